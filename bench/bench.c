@@ -0,0 +1,263 @@
+// bench.c - Microbenchmark harness and runner
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "cclaw.h"
+#include "utils/json_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_SAMPLES 31
+#define BENCH_MAX_SAMPLES 1000
+#define BENCH_MAX_FILTERS 16
+
+// Calibrated so one sample takes at least this long
+#define BENCH_SAMPLE_NS (2 * 1000 * 1000ULL)
+#define BENCH_QUICK_SAMPLE_NS (500 * 1000ULL)
+
+volatile uint64_t bench_sink;
+
+static struct {
+    const char* filters[BENCH_MAX_FILTERS];
+    uint32_t filter_count;
+    uint32_t samples;
+    bool quick;
+    uint32_t cases;
+    uint64_t rng;
+} g_bench = {
+    .samples = BENCH_DEFAULT_SAMPLES,
+    .rng = 0x9E3779B97F4A7C15ULL
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t bench_rand(void) {
+    // xorshift64*
+    g_bench.rng ^= g_bench.rng >> 12;
+    g_bench.rng ^= g_bench.rng << 25;
+    g_bench.rng ^= g_bench.rng >> 27;
+    return g_bench.rng * 0x2545F4914F6CDD1DULL;
+}
+
+void bench_seed(uint64_t seed) {
+    g_bench.rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+bool bench_quick(void) {
+    return g_bench.quick;
+}
+
+// name and filter agree on their common prefix
+static bool prefix_overlaps(const char* name, const char* filter) {
+    size_t name_len = strlen(name);
+    size_t filter_len = strlen(filter);
+    return strncmp(name, filter, name_len < filter_len ? name_len : filter_len) == 0;
+}
+
+bool bench_enabled(const char* prefix) {
+    if (g_bench.filter_count == 0) return true;
+    for (uint32_t i = 0; i < g_bench.filter_count; i++) {
+        if (prefix_overlaps(prefix, g_bench.filters[i])) return true;
+    }
+    return false;
+}
+
+static bool case_selected(const char* name) {
+    if (g_bench.filter_count == 0) return true;
+    for (uint32_t i = 0; i < g_bench.filter_count; i++) {
+        if (strncmp(name, g_bench.filters[i], strlen(g_bench.filters[i])) == 0) return true;
+    }
+    return false;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double* sorted, uint32_t count, double p) {
+    uint32_t rank = (uint32_t)(p / 100.0 * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+void bench_run(const char* name, bench_fn_t fn, void* ctx, uint64_t bytes_per_op) {
+    if (!case_selected(name)) return;
+
+    // Warm up and find an iteration count that fills a sample
+    uint64_t target = g_bench.quick ? BENCH_QUICK_SAMPLE_NS : BENCH_SAMPLE_NS;
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t start = now_ns();
+        fn(ctx, iterations);
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed >= target || iterations >= (1ULL << 40)) break;
+        iterations *= elapsed * 4 < target ? 4 : 2;
+    }
+
+    double samples[BENCH_MAX_SAMPLES];
+    double total = 0;
+    for (uint32_t i = 0; i < g_bench.samples; i++) {
+        uint64_t start = now_ns();
+        fn(ctx, iterations);
+        samples[i] = (double)(now_ns() - start) / (double)iterations;
+        total += samples[i];
+    }
+    qsort(samples, g_bench.samples, sizeof(double), compare_double);
+
+    double mean = total / g_bench.samples;
+    double p50 = percentile(samples, g_bench.samples, 50);
+    double p90 = percentile(samples, g_bench.samples, 90);
+    double p99 = percentile(samples, g_bench.samples, 99);
+    double mb_per_s = bytes_per_op && p50 > 0 ? (double)bytes_per_op / p50 * 1e9 / (1024.0 * 1024.0) : 0;
+
+    json_writer_t w;
+    json_writer_init(&w, 256);
+    json_write_object_begin(&w);
+    json_write_key(&w, "name");
+    json_write_string(&w, name);
+    json_write_key(&w, "iterations");
+    json_write_int(&w, (int64_t)iterations);
+    json_write_key(&w, "samples");
+    json_write_int(&w, g_bench.samples);
+    json_write_key(&w, "ns_min");
+    json_write_number(&w, samples[0]);
+    json_write_key(&w, "ns_p50");
+    json_write_number(&w, p50);
+    json_write_key(&w, "ns_p90");
+    json_write_number(&w, p90);
+    json_write_key(&w, "ns_p99");
+    json_write_number(&w, p99);
+    json_write_key(&w, "ns_max");
+    json_write_number(&w, samples[g_bench.samples - 1]);
+    json_write_key(&w, "ns_mean");
+    json_write_number(&w, mean);
+    if (bytes_per_op) {
+        json_write_key(&w, "bytes_per_op");
+        json_write_int(&w, (int64_t)bytes_per_op);
+        json_write_key(&w, "mb_per_s");
+        json_write_number(&w, mb_per_s);
+    }
+    json_write_object_end(&w);
+
+    char* line = json_writer_finish(&w, NULL);
+    if (line) {
+        printf("%s\n", line);
+        fflush(stdout);
+    }
+    free(line);
+
+    fprintf(stderr, "%-44s %12.1f %12.1f %12.1f", name, p50, p90, p99);
+    if (bytes_per_op) fprintf(stderr, " %10.1f MB/s", mb_per_s);
+    fprintf(stderr, "\n");
+    g_bench.cases++;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static const struct {
+    const char* prefix;
+    void (*run)(void);
+} g_suites[] = {
+    { "json.", bench_json },
+    { "context.", bench_context },
+    { "memory.", bench_memory },
+    { "sse.", bench_stream },
+    { "alloc.", bench_alloc },
+    { "cron.", bench_cron },
+    { "config.", bench_config },
+};
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [--quick] [--samples N] [--filter PREFIX[,PREFIX...]]\n"
+            "\n"
+            "Prints one JSON object per case on stdout:\n"
+            "  name, iterations, samples, ns_min, ns_p50, ns_p90, ns_p99, ns_max, ns_mean\n"
+            "  and bytes_per_op, mb_per_s for throughput cases.\n"
+            "The first line describes the run.\n",
+            argv0);
+}
+
+static bool add_filters(char* list) {
+    char* save = NULL;
+    for (char* filter = strtok_r(list, ",", &save); filter; filter = strtok_r(NULL, ",", &save)) {
+        if (g_bench.filter_count == BENCH_MAX_FILTERS) return false;
+        g_bench.filters[g_bench.filter_count++] = filter;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            g_bench.quick = true;
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            long samples = strtol(argv[++i], NULL, 10);
+            if (samples < 1 || samples > BENCH_MAX_SAMPLES) {
+                fprintf(stderr, "--samples must be 1-%d\n", BENCH_MAX_SAMPLES);
+                return 1;
+            }
+            g_bench.samples = (uint32_t)samples;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            if (!add_filters(argv[++i])) {
+                fprintf(stderr, "At most %d filters\n", BENCH_MAX_FILTERS);
+                return 1;
+            }
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    json_writer_t w;
+    json_writer_init(&w, 256);
+    json_write_object_begin(&w);
+    json_write_key(&w, "bench");
+    json_write_string(&w, "cclaw");
+    json_write_key(&w, "version");
+    json_write_string(&w, CCLAW_VERSION_STRING);
+    json_write_key(&w, "timestamp");
+    json_write_int(&w, (int64_t)time(NULL));
+    json_write_key(&w, "samples");
+    json_write_int(&w, g_bench.samples);
+    json_write_key(&w, "quick");
+    json_write_bool(&w, g_bench.quick);
+    json_write_object_end(&w);
+    char* header = json_writer_finish(&w, NULL);
+    if (header) printf("%s\n", header);
+    free(header);
+
+    fprintf(stderr, "%-44s %12s %12s %12s\n", "case", "p50 ns/op", "p90 ns/op", "p99 ns/op");
+    for (size_t i = 0; i < sizeof(g_suites) / sizeof(g_suites[0]); i++) {
+        if (!bench_enabled(g_suites[i].prefix)) continue;
+        // Each suite sees the same inputs whatever ran before it
+        bench_seed(0);
+        g_suites[i].run();
+    }
+
+    if (g_bench.cases == 0) {
+        fprintf(stderr, "No cases matched\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+// bench.h - Microbenchmark harness for CClaw hot paths
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_BENCH_H
+#define CCLAW_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// A case is a function that performs its operation `iterations` times.
+// The harness doubles the count until one call takes a few milliseconds,
+// then times a fixed number of such calls and reports per-operation
+// percentiles. Each case prints one JSON object per line on stdout and a
+// summary line on stderr, so `make bench > results.jsonl` keeps only the
+// machine-readable part.
+
+typedef void (*bench_fn_t)(void* ctx, uint64_t iterations);
+
+// bytes_per_op > 0 adds a throughput column
+void bench_run(const char* name, bench_fn_t fn, void* ctx, uint64_t bytes_per_op);
+
+// False when --filter excludes every case starting with prefix; lets a
+// suite skip expensive setup
+bool bench_enabled(const char* prefix);
+
+// --quick: small inputs only, for smoke runs
+bool bench_quick(void);
+
+// Deterministic inputs: the same seed on every run
+uint64_t bench_rand(void);
+void bench_seed(uint64_t seed);
+
+// Results are folded in here so the compiler can't drop the work
+extern volatile uint64_t bench_sink;
+
+// Suites
+void bench_json(void);
+void bench_context(void);
+void bench_memory(void);
+void bench_stream(void);
+void bench_alloc(void);
+void bench_cron(void);
+void bench_config(void);
+
+#endif // CCLAW_BENCH_H
@@ -0,0 +1,101 @@
+// bench_alloc.c - Allocator churn: malloc, size classes and arenas
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "core/alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Live set a request handler keeps while building messages
+#define CHURN_SLOTS 256
+#define CHURN_SIZES 4096
+#define ARENA_SIZE (1024 * 1024)
+
+typedef struct churn_case_t {
+    void* slots[CHURN_SLOTS];
+    size_t slot_sizes[CHURN_SLOTS];
+    size_t sizes[CHURN_SIZES];
+    uint32_t next;
+    arena_allocator_t* arena;
+} churn_case_t;
+
+// Mostly small strings and nodes, now and then a buffer, all within the
+// size classes; every allocator sees the same sequence
+static void churn_init(churn_case_t* c) {
+    memset(c, 0, sizeof(*c));
+    bench_seed(CHURN_SIZES);
+    for (uint32_t i = 0; i < CHURN_SIZES; i++) {
+        uint64_t r = bench_rand();
+        size_t limit = (r & 7) == 0 ? SIZECLASS_MAX_SIZE : 256;
+        c->sizes[i] = 8 + (size_t)((r >> 8) % (limit - 8));
+    }
+}
+
+static void run_malloc(void* ctx, uint64_t iterations) {
+    churn_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t slot = c->next % CHURN_SLOTS;
+        size_t size = c->sizes[c->next++ % CHURN_SIZES];
+        free(c->slots[slot]);
+        c->slots[slot] = calloc(1, size);
+        bench_sink += (uintptr_t)c->slots[slot];
+    }
+}
+
+static void run_sizeclass(void* ctx, uint64_t iterations) {
+    churn_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t slot = c->next % CHURN_SLOTS;
+        size_t size = c->sizes[c->next++ % CHURN_SIZES];
+        if (c->slots[slot]) sizeclass_free(c->slots[slot], c->slot_sizes[slot]);
+        c->slots[slot] = sizeclass_calloc(size);
+        c->slot_sizes[slot] = size;
+        bench_sink += (uintptr_t)c->slots[slot];
+    }
+}
+
+// One "request" of CHURN_SLOTS allocations, then a reset
+static void run_arena(void* ctx, uint64_t iterations) {
+    churn_case_t* c = ctx;
+    allocator_t* a = &c->arena->base;
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (c->next % CHURN_SLOTS == 0) arena_reset(c->arena);
+        void* ptr = alloc(a, c->sizes[c->next++ % CHURN_SIZES]);
+        bench_sink += (uintptr_t)ptr;
+    }
+}
+
+static void churn_free_slots(churn_case_t* c, bool sizeclass) {
+    for (uint32_t i = 0; i < CHURN_SLOTS; i++) {
+        if (!c->slots[i]) continue;
+        if (sizeclass) {
+            sizeclass_free(c->slots[i], c->slot_sizes[i]);
+        } else {
+            free(c->slots[i]);
+        }
+        c->slots[i] = NULL;
+    }
+}
+
+void bench_alloc(void) {
+    churn_case_t* c = malloc(sizeof(churn_case_t));
+    if (!c) return;
+
+    churn_init(c);
+    bench_run("alloc.churn/malloc", run_malloc, c, 0);
+    churn_free_slots(c, false);
+
+    churn_init(c);
+    bench_run("alloc.churn/sizeclass", run_sizeclass, c, 0);
+    churn_free_slots(c, true);
+
+    churn_init(c);
+    c->arena = arena_create(ARENA_SIZE);
+    if (c->arena) {
+        bench_run("alloc.churn/arena", run_arena, c, 0);
+        arena_destroy(c->arena);
+    }
+    free(c);
+}
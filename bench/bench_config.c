@@ -0,0 +1,51 @@
+// bench_config.c - config_load from JSON and from its binary snapshot
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "core/config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void run_load(void* ctx, uint64_t iterations) {
+    const char* path = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        config_t* config = NULL;
+        if (config_load(STR_VIEW(path), &config) == ERR_OK) {
+            bench_sink += config->gateway.port;
+            config_destroy(config);
+        }
+    }
+}
+
+// The config `cclaw onboard` writes, loaded the way every command starts
+void bench_config(void) {
+    char dir[] = "/tmp/cclaw_bench_config_XXXXXX";
+    if (!mkdtemp(dir)) return;
+    char path[64], snap[80];
+    snprintf(path, sizeof(path), "%s/config.json", dir);
+    snprintf(snap, sizeof(snap), "%s.snap", path);
+
+    config_t* config = config_default(NULL);
+    if (!config || config_save(config, STR_VIEW(path)) != ERR_OK) {
+        fprintf(stderr, "config: cannot write %s\n", path);
+        config_destroy(config);
+        rmdir(dir);
+        return;
+    }
+    config_destroy(config);
+
+    setenv("CCLAW_CONFIG_SNAPSHOT", "0", 1);
+    bench_run("config.load/json", run_load, path, 0);
+    unsetenv("CCLAW_CONFIG_SNAPSHOT");
+
+    // The first load writes the snapshot the timed ones read
+    run_load(path, 1);
+    bench_run("config.load/snapshot", run_load, path, 0);
+
+    unlink(snap);
+    unlink(path);
+    rmdir(dir);
+}
@@ -0,0 +1,91 @@
+// bench_context.c - Context window assembly at various conversation depths
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "core/agent.h"
+#include "core/tokens.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// agent_session_window is what build_context_messages runs every turn: the
+// walk from the current message to the root plus the token budgeting.
+
+#define CONTEXT_BUDGET_TOKENS 32000
+
+typedef struct context_case_t {
+    agent_session_t session;
+    str_t* texts;
+    uint32_t depth;
+} context_case_t;
+
+static const char* g_lines[] = {
+    "Can you look at the failing test in the memory module?",
+    "The search returns entries in insertion order instead of by relevance, because the ranking "
+    "query drops the bm25 column when a category filter is set.",
+    "ok",
+    "Here is the patch. I moved the filter into the FTS query so the index does the work and the "
+    "ranking survives; the test now passes and the benchmark is about twice as fast.",
+    "Run it again with the sanitizer build please.",
+    "All 214 tests pass under ASAN and UBSAN. No leaks reported.",
+};
+
+static bool context_build(context_case_t* c, uint32_t depth) {
+    c->depth = depth;
+    c->texts = calloc(depth, sizeof(str_t));
+    if (!c->texts) return false;
+
+    agent_message_t* previous = NULL;
+    for (uint32_t i = 0; i < depth; i++) {
+        const char* line = g_lines[bench_rand() % (sizeof(g_lines) / sizeof(g_lines[0]))];
+        c->texts[i] = STR_VIEW(line);
+        agent_message_type_t type = i % 2 ? AGENT_MSG_ASSISTANT : AGENT_MSG_USER;
+        agent_message_t* msg = agent_message_create(type, &c->texts[i]);
+        if (!msg) return false;
+        if (previous) {
+            agent_message_add_child(previous, msg);
+        } else {
+            c->session.root = msg;
+        }
+        previous = msg;
+    }
+    c->session.current = previous;
+    return true;
+}
+
+static void context_free(context_case_t* c) {
+    free(c->session.context);
+    free(c->session.context_nodes);
+    free(c->session.window);
+    agent_message_tree_free(c->session.root);
+    free(c->texts);
+}
+
+static void run_window(void* ctx, uint64_t iterations) {
+    context_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        chat_message_t* messages = NULL;
+        uint32_t count = 0;
+        agent_session_window(&c->session, TOKEN_FAMILY_OPENAI, CONTEXT_BUDGET_TOKENS, 0, &messages, &count);
+        bench_sink += count;
+    }
+}
+
+void bench_context(void) {
+    static const uint32_t depths[] = { 10, 100, 1000, 10000 };
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        if (bench_quick() && depths[i] > 1000) continue;
+
+        char name[64];
+        snprintf(name, sizeof(name), "context.window/depth_%u", depths[i]);
+        if (!bench_enabled(name)) continue;
+
+        context_case_t c = {0};
+        if (context_build(&c, depths[i])) {
+            bench_run(name, run_window, &c, 0);
+        } else {
+            fprintf(stderr, "%s: out of memory\n", name);
+        }
+        context_free(&c);
+    }
+}
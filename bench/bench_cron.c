@@ -0,0 +1,67 @@
+// bench_cron.c - Cron expression parsing and next-run computation
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "runtime/daemon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CRON_STARTS 1024
+
+typedef struct cron_case_t {
+    str_t expression;
+    cron_job_t job;
+    uint64_t starts[CRON_STARTS];   // ms, spread over a year
+    uint32_t next;
+} cron_case_t;
+
+static void run_next(void* ctx, uint64_t iterations) {
+    cron_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        cron_compute_next_run(&c->job, c->starts[c->next++ % CRON_STARTS]);
+        bench_sink += c->job.next_run;
+    }
+}
+
+static void run_parse(void* ctx, uint64_t iterations) {
+    cron_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        cron_job_t job = {0};
+        cron_parse_expression(&c->expression, &job);
+        bench_sink += job.minutes;
+    }
+}
+
+void bench_cron(void) {
+    static const struct {
+        const char* label;
+        const char* expression;
+    } cases[] = {
+        { "every_5_minutes", "*/5 * * * *" },
+        { "weekdays_9am", "0 9 * * 1-5" },
+        { "monthly", "30 2 1 * *" },
+        { "day_or_weekday", "0 12 13 * 5" },
+        { "leap_day", "59 23 29 2 *" },
+    };
+
+    // 2026-01-01T00:00:00Z
+    uint64_t base = 1767225600ULL * 1000;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char next_name[64], parse_name[64];
+        snprintf(next_name, sizeof(next_name), "cron.next/%s", cases[i].label);
+        snprintf(parse_name, sizeof(parse_name), "cron.parse/%s", cases[i].label);
+
+        cron_case_t c = { .expression = STR_VIEW(cases[i].expression) };
+        if (cron_parse_expression(&c.expression, &c.job) != ERR_OK) {
+            fprintf(stderr, "%s: does not parse\n", cases[i].expression);
+            continue;
+        }
+        for (uint32_t j = 0; j < CRON_STARTS; j++) {
+            c.starts[j] = base + (bench_rand() % (365ULL * 24 * 60)) * 60 * 1000;
+        }
+
+        bench_run(next_name, run_next, &c, 0);
+        bench_run(parse_name, run_parse, &c, 0);
+    }
+}
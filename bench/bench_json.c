@@ -0,0 +1,212 @@
+// bench_json.c - json_parse/json_print on provider payloads
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "json_config.h"
+#include "utils/json_writer.h"
+#include "utils/text_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A chat completion that answers with text and two tool calls
+static const char g_openai_response[] =
+    "{\"id\":\"chatcmpl-9x2KfQ8ZyV3nMhT1aB7cD4eF\",\"object\":\"chat.completion\",\"created\":1767225600,"
+    "\"model\":\"gpt-4o-2024-08-06\",\"system_fingerprint\":\"fp_3aa7262c27\",\"choices\":[{\"index\":0,"
+    "\"message\":{\"role\":\"assistant\",\"content\":\"I'll check the weather in both cities and then look up "
+    "the train schedule between them so you can plan the trip.\",\"tool_calls\":["
+    "{\"id\":\"call_Vx8mQ2pL9rT4\",\"type\":\"function\",\"function\":{\"name\":\"weather\","
+    "\"arguments\":\"{\\\"location\\\":\\\"Lisbon, PT\\\",\\\"unit\\\":\\\"celsius\\\",\\\"days\\\":3}\"}},"
+    "{\"id\":\"call_Kd3nB7wE1yU6\",\"type\":\"function\",\"function\":{\"name\":\"shell\","
+    "\"arguments\":\"{\\\"command\\\":\\\"curl -s 'https://example.com/trains?from=LIS&to=OPO' | jq '.[] | "
+    "{dep, arr}'\\\"}\"}}],\"refusal\":null},\"logprobs\":null,\"finish_reason\":\"tool_calls\"}],"
+    "\"usage\":{\"prompt_tokens\":1843,\"completion_tokens\":96,\"total_tokens\":1939,"
+    "\"prompt_tokens_details\":{\"cached_tokens\":1536,\"audio_tokens\":0},"
+    "\"completion_tokens_details\":{\"reasoning_tokens\":0,\"audio_tokens\":0,"
+    "\"accepted_prediction_tokens\":0,\"rejected_prediction_tokens\":0}}}";
+
+// A Messages API reply mixing text, a tool_use block and unicode
+static const char g_anthropic_response[] =
+    "{\"id\":\"msg_01XFDUDYJgAACzvnptvVoYEL\",\"type\":\"message\",\"role\":\"assistant\","
+    "\"model\":\"claude-sonnet-4-20250514\",\"content\":[{\"type\":\"text\",\"text\":\"Voil\\u00e0 \\u2014 "
+    "here is the summary you asked for:\\n\\n1. The config loader now validates every section.\\n2. "
+    "Memory search returns ranked snippets.\\n3. \\\"Streaming\\\" works for both dialects.\\n\\nI'll "
+    "save this to memory.\"},{\"type\":\"tool_use\",\"id\":\"toolu_01A09q90qw90lq917835lq9\","
+    "\"name\":\"memory_store\",\"input\":{\"key\":\"release-notes-0.2\",\"category\":\"core\","
+    "\"content\":\"Config validation, ranked memory snippets, streaming for OpenAI and Anthropic.\","
+    "\"tags\":[\"release\",\"notes\",\"0.2\"]}}],\"stop_reason\":\"tool_use\",\"stop_sequence\":null,"
+    "\"usage\":{\"input_tokens\":2095,\"cache_creation_input_tokens\":0,\"cache_read_input_tokens\":1790,"
+    "\"output_tokens\":143}}";
+
+typedef struct json_case_t {
+    const char* text;
+    size_t len;
+    json_value_t* value;
+} json_case_t;
+
+// An agent-sized request: system prompt, 40 turns and eight tool schemas
+static char* make_request(size_t* out_len) {
+    static const char* words[] = {
+        "the", "config", "file", "memory", "search", "returns", "results", "for", "each", "query",
+        "agent", "tool", "call", "with", "arguments", "and", "a", "summary", "of", "output"
+    };
+
+    json_writer_t w;
+    json_writer_init(&w, 16384);
+    json_write_object_begin(&w);
+    json_write_key(&w, "model");
+    json_write_string(&w, "gpt-4o");
+    json_write_key(&w, "temperature");
+    json_write_number(&w, 0.7);
+    json_write_key(&w, "stream");
+    json_write_bool(&w, true);
+
+    json_write_key(&w, "messages");
+    json_write_array_begin(&w);
+    char text[1024];
+    for (uint32_t i = 0; i < 41; i++) {
+        size_t len = 0;
+        uint32_t count = 8 + (uint32_t)(bench_rand() % 120);
+        for (uint32_t j = 0; j < count && len + 16 < sizeof(text); j++) {
+            len += (size_t)snprintf(text + len, sizeof(text) - len, "%s%s", j ? " " : "",
+                                    words[bench_rand() % (sizeof(words) / sizeof(words[0]))]);
+        }
+        json_write_object_begin(&w);
+        json_write_key(&w, "role");
+        json_write_string(&w, i == 0 ? "system" : (i % 2 ? "user" : "assistant"));
+        json_write_key(&w, "content");
+        json_write_string_len(&w, text, len);
+        json_write_object_end(&w);
+    }
+    json_write_array_end(&w);
+
+    json_write_key(&w, "tools");
+    json_write_array_begin(&w);
+    for (uint32_t i = 0; i < 8; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "tool_%u", i);
+        json_write_object_begin(&w);
+        json_write_key(&w, "type");
+        json_write_string(&w, "function");
+        json_write_key(&w, "function");
+        json_write_object_begin(&w);
+        json_write_key(&w, "name");
+        json_write_string(&w, name);
+        json_write_key(&w, "description");
+        json_write_string(&w, "Runs the named operation against the workspace and returns its output");
+        json_write_key(&w, "parameters");
+        json_write_object_begin(&w);
+        json_write_key(&w, "type");
+        json_write_string(&w, "object");
+        json_write_key(&w, "properties");
+        json_write_object_begin(&w);
+        json_write_key(&w, "path");
+        json_write_object_begin(&w);
+        json_write_key(&w, "type");
+        json_write_string(&w, "string");
+        json_write_object_end(&w);
+        json_write_key(&w, "limit");
+        json_write_object_begin(&w);
+        json_write_key(&w, "type");
+        json_write_string(&w, "integer");
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+        json_write_key(&w, "required");
+        json_write_array_begin(&w);
+        json_write_string(&w, "path");
+        json_write_array_end(&w);
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+    }
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+
+    return json_writer_finish(&w, out_len);
+}
+
+static void run_parse(void* ctx, uint64_t iterations) {
+    json_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        json_value_t* value = json_parse_len(c->text, c->len);
+        bench_sink += (uintptr_t)value;
+        json_free(value);
+    }
+}
+
+static void run_print(void* ctx, uint64_t iterations) {
+    json_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        char* text = json_print(c->value, false);
+        bench_sink += text ? (uint64_t)text[0] : 0;
+        free(text);
+    }
+}
+
+static void bench_payload(const char* label, const char* text, size_t len) {
+    char parse_name[64], print_name[64];
+    snprintf(parse_name, sizeof(parse_name), "json.parse/%s", label);
+    snprintf(print_name, sizeof(print_name), "json.print/%s", label);
+
+    json_case_t c = { .text = text, .len = len, .value = json_parse_len(text, len) };
+    if (!c.value) {
+        fprintf(stderr, "%s: payload does not parse\n", label);
+        return;
+    }
+
+    bench_run(parse_name, run_parse, &c, len);
+    bench_run(print_name, run_print, &c, len);
+    json_free(c.value);
+}
+
+typedef struct escape_case_t {
+    char* text;
+    size_t len;
+} escape_case_t;
+
+static void run_escape(void* ctx, uint64_t iterations) {
+    escape_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        json_writer_t w;
+        json_writer_init(&w, c->len + 1024);
+        json_write_string_len(&w, c->text, c->len);
+        size_t len = 0;
+        free(json_writer_finish(&w, &len));
+        bench_sink += len;
+    }
+}
+
+// A large context string, mostly prose with the odd newline and quote,
+// escaped with each kernel this machine has
+static void bench_escape(void) {
+    escape_case_t c = { .len = bench_quick() ? 16 * 1024 : 256 * 1024 };
+    c.text = malloc(c.len);
+    if (!c.text) return;
+    for (size_t i = 0; i < c.len; i++) {
+        uint64_t r = bench_rand() % 100;
+        c.text[i] = r == 0 ? '\n' : r == 1 ? '"' : r < 15 ? ' ' : (char)('a' + r % 26);
+    }
+
+    text_scan_impl_t initial = text_scan_impl();
+    for (int impl = 0; impl < TEXT_SCAN_IMPL_COUNT; impl++) {
+        if (!text_scan_set_impl((text_scan_impl_t)impl)) continue;
+        char name[64];
+        snprintf(name, sizeof(name), "json.escape/%s", text_scan_impl_name((text_scan_impl_t)impl));
+        bench_run(name, run_escape, &c, c.len);
+    }
+    text_scan_set_impl(initial);
+    free(c.text);
+}
+
+void bench_json(void) {
+    bench_payload("openai_response", g_openai_response, sizeof(g_openai_response) - 1);
+    bench_payload("anthropic_response", g_anthropic_response, sizeof(g_anthropic_response) - 1);
+
+    size_t len = 0;
+    char* request = make_request(&len);
+    if (request) bench_payload("chat_request", request, len);
+    free(request);
+
+    if (bench_enabled("json.escape")) bench_escape();
+}
@@ -0,0 +1,157 @@
+// bench_memory.c - Keyword search on the sqlite and markdown backends
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "core/memory.h"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_BATCH 1000
+#define MEMORY_QUERY_COUNT 16
+
+typedef struct memory_case_t {
+    memory_t* memory;
+    str_t queries[MEMORY_QUERY_COUNT];
+} memory_case_t;
+
+// Vocabulary built from syllables, so relevance varies from term to term
+static const char* g_syllables[] = {
+    "ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo", "ze", "po", "qua", "ber", "dun", "fel", "gor", "hin"
+};
+#define SYLLABLE_COUNT (sizeof(g_syllables) / sizeof(g_syllables[0]))
+
+static size_t make_word(char* out, size_t cap, uint64_t seed) {
+    size_t len = 0;
+    for (uint32_t i = 0; i < 3 && len + 4 < cap; i++) {
+        const char* syllable = g_syllables[(seed >> (i * 4)) % SYLLABLE_COUNT];
+        size_t n = strlen(syllable);
+        memcpy(out + len, syllable, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// Skewed towards a few common words, like real notes
+static uint64_t word_seed(void) {
+    uint64_t r = bench_rand();
+    return (r & 1) ? (r >> 8) % 64 : (r >> 8) % 4096;
+}
+
+static size_t make_content(char* out, size_t cap) {
+    size_t len = 0;
+    uint32_t words = 12 + (uint32_t)(bench_rand() % 40);
+    for (uint32_t i = 0; i < words && len + 16 < cap; i++) {
+        if (i) out[len++] = ' ';
+        len += make_word(out + len, cap - len, word_seed());
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static bool memory_fill(memory_t* memory, uint32_t entries) {
+    static const memory_category_t categories[] = {
+        MEMORY_CATEGORY_CORE, MEMORY_CATEGORY_DAILY, MEMORY_CATEGORY_CONVERSATION
+    };
+    char key[32], content[512];
+
+    bool ok = true;
+    for (uint32_t done = 0; ok && done < entries; done += MEMORY_BATCH) {
+        uint32_t count = entries - done < MEMORY_BATCH ? entries - done : MEMORY_BATCH;
+        memory_entry_t* batch = calloc(count, sizeof(memory_entry_t));
+        if (!batch) return false;
+
+        uint32_t filled = 0;
+        for (; filled < count; filled++) {
+            snprintf(key, sizeof(key), "note-%u", done + filled);
+            str_t key_str = STR_VIEW(key);
+            str_t content_str = { .data = content, .len = (uint32_t)make_content(content, sizeof(content)) };
+            memory_entry_t* entry = memory_entry_create(&key_str, &content_str,
+                                                        categories[(done + filled) % 3], NULL);
+            if (!entry) break;
+            batch[filled] = *entry;
+            free(entry);
+        }
+        ok = filled == count && memory_store_multiple(memory, batch, filled) == ERR_OK;
+        memory_entry_array_free(batch, filled);
+    }
+    return ok && memory_flush(memory) == ERR_OK;
+}
+
+// One operation is the whole query mix; common and rare terms differ by
+// orders of magnitude, so a single query per operation would make the
+// percentiles depend on which queries a sample happened to get
+static void run_search(void* ctx, uint64_t iterations) {
+    memory_case_t* c = ctx;
+    memory_search_opts_t opts = memory_search_opts_default();
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (uint32_t q = 0; q < MEMORY_QUERY_COUNT; q++) {
+            memory_entry_t* results = NULL;
+            uint32_t count = 0;
+            if (memory_search(c->memory, &c->queries[q], &opts, &results, &count) == ERR_OK) {
+                bench_sink += count;
+                memory_entry_array_free(results, count);
+            }
+        }
+    }
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    return remove(path);
+}
+
+static void bench_backend(const char* backend, uint32_t entries) {
+    char name[64];
+    snprintf(name, sizeof(name), "memory.%s/%u/search_mix", backend, entries);
+    if (!bench_enabled(name)) return;
+
+    // sqlite runs in memory so the numbers don't measure the disk
+    char dir[] = "/tmp/cclaw_bench_XXXXXX";
+    bool on_disk = strcmp(backend, "markdown") == 0;
+    if (on_disk && !mkdtemp(dir)) {
+        fprintf(stderr, "%s: cannot create a data directory\n", name);
+        return;
+    }
+
+    memory_config_t config = memory_config_default();
+    if (on_disk) config.data_dir = STR_VIEW(dir);
+
+    memory_case_t c = {0};
+    char words[MEMORY_QUERY_COUNT][32];
+    for (uint32_t i = 0; i < MEMORY_QUERY_COUNT; i++) {
+        // Half common terms, half rare ones, one two-word query
+        uint64_t seed = i % 2 ? (uint64_t)i * 7 : 512 + (uint64_t)i * 131;
+        size_t len = make_word(words[i], sizeof(words[i]), seed);
+        if (i == MEMORY_QUERY_COUNT - 1) {
+            words[i][len++] = ' ';
+            len += make_word(words[i] + len, sizeof(words[i]) - len, 3);
+        }
+        c.queries[i] = (str_t){ .data = words[i], .len = (uint32_t)len };
+    }
+
+    bench_seed(entries);
+    if (memory_create(backend, &config, &c.memory) != ERR_OK || c.memory->vtable->init(c.memory) != ERR_OK ||
+        !memory_fill(c.memory, entries)) {
+        fprintf(stderr, "%s: setup failed\n", name);
+    } else {
+        bench_run(name, run_search, &c, 0);
+    }
+
+    if (c.memory) {
+        c.memory->vtable->cleanup(c.memory);
+        c.memory->vtable->destroy(c.memory);
+    }
+    if (on_disk) nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void bench_memory(void) {
+    static const uint32_t sizes[] = { 1000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (bench_quick() && sizes[i] > 1000) continue;
+        bench_backend("sqlite", sizes[i]);
+        bench_backend("markdown", sizes[i]);
+    }
+}
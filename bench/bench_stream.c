@@ -0,0 +1,110 @@
+// bench_stream.c - SSE parsing throughput for both stream dialects
+// SPDX-License-Identifier: MIT
+
+#include "bench.h"
+#include "providers/base.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Frames per stream, and the size of the writes the transport delivers
+#define STREAM_FRAMES 2000
+#define STREAM_WRITE_SIZE 1400
+
+typedef struct stream_case_t {
+    sse_dialect_t dialect;
+    char* data;
+    size_t len;
+} stream_case_t;
+
+static const char* g_tokens[] = {
+    "The", " config", " loader", " now", " validates", " every", " section", ",", " and",
+    " memory", " search", " returns", " ranked", " snippets", ".", "\\n", " \\\"quoted\\\"", " caf\\u00e9"
+};
+
+static bool append(stream_case_t* c, size_t* cap, const char* text) {
+    size_t n = strlen(text);
+    if (c->len + n + 1 > *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 65536;
+        while (new_cap < c->len + n + 1) new_cap *= 2;
+        char* data = realloc(c->data, new_cap);
+        if (!data) return false;
+        c->data = data;
+        *cap = new_cap;
+    }
+    memcpy(c->data + c->len, text, n + 1);
+    c->len += n;
+    return true;
+}
+
+static bool stream_build(stream_case_t* c) {
+    size_t cap = 0;
+    char frame[512];
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < STREAM_FRAMES; i++) {
+        const char* token = g_tokens[bench_rand() % (sizeof(g_tokens) / sizeof(g_tokens[0]))];
+        if (c->dialect == SSE_DIALECT_ANTHROPIC) {
+            snprintf(frame, sizeof(frame),
+                     "event: content_block_delta\n"
+                     "data: {\"type\":\"content_block_delta\",\"index\":0,"
+                     "\"delta\":{\"type\":\"text_delta\",\"text\":\"%s\"}}\n\n", token);
+        } else {
+            snprintf(frame, sizeof(frame),
+                     "data: {\"id\":\"chatcmpl-9x2KfQ8ZyV3nMhT1aB7cD4eF\",\"object\":\"chat.completion.chunk\","
+                     "\"created\":1767225600,\"model\":\"gpt-4o-2024-08-06\",\"system_fingerprint\":\"fp_3aa7262c27\","
+                     "\"choices\":[{\"index\":0,\"delta\":{\"content\":\"%s\"},\"logprobs\":null,"
+                     "\"finish_reason\":null}]}\n\n", token);
+        }
+        ok = append(c, &cap, frame);
+    }
+    if (ok && c->dialect == SSE_DIALECT_ANTHROPIC) {
+        ok = append(c, &cap, "event: message_stop\ndata: {\"type\":\"message_stop\"}\n\n");
+    } else if (ok) {
+        ok = append(c, &cap, "data: [DONE]\n\n");
+    }
+    return ok;
+}
+
+static void on_chunk(const char* chunk, void* user_data) {
+    (*(uint64_t*)user_data) += (uint64_t)chunk[0];
+}
+
+static void run_stream(void* ctx, uint64_t iterations) {
+    stream_case_t* c = ctx;
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint64_t seen = 0;
+        sse_parser_t parser;
+        if (sse_parser_init(&parser, c->dialect, NULL, on_chunk, &seen) != ERR_OK) return;
+
+        // Writes split lines wherever they fall, as curl's do
+        for (size_t pos = 0; pos < c->len; pos += STREAM_WRITE_SIZE) {
+            size_t n = c->len - pos < STREAM_WRITE_SIZE ? c->len - pos : STREAM_WRITE_SIZE;
+            sse_parser_feed(c->data + pos, n, &parser);
+        }
+        sse_parser_free(&parser);
+        bench_sink += seen;
+    }
+}
+
+void bench_stream(void) {
+    static const struct {
+        const char* name;
+        sse_dialect_t dialect;
+    } cases[] = {
+        { "sse.parse/openai", SSE_DIALECT_OPENAI },
+        { "sse.parse/anthropic", SSE_DIALECT_ANTHROPIC },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (!bench_enabled(cases[i].name)) continue;
+
+        stream_case_t c = { .dialect = cases[i].dialect };
+        if (stream_build(&c)) {
+            bench_run(cases[i].name, run_stream, &c, c.len);
+        } else {
+            fprintf(stderr, "%s: out of memory\n", cases[i].name);
+        }
+        free(c.data);
+    }
+}
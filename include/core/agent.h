@@ -8,12 +8,14 @@
 #include "core/types.h"
 #include "core/error.h"
 #include "core/tool.h"
+#include "core/tokens.h"
 #include "core/memory.h"
 #include "providers/base.h"
 #include "core/channel.h"
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 // Forward declarations
 typedef struct agent_vtable_t agent_vtable_t;
@@ -22,6 +24,12 @@ typedef struct agent_session_t agent_session_t;
 typedef struct agent_message_t agent_message_t;
 typedef struct agent_context_t agent_context_t;
 typedef struct agent_config_t agent_config_t;
+typedef struct agent_summary_job_t agent_summary_job_t;
+typedef struct agent_session_map_t agent_session_map_t;
+typedef struct session_log_t session_log_t;
+
+// Streamed reply text; delta is only valid during the call
+typedef void (*agent_text_callback_t)(const str_t* delta, void* user_data);
 
 // Agent message types (inspired by Pi's conversation model)
 typedef enum {
@@ -41,29 +49,50 @@ struct agent_message_t {
 
     // For tool calls
     str_t tool_name;
-    str_t tool_args;             // JSON arguments
+    str_t tool_args;             // JSON arguments (tool_calls array on AGENT_MSG_TOOL_CALL)
     str_t tool_result;           // Execution result
+    str_t tool_call_id;          // Provider call id a result answers
 
-    // Tree structure (Pi's conversation branching)
+    // Tree structure (Pi's conversation branching): first child / next
+    // sibling links, so adding a branch never reallocates
     agent_message_t* parent;     // Parent message (NULL for root)
-    agent_message_t** children;  // Array of child messages (branches)
-    uint32_t child_count;
-    uint32_t child_capacity;
-
-    // Navigation
+    agent_message_t* first_child;
+    agent_message_t* last_child;
     agent_message_t* prev_sibling;
     agent_message_t* next_sibling;
+    uint32_t child_count;
+    uint32_t node_id;            // Slot in the session's node store (0 = allocated on its own)
 
     // Metadata
     uint64_t timestamp;
-    str_t model;                 // Which model generated this
+    str_t model;                 // Which model generated this (interned on live turns)
     uint32_t tokens_input;
     uint32_t tokens_output;
+    uint32_t tokens_cached;      // Input tokens served from the provider's prefix cache
+    uint32_t token_counts[TOKEN_FAMILY_COUNT]; // Estimated size per family (0 = not counted)
 
     // For partial/streaming content
     bool is_complete;
+
+    // Persistence (core/session_log.h)
+    uint32_t log_index;          // 1-based position in the session log (0 = not logged)
+    bool log_borrowed;           // Strings are views into the mapped log, not owned
+    bool strings_borrowed;       // Strings live in the session's string arena
 };
 
+// Per-session node store: messages are carved from fixed-size slabs and
+// addressed by 32-bit ids, strings come from one arena, and both are
+// released with the session instead of node by node
+#define AGENT_NODE_SLAB_SIZE 256
+
+typedef struct agent_node_store_t {
+    agent_message_t** slabs;         // AGENT_NODE_SLAB_SIZE nodes each
+    uint32_t slab_count;
+    uint32_t slab_capacity;
+    uint32_t node_count;             // Ids 1..node_count are in use
+    arena_allocator_t* strings;
+} agent_node_store_t;
+
 // Agent session (Pi-style conversation tree)
 struct agent_session_t {
     str_t id;                        // Session ID
@@ -92,6 +121,30 @@ struct agent_session_t {
     str_t provider_name;
     str_t model;
     double temperature;
+
+    // Context cache: system prompt plus root..tip, borrowing message content
+    chat_message_t* context;
+    agent_message_t** context_nodes; // Tree node behind each slot (slot 0 = NULL)
+    uint32_t context_count;
+    uint32_t context_capacity;
+
+    // Budgeted slice of the context actually sent (agent_session_window)
+    chat_message_t* window;
+    uint32_t window_capacity;
+    agent_message_t* window_anchor;  // First message of the last window, reused while it fits
+
+    // Per-turn scratch (tool calls, tool output before it joins the tree);
+    // reset when the turn ends
+    arena_allocator_t* scratch;
+
+    // Background summary of an old prefix, started when a turn ends
+    agent_summary_job_t* summary_job;
+
+    // Append-only log (NULL = in memory only)
+    session_log_t* log;
+
+    // Backing storage for messages made with agent_session_message_create
+    agent_node_store_t nodes;
 };
 
 // Agent configuration
@@ -106,6 +159,8 @@ struct agent_config_t {
     uint32_t max_context_messages;   // Max messages to include in context
     uint32_t context_window_tokens;  // Token budget for context
     bool enable_summarization;       // Auto-summarize old context (Pi-style)
+    uint32_t recall_top_k;           // Memories searched for each message and added to the system prompt (0 = off)
+    uint32_t recall_token_budget;    // Most of the context window those memories may take
 
     // Tool configuration
     bool enable_shell_tool;
@@ -113,12 +168,19 @@ struct agent_config_t {
     bool enable_memory_tools;
     str_t allowed_shell_commands;    // Comma-separated whitelist
     str_t workspace_root;            // Restrict file operations to this dir
+    uint32_t max_parallel_tools;     // Workers for one message's tool calls (0 = sequential)
+    uint32_t tool_timeout_ms;        // Per-call limit (0 = none)
+    bool speculative_tools;          // Start pure tools before a streamed message ends (needs max_parallel_tools)
 
     // Extension system (Pi philosophy: agent extends itself)
     bool enable_extensions;          // Allow agent to create extensions
     str_t extensions_dir;            // Where extensions are stored
     bool hot_reload_extensions;      // Auto-reload on file change
 
+    // Persistence
+    str_t sessions_dir;              // Session logs; empty = sessions live in memory only
+    size_t session_memory_budget;    // Soft cap on ALLOC_TAG_AGENT bytes (0 = none), see the session map
+
     // UI preferences
     bool stream_responses;           // Stream LLM output
     bool show_token_usage;           // Display token counts
@@ -130,8 +192,21 @@ struct agent_context_t {
     // Subsystems
     provider_t* provider;
     memory_t* memory;
+    struct docker_pool_t* sandbox;   // RUNTIME_KIND_DOCKER: where the shell tool runs
     tool_t** tools;
     uint32_t tool_count;
+    uint32_t* tool_slots;            // Name index: tool index + 1, 0 = empty
+    uint32_t tool_slot_count;
+    tool_pool_t* tool_pool;          // Created on the first parallel batch
+    tool_def_t* tool_defs;           // Serialized once; rebuilt when tools or autonomy change
+    uint32_t tool_def_count;
+    autonomy_level_t tool_defs_level;
+    uint32_t tool_defs_tokens;       // Estimated cost of sending tool_defs
+
+    // Summaries may go to a cheaper route (NULL/empty = main provider/model)
+    provider_t* summary_provider;    // Borrowed
+    str_t summary_model;
+    bool tool_defs_valid;
 
     // Session management
     agent_session_t** sessions;
@@ -139,6 +214,10 @@ struct agent_context_t {
     uint32_t session_capacity;
     agent_session_t* active_session;
 
+    // Guards lazily built shared state (tool_defs, tool_pool) when turns
+    // run on several threads; the registries themselves are read-only then
+    pthread_mutex_t shared_lock;
+
     // Configuration
     agent_config_t config;
 
@@ -211,16 +290,48 @@ void agent_destroy(agent_t* agent);
 // Session Management
 // ============================================================================
 
+// With config.sessions_dir set, sessions are logged as they grow; a session
+// whose log cannot be opened stays in memory
 err_t agent_session_create(agent_t* agent, const str_t* name, agent_session_t** out_session);
+// Map a logged session back in (returns it if already open)
 err_t agent_session_load(agent_t* agent, const str_t* session_id, agent_session_t** out_session);
+// Load session_id if it has a log, otherwise create it under that id
+err_t agent_session_resume(agent_t* agent, const str_t* session_id, const str_t* name,
+                           agent_session_t** out_session);
+// Log the session (all of it, if it was not logged yet) and flush to disk
 err_t agent_session_save(agent_t* agent, agent_session_t* session);
 void agent_session_close(agent_t* agent, agent_session_t* session);
 err_t agent_session_list(agent_t* agent, str_t** out_ids, uint32_t* out_count);
+// $HOME/AGENT_SESSIONS_DIR_DEFAULT, for config.sessions_dir (caller frees)
+str_t agent_sessions_dir_default(void);
 
 // Session helpers
 agent_session_t* agent_session_get_active(agent_t* agent);
 err_t agent_session_set_active(agent_t* agent, agent_session_t* session);
 
+// ============================================================================
+// Conversation Sessions (many chats, one agent)
+// ============================================================================
+
+// Sessions keyed by (channel, sender), spread over shards by
+// channel_route_hash. A shard's lock is held for a whole turn, so turns of
+// one conversation are serialized while other shards run in parallel;
+// with one shard per inbox worker each lock is only ever taken by its own
+// worker. Map sessions are not in ctx->sessions and never become active.
+// Past the agent's session_memory_budget, a turn's shard closes its least
+// recently used logged sessions; they reopen from their logs on next contact.
+// Tools must not be registered while turns run.
+err_t agent_session_map_create(agent_t* agent, uint32_t shard_count, agent_session_map_t** out_map);
+void agent_session_map_destroy(agent_session_map_t* map);
+uint32_t agent_session_map_count(agent_session_map_t* map);
+
+// One turn in the conversation's session, created on first contact
+err_t agent_session_map_process(agent_session_map_t* map, const str_t* channel, const str_t* sender,
+                                const str_t* user_input, str_t* out_response);
+err_t agent_session_map_process_stream(agent_session_map_t* map, const str_t* channel, const str_t* sender,
+                                       const str_t* user_input, agent_text_callback_t on_text,
+                                       void* user_data, str_t* out_response);
+
 // ============================================================================
 // Tree Navigation (Pi-style Conversation Tree)
 // ============================================================================
@@ -239,6 +350,13 @@ err_t agent_create_branch(agent_t* agent, agent_message_t* from_message, agent_m
 err_t agent_run(agent_t* agent, agent_session_t* session);
 err_t agent_process_message(agent_t* agent, agent_session_t* session,
                            const str_t* user_input, str_t* out_response);
+// Like agent_process_message, but hands reply text to on_text as the
+// provider generates it (with stream_responses set and a streaming
+// provider; otherwise once per completion). Text from tool-call rounds is
+// included, so the streamed text can be longer than out_response.
+err_t agent_process_message_stream(agent_t* agent, agent_session_t* session,
+                                   const str_t* user_input, agent_text_callback_t on_text,
+                                   void* user_data, str_t* out_response);
 err_t agent_process_single_turn(agent_t* agent, agent_session_t* session,
                                 const str_t* user_input, agent_message_t** out_message);
 
@@ -246,9 +364,19 @@ err_t agent_process_single_turn(agent_t* agent, agent_session_t* session,
 // Tool Execution
 // ============================================================================
 
+// The agent takes ownership of the tool. Tools not initialized yet are
+// initialized here against the agent's memory and workspace.
+err_t agent_register_tool(agent_t* agent, tool_t* tool);
+// One memory instance shared by every tool registered after this call
+// (e.g. from memory_create_from_config); the agent takes ownership
+void agent_set_memory(agent_t* agent, memory_t* memory);
+// Containers for the shell tool of every tool registered after this call
+// (e.g. from docker_pool_create_from_config); the agent takes ownership
+void agent_set_sandbox(agent_t* agent, struct docker_pool_t* sandbox);
 err_t agent_execute_tool(agent_t* agent, const str_t* tool_name,
                         const str_t* args, str_t* out_result);
 bool agent_tool_is_available(agent_t* agent, const str_t* tool_name);
+// Names borrow from the tools; caller frees only the array
 err_t agent_tool_list_available(agent_t* agent, str_t** out_names, uint32_t* out_count);
 
 // ============================================================================
@@ -275,17 +403,47 @@ err_t agent_rebuild_tools_description(agent_t* agent, str_t* out_description);
 agent_message_t* agent_message_create(agent_message_type_t type, const str_t* content);
 void agent_message_free(agent_message_t* message);
 void agent_message_add_child(agent_message_t* parent, agent_message_t* child);
+// Put inserted between parent and child, taking child's place among its siblings
+void agent_message_splice(agent_message_t* parent, agent_message_t* child, agent_message_t* inserted);
+// Iterative, so arbitrarily deep conversations are fine; nodes from a
+// session's store are left for session teardown
 void agent_message_tree_free(agent_message_t* root);
 
+// Message whose node and strings come from the session's store; it needs
+// no agent_message_free and lives as long as the session
+agent_message_t* agent_session_message_create(agent_session_t* session, agent_message_type_t type,
+                                              const str_t* content);
+// Copy s into the session's string arena (for fields of store messages)
+str_t agent_session_strdup(agent_session_t* session, str_t s);
+// Zeroed node from the session's store, with node_id set
+agent_message_t* agent_session_node_alloc(agent_session_t* session);
+// Store message by id; NULL if the id is not in use
+agent_message_t* agent_session_node(const agent_session_t* session, uint32_t node_id);
+
 // Get conversation path from root to current message
 err_t agent_message_get_path(agent_message_t* from_root, agent_message_t* to_message,
                              agent_message_t*** out_path, uint32_t* out_count);
 
-// Convert conversation to chat messages for LLM
+// Convert conversation to chat messages for LLM. The array is owned by the
+// session and borrows message content; it stays valid until the next call.
 err_t agent_session_to_chat_messages(agent_session_t* session,
                                      chat_message_t** out_messages,
                                      uint32_t* out_count);
 
+// The system prompt, the latest summary on the path and the newest messages
+// that fit max_tokens (0 = no limit) and max_messages (0 = no limit). The
+// newest message is always kept, a tool result is never separated from its
+// call, and nothing before the summary is sent. The start only moves when
+// the window overflows, and then refills to AGENT_WINDOW_REFILL_PERCENT, so
+// consecutive requests share a prefix; stable points carry cache_breakpoint.
+// Same lifetime rules as above.
+err_t agent_session_window(agent_session_t* session, token_family_t family,
+                           uint32_t max_tokens, uint32_t max_messages,
+                           chat_message_t** out_messages, uint32_t* out_count);
+
+// Estimated prompt cost of one message, cached on the message once complete
+uint32_t agent_message_tokens(agent_message_t* message, token_family_t family);
+
 // ============================================================================
 // Configuration
 // ============================================================================
@@ -304,6 +462,18 @@ err_t agent_summarize_conversation(agent_t* agent, agent_session_t* session,
 err_t agent_prune_context(agent_t* agent, agent_session_t* session,
                           uint32_t target_messages);
 
+// Route summaries through provider/model, e.g. one picked by the router
+void agent_set_summarizer(agent_t* agent, provider_t* provider, const str_t* model);
+
+// Once the path since the last summary passes AGENT_SUMMARY_TRIGGER_PERCENT
+// of the context window, summarize all but the newest messages on a
+// background thread. No-op while a summary is already in flight.
+err_t agent_summary_schedule(agent_t* agent, agent_session_t* session);
+
+// Splice a finished summary into the tree as an AGENT_MSG_SUMMARY node;
+// returns true if one was added. Without wait, an unfinished job is left running.
+bool agent_summary_collect(agent_t* agent, agent_session_t* session, bool wait);
+
 // ============================================================================
 // Built-in Agent Implementation
 // ============================================================================
@@ -317,7 +487,16 @@ const agent_vtable_t* agent_get_default_vtable(void);
 #define AGENT_MAX_ITERATIONS_DEFAULT 32
 #define AGENT_MAX_CONTEXT_MESSAGES_DEFAULT 50
 #define AGENT_CONTEXT_WINDOW_TOKENS_DEFAULT 8000
+#define AGENT_TURN_ARENA_SIZE (64 * 1024)
+#define AGENT_MAX_PARALLEL_TOOLS_DEFAULT 4
+#define AGENT_TOOL_TIMEOUT_MS_DEFAULT 60000
+#define AGENT_RECALL_TOKEN_BUDGET_DEFAULT 512
+#define AGENT_WINDOW_REFILL_PERCENT 75
+#define AGENT_SUMMARY_TRIGGER_PERCENT 75
+#define AGENT_SUMMARY_KEEP_RECENT 8
+#define AGENT_SESSION_MAP_BUCKETS 64
 #define AGENT_EXTENSION_DIR_DEFAULT ".cclaw/extensions"
+#define AGENT_SESSIONS_DIR_DEFAULT ".cclaw/sessions"
 
 // Minimal system prompt (Pi philosophy: shortest possible)
 #define AGENT_SYSTEM_PROMPT_MINIMAL \
@@ -337,4 +516,10 @@ const agent_vtable_t* agent_get_default_vtable(void);
     "- You can reload extensions to apply changes\n" \
     "- The system will hot-reload extensions automatically"
 
+// Instructions for folding old turns into a summary
+#define AGENT_SUMMARY_PROMPT \
+    "Summarize the conversation below for your own later reference. " \
+    "Keep decisions, facts, open tasks, file names and tool outcomes; " \
+    "drop pleasantries. Write terse notes, not prose."
+
 #endif // CCLAW_CORE_AGENT_H
@@ -28,9 +28,25 @@ typedef enum {
     ALLOCATOR_ARENA,       // Arena/region allocator
     ALLOCATOR_POOL,        // Fixed-size pool allocator
     ALLOCATOR_TRACKING,    // Tracking allocator for debugging
-    ALLOCATOR_SCRATCH      // Scratch/temporary allocator
+    ALLOCATOR_SCRATCH,     // Scratch/temporary allocator
+    ALLOCATOR_SIZECLASS    // Shared size-class allocator
 } allocator_type_t;
 
+// Subsystems whose live memory is accounted (tracking_report(NULL) and the
+// metrics endpoint). Counters are striped per thread like the metrics
+// counters, so accounting is one relaxed add; frees may land on another
+// stripe, and only the sum over stripes is meaningful.
+typedef enum {
+    ALLOC_TAG_NONE,        // Not accounted
+    ALLOC_TAG_PROVIDER,    // Stream parsers, request scratch
+    ALLOC_TAG_JSON,        // Writer buffers still being built
+    ALLOC_TAG_MEMORY,      // Recall cache
+    ALLOC_TAG_CHANNEL,     // Inbound queue, outgoing streams
+    ALLOC_TAG_AGENT,       // Session trees and turn arenas
+    ALLOC_TAG_TUI,         // Screen buffers and scrollback
+    ALLOC_TAG_COUNT
+} alloc_tag_t;
+
 // Arena allocator (region allocator)
 typedef struct arena_allocator_t {
     allocator_t base;
@@ -38,6 +54,9 @@ typedef struct arena_allocator_t {
     size_t region_size;
     size_t used;
     bool owns_region;
+    void* chunks;          // Overflow chunks, newest first (freed on reset)
+    size_t chunk_bytes;    // Total bytes in overflow chunks
+    alloc_tag_t tag;       // Owned region and chunks are accounted here
 } arena_allocator_t;
 
 // Pool allocator (fixed-size blocks)
@@ -50,6 +69,15 @@ typedef struct pool_allocator_t {
     uint32_t chunk_count;
 } pool_allocator_t;
 
+// Size-class allocator: power-of-two classes from 16 B to 4 KB behind
+// per-thread magazines and a lock-free global depot. One process-wide
+// instance; larger requests fall through to malloc and over-aligned ones
+// to aligned_alloc. Frees must pass the size the block was allocated with.
+#define SIZECLASS_MIN_SHIFT 4
+#define SIZECLASS_MAX_SHIFT 12
+#define SIZECLASS_COUNT (SIZECLASS_MAX_SHIFT - SIZECLASS_MIN_SHIFT + 1)
+#define SIZECLASS_MAX_SIZE ((size_t)1 << SIZECLASS_MAX_SHIFT)
+
 // Tracking allocator (debugging)
 typedef struct tracking_allocator_t {
     allocator_t base;
@@ -59,6 +87,7 @@ typedef struct tracking_allocator_t {
     size_t peak_allocated;
     uint32_t allocation_count;
     uint32_t leak_count;
+    alloc_tag_t tag;       // Set for allocator_tagged(); counts go to the tag instead
 } tracking_allocator_t;
 
 // Scratch allocator (temporary memory)
@@ -83,16 +112,49 @@ arena_allocator_t* arena_create(size_t size);
 arena_allocator_t* arena_create_from_buffer(void* buffer, size_t size);
 void arena_destroy(arena_allocator_t* arena);
 void arena_reset(arena_allocator_t* arena);
+size_t arena_used(const arena_allocator_t* arena);
+void arena_set_tag(arena_allocator_t* arena, alloc_tag_t tag);
 
 // Pool allocator
 pool_allocator_t* pool_create(size_t block_size, size_t blocks_per_chunk);
 void pool_destroy(pool_allocator_t* pool);
 
+// Size-class allocator
+allocator_t* allocator_sizeclass(void);
+void* sizeclass_calloc(size_t size);
+void sizeclass_free(void* ptr, size_t size);
+uint32_t sizeclass_magazines_used(void);
+
 // Tracking allocator
 tracking_allocator_t* tracking_create(allocator_t* backing);
 void tracking_destroy(tracking_allocator_t* tracker);
+// NULL reports every subsystem tag
 void tracking_report(tracking_allocator_t* tracker);
 
+// Subsystem accounting. allocator_tagged() is a process-wide tracking
+// allocator over malloc for the tag; code that mallocs directly accounts
+// with alloc_tag_add/sub using the sizes it already knows.
+typedef struct alloc_tag_stats_t {
+    size_t live;
+    size_t peak;           // Checked every ALLOC_TAG_PEAK_INTERVAL accounted allocations and on reads
+    uint64_t allocations;
+    size_t budget;         // Soft cap, 0 = none
+} alloc_tag_stats_t;
+
+#define ALLOC_TAG_PEAK_INTERVAL 64
+
+allocator_t* allocator_tagged(alloc_tag_t tag);
+void alloc_tag_add(alloc_tag_t tag, size_t bytes);
+void alloc_tag_sub(alloc_tag_t tag, size_t bytes);
+size_t alloc_tag_live(alloc_tag_t tag);
+void alloc_tag_stats(alloc_tag_t tag, alloc_tag_stats_t* out_stats);
+const char* alloc_tag_name(alloc_tag_t tag);
+
+// Nothing is refused past a budget; owners check alloc_tag_over_budget
+// and shed what they can (the session map evicts idle sessions)
+void alloc_tag_set_budget(alloc_tag_t tag, size_t bytes);
+bool alloc_tag_over_budget(alloc_tag_t tag);
+
 // Scratch allocator
 scratch_allocator_t* scratch_create(size_t size);
 scratch_allocator_t* scratch_create_from_buffer(void* buffer, size_t size);
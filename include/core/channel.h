@@ -13,6 +13,7 @@
 // Forward declarations
 typedef struct channel_t channel_t;
 typedef struct channel_vtable_t channel_vtable_t;
+typedef struct channel_stream_t channel_stream_t;
 
 // Channel message structure (defined in core/types.h)
 // typedef struct channel_message_t channel_message_t;
@@ -25,6 +26,11 @@ typedef struct channel_config_t {
     str_t webhook_url;  // Webhook URL (for webhook channels)
     uint16_t port;      // Port to listen on (for server channels)
     str_t host;         // Host to bind to (for server channels)
+    uint32_t listener_threads; // Event loops sharing the port via SO_REUSEPORT (0 = 1)
+    uint32_t initial_backoff_secs; // Reconnect backoff (reliability.channel_*_backoff_secs)
+    uint32_t max_backoff_secs;
+    uint32_t rate_limit_per_minute; // Requests per sender address (gateway.webhook_rate_limit_per_minute, 0 = off)
+    uint64_t idempotency_ttl_secs;  // Window for answering retries from cache (gateway.idempotency_ttl_secs, 0 = off)
     bool auto_start;    // Auto-start listening on initialization
 } channel_config_t;
 
@@ -58,13 +64,24 @@ struct channel_vtable_t {
     err_t (*health_check)(channel_t* channel, bool* out_healthy);
     err_t (*get_stats)(channel_t* channel, uint32_t* messages_sent,
                        uint32_t* messages_received, uint32_t* active_connections);
+
+    // Incremental replies (optional). begin may decline with
+    // ERR_NOT_IMPLEMENTED; the reply is then buffered and sent in one piece.
+    // end releases stream->impl.
+    err_t (*stream_begin)(channel_t* channel, channel_stream_t* stream);
+    err_t (*stream_append)(channel_t* channel, channel_stream_t* stream, const str_t* delta);
+    err_t (*stream_end)(channel_t* channel, channel_stream_t* stream);
 };
 
+// Inbound queue between listener threads and agent workers (inbox.c)
+typedef struct channel_inbox_t channel_inbox_t;
+
 // Channel instance structure
 struct channel_t {
     const channel_vtable_t* vtable;
     channel_config_t config;
     void* impl_data;      // Channel-specific data
+    channel_inbox_t* inbox; // Set by the manager while its workers run
     bool initialized;
     bool listening;
 };
@@ -96,6 +113,79 @@ channel_message_t* channel_message_create(const str_t* id, const str_t* sender,
 void channel_message_free(channel_message_t* message);
 void channel_message_array_free(channel_message_t* messages, uint32_t count);
 
+// Inbound queue. Messages are copied into one bounded lock-free ring per
+// worker, chosen by channel and sender so each sender stays ordered.
+#define CHANNEL_INBOX_DEFAULT_CAPACITY 1024
+
+err_t channel_inbox_create(uint32_t workers, uint32_t capacity,
+                           void (*on_message)(channel_message_t* msg, void* user_data),
+                           void* user_data, channel_inbox_t** out_inbox);
+void channel_inbox_destroy(channel_inbox_t* inbox);
+err_t channel_inbox_push(channel_inbox_t* inbox, const channel_message_t* msg);
+void channel_inbox_get_stats(channel_inbox_t* inbox, uint64_t* accepted, uint64_t* rejected);
+
+// Outbound queue (outbox.c). Each channel gets its own sender thread, so
+// a slow channel never holds up the others. A message waits up to the
+// window for company: one that follows a still-queued message to the
+// same recipient is joined onto it with a newline, while the result stays
+// under CHANNEL_OUTBOX_MERGE_MAX_BYTES.
+#define CHANNEL_OUTBOX_DEFAULT_CAPACITY 256
+#define CHANNEL_OUTBOX_DEFAULT_WINDOW_MS 25
+#define CHANNEL_OUTBOX_MERGE_MAX_BYTES 1024
+
+typedef struct channel_outbox_t channel_outbox_t;
+
+typedef struct channel_delivery_stats_t {
+    uint64_t accepted;         // Messages queued
+    uint64_t rejected;         // Refused because the outbox was full
+    uint64_t delivered;        // Messages in sends that succeeded
+    uint64_t failed;           // Messages in sends that failed
+    uint64_t sends;            // Calls to the channel's send; fewer than messages once merged
+    uint32_t pending;          // Accepted and not attempted yet
+} channel_delivery_stats_t;
+
+// capacity counts queued sends (0 = default); window_ms 0 sends at once
+err_t channel_outbox_create(channel_t* channel, uint32_t capacity, uint32_t window_ms,
+                            channel_outbox_t** out_outbox);
+// Attempts everything still queued, then stops the sender thread
+void channel_outbox_destroy(channel_outbox_t* outbox);
+// ERR_CHANNEL_RATE_LIMIT when full; the outcome of the send shows in the stats
+err_t channel_outbox_push(channel_outbox_t* outbox, const str_t* recipient, const str_t* message);
+// Sends without waiting out the window; ERR_TIMEOUT if messages remain
+err_t channel_outbox_flush(channel_outbox_t* outbox, uint32_t timeout_ms);
+void channel_outbox_get_stats(channel_outbox_t* outbox, channel_delivery_stats_t* out_stats);
+
+// Conversation key hash; worker i of an inbox with N workers serves the
+// keys with hash % N == i
+uint32_t channel_route_hash(const str_t* channel, const str_t* sender);
+
+// Listener threads hand every inbound message here. With an inbox attached
+// the message is queued (ERR_CHANNEL_RATE_LIMIT when full, and the channel
+// should push back on its sender); otherwise on_message runs inline.
+err_t channel_deliver(channel_t* channel, channel_message_t* msg,
+                      void (*on_message)(channel_message_t* msg, void* user_data),
+                      void* user_data);
+
+// Streaming replies: begin, append deltas as they are generated, end.
+// Channels without stream support get the whole text through send at end.
+struct channel_stream_t {
+    channel_t* channel;
+    str_t recipient;
+    char* text;                // Everything appended so far, NUL-terminated
+    uint32_t len;
+    uint32_t cap;
+    void* impl;                // Channel state between begin and end
+    bool native;               // The channel's stream_* functions took it
+};
+
+err_t channel_stream_begin(channel_t* channel, const str_t* recipient, channel_stream_t** out_stream);
+err_t channel_stream_append(channel_stream_t* stream, const str_t* delta);
+// Delivers what is left and frees the stream
+err_t channel_stream_end(channel_stream_t* stream);
+
+// agent_text_callback_t compatible: appends to the channel_stream_t in user_data
+void channel_stream_on_text(const str_t* delta, void* stream);
+
 // Utility functions
 str_t channel_generate_message_id(void);
 uint64_t channel_get_current_timestamp(void);
@@ -108,12 +198,31 @@ channel_manager_t* channel_manager_create(void);
 void channel_manager_destroy(channel_manager_t* manager);
 err_t channel_manager_add_channel(channel_manager_t* manager, channel_t* channel);
 err_t channel_manager_remove_channel(channel_manager_t* manager, const str_t* channel_name);
+// Sends are queued on each channel's outbox and these return once they are
+// queued; delivery failures are counted in the delivery stats. NULL
+// recipient = the channel's default.
 err_t channel_manager_send_to_all(channel_manager_t* manager, const str_t* message);
 err_t channel_manager_send_to_channel(channel_manager_t* manager, const str_t* channel_name,
                                       const str_t* message);
+err_t channel_manager_send(channel_manager_t* manager, const str_t* channel_name,
+                           const str_t* recipient, const str_t* message);
+// Waits until every queued send was attempted
+err_t channel_manager_flush(channel_manager_t* manager, uint32_t timeout_ms);
+err_t channel_manager_get_delivery_stats(channel_manager_t* manager, const str_t* channel_name,
+                                         channel_delivery_stats_t* out_stats);
 err_t channel_manager_start_all(channel_manager_t* manager,
                                void (*on_message)(channel_message_t* msg, void* user_data),
                                void* user_data);
 err_t channel_manager_stop_all(channel_manager_t* manager);
 
+// Run on_message on `workers` threads behind a queue of `queue_capacity`
+// messages instead of on the listener threads. Takes effect on the next
+// start_all; 0 workers restores inline delivery.
+err_t channel_manager_set_workers(channel_manager_t* manager, uint32_t workers, uint32_t queue_capacity);
+void channel_manager_get_queue_stats(channel_manager_t* manager, uint64_t* accepted, uint64_t* rejected);
+
+// Outbox size and merge window for the channels' outboxes, which are
+// created on a channel's first send; ones already created keep theirs
+err_t channel_manager_set_outbox(channel_manager_t* manager, uint32_t capacity, uint32_t window_ms);
+
 #endif // CCLAW_CORE_CHANNEL_H
\ No newline at end of file
@@ -7,7 +7,11 @@
 #include "types.h"
 #include "error.h"
 
-// Configuration structure (inspired by Rust original)
+// Configuration structure (inspired by Rust original). Bump
+// CONFIG_SNAPSHOT_VERSION when a field changes type or moves; snapshots
+// written by the old layout are then rebuilt from the JSON.
+#define CONFIG_SNAPSHOT_VERSION 2
+
 typedef struct config_t {
     // Paths (computed, not serialized)
     str_t workspace_dir;
@@ -18,6 +22,7 @@ typedef struct config_t {
     str_t default_provider;
     str_t default_model;
     double default_temperature;
+    bool compress_requests;        // gzip large provider request bodies
 
     // Memory configuration
     struct {
@@ -34,6 +39,10 @@ typedef struct config_t {
         double keyword_weight;
         uint32_t embedding_cache_size;
         uint32_t chunk_max_tokens;
+        uint32_t recall_cache_size;    // Entries in the read-through recall cache (0 = off)
+        bool compression;              // Compress stored content (sqlite)
+        uint32_t shards;               // Backend instances entries are spread over (0/1 = one)
+        str_t shard_by;                // "key" or "category"
     } memory;
 
     // Gateway configuration
@@ -47,6 +56,7 @@ typedef struct config_t {
         uint32_t pair_rate_limit_per_minute;
         uint32_t webhook_rate_limit_per_minute;
         uint64_t idempotency_ttl_secs;
+        uint32_t listener_threads;
     } gateway;
 
     // Autonomy configuration
@@ -75,6 +85,8 @@ typedef struct config_t {
             bool mount_workspace;
             str_t* allowed_workspace_roots;
             uint32_t allowed_workspace_roots_count;
+            uint32_t pool_size;        // Warm containers for the shell tool
+            uint32_t max_uses;         // Commands per container before it is replaced
         } docker;
     } runtime;
 
@@ -88,6 +100,7 @@ typedef struct config_t {
         uint64_t channel_max_backoff_secs;
         uint64_t scheduler_poll_secs;
         uint32_t scheduler_retries;
+        bool prewarm_providers;    // Connect to every provider host at startup
     } reliability;
 
     // Model routing configuration
@@ -99,6 +112,15 @@ typedef struct config_t {
     }* model_routes;
     uint32_t model_routes_count;
 
+    // Response cache for deterministic requests (providers/response_cache.h)
+    struct {
+        bool enabled;
+        uint32_t max_entries;      // In-memory LRU tier
+        uint64_t ttl_secs;
+        bool persist;              // SQLite tier next to the memory database
+        double max_temperature;    // Requests above this are never cached
+    } response_cache;
+
     // Heartbeat configuration
     struct {
         bool enabled;
@@ -108,6 +130,8 @@ typedef struct config_t {
     // Channel configurations
     struct {
         bool cli;
+        uint32_t agent_workers;          // Threads draining the inbound queue (0 = inline)
+        uint32_t inbound_queue_capacity;
         struct {
             str_t bot_token;
             str_t* allowed_users;
@@ -238,6 +262,17 @@ err_t config_save_default(config_t* config);
 config_t* config_default(allocator_t* alloc);
 err_t config_validate(config_t* config);
 
+// Binary snapshot of a parsed, validated config, kept at
+// "<config path>.snap" and keyed by the JSON file's mtime, size and a
+// hash of its contents. config_load tries it before parsing and rewrites
+// it after a successful parse; CCLAW_CONFIG_SNAPSHOT=0 turns both off.
+// Strings are stored as offsets into the file, so a snapshot does not
+// depend on where it is mapped. Configs with channel, tunnel or route
+// sections are not snapshotted, since nothing loads those from JSON yet.
+err_t config_snapshot_save(const config_t* config, const char* source_path);
+// ERR_NOT_FOUND when there is no snapshot or it no longer matches the file
+err_t config_snapshot_load(const char* source_path, allocator_t* alloc, config_t** out_config);
+
 // Environment variable overrides
 void config_apply_env_overrides(config_t* config);
 
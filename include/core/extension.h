@@ -7,6 +7,7 @@
 #include "core/types.h"
 #include "core/error.h"
 #include "core/agent.h"
+#include "core/tool.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -15,6 +16,7 @@
 typedef struct extension_t extension_t;
 typedef struct extension_api_t extension_api_t;
 typedef struct extension_manifest_t extension_manifest_t;
+typedef struct extension_native_t extension_native_t;
 
 // Extension types (Pi-style: code as extension)
 typedef enum {
@@ -26,6 +28,14 @@ typedef enum {
     EXTENSION_TYPE_THEME,      // UI theme/styling
 } extension_type_t;
 
+// A tool a native extension declares in its manifest, so it can be
+// listed before the library is opened
+typedef struct extension_tool_decl_t {
+    str_t name;
+    str_t description;
+    str_t parameters;          // JSON schema
+} extension_tool_decl_t;
+
 // Extension manifest (metadata)
 struct extension_manifest_t {
     str_t name;                // Extension identifier
@@ -49,6 +59,10 @@ struct extension_manifest_t {
     // Source info
     str_t source_file;         // Main source file
     str_t entry_point;         // Entry function name (for C extensions)
+
+    // Tools (native extensions)
+    extension_tool_decl_t* tools;
+    uint32_t tool_count;
 };
 
 // Extension API (what extensions can use)
@@ -98,6 +112,7 @@ struct extension_t {
 
     // Shared object handle (for compiled extensions)
     void* dl_handle;
+    extension_native_t* native;   // Set for .so/.dylib extensions
 
     // Source code (for interpreted extensions)
     str_t source_code;
@@ -130,13 +145,50 @@ typedef void (*extension_cleanup_fn_t)(void* user_data);
 err_t extension_initialize(extension_t* extension);
 void extension_cleanup(extension_t* extension);
 
+// ============================================================================
+// Native Extensions
+// ============================================================================
+
+// A .so/.dylib extension exports EXTENSION_NATIVE_ENTRY returning its tool
+// table. Tools are registered with tool_register when the extension is
+// loaded, but the library is only opened (RTLD_LAZY) the first time one of
+// them runs. If <library stem>.json declares the tools, listing them never
+// opens the library; without it the library is opened at load time to
+// find its tools. A reload opens the new build beside the old one and
+// switches tools over on their next call, so calls in flight finish on
+// the code they started with. A library links against nothing from the
+// host: its create calloc's the tool_t and the host fills in the vtable.
+// Tools created from an extension must be freed before it is unloaded.
+#define EXTENSION_ABI_VERSION 1
+#define EXTENSION_NATIVE_ENTRY "cclaw_extension_v1"
+// Native tools across all loaded extensions
+#define EXTENSION_NATIVE_MAX_TOOLS 16
+
+typedef struct extension_native_table_t {
+    uint32_t abi_version;              // EXTENSION_ABI_VERSION
+    uint32_t tool_count;
+    const tool_vtable_t* const* tools;
+} extension_native_table_t;
+
+typedef const extension_native_table_t* (*extension_native_entry_fn_t)(void);
+
+bool extension_is_native_path(const str_t* path);
+
 // ============================================================================
 // Hot Reload
 // ============================================================================
 
+// Changes arrive as events where the platform has them (inotify on Linux,
+// kqueue on macOS) and are found by polling mtimes elsewhere. Sources are
+// rescanned once the directory has been quiet for the debounce window, so
+// an editor's write, rename and chmod make one reload.
 err_t extension_watch_start(const str_t* extensions_dir);
 void extension_watch_stop(void);
-err_t extension_watch_poll(void);  // Check for changes and reload
+// Readable when the directory changes; -1 while polling or not watching
+int extension_watch_fd(void);
+// Longest wait before the next poll is due, -1 = until the fd is readable
+int extension_watch_timeout_ms(void);
+err_t extension_watch_poll(void);  // Take pending changes and reload
 
 // ============================================================================
 // Manifest Operations
@@ -196,6 +248,8 @@ err_t extension_validate(const extension_t* extension,
 #define EXTENSION_MANIFEST_FILE "manifest.json"
 #define EXTENSION_MAX_NAME_LEN 64
 #define EXTENSION_MAX_DEPENDENCIES 16
+#define EXTENSION_WATCH_DEBOUNCE_MS 25
+#define EXTENSION_WATCH_POLL_MS 1000
 
 // Template for tool extension (C code)
 #define EXTENSION_TOOL_TEMPLATE \
@@ -15,13 +15,31 @@
 typedef struct memory_t memory_t;
 typedef struct memory_vtable_t memory_vtable_t;
 
+// Embedding callback: writes count * dimensions floats (row-major) to out
+typedef err_t (*memory_embed_fn_t)(void* ctx, const str_t* texts, uint32_t count,
+                                   uint32_t dimensions, float* out);
+
 // Memory configuration
 typedef struct memory_config_t {
     str_t backend;          // "sqlite", "markdown", "null"
     str_t data_dir;         // Directory for memory storage
     uint32_t max_entries;   // Maximum number of entries to store
-    bool compression;       // Enable compression
+    bool compression;       // Compress stored content (sqlite: zlib, per-category dictionary)
     uint32_t retention_days; // Days to keep entries
+    uint32_t write_behind_batch;       // Queue stores, commit in groups of this size (0 = synchronous)
+    uint32_t write_behind_interval_ms; // Longest a queued store waits for its commit
+
+    // Hybrid search; vectors are kept only when embed is set
+    memory_embed_fn_t embed;
+    void* embed_ctx;
+    uint32_t embedding_dimensions;
+    double vector_weight;
+    double keyword_weight;
+    uint32_t embedding_cache_size;     // Cached text embeddings (0 = no cache)
+    uint32_t chunk_max_tokens;         // Content is embedded in chunks of about this size
+    uint32_t recall_cache_size;        // memory_create_from_config wraps the backend in a cache this big (0 = none)
+    uint32_t shards;                   // memory_create_from_config spreads entries over this many instances (0/1 = one)
+    bool shard_by_category;            // Route by category instead of key
 } memory_config_t;
 
 // Memory search options
@@ -32,8 +50,27 @@ typedef struct memory_search_opts_t {
     uint64_t max_timestamp; // Maximum timestamp
     double min_score;       // Minimum relevance score
     bool include_metadata;  // Include metadata in results
+    bool snippets;          // Return a highlighted excerpt instead of full content
 } memory_search_opts_t;
 
+// Retention sweep. Cutoffs are unix seconds compared against creation
+// time; 0 skips that step. Core and custom entries are never swept.
+typedef struct memory_sweep_opts_t {
+    uint64_t archive_before;      // Move daily entries out of recall and search
+    uint64_t purge_before;        // Drop archived entries
+    uint64_t conversation_before; // Delete conversation entries
+    uint32_t batch_size;          // Rows per transaction (0 = MEMORY_SWEEP_BATCH_DEFAULT)
+    uint32_t max_batches;         // Transactions per call (0 = until done)
+} memory_sweep_opts_t;
+
+typedef struct memory_sweep_result_t {
+    uint32_t archived;
+    uint32_t purged;
+    uint32_t expired;
+    uint32_t batches;
+    bool complete;                // False when max_batches stopped the sweep early
+} memory_sweep_result_t;
+
 // Memory VTable - defines the interface
 struct memory_vtable_t {
     // Memory backend identification
@@ -52,6 +89,9 @@ struct memory_vtable_t {
     err_t (*store)(memory_t* memory, const memory_entry_t* entry);
     err_t (*store_multiple)(memory_t* memory, const memory_entry_t* entries, uint32_t count);
 
+    // Durability fence: returns once every accepted store is committed
+    err_t (*flush)(memory_t* memory);
+
     // Retrieval
     err_t (*recall)(memory_t* memory, const str_t* key, memory_entry_t* out_entry);
     err_t (*recall_by_id)(memory_t* memory, const str_t* id, memory_entry_t* out_entry);
@@ -64,11 +104,14 @@ struct memory_vtable_t {
     err_t (*forget)(memory_t* memory, const str_t* key);
     err_t (*forget_by_id)(memory_t* memory, const str_t* id);
     err_t (*forget_old)(memory_t* memory, uint64_t cutoff_timestamp);
+    // Incremental retention, in short transactions so writers interleave
+    err_t (*sweep)(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result);
 
     // Statistics
     err_t (*get_stats)(memory_t* memory, uint32_t* total_entries, uint32_t* by_category_counts);
 
-    // Backup and restore
+    // Backup and restore; both run while the memory stays in use. sqlite
+    // updates an existing backup at backup_path incrementally.
     err_t (*backup)(memory_t* memory, const str_t* backup_path);
     err_t (*restore)(memory_t* memory, const str_t* backup_path);
 };
@@ -113,16 +156,42 @@ str_t memory_get_current_timestamp(void);
 memory_category_t memory_parse_category(const str_t* category_str);
 str_t memory_category_to_string(memory_category_t category);
 
+// Store helpers (fall back to per-entry store / no-op flush)
+err_t memory_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count);
+err_t memory_flush(memory_t* memory);
+
+// Retention helpers; memory_sweep is ERR_NOT_IMPLEMENTED for backends
+// without a sweep
+err_t memory_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result);
+struct config_t;
+// Cutoffs from memory.archive_after_days, purge_after_days and
+// conversation_retention_days before now (0 days = step skipped)
+memory_sweep_opts_t memory_sweep_opts_from_config(const struct config_t* config, uint64_t now);
+
 // Search helpers
 memory_search_opts_t memory_search_opts_default(void);
+// vtable search plus a latency sample per backend
+err_t memory_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                    memory_entry_t** out_entries, uint32_t* out_count);
 err_t memory_search_simple(memory_t* memory, const str_t* query, uint32_t limit,
                            memory_entry_t** out_entries, uint32_t* out_count);
 
 // Default configuration
 memory_config_t memory_config_default(void);
 
+// Copy the memory section of the application config (embedder is left unset)
+void memory_config_apply_settings(memory_config_t* memory_config, const struct config_t* config);
+// The configured backend ("none" = null), storing under the workspace,
+// initialized and behind a read-through cache (memory/cache.h) when
+// memory.recall_cache_size is set
+err_t memory_create_from_config(const struct config_t* config, memory_t** out_memory);
+
 // Default retention period (30 days)
 #define MEMORY_RETENTION_DAYS_DEFAULT 30
 #define MEMORY_MAX_ENTRIES_DEFAULT 10000
+#define MEMORY_WRITE_BEHIND_INTERVAL_DEFAULT_MS 250
+#define MEMORY_EMBEDDING_DIMENSIONS_DEFAULT 1536
+#define MEMORY_CHUNK_MAX_TOKENS_DEFAULT 512
+#define MEMORY_SWEEP_BATCH_DEFAULT 500
 
 #endif // CCLAW_CORE_MEMORY_H
\ No newline at end of file
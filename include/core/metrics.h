@@ -0,0 +1,71 @@
+// metrics.h - Process-wide metrics registry for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_CORE_METRICS_H
+#define CCLAW_CORE_METRICS_H
+
+#include "types.h"
+#include "error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+} metric_kind_t;
+
+// A metric family. Descriptors are static; a series is one family plus
+// up to two label values.
+typedef struct metric_desc_t {
+    const char* name;          // Prometheus name, e.g. "cclaw_tool_duration_seconds"
+    const char* help;
+    metric_kind_t kind;
+    const char* labels[2];     // Label names, NULL when unused
+    double scale;              // Exported value = recorded value * scale (0 = 1)
+    const double* bounds;      // Histogram "le" bounds in exported units, ascending
+    uint32_t bound_count;
+} metric_desc_t;
+
+typedef struct metric_t metric_t;
+
+// Families recorded by CClaw itself. Durations are recorded in
+// microseconds and exported in seconds.
+extern const metric_desc_t METRIC_PROVIDER_LATENCY;      // provider, model
+extern const metric_desc_t METRIC_PROVIDER_TTFT;         // provider, model
+extern const metric_desc_t METRIC_PROVIDER_TOKEN_RATE;   // provider, model; milli-tokens/s
+extern const metric_desc_t METRIC_PROVIDER_ERRORS;       // provider, model
+extern const metric_desc_t METRIC_PROVIDER_HEDGES;       // provider, result ("sent", "won")
+extern const metric_desc_t METRIC_RESPONSE_CACHE;        // provider, result ("memory", "disk", "miss")
+extern const metric_desc_t METRIC_TOOL_DURATION;         // tool
+extern const metric_desc_t METRIC_TOOL_SPECULATION;      // tool, result ("hit", "wasted")
+extern const metric_desc_t METRIC_MEMORY_SEARCH;         // backend
+extern const metric_desc_t METRIC_CHANNEL_QUEUE_DEPTH;
+
+// Find or register a series. Lookups are lock-free; registering a new
+// series takes a lock once. NULL when the registry is full, which every
+// recording function accepts.
+metric_t* metric_get(const metric_desc_t* desc, str_t label1, str_t label2);
+
+// Counters are striped per thread; gauges and histograms use relaxed
+// atomics, so recording never blocks
+void metric_inc(metric_t* metric, uint64_t delta);
+void metric_gauge_add(metric_t* metric, int64_t delta);
+void metric_gauge_set(metric_t* metric, int64_t value);
+void metric_observe(metric_t* metric, uint64_t value);
+
+// Current value of a counter or gauge
+int64_t metric_value(metric_t* metric);
+// Histogram count and quantile (q in [0, 1]) in recorded units, within
+// the ~3% bucket resolution
+uint64_t metric_count(metric_t* metric);
+uint64_t metric_quantile(metric_t* metric, double q);
+
+// Monotonic clock for duration metrics
+uint64_t metrics_now_us(void);
+
+// Prometheus text exposition format (0.0.4); caller frees out_text
+err_t metrics_export_prometheus(str_t* out_text);
+
+#endif // CCLAW_CORE_METRICS_H
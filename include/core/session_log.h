@@ -0,0 +1,55 @@
+// session_log.h - Append-only binary session log for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_CORE_SESSION_LOG_H
+#define CCLAW_CORE_SESSION_LOG_H
+
+#include "types.h"
+#include "error.h"
+#include "core/agent.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// One file per session (<dir>/<session id>.log) holding fixed-layout
+// records: a meta record (id, name, creation time), one record per message
+// (index, parent index, type, timestamp, token counts, then the strings),
+// cursor moves and checkpoints. Messages are appended as they join the
+// tree; a checkpoint every SESSION_LOG_CHECKPOINT_EVERY messages (and on
+// save or close) is followed by fdatasync. Loading maps the file and
+// builds the tree with strings left as views into the mapping, so no
+// content is copied or reparsed. A torn tail (bad CRC or short record) is
+// cut off on load. Records use host byte order.
+
+#define SESSION_LOG_MAGIC "CCLAWSL"
+#define SESSION_LOG_VERSION 1
+#define SESSION_LOG_SUFFIX ".log"
+#define SESSION_LOG_CHECKPOINT_EVERY 256
+
+typedef struct session_log_t session_log_t;
+
+// The log keeps a pointer to its session, which owns it (session->log).
+// Start the log of a new session; fails with ERR_FILE_EXISTS if it has one
+err_t session_log_create(const char* dir, agent_session_t* session, session_log_t** out_log);
+// Map <dir>/<session_id>.log and rebuild an empty session from it;
+// ERR_FILE_NOT_FOUND if there is no such log
+err_t session_log_load(const char* dir, const str_t* session_id, agent_session_t* session,
+                       session_log_t** out_log);
+// Unmaps the file: free the tree (its strings borrow the mapping) first
+void session_log_close(session_log_t* log);
+
+// Record a message that just joined the tree, and any ancestors not logged yet
+err_t session_log_append(session_log_t* log, agent_message_t* message);
+// Record a message inserted between child and child's former parent
+err_t session_log_append_splice(session_log_t* log, agent_message_t* inserted, agent_message_t* child);
+// Record the current position when it is not the newest message
+err_t session_log_set_current(session_log_t* log, const agent_message_t* current);
+// Append a checkpoint (position, session counters) and flush the log to disk
+err_t session_log_checkpoint(session_log_t* log);
+
+uint32_t session_log_message_count(const session_log_t* log);
+
+// Session ids with a log in dir (free each id and the array)
+err_t session_log_list(const char* dir, str_t** out_ids, uint32_t* out_count);
+
+#endif // CCLAW_CORE_SESSION_LOG_H
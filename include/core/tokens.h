@@ -0,0 +1,29 @@
+// tokens.h - Local token count estimation for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_CORE_TOKENS_H
+#define CCLAW_CORE_TOKENS_H
+
+#include "types.h"
+
+#include <stdint.h>
+
+// Tokenizer families with distinct BPE density
+typedef enum {
+    TOKEN_FAMILY_GENERIC,      // Unknown vocabulary (DeepSeek, Kimi, ...)
+    TOKEN_FAMILY_OPENAI,       // cl100k / o200k
+    TOKEN_FAMILY_ANTHROPIC,
+    TOKEN_FAMILY_COUNT
+} token_family_t;
+
+// Role markers and separators the chat template adds around each message
+#define TOKEN_MESSAGE_OVERHEAD 4
+
+token_family_t token_family_for_provider(str_t provider_name);
+
+// Single pass, no allocation. Approximates BPE by pricing word runs by
+// length, digit runs in groups, punctuation per character and whitespace
+// runs as one token; tuned to land within ~10% on English prose and code.
+uint32_t token_estimate(str_t text, token_family_t family);
+
+#endif // CCLAW_CORE_TOKENS_H
@@ -22,11 +22,14 @@ typedef struct tool_result_t {
     str_t error_message;
 } tool_result_t;
 
+struct docker_pool_t;
+
 // Tool execution context
 typedef struct tool_context_t {
     void* user_data;           // User-provided context
     memory_t* memory;          // Memory system for memory tools
     str_t workspace_dir;       // Current workspace directory
+    struct docker_pool_t* sandbox; // Shell commands run in its containers when set
     // Add other context fields as needed
 } tool_context_t;
 
@@ -56,6 +59,10 @@ struct tool_vtable_t {
 
     // Whether this tool is allowed in autonomous mode
     bool (*allowed_in_autonomous)(autonomy_level_t level);
+
+    // Whether this tool only reads (optional). Such a call may be started
+    // while the model is still streaming the rest of its message.
+    bool (*is_pure)(void);
 };
 
 // Tool instance structure
@@ -70,9 +77,13 @@ struct tool_t {
 err_t tool_registry_init(void);
 void tool_registry_shutdown(void);
 err_t tool_register(const char* name, const tool_vtable_t* vtable);
+err_t tool_unregister(const char* name);
 err_t tool_create(const char* name, tool_t** out_tool);
 err_t tool_registry_list(const char*** out_names, uint32_t* out_count);
 
+// Run a tool through its vtable and record the time it took
+err_t tool_execute(tool_t* tool, const str_t* args, tool_result_t* out_result);
+
 // Built-in tools
 const tool_vtable_t* shell_tool_get_vtable(void);
 const tool_vtable_t* file_read_tool_get_vtable(void);
@@ -91,6 +102,74 @@ void tool_result_free(tool_result_t* result);
 void tool_result_set_success(tool_result_t* result, const str_t* content);
 void tool_result_set_error(tool_result_t* result, const str_t* error_message);
 
+// Parallel execution. A job with tool == NULL is skipped and keeps the err
+// and result it was given.
+typedef struct tool_job_t {
+    tool_t* tool;
+    str_t args;
+    tool_result_t result;
+    err_t err;
+} tool_job_t;
+
+typedef struct tool_pool_t tool_pool_t;
+
+err_t tool_pool_create(uint32_t workers, tool_pool_t** out_pool);
+void tool_pool_destroy(tool_pool_t* pool);
+
+// Run jobs concurrently and wait for all of them. A job not finished
+// timeout_ms (0 = no limit) after submission is abandoned and reported as
+// ERR_TIMEOUT; a running one is finished in the background.
+err_t tool_pool_run(tool_pool_t* pool, tool_job_t* jobs, uint32_t count, uint32_t timeout_ms);
+
+// One call started without waiting for it. Each task is passed to exactly
+// one of collect or discard.
+typedef struct tool_task_t tool_task_t;
+
+err_t tool_pool_submit(tool_pool_t* pool, tool_t* tool, str_t args, tool_task_t** out_task);
+// Wait for the call and move its outcome into job; timeout_ms counts from
+// submission, as in tool_pool_run
+void tool_pool_collect(tool_pool_t* pool, tool_task_t* task, uint32_t timeout_ms, tool_job_t* job);
+// Drop the call; a running one finishes in the background
+void tool_pool_discard(tool_pool_t* pool, tool_task_t* task);
+
+// Shell runner. Runs "/bin/sh -c command" in its own process group with
+// stdout and stderr on separate pipes; the whole group is killed when the
+// wall-clock timeout expires.
+#define SHELL_MAX_OUTPUT_DEFAULT (64u * 1024u)
+
+// Called from the running thread as output arrives
+typedef void (*shell_output_fn)(void* user_data, bool is_stderr, const char* data, size_t len);
+
+typedef struct shell_run_options_t {
+    const char* cwd;           // NULL = inherit
+    uint32_t timeout_ms;       // 0 = no limit
+    size_t max_output;         // Per stream; 0 = SHELL_MAX_OUTPUT_DEFAULT
+    shell_output_fn on_output; // Optional
+    void* user_data;
+} shell_run_options_t;
+
+// Output past max_output keeps its first and last halves around an
+// omission marker.
+typedef struct shell_run_result_t {
+    str_t out;
+    str_t err;
+    uint64_t out_total;        // Bytes produced, including omitted ones
+    uint64_t err_total;
+    int exit_code;             // -1 unless the child exited normally
+    int term_signal;           // 0 unless killed by a signal
+    bool timed_out;
+    bool truncated;
+} shell_run_result_t;
+
+err_t shell_run(const char* command, const shell_run_options_t* options, shell_run_result_t* out_result);
+// Same, for a program and its arguments without a shell in between;
+// argv[0] is looked up on PATH
+err_t shell_run_argv(char* const argv[], const shell_run_options_t* options, shell_run_result_t* out_result);
+void shell_run_result_free(shell_run_result_t* result);
+
+// Stream a shell tool's output while its commands run
+void shell_tool_set_output_callback(tool_t* tool, shell_output_fn fn, void* user_data);
+
 // Context helpers
 tool_context_t tool_context_default(void);
 err_t tool_context_set_memory(tool_context_t* context, memory_t* memory);
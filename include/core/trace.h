@@ -0,0 +1,79 @@
+// trace.h - Low-overhead tracing spans for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_CORE_TRACE_H
+#define CCLAW_CORE_TRACE_H
+
+#include "types.h"
+#include "error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Spans are only recorded inside a sampled trace. A trace starts at a root
+// span (an inbound message or an agent turn); spans opened on a thread with
+// no trace cost one branch and are dropped. Finished spans go to a
+// per-thread ring and a background thread exports them.
+
+#define TRACE_RING_SIZE 1024       // Finished spans buffered per thread
+#define TRACE_DETAIL_MAX 32        // Bytes of detail kept per span
+
+typedef struct trace_span_t {
+    const char* name;          // Static string
+    uint64_t start_ns;
+    uint64_t span_id;          // 0 = not recording
+    uint64_t parent_id;
+    trace_context_t saved;     // Thread context to restore at end
+    bool entered;              // The span changed the thread's context
+    char detail[TRACE_DETAIL_MAX];
+} trace_span_t;
+
+typedef struct trace_config_t {
+    uint32_t sample_every;     // Record 1 of N traces (0 = tracing off)
+    const char* chrome_path;   // Chrome trace_event JSON array, appended
+    const char* otlp_endpoint; // OTLP/HTTP JSON, e.g. http://localhost:4318/v1/traces
+    uint32_t flush_interval_ms;
+} trace_config_t;
+
+#define TRACE_FLUSH_INTERVAL_MS 1000
+
+// Configure sampling and sinks and start the exporter. trace_init_from_env
+// reads CCLAW_TRACE_SAMPLE, CCLAW_TRACE_FILE and CCLAW_TRACE_OTLP.
+err_t trace_init(const trace_config_t* config);
+err_t trace_init_from_env(void);
+// Stops the exporter after a final flush
+void trace_shutdown(void);
+// Export everything buffered now
+err_t trace_flush(void);
+
+trace_span_t trace_root_begin(const char* name);    // Child span when a trace is already active
+trace_span_t trace_span_begin(const char* name);
+void trace_span_set_detail(trace_span_t* span, str_t detail);
+void trace_span_end(trace_span_t* span);
+
+// Carry the current trace to another thread
+trace_context_t trace_context_current(void);
+void trace_context_enter(const trace_context_t* context, trace_context_t* out_saved);
+void trace_context_leave(const trace_context_t* saved);
+
+// Defining CCLAW_NO_TRACE compiles every span away
+#ifndef CCLAW_NO_TRACE
+    #define TRACE_CONCAT_(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+    // Span for the rest of the enclosing block
+    #define TRACE_SCOPE(name) \
+        trace_span_t TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_span_end))) = \
+            trace_span_begin(name)
+    #define TRACE_BEGIN(var, name) trace_span_t var = trace_span_begin(name)
+    #define TRACE_ROOT(var, name) trace_span_t var = trace_root_begin(name)
+    #define TRACE_DETAIL(var, text) trace_span_set_detail(&(var), (text))
+    #define TRACE_END(var) trace_span_end(&(var))
+#else
+    #define TRACE_SCOPE(name) ((void)0)
+    #define TRACE_BEGIN(var, name) ((void)0)
+    #define TRACE_ROOT(var, name) ((void)0)
+    #define TRACE_DETAIL(var, text) ((void)0)
+    #define TRACE_END(var) ((void)0)
+#endif
+
+#endif // CCLAW_CORE_TRACE_H
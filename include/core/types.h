@@ -122,6 +122,7 @@ typedef struct chat_message_t {
     str_t content;
     str_t tool_calls;      // JSON array of tool calls (for assistant)
     str_t tool_call_id;    // ID of tool call (for tool messages)
+    bool cache_breakpoint; // Ends a stable prefix the provider may cache
 } chat_message_t;
 
 // Tool call (from Rust original)
@@ -157,6 +158,14 @@ typedef struct conversation_message_t {
     };
 } conversation_message_t;
 
+// Trace a piece of work belongs to, handed across threads (core/trace.h)
+typedef struct trace_context_t {
+    uint64_t trace_hi;
+    uint64_t trace_lo;
+    uint64_t span_id;          // Parent for spans started under it
+    bool sampled;
+} trace_context_t;
+
 // Channel message (from Rust original)
 typedef struct channel_message_t {
     str_t id;
@@ -164,6 +173,7 @@ typedef struct channel_message_t {
     str_t content;
     str_t channel;
     uint64_t timestamp;
+    trace_context_t trace;     // Set by channel_deliver, zero = untraced
 } channel_message_t;
 
 // Tool specification (from Rust original)
@@ -202,6 +212,13 @@ static inline bool str_empty(str_t s) {
 str_t str_dup(str_t s, allocator_t* alloc);
 str_t str_dup_cstr(const char* s, allocator_t* alloc);
 
+// Interning, for identifiers that repeat (model and tool names): one
+// NUL-terminated copy per distinct value, kept for the life of the
+// process. Equal interned strings share data, so str_equal on them is a
+// pointer compare. Never free the result; empty input gives STR_NULL.
+str_t str_intern(str_t s);
+str_t str_intern_cstr(const char* s);
+
 // String formatting (allocates memory)
 str_t str_format(allocator_t* alloc, const char* fmt, ...);
 
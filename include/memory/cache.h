@@ -0,0 +1,39 @@
+// cache.h - Read-through LRU cache in front of a memory backend
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_MEMORY_CACHE_H
+#define CCLAW_MEMORY_CACHE_H
+
+#include "core/memory.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A memory_t whose recall, recall_by_id and search answers are kept in a
+// sharded LRU, so repeated lookups within a turn never reach the wrapped
+// backend. Misses (ERR_NOT_FOUND) are cached as well. A store or forget
+// drops the cached recalls for that key and every cached id lookup and
+// search; forget_by_id, forget_old, sweep and restore drop everything. A
+// lookup racing a write is answered but not cached. Everything else is
+// forwarded.
+
+#define MEMORY_CACHE_SHARDS 8
+#define MEMORY_CACHE_DEFAULT_ENTRIES 1024
+
+typedef struct memory_cache_stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;    // Writes that dropped cached answers
+    uint32_t entries;
+} memory_cache_stats_t;
+
+// Takes ownership of inner (freed with the cache); max_entries 0 =
+// MEMORY_CACHE_DEFAULT_ENTRIES. init on the result also initializes inner
+// unless that was done already.
+err_t memory_cache_wrap(memory_t* inner, uint32_t max_entries, memory_t** out_memory);
+
+bool memory_is_cache(const memory_t* memory);
+// False unless memory came from memory_cache_wrap
+bool memory_cache_get_stats(memory_t* memory, memory_cache_stats_t* out_stats);
+
+#endif // CCLAW_MEMORY_CACHE_H
@@ -0,0 +1,55 @@
+// compress.h - Dictionary compression for stored memory content
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_MEMORY_COMPRESS_H
+#define CCLAW_MEMORY_COMPRESS_H
+
+#include "core/types.h"
+#include "core/error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A compressed value is the plaintext length (4 bytes, little endian)
+// followed by a zlib stream written with a preset dictionary. The stream
+// header carries the dictionary's id (its adler32), so a value decodes with
+// whichever dictionary it was written with; dictionaries are never dropped.
+
+// zlib only looks back this far, so longer dictionaries waste the front
+#define MEMORY_DICT_MAX_BYTES 32768
+// Shorter content is stored as is
+#define MEMORY_COMPRESS_MIN_BYTES 64
+
+typedef struct memory_dict_t {
+    uint32_t id;
+    uint32_t size;
+    uint8_t* data;
+} memory_dict_t;
+
+// Copy data into dict and compute its id
+err_t memory_dict_init(memory_dict_t* dict, const void* data, uint32_t size);
+// Build a dictionary from samples given newest first. Newer samples land
+// at the tail, where matches are cheapest to encode; repeated samples are
+// kept once.
+err_t memory_dict_train(const str_t* samples, uint32_t count, memory_dict_t* out_dict);
+void memory_dict_free(memory_dict_t* dict);
+
+// Reusable deflate state; not thread-safe
+typedef struct memory_compressor_t memory_compressor_t;
+
+err_t memory_compressor_create(memory_compressor_t** out_compressor);
+void memory_compressor_free(memory_compressor_t* compressor);
+
+// ERR_OK with *out_data NULL when compressing would not save space
+err_t memory_compress(memory_compressor_t* compressor, const memory_dict_t* dict,
+                      const char* text, uint32_t len, uint8_t** out_data, uint32_t* out_len);
+
+// Dictionary for an id, NULL if unknown
+typedef const memory_dict_t* (*memory_dict_lookup_fn_t)(void* ctx, uint32_t id);
+
+// Returns a NUL-terminated copy of the plaintext; ERR_MEMORY_CORRUPT for a
+// damaged value or an unknown dictionary
+err_t memory_decompress(const uint8_t* data, uint32_t len, memory_dict_lookup_fn_t lookup, void* lookup_ctx,
+                        char** out_text, uint32_t* out_len);
+
+#endif // CCLAW_MEMORY_COMPRESS_H
@@ -0,0 +1,77 @@
+// markdown_index.h - Inverted term index for the markdown memory backend
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_MEMORY_MARKDOWN_INDEX_H
+#define CCLAW_MEMORY_MARKDOWN_INDEX_H
+
+#include "core/types.h"
+#include "core/error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Longer terms are truncated to this many bytes
+#define MD_INDEX_MAX_TERM 64
+
+// Category directories tracked by the manifest
+#define MD_INDEX_DIRS 4
+
+#define MD_INDEX_NONE UINT32_MAX
+
+// One indexed file. Ids are stable for a path while the index is open, so a
+// forgotten and re-stored file reuses its slot.
+typedef struct md_index_file_t {
+    char* path;                // Relative to the base directory ("daily/key.md")
+    int64_t mtime_ns;
+    int64_t size;
+    uint32_t category;
+    uint32_t* terms;           // Term ids present in the file
+    uint32_t term_count;
+    uint32_t seen;             // Revalidation generation (not persisted)
+    bool live;
+} md_index_file_t;
+
+typedef struct md_index_term_t {
+    char* text;
+    uint32_t* files;           // Posting list (unordered)
+    uint32_t count;
+    uint32_t capacity;
+} md_index_term_t;
+
+typedef struct md_index_t {
+    md_index_file_t* files;
+    uint32_t file_count;
+    uint32_t file_capacity;
+    md_index_term_t* terms;
+    uint32_t term_count;
+    uint32_t term_capacity;
+    uint32_t* term_slots;      // Open addressing: term id + 1, 0 = empty
+    uint32_t* path_slots;      // Open addressing: file id + 1, 0 = empty
+    uint32_t term_slot_count;
+    uint32_t path_slot_count;
+    int64_t dir_mtime_ns[MD_INDEX_DIRS];
+    bool dirty;                // Changed since the last load/save
+} md_index_t;
+
+// Lifecycle
+void md_index_init(md_index_t* index);
+void md_index_free(md_index_t* index);
+
+// Persistence (written to a temp file and renamed into place)
+err_t md_index_load(md_index_t* index, const char* path);
+err_t md_index_save(md_index_t* index, const char* path);
+
+// Files
+uint32_t md_index_find_file(const md_index_t* index, const char* path);
+err_t md_index_update_file(md_index_t* index, const char* path, uint32_t category,
+                           int64_t mtime_ns, int64_t size, const char* text, size_t len);
+void md_index_remove_file(md_index_t* index, const char* path);
+
+// Ids of live files containing every query term; caller frees *out_files
+err_t md_index_query(const md_index_t* index, str_t query, uint32_t** out_files, uint32_t* out_count);
+
+// Next lowercased term of text at or after *pos; returns its length, 0 at the end
+size_t md_index_next_term(const char* text, size_t len, size_t* pos, char out[MD_INDEX_MAX_TERM + 1]);
+
+#endif // CCLAW_MEMORY_MARKDOWN_INDEX_H
@@ -0,0 +1,33 @@
+// shard.h - Memory spread over several backend instances
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_MEMORY_SHARD_H
+#define CCLAW_MEMORY_SHARD_H
+
+#include "core/memory.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A memory_t over config->shards instances of one backend, each storing
+// under data_dir/shard-NN (its own SQLite file and writer for sqlite), so
+// concurrent writers do not queue behind one database. An entry goes to
+// the shard picked by its key or, with shard_by_category, by its category.
+//
+// search runs on every shard at once and keeps the best `limit` hits by
+// score; get_stats and sweep results are summed. Recall and forget by key
+// go straight to the key's shard. Routed by category, a key stored under
+// several categories has a copy on each of their shards: recall returns
+// the newest and forget removes them all. Lookups by id try every shard.
+// backup and restore use one file per shard, backup_path.NN.
+
+#define MEMORY_SHARD_MAX 64
+
+// Creates config->shards (2..MEMORY_SHARD_MAX) instances of backend
+err_t memory_shard_create(const char* backend, const memory_config_t* config, memory_t** out_memory);
+
+bool memory_is_sharded(const memory_t* memory);
+// Route for an entry; 0 unless memory came from memory_shard_create
+uint32_t memory_shard_of(const memory_t* memory, const memory_entry_t* entry);
+
+#endif // CCLAW_MEMORY_SHARD_H
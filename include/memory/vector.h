@@ -0,0 +1,60 @@
+// vector.h - Quantized vector index for memory backends
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_MEMORY_VECTOR_H
+#define CCLAW_MEMORY_VECTOR_H
+
+#include "core/types.h"
+#include "core/error.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Vectors are L2-normalized, then stored as int8 codes with one float scale
+// each (v[i] ~= code[i] * scale). Rows are contiguous so a flat scan is a
+// straight int8 dot-product loop the compiler vectorizes.
+typedef struct vector_index_t {
+    uint32_t dimensions;
+    int8_t* codes;             // count * dimensions
+    float* scales;
+    int64_t* owners;           // Owning memory row per vector (chunks share an owner)
+    uint32_t count;
+    uint32_t capacity;
+} vector_index_t;
+
+typedef struct vector_hit_t {
+    int64_t owner;
+    float score;               // Cosine similarity, best chunk per owner
+} vector_hit_t;
+
+void vector_index_init(vector_index_t* index, uint32_t dimensions);
+void vector_index_free(vector_index_t* index);
+void vector_index_clear(vector_index_t* index);
+err_t vector_index_add(vector_index_t* index, int64_t owner, const int8_t* code, float scale);
+
+// Top-k owners by cosine against a normalized query; returns hits written (best first)
+uint32_t vector_index_search(const vector_index_t* index, const float* query,
+                             uint32_t k, vector_hit_t* out_hits);
+
+// Normalize v in place and quantize it; returns the scale
+float vector_quantize(float* v, uint32_t dimensions, int8_t* out_code);
+
+// Split text at whitespace into pieces of at most max_bytes; returns pieces written
+uint32_t vector_chunk_text(str_t text, size_t max_bytes, str_t* out_chunks, uint32_t max_chunks);
+
+// Direct-mapped cache of text embeddings keyed by a 64-bit text hash
+typedef struct embedding_cache_t {
+    uint32_t capacity;
+    uint32_t dimensions;
+    uint64_t* hashes;          // 0 = empty slot
+    float* vectors;
+} embedding_cache_t;
+
+err_t embedding_cache_init(embedding_cache_t* cache, uint32_t capacity, uint32_t dimensions);
+void embedding_cache_free(embedding_cache_t* cache);
+uint64_t embedding_cache_hash(str_t text);
+bool embedding_cache_get(const embedding_cache_t* cache, uint64_t hash, float* out);
+void embedding_cache_put(embedding_cache_t* cache, uint64_t hash, const float* vector);
+
+#endif // CCLAW_MEMORY_VECTOR_H
@@ -26,6 +26,17 @@ err_t anthropic_set_version(provider_t* provider, const char* version);
 err_t anthropic_set_beta(provider_t* provider, const char* beta);
 err_t anthropic_set_max_tokens(provider_t* provider, uint32_t max_tokens);
 
+// Messages request body and response parser (also used by providers/batch.h)
+char* anthropic_build_request(const provider_t* provider,
+                              const chat_message_t* messages,
+                              uint32_t message_count,
+                              const tool_def_t* tools,
+                              uint32_t tool_count,
+                              const char* model,
+                              double temperature,
+                              bool stream);
+err_t anthropic_parse_response(char* json_str, size_t len, chat_response_t* response);
+
 // Available Anthropic models
 static const char* const ANTHROPIC_MODELS[] = {
     // Claude 3.5 series
@@ -6,7 +6,9 @@
 
 #include "core/types.h"
 #include "core/error.h"
+#include "core/alloc.h"
 #include "utils/http.h"
+#include "utils/json_writer.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -19,11 +21,19 @@ typedef struct provider_config_t provider_config_t;
 
 // chat_role_t and chat_message_t are defined in core/types.h
 
+// Wire shapes of a tool definition and of the calls a model makes
+typedef enum {
+    TOOL_DIALECT_OPENAI,       // OpenAI, DeepSeek, Kimi, OpenRouter
+    TOOL_DIALECT_ANTHROPIC,    // Messages API: input_schema, tool_use blocks
+    TOOL_DIALECT_COUNT
+} tool_dialect_t;
+
 // Tool definition for function calling
 typedef struct tool_def_t {
     str_t name;
     str_t description;
     str_t parameters;      // JSON schema
+    str_t json[TOOL_DIALECT_COUNT];   // Cached "tools" entries (tool_def_serialize), written verbatim
 } tool_def_t;
 
 // Chat response structure
@@ -34,9 +44,104 @@ typedef struct chat_response_t {
     uint32_t prompt_tokens;
     uint32_t completion_tokens;
     uint32_t total_tokens;
-    str_t tool_calls;      // JSON array if tools were called
+    uint32_t cached_tokens;       // Prompt tokens served from the provider's prefix cache
+    uint32_t cache_write_tokens;  // Prompt tokens written to it (Anthropic)
+    str_t tool_calls;      // JSON array if tools were called (OpenAI shape)
 } chat_response_t;
 
+// Async completion callbacks (run on the http_engine_t loop thread)
+typedef void (*provider_chat_callback_t)(err_t err, chat_response_t* response, void* user_data);
+typedef void (*provider_stream_done_t)(err_t err, void* user_data);
+
+// Typed streaming deltas emitted by the shared SSE parser
+typedef enum {
+    STREAM_DELTA_TEXT,         // text: content fragment
+    STREAM_DELTA_TOOL_CALL,    // tool_index plus id/name (first fragment) and argument fragment
+    STREAM_DELTA_USAGE,        // prompt/completion/cached tokens (0 = not reported)
+    STREAM_DELTA_FINISH,       // finish_reason
+    STREAM_DELTA_ERROR,        // text: error message from the provider
+    STREAM_DELTA_DONE          // End of stream
+} stream_delta_type_t;
+
+// Strings point into parser scratch memory and are valid only during the callback
+typedef struct stream_delta_t {
+    stream_delta_type_t type;
+    str_t text;
+    uint32_t tool_index;
+    str_t tool_id;
+    str_t tool_name;
+    str_t tool_arguments;
+    uint32_t prompt_tokens;
+    uint32_t completion_tokens;
+    uint32_t cached_tokens;
+    str_t finish_reason;
+} stream_delta_t;
+
+typedef void (*stream_delta_callback_t)(const stream_delta_t* delta, void* user_data);
+
+// Wire format of the event payloads
+typedef enum {
+    SSE_DIALECT_OPENAI,        // OpenAI-compatible chat.completion.chunk
+    SSE_DIALECT_ANTHROPIC      // Anthropic Messages stream events
+} sse_dialect_t;
+
+// Incremental SSE tokenizer. Complete lines are parsed in place over the
+// transport buffer; only a line split across writes is carried over, and
+// each frame's JSON lands in a reused arena, so steady-state streaming does
+// not allocate. Each data: line is treated as one event.
+typedef struct sse_parser_t {
+    sse_dialect_t dialect;
+    stream_delta_callback_t on_delta;
+    void (*on_chunk)(const char* chunk, void* user_data);   // Text-only shortcut
+    void* user_data;
+    char* carry;               // Partial line from the previous write
+    size_t carry_len;
+    size_t carry_cap;
+    bool carry_overflow;       // Line exceeded SSE_MAX_LINE; skip to newline
+    void* arena;               // arena_allocator_t* for frame JSON
+    bool done;
+} sse_parser_t;
+
+#define SSE_MAX_LINE (1024 * 1024)
+
+err_t sse_parser_init(sse_parser_t* parser, sse_dialect_t dialect,
+                      stream_delta_callback_t on_delta,
+                      void (*on_chunk)(const char* chunk, void* user_data),
+                      void* user_data);
+void sse_parser_free(sse_parser_t* parser);
+
+// http_write_callback_t compatible
+size_t sse_parser_feed(const char* data, size_t len, void* parser);
+
+// Collects STREAM_DELTA_TOOL_CALL fragments by tool_index and renders the
+// same tool_calls array a non-streamed response carries
+typedef struct tool_call_builder_slot_t {
+    char* id;
+    char* name;
+    char* arguments;
+    size_t arguments_len;
+    size_t arguments_cap;
+    uint32_t depth;            // Brace nesting outside strings
+    bool in_string;
+    bool escaped;
+    bool closed;               // The arguments object has been closed
+} tool_call_builder_slot_t;
+
+typedef struct tool_call_builder_t {
+    tool_call_builder_slot_t* slots;
+    uint32_t count;
+} tool_call_builder_t;
+
+void tool_call_builder_init(tool_call_builder_t* builder);
+void tool_call_builder_free(tool_call_builder_t* builder);
+// Ignores deltas that are not tool calls
+err_t tool_call_builder_feed(tool_call_builder_t* builder, const stream_delta_t* delta);
+// STR_NULL when no calls were seen; caller frees out_json
+err_t tool_call_builder_finish(tool_call_builder_t* builder, str_t* out_json);
+
+// Provider-specific response parser; parses json_str in place (json_parse_insitu)
+typedef err_t (*provider_parse_fn_t)(char* json_str, size_t len, chat_response_t* out_response);
+
 // Provider configuration
 typedef struct provider_config_t {
     str_t name;                    // Provider name (e.g., "openrouter", "deepseek")
@@ -45,6 +150,7 @@ typedef struct provider_config_t {
     str_t default_model;
     double default_temperature;
     uint32_t max_tokens;
+    bool compress_requests;        // gzip large request bodies (gateways that accept it)
     uint32_t timeout_ms;
     bool stream;                   // Enable streaming responses
     // Retry configuration
@@ -86,6 +192,48 @@ struct provider_vtable_t {
                          void (*on_chunk)(const char* chunk, void* user_data),
                          void* user_data);
 
+    // Stream chat with typed deltas (text, tool-call fragments, usage)
+    err_t (*chat_stream_deltas)(provider_t* provider,
+                                const chat_message_t* messages,
+                                uint32_t message_count,
+                                const tool_def_t* tools,
+                                uint32_t tool_count,
+                                const char* model,
+                                double temperature,
+                                stream_delta_callback_t on_delta,
+                                void* user_data);
+
+    // Async chat on an HTTP engine; on_done owns the response
+    err_t (*chat_async)(provider_t* provider,
+                        http_engine_t* engine,
+                        const chat_message_t* messages,
+                        uint32_t message_count,
+                        const tool_def_t* tools,
+                        uint32_t tool_count,
+                        const char* model,
+                        double temperature,
+                        provider_chat_callback_t on_done,
+                        void* user_data);
+
+    // Async stream chat; on_chunk per delta, on_done once at the end
+    err_t (*chat_stream_async)(provider_t* provider,
+                               http_engine_t* engine,
+                               const chat_message_t* messages,
+                               uint32_t message_count,
+                               const char* model,
+                               double temperature,
+                               void (*on_chunk)(const char* chunk, void* user_data),
+                               provider_stream_done_t on_done,
+                               void* user_data);
+
+    // Embeddings: count * dimensions floats into out_vectors (dimensions 0 = model default)
+    err_t (*embed)(provider_t* provider,
+                   const char* model,
+                   const str_t* texts,
+                   uint32_t count,
+                   uint32_t dimensions,
+                   float* out_vectors);
+
     // Model management
     err_t (*list_models)(provider_t* provider, str_t** out_models, uint32_t* out_count);
     bool (*supports_model)(provider_t* provider, const char* model);
@@ -93,6 +241,9 @@ struct provider_vtable_t {
     // Health check
     err_t (*health_check)(provider_t* provider, bool* out_healthy);
 
+    // Open connections ahead of the first request (NULL = HEAD the base URL)
+    err_t (*prewarm)(provider_t* provider);
+
     // Get available models (static)
     const char** (*get_available_models)(uint32_t* out_count);
 };
@@ -134,6 +285,11 @@ const provider_vtable_t* anthropic_get_vtable(void);
 provider_t* provider_alloc(const provider_vtable_t* vtable);
 void provider_free(provider_t* provider);
 
+// DNS, TCP and TLS to the provider's hosts now rather than on the first turn
+err_t provider_prewarm(provider_t* provider);
+// Prewarms in parallel; returns the first failure
+err_t provider_prewarm_all(provider_t* const* providers, uint32_t count);
+
 // Retry and failover helpers
 err_t provider_chat_with_retry(provider_t* provider,
                                const chat_message_t* messages,
@@ -146,10 +302,133 @@ err_t provider_chat_with_retry(provider_t* provider,
                                uint64_t retry_delay_ms,
                                chat_response_t** out_response);
 
+// Hedging: an attempt that has not answered by the provider's observed p95
+// latency (METRIC_PROVIDER_LATENCY) gets a second request; the first
+// answer wins and the other is cancelled. Hedges draw on a per-minute
+// budget shared by the process.
+#define PROVIDER_HEDGE_BUDGET_PER_MIN 30
+#define PROVIDER_HEDGE_MIN_SAMPLES 20      // Latency samples before hedging starts
+#define PROVIDER_HEDGE_MIN_DELAY_MS 20
+
+void provider_set_hedge_budget(uint32_t per_minute);   // 0 disables hedging
+
+// One hedged chat on the calling thread's engine; hedge_provider NULL
+// sends the hedge to the same provider. Providers without chat_async
+// are called directly. Identical concurrent calls share one request
+// (providers/singleflight.h), as do provider_chat_stream_deltas and
+// provider_embed calls with explicit dimensions.
+err_t provider_chat_hedged(provider_t* provider,
+                           provider_t* hedge_provider,
+                           const chat_message_t* messages,
+                           uint32_t message_count,
+                           const tool_def_t* tools,
+                           uint32_t tool_count,
+                           const char* model,
+                           double temperature,
+                           chat_response_t** out_response);
+
+// Async chat; falls back to the blocking vtable call (completing inline)
+// when the provider has no async implementation
+err_t provider_chat_async(provider_t* provider,
+                          http_engine_t* engine,
+                          const chat_message_t* messages,
+                          uint32_t message_count,
+                          const tool_def_t* tools,
+                          uint32_t tool_count,
+                          const char* model,
+                          double temperature,
+                          provider_chat_callback_t on_done,
+                          void* user_data);
+
+err_t provider_chat_stream_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const char* model,
+                                 double temperature,
+                                 void (*on_chunk)(const char* chunk, void* user_data),
+                                 provider_stream_done_t on_done,
+                                 void* user_data);
+
+// Typed streaming; falls back to chat_stream (text deltas only)
+err_t provider_chat_stream_deltas(provider_t* provider,
+                                  const chat_message_t* messages,
+                                  uint32_t message_count,
+                                  const tool_def_t* tools,
+                                  uint32_t tool_count,
+                                  const char* model,
+                                  double temperature,
+                                  stream_delta_callback_t on_delta,
+                                  void* user_data);
+
+// Embeddings dispatch
+err_t provider_embed(provider_t* provider,
+                     const char* model,
+                     const str_t* texts,
+                     uint32_t count,
+                     uint32_t dimensions,
+                     float* out_vectors);
+
+// OpenAI-compatible /embeddings request (helper for provider implementations)
+err_t provider_embed_openai_compatible(provider_t* provider,
+                                       const char* url,
+                                       const char* model,
+                                       const str_t* texts,
+                                       uint32_t count,
+                                       uint32_t dimensions,
+                                       float* out_vectors);
+
+// Body of an OpenAI-compatible /embeddings call
+char* provider_embed_request_body(const char* model, const str_t* texts, uint32_t count, uint32_t dimensions);
+
+// Adapter matching memory_embed_fn_t; ctx is a provider_embedder_t
+typedef struct provider_embedder_t {
+    provider_t* provider;
+    const char* model;
+} provider_embedder_t;
+
+err_t provider_embedder_embed(void* ctx, const str_t* texts, uint32_t count,
+                              uint32_t dimensions, float* out_vectors);
+
+// POST a prepared request under the provider's client-side rate limit
+// (providers/ratelimit.h); non-2xx statuses become provider errors
+err_t provider_post_json(provider_t* provider, const char* url, const char* request_body,
+                         http_response_t** out_response);
+
+// Run a prepared streaming request through the shared SSE parser
+err_t provider_stream_request(provider_t* provider,
+                              const char* url,
+                              const char* request_body,
+                              sse_dialect_t dialect,
+                              stream_delta_callback_t on_delta,
+                              void (*on_chunk)(const char* chunk, void* user_data),
+                              void* user_data);
+
+// Submit a prepared request body on engine (helpers for provider implementations)
+err_t provider_submit_chat_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const char* url,
+                                 const char* request_body,
+                                 provider_parse_fn_t parse,
+                                 provider_chat_callback_t on_done,
+                                 void* user_data);
+
+err_t provider_submit_stream_async(provider_t* provider,
+                                   http_engine_t* engine,
+                                   const char* url,
+                                   const char* request_body,
+                                   sse_dialect_t dialect,
+                                   stream_delta_callback_t on_delta,
+                                   void (*on_chunk)(const char* chunk, void* user_data),
+                                   provider_stream_done_t on_done,
+                                   void* user_data);
+
 // Response helpers
 chat_response_t* chat_response_create(void);
 void chat_response_free(chat_response_t* response);
 void chat_response_clear(chat_response_t* response);
+// Deep copy; NULL when out of memory
+chat_response_t* chat_response_copy(const chat_response_t* response);
 
 // Message helpers
 chat_message_t* chat_message_create(chat_role_t role, const char* content);
@@ -160,11 +439,31 @@ void chat_message_array_free(chat_message_t* messages, uint32_t count);
 tool_def_t* tool_def_create(const char* name, const char* description, const char* parameters);
 void tool_def_free(tool_def_t* tool);
 void tool_def_array_free(tool_def_t* tools, uint32_t count);
-
-// Parse chat response from JSON (common helper)
-err_t provider_parse_chat_response(const char* json_str, chat_response_t* out_response);
-
-// Build chat request JSON (common helper)
+// Render the "tools" entry for every dialect once into tool->json
+err_t tool_def_serialize(tool_def_t* tool);
+
+// Tool-call helpers. The array is OpenAI-shaped:
+// [{"id","type":"function","function":{"name","arguments":"<json>"}}]
+struct json_object_t;
+struct json_array_t;
+// Fill token counts from a usage object in any supported dialect
+void provider_parse_usage(struct json_object_t* usage, chat_response_t* response);
+// Copy message.tool_calls of an OpenAI-compatible response into response->tool_calls
+err_t provider_capture_tool_calls(struct json_object_t* message, chat_response_t* response);
+// Render the tool_use blocks of an Anthropic content array as response->tool_calls
+err_t provider_capture_tool_use(struct json_array_t* content, chat_response_t* response);
+// L2-normalized vectors from the data array of an /embeddings response
+err_t provider_parse_embeddings(struct json_object_t* body, uint32_t count, uint32_t dimensions, float* out_vectors);
+// Parse a tool_calls array; calls and their strings live in arena
+err_t provider_parse_tool_calls(str_t json, arena_allocator_t* arena,
+                                tool_call_t** out_calls, uint32_t* out_count);
+
+// Parse an OpenAI-compatible chat completion in place (common helper)
+err_t provider_parse_chat_response(char* json_str, size_t len, const char* default_model,
+                                   chat_response_t* out_response);
+
+// Build chat request JSON (common helper, OpenAI-compatible body).
+// Message content is escaped straight into a single output buffer.
 char* provider_build_chat_request(const provider_t* provider,
                                    const chat_message_t* messages,
                                    uint32_t message_count,
@@ -174,6 +473,26 @@ char* provider_build_chat_request(const provider_t* provider,
                                    double temperature,
                                    bool stream);
 
+// Streaming building blocks for providers that add their own fields:
+// begin writes model/messages/temperature/stream/tools and leaves the
+// top-level object open for the caller to finish with json_write_object_end.
+size_t provider_estimate_request_size(const chat_message_t* messages, uint32_t message_count);
+void provider_write_chat_request_begin(json_writer_t* w,
+                                       const provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       bool stream);
+void provider_write_chat_messages(json_writer_t* w,
+                                  const chat_message_t* messages,
+                                  uint32_t message_count);
+void provider_write_tools(json_writer_t* w, tool_dialect_t dialect,
+                          const tool_def_t* tools, uint32_t tool_count);
+const char* provider_role_name(chat_role_t role);
+
 // Default model names
 #define DEFAULT_OPENROUTER_MODEL "anthropic/claude-3.5-sonnet"
 #define DEFAULT_DEEPSEEK_MODEL "deepseek-chat"
@@ -0,0 +1,94 @@
+// batch.h - Batch-API offload for non-interactive provider work
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_PROVIDERS_BATCH_H
+#define CCLAW_PROVIDERS_BATCH_H
+
+#include "providers/base.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Work that can wait (cron jobs, bulk re-embedding) is queued here instead
+// of taking the interactive chat path. A worker thread collects requests,
+// submits them through the provider's batch endpoint (OpenAI /batches over
+// an uploaded JSONL file, Anthropic /messages/batches), polls with a
+// doubling interval and hands each result back to its caller. Batch
+// traffic has its own HTTP client and does not draw on the interactive
+// rate-limit buckets (providers/ratelimit.h).
+
+#define PROVIDER_BATCH_MAX_REQUESTS 1000   // Per submitted batch
+#define PROVIDER_BATCH_FLUSH_MS 10000      // Longest a queued request waits for company
+#define PROVIDER_BATCH_POLL_MIN_MS 5000    // First status check after submit
+#define PROVIDER_BATCH_POLL_MAX_MS 300000
+
+typedef struct provider_batch_config_t {
+    uint32_t max_requests;     // 0 = defaults above
+    uint32_t flush_ms;
+    uint32_t poll_min_ms;
+    uint32_t poll_max_ms;
+} provider_batch_config_t;
+
+typedef struct provider_batch_stats_t {
+    uint64_t submitted;        // Batches sent
+    uint64_t requests;         // Requests they carried
+    uint64_t polls;
+    uint32_t queued;           // Waiting for the next batch
+    uint32_t in_flight;        // Batches not finished yet
+} provider_batch_stats_t;
+
+// Runs on the batch worker; vectors are count * dimensions floats
+typedef void (*provider_embed_callback_t)(err_t err, const float* vectors, void* user_data);
+
+typedef struct provider_batch_t provider_batch_t;
+
+// OpenAI (chat and embeddings) and Anthropic (chat) providers
+bool provider_batch_supported(const provider_t* provider);
+
+// The provider must outlive the batch
+err_t provider_batch_create(provider_t* provider, const provider_batch_config_t* config,
+                            provider_batch_t** out_batch);
+// Fails whatever is still queued or in flight with ERR_CANCELLED
+void provider_batch_destroy(provider_batch_t* batch);
+
+// Queue a chat; on_done runs on the worker thread and owns the response
+err_t provider_batch_chat_async(provider_batch_t* batch,
+                                const chat_message_t* messages,
+                                uint32_t message_count,
+                                const tool_def_t* tools,
+                                uint32_t tool_count,
+                                const char* model,
+                                double temperature,
+                                provider_chat_callback_t on_done,
+                                void* user_data);
+
+// Blocking forms; they wait for the whole batch to finish
+err_t provider_batch_chat(provider_batch_t* batch,
+                          const chat_message_t* messages,
+                          uint32_t message_count,
+                          const tool_def_t* tools,
+                          uint32_t tool_count,
+                          const char* model,
+                          double temperature,
+                          chat_response_t** out_response);
+
+err_t provider_batch_embed_async(provider_batch_t* batch,
+                                 const char* model,
+                                 const str_t* texts,
+                                 uint32_t count,
+                                 uint32_t dimensions,
+                                 provider_embed_callback_t on_done,
+                                 void* user_data);
+
+err_t provider_batch_embed(provider_batch_t* batch,
+                           const char* model,
+                           const str_t* texts,
+                           uint32_t count,
+                           uint32_t dimensions,
+                           float* out_vectors);
+
+// Submit what is queued now instead of waiting for flush_ms
+void provider_batch_flush(provider_batch_t* batch);
+void provider_batch_get_stats(provider_batch_t* batch, provider_batch_stats_t* out_stats);
+
+#endif // CCLAW_PROVIDERS_BATCH_H
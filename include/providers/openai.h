@@ -27,6 +27,17 @@ err_t openai_set_organization(provider_t* provider, const char* org_id);
 err_t openai_set_project(provider_t* provider, const char* project_id);
 err_t openai_set_include_reasoning(provider_t* provider, bool include);
 
+// Chat request body and response parser (also used by providers/batch.h)
+char* openai_build_request(const provider_t* provider,
+                           const chat_message_t* messages,
+                           uint32_t message_count,
+                           const tool_def_t* tools,
+                           uint32_t tool_count,
+                           const char* model,
+                           double temperature,
+                           bool stream);
+err_t openai_parse_response(char* json_str, size_t len, chat_response_t* response);
+
 // Available OpenAI models
 static const char* const OPENAI_MODELS[] = {
     // GPT-4 series
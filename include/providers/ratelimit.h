@@ -0,0 +1,67 @@
+// ratelimit.h - Retry policy and server-reported rate limits for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_PROVIDERS_RATELIMIT_H
+#define CCLAW_PROVIDERS_RATELIMIT_H
+
+#include "core/types.h"
+#include "core/error.h"
+#include "utils/http.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RETRY_MAX_DELAY_MS 30000
+#define RATE_LIMIT_SLOTS 64            // Distinct provider/API-key pairs tracked
+#define RATE_LIMIT_DEFAULT_BLOCK_MS 1000  // 429 without Retry-After or reset
+
+// Limits a provider reported on one response; -1 / 0 = not reported.
+// Understands Retry-After (seconds or HTTP date), retry-after-ms, OpenAI
+// x-ratelimit-*-requests/-tokens, Anthropic anthropic-ratelimit-* and the
+// plain X-RateLimit-* headers used by OpenRouter.
+typedef struct rate_limit_info_t {
+    uint64_t retry_after_ms;
+    int64_t requests_limit;
+    int64_t requests_remaining;
+    uint64_t requests_reset_ms;    // Until the request window resets
+    int64_t tokens_remaining;
+    uint64_t tokens_reset_ms;
+} rate_limit_info_t;
+
+void rate_limit_parse(const http_response_t* response, rate_limit_info_t* out_info);
+
+// Bucket per provider and API key; the key itself is only hashed
+uint64_t rate_limit_key(str_t provider_name, str_t api_key);
+
+// Client-side token bucket per key, sized and refilled from the limits the
+// server reports, so requests are spaced before the server starts
+// refusing them. Keys that never reported limits are not throttled.
+//
+// Take a permit and return how long to wait before using it
+uint64_t rate_limit_reserve(uint64_t key);
+// Take a permit only if one is free now; otherwise the wait, nothing taken
+uint64_t rate_limit_try(uint64_t key);
+// Feed a response's status and headers back
+void rate_limit_update(uint64_t key, uint32_t status, const rate_limit_info_t* info);
+// Time left on a server-imposed pause (Retry-After, exhausted window)
+uint64_t rate_limit_blocked_ms(uint64_t key);
+// Forget all buckets
+void rate_limit_reset(void);
+
+// Exponential backoff with equal jitter: attempt 0 waits between half
+// and all of base_delay_ms, each further attempt doubles, capped at
+// max_delay_ms. Never shorter than min_delay_ms (a server pause).
+typedef struct retry_policy_t {
+    uint32_t max_retries;
+    uint64_t base_delay_ms;
+    uint64_t max_delay_ms;
+} retry_policy_t;
+
+uint64_t retry_backoff_ms(const retry_policy_t* policy, uint32_t attempt, uint64_t min_delay_ms);
+// Transient failures worth another attempt (network, 429, 5xx)
+bool retry_is_retryable(err_t err);
+
+// Provider error for a non-2xx HTTP status
+err_t rate_limit_status_error(uint32_t status);
+
+#endif // CCLAW_PROVIDERS_RATELIMIT_H
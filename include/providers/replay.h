@@ -0,0 +1,41 @@
+// replay.h - Provider serving recorded HTTP exchanges, for load tests
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_PROVIDERS_REPLAY_H
+#define CCLAW_PROVIDERS_REPLAY_H
+
+#include "providers/base.h"
+
+// Record a capture by running against a real provider with
+// CCLAW_HTTP_CAPTURE=file (or http_capture_start), then select provider
+// "replay" with base_url, or CCLAW_REPLAY_FILE, naming that file.
+//
+// Chat exchanges (POSTs to .../chat/completions or .../messages) are
+// loaded; everything else in the capture is skipped. A request is answered
+// with an exchange whose last user message is the same, the next one in
+// turn when several are, and otherwise with the next exchange of the same
+// kind (streamed or not) in capture order, so a short capture can drive
+// any number of requests. Responses go through the same parsers as live
+// traffic, and recorded non-2xx statuses come back as the same errors.
+//
+// Delays follow the recording scaled by the time scale: 1 replays the
+// original latency and inter-chunk timing, 0.5 runs twice as fast and 0
+// answers immediately. CCLAW_REPLAY_TIME_SCALE sets the default.
+
+#define REPLAY_DEFAULT_TIME_SCALE 1.0
+
+typedef struct replay_stats_t {
+    uint32_t exchanges;        // Loaded from the capture
+    uint32_t skipped;          // Capture lines that were not chat exchanges
+    uint64_t served;
+    uint64_t matched;          // Served by last user message rather than in turn
+} replay_stats_t;
+
+err_t replay_create(const provider_config_t* config, provider_t** out_provider);
+void replay_destroy(provider_t* provider);
+const provider_vtable_t* replay_get_vtable(void);
+
+err_t replay_set_time_scale(provider_t* provider, double time_scale);
+err_t replay_get_stats(provider_t* provider, replay_stats_t* out_stats);
+
+#endif // CCLAW_PROVIDERS_REPLAY_H
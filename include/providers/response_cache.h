@@ -0,0 +1,86 @@
+// response_cache.h - Content-addressed cache of deterministic chat responses
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_PROVIDERS_RESPONSE_CACHE_H
+#define CCLAW_PROVIDERS_RESPONSE_CACHE_H
+
+#include "core/types.h"
+#include "core/error.h"
+#include "providers/base.h"
+#include "core/config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Requests are keyed by a BLAKE2b hash (libsodium crypto_generichash) of
+// provider, model, temperature, tool definitions and message bytes. Only
+// requests at or below max_temperature are cached, so sampled replies are
+// never replayed. Lookups try an in-memory LRU, then an optional SQLite
+// table; disk hits are promoted into the LRU.
+
+#define RESPONSE_CACHE_KEY_BYTES 32
+#define RESPONSE_CACHE_DEFAULT_ENTRIES 256
+#define RESPONSE_CACHE_DEFAULT_TTL_SECS 86400
+
+typedef struct response_cache_config_t {
+    uint32_t max_entries;      // LRU tier (0 = RESPONSE_CACHE_DEFAULT_ENTRIES)
+    uint64_t ttl_secs;         // 0 = RESPONSE_CACHE_DEFAULT_TTL_SECS
+    const char* db_path;       // SQLite tier; NULL = memory only
+    double max_temperature;
+} response_cache_config_t;
+
+typedef struct response_cache_stats_t {
+    uint64_t memory_hits;
+    uint64_t disk_hits;
+    uint64_t misses;
+    uint32_t entries;          // Currently in the LRU tier
+} response_cache_stats_t;
+
+typedef struct response_cache_t response_cache_t;
+
+err_t response_cache_create(const response_cache_config_t* config, response_cache_t** out_cache);
+void response_cache_destroy(response_cache_t* cache);
+
+// Settings from config->response_cache; the SQLite tier lives in the workspace
+err_t response_cache_create_from_config(const config_t* config, response_cache_t** out_cache);
+
+// Hash of everything that determines a reply; key of the cache and of
+// request coalescing (providers/singleflight.h)
+void response_cache_hash_request(str_t provider_name,
+                                 const char* model,
+                                 double temperature,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const tool_def_t* tools,
+                                 uint32_t tool_count,
+                                 uint8_t out_key[RESPONSE_CACHE_KEY_BYTES]);
+
+// As above; false when the request is not cacheable (temperature, bypass)
+bool response_cache_key(const response_cache_t* cache,
+                        str_t provider_name,
+                        const char* model,
+                        double temperature,
+                        const chat_message_t* messages,
+                        uint32_t message_count,
+                        const tool_def_t* tools,
+                        uint32_t tool_count,
+                        uint8_t out_key[RESPONSE_CACHE_KEY_BYTES]);
+
+// A fresh copy the caller frees with chat_response_free
+bool response_cache_get(response_cache_t* cache, const uint8_t key[RESPONSE_CACHE_KEY_BYTES],
+                        chat_response_t** out_response);
+void response_cache_put(response_cache_t* cache, const uint8_t key[RESPONSE_CACHE_KEY_BYTES],
+                        const chat_response_t* response);
+void response_cache_clear(response_cache_t* cache);
+void response_cache_get_stats(response_cache_t* cache, response_cache_stats_t* out_stats);
+
+// Skip the cache for requests made on the calling thread; returns the
+// previous setting so callers can restore it
+bool response_cache_set_bypass(bool bypass);
+
+// Provider answering cacheable chats from the cache and forwarding the
+// rest to inner. Takes ownership of cache and inner. Streaming and
+// embeddings pass straight through.
+err_t response_cache_wrap(response_cache_t* cache, provider_t* inner, provider_t** out_provider);
+
+#endif // CCLAW_PROVIDERS_RESPONSE_CACHE_H
@@ -7,28 +7,91 @@
 #include "providers/base.h"
 #include "core/config.h"
 
+#include <pthread.h>
+
+// Live routing: every chat through the router updates per-route EWMA
+// latency, time to first token and error rate, and a route that keeps
+// failing is cut off by a circuit breaker until a probe succeeds.
+
+#define ROUTER_EWMA_ALPHA 0.3             // Weight of the newest sample
+#define ROUTER_ERROR_WEIGHT 4.0           // Score multiplier per unit of error rate
+#define ROUTER_SWITCH_MARGIN 0.25         // A later route must score this much better
+#define ROUTER_UNMEASURED_US 2000000.0    // Assumed latency of a route with no samples
+#define ROUTER_FAILURE_THRESHOLD 3        // Consecutive failures that open the circuit
+#define ROUTER_OPEN_MS 5000               // First cool-down; doubles per failed probe
+#define ROUTER_OPEN_MAX_MS 60000
+
+typedef enum {
+    CIRCUIT_CLOSED,
+    CIRCUIT_OPEN,
+    CIRCUIT_HALF_OPEN          // One probe request in flight
+} circuit_state_t;
+
+// One provider/model pair the router may send a request to
+typedef struct provider_route_t {
+    str_t provider_name;
+    str_t model;               // Empty = the model the caller asked for
+    str_t hint;                // Empty = serves any model the provider supports
+    provider_t* provider;      // Owned; NULL when creation failed
+
+    // Live stats, under the router lock
+    double latency_us;         // EWMA of full request time
+    double ttft_us;            // EWMA of time to first streamed delta
+    double error_rate;         // EWMA of failures (0..1)
+    uint32_t samples;
+    uint32_t ttft_samples;
+    uint32_t consecutive_failures;
+    circuit_state_t circuit;
+    uint64_t open_until_ms;
+    uint64_t open_ms;          // Current cool-down
+} provider_route_t;
+
 // Provider router for load balancing and failover
 typedef struct provider_router_t {
     config_t* config;
-    provider_t** providers;
-    uint32_t provider_count;
-    uint32_t current_index;
-    uint32_t retry_count;
-    uint64_t last_failure_time;
+    provider_route_t* routes;  // model_routes, then default, then fallbacks
+    uint32_t route_count;
+    uint64_t open_ms;          // First cool-down (ROUTER_OPEN_MS)
+    pthread_mutex_t lock;
 } provider_router_t;
 
-// Create a provider router from configuration
+// Create a provider router from configuration; each route's provider is
+// created up front
 provider_router_t* provider_router_create(config_t* config);
 
 // Destroy provider router
 void provider_router_destroy(provider_router_t* router);
 
-// Get the best provider for a given model/request
-// Implements failover and load balancing
+// Add a route to an existing provider before the router serves requests;
+// the router takes ownership
+err_t provider_router_add_route(provider_router_t* router, provider_t* provider,
+                                str_t model, str_t hint);
+
+// Pick the best-scoring route for model_hint whose circuit admits a
+// request, skipping routes set in exclude (bit per route index). An open
+// circuit past its cool-down admits one probe. ERR_PROVIDER_UNAVAILABLE
+// when no route is usable.
+err_t provider_router_select(provider_router_t* router, const char* model_hint,
+                             uint64_t exclude, uint32_t* out_index);
+
+// Feed a request outcome back into a route's stats and breaker
+void provider_router_report(provider_router_t* router, uint32_t index, err_t err,
+                            uint64_t latency_us, uint64_t ttft_us);
+
+// Current score of a route (lower is better); inf while its circuit is open
+double provider_router_score(provider_router_t* router, uint32_t index);
+
+// Get the best provider for a given model/request. The provider is owned
+// by the router.
 err_t provider_router_get_provider(provider_router_t* router,
                                    const char* model_hint,
                                    provider_t** out_provider);
 
+// A provider that sends each chat through the router, failing over to the
+// next best route before any output has been delivered. Freeing it
+// destroys the router.
+err_t provider_router_as_provider(provider_router_t* router, provider_t** out_provider);
+
 // Create a provider with automatic failover
 // Tries primary provider first, then fallbacks
 err_t provider_router_create_with_failover(config_t* config,
@@ -0,0 +1,54 @@
+// singleflight.h - Coalescing of concurrent identical provider requests
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_PROVIDERS_SINGLEFLIGHT_H
+#define CCLAW_PROVIDERS_SINGLEFLIGHT_H
+
+#include "providers/base.h"
+#include "providers/response_cache.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The first caller with a key leads: it runs the request while callers
+// arriving with the same key wait and then receive a copy of its result.
+// Stream followers replay the leader's deltas from the start and then
+// follow them live. A key is free again as soon as its leader finishes,
+// so nothing is cached. The provider dispatchers (provider_chat_hedged,
+// provider_chat_stream_deltas, provider_embed) coalesce through this.
+
+#define SINGLEFLIGHT_KEY_BYTES RESPONSE_CACHE_KEY_BYTES
+#define SINGLEFLIGHT_BUCKETS 64
+
+// Keys cover the provider instance and everything that shapes the reply
+void singleflight_chat_key(const provider_t* provider,
+                           const chat_message_t* messages,
+                           uint32_t message_count,
+                           const tool_def_t* tools,
+                           uint32_t tool_count,
+                           const char* model,
+                           double temperature,
+                           uint8_t out_key[SINGLEFLIGHT_KEY_BYTES]);
+void singleflight_embed_key(const provider_t* provider,
+                            const char* model,
+                            const str_t* texts,
+                            uint32_t count,
+                            uint32_t dimensions,
+                            uint8_t out_key[SINGLEFLIGHT_KEY_BYTES]);
+
+typedef err_t (*singleflight_chat_fn_t)(void* ctx, chat_response_t** out_response);
+typedef err_t (*singleflight_stream_fn_t)(void* ctx, stream_delta_callback_t on_delta, void* user_data);
+typedef err_t (*singleflight_embed_fn_t)(void* ctx, float* out_vectors);
+
+err_t singleflight_chat(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_chat_fn_t run, void* ctx,
+                        chat_response_t** out_response);
+err_t singleflight_stream(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_stream_fn_t run, void* ctx,
+                          stream_delta_callback_t on_delta, void* user_data);
+// vector_floats is the size of out_vectors, equal for every caller of a key
+err_t singleflight_embed(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_embed_fn_t run, void* ctx,
+                         size_t vector_floats, float* out_vectors);
+
+// Callers that joined a flight instead of leading one
+uint64_t singleflight_shared_count(void);
+
+#endif // CCLAW_PROVIDERS_SINGLEFLIGHT_H
@@ -12,12 +12,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <signal.h>
+#include <pthread.h>
 
 // Forward declarations
 typedef struct daemon_t daemon_t;
 typedef struct daemon_config_t daemon_config_t;
 typedef struct cron_job_t cron_job_t;
 typedef struct health_status_t health_status_t;
+typedef struct cron_task_t cron_task_t;
 
 // Daemon configuration
 struct daemon_config_t {
@@ -27,6 +29,10 @@ struct daemon_config_t {
     bool redirect_stdio;      // Redirect stdin/stdout/stderr
     bool double_fork;         // Use double fork technique
     uint32_t umask;           // File mode creation mask
+    uint32_t cron_workers;    // Threads running job bodies (0 = DAEMON_CRON_WORKERS)
+    str_t health_socket;      // Health and metrics socket (empty = DAEMON_HEALTH_SOCKET)
+    str_t metrics_bind;       // Address for the TCP metrics listener (empty = loopback)
+    uint16_t metrics_port;    // Also serve over TCP on this port (0 = off)
 };
 
 // Cron job structure
@@ -37,12 +43,13 @@ typedef struct cron_job_t {
     str_t command;            // Command to execute
     str_t description;        // Job description
 
-    // Schedule parsing
-    uint8_t minute;           // 0-59 or 255 for *
-    uint8_t hour;             // 0-23 or 255 for *
-    uint8_t day_of_month;     // 1-31 or 255 for *
-    uint8_t month;            // 1-12 or 255 for *
-    uint8_t day_of_week;      // 0-6 (0=Sunday) or 255 for *
+    // Schedule compiled from the expression: bit n set = value n matches
+    uint64_t minutes;         // Bits 0-59
+    uint64_t hours;           // Bits 0-23
+    uint64_t days_of_month;   // Bits 1-31
+    uint64_t months;          // Bits 1-12
+    uint64_t days_of_week;    // Bits 0-6 (0=Sunday)
+    bool days_either;         // Both day fields restricted: either may match
 
     // State
     bool enabled;
@@ -50,6 +57,7 @@ typedef struct cron_job_t {
     uint64_t next_run;
     uint32_t run_count;
     uint32_t fail_count;
+    uint32_t heap_slot;       // Position in the schedule + 1, 0 = not scheduled
 
     // Callback for agent-based jobs
     void (*callback)(const char* args, void* user_data);
@@ -90,14 +98,37 @@ struct daemon_t {
     uint32_t job_count;
     uint32_t job_capacity;
 
+    // Enabled jobs in a min-heap on next_run; the main loop sleeps until
+    // the root's deadline unless a signal or a job change wakes it first
+    cron_job_t** schedule;
+    uint32_t schedule_count;
+    uint32_t schedule_capacity;
+    pthread_mutex_t cron_lock;   // jobs and schedule
+    int wake_fds[2];             // Self-pipe written by signals and job changes
+
+    // Job bodies run on a worker pool, started with the first due job
+    pthread_t* workers;
+    uint32_t worker_count;
+    pthread_mutex_t task_lock;
+    pthread_cond_t task_cond;
+    cron_task_t* task_head;
+    cron_task_t* task_tail;
+    bool workers_stop;
+
     // Signal handling
     volatile sig_atomic_t received_sigterm;
     volatile sig_atomic_t received_sighup;
     volatile sig_atomic_t received_sigusr1;
 
-    // Health check server
+    // Health check server: GET /health and GET /metrics over the unix
+    // socket and the optional TCP port, answered by one server thread
     int health_fd;            // Unix socket for health checks
     str_t health_socket_path;
+    int metrics_fd;           // TCP listener, -1 when disabled
+    int health_stop_fds[2];   // Written to stop the server thread
+    pthread_t health_thread;
+    bool health_thread_started;
+    pthread_mutex_t health_lock;  // health
 
     // Reference to agent
     agent_t* agent;
@@ -142,7 +173,8 @@ bool pidfile_exists(const char* path);
 // Cron Scheduler
 // ============================================================================
 
-// Cron expression parsing
+// Cron expression parsing: five fields of "*", "N", "N-M" and "A,B" items
+// with optional "/step", month and weekday names, and @hourly..@yearly
 err_t cron_parse_expression(const str_t* expression, cron_job_t* out_job);
 err_t cron_compute_next_run(cron_job_t* job, uint64_t after_timestamp);
 bool cron_should_run(const cron_job_t* job, uint64_t current_timestamp);
@@ -153,9 +185,18 @@ err_t daemon_cron_remove(daemon_t* daemon, const str_t* job_id);
 err_t daemon_cron_list(daemon_t* daemon, cron_job_t*** out_jobs, uint32_t* out_count);
 err_t daemon_cron_enable(daemon_t* daemon, const str_t* job_id, bool enable);
 
-// Run due jobs
+// Hand every job whose next_run has passed to the workers and reschedule it
 err_t daemon_cron_run_pending(daemon_t* daemon);
 
+// Run a job now, off schedule; its next_run is unchanged
+err_t daemon_cron_trigger(daemon_t* daemon, const str_t* job_id);
+
+// Earliest next_run of an enabled job, 0 if none is scheduled
+uint64_t daemon_cron_next_deadline(daemon_t* daemon);
+
+// Wake daemon_run to re-read the schedule (safe from signal handlers)
+void daemon_wakeup(daemon_t* daemon);
+
 // ============================================================================
 // Health Checking
 // ============================================================================
@@ -165,7 +206,8 @@ void daemon_health_shutdown(daemon_t* daemon);
 err_t daemon_health_update(daemon_t* daemon);
 err_t daemon_health_get(daemon_t* daemon, health_status_t* out_status);
 
-// Health check server
+// Health check server; answers HTTP/1.0 GET /health (JSON) and
+// GET /metrics (Prometheus text) on a background thread
 err_t daemon_health_server_start(daemon_t* daemon);
 void daemon_health_server_stop(daemon_t* daemon);
 
@@ -200,7 +242,14 @@ uint64_t daemon_get_uptime_ms(daemon_t* daemon);
 #define DAEMON_LOG_FILE_DEFAULT "/var/log/cclaw.log"
 #define DAEMON_LOG_FILE_USER "~/.cclaw/daemon.log"
 #define DAEMON_HEALTH_SOCKET "/tmp/cclaw-health.sock"
+#define DAEMON_METRICS_BIND "127.0.0.1"
+// A scraper that stalls longer than this is dropped
+#define DAEMON_HEALTH_IO_TIMEOUT_MS 2000
 
 #define DAEMON_CONFIG_CRON_FILE ".cclaw/crontab"
 
+#define DAEMON_CRON_WORKERS 4
+// Longest single sleep; bounds drift from wall-clock jumps and suspend
+#define DAEMON_MAX_SLEEP_MS (5 * 60 * 1000)
+
 #endif // CCLAW_RUNTIME_DAEMON_H
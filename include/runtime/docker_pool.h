@@ -0,0 +1,77 @@
+// docker_pool.h - Warm container pool for sandboxed shell commands
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_RUNTIME_DOCKER_POOL_H
+#define CCLAW_RUNTIME_DOCKER_POOL_H
+
+#include "core/types.h"
+#include "core/error.h"
+#include "core/config.h"
+#include "core/tool.h"
+
+// Containers are started ahead of time with `docker run -d <image> sleep
+// infinity` and commands run in them with `docker exec`, which costs tens
+// of milliseconds against seconds for a fresh container. A background
+// thread keeps the pool topped up.
+//
+// After each command the container is reset (stray processes killed,
+// /tmp cleared) before it is handed out again. It is removed instead, and
+// replaced, once it has run max_uses commands or when a command broke
+// policy: it timed out, was killed, exited 137 (the OOM killer) or docker
+// itself failed. A timed-out `docker exec` leaves its process running in
+// the container, so removing the container is the only way to stop it.
+
+#define DOCKER_POOL_DEFAULT_SIZE 2
+#define DOCKER_POOL_DEFAULT_MAX_USES 50
+#define DOCKER_POOL_DEFAULT_ACQUIRE_TIMEOUT_MS 30000
+#define DOCKER_POOL_WORKDIR "/workspace"
+// Runs as a separate exec; pid 1 (the sleep) is spared by kill -1
+#define DOCKER_POOL_RESET_COMMAND "kill -9 -1 2>/dev/null; rm -rf /tmp/* /tmp/.[!.]* 2>/dev/null; true"
+
+typedef struct docker_pool_t docker_pool_t;
+
+typedef struct docker_pool_config_t {
+    const char* image;
+    const char* network;            // NULL = docker's default
+    uint64_t memory_limit_mb;       // 0 = unlimited
+    double cpu_limit;               // 0 = unlimited
+    bool read_only_rootfs;          // Adds a tmpfs at /tmp
+    const char* workspace_dir;      // Mounted at DOCKER_POOL_WORKDIR when set
+    uint32_t size;                  // Containers kept started
+    uint32_t max_uses;              // Commands per container before it is replaced
+    uint32_t acquire_timeout_ms;    // Wait for a free container
+    const char* docker;             // CLI to run, default "docker"
+    const char* reset_command;      // Default DOCKER_POOL_RESET_COMMAND
+} docker_pool_config_t;
+
+typedef struct docker_pool_stats_t {
+    uint64_t execs;
+    uint64_t started;
+    uint64_t recycled;              // Removed for max_uses or a violation
+    uint64_t violations;
+    uint64_t start_failures;
+    uint32_t idle;
+    uint32_t busy;
+} docker_pool_stats_t;
+
+docker_pool_config_t docker_pool_config_default(void);
+
+// Starts the maintenance thread, which begins filling the pool; this does
+// not wait for the first container
+err_t docker_pool_create(const docker_pool_config_t* config, docker_pool_t** out_pool);
+
+// From config->runtime.docker, for RUNTIME_KIND_DOCKER
+err_t docker_pool_create_from_config(const config_t* config, docker_pool_t** out_pool);
+
+// Removes every container. No docker_pool_exec may still be running.
+void docker_pool_destroy(docker_pool_t* pool);
+
+// Runs `sh -c command` in a warm container, in DOCKER_POOL_WORKDIR when
+// the workspace is mounted. options->cwd is ignored. Fails with
+// ERR_DOCKER_UNAVAILABLE when no container could be started in time.
+err_t docker_pool_exec(docker_pool_t* pool, const char* command, const shell_run_options_t* options,
+                       shell_run_result_t* out_result);
+
+void docker_pool_stats(docker_pool_t* pool, docker_pool_stats_t* out_stats);
+
+#endif // CCLAW_RUNTIME_DOCKER_POOL_H
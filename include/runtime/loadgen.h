@@ -0,0 +1,89 @@
+// loadgen.h - Synthetic session load generator behind `cclaw bench`
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_RUNTIME_LOADGEN_H
+#define CCLAW_RUNTIME_LOADGEN_H
+
+#include "core/types.h"
+#include "core/error.h"
+#include "core/memory.h"
+#include "providers/base.h"
+
+#include <stdio.h>
+
+// Every session is a thread running turns back to back, pausing for a
+// randomized think time between them, until it has run its turns or the
+// duration is up. What a turn is depends on the target:
+//   provider  one chat request on a growing conversation; streamed turns
+//             time the first token. tool_ratio is the share of turns that
+//             offer the tool definitions.
+//   webhook   one POST of {"text","sender"} to the channel's endpoint;
+//             streamed turns ask for the SSE reply and last until its done
+//             event, otherwise the acknowledgement is the turn.
+//   memory    a search, or a store for tool_ratio of the turns.
+
+typedef enum {
+    LOADGEN_TARGET_PROVIDER,
+    LOADGEN_TARGET_WEBHOOK,
+    LOADGEN_TARGET_MEMORY
+} loadgen_target_t;
+
+#define LOADGEN_DEFAULT_SESSIONS 8
+#define LOADGEN_DEFAULT_TURNS 10
+#define LOADGEN_DEFAULT_THINK_MS 1000
+#define LOADGEN_DEFAULT_TOOL_RATIO 0.3
+// Messages a session keeps besides the system prompt
+#define LOADGEN_DEFAULT_HISTORY 20
+
+typedef struct loadgen_config_t {
+    loadgen_target_t target;
+    uint32_t sessions;
+    uint32_t turns;            // Per session, 0 = until duration_ms
+    uint64_t duration_ms;      // 0 = until every session ran its turns
+    uint32_t think_ms;         // Mean pause between turns (exponential), 0 = none
+    double tool_ratio;         // 0..1, see above
+    uint32_t history;
+    bool stream;
+    uint64_t seed;             // 0 = from the clock
+
+    provider_t* provider;      // LOADGEN_TARGET_PROVIDER; TTFT needs chat_stream_deltas
+    const char* model;         // NULL = provider default
+    const char* url;           // LOADGEN_TARGET_WEBHOOK
+    const char* auth_token;    // Sent as a bearer token when set
+    memory_t* memory;          // LOADGEN_TARGET_MEMORY
+} loadgen_config_t;
+
+// Latencies in microseconds; nearest-rank percentiles over all turns
+typedef struct loadgen_report_t {
+    loadgen_target_t target;
+    uint64_t turns;
+    uint64_t errors;
+    uint64_t tool_turns;       // Turns that offered tools; stores, for memory
+    uint64_t tool_calls;       // Provider responses that called a tool
+    double elapsed_s;
+    double turns_per_s;
+    uint64_t latency_p50_us;
+    uint64_t latency_p95_us;
+    uint64_t latency_p99_us;
+    uint64_t latency_max_us;
+    uint32_t ttft_count;       // Turns that streamed a first token
+    uint64_t ttft_p50_us;
+    uint64_t ttft_p95_us;
+    uint64_t ttft_p99_us;
+    uint64_t peak_rss_bytes;   // Process high-water mark
+    uint64_t peak_heap_bytes;  // malloc in use, sampled; 0 where unavailable
+    uint32_t peak_magazines;   // Size-class magazines, sampled
+    err_t first_error;
+} loadgen_report_t;
+
+loadgen_config_t loadgen_config_default(void);
+
+// Blocks until the run is over. Fails only when the run cannot start;
+// failed turns are counted in the report.
+err_t loadgen_run(const loadgen_config_t* config, loadgen_report_t* out_report);
+
+// Human-readable table, or one JSON object
+void loadgen_report_print(const loadgen_report_t* report, FILE* out);
+err_t loadgen_report_json(const loadgen_report_t* report, char** out_json);
+
+#endif // CCLAW_RUNTIME_LOADGEN_H
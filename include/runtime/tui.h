@@ -7,6 +7,8 @@
 #include "core/types.h"
 #include "core/agent.h"
 #include "core/error.h"
+#include "runtime/tui_screen.h"
+#include "runtime/tui_scrollback.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -54,17 +56,10 @@ struct tui_config_t {
     bool show_token_count;
     bool show_timestamps;
     bool show_branch_indicator;
+    uint16_t max_fps;              // Redraws per second at most; 0 = uncapped
     tui_theme_t theme;
 };
 
-// Chat message for TUI display
-typedef struct tui_message_t {
-    char* text;
-    char* sender;  // "user", "assistant", "system"
-    uint64_t timestamp;
-    struct tui_message_t* next;
-} tui_message_t;
-
 // TUI State
 struct tui_t {
     tui_config_t config;
@@ -75,10 +70,8 @@ struct tui_t {
     struct termios original_termios;
     bool raw_mode;
 
-    // Screen buffer
-    char** screen_buffer;
-    uint16_t buffer_width;
-    uint16_t buffer_height;
+    // Frames are drawn here and only the changes reach the terminal
+    tui_screen_t* screen;
 
     // Input state
     char* input_buffer;
@@ -92,10 +85,8 @@ struct tui_t {
     uint32_t history_pos;
     uint32_t history_capacity;
 
-    // Chat messages (simple linked list)
-    tui_message_t* messages;
-    tui_message_t* messages_tail;
-    uint32_t message_count;
+    // Chat messages
+    tui_scrollback_t scrollback;
 
     // Panels
     tui_panel_t* panels[5];
@@ -104,12 +95,10 @@ struct tui_t {
     // Session selection in sidebar
     uint32_t selected_session;
 
-    // Scrolling
-    uint32_t scroll_offset;
-
     // Running state
     bool running;
-    bool needs_redraw;
+    bool needs_redraw;         // Set by anything that changes what is shown
+    bool streaming;            // The last message is a reply still arriving
 };
 
 // TUI Panel
@@ -138,6 +127,9 @@ void tui_stop(tui_t* tui);
 // Rendering
 // ============================================================================
 
+// tui_redraw draws a frame and writes what changed since the last one.
+// Within the frame cap it only sets needs_redraw; tui_run draws the
+// deferred frame once it is due.
 void tui_clear_screen(tui_t* tui);
 void tui_refresh(tui_t* tui);
 void tui_redraw(tui_t* tui);
@@ -148,14 +140,14 @@ void tui_draw_status_bar(tui_t* tui);
 void tui_draw_input_area(tui_t* tui);
 void tui_draw_toolbar(tui_t* tui);
 
-// Drawing primitives
-void tui_move_cursor(uint16_t x, uint16_t y);
-void tui_set_color(uint8_t fg, uint8_t bg);
-void tui_reset_color(void);
-void tui_draw_box(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title);
-void tui_draw_line(uint16_t x, uint16_t y, uint16_t len, bool horizontal);
-void tui_draw_text(uint16_t x, uint16_t y, const char* text);
-void tui_draw_text_truncated(uint16_t x, uint16_t y, uint16_t max_width, const char* text);
+// Drawing primitives (into the frame being drawn)
+void tui_move_cursor(tui_t* tui, uint16_t x, uint16_t y);
+void tui_set_color(tui_t* tui, uint8_t fg, uint8_t bg);
+void tui_reset_color(tui_t* tui);
+void tui_draw_box(tui_t* tui, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title);
+void tui_draw_line(tui_t* tui, uint16_t x, uint16_t y, uint16_t len, bool horizontal);
+void tui_draw_text(tui_t* tui, uint16_t x, uint16_t y, const char* text);
+void tui_draw_text_truncated(tui_t* tui, uint16_t x, uint16_t y, uint16_t max_width, const char* text);
 
 // ============================================================================
 // Input Handling
@@ -192,6 +184,8 @@ void tui_chat_add_message(tui_t* tui, agent_message_t* message);
 void tui_chat_add_system_message(tui_t* tui, const char* text);
 void tui_chat_add_user_message(tui_t* tui, const char* text);
 void tui_chat_add_assistant_message(tui_t* tui, const char* text);
+// Extend the last message, e.g. with streamed reply text
+void tui_chat_append_text(tui_t* tui, const char* text, size_t len);
 void tui_chat_add_tool_call(tui_t* tui, const char* tool_name, const char* args);
 void tui_chat_add_tool_result(tui_t* tui, const char* tool_name, const char* result);
 void tui_chat_scroll_up(tui_t* tui, uint32_t lines);
@@ -273,5 +267,7 @@ tui_config_t tui_config_default(void);
 #define TUI_MIN_HEIGHT 10
 #define TUI_INPUT_HISTORY_SIZE 100
 #define TUI_MAX_INPUT_LENGTH 4096
+// Taller chat panels show this many lines
+#define TUI_CHAT_MAX_ROWS 512
 
 #endif // CCLAW_RUNTIME_TUI_H
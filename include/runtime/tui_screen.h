@@ -0,0 +1,97 @@
+// tui_screen.h - Double-buffered cell grid for the terminal UI
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_RUNTIME_TUI_SCREEN_H
+#define CCLAW_RUNTIME_TUI_SCREEN_H
+
+#include "core/types.h"
+#include "core/error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// A frame is drawn into the back buffer from scratch, then flushed: rows
+// that differ from the front buffer (what the terminal shows) are
+// repainted from their first to their last changed cell, cursor moves and
+// SGR changes are only emitted where needed, and the whole frame goes out
+// in one write(). A frame with no changes writes nothing.
+
+typedef struct tui_screen_t tui_screen_t;
+
+// Attribute bits
+#define TUI_ATTR_BOLD      0x01
+#define TUI_ATTR_DIM       0x02
+#define TUI_ATTR_ITALIC    0x04
+#define TUI_ATTR_UNDERLINE 0x08
+#define TUI_ATTR_REVERSE   0x10
+
+// The terminal's own foreground/background
+#define TUI_COLOR_DEFAULT 256
+
+// Frames per second when tui_config_t doesn't say
+#define TUI_DEFAULT_FPS 60
+
+typedef struct tui_cell_t {
+    char glyph[4];          // UTF-8, not NUL-terminated
+    uint8_t len;            // 0 = right half of the wide glyph to the left
+    uint8_t attr;
+    uint16_t fg;            // 0-255, or TUI_COLOR_DEFAULT
+    uint16_t bg;
+} tui_cell_t;
+
+typedef struct tui_screen_stats_t {
+    uint64_t frames;        // Flushes that wrote something
+    uint64_t rows_painted;
+    uint64_t bytes_written;
+} tui_screen_stats_t;
+
+// Frames are written to fd (normally STDOUT_FILENO)
+err_t tui_screen_create(uint16_t width, uint16_t height, int fd, tui_screen_t** out_screen);
+void tui_screen_free(tui_screen_t* screen);
+
+// The next flush repaints everything
+err_t tui_screen_resize(tui_screen_t* screen, uint16_t width, uint16_t height);
+void tui_screen_invalidate(tui_screen_t* screen);
+void tui_screen_get_size(const tui_screen_t* screen, uint16_t* out_width, uint16_t* out_height);
+
+// ============================================================================
+// Drawing (back buffer; anything past the edges is clipped)
+// ============================================================================
+
+// Blank the back buffer to start a frame
+void tui_screen_clear(tui_screen_t* screen);
+void tui_screen_move(tui_screen_t* screen, uint16_t x, uint16_t y);
+void tui_screen_set_style(tui_screen_t* screen, uint16_t fg, uint16_t bg, uint8_t attr);
+void tui_screen_reset_style(tui_screen_t* screen);
+// Text at the pen, which moves past it; control characters are drawn as
+// spaces and nothing wraps
+void tui_screen_put(tui_screen_t* screen, const char* text, size_t len);
+void tui_screen_puts(tui_screen_t* screen, const char* text);
+void tui_screen_printf(tui_screen_t* screen, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+// Where the terminal cursor is left after a flush
+void tui_screen_set_cursor(tui_screen_t* screen, uint16_t x, uint16_t y, bool visible);
+
+// NULL if out of range
+const tui_cell_t* tui_screen_cell(const tui_screen_t* screen, uint16_t x, uint16_t y);
+
+// Bytes in the glyph at text and the columns tui_screen_put gives it (1 or 2)
+uint32_t tui_glyph_measure(const char* text, size_t len, uint32_t* out_columns);
+
+// ============================================================================
+// Output
+// ============================================================================
+
+// Minimum time between frames; 0 = uncapped
+void tui_screen_set_frame_interval(tui_screen_t* screen, uint32_t interval_ms);
+bool tui_screen_frame_due(const tui_screen_t* screen);
+// Until the next frame is due, 0 if it is already
+int tui_screen_frame_wait_ms(const tui_screen_t* screen);
+
+// Write the difference between the back and front buffers
+err_t tui_screen_flush(tui_screen_t* screen);
+
+void tui_screen_get_stats(const tui_screen_t* screen, tui_screen_stats_t* out_stats);
+
+#endif // CCLAW_RUNTIME_TUI_SCREEN_H
@@ -0,0 +1,83 @@
+// tui_scrollback.h - Chat history with cached line wrapping for the TUI
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_RUNTIME_TUI_SCROLLBACK_H
+#define CCLAW_RUNTIME_TUI_SCROLLBACK_H
+
+#include "core/types.h"
+#include "core/error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Messages live in a ring, each with the byte offsets of its wrapped lines
+// and the number of its first line in the whole history. Wrapping is
+// redone for every message only when the width changes; appending to the
+// last message rewraps just its last line. Scrolling is arithmetic on a
+// line count, and drawing looks up the message at the top of the window
+// by binary search, so neither depends on how long the history is.
+
+// Oldest messages are dropped past this
+#define TUI_SCROLLBACK_MAX_MESSAGES 10000
+
+typedef struct tui_message_t {
+    char* text;
+    char* sender;              // "user", "assistant", "system", ...
+    char* label;               // Drawn before the first line, e.g. "[You]: "
+    uint64_t timestamp;
+    uint32_t text_len;
+    uint16_t label_width;      // Columns; later lines are indented as far
+
+    // Wrap cache
+    uint32_t* line_starts;     // Byte offset of each wrapped line
+    uint32_t line_count;
+    uint32_t line_capacity;
+    uint64_t first_line;       // In the whole history
+    size_t accounted;          // Bytes charged to ALLOC_TAG_TUI
+} tui_message_t;
+
+typedef struct tui_scrollback_t {
+    tui_message_t** ring;
+    uint32_t capacity;
+    uint32_t head;             // Oldest message
+    uint32_t count;
+    uint16_t width;            // Columns lines are wrapped to
+    uint64_t end_line;         // One past the newest line
+    uint64_t scroll;           // Lines scrolled up from the bottom
+} tui_scrollback_t;
+
+// One visible line
+typedef struct tui_scrollback_line_t {
+    const tui_message_t* message;
+    uint32_t line;             // Within the message; 0 carries the label
+    const char* text;
+    uint32_t len;
+} tui_scrollback_line_t;
+
+// max_messages 0 = TUI_SCROLLBACK_MAX_MESSAGES
+err_t tui_scrollback_init(tui_scrollback_t* scrollback, uint32_t max_messages);
+void tui_scrollback_free(tui_scrollback_t* scrollback);
+
+err_t tui_scrollback_push(tui_scrollback_t* scrollback, const char* sender, const char* text);
+err_t tui_scrollback_append(tui_scrollback_t* scrollback, const char* text, size_t len);
+err_t tui_scrollback_replace_last(tui_scrollback_t* scrollback, const char* sender, const char* text);
+
+// index 0 = oldest; NULL if out of range
+tui_message_t* tui_scrollback_at(const tui_scrollback_t* scrollback, uint32_t index);
+tui_message_t* tui_scrollback_last(const tui_scrollback_t* scrollback);
+
+// Rewraps everything when width changed
+void tui_scrollback_set_width(tui_scrollback_t* scrollback, uint16_t width);
+uint64_t tui_scrollback_line_count(const tui_scrollback_t* scrollback);
+
+// While scrolled up, new lines keep the view where it is
+void tui_scrollback_scroll_up(tui_scrollback_t* scrollback, uint64_t lines);
+void tui_scrollback_scroll_down(tui_scrollback_t* scrollback, uint64_t lines);
+
+// Lines of a window rows high at the current scroll position, oldest
+// first; returns how many were filled
+uint32_t tui_scrollback_window(tui_scrollback_t* scrollback, uint32_t rows,
+                               tui_scrollback_line_t* out_lines);
+
+#endif // CCLAW_RUNTIME_TUI_SCROLLBACK_H
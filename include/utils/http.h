@@ -45,11 +45,20 @@ typedef struct http_client_config_t {
     str_t ca_cert_path;
     str_t client_cert_path;
     str_t client_key_path;
+    // Connection pool options
+    uint32_t pool_size;               // Max easy handles kept by the client
+    uint32_t max_connections_per_host; // Max concurrent requests per host (0 = pool_size)
+    uint32_t idle_timeout_ms;         // Evict handles/connections idle longer than this
+    // Protocol options
+    bool http2;                       // Negotiate HTTP/2 over TLS; engine requests multiplex on it
+    uint32_t tcp_keepalive_secs;      // Idle seconds before TCP keepalive probes (0 = off)
+    uint32_t upkeep_interval_ms;      // HTTP/2 PING cadence for http_client_upkeep (0 = off)
+    uint32_t compress_min_bytes;      // gzip request bodies at least this large (0 = off)
 } http_client_config_t;
 
 // HTTP client handle
 struct http_client_t {
-    void* curl;  // CURL* handle
+    void* pool;  // http_pool_t* (keep-alive easy handles + CURLSH share)
     http_client_config_t config;
     http_header_t* default_headers;
     uint32_t default_headers_count;
@@ -87,6 +96,9 @@ err_t http_request(http_client_t* client, const char* method, const char* url,
 
 // Response handling
 void http_response_free(http_response_t* response);
+// The response owns its NUL-terminated body, pre-sized from Content-Length;
+// in-situ parsers (json_parse_insitu) may overwrite it
+char* http_response_body(http_response_t* response);
 const char* http_response_get_header(http_response_t* response, const char* name);
 bool http_response_is_success(http_response_t* response);
 bool http_response_is_redirect(http_response_t* response);
@@ -102,20 +114,94 @@ str_t http_url_decode(const char* str);
 // Build query string from key-value pairs
 str_t http_build_query(const char** keys, const char** values, uint32_t count);
 
-// Async support (basic)
+// Streaming response support
+typedef size_t (*http_write_callback_t)(const char* data, size_t len, void* user_data);
+
+// Async engine
+// A curl_multi handle driven by a libuv loop; one thread can keep many
+// requests in flight. All engine calls must happen on the loop's thread.
+// Completion callbacks own the response (NULL when err != ERR_OK).
+typedef struct http_engine_t http_engine_t;
+typedef void (*http_async_callback_t)(err_t err, http_response_t* response, void* user_data);
+
+http_engine_t* http_engine_create(void* loop);         // uv_loop_t*, NULL = uv_default_loop()
+void http_engine_destroy(http_engine_t* engine);       // Cancels in-flight requests
+err_t http_engine_run(http_engine_t* engine);          // Run loop until no requests remain
+uint32_t http_engine_pending(const http_engine_t* engine);
+void* http_engine_get_loop(const http_engine_t* engine);
+http_engine_t* http_engine_default(void);              // Lazily created on uv_default_loop()
+http_engine_t* http_engine_thread(void);               // Calling thread's own engine and loop
+
+// Run one loop iteration, waiting at most timeout_ms for I/O
+#define HTTP_ENGINE_WAIT_FOREVER UINT32_MAX
+err_t http_engine_run_once(http_engine_t* engine, uint32_t timeout_ms);
+
+// Requests submitted while a tag is set carry it; cancelling a tag
+// completes each of its in-flight requests with ERR_CANCELLED
+void http_engine_set_tag(http_engine_t* engine, uint64_t tag);    // 0 = untagged
+uint32_t http_engine_cancel(http_engine_t* engine, uint64_t tag);
+
+err_t http_request_async(http_engine_t* engine, http_client_t* client,
+                         const char* method, const char* url,
+                         const char* body, size_t body_len,
+                         const char* content_type,
+                         http_async_callback_t on_done, void* user_data);
+err_t http_post_json_async(http_engine_t* engine, http_client_t* client,
+                           const char* url, const char* json_body,
+                           http_async_callback_t on_done, void* user_data);
+// on_data receives body chunks; the final response carries status only
+err_t http_post_json_stream_async(http_engine_t* engine, http_client_t* client,
+                                  const char* url, const char* json_body,
+                                  http_write_callback_t on_data,
+                                  http_async_callback_t on_done, void* user_data);
+
+// Async support (basic, runs on http_engine_default())
 typedef void (*http_callback_t)(http_response_t* response, void* user_data);
 err_t http_get_async(http_client_t* client, const char* url, http_callback_t callback, void* user_data);
 
-// Streaming response support
-typedef size_t (*http_write_callback_t)(const char* data, size_t len, void* user_data);
 err_t http_get_stream(http_client_t* client, const char* url, http_write_callback_t callback, void* user_data);
+err_t http_post_stream(http_client_t* client, const char* url, const char* body,
+                       http_write_callback_t callback, void* user_data);
 err_t http_post_json_stream(http_client_t* client, const char* url, const char* json_body,
                            http_write_callback_t callback, void* user_data);
+// Same, but *out_status receives the status and headers (empty body)
+err_t http_post_json_stream_status(http_client_t* client, const char* url, const char* json_body,
+                                   http_write_callback_t callback, void* user_data,
+                                   http_response_t** out_status);
 
 // Connection pool (for high-performance scenarios)
+// Requests on one client run concurrently on pooled keep-alive handles that
+// share a connection/DNS/TLS-session cache. Callers block when the pool or the
+// per-host limit is exhausted.
 err_t http_client_set_pool_size(http_client_t* client, uint32_t size);
 void http_client_drain_pool(http_client_t* client);
 
+// Resolve, connect and finish TLS to url's host with a HEAD request, so the
+// first real request reuses a live connection. Any HTTP status counts as warm.
+err_t http_client_prewarm(http_client_t* client, const char* url);
+// Ping idle HTTP/2 connections older than upkeep_interval_ms
+void http_client_upkeep(http_client_t* client);
+
+// Capture
+// While on, every exchange on any client, sync or async, is appended to
+// the file as one JSON line, stream chunks with their arrival offsets, for
+// the replay provider (providers/replay.h) to serve back. Lines hold the
+// request and response bodies and response headers; request headers, and
+// so API keys, are left out.
+err_t http_capture_start(const char* path);
+void http_capture_stop(void);
+// Starts a capture when CCLAW_HTTP_CAPTURE names a file
+err_t http_capture_init_from_env(void);
+
+// Pool defaults
+#define HTTP_POOL_SIZE_DEFAULT 8
+#define HTTP_POOL_MAX_PER_HOST_DEFAULT 4
+#define HTTP_POOL_IDLE_TIMEOUT_MS_DEFAULT 60000
+#define HTTP_TCP_KEEPALIVE_SECS_DEFAULT 30
+#define HTTP_UPKEEP_INTERVAL_MS_DEFAULT 20000
+#define HTTP_COMPRESS_MIN_BYTES_DEFAULT 16384
+#define HTTP_COMPRESS_LEVEL 6
+
 // Helper macros
 #define HTTP_OK 200
 #define HTTP_CREATED 201
@@ -0,0 +1,79 @@
+// json_writer.h - Streaming JSON writer for CClaw
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_UTILS_JSON_WRITER_H
+#define CCLAW_UTILS_JSON_WRITER_H
+
+#include "core/types.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Maximum container nesting tracked by the writer
+#define JSON_WRITER_MAX_DEPTH 64
+
+// Bytes of JSON text staged before a gzip writer deflates them
+#define JSON_WRITER_GZIP_CHUNK 16384
+
+// Writes JSON text directly into one growable buffer. Strings are escaped
+// straight from the source, so no intermediate DOM or string copies exist.
+// Allocation failures are sticky: json_writer_finish then returns NULL.
+// A gzip writer deflates the text a chunk at a time as it is produced, so
+// a large body never exists uncompressed in full.
+typedef struct json_writer_t {
+    char* data;
+    size_t len;
+    size_t cap;
+    uint32_t depth;
+    uint64_t has_items;    // Bit per depth: container already holds a value
+    bool after_key;
+    bool failed;
+    void* gzip;            // z_stream*, NULL for plain output
+    char* gz_data;
+    size_t gz_len;
+    size_t gz_cap;
+} json_writer_t;
+
+// Lifecycle
+void json_writer_init(json_writer_t* w, size_t initial_capacity);
+// Output is a gzip member (level 1-9, 0 = zlib default); finish needs out_len
+void json_writer_init_gzip(json_writer_t* w, int level);
+void json_writer_free(json_writer_t* w);
+void json_writer_reset(json_writer_t* w);
+
+// Hand the NUL-terminated buffer to the caller (free with free()); gzip
+// output is binary and also NUL-terminated only for convenience
+char* json_writer_finish(json_writer_t* w, size_t* out_len);
+
+// Containers
+void json_write_object_begin(json_writer_t* w);
+void json_write_object_end(json_writer_t* w);
+void json_write_array_begin(json_writer_t* w);
+void json_write_array_end(json_writer_t* w);
+
+// Values
+void json_write_key(json_writer_t* w, const char* key);
+void json_write_string(json_writer_t* w, const char* str);
+void json_write_string_len(json_writer_t* w, const char* str, size_t len);
+void json_write_str(json_writer_t* w, str_t str);
+void json_write_number(json_writer_t* w, double value);
+void json_write_int(json_writer_t* w, int64_t value);
+void json_write_bool(json_writer_t* w, bool value);
+void json_write_null(json_writer_t* w);
+
+// Pre-serialized JSON (e.g. a tool's parameter schema), written verbatim
+void json_write_raw(json_writer_t* w, const char* json, size_t len);
+
+// Key/value shorthands
+void json_write_kv_string(json_writer_t* w, const char* key, const char* value);
+void json_write_kv_str(json_writer_t* w, const char* key, str_t value);
+void json_write_kv_number(json_writer_t* w, const char* key, double value);
+void json_write_kv_int(json_writer_t* w, const char* key, int64_t value);
+void json_write_kv_bool(json_writer_t* w, const char* key, bool value);
+
+// Append escaped string contents (no quotes) to the buffer; bytes that
+// are not well-formed UTF-8 become U+FFFD
+void json_write_escaped(json_writer_t* w, const char* str, size_t len);
+
+#endif // CCLAW_UTILS_JSON_WRITER_H
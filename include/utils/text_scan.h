@@ -0,0 +1,49 @@
+// text_scan.h - Vectorized scans for JSON strings and UTF-8 text
+// SPDX-License-Identifier: MIT
+
+#ifndef CCLAW_UTILS_TEXT_SCAN_H
+#define CCLAW_UTILS_TEXT_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Each scan returns the offset of the first byte it stops at, or len when
+// there is none, so a caller copies [0, offset) as one clean run. The
+// kernel is picked once per process from what the CPU supports: AVX2 or
+// SSE2 on x86-64, NEON on AArch64, and a scalar loop elsewhere. All of
+// them give identical results.
+
+typedef enum {
+    TEXT_SCAN_SCALAR,
+    TEXT_SCAN_SSE2,
+    TEXT_SCAN_AVX2,
+    TEXT_SCAN_NEON,
+    TEXT_SCAN_IMPL_COUNT
+} text_scan_impl_t;
+
+// First byte a JSON string must escape: '"', '\\' or a control byte < 0x20
+size_t text_scan_json_escape(const char* s, size_t len);
+
+// First '"' or '\\', for finding the end of an encoded JSON string
+size_t text_scan_json_special(const char* s, size_t len);
+
+// First byte >= 0x80
+size_t text_scan_non_ascii(const char* s, size_t len);
+
+// Length of the longest prefix that is well-formed UTF-8 (RFC 3629: no
+// overlong forms, surrogates or code points past U+10FFFF). A sequence cut
+// off by the end of the input counts as malformed.
+size_t text_utf8_valid_prefix(const char* s, size_t len);
+
+static inline bool text_utf8_valid(const char* s, size_t len) {
+    return text_utf8_valid_prefix(s, len) == len;
+}
+
+// The kernel in use, and a way to pin one (tests, benchmarks). Pinning
+// fails for an implementation this build or CPU lacks.
+text_scan_impl_t text_scan_impl(void);
+bool text_scan_set_impl(text_scan_impl_t impl);
+const char* text_scan_impl_name(text_scan_impl_t impl);
+
+#endif // CCLAW_UTILS_TEXT_SCAN_H
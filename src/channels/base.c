@@ -2,9 +2,12 @@
 // SPDX-License-Identifier: MIT
 
 #include "core/channel.h"
+#include "core/alloc.h"
+#include "core/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -14,37 +17,15 @@ typedef struct {
     const channel_vtable_t* vtable;
 } channel_entry_t;
 
+// Filled on first use and locked like the provider registry
 #define MAX_CHANNELS 16
 static channel_entry_t g_registry[MAX_CHANNELS];
 static uint32_t g_channel_count = 0;
 static bool g_registry_initialized = false;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
-err_t channel_registry_init(void) {
-    if (g_registry_initialized) return ERR_OK;
-
-    memset(g_registry, 0, sizeof(g_registry));
-    g_channel_count = 0;
-    g_registry_initialized = true;
-
-    // Register built-in channels
-    // These will be registered when their respective modules are implemented
-    channel_register("cli", channel_cli_get_vtable());
-    channel_register("telegram", channel_telegram_get_vtable());
-    // channel_register("discord", channel_discord_get_vtable());
-    channel_register("webhook", channel_webhook_get_vtable());
-
-    return ERR_OK;
-}
-
-void channel_registry_shutdown(void) {
-    memset(g_registry, 0, sizeof(g_registry));
-    g_channel_count = 0;
-    g_registry_initialized = false;
-}
-
-err_t channel_register(const char* name, const channel_vtable_t* vtable) {
-    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) channel_registry_init();
+// Caller holds g_registry_lock
+static err_t registry_add(const char* name, const channel_vtable_t* vtable) {
     if (g_channel_count >= MAX_CHANNELS) return ERR_OUT_OF_MEMORY;
 
     // Check for duplicates
@@ -61,30 +42,84 @@ err_t channel_register(const char* name, const channel_vtable_t* vtable) {
     return ERR_OK;
 }
 
-err_t channel_create(const char* name, const channel_config_t* config, channel_t** out_channel) {
-    if (!name || !config || !out_channel) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) channel_registry_init();
+static const channel_vtable_t* registry_lookup(const char* name) {
+    const channel_vtable_t* vtable = NULL;
 
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_channel_count; i++) {
         if (strcmp(g_registry[i].name, name) == 0) {
-            return g_registry[i].vtable->create(config, out_channel);
+            vtable = g_registry[i].vtable;
+            break;
         }
     }
+    pthread_mutex_unlock(&g_registry_lock);
 
-    return ERR_NOT_FOUND;
+    return vtable;
+}
+
+err_t channel_registry_init(void) {
+    if (__atomic_load_n(&g_registry_initialized, __ATOMIC_ACQUIRE)) return ERR_OK;
+
+    pthread_mutex_lock(&g_registry_lock);
+    if (!g_registry_initialized) {
+        memset(g_registry, 0, sizeof(g_registry));
+        g_channel_count = 0;
+
+        // Register built-in channels
+        registry_add("cli", channel_cli_get_vtable());
+        registry_add("telegram", channel_telegram_get_vtable());
+        // registry_add("discord", channel_discord_get_vtable());
+        registry_add("webhook", channel_webhook_get_vtable());
+
+        __atomic_store_n(&g_registry_initialized, true, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return ERR_OK;
+}
+
+void channel_registry_shutdown(void) {
+    pthread_mutex_lock(&g_registry_lock);
+    memset(g_registry, 0, sizeof(g_registry));
+    g_channel_count = 0;
+    __atomic_store_n(&g_registry_initialized, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+err_t channel_register(const char* name, const channel_vtable_t* vtable) {
+    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
+    channel_registry_init();
+
+    pthread_mutex_lock(&g_registry_lock);
+    err_t err = registry_add(name, vtable);
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return err;
+}
+
+err_t channel_create(const char* name, const channel_config_t* config, channel_t** out_channel) {
+    if (!name || !config || !out_channel) return ERR_INVALID_ARGUMENT;
+    channel_registry_init();
+
+    const channel_vtable_t* vtable = registry_lookup(name);
+    if (!vtable) return ERR_NOT_FOUND;
+
+    return vtable->create(config, out_channel);
 }
 
 err_t channel_registry_list(const char*** out_names, uint32_t* out_count) {
     if (!out_names || !out_count) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) channel_registry_init();
+    channel_registry_init();
 
     static const char* names[MAX_CHANNELS];
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_channel_count; i++) {
         names[i] = g_registry[i].name;
     }
+    *out_count = g_channel_count;
+    pthread_mutex_unlock(&g_registry_lock);
 
     *out_names = names;
-    *out_count = g_channel_count;
 
     return ERR_OK;
 }
@@ -100,7 +135,8 @@ channel_t* channel_alloc(const channel_vtable_t* vtable) {
 
 void channel_free(channel_t* channel) {
     if (!channel) return;
-    if (channel->vtable && channel->vtable->destroy) {
+    // Channel destroy functions release impl_data and then call back here
+    if (channel->impl_data && channel->vtable && channel->vtable->destroy) {
         channel->vtable->destroy(channel);
     } else {
         free(channel);
@@ -110,7 +146,7 @@ void channel_free(channel_t* channel) {
 // Message helpers
 channel_message_t* channel_message_create(const str_t* id, const str_t* sender,
                                          const str_t* content, const str_t* channel) {
-    channel_message_t* msg = calloc(1, sizeof(channel_message_t));
+    channel_message_t* msg = sizeclass_calloc(sizeof(channel_message_t));
     if (!msg) return NULL;
 
     if (id && !str_empty(*id)) {
@@ -146,7 +182,7 @@ void channel_message_free(channel_message_t* message) {
     free((void*)message->content.data);
     free((void*)message->channel.data);
 
-    free(message);
+    sizeclass_free(message, sizeof(channel_message_t));
 }
 
 void channel_message_array_free(channel_message_t* messages, uint32_t count) {
@@ -162,6 +198,78 @@ void channel_message_array_free(channel_message_t* messages, uint32_t count) {
     free(messages);
 }
 
+// Streaming replies
+err_t channel_stream_begin(channel_t* channel, const str_t* recipient, channel_stream_t** out_stream) {
+    if (!channel || !channel->vtable || !out_stream) return ERR_INVALID_ARGUMENT;
+
+    channel_stream_t* stream = calloc(1, sizeof(channel_stream_t));
+    if (!stream) return ERR_OUT_OF_MEMORY;
+    stream->channel = channel;
+    if (recipient && !str_empty(*recipient)) {
+        stream->recipient = str_dup(*recipient, NULL);
+        if (!stream->recipient.data) {
+            free(stream);
+            return ERR_OUT_OF_MEMORY;
+        }
+    }
+
+    // Any failure to start natively degrades to one send at the end
+    const channel_vtable_t* vt = channel->vtable;
+    if (vt->stream_begin && vt->stream_append && vt->stream_end) {
+        stream->native = vt->stream_begin(channel, stream) == ERR_OK;
+    }
+
+    *out_stream = stream;
+    return ERR_OK;
+}
+
+err_t channel_stream_append(channel_stream_t* stream, const str_t* delta) {
+    if (!stream || !delta) return ERR_INVALID_ARGUMENT;
+    if (delta->len == 0) return ERR_OK;
+
+    if (stream->len + delta->len + 1 > stream->cap) {
+        uint32_t cap = stream->cap ? stream->cap : 256;
+        while (cap < stream->len + delta->len + 1) cap *= 2;
+        char* text = realloc(stream->text, cap);
+        if (!text) return ERR_OUT_OF_MEMORY;
+        stream->text = text;
+        stream->cap = cap;
+    }
+    memcpy(stream->text + stream->len, delta->data, delta->len);
+    stream->len += delta->len;
+    stream->text[stream->len] = '\0';
+
+    if (!stream->native) return ERR_OK;
+    return stream->channel->vtable->stream_append(stream->channel, stream, delta);
+}
+
+err_t channel_stream_end(channel_stream_t* stream) {
+    if (!stream) return ERR_INVALID_ARGUMENT;
+
+    channel_t* channel = stream->channel;
+    TRACE_BEGIN(span, "channel.send");
+    TRACE_DETAIL(span, channel->config.name);
+    err_t err = ERR_OK;
+    if (stream->native) {
+        err = channel->vtable->stream_end(channel, stream);
+    } else if (stream->len > 0) {
+        str_t text = { .data = stream->text, .len = stream->len };
+        err = channel->vtable->send ? channel->vtable->send(channel, &text, &stream->recipient)
+                                    : ERR_NOT_IMPLEMENTED;
+    }
+
+    TRACE_END(span);
+
+    free((void*)stream->recipient.data);
+    free(stream->text);
+    free(stream);
+    return err;
+}
+
+void channel_stream_on_text(const str_t* delta, void* stream) {
+    channel_stream_append((channel_stream_t*)stream, delta);
+}
+
 // Utility functions
 str_t channel_generate_message_id(void) {
     // Simple UUID-like generation for now
@@ -191,6 +299,9 @@ channel_config_t channel_config_default(void) {
         .webhook_url = STR_NULL,
         .port = 8080,
         .host = STR_LIT("127.0.0.1"),
+        .listener_threads = 1,
+        .initial_backoff_secs = 2,
+        .max_backoff_secs = 60,
         .auto_start = true
     };
 }
@@ -198,8 +309,19 @@ channel_config_t channel_config_default(void) {
 // Channel manager implementation
 struct channel_manager_t {
     channel_t** channels;
+    channel_outbox_t** outboxes; // Parallel to channels, created on first send
     uint32_t channel_count;
     uint32_t channel_capacity;
+    pthread_mutex_t outbox_lock;
+    uint32_t outbox_capacity;
+    uint32_t outbox_window_ms;
+
+    // Agent workers behind the inbound queue (0 = deliver inline)
+    uint32_t workers;
+    uint32_t queue_capacity;
+    channel_inbox_t* inbox;
+    uint64_t accepted;         // Totals of inboxes already torn down
+    uint64_t rejected;
 };
 
 channel_manager_t* channel_manager_create(void) {
@@ -208,10 +330,15 @@ channel_manager_t* channel_manager_create(void) {
 
     manager->channel_capacity = 8;
     manager->channels = calloc(manager->channel_capacity, sizeof(channel_t*));
-    if (!manager->channels) {
+    manager->outboxes = calloc(manager->channel_capacity, sizeof(channel_outbox_t*));
+    if (!manager->channels || !manager->outboxes) {
+        free(manager->channels);
+        free(manager->outboxes);
         free(manager);
         return NULL;
     }
+    pthread_mutex_init(&manager->outbox_lock, NULL);
+    manager->outbox_window_ms = CHANNEL_OUTBOX_DEFAULT_WINDOW_MS;
 
     return manager;
 }
@@ -222,11 +349,14 @@ void channel_manager_destroy(channel_manager_t* manager) {
     // Stop all channels first
     channel_manager_stop_all(manager);
 
-    // Free all channels
+    // Free all channels, once what they still had to send went out
     for (uint32_t i = 0; i < manager->channel_count; i++) {
+        channel_outbox_destroy(manager->outboxes[i]);
         channel_free(manager->channels[i]);
     }
 
+    pthread_mutex_destroy(&manager->outbox_lock);
+    free(manager->outboxes);
     free(manager->channels);
     free(manager);
 }
@@ -246,12 +376,16 @@ err_t channel_manager_add_channel(channel_manager_t* manager, channel_t* channel
         uint32_t new_capacity = manager->channel_capacity * 2;
         channel_t** new_channels = realloc(manager->channels, new_capacity * sizeof(channel_t*));
         if (!new_channels) return ERR_OUT_OF_MEMORY;
-
         manager->channels = new_channels;
+
+        channel_outbox_t** new_outboxes = realloc(manager->outboxes, new_capacity * sizeof(channel_outbox_t*));
+        if (!new_outboxes) return ERR_OUT_OF_MEMORY;
+        manager->outboxes = new_outboxes;
         manager->channel_capacity = new_capacity;
     }
 
     manager->channels[manager->channel_count] = channel;
+    manager->outboxes[manager->channel_count] = NULL;
     manager->channel_count++;
 
     return ERR_OK;
@@ -268,12 +402,14 @@ err_t channel_manager_remove_channel(channel_manager_t* manager, const str_t* ch
                 channel->vtable->stop_listening(channel);
             }
 
-            // Free the channel
+            // Free the channel after its queued sends
+            channel_outbox_destroy(manager->outboxes[i]);
             channel_free(channel);
 
             // Shift remaining channels
             for (uint32_t j = i; j < manager->channel_count - 1; j++) {
                 manager->channels[j] = manager->channels[j + 1];
+                manager->outboxes[j] = manager->outboxes[j + 1];
             }
 
             manager->channel_count--;
@@ -284,6 +420,27 @@ err_t channel_manager_remove_channel(channel_manager_t* manager, const str_t* ch
     return ERR_NOT_FOUND;
 }
 
+// The channel's outbox, created on first use
+static err_t manager_outbox(channel_manager_t* manager, uint32_t index, channel_outbox_t** out_outbox) {
+    pthread_mutex_lock(&manager->outbox_lock);
+    err_t err = ERR_OK;
+    if (!manager->outboxes[index]) {
+        err = channel_outbox_create(manager->channels[index], manager->outbox_capacity,
+                                    manager->outbox_window_ms, &manager->outboxes[index]);
+    }
+    *out_outbox = manager->outboxes[index];
+    pthread_mutex_unlock(&manager->outbox_lock);
+    return err;
+}
+
+static err_t manager_enqueue(channel_manager_t* manager, uint32_t index, const str_t* recipient,
+                             const str_t* message) {
+    channel_outbox_t* outbox = NULL;
+    err_t err = manager_outbox(manager, index, &outbox);
+    if (err != ERR_OK) return err;
+    return channel_outbox_push(outbox, recipient, message);
+}
+
 err_t channel_manager_send_to_all(channel_manager_t* manager, const str_t* message) {
     if (!manager || !message) return ERR_INVALID_ARGUMENT;
 
@@ -292,7 +449,7 @@ err_t channel_manager_send_to_all(channel_manager_t* manager, const str_t* messa
     for (uint32_t i = 0; i < manager->channel_count; i++) {
         channel_t* channel = manager->channels[i];
         if (channel->initialized && channel->vtable->send) {
-            err_t err = channel->vtable->send(channel, message, NULL);
+            err_t err = manager_enqueue(manager, i, NULL, message);
             if (err != ERR_OK) {
                 last_error = err;
                 // Continue trying other channels
@@ -305,13 +462,18 @@ err_t channel_manager_send_to_all(channel_manager_t* manager, const str_t* messa
 
 err_t channel_manager_send_to_channel(channel_manager_t* manager, const str_t* channel_name,
                                       const str_t* message) {
+    return channel_manager_send(manager, channel_name, NULL, message);
+}
+
+err_t channel_manager_send(channel_manager_t* manager, const str_t* channel_name,
+                           const str_t* recipient, const str_t* message) {
     if (!manager || !channel_name || !message) return ERR_INVALID_ARGUMENT;
 
     for (uint32_t i = 0; i < manager->channel_count; i++) {
         channel_t* channel = manager->channels[i];
         if (str_equal(channel->config.name, *channel_name)) {
             if (channel->initialized && channel->vtable->send) {
-                return channel->vtable->send(channel, message, NULL);
+                return manager_enqueue(manager, i, recipient, message);
             }
             return ERR_CHANNEL;
         }
@@ -320,18 +482,61 @@ err_t channel_manager_send_to_channel(channel_manager_t* manager, const str_t* c
     return ERR_NOT_FOUND;
 }
 
+err_t channel_manager_flush(channel_manager_t* manager, uint32_t timeout_ms) {
+    if (!manager) return ERR_INVALID_ARGUMENT;
+
+    // Every outbox already sends in parallel; one deadline covers them all
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err_t last_error = ERR_OK;
+    for (uint32_t i = 0; i < manager->channel_count; i++) {
+        if (!manager->outboxes[i]) continue;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t elapsed_ms = (int64_t)(now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        uint32_t left = elapsed_ms < (int64_t)timeout_ms ? (uint32_t)((int64_t)timeout_ms - elapsed_ms) : 0;
+        err_t err = channel_outbox_flush(manager->outboxes[i], left);
+        if (err != ERR_OK) last_error = err;
+    }
+
+    return last_error;
+}
+
+err_t channel_manager_get_delivery_stats(channel_manager_t* manager, const str_t* channel_name,
+                                         channel_delivery_stats_t* out_stats) {
+    if (!manager || !channel_name || !out_stats) return ERR_INVALID_ARGUMENT;
+
+    for (uint32_t i = 0; i < manager->channel_count; i++) {
+        if (str_equal(manager->channels[i]->config.name, *channel_name)) {
+            channel_outbox_get_stats(manager->outboxes[i], out_stats);
+            return ERR_OK;
+        }
+    }
+
+    return ERR_NOT_FOUND;
+}
+
 err_t channel_manager_start_all(channel_manager_t* manager,
                                void (*on_message)(channel_message_t* msg, void* user_data),
                                void* user_data) {
     if (!manager) return ERR_INVALID_ARGUMENT;
 
+    if (manager->workers > 0 && !manager->inbox) {
+        err_t err = channel_inbox_create(manager->workers, manager->queue_capacity,
+                                         on_message, user_data, &manager->inbox);
+        if (err != ERR_OK) return err;
+    }
+
     err_t last_error = ERR_OK;
 
     for (uint32_t i = 0; i < manager->channel_count; i++) {
         channel_t* channel = manager->channels[i];
         if (channel->initialized && !channel->listening && channel->vtable->start_listening) {
+            channel->inbox = manager->inbox;
             err_t err = channel->vtable->start_listening(channel, on_message, user_data);
             if (err != ERR_OK) {
+                channel->inbox = NULL;
                 last_error = err;
                 // Continue trying other channels
             } else {
@@ -361,5 +566,50 @@ err_t channel_manager_stop_all(channel_manager_t* manager) {
         }
     }
 
+    // Producers are gone once every listener stopped; workers drain the rest
+    bool producers_left = false;
+    for (uint32_t i = 0; i < manager->channel_count; i++) {
+        channel_t* channel = manager->channels[i];
+        if (channel->listening) {
+            producers_left = true;
+        } else {
+            channel->inbox = NULL;
+        }
+    }
+    if (manager->inbox && !producers_left) {
+        uint64_t accepted = 0, rejected = 0;
+        channel_inbox_get_stats(manager->inbox, &accepted, &rejected);
+        manager->accepted += accepted;
+        manager->rejected += rejected;
+        channel_inbox_destroy(manager->inbox);
+        manager->inbox = NULL;
+    }
+
     return last_error;
+}
+
+err_t channel_manager_set_workers(channel_manager_t* manager, uint32_t workers, uint32_t queue_capacity) {
+    if (!manager) return ERR_INVALID_ARGUMENT;
+    if (manager->inbox) return ERR_INVALID_STATE;
+
+    manager->workers = workers;
+    manager->queue_capacity = queue_capacity;
+    return ERR_OK;
+}
+
+void channel_manager_get_queue_stats(channel_manager_t* manager, uint64_t* accepted, uint64_t* rejected) {
+    uint64_t live_accepted = 0, live_rejected = 0;
+    if (manager) channel_inbox_get_stats(manager->inbox, &live_accepted, &live_rejected);
+    if (accepted) *accepted = manager ? manager->accepted + live_accepted : 0;
+    if (rejected) *rejected = manager ? manager->rejected + live_rejected : 0;
+}
+
+err_t channel_manager_set_outbox(channel_manager_t* manager, uint32_t capacity, uint32_t window_ms) {
+    if (!manager) return ERR_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&manager->outbox_lock);
+    manager->outbox_capacity = capacity;
+    manager->outbox_window_ms = window_ms;
+    pthread_mutex_unlock(&manager->outbox_lock);
+    return ERR_OK;
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include <errno.h>
 #include <pthread.h>
 
+// Retry interval while the inbound queue is full
+#define CLI_BACKPRESSURE_DELAY_US 10000
+
 // CLI channel instance data
 typedef struct cli_channel_t {
     pthread_t listener_thread;      // Thread for listening to stdin
@@ -124,8 +127,11 @@ static void* cli_listener_thread(void* arg) {
                     }
 
                     channel_message_t* msg = channel_message_create(NULL, &sender, &content, &channel_name);
-                    if (msg && cli_data->on_message_callback) {
-                        cli_data->on_message_callback(msg, cli_data->user_data);
+                    // Stop reading stdin while the inbound queue is full
+                    while (msg && !cli_data->stop_listening &&
+                           channel_deliver(channel, msg, cli_data->on_message_callback,
+                                           cli_data->user_data) == ERR_CHANNEL_RATE_LIMIT) {
+                        usleep(CLI_BACKPRESSURE_DELAY_US);
                     }
                     channel_message_free(msg);
                 }
@@ -0,0 +1,254 @@
+// inbox.c - Bounded inbound message queue between channels and agent workers
+// SPDX-License-Identifier: MIT
+
+#include "core/channel.h"
+#include "core/alloc.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+
+// One slot of a bounded MPSC ring. `seq` equals the enqueue position when
+// the slot is free and position + 1 once a message was published in it.
+typedef struct inbox_slot_t {
+    uint64_t seq;
+    channel_message_t* msg;
+} inbox_slot_t;
+
+// Each worker drains its own ring, so all messages of a sender (hashed to
+// one ring) are handled in arrival order by a single thread
+typedef struct inbox_ring_t {
+    channel_inbox_t* inbox;
+    inbox_slot_t* slots;
+    uint64_t mask;
+    uint64_t enqueue_pos;      // Shared by producers, advanced by CAS
+    uint64_t dequeue_pos;      // Owned by the worker
+    sem_t ready;               // One post per published message, plus stop
+    pthread_t thread;
+    bool started;
+} inbox_ring_t;
+
+struct channel_inbox_t {
+    inbox_ring_t* rings;
+    uint32_t ring_count;
+    void (*on_message)(channel_message_t* msg, void* user_data);
+    void* user_data;
+    bool stopping;
+    metric_t* depth;           // Queued messages across all rings
+
+    // Statistics
+    uint64_t accepted;
+    uint64_t rejected;
+};
+
+uint32_t channel_route_hash(const str_t* channel, const str_t* sender) {
+    // FNV-1a over channel and sender
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; channel && i < channel->len; i++) h = (h ^ (uint8_t)channel->data[i]) * 16777619u;
+    h = (h ^ 0xFF) * 16777619u;
+    for (uint32_t i = 0; sender && i < sender->len; i++) h = (h ^ (uint8_t)sender->data[i]) * 16777619u;
+    return h;
+}
+
+static bool ring_push(inbox_ring_t* ring, channel_message_t* msg) {
+    uint64_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        inbox_slot_t* slot = &ring->slots[pos & ring->mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->msg = msg;
+                __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;  // Full: the worker has not freed this slot yet
+        } else {
+            pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static channel_message_t* ring_pop(inbox_ring_t* ring) {
+    inbox_slot_t* slot = &ring->slots[ring->dequeue_pos & ring->mask];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq != ring->dequeue_pos + 1) return NULL;
+
+    channel_message_t* msg = slot->msg;
+    slot->msg = NULL;
+    __atomic_store_n(&slot->seq, ring->dequeue_pos + ring->mask + 1, __ATOMIC_RELEASE);
+    ring->dequeue_pos++;
+    return msg;
+}
+
+// What a queued copy holds, accounted to ALLOC_TAG_CHANNEL until it is freed
+static size_t inbox_message_bytes(const channel_message_t* msg) {
+    return sizeof(channel_message_t) + msg->id.len + msg->sender.len + msg->content.len + msg->channel.len;
+}
+
+static void* inbox_worker(void* arg) {
+    inbox_ring_t* ring = (inbox_ring_t*)arg;
+    channel_inbox_t* inbox = ring->inbox;
+
+    for (;;) {
+        while (sem_wait(&ring->ready) != 0 && errno == EINTR) {}
+
+        // Stopping is set once every producer is gone, so reading it before
+        // the drain guarantees nothing published is left behind
+        bool stopping = __atomic_load_n(&inbox->stopping, __ATOMIC_ACQUIRE);
+
+        // A post can arrive before an earlier slot is published; draining
+        // everything visible makes the later post pick it up
+        channel_message_t* msg;
+        while ((msg = ring_pop(ring)) != NULL) {
+            metric_gauge_add(inbox->depth, -1);
+            trace_context_t saved;
+            trace_context_enter(&msg->trace, &saved);
+            if (inbox->on_message) inbox->on_message(msg, inbox->user_data);
+            trace_context_leave(&saved);
+            alloc_tag_sub(ALLOC_TAG_CHANNEL, inbox_message_bytes(msg));
+            channel_message_free(msg);
+        }
+        if (stopping) break;
+    }
+    return NULL;
+}
+
+static uint64_t round_pow2(uint64_t n) {
+    uint64_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+err_t channel_inbox_create(uint32_t workers, uint32_t capacity,
+                           void (*on_message)(channel_message_t* msg, void* user_data),
+                           void* user_data, channel_inbox_t** out_inbox) {
+    if (workers == 0 || !out_inbox) return ERR_INVALID_ARGUMENT;
+    if (capacity == 0) capacity = CHANNEL_INBOX_DEFAULT_CAPACITY;
+
+    channel_inbox_t* inbox = calloc(1, sizeof(channel_inbox_t));
+    if (!inbox) return ERR_OUT_OF_MEMORY;
+    inbox->on_message = on_message;
+    inbox->user_data = user_data;
+    inbox->depth = metric_get(&METRIC_CHANNEL_QUEUE_DEPTH, STR_NULL, STR_NULL);
+
+    inbox->rings = calloc(workers, sizeof(inbox_ring_t));
+    if (!inbox->rings) {
+        free(inbox);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint64_t slots = round_pow2((capacity + workers - 1) / workers);
+    err_t err = ERR_OK;
+    for (uint32_t i = 0; i < workers && err == ERR_OK; i++) {
+        inbox_ring_t* ring = &inbox->rings[i];
+        ring->inbox = inbox;
+        ring->mask = slots - 1;
+        ring->slots = calloc(slots, sizeof(inbox_slot_t));
+        if (!ring->slots) {
+            err = ERR_OUT_OF_MEMORY;
+            break;
+        }
+        for (uint64_t s = 0; s < slots; s++) ring->slots[s].seq = s;
+        sem_init(&ring->ready, 0, 0);
+        inbox->ring_count++;
+
+        if (pthread_create(&ring->thread, NULL, inbox_worker, ring) != 0) {
+            err = ERR_RUNTIME;
+            break;
+        }
+        ring->started = true;
+    }
+
+    if (err != ERR_OK) {
+        channel_inbox_destroy(inbox);
+        return err;
+    }
+
+    *out_inbox = inbox;
+    return ERR_OK;
+}
+
+void channel_inbox_destroy(channel_inbox_t* inbox) {
+    if (!inbox) return;
+
+    // Callers detach every producer first; workers finish what is queued
+    __atomic_store_n(&inbox->stopping, true, __ATOMIC_RELEASE);
+    for (uint32_t i = 0; i < inbox->ring_count; i++) {
+        inbox_ring_t* ring = &inbox->rings[i];
+        if (!ring->started) continue;
+        sem_post(&ring->ready);
+        pthread_join(ring->thread, NULL);
+    }
+
+    for (uint32_t i = 0; i < inbox->ring_count; i++) {
+        inbox_ring_t* ring = &inbox->rings[i];
+        channel_message_t* msg;
+        while ((msg = ring_pop(ring)) != NULL) {
+            metric_gauge_add(inbox->depth, -1);
+            alloc_tag_sub(ALLOC_TAG_CHANNEL, inbox_message_bytes(msg));
+            channel_message_free(msg);
+        }
+        sem_destroy(&ring->ready);
+        free(ring->slots);
+    }
+    free(inbox->rings);
+    free(inbox);
+}
+
+err_t channel_inbox_push(channel_inbox_t* inbox, const channel_message_t* msg) {
+    if (!inbox || !msg) return ERR_INVALID_ARGUMENT;
+
+    channel_message_t* copy = channel_message_create(&msg->id, &msg->sender, &msg->content, &msg->channel);
+    if (!copy) return ERR_OUT_OF_MEMORY;
+    if (msg->timestamp) copy->timestamp = msg->timestamp;
+    copy->trace = msg->trace;
+
+    inbox_ring_t* ring = &inbox->rings[channel_route_hash(&msg->channel, &msg->sender) % inbox->ring_count];
+    // Counted before publishing so the worker never takes the gauge negative
+    size_t bytes = inbox_message_bytes(copy);
+    metric_gauge_add(inbox->depth, 1);
+    alloc_tag_add(ALLOC_TAG_CHANNEL, bytes);
+    if (!ring_push(ring, copy)) {
+        metric_gauge_add(inbox->depth, -1);
+        alloc_tag_sub(ALLOC_TAG_CHANNEL, bytes);
+        channel_message_free(copy);
+        __atomic_fetch_add(&inbox->rejected, 1, __ATOMIC_RELAXED);
+        return ERR_CHANNEL_RATE_LIMIT;
+    }
+
+    __atomic_fetch_add(&inbox->accepted, 1, __ATOMIC_RELAXED);
+    sem_post(&ring->ready);
+    return ERR_OK;
+}
+
+void channel_inbox_get_stats(channel_inbox_t* inbox, uint64_t* accepted, uint64_t* rejected) {
+    if (accepted) *accepted = inbox ? __atomic_load_n(&inbox->accepted, __ATOMIC_RELAXED) : 0;
+    if (rejected) *rejected = inbox ? __atomic_load_n(&inbox->rejected, __ATOMIC_RELAXED) : 0;
+}
+
+err_t channel_deliver(channel_t* channel, channel_message_t* msg,
+                      void (*on_message)(channel_message_t* msg, void* user_data),
+                      void* user_data) {
+    if (!channel || !msg) return ERR_INVALID_ARGUMENT;
+
+    // The message starts a trace; a queued one carries it to the worker
+    TRACE_ROOT(span, "channel.deliver");
+    TRACE_DETAIL(span, channel->config.name);
+    msg->trace = trace_context_current();
+
+    err_t err = ERR_OK;
+    if (channel->inbox) {
+        err = channel_inbox_push(channel->inbox, msg);
+    } else if (on_message) {
+        on_message(msg, user_data);
+    }
+
+    TRACE_END(span);
+    return err;
+}
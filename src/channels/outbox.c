@@ -0,0 +1,254 @@
+// outbox.c - Per-channel outbound queue with message merging
+// SPDX-License-Identifier: MIT
+
+#include "core/channel.h"
+#include "core/alloc.h"
+#include "core/trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+// One pending send; merged messages share its text
+typedef struct outbox_entry_t {
+    struct outbox_entry_t* next;
+    str_t recipient;           // STR_NULL = the channel's default
+    char* text;
+    uint32_t len;
+    uint32_t cap;
+    uint32_t messages;         // Messages joined into text
+    struct timespec due;       // End of the merge window (realtime)
+} outbox_entry_t;
+
+struct channel_outbox_t {
+    channel_t* channel;
+    uint32_t capacity;
+    uint32_t window_ms;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;    // Queued, attempted, flushing or stopping
+    outbox_entry_t* head;
+    outbox_entry_t* tail;
+    uint32_t entries;
+    uint32_t flushing;         // Callers in flush: skip the window
+    bool stopping;
+    channel_delivery_stats_t stats;
+};
+
+// What an entry holds, accounted to ALLOC_TAG_CHANNEL until it is freed
+static size_t entry_bytes(const outbox_entry_t* entry) {
+    return sizeof(outbox_entry_t) + entry->cap + entry->recipient.len;
+}
+
+static void entry_free(outbox_entry_t* entry) {
+    alloc_tag_sub(ALLOC_TAG_CHANNEL, entry_bytes(entry));
+    free((void*)entry->recipient.data);
+    free(entry->text);
+    free(entry);
+}
+
+static struct timespec now_after(uint32_t ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static bool window_open(const struct timespec* due) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec < due->tv_sec || (now.tv_sec == due->tv_sec && now.tv_nsec < due->tv_nsec);
+}
+
+static bool same_recipient(const outbox_entry_t* entry, const str_t* recipient) {
+    str_t other = recipient ? *recipient : STR_NULL;
+    return entry->recipient.len == other.len &&
+           (other.len == 0 || memcmp(entry->recipient.data, other.data, other.len) == 0);
+}
+
+static void* outbox_main(void* arg) {
+    channel_outbox_t* outbox = (channel_outbox_t*)arg;
+    channel_t* channel = outbox->channel;
+
+    pthread_mutex_lock(&outbox->lock);
+    for (;;) {
+        outbox_entry_t* entry = outbox->head;
+        if (!entry) {
+            if (outbox->stopping) break;
+            pthread_cond_wait(&outbox->changed, &outbox->lock);
+            continue;
+        }
+        // Leave the entry open to merges until its window closes
+        if (!outbox->stopping && !outbox->flushing && window_open(&entry->due)) {
+            pthread_cond_timedwait(&outbox->changed, &outbox->lock, &entry->due);
+            continue;
+        }
+
+        outbox->head = entry->next;
+        if (!outbox->head) outbox->tail = NULL;
+        outbox->entries--;
+        pthread_mutex_unlock(&outbox->lock);
+
+        TRACE_BEGIN(span, "channel.send");
+        TRACE_DETAIL(span, channel->config.name);
+        str_t text = { .data = entry->text, .len = entry->len };
+        err_t err = channel->vtable->send(channel, &text, str_empty(entry->recipient) ? NULL : &entry->recipient);
+        TRACE_END(span);
+
+        pthread_mutex_lock(&outbox->lock);
+        outbox->stats.sends++;
+        if (err == ERR_OK) outbox->stats.delivered += entry->messages;
+        else outbox->stats.failed += entry->messages;
+        outbox->stats.pending -= entry->messages;
+        pthread_cond_broadcast(&outbox->changed);
+        entry_free(entry);
+    }
+    pthread_mutex_unlock(&outbox->lock);
+    return NULL;
+}
+
+err_t channel_outbox_create(channel_t* channel, uint32_t capacity, uint32_t window_ms,
+                            channel_outbox_t** out_outbox) {
+    if (!channel || !channel->vtable || !channel->vtable->send || !out_outbox) return ERR_INVALID_ARGUMENT;
+
+    channel_outbox_t* outbox = calloc(1, sizeof(channel_outbox_t));
+    if (!outbox) return ERR_OUT_OF_MEMORY;
+    outbox->channel = channel;
+    outbox->capacity = capacity ? capacity : CHANNEL_OUTBOX_DEFAULT_CAPACITY;
+    outbox->window_ms = window_ms;
+    pthread_mutex_init(&outbox->lock, NULL);
+    pthread_cond_init(&outbox->changed, NULL);
+
+    if (pthread_create(&outbox->thread, NULL, outbox_main, outbox) != 0) {
+        pthread_cond_destroy(&outbox->changed);
+        pthread_mutex_destroy(&outbox->lock);
+        free(outbox);
+        return ERR_RUNTIME;
+    }
+
+    *out_outbox = outbox;
+    return ERR_OK;
+}
+
+void channel_outbox_destroy(channel_outbox_t* outbox) {
+    if (!outbox) return;
+
+    pthread_mutex_lock(&outbox->lock);
+    outbox->stopping = true;
+    pthread_cond_broadcast(&outbox->changed);
+    pthread_mutex_unlock(&outbox->lock);
+    pthread_join(outbox->thread, NULL);
+
+    pthread_cond_destroy(&outbox->changed);
+    pthread_mutex_destroy(&outbox->lock);
+    free(outbox);
+}
+
+// Caller holds outbox->lock. Joins message onto the newest entry when it
+// is for the same recipient and the result stays short.
+static bool outbox_merge(channel_outbox_t* outbox, const str_t* recipient, const str_t* message) {
+    outbox_entry_t* tail = outbox->tail;
+    if (!tail || !same_recipient(tail, recipient)) return false;
+
+    // Entries that start short are allocated to the merge limit
+    size_t len = (size_t)tail->len + 1 + message->len;
+    if (len > CHANNEL_OUTBOX_MERGE_MAX_BYTES || len + 1 > tail->cap) return false;
+
+    tail->text[tail->len++] = '\n';
+    memcpy(tail->text + tail->len, message->data, message->len);
+    tail->len += message->len;
+    tail->text[tail->len] = '\0';
+    tail->messages++;
+    return true;
+}
+
+// A short first message gets room for later ones to join it
+static outbox_entry_t* entry_create(const str_t* recipient, const str_t* message) {
+    outbox_entry_t* entry = calloc(1, sizeof(outbox_entry_t));
+    if (!entry) return NULL;
+    entry->cap = message->len < CHANNEL_OUTBOX_MERGE_MAX_BYTES ? CHANNEL_OUTBOX_MERGE_MAX_BYTES + 1 : message->len + 1;
+    entry->text = malloc(entry->cap);
+    bool named = recipient && !str_empty(*recipient);
+    if (named) entry->recipient = str_dup(*recipient, NULL);
+    if (!entry->text || (named && !entry->recipient.data)) {
+        free((void*)entry->recipient.data);
+        free(entry->text);
+        free(entry);
+        return NULL;
+    }
+
+    if (message->len) memcpy(entry->text, message->data, message->len);
+    entry->len = message->len;
+    entry->text[entry->len] = '\0';
+    entry->messages = 1;
+    alloc_tag_add(ALLOC_TAG_CHANNEL, entry_bytes(entry));
+    return entry;
+}
+
+err_t channel_outbox_push(channel_outbox_t* outbox, const str_t* recipient, const str_t* message) {
+    if (!outbox || !message) return ERR_INVALID_ARGUMENT;
+
+    err_t err = ERR_OK;
+    pthread_mutex_lock(&outbox->lock);
+    if (outbox->stopping) {
+        err = ERR_INVALID_STATE;
+    } else if (!outbox_merge(outbox, recipient, message)) {
+        outbox_entry_t* entry = NULL;
+        if (outbox->entries >= outbox->capacity) {
+            outbox->stats.rejected++;
+            err = ERR_CHANNEL_RATE_LIMIT;
+        } else if (!(entry = entry_create(recipient, message))) {
+            err = ERR_OUT_OF_MEMORY;
+        } else {
+            entry->due = now_after(outbox->window_ms);
+            if (outbox->tail) outbox->tail->next = entry;
+            else outbox->head = entry;
+            outbox->tail = entry;
+            outbox->entries++;
+            pthread_cond_broadcast(&outbox->changed);
+        }
+    }
+    if (err == ERR_OK) {
+        outbox->stats.accepted++;
+        outbox->stats.pending++;
+    }
+    pthread_mutex_unlock(&outbox->lock);
+    return err;
+}
+
+err_t channel_outbox_flush(channel_outbox_t* outbox, uint32_t timeout_ms) {
+    if (!outbox) return ERR_INVALID_ARGUMENT;
+
+    struct timespec deadline = now_after(timeout_ms);
+    err_t err = ERR_OK;
+    pthread_mutex_lock(&outbox->lock);
+    outbox->flushing++;
+    pthread_cond_broadcast(&outbox->changed);
+    while (outbox->stats.pending > 0 && err == ERR_OK) {
+        if (pthread_cond_timedwait(&outbox->changed, &outbox->lock, &deadline) == ETIMEDOUT &&
+            outbox->stats.pending > 0) {
+            err = ERR_TIMEOUT;
+        }
+    }
+    outbox->flushing--;
+    pthread_mutex_unlock(&outbox->lock);
+    return err;
+}
+
+void channel_outbox_get_stats(channel_outbox_t* outbox, channel_delivery_stats_t* out_stats) {
+    if (!out_stats) return;
+    if (!outbox) {
+        *out_stats = (channel_delivery_stats_t){0};
+        return;
+    }
+
+    pthread_mutex_lock(&outbox->lock);
+    *out_stats = outbox->stats;
+    pthread_mutex_unlock(&outbox->lock);
+}
@@ -4,6 +4,7 @@
 #include "core/channel.h"
 #include "utils/http.h"
 #include "json_config.h"
+#include "utils/json_writer.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -11,6 +12,20 @@
 #include <time.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <errno.h>
+
+#define TELEGRAM_POLL_TIMEOUT_SECS 30
+#define TELEGRAM_BACKPRESSURE_DELAY_MS 1000
+#define TELEGRAM_SEND_ATTEMPTS 3
+#define TELEGRAM_CHAT_SLOTS 256
+#define TELEGRAM_GLOBAL_INTERVAL_MS 34     // ~30 messages per second
+#define TELEGRAM_CHAT_INTERVAL_MS 1000
+#define TELEGRAM_GROUP_INTERVAL_MS 3000    // 20 messages per minute
+#define TELEGRAM_MAX_TEXT 4096             // sendMessage text limit
+
+typedef struct telegram_chat_slot_t {
+    uint64_t next_ms;       // Earliest monotonic time of the next send
+} telegram_chat_slot_t;
 
 // Telegram channel instance data
 typedef struct telegram_channel_t {
@@ -18,12 +33,22 @@ typedef struct telegram_channel_t {
     str_t bot_token;        // Telegram bot token
     str_t base_url;         // Telegram API base URL
 
-    // HTTP client
-    http_client_t* http_client;
+    // HTTP clients: one long-poll connection, a pool for replies
+    http_client_t* poll_client;
+    http_client_t* send_client;
 
     // Thread management
     pthread_t listener_thread;      // Thread for long polling
     bool stop_listening;            // Flag to stop the listener thread
+    pthread_mutex_t stop_lock;      // Lets backoff waits end early on stop
+    pthread_cond_t stop_cond;
+    uint64_t initial_backoff_ms;
+    uint64_t max_backoff_ms;
+
+    // Outbound rate limiting
+    pthread_mutex_t send_lock;
+    uint64_t send_next_ms;
+    telegram_chat_slot_t chat_slots[TELEGRAM_CHAT_SLOTS];
     void (*on_message_callback)(channel_message_t* msg, void* user_data);
     void* user_data;
 
@@ -52,9 +77,9 @@ static bool telegram_is_listening(channel_t* channel);
 static err_t telegram_health_check(channel_t* channel, bool* out_healthy);
 static err_t telegram_get_stats(channel_t* channel, uint32_t* messages_sent,
                               uint32_t* messages_received, uint32_t* active_connections);
-
-// Helper functions
-static err_t fetch_telegram_updates(telegram_channel_t* tg, uint32_t timeout_seconds);
+static err_t telegram_stream_begin(channel_t* channel, channel_stream_t* stream);
+static err_t telegram_stream_append(channel_t* channel, channel_stream_t* stream, const str_t* delta);
+static err_t telegram_stream_end(channel_t* channel, channel_stream_t* stream);
 
 // VTable definition
 static const channel_vtable_t telegram_vtable = {
@@ -71,7 +96,10 @@ static const channel_vtable_t telegram_vtable = {
     .stop_listening = telegram_stop_listening,
     .is_listening = telegram_is_listening,
     .health_check = telegram_health_check,
-    .get_stats = telegram_get_stats
+    .get_stats = telegram_get_stats,
+    .stream_begin = telegram_stream_begin,
+    .stream_append = telegram_stream_append,
+    .stream_end = telegram_stream_end
 };
 
 // Get vtable
@@ -175,72 +203,88 @@ static err_t parse_telegram_update(json_value_t* update, channel_message_t* out_
     return ERR_OK;
 }
 
-// Listener thread function for Telegram long polling
+// Wait up to ms unless stop_listening is signalled first
+static void listener_wait(telegram_channel_t* tg, uint64_t ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(ms / 1000);
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&tg->stop_lock);
+    while (!tg->stop_listening) {
+        if (pthread_cond_timedwait(&tg->stop_cond, &tg->stop_lock, &deadline) != 0) break;
+    }
+    pthread_mutex_unlock(&tg->stop_lock);
+}
+
+// Sleep for the current backoff (at least retry_after_secs) and double it
+static void listener_backoff(telegram_channel_t* tg, uint64_t* backoff_ms, uint64_t retry_after_secs) {
+    uint64_t wait_ms = *backoff_ms;
+    if (retry_after_secs * 1000 > wait_ms) wait_ms = retry_after_secs * 1000;
+    listener_wait(tg, wait_ms);
+
+    *backoff_ms *= 2;
+    if (*backoff_ms > tg->max_backoff_ms) *backoff_ms = tg->max_backoff_ms;
+}
+
+// parameters.retry_after of a Telegram error reply (0 if absent)
+static uint64_t telegram_retry_after(json_value_t* root) {
+    if (!root || root->type != JSON_OBJECT) return 0;
+    json_value_t* params = json_object_get(root->object, "parameters");
+    if (!params || params->type != JSON_OBJECT) return 0;
+    json_value_t* retry = json_object_get(params->object, "retry_after");
+    return retry && retry->type == JSON_NUMBER && retry->number > 0 ? (uint64_t)retry->number : 0;
+}
+
+// result.message_id of a sendMessage reply (0 if absent)
+static int64_t telegram_result_message_id(json_value_t* root) {
+    if (!root || root->type != JSON_OBJECT) return 0;
+    json_value_t* result = json_object_get(root->object, "result");
+    if (!result || result->type != JSON_OBJECT) return 0;
+    json_value_t* id = json_object_get(result->object, "message_id");
+    return id && id->type == JSON_NUMBER ? (int64_t)id->number : 0;
+}
+
+// Listener thread function for Telegram long polling. getUpdates runs on
+// its own single keep-alive connection and the next poll goes out as soon
+// as a batch is handed off, so replies never sit in front of it.
 static void* telegram_listener_thread(void* arg) {
     channel_t* channel = (channel_t*)arg;
     telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
 
-    const uint32_t POLL_TIMEOUT = 30; // seconds
-    const uint32_t ERROR_RETRY_DELAY = 5; // seconds
+    uint64_t backoff_ms = tg_data->initial_backoff_ms;
 
-    while (!tg_data->stop_listening) {
-        // Build URL for getUpdates method
-        str_t url = build_telegram_url(tg_data, "getUpdates");
-        if (str_empty(url)) {
-            // Sleep and retry
-            sleep(ERROR_RETRY_DELAY);
-            continue;
-        }
+    str_t url = build_telegram_url(tg_data, "getUpdates");
+    if (str_empty(url)) return NULL;
 
-        // Build query parameters
-        char query[256];
-        snprintf(query, sizeof(query), "?timeout=%u&offset=%u",
-                POLL_TIMEOUT, tg_data->last_update_id + 1);
-
-        // Append query to URL
+    while (!__atomic_load_n(&tg_data->stop_listening, __ATOMIC_ACQUIRE)) {
         char full_url[768];
-        snprintf(full_url, sizeof(full_url), "%.*s%s",
-                (int)url.len, url.data, query);
-        free((void*)url.data);
+        snprintf(full_url, sizeof(full_url), "%.*s?timeout=%u&offset=%u",
+                 (int)url.len, url.data, TELEGRAM_POLL_TIMEOUT_SECS, tg_data->last_update_id + 1);
 
-        // Send HTTP GET request
         http_response_t* response = NULL;
-        err_t err = http_get(tg_data->http_client, full_url, &response);
-
-        if (err != ERR_OK) {
-            // Network error, sleep and retry
-            sleep(ERROR_RETRY_DELAY);
-            continue;
-        }
-
-        if (!response || !http_response_is_success(response)) {
-            if (response) {
-                http_response_free(response);
-            }
-            sleep(ERROR_RETRY_DELAY);
-            continue;
-        }
-
-        // Parse JSON response
-        char* response_body = (char*)response->body.data;
-        size_t body_len = response->body.len;
-        char* body_copy = malloc(body_len + 1);
-        if (!body_copy) {
-            http_response_free(response);
-            sleep(ERROR_RETRY_DELAY);
+        err_t err = http_get(tg_data->poll_client, full_url, &response);
+        if (err != ERR_OK || !response) {
+            // Network error
+            listener_backoff(tg_data, &backoff_ms, 0);
             continue;
         }
-        memcpy(body_copy, response_body, body_len);
-        body_copy[body_len] = '\0';
 
-        json_value_t* root = json_parse(body_copy);
+        json_value_t* root = json_parse_len(response->body.data, response->body.len);
+        bool success = http_response_is_success(response);
         http_response_free(response);
 
-        if (!root || root->type != JSON_OBJECT) {
-            free(body_copy);
-            sleep(ERROR_RETRY_DELAY);
+        if (!success || !root || root->type != JSON_OBJECT) {
+            // 429 carries retry_after when Telegram wants us to slow down
+            listener_backoff(tg_data, &backoff_ms, telegram_retry_after(root));
+            if (root) json_free(root);
             continue;
         }
+        backoff_ms = tg_data->initial_backoff_ms;
 
         // Get updates array
         json_value_t* result_val = json_object_get(root->object, "result");
@@ -248,19 +292,28 @@ static void* telegram_listener_thread(void* arg) {
             json_array_t* array = result_val->array;
             uint32_t update_count = 0;
             uint32_t highest_update_id = tg_data->last_update_id;
+            bool backpressure = false;
 
             // Process each update
-            while (array) {
+            size_t array_len = json_array_length(array);
+            for (size_t i = 0; i < array_len; i++) {
                 channel_message_t msg = {0};
-                err_t parse_err = parse_telegram_update(&array->value, &msg);
+                err_t parse_err = parse_telegram_update(json_array_get(array, i), &msg);
 
                 if (parse_err == ERR_OK) {
-                    tg_data->messages_received++;
-
-                    // Call callback if set
-                    if (tg_data->on_message_callback) {
-                        tg_data->on_message_callback(&msg, tg_data->user_data);
+                    // With the inbound queue full, hold the offset at the
+                    // last accepted update so Telegram redelivers the rest
+                    err_t deliver_err = channel_deliver(channel, &msg, tg_data->on_message_callback,
+                                                        tg_data->user_data);
+                    if (deliver_err != ERR_OK) {
+                        free((void*)msg.id.data);
+                        free((void*)msg.sender.data);
+                        free((void*)msg.content.data);
+                        free((void*)msg.channel.data);
+                        backpressure = true;
+                        break;
                     }
+                    __atomic_fetch_add(&tg_data->messages_received, 1, __ATOMIC_RELAXED);
 
                     // Update highest update_id
                     // Extract update_id from message ID (format: tg_123456)
@@ -280,7 +333,6 @@ static void* telegram_listener_thread(void* arg) {
                     free((void*)msg.channel.data);
                 }
 
-                array = array->next;
                 update_count++;
             }
 
@@ -288,17 +340,70 @@ static void* telegram_listener_thread(void* arg) {
             if (update_count > 0 && highest_update_id > tg_data->last_update_id) {
                 tg_data->last_update_id = highest_update_id;
             }
+            if (backpressure) listener_wait(tg_data, TELEGRAM_BACKPRESSURE_DELAY_MS);
         }
 
         json_free(root);
-        free(body_copy);
 
         // If no updates were received (long poll timeout), loop continues
     }
 
+    free((void*)url.data);
     return NULL;
 }
 
+// ============================================================================
+// Outbound Rate Limiting
+// ============================================================================
+
+// Telegram allows about 30 messages per second per bot, one per second in
+// a private chat and 20 per minute in a group (negative chat ids). Each
+// send reserves the next free instant for its chat and for the bot, then
+// sleeps until it, so concurrent senders go out in reservation order.
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static telegram_chat_slot_t* chat_slot(telegram_channel_t* tg, const str_t* chat_id) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < chat_id->len; i++) h = (h ^ (uint8_t)chat_id->data[i]) * 16777619u;
+    return &tg->chat_slots[h % TELEGRAM_CHAT_SLOTS];
+}
+
+// Milliseconds to wait before this send may go out
+static uint64_t send_reserve(telegram_channel_t* tg, const str_t* chat_id) {
+    bool group = chat_id->len > 0 && chat_id->data[0] == '-';
+
+    pthread_mutex_lock(&tg->send_lock);
+    // Two chats sharing a slot throttle each other, which errs on the safe side
+    telegram_chat_slot_t* slot = chat_slot(tg, chat_id);
+    uint64_t now = monotonic_ms();
+    uint64_t at = now > tg->send_next_ms ? now : tg->send_next_ms;
+    if (slot->next_ms > at) at = slot->next_ms;
+
+    tg->send_next_ms = at + TELEGRAM_GLOBAL_INTERVAL_MS;
+    slot->next_ms = at + (group ? TELEGRAM_GROUP_INTERVAL_MS : TELEGRAM_CHAT_INTERVAL_MS);
+    pthread_mutex_unlock(&tg->send_lock);
+
+    return at - now;
+}
+
+// Push a chat's next slot back after Telegram answered 429
+static void send_defer(telegram_channel_t* tg, const str_t* chat_id, uint64_t delay_ms) {
+    pthread_mutex_lock(&tg->send_lock);
+    telegram_chat_slot_t* slot = chat_slot(tg, chat_id);
+    uint64_t until = monotonic_ms() + delay_ms;
+    if (slot->next_ms < until) slot->next_ms = until;
+    pthread_mutex_unlock(&tg->send_lock);
+}
+
+static void sleep_ms(uint64_t ms) {
+    struct timespec ts = { .tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
 static str_t telegram_get_name(void) {
     return STR_LIT("telegram");
 }
@@ -326,8 +431,15 @@ static err_t telegram_create(const channel_config_t* config, channel_t** out_cha
     // Initialize telegram data
     tg_data->bot_token = STR_NULL;
     tg_data->base_url = STR_LIT("https://api.telegram.org");
-    tg_data->http_client = NULL;
+    tg_data->poll_client = NULL;
+    tg_data->send_client = NULL;
     tg_data->listener_thread = 0;
+    pthread_mutex_init(&tg_data->stop_lock, NULL);
+    pthread_cond_init(&tg_data->stop_cond, NULL);
+    pthread_mutex_init(&tg_data->send_lock, NULL);
+    tg_data->initial_backoff_ms = (uint64_t)(config->initial_backoff_secs ? config->initial_backoff_secs : 2) * 1000;
+    tg_data->max_backoff_ms = (uint64_t)config->max_backoff_secs * 1000;
+    if (tg_data->max_backoff_ms < tg_data->initial_backoff_ms) tg_data->max_backoff_ms = tg_data->initial_backoff_ms;
     tg_data->stop_listening = true;
     tg_data->on_message_callback = NULL;
     tg_data->user_data = NULL;
@@ -380,6 +492,9 @@ static void telegram_destroy(channel_t* channel) {
     free((void*)channel->config.webhook_url.data);
     free((void*)channel->config.host.data);
 
+    pthread_mutex_destroy(&tg_data->send_lock);
+    pthread_cond_destroy(&tg_data->stop_cond);
+    pthread_mutex_destroy(&tg_data->stop_lock);
     free(tg_data);
     channel->impl_data = NULL;
 
@@ -392,10 +507,20 @@ static err_t telegram_init(channel_t* channel) {
 
     telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
 
-    // Create HTTP client
-    http_client_config_t http_config = http_client_default_config();
-    tg_data->http_client = http_client_create(&http_config);
-    if (!tg_data->http_client) {
+    // The poll connection must outlive a full long-poll interval
+    http_client_config_t poll_config = http_client_default_config();
+    poll_config.timeout_ms = (TELEGRAM_POLL_TIMEOUT_SECS + 10) * 1000;
+    poll_config.pool_size = 1;
+    poll_config.max_connections_per_host = 1;
+    tg_data->poll_client = http_client_create(&poll_config);
+
+    http_client_config_t send_config = http_client_default_config();
+    tg_data->send_client = http_client_create(&send_config);
+    if (!tg_data->poll_client || !tg_data->send_client) {
+        http_client_destroy(tg_data->poll_client);
+        http_client_destroy(tg_data->send_client);
+        tg_data->poll_client = NULL;
+        tg_data->send_client = NULL;
         return ERR_NETWORK;
     }
 
@@ -416,15 +541,94 @@ static void telegram_cleanup(channel_t* channel) {
 
     telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
 
-    // Cleanup HTTP client
-    if (tg_data->http_client) {
-        http_client_destroy(tg_data->http_client);
-        tg_data->http_client = NULL;
-    }
+    // Cleanup HTTP clients
+    http_client_destroy(tg_data->poll_client);
+    http_client_destroy(tg_data->send_client);
+    tg_data->poll_client = NULL;
+    tg_data->send_client = NULL;
 
     channel->initialized = false;
 }
 
+// Incoming messages name their chat "telegram_<id>"
+static str_t telegram_chat_id(const str_t* recipient) {
+    str_t chat_id = *recipient;
+    if (chat_id.len > 9 && memcmp(chat_id.data, "telegram_", 9) == 0) {
+        chat_id.data += 9;
+        chat_id.len -= 9;
+    }
+    return chat_id;
+}
+
+// POST a Bot API method for one chat, honouring the rate limits and flood
+// control. out_message_id (optional) receives result.message_id.
+static err_t telegram_call(telegram_channel_t* tg_data, const char* method, const str_t* chat_id,
+                           const char* payload, int64_t* out_message_id) {
+    str_t url = build_telegram_url(tg_data, method);
+    if (str_empty(url)) {
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    // Replies use their own pooled client, so they never queue behind a poll
+    err_t err = ERR_NETWORK;
+    for (uint32_t attempt = 0; attempt < TELEGRAM_SEND_ATTEMPTS; attempt++) {
+        uint64_t wait_ms = send_reserve(tg_data, chat_id);
+        if (wait_ms) sleep_ms(wait_ms);
+
+        http_response_t* response = NULL;
+        err = http_post_json(tg_data->send_client, url.data, payload, &response);
+        if (err != ERR_OK) break;
+
+        bool success = http_response_is_success(response);
+        bool limited = response->status_code == HTTP_TOO_MANY_REQUESTS;
+        json_value_t* root = NULL;
+        if (limited || (success && out_message_id)) {
+            root = json_parse_len(response->body.data, response->body.len);
+        }
+        http_response_free(response);
+
+        if (success) {
+            if (out_message_id) *out_message_id = telegram_result_message_id(root);
+            if (root) json_free(root);
+            err = ERR_OK;
+            break;
+        }
+
+        // Flood control: wait as long as Telegram asks, then try again
+        uint64_t retry_after = telegram_retry_after(root);
+        if (root) json_free(root);
+
+        err = limited ? ERR_CHANNEL_RATE_LIMIT : ERR_NETWORK;
+        if (!limited) break;
+        send_defer(tg_data, chat_id, (retry_after ? retry_after : 1) * 1000);
+    }
+
+    free((void*)url.data);
+    return err;
+}
+
+// sendMessage, or editMessageText when message_id is set
+static err_t telegram_post_text(telegram_channel_t* tg_data, const str_t* chat_id, const str_t* text,
+                                int64_t message_id, int64_t* out_message_id) {
+    // Build JSON payload; escaped, so any length and content is safe
+    json_writer_t w;
+    json_writer_init(&w, text->len + 96);
+    json_write_object_begin(&w);
+    json_write_kv_str(&w, "chat_id", *chat_id);
+    if (message_id) json_write_kv_int(&w, "message_id", message_id);
+    json_write_kv_str(&w, "text", *text);
+    json_write_object_end(&w);
+    char* payload = json_writer_finish(&w, NULL);
+    if (!payload) {
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    err_t err = telegram_call(tg_data, message_id ? "editMessageText" : "sendMessage",
+                              chat_id, payload, out_message_id);
+    free(payload);
+    return err;
+}
+
 static err_t telegram_send(channel_t* channel, const str_t* message, const str_t* recipient) {
     if (!channel || !channel->impl_data || !channel->initialized || !message) {
         return ERR_INVALID_ARGUMENT;
@@ -437,52 +641,16 @@ static err_t telegram_send(channel_t* channel, const str_t* message, const str_t
         return ERR_CHANNEL; // No bot token configured
     }
 
-    // Build URL for sendMessage method
-    str_t url = build_telegram_url(tg_data, "sendMessage");
-    if (str_empty(url)) {
-        return ERR_OUT_OF_MEMORY;
-    }
-
-    // Build JSON payload
-    char json_buffer[2048];
-    int written;
-    if (recipient && !str_empty(*recipient)) {
-        // Send to specific chat ID
-        written = snprintf(json_buffer, sizeof(json_buffer),
-                          "{\"chat_id\": \"%.*s\", \"text\": \"%.*s\"}",
-                          (int)recipient->len, recipient->data,
-                          (int)message->len, message->data);
-    } else {
+    if (!recipient || str_empty(*recipient)) {
         // No recipient specified - need default chat ID
         // TODO: Use default chat ID from configuration
-        free((void*)url.data);
         return ERR_INVALID_ARGUMENT;
     }
 
-    if (written < 0 || written >= (int)sizeof(json_buffer)) {
-        free((void*)url.data);
-        return ERR_OUT_OF_MEMORY;
-    }
-
-    // Send HTTP POST request
-    http_response_t* response = NULL;
-    err_t err = http_post_json(tg_data->http_client, url.data, json_buffer, &response);
-    free((void*)url.data);
-
-    if (err != ERR_OK) {
-        return err;
-    }
-
-    // Check response status
-    bool success = http_response_is_success(response);
-    http_response_free(response);
-
-    if (success) {
-        tg_data->messages_sent++;
-        return ERR_OK;
-    } else {
-        return ERR_NETWORK;
-    }
+    str_t chat_id = telegram_chat_id(recipient);
+    err_t err = telegram_post_text(tg_data, &chat_id, message, 0, NULL);
+    if (err == ERR_OK) __atomic_fetch_add(&tg_data->messages_sent, 1, __ATOMIC_RELAXED);
+    return err;
 }
 
 static err_t telegram_send_message(channel_t* channel, const channel_message_t* message) {
@@ -495,6 +663,90 @@ static err_t telegram_send_message(channel_t* channel, const channel_message_t*
     return telegram_send(channel, &message->content, &message->sender);
 }
 
+// ============================================================================
+// Streaming Replies
+// ============================================================================
+
+// A streamed reply is sent as soon as there is text and then edited in
+// place, at most once per chat interval so edits stay inside the per-chat
+// limit. Text past TELEGRAM_MAX_TEXT continues in a new message.
+typedef struct telegram_stream_t {
+    str_t chat_id;             // Points into stream->recipient
+    bool group;
+    int64_t message_id;        // Message being edited, 0 before the first send
+    uint32_t offset;           // Start of that message in stream->text
+    uint32_t shown;            // Bytes of it Telegram already shows
+    uint64_t next_edit_ms;
+} telegram_stream_t;
+
+// Longest prefix of at most max bytes that does not split a UTF-8 sequence
+static uint32_t utf8_prefix(const char* text, uint32_t len, uint32_t max) {
+    if (len <= max) return len;
+    uint32_t cut = max;
+    while (cut > 0 && ((unsigned char)text[cut] & 0xC0) == 0x80) cut--;
+    return cut;
+}
+
+static err_t telegram_stream_flush(telegram_channel_t* tg_data, telegram_stream_t* ts,
+                                   channel_stream_t* stream, bool final) {
+    for (;;) {
+        uint32_t len = stream->len - ts->offset;
+        bool full = len > TELEGRAM_MAX_TEXT;
+        if (full) len = utf8_prefix(stream->text + ts->offset, len, TELEGRAM_MAX_TEXT);
+
+        // Intermediate edits wait for the interval; a full message is closed now
+        if (!full && !final && monotonic_ms() < ts->next_edit_ms) return ERR_OK;
+
+        if (len > ts->shown) {
+            str_t text = { .data = stream->text + ts->offset, .len = len };
+            err_t err = telegram_post_text(tg_data, &ts->chat_id, &text, ts->message_id,
+                                           ts->message_id ? NULL : &ts->message_id);
+            if (err != ERR_OK) return err;
+            ts->shown = len;
+            ts->next_edit_ms = monotonic_ms() +
+                               (ts->group ? TELEGRAM_GROUP_INTERVAL_MS : TELEGRAM_CHAT_INTERVAL_MS);
+        }
+        if (!full) return ERR_OK;
+
+        ts->offset += len;
+        ts->message_id = 0;
+        ts->shown = 0;
+    }
+}
+
+static err_t telegram_stream_begin(channel_t* channel, channel_stream_t* stream) {
+    if (!channel || !channel->impl_data || !channel->initialized) return ERR_INVALID_ARGUMENT;
+
+    telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
+    if (str_empty(tg_data->bot_token)) return ERR_CHANNEL;
+    if (str_empty(stream->recipient)) return ERR_INVALID_ARGUMENT;
+
+    telegram_stream_t* ts = calloc(1, sizeof(telegram_stream_t));
+    if (!ts) return ERR_OUT_OF_MEMORY;
+    ts->chat_id = telegram_chat_id(&stream->recipient);
+    ts->group = ts->chat_id.data[0] == '-';
+    stream->impl = ts;
+    return ERR_OK;
+}
+
+static err_t telegram_stream_append(channel_t* channel, channel_stream_t* stream, const str_t* delta) {
+    (void)delta;
+    return telegram_stream_flush((telegram_channel_t*)channel->impl_data,
+                                 (telegram_stream_t*)stream->impl, stream, false);
+}
+
+static err_t telegram_stream_end(channel_t* channel, channel_stream_t* stream) {
+    telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
+    telegram_stream_t* ts = (telegram_stream_t*)stream->impl;
+
+    err_t err = telegram_stream_flush(tg_data, ts, stream, true);
+    if (err == ERR_OK && ts->message_id) __atomic_fetch_add(&tg_data->messages_sent, 1, __ATOMIC_RELAXED);
+
+    free(ts);
+    stream->impl = NULL;
+    return err;
+}
+
 static err_t telegram_start_listening(channel_t* channel,
                                     void (*on_message)(channel_message_t* msg, void* user_data),
                                     void* user_data) {
@@ -540,8 +792,12 @@ static err_t telegram_stop_listening(channel_t* channel) {
         return ERR_OK; // Not listening
     }
 
-    // Signal thread to stop
-    tg_data->stop_listening = true;
+    // Signal thread to stop; a backoff wait ends at once, a poll in
+    // flight returns within the long-poll timeout
+    pthread_mutex_lock(&tg_data->stop_lock);
+    __atomic_store_n(&tg_data->stop_listening, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&tg_data->stop_cond);
+    pthread_mutex_unlock(&tg_data->stop_lock);
 
     // Wait for thread to finish
     if (tg_data->listener_thread) {
@@ -575,7 +831,7 @@ static err_t telegram_health_check(channel_t* channel, bool* out_healthy) {
     telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
 
     // Basic health check: bot token present and HTTP client initialized
-    bool healthy = channel->initialized && tg_data->http_client != NULL &&
+    bool healthy = channel->initialized && tg_data->poll_client != NULL && tg_data->send_client != NULL &&
                    !str_empty(tg_data->bot_token);
 
     *out_healthy = healthy;
@@ -590,8 +846,8 @@ static err_t telegram_get_stats(channel_t* channel, uint32_t* messages_sent,
 
     telegram_channel_t* tg_data = (telegram_channel_t*)channel->impl_data;
 
-    if (messages_sent) *messages_sent = tg_data->messages_sent;
-    if (messages_received) *messages_received = tg_data->messages_received;
+    if (messages_sent) *messages_sent = __atomic_load_n(&tg_data->messages_sent, __ATOMIC_RELAXED);
+    if (messages_received) *messages_received = __atomic_load_n(&tg_data->messages_received, __ATOMIC_RELAXED);
     if (active_connections) *active_connections = tg_data->listening ? 1 : 0;
 
     return ERR_OK;
@@ -2,20 +2,56 @@
 // SPDX-License-Identifier: MIT
 
 #include "core/channel.h"
+#include "core/alloc.h"
 #include "utils/http.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <strings.h>
 #include <time.h>
 #include <sodium.h>
 #include "json_config.h"
+#include "utils/json_writer.h"
 #include <uv.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <errno.h>
+typedef struct webhook_conn_t webhook_conn_t;
+typedef struct webhook_stream_t webhook_stream_t;
+typedef struct webhook_delivery_t webhook_delivery_t;
+// Upper bound on listener_threads
+#define WEBHOOK_MAX_REACTORS 64
+
+typedef struct webhook_channel_t webhook_channel_t;
+
+// One event loop with its own listening socket. With several reactors
+// each binds the port with SO_REUSEPORT and the kernel spreads incoming
+// connections across them; a connection never leaves its reactor.
+typedef struct webhook_reactor_t {
+    webhook_channel_t* owner;
+    uv_loop_t* loop;        // libuv event loop
+    uv_tcp_t server;        // TCP server handle
+    uv_async_t stop_async;  // Wakes the loop to shut down
+    uv_async_t stream_async; // Streamed reply output is queued
+    uv_timer_t sweep_timer; // Closes idle keep-alive connections
+    pthread_t thread;       // Thread for libuv event loop
+    bool running;
+    webhook_conn_t* conns;  // Open connections (loop thread only)
+    webhook_conn_t* pool;   // Closed connections kept for reuse
+    uint32_t pool_count;
+
+    // Stats, written by the loop thread and summed by webhook_get_stats
+    uint32_t messages_received;
+    uint32_t active_connections;
+} webhook_reactor_t;
+
 // Webhook channel instance data
-typedef struct webhook_channel_t {
+struct webhook_channel_t {
+    channel_t* channel;
+
     // Configuration
     str_t secret;           // HMAC secret for signature verification
     bool verify_signature;  // Whether to verify signatures
@@ -23,22 +59,45 @@ typedef struct webhook_channel_t {
     // HTTP client for sending
     http_client_t* http_client;
 
-    // HTTP server for receiving
-    uv_loop_t* loop;        // libuv event loop
-    uv_tcp_t server;        // TCP server handle
-    pthread_t listener_thread;      // Thread for libuv event loop
-    bool stop_listening;            // Flag to stop the listener thread
+    // HTTP server for receiving; on_message_callback runs on the reactor
+    // threads, concurrently when there are several
+    webhook_reactor_t* reactors;
+    uint32_t reactor_count;
     void (*on_message_callback)(channel_message_t* msg, void* user_data);
     void* user_data;
 
+    // Event-stream responses waiting for or carrying a reply
+    pthread_mutex_t streams_lock;
+    webhook_stream_t* streams;
+
+    // Delivery guards (see below); each is off, and NULL, unless configured
+    unsigned char guard_key[crypto_shorthash_KEYBYTES];
+    uint64_t guard_epoch;
+    uint64_t* rate_slots;           // Token bucket per sender address
+    uint64_t rate_interval_ms;      // One token per interval
+    uint64_t rate_burst_ms;         // Bucket depth beyond the first token
+    pthread_mutex_t idem_lock;
+    webhook_delivery_t** idem_buckets;
+    webhook_delivery_t* idem_oldest;
+    webhook_delivery_t* idem_newest;
+    uint32_t idem_count;
+    uint64_t idem_ttl_ms;
+
     // State
     uint32_t messages_sent;
-    uint32_t messages_received;
+    uint32_t messages_received;     // From reactors already shut down
     bool listening;
-} webhook_channel_t;
+};
 
 // Forward declarations
 static void* listener_thread_func(void* arg);
+static err_t server_open(channel_t* channel, webhook_reactor_t* reactor);
+static void server_close(webhook_reactor_t* reactor);
+static webhook_stream_t* stream_claim(webhook_channel_t* webhook_data, const str_t* recipient);
+static err_t stream_push(webhook_channel_t* webhook_data, webhook_stream_t* stream, const str_t* text);
+static void stream_detach(webhook_conn_t* conn);
+static err_t guard_init(webhook_channel_t* webhook_data, const channel_config_t* config);
+static void guard_free(webhook_channel_t* webhook_data);
 
 // Forward declarations for vtable
 static str_t webhook_get_name(void);
@@ -58,6 +117,9 @@ static bool webhook_is_listening(channel_t* channel);
 static err_t webhook_health_check(channel_t* channel, bool* out_healthy);
 static err_t webhook_get_stats(channel_t* channel, uint32_t* messages_sent,
                               uint32_t* messages_received, uint32_t* active_connections);
+static err_t webhook_stream_begin(channel_t* channel, channel_stream_t* stream);
+static err_t webhook_stream_append(channel_t* channel, channel_stream_t* stream, const str_t* delta);
+static err_t webhook_stream_end(channel_t* channel, channel_stream_t* stream);
 
 // VTable definition
 static const channel_vtable_t webhook_vtable = {
@@ -74,7 +136,10 @@ static const channel_vtable_t webhook_vtable = {
     .stop_listening = webhook_stop_listening,
     .is_listening = webhook_is_listening,
     .health_check = webhook_health_check,
-    .get_stats = webhook_get_stats
+    .get_stats = webhook_get_stats,
+    .stream_begin = webhook_stream_begin,
+    .stream_append = webhook_stream_append,
+    .stream_end = webhook_stream_end
 };
 
 // Get vtable
@@ -134,16 +199,9 @@ static err_t parse_webhook_payload(const char* payload, size_t payload_len,
                                   channel_message_t* out_message) {
     if (!payload || !out_message) return ERR_INVALID_ARGUMENT;
 
-    // Copy payload to null-terminated string for JSON parser
-    char* payload_copy = malloc(payload_len + 1);
-    if (!payload_copy) return ERR_OUT_OF_MEMORY;
-    memcpy(payload_copy, payload, payload_len);
-    payload_copy[payload_len] = '\0';
-
     // Parse JSON
-    json_value_t* root = json_parse(payload_copy);
+    json_value_t* root = json_parse_len(payload, payload_len);
     if (!root) {
-        free(payload_copy);
         return ERR_INVALID_ARGUMENT;
     }
 
@@ -189,7 +247,6 @@ static err_t parse_webhook_payload(const char* payload, size_t payload_len,
 
 cleanup:
     json_free(root);
-    free(payload_copy);
     return result;
 }
 
@@ -216,12 +273,16 @@ static err_t webhook_create(const channel_config_t* config, channel_t** out_chan
         channel_free(channel);
         return ERR_OUT_OF_MEMORY;
     }
+    if (guard_init(webhook_data, config) != ERR_OK) {
+        free(webhook_data);
+        channel_free(channel);
+        return ERR_OUT_OF_MEMORY;
+    }
 
     // Initialize webhook data
     webhook_data->secret = STR_NULL;
     webhook_data->verify_signature = false;
     webhook_data->messages_sent = 0;
-    webhook_data->messages_received = 0;
     webhook_data->listening = false;
 
     // Copy configuration
@@ -236,7 +297,9 @@ static err_t webhook_create(const channel_config_t* config, channel_t** out_chan
         webhook_data->verify_signature = true;
     }
 
+    pthread_mutex_init(&webhook_data->streams_lock, NULL);
     channel->impl_data = webhook_data;
+    webhook_data->channel = channel;
     channel->initialized = false;
     channel->listening = false;
 
@@ -283,6 +346,8 @@ static void webhook_destroy(channel_t* channel) {
         free((void*)channel->config.host.data);
     }
 
+    pthread_mutex_destroy(&webhook_data->streams_lock);
+    guard_free(webhook_data);
     free(webhook_data);
     channel->impl_data = NULL;
 
@@ -333,6 +398,16 @@ static err_t webhook_send(channel_t* channel, const str_t* message, const str_t*
 
     webhook_channel_t* webhook_data = (webhook_channel_t*)channel->impl_data;
 
+    // A sender waiting on an event stream gets the reply there
+    webhook_stream_t* stream = recipient && !str_empty(*recipient) ? stream_claim(webhook_data, recipient) : NULL;
+    if (stream) {
+        err_t err = stream_push(webhook_data, stream, message);
+        err_t done_err = stream_push(webhook_data, stream, NULL);
+        if (err == ERR_OK) err = done_err;
+        if (err == ERR_OK) __atomic_fetch_add(&webhook_data->messages_sent, 1, __ATOMIC_RELAXED);
+        return err;
+    }
+
     // Check if webhook URL is configured
     if (str_empty(channel->config.webhook_url)) {
         return ERR_CHANNEL; // No webhook URL configured
@@ -391,6 +466,24 @@ static err_t webhook_send_message(channel_t* channel, const channel_message_t* m
     return ERR_OK;
 }
 
+// Wake every running loop, join its thread and fold its counters into
+// the channel totals
+static void webhook_stop_reactors(webhook_channel_t* webhook_data) {
+    for (uint32_t i = 0; i < webhook_data->reactor_count; i++) {
+        webhook_reactor_t* reactor = &webhook_data->reactors[i];
+        if (reactor->running) {
+            // Wake the loop; it closes its handles and returns
+            uv_async_send(&reactor->stop_async);
+            pthread_join(reactor->thread, NULL);
+            reactor->running = false;
+        }
+        webhook_data->messages_received += reactor->messages_received;
+    }
+    free(webhook_data->reactors);
+    webhook_data->reactors = NULL;
+    webhook_data->reactor_count = 0;
+}
+
 static err_t webhook_start_listening(channel_t* channel,
                                     void (*on_message)(channel_message_t* msg, void* user_data),
                                     void* user_data) {
@@ -408,15 +501,34 @@ static err_t webhook_start_listening(channel_t* channel,
     webhook_data->on_message_callback = on_message;
     webhook_data->user_data = user_data;
 
-    // Reset stop flag
-    webhook_data->stop_listening = false;
+    uint32_t count = channel->config.listener_threads ? channel->config.listener_threads : 1;
+    if (count > WEBHOOK_MAX_REACTORS) count = WEBHOOK_MAX_REACTORS;
+
+    webhook_data->reactors = calloc(count, sizeof(webhook_reactor_t));
+    if (!webhook_data->reactors) return ERR_OUT_OF_MEMORY;
+    webhook_data->reactor_count = count;
+
+    err_t open_err = ERR_OK;
+    for (uint32_t i = 0; i < count && open_err == ERR_OK; i++) {
+        webhook_reactor_t* reactor = &webhook_data->reactors[i];
+        reactor->owner = webhook_data;
+        open_err = server_open(channel, reactor);
+        if (open_err != ERR_OK) break;
+
+        // Start listener thread
+        int err = pthread_create(&reactor->thread, NULL, listener_thread_func, reactor);
+        if (err != 0) {
+            fprintf(stderr, "[Webhook] Failed to start listener thread: %d\n", err);
+            server_close(reactor);
+            open_err = ERR_FAILED;
+            break;
+        }
+        reactor->running = true;
+    }
 
-    // Start listener thread
-    int err = pthread_create(&webhook_data->listener_thread, NULL,
-                            listener_thread_func, channel);
-    if (err != 0) {
-        fprintf(stderr, "[Webhook] Failed to start listener thread: %d\n", err);
-        return ERR_FAILED;
+    if (open_err != ERR_OK) {
+        webhook_stop_reactors(webhook_data);
+        return open_err;
     }
 
     printf("[Webhook] Webhook HTTP server started on port %d\n", channel->config.port);
@@ -438,14 +550,7 @@ static err_t webhook_stop_listening(channel_t* channel) {
         return ERR_OK; // Not listening
     }
 
-    // Set stop flag to signal listener thread to exit
-    webhook_data->stop_listening = true;
-
-    // Wait for thread to finish
-    if (webhook_data->listener_thread) {
-        pthread_join(webhook_data->listener_thread, NULL);
-        webhook_data->listener_thread = 0;
-    }
+    webhook_stop_reactors(webhook_data);
 
     printf("[Webhook] Webhook HTTP server stopped\n");
 
@@ -483,8 +588,16 @@ static err_t webhook_get_stats(channel_t* channel, uint32_t* messages_sent,
     webhook_channel_t* webhook_data = (webhook_channel_t*)channel->impl_data;
 
     if (messages_sent) *messages_sent = webhook_data->messages_sent;
-    if (messages_received) *messages_received = webhook_data->messages_received;
-    if (active_connections) *active_connections = webhook_data->listening ? 1 : 0;
+
+    // Per-reactor counters are summed on read
+    uint32_t received = webhook_data->messages_received;
+    uint32_t connections = 0;
+    for (uint32_t i = 0; i < webhook_data->reactor_count; i++) {
+        received += __atomic_load_n(&webhook_data->reactors[i].messages_received, __ATOMIC_RELAXED);
+        connections += __atomic_load_n(&webhook_data->reactors[i].active_connections, __ATOMIC_RELAXED);
+    }
+    if (messages_received) *messages_received = received;
+    if (active_connections) *active_connections = connections;
 
     return ERR_OK;
 }
@@ -493,251 +606,1227 @@ static err_t webhook_get_stats(channel_t* channel, uint32_t* messages_sent,
 // HTTP Server Implementation
 // ============================================================================
 
-// Buffer for HTTP requests
-typedef struct {
-    char data[4096];
+// Request limits; larger requests are answered with 431/413 and closed
+#define WEBHOOK_MAX_HEADER_BYTES (16 * 1024)
+#define WEBHOOK_MAX_BODY_BYTES (8 * 1024 * 1024)
+
+// Idle keep-alive connections are closed by a periodic sweep
+#define WEBHOOK_IDLE_TIMEOUT_MS 30000
+#define WEBHOOK_SWEEP_INTERVAL_MS 5000
+
+// Closed connections are recycled with their read buffers
+#define WEBHOOK_POOL_MAX 64
+#define WEBHOOK_POOL_BUFFER_MAX (64 * 1024)
+#define WEBHOOK_READ_CHUNK 16384
+
+#define WEBHOOK_BACKLOG 1024
+
+typedef enum {
+    PARSE_HEADERS,
+    PARSE_BODY,                // Content-Length body
+    PARSE_CHUNK_SIZE,
+    PARSE_CHUNK_DATA,
+    PARSE_TRAILERS,
+    PARSE_DONE
+} parse_state_t;
+
+// Incremental HTTP/1.1 request parser over the connection buffer. Chunked
+// bodies are decoded in place, so the body always ends up contiguous at
+// body_start.
+typedef struct http_request_t {
+    parse_state_t state;
+    size_t scan;               // Resume point of the current search
+    size_t body_start;
+    size_t body_len;           // Decoded bytes so far
+    size_t content_length;
+    size_t chunk_left;
+    size_t consumed;           // Raw bytes of the finished request
+    bool chunked;
+    bool keep_alive;
+    bool expect_continue;
+    bool sent_continue;
+    bool accept_stream;        // Accept: text/event-stream
+    bool admitted;             // Passed the sender's rate limit
+    size_t delivery_id_off;    // Idempotency-Key or equivalent, in the head
+    size_t delivery_id_len;
+    char method[16];
+    char path[256];
+} http_request_t;
+
+struct webhook_conn_t {
+    uv_tcp_t handle;
+    webhook_reactor_t* reactor;
+    webhook_conn_t* prev;      // Live list
+    webhook_conn_t* next;      // Live list, or pool free list
+    char* buf;
+    size_t len;
+    size_t cap;
+    http_request_t request;
+    webhook_stream_t* stream;  // Event-stream response in progress
+    uint64_t peer_key;         // Sender address, for the rate limit
+    uint64_t last_active;
+    bool closing;
+};
+
+// A queued response; freed by the write callback
+typedef struct webhook_write_t {
+    uv_write_t req;
+    webhook_conn_t* conn;
+    bool close_after;
     size_t len;
-} http_buffer_t;
+    char data[];
+} webhook_write_t;
 
-// HTTP connection context
-typedef struct {
-    uv_tcp_t* handle;
-    webhook_channel_t* channel;
-    http_buffer_t buffer;
-    bool request_complete;
-} connection_context_t;
+static void request_reset(http_request_t* request) {
+    memset(request, 0, sizeof(*request));
+}
 
-// Allocate buffer for reading
-static void alloc_buffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
-    connection_context_t* context = (connection_context_t*)handle->data;
-    if (context && context->buffer.len < sizeof(context->buffer.data)) {
-        size_t available = sizeof(context->buffer.data) - context->buffer.len;
-        buf->base = context->buffer.data + context->buffer.len;
-        buf->len = available > suggested_size ? suggested_size : available;
+static void conn_touch(webhook_conn_t* conn) {
+    conn->last_active = uv_now(conn->reactor->loop);
+}
+
+static void on_conn_closed(uv_handle_t* handle) {
+    webhook_conn_t* conn = (webhook_conn_t*)handle->data;
+    webhook_reactor_t* reactor = conn->reactor;
+
+    stream_detach(conn);
+    if (conn->prev) conn->prev->next = conn->next;
+    else reactor->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    __atomic_fetch_sub(&reactor->active_connections, 1, __ATOMIC_RELAXED);
+
+    if (reactor->pool_count >= WEBHOOK_POOL_MAX) {
+        free(conn->buf);
+        free(conn);
+        return;
+    }
+    if (conn->cap > WEBHOOK_POOL_BUFFER_MAX) {
+        free(conn->buf);
+        conn->buf = NULL;
+        conn->cap = 0;
+    }
+    conn->next = reactor->pool;
+    reactor->pool = conn;
+    reactor->pool_count++;
+}
+
+static void conn_close(webhook_conn_t* conn) {
+    if (conn->closing) return;
+    conn->closing = true;
+    uv_close((uv_handle_t*)&conn->handle, on_conn_closed);
+}
+
+static void on_write_done(uv_write_t* req, int status) {
+    webhook_write_t* write = (webhook_write_t*)req;
+    if (status < 0 || write->close_after) conn_close(write->conn);
+    alloc_tag_sub(ALLOC_TAG_CHANNEL, sizeof(webhook_write_t) + write->len);
+    free(write);
+}
+
+static void conn_write(webhook_conn_t* conn, const char* data, size_t len, bool close_after) {
+    webhook_write_t* write = malloc(sizeof(webhook_write_t) + len);
+    if (!write) {
+        conn_close(conn);
+        return;
+    }
+    write->conn = conn;
+    write->close_after = close_after;
+    write->len = len;
+    memcpy(write->data, data, len);
+    // Accounted until libuv has written it out
+    alloc_tag_add(ALLOC_TAG_CHANNEL, sizeof(webhook_write_t) + len);
+
+    uv_buf_t buf = uv_buf_init(write->data, (unsigned int)len);
+    if (uv_write(&write->req, (uv_stream_t*)&conn->handle, &buf, 1, on_write_done) != 0) {
+        alloc_tag_sub(ALLOC_TAG_CHANNEL, sizeof(webhook_write_t) + len);
+        free(write);
+        conn_close(conn);
+    }
+}
+
+// Send HTTP response; headers holds extra "Name: value\r\n" lines
+static void send_http_response_headers(webhook_conn_t* conn, int status_code, const char* status_text,
+                                       const char* headers, const char* body, bool keep_alive) {
+    char response[512];
+    size_t body_len = strlen(body);
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %d %s\r\n"
+                       "Content-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: %s\r\n"
+                       "%s"
+                       "\r\n"
+                       "%s",
+                       status_code, status_text, body_len,
+                       keep_alive ? "keep-alive" : "close", headers, body);
+    if (len > 0 && (size_t)len < sizeof(response)) {
+        conn_write(conn, response, (size_t)len, !keep_alive);
     } else {
-        buf->base = NULL;
-        buf->len = 0;
-    }
-}
-
-// Parse HTTP request and extract method, path, headers, and body
-static bool parse_http_request(const char* data, size_t len,
-                              char* method, size_t method_size,
-                              char* path, size_t path_size,
-                              char* body, size_t* body_len) {
-    if (len == 0) return false;
-
-    // Find request line
-    const char* end_of_line = strstr(data, "\r\n");
-    if (!end_of_line) return false;
-
-    // Parse method and path
-    int scanned = sscanf(data, "%s %s", method, path);
-    if (scanned != 2) return false;
-
-    // Find body (after \r\n\r\n)
-    const char* body_start = strstr(data, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4; // Skip \r\n\r\n
-        size_t body_length = len - (body_start - data);
-        if (body_length > 0) {
-            *body_len = body_length < *body_len ? body_length : *body_len;
-            memcpy(body, body_start, *body_len);
-        } else {
-            *body_len = 0;
+        conn_close(conn);
+    }
+}
+
+static void send_http_response(webhook_conn_t* conn, int status_code, const char* status_text,
+                               const char* body, bool keep_alive) {
+    send_http_response_headers(conn, status_code, status_text,
+                               status_code == 429 ? "Retry-After: 1\r\n" : "", body, keep_alive);
+}
+
+// ============================================================================
+// Delivery Guards
+// ============================================================================
+
+// Two checks keep floods and retries away from the agent. Every sender
+// address has a token bucket, consulted as soon as a request head is
+// parsed, so an over-limit body is never read or parsed. Accepted
+// deliveries are remembered for idempotency_ttl_secs under their delivery
+// ID header, or a hash of the body without one, and a retry is answered
+// from the record instead of starting another turn.
+
+#define WEBHOOK_RATE_SLOTS 4096        // Power of two
+#define WEBHOOK_RATE_PROBES 8
+#define WEBHOOK_RATE_TAT_BITS 40
+#define WEBHOOK_RATE_TAT_MASK ((UINT64_C(1) << WEBHOOK_RATE_TAT_BITS) - 1)
+
+#define WEBHOOK_IDEM_BUCKETS 4096      // Power of two
+#define WEBHOOK_IDEM_MAX 16384         // Past this the oldest record goes
+#define WEBHOOK_IDEM_REPLAY_MAX (64 * 1024)
+#define WEBHOOK_DELIVERY_ID_MAX 255
+
+// An accepted delivery. Records are listed in arrival order, which with a
+// single TTL is also expiry order.
+struct webhook_delivery_t {
+    uint64_t key;
+    uint64_t expires;
+    bool pending;              // The reply is still being produced
+    char* replay;              // Streamed reply events; NULL when not kept
+    size_t replay_len;
+    webhook_delivery_t* chain; // Bucket chain
+    webhook_delivery_t* older;
+    webhook_delivery_t* newer;
+};
+
+typedef enum {
+    DELIVERY_NEW,              // Now recorded as pending; go ahead
+    DELIVERY_PENDING,          // The first attempt has not finished
+    DELIVERY_DONE
+} delivery_state_t;
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Milliseconds since the channel was created, starting at 1
+static uint64_t guard_now(const webhook_channel_t* webhook_data) {
+    return monotonic_ms() - webhook_data->guard_epoch;
+}
+
+// Keyed with a per-channel secret so senders cannot aim at each other's
+// buckets or records
+static uint64_t guard_hash(const webhook_channel_t* webhook_data, const void* data, size_t len) {
+    unsigned char out[crypto_shorthash_BYTES];
+    crypto_shorthash(out, data, len, webhook_data->guard_key);
+    uint64_t hash;
+    memcpy(&hash, out, sizeof(hash));
+    return hash;
+}
+
+static err_t guard_init(webhook_channel_t* webhook_data, const channel_config_t* config) {
+    if (sodium_init() < 0) return ERR_RUNTIME;
+    randombytes_buf(webhook_data->guard_key, sizeof(webhook_data->guard_key));
+    webhook_data->guard_epoch = monotonic_ms() - 1;
+
+    if (config->rate_limit_per_minute) {
+        webhook_data->rate_slots = calloc(WEBHOOK_RATE_SLOTS, sizeof(uint64_t));
+        if (!webhook_data->rate_slots) return ERR_OUT_OF_MEMORY;
+        uint64_t interval = 60000 / config->rate_limit_per_minute;
+        webhook_data->rate_interval_ms = interval ? interval : 1;
+        webhook_data->rate_burst_ms = webhook_data->rate_interval_ms * (config->rate_limit_per_minute - 1);
+    }
+
+    pthread_mutex_init(&webhook_data->idem_lock, NULL);
+    if (config->idempotency_ttl_secs) {
+        webhook_data->idem_buckets = calloc(WEBHOOK_IDEM_BUCKETS, sizeof(webhook_delivery_t*));
+        if (!webhook_data->idem_buckets) {
+            pthread_mutex_destroy(&webhook_data->idem_lock);
+            free(webhook_data->rate_slots);
+            return ERR_OUT_OF_MEMORY;
+        }
+        webhook_data->idem_ttl_ms = config->idempotency_ttl_secs * 1000;
+    }
+    return ERR_OK;
+}
+
+// Token buckets kept as one word each, so taking a token is a single
+// compare-and-swap without locks (GCRA): the high 24 bits tag the sender,
+// the low 40 hold the time the bucket is next full. A slot whose bucket
+// has refilled carries no state and may be taken by another sender.
+//
+// Returns 0 when a token was taken, otherwise the wait for the next one.
+// A sender that finds all its probe slots held by active senders is
+// refused; under a flood that wide, refusing is the safe side.
+static uint64_t rate_take(webhook_channel_t* webhook_data, uint64_t key) {
+    uint64_t now = guard_now(webhook_data);
+    uint64_t tag = (key >> WEBHOOK_RATE_TAT_BITS) | 1;
+    uint64_t interval = webhook_data->rate_interval_ms;
+
+    for (uint32_t probe = 0; probe < WEBHOOK_RATE_PROBES; probe++) {
+        uint64_t* slot = &webhook_data->rate_slots[(key + probe) & (WEBHOOK_RATE_SLOTS - 1)];
+        uint64_t word = __atomic_load_n(slot, __ATOMIC_RELAXED);
+        for (;;) {
+            uint64_t full_at = word & WEBHOOK_RATE_TAT_MASK;
+            bool mine = (word >> WEBHOOK_RATE_TAT_BITS) == tag;
+            if (!mine && full_at > now) break;
+
+            uint64_t from = mine && full_at > now ? full_at : now;
+            if (from - now > webhook_data->rate_burst_ms) return from - now - webhook_data->rate_burst_ms;
+            uint64_t next = tag << WEBHOOK_RATE_TAT_BITS | ((from + interval) & WEBHOOK_RATE_TAT_MASK);
+            if (__atomic_compare_exchange_n(slot, &word, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return 0;
+            }
         }
+    }
+    return interval;
+}
+
+static uint64_t peer_key(const webhook_channel_t* webhook_data, const struct sockaddr_storage* peer) {
+    if (peer->ss_family == AF_INET6) {
+        const struct sockaddr_in6* addr = (const struct sockaddr_in6*)peer;
+        return guard_hash(webhook_data, &addr->sin6_addr, sizeof(addr->sin6_addr));
+    }
+    if (peer->ss_family == AF_INET) {
+        const struct sockaddr_in* addr = (const struct sockaddr_in*)peer;
+        return guard_hash(webhook_data, &addr->sin_addr, sizeof(addr->sin_addr));
+    }
+    return 0;
+}
+
+// Loop thread, once the request head is parsed: 0 to go ahead, otherwise
+// milliseconds until the sender may try again
+static uint64_t guard_admit(webhook_conn_t* conn) {
+    webhook_channel_t* webhook_data = conn->reactor->owner;
+    if (!webhook_data->rate_slots) return 0;
+    return rate_take(webhook_data, conn->peer_key);
+}
+
+// The delivery ID header when there is one, else the body. The leading
+// NUL keeps IDs apart from bodies, which are JSON objects. Scoped to the
+// sender and its address, so a known ID never replays another sender's
+// reply; a retry from a new address runs again instead.
+static uint64_t delivery_key(const webhook_conn_t* conn, const str_t* sender) {
+    const http_request_t* request = &conn->request;
+    const webhook_channel_t* webhook_data = conn->reactor->owner;
+
+    uint64_t parts[3] = { conn->peer_key, guard_hash(webhook_data, sender->data, sender->len), 0 };
+    if (request->delivery_id_len && request->delivery_id_len <= WEBHOOK_DELIVERY_ID_MAX) {
+        char id[WEBHOOK_DELIVERY_ID_MAX + 1];
+        id[0] = '\0';
+        memcpy(id + 1, conn->buf + request->delivery_id_off, request->delivery_id_len);
+        parts[2] = guard_hash(webhook_data, id, request->delivery_id_len + 1);
     } else {
-        *body_len = 0;
+        parts[2] = guard_hash(webhook_data, conn->buf + request->body_start, request->body_len);
     }
+    return guard_hash(webhook_data, parts, sizeof(parts)) | 1;
+}
 
-    return true;
+// Caller holds idem_lock
+static webhook_delivery_t* delivery_find(webhook_channel_t* webhook_data, uint64_t key) {
+    webhook_delivery_t* delivery = webhook_data->idem_buckets[key & (WEBHOOK_IDEM_BUCKETS - 1)];
+    while (delivery && delivery->key != key) delivery = delivery->chain;
+    return delivery;
 }
 
-// Send HTTP response
-static void send_http_response(uv_stream_t* stream, int status_code, const char* status_text,
-                              const char* content_type, const char* body) {
-    char response[1024];
-    int len = snprintf(response, sizeof(response),
-                      "HTTP/1.1 %d %s\r\n"
-                      "Content-Type: %s\r\n"
-                      "Content-Length: %lu\r\n"
-                      "Connection: close\r\n"
-                      "\r\n"
-                      "%s",
-                      status_code, status_text, content_type,
-                      body ? strlen(body) : 0, body ? body : "");
+// Caller holds idem_lock
+static void delivery_remove(webhook_channel_t* webhook_data, webhook_delivery_t* delivery) {
+    webhook_delivery_t** link = &webhook_data->idem_buckets[delivery->key & (WEBHOOK_IDEM_BUCKETS - 1)];
+    while (*link != delivery) link = &(*link)->chain;
+    *link = delivery->chain;
+
+    if (delivery->older) delivery->older->newer = delivery->newer;
+    else webhook_data->idem_oldest = delivery->newer;
+    if (delivery->newer) delivery->newer->older = delivery->older;
+    else webhook_data->idem_newest = delivery->older;
+    webhook_data->idem_count--;
+
+    alloc_tag_sub(ALLOC_TAG_CHANNEL, sizeof(webhook_delivery_t) + delivery->replay_len);
+    free(delivery->replay);
+    free(delivery);
+}
+
+// Look a delivery up, recording it as pending when it is new. A finished
+// one hands back a copy of its replay, if it kept one.
+static delivery_state_t delivery_begin(webhook_channel_t* webhook_data, uint64_t key,
+                                       char** out_replay, size_t* out_len) {
+    *out_replay = NULL;
+    *out_len = 0;
+    uint64_t now = guard_now(webhook_data);
+    delivery_state_t state = DELIVERY_NEW;
+
+    pthread_mutex_lock(&webhook_data->idem_lock);
+    while (webhook_data->idem_oldest && webhook_data->idem_oldest->expires <= now) {
+        delivery_remove(webhook_data, webhook_data->idem_oldest);
+    }
+
+    webhook_delivery_t* delivery = delivery_find(webhook_data, key);
+    if (delivery) {
+        state = delivery->pending ? DELIVERY_PENDING : DELIVERY_DONE;
+        if (state == DELIVERY_DONE && delivery->replay) {
+            *out_replay = malloc(delivery->replay_len);
+            if (*out_replay) {
+                memcpy(*out_replay, delivery->replay, delivery->replay_len);
+                *out_len = delivery->replay_len;
+            }
+        }
+    } else {
+        if (webhook_data->idem_count >= WEBHOOK_IDEM_MAX) delivery_remove(webhook_data, webhook_data->idem_oldest);
+        // Without a record a retry runs again, which is no reason to
+        // refuse this attempt
+        delivery = calloc(1, sizeof(webhook_delivery_t));
+        if (delivery) {
+            alloc_tag_add(ALLOC_TAG_CHANNEL, sizeof(webhook_delivery_t));
+            delivery->key = key;
+            delivery->expires = now + webhook_data->idem_ttl_ms;
+            delivery->pending = true;
+            webhook_delivery_t** bucket = &webhook_data->idem_buckets[key & (WEBHOOK_IDEM_BUCKETS - 1)];
+            delivery->chain = *bucket;
+            *bucket = delivery;
+            delivery->older = webhook_data->idem_newest;
+            if (delivery->older) delivery->older->newer = delivery;
+            else webhook_data->idem_oldest = delivery;
+            webhook_data->idem_newest = delivery;
+            webhook_data->idem_count++;
+        }
+    }
+    pthread_mutex_unlock(&webhook_data->idem_lock);
+    return state;
+}
 
-    if (len > 0 && len < (int)sizeof(response)) {
-        uv_buf_t buf = uv_buf_init(response, len);
-        uv_write_t* req = (uv_write_t*)malloc(sizeof(uv_write_t));
-        uv_write(req, stream, &buf, 1, NULL); // We don't handle write completion
+// The first attempt was answered; takes over replay (may be NULL), which
+// later retries get instead of a plain acknowledgement
+static void delivery_finish(webhook_channel_t* webhook_data, uint64_t key, char* replay, size_t replay_len) {
+    pthread_mutex_lock(&webhook_data->idem_lock);
+    webhook_delivery_t* delivery = delivery_find(webhook_data, key);
+    if (delivery && delivery->pending) {
+        delivery->pending = false;
+        if (replay) {
+            alloc_tag_add(ALLOC_TAG_CHANNEL, replay_len);
+            delivery->replay = replay;
+            delivery->replay_len = replay_len;
+            replay = NULL;
+        }
     }
+    pthread_mutex_unlock(&webhook_data->idem_lock);
+    free(replay);
 }
 
-// Handle incoming data
-static void on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
-    connection_context_t* context = (connection_context_t*)stream->data;
-    if (!context) return;
-
-    if (nread > 0) {
-        context->buffer.len += nread;
-        context->buffer.data[context->buffer.len] = '\0';
-
-        // Check if we have a complete request (ends with \r\n\r\n)
-        if (strstr(context->buffer.data, "\r\n\r\n")) {
-            char method[16];
-            char path[256];
-            char body[2048];
-            size_t body_len = sizeof(body);
-
-            if (parse_http_request(context->buffer.data, context->buffer.len,
-                                  method, sizeof(method),
-                                  path, sizeof(path),
-                                  body, &body_len)) {
-
-                // Only handle POST requests to /webhook or /
-                if (strcmp(method, "POST") == 0 &&
-                    (strcmp(path, "/webhook") == 0 || strcmp(path, "/") == 0)) {
-
-                    // Parse webhook payload
-                    channel_message_t message = {0};
-                    err_t parse_err = parse_webhook_payload(body, body_len, &message);
-
-                    if (parse_err == ERR_OK) {
-                        // Verify signature if configured
-                        webhook_channel_t* channel = context->channel;
-                        bool signature_valid = true;
-
-                        if (channel->verify_signature && !str_empty(channel->secret)) {
-                            // Extract signature from headers (simplified)
-                            // In real implementation, extract from X-Signature header
-                            signature_valid = false; // Default to false for now
-
-                            // TODO: Parse headers and verify signature
-                            // For now, accept all requests for testing
-                            signature_valid = true;
-                        }
-
-                        if (signature_valid) {
-                            channel->messages_received++;
-
-                            // Call the callback if set
-                            if (channel->on_message_callback) {
-                                channel->on_message_callback(&message, channel->user_data);
-                            }
-
-                            send_http_response(stream, 200, "OK",
-                                              "application/json",
-                                              "{\"status\":\"ok\"}");
-                        } else {
-                            send_http_response(stream, 401, "Unauthorized",
-                                              "application/json",
-                                              "{\"error\":\"Invalid signature\"}");
-                        }
-
-                        // Free message strings
-                        free((void*)message.content.data);
-                        free((void*)message.sender.data);
-                        free((void*)message.channel.data);
-                    } else {
-                        send_http_response(stream, 400, "Bad Request",
-                                          "application/json",
-                                          "{\"error\":\"Invalid JSON payload\"}");
-                    }
-                } else {
-                    send_http_response(stream, 404, "Not Found",
-                                      "application/json",
-                                      "{\"error\":\"Not Found\"}");
+// The first attempt was refused (bad payload, full queue), so a retry
+// has to go through
+static void delivery_forget(webhook_channel_t* webhook_data, uint64_t key) {
+    pthread_mutex_lock(&webhook_data->idem_lock);
+    webhook_delivery_t* delivery = delivery_find(webhook_data, key);
+    if (delivery) delivery_remove(webhook_data, delivery);
+    pthread_mutex_unlock(&webhook_data->idem_lock);
+}
+
+static void guard_free(webhook_channel_t* webhook_data) {
+    if (webhook_data->idem_buckets) {
+        while (webhook_data->idem_oldest) delivery_remove(webhook_data, webhook_data->idem_oldest);
+        free(webhook_data->idem_buckets);
+        webhook_data->idem_buckets = NULL;
+    }
+    pthread_mutex_destroy(&webhook_data->idem_lock);
+    free(webhook_data->rate_slots);
+    webhook_data->rate_slots = NULL;
+}
+
+// ============================================================================
+// Streamed Replies (Server-Sent Events)
+// ============================================================================
+
+// A request sent with "Accept: text/event-stream" is answered with an
+// event stream instead of the 200 acknowledgement, and the reply to its
+// sender goes out on it as "data: {"text":...}" events ending with
+// "event: done". Agent threads queue encoded events under streams_lock
+// and wake the reactor, which alone writes to the connection.
+struct webhook_stream_t {
+    webhook_reactor_t* reactor;
+    webhook_conn_t* conn;      // Loop thread only; NULL once closed
+    str_t sender;
+    char* out;                 // Encoded events not yet written
+    size_t out_len;
+    size_t out_cap;
+    uint32_t refs;             // The connection, plus the reply once claimed
+    bool claimed;              // A reply (stream_begin or send) owns it
+    bool finished;             // The done event is queued
+    bool detached;             // Connection or reactor gone; drop output
+    uint64_t delivery;         // Idempotency record to finish, 0 if none
+    char* replay;              // Every event so far, for retries
+    size_t replay_len;
+    size_t replay_cap;
+    bool replay_complete;      // Ends with the done event
+    bool replay_dropped;       // Outgrew WEBHOOK_IDEM_REPLAY_MAX
+    webhook_stream_t* next;    // Channel's stream list
+};
+
+static const char sse_head[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+static const char sse_replay_head[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "Idempotent-Replayed: true\r\n"
+    "\r\n";
+
+// Caller holds streams_lock
+static void stream_release(webhook_channel_t* webhook_data, webhook_stream_t* stream) {
+    if (--stream->refs > 0) return;
+
+    for (webhook_stream_t** link = &webhook_data->streams; *link; link = &(*link)->next) {
+        if (*link == stream) {
+            *link = stream->next;
+            break;
+        }
+    }
+    if (stream->delivery) {
+        // A reply cut short is not replayed; retries get the acknowledgement
+        bool whole = stream->replay_complete && !stream->replay_dropped;
+        delivery_finish(webhook_data, stream->delivery, whole ? stream->replay : NULL, stream->replay_len);
+        if (!whole) free(stream->replay);
+    }
+    free((void*)stream->sender.data);
+    alloc_tag_sub(ALLOC_TAG_CHANNEL, stream->out_cap);
+    free(stream->out);
+    free(stream);
+}
+
+// Caller holds streams_lock
+static void stream_record(webhook_stream_t* stream, const char* data, size_t len, bool done) {
+    if (stream->replay_dropped) return;
+    if (stream->replay_len + len > WEBHOOK_IDEM_REPLAY_MAX) {
+        stream->replay_dropped = true;
+        return;
+    }
+    if (stream->replay_len + len > stream->replay_cap) {
+        size_t cap = stream->replay_cap ? stream->replay_cap * 2 : 1024;
+        while (cap < stream->replay_len + len) cap *= 2;
+        char* replay = realloc(stream->replay, cap);
+        if (!replay) {
+            stream->replay_dropped = true;
+            return;
+        }
+        stream->replay = replay;
+        stream->replay_cap = cap;
+    }
+    memcpy(stream->replay + stream->replay_len, data, len);
+    stream->replay_len += len;
+    if (done) stream->replay_complete = true;
+}
+
+// Loop thread: register before delivery so an inline reply finds it
+static webhook_stream_t* stream_open(webhook_conn_t* conn, const str_t* sender, uint64_t delivery) {
+    webhook_channel_t* webhook_data = conn->reactor->owner;
+
+    webhook_stream_t* stream = calloc(1, sizeof(webhook_stream_t));
+    if (!stream) return NULL;
+    stream->sender = str_dup(*sender, NULL);
+    if (!stream->sender.data) {
+        free(stream);
+        return NULL;
+    }
+    stream->reactor = conn->reactor;
+    stream->conn = conn;
+    stream->refs = 1;
+    stream->delivery = delivery;
+
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    stream->next = webhook_data->streams;
+    webhook_data->streams = stream;
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+
+    conn->stream = stream;
+    return stream;
+}
+
+// Loop thread: the connection no longer carries the stream
+static void stream_detach(webhook_conn_t* conn) {
+    webhook_stream_t* stream = conn->stream;
+    if (!stream) return;
+    webhook_channel_t* webhook_data = conn->reactor->owner;
+
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    stream->conn = NULL;
+    stream->detached = true;
+    stream_release(webhook_data, stream);
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+    conn->stream = NULL;
+}
+
+// Oldest open stream waiting for a reply to recipient
+static webhook_stream_t* stream_claim(webhook_channel_t* webhook_data, const str_t* recipient) {
+    webhook_stream_t* found = NULL;
+
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    for (webhook_stream_t* stream = webhook_data->streams; stream; stream = stream->next) {
+        if (!stream->claimed && !stream->detached && str_equal(stream->sender, *recipient)) {
+            found = stream;    // Newest first; keep going to the oldest
+        }
+    }
+    if (found) {
+        found->claimed = true;
+        found->refs++;
+    }
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+    return found;
+}
+
+// Queue one text event, or the done event when text is NULL, and wake the
+// reactor. The done event also drops the reply's reference.
+static err_t stream_push(webhook_channel_t* webhook_data, webhook_stream_t* stream, const str_t* text) {
+    char* event = NULL;
+    size_t event_len = 0;
+    if (text) {
+        json_writer_t w;
+        json_writer_init(&w, text->len + 32);
+        json_write_raw(&w, "data: ", 6);
+        json_write_object_begin(&w);
+        json_write_kv_str(&w, "text", *text);
+        json_write_object_end(&w);
+        json_write_raw(&w, "\n\n", 2);
+        event = json_writer_finish(&w, &event_len);
+        if (!event) return ERR_OUT_OF_MEMORY;
+    }
+    static const char done[] = "event: done\ndata: {}\n\n";
+    const char* data = text ? event : done;
+    size_t len = text ? event_len : sizeof(done) - 1;
+
+    err_t err = ERR_OK;
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    // Recorded even once the connection is gone, for the sender's retry
+    if (stream->delivery) stream_record(stream, data, len, !text);
+    if (stream->detached) {
+        err = ERR_NETWORK;
+    } else if (stream->out_len + len > stream->out_cap) {
+        size_t cap = stream->out_cap ? stream->out_cap * 2 : 4096;
+        while (cap < stream->out_len + len) cap *= 2;
+        char* out = realloc(stream->out, cap);
+        if (!out) err = ERR_OUT_OF_MEMORY;
+        else {
+            alloc_tag_add(ALLOC_TAG_CHANNEL, cap - stream->out_cap);
+            stream->out = out;
+            stream->out_cap = cap;
+        }
+    }
+    if (err == ERR_OK) {
+        memcpy(stream->out + stream->out_len, data, len);
+        stream->out_len += len;
+        if (!text) stream->finished = true;
+        // The reactor marks its streams detached before closing this handle
+        uv_async_send(&stream->reactor->stream_async);
+    }
+    if (!text) stream_release(webhook_data, stream);
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+
+    free(event);
+    return err;
+}
+
+// Loop thread: write what the reply threads queued
+static void on_stream_ready(uv_async_t* async) {
+    webhook_reactor_t* reactor = (webhook_reactor_t*)async->data;
+    webhook_channel_t* webhook_data = reactor->owner;
+
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    webhook_stream_t* stream = webhook_data->streams;
+    while (stream) {
+        webhook_stream_t* next = stream->next;
+        webhook_conn_t* conn = stream->conn;
+        if (stream->reactor == reactor && conn && stream->out_len > 0) {
+            conn_write(conn, stream->out, stream->out_len, stream->finished);
+            stream->out_len = 0;
+            conn_touch(conn);
+            if (stream->finished) {
+                // The connection closes once the last write is out
+                stream->conn = NULL;
+                conn->stream = NULL;
+                stream_release(webhook_data, stream);
+            }
+        }
+        stream = next;
+    }
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+}
+
+// Loop thread, on shutdown: nothing may wake this reactor any more
+static void stream_detach_reactor(webhook_reactor_t* reactor) {
+    webhook_channel_t* webhook_data = reactor->owner;
+
+    pthread_mutex_lock(&webhook_data->streams_lock);
+    for (webhook_stream_t* stream = webhook_data->streams; stream; stream = stream->next) {
+        if (stream->reactor == reactor) stream->detached = true;
+    }
+    pthread_mutex_unlock(&webhook_data->streams_lock);
+}
+
+static err_t webhook_stream_begin(channel_t* channel, channel_stream_t* stream) {
+    if (!channel || !channel->impl_data || str_empty(stream->recipient)) return ERR_INVALID_ARGUMENT;
+
+    // Senders that did not ask for an event stream get the reply posted
+    // to webhook_url
+    webhook_stream_t* sse = stream_claim((webhook_channel_t*)channel->impl_data, &stream->recipient);
+    if (!sse) return ERR_NOT_FOUND;
+    stream->impl = sse;
+    return ERR_OK;
+}
+
+static err_t webhook_stream_append(channel_t* channel, channel_stream_t* stream, const str_t* delta) {
+    return stream_push((webhook_channel_t*)channel->impl_data, (webhook_stream_t*)stream->impl, delta);
+}
+
+static err_t webhook_stream_end(channel_t* channel, channel_stream_t* stream) {
+    webhook_channel_t* webhook_data = (webhook_channel_t*)channel->impl_data;
+    err_t err = stream_push(webhook_data, (webhook_stream_t*)stream->impl, NULL);
+    if (err == ERR_OK) __atomic_fetch_add(&webhook_data->messages_sent, 1, __ATOMIC_RELAXED);
+    stream->impl = NULL;
+    return err;
+}
+
+static bool header_is(const char* name, size_t name_len, const char* expected) {
+    return name_len == strlen(expected) && strncasecmp(name, expected, name_len) == 0;
+}
+
+static bool value_has(const char* value, size_t value_len, const char* token) {
+    size_t token_len = strlen(token);
+    for (size_t i = 0; i + token_len <= value_len; i++) {
+        if (strncasecmp(value + i, token, token_len) == 0) return true;
+    }
+    return false;
+}
+
+// Request line and headers in [0, end); returns an HTTP status, 0 if valid
+static int parse_head(http_request_t* request, const char* data, size_t end) {
+    const char* line_end = memchr(data, '\r', end);
+    if (!line_end) return 400;
+
+    const char* sp1 = memchr(data, ' ', (size_t)(line_end - data));
+    const char* sp2 = sp1 ? memchr(sp1 + 1, ' ', (size_t)(line_end - sp1 - 1)) : NULL;
+    if (!sp1 || !sp2) return 400;
+
+    size_t method_len = (size_t)(sp1 - data);
+    size_t path_len = (size_t)(sp2 - sp1 - 1);
+    if (method_len == 0 || method_len >= sizeof(request->method)) return 400;
+    if (path_len == 0 || path_len >= sizeof(request->path)) return 414;
+    memcpy(request->method, data, method_len);
+    request->method[method_len] = '\0';
+    memcpy(request->path, sp1 + 1, path_len);
+    request->path[path_len] = '\0';
+
+    const char* version = sp2 + 1;
+    size_t version_len = (size_t)(line_end - version);
+    if (version_len != 8 || strncmp(version, "HTTP/1.", 7) != 0) return 400;
+    request->keep_alive = version[7] == '1';
+
+    bool has_length = false;
+    const char* p = line_end + 2;
+    const char* stop = data + end;
+    while (p < stop) {
+        const char* eol = memchr(p, '\r', (size_t)(stop - p));
+        if (!eol) eol = stop;
+        const char* colon = memchr(p, ':', (size_t)(eol - p));
+        if (colon) {
+            size_t name_len = (size_t)(colon - p);
+            const char* value = colon + 1;
+            while (value < eol && (*value == ' ' || *value == '\t')) value++;
+            size_t value_len = (size_t)(eol - value);
+
+            if (header_is(p, name_len, "Content-Length")) {
+                // Digits only, and only once: peers that resolve a repeat
+                // differently would frame the body differently
+                while (value_len && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) value_len--;
+                if (has_length || value_len == 0) return 400;
+                size_t length = 0;
+                for (size_t i = 0; i < value_len; i++) {
+                    if (value[i] < '0' || value[i] > '9') return 400;
+                    length = length * 10 + (size_t)(value[i] - '0');
+                    if (length > WEBHOOK_MAX_BODY_BYTES) return 413;
                 }
-            } else {
-                send_http_response(stream, 400, "Bad Request",
-                                  "application/json",
-                                  "{\"error\":\"Invalid HTTP request\"}");
+                request->content_length = length;
+                has_length = true;
+            } else if (header_is(p, name_len, "Transfer-Encoding")) {
+                request->chunked = value_has(value, value_len, "chunked");
+            } else if (header_is(p, name_len, "Connection")) {
+                if (value_has(value, value_len, "close")) request->keep_alive = false;
+                if (value_has(value, value_len, "keep-alive")) request->keep_alive = true;
+            } else if (header_is(p, name_len, "Expect")) {
+                request->expect_continue = value_has(value, value_len, "100-continue");
+            } else if (header_is(p, name_len, "Accept")) {
+                request->accept_stream = value_has(value, value_len, "text/event-stream");
+            } else if (header_is(p, name_len, "Idempotency-Key") || header_is(p, name_len, "X-Delivery-ID") ||
+                       header_is(p, name_len, "X-GitHub-Delivery")) {
+                while (value_len && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) value_len--;
+                request->delivery_id_off = (size_t)(value - data);
+                request->delivery_id_len = value_len;
             }
+        }
+        p = eol + 2;
+    }
 
-            // Close connection after response
-            uv_close((uv_handle_t*)stream, NULL);
+    // Ambiguous framing is a smuggling vector; refuse it
+    if (request->chunked && has_length) return 400;
+    return 0;
+}
+
+// Advance the parser over newly read bytes. Returns 0 while more input is
+// needed or once PARSE_DONE is reached, otherwise an HTTP error status.
+static int parse_request(webhook_conn_t* conn) {
+    http_request_t* request = &conn->request;
+    char* data = conn->buf;
+
+    for (;;) {
+        switch (request->state) {
+            case PARSE_HEADERS: {
+                size_t from = request->scan > 3 ? request->scan - 3 : 0;
+                const char* end = from < conn->len ? memmem(data + from, conn->len - from, "\r\n\r\n", 4) : NULL;
+                if (!end) {
+                    request->scan = conn->len;
+                    return conn->len > WEBHOOK_MAX_HEADER_BYTES ? 431 : 0;
+                }
+
+                size_t head_len = (size_t)(end - data) + 2;
+                if (head_len > WEBHOOK_MAX_HEADER_BYTES) return 431;
+                int status = parse_head(request, data, head_len);
+                if (status) return status;
+
+                request->body_start = head_len + 2;
+                request->scan = request->body_start;
+                request->state = request->chunked ? PARSE_CHUNK_SIZE : PARSE_BODY;
+                break;
+            }
+            case PARSE_BODY:
+                if (conn->len - request->body_start < request->content_length) return 0;
+                request->body_len = request->content_length;
+                request->consumed = request->body_start + request->content_length;
+                request->state = PARSE_DONE;
+                return 0;
+            case PARSE_CHUNK_SIZE: {
+                const char* eol = memmem(data + request->scan, conn->len - request->scan, "\r\n", 2);
+                if (!eol) return conn->len - request->scan > 64 ? 400 : 0;
+
+                // Hex digits only (no sign, space or 0x), then an optional extension
+                const char* hex = data + request->scan;
+                const char* hex_end = hex;
+                size_t size = 0;
+                for (; hex_end < eol && isxdigit((unsigned char)*hex_end); hex_end++) {
+                    int digit = isdigit((unsigned char)*hex_end) ? *hex_end - '0'
+                                                                 : (tolower((unsigned char)*hex_end) - 'a' + 10);
+                    size = size * 16 + (size_t)digit;
+                    if (size > WEBHOOK_MAX_BODY_BYTES - request->body_len) return 413;
+                }
+                if (hex_end == hex || (hex_end != eol && *hex_end != ';')) return 400;
+
+                request->scan = (size_t)(eol - data) + 2;
+                request->chunk_left = size;
+                request->state = size == 0 ? PARSE_TRAILERS : PARSE_CHUNK_DATA;
+                break;
+            }
+            case PARSE_CHUNK_DATA: {
+                if (conn->len - request->scan < request->chunk_left + 2) return 0;
+                if (memcmp(data + request->scan + request->chunk_left, "\r\n", 2) != 0) return 400;
+
+                // Compact the chunk onto the decoded body
+                memmove(data + request->body_start + request->body_len, data + request->scan, request->chunk_left);
+                request->body_len += request->chunk_left;
+                request->scan += request->chunk_left + 2;
+                request->state = PARSE_CHUNK_SIZE;
+                break;
+            }
+            case PARSE_TRAILERS: {
+                const char* eol = memmem(data + request->scan, conn->len - request->scan, "\r\n", 2);
+                if (!eol) return conn->len - request->scan > WEBHOOK_MAX_HEADER_BYTES ? 431 : 0;
+                size_t line_len = (size_t)(eol - data) - request->scan;
+                request->scan = (size_t)(eol - data) + 2;
+                if (line_len == 0) {
+                    request->consumed = request->scan;
+                    request->state = PARSE_DONE;
+                    return 0;
+                }
+                break;
+            }
+            case PARSE_DONE:
+                return 0;
+        }
+    }
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        default: return "Error";
+    }
+}
+
+// Answer a retry of an accepted delivery. A streamed reply is replayed
+// whole; otherwise the sender gets the acknowledgement again.
+static void send_duplicate(webhook_conn_t* conn, delivery_state_t state, const char* replay, size_t replay_len) {
+    http_request_t* request = &conn->request;
+    if (state == DELIVERY_PENDING) {
+        send_http_response_headers(conn, 409, "Conflict", "Retry-After: 1\r\n",
+                                   "{\"error\":\"Delivery in progress\"}", request->keep_alive);
+    } else if (replay && request->accept_stream) {
+        request->keep_alive = false;
+        conn_write(conn, sse_replay_head, sizeof(sse_replay_head) - 1, false);
+        conn_write(conn, replay, replay_len, true);
+    } else {
+        send_http_response_headers(conn, 200, "OK", "Idempotent-Replayed: true\r\n",
+                                   "{\"status\":\"ok\"}", request->keep_alive);
+    }
+}
+
+static void handle_request(webhook_conn_t* conn) {
+    http_request_t* request = &conn->request;
+    webhook_reactor_t* reactor = conn->reactor;
+    webhook_channel_t* channel = reactor->owner;
+    bool keep_alive = request->keep_alive;
+
+    // Only handle POST requests to /webhook or /
+    if (strcmp(request->method, "POST") != 0 ||
+        (strcmp(request->path, "/webhook") != 0 && strcmp(request->path, "/") != 0)) {
+        send_http_response(conn, 404, "Not Found", "{\"error\":\"Not Found\"}", keep_alive);
+        return;
+    }
+
+    // Parse webhook payload
+    channel_message_t message = {0};
+    err_t parse_err = parse_webhook_payload(conn->buf + request->body_start, request->body_len, &message);
+    if (parse_err != ERR_OK) {
+        send_http_response(conn, 400, "Bad Request", "{\"error\":\"Invalid JSON payload\"}", keep_alive);
+        return;
+    }
+
+    // Verify signature if configured
+    bool signature_valid = true;
+    if (channel->verify_signature && !str_empty(channel->secret)) {
+        // TODO: Parse the X-Signature header and verify it
+        // For now, accept all requests for testing
+        signature_valid = true;
+    }
+
+    // Retries are answered from the idempotency table, and only
+    // authenticated requests reserve a key in it
+    uint64_t delivery = 0;
+    delivery_state_t state = DELIVERY_NEW;
+    char* replay = NULL;
+    size_t replay_len = 0;
+    if (signature_valid && channel->idem_buckets) {
+        delivery = delivery_key(conn, &message.sender);
+        state = delivery_begin(channel, delivery, &replay, &replay_len);
+    }
+
+    if (!signature_valid) {
+        send_http_response(conn, 401, "Unauthorized", "{\"error\":\"Invalid signature\"}", keep_alive);
+    } else if (state != DELIVERY_NEW) {
+        send_duplicate(conn, state, replay, replay_len);
+        free(replay);
+    } else {
+        // The event stream ends the connection, so nothing after this
+        // request is read
+        webhook_stream_t* stream = request->accept_stream ? stream_open(conn, &message.sender, delivery) : NULL;
+        if (stream) {
+            request->keep_alive = false;
+            keep_alive = false;
+        }
+
+        // Queued for the agent workers when the manager runs them; a full
+        // queue is pushed back to the sender
+        err_t deliver_err = channel_deliver(channel->channel, &message,
+                                            channel->on_message_callback, channel->user_data);
+        if (deliver_err != ERR_OK) {
+            stream_detach(conn);
+            if (delivery) delivery_forget(channel, delivery);
+        } else if (delivery && !stream) {
+            delivery_finish(channel, delivery, NULL, 0);
+        }
+
+        if (deliver_err == ERR_OK) {
+            __atomic_fetch_add(&reactor->messages_received, 1, __ATOMIC_RELAXED);
+            if (stream) conn_write(conn, sse_head, sizeof(sse_head) - 1, false);
+            else send_http_response(conn, 200, "OK", "{\"status\":\"ok\"}", keep_alive);
+        } else if (deliver_err == ERR_CHANNEL_RATE_LIMIT) {
+            send_http_response(conn, 429, "Too Many Requests", "{\"error\":\"Queue full\"}", keep_alive);
+        } else {
+            send_http_response(conn, 500, "Internal Server Error", "{\"error\":\"Delivery failed\"}", keep_alive);
         }
-    } else if (nread < 0) {
-        // Error or EOF
-        uv_close((uv_handle_t*)stream, NULL);
     }
 
-    // Free context when connection closes
-    if (nread <= 0) {
-        free(context);
+    // Free message strings
+    free((void*)message.id.data);
+    free((void*)message.content.data);
+    free((void*)message.sender.data);
+    free((void*)message.channel.data);
+}
+
+// Answer every complete request in the buffer (pipelining) and keep the
+// leftover bytes of the next one
+static void process_buffer(webhook_conn_t* conn) {
+    while (!conn->closing) {
+        int status = parse_request(conn);
+        if (status) {
+            char body[64];
+            snprintf(body, sizeof(body), "{\"error\":\"%s\"}", status_text(status));
+            send_http_response(conn, status, status_text(status), body, false);
+            uv_read_stop((uv_stream_t*)&conn->handle);
+            return;
+        }
+
+        // Checked once per request, before its body is read
+        http_request_t* request = &conn->request;
+        if (request->state != PARSE_HEADERS && !request->admitted) {
+            uint64_t wait_ms = guard_admit(conn);
+            if (wait_ms) {
+                char retry[48];
+                snprintf(retry, sizeof(retry), "Retry-After: %llu\r\n", (unsigned long long)((wait_ms + 999) / 1000));
+                send_http_response_headers(conn, 429, "Too Many Requests", retry,
+                                           "{\"error\":\"Rate limit exceeded\"}", false);
+                uv_read_stop((uv_stream_t*)&conn->handle);
+                return;
+            }
+            request->admitted = true;
+        }
+
+        if (request->state != PARSE_DONE) {
+            if (request->expect_continue && !request->sent_continue && request->state != PARSE_HEADERS) {
+                static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                conn_write(conn, cont, sizeof(cont) - 1, false);
+                request->sent_continue = true;
+            }
+            return;
+        }
+
+        handle_request(conn);
+        bool keep_alive = request->keep_alive;
+
+        size_t rest = conn->len - request->consumed;
+        memmove(conn->buf, conn->buf + request->consumed, rest);
+        conn->len = rest;
+        request_reset(request);
+
+        if (!keep_alive) {
+            uv_read_stop((uv_stream_t*)&conn->handle);
+            return;
+        }
+        if (rest == 0) return;
+    }
+}
+
+// Hand libuv the free tail of the connection buffer, growing it as needed
+static void alloc_buffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
+    (void)suggested_size;
+    webhook_conn_t* conn = (webhook_conn_t*)handle->data;
+
+    if (conn->cap - conn->len < WEBHOOK_READ_CHUNK) {
+        size_t cap = conn->cap ? conn->cap : WEBHOOK_READ_CHUNK;
+        while (cap - conn->len < WEBHOOK_READ_CHUNK) cap *= 2;
+        char* grown = realloc(conn->buf, cap);
+        if (!grown) {
+            buf->base = NULL;
+            buf->len = 0;
+            return;
+        }
+        conn->buf = grown;
+        conn->cap = cap;
+    }
+
+    buf->base = conn->buf + conn->len;
+    buf->len = conn->cap - conn->len;
+}
+
+// Handle incoming data
+static void on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+    (void)buf;
+    webhook_conn_t* conn = (webhook_conn_t*)stream->data;
+
+    if (nread < 0) {
+        // Error or EOF
+        conn_close(conn);
+        return;
     }
+    if (nread == 0 || conn->closing) return;
+
+    conn->len += (size_t)nread;
+    conn_touch(conn);
+    process_buffer(conn);
 }
 
 // Handle new connection
 static void on_connection(uv_stream_t* server, int status) {
     if (status < 0) return;
 
-    channel_t* channel = (channel_t*)server->data;
-    if (!channel || !channel->impl_data) return;
+    webhook_reactor_t* reactor = (webhook_reactor_t*)server->data;
+
+    webhook_conn_t* conn = reactor->pool;
+    if (conn) {
+        reactor->pool = conn->next;
+        reactor->pool_count--;
+        char* buf = conn->buf;
+        size_t cap = conn->cap;
+        memset(conn, 0, sizeof(*conn));
+        conn->buf = buf;
+        conn->cap = cap;
+    } else {
+        conn = calloc(1, sizeof(webhook_conn_t));
+        if (!conn) return;
+    }
 
-    webhook_channel_t* webhook_data = (webhook_channel_t*)channel->impl_data;
+    conn->reactor = reactor;
+    uv_tcp_init(reactor->loop, &conn->handle);
+    conn->handle.data = conn;
+
+    conn->next = reactor->conns;
+    if (conn->next) conn->next->prev = conn;
+    reactor->conns = conn;
+    __atomic_fetch_add(&reactor->active_connections, 1, __ATOMIC_RELAXED);
+    conn_touch(conn);
+
+    if (uv_accept(server, (uv_stream_t*)&conn->handle) == 0) {
+        struct sockaddr_storage peer;
+        int peer_len = sizeof(peer);
+        if (reactor->owner->rate_slots &&
+            uv_tcp_getpeername(&conn->handle, (struct sockaddr*)&peer, &peer_len) == 0) {
+            conn->peer_key = peer_key(reactor->owner, &peer);
+        }
+        uv_tcp_nodelay(&conn->handle, 1);
+        uv_read_start((uv_stream_t*)&conn->handle, alloc_buffer, on_read);
+    } else {
+        conn_close(conn);
+    }
+}
 
-    uv_tcp_t* client = (uv_tcp_t*)malloc(sizeof(uv_tcp_t));
-    uv_tcp_init(webhook_data->loop, client);
+static void on_sweep(uv_timer_t* timer) {
+    webhook_reactor_t* reactor = (webhook_reactor_t*)timer->data;
+    uint64_t now = uv_now(reactor->loop);
 
-    // Create connection context
-    connection_context_t* context = (connection_context_t*)calloc(1, sizeof(connection_context_t));
-    context->handle = client;
-    context->channel = webhook_data;
-    client->data = context;
+    for (webhook_conn_t* conn = reactor->conns; conn; conn = conn->next) {
+        if (now - conn->last_active >= WEBHOOK_IDLE_TIMEOUT_MS) conn_close(conn);
+    }
+}
 
-    if (uv_accept(server, (uv_stream_t*)client) == 0) {
-        uv_read_start((uv_stream_t*)client, alloc_buffer, on_read);
-    } else {
-        uv_close((uv_handle_t*)client, NULL);
-        free(context);
+// Runs on the loop thread: close every handle so uv_run returns
+static void on_stop(uv_async_t* async) {
+    webhook_reactor_t* reactor = (webhook_reactor_t*)async->data;
+
+    stream_detach_reactor(reactor);
+    uv_close((uv_handle_t*)&reactor->server, NULL);
+    uv_close((uv_handle_t*)&reactor->sweep_timer, NULL);
+    uv_close((uv_handle_t*)&reactor->stop_async, NULL);
+    uv_close((uv_handle_t*)&reactor->stream_async, NULL);
+    for (webhook_conn_t* conn = reactor->conns; conn; conn = conn->next) {
+        conn_close(conn);
     }
 }
 
-// Thread function for libuv event loop
-static void* listener_thread_func(void* arg) {
-    channel_t* channel = (channel_t*)arg;
-    if (!channel || !channel->impl_data) return NULL;
+static void server_free_pool(webhook_reactor_t* reactor) {
+    while (reactor->pool) {
+        webhook_conn_t* conn = reactor->pool;
+        reactor->pool = conn->next;
+        free(conn->buf);
+        free(conn);
+    }
+    reactor->pool_count = 0;
+}
+
+// Listening socket for one reactor. SO_REUSEPORT is only set with several
+// reactors so a single listener keeps exclusive use of its port.
+static int server_socket(const struct sockaddr_in* addr, bool reuse_port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -errno;
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    if (bind(fd, (const struct sockaddr*)addr, sizeof(*addr)) != 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    return fd;
+}
+
+// Close a reactor's handles and loop without running it on a thread
+static void server_close(webhook_reactor_t* reactor) {
+    on_stop(&reactor->stop_async);
+    uv_run(reactor->loop, UV_RUN_DEFAULT);
+    uv_loop_close(reactor->loop);
+    free(reactor->loop);
+    reactor->loop = NULL;
+    server_free_pool(reactor);
+}
 
+// Set up the loop and bind on the caller's thread so errors are reported
+// synchronously; the listener thread only runs the loop
+static err_t server_open(channel_t* channel, webhook_reactor_t* reactor) {
     webhook_channel_t* webhook_data = (webhook_channel_t*)channel->impl_data;
 
-    // Create libuv loop
-    webhook_data->loop = (uv_loop_t*)malloc(sizeof(uv_loop_t));
-    uv_loop_init(webhook_data->loop);
+    reactor->loop = (uv_loop_t*)malloc(sizeof(uv_loop_t));
+    if (!reactor->loop) return ERR_OUT_OF_MEMORY;
+    uv_loop_init(reactor->loop);
 
-    // Create TCP server
     struct sockaddr_in addr;
     uv_ip4_addr("0.0.0.0", channel->config.port, &addr);
 
-    uv_tcp_init(webhook_data->loop, &webhook_data->server);
-    uv_tcp_bind(&webhook_data->server, (const struct sockaddr*)&addr, 0);
-    webhook_data->server.data = channel; // Store channel_t pointer for callbacks
-
-    int r = uv_listen((uv_stream_t*)&webhook_data->server, 128, on_connection);
+    uv_tcp_init(reactor->loop, &reactor->server);
+    reactor->server.data = reactor;
+    uv_timer_init(reactor->loop, &reactor->sweep_timer);
+    reactor->sweep_timer.data = reactor;
+    uv_async_init(reactor->loop, &reactor->stop_async, on_stop);
+    reactor->stop_async.data = reactor;
+    uv_async_init(reactor->loop, &reactor->stream_async, on_stream_ready);
+    reactor->stream_async.data = reactor;
+
+    // Once uv_tcp_open succeeds the handle owns the descriptor
+    int fd = server_socket(&addr, webhook_data->reactor_count > 1);
+    int r = fd < 0 ? fd : uv_tcp_open(&reactor->server, fd);
+    if (r && fd >= 0) close(fd);
+    if (r == 0) r = uv_listen((uv_stream_t*)&reactor->server, WEBHOOK_BACKLOG, on_connection);
     if (r) {
         fprintf(stderr, "[Webhook] Listen error: %s\n", uv_strerror(r));
-        uv_loop_close(webhook_data->loop);
-        free(webhook_data->loop);
-        webhook_data->loop = NULL;
-        return NULL;
+        server_close(reactor);
+        return ERR_NETWORK;
     }
 
-    printf("[Webhook] HTTP server listening on port %d\n", channel->config.port);
+    uv_timer_start(&reactor->sweep_timer, on_sweep, WEBHOOK_SWEEP_INTERVAL_MS, WEBHOOK_SWEEP_INTERVAL_MS);
+    return ERR_OK;
+}
 
-    // Run event loop until stop flag is set
-    while (!webhook_data->stop_listening) {
-        uv_run(webhook_data->loop, UV_RUN_NOWAIT);
-        usleep(10000); // 10ms sleep to prevent busy waiting
-    }
+// Thread function for libuv event loop
+static void* listener_thread_func(void* arg) {
+    webhook_reactor_t* reactor = (webhook_reactor_t*)arg;
 
-    // Cleanup
-    uv_close((uv_handle_t*)&webhook_data->server, NULL);
-    uv_run(webhook_data->loop, UV_RUN_DEFAULT);
-    uv_loop_close(webhook_data->loop);
-    free(webhook_data->loop);
-    webhook_data->loop = NULL;
+    // Blocks in the kernel until there is work; on_stop ends it
+    uv_run(reactor->loop, UV_RUN_DEFAULT);
 
-    printf("[Webhook] HTTP server stopped\n");
+    uv_loop_close(reactor->loop);
+    free(reactor->loop);
+    reactor->loop = NULL;
+    server_free_pool(reactor);
     return NULL;
-}
\ No newline at end of file
+}
@@ -5,13 +5,21 @@
 #include "runtime/daemon.h"
 #include "runtime/tui.h"
 #include "runtime/agent_loop.h"
+#include "runtime/loadgen.h"
+#include "runtime/docker_pool.h"
 #include "core/agent.h"
+#include "core/memory.h"
 #include "providers/base.h"
+#include "providers/router.h"
+#include "providers/response_cache.h"
+#include "providers/replay.h"
 #include "cclaw.h"
 
+#include <ftw.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 // ============================================================================
@@ -170,9 +178,46 @@ err_t cmd_agent(config_t* config, int argc, char** argv) {
 // Daemon Command
 // ============================================================================
 
-err_t cmd_daemon(config_t* config, int argc, char** argv) {
-    (void)config;
+// Retention runs at minute 17 of every hour, at most this many short
+// transactions per run; anything left over waits for the next run
+#define MEMORY_HYGIENE_CRON "17 * * * *"
+#define MEMORY_HYGIENE_MAX_BATCHES 200
+
+typedef struct memory_hygiene_t {
+    memory_t* memory;
+    const config_t* config;
+} memory_hygiene_t;
+
+static void memory_hygiene_run(const char* args, void* user_data) {
+    (void)args;
+    memory_hygiene_t* hygiene = (memory_hygiene_t*)user_data;
+
+    memory_sweep_opts_t opts = memory_sweep_opts_from_config(hygiene->config, (uint64_t)time(NULL));
+    opts.max_batches = MEMORY_HYGIENE_MAX_BATCHES;
 
+    memory_sweep_result_t result;
+    err_t err = memory_sweep(hygiene->memory, &opts, &result);
+    if (err != ERR_OK && err != ERR_NOT_IMPLEMENTED) {
+        fprintf(stderr, "Memory hygiene failed: %s\n", error_to_string(err));
+    }
+}
+
+// Opened after daemon_start, since the backend's threads do not survive the fork
+static err_t memory_hygiene_schedule(daemon_t* daemon, memory_hygiene_t* hygiene) {
+    err_t err = memory_create_from_config(hygiene->config, &hygiene->memory);
+    if (err != ERR_OK) return err;
+
+    cron_job_t job = {0};
+    job.name = STR_LIT("memory-hygiene");
+    job.expression = STR_LIT(MEMORY_HYGIENE_CRON);
+    job.description = STR_LIT("Archive, purge and expire old memories");
+    job.enabled = true;
+    job.callback = memory_hygiene_run;
+    job.user_data = hygiene;
+    return daemon_cron_add(daemon, &job);
+}
+
+err_t cmd_daemon(config_t* config, int argc, char** argv) {
     daemon_config_t daemon_config = daemon_config_default();
     const char* action = "start";
 
@@ -188,6 +233,8 @@ err_t cmd_daemon(config_t* config, int argc, char** argv) {
             action = "status";
         } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pidfile") == 0) && i + 1 < argc) {
             daemon_config.pid_file = STR_VIEW(argv[i + 1]);
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            daemon_config.metrics_port = (uint16_t)atoi(argv[++i]);
         }
     }
 
@@ -219,12 +266,21 @@ err_t cmd_daemon(config_t* config, int argc, char** argv) {
 
         printf("✓ Daemon started (PID: %d)\n", (int)daemon->pid);
 
+        memory_hygiene_t hygiene = { .memory = NULL, .config = config };
+        if (config->memory.hygiene_enabled) {
+            err = memory_hygiene_schedule(daemon, &hygiene);
+            if (err != ERR_OK) {
+                fprintf(stderr, "Warning: Memory hygiene disabled: %s\n", error_to_string(err));
+            }
+        }
+
         // Run daemon
         daemon_run(daemon);
 
-        // Cleanup
+        // Cleanup; the cron workers are joined before the memory goes away
         daemon_stop(daemon);
         daemon_destroy(daemon);
+        memory_free(hygiene.memory);
 
     } else if (strcmp(action, "stop") == 0) {
         if (!daemon_is_running(pid_path)) {
@@ -320,6 +376,7 @@ err_t cmd_tui(config_t* config, int argc, char** argv) {
     agent_config.autonomy_level = config->autonomy.level;
     agent_config.enable_shell_tool = true;
     agent_config.workspace_root = str_dup(config->workspace_dir, NULL);
+    agent_config.sessions_dir = agent_sessions_dir_default();
 
     agent_t* agent = NULL;
 
@@ -329,6 +386,26 @@ err_t cmd_tui(config_t* config, int argc, char** argv) {
         return err;
     }
 
+    // One memory instance for every memory tool, behind the recall cache
+    memory_t* memory = NULL;
+    err_t memory_err = memory_create_from_config(config, &memory);
+    if (memory_err == ERR_OK) {
+        agent_set_memory(agent, memory);
+    } else {
+        fprintf(stderr, "Warning: Failed to open memory backend: %s\n", error_to_string(memory_err));
+    }
+
+    if (config->runtime.kind == RUNTIME_KIND_DOCKER) {
+        docker_pool_t* sandbox = NULL;
+        err = docker_pool_create_from_config(config, &sandbox);
+        if (err != ERR_OK) {
+            fprintf(stderr, "Failed to start Docker sandbox: %s\n", error_to_string(err));
+            agent_destroy(agent);
+            return err;
+        }
+        agent_set_sandbox(agent, sandbox);
+    }
+
     // Initialize provider if API key is configured
     if (!str_empty(config->api_key)) {
         provider_registry_init();
@@ -339,6 +416,7 @@ err_t cmd_tui(config_t* config, int argc, char** argv) {
             .base_url = STR_NULL,
             .default_model = config->default_model,
             .default_temperature = config->default_temperature,
+            .compress_requests = config->compress_requests,
             .max_tokens = 4096,
             .timeout_ms = 60000,
             .stream = false,
@@ -349,7 +427,30 @@ err_t cmd_tui(config_t* config, int argc, char** argv) {
         const char* provider_name = str_empty(config->default_provider) ? "openrouter" : config->default_provider.data;
 
         provider_t* provider = NULL;
-        err_t provider_err = provider_create(provider_name, &provider_config, &provider);
+        err_t provider_err;
+        if (config->model_routes_count > 0 || config->reliability.fallback_providers_count > 0) {
+            // Several candidates: route each request by live latency and errors
+            provider_router_t* router = provider_router_create(config);
+            provider_err = router ? provider_router_as_provider(router, &provider) : ERR_OUT_OF_MEMORY;
+            if (provider_err != ERR_OK) provider_router_destroy(router);
+        } else {
+            provider_err = provider_create(provider_name, &provider_config, &provider);
+        }
+        if (provider_err == ERR_OK && config->response_cache.enabled) {
+            // Deterministic requests (cron, summaries) are answered from the cache
+            response_cache_t* cache = NULL;
+            provider_t* cached = NULL;
+            if (response_cache_create_from_config(config, &cache) == ERR_OK &&
+                response_cache_wrap(cache, provider, &cached) == ERR_OK) {
+                provider = cached;
+            } else {
+                response_cache_destroy(cache);
+            }
+        }
+        if (provider_err == ERR_OK && config->reliability.prewarm_providers) {
+            // Handshakes happen now, in parallel, instead of on the first turn
+            provider_prewarm(provider);
+        }
         if (provider_err == ERR_OK) {
             agent->ctx->provider = provider;
         } else {
@@ -357,10 +458,10 @@ err_t cmd_tui(config_t* config, int argc, char** argv) {
         }
     }
 
-    // Create default session for TUI
+    // Default session for the TUI, resumed from its log
     agent_session_t* session = NULL;
     str_t session_name = STR_LIT("tui");
-    err = agent_session_create(agent, &session_name, &session);
+    err = agent_session_resume(agent, &session_name, &session_name, &session);
     if (err != ERR_OK) {
         fprintf(stderr, "Failed to create session: %s\n", error_to_string(err));
         agent_destroy(agent);
@@ -498,6 +599,185 @@ err_t cmd_doctor(config_t* config, int argc, char** argv) {
     return all_ok ? ERR_OK : ERR_FAILED;
 }
 
+// ============================================================================
+// Bench Command
+// ============================================================================
+
+static void bench_usage(void) {
+    printf("Usage: cclaw bench [provider|webhook|memory] [options]\n");
+    printf("\nOptions:\n");
+    printf("  --sessions N      Concurrent synthetic sessions (default %d)\n", LOADGEN_DEFAULT_SESSIONS);
+    printf("  --turns N         Turns per session, 0 = until --duration (default %d)\n", LOADGEN_DEFAULT_TURNS);
+    printf("  --duration SECS   Stop after this long\n");
+    printf("  --think MS        Mean think time between turns (default %d)\n", LOADGEN_DEFAULT_THINK_MS);
+    printf("  --tools RATIO     Share of turns offering tools, or storing for memory (default %.1f)\n",
+           LOADGEN_DEFAULT_TOOL_RATIO);
+    printf("  --no-stream       Buffered requests; no time to first token\n");
+    printf("  --provider NAME   Provider to load (default: configured provider)\n");
+    printf("  --model NAME      Model to request\n");
+    printf("  --capture FILE    Replay a capture (implies --provider replay)\n");
+    printf("  --time-scale X    Replay timing scale (default 1, 0 = no delays)\n");
+    printf("  --url URL         Webhook endpoint (default: configured webhook port)\n");
+    printf("  --token TOKEN     Bearer token for the webhook\n");
+    printf("  --workspace DIR   Memory workspace (default: a scratch directory)\n");
+    printf("  --seed N          Prompt and think-time seed\n");
+    printf("  --json            Print the report as JSON\n");
+}
+
+static int bench_remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    return remove(path);
+}
+
+static err_t bench_create_provider(const config_t* config, const char* name, const char* capture,
+                                   double time_scale, provider_t** out_provider) {
+    provider_registry_init();
+
+    provider_config_t provider_config = {
+        .name = STR_VIEW(name),
+        .api_key = config->api_key,
+        .base_url = capture ? STR_VIEW(capture) : STR_NULL,
+        .default_model = config->default_model,
+        .default_temperature = config->default_temperature,
+        .compress_requests = config->compress_requests,
+        .max_tokens = 4096,
+        .timeout_ms = 60000,
+        .stream = true
+    };
+    err_t err = provider_create(name, &provider_config, out_provider);
+    if (err == ERR_OK && strcmp(name, "replay") == 0 && time_scale >= 0.0) {
+        err = replay_set_time_scale(*out_provider, time_scale);
+    }
+    return err;
+}
+
+err_t cmd_bench(config_t* config, int argc, char** argv) {
+    loadgen_config_t load = loadgen_config_default();
+    const char* provider_name = str_empty(config->default_provider) ? "openrouter" : config->default_provider.data;
+    const char* capture = NULL;
+    const char* workspace = NULL;
+    double time_scale = -1.0;
+    bool json = false;
+
+    for (int i = 0; i < argc; i++) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "provider") == 0) {
+            load.target = LOADGEN_TARGET_PROVIDER;
+        } else if (strcmp(arg, "webhook") == 0) {
+            load.target = LOADGEN_TARGET_WEBHOOK;
+        } else if (strcmp(arg, "memory") == 0) {
+            load.target = LOADGEN_TARGET_MEMORY;
+        } else if (strcmp(arg, "--sessions") == 0 && has_value) {
+            load.sessions = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--turns") == 0 && has_value) {
+            load.turns = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--duration") == 0 && has_value) {
+            load.duration_ms = (uint64_t)(strtod(argv[++i], NULL) * 1000.0);
+            if (load.turns == LOADGEN_DEFAULT_TURNS) load.turns = 0;
+        } else if (strcmp(arg, "--think") == 0 && has_value) {
+            load.think_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--tools") == 0 && has_value) {
+            load.tool_ratio = strtod(argv[++i], NULL);
+        } else if (strcmp(arg, "--no-stream") == 0) {
+            load.stream = false;
+        } else if (strcmp(arg, "--provider") == 0 && has_value) {
+            provider_name = argv[++i];
+        } else if (strcmp(arg, "--model") == 0 && has_value) {
+            load.model = argv[++i];
+        } else if (strcmp(arg, "--capture") == 0 && has_value) {
+            capture = argv[++i];
+            provider_name = "replay";
+        } else if (strcmp(arg, "--time-scale") == 0 && has_value) {
+            time_scale = strtod(argv[++i], NULL);
+        } else if (strcmp(arg, "--url") == 0 && has_value) {
+            load.url = argv[++i];
+        } else if (strcmp(arg, "--token") == 0 && has_value) {
+            load.auth_token = argv[++i];
+        } else if (strcmp(arg, "--workspace") == 0 && has_value) {
+            workspace = argv[++i];
+        } else if (strcmp(arg, "--seed") == 0 && has_value) {
+            load.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--json") == 0) {
+            json = true;
+        } else {
+            bench_usage();
+            return ERR_INVALID_ARGUMENT;
+        }
+    }
+
+    // Set up the target
+    err_t err = ERR_OK;
+    char url[128];
+    char scratch[] = "/tmp/cclaw_bench_XXXXXX";
+    bool scratch_used = false;
+    const char* target_name = "provider";
+
+    if (load.target == LOADGEN_TARGET_PROVIDER) {
+        err = bench_create_provider(config, provider_name, capture, time_scale, &load.provider);
+        if (err != ERR_OK) {
+            fprintf(stderr, "Failed to create provider '%s': %s\n", provider_name, error_to_string(err));
+            return err;
+        }
+        target_name = provider_name;
+    } else if (load.target == LOADGEN_TARGET_WEBHOOK) {
+        if (!load.url && config->channels.webhook && config->channels.webhook->port) {
+            snprintf(url, sizeof(url), "http://127.0.0.1:%u/webhook", config->channels.webhook->port);
+            load.url = url;
+        }
+        if (!load.url) {
+            fprintf(stderr, "No webhook channel configured; pass --url\n");
+            return ERR_INVALID_ARGUMENT;
+        }
+        target_name = load.url;
+    } else {
+        // Synthetic entries stay out of the real memory unless asked for
+        config_t memory_config = *config;
+        if (!workspace) {
+            if (!mkdtemp(scratch)) return ERR_IO;
+            workspace = scratch;
+            scratch_used = true;
+        }
+        memory_config.workspace_dir = STR_VIEW(workspace);
+        err = memory_create_from_config(&memory_config, &load.memory);
+        if (err != ERR_OK) {
+            fprintf(stderr, "Failed to open memory backend: %s\n", error_to_string(err));
+            if (scratch_used) nftw(scratch, bench_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+            return err;
+        }
+        target_name = str_empty(config->memory.backend) ? "memory" : config->memory.backend.data;
+    }
+
+    if (!json) {
+        printf("Benchmarking %s: %u sessions, ", target_name, load.sessions);
+        if (load.turns) printf("%u turns each", load.turns);
+        if (load.turns && load.duration_ms) printf(", ");
+        if (load.duration_ms) printf("%.0f s", (double)load.duration_ms / 1000.0);
+        printf(", think %u ms", load.think_ms);
+        if (load.target != LOADGEN_TARGET_WEBHOOK) {
+            printf(", %s %.0f%%", load.target == LOADGEN_TARGET_MEMORY ? "stores" : "tools", load.tool_ratio * 100.0);
+        }
+        printf("%s\n\n", load.stream || load.target == LOADGEN_TARGET_MEMORY ? "" : ", buffered");
+    }
+
+    loadgen_report_t report;
+    err = loadgen_run(&load, &report);
+    if (err == ERR_OK && json) {
+        char* text = NULL;
+        err = loadgen_report_json(&report, &text);
+        if (err == ERR_OK) printf("%s\n", text);
+        free(text);
+    } else if (err == ERR_OK) {
+        loadgen_report_print(&report, stdout);
+    } else {
+        fprintf(stderr, "Benchmark failed: %s\n", error_to_string(err));
+    }
+
+    provider_free(load.provider);
+    memory_free(load.memory);
+    if (scratch_used) nftw(scratch, bench_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    return err;
+}
+
 // ============================================================================
 // Version and Help
 // ============================================================================
@@ -523,6 +803,7 @@ err_t cmd_help(const char* topic) {
         printf("  channel          Manage channels\n");
         printf("  cron             Manage scheduled tasks\n");
         printf("  doctor           Run diagnostics\n");
+        printf("  bench            Load test a provider, webhook or memory backend\n");
         printf("  version          Show version\n");
         printf("  help             Show this help\n");
         printf("\nOptions:\n");
@@ -535,6 +816,8 @@ err_t cmd_help(const char* topic) {
         printf("  cclaw agent -m \"Hello!\"\n");
         printf("  cclaw daemon start\n");
         printf("  cclaw status\n");
+    } else if (strcmp(topic, "bench") == 0) {
+        bench_usage();
     } else {
         printf("Help for '%s':\n\n", topic);
         printf("(Detailed help coming soon)\n");
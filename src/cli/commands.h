@@ -17,6 +17,7 @@ err_t cmd_channel(config_t* config, int argc, char** argv);
 err_t cmd_cron(config_t* config, int argc, char** argv);
 err_t cmd_doctor(config_t* config, int argc, char** argv);
 err_t cmd_tui(config_t* config, int argc, char** argv);
+err_t cmd_bench(config_t* config, int argc, char** argv);
 
 // Utility commands
 err_t cmd_version(void);
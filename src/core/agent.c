@@ -5,23 +5,33 @@
 #include "core/agent.h"
 #include "core/alloc.h"
 #include "core/channel.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "core/session_log.h"
+#include "utils/http.h"
+#include "runtime/docker_pool.h"
 #include "cclaw.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 #include <uuid/uuid.h>
 
 // ============================================================================
 // Internal Helpers
 // ============================================================================
 
-static str_t generate_uuid(void) {
+static void format_uuid(char out[37]) {
     uuid_t uuid;
-    char uuid_str[37];
     uuid_generate_random(uuid);
-    uuid_unparse_lower(uuid, uuid_str);
+    uuid_unparse_lower(uuid, out);
+}
+
+static str_t generate_uuid(void) {
+    char uuid_str[37];
+    format_uuid(uuid_str);
     return str_dup_cstr(uuid_str, NULL);
 }
 
@@ -48,7 +58,7 @@ static const char* message_type_to_string(agent_message_type_t type) {
 // ============================================================================
 
 agent_message_t* agent_message_create(agent_message_type_t type, const str_t* content) {
-    agent_message_t* msg = calloc(1, sizeof(agent_message_t));
+    agent_message_t* msg = sizeclass_calloc(sizeof(agent_message_t));
     if (!msg) return NULL;
 
     msg->id = generate_uuid();
@@ -56,9 +66,6 @@ agent_message_t* agent_message_create(agent_message_type_t type, const str_t* co
     msg->content = content ? str_dup(*content, NULL) : STR_NULL;
     msg->timestamp = get_timestamp_ms();
     msg->is_complete = true;
-    msg->children = NULL;
-    msg->child_count = 0;
-    msg->child_capacity = 0;
 
     return msg;
 }
@@ -66,54 +73,79 @@ agent_message_t* agent_message_create(agent_message_type_t type, const str_t* co
 void agent_message_free(agent_message_t* message) {
     if (!message) return;
 
-    free((void*)message->id.data);
-    free((void*)message->content.data);
-    free((void*)message->tool_name.data);
-    free((void*)message->tool_args.data);
-    free((void*)message->tool_result.data);
-    free((void*)message->model.data);
+    if (!message->log_borrowed && !message->strings_borrowed) {
+        free((void*)message->id.data);
+        free((void*)message->content.data);
+        free((void*)message->tool_name.data);
+        free((void*)message->tool_args.data);
+        free((void*)message->tool_result.data);
+        free((void*)message->tool_call_id.data);
+        free((void*)message->model.data);
+    }
 
-    free(message->children);
-    free(message);
+    // Store nodes are reclaimed with their session
+    if (message->node_id == 0) sizeclass_free(message, sizeof(agent_message_t));
 }
 
 void agent_message_add_child(agent_message_t* parent, agent_message_t* child) {
     if (!parent || !child) return;
 
-    // Ensure capacity
-    if (parent->child_count >= parent->child_capacity) {
-        uint32_t new_capacity = parent->child_capacity == 0 ? 4 : parent->child_capacity * 2;
-        agent_message_t** new_children = realloc(parent->children,
-                                                  sizeof(agent_message_t*) * new_capacity);
-        if (!new_children) return;
-
-        parent->children = new_children;
-        parent->child_capacity = new_capacity;
-    }
-
-    // Add child
-    parent->children[parent->child_count] = child;
     child->parent = parent;
-
-    // Link siblings
-    if (parent->child_count > 0) {
-        agent_message_t* prev = parent->children[parent->child_count - 1];
-        prev->next_sibling = child;
-        child->prev_sibling = prev;
+    child->prev_sibling = parent->last_child;
+    child->next_sibling = NULL;
+    if (parent->last_child) {
+        parent->last_child->next_sibling = child;
+    } else {
+        parent->first_child = child;
     }
-
+    parent->last_child = child;
     parent->child_count++;
 }
 
 void agent_message_tree_free(agent_message_t* root) {
     if (!root) return;
 
-    // Recursively free all children first
-    for (uint32_t i = 0; i < root->child_count; i++) {
-        agent_message_tree_free(root->children[i]);
+    // Postorder without a stack: descend to a leaf, free it, then move to
+    // its next sibling or back up to the parent. Nodes from a session's
+    // store are skipped here, but still walked for owned descendants.
+    agent_message_t* node = root;
+    while (node) {
+        while (node->first_child) node = node->first_child;
+
+        agent_message_t* next = NULL;
+        bool done = node == root;
+        if (!done) {
+            agent_message_t* up = node->parent;
+            up->first_child = node->next_sibling;
+            if (!up->first_child) up->last_child = NULL;
+            next = node->next_sibling ? node->next_sibling : up;
+        }
+        agent_message_free(node);
+        node = done ? NULL : next;
+    }
+}
+
+void agent_message_splice(agent_message_t* parent, agent_message_t* child, agent_message_t* inserted) {
+    if (!parent || !child || !inserted) return;
+
+    // inserted takes child's place in the sibling list
+    inserted->parent = parent;
+    inserted->prev_sibling = child->prev_sibling;
+    inserted->next_sibling = child->next_sibling;
+    if (inserted->prev_sibling) {
+        inserted->prev_sibling->next_sibling = inserted;
+    } else {
+        parent->first_child = inserted;
+    }
+    if (inserted->next_sibling) {
+        inserted->next_sibling->prev_sibling = inserted;
+    } else {
+        parent->last_child = inserted;
     }
 
-    agent_message_free(root);
+    child->prev_sibling = NULL;
+    child->next_sibling = NULL;
+    agent_message_add_child(inserted, child);
 }
 
 err_t agent_message_get_path(agent_message_t* from_root, agent_message_t* to_message,
@@ -171,9 +203,89 @@ static agent_session_t* session_create_internal(const str_t* name) {
     return session;
 }
 
+// Arena for one session's message strings; grows geometrically from here
+#define AGENT_SESSION_STRINGS_INITIAL (16 * 1024)
+
+agent_message_t* agent_session_node_alloc(agent_session_t* session) {
+    if (!session) return NULL;
+
+    agent_node_store_t* store = &session->nodes;
+    uint32_t index = store->node_count;
+    uint32_t slab = index / AGENT_NODE_SLAB_SIZE;
+    if (slab == store->slab_count) {
+        if (store->slab_count == store->slab_capacity) {
+            uint32_t new_capacity = store->slab_capacity == 0 ? 8 : store->slab_capacity * 2;
+            agent_message_t** slabs = realloc(store->slabs, new_capacity * sizeof(agent_message_t*));
+            if (!slabs) return NULL;
+            store->slabs = slabs;
+            store->slab_capacity = new_capacity;
+        }
+        store->slabs[slab] = calloc(AGENT_NODE_SLAB_SIZE, sizeof(agent_message_t));
+        if (!store->slabs[slab]) return NULL;
+        store->slab_count++;
+        alloc_tag_add(ALLOC_TAG_AGENT, AGENT_NODE_SLAB_SIZE * sizeof(agent_message_t));
+    }
+
+    agent_message_t* node = &store->slabs[slab][index % AGENT_NODE_SLAB_SIZE];
+    node->node_id = ++store->node_count;
+    return node;
+}
+
+static void node_store_free(agent_node_store_t* store) {
+    for (uint32_t i = 0; i < store->slab_count; i++) free(store->slabs[i]);
+    alloc_tag_sub(ALLOC_TAG_AGENT, store->slab_count * AGENT_NODE_SLAB_SIZE * sizeof(agent_message_t));
+    free(store->slabs);
+    if (store->strings) arena_destroy(store->strings);
+    memset(store, 0, sizeof(*store));
+}
+
+str_t agent_session_strdup(agent_session_t* session, str_t s) {
+    if (!session || !s.data) return STR_NULL;
+    if (!session->nodes.strings) {
+        session->nodes.strings = arena_create(AGENT_SESSION_STRINGS_INITIAL);
+        if (!session->nodes.strings) return STR_NULL;
+        arena_set_tag(session->nodes.strings, ALLOC_TAG_AGENT);
+    }
+    return str_dup(s, &session->nodes.strings->base);
+}
+
+agent_message_t* agent_session_message_create(agent_session_t* session, agent_message_type_t type,
+                                              const str_t* content) {
+    if (!session) return NULL;
+
+    char uuid_str[37];
+    format_uuid(uuid_str);
+
+    str_t id = agent_session_strdup(session, (str_t){ .data = uuid_str, .len = 36 });
+    str_t text = content ? agent_session_strdup(session, *content) : STR_NULL;
+    if (!id.data || (content && content->len && !text.data)) return NULL;
+
+    agent_message_t* msg = agent_session_node_alloc(session);
+    if (!msg) return NULL;
+
+    msg->id = id;
+    msg->type = type;
+    msg->content = text;
+    msg->timestamp = get_timestamp_ms();
+    msg->is_complete = true;
+    msg->strings_borrowed = true;
+    return msg;
+}
+
+agent_message_t* agent_session_node(const agent_session_t* session, uint32_t node_id) {
+    if (!session || node_id == 0 || node_id > session->nodes.node_count) return NULL;
+    uint32_t index = node_id - 1;
+    return &session->nodes.slabs[index / AGENT_NODE_SLAB_SIZE][index % AGENT_NODE_SLAB_SIZE];
+}
+
+static void summary_job_release(agent_summary_job_t* job);
+
 static void session_free(agent_session_t* session) {
     if (!session) return;
 
+    // The job never touches the tree, but it must finish before we go
+    summary_job_release(session->summary_job);
+
     free((void*)session->id.data);
     free((void*)session->name.data);
     free((void*)session->working_directory.data);
@@ -183,8 +295,17 @@ static void session_free(agent_session_t* session) {
     if (session->root) {
         agent_message_tree_free(session->root);
     }
+    // After the tree: loaded messages borrow the log's mapping
+    session_log_close(session->log);
+    node_store_free(&session->nodes);
 
     free(session->history);
+    free(session->context);
+    free(session->context_nodes);
+    free(session->window);
+    if (session->scratch) {
+        arena_destroy(session->scratch);
+    }
     free(session);
 }
 
@@ -202,12 +323,17 @@ agent_config_t agent_config_default(void) {
         .max_context_messages = AGENT_MAX_CONTEXT_MESSAGES_DEFAULT,
         .context_window_tokens = AGENT_CONTEXT_WINDOW_TOKENS_DEFAULT,
         .enable_summarization = true,
+        .recall_top_k = 0,
+        .recall_token_budget = AGENT_RECALL_TOKEN_BUDGET_DEFAULT,
 
         .enable_shell_tool = true,
         .enable_file_tools = true,
         .enable_memory_tools = true,
         .allowed_shell_commands = STR_NULL,
         .workspace_root = STR_NULL,
+        .max_parallel_tools = AGENT_MAX_PARALLEL_TOOLS_DEFAULT,
+        .tool_timeout_ms = AGENT_TOOL_TIMEOUT_MS_DEFAULT,
+        .speculative_tools = true,
 
         .enable_extensions = true,
         .extensions_dir = STR_NULL,
@@ -225,129 +351,1015 @@ void agent_config_free(agent_config_t* config) {
     free((void*)config->allowed_shell_commands.data);
     free((void*)config->workspace_root.data);
     free((void*)config->extensions_dir.data);
+    free((void*)config->sessions_dir.data);
 }
 
 // ============================================================================
 // Context Building
 // ============================================================================
 
-static err_t build_context_messages(agent_t* agent, agent_session_t* session,
-                                    chat_message_t** out_messages, uint32_t* out_count) {
-    if (!agent || !session || !out_messages || !out_count) {
+static chat_role_t message_chat_role(agent_message_type_t type) {
+    switch (type) {
+        case AGENT_MSG_USER:
+            return CHAT_ROLE_USER;
+        case AGENT_MSG_ASSISTANT:
+        case AGENT_MSG_SUMMARY:
+        case AGENT_MSG_TOOL_CALL:
+            return CHAT_ROLE_ASSISTANT;
+        case AGENT_MSG_TOOL_RESULT:
+            return CHAT_ROLE_TOOL;
+        default:
+            return CHAT_ROLE_SYSTEM;
+    }
+}
+
+static bool context_reserve(agent_session_t* session, uint32_t count) {
+    if (count <= session->context_capacity) return true;
+
+    uint32_t new_capacity = session->context_capacity ? session->context_capacity : 16;
+    while (new_capacity < count) new_capacity *= 2;
+
+    chat_message_t* context = realloc(session->context, new_capacity * sizeof(chat_message_t));
+    if (!context) return false;
+    session->context = context;
+
+    agent_message_t** nodes = realloc(session->context_nodes, new_capacity * sizeof(agent_message_t*));
+    if (!nodes) return false;
+    session->context_nodes = nodes;
+
+    session->context_capacity = new_capacity;
+    return true;
+}
+
+err_t agent_session_to_chat_messages(agent_session_t* session,
+                                     chat_message_t** out_messages,
+                                     uint32_t* out_count) {
+    if (!session || !out_messages || !out_count) {
         return ERR_INVALID_ARGUMENT;
     }
 
-    // Count messages in current path
-    uint32_t path_count = 0;
-    agent_message_t* current = session->current;
-    while (current) {
-        path_count++;
-        current = current->parent;
+    // Walk up from current until we meet the cached tip; when a turn only
+    // appended that is a few steps, otherwise (branch switch, navigation)
+    // it is the whole path and the cache is rebuilt from slot 1
+    agent_message_t* tip = session->context_count > 1 ? session->context_nodes[session->context_count - 1] : NULL;
+    uint32_t added = 0;
+    agent_message_t* node = session->current;
+    while (node && node != tip) {
+        added++;
+        node = node->parent;
     }
 
-    // Allocate chat messages (+1 for system prompt)
-    chat_message_t* messages = calloc(path_count + 1, sizeof(chat_message_t));
-    if (!messages) return ERR_OUT_OF_MEMORY;
+    uint32_t base = (tip && node == tip) ? session->context_count : 1;
+    if (!context_reserve(session, base + added)) return ERR_OUT_OF_MEMORY;
 
     // System prompt
-    messages[0].role = CHAT_ROLE_SYSTEM;
     // TODO: Build dynamic system prompt
-    messages[0].content = str_dup_cstr(AGENT_SYSTEM_PROMPT_EXTENDED, NULL);
-
-    // Build path from root to current
-    uint32_t idx = 1;
-    current = session->root;
-    while (current && idx <= path_count) {
-        chat_role_t role;
-        switch (current->type) {
-            case AGENT_MSG_USER:
-                role = CHAT_ROLE_USER;
-                break;
-            case AGENT_MSG_ASSISTANT:
-            case AGENT_MSG_SUMMARY:
-                role = CHAT_ROLE_ASSISTANT;
-                break;
-            case AGENT_MSG_TOOL_CALL:
-            case AGENT_MSG_TOOL_RESULT:
-                role = CHAT_ROLE_TOOL;
-                break;
-            default:
-                role = CHAT_ROLE_SYSTEM;
-                break;
+    session->context[0] = (chat_message_t){
+        .role = CHAT_ROLE_SYSTEM,
+        .content = STR_LIT(AGENT_SYSTEM_PROMPT_EXTENDED)
+    };
+    session->context_nodes[0] = NULL;
+
+    // Fill the new slots back to front from the parent chain
+    node = session->current;
+    for (uint32_t i = base + added; i > base; i--) {
+        session->context[i - 1] = (chat_message_t){
+            .role = message_chat_role(node->type),
+            .content = node->content,
+            .tool_calls = node->type == AGENT_MSG_TOOL_CALL ? node->tool_args : STR_NULL,
+            .tool_call_id = node->tool_call_id
+        };
+        session->context_nodes[i - 1] = node;
+        node = node->parent;
+    }
+    session->context_count = base + added;
+
+    *out_messages = session->context;
+    *out_count = session->context_count;
+    return ERR_OK;
+}
+
+uint32_t agent_message_tokens(agent_message_t* message, token_family_t family) {
+    if (!message) return 0;
+    if ((unsigned)family >= TOKEN_FAMILY_COUNT) family = TOKEN_FAMILY_GENERIC;
+    if (message->token_counts[family]) return message->token_counts[family];
+
+    uint32_t tokens = TOKEN_MESSAGE_OVERHEAD + token_estimate(message->content, family);
+    if (message->type == AGENT_MSG_TOOL_CALL) {
+        tokens += token_estimate(message->tool_args, family);
+    }
+    tokens += token_estimate(message->tool_call_id, family);
+
+    // Streaming content is still growing
+    if (message->is_complete) {
+        message->token_counts[family] = tokens;
+    }
+    return tokens;
+}
+
+static bool window_reserve(agent_session_t* session, uint32_t count) {
+    if (count <= session->window_capacity) return true;
+
+    uint32_t new_capacity = session->window_capacity ? session->window_capacity : 16;
+    while (new_capacity < count) new_capacity *= 2;
+
+    chat_message_t* window = realloc(session->window, new_capacity * sizeof(chat_message_t));
+    if (!window) return false;
+    session->window = window;
+    session->window_capacity = new_capacity;
+    return true;
+}
+
+err_t agent_session_window(agent_session_t* session, token_family_t family,
+                           uint32_t max_tokens, uint32_t max_messages,
+                           chat_message_t** out_messages, uint32_t* out_count) {
+    if (!session || !out_messages || !out_count) return ERR_INVALID_ARGUMENT;
+
+    chat_message_t* path = NULL;
+    uint32_t path_count = 0;
+    err_t err = agent_session_to_chat_messages(session, &path, &path_count);
+    if (err != ERR_OK) return err;
+
+    agent_message_t** nodes = session->context_nodes;
+
+    // A summary stands in for everything before it
+    uint32_t summary = 0;
+    for (uint32_t i = path_count; i > 1; i--) {
+        if (nodes[i - 1]->type == AGENT_MSG_SUMMARY) {
+            summary = i - 1;
+            break;
         }
+    }
+    uint32_t first = summary ? summary + 1 : 1;
 
-        messages[idx].role = role;
-        messages[idx].content = str_dup(current->content, NULL);
+    uint64_t used = TOKEN_MESSAGE_OVERHEAD + token_estimate(path[0].content, family);
+    if (summary) used += agent_message_tokens(nodes[summary], family);
 
-        // Navigate to next in path
-        if (current == session->current) break;
+    // Keep the previous start while everything from it still fits: the
+    // request prefix then stays byte-identical and provider caches hit
+    uint32_t start = path_count;
+    for (uint32_t i = first; session->window_anchor && i < path_count; i++) {
+        if (nodes[i] != session->window_anchor) continue;
 
-        // Find which child leads to current
-        for (uint32_t i = 0; i < current->child_count; i++) {
-            agent_message_t* child = current->children[i];
-            agent_message_t* desc = child;
-            while (desc && desc != session->current) {
-                desc = desc->children && desc->child_count > 0 ? desc->children[0] : NULL;
-            }
-            if (desc == session->current || child == session->current) {
-                current = child;
-                break;
-            }
+        uint64_t total = used;
+        for (uint32_t j = i; j < path_count; j++) {
+            total += agent_message_tokens(nodes[j], family);
+        }
+        if ((!max_tokens || total <= max_tokens) && (!max_messages || path_count - i <= max_messages)) {
+            start = i;
+        }
+        break;
+    }
+
+    // Otherwise refill to part of the budget so the new start can hold
+    // for a few turns before sliding again
+    if (start == path_count) {
+        uint64_t token_limit = 0;
+        if (max_tokens) {
+            token_limit = max_tokens > used ? used + (max_tokens - used) * AGENT_WINDOW_REFILL_PERCENT / 100 : used;
+        }
+        uint32_t message_limit = max_messages ? max_messages * AGENT_WINDOW_REFILL_PERCENT / 100 : 0;
+        if (max_messages && message_limit == 0) message_limit = 1;
+
+        uint32_t kept = 0;
+        while (start > first) {
+            uint32_t tokens = agent_message_tokens(nodes[start - 1], family);
+            bool over = (token_limit && used + tokens > token_limit) || (message_limit && kept >= message_limit);
+            if (over && start < path_count) break;
+            used += tokens;
+            start--;
+            kept++;
+        }
+
+        // Results are only valid right after their call
+        while (start > first && start < path_count && nodes[start]->type == AGENT_MSG_TOOL_RESULT) {
+            start--;
+        }
+    }
+    session->window_anchor = start < path_count ? nodes[start] : NULL;
+
+    uint32_t count = (summary ? 2u : 1u) + (path_count - start);
+    if (!window_reserve(session, count)) return ERR_OUT_OF_MEMORY;
+
+    // Breakpoints: system prompt (with tools ahead of it), the summary, and
+    // the newest message so the next turn reuses this whole request
+    uint32_t slot = 0;
+    session->window[slot] = path[0];
+    session->window[slot++].cache_breakpoint = true;
+    if (summary) {
+        session->window[slot] = path[summary];
+        session->window[slot++].cache_breakpoint = true;
+    }
+    memcpy(session->window + slot, path + start, (path_count - start) * sizeof(chat_message_t));
+    session->window[count - 1].cache_breakpoint = true;
+
+    *out_messages = session->window;
+    *out_count = count;
+    return ERR_OK;
+}
+
+static token_family_t agent_token_family(const agent_context_t* ctx) {
+    if (!ctx->provider || !ctx->provider->vtable || !ctx->provider->vtable->get_name) {
+        return TOKEN_FAMILY_GENERIC;
+    }
+    return token_family_for_provider(ctx->provider->vtable->get_name());
+}
+
+static const tool_def_t* agent_tool_defs(agent_context_t* ctx, uint32_t* out_count);
+
+// Fit the history into what the context window leaves after tool schemas
+// and the reserved tokens
+static err_t build_context_messages(agent_t* agent, agent_session_t* session, uint32_t reserved,
+                                    chat_message_t** out_messages, uint32_t* out_count) {
+    if (!agent) return ERR_INVALID_ARGUMENT;
+    TRACE_SCOPE("agent.build_context");
+
+    agent_context_t* ctx = agent->ctx;
+    uint32_t tool_def_count = 0;
+    agent_tool_defs(ctx, &tool_def_count);
+
+    uint32_t budget = ctx->config.context_window_tokens;
+    if (budget) {
+        uint64_t taken = (uint64_t)ctx->tool_defs_tokens + reserved;
+        budget = budget > taken ? (uint32_t)(budget - taken) : 1;
+    }
+
+    return agent_session_window(session, agent_token_family(ctx), budget,
+                                ctx->config.max_context_messages, out_messages, out_count);
+}
+
+// ============================================================================
+// Summarization
+// ============================================================================
+
+// Snapshot of a prefix being summarized; owns everything the thread reads
+struct agent_summary_job_t {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool done;
+    provider_t* provider;
+    char* model;                   // NULL = provider default
+    str_t transcript;
+    agent_message_t* fold_after;   // Last message the summary covers
+    str_t summary;
+    err_t err;
+};
+
+static const char* summary_role_label(agent_message_type_t type) {
+    switch (type) {
+        case AGENT_MSG_USER: return "User";
+        case AGENT_MSG_ASSISTANT: return "Assistant";
+        case AGENT_MSG_TOOL_CALL: return "Tool call";
+        case AGENT_MSG_TOOL_RESULT: return "Tool result";
+        case AGENT_MSG_SUMMARY: return "Earlier summary";
+        default: return "System";
+    }
+}
+
+// "Role: content" blocks for from..to along the parent chain
+static err_t summary_transcript(agent_message_t* from, agent_message_t* to, str_t* out_transcript) {
+    size_t total = 0;
+    agent_message_t* node = to;
+    while (node) {
+        total += strlen(summary_role_label(node->type)) + 4 + node->content.len;
+        if (node->type == AGENT_MSG_TOOL_CALL) total += node->tool_args.len + 1;
+        if (node == from) break;
+        node = node->parent;
+    }
+    if (!node) return ERR_INVALID_ARGUMENT;
+
+    char* buffer = malloc(total + 1);
+    if (!buffer) return ERR_OUT_OF_MEMORY;
+
+    // Filled back to front while walking up again
+    size_t pos = total;
+    buffer[total] = '\0';
+    for (node = to; ; node = node->parent) {
+        const char* label = summary_role_label(node->type);
+        size_t label_len = strlen(label);
+        size_t block = label_len + 4 + node->content.len;
+        if (node->type == AGENT_MSG_TOOL_CALL) block += node->tool_args.len + 1;
+
+        pos -= block;
+        char* out = buffer + pos;
+        memcpy(out, label, label_len);
+        out += label_len;
+        *out++ = ':';
+        *out++ = ' ';
+        if (node->content.len) memcpy(out, node->content.data, node->content.len);
+        out += node->content.len;
+        if (node->type == AGENT_MSG_TOOL_CALL) {
+            *out++ = ' ';
+            if (node->tool_args.len) memcpy(out, node->tool_args.data, node->tool_args.len);
+            out += node->tool_args.len;
+        }
+        *out++ = '\n';
+        *out++ = '\n';
+
+        if (node == from) break;
+    }
+
+    *out_transcript = (str_t){ .data = buffer, .len = (uint32_t)total };
+    return ERR_OK;
+}
+
+static err_t summary_request(provider_t* provider, const char* model, str_t transcript, str_t* out_summary) {
+    if (!provider || !provider->vtable || !provider->vtable->chat) return ERR_NOT_INITIALIZED;
+
+    // Sessions summarizing the same transcript share one request
+    chat_message_t request[2] = {
+        { .role = CHAT_ROLE_SYSTEM, .content = STR_LIT(AGENT_SUMMARY_PROMPT) },
+        { .role = CHAT_ROLE_USER, .content = transcript }
+    };
+
+    chat_response_t* response = NULL;
+    err_t err = provider_chat_hedged(provider, NULL, request, 2, NULL, 0, model, 0.2, &response);
+    if (err != ERR_OK) return err;
+
+    err = str_empty(response->content) ? ERR_PROVIDER : ERR_OK;
+    if (err == ERR_OK) {
+        *out_summary = str_dup(response->content, NULL);
+    }
+    chat_response_free(response);
+    return err;
+}
+
+static provider_t* summary_provider(const agent_context_t* ctx) {
+    return ctx->summary_provider ? ctx->summary_provider : ctx->provider;
+}
+
+static const char* summary_model(const agent_context_t* ctx, const agent_session_t* session) {
+    if (!str_empty(ctx->summary_model)) return ctx->summary_model.data;
+    return str_empty(session->model) ? NULL : session->model.data;
+}
+
+err_t agent_summarize_conversation(agent_t* agent, agent_session_t* session,
+                                   agent_message_t* from_message,
+                                   agent_message_t* to_message,
+                                   str_t* out_summary) {
+    if (!agent || !session || !from_message || !to_message || !out_summary) return ERR_INVALID_ARGUMENT;
+
+    str_t transcript = STR_NULL;
+    err_t err = summary_transcript(from_message, to_message, &transcript);
+    if (err != ERR_OK) return err;
+
+    err = summary_request(summary_provider(agent->ctx), summary_model(agent->ctx, session),
+                          transcript, out_summary);
+    free((void*)transcript.data);
+    return err;
+}
+
+void agent_set_summarizer(agent_t* agent, provider_t* provider, const str_t* model) {
+    if (!agent) return;
+
+    agent->ctx->summary_provider = provider;
+    free((void*)agent->ctx->summary_model.data);
+    agent->ctx->summary_model = (model && !str_empty(*model)) ? str_dup(*model, NULL) : STR_NULL;
+}
+
+static void* summary_thread_main(void* arg) {
+    agent_summary_job_t* job = (agent_summary_job_t*)arg;
+
+    str_t summary = STR_NULL;
+    err_t err = summary_request(job->provider, job->model, job->transcript, &summary);
+
+    pthread_mutex_lock(&job->lock);
+    job->summary = summary;
+    job->err = err;
+    job->done = true;
+    pthread_mutex_unlock(&job->lock);
+
+    return NULL;
+}
+
+static void summary_job_free(agent_summary_job_t* job) {
+    pthread_mutex_destroy(&job->lock);
+    free(job->model);
+    free((void*)job->transcript.data);
+    free((void*)job->summary.data);
+    free(job);
+}
+
+static void summary_job_release(agent_summary_job_t* job) {
+    if (!job) return;
+
+    pthread_join(job->thread, NULL);
+    summary_job_free(job);
+}
+
+err_t agent_summary_schedule(agent_t* agent, agent_session_t* session) {
+    if (!agent || !session) return ERR_INVALID_ARGUMENT;
+
+    agent_context_t* ctx = agent->ctx;
+    provider_t* provider = summary_provider(ctx);
+    if (!ctx->config.enable_summarization || !ctx->config.context_window_tokens ||
+        session->summary_job || !provider) {
+        return ERR_OK;
+    }
+
+    chat_message_t* path = NULL;
+    uint32_t count = 0;
+    err_t err = agent_session_to_chat_messages(session, &path, &count);
+    if (err != ERR_OK) return err;
+    agent_message_t** nodes = session->context_nodes;
+
+    // Everything since (and including) the latest summary
+    uint32_t first = 1;
+    for (uint32_t i = count; i > 1; i--) {
+        if (nodes[i - 1]->type == AGENT_MSG_SUMMARY) {
+            first = i - 1;
+            break;
         }
-        idx++;
     }
 
-    *out_messages = messages;
-    *out_count = path_count + 1;
+    token_family_t family = agent_token_family(ctx);
+    uint64_t tokens = 0;
+    for (uint32_t i = first; i < count; i++) {
+        tokens += agent_message_tokens(nodes[i], family);
+    }
+    if (tokens * 100 <= (uint64_t)ctx->config.context_window_tokens * AGENT_SUMMARY_TRIGGER_PERCENT) {
+        return ERR_OK;
+    }
+
+    // Keep the newest messages verbatim and never end inside a tool exchange
+    if (count <= first + AGENT_SUMMARY_KEEP_RECENT + 1) return ERR_OK;
+    uint32_t end = count - AGENT_SUMMARY_KEEP_RECENT - 1;
+    while (end > first && (nodes[end]->type == AGENT_MSG_TOOL_CALL ||
+                           (end + 1 < count && nodes[end + 1]->type == AGENT_MSG_TOOL_RESULT))) {
+        end--;
+    }
+    if (nodes[end]->type == AGENT_MSG_SUMMARY) return ERR_OK;
+
+    agent_summary_job_t* job = calloc(1, sizeof(agent_summary_job_t));
+    if (!job) return ERR_OUT_OF_MEMORY;
+
+    err = summary_transcript(nodes[first], nodes[end], &job->transcript);
+    const char* model = summary_model(ctx, session);
+    job->model = model ? strdup(model) : NULL;
+    if (err != ERR_OK || (model && !job->model)) {
+        free(job->model);
+        free((void*)job->transcript.data);
+        free(job);
+        return err != ERR_OK ? err : ERR_OUT_OF_MEMORY;
+    }
+
+    job->provider = provider;
+    job->fold_after = nodes[end];
+    pthread_mutex_init(&job->lock, NULL);
+
+    if (pthread_create(&job->thread, NULL, summary_thread_main, job) != 0) {
+        summary_job_free(job);
+        return ERR_RUNTIME;
+    }
+
+    session->summary_job = job;
     return ERR_OK;
 }
 
-// ============================================================================
-// Tool Execution
-// ============================================================================
 
-static err_t parse_tool_calls(const str_t* content, tool_call_t** out_calls, uint32_t* out_count) {
-    // TODO: Parse JSON tool calls from assistant response
-    // This is a simplified placeholder
-    *out_calls = NULL;
-    *out_count = 0;
+bool agent_summary_collect(agent_t* agent, agent_session_t* session, bool wait) {
+    if (!agent || !session || !session->summary_job) return false;
+
+    agent_summary_job_t* job = session->summary_job;
+    if (!wait) {
+        pthread_mutex_lock(&job->lock);
+        bool done = job->done;
+        pthread_mutex_unlock(&job->lock);
+        if (!done) return false;
+    }
+
+    pthread_join(job->thread, NULL);
+    session->summary_job = NULL;
+
+    // Only applies if the folded prefix is still behind the active message
+    agent_message_t* child = session->current;
+    while (child && child->parent != job->fold_after) {
+        child = child->parent;
+    }
+
+    bool spliced = false;
+    if (job->err == ERR_OK && child) {
+        agent_message_t* summary = agent_session_message_create(session, AGENT_MSG_SUMMARY, &job->summary);
+        if (summary && summary->content.data) {
+            agent_message_splice(job->fold_after, child, summary);
+            if (session->log) session_log_append_splice(session->log, summary, child);
+            session->context_count = 0;    // Path changed; rebuild the cache
+            spliced = true;
+        } else {
+            agent_message_free(summary);
+        }
+    }
+
+    summary_job_free(job);
+    return spliced;
+}
+
+// ============================================================================
+// Tool Execution
+// ============================================================================
+
+// Turn scratch for the session, created on first use
+static arena_allocator_t* session_scratch(agent_session_t* session) {
+    if (!session->scratch) {
+        session->scratch = arena_create(AGENT_TURN_ARENA_SIZE);
+        arena_set_tag(session->scratch, ALLOC_TAG_AGENT);
+    }
+    return session->scratch;
+}
+
+static err_t parse_tool_calls(const str_t* content, arena_allocator_t* scratch,
+                              tool_call_t** out_calls, uint32_t* out_count) {
+    if (!scratch) return ERR_OUT_OF_MEMORY;
+    return provider_parse_tool_calls(*content, scratch, out_calls, out_count);
+}
+
+// ============================================================================
+// Tool Dispatch
+// ============================================================================
+
+static uint32_t tool_name_hash(str_t name) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < name.len; i++) {
+        hash ^= (unsigned char)name.data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Returns the slot holding name, or the empty slot where it would go
+static uint32_t tool_slot_find(const agent_context_t* ctx, str_t name) {
+    uint32_t mask = ctx->tool_slot_count - 1;
+    uint32_t slot = tool_name_hash(name) & mask;
+    while (ctx->tool_slots[slot]) {
+        tool_t* tool = ctx->tools[ctx->tool_slots[slot] - 1];
+        if (str_equal(tool->vtable->get_name(), name)) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Sized for at most half full; the first tool with a given name wins
+static err_t tool_index_rebuild(agent_context_t* ctx) {
+    uint32_t slot_count = 16;
+    while (slot_count < ctx->tool_count * 2) slot_count *= 2;
+
+    uint32_t* slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) return ERR_OUT_OF_MEMORY;
+
+    free(ctx->tool_slots);
+    ctx->tool_slots = slots;
+    ctx->tool_slot_count = slot_count;
+
+    for (uint32_t i = 0; i < ctx->tool_count; i++) {
+        uint32_t slot = tool_slot_find(ctx, ctx->tools[i]->vtable->get_name());
+        if (!slots[slot]) slots[slot] = i + 1;
+    }
+    return ERR_OK;
+}
+
+static tool_t* find_tool(const agent_context_t* ctx, str_t name) {
+    if (ctx->tool_slot_count == 0 || str_empty(name)) return NULL;
+
+    uint32_t slot = tool_slot_find(ctx, name);
+    return ctx->tool_slots[slot] ? ctx->tools[ctx->tool_slots[slot] - 1] : NULL;
+}
+
+static bool tool_allowed(const agent_context_t* ctx, const tool_t* tool) {
+    return !tool->vtable->allowed_in_autonomous ||
+           tool->vtable->allowed_in_autonomous(ctx->config.autonomy_level);
+}
+
+// Resolve a call into a job; unknown or disallowed tools get a preset error
+static void prepare_tool_job(const agent_context_t* ctx, str_t name, str_t args, tool_job_t* job) {
+    job->tool = find_tool(ctx, name);
+    job->args = args;
+    job->result = tool_result_create();
+    job->err = ERR_OK;
+
+    if (!job->tool) {
+        const str_t unknown = STR_LIT("Unknown tool");
+        job->err = ERR_NOT_FOUND;
+        tool_result_set_error(&job->result, &unknown);
+    } else if (!tool_allowed(ctx, job->tool)) {
+        const str_t denied = STR_LIT("Tool not allowed at this autonomy level");
+        job->tool = NULL;
+        job->err = ERR_PERMISSION_DENIED;
+        tool_result_set_error(&job->result, &denied);
+    }
+}
+
+// Shared by every session; created on first use. NULL when tools run
+// sequentially or the workers could not be started.
+static tool_pool_t* agent_tool_pool(agent_context_t* ctx) {
+    if (ctx->config.max_parallel_tools == 0) return NULL;
+    tool_pool_t* pool = __atomic_load_n(&ctx->tool_pool, __ATOMIC_ACQUIRE);
+    if (!pool) {
+        pthread_mutex_lock(&ctx->shared_lock);
+        if (!ctx->tool_pool && tool_pool_create(ctx->config.max_parallel_tools, &pool) == ERR_OK) {
+            __atomic_store_n(&ctx->tool_pool, pool, __ATOMIC_RELEASE);
+        }
+        pool = ctx->tool_pool;
+        pthread_mutex_unlock(&ctx->shared_lock);
+    }
+    return pool;
+}
+
+// Runs inline only when there is nothing to overlap and no deadline to enforce
+static void run_tool_jobs(agent_context_t* ctx, tool_job_t* jobs, uint32_t count) {
+    uint32_t runnable = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (jobs[i].tool) runnable++;
+    }
+    if (runnable == 0) return;
+
+    bool pooled = runnable > 1 || ctx->config.tool_timeout_ms > 0;
+    tool_pool_t* pool = pooled ? agent_tool_pool(ctx) : NULL;
+    if (pool && tool_pool_run(pool, jobs, count, ctx->config.tool_timeout_ms) == ERR_OK) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!jobs[i].tool) continue;
+        jobs[i].err = tool_execute(jobs[i].tool, &jobs[i].args, &jobs[i].result);
+    }
+}
+
+static const tool_def_t* tool_defs_rebuild(agent_context_t* ctx, uint32_t* out_count);
+
+// Definitions offered to the model, serialized on first use after a change
+static const tool_def_t* agent_tool_defs(agent_context_t* ctx, uint32_t* out_count) {
+    if (__atomic_load_n(&ctx->tool_defs_valid, __ATOMIC_ACQUIRE) &&
+        ctx->tool_defs_level == ctx->config.autonomy_level) {
+        *out_count = ctx->tool_def_count;
+        return ctx->tool_defs;
+    }
+
+    pthread_mutex_lock(&ctx->shared_lock);
+    const tool_def_t* defs = tool_defs_rebuild(ctx, out_count);
+    pthread_mutex_unlock(&ctx->shared_lock);
+    return defs;
+}
+
+static const tool_def_t* tool_defs_rebuild(agent_context_t* ctx, uint32_t* out_count) {
+    // Another turn may have rebuilt them while we waited
+    if (ctx->tool_defs_valid && ctx->tool_defs_level == ctx->config.autonomy_level) {
+        *out_count = ctx->tool_def_count;
+        return ctx->tool_defs;
+    }
+
+    tool_def_array_free(ctx->tool_defs, ctx->tool_def_count);
+    ctx->tool_defs = NULL;
+    ctx->tool_def_count = 0;
+    ctx->tool_defs_valid = false;
+    *out_count = 0;
+
+    if (ctx->tool_count > 0) {
+        ctx->tool_defs = calloc(ctx->tool_count, sizeof(tool_def_t));
+        if (!ctx->tool_defs) return NULL;
+    }
+
+    for (uint32_t i = 0; i < ctx->tool_count; i++) {
+        const tool_vtable_t* vtable = ctx->tools[i]->vtable;
+        if (!tool_allowed(ctx, ctx->tools[i])) continue;
+
+        tool_def_t* def = &ctx->tool_defs[ctx->tool_def_count++];
+        def->name = str_dup(vtable->get_name(), NULL);
+        def->description = vtable->get_description ? str_dup(vtable->get_description(), NULL) : STR_NULL;
+        def->parameters = vtable->get_parameters_schema ? str_dup(vtable->get_parameters_schema(), NULL) : STR_NULL;
+        tool_def_serialize(def);
+    }
+
+    token_family_t family = agent_token_family(ctx);
+    ctx->tool_defs_tokens = 0;
+    for (uint32_t i = 0; i < ctx->tool_def_count; i++) {
+        ctx->tool_defs_tokens += token_estimate(ctx->tool_defs[i].json[TOOL_DIALECT_OPENAI], family);
+    }
+
+    ctx->tool_defs_level = ctx->config.autonomy_level;
+    __atomic_store_n(&ctx->tool_defs_valid, true, __ATOMIC_RELEASE);
+    *out_count = ctx->tool_def_count;
+    return ctx->tool_defs;
+}
+
+static str_t tool_job_output(const tool_job_t* job) {
+    return (job->err == ERR_OK && job->result.success) ? job->result.content : job->result.error_message;
+}
+
+// ============================================================================
+// Speculative Tool Calls
+// ============================================================================
+
+// A pure tool whose arguments close while the message is still streaming
+// is started on the pool right away. If the finished message carries the
+// same call (id, name and arguments) its result is taken; otherwise the
+// call is dropped and whatever the message asked for runs as usual.
+typedef struct tool_speculation_t {
+    uint32_t index;            // Stream tool_index
+    tool_t* tool;
+    str_t id;
+    str_t name;
+    str_t args;
+    tool_task_t* task;         // NULL once collected
+} tool_speculation_t;
+
+typedef struct tool_speculation_set_t {
+    agent_context_t* ctx;
+    tool_pool_t* pool;
+    tool_speculation_t* items;
+    uint32_t count;
+    uint32_t cap;
+} tool_speculation_set_t;
+
+static void speculation_start(tool_speculation_set_t* set, const tool_call_builder_t* builder, uint32_t index) {
+    const tool_call_builder_slot_t* slot = &builder->slots[index];
+    if (!slot->closed || !slot->name) return;
+    for (uint32_t i = 0; i < set->count; i++) {
+        if (set->items[i].index == index) return;
+    }
+
+    tool_t* tool = find_tool(set->ctx, STR_VIEW(slot->name));
+    if (!tool || !tool->vtable->is_pure || !tool->vtable->is_pure() || !tool_allowed(set->ctx, tool)) return;
+
+    if (set->count == set->cap) {
+        uint32_t cap = set->cap ? set->cap * 2 : 4;
+        tool_speculation_t* items = realloc(set->items, cap * sizeof(tool_speculation_t));
+        if (!items) return;
+        set->items = items;
+        set->cap = cap;
+    }
+
+    tool_speculation_t* spec = &set->items[set->count];
+    *spec = (tool_speculation_t){ .index = index, .tool = tool };
+    spec->id = str_dup_cstr(slot->id ? slot->id : "", NULL);
+    spec->name = str_dup_cstr(slot->name, NULL);
+    spec->args = str_dup((str_t){ .data = slot->arguments, .len = (uint32_t)slot->arguments_len }, NULL);
+    if (!spec->id.data || !spec->name.data || !spec->args.data ||
+        tool_pool_submit(set->pool, tool, spec->args, &spec->task) != ERR_OK) {
+        free((void*)spec->id.data);
+        free((void*)spec->name.data);
+        free((void*)spec->args.data);
+        return;
+    }
+    set->count++;
+}
+
+// The started call matching this one, if any; its job is skipped by
+// run_tool_jobs and filled in by speculation_collect
+static tool_speculation_t* speculation_match(tool_speculation_set_t* set, const tool_call_t* call, tool_job_t* job) {
+    if (!job->tool) return NULL;
+    for (uint32_t i = 0; i < set->count; i++) {
+        tool_speculation_t* spec = &set->items[i];
+        if (spec->task && spec->tool == job->tool && str_equal(spec->id, call->id) &&
+            str_equal(spec->name, call->name) && str_equal(spec->args, call->arguments)) {
+            job->tool = NULL;
+            return spec;
+        }
+    }
+    return NULL;
+}
+
+static void speculation_collect(tool_speculation_set_t* set, tool_speculation_t* spec, tool_job_t* job) {
+    tool_pool_collect(set->pool, spec->task, set->ctx->config.tool_timeout_ms, job);
+    spec->task = NULL;
+    metric_inc(metric_get(&METRIC_TOOL_SPECULATION, spec->name, STR_LIT("hit")), 1);
+}
+
+// Drops every call nobody collected
+static void speculation_release(tool_speculation_set_t* set) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        tool_speculation_t* spec = &set->items[i];
+        if (spec->task) {
+            tool_pool_discard(set->pool, spec->task);
+            metric_inc(metric_get(&METRIC_TOOL_SPECULATION, spec->name, STR_LIT("wasted")), 1);
+        }
+        free((void*)spec->id.data);
+        free((void*)spec->name.data);
+        free((void*)spec->args.data);
+    }
+    free(set->items);
+    set->items = NULL;
+    set->count = set->cap = 0;
+}
+
+// ============================================================================
+// Memory Recall
+// ============================================================================
+
+// Search for the incoming message. It runs on its own thread while the
+// window and tool schemas are built, so relevant memories reach the model
+// without a memory_recall round trip.
+typedef struct agent_recall_t {
+    pthread_t thread;
+    bool threaded;
+    memory_t* memory;
+    str_t query;
+    uint32_t limit;
+    memory_entry_t* entries;
+    uint32_t count;
+    err_t err;
+} agent_recall_t;
+
+static void* recall_thread_main(void* arg) {
+    agent_recall_t* recall = (agent_recall_t*)arg;
+    memory_search_opts_t opts = memory_search_opts_default();
+    opts.limit = recall->limit;
+    opts.snippets = true;
+    recall->err = memory_search(recall->memory, &recall->query, &opts, &recall->entries, &recall->count);
+    return NULL;
+}
+
+static bool recall_enabled(const agent_context_t* ctx) {
+    return ctx->memory && ctx->config.recall_top_k > 0 && ctx->config.recall_token_budget > 0;
+}
+
+// Searches inline when no thread can be started
+static void recall_start(agent_context_t* ctx, const str_t* query, agent_recall_t* recall) {
+    *recall = (agent_recall_t){ .memory = ctx->memory, .query = *query, .limit = ctx->config.recall_top_k };
+    recall->threaded = pthread_create(&recall->thread, NULL, recall_thread_main, recall) == 0;
+    if (!recall->threaded) recall_thread_main(recall);
+}
+
+// The system prompt followed by the best hits that fit the budget, or
+// STR_NULL when there are none (or the search failed: the turn goes on
+// without them)
+static str_t recall_finish(agent_context_t* ctx, agent_recall_t* recall, str_t system_prompt) {
+    if (recall->threaded) pthread_join(recall->thread, NULL);
+    recall->threaded = false;
+    if (recall->err != ERR_OK || recall->count == 0 || !system_prompt.data) {
+        memory_entry_array_free(recall->entries, recall->count);
+        return STR_NULL;
+    }
+
+    static const char header[] = "\n\n## Relevant memories\n"
+                                 "Found for the latest message; they may be incomplete or out of date.\n";
+    token_family_t family = agent_token_family(ctx);
+    uint32_t budget = ctx->config.recall_token_budget;
+    uint32_t used = token_estimate(STR_LIT(header), family);
+
+    // Hits come best first; stop at the first that does not fit
+    uint32_t kept = 0;
+    size_t len = system_prompt.len + sizeof(header) - 1;
+    for (; kept < recall->count; kept++) {
+        const memory_entry_t* entry = &recall->entries[kept];
+        uint32_t tokens = token_estimate(entry->key, family) + token_estimate(entry->content, family) + 2;
+        if (used + tokens > budget) break;
+        used += tokens;
+        len += entry->key.len + entry->content.len + 5;
+    }
+
+    char* text = kept ? malloc(len + 1) : NULL;
+    if (!text) {
+        memory_entry_array_free(recall->entries, recall->count);
+        return STR_NULL;
+    }
+
+    size_t at = 0;
+    memcpy(text, system_prompt.data, system_prompt.len);
+    at += system_prompt.len;
+    memcpy(text + at, header, sizeof(header) - 1);
+    at += sizeof(header) - 1;
+    for (uint32_t i = 0; i < kept; i++) {
+        const memory_entry_t* entry = &recall->entries[i];
+        memcpy(text + at, "- ", 2);
+        at += 2;
+        memcpy(text + at, entry->key.data, entry->key.len);
+        at += entry->key.len;
+        memcpy(text + at, ": ", 2);
+        at += 2;
+        memcpy(text + at, entry->content.data, entry->content.len);
+        at += entry->content.len;
+        text[at++] = '\n';
+    }
+    text[at] = '\0';
+
+    memory_entry_array_free(recall->entries, recall->count);
+    return (str_t){ .data = text, .len = (uint32_t)at };
+}
+
+// ============================================================================
+// Core Agent Loop
+// ============================================================================
+
+// Reassembles a streamed completion into the chat_response_t that chat()
+// would have returned, forwarding text as it arrives
+typedef struct stream_collect_t {
+    agent_text_callback_t on_text;
+    void* user_data;
+    char* text;
+    size_t len;
+    size_t cap;
+    tool_call_builder_t tool_calls;
+    tool_speculation_set_t* speculation;  // NULL when not speculating
+    chat_response_t* response;
+    err_t err;
+    uint64_t first_delta_us;     // When the first text or tool call arrived
+} stream_collect_t;
+
+static void stream_collect_delta(const stream_delta_t* delta, void* user_data) {
+    stream_collect_t* sc = (stream_collect_t*)user_data;
+    chat_response_t* response = sc->response;
+
+    if (!sc->first_delta_us && (delta->type == STREAM_DELTA_TEXT || delta->type == STREAM_DELTA_TOOL_CALL)) {
+        sc->first_delta_us = metrics_now_us();
+    }
+
+    switch (delta->type) {
+        case STREAM_DELTA_TEXT:
+            if (delta->text.len == 0) break;
+            if (sc->len + delta->text.len + 1 > sc->cap) {
+                size_t cap = sc->cap ? sc->cap * 2 : 1024;
+                while (cap < sc->len + delta->text.len + 1) cap *= 2;
+                char* text = realloc(sc->text, cap);
+                if (!text) {
+                    sc->err = ERR_OUT_OF_MEMORY;
+                    break;
+                }
+                sc->text = text;
+                sc->cap = cap;
+            }
+            memcpy(sc->text + sc->len, delta->text.data, delta->text.len);
+            sc->len += delta->text.len;
+            sc->text[sc->len] = '\0';
+            if (sc->on_text) sc->on_text(&delta->text, sc->user_data);
+            break;
+        case STREAM_DELTA_TOOL_CALL:
+            if (tool_call_builder_feed(&sc->tool_calls, delta) != ERR_OK) sc->err = ERR_OUT_OF_MEMORY;
+            else if (sc->speculation) speculation_start(sc->speculation, &sc->tool_calls, delta->tool_index);
+            break;
+        case STREAM_DELTA_USAGE:
+            if (delta->prompt_tokens) response->prompt_tokens = delta->prompt_tokens;
+            if (delta->completion_tokens) response->completion_tokens = delta->completion_tokens;
+            if (delta->cached_tokens) response->cached_tokens = delta->cached_tokens;
+            break;
+        case STREAM_DELTA_FINISH:
+            free((void*)response->finish_reason.data);
+            response->finish_reason = str_dup(delta->finish_reason, NULL);
+            break;
+        case STREAM_DELTA_ERROR:
+            sc->err = ERR_PROVIDER;
+            break;
+        case STREAM_DELTA_DONE:
+            break;
+    }
+}
+
+static err_t chat_streamed(agent_context_t* ctx, chat_message_t* messages, uint32_t message_count,
+                           const tool_def_t* tool_defs, uint32_t tool_def_count, const char* model,
+                           double temperature, agent_text_callback_t on_text, void* user_data,
+                           tool_speculation_set_t* speculation,
+                           chat_response_t** out_response, uint64_t* out_first_delta_us) {
+    stream_collect_t sc = { .on_text = on_text, .user_data = user_data, .speculation = speculation };
+    sc.response = chat_response_create();
+    if (!sc.response) return ERR_OUT_OF_MEMORY;
+    tool_call_builder_init(&sc.tool_calls);
+
+    err_t err = provider_chat_stream_deltas(ctx->provider, messages, message_count,
+                                            tool_defs, tool_def_count, model, temperature,
+                                            stream_collect_delta, &sc);
+    if (err == ERR_OK) err = sc.err;
+    if (err == ERR_OK) err = tool_call_builder_finish(&sc.tool_calls, &sc.response->tool_calls);
+    tool_call_builder_free(&sc.tool_calls);
+    *out_first_delta_us = sc.first_delta_us;
+
+    if (err != ERR_OK) {
+        free(sc.text);
+        chat_response_free(sc.response);
+        return err;
+    }
+
+    sc.response->content = sc.text ? (str_t){ .data = sc.text, .len = (uint32_t)sc.len } : str_dup_cstr("", NULL);
+    if (model) sc.response->model = str_dup_cstr(model, NULL);
+    *out_response = sc.response;
     return ERR_OK;
 }
 
-static err_t execute_tool_call(agent_t* agent, tool_call_t* call, str_t* out_result) {
-    if (!agent || !call || !out_result) return ERR_INVALID_ARGUMENT;
-
-    agent_context_t* ctx = agent->ctx;
-
-    // Find the tool
-    for (uint32_t i = 0; i < ctx->tool_count; i++) {
-        tool_t* tool = ctx->tools[i];
-        str_t tool_name = tool->vtable->get_name();
-
-        if (str_equal(tool_name, call->name)) {
-            tool_result_t result = tool_result_create();
-            err_t err = tool->vtable->execute(tool, &call->arguments, &result);
-
-            if (err == ERR_OK && result.success) {
-                *out_result = str_dup(result.content, NULL);
-            } else {
-                *out_result = str_dup(result.error_message, NULL);
-            }
+// Latency, time to first token and output rate per provider and model
+static void record_provider_metrics(agent_context_t* ctx, const char* model, uint64_t start_us,
+                                    uint64_t first_delta_us, err_t err, const chat_response_t* response) {
+    provider_t* provider = ctx->provider;
+    str_t provider_name = provider->config.name;
+    if (str_empty(provider_name) && provider->vtable->get_name) provider_name = provider->vtable->get_name();
+    str_t model_name = model ? STR_VIEW(model) : provider->config.default_model;
 
-            tool_result_free(&result);
-            return err;
-        }
+    if (err != ERR_OK) {
+        metric_inc(metric_get(&METRIC_PROVIDER_ERRORS, provider_name, model_name), 1);
+        return;
     }
 
-    return ERR_NOT_FOUND;
+    uint64_t elapsed_us = metrics_now_us() - start_us;
+    metric_observe(metric_get(&METRIC_PROVIDER_LATENCY, provider_name, model_name), elapsed_us);
+    if (first_delta_us) {
+        metric_observe(metric_get(&METRIC_PROVIDER_TTFT, provider_name, model_name), first_delta_us - start_us);
+    }
+    if (response->completion_tokens && elapsed_us) {
+        metric_observe(metric_get(&METRIC_PROVIDER_TOKEN_RATE, provider_name, model_name),
+                       (uint64_t)response->completion_tokens * 1000000000ULL / elapsed_us);
+    }
 }
 
-// ============================================================================
-// Core Agent Loop
-// ============================================================================
-
 static err_t agent_loop_iteration(agent_t* agent, agent_session_t* session,
                                   chat_message_t* messages, uint32_t message_count,
+                                  agent_text_callback_t on_text, void* user_data,
                                   agent_message_t** out_response) {
     if (!agent || !session || !out_response) return ERR_INVALID_ARGUMENT;
 
@@ -361,55 +1373,104 @@ static err_t agent_loop_iteration(agent_t* agent, agent_session_t* session,
     // Call LLM
     chat_response_t* llm_response = NULL;
     const char* model = str_empty(session->model) ? NULL : session->model.data;
-
-    err_t err = ctx->provider->vtable->chat(
-        ctx->provider,
-        messages, message_count,
-        NULL, 0, // TODO: Pass tool definitions
-        model,
-        session->temperature,
-        &llm_response
-    );
+    uint32_t tool_def_count = 0;
+    const tool_def_t* tool_defs = agent_tool_defs(ctx, &tool_def_count);
+
+    // Plain chat_stream carries no tool calls, so it only serves tool-less turns
+    const provider_vtable_t* vt = ctx->provider->vtable;
+    bool stream = on_text && ctx->config.stream_responses &&
+                  (vt->chat_stream_deltas || (vt->chat_stream && tool_def_count == 0));
+
+    err_t err;
+    uint64_t start_us = metrics_now_us();
+    uint64_t first_delta_us = 0;
+    // Pure tools can start off the stream when the pool is there to run them
+    tool_speculation_set_t speculation = { .ctx = ctx };
+    if (stream && tool_def_count > 0 && ctx->config.speculative_tools) speculation.pool = agent_tool_pool(ctx);
+
+    TRACE_BEGIN(chat_span, "provider.chat");
+    TRACE_DETAIL(chat_span, ctx->provider->config.name);
+    if (stream) {
+        err = chat_streamed(ctx, messages, message_count, tool_defs, tool_def_count, model,
+                            session->temperature, on_text, user_data,
+                            speculation.pool ? &speculation : NULL, &llm_response, &first_delta_us);
+    } else {
+        // Hedged once the provider has a latency history
+        err = provider_chat_hedged(ctx->provider, NULL, messages, message_count, tool_defs,
+                                   tool_def_count, model, session->temperature, &llm_response);
+    }
+    TRACE_END(chat_span);
+    record_provider_metrics(ctx, model, start_us, first_delta_us, err, llm_response);
+    if (!stream && err == ERR_OK && on_text && !str_empty(llm_response->content)) {
+        on_text(&llm_response->content, user_data);
+    }
 
     if (err != ERR_OK) {
+        speculation_release(&speculation);
         return err;
     }
 
     // Create assistant message
-    agent_message_t* assistant_msg = agent_message_create(AGENT_MSG_ASSISTANT, &llm_response->content);
-    assistant_msg->model = str_dup_cstr(llm_response->model.data ? llm_response->model.data : "unknown", NULL);
+    agent_message_t* assistant_msg = agent_session_message_create(session, AGENT_MSG_ASSISTANT, &llm_response->content);
+    if (!assistant_msg) {
+        speculation_release(&speculation);
+        chat_response_free(llm_response);
+        return ERR_OUT_OF_MEMORY;
+    }
+    assistant_msg->model = str_intern(llm_response->model.data ? llm_response->model : STR_LIT("unknown"));
     assistant_msg->tokens_input = llm_response->prompt_tokens;
     assistant_msg->tokens_output = llm_response->completion_tokens;
+    assistant_msg->tokens_cached = llm_response->cached_tokens;
 
-    // Check for tool calls
+    // Check for tool calls; results are chained under the call so the
+    // next request's context carries all of them
+    agent_message_t* tail = assistant_msg;
     if (!str_empty(llm_response->tool_calls)) {
         assistant_msg->type = AGENT_MSG_TOOL_CALL;
+        assistant_msg->tool_args = agent_session_strdup(session, llm_response->tool_calls);
 
-        // Parse and execute tool calls
+        // Parsed calls live in the turn scratch
         tool_call_t* tool_calls = NULL;
         uint32_t tool_call_count = 0;
-        err = parse_tool_calls(&llm_response->tool_calls, &tool_calls, &tool_call_count);
+        err = parse_tool_calls(&llm_response->tool_calls, session_scratch(session), &tool_calls, &tool_call_count);
 
+        tool_job_t* jobs = NULL;
+        tool_speculation_t** started = NULL;
         if (err == ERR_OK && tool_call_count > 0) {
-            // Execute each tool call
-            for (uint32_t i = 0; i < tool_call_count; i++) {
-                str_t result = STR_NULL;
-                err = execute_tool_call(agent, &tool_calls[i], &result);
-
-                // Create tool result message
-                agent_message_t* result_msg = agent_message_create(AGENT_MSG_TOOL_RESULT, &result);
-                result_msg->tool_name = str_dup(tool_calls[i].name, NULL);
+            jobs = calloc(tool_call_count, sizeof(tool_job_t));
+            started = calloc(tool_call_count, sizeof(tool_speculation_t*));
+        }
 
-                // Add to tree
-                agent_message_add_child(assistant_msg, result_msg);
+        if (jobs && started) {
+            // Calls in one message are independent; run them together
+            for (uint32_t i = 0; i < tool_call_count; i++) {
+                prepare_tool_job(ctx, tool_calls[i].name, tool_calls[i].arguments, &jobs[i]);
+                started[i] = speculation_match(&speculation, &tool_calls[i], &jobs[i]);
+            }
+            run_tool_jobs(ctx, jobs, tool_call_count);
+            for (uint32_t i = 0; i < tool_call_count; i++) {
+                if (started[i]) speculation_collect(&speculation, started[i], &jobs[i]);
+            }
 
-                free((void*)result.data);
+            // Attach results in the order the model issued the calls
+            for (uint32_t i = 0; i < tool_call_count; i++) {
+                str_t output = tool_job_output(&jobs[i]);
+                agent_message_t* result_msg = agent_session_message_create(session, AGENT_MSG_TOOL_RESULT, &output);
+                if (result_msg) {
+                    result_msg->tool_name = str_intern(tool_calls[i].name);
+                    result_msg->tool_call_id = agent_session_strdup(session, tool_calls[i].id);
+                    agent_message_add_child(tail, result_msg);
+                    tail = result_msg;
+                }
+
+                tool_result_free(&jobs[i].result);
             }
         }
-
-        free(tool_calls);
+        free(jobs);
+        free(started);
     }
 
+    speculation_release(&speculation);
     chat_response_free(llm_response);
 
     // Add to conversation tree
@@ -418,7 +1479,9 @@ static err_t agent_loop_iteration(agent_t* agent, agent_session_t* session,
     } else {
         session->root = assistant_msg;
     }
-    session->current = assistant_msg;
+    session->current = tail;
+    // Logging is best-effort; a failed append is retried with the next message
+    if (session->log) session_log_append(session->log, tail);
 
     *out_response = assistant_msg;
     return ERR_OK;
@@ -426,12 +1489,19 @@ static err_t agent_loop_iteration(agent_t* agent, agent_session_t* session,
 
 err_t agent_process_message(agent_t* agent, agent_session_t* session,
                            const str_t* user_input, str_t* out_response) {
-    if (!agent || !session || !user_input || !out_response) {
-        return ERR_INVALID_ARGUMENT;
-    }
+    return agent_process_message_stream(agent, session, user_input, NULL, NULL, out_response);
+}
+
+static err_t process_turn(agent_t* agent, agent_session_t* session,
+                          const str_t* user_input, agent_text_callback_t on_text,
+                          void* user_data, str_t* out_response) {
+
+    // Pick up a summary finished while we were idle; never wait for one
+    agent_summary_collect(agent, session, false);
 
     // Create user message
-    agent_message_t* user_msg = agent_message_create(AGENT_MSG_USER, user_input);
+    agent_message_t* user_msg = agent_session_message_create(session, AGENT_MSG_USER, user_input);
+    if (!user_msg) return ERR_OUT_OF_MEMORY;
 
     // Add to conversation tree
     if (session->current) {
@@ -442,21 +1512,34 @@ err_t agent_process_message(agent_t* agent, agent_session_t* session,
     session->current = user_msg;
     session->total_messages++;
     session->last_active = get_timestamp_ms();
+    if (session->log) session_log_append(session->log, user_msg);
+
+    // Build context; memory search runs alongside and its share of the
+    // window is held back up front
+    agent_context_t* ctx = agent->ctx;
+    agent_recall_t recall;
+    bool recalling = recall_enabled(ctx);
+    if (recalling) recall_start(ctx, user_input, &recall);
 
-    // Build context
     chat_message_t* messages = NULL;
     uint32_t message_count = 0;
-    err_t err = build_context_messages(agent, session, &messages, &message_count);
+    uint32_t reserved = recalling ? ctx->config.recall_token_budget : 0;
+    err_t err = build_context_messages(agent, session, reserved, &messages, &message_count);
+    str_t system_prompt = STR_NULL;
+    if (recalling) system_prompt = recall_finish(ctx, &recall, err == ERR_OK ? messages[0].content : STR_NULL);
     if (err != ERR_OK) {
+        free((void*)system_prompt.data);
         return err;
     }
+    if (system_prompt.data) messages[0].content = system_prompt;
 
     // Agent loop with iteration limit
     agent_message_t* response = NULL;
     uint32_t iterations = 0;
 
     while (iterations < agent->ctx->config.max_iterations) {
-        err = agent_loop_iteration(agent, session, messages, message_count, &response);
+        err = agent_loop_iteration(agent, session, messages, message_count,
+                                   on_text, user_data, &response);
         if (err != ERR_OK) break;
 
         // If no tool calls, we're done
@@ -464,15 +1547,23 @@ err_t agent_process_message(agent_t* agent, agent_session_t* session,
             break;
         }
 
-        // Rebuild context with tool results
-        free(messages);
-        err = build_context_messages(agent, session, &messages, &message_count);
+        // Extend context with tool results
+        err = build_context_messages(agent, session, reserved, &messages, &message_count);
         if (err != ERR_OK) break;
+        if (system_prompt.data) messages[0].content = system_prompt;
 
         iterations++;
     }
 
-    free(messages);
+    // Everything transient from this turn goes at once
+    if (session->scratch) {
+        arena_reset(session->scratch);
+    }
+    free((void*)system_prompt.data);
+
+    // Fold old turns off the critical path, before the user replies
+    agent_summary_schedule(agent, session);
+    if (session->log) session_log_set_current(session->log, session->current);
 
     if (response && response->type == AGENT_MSG_ASSISTANT) {
         *out_response = str_dup(response->content, NULL);
@@ -482,6 +1573,20 @@ err_t agent_process_message(agent_t* agent, agent_session_t* session,
     return err;
 }
 
+err_t agent_process_message_stream(agent_t* agent, agent_session_t* session,
+                                   const str_t* user_input, agent_text_callback_t on_text,
+                                   void* user_data, str_t* out_response) {
+    if (!agent || !session || !user_input || !out_response) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    // Continues the inbound message's trace when there is one
+    TRACE_ROOT(span, "agent.turn");
+    err_t err = process_turn(agent, session, user_input, on_text, user_data, out_response);
+    TRACE_END(span);
+    return err;
+}
+
 err_t agent_run(agent_t* agent, agent_session_t* session) {
     if (!agent || !session) return ERR_INVALID_ARGUMENT;
 
@@ -501,23 +1606,24 @@ err_t agent_run(agent_t* agent, agent_session_t* session) {
 // Session Management (API)
 // ============================================================================
 
-err_t agent_session_create(agent_t* agent, const str_t* name, agent_session_t** out_session) {
-    if (!agent || !out_session) return ERR_INVALID_ARGUMENT;
-
-    agent_session_t* session = session_create_internal(name);
-    if (!session) return ERR_OUT_OF_MEMORY;
+str_t agent_sessions_dir_default(void) {
+    const char* home = getenv("HOME");
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", home ? home : ".", AGENT_SESSIONS_DIR_DEFAULT);
+    return str_dup_cstr(path, NULL);
+}
 
-    // Add to agent's session list
-    agent_context_t* ctx = agent->ctx;
+static const char* sessions_dir(const agent_context_t* ctx) {
+    return str_empty(ctx->config.sessions_dir) ? NULL : ctx->config.sessions_dir.data;
+}
 
+// Add to the agent's session list
+static err_t session_register(agent_context_t* ctx, agent_session_t* session) {
     if (ctx->session_count >= ctx->session_capacity) {
         uint32_t new_capacity = ctx->session_capacity == 0 ? 4 : ctx->session_capacity * 2;
         agent_session_t** new_sessions = realloc(ctx->sessions,
                                                   sizeof(agent_session_t*) * new_capacity);
-        if (!new_sessions) {
-            session_free(session);
-            return ERR_OUT_OF_MEMORY;
-        }
+        if (!new_sessions) return ERR_OUT_OF_MEMORY;
         ctx->sessions = new_sessions;
         ctx->session_capacity = new_capacity;
     }
@@ -527,11 +1633,155 @@ err_t agent_session_create(agent_t* agent, const str_t* name, agent_session_t**
     if (!ctx->active_session) {
         ctx->active_session = session;
     }
+    return ERR_OK;
+}
+
+// Unregistered session for session_id: its log mapped back in, or a new one
+// under that id (logged from now on when a sessions dir is configured)
+static err_t session_open_internal(const agent_context_t* ctx, const str_t* session_id, const str_t* name,
+                                   bool create, agent_session_t** out_session) {
+    agent_session_t* session = session_create_internal(name);
+    if (!session) return ERR_OUT_OF_MEMORY;
+
+    const char* dir = sessions_dir(ctx);
+    err_t err = dir ? session_log_load(dir, session_id, session, &session->log) : ERR_FILE_NOT_FOUND;
+    if (err == ERR_FILE_NOT_FOUND && create) {
+        free((void*)session->id.data);
+        session->id = str_dup(*session_id, NULL);
+        if (!session->id.data) {
+            session_free(session);
+            return ERR_OUT_OF_MEMORY;
+        }
+        if (dir) session_log_create(dir, session, &session->log);
+        err = ERR_OK;
+    }
+    if (err != ERR_OK) {
+        session_free(session);
+        return err;
+    }
+
+    *out_session = session;
+    return ERR_OK;
+}
+
+err_t agent_session_create(agent_t* agent, const str_t* name, agent_session_t** out_session) {
+    if (!agent || !out_session) return ERR_INVALID_ARGUMENT;
+
+    agent_session_t* session = session_create_internal(name);
+    if (!session) return ERR_OUT_OF_MEMORY;
+
+    agent_context_t* ctx = agent->ctx;
+    const char* dir = sessions_dir(ctx);
+    if (dir) session_log_create(dir, session, &session->log);
+
+    err_t err = session_register(ctx, session);
+    if (err != ERR_OK) {
+        session_free(session);
+        return err;
+    }
+
+    *out_session = session;
+    return ERR_OK;
+}
+
+static agent_session_t* session_find(agent_context_t* ctx, const str_t* session_id) {
+    for (uint32_t i = 0; i < ctx->session_count; i++) {
+        if (str_equal(ctx->sessions[i]->id, *session_id)) return ctx->sessions[i];
+    }
+    return NULL;
+}
+
+static err_t session_open_registered(agent_t* agent, const str_t* session_id, const str_t* name,
+                                     bool create, agent_session_t** out_session) {
+    if (!agent || !session_id || str_empty(*session_id) || !out_session) return ERR_INVALID_ARGUMENT;
+
+    agent_context_t* ctx = agent->ctx;
+    agent_session_t* session = session_find(ctx, session_id);
+    if (session) {
+        *out_session = session;
+        return ERR_OK;
+    }
+    if (!create && !sessions_dir(ctx)) return ERR_CONFIG_MISSING;
+
+    err_t err = session_open_internal(ctx, session_id, name, create, &session);
+    if (err != ERR_OK) return err;
+
+    err = session_register(ctx, session);
+    if (err != ERR_OK) {
+        session_free(session);
+        return err;
+    }
 
     *out_session = session;
     return ERR_OK;
 }
 
+err_t agent_session_load(agent_t* agent, const str_t* session_id, agent_session_t** out_session) {
+    return session_open_registered(agent, session_id, NULL, false, out_session);
+}
+
+err_t agent_session_resume(agent_t* agent, const str_t* session_id, const str_t* name,
+                           agent_session_t** out_session) {
+    return session_open_registered(agent, session_id, name, true, out_session);
+}
+
+// Preorder, so every parent is logged before its children
+static err_t session_log_tree(session_log_t* log, agent_message_t* root) {
+    agent_message_t* node = root;
+    while (node) {
+        err_t err = session_log_append(log, node);
+        if (err != ERR_OK) return err;
+
+        if (node->first_child) {
+            node = node->first_child;
+            continue;
+        }
+        while (node != root && !node->next_sibling) node = node->parent;
+        node = node == root ? NULL : node->next_sibling;
+    }
+    return ERR_OK;
+}
+
+err_t agent_session_save(agent_t* agent, agent_session_t* session) {
+    if (!agent || !session) return ERR_INVALID_ARGUMENT;
+
+    if (!session->log) {
+        const char* dir = sessions_dir(agent->ctx);
+        if (!dir) return ERR_CONFIG_MISSING;
+
+        err_t err = session_log_create(dir, session, &session->log);
+        if (err != ERR_OK) return err;
+    }
+
+    err_t err = session->root ? session_log_tree(session->log, session->root) : ERR_OK;
+    if (err == ERR_OK) err = session_log_set_current(session->log, session->current);
+    if (err == ERR_OK) err = session_log_checkpoint(session->log);
+    return err;
+}
+
+err_t agent_session_list(agent_t* agent, str_t** out_ids, uint32_t* out_count) {
+    if (!agent || !out_ids || !out_count) return ERR_INVALID_ARGUMENT;
+
+    agent_context_t* ctx = agent->ctx;
+    const char* dir = sessions_dir(ctx);
+    if (dir) return session_log_list(dir, out_ids, out_count);
+
+    // Nothing is persisted: the sessions open now
+    *out_ids = NULL;
+    *out_count = 0;
+    if (ctx->session_count == 0) return ERR_OK;
+
+    str_t* ids = calloc(ctx->session_count, sizeof(str_t));
+    if (!ids) return ERR_OUT_OF_MEMORY;
+    for (uint32_t i = 0; i < ctx->session_count; i++) {
+        ids[i] = str_dup(ctx->sessions[i]->id, NULL);
+    }
+
+    *out_ids = ids;
+    *out_count = ctx->session_count;
+    return ERR_OK;
+}
+
 void agent_session_close(agent_t* agent, agent_session_t* session) {
     if (!agent || !session) return;
 
@@ -569,6 +1819,192 @@ err_t agent_session_set_active(agent_t* agent, agent_session_t* session) {
     return ERR_OK;
 }
 
+// ============================================================================
+// Conversation Sessions
+// ============================================================================
+
+typedef struct session_entry_t {
+    struct session_entry_t* next;
+    uint32_t hash;
+    str_t channel;
+    str_t sender;
+    agent_session_t* session;
+    uint64_t last_used;            // Shard turn count at its latest turn
+} session_entry_t;
+
+typedef struct session_shard_t {
+    pthread_mutex_t lock;
+    session_entry_t* buckets[AGENT_SESSION_MAP_BUCKETS];
+    uint32_t count;
+    uint64_t turns;
+} session_shard_t;
+
+struct agent_session_map_t {
+    agent_t* agent;
+    session_shard_t* shards;
+    uint32_t shard_count;
+};
+
+err_t agent_session_map_create(agent_t* agent, uint32_t shard_count, agent_session_map_t** out_map) {
+    if (!agent || shard_count == 0 || !out_map) return ERR_INVALID_ARGUMENT;
+
+    agent_session_map_t* map = calloc(1, sizeof(agent_session_map_t));
+    if (!map) return ERR_OUT_OF_MEMORY;
+
+    map->shards = calloc(shard_count, sizeof(session_shard_t));
+    if (!map->shards) {
+        free(map);
+        return ERR_OUT_OF_MEMORY;
+    }
+    map->agent = agent;
+    map->shard_count = shard_count;
+    for (uint32_t i = 0; i < shard_count; i++) {
+        pthread_mutex_init(&map->shards[i].lock, NULL);
+    }
+
+    // Serialize tool definitions now so the first turns do not contend
+    uint32_t def_count = 0;
+    agent_tool_defs(agent->ctx, &def_count);
+
+    *out_map = map;
+    return ERR_OK;
+}
+
+static void session_entry_free(session_entry_t* entry) {
+    session_free(entry->session);
+    free((void*)entry->channel.data);
+    free((void*)entry->sender.data);
+    free(entry);
+}
+
+void agent_session_map_destroy(agent_session_map_t* map) {
+    if (!map) return;
+
+    for (uint32_t i = 0; i < map->shard_count; i++) {
+        session_shard_t* shard = &map->shards[i];
+        for (uint32_t b = 0; b < AGENT_SESSION_MAP_BUCKETS; b++) {
+            session_entry_t* entry = shard->buckets[b];
+            while (entry) {
+                session_entry_t* next = entry->next;
+                session_entry_free(entry);
+                entry = next;
+            }
+        }
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(map->shards);
+    free(map);
+}
+
+uint32_t agent_session_map_count(agent_session_map_t* map) {
+    if (!map) return 0;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < map->shard_count; i++) {
+        pthread_mutex_lock(&map->shards[i].lock);
+        count += map->shards[i].count;
+        pthread_mutex_unlock(&map->shards[i].lock);
+    }
+    return count;
+}
+
+// Caller holds the shard lock
+static session_entry_t* shard_session(const agent_context_t* ctx, session_shard_t* shard, uint32_t hash,
+                                      const str_t* channel, const str_t* sender) {
+    // The shard index takes the low bits' remainder; buckets use the high bits
+    session_entry_t** bucket = &shard->buckets[(hash >> 16) % AGENT_SESSION_MAP_BUCKETS];
+    for (session_entry_t* entry = *bucket; entry; entry = entry->next) {
+        if (entry->hash == hash && str_equal(entry->channel, *channel) && str_equal(entry->sender, *sender)) {
+            return entry;
+        }
+    }
+
+    session_entry_t* entry = calloc(1, sizeof(session_entry_t));
+    if (!entry) return NULL;
+
+    // Named after the conversation so it is recognisable in listings
+    char name[256];
+    snprintf(name, sizeof(name), "%.*s:%.*s", (int)channel->len, channel->data ? channel->data : "",
+             (int)sender->len, sender->data ? sender->data : "");
+    str_t session_name = STR_VIEW(name);
+    if (sessions_dir(ctx)) {
+        // A stable id per conversation, so it picks up its log after a restart
+        uint64_t key = 14695981039346656037ull;
+        for (const char* c = name; *c; c++) {
+            key ^= (unsigned char)*c;
+            key *= 1099511628211ull;
+        }
+        char id[32];
+        snprintf(id, sizeof(id), "conv-%016llx", (unsigned long long)key);
+        str_t session_id = STR_VIEW(id);
+        if (session_open_internal(ctx, &session_id, &session_name, true, &entry->session) != ERR_OK) {
+            entry->session = NULL;
+        }
+    } else {
+        entry->session = session_create_internal(&session_name);
+    }
+    entry->channel = str_dup(*channel, NULL);
+    entry->sender = str_dup(*sender, NULL);
+    if (!entry->session || (channel->len && !entry->channel.data) || (sender->len && !entry->sender.data)) {
+        session_entry_free(entry);
+        return NULL;
+    }
+
+    entry->hash = hash;
+    entry->next = *bucket;
+    *bucket = entry;
+    shard->count++;
+    return entry;
+}
+
+// Caller holds the shard lock. Closes the shard's least recently used
+// logged sessions other than keep while the agent tree is over budget;
+// sessions without a log would lose their history and stay.
+static void shard_shed(session_shard_t* shard, const session_entry_t* keep) {
+    while (alloc_tag_over_budget(ALLOC_TAG_AGENT)) {
+        session_entry_t** victim = NULL;
+        for (uint32_t b = 0; b < AGENT_SESSION_MAP_BUCKETS; b++) {
+            for (session_entry_t** slot = &shard->buckets[b]; *slot; slot = &(*slot)->next) {
+                session_entry_t* entry = *slot;
+                if (entry == keep || !entry->session->log) continue;
+                if (!victim || entry->last_used < (*victim)->last_used) victim = slot;
+            }
+        }
+        if (!victim) return;
+
+        session_entry_t* entry = *victim;
+        *victim = entry->next;
+        shard->count--;
+        session_entry_free(entry);
+    }
+}
+
+err_t agent_session_map_process(agent_session_map_t* map, const str_t* channel, const str_t* sender,
+                                const str_t* user_input, str_t* out_response) {
+    return agent_session_map_process_stream(map, channel, sender, user_input, NULL, NULL, out_response);
+}
+
+err_t agent_session_map_process_stream(agent_session_map_t* map, const str_t* channel, const str_t* sender,
+                                       const str_t* user_input, agent_text_callback_t on_text,
+                                       void* user_data, str_t* out_response) {
+    if (!map || !channel || !sender || !user_input || !out_response) return ERR_INVALID_ARGUMENT;
+
+    uint32_t hash = channel_route_hash(channel, sender);
+    session_shard_t* shard = &map->shards[hash % map->shard_count];
+
+    pthread_mutex_lock(&shard->lock);
+    session_entry_t* entry = shard_session(map->agent->ctx, shard, hash, channel, sender);
+    err_t err = ERR_OUT_OF_MEMORY;
+    if (entry) {
+        entry->last_used = ++shard->turns;
+        err = agent_process_message_stream(map->agent, entry->session, user_input,
+                                           on_text, user_data, out_response);
+        shard_shed(shard, entry);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return err;
+}
+
 // ============================================================================
 // Tree Navigation
 // ============================================================================
@@ -586,6 +2022,7 @@ err_t agent_navigate_to(agent_t* agent, agent_message_t* message) {
     }
 
     session->current = message;
+    if (session->log) session_log_set_current(session->log, message);
     return ERR_OK;
 }
 
@@ -598,6 +2035,7 @@ err_t agent_navigate_back(agent_t* agent) {
 
     session->history_pos--;
     session->current = session->history[session->history_pos];
+    if (session->log) session_log_set_current(session->log, session->current);
     return ERR_OK;
 }
 
@@ -609,15 +2047,115 @@ err_t agent_navigate_to_parent(agent_t* agent) {
     if (!session || !session->current || !session->current->parent) return ERR_INVALID_STATE;
 
     session->current = session->current->parent;
+    if (session->log) session_log_set_current(session->log, session->current);
+    return ERR_OK;
+}
+
+err_t agent_navigate_to_child(agent_t* agent, uint32_t child_index) {
+    if (!agent) return ERR_INVALID_ARGUMENT;
+
+    agent_context_t* ctx = agent->ctx;
+    agent_session_t* session = ctx->active_session;
+    if (!session || !session->current) return ERR_INVALID_STATE;
+    if (child_index >= session->current->child_count) return ERR_NOT_FOUND;
+
+    agent_message_t* child = session->current->first_child;
+    for (uint32_t i = 0; i < child_index; i++) child = child->next_sibling;
+
+    session->current = child;
+    if (session->log) session_log_set_current(session->log, child);
+    return ERR_OK;
+}
+
+err_t agent_register_tool(agent_t* agent, tool_t* tool) {
+    if (!agent || !tool || !tool->vtable || !tool->vtable->get_name) return ERR_INVALID_ARGUMENT;
+
+    agent_context_t* ctx = agent->ctx;
+    if (!tool->initialized && tool->vtable->init) {
+        // Memory tools share the agent's instance instead of opening their own
+        tool_context_t context = tool_context_default();
+        context.memory = ctx->memory;
+        context.workspace_dir = ctx->config.workspace_root;
+        context.sandbox = ctx->sandbox;
+        err_t err = tool->vtable->init(tool, &context);
+        if (err != ERR_OK) return err;
+    }
+
+    tool_t** tools = realloc(ctx->tools, (ctx->tool_count + 1) * sizeof(tool_t*));
+    if (!tools) return ERR_OUT_OF_MEMORY;
+    ctx->tools = tools;
+    ctx->tools[ctx->tool_count++] = tool;
+
+    ctx->tool_defs_valid = false;
+
+    if (ctx->tool_count * 2 > ctx->tool_slot_count) {
+        err_t err = tool_index_rebuild(ctx);
+        if (err != ERR_OK) {
+            ctx->tool_count--;
+            return err;
+        }
+        return ERR_OK;
+    }
+
+    uint32_t slot = tool_slot_find(ctx, tool->vtable->get_name());
+    if (!ctx->tool_slots[slot]) ctx->tool_slots[slot] = ctx->tool_count;
     return ERR_OK;
 }
 
+void agent_set_memory(agent_t* agent, memory_t* memory) {
+    if (!agent) return;
+
+    memory_free(agent->ctx->memory);
+    agent->ctx->memory = memory;
+}
+
+void agent_set_sandbox(agent_t* agent, docker_pool_t* sandbox) {
+    if (!agent) return;
+
+    docker_pool_destroy(agent->ctx->sandbox);
+    agent->ctx->sandbox = sandbox;
+}
+
+err_t agent_execute_tool(agent_t* agent, const str_t* tool_name,
+                        const str_t* args, str_t* out_result) {
+    if (!agent || !tool_name || !out_result) return ERR_INVALID_ARGUMENT;
+
+    tool_job_t job;
+    prepare_tool_job(agent->ctx, *tool_name, args ? *args : STR_NULL, &job);
+    run_tool_jobs(agent->ctx, &job, 1);
+
+    *out_result = str_dup(tool_job_output(&job), NULL);
+    tool_result_free(&job.result);
+    return job.err;
+}
+
+bool agent_tool_is_available(agent_t* agent, const str_t* tool_name) {
+    if (!agent || !tool_name) return false;
+
+    tool_t* tool = find_tool(agent->ctx, *tool_name);
+    return tool && tool_allowed(agent->ctx, tool);
+}
+
 err_t agent_tool_list_available(agent_t* agent, str_t** out_names, uint32_t* out_count) {
     if (!agent || !out_names || !out_count) return ERR_INVALID_ARGUMENT;
 
-    // Return empty list for now (would query tool registry in full implementation)
+    agent_context_t* ctx = agent->ctx;
     *out_names = NULL;
     *out_count = 0;
+    if (ctx->tool_count == 0) return ERR_OK;
+
+    str_t* names = calloc(ctx->tool_count, sizeof(str_t));
+    if (!names) return ERR_OUT_OF_MEMORY;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < ctx->tool_count; i++) {
+        if (tool_allowed(ctx, ctx->tools[i])) {
+            names[count++] = ctx->tools[i]->vtable->get_name();
+        }
+    }
+
+    *out_names = names;
+    *out_count = count;
     return ERR_OK;
 }
 
@@ -657,6 +2195,9 @@ err_t agent_create(const agent_config_t* config, agent_t** out_agent) {
 
     // Copy configuration
     ctx->config = config ? *config : agent_config_default();
+    if (ctx->config.session_memory_budget) {
+        alloc_tag_set_budget(ALLOC_TAG_AGENT, ctx->config.session_memory_budget);
+    }
     ctx->start_time = get_timestamp_ms();
     ctx->is_running = false;
 
@@ -666,6 +2207,14 @@ err_t agent_create(const agent_config_t* config, agent_t** out_agent) {
     ctx->tools = NULL;
     ctx->tool_count = 0;
 
+    // Name index for dispatch; agent_register_tool keeps it current
+    if (tool_index_rebuild(ctx) != ERR_OK) {
+        free(ctx);
+        free(agent);
+        return ERR_OUT_OF_MEMORY;
+    }
+    pthread_mutex_init(&ctx->shared_lock, NULL);
+
     agent->ctx = ctx;
     agent->vtable = agent_get_default_vtable();
 
@@ -684,11 +2233,20 @@ void agent_destroy(agent_t* agent) {
         }
         free(ctx->sessions);
 
+        // Let abandoned calls finish before their tools go away
+        tool_pool_destroy(ctx->tool_pool);
+
         // Free tools
         for (uint32_t i = 0; i < ctx->tool_count; i++) {
             tool_free(ctx->tools[i]);
         }
         free(ctx->tools);
+        free(ctx->tool_slots);
+        // After the tools, which borrow them
+        memory_free(ctx->memory);
+        docker_pool_destroy(ctx->sandbox);
+        free((void*)ctx->summary_model.data);
+        tool_def_array_free(ctx->tool_defs, ctx->tool_def_count);
 
         // Free extensions list
         for (uint32_t i = 0; i < ctx->extension_count; i++) {
@@ -698,6 +2256,7 @@ void agent_destroy(agent_t* agent) {
 
         agent_config_free(&ctx->config);
         free((void*)ctx->system_prompt.data);
+        pthread_mutex_destroy(&ctx->shared_lock);
 
         free(ctx);
     }
@@ -724,6 +2283,18 @@ static err_t agent_session_create_impl(agent_t* agent, const str_t* name, agent_
     return agent_session_create(agent, name, out_session);
 }
 
+static err_t agent_session_load_impl(agent_t* agent, const str_t* session_id, agent_session_t** out_session) {
+    return agent_session_load(agent, session_id, out_session);
+}
+
+static err_t agent_session_save_impl(agent_t* agent, agent_session_t* session) {
+    return agent_session_save(agent, session);
+}
+
+static err_t agent_session_list_impl(agent_t* agent, str_t** out_ids, uint32_t* out_count) {
+    return agent_session_list(agent, out_ids, out_count);
+}
+
 static err_t agent_session_close_impl(agent_t* agent, agent_session_t* session) {
     agent_session_close(agent, session);
     return ERR_OK;
@@ -778,12 +2349,16 @@ static const agent_vtable_t g_default_vtable = {
     .create = agent_create_impl,
     .destroy = agent_destroy_impl,
     .session_create = agent_session_create_impl,
+    .session_load = agent_session_load_impl,
+    .session_save = agent_session_save_impl,
     .session_close = agent_session_close_impl,
+    .session_list = agent_session_list_impl,
     .navigate_to = agent_navigate_to_impl,
     .navigate_back = agent_navigate_back_impl,
     .create_branch = agent_create_branch_impl,
     .run = agent_run_impl,
     .process_message = agent_process_message_impl,
+    .execute_tool = agent_execute_tool,
     .rebuild_system_prompt = agent_rebuild_system_prompt_impl,
 };
 
@@ -798,11 +2373,19 @@ const agent_vtable_t* agent_get_default_vtable(void) {
 err_t cclaw_init(void) {
     fprintf(stderr, "Initializing CClaw v%s\n", CCLAW_VERSION_STRING);
 
-    // Initialize subsystems
-    err_t err = channel_registry_init();
+    // The provider, channel, memory and tool registries fill themselves on
+    // first lookup, so commands that never touch one skip its setup
+
+    // Tracing stays off unless CCLAW_TRACE_FILE or CCLAW_TRACE_OTLP is set
+    err_t err = trace_init_from_env();
     if (err != ERR_OK) {
-        fprintf(stderr, "Failed to initialize channel registry: %s\n", error_to_string(err));
-        return err;
+        fprintf(stderr, "Failed to start tracing: %s\n", error_to_string(err));
+    }
+
+    // Provider traffic is recorded for the replay provider when CCLAW_HTTP_CAPTURE is set
+    err = http_capture_init_from_env();
+    if (err != ERR_OK) {
+        fprintf(stderr, "Failed to open HTTP capture: %s\n", error_to_string(err));
     }
 
     return ERR_OK;
@@ -810,6 +2393,8 @@ err_t cclaw_init(void) {
 
 void cclaw_shutdown(void) {
     fprintf(stderr, "Shutting down CClaw\n");
+    http_capture_stop();
+    trace_shutdown();
     channel_registry_shutdown();
 }
 
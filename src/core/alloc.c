@@ -0,0 +1,1002 @@
+// alloc.c - Memory allocators for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "core/alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define ALLOC_DEFAULT_ALIGNMENT _Alignof(max_align_t)
+#define ALLOCATOR_SCRATCH_SIZE (256 * 1024)
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// ============================================================================
+// Default allocator (malloc/free)
+// ============================================================================
+
+static void* default_alloc(allocator_t* a, size_t size, size_t alignment) {
+    (void)a;
+    if (alignment <= ALLOC_DEFAULT_ALIGNMENT) return malloc(size);
+    return aligned_alloc(alignment, align_up(size, alignment));
+}
+
+static void* default_realloc(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    (void)a;
+    if (alignment <= ALLOC_DEFAULT_ALIGNMENT) return realloc(ptr, new_size);
+
+    void* new_ptr = aligned_alloc(alignment, align_up(new_size, alignment));
+    if (new_ptr && ptr) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        free(ptr);
+    }
+    return new_ptr;
+}
+
+static void default_free(allocator_t* a, void* ptr, size_t size) {
+    (void)a;
+    (void)size;
+    free(ptr);
+}
+
+static allocator_vtable_t g_default_vtable = {
+    .alloc = default_alloc,
+    .realloc = default_realloc,
+    .free = default_free,
+    .destroy = NULL
+};
+
+static allocator_t g_default_allocator = {
+    .vtable = &g_default_vtable,
+    .user_data = NULL
+};
+
+allocator_t* allocator_default(void) {
+    return &g_default_allocator;
+}
+
+// ============================================================================
+// Arena allocator
+// ============================================================================
+
+// Overflow chunk header; data follows
+typedef struct arena_chunk_t {
+    struct arena_chunk_t* next;
+    size_t size;
+    size_t used;
+} arena_chunk_t;
+
+#define ARENA_CHUNK_HEADER align_up(sizeof(arena_chunk_t), ALLOC_DEFAULT_ALIGNMENT)
+#define ARENA_MIN_CHUNK 4096
+
+// What the arena holds from malloc, as accounted to its tag
+static size_t arena_footprint(const arena_allocator_t* arena) {
+    return (arena->owns_region ? arena->region_size : 0) + arena->chunk_bytes;
+}
+
+static void* arena_bump(arena_allocator_t* arena, size_t size, size_t alignment) {
+    // Try the primary region first
+    if (arena->region) {
+        uintptr_t base = (uintptr_t)arena->region;
+        size_t offset = align_up(base + arena->used, alignment) - base;
+        if (offset + size <= arena->region_size) {
+            arena->used = offset + size;
+            return (char*)arena->region + offset;
+        }
+    }
+
+    // Then the newest overflow chunk
+    arena_chunk_t* chunk = (arena_chunk_t*)arena->chunks;
+    if (chunk) {
+        uintptr_t base = (uintptr_t)chunk + ARENA_CHUNK_HEADER;
+        size_t offset = align_up(base + chunk->used, alignment) - base;
+        if (offset + size <= chunk->size) {
+            chunk->used = offset + size;
+            return (char*)base + offset;
+        }
+    }
+
+    // Grow geometrically so long-lived arenas settle into few chunks
+    size_t chunk_size = arena->region_size + arena->chunk_bytes;
+    if (chunk_size < ARENA_MIN_CHUNK) chunk_size = ARENA_MIN_CHUNK;
+    if (chunk_size < size + alignment) chunk_size = size + alignment;
+
+    chunk = malloc(ARENA_CHUNK_HEADER + chunk_size);
+    if (!chunk) return NULL;
+
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    chunk->next = (arena_chunk_t*)arena->chunks;
+    arena->chunks = chunk;
+    arena->chunk_bytes += chunk_size;
+    if (arena->tag) alloc_tag_add(arena->tag, chunk_size);
+
+    uintptr_t base = (uintptr_t)chunk + ARENA_CHUNK_HEADER;
+    size_t offset = align_up(base, alignment) - base;
+    chunk->used = offset + size;
+    return (char*)base + offset;
+}
+
+static void* arena_alloc_impl(allocator_t* a, size_t size, size_t alignment) {
+    return arena_bump((arena_allocator_t*)a, size, alignment);
+}
+
+static void* arena_realloc_impl(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    if (new_size <= old_size && ptr) return ptr;
+
+    void* new_ptr = arena_bump((arena_allocator_t*)a, new_size, alignment);
+    if (new_ptr && ptr) memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+static void arena_free_impl(allocator_t* a, void* ptr, size_t size) {
+    // Individual frees are no-ops; memory is reclaimed by arena_reset
+    (void)a;
+    (void)ptr;
+    (void)size;
+}
+
+static void arena_destroy_impl(allocator_t* a) {
+    arena_destroy((arena_allocator_t*)a);
+}
+
+static allocator_vtable_t g_arena_vtable = {
+    .alloc = arena_alloc_impl,
+    .realloc = arena_realloc_impl,
+    .free = arena_free_impl,
+    .destroy = arena_destroy_impl
+};
+
+static void arena_free_chunks(arena_allocator_t* arena) {
+    arena_chunk_t* chunk = (arena_chunk_t*)arena->chunks;
+    while (chunk) {
+        arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    if (arena->tag) alloc_tag_sub(arena->tag, arena->chunk_bytes);
+    arena->chunks = NULL;
+    arena->chunk_bytes = 0;
+}
+
+arena_allocator_t* arena_create(size_t size) {
+    arena_allocator_t* arena = calloc(1, sizeof(arena_allocator_t));
+    if (!arena) return NULL;
+
+    if (size > 0) {
+        arena->region = malloc(size);
+        if (!arena->region) {
+            free(arena);
+            return NULL;
+        }
+    }
+
+    arena->base.vtable = &g_arena_vtable;
+    arena->region_size = size;
+    arena->owns_region = true;
+    return arena;
+}
+
+arena_allocator_t* arena_create_from_buffer(void* buffer, size_t size) {
+    arena_allocator_t* arena = calloc(1, sizeof(arena_allocator_t));
+    if (!arena) return NULL;
+
+    arena->base.vtable = &g_arena_vtable;
+    arena->region = buffer;
+    arena->region_size = buffer ? size : 0;
+    arena->owns_region = false;
+    return arena;
+}
+
+void arena_destroy(arena_allocator_t* arena) {
+    if (!arena) return;
+
+    arena_free_chunks(arena);
+    if (arena->owns_region) {
+        if (arena->tag) alloc_tag_sub(arena->tag, arena->region_size);
+        free(arena->region);
+    }
+    free(arena);
+}
+
+void arena_reset(arena_allocator_t* arena) {
+    if (!arena) return;
+
+    // Fold overflow into one larger region so the next cycle fits without chunking
+    if (arena->chunks && arena->owns_region) {
+        size_t new_size = arena->region_size + arena->chunk_bytes;
+        void* region = malloc(new_size);
+        if (region) {
+            if (arena->tag) {
+                alloc_tag_sub(arena->tag, arena->region_size);
+                alloc_tag_add(arena->tag, new_size);
+            }
+            free(arena->region);
+            arena->region = region;
+            arena->region_size = new_size;
+        }
+    }
+
+    arena_free_chunks(arena);
+    arena->used = 0;
+}
+
+void arena_set_tag(arena_allocator_t* arena, alloc_tag_t tag) {
+    if (!arena || tag >= ALLOC_TAG_COUNT || tag == arena->tag) return;
+
+    size_t footprint = arena_footprint(arena);
+    if (arena->tag) alloc_tag_sub(arena->tag, footprint);
+    if (tag) alloc_tag_add(tag, footprint);
+    arena->tag = tag;
+}
+
+size_t arena_used(const arena_allocator_t* arena) {
+    if (!arena) return 0;
+
+    size_t total = arena->used;
+    for (arena_chunk_t* chunk = (arena_chunk_t*)arena->chunks; chunk; chunk = chunk->next) {
+        total += chunk->used;
+    }
+    return total;
+}
+
+// ============================================================================
+// Pool allocator
+// ============================================================================
+
+static bool pool_grow(pool_allocator_t* pool) {
+    // Chunk layout: [next chunk pointer][blocks...]
+    size_t header = align_up(sizeof(void*), ALLOC_DEFAULT_ALIGNMENT);
+    char* chunk = malloc(header + pool->block_size * pool->blocks_per_chunk);
+    if (!chunk) return false;
+
+    *(void**)chunk = pool->chunks;
+    pool->chunks = chunk;
+    pool->chunk_count++;
+
+    char* blocks = chunk + header;
+    for (size_t i = 0; i < pool->blocks_per_chunk; i++) {
+        void** block = (void**)(blocks + i * pool->block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+    return true;
+}
+
+static void* pool_alloc_impl(allocator_t* a, size_t size, size_t alignment) {
+    pool_allocator_t* pool = (pool_allocator_t*)a;
+    if (size > pool->block_size || alignment > ALLOC_DEFAULT_ALIGNMENT) return NULL;
+
+    if (!pool->free_list && !pool_grow(pool)) return NULL;
+
+    void** block = pool->free_list;
+    pool->free_list = (void**)*block;
+    return block;
+}
+
+static void* pool_realloc_impl(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    pool_allocator_t* pool = (pool_allocator_t*)a;
+    (void)old_size;
+    if (new_size > pool->block_size || alignment > ALLOC_DEFAULT_ALIGNMENT) return NULL;
+    return ptr ? ptr : pool_alloc_impl(a, new_size, alignment);
+}
+
+static void pool_free_impl(allocator_t* a, void* ptr, size_t size) {
+    (void)size;
+    if (!ptr) return;
+
+    pool_allocator_t* pool = (pool_allocator_t*)a;
+    void** block = (void**)ptr;
+    *block = pool->free_list;
+    pool->free_list = block;
+}
+
+static void pool_destroy_impl(allocator_t* a) {
+    pool_destroy((pool_allocator_t*)a);
+}
+
+static allocator_vtable_t g_pool_vtable = {
+    .alloc = pool_alloc_impl,
+    .realloc = pool_realloc_impl,
+    .free = pool_free_impl,
+    .destroy = pool_destroy_impl
+};
+
+pool_allocator_t* pool_create(size_t block_size, size_t blocks_per_chunk) {
+    if (block_size == 0 || blocks_per_chunk == 0) return NULL;
+
+    pool_allocator_t* pool = calloc(1, sizeof(pool_allocator_t));
+    if (!pool) return NULL;
+
+    pool->base.vtable = &g_pool_vtable;
+    pool->block_size = align_up(block_size < sizeof(void*) ? sizeof(void*) : block_size,
+                                ALLOC_DEFAULT_ALIGNMENT);
+    pool->blocks_per_chunk = blocks_per_chunk;
+    return pool;
+}
+
+void pool_destroy(pool_allocator_t* pool) {
+    if (!pool) return;
+
+    void* chunk = pool->chunks;
+    while (chunk) {
+        void* next = *(void**)chunk;
+        free(chunk);
+        chunk = next;
+    }
+    free(pool);
+}
+
+// ============================================================================
+// Size-class allocator
+// ============================================================================
+
+// Blocks are plain malloc allocations of their class size, recycled through
+// per-thread magazines instead of being freed. Full and empty magazines are
+// traded with a global depot of Treiber stacks; a stack head packs a
+// 32-bit ABA tag with a 1-based index into the static magazine table.
+#define SIZECLASS_MAGAZINE_SIZE 32
+#define SIZECLASS_MAX_MAGAZINES 256
+
+typedef struct sc_magazine_t {
+    uint32_t next;             // Depot link (index + 1, 0 = end)
+    uint32_t count;
+    void* blocks[SIZECLASS_MAGAZINE_SIZE];
+} sc_magazine_t;
+
+typedef struct sc_cache_t {
+    sc_magazine_t* loaded[SIZECLASS_COUNT];
+    sc_magazine_t* previous[SIZECLASS_COUNT];
+} sc_cache_t;
+
+static sc_magazine_t g_sc_magazines[SIZECLASS_MAX_MAGAZINES];
+static uint32_t g_sc_magazines_used;
+static uint64_t g_sc_full[SIZECLASS_COUNT];
+static uint64_t g_sc_empty;
+
+static pthread_key_t g_sc_key;
+static pthread_once_t g_sc_key_once = PTHREAD_ONCE_INIT;
+static __thread sc_cache_t* t_sc_cache;
+
+static void depot_push(uint64_t* head, sc_magazine_t* mag) {
+    uint32_t index = (uint32_t)(mag - g_sc_magazines) + 1;
+    uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+    uint64_t desired;
+    do {
+        __atomic_store_n(&mag->next, (uint32_t)old, __ATOMIC_RELAXED);
+        desired = ((old >> 32) + 1) << 32 | index;
+    } while (!__atomic_compare_exchange_n(head, &old, desired, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+static sc_magazine_t* depot_pop(uint64_t* head) {
+    uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+    uint64_t desired;
+    sc_magazine_t* mag;
+    do {
+        uint32_t index = (uint32_t)old;
+        if (index == 0) return NULL;
+        mag = &g_sc_magazines[index - 1];
+        // Magazines live forever, so reading a stale next is harmless; the
+        // tag makes the exchange fail if the head moved meanwhile
+        desired = ((old >> 32) + 1) << 32 | __atomic_load_n(&mag->next, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(head, &old, desired, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return mag;
+}
+
+static sc_magazine_t* magazine_empty(void) {
+    sc_magazine_t* mag = depot_pop(&g_sc_empty);
+    if (mag) return mag;
+
+    uint32_t index = __atomic_fetch_add(&g_sc_magazines_used, 1, __ATOMIC_RELAXED);
+    if (index >= SIZECLASS_MAX_MAGAZINES) {
+        __atomic_store_n(&g_sc_magazines_used, SIZECLASS_MAX_MAGAZINES, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return &g_sc_magazines[index];
+}
+
+static void magazine_return(uint32_t cls, sc_magazine_t* mag) {
+    if (!mag) return;
+    depot_push(mag->count > 0 ? &g_sc_full[cls] : &g_sc_empty, mag);
+}
+
+// Thread exit: hand cached blocks back to the depot
+static void sc_cache_release(void* data) {
+    sc_cache_t* cache = (sc_cache_t*)data;
+    for (uint32_t cls = 0; cls < SIZECLASS_COUNT; cls++) {
+        magazine_return(cls, cache->loaded[cls]);
+        magazine_return(cls, cache->previous[cls]);
+    }
+    // Later TLS destructors on this thread may still allocate
+    t_sc_cache = NULL;
+    free(cache);
+}
+
+static void sc_key_create(void) {
+    pthread_key_create(&g_sc_key, sc_cache_release);
+}
+
+static sc_cache_t* sc_cache(void) {
+    if (t_sc_cache) return t_sc_cache;
+
+    pthread_once(&g_sc_key_once, sc_key_create);
+    sc_cache_t* cache = calloc(1, sizeof(sc_cache_t));
+    if (!cache) return NULL;
+    if (pthread_setspecific(g_sc_key, cache) != 0) {
+        free(cache);
+        return NULL;
+    }
+    t_sc_cache = cache;
+    return cache;
+}
+
+static uint32_t size_class(size_t size) {
+    if (size <= ((size_t)1 << SIZECLASS_MIN_SHIFT)) return 0;
+    uint32_t shift = (uint32_t)(64 - __builtin_clzll((unsigned long long)(size - 1)));
+    return shift - SIZECLASS_MIN_SHIFT;
+}
+
+static void* sizeclass_alloc_impl(allocator_t* a, size_t size, size_t alignment) {
+    (void)a;
+    if (size > SIZECLASS_MAX_SIZE) return default_alloc(NULL, size, alignment);
+
+    // Over-aligned blocks skip the magazines but are sized to the full
+    // class, since their free recycles them into it
+    uint32_t cls = size_class(size);
+    if (alignment > ALLOC_DEFAULT_ALIGNMENT) {
+        return default_alloc(NULL, (size_t)1 << (cls + SIZECLASS_MIN_SHIFT), alignment);
+    }
+    sc_cache_t* cache = sc_cache();
+    if (cache) {
+        sc_magazine_t* mag = cache->loaded[cls];
+        if (!mag || mag->count == 0) {
+            sc_magazine_t* prev = cache->previous[cls];
+            if (prev && prev->count > 0) {
+                cache->previous[cls] = mag;
+                cache->loaded[cls] = prev;
+                mag = prev;
+            } else {
+                sc_magazine_t* full = depot_pop(&g_sc_full[cls]);
+                if (full) {
+                    if (prev) depot_push(&g_sc_empty, prev);
+                    cache->previous[cls] = mag;
+                    cache->loaded[cls] = full;
+                    mag = full;
+                }
+            }
+        }
+        if (mag && mag->count > 0) return mag->blocks[--mag->count];
+    }
+
+    return malloc((size_t)1 << (cls + SIZECLASS_MIN_SHIFT));
+}
+
+static void sizeclass_free_impl(allocator_t* a, void* ptr, size_t size) {
+    (void)a;
+    if (!ptr) return;
+    if (size > SIZECLASS_MAX_SIZE) {
+        free(ptr);
+        return;
+    }
+
+    uint32_t cls = size_class(size);
+    sc_cache_t* cache = sc_cache();
+    if (cache) {
+        sc_magazine_t* mag = cache->loaded[cls];
+        if (!mag || mag->count == SIZECLASS_MAGAZINE_SIZE) {
+            sc_magazine_t* prev = cache->previous[cls];
+            if (prev && prev->count < SIZECLASS_MAGAZINE_SIZE) {
+                cache->previous[cls] = mag;
+                cache->loaded[cls] = prev;
+                mag = prev;
+            } else {
+                sc_magazine_t* empty = magazine_empty();
+                if (empty) {
+                    if (prev) depot_push(&g_sc_full[cls], prev);
+                    cache->previous[cls] = mag;
+                    cache->loaded[cls] = empty;
+                    mag = empty;
+                }
+            }
+        }
+        if (mag && mag->count < SIZECLASS_MAGAZINE_SIZE) {
+            mag->blocks[mag->count++] = ptr;
+            return;
+        }
+    }
+
+    free(ptr);
+}
+
+static void* sizeclass_realloc_impl(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    if (!ptr) return sizeclass_alloc_impl(a, new_size, alignment);
+    if (old_size > SIZECLASS_MAX_SIZE && new_size > SIZECLASS_MAX_SIZE) {
+        return default_realloc(NULL, ptr, old_size, new_size, alignment);
+    }
+    if (old_size <= SIZECLASS_MAX_SIZE && new_size <= SIZECLASS_MAX_SIZE &&
+        size_class(old_size) == size_class(new_size) && alignment <= ALLOC_DEFAULT_ALIGNMENT) {
+        return ptr;
+    }
+
+    void* new_ptr = sizeclass_alloc_impl(a, new_size, alignment);
+    if (!new_ptr) return NULL;
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    sizeclass_free_impl(a, ptr, old_size);
+    return new_ptr;
+}
+
+static allocator_vtable_t g_sizeclass_vtable = {
+    .alloc = sizeclass_alloc_impl,
+    .realloc = sizeclass_realloc_impl,
+    .free = sizeclass_free_impl,
+    .destroy = NULL
+};
+
+static allocator_t g_sizeclass_allocator = {
+    .vtable = &g_sizeclass_vtable,
+    .user_data = NULL
+};
+
+allocator_t* allocator_sizeclass(void) {
+    return &g_sizeclass_allocator;
+}
+
+uint32_t sizeclass_magazines_used(void) {
+    return __atomic_load_n(&g_sc_magazines_used, __ATOMIC_RELAXED);
+}
+
+void* sizeclass_calloc(size_t size) {
+    void* ptr = sizeclass_alloc_impl(NULL, size, ALLOC_DEFAULT_ALIGNMENT);
+    if (ptr) memset(ptr, 0, size);
+    return ptr;
+}
+
+void sizeclass_free(void* ptr, size_t size) {
+    sizeclass_free_impl(NULL, ptr, size);
+}
+
+// ============================================================================
+// Tracking allocator
+// ============================================================================
+
+static void tracking_account_alloc(tracking_allocator_t* tracker, size_t size) {
+    if (tracker->tag) {
+        alloc_tag_add(tracker->tag, size);
+        return;
+    }
+
+    tracker->total_allocated += size;
+    tracker->allocation_count++;
+
+    size_t live = tracker->total_allocated - tracker->total_freed;
+    if (live > tracker->peak_allocated) tracker->peak_allocated = live;
+}
+
+static void tracking_account_free(tracking_allocator_t* tracker, size_t size) {
+    if (tracker->tag) {
+        alloc_tag_sub(tracker->tag, size);
+        return;
+    }
+    tracker->total_freed += size;
+}
+
+static void* tracking_alloc_impl(allocator_t* a, size_t size, size_t alignment) {
+    tracking_allocator_t* tracker = (tracking_allocator_t*)a;
+    void* ptr = tracker->backing->vtable->alloc(tracker->backing, size, alignment);
+    if (ptr) tracking_account_alloc(tracker, size);
+    return ptr;
+}
+
+static void* tracking_realloc_impl(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    tracking_allocator_t* tracker = (tracking_allocator_t*)a;
+    void* new_ptr = tracker->backing->vtable->realloc(tracker->backing, ptr, old_size, new_size, alignment);
+    if (new_ptr) {
+        if (ptr) tracking_account_free(tracker, old_size);
+        tracking_account_alloc(tracker, new_size);
+    }
+    return new_ptr;
+}
+
+static void tracking_free_impl(allocator_t* a, void* ptr, size_t size) {
+    if (!ptr) return;
+
+    tracking_allocator_t* tracker = (tracking_allocator_t*)a;
+    tracker->backing->vtable->free(tracker->backing, ptr, size);
+    tracking_account_free(tracker, size);
+}
+
+static void tracking_destroy_impl(allocator_t* a) {
+    tracking_destroy((tracking_allocator_t*)a);
+}
+
+static allocator_vtable_t g_tracking_vtable = {
+    .alloc = tracking_alloc_impl,
+    .realloc = tracking_realloc_impl,
+    .free = tracking_free_impl,
+    .destroy = tracking_destroy_impl
+};
+
+tracking_allocator_t* tracking_create(allocator_t* backing) {
+    tracking_allocator_t* tracker = calloc(1, sizeof(tracking_allocator_t));
+    if (!tracker) return NULL;
+
+    tracker->base.vtable = &g_tracking_vtable;
+    tracker->backing = backing ? backing : allocator_default();
+    return tracker;
+}
+
+void tracking_destroy(tracking_allocator_t* tracker) {
+    // The tagged allocators are static
+    if (tracker && tracker->tag) return;
+    free(tracker);
+}
+
+static void tag_report(alloc_tag_t tag) {
+    alloc_tag_stats_t stats;
+    alloc_tag_stats(tag, &stats);
+    fprintf(stderr, "[alloc] %-8s allocations=%llu live=%zu peak=%zu",
+            alloc_tag_name(tag), (unsigned long long)stats.allocations, stats.live, stats.peak);
+    if (stats.budget) fprintf(stderr, " budget=%zu", stats.budget);
+    fputc('\n', stderr);
+}
+
+void tracking_report(tracking_allocator_t* tracker) {
+    if (!tracker) {
+        for (int tag = ALLOC_TAG_NONE + 1; tag < ALLOC_TAG_COUNT; tag++) tag_report((alloc_tag_t)tag);
+        return;
+    }
+    if (tracker->tag) {
+        tag_report(tracker->tag);
+        return;
+    }
+
+    size_t live = tracker->total_allocated - tracker->total_freed;
+    fprintf(stderr, "[alloc] allocations=%u allocated=%zu freed=%zu peak=%zu live=%zu\n",
+            tracker->allocation_count, tracker->total_allocated, tracker->total_freed,
+            tracker->peak_allocated, live);
+}
+
+// ============================================================================
+// Subsystem accounting
+// ============================================================================
+
+#define ALLOC_TAG_STRIPES 8
+
+// One cache line per stripe so threads on different stripes don't share
+typedef struct {
+    _Alignas(64) int64_t live[ALLOC_TAG_COUNT];
+    uint64_t allocations[ALLOC_TAG_COUNT];
+} alloc_tag_stripe_t;
+
+static alloc_tag_stripe_t g_tag_stripes[ALLOC_TAG_STRIPES];
+static size_t g_tag_peak[ALLOC_TAG_COUNT];
+static size_t g_tag_budget[ALLOC_TAG_COUNT];
+static uint32_t g_tag_next_stripe;
+static __thread uint32_t t_tag_stripe;    // Index + 1, 0 = not yet assigned
+
+#define TAGGED_ALLOCATOR(t) { .base = { .vtable = &g_tracking_vtable }, .backing = &g_default_allocator, .tag = (t) }
+
+static tracking_allocator_t g_tagged[ALLOC_TAG_COUNT] = {
+    TAGGED_ALLOCATOR(ALLOC_TAG_NONE),
+    TAGGED_ALLOCATOR(ALLOC_TAG_PROVIDER),
+    TAGGED_ALLOCATOR(ALLOC_TAG_JSON),
+    TAGGED_ALLOCATOR(ALLOC_TAG_MEMORY),
+    TAGGED_ALLOCATOR(ALLOC_TAG_CHANNEL),
+    TAGGED_ALLOCATOR(ALLOC_TAG_AGENT),
+    TAGGED_ALLOCATOR(ALLOC_TAG_TUI),
+};
+
+static alloc_tag_stripe_t* tag_stripe(void) {
+    if (!t_tag_stripe) {
+        t_tag_stripe = __atomic_fetch_add(&g_tag_next_stripe, 1, __ATOMIC_RELAXED) % ALLOC_TAG_STRIPES + 1;
+    }
+    return &g_tag_stripes[t_tag_stripe - 1];
+}
+
+static size_t tag_sum_live(alloc_tag_t tag) {
+    int64_t live = 0;
+    for (int i = 0; i < ALLOC_TAG_STRIPES; i++) {
+        live += __atomic_load_n(&g_tag_stripes[i].live[tag], __ATOMIC_RELAXED);
+    }
+    return live > 0 ? (size_t)live : 0;
+}
+
+static size_t tag_update_peak(alloc_tag_t tag) {
+    size_t live = tag_sum_live(tag);
+    size_t peak = __atomic_load_n(&g_tag_peak[tag], __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&g_tag_peak[tag], &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return live;
+}
+
+allocator_t* allocator_tagged(alloc_tag_t tag) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return allocator_default();
+    return &g_tagged[tag].base;
+}
+
+void alloc_tag_add(alloc_tag_t tag, size_t bytes) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return;
+
+    alloc_tag_stripe_t* stripe = tag_stripe();
+    __atomic_fetch_add(&stripe->live[tag], (int64_t)bytes, __ATOMIC_RELAXED);
+    uint64_t n = __atomic_add_fetch(&stripe->allocations[tag], 1, __ATOMIC_RELAXED);
+    if (n % ALLOC_TAG_PEAK_INTERVAL == 0) tag_update_peak(tag);
+}
+
+void alloc_tag_sub(alloc_tag_t tag, size_t bytes) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return;
+    __atomic_fetch_sub(&tag_stripe()->live[tag], (int64_t)bytes, __ATOMIC_RELAXED);
+}
+
+size_t alloc_tag_live(alloc_tag_t tag) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return 0;
+    return tag_sum_live(tag);
+}
+
+void alloc_tag_stats(alloc_tag_t tag, alloc_tag_stats_t* out_stats) {
+    if (!out_stats) return;
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return;
+
+    out_stats->live = tag_update_peak(tag);
+    out_stats->peak = __atomic_load_n(&g_tag_peak[tag], __ATOMIC_RELAXED);
+    if (out_stats->peak < out_stats->live) out_stats->peak = out_stats->live;
+    for (int i = 0; i < ALLOC_TAG_STRIPES; i++) {
+        out_stats->allocations += __atomic_load_n(&g_tag_stripes[i].allocations[tag], __ATOMIC_RELAXED);
+    }
+    out_stats->budget = __atomic_load_n(&g_tag_budget[tag], __ATOMIC_RELAXED);
+}
+
+const char* alloc_tag_name(alloc_tag_t tag) {
+    switch (tag) {
+        case ALLOC_TAG_PROVIDER: return "provider";
+        case ALLOC_TAG_JSON:     return "json";
+        case ALLOC_TAG_MEMORY:   return "memory";
+        case ALLOC_TAG_CHANNEL:  return "channel";
+        case ALLOC_TAG_AGENT:    return "agent";
+        case ALLOC_TAG_TUI:      return "tui";
+        default:                 return "none";
+    }
+}
+
+void alloc_tag_set_budget(alloc_tag_t tag, size_t bytes) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return;
+    __atomic_store_n(&g_tag_budget[tag], bytes, __ATOMIC_RELAXED);
+}
+
+bool alloc_tag_over_budget(alloc_tag_t tag) {
+    if (tag == ALLOC_TAG_NONE || tag >= ALLOC_TAG_COUNT) return false;
+    size_t budget = __atomic_load_n(&g_tag_budget[tag], __ATOMIC_RELAXED);
+    return budget && tag_sum_live(tag) > budget;
+}
+
+// ============================================================================
+// Scratch allocator
+// ============================================================================
+
+static void* scratch_alloc_impl(allocator_t* a, size_t size, size_t alignment) {
+    scratch_allocator_t* scratch = (scratch_allocator_t*)a;
+
+    uintptr_t base = (uintptr_t)scratch->buffer;
+    size_t offset = align_up(base + scratch->used, alignment) - base;
+    if (offset + size > scratch->buffer_size) return NULL;
+
+    scratch->used = offset + size;
+    return (char*)scratch->buffer + offset;
+}
+
+static void* scratch_realloc_impl(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    if (new_size <= old_size && ptr) return ptr;
+
+    void* new_ptr = scratch_alloc_impl(a, new_size, alignment);
+    if (new_ptr && ptr) memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+static void scratch_free_impl(allocator_t* a, void* ptr, size_t size) {
+    (void)a;
+    (void)ptr;
+    (void)size;
+}
+
+static void scratch_destroy_impl(allocator_t* a) {
+    scratch_destroy((scratch_allocator_t*)a);
+}
+
+static allocator_vtable_t g_scratch_vtable = {
+    .alloc = scratch_alloc_impl,
+    .realloc = scratch_realloc_impl,
+    .free = scratch_free_impl,
+    .destroy = scratch_destroy_impl
+};
+
+// Buffer is stored right after the struct when owned
+scratch_allocator_t* scratch_create(size_t size) {
+    scratch_allocator_t* scratch = malloc(sizeof(scratch_allocator_t) + size);
+    if (!scratch) return NULL;
+
+    memset(scratch, 0, sizeof(scratch_allocator_t));
+    scratch->base.vtable = &g_scratch_vtable;
+    scratch->buffer = scratch + 1;
+    scratch->buffer_size = size;
+    return scratch;
+}
+
+scratch_allocator_t* scratch_create_from_buffer(void* buffer, size_t size) {
+    scratch_allocator_t* scratch = calloc(1, sizeof(scratch_allocator_t));
+    if (!scratch) return NULL;
+
+    scratch->base.vtable = &g_scratch_vtable;
+    scratch->buffer = buffer;
+    scratch->buffer_size = size;
+    return scratch;
+}
+
+void scratch_destroy(scratch_allocator_t* scratch) {
+    free(scratch);
+}
+
+void scratch_reset(scratch_allocator_t* scratch) {
+    if (scratch) scratch->used = 0;
+}
+
+size_t scratch_save(scratch_allocator_t* scratch) {
+    if (!scratch) return 0;
+    scratch->saved = scratch->used;
+    return scratch->used;
+}
+
+void scratch_restore(scratch_allocator_t* scratch, size_t mark) {
+    if (scratch && mark <= scratch->used) scratch->used = mark;
+}
+
+// Per-thread scratch space
+static _Thread_local scratch_allocator_t* t_scratch = NULL;
+
+allocator_t* allocator_scratch(void) {
+    if (!t_scratch) {
+        t_scratch = scratch_create(ALLOCATOR_SCRATCH_SIZE);
+        if (!t_scratch) return NULL;
+    }
+    return &t_scratch->base;
+}
+
+// ============================================================================
+// Generic allocator API
+// ============================================================================
+
+allocator_t* allocator_create(allocator_type_t type, size_t param1, size_t param2) {
+    switch (type) {
+        case ALLOCATOR_DEFAULT: return allocator_default();
+        case ALLOCATOR_ARENA: {
+            arena_allocator_t* arena = arena_create(param1);
+            return arena ? &arena->base : NULL;
+        }
+        case ALLOCATOR_POOL: {
+            pool_allocator_t* pool = pool_create(param1, param2);
+            return pool ? &pool->base : NULL;
+        }
+        case ALLOCATOR_TRACKING: {
+            tracking_allocator_t* tracker = tracking_create(allocator_default());
+            return tracker ? &tracker->base : NULL;
+        }
+        case ALLOCATOR_SCRATCH: {
+            scratch_allocator_t* scratch = scratch_create(param1);
+            return scratch ? &scratch->base : NULL;
+        }
+        case ALLOCATOR_SIZECLASS: return allocator_sizeclass();
+    }
+    return NULL;
+}
+
+void allocator_destroy(allocator_t* a) {
+    if (!a || a == allocator_default()) return;
+    if (a->vtable && a->vtable->destroy) a->vtable->destroy(a);
+}
+
+void* alloc(allocator_t* a, size_t size) {
+    return alloc_aligned(a, size, ALLOC_DEFAULT_ALIGNMENT);
+}
+
+void* alloc_aligned(allocator_t* a, size_t size, size_t alignment) {
+    if (!a) a = allocator_default();
+    return a->vtable->alloc(a, size, alignment);
+}
+
+void* realloc_ptr(allocator_t* a, void* ptr, size_t old_size, size_t new_size) {
+    return realloc_aligned_ptr(a, ptr, old_size, new_size, ALLOC_DEFAULT_ALIGNMENT);
+}
+
+void* realloc_aligned_ptr(allocator_t* a, void* ptr, size_t old_size, size_t new_size, size_t alignment) {
+    if (!a) a = allocator_default();
+    return a->vtable->realloc(a, ptr, old_size, new_size, alignment);
+}
+
+void free_ptr(allocator_t* a, void* ptr, size_t size) {
+    if (!ptr) return;
+    if (!a) a = allocator_default();
+    a->vtable->free(a, ptr, size);
+}
+
+str_t alloc_str(allocator_t* a, str_t src) {
+    if (!src.data) return STR_NULL;
+
+    char* data = alloc_aligned(a, (size_t)src.len + 1, 1);
+    if (!data) return STR_NULL;
+
+    memcpy(data, src.data, src.len);
+    data[src.len] = '\0';
+    return (str_t){ .data = data, .len = src.len };
+}
+
+str_t alloc_str_cstr(allocator_t* a, const char* src) {
+    if (!src) return STR_NULL;
+    return alloc_str(a, (str_t){ .data = src, .len = (uint32_t)strlen(src) });
+}
+
+void free_str(allocator_t* a, str_t str) {
+    free_ptr(a, (void*)str.data, (size_t)str.len + 1);
+}
+
+void* alloc_array(allocator_t* a, size_t element_size, size_t count) {
+    if (element_size && count > SIZE_MAX / element_size) return NULL;
+    return alloc(a, element_size * count);
+}
+
+void* realloc_array(allocator_t* a, void* ptr, size_t element_size, size_t old_count, size_t new_count) {
+    if (element_size && new_count > SIZE_MAX / element_size) return NULL;
+    return realloc_ptr(a, ptr, element_size * old_count, element_size * new_count);
+}
+
+// ============================================================================
+// Memory utilities
+// ============================================================================
+
+void zero_memory(void* ptr, size_t size) {
+    if (ptr) memset(ptr, 0, size);
+}
+
+void copy_memory(void* dst, const void* src, size_t size) {
+    if (dst && src) memcpy(dst, src, size);
+}
+
+void move_memory(void* dst, const void* src, size_t size) {
+    if (dst && src) memmove(dst, src, size);
+}
+
+bool compare_memory(const void* a, const void* b, size_t size) {
+    if (!a || !b) return a == b;
+    return memcmp(a, b, size) == 0;
+}
+
+#ifdef DEBUG
+static size_t g_track_live = 0;
+static uint32_t g_track_count = 0;
+
+void track_alloc(allocator_t* a, size_t size, const char* file, uint32_t line) {
+    (void)a;
+    (void)file;
+    (void)line;
+    g_track_live += size;
+    g_track_count++;
+}
+
+void track_free(allocator_t* a, void* ptr, size_t size, const char* file, uint32_t line) {
+    (void)a;
+    (void)ptr;
+    (void)file;
+    (void)line;
+    g_track_live -= size;
+}
+
+void track_report(void) {
+    fprintf(stderr, "[alloc] tracked allocations=%u live=%zu\n", g_track_count, g_track_live);
+}
+#endif
@@ -3,6 +3,7 @@
 
 #include "core/config.h"
 #include "core/error.h"
+#include "core/alloc.h"
 #include "json_config.h"
 
 #include <stdlib.h>
@@ -11,6 +12,8 @@
 #include <sys/stat.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 // Default configuration values
 #define DEFAULT_PROVIDER "openrouter"
@@ -20,39 +23,20 @@
 #define DEFAULT_HOST "127.0.0.1"
 #define DEFAULT_MEMORY_BACKEND "sqlite"
 
-typedef struct allocator_t {
-    void* (*alloc)(size_t size);
-    void (*free)(void* ptr);
-    void* (*realloc)(void* ptr, size_t size);
-} allocator_t;
-
-// Global default allocator using stdlib
-static void* default_alloc(size_t size) {
-    return malloc(size);
-}
-
-static void default_free(void* ptr) {
-    free(ptr);
-}
-
-static void* default_realloc(void* ptr, size_t size) {
-    return realloc(ptr, size);
+// Local wrappers: callers here name their allocator parameter "alloc",
+// which shadows the alloc() function from core/alloc.h
+static void* config_alloc(allocator_t* a, size_t size) {
+    return alloc(a, size);
 }
 
-static allocator_t g_default_allocator = {
-    .alloc = default_alloc,
-    .free = default_free,
-    .realloc = default_realloc
-};
-
-allocator_t* allocator_default(void) {
-    return &g_default_allocator;
+static void config_free(allocator_t* a, void* ptr) {
+    free_ptr(a, ptr, 0);
 }
 
 static str_t str_dup_impl(str_t s, allocator_t* alloc) {
     if (str_empty(s)) return STR_NULL;
 
-    char* data = alloc->alloc(s.len + 1);
+    char* data = config_alloc(alloc, s.len + 1);
     if (!data) return STR_NULL;
 
     memcpy(data, s.data, s.len);
@@ -63,7 +47,7 @@ static str_t str_dup_impl(str_t s, allocator_t* alloc) {
 
 static void str_free_impl(str_t s, allocator_t* alloc) {
     if (s.data) {
-        alloc->free((void*)s.data);
+        config_free(alloc, (void*)s.data);
     }
 }
 
@@ -71,7 +55,7 @@ static void str_free_impl(str_t s, allocator_t* alloc) {
 config_t* config_create(allocator_t* alloc) {
     if (!alloc) alloc = allocator_default();
 
-    config_t* config = alloc->alloc(sizeof(config_t));
+    config_t* config = config_alloc(alloc, sizeof(config_t));
     if (!config) return NULL;
 
     memset(config, 0, sizeof(config_t));
@@ -80,6 +64,91 @@ config_t* config_create(allocator_t* alloc) {
     return config;
 }
 
+// Every string, string list and optional section a config owns. The
+// walk is shared by config_destroy and the snapshot encoder/decoder so
+// that a new field only needs adding here.
+typedef struct config_visitor_t {
+    void (*string)(void* ctx, str_t* field);
+    void (*list)(void* ctx, str_t** items, uint32_t* count);
+    void (*section)(void* ctx, void* field);    // Address of a pointer field
+    void* ctx;
+} config_visitor_t;
+
+static void config_walk(config_t* c, const config_visitor_t* v) {
+    v->string(v->ctx, &c->workspace_dir);
+    v->string(v->ctx, &c->config_path);
+    v->string(v->ctx, &c->api_key);
+    v->string(v->ctx, &c->default_provider);
+    v->string(v->ctx, &c->default_model);
+
+    v->string(v->ctx, &c->memory.backend);
+    v->string(v->ctx, &c->memory.embedding_provider);
+    v->string(v->ctx, &c->memory.embedding_model);
+    v->string(v->ctx, &c->memory.shard_by);
+
+    v->string(v->ctx, &c->gateway.host);
+    v->list(v->ctx, &c->gateway.paired_tokens, &c->gateway.paired_tokens_count);
+
+    v->list(v->ctx, &c->autonomy.allowed_commands, &c->autonomy.allowed_commands_count);
+    v->list(v->ctx, &c->autonomy.forbidden_paths, &c->autonomy.forbidden_paths_count);
+
+    v->string(v->ctx, &c->runtime.docker.image);
+    v->string(v->ctx, &c->runtime.docker.network);
+    v->list(v->ctx, &c->runtime.docker.allowed_workspace_roots,
+            &c->runtime.docker.allowed_workspace_roots_count);
+
+    v->list(v->ctx, &c->reliability.fallback_providers, &c->reliability.fallback_providers_count);
+    v->section(v->ctx, &c->model_routes);
+
+    v->section(v->ctx, &c->channels.telegram);
+    v->section(v->ctx, &c->channels.discord);
+    v->section(v->ctx, &c->channels.slack);
+    v->section(v->ctx, &c->channels.webhook);
+    v->section(v->ctx, &c->channels.imessage);
+    v->section(v->ctx, &c->channels.matrix);
+    v->section(v->ctx, &c->channels.whatsapp);
+    v->section(v->ctx, &c->channels.email);
+    v->section(v->ctx, &c->channels.irc);
+
+    v->string(v->ctx, &c->tunnel.provider);
+    v->section(v->ctx, &c->tunnel.cloudflare);
+    v->section(v->ctx, &c->tunnel.tailscale);
+    v->section(v->ctx, &c->tunnel.ngrok);
+    v->section(v->ctx, &c->tunnel.custom);
+
+    v->list(v->ctx, &c->browser.allowed_domains, &c->browser.allowed_domains_count);
+    v->string(v->ctx, &c->browser.session_name);
+
+    v->string(v->ctx, &c->composio.api_key);
+    v->string(v->ctx, &c->composio.entity_id);
+
+    v->string(v->ctx, &c->identity.format);
+    v->string(v->ctx, &c->identity.aieos_path);
+    v->string(v->ctx, &c->identity.aieos_inline);
+
+    v->string(v->ctx, &c->observability.backend);
+    v->string(v->ctx, &c->observability.otel_endpoint);
+    v->string(v->ctx, &c->observability.otel_service_name);
+}
+
+static void destroy_string(void* ctx, str_t* field) {
+    str_free_impl(*field, ctx);
+}
+
+static void destroy_list(void* ctx, str_t** items, uint32_t* count) {
+    if (!*items) return;
+    for (uint32_t i = 0; i < *count; i++) {
+        str_free_impl((*items)[i], ctx);
+    }
+    config_free(ctx, *items);
+}
+
+// Nothing in this file allocates the optional sections yet
+static void destroy_section(void* ctx, void* field) {
+    (void)ctx;
+    (void)field;
+}
+
 // Destroy a configuration and free all associated memory
 void config_destroy(config_t* config) {
     if (!config) return;
@@ -87,53 +156,16 @@ void config_destroy(config_t* config) {
     allocator_t* alloc = config->alloc;
     if (!alloc) alloc = allocator_default();
 
-    // Free all string fields
-    str_free_impl(config->workspace_dir, alloc);
-    str_free_impl(config->config_path, alloc);
-    str_free_impl(config->api_key, alloc);
-    str_free_impl(config->default_provider, alloc);
-    str_free_impl(config->default_model, alloc);
-
-    // Free memory configuration strings
-    str_free_impl(config->memory.backend, alloc);
-    str_free_impl(config->memory.embedding_provider, alloc);
-    str_free_impl(config->memory.embedding_model, alloc);
-
-    // Free gateway configuration
-    str_free_impl(config->gateway.host, alloc);
-    if (config->gateway.paired_tokens) {
-        for (uint32_t i = 0; i < config->gateway.paired_tokens_count; i++) {
-            str_free_impl(config->gateway.paired_tokens[i], alloc);
-        }
-        alloc->free(config->gateway.paired_tokens);
-    }
-
-    // Free autonomy configuration arrays
-    if (config->autonomy.allowed_commands) {
-        for (uint32_t i = 0; i < config->autonomy.allowed_commands_count; i++) {
-            str_free_impl(config->autonomy.allowed_commands[i], alloc);
-        }
-        alloc->free(config->autonomy.allowed_commands);
-    }
-    if (config->autonomy.forbidden_paths) {
-        for (uint32_t i = 0; i < config->autonomy.forbidden_paths_count; i++) {
-            str_free_impl(config->autonomy.forbidden_paths[i], alloc);
-        }
-        alloc->free(config->autonomy.forbidden_paths);
-    }
-
-    // Free runtime configuration
-    str_free_impl(config->runtime.docker.image, alloc);
-    str_free_impl(config->runtime.docker.network, alloc);
-    if (config->runtime.docker.allowed_workspace_roots) {
-        for (uint32_t i = 0; i < config->runtime.docker.allowed_workspace_roots_count; i++) {
-            str_free_impl(config->runtime.docker.allowed_workspace_roots[i], alloc);
-        }
-        alloc->free(config->runtime.docker.allowed_workspace_roots);
-    }
+    config_visitor_t visitor = {
+        .string = destroy_string,
+        .list = destroy_list,
+        .section = destroy_section,
+        .ctx = alloc,
+    };
+    config_walk(config, &visitor);
 
     // Free the config itself
-    alloc->free(config);
+    config_free(alloc, config);
 }
 
 // Create a default configuration
@@ -162,6 +194,10 @@ config_t* config_default(allocator_t* alloc) {
     config->memory.keyword_weight = 0.3;
     config->memory.embedding_cache_size = 10000;
     config->memory.chunk_max_tokens = 512;
+    config->memory.recall_cache_size = 1024;
+    config->memory.compression = false;
+    config->memory.shards = 0;
+    config->memory.shard_by = str_dup_impl(STR_LIT("key"), alloc);
 
     // Gateway configuration
     config->gateway.port = DEFAULT_PORT;
@@ -171,6 +207,7 @@ config_t* config_default(allocator_t* alloc) {
     config->gateway.pair_rate_limit_per_minute = 10;
     config->gateway.webhook_rate_limit_per_minute = 60;
     config->gateway.idempotency_ttl_secs = 300;
+    config->gateway.listener_threads = 1;
 
     // Autonomy configuration
     config->autonomy.level = AUTONOMY_LEVEL_SUPERVISED;
@@ -186,7 +223,7 @@ config_t* config_default(allocator_t* alloc) {
         "echo", "pwd", "wc", "head", "tail"
     };
     config->autonomy.allowed_commands_count = sizeof(default_commands) / sizeof(default_commands[0]);
-    config->autonomy.allowed_commands = alloc->alloc(sizeof(str_t) * config->autonomy.allowed_commands_count);
+    config->autonomy.allowed_commands = config_alloc(alloc, sizeof(str_t) * config->autonomy.allowed_commands_count);
     for (uint32_t i = 0; i < config->autonomy.allowed_commands_count; i++) {
         config->autonomy.allowed_commands[i] = str_dup_impl(STR_VIEW(default_commands[i]), alloc);
     }
@@ -198,7 +235,7 @@ config_t* config_default(allocator_t* alloc) {
         "/var", "/tmp", "~/.ssh", "~/.gnupg", "~/.aws", "~/.config"
     };
     config->autonomy.forbidden_paths_count = sizeof(default_forbidden) / sizeof(default_forbidden[0]);
-    config->autonomy.forbidden_paths = alloc->alloc(sizeof(str_t) * config->autonomy.forbidden_paths_count);
+    config->autonomy.forbidden_paths = config_alloc(alloc, sizeof(str_t) * config->autonomy.forbidden_paths_count);
     for (uint32_t i = 0; i < config->autonomy.forbidden_paths_count; i++) {
         config->autonomy.forbidden_paths[i] = str_dup_impl(STR_VIEW(default_forbidden[i]), alloc);
     }
@@ -211,6 +248,8 @@ config_t* config_default(allocator_t* alloc) {
     config->runtime.docker.cpu_limit = 1.0;
     config->runtime.docker.read_only_rootfs = true;
     config->runtime.docker.mount_workspace = true;
+    config->runtime.docker.pool_size = 2;
+    config->runtime.docker.max_uses = 50;
 
     // Reliability configuration
     config->reliability.provider_retries = 2;
@@ -219,6 +258,14 @@ config_t* config_default(allocator_t* alloc) {
     config->reliability.channel_max_backoff_secs = 60;
     config->reliability.scheduler_poll_secs = 15;
     config->reliability.scheduler_retries = 2;
+    config->reliability.prewarm_providers = true;
+
+    // Response cache configuration
+    config->response_cache.enabled = false;
+    config->response_cache.max_entries = 256;
+    config->response_cache.ttl_secs = 86400;
+    config->response_cache.persist = true;
+    config->response_cache.max_temperature = 0.0;
 
     // Heartbeat configuration
     config->heartbeat.enabled = false;
@@ -226,6 +273,8 @@ config_t* config_default(allocator_t* alloc) {
 
     // Channel configuration
     config->channels.cli = true;
+    config->channels.agent_workers = 4;
+    config->channels.inbound_queue_capacity = 1024;
 
     // Tunnel configuration
     config->tunnel.provider = str_dup_impl(STR_LIT("none"), alloc);
@@ -259,7 +308,7 @@ static str_t* load_string_array(json_array_t* arr, uint32_t* count, allocator_t*
         return NULL;
     }
 
-    str_t* strings = alloc->alloc(sizeof(str_t) * len);
+    str_t* strings = config_alloc(alloc, sizeof(str_t) * len);
     if (!strings) return NULL;
 
     for (size_t i = 0; i < len; i++) {
@@ -272,6 +321,426 @@ static str_t* load_string_array(json_array_t* arr, uint32_t* count, allocator_t*
     return strings;
 }
 
+// ============================================================================
+// Binary snapshot
+// ============================================================================
+
+// File layout: a header, then a copy of config_t with every string and
+// list pointer replaced by its offset into the pool that follows (plus
+// one, so 0 stays NULL). Pool strings are NUL-terminated and lists are
+// arrays of str_t encoded the same way.
+
+#define SNAPSHOT_MAGIC "CCLAWSNP"
+#define SNAPSHOT_MAX_BYTES (4u * 1024 * 1024)
+#define SNAPSHOT_FNV_OFFSET 0xcbf29ce484222325ULL
+#define SNAPSHOT_FNV_PRIME 0x100000001b3ULL
+
+// The JSON file a snapshot was built from
+typedef struct snapshot_key_t {
+    uint64_t mtime_ns;
+    uint64_t size;
+    uint64_t hash;
+} snapshot_key_t;
+
+typedef struct snapshot_header_t {
+    char magic[8];
+    uint32_t version;          // CONFIG_SNAPSHOT_VERSION
+    uint32_t image_size;       // sizeof(config_t) in the writing build
+    uint64_t layout;           // Hash of the walked field offsets
+    snapshot_key_t source;
+    uint64_t payload_size;     // Image plus pool
+    uint64_t payload_hash;
+} snapshot_header_t;
+
+// FNV-1a over 8-byte words, then the tail a byte at a time. It only has
+// to notice edits; hashed a byte at a time, the two files took about as
+// long as parsing the JSON.
+static uint64_t snapshot_hash(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        h ^= word;
+        h *= SNAPSHOT_FNV_PRIME;
+        h ^= h >> 29;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= *p;
+        h *= SNAPSHOT_FNV_PRIME;
+    }
+    return h;
+}
+
+static bool snapshot_enabled(void) {
+    const char* env = getenv("CCLAW_CONFIG_SNAPSHOT");
+    return !env || strcmp(env, "0") != 0;
+}
+
+static err_t read_file(const char* path, size_t max_bytes, char** out_data, size_t* out_len, struct stat* out_st) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT ? ERR_FILE_NOT_FOUND : ERR_IO;
+
+    if (fstat(fd, out_st) != 0 || !S_ISREG(out_st->st_mode)) {
+        close(fd);
+        return ERR_IO;
+    }
+    if ((uint64_t)out_st->st_size > max_bytes) {
+        close(fd);
+        return ERR_FILE_TOO_LARGE;
+    }
+
+    size_t len = (size_t)out_st->st_size;
+    char* data = malloc(len + 1);
+    if (!data) {
+        close(fd);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, data + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    close(fd);
+    if (done != len) {
+        free(data);
+        return ERR_IO;
+    }
+
+    data[len] = '\0';
+    *out_data = data;
+    *out_len = len;
+    return ERR_OK;
+}
+
+// Reads the JSON text and the key a snapshot of it is stored under
+static err_t source_read(const char* path, char** out_text, snapshot_key_t* out_key) {
+    struct stat st;
+    size_t len = 0;
+    err_t err = read_file(path, SNAPSHOT_MAX_BYTES, out_text, &len, &st);
+    if (err != ERR_OK) return err;
+
+#ifdef __APPLE__
+    out_key->mtime_ns = (uint64_t)st.st_mtimespec.tv_sec * 1000000000ULL + (uint64_t)st.st_mtimespec.tv_nsec;
+#else
+    out_key->mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    out_key->size = len;
+    out_key->hash = snapshot_hash(SNAPSHOT_FNV_OFFSET, *out_text, len);
+    return ERR_OK;
+}
+
+// Layout fingerprint: catches a build whose config_t moved a string or
+// list without anyone bumping CONFIG_SNAPSHOT_VERSION
+typedef struct layout_ctx_t {
+    const char* base;
+    uint64_t hash;
+} layout_ctx_t;
+
+static void layout_field(layout_ctx_t* l, char kind, const void* field) {
+    uint64_t offset = (uint64_t)((const char*)field - l->base);
+    l->hash = snapshot_hash(l->hash, &kind, 1);
+    l->hash = snapshot_hash(l->hash, &offset, sizeof(offset));
+}
+
+static void layout_string(void* ctx, str_t* field) {
+    layout_field(ctx, 's', field);
+}
+
+static void layout_list(void* ctx, str_t** items, uint32_t* count) {
+    layout_field(ctx, 'l', items);
+    layout_field(ctx, 'n', count);
+}
+
+static void layout_section(void* ctx, void* field) {
+    layout_field(ctx, 'p', field);
+}
+
+static uint64_t snapshot_layout(void) {
+    config_t probe;
+    memset(&probe, 0, sizeof(probe));
+    layout_ctx_t l = { .base = (const char*)&probe, .hash = SNAPSHOT_FNV_OFFSET };
+    config_visitor_t visitor = { layout_string, layout_list, layout_section, &l };
+    config_walk(&probe, &visitor);
+    return l.hash;
+}
+
+typedef struct snapshot_writer_t {
+    char* pool;
+    size_t len;
+    size_t cap;
+    bool unsupported;          // An optional section is set
+    bool failed;
+} snapshot_writer_t;
+
+// Reserves len bytes at an aligned offset; SIZE_MAX on failure
+static size_t pool_reserve(snapshot_writer_t* w, size_t len, size_t align) {
+    size_t offset = (w->len + align - 1) & ~(align - 1);
+    if (offset + len > w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 1024;
+        while (cap < offset + len) cap *= 2;
+        char* pool = realloc(w->pool, cap);
+        if (!pool) {
+            w->failed = true;
+            return SIZE_MAX;
+        }
+        w->pool = pool;
+        w->cap = cap;
+    }
+    memset(w->pool + w->len, 0, offset + len - w->len);
+    w->len = offset + len;
+    return offset;
+}
+
+static void encode_string(void* ctx, str_t* field) {
+    snapshot_writer_t* w = ctx;
+    if (!field->data) {
+        field->len = 0;
+        return;
+    }
+
+    size_t offset = pool_reserve(w, (size_t)field->len + 1, 1);
+    if (offset == SIZE_MAX) {
+        *field = STR_NULL;
+        return;
+    }
+    memcpy(w->pool + offset, field->data, field->len);
+    field->data = (const char*)(uintptr_t)(offset + 1);
+}
+
+static void encode_list(void* ctx, str_t** items, uint32_t* count) {
+    snapshot_writer_t* w = ctx;
+    if (!*items || *count == 0) {
+        *items = NULL;
+        *count = 0;
+        return;
+    }
+
+    size_t offset = pool_reserve(w, sizeof(str_t) * *count, _Alignof(str_t));
+    if (offset == SIZE_MAX) {
+        *items = NULL;
+        *count = 0;
+        return;
+    }
+    for (uint32_t i = 0; i < *count; i++) {
+        str_t item = (*items)[i];
+        encode_string(w, &item);
+        memcpy(w->pool + offset + i * sizeof(str_t), &item, sizeof(item));
+    }
+    *items = (str_t*)(uintptr_t)(offset + 1);
+}
+
+static void encode_section(void* ctx, void* field) {
+    snapshot_writer_t* w = ctx;
+    void* section = NULL;
+    memcpy(&section, field, sizeof(section));
+    if (section) w->unsupported = true;
+}
+
+typedef struct snapshot_reader_t {
+    const char* pool;
+    size_t len;
+    allocator_t* alloc;
+    err_t err;
+} snapshot_reader_t;
+
+static str_t decode_str(snapshot_reader_t* r, str_t encoded) {
+    uintptr_t offset = (uintptr_t)encoded.data;
+    if (offset == 0) return STR_NULL;
+
+    offset--;
+    if (offset >= r->len || encoded.len >= r->len - offset || r->pool[offset + encoded.len] != '\0') {
+        r->err = ERR_CONFIG_PARSE;
+        return STR_NULL;
+    }
+
+    str_t s = str_dup_impl((str_t){ .data = r->pool + offset, .len = encoded.len }, r->alloc);
+    if (!s.data && encoded.len > 0) r->err = ERR_OUT_OF_MEMORY;
+    return s;
+}
+
+static void decode_string(void* ctx, str_t* field) {
+    *field = decode_str(ctx, *field);
+}
+
+static void decode_list(void* ctx, str_t** items, uint32_t* count) {
+    snapshot_reader_t* r = ctx;
+    uintptr_t offset = (uintptr_t)*items;
+    uint32_t n = *count;
+    *items = NULL;
+    *count = 0;
+    if (offset == 0 || n == 0) return;
+
+    offset--;
+    if (offset > r->len || (uint64_t)n * sizeof(str_t) > r->len - offset) {
+        r->err = ERR_CONFIG_PARSE;
+        return;
+    }
+
+    str_t* list = config_alloc(r->alloc, sizeof(str_t) * n);
+    if (!list) {
+        r->err = ERR_OUT_OF_MEMORY;
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        str_t item;
+        memcpy(&item, r->pool + offset + i * sizeof(str_t), sizeof(item));
+        list[i] = decode_str(r, item);
+    }
+    *items = list;
+    *count = n;
+}
+
+static void decode_section(void* ctx, void* field) {
+    (void)ctx;
+    memset(field, 0, sizeof(void*));
+}
+
+static void snapshot_path(const char* source_path, char* out, size_t size) {
+    snprintf(out, size, "%s.snap", source_path);
+}
+
+static err_t write_all(int fd, const void* data, size_t len) {
+    const char* p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return ERR_WRITE_FAILED;
+        p += n;
+        len -= (size_t)n;
+    }
+    return ERR_OK;
+}
+
+static err_t snapshot_save_keyed(const config_t* config, const char* source_path, const snapshot_key_t* key) {
+    config_t image;
+    memcpy(&image, config, sizeof(image));
+    image.alloc = NULL;
+
+    snapshot_writer_t w = {0};
+    config_visitor_t visitor = { encode_string, encode_list, encode_section, &w };
+    config_walk(&image, &visitor);
+    if (w.unsupported || w.failed) {
+        free(w.pool);
+        return w.unsupported ? ERR_NOT_IMPLEMENTED : ERR_OUT_OF_MEMORY;
+    }
+
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = CONFIG_SNAPSHOT_VERSION;
+    header.image_size = (uint32_t)sizeof(config_t);
+    header.layout = snapshot_layout();
+    header.source = *key;
+    header.payload_size = sizeof(image) + w.len;
+    header.payload_hash = snapshot_hash(snapshot_hash(SNAPSHOT_FNV_OFFSET, &image, sizeof(image)), w.pool, w.len);
+
+    // Same temp-then-rename as config_save; 0600 since it holds the API key
+    char path[528], temp_path[536];
+    snapshot_path(source_path, path, sizeof(path));
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        free(w.pool);
+        return ERR_IO;
+    }
+    err_t err = write_all(fd, &header, sizeof(header));
+    if (err == ERR_OK) err = write_all(fd, &image, sizeof(image));
+    if (err == ERR_OK) err = write_all(fd, w.pool, w.len);
+    close(fd);
+    free(w.pool);
+
+    if (err == ERR_OK && rename(temp_path, path) != 0) err = ERR_IO;
+    if (err != ERR_OK) remove(temp_path);
+    return err;
+}
+
+static err_t snapshot_load_keyed(const char* source_path, const snapshot_key_t* key, allocator_t* alloc,
+                                 config_t** out_config) {
+    char path[528];
+    snapshot_path(source_path, path, sizeof(path));
+
+    char* data = NULL;
+    size_t len = 0;
+    struct stat st;
+    err_t err = read_file(path, SNAPSHOT_MAX_BYTES, &data, &len, &st);
+    if (err != ERR_OK) return ERR_NOT_FOUND;
+
+    // Anything that doesn't match is stale, not an error: the caller
+    // parses the JSON and writes a fresh snapshot
+    snapshot_header_t header;
+    if (len < sizeof(header) + sizeof(config_t)) {
+        free(data);
+        return ERR_NOT_FOUND;
+    }
+    memcpy(&header, data, sizeof(header));
+    const char* payload = data + sizeof(header);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CONFIG_SNAPSHOT_VERSION ||
+        header.image_size != sizeof(config_t) ||
+        header.layout != snapshot_layout() ||
+        header.source.mtime_ns != key->mtime_ns ||
+        header.source.size != key->size ||
+        header.source.hash != key->hash ||
+        header.payload_size != len - sizeof(header) ||
+        header.payload_hash != snapshot_hash(SNAPSHOT_FNV_OFFSET, payload, len - sizeof(header))) {
+        free(data);
+        return ERR_NOT_FOUND;
+    }
+
+    config_t* config = config_create(alloc);
+    if (!config) {
+        free(data);
+        return ERR_OUT_OF_MEMORY;
+    }
+    memcpy(config, payload, sizeof(config_t));
+    config->alloc = alloc ? alloc : allocator_default();
+
+    snapshot_reader_t r = {
+        .pool = payload + sizeof(config_t),
+        .len = len - sizeof(header) - sizeof(config_t),
+        .alloc = config->alloc,
+        .err = ERR_OK,
+    };
+    config_visitor_t visitor = { decode_string, decode_list, decode_section, &r };
+    config_walk(config, &visitor);
+    free(data);
+
+    if (r.err != ERR_OK) {
+        config_destroy(config);
+        return r.err;
+    }
+
+    *out_config = config;
+    return ERR_OK;
+}
+
+err_t config_snapshot_save(const config_t* config, const char* source_path) {
+    if (!config || !source_path) return ERR_INVALID_ARGUMENT;
+
+    char* text = NULL;
+    snapshot_key_t key;
+    err_t err = source_read(source_path, &text, &key);
+    if (err != ERR_OK) return err;
+    free(text);
+
+    return snapshot_save_keyed(config, source_path, &key);
+}
+
+err_t config_snapshot_load(const char* source_path, allocator_t* alloc, config_t** out_config) {
+    if (!source_path || !out_config) return ERR_INVALID_ARGUMENT;
+
+    char* text = NULL;
+    snapshot_key_t key;
+    if (source_read(source_path, &text, &key) != ERR_OK) return ERR_NOT_FOUND;
+    free(text);
+
+    return snapshot_load_keyed(source_path, &key, alloc, out_config);
+}
+
 // Load configuration from file
 err_t config_load(str_t path, config_t** out_config) {
     if (!out_config) return ERR_INVALID_ARGUMENT;
@@ -318,8 +787,20 @@ err_t config_load(str_t path, config_t** out_config) {
         return ERR_OK;
     }
 
-    // Parse existing config
-    json_value_t* json = json_parse_file(config_path);
+    // Parse existing config, unless an earlier run left a snapshot of
+    // this exact file
+    char* text = NULL;
+    snapshot_key_t key;
+    bool use_snapshot = snapshot_enabled() && source_read(config_path, &text, &key) == ERR_OK;
+    if (use_snapshot && snapshot_load_keyed(config_path, &key, alloc, out_config) == ERR_OK) {
+        free(text);
+        str_free_impl((*out_config)->config_path, alloc);
+        (*out_config)->config_path = str_dup_impl(STR_VIEW(config_path), alloc);
+        return ERR_OK;
+    }
+
+    json_value_t* json = text ? json_parse(text) : json_parse_file(config_path);
+    free(text);
     if (!json) {
         // Parse error, fall back to default
         config_t* config = config_default(alloc);
@@ -345,6 +826,11 @@ err_t config_load(str_t path, config_t** out_config) {
         // Set config_path for loaded config
         if (*out_config) {
             (*out_config)->config_path = str_dup_impl(STR_VIEW(config_path), alloc);
+
+            // Best effort: without a snapshot the next run just parses again
+            if (use_snapshot && config_validate(*out_config) == ERR_OK) {
+                snapshot_save_keyed(*out_config, config_path, &key);
+            }
         }
     } else {
         // Error, use default
@@ -394,6 +880,7 @@ err_t config_from_json_str(json_value_t* json, allocator_t* alloc, config_t** ou
     }
 
     config->default_temperature = json_object_get_number(root, "default_temperature", DEFAULT_TEMPERATURE);
+    config->compress_requests = json_object_get_bool(root, "compress_requests", false);
 
     // Workspace directory
     const char* workspace_dir = json_object_get_string(root, "workspace_dir", NULL);
@@ -414,6 +901,34 @@ err_t config_from_json_str(json_value_t* json, allocator_t* alloc, config_t** ou
         config->memory.hygiene_enabled = json_object_get_bool(memory, "hygiene_enabled", true);
         config->memory.archive_after_days = (uint32_t)json_object_get_number(memory, "archive_after_days", 7);
         config->memory.purge_after_days = (uint32_t)json_object_get_number(memory, "purge_after_days", 30);
+
+        const char* embedding_provider = json_object_get_string(memory, "embedding_provider", NULL);
+        if (embedding_provider) {
+            str_free_impl(config->memory.embedding_provider, alloc);
+            config->memory.embedding_provider = str_dup_impl(STR_VIEW(embedding_provider), alloc);
+        }
+        const char* embedding_model = json_object_get_string(memory, "embedding_model", NULL);
+        if (embedding_model) {
+            str_free_impl(config->memory.embedding_model, alloc);
+            config->memory.embedding_model = str_dup_impl(STR_VIEW(embedding_model), alloc);
+        }
+        config->memory.embedding_dimensions = (uint32_t)json_object_get_number(
+            memory, "embedding_dimensions", config->memory.embedding_dimensions);
+        config->memory.vector_weight = json_object_get_number(memory, "vector_weight", config->memory.vector_weight);
+        config->memory.keyword_weight = json_object_get_number(memory, "keyword_weight", config->memory.keyword_weight);
+        config->memory.embedding_cache_size = (uint32_t)json_object_get_number(
+            memory, "embedding_cache_size", config->memory.embedding_cache_size);
+        config->memory.chunk_max_tokens = (uint32_t)json_object_get_number(
+            memory, "chunk_max_tokens", config->memory.chunk_max_tokens);
+        config->memory.recall_cache_size = (uint32_t)json_object_get_number(
+            memory, "recall_cache_size", config->memory.recall_cache_size);
+        config->memory.compression = json_object_get_bool(memory, "compression", config->memory.compression);
+        config->memory.shards = (uint32_t)json_object_get_number(memory, "shards", config->memory.shards);
+        const char* shard_by = json_object_get_string(memory, "shard_by", NULL);
+        if (shard_by) {
+            str_free_impl(config->memory.shard_by, alloc);
+            config->memory.shard_by = str_dup_impl(STR_VIEW(shard_by), alloc);
+        }
     }
 
     // Gateway configuration
@@ -427,6 +942,68 @@ err_t config_from_json_str(json_value_t* json, allocator_t* alloc, config_t** ou
         }
         config->gateway.require_pairing = json_object_get_bool(gateway, "require_pairing", true);
         config->gateway.allow_public_bind = json_object_get_bool(gateway, "allow_public_bind", false);
+        config->gateway.listener_threads = (uint32_t)json_object_get_number(gateway, "listener_threads", 1);
+        config->gateway.pair_rate_limit_per_minute =
+            (uint32_t)json_object_get_number(gateway, "pair_rate_limit_per_minute", 10);
+        config->gateway.webhook_rate_limit_per_minute =
+            (uint32_t)json_object_get_number(gateway, "webhook_rate_limit_per_minute", 60);
+        config->gateway.idempotency_ttl_secs =
+            (uint64_t)json_object_get_number(gateway, "idempotency_ttl_secs", 300);
+    }
+
+    // Channel configuration
+    json_object_t* channels = json_object_get_object(root, "channels");
+    if (channels) {
+        config->channels.cli = json_object_get_bool(channels, "cli", true);
+        config->channels.agent_workers = (uint32_t)json_object_get_number(channels, "agent_workers", 4);
+        config->channels.inbound_queue_capacity =
+            (uint32_t)json_object_get_number(channels, "inbound_queue_capacity", 1024);
+    }
+
+    // Reliability configuration
+    json_object_t* reliability = json_object_get_object(root, "reliability");
+    if (reliability) {
+        config->reliability.prewarm_providers = json_object_get_bool(reliability, "prewarm_providers",
+                                                                     config->reliability.prewarm_providers);
+    }
+
+    // Response cache configuration
+    json_object_t* response_cache = json_object_get_object(root, "response_cache");
+    if (response_cache) {
+        config->response_cache.enabled = json_object_get_bool(response_cache, "enabled", false);
+        config->response_cache.max_entries = (uint32_t)json_object_get_number(
+            response_cache, "max_entries", config->response_cache.max_entries);
+        config->response_cache.ttl_secs = (uint64_t)json_object_get_number(
+            response_cache, "ttl_secs", (double)config->response_cache.ttl_secs);
+        config->response_cache.persist = json_object_get_bool(response_cache, "persist",
+                                                              config->response_cache.persist);
+        config->response_cache.max_temperature = json_object_get_number(
+            response_cache, "max_temperature", config->response_cache.max_temperature);
+    }
+
+    // Runtime configuration
+    json_object_t* runtime = json_object_get_object(root, "runtime");
+    if (runtime) {
+        config->runtime.kind = (runtime_kind_t)(int)json_object_get_number(runtime, "kind", RUNTIME_KIND_NATIVE);
+        json_object_t* docker = json_object_get_object(runtime, "docker");
+        if (docker) {
+            const char* image = json_object_get_string(docker, "image", NULL);
+            if (image) {
+                str_free_impl(config->runtime.docker.image, alloc);
+                config->runtime.docker.image = str_dup_impl(STR_VIEW(image), alloc);
+            }
+            const char* network = json_object_get_string(docker, "network", NULL);
+            if (network) {
+                str_free_impl(config->runtime.docker.network, alloc);
+                config->runtime.docker.network = str_dup_impl(STR_VIEW(network), alloc);
+            }
+            config->runtime.docker.memory_limit_mb = (uint64_t)json_object_get_number(docker, "memory_limit_mb", 512);
+            config->runtime.docker.cpu_limit = json_object_get_number(docker, "cpu_limit", 1.0);
+            config->runtime.docker.read_only_rootfs = json_object_get_bool(docker, "read_only_rootfs", true);
+            config->runtime.docker.mount_workspace = json_object_get_bool(docker, "mount_workspace", true);
+            config->runtime.docker.pool_size = (uint32_t)json_object_get_number(docker, "pool_size", 2);
+            config->runtime.docker.max_uses = (uint32_t)json_object_get_number(docker, "max_uses", 50);
+        }
     }
 
     // Autonomy configuration
@@ -502,6 +1079,7 @@ err_t config_save(config_t* config, str_t path) {
     json_object_set_string(json, "default_provider", str_empty(config->default_provider) ? DEFAULT_PROVIDER : config->default_provider.data);
     json_object_set_string(json, "default_model", str_empty(config->default_model) ? DEFAULT_MODEL : config->default_model.data);
     json_object_set_number(json, "default_temperature", config->default_temperature);
+    json_object_set_bool(json, "compress_requests", config->compress_requests);
 
     // Memory configuration
     json_value_t* memory = json_create_object();
@@ -511,6 +1089,17 @@ err_t config_save(config_t* config, str_t path) {
     json_object_set_number(memory, "archive_after_days", config->memory.archive_after_days);
     json_object_set_number(memory, "purge_after_days", config->memory.purge_after_days);
     json_object_set_number(memory, "conversation_retention_days", config->memory.conversation_retention_days);
+    json_object_set_string(memory, "embedding_provider", config->memory.embedding_provider.data);
+    json_object_set_string(memory, "embedding_model", config->memory.embedding_model.data);
+    json_object_set_number(memory, "embedding_dimensions", config->memory.embedding_dimensions);
+    json_object_set_number(memory, "vector_weight", config->memory.vector_weight);
+    json_object_set_number(memory, "keyword_weight", config->memory.keyword_weight);
+    json_object_set_number(memory, "embedding_cache_size", config->memory.embedding_cache_size);
+    json_object_set_number(memory, "chunk_max_tokens", config->memory.chunk_max_tokens);
+    json_object_set_number(memory, "recall_cache_size", config->memory.recall_cache_size);
+    json_object_set_bool(memory, "compression", config->memory.compression);
+    json_object_set_number(memory, "shards", config->memory.shards);
+    json_object_set_string(memory, "shard_by", str_empty(config->memory.shard_by) ? "key" : config->memory.shard_by.data);
     json_object_set(json, "memory", memory);
 
     // Gateway configuration
@@ -521,8 +1110,17 @@ err_t config_save(config_t* config, str_t path) {
     json_object_set_bool(gateway, "allow_public_bind", config->gateway.allow_public_bind);
     json_object_set_number(gateway, "pair_rate_limit_per_minute", config->gateway.pair_rate_limit_per_minute);
     json_object_set_number(gateway, "webhook_rate_limit_per_minute", config->gateway.webhook_rate_limit_per_minute);
+    json_object_set_number(gateway, "idempotency_ttl_secs", (double)config->gateway.idempotency_ttl_secs);
+    json_object_set_number(gateway, "listener_threads", config->gateway.listener_threads);
     json_object_set(json, "gateway", gateway);
 
+    // Channel configuration
+    json_value_t* channels = json_create_object();
+    json_object_set_bool(channels, "cli", config->channels.cli);
+    json_object_set_number(channels, "agent_workers", config->channels.agent_workers);
+    json_object_set_number(channels, "inbound_queue_capacity", config->channels.inbound_queue_capacity);
+    json_object_set(json, "channels", channels);
+
     // Autonomy configuration
     json_value_t* autonomy = json_create_object();
     json_object_set_number(autonomy, "level", config->autonomy.level);
@@ -554,6 +1152,8 @@ err_t config_save(config_t* config, str_t path) {
     json_object_set_number(docker, "cpu_limit", config->runtime.docker.cpu_limit);
     json_object_set_bool(docker, "read_only_rootfs", config->runtime.docker.read_only_rootfs);
     json_object_set_bool(docker, "mount_workspace", config->runtime.docker.mount_workspace);
+    json_object_set_number(docker, "pool_size", config->runtime.docker.pool_size);
+    json_object_set_number(docker, "max_uses", config->runtime.docker.max_uses);
     json_object_set(runtime, "docker", docker);
     json_object_set(json, "runtime", runtime);
 
@@ -563,8 +1163,18 @@ err_t config_save(config_t* config, str_t path) {
     json_object_set_number(reliability, "provider_backoff_ms", config->reliability.provider_backoff_ms);
     json_object_set_number(reliability, "channel_initial_backoff_secs", config->reliability.channel_initial_backoff_secs);
     json_object_set_number(reliability, "channel_max_backoff_secs", config->reliability.channel_max_backoff_secs);
+    json_object_set_bool(reliability, "prewarm_providers", config->reliability.prewarm_providers);
     json_object_set(json, "reliability", reliability);
 
+    // Response cache configuration
+    json_value_t* response_cache = json_create_object();
+    json_object_set_bool(response_cache, "enabled", config->response_cache.enabled);
+    json_object_set_number(response_cache, "max_entries", config->response_cache.max_entries);
+    json_object_set_number(response_cache, "ttl_secs", (double)config->response_cache.ttl_secs);
+    json_object_set_bool(response_cache, "persist", config->response_cache.persist);
+    json_object_set_number(response_cache, "max_temperature", config->response_cache.max_temperature);
+    json_object_set(json, "response_cache", response_cache);
+
     // Heartbeat configuration
     json_value_t* heartbeat = json_create_object();
     json_object_set_bool(heartbeat, "enabled", config->heartbeat.enabled);
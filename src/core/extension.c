@@ -3,26 +3,53 @@
 
 #include "core/extension.h"
 #include "core/alloc.h"
+#include "json_config.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if defined(__linux__) && !defined(__ANDROID__)
+    #define EXTENSION_WATCH_INOTIFY 1
+    #include <sys/inotify.h>
+#elif defined(__APPLE__)
+    #define EXTENSION_WATCH_KQUEUE 1
+    #include <sys/event.h>
+#endif
+
 // ============================================================================
 // Internal Registry
 // ============================================================================
 
 #define MAX_EXTENSIONS 64
 
+static err_t native_read_manifest(const char* library_path, extension_manifest_t* out_manifest);
+static err_t native_attach(extension_t* ext);
+static void native_detach(extension_t* ext);
+static err_t native_bind(extension_t* ext);
+
 static struct {
     extension_t* extensions[MAX_EXTENSIONS];
     uint32_t count;
     bool initialized;
+
+    // Hot reload
     str_t watch_dir;
     bool watching;
+    int watch_fd;                   // inotify or kqueue descriptor, -1 while polling
+#ifdef EXTENSION_WATCH_KQUEUE
+    int dir_fd;                     // Entries added, renamed or removed
+    int file_fds[MAX_EXTENSIONS];   // Writes to each loaded source, -1 = none
+#endif
+    uint64_t scan_due;              // Rescan once quiet until then (0 = nothing pending)
+    uint64_t last_scan;
 } g_registry = {0};
 
 // ============================================================================
@@ -45,24 +72,87 @@ void extension_manifest_free(extension_manifest_t* manifest) {
     }
     free(manifest->dependencies);
 
+    for (uint32_t i = 0; i < manifest->tool_count; i++) {
+        free((void*)manifest->tools[i].name.data);
+        free((void*)manifest->tools[i].description.data);
+        free((void*)manifest->tools[i].parameters.data);
+    }
+    free(manifest->tools);
+
     memset(manifest, 0, sizeof(*manifest));
 }
 
+static str_t manifest_string(json_object_t* obj, const char* key, const char* fallback) {
+    const char* value = json_object_get_string(obj, key, fallback);
+    return value ? str_dup_cstr(value, NULL) : STR_NULL;
+}
+
+static extension_type_t manifest_type(const char* name) {
+    static const char* names[] = { "tool", "command", "provider", "channel", "hook", "theme" };
+    for (size_t i = 0; name && i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) return (extension_type_t)i;
+    }
+    return EXTENSION_TYPE_TOOL;
+}
+
+// {"name", "version", "description", "author", "license", "type",
+//  "entry_point", "permissions": {"filesystem", "network", "shell", "memory"},
+//  "tools": [{"name", "description", "parameters"}]}
 err_t extension_manifest_parse(const str_t* json, extension_manifest_t* out_manifest) {
     if (!json || !out_manifest) return ERR_INVALID_ARGUMENT;
 
-    // TODO: Parse JSON manifest
-    // For now, create a minimal default manifest
-
     *out_manifest = (extension_manifest_t){0};
-    out_manifest->name = str_dup(*json, NULL); // Use input as name for now
-    out_manifest->version = str_dup_cstr("0.1.0", NULL);
-    out_manifest->type = EXTENSION_TYPE_TOOL;
-    out_manifest->needs_filesystem = true;
-    out_manifest->needs_network = false;
-    out_manifest->needs_shell = false;
+    json_value_t* root = json_parse_len(json->data, json->len);
+    json_object_t* obj = root ? json_as_object(root) : NULL;
+    if (!obj) {
+        json_free(root);
+        return ERR_CONFIG_PARSE;
+    }
 
-    return ERR_OK;
+    extension_manifest_t* manifest = out_manifest;
+    manifest->name = manifest_string(obj, "name", NULL);
+    manifest->version = manifest_string(obj, "version", "0.1.0");
+    manifest->description = manifest_string(obj, "description", NULL);
+    manifest->author = manifest_string(obj, "author", NULL);
+    manifest->license = manifest_string(obj, "license", NULL);
+    manifest->entry_point = manifest_string(obj, "entry_point", NULL);
+    manifest->type = manifest_type(json_object_get_string(obj, "type", NULL));
+
+    json_object_t* permissions = json_object_get_object(obj, "permissions");
+    if (permissions) {
+        manifest->needs_filesystem = json_object_get_bool(permissions, "filesystem", false);
+        manifest->needs_network = json_object_get_bool(permissions, "network", false);
+        manifest->needs_shell = json_object_get_bool(permissions, "shell", false);
+        manifest->needs_memory = json_object_get_bool(permissions, "memory", false);
+    }
+
+    err_t err = ERR_OK;
+    json_array_t* tools = json_object_get_array(obj, "tools");
+    uint32_t tool_count = tools ? (uint32_t)json_array_length(tools) : 0;
+    manifest->tools = tool_count ? calloc(tool_count, sizeof(extension_tool_decl_t)) : NULL;
+    if (tool_count && !manifest->tools) err = ERR_OUT_OF_MEMORY;
+
+    for (uint32_t i = 0; err == ERR_OK && i < tool_count; i++) {
+        json_object_t* tool = json_as_object(json_array_get(tools, i));
+        if (!tool || !json_object_get_string(tool, "name", NULL)) {
+            err = ERR_CONFIG_INVALID;
+            break;
+        }
+
+        extension_tool_decl_t* decl = &manifest->tools[manifest->tool_count++];
+        decl->name = manifest_string(tool, "name", NULL);
+        decl->description = manifest_string(tool, "description", NULL);
+        json_value_t* parameters = json_object_get(tool, "parameters");
+        if (parameters) {
+            char* schema = json_print(parameters, false);
+            decl->parameters = schema ? (str_t){ .data = schema, .len = (uint32_t)strlen(schema) } : STR_NULL;
+        }
+    }
+
+    json_free(root);
+    if (err == ERR_OK && str_empty(manifest->name)) err = ERR_CONFIG_INVALID;
+    if (err != ERR_OK) extension_manifest_free(manifest);
+    return err;
 }
 
 err_t extension_manifest_to_json(const extension_manifest_t* manifest, str_t* out_json) {
@@ -102,10 +192,15 @@ err_t extension_manifest_to_json(const extension_manifest_t* manifest, str_t* ou
 // Extension Lifecycle
 // ============================================================================
 
+// Milliseconds, so saves within the same second still register
 static uint64_t get_file_mtime(const char* path) {
     struct stat st;
     if (stat(path, &st) != 0) return 0;
-    return (uint64_t)st.st_mtime * 1000;
+#ifdef __APPLE__
+    return (uint64_t)st.st_mtimespec.tv_sec * 1000 + (uint64_t)st.st_mtimespec.tv_nsec / 1000000;
+#else
+    return (uint64_t)st.st_mtim.tv_sec * 1000 + (uint64_t)st.st_mtim.tv_nsec / 1000000;
+#endif
 }
 
 err_t extension_load(const str_t* path, extension_t** out_extension) {
@@ -124,9 +219,12 @@ err_t extension_load(const str_t* path, extension_t** out_extension) {
     }
 
     // Read manifest or infer from filename
-    ext->manifest.name = str_dup(*path, NULL);
-    ext->manifest.version = str_dup_cstr("0.1.0", NULL);
-    ext->manifest.type = EXTENSION_TYPE_TOOL;
+    bool native = extension_is_native_path(path);
+    if (!native || native_read_manifest(path_cstr, &ext->manifest) != ERR_OK) {
+        ext->manifest.name = str_dup(*path, NULL);
+        ext->manifest.version = str_dup_cstr("0.1.0", NULL);
+        ext->manifest.type = EXTENSION_TYPE_TOOL;
+    }
     ext->manifest.source_file = str_dup(*path, NULL);
 
     ext->loaded = true;
@@ -134,6 +232,16 @@ err_t extension_load(const str_t* path, extension_t** out_extension) {
 
     free(path_cstr);
 
+    if (native) {
+        err_t err = native_attach(ext);
+        if (err != ERR_OK) {
+            native_detach(ext);
+            extension_manifest_free(&ext->manifest);
+            free(ext);
+            return err;
+        }
+    }
+
     // Add to registry
     g_registry.extensions[g_registry.count++] = ext;
 
@@ -158,6 +266,7 @@ err_t extension_unload(extension_t* extension) {
 
     // Cleanup
     extension_cleanup(extension);
+    native_detach(extension);
     extension_manifest_free(&extension->manifest);
     free((void*)extension->source_code.data);
     free(extension);
@@ -176,6 +285,12 @@ err_t extension_reload(extension_t* extension) {
     extension->last_modified = get_file_mtime(path);
     free(path);
 
+    // A native library in use is swapped now; one never called stays closed
+    if (extension->native && extension->dl_handle) {
+        err_t err = native_bind(extension);
+        if (err != ERR_OK) return err;
+    }
+
     return extension_initialize(extension);
 }
 
@@ -183,8 +298,8 @@ err_t extension_initialize(extension_t* extension) {
     if (!extension) return ERR_INVALID_ARGUMENT;
     if (extension->initialized) return ERR_OK;
 
-    // TODO: Load shared object or compile source
-    // For now, just mark as initialized
+    // TODO: Compile source extensions. Native libraries are opened on the
+    // first call of one of their tools.
 
     extension->initialized = true;
     return ERR_OK;
@@ -195,7 +310,8 @@ void extension_cleanup(extension_t* extension) {
 
     // TODO: Call cleanup function if available
 
-    if (extension->dl_handle) {
+    // Native libraries stay open until unload; their tools may be in use
+    if (extension->dl_handle && !extension->native) {
         dlclose(extension->dl_handle);
         extension->dl_handle = NULL;
     }
@@ -219,15 +335,17 @@ err_t extension_registry_init(void) {
 void extension_registry_shutdown(void) {
     if (!g_registry.initialized) return;
 
+    extension_watch_stop();
+
     // Unload all extensions
     for (uint32_t i = 0; i < g_registry.count; i++) {
         extension_t* ext = g_registry.extensions[i];
+        native_detach(ext);
         extension_manifest_free(&ext->manifest);
         free((void*)ext->source_code.data);
         free(ext);
     }
 
-    free((void*)g_registry.watch_dir.data);
     memset(&g_registry, 0, sizeof(g_registry));
 }
 
@@ -337,44 +455,634 @@ err_t extension_generate_manifest(const str_t* name,
     return err;
 }
 
+// ============================================================================
+// Native Extensions
+// ============================================================================
+
+// Native tools are registered under a fixed set of proxy vtables. The
+// vtable callbacks that take no tool argument carry no state, so each slot
+// gets its own copies of them with the slot index baked in.
+typedef struct native_slot_t {
+    extension_t* owner;                  // NULL = free
+    char* name;                          // Registered tool name
+    const extension_tool_decl_t* decl;   // From the manifest, NULL if none
+    const tool_vtable_t* impl;           // Current build's vtable, NULL until bound
+    uint32_t generation;                 // Bumped whenever impl changes
+} native_slot_t;
+
+struct extension_native_t {
+    const extension_native_table_t* table;   // Of dl_handle
+    void** retired;                          // Replaced builds, closed at unload
+    uint32_t retired_count;
+};
+
+// A registered tool instance; runs on an instance of the current build
+typedef struct native_tool_t {
+    uint32_t slot;
+    uint32_t generation;       // Slot generation inner was created from
+    tool_t* inner;
+    tool_t** retired;          // Instances of replaced builds, freed with this one
+    uint32_t retired_count;
+    tool_context_t context;
+    bool has_context;
+    pthread_mutex_t lock;
+} native_tool_t;
+
+// Slots, owners' handles and tables
+static native_slot_t g_native_slots[EXTENSION_NATIVE_MAX_TOOLS];
+static pthread_mutex_t g_native_lock = PTHREAD_MUTEX_INITIALIZER;
+static const tool_vtable_t g_native_vtables[EXTENSION_NATIVE_MAX_TOOLS];
+
+static bool has_suffix(const str_t* path, const char* suffix) {
+    size_t len = strlen(suffix);
+    return path->len >= len && memcmp(path->data + path->len - len, suffix, len) == 0;
+}
+
+bool extension_is_native_path(const str_t* path) {
+    return path && (has_suffix(path, ".so") || has_suffix(path, ".dylib"));
+}
+
+// <stem>.json next to the library
+static err_t native_read_manifest(const char* library_path, extension_manifest_t* out_manifest) {
+    const char* dot = strrchr(library_path, '.');
+    size_t stem_len = dot ? (size_t)(dot - library_path) : strlen(library_path);
+    char* path = malloc(stem_len + sizeof(".json"));
+    if (!path) return ERR_OUT_OF_MEMORY;
+    memcpy(path, library_path, stem_len);
+    memcpy(path + stem_len, ".json", sizeof(".json"));
+
+    FILE* f = fopen(path, "rb");
+    free(path);
+    if (!f) return ERR_FILE_NOT_FOUND;
+
+    char* text = NULL;
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) text = malloc((size_t)size);
+    bool read_ok = text && fread(text, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+    if (!read_ok) {
+        free(text);
+        return ERR_IO;
+    }
+
+    str_t json = { .data = text, .len = (uint32_t)size };
+    err_t err = extension_manifest_parse(&json, out_manifest);
+    free(text);
+    return err;
+}
+
+// dlopen answers a path it has already mapped with the old image, so each
+// build is opened through a private copy, unlinked once mapped
+static err_t native_open(const char* path, void** out_handle, const extension_native_table_t** out_table) {
+    const char* tmpdir = getenv("TMPDIR");
+    char copy[512];
+    snprintf(copy, sizeof(copy), "%s/cclaw-ext-XXXXXX", tmpdir && *tmpdir ? tmpdir : "/tmp");
+
+    int in = open(path, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return ERR_FILE_NOT_FOUND;
+    int out = mkstemp(copy);
+    if (out < 0) {
+        close(in);
+        return ERR_IO;
+    }
+
+    char buffer[16384];
+    ssize_t n;
+    bool copied = true;
+    while (copied && (n = read(in, buffer, sizeof(buffer))) != 0) {
+        copied = n > 0 && write(out, buffer, (size_t)n) == n;
+    }
+    close(in);
+    copied = close(out) == 0 && copied;
+
+    void* handle = copied ? dlopen(copy, RTLD_LAZY | RTLD_LOCAL) : NULL;
+    unlink(copy);
+    if (!handle) return copied ? ERR_RUNTIME : ERR_IO;
+
+    extension_native_entry_fn_t entry = NULL;
+    *(void**)&entry = dlsym(handle, EXTENSION_NATIVE_ENTRY);
+    const extension_native_table_t* table = entry ? entry() : NULL;
+    if (!table || table->abi_version != EXTENSION_ABI_VERSION || (table->tool_count && !table->tools)) {
+        dlclose(handle);
+        return entry ? ERR_INVALID_STATE : ERR_NOT_FOUND;
+    }
+
+    *out_handle = handle;
+    *out_table = table;
+    return ERR_OK;
+}
+
+static const tool_vtable_t* native_table_find(const extension_native_table_t* table, const char* name) {
+    for (uint32_t i = 0; i < table->tool_count; i++) {
+        const tool_vtable_t* vtable = table->tools[i];
+        if (vtable && vtable->get_name && str_equal_cstr(vtable->get_name(), name)) return vtable;
+    }
+    return NULL;
+}
+
+// Open the extension's current build and point its slots at it; the old
+// build stays mapped for instances still running on it (g_native_lock held)
+static err_t native_bind_locked(extension_t* ext) {
+    extension_native_t* native = ext->native;
+    char* path = strndup(ext->manifest.source_file.data, ext->manifest.source_file.len);
+    if (!path) return ERR_OUT_OF_MEMORY;
+
+    void* handle = NULL;
+    const extension_native_table_t* table = NULL;
+    err_t err = native_open(path, &handle, &table);
+    free(path);
+    if (err != ERR_OK) return err;
+
+    if (ext->dl_handle) {
+        void** retired = realloc(native->retired, (native->retired_count + 1) * sizeof(void*));
+        if (!retired) {
+            dlclose(handle);
+            return ERR_OUT_OF_MEMORY;
+        }
+        native->retired = retired;
+        native->retired[native->retired_count++] = ext->dl_handle;
+    }
+    ext->dl_handle = handle;
+    native->table = table;
+
+    for (uint32_t i = 0; i < EXTENSION_NATIVE_MAX_TOOLS; i++) {
+        native_slot_t* slot = &g_native_slots[i];
+        if (slot->owner != ext) continue;
+        slot->impl = native_table_find(table, slot->name);
+        slot->generation++;
+    }
+    return ERR_OK;
+}
+
+static err_t native_bind(extension_t* ext) {
+    pthread_mutex_lock(&g_native_lock);
+    err_t err = native_bind_locked(ext);
+    pthread_mutex_unlock(&g_native_lock);
+    return err;
+}
+
+static err_t native_claim_slot(extension_t* ext, const char* name, const extension_tool_decl_t* decl,
+                               const tool_vtable_t* impl) {
+    for (uint32_t i = 0; i < EXTENSION_NATIVE_MAX_TOOLS; i++) {
+        native_slot_t* slot = &g_native_slots[i];
+        if (slot->owner) continue;
+
+        slot->name = strdup(name);
+        if (!slot->name) return ERR_OUT_OF_MEMORY;
+        slot->owner = ext;
+        slot->decl = decl;
+        slot->impl = impl;
+        slot->generation++;
+        return tool_register(slot->name, &g_native_vtables[i]);
+    }
+    return ERR_OUT_OF_MEMORY;
+}
+
+// Register the extension's tools: from the manifest when it lists them,
+// otherwise from the library's own table
+static err_t native_attach(extension_t* ext) {
+    ext->native = calloc(1, sizeof(extension_native_t));
+    if (!ext->native) return ERR_OUT_OF_MEMORY;
+
+    pthread_mutex_lock(&g_native_lock);
+    err_t err = ERR_OK;
+    const extension_manifest_t* manifest = &ext->manifest;
+    for (uint32_t i = 0; err == ERR_OK && i < manifest->tool_count; i++) {
+        char* name = strndup(manifest->tools[i].name.data, manifest->tools[i].name.len);
+        err = name ? native_claim_slot(ext, name, &manifest->tools[i], NULL) : ERR_OUT_OF_MEMORY;
+        free(name);
+    }
+
+    if (err == ERR_OK && manifest->tool_count == 0) {
+        err = native_bind_locked(ext);
+        const extension_native_table_t* table = ext->native->table;
+        for (uint32_t i = 0; err == ERR_OK && i < table->tool_count; i++) {
+            const tool_vtable_t* vtable = table->tools[i];
+            if (!vtable || !vtable->get_name) continue;
+
+            str_t name = vtable->get_name();
+            char* cname = strndup(name.data, name.len);
+            err = cname ? native_claim_slot(ext, cname, NULL, vtable) : ERR_OUT_OF_MEMORY;
+            free(cname);
+        }
+    }
+    pthread_mutex_unlock(&g_native_lock);
+
+    return err;
+}
+
+static void native_detach(extension_t* ext) {
+    extension_native_t* native = ext->native;
+    if (!native) return;
+
+    pthread_mutex_lock(&g_native_lock);
+    for (uint32_t i = 0; i < EXTENSION_NATIVE_MAX_TOOLS; i++) {
+        native_slot_t* slot = &g_native_slots[i];
+        if (slot->owner != ext) continue;
+
+        tool_unregister(slot->name);
+        free(slot->name);
+        // The generation carries on, so a stale instance never matches a reused slot
+        *slot = (native_slot_t){ .generation = slot->generation + 1 };
+    }
+    pthread_mutex_unlock(&g_native_lock);
+
+    if (ext->dl_handle) dlclose(ext->dl_handle);
+    for (uint32_t i = 0; i < native->retired_count; i++) {
+        dlclose(native->retired[i]);
+    }
+    free(native->retired);
+    free(native);
+    ext->native = NULL;
+    ext->dl_handle = NULL;
+}
+
+// Slot's implementation, opening the library on first use
+static const tool_vtable_t* native_slot_impl(uint32_t index, uint32_t* out_generation) {
+    pthread_mutex_lock(&g_native_lock);
+    native_slot_t* slot = &g_native_slots[index];
+    if (slot->owner && !slot->owner->dl_handle) native_bind_locked(slot->owner);
+    const tool_vtable_t* impl = slot->impl;
+    if (out_generation) *out_generation = slot->generation;
+    pthread_mutex_unlock(&g_native_lock);
+    return impl;
+}
+
+static str_t native_slot_name(uint32_t index) {
+    const char* name = g_native_slots[index].name;
+    return name ? (str_t){ .data = name, .len = (uint32_t)strlen(name) } : STR_NULL;
+}
+
+static str_t native_slot_description(uint32_t index) {
+    const extension_tool_decl_t* decl = g_native_slots[index].decl;
+    if (decl) return decl->description;
+    const tool_vtable_t* impl = native_slot_impl(index, NULL);
+    return impl && impl->get_description ? impl->get_description() : STR_NULL;
+}
+
+static str_t native_slot_schema(uint32_t index) {
+    const extension_tool_decl_t* decl = g_native_slots[index].decl;
+    if (decl) return decl->parameters;
+    const tool_vtable_t* impl = native_slot_impl(index, NULL);
+    return impl && impl->get_parameters_schema ? impl->get_parameters_schema() : STR_NULL;
+}
+
+static str_t native_slot_version(uint32_t index) {
+    extension_t* owner = g_native_slots[index].owner;
+    return owner ? owner->manifest.version : STR_NULL;
+}
+
+static bool native_slot_requires_memory(uint32_t index) {
+    native_slot_t* slot = &g_native_slots[index];
+    if (slot->decl) return slot->owner && slot->owner->manifest.needs_memory;
+    const tool_vtable_t* impl = native_slot_impl(index, NULL);
+    return impl && impl->requires_memory && impl->requires_memory();
+}
+
+// Declared tools are judged by the manifest's permissions, like the
+// built-in shell and file_write tools
+static bool native_slot_allowed(uint32_t index, autonomy_level_t level) {
+    native_slot_t* slot = &g_native_slots[index];
+    if (slot->decl) {
+        bool risky = slot->owner && (slot->owner->manifest.needs_shell || slot->owner->manifest.needs_filesystem);
+        return !risky || level >= AUTONOMY_LEVEL_SUPERVISED;
+    }
+    const tool_vtable_t* impl = native_slot_impl(index, NULL);
+    return impl && (!impl->allowed_in_autonomous || impl->allowed_in_autonomous(level));
+}
+
+static err_t native_tool_create(uint32_t index, tool_t** out_tool) {
+    if (!out_tool) return ERR_INVALID_ARGUMENT;
+
+    tool_t* tool = tool_alloc(&g_native_vtables[index]);
+    native_tool_t* proxy = calloc(1, sizeof(native_tool_t));
+    if (!tool || !proxy) {
+        free(tool);
+        free(proxy);
+        return ERR_OUT_OF_MEMORY;
+    }
+    proxy->slot = index;
+    pthread_mutex_init(&proxy->lock, NULL);
+    tool->impl_data = proxy;
+
+    *out_tool = tool;
+    return ERR_OK;
+}
+
+static void native_tool_destroy(tool_t* tool) {
+    if (!tool) return;
+
+    native_tool_t* proxy = (native_tool_t*)tool->impl_data;
+    if (proxy) {
+        tool_free(proxy->inner);
+        for (uint32_t i = 0; i < proxy->retired_count; i++) {
+            tool_free(proxy->retired[i]);
+        }
+        free(proxy->retired);
+        pthread_mutex_destroy(&proxy->lock);
+        free(proxy);
+    }
+    free(tool);
+}
+
+// The instance to run on: created from the current build on first use and
+// again after each reload. A replaced instance is kept until destroy, as a
+// concurrent call may still be running on it.
+static err_t native_tool_current(native_tool_t* proxy, tool_t** out_inner) {
+    uint32_t generation = 0;
+    const tool_vtable_t* impl = native_slot_impl(proxy->slot, &generation);
+    if (!impl || !impl->create || !impl->execute) return ERR_NOT_FOUND;
+
+    err_t err = ERR_OK;
+    pthread_mutex_lock(&proxy->lock);
+    if (!proxy->inner || proxy->generation != generation) {
+        tool_t* inner = NULL;
+        tool_t** retired = proxy->inner ? realloc(proxy->retired, (proxy->retired_count + 1) * sizeof(tool_t*))
+                                        : proxy->retired;
+        err = proxy->inner && !retired ? ERR_OUT_OF_MEMORY : impl->create(&inner);
+        proxy->retired = retired;
+        // The library cannot reach tool_alloc, so it may leave this unset
+        if (err == ERR_OK) inner->vtable = impl;
+        if (err == ERR_OK && proxy->has_context && impl->init) err = impl->init(inner, &proxy->context);
+
+        if (err == ERR_OK) {
+            if (proxy->inner) proxy->retired[proxy->retired_count++] = proxy->inner;
+            proxy->inner = inner;
+            proxy->generation = generation;
+        } else {
+            tool_free(inner);
+        }
+    }
+    *out_inner = proxy->inner;
+    pthread_mutex_unlock(&proxy->lock);
+
+    return err;
+}
+
+static err_t native_tool_init(tool_t* tool, const tool_context_t* context) {
+    if (!tool || !tool->impl_data) return ERR_INVALID_ARGUMENT;
+
+    native_tool_t* proxy = (native_tool_t*)tool->impl_data;
+    pthread_mutex_lock(&proxy->lock);
+    if (context) {
+        tool->context = *context;
+        proxy->context = *context;
+        proxy->has_context = true;
+    }
+    tool_t* inner = proxy->inner;
+    pthread_mutex_unlock(&proxy->lock);
+
+    err_t err = inner && inner->vtable->init && context ? inner->vtable->init(inner, context) : ERR_OK;
+    tool->initialized = err == ERR_OK;
+    return err;
+}
+
+static void native_tool_cleanup(tool_t* tool) {
+    if (!tool || !tool->impl_data) return;
+
+    native_tool_t* proxy = (native_tool_t*)tool->impl_data;
+    pthread_mutex_lock(&proxy->lock);
+    tool_t* inner = proxy->inner;
+    pthread_mutex_unlock(&proxy->lock);
+
+    if (inner && inner->vtable->cleanup) inner->vtable->cleanup(inner);
+    tool->initialized = false;
+}
+
+static err_t native_tool_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
+    if (!tool || !tool->impl_data) return ERR_INVALID_ARGUMENT;
+
+    tool_t* inner = NULL;
+    err_t err = native_tool_current((native_tool_t*)tool->impl_data, &inner);
+    if (err != ERR_OK) return err;
+
+    return inner->vtable->execute(inner, args, out_result);
+}
+
+#define NATIVE_SLOT(n) \
+    static str_t native_get_name_##n(void) { return native_slot_name(n); } \
+    static str_t native_get_description_##n(void) { return native_slot_description(n); } \
+    static str_t native_get_version_##n(void) { return native_slot_version(n); } \
+    static err_t native_create_##n(tool_t** out_tool) { return native_tool_create(n, out_tool); } \
+    static str_t native_get_schema_##n(void) { return native_slot_schema(n); } \
+    static bool native_requires_memory_##n(void) { return native_slot_requires_memory(n); } \
+    static bool native_allowed_##n(autonomy_level_t level) { return native_slot_allowed(n, level); }
+
+#define NATIVE_VTABLE(n) { \
+        .get_name = native_get_name_##n, \
+        .get_description = native_get_description_##n, \
+        .get_version = native_get_version_##n, \
+        .create = native_create_##n, \
+        .destroy = native_tool_destroy, \
+        .init = native_tool_init, \
+        .cleanup = native_tool_cleanup, \
+        .execute = native_tool_execute, \
+        .get_parameters_schema = native_get_schema_##n, \
+        .requires_memory = native_requires_memory_##n, \
+        .allowed_in_autonomous = native_allowed_##n \
+    }
+
+NATIVE_SLOT(0) NATIVE_SLOT(1) NATIVE_SLOT(2) NATIVE_SLOT(3)
+NATIVE_SLOT(4) NATIVE_SLOT(5) NATIVE_SLOT(6) NATIVE_SLOT(7)
+NATIVE_SLOT(8) NATIVE_SLOT(9) NATIVE_SLOT(10) NATIVE_SLOT(11)
+NATIVE_SLOT(12) NATIVE_SLOT(13) NATIVE_SLOT(14) NATIVE_SLOT(15)
+
+_Static_assert(EXTENSION_NATIVE_MAX_TOOLS == 16, "one NATIVE_SLOT per native tool slot");
+
+static const tool_vtable_t g_native_vtables[EXTENSION_NATIVE_MAX_TOOLS] = {
+    NATIVE_VTABLE(0), NATIVE_VTABLE(1), NATIVE_VTABLE(2), NATIVE_VTABLE(3),
+    NATIVE_VTABLE(4), NATIVE_VTABLE(5), NATIVE_VTABLE(6), NATIVE_VTABLE(7),
+    NATIVE_VTABLE(8), NATIVE_VTABLE(9), NATIVE_VTABLE(10), NATIVE_VTABLE(11),
+    NATIVE_VTABLE(12), NATIVE_VTABLE(13), NATIVE_VTABLE(14), NATIVE_VTABLE(15),
+};
+
 // ============================================================================
 // Hot Reload
 // ============================================================================
 
+static uint64_t watch_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+#ifdef EXTENSION_WATCH_KQUEUE
+static int watch_open_vnode(const char* path, u_int fflags) {
+    int fd = open(path, O_EVTONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct kevent change;
+    EV_SET(&change, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, fflags, 0, NULL);
+    if (kevent(g_registry.watch_fd, &change, 1, NULL, 0, NULL) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// kqueue watches inodes, so sources replaced by a rename are reopened
+// after every scan
+static void watch_files_refresh(void) {
+    for (uint32_t i = 0; i < MAX_EXTENSIONS; i++) {
+        if (g_registry.file_fds[i] >= 0) close(g_registry.file_fds[i]);
+        g_registry.file_fds[i] = -1;
+    }
+    for (uint32_t i = 0; i < g_registry.count; i++) {
+        char* path = strndup(g_registry.extensions[i]->manifest.source_file.data,
+                             g_registry.extensions[i]->manifest.source_file.len);
+        if (!path) continue;
+        g_registry.file_fds[i] = watch_open_vnode(path, NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB |
+                                                        NOTE_RENAME | NOTE_DELETE);
+        free(path);
+    }
+}
+#endif
+
+static void watch_close(void) {
+#ifdef EXTENSION_WATCH_KQUEUE
+    for (uint32_t i = 0; i < MAX_EXTENSIONS; i++) {
+        if (g_registry.file_fds[i] >= 0) close(g_registry.file_fds[i]);
+        g_registry.file_fds[i] = -1;
+    }
+    if (g_registry.dir_fd >= 0) close(g_registry.dir_fd);
+    g_registry.dir_fd = -1;
+#endif
+    if (g_registry.watch_fd >= 0) close(g_registry.watch_fd);
+    g_registry.watch_fd = -1;
+}
+
+// Subscribe to changes under dir; on failure the watcher polls instead
+static void watch_open(const char* dir) {
+    g_registry.watch_fd = -1;
+#if defined(EXTENSION_WATCH_INOTIFY)
+    g_registry.watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Editors either rewrite in place or write a temp file and rename it over
+    if (g_registry.watch_fd >= 0 &&
+        inotify_add_watch(g_registry.watch_fd, dir, IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB |
+                                                    IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        watch_close();
+    }
+#elif defined(EXTENSION_WATCH_KQUEUE)
+    for (uint32_t i = 0; i < MAX_EXTENSIONS; i++) g_registry.file_fds[i] = -1;
+    g_registry.watch_fd = kqueue();
+    g_registry.dir_fd = g_registry.watch_fd >= 0 ? watch_open_vnode(dir, NOTE_WRITE) : -1;
+    if (g_registry.dir_fd < 0) {
+        watch_close();
+        return;
+    }
+    fcntl(g_registry.watch_fd, F_SETFD, FD_CLOEXEC);
+    watch_files_refresh();
+#else
+    (void)dir;
+#endif
+}
+
+// Consume queued events; true if there were any
+static bool watch_drain(void) {
+    if (g_registry.watch_fd < 0) return false;
+
+    bool changed = false;
+#if defined(EXTENSION_WATCH_INOTIFY)
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(g_registry.watch_fd, buffer, sizeof(buffer))) > 0) changed = true;
+    // The queue overflowed or the directory went away; keep going by polling
+    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        watch_close();
+        changed = true;
+    }
+#elif defined(EXTENSION_WATCH_KQUEUE)
+    struct kevent events[16];
+    struct timespec zero = {0, 0};
+    int n;
+    while ((n = kevent(g_registry.watch_fd, NULL, 0, events, 16, &zero)) > 0) changed = true;
+#endif
+    return changed;
+}
+
+// Reload every extension whose source moved on since it was loaded
+static void watch_scan(void) {
+    for (uint32_t i = 0; i < g_registry.count; i++) {
+        extension_t* ext = g_registry.extensions[i];
+
+        char* path = strndup(ext->manifest.source_file.data,
+                             ext->manifest.source_file.len);
+        uint64_t mtime = path ? get_file_mtime(path) : 0;
+        free(path);
+
+        // A source removed mid-save reappears with the next event
+        if (mtime != 0 && mtime != ext->last_modified) {
+            extension_reload(ext);
+        }
+    }
+#ifdef EXTENSION_WATCH_KQUEUE
+    if (g_registry.watch_fd >= 0) watch_files_refresh();
+#endif
+}
+
 err_t extension_watch_start(const str_t* extensions_dir) {
-    if (!extensions_dir) return ERR_INVALID_ARGUMENT;
+    if (!extensions_dir || str_empty(*extensions_dir)) return ERR_INVALID_ARGUMENT;
 
+    extension_watch_stop();
     g_registry.watch_dir = str_dup(*extensions_dir, NULL);
+    if (!g_registry.watch_dir.data) return ERR_OUT_OF_MEMORY;
+
+    char* dir = strndup(extensions_dir->data, extensions_dir->len);
+    if (!dir) {
+        extension_watch_stop();
+        return ERR_OUT_OF_MEMORY;
+    }
+    watch_open(dir);
+    free(dir);
+
     g_registry.watching = true;
+    g_registry.scan_due = 0;
+    g_registry.last_scan = watch_now_ms();
 
     return ERR_OK;
 }
 
 void extension_watch_stop(void) {
+    if (g_registry.watching) watch_close();
     g_registry.watching = false;
+    g_registry.scan_due = 0;
     free((void*)g_registry.watch_dir.data);
     g_registry.watch_dir = STR_NULL;
 }
 
+int extension_watch_fd(void) {
+    return g_registry.watching ? g_registry.watch_fd : -1;
+}
+
+int extension_watch_timeout_ms(void) {
+    if (!g_registry.watching) return -1;
+
+    uint64_t due = g_registry.scan_due;
+    if (!due && g_registry.watch_fd < 0) due = g_registry.last_scan + EXTENSION_WATCH_POLL_MS;
+    if (!due) return -1;
+
+    uint64_t now = watch_now_ms();
+    return due > now ? (int)(due - now) : 0;
+}
+
 err_t extension_watch_poll(void) {
     if (!g_registry.watching || str_empty(g_registry.watch_dir)) {
         return ERR_INVALID_STATE;
     }
 
-    // Check each extension for modifications
-    for (uint32_t i = 0; i < g_registry.count; i++) {
-        extension_t* ext = g_registry.extensions[i];
-
-        char* path = strndup(ext->manifest.source_file.data,
-                             ext->manifest.source_file.len);
-        uint64_t mtime = get_file_mtime(path);
-        free(path);
-
-        if (mtime > ext->last_modified) {
-            // Extension changed, reload it
-            extension_reload(ext);
-        }
+    // Every event pushes the scan back, so a burst of writes from one
+    // save is picked up once, after it settles
+    uint64_t now = watch_now_ms();
+    if (watch_drain()) {
+        g_registry.scan_due = now + EXTENSION_WATCH_DEBOUNCE_MS;
+    } else if (!g_registry.scan_due && g_registry.watch_fd < 0) {
+        g_registry.scan_due = g_registry.last_scan + EXTENSION_WATCH_POLL_MS;
     }
+    if (!g_registry.scan_due || now < g_registry.scan_due) return ERR_OK;
+
+    g_registry.scan_due = 0;
+    g_registry.last_scan = now;
+    watch_scan();
 
     return ERR_OK;
 }
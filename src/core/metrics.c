@@ -0,0 +1,503 @@
+// metrics.c - Process-wide metrics registry for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "core/metrics.h"
+#include "core/alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <malloc.h>
+
+// Open-addressed series table; slots are published once and never reused
+#define METRICS_MAX_SERIES 1024
+#define METRICS_STRIPES 8
+
+// HDR-style log-linear buckets: values below 16 get their own bucket,
+// above that every power of two is split into 16 sub-buckets, so a
+// bucket is never wider than 1/16 of its lower bound. Values are capped
+// at 2^41 (about 25 days in microseconds).
+#define METRICS_SUB_BITS 4
+#define METRICS_SUB (1u << METRICS_SUB_BITS)
+#define METRICS_MAX_EXP 40
+#define METRICS_BUCKETS ((METRICS_MAX_EXP - METRICS_SUB_BITS + 2) * METRICS_SUB)
+#define METRICS_MAX_VALUE ((1ULL << (METRICS_MAX_EXP + 1)) - 1)
+
+// One counter stripe per cache line
+typedef struct metric_cell_t {
+    uint64_t value;
+    char pad[56];
+} metric_cell_t;
+
+struct metric_t {
+    const metric_desc_t* desc;
+    str_t values[2];
+    char* labels;              // Rendered `name="value",...`, escaped
+    uint32_t hash;
+
+    metric_cell_t* cells;      // Counters
+    int64_t gauge;             // Gauges
+    uint64_t* buckets;         // Histograms
+    uint64_t sum;
+};
+
+static metric_t* g_series[METRICS_MAX_SERIES];
+static uint32_t g_series_count;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t g_next_stripe;
+static __thread uint32_t t_stripe;    // Stripe + 1, 0 = not assigned yet
+
+// ============================================================================
+// Families
+// ============================================================================
+
+static const double g_latency_bounds[] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 60, 120
+};
+static const double g_tool_bounds[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+};
+static const double g_search_bounds[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1
+};
+static const double g_rate_bounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+
+#define BOUNDS(b) .bounds = (b), .bound_count = sizeof(b) / sizeof((b)[0])
+
+const metric_desc_t METRIC_PROVIDER_LATENCY = {
+    .name = "cclaw_provider_request_duration_seconds",
+    .help = "Provider chat request latency",
+    .kind = METRIC_HISTOGRAM, .labels = { "provider", "model" }, .scale = 1e-6, BOUNDS(g_latency_bounds)
+};
+const metric_desc_t METRIC_PROVIDER_TTFT = {
+    .name = "cclaw_provider_time_to_first_token_seconds",
+    .help = "Time from a streamed request to its first text delta",
+    .kind = METRIC_HISTOGRAM, .labels = { "provider", "model" }, .scale = 1e-6, BOUNDS(g_latency_bounds)
+};
+const metric_desc_t METRIC_PROVIDER_TOKEN_RATE = {
+    .name = "cclaw_provider_output_tokens_per_second",
+    .help = "Completion tokens per second of request time",
+    .kind = METRIC_HISTOGRAM, .labels = { "provider", "model" }, .scale = 1e-3, BOUNDS(g_rate_bounds)
+};
+const metric_desc_t METRIC_PROVIDER_ERRORS = {
+    .name = "cclaw_provider_errors_total",
+    .help = "Failed provider chat requests",
+    .kind = METRIC_COUNTER, .labels = { "provider", "model" }
+};
+const metric_desc_t METRIC_PROVIDER_HEDGES = {
+    .name = "cclaw_provider_hedges_total",
+    .help = "Hedge requests sent after the primary passed its p95 latency",
+    .kind = METRIC_COUNTER, .labels = { "provider", "result" }
+};
+const metric_desc_t METRIC_RESPONSE_CACHE = {
+    .name = "cclaw_response_cache_lookups_total",
+    .help = "Response cache lookups for deterministic chat requests",
+    .kind = METRIC_COUNTER, .labels = { "provider", "result" }
+};
+const metric_desc_t METRIC_TOOL_DURATION = {
+    .name = "cclaw_tool_duration_seconds",
+    .help = "Tool execution time",
+    .kind = METRIC_HISTOGRAM, .labels = { "tool" }, .scale = 1e-6, BOUNDS(g_tool_bounds)
+};
+const metric_desc_t METRIC_TOOL_SPECULATION = {
+    .name = "cclaw_tool_speculations_total",
+    .help = "Pure tool calls started while the model was still streaming",
+    .kind = METRIC_COUNTER, .labels = { "tool", "result" }
+};
+const metric_desc_t METRIC_MEMORY_SEARCH = {
+    .name = "cclaw_memory_search_duration_seconds",
+    .help = "Memory backend search latency",
+    .kind = METRIC_HISTOGRAM, .labels = { "backend" }, .scale = 1e-6, BOUNDS(g_search_bounds)
+};
+const metric_desc_t METRIC_CHANNEL_QUEUE_DEPTH = {
+    .name = "cclaw_channel_queue_depth",
+    .help = "Inbound channel messages waiting for an agent worker",
+    .kind = METRIC_GAUGE
+};
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+static uint32_t series_hash(const metric_desc_t* desc, str_t label1, str_t label2) {
+    uintptr_t key = (uintptr_t)desc;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(key); i++) h = (h ^ (uint8_t)(key >> (i * 8))) * 16777619u;
+    for (uint32_t i = 0; i < label1.len; i++) h = (h ^ (uint8_t)label1.data[i]) * 16777619u;
+    h = (h ^ 0xFF) * 16777619u;
+    for (uint32_t i = 0; i < label2.len; i++) h = (h ^ (uint8_t)label2.data[i]) * 16777619u;
+    return h;
+}
+
+static bool series_matches(const metric_t* m, const metric_desc_t* desc, uint32_t hash,
+                           str_t label1, str_t label2) {
+    return m->hash == hash && m->desc == desc &&
+           str_equal(m->values[0], label1) && str_equal(m->values[1], label2);
+}
+
+static size_t render_label(char* out, const char* name, str_t value) {
+    size_t n = 0;
+    n += (size_t)sprintf(out + n, "%s=\"", name);
+    for (uint32_t i = 0; i < value.len; i++) {
+        char c = value.data[i];
+        if (c == '\\' || c == '"') {
+            out[n++] = '\\';
+            out[n++] = c;
+        } else if (c == '\n') {
+            out[n++] = '\\';
+            out[n++] = 'n';
+        } else {
+            out[n++] = c;
+        }
+    }
+    out[n++] = '"';
+    return n;
+}
+
+static metric_t* series_create(const metric_desc_t* desc, uint32_t hash, str_t label1, str_t label2) {
+    metric_t* m = calloc(1, sizeof(metric_t));
+    if (!m) return NULL;
+    m->desc = desc;
+    m->hash = hash;
+    m->values[0] = str_dup(label1, NULL);
+    m->values[1] = str_dup(label2, NULL);
+
+    // Escaping at most doubles a value
+    size_t cap = 1 + 2 * ((size_t)label1.len + label2.len) + 8;
+    for (int i = 0; i < 2; i++) {
+        if (desc->labels[i]) cap += strlen(desc->labels[i]);
+    }
+    m->labels = malloc(cap);
+    if (m->labels) {
+        size_t n = 0;
+        for (int i = 0; i < 2; i++) {
+            if (!desc->labels[i]) continue;
+            if (n) m->labels[n++] = ',';
+            n += render_label(m->labels + n, desc->labels[i], m->values[i]);
+        }
+        m->labels[n] = '\0';
+    }
+
+    if (desc->kind == METRIC_COUNTER) {
+        m->cells = aligned_alloc(64, sizeof(metric_cell_t) * METRICS_STRIPES);
+        if (m->cells) memset(m->cells, 0, sizeof(metric_cell_t) * METRICS_STRIPES);
+    } else if (desc->kind == METRIC_HISTOGRAM) {
+        m->buckets = calloc(METRICS_BUCKETS, sizeof(uint64_t));
+    }
+
+    bool ok = m->labels && (desc->kind != METRIC_COUNTER || m->cells) &&
+              (desc->kind != METRIC_HISTOGRAM || m->buckets);
+    if (!ok) {
+        free((void*)m->values[0].data);
+        free((void*)m->values[1].data);
+        free(m->labels);
+        free(m->cells);
+        free(m->buckets);
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+metric_t* metric_get(const metric_desc_t* desc, str_t label1, str_t label2) {
+    if (!desc) return NULL;
+    if (!desc->labels[0] || str_empty(label1)) label1 = STR_NULL;
+    if (!desc->labels[1] || str_empty(label2)) label2 = STR_NULL;
+
+    uint32_t hash = series_hash(desc, label1, label2);
+    const uint32_t mask = METRICS_MAX_SERIES - 1;
+
+    // Fast path: probe published slots without the lock
+    for (uint32_t i = 0; i < METRICS_MAX_SERIES; i++) {
+        metric_t* m = __atomic_load_n(&g_series[(hash + i) & mask], __ATOMIC_ACQUIRE);
+        if (!m) break;
+        if (series_matches(m, desc, hash, label1, label2)) return m;
+    }
+
+    // Inserts are serialized, so a second probe under the lock is final
+    pthread_mutex_lock(&g_registry_lock);
+    metric_t* found = NULL;
+    for (uint32_t i = 0; i < METRICS_MAX_SERIES; i++) {
+        metric_t** slot = &g_series[(hash + i) & mask];
+        metric_t* m = *slot;
+        if (m && series_matches(m, desc, hash, label1, label2)) {
+            found = m;
+            break;
+        }
+        if (m) continue;
+
+        // Keep the table sparse enough for short probes
+        if (g_series_count < METRICS_MAX_SERIES * 3 / 4) {
+            found = series_create(desc, hash, label1, label2);
+            if (found) {
+                g_series_count++;
+                __atomic_store_n(slot, found, __ATOMIC_RELEASE);
+            }
+        }
+        break;
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+    return found;
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+static uint32_t thread_stripe(void) {
+    if (!t_stripe) t_stripe = __atomic_fetch_add(&g_next_stripe, 1, __ATOMIC_RELAXED) % METRICS_STRIPES + 1;
+    return t_stripe - 1;
+}
+
+static uint32_t bucket_index(uint64_t value) {
+    if (value > METRICS_MAX_VALUE) value = METRICS_MAX_VALUE;
+    if (value < METRICS_SUB) return (uint32_t)value;
+    uint32_t e = 63 - (uint32_t)__builtin_clzll(value);
+    return (e - METRICS_SUB_BITS + 1) * METRICS_SUB + (uint32_t)((value >> (e - METRICS_SUB_BITS)) & (METRICS_SUB - 1));
+}
+
+static uint64_t bucket_lower(uint32_t index) {
+    if (index < METRICS_SUB) return index;
+    uint32_t e = index / METRICS_SUB + METRICS_SUB_BITS - 1;
+    return (uint64_t)(METRICS_SUB + index % METRICS_SUB) << (e - METRICS_SUB_BITS);
+}
+
+static uint64_t bucket_width(uint32_t index) {
+    if (index < METRICS_SUB) return 1;
+    return 1ULL << (index / METRICS_SUB - 1);
+}
+
+void metric_inc(metric_t* metric, uint64_t delta) {
+    if (!metric || !metric->cells) return;
+    __atomic_fetch_add(&metric->cells[thread_stripe()].value, delta, __ATOMIC_RELAXED);
+}
+
+void metric_gauge_add(metric_t* metric, int64_t delta) {
+    if (!metric) return;
+    __atomic_fetch_add(&metric->gauge, delta, __ATOMIC_RELAXED);
+}
+
+void metric_gauge_set(metric_t* metric, int64_t value) {
+    if (!metric) return;
+    __atomic_store_n(&metric->gauge, value, __ATOMIC_RELAXED);
+}
+
+void metric_observe(metric_t* metric, uint64_t value) {
+    if (!metric || !metric->buckets) return;
+    __atomic_fetch_add(&metric->buckets[bucket_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&metric->sum, value, __ATOMIC_RELAXED);
+}
+
+int64_t metric_value(metric_t* metric) {
+    if (!metric) return 0;
+    if (!metric->cells) return __atomic_load_n(&metric->gauge, __ATOMIC_RELAXED);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < METRICS_STRIPES; i++) {
+        total += __atomic_load_n(&metric->cells[i].value, __ATOMIC_RELAXED);
+    }
+    return (int64_t)total;
+}
+
+uint64_t metric_count(metric_t* metric) {
+    if (!metric || !metric->buckets) return 0;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < METRICS_BUCKETS; i++) {
+        total += __atomic_load_n(&metric->buckets[i], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+uint64_t metric_quantile(metric_t* metric, double q) {
+    uint64_t total = metric_count(metric);
+    if (total == 0) return 0;
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+
+    uint64_t rank = (uint64_t)(q * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < METRICS_BUCKETS; i++) {
+        seen += __atomic_load_n(&metric->buckets[i], __ATOMIC_RELAXED);
+        // Midpoint of the bucket halves the worst-case error
+        if (seen >= rank) return bucket_lower(i) + (bucket_width(i) - 1) / 2;
+    }
+    return bucket_lower(METRICS_BUCKETS - 1);
+}
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// ============================================================================
+// Prometheus Export
+// ============================================================================
+
+typedef struct text_buf_t {
+    char* data;
+    size_t len;
+    size_t cap;
+    bool failed;
+} text_buf_t;
+
+__attribute__((format(printf, 2, 3)))
+static void text_printf(text_buf_t* buf, const char* fmt, ...) {
+    if (buf->failed) return;
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            buf->failed = true;
+            return;
+        }
+        if ((size_t)n < buf->cap - buf->len) {
+            buf->len += (size_t)n;
+            return;
+        }
+
+        size_t cap = buf->cap * 2;
+        while (cap - buf->len <= (size_t)n) cap *= 2;
+        char* data = realloc(buf->data, cap);
+        if (!data) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+}
+
+static void export_series(text_buf_t* buf, const metric_t* m) {
+    const metric_desc_t* desc = m->desc;
+    double scale = desc->scale > 0 ? desc->scale : 1.0;
+    const char* sep = m->labels[0] ? "," : "";
+
+    if (desc->kind == METRIC_COUNTER) {
+        text_printf(buf, "%s{%s} %lld\n", desc->name, m->labels, (long long)metric_value((metric_t*)m));
+        return;
+    }
+    if (desc->kind == METRIC_GAUGE) {
+        text_printf(buf, "%s{%s} %.9g\n", desc->name, m->labels,
+                    (double)__atomic_load_n(&m->gauge, __ATOMIC_RELAXED) * scale);
+        return;
+    }
+
+    // Snapshot first so the cumulative buckets agree with _count
+    uint64_t* counts = malloc(sizeof(uint64_t) * METRICS_BUCKETS);
+    if (!counts) {
+        buf->failed = true;
+        return;
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < METRICS_BUCKETS; i++) {
+        counts[i] = __atomic_load_n(&m->buckets[i], __ATOMIC_RELAXED);
+        total += counts[i];
+    }
+
+    // Fine buckets below a bound count whole; the one it cuts through
+    // counts in proportion, assuming values spread evenly inside it
+    uint64_t cumulative = 0;
+    uint32_t next = 0;
+    for (uint32_t b = 0; b < desc->bound_count; b++) {
+        double limit = desc->bounds[b] / scale;
+        while (next < METRICS_BUCKETS && (double)(bucket_lower(next) + bucket_width(next) - 1) <= limit) {
+            cumulative += counts[next++];
+        }
+        uint64_t partial = 0;
+        if (next < METRICS_BUCKETS && (double)bucket_lower(next) <= limit) {
+            double covered = (limit - (double)bucket_lower(next) + 1) / (double)bucket_width(next);
+            partial = (uint64_t)((double)counts[next] * covered);
+        }
+        text_printf(buf, "%s_bucket{%s%sle=\"%g\"} %llu\n", desc->name, m->labels, sep,
+                    desc->bounds[b], (unsigned long long)(cumulative + partial));
+    }
+    text_printf(buf, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", desc->name, m->labels, sep,
+                (unsigned long long)total);
+    text_printf(buf, "%s_sum{%s} %.9g\n", desc->name, m->labels,
+                (double)__atomic_load_n(&m->sum, __ATOMIC_RELAXED) * scale);
+    text_printf(buf, "%s_count{%s} %llu\n", desc->name, m->labels, (unsigned long long)total);
+    free(counts);
+}
+
+static void export_process(text_buf_t* buf) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    text_printf(buf, "# HELP cclaw_heap_bytes Heap bytes reported by malloc\n");
+    text_printf(buf, "# TYPE cclaw_heap_bytes gauge\n");
+    text_printf(buf, "cclaw_heap_bytes{state=\"in_use\"} %zu\n", info.uordblks + info.hblkhd);
+    text_printf(buf, "cclaw_heap_bytes{state=\"free\"} %zu\n", info.fordblks);
+#endif
+    text_printf(buf, "# HELP cclaw_sizeclass_magazines Size-class allocator magazines in use\n");
+    text_printf(buf, "# TYPE cclaw_sizeclass_magazines gauge\n");
+    text_printf(buf, "cclaw_sizeclass_magazines %u\n", sizeclass_magazines_used());
+
+    alloc_tag_stats_t stats[ALLOC_TAG_COUNT];
+    bool budgets = false;
+    for (int tag = ALLOC_TAG_NONE + 1; tag < ALLOC_TAG_COUNT; tag++) {
+        alloc_tag_stats((alloc_tag_t)tag, &stats[tag]);
+        budgets = budgets || stats[tag].budget;
+    }
+    text_printf(buf, "# HELP cclaw_alloc_bytes Live bytes accounted to a subsystem\n");
+    text_printf(buf, "# TYPE cclaw_alloc_bytes gauge\n");
+    for (int tag = ALLOC_TAG_NONE + 1; tag < ALLOC_TAG_COUNT; tag++) {
+        text_printf(buf, "cclaw_alloc_bytes{subsystem=\"%s\"} %zu\n", alloc_tag_name((alloc_tag_t)tag), stats[tag].live);
+    }
+    text_printf(buf, "# HELP cclaw_alloc_peak_bytes Highest live bytes seen for a subsystem\n");
+    text_printf(buf, "# TYPE cclaw_alloc_peak_bytes gauge\n");
+    for (int tag = ALLOC_TAG_NONE + 1; tag < ALLOC_TAG_COUNT; tag++) {
+        text_printf(buf, "cclaw_alloc_peak_bytes{subsystem=\"%s\"} %zu\n", alloc_tag_name((alloc_tag_t)tag), stats[tag].peak);
+    }
+    if (!budgets) return;
+    text_printf(buf, "# HELP cclaw_alloc_budget_bytes Soft cap on a subsystem's live bytes\n");
+    text_printf(buf, "# TYPE cclaw_alloc_budget_bytes gauge\n");
+    for (int tag = ALLOC_TAG_NONE + 1; tag < ALLOC_TAG_COUNT; tag++) {
+        if (!stats[tag].budget) continue;
+        text_printf(buf, "cclaw_alloc_budget_bytes{subsystem=\"%s\"} %zu\n", alloc_tag_name((alloc_tag_t)tag), stats[tag].budget);
+    }
+}
+
+err_t metrics_export_prometheus(str_t* out_text) {
+    if (!out_text) return ERR_INVALID_ARGUMENT;
+
+    text_buf_t buf = { .cap = 4096 };
+    buf.data = malloc(buf.cap);
+    if (!buf.data) return ERR_OUT_OF_MEMORY;
+    buf.data[0] = '\0';
+
+    // Group series by family
+    metric_t* series[METRICS_MAX_SERIES];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < METRICS_MAX_SERIES; i++) {
+        metric_t* m = __atomic_load_n(&g_series[i], __ATOMIC_ACQUIRE);
+        if (m) series[count++] = m;
+    }
+
+    static const char* const kind_names[] = { "counter", "gauge", "histogram" };
+    for (uint32_t i = 0; i < count; i++) {
+        const metric_desc_t* desc = series[i]->desc;
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) seen = series[j]->desc == desc;
+        if (seen) continue;
+
+        text_printf(&buf, "# HELP %s %s\n", desc->name, desc->help);
+        text_printf(&buf, "# TYPE %s %s\n", desc->name, kind_names[desc->kind]);
+        for (uint32_t j = i; j < count; j++) {
+            if (series[j]->desc == desc) export_series(&buf, series[j]);
+        }
+    }
+    export_process(&buf);
+
+    if (buf.failed) {
+        free(buf.data);
+        return ERR_OUT_OF_MEMORY;
+    }
+    *out_text = (str_t){ .data = buf.data, .len = (uint32_t)buf.len };
+    return ERR_OK;
+}
@@ -0,0 +1,530 @@
+// session_log.c - Append-only binary session log for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "core/session_log.h"
+#include "core/alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define LOG_NONE UINT32_MAX
+#define LOG_ALIGN 8
+
+enum {
+    LOG_FIELD_ID,
+    LOG_FIELD_CONTENT,          // Session name in the meta record
+    LOG_FIELD_TOOL_NAME,
+    LOG_FIELD_TOOL_ARGS,
+    LOG_FIELD_TOOL_RESULT,
+    LOG_FIELD_TOOL_CALL_ID,
+    LOG_FIELD_MODEL,
+    LOG_FIELD_COUNT
+};
+
+typedef enum {
+    LOG_RECORD_META = 1,
+    LOG_RECORD_MESSAGE,
+    LOG_RECORD_CURRENT,
+    LOG_RECORD_CHECKPOINT
+} log_record_kind_t;
+
+typedef struct log_file_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;       // sizeof(log_record_t) when written
+} log_file_header_t;
+
+typedef struct log_record_t {
+    uint32_t size;              // Whole record including strings and padding
+    uint32_t crc;               // CRC-32 of everything after this field
+    uint8_t kind;
+    uint8_t type;               // agent_message_type_t
+    uint16_t flags;
+    uint32_t index;             // Message index; cursor target; checkpoint message count
+    uint32_t parent;            // Parent index (LOG_NONE = root); checkpoint cursor
+    uint32_t splice;            // Child this message was inserted above (LOG_NONE = none)
+    uint64_t timestamp;
+    uint32_t tokens_input;      // Checkpoint: session total_messages
+    uint32_t tokens_output;     // Checkpoint: session total_tokens
+    uint32_t tokens_cached;
+    uint32_t lens[LOG_FIELD_COUNT];   // Strings follow in field order, each NUL-terminated
+} log_record_t;
+
+struct session_log_t {
+    int fd;
+    agent_session_t* session;   // Owner
+    void* map;                  // Loaded prefix; message strings point into it
+    size_t map_len;
+    uint32_t count;             // Messages logged
+    uint32_t position;          // Where a replay would leave current (LOG_NONE = nowhere)
+    uint32_t since_checkpoint;  // Records since the last checkpoint
+    char* buffer;               // Record staging, reused
+    size_t buffer_cap;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Ids become file names, so keep them to a safe alphabet
+static bool valid_id(str_t id) {
+    if (str_empty(id) || id.len > 128 || id.data[0] == '.') return false;
+    for (uint32_t i = 0; i < id.len; i++) {
+        char c = id.data[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                  c == '-' || c == '_' || c == '.';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static char* log_path(const char* dir, str_t id) {
+    size_t len = strlen(dir) + id.len + sizeof(SESSION_LOG_SUFFIX) + 2;
+    char* path = malloc(len);
+    if (path) snprintf(path, len, "%s/%.*s%s", dir, (int)id.len, id.data, SESSION_LOG_SUFFIX);
+    return path;
+}
+
+static err_t write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return ERR_WRITE_FAILED;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return ERR_OK;
+}
+
+// Stage header plus strings in the reusable buffer and append it in one write
+static err_t write_record(session_log_t* log, log_record_t* record, const str_t* fields) {
+    size_t size = sizeof(log_record_t);
+    for (int i = 0; i < LOG_FIELD_COUNT; i++) {
+        record->lens[i] = fields ? fields[i].len : 0;
+        size += record->lens[i] + 1;
+    }
+    size = (size + LOG_ALIGN - 1) & ~(size_t)(LOG_ALIGN - 1);
+
+    if (size > log->buffer_cap) {
+        size_t cap = log->buffer_cap ? log->buffer_cap : 1024;
+        while (cap < size) cap *= 2;
+        char* buffer = realloc(log->buffer, cap);
+        if (!buffer) return ERR_OUT_OF_MEMORY;
+        log->buffer = buffer;
+        log->buffer_cap = cap;
+    }
+
+    record->size = (uint32_t)size;
+    char* out = log->buffer + sizeof(log_record_t);
+    for (int i = 0; i < LOG_FIELD_COUNT; i++) {
+        if (record->lens[i]) memcpy(out, fields[i].data, record->lens[i]);
+        out += record->lens[i];
+        *out++ = '\0';
+    }
+    memset(out, 0, (size_t)(log->buffer + size - out));
+
+    memcpy(log->buffer, record, sizeof(log_record_t));
+    uint32_t crc = (uint32_t)crc32(0L, (const Bytef*)log->buffer + 8, (uInt)(size - 8));
+    memcpy(log->buffer + 4, &crc, sizeof(crc));
+
+    err_t err = write_all(log->fd, log->buffer, size);
+    if (err == ERR_OK) log->since_checkpoint++;
+    return err;
+}
+
+static err_t write_message(session_log_t* log, agent_message_t* message, uint32_t splice) {
+    log_record_t record = {
+        .kind = LOG_RECORD_MESSAGE,
+        .type = (uint8_t)message->type,
+        .index = log->count,
+        .parent = message->parent ? message->parent->log_index - 1 : LOG_NONE,
+        .splice = splice,
+        .timestamp = message->timestamp,
+        .tokens_input = message->tokens_input,
+        .tokens_output = message->tokens_output,
+        .tokens_cached = message->tokens_cached,
+    };
+    str_t fields[LOG_FIELD_COUNT] = {
+        [LOG_FIELD_ID] = message->id,
+        [LOG_FIELD_CONTENT] = message->content,
+        [LOG_FIELD_TOOL_NAME] = message->tool_name,
+        [LOG_FIELD_TOOL_ARGS] = message->tool_args,
+        [LOG_FIELD_TOOL_RESULT] = message->tool_result,
+        [LOG_FIELD_TOOL_CALL_ID] = message->tool_call_id,
+        [LOG_FIELD_MODEL] = message->model,
+    };
+
+    err_t err = write_record(log, &record, fields);
+    if (err != ERR_OK) return err;
+
+    message->log_index = ++log->count;
+    if (splice == LOG_NONE) log->position = record.index;
+
+    if (log->since_checkpoint >= SESSION_LOG_CHECKPOINT_EVERY) {
+        return session_log_checkpoint(log);
+    }
+    return ERR_OK;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+err_t session_log_create(const char* dir, agent_session_t* session, session_log_t** out_log) {
+    if (!dir || !*dir || !session || !out_log) return ERR_INVALID_ARGUMENT;
+    if (!valid_id(session->id)) return ERR_INVALID_ARGUMENT;
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) return ERR_IO;
+
+    char* path = log_path(dir, session->id);
+    if (!path) return ERR_OUT_OF_MEMORY;
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0600);
+    int open_errno = errno;
+    free(path);
+    if (fd < 0) return open_errno == EEXIST ? ERR_FILE_EXISTS : ERR_IO;
+
+    session_log_t* log = calloc(1, sizeof(session_log_t));
+    if (!log) {
+        close(fd);
+        return ERR_OUT_OF_MEMORY;
+    }
+    log->fd = fd;
+    log->session = session;
+    log->position = LOG_NONE;
+
+    log_file_header_t header = { .version = SESSION_LOG_VERSION, .record_size = sizeof(log_record_t) };
+    memcpy(header.magic, SESSION_LOG_MAGIC, sizeof(SESSION_LOG_MAGIC));
+    log_record_t meta = { .kind = LOG_RECORD_META, .timestamp = session->created_at };
+    str_t fields[LOG_FIELD_COUNT] = { [LOG_FIELD_ID] = session->id, [LOG_FIELD_CONTENT] = session->name };
+
+    err_t err = write_all(fd, (const char*)&header, sizeof(header));
+    if (err == ERR_OK) err = write_record(log, &meta, fields);
+    if (err != ERR_OK) {
+        session_log_close(log);
+        return err;
+    }
+
+    *out_log = log;
+    return ERR_OK;
+}
+
+err_t session_log_append(session_log_t* log, agent_message_t* message) {
+    if (!log || !message) return ERR_INVALID_ARGUMENT;
+
+    // Parents go first; walk up to the oldest ancestor not logged yet
+    while (!message->log_index) {
+        agent_message_t* next = message;
+        while (next->parent && !next->parent->log_index) next = next->parent;
+
+        err_t err = write_message(log, next, LOG_NONE);
+        if (err != ERR_OK) return err;
+    }
+    return ERR_OK;
+}
+
+err_t session_log_append_splice(session_log_t* log, agent_message_t* inserted, agent_message_t* child) {
+    if (!log || !inserted || !child || !child->log_index) return ERR_INVALID_ARGUMENT;
+    if (inserted->parent && !inserted->parent->log_index) return ERR_INVALID_STATE;
+
+    return write_message(log, inserted, child->log_index - 1);
+}
+
+err_t session_log_set_current(session_log_t* log, const agent_message_t* current) {
+    if (!log) return ERR_INVALID_ARGUMENT;
+    if (!current || !current->log_index || current->log_index - 1 == log->position) return ERR_OK;
+
+    log_record_t record = { .kind = LOG_RECORD_CURRENT, .index = current->log_index - 1, .timestamp = now_ms() };
+    err_t err = write_record(log, &record, NULL);
+    if (err == ERR_OK) log->position = record.index;
+    return err;
+}
+
+err_t session_log_checkpoint(session_log_t* log) {
+    if (!log) return ERR_INVALID_ARGUMENT;
+
+    agent_session_t* session = log->session;
+    log_record_t record = {
+        .kind = LOG_RECORD_CHECKPOINT,
+        .index = log->count,
+        .parent = log->position,
+        .splice = LOG_NONE,
+        .timestamp = now_ms(),
+        .tokens_input = session ? session->total_messages : 0,
+        .tokens_output = session ? session->total_tokens : 0,
+    };
+    err_t err = write_record(log, &record, NULL);
+    if (err != ERR_OK) return err;
+
+    log->since_checkpoint = 0;
+    return fdatasync(log->fd) == 0 ? ERR_OK : ERR_IO;
+}
+
+uint32_t session_log_message_count(const session_log_t* log) {
+    return log ? log->count : 0;
+}
+
+void session_log_close(session_log_t* log) {
+    if (!log) return;
+
+    if (log->since_checkpoint > 0) session_log_checkpoint(log);
+    if (log->fd >= 0) close(log->fd);
+    if (log->map) munmap(log->map, log->map_len);
+    free(log->buffer);
+    free(log);
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+static str_t record_string(const char** cursor, uint32_t len) {
+    str_t s = len ? (str_t){ .data = *cursor, .len = len } : STR_NULL;
+    *cursor += len + 1;
+    return s;
+}
+
+static bool record_valid(const char* base, size_t offset, size_t end) {
+    if (end - offset < sizeof(log_record_t)) return false;
+
+    const log_record_t* record = (const log_record_t*)(base + offset);
+    if (record->size < sizeof(log_record_t) || record->size > end - offset || record->size % LOG_ALIGN) {
+        return false;
+    }
+
+    size_t strings = 0;
+    for (int i = 0; i < LOG_FIELD_COUNT; i++) strings += (size_t)record->lens[i] + 1;
+    if (strings > record->size - sizeof(log_record_t)) return false;
+
+    uint32_t crc = (uint32_t)crc32(0L, (const Bytef*)base + offset + 8, (uInt)(record->size - 8));
+    return crc == record->crc;
+}
+
+// Message node whose strings are views into the mapping
+static agent_message_t* record_message(agent_session_t* session, const log_record_t* record) {
+    agent_message_t* msg = agent_session_node_alloc(session);
+    if (!msg) return NULL;
+
+    const char* cursor = (const char*)(record + 1);
+    msg->id = record_string(&cursor, record->lens[LOG_FIELD_ID]);
+    msg->content = record_string(&cursor, record->lens[LOG_FIELD_CONTENT]);
+    msg->tool_name = record_string(&cursor, record->lens[LOG_FIELD_TOOL_NAME]);
+    msg->tool_args = record_string(&cursor, record->lens[LOG_FIELD_TOOL_ARGS]);
+    msg->tool_result = record_string(&cursor, record->lens[LOG_FIELD_TOOL_RESULT]);
+    msg->tool_call_id = record_string(&cursor, record->lens[LOG_FIELD_TOOL_CALL_ID]);
+    msg->model = record_string(&cursor, record->lens[LOG_FIELD_MODEL]);
+
+    msg->type = (agent_message_type_t)record->type;
+    msg->timestamp = record->timestamp;
+    msg->tokens_input = record->tokens_input;
+    msg->tokens_output = record->tokens_output;
+    msg->tokens_cached = record->tokens_cached;
+    msg->is_complete = true;
+    msg->log_borrowed = true;
+    msg->log_index = record->index + 1;
+    return msg;
+}
+
+err_t session_log_load(const char* dir, const str_t* session_id, agent_session_t* session,
+                       session_log_t** out_log) {
+    if (!dir || !*dir || !session_id || !session || session->root || !out_log) return ERR_INVALID_ARGUMENT;
+    if (!valid_id(*session_id)) return ERR_INVALID_ARGUMENT;
+
+    char* path = log_path(dir, *session_id);
+    if (!path) return ERR_OUT_OF_MEMORY;
+    int fd = open(path, O_RDWR | O_APPEND | O_CLOEXEC);
+    int open_errno = errno;
+    free(path);
+    if (fd < 0) return open_errno == ENOENT ? ERR_FILE_NOT_FOUND : ERR_IO;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(log_file_header_t)) {
+        close(fd);
+        return ERR_MEMORY_CORRUPT;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return ERR_IO;
+    }
+
+    session_log_t* log = calloc(1, sizeof(session_log_t));
+    if (!log) {
+        munmap(base, size);
+        close(fd);
+        return ERR_OUT_OF_MEMORY;
+    }
+    log->fd = fd;
+    log->session = session;
+    log->map = base;
+    log->map_len = size;
+    log->position = LOG_NONE;
+
+    const log_file_header_t* header = (const log_file_header_t*)base;
+    if (memcmp(header->magic, SESSION_LOG_MAGIC, sizeof(SESSION_LOG_MAGIC)) != 0 ||
+        header->version != SESSION_LOG_VERSION || header->record_size != sizeof(log_record_t)) {
+        session_log_close(log);
+        return ERR_MEMORY_CORRUPT;
+    }
+
+    // Node per message index; NULL where a message could not be attached
+    agent_message_t** nodes = NULL;
+    uint32_t capacity = 0;
+    bool have_meta = false;
+    bool have_checkpoint = false;
+    uint32_t user_messages = 0;
+    err_t err = ERR_OK;
+
+    size_t offset = sizeof(log_file_header_t);
+    while (offset < size && record_valid(base, offset, size)) {
+        const log_record_t* record = (const log_record_t*)(base + offset);
+
+        if (record->kind == LOG_RECORD_META) {
+            const char* cursor = (const char*)(record + 1);
+            str_t id = record_string(&cursor, record->lens[LOG_FIELD_ID]);
+            str_t name = record_string(&cursor, record->lens[LOG_FIELD_CONTENT]);
+            free((void*)session->id.data);
+            free((void*)session->name.data);
+            session->id = str_dup(id, NULL);
+            session->name = str_dup(name, NULL);
+            session->created_at = record->timestamp;
+            have_meta = true;
+        } else if (record->kind == LOG_RECORD_MESSAGE) {
+            if (!have_meta || record->index != log->count) break;
+
+            if (log->count >= capacity) {
+                uint32_t new_capacity = capacity ? capacity * 2 : 256;
+                agent_message_t** grown = realloc(nodes, new_capacity * sizeof(agent_message_t*));
+                if (!grown) {
+                    err = ERR_OUT_OF_MEMORY;
+                    break;
+                }
+                nodes = grown;
+                capacity = new_capacity;
+            }
+
+            agent_message_t* msg = record_message(session, record);
+            if (!msg) {
+                err = ERR_OUT_OF_MEMORY;
+                break;
+            }
+
+            agent_message_t* parent = record->parent < log->count ? nodes[record->parent] : NULL;
+            agent_message_t* child = record->splice < log->count ? nodes[record->splice] : NULL;
+            if (record->parent == LOG_NONE && !session->root) {
+                session->root = msg;
+            } else if (parent && child && child->parent == parent) {
+                agent_message_splice(parent, child, msg);
+            } else if (parent) {
+                agent_message_add_child(parent, msg);
+            } else {
+                // Detached (a branch off the root); nothing can reach it
+                agent_message_free(msg);
+                msg = NULL;
+            }
+
+            nodes[log->count++] = msg;
+            if (msg && record->splice == LOG_NONE) log->position = record->index;
+            if (msg && msg->type == AGENT_MSG_USER) user_messages++;
+        } else if (record->kind == LOG_RECORD_CURRENT) {
+            if (record->index < log->count && nodes[record->index]) log->position = record->index;
+        } else if (record->kind == LOG_RECORD_CHECKPOINT) {
+            session->total_messages = record->tokens_input;
+            session->total_tokens = record->tokens_output;
+            session->last_active = record->timestamp;
+            have_checkpoint = true;
+        }
+        offset += record->size;
+    }
+
+    if (err == ERR_OK && !have_meta) err = ERR_MEMORY_CORRUPT;
+
+    // Cut off a torn tail so appends continue from the last good record
+    if (err == ERR_OK && offset < size && ftruncate(fd, (off_t)offset) != 0) err = ERR_IO;
+
+    if (err == ERR_OK) {
+        session->current = log->position != LOG_NONE ? nodes[log->position] : NULL;
+        if (!session->current) session->current = session->root;
+        if (!have_checkpoint) session->total_messages = user_messages;
+    }
+    free(nodes);
+
+    if (err != ERR_OK) {
+        // The partial tree borrows the mapping, so it goes first
+        agent_message_tree_free(session->root);
+        session->root = NULL;
+        session->current = NULL;
+        log->since_checkpoint = 0;
+        session_log_close(log);
+        return err;
+    }
+
+    *out_log = log;
+    return ERR_OK;
+}
+
+err_t session_log_list(const char* dir, str_t** out_ids, uint32_t* out_count) {
+    if (!dir || !out_ids || !out_count) return ERR_INVALID_ARGUMENT;
+
+    *out_ids = NULL;
+    *out_count = 0;
+    DIR* d = opendir(dir);
+    if (!d) return errno == ENOENT ? ERR_OK : ERR_IO;
+
+    const size_t suffix_len = sizeof(SESSION_LOG_SUFFIX) - 1;
+    str_t* ids = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    err_t err = ERR_OK;
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= suffix_len || strcmp(entry->d_name + len - suffix_len, SESSION_LOG_SUFFIX) != 0) continue;
+
+        str_t id = { .data = entry->d_name, .len = (uint32_t)(len - suffix_len) };
+        if (!valid_id(id)) continue;
+
+        if (count >= capacity) {
+            uint32_t new_capacity = capacity ? capacity * 2 : 16;
+            str_t* grown = realloc(ids, new_capacity * sizeof(str_t));
+            if (!grown) {
+                err = ERR_OUT_OF_MEMORY;
+                break;
+            }
+            ids = grown;
+            capacity = new_capacity;
+        }
+        ids[count] = str_dup(id, NULL);
+        if (!ids[count].data) {
+            err = ERR_OUT_OF_MEMORY;
+            break;
+        }
+        count++;
+    }
+    closedir(d);
+
+    if (err != ERR_OK) {
+        for (uint32_t i = 0; i < count; i++) free((void*)ids[i].data);
+        free(ids);
+        return err;
+    }
+
+    *out_ids = ids;
+    *out_count = count;
+    return ERR_OK;
+}
@@ -7,16 +7,21 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <pthread.h>
+
+// Strings come from the given allocator, or from malloc (release with free)
+// when it is NULL
+static char* string_alloc(allocator_t* allocator, size_t size) {
+    return allocator ? alloc_aligned(allocator, size, 1) : malloc(size);
+}
 
 // String duplication
 str_t str_dup(str_t s, allocator_t* alloc) {
-    (void)alloc; // TODO: Use allocator when implemented
-
     if (str_empty(s)) {
         return STR_NULL;
     }
 
-    char* data = malloc(s.len + 1);
+    char* data = string_alloc(alloc, (size_t)s.len + 1);
     if (!data) {
         return STR_NULL;
     }
@@ -28,14 +33,12 @@ str_t str_dup(str_t s, allocator_t* alloc) {
 }
 
 str_t str_dup_cstr(const char* s, allocator_t* alloc) {
-    (void)alloc; // TODO: Use allocator when implemented
-
     if (!s) {
         return STR_NULL;
     }
 
     size_t len = strlen(s);
-    char* data = malloc(len + 1);
+    char* data = string_alloc(alloc, len + 1);
     if (!data) {
         return STR_NULL;
     }
@@ -48,8 +51,6 @@ str_t str_dup_cstr(const char* s, allocator_t* alloc) {
 
 // String formatting (allocates memory)
 str_t str_format(allocator_t* alloc, const char* fmt, ...) {
-    (void)alloc; // TODO: Use allocator when implemented
-
     va_list args;
     va_start(args, fmt);
 
@@ -65,7 +66,7 @@ str_t str_format(allocator_t* alloc, const char* fmt, ...) {
     }
 
     // Allocate buffer
-    char* buffer = malloc((size_t)size + 1);
+    char* buffer = string_alloc(alloc, (size_t)size + 1);
     if (!buffer) {
         va_end(args);
         return STR_NULL;
@@ -76,4 +77,103 @@ str_t str_format(allocator_t* alloc, const char* fmt, ...) {
     va_end(args);
 
     return (str_t){ .data = buffer, .len = (uint32_t)size };
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Interning
+// ============================================================================
+
+#define INTERN_SHARDS 16
+#define INTERN_INITIAL_BUCKETS 64
+
+typedef struct intern_entry_t {
+    struct intern_entry_t* next;
+    uint32_t hash;
+    uint32_t len;
+    char data[];
+} intern_entry_t;
+
+typedef struct intern_shard_t {
+    pthread_mutex_t lock;
+    intern_entry_t** buckets;
+    uint32_t mask;
+    uint32_t count;
+} intern_shard_t;
+
+static intern_shard_t g_intern[INTERN_SHARDS];
+static pthread_once_t g_intern_once = PTHREAD_ONCE_INIT;
+
+static void intern_init(void) {
+    for (int i = 0; i < INTERN_SHARDS; i++) pthread_mutex_init(&g_intern[i].lock, NULL);
+}
+
+static uint32_t intern_hash(str_t s) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < s.len; i++) {
+        hash ^= (unsigned char)s.data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Caller holds the shard lock; on failure the table just stays denser
+static void intern_grow(intern_shard_t* shard) {
+    uint32_t capacity = shard->buckets ? (shard->mask + 1) * 2 : INTERN_INITIAL_BUCKETS;
+    intern_entry_t** buckets = calloc(capacity, sizeof(intern_entry_t*));
+    if (!buckets) return;
+
+    if (shard->buckets) {
+        for (uint32_t i = 0; i <= shard->mask; i++) {
+            intern_entry_t* entry = shard->buckets[i];
+            while (entry) {
+                intern_entry_t* next = entry->next;
+                // The shard takes the low bits; buckets use the rest
+                uint32_t slot = (entry->hash / INTERN_SHARDS) & (capacity - 1);
+                entry->next = buckets[slot];
+                buckets[slot] = entry;
+                entry = next;
+            }
+        }
+        free(shard->buckets);
+    }
+    shard->buckets = buckets;
+    shard->mask = capacity - 1;
+}
+
+str_t str_intern(str_t s) {
+    if (str_empty(s)) return STR_NULL;
+    pthread_once(&g_intern_once, intern_init);
+
+    uint32_t hash = intern_hash(s);
+    intern_shard_t* shard = &g_intern[hash % INTERN_SHARDS];
+    str_t result = STR_NULL;
+
+    pthread_mutex_lock(&shard->lock);
+    if (!shard->buckets || shard->count > shard->mask) intern_grow(shard);
+    if (shard->buckets) {
+        intern_entry_t** slot = &shard->buckets[(hash / INTERN_SHARDS) & shard->mask];
+        intern_entry_t* entry = *slot;
+        while (entry && !(entry->hash == hash && entry->len == s.len && memcmp(entry->data, s.data, s.len) == 0)) {
+            entry = entry->next;
+        }
+        if (!entry) {
+            entry = malloc(sizeof(intern_entry_t) + (size_t)s.len + 1);
+            if (entry) {
+                entry->hash = hash;
+                entry->len = s.len;
+                memcpy(entry->data, s.data, s.len);
+                entry->data[s.len] = '\0';
+                entry->next = *slot;
+                *slot = entry;
+                shard->count++;
+            }
+        }
+        if (entry) result = (str_t){ .data = entry->data, .len = entry->len };
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return result;
+}
+
+str_t str_intern_cstr(const char* s) {
+    return s ? str_intern(STR_VIEW(s)) : STR_NULL;
+}
@@ -0,0 +1,94 @@
+// tokens.c - Local token count estimation for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "core/tokens.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct token_params_t {
+    uint8_t word_bytes_x2;     // Letter bytes per token, doubled
+    uint8_t digit_group;       // Digits merged into one token
+} token_params_t;
+
+static const token_params_t g_params[TOKEN_FAMILY_COUNT] = {
+    [TOKEN_FAMILY_GENERIC]   = { .word_bytes_x2 = 8, .digit_group = 2 },
+    [TOKEN_FAMILY_OPENAI]    = { .word_bytes_x2 = 9, .digit_group = 3 },
+    [TOKEN_FAMILY_ANTHROPIC] = { .word_bytes_x2 = 7, .digit_group = 2 },
+};
+
+static bool contains(str_t haystack, const char* needle) {
+    size_t len = strlen(needle);
+    if (haystack.len < len) return false;
+    for (uint32_t i = 0; i + len <= haystack.len; i++) {
+        if (memcmp(haystack.data + i, needle, len) == 0) return true;
+    }
+    return false;
+}
+
+token_family_t token_family_for_provider(str_t provider_name) {
+    if (str_empty(provider_name)) return TOKEN_FAMILY_GENERIC;
+    if (contains(provider_name, "anthropic") || contains(provider_name, "claude")) return TOKEN_FAMILY_ANTHROPIC;
+    if (contains(provider_name, "openai")) return TOKEN_FAMILY_OPENAI;
+    return TOKEN_FAMILY_GENERIC;
+}
+
+static inline bool is_letter(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26;
+}
+
+static inline bool is_digit(unsigned char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+// Latin letters plus two-byte UTF-8 sequences (accented Latin, Cyrillic,
+// Greek), which BPE vocabularies merge roughly like ASCII letters per byte
+static inline bool is_word_byte(unsigned char c) {
+    return is_letter(c) || (c >= 0x80 && c < 0xE0);
+}
+
+uint32_t token_estimate(str_t text, token_family_t family) {
+    if (!text.data || text.len == 0) return 0;
+    if ((unsigned)family >= TOKEN_FAMILY_COUNT) family = TOKEN_FAMILY_GENERIC;
+
+    const token_params_t* params = &g_params[family];
+    const unsigned char* s = (const unsigned char*)text.data;
+    uint32_t n = text.len;
+    uint32_t i = 0;
+    uint32_t tokens = 0;
+
+    while (i < n) {
+        unsigned char c = s[i];
+        uint32_t start = i;
+
+        if (is_letter(c) || (c >= 0xC0 && c < 0xE0)) {
+            while (i < n && is_word_byte(s[i])) i++;
+            tokens += ((i - start) * 2 + params->word_bytes_x2 - 1) / params->word_bytes_x2;
+        } else if (is_digit(c)) {
+            while (i < n && is_digit(s[i])) i++;
+            tokens += (i - start + params->digit_group - 1) / params->digit_group;
+        } else if (c == ' ') {
+            // A single space rides on the following token; indentation
+            // runs collapse into a few whitespace tokens
+            while (i < n && s[i] == ' ') i++;
+            tokens += (i - start) / 8;
+        } else if (c == '\n' || c == '\r' || c == '\t') {
+            while (i < n && (s[i] == '\n' || s[i] == '\r' || s[i] == '\t')) i++;
+            tokens++;
+        } else if (c >= 0xE0) {
+            // CJK, symbols and emoji: about one token per code point
+            i++;
+            while (i < n && (s[i] & 0xC0) == 0x80) i++;
+            tokens++;
+        } else if (c >= 0x80) {
+            // Stray continuation byte
+            i++;
+        } else {
+            // Punctuation; repeated characters ("----", "====") merge
+            while (i < n && s[i] == c) i++;
+            tokens += 1 + (i - start - 1) / 4;
+        }
+    }
+
+    return tokens;
+}
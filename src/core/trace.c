@@ -0,0 +1,536 @@
+// trace.c - Low-overhead tracing spans for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "core/trace.h"
+#include "utils/http.h"
+#include "utils/json_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// A finished span as stored in a ring. Every field is a word written with
+// relaxed atomics, so the exporter may read a slot that is being reused
+// and throw it away afterwards (see ring_collect).
+typedef struct trace_event_t {
+    uint64_t trace_hi;
+    uint64_t trace_lo;
+    uint64_t span_id;
+    uint64_t parent_id;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t name;             // const char*
+    uint64_t tid;
+    uint64_t detail[TRACE_DETAIL_MAX / 8];
+} trace_event_t;
+
+// Single-writer ring owned by one thread at a time; rings of exited
+// threads are handed to new ones, never freed
+typedef struct trace_ring_t {
+    trace_event_t events[TRACE_RING_SIZE];
+    uint64_t head;             // Events ever written; release-stored by the owner
+    uint64_t read;             // Exporter cursor, under g_export_lock
+    bool owned;
+    struct trace_ring_t* next;
+} trace_ring_t;
+
+static uint32_t g_sample_every;
+static uint64_t g_roots;
+static uint64_t g_clock_offset_ns;  // Realtime minus monotonic, for OTLP
+
+static trace_ring_t* g_rings;
+static pthread_mutex_t g_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_ring_key;
+static pthread_once_t g_ring_key_once = PTHREAD_ONCE_INIT;
+
+// Sinks and exporter
+static pthread_mutex_t g_export_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_chrome_fd = -1;
+static char* g_otlp_endpoint;
+static http_client_t* g_otlp_client;
+
+static pthread_mutex_t g_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t g_exporter;
+static bool g_exporter_started;
+static bool g_exporter_stop;
+static bool g_exporter_wake;
+static uint32_t g_flush_interval_ms = TRACE_FLUSH_INTERVAL_MS;
+
+static __thread trace_context_t t_context;
+static __thread trace_ring_t* t_ring;
+static __thread uint64_t t_rng;
+static __thread uint64_t t_tid;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64*, seeded per thread; ids only need to be unique, not secret
+static uint64_t random_id(void) {
+    if (!t_rng) t_rng = now_ns() ^ ((uint64_t)(uintptr_t)&t_rng << 16) ^ 0x9E3779B97F4A7C15ULL;
+    t_rng ^= t_rng >> 12;
+    t_rng ^= t_rng << 25;
+    t_rng ^= t_rng >> 27;
+    uint64_t id = t_rng * 0x2545F4914F6CDD1DULL;
+    return id ? id : 1;
+}
+
+// ============================================================================
+// Rings
+// ============================================================================
+
+static void ring_release(void* data) {
+    __atomic_store_n(&((trace_ring_t*)data)->owned, false, __ATOMIC_RELEASE);
+}
+
+static void ring_key_create(void) {
+    pthread_key_create(&g_ring_key, ring_release);
+}
+
+static trace_ring_t* thread_ring(void) {
+    if (t_ring) return t_ring;
+
+    pthread_once(&g_ring_key_once, ring_key_create);
+    pthread_mutex_lock(&g_rings_lock);
+    trace_ring_t* ring = g_rings;
+    for (; ring; ring = ring->next) {
+        bool owned = false;
+        if (__atomic_compare_exchange_n(&ring->owned, &owned, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if (!ring) {
+        ring = calloc(1, sizeof(trace_ring_t));
+        if (ring) {
+            ring->owned = true;
+            ring->next = g_rings;
+            __atomic_store_n(&g_rings, ring, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&g_rings_lock);
+
+    if (ring && pthread_setspecific(g_ring_key, ring) != 0) {
+        ring_release(ring);
+        ring = NULL;
+    }
+    t_ring = ring;
+    return ring;
+}
+
+static void ring_push(const trace_event_t* event) {
+    trace_ring_t* ring = thread_ring();
+    if (!ring) return;
+
+    uint64_t index = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint64_t* dst = (uint64_t*)&ring->events[index % TRACE_RING_SIZE];
+    const uint64_t* src = (const uint64_t*)event;
+    for (size_t i = 0; i < sizeof(trace_event_t) / 8; i++) __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->head, index + 1, __ATOMIC_RELEASE);
+}
+
+// Append the ring's unread events; slots the owner overwrote while they
+// were being copied are dropped
+static void ring_collect(trace_ring_t* ring, trace_event_t** events, size_t* count, size_t* cap) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t start = ring->read;
+    if (head - start > TRACE_RING_SIZE) start = head - TRACE_RING_SIZE;
+    if (start == head) return;
+
+    size_t need = *count + (size_t)(head - start);
+    if (need > *cap) {
+        size_t cap_new = *cap ? *cap : 256;
+        while (cap_new < need) cap_new *= 2;
+        trace_event_t* grown = realloc(*events, cap_new * sizeof(trace_event_t));
+        if (!grown) return;
+        *events = grown;
+        *cap = cap_new;
+    }
+
+    size_t first = *count;
+    for (uint64_t i = start; i < head; i++) {
+        const uint64_t* src = (const uint64_t*)&ring->events[i % TRACE_RING_SIZE];
+        uint64_t* dst = (uint64_t*)&(*events)[(*count)++];
+        for (size_t w = 0; w < sizeof(trace_event_t) / 8; w++) dst[w] = __atomic_load_n(&src[w], __ATOMIC_RELAXED);
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t head_after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head_after - start > TRACE_RING_SIZE) {
+        size_t lost = (size_t)(head_after - start - TRACE_RING_SIZE);
+        if (lost > (size_t)(head - start)) lost = (size_t)(head - start);
+        memmove(&(*events)[first], &(*events)[first + lost], (*count - first - lost) * sizeof(trace_event_t));
+        *count -= lost;
+    }
+    ring->read = head;
+}
+
+// ============================================================================
+// Spans
+// ============================================================================
+
+static void exporter_wake(void) {
+    if (!__atomic_load_n(&g_exporter_started, __ATOMIC_ACQUIRE)) return;
+    pthread_mutex_lock(&g_wake_lock);
+    g_exporter_wake = true;
+    pthread_cond_signal(&g_wake_cond);
+    pthread_mutex_unlock(&g_wake_lock);
+}
+
+static trace_span_t span_open(const char* name) {
+    trace_span_t span = { .name = name, .span_id = random_id(), .parent_id = t_context.span_id };
+    span.saved = t_context;
+    span.entered = true;
+    t_context.span_id = span.span_id;
+    span.start_ns = now_ns();
+    return span;
+}
+
+trace_span_t trace_root_begin(const char* name) {
+    uint32_t every = __atomic_load_n(&g_sample_every, __ATOMIC_RELAXED);
+    if (!every) return (trace_span_t){0};
+    if (t_context.trace_hi || t_context.trace_lo) return trace_span_begin(name);
+
+    // Unsampled roots leave the thread untraced, so their children are free
+    if (__atomic_fetch_add(&g_roots, 1, __ATOMIC_RELAXED) % every != 0) return (trace_span_t){0};
+
+    trace_context_t saved = t_context;
+    t_context = (trace_context_t){ .trace_hi = random_id(), .trace_lo = random_id(), .sampled = true };
+    trace_span_t span = span_open(name);
+    span.saved = saved;
+    return span;
+}
+
+trace_span_t trace_span_begin(const char* name) {
+    if (!t_context.sampled) return (trace_span_t){0};
+    return span_open(name);
+}
+
+void trace_span_set_detail(trace_span_t* span, str_t detail) {
+    if (!span || !span->span_id) return;
+    size_t len = detail.len < TRACE_DETAIL_MAX - 1 ? detail.len : TRACE_DETAIL_MAX - 1;
+    if (len) memcpy(span->detail, detail.data, len);
+    span->detail[len] = '\0';
+}
+
+void trace_span_end(trace_span_t* span) {
+    if (!span || !span->span_id) return;
+
+    trace_event_t event = {
+        .trace_hi = t_context.trace_hi,
+        .trace_lo = t_context.trace_lo,
+        .span_id = span->span_id,
+        .parent_id = span->parent_id,
+        .start_ns = span->start_ns,
+        .duration_ns = now_ns() - span->start_ns,
+        .name = (uint64_t)(uintptr_t)span->name,
+    };
+    if (!t_tid) t_tid = (uint64_t)syscall(SYS_gettid);
+    event.tid = t_tid;
+    memcpy(event.detail, span->detail, TRACE_DETAIL_MAX);
+    ring_push(&event);
+
+    if (span->entered) t_context = span->saved;
+    span->span_id = 0;
+    if (!event.parent_id) exporter_wake();
+}
+
+trace_context_t trace_context_current(void) {
+    return t_context;
+}
+
+void trace_context_enter(const trace_context_t* context, trace_context_t* out_saved) {
+    if (out_saved) *out_saved = t_context;
+    if (context) t_context = *context;
+}
+
+void trace_context_leave(const trace_context_t* saved) {
+    t_context = saved ? *saved : (trace_context_t){0};
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+static void write_hex_id(json_writer_t* w, const char* key, uint64_t hi, uint64_t lo, bool wide) {
+    char hex[33];
+    if (wide) {
+        snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)hi, (unsigned long long)lo);
+    } else {
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)lo);
+    }
+    json_write_kv_string(w, key, hex);
+}
+
+static void write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Chrome's JSON Array Format may be left unterminated, so each flush
+// appends complete events and the file stays loadable throughout
+static void export_chrome(const trace_event_t* events, size_t count) {
+    json_writer_t w;
+    json_writer_init(&w, count * 224 + 16);
+    int pid = (int)getpid();
+
+    for (size_t i = 0; i < count; i++) {
+        const trace_event_t* e = &events[i];
+        if (i) json_write_raw(&w, ",\n", 2);
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "name", (const char*)(uintptr_t)e->name);
+        json_write_kv_string(&w, "cat", "cclaw");
+        json_write_kv_string(&w, "ph", "X");
+        json_write_kv_number(&w, "ts", (double)e->start_ns / 1000.0);
+        json_write_kv_number(&w, "dur", (double)e->duration_ns / 1000.0);
+        json_write_kv_int(&w, "pid", pid);
+        json_write_kv_int(&w, "tid", (int64_t)e->tid);
+        json_write_key(&w, "args");
+        json_write_object_begin(&w);
+        write_hex_id(&w, "trace_id", e->trace_hi, e->trace_lo, true);
+        write_hex_id(&w, "span_id", 0, e->span_id, false);
+        const char* detail = (const char*)e->detail;
+        if (detail[0]) json_write_kv_string(&w, "detail", detail);
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+    }
+    json_write_raw(&w, ",\n", 2);
+
+    size_t len = 0;
+    char* text = json_writer_finish(&w, &len);
+    if (text) write_all(g_chrome_fd, text, len);
+    free(text);
+}
+
+static void write_nanos(json_writer_t* w, const char* key, uint64_t ns) {
+    // 64-bit integers are strings in OTLP JSON
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%llu", (unsigned long long)ns);
+    json_write_kv_string(w, key, digits);
+}
+
+static void export_otlp(const trace_event_t* events, size_t count) {
+    json_writer_t w;
+    json_writer_init(&w, count * 320 + 256);
+    json_write_object_begin(&w);
+    json_write_key(&w, "resourceSpans");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+
+    json_write_key(&w, "resource");
+    json_write_object_begin(&w);
+    json_write_key(&w, "attributes");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "key", "service.name");
+    json_write_key(&w, "value");
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "stringValue", "cclaw");
+    json_write_object_end(&w);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+
+    json_write_key(&w, "scopeSpans");
+    json_write_array_begin(&w);
+    json_write_object_begin(&w);
+    json_write_key(&w, "scope");
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "name", "cclaw");
+    json_write_object_end(&w);
+    json_write_key(&w, "spans");
+    json_write_array_begin(&w);
+
+    for (size_t i = 0; i < count; i++) {
+        const trace_event_t* e = &events[i];
+        json_write_object_begin(&w);
+        write_hex_id(&w, "traceId", e->trace_hi, e->trace_lo, true);
+        write_hex_id(&w, "spanId", 0, e->span_id, false);
+        if (e->parent_id) write_hex_id(&w, "parentSpanId", 0, e->parent_id, false);
+        json_write_kv_string(&w, "name", (const char*)(uintptr_t)e->name);
+        json_write_kv_int(&w, "kind", 1);
+        write_nanos(&w, "startTimeUnixNano", e->start_ns + g_clock_offset_ns);
+        write_nanos(&w, "endTimeUnixNano", e->start_ns + e->duration_ns + g_clock_offset_ns);
+
+        json_write_key(&w, "attributes");
+        json_write_array_begin(&w);
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "key", "thread.id");
+        json_write_key(&w, "value");
+        json_write_object_begin(&w);
+        write_nanos(&w, "intValue", e->tid);
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+        const char* detail = (const char*)e->detail;
+        if (detail[0]) {
+            json_write_object_begin(&w);
+            json_write_kv_string(&w, "key", "detail");
+            json_write_key(&w, "value");
+            json_write_object_begin(&w);
+            json_write_kv_string(&w, "stringValue", detail);
+            json_write_object_end(&w);
+            json_write_object_end(&w);
+        }
+        json_write_array_end(&w);
+        json_write_object_end(&w);
+    }
+
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+
+    char* body = json_writer_finish(&w, NULL);
+    if (!body) return;
+
+    // The exporter thread carries no trace, so this request is not traced
+    http_response_t* response = NULL;
+    if (http_post_json(g_otlp_client, g_otlp_endpoint, body, &response) == ERR_OK) {
+        http_response_free(response);
+    }
+    free(body);
+}
+
+err_t trace_flush(void) {
+    pthread_mutex_lock(&g_export_lock);
+
+    trace_event_t* events = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+    for (trace_ring_t* ring = __atomic_load_n(&g_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        ring_collect(ring, &events, &count, &cap);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        // Names are static strings; detail may have been cut mid-write
+        ((char*)events[i].detail)[TRACE_DETAIL_MAX - 1] = '\0';
+    }
+
+    if (count > 0 && g_chrome_fd >= 0) export_chrome(events, count);
+    if (count > 0 && g_otlp_client) export_otlp(events, count);
+
+    pthread_mutex_unlock(&g_export_lock);
+    free(events);
+    return ERR_OK;
+}
+
+static void* exporter_main(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_wake_lock);
+    while (!g_exporter_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t)(g_flush_interval_ms / 1000);
+        deadline.tv_nsec += (long)(g_flush_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!g_exporter_stop && !g_exporter_wake) {
+            if (pthread_cond_timedwait(&g_wake_cond, &g_wake_lock, &deadline) != 0) break;
+        }
+        g_exporter_wake = false;
+        pthread_mutex_unlock(&g_wake_lock);
+
+        trace_flush();
+
+        pthread_mutex_lock(&g_wake_lock);
+    }
+    pthread_mutex_unlock(&g_wake_lock);
+    return NULL;
+}
+
+err_t trace_init(const trace_config_t* config) {
+    if (!config) return ERR_INVALID_ARGUMENT;
+    trace_shutdown();
+
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    g_clock_offset_ns = (uint64_t)real.tv_sec * 1000000000ULL + (uint64_t)real.tv_nsec - now_ns();
+    g_flush_interval_ms = config->flush_interval_ms ? config->flush_interval_ms : TRACE_FLUSH_INTERVAL_MS;
+
+    err_t err = ERR_OK;
+    if (config->chrome_path && config->chrome_path[0]) {
+        g_chrome_fd = open(config->chrome_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        struct stat st;
+        if (g_chrome_fd < 0) {
+            err = ERR_IO;
+        } else if (fstat(g_chrome_fd, &st) == 0 && st.st_size == 0) {
+            write_all(g_chrome_fd, "[\n", 2);
+        }
+    }
+    if (err == ERR_OK && config->otlp_endpoint && config->otlp_endpoint[0]) {
+        g_otlp_endpoint = strdup(config->otlp_endpoint);
+        g_otlp_client = g_otlp_endpoint ? http_client_create(NULL) : NULL;
+        if (!g_otlp_client) err = ERR_OUT_OF_MEMORY;
+    }
+    if (err == ERR_OK && (g_chrome_fd >= 0 || g_otlp_client)) {
+        g_exporter_stop = false;
+        if (pthread_create(&g_exporter, NULL, exporter_main, NULL) != 0) {
+            err = ERR_RUNTIME;
+        } else {
+            __atomic_store_n(&g_exporter_started, true, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (err != ERR_OK) {
+        trace_shutdown();
+        return err;
+    }
+    __atomic_store_n(&g_sample_every, config->sample_every, __ATOMIC_RELAXED);
+    return ERR_OK;
+}
+
+err_t trace_init_from_env(void) {
+    const char* file = getenv("CCLAW_TRACE_FILE");
+    const char* otlp = getenv("CCLAW_TRACE_OTLP");
+    const char* sample = getenv("CCLAW_TRACE_SAMPLE");
+    if (!file && !otlp) return ERR_OK;
+
+    trace_config_t config = {
+        .sample_every = sample ? (uint32_t)strtoul(sample, NULL, 10) : 1,
+        .chrome_path = file,
+        .otlp_endpoint = otlp,
+    };
+    return trace_init(&config);
+}
+
+void trace_shutdown(void) {
+    __atomic_store_n(&g_sample_every, 0, __ATOMIC_RELAXED);
+
+    if (__atomic_load_n(&g_exporter_started, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g_wake_lock);
+        g_exporter_stop = true;
+        pthread_cond_signal(&g_wake_cond);
+        pthread_mutex_unlock(&g_wake_lock);
+        pthread_join(g_exporter, NULL);
+        __atomic_store_n(&g_exporter_started, false, __ATOMIC_RELEASE);
+    }
+
+    // Whatever finished since the exporter's last pass
+    trace_flush();
+
+    pthread_mutex_lock(&g_export_lock);
+    if (g_chrome_fd >= 0) close(g_chrome_fd);
+    g_chrome_fd = -1;
+    http_client_destroy(g_otlp_client);
+    g_otlp_client = NULL;
+    free(g_otlp_endpoint);
+    g_otlp_endpoint = NULL;
+    pthread_mutex_unlock(&g_export_lock);
+}
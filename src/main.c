@@ -115,6 +115,7 @@ static void print_help(void) {
     printf("  doctor           Run diagnostics\n");
     printf("  channel          Manage channels\n");
     printf("  cron             Manage scheduled tasks\n");
+    printf("  bench            Load test a provider, webhook or memory backend\n");
     printf("  version          Show version information\n");
     printf("  help             Show this help message\n");
     printf("\n");
@@ -218,6 +219,9 @@ static err_t handle_command(cli_args_t* args, config_t* config) {
     else if (strcmp(cmd, "cron") == 0) {
         return cmd_cron(config, args->sub_argc, args->sub_argv);
     }
+    else if (strcmp(cmd, "bench") == 0) {
+        return cmd_bench(config, args->sub_argc, args->sub_argv);
+    }
     else if (strcmp(cmd, "version") == 0) {
         return cmd_version();
     }
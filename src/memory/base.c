@@ -2,10 +2,16 @@
 // SPDX-License-Identifier: MIT
 
 #include "core/memory.h"
+#include "core/config.h"
+#include "memory/cache.h"
+#include "memory/shard.h"
+#include "core/metrics.h"
+#include "core/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 // Entry helpers
 memory_entry_t* memory_entry_create(const str_t* key, const str_t* content,
@@ -68,36 +74,15 @@ typedef struct {
     const memory_vtable_t* vtable;
 } memory_backend_entry_t;
 
+// Filled on first use; lookups and registration hold the lock
 #define MAX_MEMORY_BACKENDS 16
 static memory_backend_entry_t g_registry[MAX_MEMORY_BACKENDS];
 static uint32_t g_backend_count = 0;
 static bool g_registry_initialized = false;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
-err_t memory_registry_init(void) {
-    if (g_registry_initialized) return ERR_OK;
-
-    memset(g_registry, 0, sizeof(g_registry));
-    g_backend_count = 0;
-    g_registry_initialized = true;
-
-    // Register built-in backends
-    // These will be registered when their respective modules are implemented
-    memory_register("sqlite", memory_sqlite_get_vtable());
-    memory_register("markdown", memory_markdown_get_vtable());
-    memory_register("null", memory_null_get_vtable());
-
-    return ERR_OK;
-}
-
-void memory_registry_shutdown(void) {
-    memset(g_registry, 0, sizeof(g_registry));
-    g_backend_count = 0;
-    g_registry_initialized = false;
-}
-
-err_t memory_register(const char* name, const memory_vtable_t* vtable) {
-    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) memory_registry_init();
+// Caller holds g_registry_lock
+static err_t registry_add(const char* name, const memory_vtable_t* vtable) {
     if (g_backend_count >= MAX_MEMORY_BACKENDS) return ERR_OUT_OF_MEMORY;
 
     // Check for duplicates
@@ -114,30 +99,83 @@ err_t memory_register(const char* name, const memory_vtable_t* vtable) {
     return ERR_OK;
 }
 
-err_t memory_create(const char* name, const memory_config_t* config, memory_t** out_memory) {
-    if (!name || !config || !out_memory) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) memory_registry_init();
+static const memory_vtable_t* registry_lookup(const char* name) {
+    const memory_vtable_t* vtable = NULL;
 
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_backend_count; i++) {
         if (strcmp(g_registry[i].name, name) == 0) {
-            return g_registry[i].vtable->create(config, out_memory);
+            vtable = g_registry[i].vtable;
+            break;
         }
     }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return vtable;
+}
+
+err_t memory_registry_init(void) {
+    if (__atomic_load_n(&g_registry_initialized, __ATOMIC_ACQUIRE)) return ERR_OK;
+
+    pthread_mutex_lock(&g_registry_lock);
+    if (!g_registry_initialized) {
+        memset(g_registry, 0, sizeof(g_registry));
+        g_backend_count = 0;
+
+        // Register built-in backends
+        registry_add("sqlite", memory_sqlite_get_vtable());
+        registry_add("markdown", memory_markdown_get_vtable());
+        registry_add("null", memory_null_get_vtable());
+
+        __atomic_store_n(&g_registry_initialized, true, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return ERR_OK;
+}
+
+void memory_registry_shutdown(void) {
+    pthread_mutex_lock(&g_registry_lock);
+    memset(g_registry, 0, sizeof(g_registry));
+    g_backend_count = 0;
+    __atomic_store_n(&g_registry_initialized, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+err_t memory_register(const char* name, const memory_vtable_t* vtable) {
+    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
+    memory_registry_init();
+
+    pthread_mutex_lock(&g_registry_lock);
+    err_t err = registry_add(name, vtable);
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return err;
+}
+
+err_t memory_create(const char* name, const memory_config_t* config, memory_t** out_memory) {
+    if (!name || !config || !out_memory) return ERR_INVALID_ARGUMENT;
+    memory_registry_init();
+
+    const memory_vtable_t* vtable = registry_lookup(name);
+    if (!vtable) return ERR_NOT_FOUND;
 
-    return ERR_NOT_FOUND;
+    return vtable->create(config, out_memory);
 }
 
 err_t memory_registry_list(const char*** out_names, uint32_t* out_count) {
     if (!out_names || !out_count) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) memory_registry_init();
+    memory_registry_init();
 
     static const char* names[MAX_MEMORY_BACKENDS];
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_backend_count; i++) {
         names[i] = g_registry[i].name;
     }
+    *out_count = g_backend_count;
+    pthread_mutex_unlock(&g_registry_lock);
 
     *out_names = names;
-    *out_count = g_backend_count;
 
     return ERR_OK;
 }
@@ -200,6 +238,56 @@ str_t memory_category_to_string(memory_category_t category) {
     }
 }
 
+// Store helpers
+err_t memory_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count) {
+    if (!memory || !memory->vtable || (!entries && count > 0)) return ERR_INVALID_ARGUMENT;
+    TRACE_SCOPE("memory.store");
+
+    if (memory->vtable->store_multiple) {
+        return memory->vtable->store_multiple(memory, entries, count);
+    }
+
+    if (!memory->vtable->store) return ERR_NOT_IMPLEMENTED;
+
+    for (uint32_t i = 0; i < count; i++) {
+        err_t err = memory->vtable->store(memory, &entries[i]);
+        if (err != ERR_OK) return err;
+    }
+    return ERR_OK;
+}
+
+err_t memory_flush(memory_t* memory) {
+    if (!memory || !memory->vtable) return ERR_INVALID_ARGUMENT;
+    if (!memory->vtable->flush) return ERR_OK;
+    return memory->vtable->flush(memory);
+}
+
+err_t memory_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result) {
+    if (!memory || !memory->vtable || !opts) return ERR_INVALID_ARGUMENT;
+    if (!memory->vtable->sweep) return ERR_NOT_IMPLEMENTED;
+    TRACE_SCOPE("memory.sweep");
+
+    memory_sweep_result_t result = {0};
+    err_t err = memory->vtable->sweep(memory, opts, &result);
+    if (out_result) *out_result = result;
+    return err;
+}
+
+static uint64_t days_before(uint64_t now, uint32_t days) {
+    uint64_t span = (uint64_t)days * 86400;
+    return days > 0 && span < now ? now - span : 0;
+}
+
+memory_sweep_opts_t memory_sweep_opts_from_config(const config_t* config, uint64_t now) {
+    memory_sweep_opts_t opts = {0};
+    if (!config) return opts;
+
+    opts.archive_before = days_before(now, config->memory.archive_after_days);
+    opts.purge_before = days_before(now, config->memory.purge_after_days);
+    opts.conversation_before = days_before(now, config->memory.conversation_retention_days);
+    return opts;
+}
+
 // Search helpers
 memory_search_opts_t memory_search_opts_default(void) {
     return (memory_search_opts_t){
@@ -208,10 +296,27 @@ memory_search_opts_t memory_search_opts_default(void) {
         .min_timestamp = 0,
         .max_timestamp = 0,
         .min_score = 0.0,
-        .include_metadata = false
+        .include_metadata = false,
+        .snippets = false
     };
 }
 
+err_t memory_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                    memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!memory || !memory->vtable || !memory->vtable->search || !query || !out_entries || !out_count) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    str_t backend = memory->vtable->get_name ? memory->vtable->get_name() : STR_NULL;
+    TRACE_BEGIN(span, "memory.search");
+    TRACE_DETAIL(span, backend);
+    uint64_t start_us = metrics_now_us();
+    err_t err = memory->vtable->search(memory, query, opts, out_entries, out_count);
+    TRACE_END(span);
+    metric_observe(metric_get(&METRIC_MEMORY_SEARCH, backend, STR_NULL), metrics_now_us() - start_us);
+    return err;
+}
+
 err_t memory_search_simple(memory_t* memory, const str_t* query, uint32_t limit,
                            memory_entry_t** out_entries, uint32_t* out_count) {
     if (!memory || !memory->vtable || !memory->vtable->search || !query || !out_entries || !out_count) {
@@ -221,7 +326,7 @@ err_t memory_search_simple(memory_t* memory, const str_t* query, uint32_t limit,
     memory_search_opts_t opts = memory_search_opts_default();
     opts.limit = limit;
 
-    return memory->vtable->search(memory, query, &opts, out_entries, out_count);
+    return memory_search(memory, query, &opts, out_entries, out_count);
 }
 
 // Default configuration
@@ -231,6 +336,73 @@ memory_config_t memory_config_default(void) {
         .data_dir = STR_NULL,
         .max_entries = MEMORY_MAX_ENTRIES_DEFAULT,
         .compression = false,
-        .retention_days = MEMORY_RETENTION_DAYS_DEFAULT
+        .retention_days = MEMORY_RETENTION_DAYS_DEFAULT,
+        .write_behind_batch = 0,
+        .write_behind_interval_ms = MEMORY_WRITE_BEHIND_INTERVAL_DEFAULT_MS,
+        .embed = NULL,
+        .embed_ctx = NULL,
+        .embedding_dimensions = MEMORY_EMBEDDING_DIMENSIONS_DEFAULT,
+        .vector_weight = 0.7,
+        .keyword_weight = 0.3,
+        .embedding_cache_size = 0,
+        .chunk_max_tokens = MEMORY_CHUNK_MAX_TOKENS_DEFAULT,
+        .recall_cache_size = 0,
+        .shards = 0,
+        .shard_by_category = false
     };
+}
+
+void memory_config_apply_settings(memory_config_t* memory_config, const config_t* config) {
+    if (!memory_config || !config) return;
+
+    memory_config->backend = config->memory.backend;
+    memory_config->retention_days = config->memory.conversation_retention_days;
+    memory_config->embedding_dimensions = config->memory.embedding_dimensions;
+    memory_config->vector_weight = config->memory.vector_weight;
+    memory_config->keyword_weight = config->memory.keyword_weight;
+    memory_config->embedding_cache_size = config->memory.embedding_cache_size;
+    memory_config->chunk_max_tokens = config->memory.chunk_max_tokens;
+    memory_config->recall_cache_size = config->memory.recall_cache_size;
+    memory_config->compression = config->memory.compression;
+    memory_config->shards = config->memory.shards;
+    memory_config->shard_by_category = str_equal_cstr(config->memory.shard_by, "category");
+}
+
+err_t memory_create_from_config(const config_t* config, memory_t** out_memory) {
+    if (!config || !out_memory) return ERR_INVALID_ARGUMENT;
+
+    memory_config_t memory_config = memory_config_default();
+    memory_config_apply_settings(&memory_config, config);
+    memory_config.data_dir = config->workspace_dir;
+
+    char backend[32] = "sqlite";
+    if (!str_empty(config->memory.backend) && config->memory.backend.len < sizeof(backend)) {
+        memcpy(backend, config->memory.backend.data, config->memory.backend.len);
+        backend[config->memory.backend.len] = '\0';
+    }
+    if (strcmp(backend, "none") == 0) strcpy(backend, "null");
+
+    memory_t* memory = NULL;
+    err_t err = memory_config.shards > 1 ? memory_shard_create(backend, &memory_config, &memory)
+                                         : memory_create(backend, &memory_config, &memory);
+    if (err != ERR_OK) return err;
+
+    if (memory_config.recall_cache_size > 0) {
+        memory_t* cached = NULL;
+        err = memory_cache_wrap(memory, memory_config.recall_cache_size, &cached);
+        if (err != ERR_OK) {
+            memory_free(memory);
+            return err;
+        }
+        memory = cached;
+    }
+
+    err = memory->vtable->init ? memory->vtable->init(memory) : ERR_OK;
+    if (err != ERR_OK) {
+        memory_free(memory);
+        return err;
+    }
+
+    *out_memory = memory;
+    return ERR_OK;
 }
\ No newline at end of file
@@ -0,0 +1,614 @@
+// cache.c - Read-through LRU cache in front of a memory backend
+// SPDX-License-Identifier: MIT
+
+#include "memory/cache.h"
+#include "core/alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef enum {
+    CACHE_ITEM_KEY,
+    CACHE_ITEM_ID,
+    CACHE_ITEM_SEARCH
+} cache_item_kind_t;
+
+typedef struct cache_item_t {
+    uint64_t hash;
+    cache_item_kind_t kind;
+    char* lookup;                      // Key, id, or encoded search options + query
+    uint32_t lookup_len;
+    uint64_t epoch;                    // Write sequence when the answer was read
+    err_t result;                      // ERR_OK or ERR_NOT_FOUND
+    memory_entry_t* entries;
+    uint32_t count;
+    size_t bytes;                      // Accounted to ALLOC_TAG_MEMORY
+    struct cache_item_t* hash_next;
+    struct cache_item_t* prev;         // LRU list, most recent first
+    struct cache_item_t* next;
+} cache_item_t;
+
+typedef struct cache_shard_t {
+    pthread_mutex_t lock;
+    cache_item_t** buckets;
+    uint32_t bucket_mask;
+    cache_item_t* head;
+    cache_item_t* tail;
+    uint32_t count;
+    uint32_t capacity;
+} cache_shard_t;
+
+typedef struct memory_cache_t {
+    memory_t* inner;
+    cache_shard_t shards[MEMORY_CACHE_SHARDS];
+
+    // Bumped at the start and end of every write; an answer is cached only
+    // if no write began or ran while it was read
+    uint64_t writes;
+    uint32_t writing;
+    uint64_t derived_epoch;            // Id and search answers read before this are stale
+    uint64_t full_epoch;               // Every answer read before this is stale
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+} memory_cache_t;
+
+static const memory_vtable_t cache_vtable;
+
+// ============================================================================
+// Entries
+// ============================================================================
+
+static void entry_copy(memory_entry_t* dst, const memory_entry_t* src) {
+    *dst = *src;
+    dst->id = str_dup(src->id, NULL);
+    dst->key = str_dup(src->key, NULL);
+    dst->content = str_dup(src->content, NULL);
+    dst->timestamp = str_dup(src->timestamp, NULL);
+    dst->session_id = str_dup(src->session_id, NULL);
+}
+
+static memory_entry_t* entries_copy(const memory_entry_t* entries, uint32_t count) {
+    if (count == 0) return NULL;
+    memory_entry_t* copy = calloc(count, sizeof(memory_entry_t));
+    if (!copy) return NULL;
+    for (uint32_t i = 0; i < count; i++) entry_copy(&copy[i], &entries[i]);
+    return copy;
+}
+
+// ============================================================================
+// Shards
+// ============================================================================
+
+static uint64_t lookup_hash(cache_item_kind_t kind, const char* data, uint32_t len) {
+    // FNV-1a with the kind mixed in first
+    uint64_t h = 1469598103934665603ULL;
+    h = (h ^ (uint64_t)kind) * 1099511628211ULL;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)data[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static cache_shard_t* shard_of(memory_cache_t* cache, uint64_t hash) {
+    return &cache->shards[(hash >> 56) % MEMORY_CACHE_SHARDS];
+}
+
+static cache_item_t** item_slot(cache_shard_t* shard, uint64_t hash, cache_item_kind_t kind,
+                                const char* lookup, uint32_t len) {
+    cache_item_t** slot = &shard->buckets[hash & shard->bucket_mask];
+    while (*slot) {
+        cache_item_t* item = *slot;
+        if (item->hash == hash && item->kind == kind && item->lookup_len == len &&
+            memcmp(item->lookup, lookup, len) == 0) {
+            break;
+        }
+        slot = &item->hash_next;
+    }
+    return slot;
+}
+
+static void lru_unlink(cache_shard_t* shard, cache_item_t* item) {
+    if (item->prev) item->prev->next = item->next; else shard->head = item->next;
+    if (item->next) item->next->prev = item->prev; else shard->tail = item->prev;
+    item->prev = item->next = NULL;
+}
+
+static void lru_push_front(cache_shard_t* shard, cache_item_t* item) {
+    item->next = shard->head;
+    if (shard->head) shard->head->prev = item;
+    shard->head = item;
+    if (!shard->tail) shard->tail = item;
+}
+
+static void item_free(cache_item_t* item) {
+    alloc_tag_sub(ALLOC_TAG_MEMORY, item->bytes);
+    memory_entry_array_free(item->entries, item->count);
+    free(item->lookup);
+    free(item);
+}
+
+static void item_remove(cache_shard_t* shard, cache_item_t* item) {
+    cache_item_t** slot = item_slot(shard, item->hash, item->kind, item->lookup, item->lookup_len);
+    *slot = item->hash_next;
+    lru_unlink(shard, item);
+    item_free(item);
+    shard->count--;
+}
+
+static void shard_clear(cache_shard_t* shard) {
+    while (shard->head) item_remove(shard, shard->head);
+}
+
+static bool item_fresh(memory_cache_t* cache, const cache_item_t* item) {
+    uint64_t epoch = __atomic_load_n(&cache->full_epoch, __ATOMIC_ACQUIRE);
+    if (item->kind != CACHE_ITEM_KEY) {
+        uint64_t derived = __atomic_load_n(&cache->derived_epoch, __ATOMIC_ACQUIRE);
+        if (derived > epoch) epoch = derived;
+    }
+    return item->epoch >= epoch;
+}
+
+// Copies the cached answer out; false on a miss
+static bool cache_get(memory_cache_t* cache, cache_item_kind_t kind, const char* lookup, uint32_t len,
+                      err_t* out_result, memory_entry_t** out_entries, uint32_t* out_count) {
+    uint64_t hash = lookup_hash(kind, lookup, len);
+    cache_shard_t* shard = shard_of(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    cache_item_t* item = *item_slot(shard, hash, kind, lookup, len);
+    if (item && !item_fresh(cache, item)) {
+        item_remove(shard, item);
+        item = NULL;
+    }
+    bool hit = false;
+    if (item) {
+        memory_entry_t* copy = entries_copy(item->entries, item->count);
+        if (copy || item->count == 0) {
+            lru_unlink(shard, item);
+            lru_push_front(shard, item);
+            *out_result = item->result;
+            *out_entries = copy;
+            *out_count = item->count;
+            hit = true;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    __atomic_fetch_add(hit ? &cache->hits : &cache->misses, 1, __ATOMIC_RELAXED);
+    return hit;
+}
+
+// Sequence to pass to cache_put once the backend has answered
+static uint64_t read_begin(memory_cache_t* cache) {
+    if (__atomic_load_n(&cache->writing, __ATOMIC_ACQUIRE) > 0) return UINT64_MAX;
+    return __atomic_load_n(&cache->writes, __ATOMIC_ACQUIRE);
+}
+
+static void cache_put(memory_cache_t* cache, uint64_t epoch, cache_item_kind_t kind,
+                      const char* lookup, uint32_t len, err_t result,
+                      const memory_entry_t* entries, uint32_t count) {
+    if (epoch == UINT64_MAX) return;
+
+    uint64_t hash = lookup_hash(kind, lookup, len);
+    cache_shard_t* shard = shard_of(cache, hash);
+
+    cache_item_t* item = calloc(1, sizeof(cache_item_t));
+    if (!item) return;
+    item->lookup = malloc(len ? len : 1);
+    item->entries = entries_copy(entries, count);
+    item->count = item->entries ? count : 0;
+    if (!item->lookup || (count > 0 && !item->entries)) {
+        item_free(item);
+        return;
+    }
+    memcpy(item->lookup, lookup, len);
+    item->lookup_len = len;
+    item->bytes = sizeof(cache_item_t) + len + count * sizeof(memory_entry_t);
+    for (uint32_t i = 0; i < count; i++) {
+        const memory_entry_t* e = &entries[i];
+        item->bytes += e->id.len + e->key.len + e->content.len + e->timestamp.len + e->session_id.len;
+    }
+    alloc_tag_add(ALLOC_TAG_MEMORY, item->bytes);
+    item->hash = hash;
+    item->kind = kind;
+    item->epoch = epoch;
+    item->result = result;
+
+    pthread_mutex_lock(&shard->lock);
+    // Checked under the lock: a write finishing later drops the item itself
+    bool current = __atomic_load_n(&cache->writing, __ATOMIC_ACQUIRE) == 0 &&
+                   __atomic_load_n(&cache->writes, __ATOMIC_ACQUIRE) == epoch;
+    if (current) {
+        cache_item_t* existing = *item_slot(shard, hash, kind, lookup, len);
+        if (existing) item_remove(shard, existing);
+        if (shard->count >= shard->capacity && shard->tail) item_remove(shard, shard->tail);
+
+        cache_item_t** slot = &shard->buckets[hash & shard->bucket_mask];
+        item->hash_next = *slot;
+        *slot = item;
+        lru_push_front(shard, item);
+        shard->count++;
+        item = NULL;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    if (item) item_free(item);
+}
+
+static void cache_drop(memory_cache_t* cache, cache_item_kind_t kind, const char* lookup, uint32_t len) {
+    uint64_t hash = lookup_hash(kind, lookup, len);
+    cache_shard_t* shard = shard_of(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    cache_item_t* item = *item_slot(shard, hash, kind, lookup, len);
+    if (item) item_remove(shard, item);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+// ============================================================================
+// Writes
+// ============================================================================
+
+static void write_begin(memory_cache_t* cache) {
+    __atomic_fetch_add(&cache->writing, 1, __ATOMIC_ACQ_REL);
+    __atomic_fetch_add(&cache->writes, 1, __ATOMIC_ACQ_REL);
+}
+
+// Runs after the backend write; full also drops answers for other keys
+static void write_end(memory_cache_t* cache, bool full) {
+    uint64_t now = __atomic_load_n(&cache->writes, __ATOMIC_ACQUIRE);
+    __atomic_store_n(full ? &cache->full_epoch : &cache->derived_epoch, now, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&cache->invalidations, 1, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&cache->writes, 1, __ATOMIC_ACQ_REL);
+    __atomic_fetch_sub(&cache->writing, 1, __ATOMIC_ACQ_REL);
+}
+
+static void drop_key(memory_cache_t* cache, const str_t* key) {
+    if (key && key->data) cache_drop(cache, CACHE_ITEM_KEY, key->data, key->len);
+}
+
+// ============================================================================
+// VTable
+// ============================================================================
+
+static str_t cache_get_name(void) {
+    return STR_LIT("cache");
+}
+
+static str_t cache_get_version(void) {
+    return STR_LIT("1.0.0");
+}
+
+static err_t cache_create(const memory_config_t* config, memory_t** out_memory) {
+    (void)config;
+    (void)out_memory;
+    // Only built around an existing backend (memory_cache_wrap)
+    return ERR_NOT_IMPLEMENTED;
+}
+
+static void cache_destroy(memory_t* memory) {
+    if (!memory) return;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (cache) {
+        for (uint32_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+            shard_clear(&cache->shards[i]);
+            free(cache->shards[i].buckets);
+            pthread_mutex_destroy(&cache->shards[i].lock);
+        }
+        memory_free(cache->inner);
+        free(cache);
+    }
+    free(memory);
+}
+
+static err_t cache_init(memory_t* memory) {
+    if (!memory || !memory->impl_data) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->initialized && cache->inner->vtable->init) {
+        err_t err = cache->inner->vtable->init(cache->inner);
+        if (err != ERR_OK) return err;
+    }
+    memory->initialized = true;
+    return ERR_OK;
+}
+
+static void cache_cleanup(memory_t* memory) {
+    if (!memory || !memory->impl_data) return;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    for (uint32_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        pthread_mutex_lock(&cache->shards[i].lock);
+        shard_clear(&cache->shards[i]);
+        pthread_mutex_unlock(&cache->shards[i].lock);
+    }
+    if (cache->inner->vtable->cleanup) cache->inner->vtable->cleanup(cache->inner);
+    memory->initialized = false;
+}
+
+static err_t cache_store(memory_t* memory, const memory_entry_t* entry) {
+    if (!memory || !entry) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->store) return ERR_NOT_IMPLEMENTED;
+
+    write_begin(cache);
+    err_t err = cache->inner->vtable->store(cache->inner, entry);
+    drop_key(cache, &entry->key);
+    write_end(cache, false);
+    return err;
+}
+
+static err_t cache_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count) {
+    if (!memory || (!entries && count > 0)) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    write_begin(cache);
+    err_t err = memory_store_multiple(cache->inner, entries, count);
+    for (uint32_t i = 0; i < count; i++) drop_key(cache, &entries[i].key);
+    write_end(cache, false);
+    return err;
+}
+
+static err_t cache_flush(memory_t* memory) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+    return memory_flush(((memory_cache_t*)memory->impl_data)->inner);
+}
+
+static err_t cached_recall(memory_t* memory, cache_item_kind_t kind, const str_t* lookup,
+                           memory_entry_t* out_entry) {
+    if (!memory || !lookup || !lookup->data || !out_entry) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    err_t (*recall)(memory_t*, const str_t*, memory_entry_t*) =
+        kind == CACHE_ITEM_KEY ? cache->inner->vtable->recall : cache->inner->vtable->recall_by_id;
+    if (!recall) return ERR_NOT_IMPLEMENTED;
+
+    err_t result = ERR_OK;
+    memory_entry_t* entries = NULL;
+    uint32_t count = 0;
+    if (cache_get(cache, kind, lookup->data, lookup->len, &result, &entries, &count)) {
+        if (result == ERR_OK) {
+            *out_entry = entries[0];
+            free(entries);
+        }
+        return result;
+    }
+
+    uint64_t epoch = read_begin(cache);
+    memory_entry_t entry = {0};
+    err_t err = recall(cache->inner, lookup, &entry);
+    if (err == ERR_OK) {
+        cache_put(cache, epoch, kind, lookup->data, lookup->len, ERR_OK, &entry, 1);
+        *out_entry = entry;
+    } else if (err == ERR_NOT_FOUND) {
+        cache_put(cache, epoch, kind, lookup->data, lookup->len, ERR_NOT_FOUND, NULL, 0);
+    }
+    return err;
+}
+
+static err_t cache_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry) {
+    return cached_recall(memory, CACHE_ITEM_KEY, key, out_entry);
+}
+
+static err_t cache_recall_by_id(memory_t* memory, const str_t* id, memory_entry_t* out_entry) {
+    return cached_recall(memory, CACHE_ITEM_ID, id, out_entry);
+}
+
+// Options and query as one comparable byte string (fields copied one by
+// one so struct padding never enters the key)
+static char* search_lookup(const str_t* query, const memory_search_opts_t* opts, uint32_t* out_len) {
+    uint32_t limit = opts->limit;
+    uint32_t category = (uint32_t)opts->category_filter;
+    uint8_t flags = (uint8_t)((opts->include_metadata ? 1 : 0) | (opts->snippets ? 2 : 0));
+    size_t fixed = sizeof(limit) + sizeof(category) + sizeof(opts->min_timestamp) +
+                   sizeof(opts->max_timestamp) + sizeof(opts->min_score) + sizeof(flags);
+
+    char* buf = malloc(fixed + query->len);
+    if (!buf) return NULL;
+    char* p = buf;
+    memcpy(p, &limit, sizeof(limit)); p += sizeof(limit);
+    memcpy(p, &category, sizeof(category)); p += sizeof(category);
+    memcpy(p, &opts->min_timestamp, sizeof(opts->min_timestamp)); p += sizeof(opts->min_timestamp);
+    memcpy(p, &opts->max_timestamp, sizeof(opts->max_timestamp)); p += sizeof(opts->max_timestamp);
+    memcpy(p, &opts->min_score, sizeof(opts->min_score)); p += sizeof(opts->min_score);
+    memcpy(p, &flags, sizeof(flags)); p += sizeof(flags);
+    if (query->len) memcpy(p, query->data, query->len);
+
+    *out_len = (uint32_t)(fixed + query->len);
+    return buf;
+}
+
+static err_t cache_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                          memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!memory || !query || !out_entries || !out_count) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->search) return ERR_NOT_IMPLEMENTED;
+
+    memory_search_opts_t defaults = memory_search_opts_default();
+    uint32_t len = 0;
+    char* lookup = search_lookup(query, opts ? opts : &defaults, &len);
+    if (!lookup) return ERR_OUT_OF_MEMORY;
+
+    err_t result = ERR_OK;
+    if (cache_get(cache, CACHE_ITEM_SEARCH, lookup, len, &result, out_entries, out_count)) {
+        free(lookup);
+        return result;
+    }
+
+    uint64_t epoch = read_begin(cache);
+    err_t err = memory_search(cache->inner, query, opts, out_entries, out_count);
+    if (err == ERR_OK) {
+        cache_put(cache, epoch, CACHE_ITEM_SEARCH, lookup, len, ERR_OK, *out_entries, *out_count);
+    }
+    free(lookup);
+    return err;
+}
+
+static err_t cache_forget(memory_t* memory, const str_t* key) {
+    if (!memory || !key) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->forget) return ERR_NOT_IMPLEMENTED;
+
+    write_begin(cache);
+    err_t err = cache->inner->vtable->forget(cache->inner, key);
+    drop_key(cache, key);
+    write_end(cache, false);
+    return err;
+}
+
+static err_t cache_forget_by_id(memory_t* memory, const str_t* id) {
+    if (!memory || !id) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->forget_by_id) return ERR_NOT_IMPLEMENTED;
+
+    // The key behind the id is unknown here, so nothing cached survives
+    write_begin(cache);
+    err_t err = cache->inner->vtable->forget_by_id(cache->inner, id);
+    write_end(cache, true);
+    return err;
+}
+
+static err_t cache_forget_old(memory_t* memory, uint64_t cutoff_timestamp) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->forget_old) return ERR_NOT_IMPLEMENTED;
+
+    write_begin(cache);
+    err_t err = cache->inner->vtable->forget_old(cache->inner, cutoff_timestamp);
+    write_end(cache, true);
+    return err;
+}
+
+static err_t cache_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->sweep) return ERR_NOT_IMPLEMENTED;
+
+    write_begin(cache);
+    err_t err = cache->inner->vtable->sweep(cache->inner, opts, out_result);
+    write_end(cache, true);
+    return err;
+}
+
+static err_t cache_get_stats(memory_t* memory, uint32_t* total_entries, uint32_t* by_category_counts) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->get_stats) return ERR_NOT_IMPLEMENTED;
+    return cache->inner->vtable->get_stats(cache->inner, total_entries, by_category_counts);
+}
+
+static err_t cache_backup(memory_t* memory, const str_t* backup_path) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->backup) return ERR_NOT_IMPLEMENTED;
+    return cache->inner->vtable->backup(cache->inner, backup_path);
+}
+
+static err_t cache_restore(memory_t* memory, const str_t* backup_path) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    if (!cache->inner->vtable->restore) return ERR_NOT_IMPLEMENTED;
+
+    write_begin(cache);
+    err_t err = cache->inner->vtable->restore(cache->inner, backup_path);
+    write_end(cache, true);
+    return err;
+}
+
+static const memory_vtable_t cache_vtable = {
+    .get_name = cache_get_name,
+    .get_version = cache_get_version,
+    .create = cache_create,
+    .destroy = cache_destroy,
+    .init = cache_init,
+    .cleanup = cache_cleanup,
+    .store = cache_store,
+    .store_multiple = cache_store_multiple,
+    .flush = cache_flush,
+    .recall = cache_recall,
+    .recall_by_id = cache_recall_by_id,
+    .search = cache_search,
+    .forget = cache_forget,
+    .forget_by_id = cache_forget_by_id,
+    .forget_old = cache_forget_old,
+    .sweep = cache_sweep,
+    .get_stats = cache_get_stats,
+    .backup = cache_backup,
+    .restore = cache_restore
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+err_t memory_cache_wrap(memory_t* inner, uint32_t max_entries, memory_t** out_memory) {
+    if (!inner || !inner->vtable || !out_memory) return ERR_INVALID_ARGUMENT;
+    if (max_entries == 0) max_entries = MEMORY_CACHE_DEFAULT_ENTRIES;
+
+    memory_t* memory = memory_alloc(&cache_vtable);
+    memory_cache_t* cache = calloc(1, sizeof(memory_cache_t));
+    if (!memory || !cache) {
+        free(memory);
+        free(cache);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint32_t per_shard = (max_entries + MEMORY_CACHE_SHARDS - 1) / MEMORY_CACHE_SHARDS;
+    uint32_t buckets = 8;
+    while (buckets < per_shard) buckets <<= 1;
+
+    memory->impl_data = cache;
+    for (uint32_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        pthread_mutex_init(&cache->shards[i].lock, NULL);
+    }
+    for (uint32_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        cache_shard_t* shard = &cache->shards[i];
+        shard->capacity = per_shard;
+        shard->bucket_mask = buckets - 1;
+        shard->buckets = calloc(buckets, sizeof(cache_item_t*));
+        if (!shard->buckets) {
+            cache_destroy(memory);
+            return ERR_OUT_OF_MEMORY;
+        }
+    }
+
+    cache->inner = inner;
+    memory->config = inner->config;
+    memory->initialized = inner->initialized;
+
+    *out_memory = memory;
+    return ERR_OK;
+}
+
+bool memory_is_cache(const memory_t* memory) {
+    return memory && memory->vtable == &cache_vtable;
+}
+
+bool memory_cache_get_stats(memory_t* memory, memory_cache_stats_t* out_stats) {
+    if (!memory_is_cache(memory) || !out_stats) return false;
+
+    memory_cache_t* cache = (memory_cache_t*)memory->impl_data;
+    out_stats->hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+    out_stats->misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+    out_stats->invalidations = __atomic_load_n(&cache->invalidations, __ATOMIC_RELAXED);
+    out_stats->entries = 0;
+    for (uint32_t i = 0; i < MEMORY_CACHE_SHARDS; i++) {
+        pthread_mutex_lock(&cache->shards[i].lock);
+        out_stats->entries += cache->shards[i].count;
+        pthread_mutex_unlock(&cache->shards[i].lock);
+    }
+    return true;
+}
@@ -0,0 +1,164 @@
+// compress.c - Dictionary compression for stored memory content
+// SPDX-License-Identifier: MIT
+
+#include "memory/compress.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define COMPRESS_HEADER_BYTES 4
+
+struct memory_compressor_t {
+    z_stream stream;
+};
+
+// ============================================================================
+// Dictionaries
+// ============================================================================
+
+err_t memory_dict_init(memory_dict_t* dict, const void* data, uint32_t size) {
+    if (!dict || !data || size == 0) return ERR_INVALID_ARGUMENT;
+    if (size > MEMORY_DICT_MAX_BYTES) {
+        data = (const uint8_t*)data + (size - MEMORY_DICT_MAX_BYTES);
+        size = MEMORY_DICT_MAX_BYTES;
+    }
+
+    dict->data = malloc(size);
+    if (!dict->data) return ERR_OUT_OF_MEMORY;
+    memcpy(dict->data, data, size);
+    dict->size = size;
+    dict->id = (uint32_t)adler32(adler32(0L, Z_NULL, 0), dict->data, size);
+    return ERR_OK;
+}
+
+err_t memory_dict_train(const str_t* samples, uint32_t count, memory_dict_t* out_dict) {
+    if (!samples || !out_dict) return ERR_INVALID_ARGUMENT;
+
+    // Filled back to front so the newest sample ends up last
+    uint8_t* buffer = malloc(MEMORY_DICT_MAX_BYTES);
+    if (!buffer) return ERR_OUT_OF_MEMORY;
+
+    uint32_t start = MEMORY_DICT_MAX_BYTES;
+    for (uint32_t i = 0; i < count && start > 0; i++) {
+        const str_t* sample = &samples[i];
+        if (str_empty(*sample)) continue;
+
+        uint32_t take = sample->len < start ? sample->len : start;
+        const uint8_t* tail = (const uint8_t*)sample->data + (sample->len - take);
+        if (memmem(buffer + start, MEMORY_DICT_MAX_BYTES - start, tail, take)) continue;
+
+        start -= take;
+        memcpy(buffer + start, tail, take);
+    }
+
+    err_t err = start < MEMORY_DICT_MAX_BYTES
+        ? memory_dict_init(out_dict, buffer + start, MEMORY_DICT_MAX_BYTES - start)
+        : ERR_NOT_FOUND;
+    free(buffer);
+    return err;
+}
+
+void memory_dict_free(memory_dict_t* dict) {
+    if (!dict) return;
+    free(dict->data);
+    memset(dict, 0, sizeof(*dict));
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+err_t memory_compressor_create(memory_compressor_t** out_compressor) {
+    if (!out_compressor) return ERR_INVALID_ARGUMENT;
+
+    memory_compressor_t* compressor = calloc(1, sizeof(memory_compressor_t));
+    if (!compressor) return ERR_OUT_OF_MEMORY;
+
+    if (deflateInit2(&compressor->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(compressor);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    *out_compressor = compressor;
+    return ERR_OK;
+}
+
+void memory_compressor_free(memory_compressor_t* compressor) {
+    if (!compressor) return;
+    deflateEnd(&compressor->stream);
+    free(compressor);
+}
+
+err_t memory_compress(memory_compressor_t* compressor, const memory_dict_t* dict,
+                      const char* text, uint32_t len, uint8_t** out_data, uint32_t* out_len) {
+    if (!compressor || !dict || !text || !out_data || !out_len) return ERR_INVALID_ARGUMENT;
+
+    *out_data = NULL;
+    *out_len = 0;
+    if (len < MEMORY_COMPRESS_MIN_BYTES) return ERR_OK;
+
+    z_stream* stream = &compressor->stream;
+    if (deflateReset(stream) != Z_OK || deflateSetDictionary(stream, dict->data, dict->size) != Z_OK) {
+        return ERR_RUNTIME;
+    }
+
+    // Anything that does not fit under the plaintext size is not worth keeping
+    uint8_t* data = malloc(len);
+    if (!data) return ERR_OUT_OF_MEMORY;
+    for (int i = 0; i < COMPRESS_HEADER_BYTES; i++) data[i] = (uint8_t)(len >> (8 * i));
+
+    stream->next_in = (Bytef*)text;
+    stream->avail_in = len;
+    stream->next_out = data + COMPRESS_HEADER_BYTES;
+    stream->avail_out = len - COMPRESS_HEADER_BYTES;
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        free(data);
+        return ERR_OK;
+    }
+
+    *out_data = data;
+    *out_len = COMPRESS_HEADER_BYTES + (uint32_t)stream->total_out;
+    return ERR_OK;
+}
+
+err_t memory_decompress(const uint8_t* data, uint32_t len, memory_dict_lookup_fn_t lookup, void* lookup_ctx,
+                        char** out_text, uint32_t* out_len) {
+    if (!data || !out_text || len < COMPRESS_HEADER_BYTES) return ERR_INVALID_ARGUMENT;
+
+    uint32_t plain_len = 0;
+    for (int i = 0; i < COMPRESS_HEADER_BYTES; i++) plain_len |= (uint32_t)data[i] << (8 * i);
+
+    char* text = malloc((size_t)plain_len + 1);
+    if (!text) return ERR_OUT_OF_MEMORY;
+
+    z_stream stream = {0};
+    if (inflateInit(&stream) != Z_OK) {
+        free(text);
+        return ERR_OUT_OF_MEMORY;
+    }
+    stream.next_in = (Bytef*)(data + COMPRESS_HEADER_BYTES);
+    stream.avail_in = len - COMPRESS_HEADER_BYTES;
+    stream.next_out = (Bytef*)text;
+    stream.avail_out = plain_len;
+
+    int rc = inflate(&stream, Z_FINISH);
+    if (rc == Z_NEED_DICT) {
+        const memory_dict_t* dict = lookup ? lookup(lookup_ctx, (uint32_t)stream.adler) : NULL;
+        rc = dict && inflateSetDictionary(&stream, dict->data, dict->size) == Z_OK
+            ? inflate(&stream, Z_FINISH)
+            : Z_NEED_DICT;
+    }
+    bool ok = rc == Z_STREAM_END && stream.total_out == plain_len;
+    inflateEnd(&stream);
+
+    if (!ok) {
+        free(text);
+        return ERR_MEMORY_CORRUPT;
+    }
+
+    text[plain_len] = '\0';
+    *out_text = text;
+    if (out_len) *out_len = plain_len;
+    return ERR_OK;
+}
@@ -3,20 +3,33 @@
 
 #include "core/memory.h"
 #include "core/alloc.h"
+#include "memory/markdown_index.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
+// Index file kept next to the category directories
+#define MARKDOWN_INDEX_FILE ".index"
+
 // Markdown memory instance data
 typedef struct markdown_memory_t {
     char* base_dir;
+    char* index_path;
     bool use_compression;
     bool use_categories;  // Store in separate category directories
+    md_index_t index;     // Term -> files, plus the mtime/size manifest
+    uint32_t generation;  // Revalidation pass counter
+    pthread_mutex_t lock; // Guards index
 } markdown_memory_t;
 
+// Category directories, indexed by memory_category_t
+static const char* g_category_dirs[MD_INDEX_DIRS] = {"core", "daily", "conversation", "custom"};
+
 // Forward declarations for vtable
 static str_t markdown_get_name(void);
 static str_t markdown_get_version(void);
@@ -26,6 +39,7 @@ static err_t markdown_init(memory_t* memory);
 static void markdown_cleanup(memory_t* memory);
 static err_t markdown_store(memory_t* memory, const memory_entry_t* entry);
 static err_t markdown_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count);
+static err_t markdown_flush(memory_t* memory);
 static err_t markdown_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry);
 static err_t markdown_recall_by_id(memory_t* memory, const str_t* id, memory_entry_t* out_entry);
 static err_t markdown_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
@@ -47,6 +61,7 @@ static const memory_vtable_t markdown_vtable = {
     .cleanup = markdown_cleanup,
     .store = markdown_store,
     .store_multiple = NULL, // TODO: Implement batch store
+    .flush = markdown_flush,
     .recall = markdown_recall,
     .recall_by_id = markdown_recall_by_id,
     .search = markdown_search,
@@ -148,6 +163,245 @@ static char* get_entry_filepath(markdown_memory_t* md_mem, const memory_entry_t*
     return filepath;
 }
 
+static const char* relative_path(markdown_memory_t* md_mem, const char* filepath) {
+    return filepath + strlen(md_mem->base_dir) + 1;
+}
+
+static uint32_t entry_category(const memory_entry_t* entry) {
+    return (uint32_t)entry->category < MD_INDEX_DIRS ? (uint32_t)entry->category : MEMORY_CATEGORY_CUSTOM;
+}
+
+static int64_t stat_mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + (int64_t)st->st_mtim.tv_nsec;
+}
+
+static int64_t dir_mtime_ns(markdown_memory_t* md_mem, uint32_t category) {
+    char dirpath[512];
+    snprintf(dirpath, sizeof(dirpath), "%s/%s", md_mem->base_dir, g_category_dirs[category]);
+
+    struct stat st;
+    return stat(dirpath, &st) == 0 ? stat_mtime_ns(&st) : -1;
+}
+
+// Our own create/unlink bumps the directory mtime. When the index was current
+// before it, record the new mtime so the next search skips the rescan.
+static void absorb_own_change(markdown_memory_t* md_mem, uint32_t category, int64_t before) {
+    if (before >= 0 && before == md_mem->index.dir_mtime_ns[category]) {
+        md_mem->index.dir_mtime_ns[category] = dir_mtime_ns(md_mem, category);
+    }
+}
+
+// Whole file as a NUL-terminated buffer; st describes the file that was read
+static char* read_file(const char* filepath, struct stat* st, size_t* out_len) {
+    FILE* f = fopen(filepath, "r");
+    if (!f) return NULL;
+
+    if (fstat(fileno(f), st) != 0 || st->st_size < 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    size_t size = (size_t)st->st_size;
+    char* text = malloc(size + 1);
+    if (!text) {
+        fclose(f);
+        return NULL;
+    }
+
+    size_t len = fread(text, 1, size, f);
+    fclose(f);
+    text[len] = '\0';
+
+    *out_len = len;
+    return text;
+}
+
+// Entry as file text: YAML frontmatter, blank line, content
+static char* render_entry(const memory_entry_t* entry, size_t* out_len) {
+    char session[160] = "";
+    if (!str_empty(entry->session_id)) {
+        snprintf(session, sizeof(session), "session_id: %.*s\n", (int)entry->session_id.len, entry->session_id.data);
+    }
+
+    const char* format = "---\nid: %.*s\nkey: %.*s\ncategory: %d\ntimestamp: %.*s\n%sscore: %f\n---\n\n%.*s\n";
+    int len = snprintf(NULL, 0, format,
+                       (int)entry->id.len, entry->id.data, (int)entry->key.len, entry->key.data,
+                       entry->category, (int)entry->timestamp.len, entry->timestamp.data, session,
+                       entry->score, (int)entry->content.len, entry->content.data);
+    if (len < 0) return NULL;
+
+    char* text = malloc((size_t)len + 1);
+    if (!text) return NULL;
+
+    snprintf(text, (size_t)len + 1, format,
+             (int)entry->id.len, entry->id.data, (int)entry->key.len, entry->key.data,
+             entry->category, (int)entry->timestamp.len, entry->timestamp.data, session,
+             entry->score, (int)entry->content.len, entry->content.data);
+
+    *out_len = (size_t)len;
+    return text;
+}
+
+static bool set_field(str_t* field, const char* data, size_t len) {
+    char* copy = malloc(len + 1);
+    if (!copy) return false;
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+
+    free((void*)field->data);
+    field->data = copy;
+    field->len = (uint32_t)len;
+    return true;
+}
+
+// Parse file text into an entry. Hand-written files without frontmatter are
+// taken whole, keyed by their file name.
+static err_t parse_entry(const char* text, size_t len, const char* path, uint32_t category,
+                         memory_entry_t* out_entry) {
+    memset(out_entry, 0, sizeof(memory_entry_t));
+    out_entry->category = (memory_category_t)category;
+
+    const char* body = text;
+    const char* end = text + len;
+    bool ok = true;
+
+    if (len >= 4 && memcmp(text, "---\n", 4) == 0) {
+        const char* line = text + 4;
+        while (line < end && ok) {
+            const char* eol = memchr(line, '\n', (size_t)(end - line));
+            if (!eol) eol = end;
+            size_t line_len = (size_t)(eol - line);
+
+            if (line_len == 3 && memcmp(line, "---", 3) == 0) {
+                body = eol < end ? eol + 1 : end;
+                break;
+            }
+
+            const char* colon = memchr(line, ':', line_len);
+            if (colon) {
+                size_t name_len = (size_t)(colon - line);
+                const char* value = colon + 1;
+                while (value < eol && *value == ' ') value++;
+                size_t value_len = (size_t)(eol - value);
+
+                if (name_len == 2 && memcmp(line, "id", 2) == 0) {
+                    ok = set_field(&out_entry->id, value, value_len);
+                } else if (name_len == 3 && memcmp(line, "key", 3) == 0) {
+                    ok = set_field(&out_entry->key, value, value_len);
+                } else if (name_len == 9 && memcmp(line, "timestamp", 9) == 0) {
+                    ok = set_field(&out_entry->timestamp, value, value_len);
+                } else if (name_len == 10 && memcmp(line, "session_id", 10) == 0) {
+                    ok = set_field(&out_entry->session_id, value, value_len);
+                }
+            }
+            line = eol + 1;
+        }
+        if (body < end && *body == '\n') body++;
+    }
+
+    // Content without the trailing newline the writer adds
+    size_t body_len = (size_t)(end - body);
+    while (body_len > 0 && body[body_len - 1] == '\n') body_len--;
+    ok = ok && set_field(&out_entry->content, body, body_len);
+
+    if (ok && !out_entry->key.data) {
+        const char* name = strrchr(path, '/');
+        name = name ? name + 1 : path;
+        size_t name_len = strlen(name);
+        ok = set_field(&out_entry->key, name, name_len > 3 ? name_len - 3 : name_len);
+    }
+
+    if (!ok) {
+        free((void*)out_entry->id.data);
+        free((void*)out_entry->key.data);
+        free((void*)out_entry->content.data);
+        free((void*)out_entry->timestamp.data);
+        free((void*)out_entry->session_id.data);
+        memset(out_entry, 0, sizeof(memory_entry_t));
+        return ERR_OUT_OF_MEMORY;
+    }
+    return ERR_OK;
+}
+
+// Re-read one category directory (index lock held). Unchanged files cost one
+// stat; new or modified ones are re-tokenized and vanished ones dropped.
+static err_t revalidate_directory(markdown_memory_t* md_mem, uint32_t category) {
+    md_index_t* index = &md_mem->index;
+    uint32_t generation = ++md_mem->generation;
+
+    char dirpath[512];
+    snprintf(dirpath, sizeof(dirpath), "%s/%s", md_mem->base_dir, g_category_dirs[category]);
+
+    DIR* dir = opendir(dirpath);
+    if (!dir) return ERR_IO;
+
+    err_t err = ERR_OK;
+    struct dirent* dent;
+    while ((dent = readdir(dir)) != NULL && err == ERR_OK) {
+        size_t name_len = strlen(dent->d_name);
+        if (dent->d_name[0] == '.' || name_len < 4 || strcmp(dent->d_name + name_len - 3, ".md") != 0) {
+            continue;
+        }
+
+        char filepath[1024];
+        snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, dent->d_name);
+        const char* rel = relative_path(md_mem, filepath);
+
+        struct stat st;
+        if (stat(filepath, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        uint32_t id = md_index_find_file(index, rel);
+        if (id != MD_INDEX_NONE && index->files[id].live &&
+            index->files[id].mtime_ns == stat_mtime_ns(&st) && index->files[id].size == (int64_t)st.st_size) {
+            index->files[id].seen = generation;
+            continue;
+        }
+
+        size_t len = 0;
+        char* text = read_file(filepath, &st, &len);
+        if (!text) continue;
+
+        err = md_index_update_file(index, rel, category, stat_mtime_ns(&st), (int64_t)st.st_size, text, len);
+        free(text);
+
+        id = md_index_find_file(index, rel);
+        if (id != MD_INDEX_NONE) index->files[id].seen = generation;
+    }
+    closedir(dir);
+
+    for (uint32_t i = 0; i < index->file_count && err == ERR_OK; i++) {
+        md_index_file_t* file = &index->files[i];
+        if (file->live && file->category == category && file->seen != generation) {
+            md_index_remove_file(index, file->path);
+        }
+    }
+
+    return err;
+}
+
+// Bring the index up to date with the directories (index lock held). Adding,
+// removing or renaming a file bumps its directory's mtime, so normally this
+// is four stats; `full` also re-checks every file for in-place edits.
+static err_t revalidate(markdown_memory_t* md_mem, bool full) {
+    for (uint32_t i = 0; i < MD_INDEX_DIRS; i++) {
+        char dirpath[512];
+        snprintf(dirpath, sizeof(dirpath), "%s/%s", md_mem->base_dir, g_category_dirs[i]);
+
+        struct stat st;
+        if (stat(dirpath, &st) != 0) return ERR_IO;
+
+        int64_t mtime = stat_mtime_ns(&st);
+        if (!full && mtime == md_mem->index.dir_mtime_ns[i]) continue;
+
+        err_t err = revalidate_directory(md_mem, i);
+        if (err != ERR_OK) return err;
+
+        md_mem->index.dir_mtime_ns[i] = mtime;
+        md_mem->index.dirty = true;
+    }
+    return ERR_OK;
+}
+
 static str_t markdown_get_name(void) {
     return STR_LIT("markdown");
 }
@@ -190,8 +444,20 @@ static err_t markdown_create(const memory_config_t* config, memory_t** out_memor
         }
     }
 
+    size_t index_path_len = strlen(md_mem->base_dir) + sizeof(MARKDOWN_INDEX_FILE) + 1;
+    md_mem->index_path = malloc(index_path_len);
+    if (!md_mem->index_path) {
+        free(md_mem->base_dir);
+        free(md_mem);
+        memory_free(memory);
+        return ERR_OUT_OF_MEMORY;
+    }
+    snprintf(md_mem->index_path, index_path_len, "%s/%s", md_mem->base_dir, MARKDOWN_INDEX_FILE);
+
     md_mem->use_compression = config->compression;
     md_mem->use_categories = true; // Always use categories for markdown
+    md_index_init(&md_mem->index);
+    pthread_mutex_init(&md_mem->lock, NULL);
 
     memory->impl_data = md_mem;
 
@@ -209,6 +475,8 @@ static void markdown_destroy(memory_t* memory) {
         markdown_cleanup(memory);
     }
 
+    pthread_mutex_destroy(&md_mem->lock);
+    free(md_mem->index_path);
     free(md_mem->base_dir);
     free(md_mem);
     memory->impl_data = NULL;
@@ -228,15 +496,30 @@ static err_t markdown_init(memory_t* memory) {
     }
 
     // Create category directories
-    const char* categories[] = {"core", "daily", "conversation", "custom"};
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < MD_INDEX_DIRS; i++) {
         char path[512];
-        snprintf(path, sizeof(path), "%s/%s", md_mem->base_dir, categories[i]);
+        snprintf(path, sizeof(path), "%s/%s", md_mem->base_dir, g_category_dirs[i]);
         if (!ensure_directory_exists(path)) {
             return ERR_IO;
         }
     }
 
+    // A missing or unreadable index is rebuilt from the files. Either way every
+    // known file is re-stat'ed once, so edits made while we were down are seen.
+    pthread_mutex_lock(&md_mem->lock);
+    if (md_index_load(&md_mem->index, md_mem->index_path) != ERR_OK) {
+        md_index_free(&md_mem->index);
+    }
+    err_t err = revalidate(md_mem, true);
+    if (err == ERR_OK && md_mem->index.dirty) {
+        md_index_save(&md_mem->index, md_mem->index_path);
+    }
+    pthread_mutex_unlock(&md_mem->lock);
+    if (err != ERR_OK) {
+        md_index_free(&md_mem->index);
+        return err;
+    }
+
     memory->initialized = true;
     return ERR_OK;
 }
@@ -245,7 +528,13 @@ static void markdown_cleanup(memory_t* memory) {
     if (!memory || !memory->impl_data || !memory->initialized) return;
 
     markdown_memory_t* md_mem = (markdown_memory_t*)memory->impl_data;
-    // Nothing to clean up for file-based storage
+
+    pthread_mutex_lock(&md_mem->lock);
+    if (md_mem->index.dirty) {
+        md_index_save(&md_mem->index, md_mem->index_path);
+    }
+    md_index_free(&md_mem->index);
+    pthread_mutex_unlock(&md_mem->lock);
 
     memory->initialized = false;
 }
@@ -261,31 +550,56 @@ static err_t markdown_store(memory_t* memory, const memory_entry_t* entry) {
     char* filepath = get_entry_filepath(md_mem, entry);
     if (!filepath) return ERR_OUT_OF_MEMORY;
 
-    // Create Markdown content
+    // Render once so the same bytes are written and indexed
+    size_t len = 0;
+    char* text = render_entry(entry, &len);
+    if (!text) {
+        free(filepath);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint32_t category = entry_category(entry);
+    pthread_mutex_lock(&md_mem->lock);
+    int64_t before = dir_mtime_ns(md_mem, category);
+
     FILE* f = fopen(filepath, "w");
     if (!f) {
+        pthread_mutex_unlock(&md_mem->lock);
+        free(text);
         free(filepath);
         return ERR_IO;
     }
 
-    // Write metadata as YAML frontmatter
-    fprintf(f, "---\n");
-    fprintf(f, "id: %.*s\n", (int)entry->id.len, entry->id.data);
-    fprintf(f, "key: %.*s\n", (int)entry->key.len, entry->key.data);
-    fprintf(f, "category: %d\n", entry->category);
-    fprintf(f, "timestamp: %.*s\n", (int)entry->timestamp.len, entry->timestamp.data);
-    if (!str_empty(entry->session_id)) {
-        fprintf(f, "session_id: %.*s\n", (int)entry->session_id.len, entry->session_id.data);
-    }
-    fprintf(f, "score: %f\n", entry->score);
-    fprintf(f, "---\n\n");
+    bool written = fwrite(text, 1, len, f) == len;
+    written = fclose(f) == 0 && written;
 
-    // Write content
-    fprintf(f, "%.*s\n", (int)entry->content.len, entry->content.data);
+    struct stat st;
+    err_t err = written ? ERR_OK : ERR_IO;
+    if (err == ERR_OK && stat(filepath, &st) == 0) {
+        err = md_index_update_file(&md_mem->index, relative_path(md_mem, filepath), category,
+                                   stat_mtime_ns(&st), (int64_t)st.st_size, text, len);
+        absorb_own_change(md_mem, category, before);
+    }
+    pthread_mutex_unlock(&md_mem->lock);
 
-    fclose(f);
+    free(text);
     free(filepath);
-    return ERR_OK;
+    return err;
+}
+
+static err_t markdown_flush(memory_t* memory) {
+    if (!memory || !memory->impl_data || !memory->initialized) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    markdown_memory_t* md_mem = (markdown_memory_t*)memory->impl_data;
+
+    // Files are written synchronously; only the index may lag behind
+    pthread_mutex_lock(&md_mem->lock);
+    err_t err = md_mem->index.dirty ? md_index_save(&md_mem->index, md_mem->index_path) : ERR_OK;
+    pthread_mutex_unlock(&md_mem->lock);
+
+    return err;
 }
 
 static err_t markdown_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry) {
@@ -312,177 +626,173 @@ static err_t markdown_recall_by_id(memory_t* memory, const str_t* id, memory_ent
     return ERR_NOT_IMPLEMENTED;
 }
 
-static bool file_matches_query(const char* filepath, const char* query) {
-    FILE* f = fopen(filepath, "r");
-    if (!f) return false;
-
-    // Simple check: read file and search for query substring
-    char buffer[4096];
-    bool found = false;
-    size_t query_len = strlen(query);
+// Count query term occurrences in text; 0 unless every term occurs
+static uint32_t count_term_hits(const str_t* query, const char* text, size_t len) {
+    char terms[8][MD_INDEX_MAX_TERM + 1];
+    uint32_t hits[8] = {0};
+    uint32_t term_count = 0;
+    size_t pos = 0;
+    while (term_count < 8 && md_index_next_term(query->data, query->len, &pos, terms[term_count]) > 0) {
+        term_count++;
+    }
 
-    while (fgets(buffer, sizeof(buffer), f) && !found) {
-        if (strstr(buffer, query) != NULL) {
-            found = true;
+    char term[MD_INDEX_MAX_TERM + 1];
+    uint32_t total = 0;
+    pos = 0;
+    while (md_index_next_term(text, len, &pos, term) > 0) {
+        for (uint32_t i = 0; i < term_count; i++) {
+            if (strcmp(term, terms[i]) == 0) {
+                hits[i]++;
+                total++;
+            }
         }
     }
 
-    fclose(f);
-    return found;
+    for (uint32_t i = 0; i < term_count; i++) {
+        if (hits[i] == 0) return 0;
+    }
+    return total;
 }
 
-static err_t scan_directory(const char* dirpath, const char* query,
-                           memory_entry_t** out_entries, uint32_t* out_count,
-                           uint32_t limit) {
-    DIR* dir = opendir(dirpath);
-    if (!dir) return ERR_IO;
+static int compare_score_desc(const void* a, const void* b) {
+    double sa = ((const memory_entry_t*)a)->score;
+    double sb = ((const memory_entry_t*)b)->score;
+    return (sa < sb) - (sa > sb);
+}
+
+static err_t markdown_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                            memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!memory || !memory->impl_data || !memory->initialized || !query || !out_entries || !out_count) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    markdown_memory_t* md_mem = (markdown_memory_t*)memory->impl_data;
 
-    struct dirent* entry;
+    uint32_t limit = opts && opts->limit ? opts->limit : 10;
+    memory_category_t category_filter = opts ? opts->category_filter : 0;
+
+    *out_entries = NULL;
+    *out_count = 0;
+
+    pthread_mutex_lock(&md_mem->lock);
+
+    // Four directory stats pick up files added, removed or renamed by hand
+    err_t err = revalidate(md_mem, false);
+
+    uint32_t* candidates = NULL;
+    uint32_t candidate_count = 0;
+    if (err == ERR_OK) {
+        err = md_index_query(&md_mem->index, *query, &candidates, &candidate_count);
+    }
+
+    // Only files holding every term are opened
+    memory_entry_t* entries = NULL;
     uint32_t count = 0;
     uint32_t capacity = 0;
-    memory_entry_t* entries = NULL;
 
-    while ((entry = readdir(dir)) != NULL && count < limit) {
-        if (entry->d_type != DT_REG) continue;
+    for (uint32_t c = 0; c < candidate_count && err == ERR_OK; c++) {
+        md_index_file_t* file = &md_mem->index.files[candidates[c]];
+        if (category_filter && file->category != (uint32_t)category_filter) continue;
+
+        char filepath[1024];
+        snprintf(filepath, sizeof(filepath), "%s/%s", md_mem->base_dir, file->path);
 
-        // Check if it's a .md file
-        size_t name_len = strlen(entry->d_name);
-        if (name_len < 4 || strcmp(entry->d_name + name_len - 3, ".md") != 0) {
+        size_t len = 0;
+        struct stat st;
+        char* text = read_file(filepath, &st, &len);
+        if (!text) {
+            md_index_remove_file(&md_mem->index, file->path);
             continue;
         }
 
-        // Build full path
-        char filepath[1024];
-        snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, entry->d_name);
+        // Edited in place since it was indexed: refresh its terms
+        if (stat_mtime_ns(&st) != file->mtime_ns || (int64_t)st.st_size != file->size) {
+            md_index_update_file(&md_mem->index, file->path, file->category,
+                                 stat_mtime_ns(&st), (int64_t)st.st_size, text, len);
+        }
 
-        if (!file_matches_query(filepath, query)) {
+        uint32_t hits = count_term_hits(query, text, len);
+        if (hits == 0) {
+            free(text);
             continue;
         }
 
-        // Read file and parse entry
-        FILE* f = fopen(filepath, "r");
-        if (!f) continue;
-
-        // Resize entries array if needed
         if (count >= capacity) {
             capacity = capacity ? capacity * 2 : 16;
             memory_entry_t* new_entries = realloc(entries, capacity * sizeof(memory_entry_t));
             if (!new_entries) {
-                closedir(dir);
-                memory_entry_array_free(entries, count);
-                return ERR_OUT_OF_MEMORY;
+                free(text);
+                err = ERR_OUT_OF_MEMORY;
+                break;
             }
             entries = new_entries;
         }
 
-        // Simple parsing - in reality would need proper YAML frontmatter parsing
-        // For now, just create a minimal entry
-        memory_entry_t* mem_entry = &entries[count];
+        err = parse_entry(text, len, file->path, file->category, &entries[count]);
+        free(text);
+        if (err != ERR_OK) break;
 
-        // Extract key from filename (remove .md extension)
-        char* key = strndup(entry->d_name, name_len - 3);
-        if (key) {
-            // TODO: decode safe_key back to original key
-            mem_entry->key.data = key;
-            mem_entry->key.len = strlen(key);
-        } else {
-            mem_entry->key = STR_NULL;
-        }
+        entries[count].score = (double)hits;
+        count++;
+    }
 
-        // TODO: Parse actual content from file
-        mem_entry->content = STR_LIT("[Content would be parsed from file]");
-        mem_entry->id = STR_LIT("markdown-entry");
-        mem_entry->category = MEMORY_CATEGORY_CUSTOM; // Would parse from frontmatter
-        mem_entry->timestamp = STR_LIT("2025-01-01 00:00:00");
-        mem_entry->session_id = STR_NULL;
-        mem_entry->score = 1.0;
+    pthread_mutex_unlock(&md_mem->lock);
+    free(candidates);
 
-        fclose(f);
-        count++;
+    if (err != ERR_OK) {
+        memory_entry_array_free(entries, count);
+        return err;
     }
 
-    closedir(dir);
+    qsort(entries, count, sizeof(memory_entry_t), compare_score_desc);
+    while (count > limit) {
+        count--;
+        free((void*)entries[count].id.data);
+        free((void*)entries[count].key.data);
+        free((void*)entries[count].content.data);
+        free((void*)entries[count].timestamp.data);
+        free((void*)entries[count].session_id.data);
+    }
+
+    if (count == 0) {
+        free(entries);
+        return ERR_NOT_FOUND;
+    }
 
     *out_entries = entries;
     *out_count = count;
     return ERR_OK;
 }
 
-static err_t markdown_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
-                            memory_entry_t** out_entries, uint32_t* out_count) {
-    if (!memory || !memory->impl_data || !memory->initialized || !query || !out_entries || !out_count) {
+static err_t markdown_forget(memory_t* memory, const str_t* key) {
+    if (!memory || !memory->impl_data || !memory->initialized || !key) {
         return ERR_INVALID_ARGUMENT;
     }
 
     markdown_memory_t* md_mem = (markdown_memory_t*)memory->impl_data;
 
-    // Convert query to C string for searching
-    char* query_cstr = malloc(query->len + 1);
-    if (!query_cstr) return ERR_OUT_OF_MEMORY;
-
-    memcpy(query_cstr, query->data, query->len);
-    query_cstr[query->len] = '\0';
-
-    uint32_t limit = opts ? opts->limit : 10;
-
-    // Search through all category directories
-    const char* categories[] = {"core", "daily", "conversation", "custom"};
-    err_t result = ERR_NOT_FOUND;
-    memory_entry_t* all_entries = NULL;
-    uint32_t total_count = 0;
-
-    for (int i = 0; i < 4; i++) {
-        char dirpath[512];
-        snprintf(dirpath, sizeof(dirpath), "%s/%s", md_mem->base_dir, categories[i]);
-
-        memory_entry_t* category_entries = NULL;
-        uint32_t category_count = 0;
-
-        err_t scan_result = scan_directory(dirpath, query_cstr, &category_entries, &category_count,
-                                          limit - total_count);
-
-        if (scan_result == ERR_OK && category_count > 0) {
-            // Merge results
-            memory_entry_t* new_all = realloc(all_entries, (total_count + category_count) * sizeof(memory_entry_t));
-            if (!new_all) {
-                memory_entry_array_free(category_entries, category_count);
-                free(query_cstr);
-                return ERR_OUT_OF_MEMORY;
-            }
-
-            all_entries = new_all;
-            memcpy(all_entries + total_count, category_entries, category_count * sizeof(memory_entry_t));
-            total_count += category_count;
-            free(category_entries);
-
-            result = ERR_OK;
-
-            if (total_count >= limit) {
-                break;
-            }
-        } else if (category_entries) {
-            free(category_entries);
+    // The key maps to one file name per category directory
+    bool removed = false;
+    pthread_mutex_lock(&md_mem->lock);
+    for (int i = 0; i < MD_INDEX_DIRS; i++) {
+        memory_entry_t probe = { .key = *key, .category = (memory_category_t)i };
+        char* filepath = get_entry_filepath(md_mem, &probe);
+        if (!filepath) {
+            pthread_mutex_unlock(&md_mem->lock);
+            return ERR_OUT_OF_MEMORY;
         }
-    }
-
-    free(query_cstr);
 
-    if (result == ERR_OK) {
-        *out_entries = all_entries;
-        *out_count = total_count;
-    } else {
-        *out_entries = NULL;
-        *out_count = 0;
+        int64_t before = dir_mtime_ns(md_mem, (uint32_t)i);
+        if (unlink(filepath) == 0) {
+            md_index_remove_file(&md_mem->index, relative_path(md_mem, filepath));
+            absorb_own_change(md_mem, (uint32_t)i, before);
+            removed = true;
+        }
+        free(filepath);
     }
+    pthread_mutex_unlock(&md_mem->lock);
 
-    return result;
-}
-
-static err_t markdown_forget(memory_t* memory, const str_t* key) {
-    // Markdown backend doesn't efficiently support deletion by key
-    (void)memory;
-    (void)key;
-    return ERR_NOT_IMPLEMENTED;
+    return removed ? ERR_OK : ERR_NOT_FOUND;
 }
 
 static err_t markdown_forget_by_id(memory_t* memory, const str_t* id) {
@@ -504,33 +814,23 @@ static err_t markdown_get_stats(memory_t* memory, uint32_t* total_entries, uint3
 
     markdown_memory_t* md_mem = (markdown_memory_t*)memory->impl_data;
 
-    // Count files in each category directory
-    uint32_t total = 0;
-    const char* categories[] = {"core", "daily", "conversation", "custom"};
+    // Count live files in the manifest
+    pthread_mutex_lock(&md_mem->lock);
+    err_t err = revalidate(md_mem, false);
 
-    for (int i = 0; i < 4; i++) {
-        char dirpath[512];
-        snprintf(dirpath, sizeof(dirpath), "%s/%s", md_mem->base_dir, categories[i]);
-
-        DIR* dir = opendir(dirpath);
-        if (dir) {
-            uint32_t count = 0;
-            struct dirent* entry;
-            while ((entry = readdir(dir)) != NULL) {
-                if (entry->d_type == DT_REG) {
-                    size_t name_len = strlen(entry->d_name);
-                    if (name_len >= 4 && strcmp(entry->d_name + name_len - 3, ".md") == 0) {
-                        count++;
-                    }
-                }
-            }
-            closedir(dir);
+    uint32_t counts[MD_INDEX_DIRS] = {0};
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < md_mem->index.file_count; i++) {
+        const md_index_file_t* file = &md_mem->index.files[i];
+        if (!file->live || file->category >= MD_INDEX_DIRS) continue;
+        counts[file->category]++;
+        total++;
+    }
+    pthread_mutex_unlock(&md_mem->lock);
 
-            total += count;
-            if (by_category_counts) {
-                by_category_counts[i] = count;
-            }
-        }
+    if (err != ERR_OK) return err;
+    if (by_category_counts) {
+        memcpy(by_category_counts, counts, sizeof(counts));
     }
 
     *total_entries = total;
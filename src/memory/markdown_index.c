@@ -0,0 +1,509 @@
+// markdown_index.c - Inverted term index for the markdown memory backend
+// SPDX-License-Identifier: MIT
+
+#include "memory/markdown_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MD_INDEX_MAGIC "CCMI"
+#define MD_INDEX_VERSION 1u
+
+// ============================================================================
+// Hashing
+// ============================================================================
+
+static uint32_t hash_bytes(const char* data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+typedef const char* (*slot_key_fn)(const md_index_t* index, uint32_t id);
+
+static const char* term_key(const md_index_t* index, uint32_t id) { return index->terms[id].text; }
+static const char* path_key(const md_index_t* index, uint32_t id) { return index->files[id].path; }
+
+// Double a slot table and reinsert every key
+static bool slots_rehash(const md_index_t* index, uint32_t** slots, uint32_t* slot_count,
+                         uint32_t entries, slot_key_fn key) {
+    uint32_t new_count = *slot_count ? *slot_count * 2 : 256;
+    uint32_t* new_slots = calloc(new_count, sizeof(uint32_t));
+    if (!new_slots) return false;
+
+    for (uint32_t id = 0; id < entries; id++) {
+        const char* k = key(index, id);
+        uint32_t slot = hash_bytes(k, strlen(k)) & (new_count - 1);
+        while (new_slots[slot]) slot = (slot + 1) & (new_count - 1);
+        new_slots[slot] = id + 1;
+    }
+
+    free(*slots);
+    *slots = new_slots;
+    *slot_count = new_count;
+    return true;
+}
+
+// Returns the id stored for key, or MD_INDEX_NONE with *out_slot set to the free slot
+static uint32_t slots_find(const md_index_t* index, const uint32_t* slots, uint32_t slot_count,
+                           slot_key_fn key, const char* k, size_t len, uint32_t* out_slot) {
+    if (slot_count == 0) return MD_INDEX_NONE;
+
+    uint32_t slot = hash_bytes(k, len) & (slot_count - 1);
+    while (slots[slot]) {
+        const char* existing = key(index, slots[slot] - 1);
+        if (strncmp(existing, k, len) == 0 && existing[len] == '\0') return slots[slot] - 1;
+        slot = (slot + 1) & (slot_count - 1);
+    }
+    if (out_slot) *out_slot = slot;
+    return MD_INDEX_NONE;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+void md_index_init(md_index_t* index) {
+    memset(index, 0, sizeof(md_index_t));
+}
+
+void md_index_free(md_index_t* index) {
+    if (!index) return;
+
+    for (uint32_t i = 0; i < index->file_count; i++) {
+        free(index->files[i].path);
+        free(index->files[i].terms);
+    }
+    for (uint32_t i = 0; i < index->term_count; i++) {
+        free(index->terms[i].text);
+        free(index->terms[i].files);
+    }
+    free(index->files);
+    free(index->terms);
+    free(index->term_slots);
+    free(index->path_slots);
+    md_index_init(index);
+}
+
+// ============================================================================
+// Terms
+// ============================================================================
+
+size_t md_index_next_term(const char* text, size_t len, size_t* pos, char out[MD_INDEX_MAX_TERM + 1]) {
+    size_t i = *pos;
+
+    // Terms are runs of ASCII letters/digits and any non-ASCII (UTF-8) bytes
+    while (i < len) {
+        unsigned char c = (unsigned char)text[i];
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80) break;
+        i++;
+    }
+
+    size_t n = 0;
+    while (i < len) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = (unsigned char)(c - 'A' + 'a');
+        } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80)) {
+            break;
+        }
+        if (n < MD_INDEX_MAX_TERM) out[n++] = (char)c;
+        i++;
+    }
+    out[n] = '\0';
+
+    *pos = i;
+    return n;
+}
+
+static uint32_t term_intern(md_index_t* index, const char* text, size_t len) {
+    uint32_t slot = 0;
+    uint32_t id = slots_find(index, index->term_slots, index->term_slot_count, term_key, text, len, &slot);
+    if (id != MD_INDEX_NONE) return id;
+
+    if ((index->term_count + 1) * 10 >= index->term_slot_count * 7) {
+        if (!slots_rehash(index, &index->term_slots, &index->term_slot_count, index->term_count, term_key)) {
+            return MD_INDEX_NONE;
+        }
+        slots_find(index, index->term_slots, index->term_slot_count, term_key, text, len, &slot);
+    }
+
+    if (index->term_count == index->term_capacity) {
+        uint32_t new_capacity = index->term_capacity ? index->term_capacity * 2 : 256;
+        md_index_term_t* terms = realloc(index->terms, new_capacity * sizeof(md_index_term_t));
+        if (!terms) return MD_INDEX_NONE;
+        index->terms = terms;
+        index->term_capacity = new_capacity;
+    }
+
+    char* copy = malloc(len + 1);
+    if (!copy) return MD_INDEX_NONE;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+
+    id = index->term_count++;
+    index->terms[id] = (md_index_term_t){ .text = copy };
+    index->term_slots[slot] = id + 1;
+    return id;
+}
+
+static bool posting_add(md_index_term_t* term, uint32_t file) {
+    if (term->count == term->capacity) {
+        uint32_t new_capacity = term->capacity ? term->capacity * 2 : 4;
+        uint32_t* files = realloc(term->files, new_capacity * sizeof(uint32_t));
+        if (!files) return false;
+        term->files = files;
+        term->capacity = new_capacity;
+    }
+    term->files[term->count++] = file;
+    return true;
+}
+
+static void posting_remove(md_index_term_t* term, uint32_t file) {
+    for (uint32_t i = 0; i < term->count; i++) {
+        if (term->files[i] == file) {
+            term->files[i] = term->files[--term->count];
+            return;
+        }
+    }
+}
+
+// ============================================================================
+// Files
+// ============================================================================
+
+uint32_t md_index_find_file(const md_index_t* index, const char* path) {
+    return slots_find(index, index->path_slots, index->path_slot_count, path_key, path, strlen(path), NULL);
+}
+
+static uint32_t file_intern(md_index_t* index, const char* path) {
+    size_t len = strlen(path);
+    uint32_t slot = 0;
+    uint32_t id = slots_find(index, index->path_slots, index->path_slot_count, path_key, path, len, &slot);
+    if (id != MD_INDEX_NONE) return id;
+
+    if ((index->file_count + 1) * 10 >= index->path_slot_count * 7) {
+        if (!slots_rehash(index, &index->path_slots, &index->path_slot_count, index->file_count, path_key)) {
+            return MD_INDEX_NONE;
+        }
+        slots_find(index, index->path_slots, index->path_slot_count, path_key, path, len, &slot);
+    }
+
+    if (index->file_count == index->file_capacity) {
+        uint32_t new_capacity = index->file_capacity ? index->file_capacity * 2 : 64;
+        md_index_file_t* files = realloc(index->files, new_capacity * sizeof(md_index_file_t));
+        if (!files) return MD_INDEX_NONE;
+        index->files = files;
+        index->file_capacity = new_capacity;
+    }
+
+    char* copy = strdup(path);
+    if (!copy) return MD_INDEX_NONE;
+
+    id = index->file_count++;
+    index->files[id] = (md_index_file_t){ .path = copy };
+    index->path_slots[slot] = id + 1;
+    return id;
+}
+
+static void file_clear_terms(md_index_t* index, uint32_t id) {
+    md_index_file_t* file = &index->files[id];
+    for (uint32_t i = 0; i < file->term_count; i++) {
+        posting_remove(&index->terms[file->terms[i]], id);
+    }
+    free(file->terms);
+    file->terms = NULL;
+    file->term_count = 0;
+}
+
+// Attach already-interned terms to a file (ids must be distinct)
+static err_t file_set_terms(md_index_t* index, uint32_t id, uint32_t* terms, uint32_t count) {
+    md_index_file_t* file = &index->files[id];
+    for (uint32_t i = 0; i < count; i++) {
+        if (!posting_add(&index->terms[terms[i]], id)) {
+            file->terms = terms;
+            file->term_count = i;
+            return ERR_OUT_OF_MEMORY;
+        }
+    }
+    file->terms = terms;
+    file->term_count = count;
+    return ERR_OK;
+}
+
+err_t md_index_update_file(md_index_t* index, const char* path, uint32_t category,
+                           int64_t mtime_ns, int64_t size, const char* text, size_t len) {
+    if (!index || !path) return ERR_INVALID_ARGUMENT;
+
+    uint32_t id = file_intern(index, path);
+    if (id == MD_INDEX_NONE) return ERR_OUT_OF_MEMORY;
+    file_clear_terms(index, id);
+
+    // Distinct terms of the file; a term's last posting is this file once added
+    uint32_t* terms = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    char term[MD_INDEX_MAX_TERM + 1];
+    size_t pos = 0;
+    size_t term_len;
+    err_t err = ERR_OK;
+
+    while ((term_len = md_index_next_term(text, len, &pos, term)) > 0) {
+        uint32_t term_id = term_intern(index, term, term_len);
+        if (term_id == MD_INDEX_NONE) {
+            err = ERR_OUT_OF_MEMORY;
+            break;
+        }
+
+        md_index_term_t* t = &index->terms[term_id];
+        if (t->count > 0 && t->files[t->count - 1] == id) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint32_t* grown = realloc(terms, capacity * sizeof(uint32_t));
+            if (!grown) {
+                err = ERR_OUT_OF_MEMORY;
+                break;
+            }
+            terms = grown;
+        }
+        if (!posting_add(t, id)) {
+            err = ERR_OUT_OF_MEMORY;
+            break;
+        }
+        terms[count++] = term_id;
+    }
+
+    md_index_file_t* file = &index->files[id];
+    file->terms = terms;
+    file->term_count = count;
+    file->category = category;
+    file->mtime_ns = mtime_ns;
+    file->size = size;
+    file->live = true;
+    index->dirty = true;
+
+    return err;
+}
+
+void md_index_remove_file(md_index_t* index, const char* path) {
+    uint32_t id = md_index_find_file(index, path);
+    if (id == MD_INDEX_NONE || !index->files[id].live) return;
+
+    file_clear_terms(index, id);
+    index->files[id].live = false;
+    index->dirty = true;
+}
+
+// ============================================================================
+// Query
+// ============================================================================
+
+err_t md_index_query(const md_index_t* index, str_t query, uint32_t** out_files, uint32_t* out_count) {
+    *out_files = NULL;
+    *out_count = 0;
+
+    // Distinct query terms; any unknown term means no file can match
+    uint32_t wanted[32];
+    uint32_t wanted_count = 0;
+    char term[MD_INDEX_MAX_TERM + 1];
+    size_t pos = 0;
+    size_t term_len;
+
+    while ((term_len = md_index_next_term(query.data, query.len, &pos, term)) > 0 && wanted_count < 32) {
+        uint32_t id = slots_find(index, index->term_slots, index->term_slot_count, term_key, term, term_len, NULL);
+        if (id == MD_INDEX_NONE || index->terms[id].count == 0) return ERR_OK;
+
+        bool duplicate = false;
+        for (uint32_t i = 0; i < wanted_count; i++) duplicate |= wanted[i] == id;
+        if (!duplicate) wanted[wanted_count++] = id;
+    }
+    if (wanted_count == 0) return ERR_OK;
+
+    // Walk the shortest posting list and probe the others
+    uint32_t shortest = 0;
+    for (uint32_t i = 1; i < wanted_count; i++) {
+        if (index->terms[wanted[i]].count < index->terms[wanted[shortest]].count) shortest = i;
+    }
+
+    const md_index_term_t* base = &index->terms[wanted[shortest]];
+    uint32_t* files = malloc(base->count * sizeof(uint32_t));
+    if (!files) return ERR_OUT_OF_MEMORY;
+
+    uint32_t count = 0;
+    for (uint32_t p = 0; p < base->count; p++) {
+        uint32_t file = base->files[p];
+        bool all = true;
+        for (uint32_t i = 0; i < wanted_count && all; i++) {
+            if (i == shortest) continue;
+            const md_index_file_t* f = &index->files[file];
+            bool has = false;
+            for (uint32_t t = 0; t < f->term_count && !has; t++) has = f->terms[t] == wanted[i];
+            all = has;
+        }
+        if (all) files[count++] = file;
+    }
+
+    *out_files = files;
+    *out_count = count;
+    return ERR_OK;
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+// File layout (native endianness, rebuilt from disk if anything looks off):
+//   "CCMI" u32 version, i64 dir_mtime[MD_INDEX_DIRS]
+//   u32 term_count, term_count * (u16 len, bytes)
+//   u32 file_count, file_count * (u32 path_len, path, i64 mtime, i64 size,
+//                                 u32 category, u32 terms, terms * u32)
+
+static bool write_u32(FILE* f, uint32_t v) { return fwrite(&v, sizeof(v), 1, f) == 1; }
+static bool write_i64(FILE* f, int64_t v) { return fwrite(&v, sizeof(v), 1, f) == 1; }
+static bool read_u32(FILE* f, uint32_t* v) { return fread(v, sizeof(*v), 1, f) == 1; }
+static bool read_i64(FILE* f, int64_t* v) { return fread(v, sizeof(*v), 1, f) == 1; }
+
+err_t md_index_save(md_index_t* index, const char* path) {
+    if (!index || !path) return ERR_INVALID_ARGUMENT;
+
+    // Only terms still referenced are written; remap their ids densely
+    uint32_t* remap = malloc((index->term_count + 1) * sizeof(uint32_t));
+    if (!remap) return ERR_OUT_OF_MEMORY;
+
+    uint32_t live_terms = 0;
+    for (uint32_t i = 0; i < index->term_count; i++) {
+        remap[i] = index->terms[i].count > 0 ? live_terms++ : MD_INDEX_NONE;
+    }
+    uint32_t live_files = 0;
+    for (uint32_t i = 0; i < index->file_count; i++) {
+        if (index->files[i].live) live_files++;
+    }
+
+    size_t tmp_len = strlen(path) + 5;
+    char* tmp = malloc(tmp_len);
+    if (!tmp) {
+        free(remap);
+        return ERR_OUT_OF_MEMORY;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        free(tmp);
+        free(remap);
+        return ERR_IO;
+    }
+
+    bool ok = fwrite(MD_INDEX_MAGIC, 4, 1, f) == 1 && write_u32(f, MD_INDEX_VERSION);
+    for (uint32_t d = 0; d < MD_INDEX_DIRS && ok; d++) ok = write_i64(f, index->dir_mtime_ns[d]);
+
+    ok = ok && write_u32(f, live_terms);
+    for (uint32_t i = 0; i < index->term_count && ok; i++) {
+        if (remap[i] == MD_INDEX_NONE) continue;
+        uint16_t len = (uint16_t)strlen(index->terms[i].text);
+        ok = fwrite(&len, sizeof(len), 1, f) == 1 && fwrite(index->terms[i].text, len, 1, f) == 1;
+    }
+
+    ok = ok && write_u32(f, live_files);
+    for (uint32_t i = 0; i < index->file_count && ok; i++) {
+        const md_index_file_t* file = &index->files[i];
+        if (!file->live) continue;
+
+        uint32_t path_len = (uint32_t)strlen(file->path);
+        ok = write_u32(f, path_len) && fwrite(file->path, path_len, 1, f) == 1 &&
+             write_i64(f, file->mtime_ns) && write_i64(f, file->size) &&
+             write_u32(f, file->category) && write_u32(f, file->term_count);
+        for (uint32_t t = 0; t < file->term_count && ok; t++) {
+            ok = write_u32(f, remap[file->terms[t]]);
+        }
+    }
+
+    ok = fclose(f) == 0 && ok;
+    if (ok && rename(tmp, path) != 0) ok = false;
+    if (!ok) remove(tmp);
+
+    free(tmp);
+    free(remap);
+
+    if (!ok) return ERR_IO;
+    index->dirty = false;
+    return ERR_OK;
+}
+
+err_t md_index_load(md_index_t* index, const char* path) {
+    if (!index || !path) return ERR_INVALID_ARGUMENT;
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return ERR_NOT_FOUND;
+
+    md_index_t loaded;
+    md_index_init(&loaded);
+
+    char magic[4];
+    uint32_t version = 0;
+    bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, MD_INDEX_MAGIC, 4) == 0 &&
+              read_u32(f, &version) && version == MD_INDEX_VERSION;
+    for (uint32_t d = 0; d < MD_INDEX_DIRS && ok; d++) ok = read_i64(f, &loaded.dir_mtime_ns[d]);
+
+    uint32_t term_count = 0;
+    ok = ok && read_u32(f, &term_count);
+    for (uint32_t i = 0; i < term_count && ok; i++) {
+        uint16_t len = 0;
+        char term[MD_INDEX_MAX_TERM + 1];
+        ok = fread(&len, sizeof(len), 1, f) == 1 && len > 0 && len <= MD_INDEX_MAX_TERM &&
+             fread(term, len, 1, f) == 1;
+        ok = ok && term_intern(&loaded, term, len) == i;
+    }
+
+    uint32_t file_count = 0;
+    ok = ok && read_u32(f, &file_count);
+    for (uint32_t i = 0; i < file_count && ok; i++) {
+        uint32_t path_len = 0;
+        ok = read_u32(f, &path_len) && path_len > 0 && path_len < 4096;
+        if (!ok) break;
+
+        char* file_path = malloc(path_len + 1);
+        ok = file_path && fread(file_path, path_len, 1, f) == 1;
+        if (ok) file_path[path_len] = '\0';
+
+        uint32_t id = ok ? file_intern(&loaded, file_path) : MD_INDEX_NONE;
+        free(file_path);
+        ok = id != MD_INDEX_NONE && !loaded.files[id].live;
+        if (!ok) break;
+
+        md_index_file_t* file = &loaded.files[id];
+        uint32_t terms_len = 0;
+        ok = read_i64(f, &file->mtime_ns) && read_i64(f, &file->size) &&
+             read_u32(f, &file->category) && read_u32(f, &terms_len) && terms_len <= term_count;
+        if (!ok) break;
+
+        uint32_t* terms = terms_len ? malloc(terms_len * sizeof(uint32_t)) : NULL;
+        ok = !terms_len || terms;
+        for (uint32_t t = 0; t < terms_len && ok; t++) {
+            ok = read_u32(f, &terms[t]) && terms[t] < term_count;
+        }
+        if (!ok) {
+            free(terms);
+            break;
+        }
+
+        ok = file_set_terms(&loaded, id, terms, terms_len) == ERR_OK;
+        file->live = true;
+    }
+
+    fclose(f);
+
+    if (!ok) {
+        md_index_free(&loaded);
+        return ERR_FAILED;
+    }
+
+    md_index_free(index);
+    *index = loaded;
+    return ERR_OK;
+}
@@ -0,0 +1,536 @@
+// shard.c - Memory spread over several backend instances
+// SPDX-License-Identifier: MIT
+
+#include "memory/shard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define SHARD_CATEGORY_COUNT (MEMORY_CATEGORY_CUSTOM + 1)
+
+typedef struct memory_shard_set_t {
+    memory_t** shards;
+    char** dirs;               // data_dir of each shard, NULL for in-memory ones
+    uint32_t count;
+    bool by_category;
+} memory_shard_set_t;
+
+static const memory_vtable_t shard_vtable;
+
+static uint32_t shard_hash(str_t s) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < s.len; i++) h = (h ^ (uint8_t)s.data[i]) * 16777619u;
+    return h;
+}
+
+static uint32_t shard_route(const memory_shard_set_t* set, const memory_entry_t* entry) {
+    if (set->by_category) return (uint32_t)entry->category % set->count;
+    return shard_hash(entry->key) % set->count;
+}
+
+// The one shard a key can live on; NULL when routing by category
+static memory_t* shard_for_key(const memory_shard_set_t* set, const str_t* key) {
+    return set->by_category ? NULL : set->shards[shard_hash(*key) % set->count];
+}
+
+// Frees what recall filled in, not the entry itself
+static void entry_release(memory_entry_t* entry) {
+    free((void*)entry->id.data);
+    free((void*)entry->key.data);
+    free((void*)entry->content.data);
+    free((void*)entry->timestamp.data);
+    free((void*)entry->session_id.data);
+    *entry = (memory_entry_t){0};
+}
+
+// Timestamps are "%Y-%m-%d %H:%M:%S", so byte order is time order
+static bool newer_than(const memory_entry_t* a, const memory_entry_t* b) {
+    uint32_t len = a->timestamp.len < b->timestamp.len ? a->timestamp.len : b->timestamp.len;
+    int cmp = len ? memcmp(a->timestamp.data, b->timestamp.data, len) : 0;
+    return cmp > 0 || (cmp == 0 && a->timestamp.len > b->timestamp.len);
+}
+
+// Folds one shard's outcome into a fan-out's: any success wins, then a
+// real error over ERR_NOT_FOUND
+static err_t fold_result(err_t acc, err_t err) {
+    if (acc == ERR_OK || err == ERR_OK) return ERR_OK;
+    if (err == ERR_NOT_FOUND) return acc;
+    return acc == ERR_NOT_FOUND ? err : acc;
+}
+
+// ============================================================================
+// Search Fan-out
+// ============================================================================
+
+typedef struct shard_search_t {
+    memory_t* shard;
+    const str_t* query;
+    const memory_search_opts_t* opts;
+    memory_entry_t* entries;
+    uint32_t count;
+    err_t err;
+    pthread_t thread;
+    bool threaded;
+} shard_search_t;
+
+static void* shard_search_main(void* arg) {
+    shard_search_t* search = (shard_search_t*)arg;
+    search->err = memory_search(search->shard, search->query, search->opts, &search->entries, &search->count);
+    return NULL;
+}
+
+static int entry_score_cmp(const void* a, const void* b) {
+    double sa = ((const memory_entry_t*)a)->score;
+    double sb = ((const memory_entry_t*)b)->score;
+    return (sa < sb) - (sa > sb);
+}
+
+// Best hits of every shard, highest score first
+static err_t search_merge(shard_search_t* searches, uint32_t count, uint32_t limit,
+                          memory_entry_t** out_entries, uint32_t* out_count) {
+    uint32_t total = 0;
+    err_t err = ERR_NOT_FOUND;
+    for (uint32_t i = 0; i < count; i++) {
+        err = fold_result(err, searches[i].err);
+        if (searches[i].err == ERR_OK) total += searches[i].count;
+    }
+    if (err != ERR_OK) return err;
+
+    memory_entry_t* merged = total ? malloc(total * sizeof(memory_entry_t)) : NULL;
+    if (total && !merged) return ERR_OUT_OF_MEMORY;
+
+    // Entries move into the merged array; their strings go with them
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (searches[i].err != ERR_OK || !searches[i].count) continue;
+        memcpy(merged + at, searches[i].entries, searches[i].count * sizeof(memory_entry_t));
+        at += searches[i].count;
+        free(searches[i].entries);
+        searches[i].entries = NULL;
+        searches[i].count = 0;
+    }
+
+    if (total > 1) qsort(merged, total, sizeof(memory_entry_t), entry_score_cmp);
+    uint32_t kept = limit && total > limit ? limit : total;
+    if (kept < total) {
+        memory_entry_t* rest = malloc((total - kept) * sizeof(memory_entry_t));
+        if (!rest) {
+            memory_entry_array_free(merged, total);
+            return ERR_OUT_OF_MEMORY;
+        }
+        memcpy(rest, merged + kept, (total - kept) * sizeof(memory_entry_t));
+        memory_entry_array_free(rest, total - kept);
+    }
+
+    *out_entries = merged;
+    *out_count = kept;
+    return ERR_OK;
+}
+
+// ============================================================================
+// Backend
+// ============================================================================
+
+static str_t shard_get_name(void) {
+    return STR_LIT("sharded");
+}
+
+static str_t shard_get_version(void) {
+    return STR_LIT("1.0.0");
+}
+
+static err_t shard_create(const memory_config_t* config, memory_t** out_memory) {
+    (void)config;
+    (void)out_memory;
+    // Needs the backend to shard (memory_shard_create)
+    return ERR_NOT_IMPLEMENTED;
+}
+
+static void shard_destroy(memory_t* memory) {
+    if (!memory) return;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    if (set) {
+        for (uint32_t i = 0; i < set->count; i++) {
+            memory_free(set->shards[i]);
+            free(set->dirs[i]);
+        }
+        free(set->shards);
+        free(set->dirs);
+        free(set);
+    }
+    free(memory);
+}
+
+static err_t shard_init(memory_t* memory) {
+    if (!memory || !memory->impl_data) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (set->dirs[i] && mkdir(set->dirs[i], 0755) != 0 && errno != EEXIST) return ERR_IO;
+        if (!shard->initialized && shard->vtable->init) {
+            err_t err = shard->vtable->init(shard);
+            if (err != ERR_OK) return err;
+        }
+    }
+    memory->initialized = true;
+    return ERR_OK;
+}
+
+static void shard_cleanup(memory_t* memory) {
+    if (!memory || !memory->impl_data) return;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (shard->vtable->cleanup) shard->vtable->cleanup(shard);
+    }
+    memory->initialized = false;
+}
+
+static err_t shard_store(memory_t* memory, const memory_entry_t* entry) {
+    if (!memory || !entry) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    memory_t* shard = set->shards[shard_route(set, entry)];
+    if (!shard->vtable->store) return ERR_NOT_IMPLEMENTED;
+    return shard->vtable->store(shard, entry);
+}
+
+static err_t shard_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count) {
+    if (!memory || (!entries && count > 0)) return ERR_INVALID_ARGUMENT;
+    if (count == 0) return ERR_OK;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    memory_entry_t* batch = malloc(count * sizeof(memory_entry_t));
+    if (!batch) return ERR_OUT_OF_MEMORY;
+
+    // One batch per shard, keeping the caller's order within it; entries
+    // are shallow copies
+    err_t err = ERR_OK;
+    for (uint32_t s = 0; s < set->count; s++) {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (shard_route(set, &entries[i]) == s) batch[n++] = entries[i];
+        }
+        if (n == 0) continue;
+        err_t shard_err = memory_store_multiple(set->shards[s], batch, n);
+        if (shard_err != ERR_OK) err = shard_err;
+    }
+
+    free(batch);
+    return err;
+}
+
+static err_t shard_flush(memory_t* memory) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    err_t err = ERR_OK;
+    for (uint32_t i = 0; i < set->count; i++) {
+        err_t shard_err = memory_flush(set->shards[i]);
+        if (shard_err != ERR_OK) err = shard_err;
+    }
+    return err;
+}
+
+static err_t shard_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry) {
+    if (!memory || !key || !out_entry) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    memory_t* owner = shard_for_key(set, key);
+    if (owner) {
+        if (!owner->vtable->recall) return ERR_NOT_IMPLEMENTED;
+        return owner->vtable->recall(owner, key, out_entry);
+    }
+
+    // A key stored under several categories has a copy per shard; like a
+    // single backend, answer with the newest
+    err_t err = ERR_NOT_FOUND;
+    bool found = false;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->recall) return ERR_NOT_IMPLEMENTED;
+
+        memory_entry_t candidate = {0};
+        err_t shard_err = shard->vtable->recall(shard, key, &candidate);
+        err = fold_result(err, shard_err);
+        if (shard_err != ERR_OK) continue;
+        if (!found || newer_than(&candidate, out_entry)) {
+            if (found) entry_release(out_entry);
+            *out_entry = candidate;
+            found = true;
+        } else {
+            entry_release(&candidate);
+        }
+    }
+    return err;
+}
+
+static err_t shard_recall_by_id(memory_t* memory, const str_t* id, memory_entry_t* out_entry) {
+    if (!memory || !id || !out_entry) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    err_t err = ERR_NOT_FOUND;
+    for (uint32_t i = 0; i < set->count && err != ERR_OK; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->recall_by_id) return ERR_NOT_IMPLEMENTED;
+        err = fold_result(err, shard->vtable->recall_by_id(shard, id, out_entry));
+    }
+    return err;
+}
+
+static err_t shard_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                          memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!memory || !query || !opts || !out_entries || !out_count) return ERR_INVALID_ARGUMENT;
+    *out_entries = NULL;
+    *out_count = 0;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    shard_search_t* searches = calloc(set->count, sizeof(shard_search_t));
+    if (!searches) return ERR_OUT_OF_MEMORY;
+
+    // Shard 0 runs on the calling thread; a shard without a thread of its
+    // own runs there too
+    for (uint32_t i = 0; i < set->count; i++) {
+        searches[i] = (shard_search_t){ .shard = set->shards[i], .query = query, .opts = opts };
+        if (i > 0) {
+            searches[i].threaded = pthread_create(&searches[i].thread, NULL, shard_search_main, &searches[i]) == 0;
+        }
+    }
+    for (uint32_t i = 0; i < set->count; i++) {
+        if (!searches[i].threaded) shard_search_main(&searches[i]);
+    }
+    for (uint32_t i = 1; i < set->count; i++) {
+        if (searches[i].threaded) pthread_join(searches[i].thread, NULL);
+    }
+
+    err_t err = search_merge(searches, set->count, opts->limit, out_entries, out_count);
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_entry_array_free(searches[i].entries, searches[i].count);
+    }
+    free(searches);
+    return err;
+}
+
+static err_t shard_forget(memory_t* memory, const str_t* key) {
+    if (!memory || !key) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    memory_t* owner = shard_for_key(set, key);
+    if (owner) {
+        if (!owner->vtable->forget) return ERR_NOT_IMPLEMENTED;
+        return owner->vtable->forget(owner, key);
+    }
+
+    err_t err = ERR_NOT_FOUND;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->forget) return ERR_NOT_IMPLEMENTED;
+        err = fold_result(err, shard->vtable->forget(shard, key));
+    }
+    return err;
+}
+
+static err_t shard_forget_by_id(memory_t* memory, const str_t* id) {
+    if (!memory || !id) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    err_t err = ERR_NOT_FOUND;
+    for (uint32_t i = 0; i < set->count && err != ERR_OK; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->forget_by_id) return ERR_NOT_IMPLEMENTED;
+        err = fold_result(err, shard->vtable->forget_by_id(shard, id));
+    }
+    return err;
+}
+
+static err_t shard_forget_old(memory_t* memory, uint64_t cutoff_timestamp) {
+    if (!memory) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    err_t err = ERR_OK;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->forget_old) return ERR_NOT_IMPLEMENTED;
+        err_t shard_err = shard->vtable->forget_old(shard, cutoff_timestamp);
+        if (shard_err != ERR_OK) err = shard_err;
+    }
+    return err;
+}
+
+static err_t shard_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result) {
+    if (!memory || !opts || !out_result) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    memset(out_result, 0, sizeof(*out_result));
+    out_result->complete = true;
+
+    // max_batches applies to each shard
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_sweep_result_t result = {0};
+        err_t err = memory_sweep(set->shards[i], opts, &result);
+        out_result->archived += result.archived;
+        out_result->purged += result.purged;
+        out_result->expired += result.expired;
+        out_result->batches += result.batches;
+        out_result->complete = out_result->complete && result.complete;
+        if (err != ERR_OK) {
+            out_result->complete = false;
+            return err;
+        }
+    }
+    return ERR_OK;
+}
+
+static err_t shard_get_stats(memory_t* memory, uint32_t* total_entries, uint32_t* by_category_counts) {
+    if (!memory || !total_entries) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    *total_entries = 0;
+    if (by_category_counts) memset(by_category_counts, 0, SHARD_CATEGORY_COUNT * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->get_stats) return ERR_NOT_IMPLEMENTED;
+
+        uint32_t total = 0;
+        uint32_t counts[SHARD_CATEGORY_COUNT] = {0};
+        err_t err = shard->vtable->get_stats(shard, &total, counts);
+        if (err != ERR_OK) return err;
+        *total_entries += total;
+        for (uint32_t c = 0; by_category_counts && c < SHARD_CATEGORY_COUNT; c++) {
+            by_category_counts[c] += counts[c];
+        }
+    }
+    return ERR_OK;
+}
+
+// backup_path.NN for shard NN
+static str_t shard_path(const str_t* path, uint32_t index, char* buf, size_t cap) {
+    int len = snprintf(buf, cap, "%.*s.%02u", (int)path->len, path->data, index);
+    return len > 0 && (size_t)len < cap ? (str_t){ .data = buf, .len = (uint32_t)len } : STR_NULL;
+}
+
+static err_t shard_backup(memory_t* memory, const str_t* backup_path) {
+    if (!memory || !backup_path || str_empty(*backup_path)) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->backup) return ERR_NOT_IMPLEMENTED;
+
+        char buf[4096];
+        str_t path = shard_path(backup_path, i, buf, sizeof(buf));
+        if (str_empty(path)) return ERR_INVALID_ARGUMENT;
+        err_t err = shard->vtable->backup(shard, &path);
+        if (err != ERR_OK) return err;
+    }
+    return ERR_OK;
+}
+
+static err_t shard_restore(memory_t* memory, const str_t* backup_path) {
+    if (!memory || !backup_path || str_empty(*backup_path)) return ERR_INVALID_ARGUMENT;
+
+    memory_shard_set_t* set = (memory_shard_set_t*)memory->impl_data;
+    for (uint32_t i = 0; i < set->count; i++) {
+        memory_t* shard = set->shards[i];
+        if (!shard->vtable->restore) return ERR_NOT_IMPLEMENTED;
+
+        char buf[4096];
+        str_t path = shard_path(backup_path, i, buf, sizeof(buf));
+        if (str_empty(path)) return ERR_INVALID_ARGUMENT;
+        err_t err = shard->vtable->restore(shard, &path);
+        if (err != ERR_OK) return err;
+    }
+    return ERR_OK;
+}
+
+static const memory_vtable_t shard_vtable = {
+    .get_name = shard_get_name,
+    .get_version = shard_get_version,
+    .create = shard_create,
+    .destroy = shard_destroy,
+    .init = shard_init,
+    .cleanup = shard_cleanup,
+    .store = shard_store,
+    .store_multiple = shard_store_multiple,
+    .flush = shard_flush,
+    .recall = shard_recall,
+    .recall_by_id = shard_recall_by_id,
+    .search = shard_search,
+    .forget = shard_forget,
+    .forget_by_id = shard_forget_by_id,
+    .forget_old = shard_forget_old,
+    .sweep = shard_sweep,
+    .get_stats = shard_get_stats,
+    .backup = shard_backup,
+    .restore = shard_restore
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+err_t memory_shard_create(const char* backend, const memory_config_t* config, memory_t** out_memory) {
+    if (!backend || !config || !out_memory) return ERR_INVALID_ARGUMENT;
+    if (config->shards < 2 || config->shards > MEMORY_SHARD_MAX) return ERR_INVALID_ARGUMENT;
+
+    memory_t* memory = memory_alloc(&shard_vtable);
+    memory_shard_set_t* set = calloc(1, sizeof(memory_shard_set_t));
+    if (!memory || !set) {
+        free(memory);
+        free(set);
+        return ERR_OUT_OF_MEMORY;
+    }
+    memory->impl_data = set;
+    memory->config = *config;
+    set->by_category = config->shard_by_category;
+
+    set->shards = calloc(config->shards, sizeof(memory_t*));
+    set->dirs = calloc(config->shards, sizeof(char*));
+    if (!set->shards || !set->dirs) {
+        shard_destroy(memory);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < config->shards; i++) {
+        memory_config_t shard_config = *config;
+        shard_config.shards = 0;
+        if (!str_empty(config->data_dir)) {
+            size_t len = config->data_dir.len + 16;
+            set->dirs[i] = malloc(len);
+            if (!set->dirs[i]) {
+                shard_destroy(memory);
+                return ERR_OUT_OF_MEMORY;
+            }
+            snprintf(set->dirs[i], len, "%.*s/shard-%02u", (int)config->data_dir.len, config->data_dir.data, i);
+            shard_config.data_dir = STR_VIEW(set->dirs[i]);
+        }
+
+        err_t err = memory_create(backend, &shard_config, &set->shards[i]);
+        if (err != ERR_OK) {
+            free(set->dirs[i]);
+            shard_destroy(memory);
+            return err;
+        }
+        set->count++;
+    }
+
+    *out_memory = memory;
+    return ERR_OK;
+}
+
+bool memory_is_sharded(const memory_t* memory) {
+    return memory && memory->vtable == &shard_vtable;
+}
+
+uint32_t memory_shard_of(const memory_t* memory, const memory_entry_t* entry) {
+    if (!memory_is_sharded(memory) || !entry) return 0;
+    return shard_route((const memory_shard_set_t*)memory->impl_data, entry);
+}
@@ -2,26 +2,124 @@
 // SPDX-License-Identifier: MIT
 
 #include "core/memory.h"
+#include "memory/vector.h"
+#include "memory/compress.h"
 #include <sqlite3.h>
+#include <pthread.h>
+#include <errno.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-// SQLite memory instance data
-typedef struct sqlite_memory_t {
+// Read-only connections next to the writer (file databases only; an
+// in-memory database has just the writer)
+#define SQLITE_READER_COUNT 4
+
+// Categories with a cached row count
+#define SQLITE_CATEGORY_COUNT (MEMORY_CATEGORY_CUSTOM + 1)
+
+// Free pages handed back per incremental vacuum step
+#define SQLITE_SWEEP_VACUUM_PAGES 256
+
+// A category gets its compression dictionary once it holds this many rows,
+// trained on up to SQLITE_DICT_SAMPLE_ROWS of the newest ones
+#define SQLITE_DICT_TRAIN_ROWS 32
+#define SQLITE_DICT_SAMPLE_ROWS 256
+
+// memories.codec values
+#define SQLITE_CODEC_PLAIN 0
+#define SQLITE_CODEC_ZLIB_DICT 1
+
+// A connection and the statements prepared on it. Readers prepare only the
+// lookups; the write statements stay NULL there.
+typedef struct sqlite_conn_t {
     sqlite3* db;
-    sqlite3_stmt* stmt_insert;
     sqlite3_stmt* stmt_select_by_key;
     sqlite3_stmt* stmt_select_by_id;
     sqlite3_stmt* stmt_search;
+    sqlite3_stmt* stmt_search_snippet;
+    sqlite3_stmt* stmt_select_filtered;
+    sqlite3_stmt* stmt_load_vectors;
+
+    // Writer only
+    sqlite3_stmt* stmt_insert;
     sqlite3_stmt* stmt_delete_by_key;
     sqlite3_stmt* stmt_delete_by_id;
     sqlite3_stmt* stmt_delete_old;
-    sqlite3_stmt* stmt_count_total;
     sqlite3_stmt* stmt_count_by_category;
+    sqlite3_stmt* stmt_insert_vector;
+    sqlite3_stmt* stmt_sweep_bound;
+    sqlite3_stmt* stmt_sweep_archive;
+    sqlite3_stmt* stmt_sweep_delete;
+    sqlite3_stmt* stmt_purge_archive;
+    sqlite3_stmt* stmt_freelist_count;
+    sqlite3_stmt* stmt_insert_fts;
+    sqlite3_stmt* stmt_insert_dict;
+    sqlite3_stmt* stmt_load_dicts;
+    sqlite3_stmt* stmt_sample_content;
+} sqlite_conn_t;
+
+// SQLite memory instance data
+typedef struct sqlite_memory_t {
+    sqlite_conn_t writer;
     char* db_path;
+
+    // Serializes use of the writer between callers and the flusher
+    pthread_mutex_t db_lock;
+
+    // Lookups run on pooled readers, concurrently with each other and with
+    // the writer (WAL)
+    sqlite_conn_t readers[SQLITE_READER_COUNT];
+    uint32_t reader_count;
+    uint32_t free_readers[SQLITE_READER_COUNT];
+    uint32_t free_count;
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_cond;
+
+    // Row counts kept current by inserts and deletes, so get_stats never scans
+    uint32_t total_count;
+    uint32_t category_counts[SQLITE_CATEGORY_COUNT];
+
+    // Write-behind queue (enabled when write_behind_batch > 0)
+    bool write_behind;
+    uint32_t batch_size;
+    uint32_t interval_ms;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_cond;
+    pthread_t flusher;
+    bool flusher_running;
+    bool stopping;
+    memory_entry_t* queue;
+    uint32_t queue_count;
+    uint32_t queue_capacity;
+    uint32_t uncommitted;   // Queued or mid-commit; reads wait for these
+    err_t flush_error;      // First background commit failure, reported by flush
+
+    // Hybrid search (enabled when config.embed is set)
+    memory_embed_fn_t embed;
+    void* embed_ctx;
+    uint32_t dimensions;
+    double vector_weight;
+    double keyword_weight;
+    size_t chunk_bytes;
+    vector_index_t vectors;        // In-RAM copy of memory_vectors (vectors_lock)
+    bool vectors_stale;            // Rows were deleted; reload before the next scan
+    pthread_rwlock_t vectors_lock;
+    embedding_cache_t cache;
+    pthread_mutex_t cache_lock;
+
+    // Content compression (config.compression). Dictionaries are only ever
+    // added, so rows written with an older one keep decoding.
     bool use_compression;
+    memory_compressor_t* compressor;   // Writer only (db_lock)
+    memory_dict_t** dicts;
+    uint32_t dict_count;
+    uint32_t dict_capacity;
+    const memory_dict_t* active_dicts[SQLITE_CATEGORY_COUNT];
+    bool dict_trained[SQLITE_CATEGORY_COUNT];   // Training tried since open
+    pthread_mutex_t dict_lock;
 } sqlite_memory_t;
 
 // Forward declarations for vtable
@@ -33,6 +131,7 @@ static err_t sqlite_init(memory_t* memory);
 static void sqlite_cleanup(memory_t* memory);
 static err_t sqlite_store(memory_t* memory, const memory_entry_t* entry);
 static err_t sqlite_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count);
+static err_t sqlite_flush(memory_t* memory);
 static err_t sqlite_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry);
 static err_t sqlite_recall_by_id(memory_t* memory, const str_t* id, memory_entry_t* out_entry);
 static err_t sqlite_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
@@ -40,6 +139,7 @@ static err_t sqlite_search(memory_t* memory, const str_t* query, const memory_se
 static err_t sqlite_forget(memory_t* memory, const str_t* key);
 static err_t sqlite_forget_by_id(memory_t* memory, const str_t* id);
 static err_t sqlite_forget_old(memory_t* memory, uint64_t cutoff_timestamp);
+static err_t sqlite_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result);
 static err_t sqlite_get_stats(memory_t* memory, uint32_t* total_entries, uint32_t* by_category_counts);
 static err_t sqlite_backup(memory_t* memory, const str_t* backup_path);
 static err_t sqlite_restore(memory_t* memory, const str_t* backup_path);
@@ -53,13 +153,15 @@ static const memory_vtable_t sqlite_vtable = {
     .init = sqlite_init,
     .cleanup = sqlite_cleanup,
     .store = sqlite_store,
-    .store_multiple = NULL, // TODO: Implement batch insert
+    .store_multiple = sqlite_store_multiple,
+    .flush = sqlite_flush,
     .recall = sqlite_recall,
     .recall_by_id = sqlite_recall_by_id,
     .search = sqlite_search,
     .forget = sqlite_forget,
     .forget_by_id = sqlite_forget_by_id,
     .forget_old = sqlite_forget_old,
+    .sweep = sqlite_sweep,
     .get_stats = sqlite_get_stats,
     .backup = sqlite_backup,
     .restore = sqlite_restore
@@ -81,77 +183,956 @@ static const char* get_table_schema(void) {
            "session_id TEXT,"
            "score REAL DEFAULT 1.0,"
            "created_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now')),"
-           "updated_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now'))"
+           "updated_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now')),"
+           "codec INTEGER NOT NULL DEFAULT 0"
            ");"
            "CREATE INDEX IF NOT EXISTS idx_memories_key ON memories(key);"
            "CREATE INDEX IF NOT EXISTS idx_memories_category ON memories(category);"
            "CREATE INDEX IF NOT EXISTS idx_memories_created_at ON memories(created_at);"
+           "CREATE INDEX IF NOT EXISTS idx_memories_category_created ON memories(category, created_at);"
            "CREATE VIRTUAL TABLE IF NOT EXISTS memories_fts USING fts5(key, content, tokenize='porter');"
-           "CREATE TRIGGER IF NOT EXISTS memories_ai AFTER INSERT ON memories BEGIN "
-           "  INSERT INTO memories_fts(rowid, key, content) VALUES (new.rowid, new.key, new.content);"
-           "END;"
            "CREATE TRIGGER IF NOT EXISTS memories_ad AFTER DELETE ON memories BEGIN "
            "  DELETE FROM memories_fts WHERE rowid = old.rowid;"
-           "END;";
-}
-
-static err_t prepare_statements(sqlite_memory_t* sqlite_mem) {
-    const char* insert_sql = "INSERT INTO memories (id, key, content, category, timestamp, session_id, score) "
-                             "VALUES (?, ?, ?, ?, ?, ?, ?);";
-    const char* select_by_key_sql = "SELECT * FROM memories WHERE key = ? ORDER BY created_at DESC LIMIT 1;";
-    const char* select_by_id_sql = "SELECT * FROM memories WHERE id = ?;";
-    const char* search_sql = "SELECT * FROM memories WHERE rowid IN ("
-                             "  SELECT rowid FROM memories_fts WHERE key MATCH ? OR content MATCH ?"
-                             ") ORDER BY created_at DESC LIMIT ?;";
-    const char* delete_by_key_sql = "DELETE FROM memories WHERE key = ?;";
-    const char* delete_by_id_sql = "DELETE FROM memories WHERE id = ?;";
-    const char* delete_old_sql = "DELETE FROM memories WHERE created_at < ?;";
-    const char* count_total_sql = "SELECT COUNT(*) FROM memories;";
-    const char* count_by_category_sql = "SELECT category, COUNT(*) FROM memories GROUP BY category;";
+           "END;"
+           "CREATE TABLE IF NOT EXISTS memory_vectors ("
+           "memory_rowid INTEGER NOT NULL,"
+           "chunk INTEGER NOT NULL,"
+           "scale REAL NOT NULL,"
+           "code BLOB NOT NULL,"
+           "PRIMARY KEY (memory_rowid, chunk)"
+           ") WITHOUT ROWID;"
+           "CREATE TRIGGER IF NOT EXISTS memories_vd AFTER DELETE ON memories BEGIN "
+           "  DELETE FROM memory_vectors WHERE memory_rowid = old.rowid;"
+           "END;"
+           "CREATE TABLE IF NOT EXISTS memories_archive ("
+           "id TEXT PRIMARY KEY,"
+           "key TEXT NOT NULL,"
+           "content TEXT NOT NULL,"
+           "category INTEGER NOT NULL,"
+           "timestamp TEXT NOT NULL,"
+           "session_id TEXT,"
+           "score REAL DEFAULT 1.0,"
+           "created_at INTEGER NOT NULL,"
+           "archived_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now')),"
+           "codec INTEGER NOT NULL DEFAULT 0"
+           ");"
+           "CREATE INDEX IF NOT EXISTS idx_memories_archive_created_at ON memories_archive(created_at);"
+           "CREATE TABLE IF NOT EXISTS memory_dicts ("
+           "dict_id INTEGER NOT NULL UNIQUE,"
+           "category INTEGER NOT NULL,"
+           "dict BLOB NOT NULL"
+           ");";
+}
+
+static bool table_has_column(sqlite3* db, const char* table, const char* column) {
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_info(?1) WHERE name = ?2;", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, column, -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Bring a database created before the codec column up to date. Compressed
+// rows are indexed by the insert path with their plaintext, so the FTS
+// trigger only covers plain rows.
+static bool schema_migrate(sqlite3* db) {
+    const char* tables[] = { "memories", "memories_archive" };
+    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        if (table_has_column(db, tables[i], "codec")) continue;
+
+        char sql[128];
+        snprintf(sql, sizeof(sql), "ALTER TABLE %s ADD COLUMN codec INTEGER NOT NULL DEFAULT 0;", tables[i]);
+        if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) return false;
+    }
+
+    return sqlite3_exec(db,
+                        "DROP TRIGGER IF EXISTS memories_ai;"
+                        "CREATE TRIGGER IF NOT EXISTS memories_ai_plain AFTER INSERT ON memories "
+                        "WHEN new.codec = 0 BEGIN "
+                        "  INSERT INTO memories_fts(rowid, key, content) VALUES (new.rowid, new.key, new.content);"
+                        "END;", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+// Ranked full-text search. bm25() is negated so higher scores are better;
+// filters run against the matched rows before the limit applies.
+// ?1 match expression, ?2 category (0 = all), ?3/?4 created_at range
+// (0 = open), ?5 minimum score, ?6 limit. Snippets come from the index's
+// plaintext copy, so they never need decoding.
+#define SEARCH_SQL(content_expr, codec_expr, extra_columns) \
+    "SELECT m.id, m.key, " content_expr ", m.category, m.timestamp, m.session_id, f.score, m.rowid, " \
+    codec_expr " " \
+    "FROM (SELECT rowid, -bm25(memories_fts) AS score" extra_columns \
+    "      FROM memories_fts WHERE memories_fts MATCH ?1) AS f " \
+    "JOIN memories AS m ON m.rowid = f.rowid " \
+    "WHERE (?2 = 0 OR m.category = ?2) " \
+    "AND (?3 = 0 OR m.created_at >= ?3) " \
+    "AND (?4 = 0 OR m.created_at <= ?4) " \
+    "AND f.score >= ?5 " \
+    "ORDER BY f.score DESC LIMIT ?6;"
+
+#define SEARCH_SNIPPET_COLUMN ", snippet(memories_fts, 1, '[', ']', '...', 16) AS snippet"
+
+#define SELECT_ENTRY_COLUMNS "SELECT id, key, content, category, timestamp, session_id, score, codec FROM memories "
+static const char* SELECT_BY_KEY_SQL = SELECT_ENTRY_COLUMNS "WHERE key = ? ORDER BY created_at DESC LIMIT 1;";
+static const char* SELECT_BY_ID_SQL = SELECT_ENTRY_COLUMNS "WHERE id = ?;";
+static const char* LOAD_VECTORS_SQL = "SELECT memory_rowid, scale, code FROM memory_vectors;";
+static const char* SELECT_FILTERED_SQL = "SELECT id, key, content, category, timestamp, session_id, codec "
+                                         "FROM memories WHERE rowid = ?1 AND (?2 = 0 OR category = ?2) "
+                                         "AND (?3 = 0 OR created_at >= ?3) AND (?4 = 0 OR created_at <= ?4);";
+
+// Deletes report each removed row's category to keep the counters exact
+static const char* INSERT_SQL = "INSERT INTO memories (id, key, content, category, timestamp, session_id, score, codec) "
+                                "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+static const char* DELETE_BY_KEY_SQL = "DELETE FROM memories WHERE key = ? RETURNING category;";
+static const char* DELETE_BY_ID_SQL = "DELETE FROM memories WHERE id = ? RETURNING category;";
+static const char* DELETE_OLD_SQL = "DELETE FROM memories WHERE rowid IN "
+                                    "(SELECT rowid FROM memories WHERE created_at < ?1 ORDER BY rowid LIMIT ?2) "
+                                    "RETURNING category;";
+static const char* COUNT_BY_CATEGORY_SQL = "SELECT category, COUNT(*) FROM memories GROUP BY category;";
+static const char* INSERT_VECTOR_SQL = "INSERT OR REPLACE INTO memory_vectors (memory_rowid, chunk, scale, code) "
+                                       "VALUES (?, ?, ?, ?);";
+
+static const char* INSERT_FTS_SQL = "INSERT INTO memories_fts (rowid, key, content) VALUES (?, ?, ?);";
+static const char* INSERT_DICT_SQL = "INSERT OR IGNORE INTO memory_dicts (dict_id, category, dict) VALUES (?, ?, ?);";
+static const char* LOAD_DICTS_SQL = "SELECT dict_id, category, dict FROM memory_dicts ORDER BY rowid;";
+static const char* SAMPLE_CONTENT_SQL = "SELECT content FROM memories WHERE category = ?1 AND codec = 0 "
+                                        "ORDER BY rowid DESC LIMIT ?2;";
+
+// A sweep batch is the rowid range (?1, bound] holding the next ?4 rows of
+// category ?2 created before ?3; archive and delete then touch only that range
+static const char* SWEEP_BOUND_SQL = "SELECT MAX(rowid) FROM (SELECT rowid FROM memories "
+                                     "WHERE rowid > ?1 AND category = ?2 AND created_at < ?3 "
+                                     "ORDER BY rowid LIMIT ?4);";
+#define SWEEP_RANGE_WHERE "WHERE rowid > ?1 AND rowid <= ?2 AND category = ?3 AND created_at < ?4"
+static const char* SWEEP_ARCHIVE_SQL = "INSERT OR REPLACE INTO memories_archive "
+                                       "(id, key, content, category, timestamp, session_id, score, created_at, codec) "
+                                       "SELECT id, key, content, category, timestamp, session_id, score, created_at, codec "
+                                       "FROM memories " SWEEP_RANGE_WHERE ";";
+static const char* SWEEP_DELETE_SQL = "DELETE FROM memories " SWEEP_RANGE_WHERE " RETURNING category;";
+static const char* PURGE_ARCHIVE_SQL = "DELETE FROM memories_archive WHERE rowid IN "
+                                       "(SELECT rowid FROM memories_archive WHERE created_at < ?1 "
+                                       "ORDER BY rowid LIMIT ?2);";
+static const char* FREELIST_COUNT_SQL = "PRAGMA freelist_count;";
+
+static err_t prepare_statements(sqlite_conn_t* conn, bool writer) {
+    struct { const char* sql; sqlite3_stmt** stmt; } lookups[] = {
+        { SELECT_BY_KEY_SQL, &conn->stmt_select_by_key },
+        { SELECT_BY_ID_SQL, &conn->stmt_select_by_id },
+        { SEARCH_SQL("m.content", "m.codec", ""), &conn->stmt_search },
+        { SEARCH_SQL("f.snippet", "0", SEARCH_SNIPPET_COLUMN), &conn->stmt_search_snippet },
+        { SELECT_FILTERED_SQL, &conn->stmt_select_filtered },
+        { LOAD_VECTORS_SQL, &conn->stmt_load_vectors },
+    };
+    struct { const char* sql; sqlite3_stmt** stmt; } writes[] = {
+        { INSERT_SQL, &conn->stmt_insert },
+        { DELETE_BY_KEY_SQL, &conn->stmt_delete_by_key },
+        { DELETE_BY_ID_SQL, &conn->stmt_delete_by_id },
+        { DELETE_OLD_SQL, &conn->stmt_delete_old },
+        { COUNT_BY_CATEGORY_SQL, &conn->stmt_count_by_category },
+        { INSERT_VECTOR_SQL, &conn->stmt_insert_vector },
+        { SWEEP_BOUND_SQL, &conn->stmt_sweep_bound },
+        { SWEEP_ARCHIVE_SQL, &conn->stmt_sweep_archive },
+        { SWEEP_DELETE_SQL, &conn->stmt_sweep_delete },
+        { PURGE_ARCHIVE_SQL, &conn->stmt_purge_archive },
+        { FREELIST_COUNT_SQL, &conn->stmt_freelist_count },
+        { INSERT_FTS_SQL, &conn->stmt_insert_fts },
+        { INSERT_DICT_SQL, &conn->stmt_insert_dict },
+        { LOAD_DICTS_SQL, &conn->stmt_load_dicts },
+        { SAMPLE_CONTENT_SQL, &conn->stmt_sample_content },
+    };
+
+    for (size_t i = 0; i < sizeof(lookups) / sizeof(lookups[0]); i++) {
+        if (sqlite3_prepare_v2(conn->db, lookups[i].sql, -1, lookups[i].stmt, NULL) != SQLITE_OK) {
+            return ERR_MEMORY;
+        }
+    }
+    for (size_t i = 0; writer && i < sizeof(writes) / sizeof(writes[0]); i++) {
+        if (sqlite3_prepare_v2(conn->db, writes[i].sql, -1, writes[i].stmt, NULL) != SQLITE_OK) {
+            return ERR_MEMORY;
+        }
+    }
+    return ERR_OK;
+}
+
+// Finalizes the statements and closes the connection
+static void conn_close(sqlite_conn_t* conn) {
+    sqlite3_stmt* stmts[] = {
+        conn->stmt_select_by_key, conn->stmt_select_by_id, conn->stmt_search, conn->stmt_search_snippet,
+        conn->stmt_select_filtered, conn->stmt_load_vectors, conn->stmt_insert, conn->stmt_delete_by_key,
+        conn->stmt_delete_by_id, conn->stmt_delete_old, conn->stmt_count_by_category, conn->stmt_insert_vector,
+        conn->stmt_sweep_bound, conn->stmt_sweep_archive, conn->stmt_sweep_delete, conn->stmt_purge_archive,
+        conn->stmt_freelist_count, conn->stmt_insert_fts, conn->stmt_insert_dict, conn->stmt_load_dicts,
+        conn->stmt_sample_content,
+    };
+    for (size_t i = 0; i < sizeof(stmts) / sizeof(stmts[0]); i++) {
+        if (stmts[i]) sqlite3_finalize(stmts[i]);
+    }
+    if (conn->db) sqlite3_close(conn->db);
+    memset(conn, 0, sizeof(*conn));
+}
+
+// WAL with NORMAL sync is durable across application crashes and only
+// loses the last commits on power loss; reads go through the page cache
+// and the mapping rather than read() calls
+static const char* CONNECTION_PRAGMAS =
+    "PRAGMA synchronous=NORMAL;"
+    "PRAGMA temp_store=MEMORY;"
+    "PRAGMA cache_size=-8192;"
+    "PRAGMA mmap_size=268435456;";
+
+static err_t conn_open(sqlite_conn_t* conn, const char* path, bool writer) {
+    memset(conn, 0, sizeof(*conn));
+    int flags = writer ? SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE : SQLITE_OPEN_READONLY;
+    if (sqlite3_open_v2(path, &conn->db, flags | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        conn_close(conn);
+        return ERR_MEMORY;
+    }
+    sqlite3_busy_timeout(conn->db, 5000);
+
+    // The writer creates the schema; readers open after it. auto_vacuum
+    // only takes on a new file, before its first table.
+    bool ok = (!writer || sqlite3_exec(conn->db, "PRAGMA auto_vacuum=INCREMENTAL;", NULL, NULL, NULL) == SQLITE_OK) &&
+              (!writer || sqlite3_exec(conn->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL) == SQLITE_OK) &&
+              sqlite3_exec(conn->db, CONNECTION_PRAGMAS, NULL, NULL, NULL) == SQLITE_OK &&
+              (!writer || sqlite3_exec(conn->db, get_table_schema(), NULL, NULL, NULL) == SQLITE_OK) &&
+              (!writer || schema_migrate(conn->db));
+    if (!ok || prepare_statements(conn, writer) != ERR_OK) {
+        conn_close(conn);
+        return ERR_MEMORY;
+    }
+    return ERR_OK;
+}
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+static void count_adjust(sqlite_memory_t* sqlite_mem, int category, int delta) {
+    __atomic_add_fetch(&sqlite_mem->total_count, (uint32_t)delta, __ATOMIC_RELAXED);
+    if (category >= 0 && category < SQLITE_CATEGORY_COUNT) {
+        __atomic_add_fetch(&sqlite_mem->category_counts[category], (uint32_t)delta, __ATOMIC_RELAXED);
+    }
+}
+
+// One scan when the database is opened (db_lock held)
+static void count_load(sqlite_memory_t* sqlite_mem) {
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_count_by_category;
+    sqlite_mem->total_count = 0;
+    memset(sqlite_mem->category_counts, 0, sizeof(sqlite_mem->category_counts));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int category = sqlite3_column_int(stmt, 0);
+        uint32_t n = (uint32_t)sqlite3_column_int64(stmt, 1);
+        sqlite_mem->total_count += n;
+        if (category >= 0 && category < SQLITE_CATEGORY_COUNT) sqlite_mem->category_counts[category] += n;
+    }
+    sqlite3_reset(stmt);
+}
 
+static void vectors_mark_stale(sqlite_memory_t* sqlite_mem) {
+    pthread_rwlock_wrlock(&sqlite_mem->vectors_lock);
+    sqlite_mem->vectors_stale = true;
+    pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+}
+
+// Step a DELETE ... RETURNING category (db_lock held)
+static err_t run_delete(sqlite_memory_t* sqlite_mem, sqlite3_stmt* stmt, uint32_t* out_removed) {
+    uint32_t removed = 0;
     int rc;
-    rc = sqlite3_prepare_v2(sqlite_mem->db, insert_sql, -1, &sqlite_mem->stmt_insert, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        count_adjust(sqlite_mem, sqlite3_column_int(stmt, 0), -1);
+        removed++;
+    }
+    sqlite3_reset(stmt);
+    if (removed > 0) vectors_mark_stale(sqlite_mem);
+    if (out_removed) *out_removed = removed;
+
+    return rc == SQLITE_DONE ? ERR_OK : ERR_MEMORY;
+}
+
+// ============================================================================
+// Compression
+// ============================================================================
+
+static const memory_dict_t* dict_lookup(void* ctx, uint32_t id) {
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)ctx;
+    const memory_dict_t* found = NULL;
+
+    pthread_mutex_lock(&sqlite_mem->dict_lock);
+    for (uint32_t i = 0; i < sqlite_mem->dict_count && !found; i++) {
+        if (sqlite_mem->dicts[i]->id == id) found = sqlite_mem->dicts[i];
+    }
+    pthread_mutex_unlock(&sqlite_mem->dict_lock);
+
+    return found;
+}
+
+// Keep dict (taking its buffer) unless one with the same id is loaded;
+// returns the loaded copy
+static const memory_dict_t* dicts_add(sqlite_memory_t* sqlite_mem, memory_dict_t* dict) {
+    const memory_dict_t* known = dict_lookup(sqlite_mem, dict->id);
+    if (known) {
+        memory_dict_free(dict);
+        return known;
+    }
+
+    memory_dict_t* owned = malloc(sizeof(memory_dict_t));
+    pthread_mutex_lock(&sqlite_mem->dict_lock);
+    if (owned && sqlite_mem->dict_count == sqlite_mem->dict_capacity) {
+        uint32_t new_capacity = sqlite_mem->dict_capacity ? sqlite_mem->dict_capacity * 2 : 8;
+        memory_dict_t** dicts = realloc(sqlite_mem->dicts, new_capacity * sizeof(memory_dict_t*));
+        if (dicts) {
+            sqlite_mem->dicts = dicts;
+            sqlite_mem->dict_capacity = new_capacity;
+        }
+    }
+    if (owned && sqlite_mem->dict_count < sqlite_mem->dict_capacity) {
+        *owned = *dict;
+        sqlite_mem->dicts[sqlite_mem->dict_count++] = owned;
+    } else {
+        free(owned);
+        memory_dict_free(dict);
+        owned = NULL;
+    }
+    pthread_mutex_unlock(&sqlite_mem->dict_lock);
+
+    return owned;
+}
+
+// Load memory_dicts; the newest dictionary of each category becomes the
+// one new rows are written with (db_lock held)
+static void dicts_load(sqlite_memory_t* sqlite_mem) {
+    memset(sqlite_mem->active_dicts, 0, sizeof(sqlite_mem->active_dicts));
+    memset(sqlite_mem->dict_trained, 0, sizeof(sqlite_mem->dict_trained));
+
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_load_dicts;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int category = sqlite3_column_int(stmt, 1);
+        memory_dict_t dict;
+        if (memory_dict_init(&dict, sqlite3_column_blob(stmt, 2), (uint32_t)sqlite3_column_bytes(stmt, 2)) != ERR_OK) {
+            continue;
+        }
+        // A damaged dictionary would not match the id its rows name
+        if (dict.id != (uint32_t)sqlite3_column_int64(stmt, 0)) {
+            memory_dict_free(&dict);
+            continue;
+        }
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, select_by_key_sql, -1, &sqlite_mem->stmt_select_by_key, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+        const memory_dict_t* loaded = dicts_add(sqlite_mem, &dict);
+        if (loaded && category >= 0 && category < SQLITE_CATEGORY_COUNT) {
+            sqlite_mem->active_dicts[category] = loaded;
+        }
+    }
+    sqlite3_reset(stmt);
+}
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, select_by_id_sql, -1, &sqlite_mem->stmt_select_by_id, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+static void dicts_free(sqlite_memory_t* sqlite_mem) {
+    for (uint32_t i = 0; i < sqlite_mem->dict_count; i++) {
+        memory_dict_free(sqlite_mem->dicts[i]);
+        free(sqlite_mem->dicts[i]);
+    }
+    free(sqlite_mem->dicts);
+    sqlite_mem->dicts = NULL;
+    sqlite_mem->dict_count = 0;
+    sqlite_mem->dict_capacity = 0;
+    memset(sqlite_mem->active_dicts, 0, sizeof(sqlite_mem->active_dicts));
+}
+
+// Train and store a dictionary for category from its newest plain rows,
+// once it has enough of them (db_lock held). Tried once per category per
+// open; a category whose content does not train stays uncompressed.
+static void dict_train(sqlite_memory_t* sqlite_mem, int category) {
+    if (category < 0 || category >= SQLITE_CATEGORY_COUNT) return;
+    if (sqlite_mem->active_dicts[category] || sqlite_mem->dict_trained[category]) return;
+    if (__atomic_load_n(&sqlite_mem->category_counts[category], __ATOMIC_RELAXED) < SQLITE_DICT_TRAIN_ROWS) return;
+    sqlite_mem->dict_trained[category] = true;
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, search_sql, -1, &sqlite_mem->stmt_search, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_sample_content;
+    str_t* samples = calloc(SQLITE_DICT_SAMPLE_ROWS, sizeof(str_t));
+    if (!samples) return;
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, delete_by_key_sql, -1, &sqlite_mem->stmt_delete_by_key, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+    uint32_t count = 0;
+    sqlite3_bind_int(stmt, 1, category);
+    sqlite3_bind_int(stmt, 2, SQLITE_DICT_SAMPLE_ROWS);
+    while (count < SQLITE_DICT_SAMPLE_ROWS && sqlite3_step(stmt) == SQLITE_ROW) {
+        samples[count] = str_dup((str_t){ .data = (const char*)sqlite3_column_text(stmt, 0),
+                                          .len = (uint32_t)sqlite3_column_bytes(stmt, 0) }, NULL);
+        if (samples[count].data) count++;
+    }
+    sqlite3_reset(stmt);
+
+    memory_dict_t dict;
+    err_t err = memory_dict_train(samples, count, &dict);
+    for (uint32_t i = 0; i < count; i++) free((void*)samples[i].data);
+    free(samples);
+    if (err != ERR_OK) return;
+
+    stmt = sqlite_mem->writer.stmt_insert_dict;
+    sqlite3_bind_int64(stmt, 1, dict.id);
+    sqlite3_bind_int(stmt, 2, category);
+    sqlite3_bind_blob(stmt, 3, dict.data, (int)dict.size, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (rc != SQLITE_DONE) {
+        memory_dict_free(&dict);
+        return;
+    }
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, delete_by_id_sql, -1, &sqlite_mem->stmt_delete_by_id, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+    sqlite_mem->active_dicts[category] = dicts_add(sqlite_mem, &dict);
+}
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, delete_old_sql, -1, &sqlite_mem->stmt_delete_old, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+// Heap copy of a content column, decoding compressed rows
+static err_t content_from_row(sqlite_memory_t* sqlite_mem, sqlite3_stmt* stmt, int column, int codec, str_t* out) {
+    if (codec == SQLITE_CODEC_ZLIB_DICT && sqlite3_column_type(stmt, column) == SQLITE_BLOB) {
+        char* text = NULL;
+        uint32_t len = 0;
+        err_t err = memory_decompress(sqlite3_column_blob(stmt, column), (uint32_t)sqlite3_column_bytes(stmt, column),
+                                      dict_lookup, sqlite_mem, &text, &len);
+        if (err != ERR_OK) return err;
+        *out = (str_t){ .data = text, .len = len };
+        return ERR_OK;
+    }
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, count_total_sql, -1, &sqlite_mem->stmt_count_total, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+    const char* text = (const char*)sqlite3_column_text(stmt, column);
+    if (!text) return ERR_OK;
+    out->data = strdup(text);
+    if (!out->data) return ERR_OUT_OF_MEMORY;
+    out->len = (uint32_t)strlen(text);
+    return ERR_OK;
+}
 
-    rc = sqlite3_prepare_v2(sqlite_mem->db, count_by_category_sql, -1, &sqlite_mem->stmt_count_by_category, NULL);
-    if (rc != SQLITE_OK) return ERR_MEMORY;
+// ============================================================================
+// Inserts
+// ============================================================================
+
+static void bind_text(sqlite3_stmt* stmt, int index, str_t value) {
+    if (value.data) {
+        sqlite3_bind_text(stmt, index, value.data, (int)value.len, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, index);
+    }
+}
+
+// Compressed content when the category has a dictionary and it pays off;
+// NULL to store the plaintext
+static uint8_t* compress_content(sqlite_memory_t* sqlite_mem, const memory_entry_t* entry, uint32_t* out_len) {
+    if (!sqlite_mem->use_compression || !sqlite_mem->compressor || !entry->content.data) return NULL;
+    if ((uint32_t)entry->category >= SQLITE_CATEGORY_COUNT) return NULL;
+
+    const memory_dict_t* dict = sqlite_mem->active_dicts[entry->category];
+    uint8_t* data = NULL;
+    if (!dict || memory_compress(sqlite_mem->compressor, dict, entry->content.data, entry->content.len,
+                                 &data, out_len) != ERR_OK) {
+        return NULL;
+    }
+    return data;
+}
+
+// A compressed row is indexed here with its plaintext; plain rows go
+// through the insert trigger. Callers wrap compressed inserts in a
+// transaction so the two writes land together.
+static err_t insert_entry(sqlite_memory_t* sqlite_mem, const memory_entry_t* entry) {
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_insert;
+
+    uint32_t packed_len = 0;
+    uint8_t* packed = compress_content(sqlite_mem, entry, &packed_len);
+
+    bind_text(stmt, 1, entry->id);
+    bind_text(stmt, 2, entry->key);
+    if (packed) {
+        sqlite3_bind_blob(stmt, 3, packed, (int)packed_len, SQLITE_STATIC);
+    } else {
+        bind_text(stmt, 3, entry->content);
+    }
+    sqlite3_bind_int(stmt, 4, entry->category);
+    bind_text(stmt, 5, entry->timestamp);
+    bind_text(stmt, 6, str_empty(entry->session_id) ? STR_NULL : entry->session_id);
+    sqlite3_bind_double(stmt, 7, entry->score);
+    sqlite3_bind_int(stmt, 8, packed ? SQLITE_CODEC_ZLIB_DICT : SQLITE_CODEC_PLAIN);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    free(packed);
+
+    if (rc == SQLITE_DONE && packed) {
+        sqlite3_stmt* fts = sqlite_mem->writer.stmt_insert_fts;
+        sqlite3_bind_int64(fts, 1, sqlite3_last_insert_rowid(sqlite_mem->writer.db));
+        bind_text(fts, 2, entry->key);
+        bind_text(fts, 3, entry->content);
+        rc = sqlite3_step(fts);
+        sqlite3_reset(fts);
+        sqlite3_clear_bindings(fts);
+    }
+
+    if (rc != SQLITE_DONE) return ERR_MEMORY;
+    count_adjust(sqlite_mem, (int)entry->category, 1);
+    return ERR_OK;
+}
+
+// ============================================================================
+// Embeddings
+// ============================================================================
+
+// Chunks beyond this many per memory are folded into the last one
+#define EMBED_MAX_CHUNKS 16
+
+// Quantized chunk vectors for a group of entries, grouped by entry in order
+typedef struct vector_batch_t {
+    uint32_t count;
+    uint32_t* entry;
+    int8_t* codes;
+    float* scales;
+} vector_batch_t;
+
+static void vector_batch_free(vector_batch_t* batch) {
+    free(batch->entry);
+    free(batch->codes);
+    free(batch->scales);
+    memset(batch, 0, sizeof(vector_batch_t));
+}
+
+// Embed texts into out (count * dimensions), answering repeats from the cache
+static err_t embed_texts(sqlite_memory_t* sqlite_mem, const str_t* texts, uint32_t count, float* out) {
+    uint32_t dims = sqlite_mem->dimensions;
+    uint64_t* hashes = malloc(count * sizeof(uint64_t));
+    uint32_t* misses = malloc(count * sizeof(uint32_t));
+    str_t* miss_texts = malloc(count * sizeof(str_t));
+    if (!hashes || !misses || !miss_texts) {
+        free(hashes);
+        free(misses);
+        free(miss_texts);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint32_t miss_count = 0;
+    pthread_mutex_lock(&sqlite_mem->cache_lock);
+    for (uint32_t i = 0; i < count; i++) {
+        hashes[i] = embedding_cache_hash(texts[i]);
+        if (!embedding_cache_get(&sqlite_mem->cache, hashes[i], out + (size_t)i * dims)) {
+            misses[miss_count] = i;
+            miss_texts[miss_count] = texts[i];
+            miss_count++;
+        }
+    }
+    pthread_mutex_unlock(&sqlite_mem->cache_lock);
+
+    err_t err = ERR_OK;
+    if (miss_count > 0) {
+        float* fresh = malloc((size_t)miss_count * dims * sizeof(float));
+        err = fresh ? sqlite_mem->embed(sqlite_mem->embed_ctx, miss_texts, miss_count, dims, fresh)
+                    : ERR_OUT_OF_MEMORY;
+        if (err == ERR_OK) {
+            pthread_mutex_lock(&sqlite_mem->cache_lock);
+            for (uint32_t m = 0; m < miss_count; m++) {
+                const float* vec = fresh + (size_t)m * dims;
+                memcpy(out + (size_t)misses[m] * dims, vec, dims * sizeof(float));
+                embedding_cache_put(&sqlite_mem->cache, hashes[misses[m]], vec);
+            }
+            pthread_mutex_unlock(&sqlite_mem->cache_lock);
+        }
+        free(fresh);
+    }
+
+    free(hashes);
+    free(misses);
+    free(miss_texts);
+    return err;
+}
+
+// Chunk, embed (one request for the whole group) and quantize entry contents
+static err_t embed_entries(sqlite_memory_t* sqlite_mem, const memory_entry_t* entries, uint32_t count,
+                           vector_batch_t* out) {
+    memset(out, 0, sizeof(vector_batch_t));
+    if (!sqlite_mem->embed || count == 0) return ERR_OK;
+
+    uint32_t dims = sqlite_mem->dimensions;
+    size_t max_chunks = (size_t)count * EMBED_MAX_CHUNKS;
+    str_t* chunks = malloc(max_chunks * sizeof(str_t));
+    out->entry = malloc(max_chunks * sizeof(uint32_t));
+    if (!chunks || !out->entry) {
+        free(chunks);
+        vector_batch_free(out);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t n = vector_chunk_text(entries[i].content, sqlite_mem->chunk_bytes,
+                                       chunks + total, EMBED_MAX_CHUNKS);
+        for (uint32_t c = 0; c < n; c++) out->entry[total + c] = i;
+        total += n;
+    }
+
+    err_t err = ERR_OK;
+    float* vectors = total ? malloc((size_t)total * dims * sizeof(float)) : NULL;
+    out->codes = total ? malloc((size_t)total * dims) : NULL;
+    out->scales = total ? malloc(total * sizeof(float)) : NULL;
+    if (total && (!vectors || !out->codes || !out->scales)) {
+        err = ERR_OUT_OF_MEMORY;
+    } else if (total) {
+        err = embed_texts(sqlite_mem, chunks, total, vectors);
+    }
+
+    if (err == ERR_OK) {
+        for (uint32_t c = 0; c < total; c++) {
+            out->scales[c] = vector_quantize(vectors + (size_t)c * dims, dims, out->codes + (size_t)c * dims);
+        }
+        out->count = total;
+    } else {
+        vector_batch_free(out);
+    }
+
+    free(vectors);
+    free(chunks);
+    return err;
+}
+
+// Rebuild the RAM index from memory_vectors (vectors_lock held for writing)
+static err_t load_vectors(sqlite_memory_t* sqlite_mem, sqlite_conn_t* conn) {
+    vector_index_clear(&sqlite_mem->vectors);
+
+    err_t err = ERR_OK;
+    sqlite3_stmt* stmt = conn->stmt_load_vectors;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if ((uint32_t)sqlite3_column_bytes(stmt, 2) != sqlite_mem->dimensions) continue;
+
+        err = vector_index_add(&sqlite_mem->vectors, sqlite3_column_int64(stmt, 0),
+                               (const int8_t*)sqlite3_column_blob(stmt, 2),
+                               (float)sqlite3_column_double(stmt, 1));
+        if (err != ERR_OK) break;
+    }
+    sqlite3_reset(stmt);
+
+    sqlite_mem->vectors_stale = err != ERR_OK;
+    return err;
+}
+
+static err_t insert_vector(sqlite_memory_t* sqlite_mem, int64_t rowid, uint32_t chunk,
+                           const int8_t* code, float scale) {
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_insert_vector;
+
+    sqlite3_bind_int64(stmt, 1, rowid);
+    sqlite3_bind_int(stmt, 2, (int)chunk);
+    sqlite3_bind_double(stmt, 3, scale);
+    sqlite3_bind_blob(stmt, 4, code, (int)sqlite_mem->dimensions, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    return rc == SQLITE_DONE ? ERR_OK : ERR_MEMORY;
+}
+
+// Insert a group with one prepared statement inside one transaction (db_lock
+// held). Vectors, when given, are written in the same transaction.
+static err_t insert_entries(sqlite_memory_t* sqlite_mem, const memory_entry_t* entries, uint32_t count,
+                            const vector_batch_t* vectors) {
+    if (count == 0) return ERR_OK;
+
+    // Dictionaries are trained outside the group's transaction
+    if (sqlite_mem->use_compression) {
+        for (uint32_t i = 0; i < count; i++) dict_train(sqlite_mem, (int)entries[i].category);
+    }
+
+    bool has_vectors = vectors && vectors->count > 0;
+    if (count == 1 && !has_vectors && !sqlite_mem->use_compression) return insert_entry(sqlite_mem, &entries[0]);
+
+    int64_t* rowids = has_vectors ? malloc(count * sizeof(int64_t)) : NULL;
+    if (has_vectors && !rowids) return ERR_OUT_OF_MEMORY;
+
+    sqlite3* db = sqlite_mem->writer.db;
+    if (sqlite3_exec(db, "BEGIN IMMEDIATE;", NULL, NULL, NULL) != SQLITE_OK) {
+        free(rowids);
+        return ERR_MEMORY;
+    }
+
+    err_t err = ERR_OK;
+    uint32_t next_vector = 0;
+    for (uint32_t i = 0; i < count && err == ERR_OK; i++) {
+        err = insert_entry(sqlite_mem, &entries[i]);
+        if (err != ERR_OK || !has_vectors) continue;
+
+        rowids[i] = sqlite3_last_insert_rowid(db);
+        for (uint32_t chunk = 0; next_vector < vectors->count && vectors->entry[next_vector] == i; chunk++) {
+            err = insert_vector(sqlite_mem, rowids[i], chunk,
+                                vectors->codes + (size_t)next_vector * sqlite_mem->dimensions,
+                                vectors->scales[next_vector]);
+            if (err != ERR_OK) break;
+            next_vector++;
+        }
+    }
+
+    // Hold the index across the commit so a reader rebuilding it from the
+    // database cannot pick these rows up before they are mirrored below
+    if (has_vectors) pthread_rwlock_wrlock(&sqlite_mem->vectors_lock);
+    if (err == ERR_OK && sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+        err = ERR_MEMORY;
+    }
+    if (err != ERR_OK) {
+        if (has_vectors) pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+        sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        free(rowids);
+        // The rolled-back rows were counted as they went in
+        count_load(sqlite_mem);
+        return err;
+    }
+
+    // Committed: mirror the vectors into the RAM index
+    if (!has_vectors) return ERR_OK;
+    if (!sqlite_mem->vectors_stale) {
+        for (uint32_t v = 0; v < vectors->count; v++) {
+            if (vector_index_add(&sqlite_mem->vectors, rowids[vectors->entry[v]],
+                                 vectors->codes + (size_t)v * sqlite_mem->dimensions,
+                                 vectors->scales[v]) != ERR_OK) {
+                sqlite_mem->vectors_stale = true;
+                break;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+
+    free(rowids);
+    return ERR_OK;
+}
+
+// ============================================================================
+// Write-behind queue
+// ============================================================================
+
+// Producers drain inline once the backlog reaches this many batches
+#define WRITE_BEHIND_MAX_BATCHES 4
+
+static void entry_release(memory_entry_t* entry) {
+    free((void*)entry->id.data);
+    free((void*)entry->key.data);
+    free((void*)entry->content.data);
+    free((void*)entry->timestamp.data);
+    free((void*)entry->session_id.data);
+}
+
+static bool entry_copy(memory_entry_t* dst, const memory_entry_t* src) {
+    *dst = (memory_entry_t){
+        .id = str_dup(src->id, NULL),
+        .key = str_dup(src->key, NULL),
+        .content = str_dup(src->content, NULL),
+        .category = src->category,
+        .timestamp = str_dup(src->timestamp, NULL),
+        .session_id = str_dup(src->session_id, NULL),
+        .score = src->score
+    };
+
+    if ((!str_empty(src->id) && !dst->id.data) ||
+        (!str_empty(src->key) && !dst->key.data) ||
+        (!str_empty(src->content) && !dst->content.data) ||
+        (!str_empty(src->timestamp) && !dst->timestamp.data) ||
+        (!str_empty(src->session_id) && !dst->session_id.data)) {
+        entry_release(dst);
+        return false;
+    }
+    return true;
+}
+
+// Commit everything queued so far (db_lock held)
+static err_t write_behind_drain(sqlite_memory_t* sqlite_mem) {
+    pthread_mutex_lock(&sqlite_mem->queue_lock);
+    memory_entry_t* batch = sqlite_mem->queue;
+    uint32_t count = sqlite_mem->queue_count;
+    sqlite_mem->queue = NULL;
+    sqlite_mem->queue_count = 0;
+    sqlite_mem->queue_capacity = 0;
+    pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+    if (count == 0) {
+        free(batch);
+        return ERR_OK;
+    }
+
+    // Entries are still committed if embedding fails; they just stay keyword-only
+    vector_batch_t vectors;
+    if (embed_entries(sqlite_mem, batch, count, &vectors) != ERR_OK) {
+        memset(&vectors, 0, sizeof(vectors));
+    }
+
+    err_t err = insert_entries(sqlite_mem, batch, count, &vectors);
+    vector_batch_free(&vectors);
+    if (err != ERR_OK && sqlite_mem->flush_error == ERR_OK) {
+        sqlite_mem->flush_error = err;
+    }
+
+    pthread_mutex_lock(&sqlite_mem->queue_lock);
+    sqlite_mem->uncommitted -= count;
+    pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+    for (uint32_t i = 0; i < count; i++) {
+        entry_release(&batch[i]);
+    }
+    free(batch);
+
+    return err;
+}
+
+static void* write_behind_thread(void* arg) {
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)arg;
+
+    pthread_mutex_lock(&sqlite_mem->queue_lock);
+    for (;;) {
+        while (!sqlite_mem->stopping && sqlite_mem->queue_count == 0) {
+            pthread_cond_wait(&sqlite_mem->queue_cond, &sqlite_mem->queue_lock);
+        }
+        if (sqlite_mem->stopping && sqlite_mem->queue_count == 0) break;
+
+        // Give the group until the interval expires to fill up
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += sqlite_mem->interval_ms / 1000;
+        deadline.tv_nsec += (long)(sqlite_mem->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (!sqlite_mem->stopping && sqlite_mem->queue_count < sqlite_mem->batch_size) {
+            if (pthread_cond_timedwait(&sqlite_mem->queue_cond, &sqlite_mem->queue_lock,
+                                       &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+        // db_lock before the swap so readers never miss a group in flight
+        pthread_mutex_lock(&sqlite_mem->db_lock);
+        write_behind_drain(sqlite_mem);
+        pthread_mutex_unlock(&sqlite_mem->db_lock);
+
+        pthread_mutex_lock(&sqlite_mem->queue_lock);
+    }
+    pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+    return NULL;
+}
+
+static err_t write_behind_enqueue(sqlite_memory_t* sqlite_mem, const memory_entry_t* entries, uint32_t count) {
+    pthread_mutex_lock(&sqlite_mem->queue_lock);
+
+    if (sqlite_mem->queue_count + count > sqlite_mem->queue_capacity) {
+        uint32_t new_capacity = sqlite_mem->queue_capacity ? sqlite_mem->queue_capacity : sqlite_mem->batch_size;
+        while (new_capacity < sqlite_mem->queue_count + count) new_capacity *= 2;
+
+        memory_entry_t* queue = realloc(sqlite_mem->queue, new_capacity * sizeof(memory_entry_t));
+        if (!queue) {
+            pthread_mutex_unlock(&sqlite_mem->queue_lock);
+            return ERR_OUT_OF_MEMORY;
+        }
+        sqlite_mem->queue = queue;
+        sqlite_mem->queue_capacity = new_capacity;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!entry_copy(&sqlite_mem->queue[sqlite_mem->queue_count], &entries[i])) {
+            pthread_mutex_unlock(&sqlite_mem->queue_lock);
+            return ERR_OUT_OF_MEMORY;
+        }
+        sqlite_mem->queue_count++;
+        sqlite_mem->uncommitted++;
+    }
+
+    uint32_t queued = sqlite_mem->queue_count;
+    if (queued == count || queued >= sqlite_mem->batch_size) {
+        pthread_cond_signal(&sqlite_mem->queue_cond);
+    }
+    pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+    // Backpressure: commit inline when the flusher falls behind
+    if (queued >= sqlite_mem->batch_size * WRITE_BEHIND_MAX_BATCHES) {
+        pthread_mutex_lock(&sqlite_mem->db_lock);
+        err_t err = write_behind_drain(sqlite_mem);
+        pthread_mutex_unlock(&sqlite_mem->db_lock);
+        return err;
+    }
 
     return ERR_OK;
 }
 
-static void finalize_statements(sqlite_memory_t* sqlite_mem) {
-    if (sqlite_mem->stmt_insert) sqlite3_finalize(sqlite_mem->stmt_insert);
-    if (sqlite_mem->stmt_select_by_key) sqlite3_finalize(sqlite_mem->stmt_select_by_key);
-    if (sqlite_mem->stmt_select_by_id) sqlite3_finalize(sqlite_mem->stmt_select_by_id);
-    if (sqlite_mem->stmt_search) sqlite3_finalize(sqlite_mem->stmt_search);
-    if (sqlite_mem->stmt_delete_by_key) sqlite3_finalize(sqlite_mem->stmt_delete_by_key);
-    if (sqlite_mem->stmt_delete_by_id) sqlite3_finalize(sqlite_mem->stmt_delete_by_id);
-    if (sqlite_mem->stmt_delete_old) sqlite3_finalize(sqlite_mem->stmt_delete_old);
-    if (sqlite_mem->stmt_count_total) sqlite3_finalize(sqlite_mem->stmt_count_total);
-    if (sqlite_mem->stmt_count_by_category) sqlite3_finalize(sqlite_mem->stmt_count_by_category);
+// Take the writer; queued stores are committed first so deletes observe
+// every store that returned before them
+static void db_acquire(sqlite_memory_t* sqlite_mem) {
+    pthread_mutex_lock(&sqlite_mem->db_lock);
+    if (sqlite_mem->write_behind) {
+        write_behind_drain(sqlite_mem);
+    }
+}
+
+static void db_release(sqlite_memory_t* sqlite_mem) {
+    pthread_mutex_unlock(&sqlite_mem->db_lock);
+}
+
+// Commit stores still queued or in flight, so a read sees every store
+// that returned before it. Nothing to do (and no db_lock) when idle.
+static void sync_pending(sqlite_memory_t* sqlite_mem) {
+    if (!sqlite_mem->write_behind) return;
+
+    pthread_mutex_lock(&sqlite_mem->queue_lock);
+    bool pending = sqlite_mem->uncommitted > 0;
+    pthread_mutex_unlock(&sqlite_mem->queue_lock);
+
+    if (pending) {
+        db_acquire(sqlite_mem);
+        db_release(sqlite_mem);
+    }
 }
 
+// A connection for lookups: a pooled reader, or the writer (under
+// db_lock) when the database cannot be shared between connections
+static sqlite_conn_t* reader_acquire(sqlite_memory_t* sqlite_mem) {
+    sync_pending(sqlite_mem);
+
+    if (sqlite_mem->reader_count == 0) {
+        pthread_mutex_lock(&sqlite_mem->db_lock);
+        return &sqlite_mem->writer;
+    }
+
+    pthread_mutex_lock(&sqlite_mem->pool_lock);
+    while (sqlite_mem->free_count == 0) {
+        pthread_cond_wait(&sqlite_mem->pool_cond, &sqlite_mem->pool_lock);
+    }
+    sqlite_conn_t* conn = &sqlite_mem->readers[sqlite_mem->free_readers[--sqlite_mem->free_count]];
+    pthread_mutex_unlock(&sqlite_mem->pool_lock);
+    return conn;
+}
+
+static void reader_release(sqlite_memory_t* sqlite_mem, sqlite_conn_t* conn) {
+    if (conn == &sqlite_mem->writer) {
+        pthread_mutex_unlock(&sqlite_mem->db_lock);
+        return;
+    }
+
+    pthread_mutex_lock(&sqlite_mem->pool_lock);
+    sqlite_mem->free_readers[sqlite_mem->free_count++] = (uint32_t)(conn - sqlite_mem->readers);
+    pthread_cond_signal(&sqlite_mem->pool_cond);
+    pthread_mutex_unlock(&sqlite_mem->pool_lock);
+}
+
+static void readers_close(sqlite_memory_t* sqlite_mem) {
+    for (uint32_t i = 0; i < sqlite_mem->reader_count; i++) {
+        conn_close(&sqlite_mem->readers[i]);
+    }
+    sqlite_mem->reader_count = 0;
+    sqlite_mem->free_count = 0;
+}
+
+// Readers need a database file that several connections can open
+static bool path_shareable(const char* path) {
+    return path && *path && strcmp(path, ":memory:") != 0 && strncmp(path, "file::memory:", 13) != 0;
+}
+
+// ============================================================================
+// Backend
+// ============================================================================
+
 static str_t sqlite_get_name(void) {
     return STR_LIT("sqlite");
 }
@@ -190,6 +1171,29 @@ static err_t sqlite_create(const memory_config_t* config, memory_t** out_memory)
     }
 
     sqlite_mem->use_compression = config->compression;
+    sqlite_mem->write_behind = config->write_behind_batch > 0;
+    sqlite_mem->batch_size = config->write_behind_batch;
+    sqlite_mem->interval_ms = config->write_behind_interval_ms ? config->write_behind_interval_ms
+                                                               : MEMORY_WRITE_BEHIND_INTERVAL_DEFAULT_MS;
+    pthread_mutex_init(&sqlite_mem->db_lock, NULL);
+    pthread_mutex_init(&sqlite_mem->queue_lock, NULL);
+    pthread_cond_init(&sqlite_mem->queue_cond, NULL);
+
+    sqlite_mem->embed = config->embed;
+    sqlite_mem->embed_ctx = config->embed_ctx;
+    sqlite_mem->dimensions = config->embedding_dimensions ? config->embedding_dimensions
+                                                          : MEMORY_EMBEDDING_DIMENSIONS_DEFAULT;
+    sqlite_mem->vector_weight = config->vector_weight;
+    sqlite_mem->keyword_weight = config->keyword_weight;
+    // Roughly four bytes per token for English text
+    sqlite_mem->chunk_bytes = (size_t)(config->chunk_max_tokens ? config->chunk_max_tokens
+                                                                : MEMORY_CHUNK_MAX_TOKENS_DEFAULT) * 4;
+    vector_index_init(&sqlite_mem->vectors, sqlite_mem->dimensions);
+    pthread_rwlock_init(&sqlite_mem->vectors_lock, NULL);
+    pthread_mutex_init(&sqlite_mem->cache_lock, NULL);
+    pthread_mutex_init(&sqlite_mem->pool_lock, NULL);
+    pthread_cond_init(&sqlite_mem->pool_cond, NULL);
+    pthread_mutex_init(&sqlite_mem->dict_lock, NULL);
     memory->impl_data = sqlite_mem;
 
     *out_memory = memory;
@@ -206,6 +1210,14 @@ static void sqlite_destroy(memory_t* memory) {
         sqlite_cleanup(memory);
     }
 
+    pthread_cond_destroy(&sqlite_mem->queue_cond);
+    pthread_mutex_destroy(&sqlite_mem->queue_lock);
+    pthread_mutex_destroy(&sqlite_mem->db_lock);
+    pthread_mutex_destroy(&sqlite_mem->cache_lock);
+    pthread_rwlock_destroy(&sqlite_mem->vectors_lock);
+    pthread_cond_destroy(&sqlite_mem->pool_cond);
+    pthread_mutex_destroy(&sqlite_mem->pool_lock);
+    pthread_mutex_destroy(&sqlite_mem->dict_lock);
     free(sqlite_mem->db_path);
     free(sqlite_mem);
     memory->impl_data = NULL;
@@ -219,31 +1231,42 @@ static err_t sqlite_init(memory_t* memory) {
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    // Open database
-    int rc = sqlite3_open(sqlite_mem->db_path, &sqlite_mem->db);
-    if (rc != SQLITE_OK) {
-        return ERR_MEMORY;
+    // Writer first: it switches the file to WAL and creates the schema
+    err_t err = conn_open(&sqlite_mem->writer, sqlite_mem->db_path, true);
+    if (err != ERR_OK) return err;
+    count_load(sqlite_mem);
+
+    // Dictionaries load even with compression off so compressed rows still decode
+    dicts_load(sqlite_mem);
+    if (sqlite_mem->use_compression && memory_compressor_create(&sqlite_mem->compressor) != ERR_OK) {
+        sqlite_mem->compressor = NULL;
     }
 
-    // Enable WAL mode for better concurrency
-    rc = sqlite3_exec(sqlite_mem->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
-    if (rc != SQLITE_OK) {
-        sqlite3_close(sqlite_mem->db);
-        return ERR_MEMORY;
+    // A reader that fails to open just leaves the pool smaller
+    if (path_shareable(sqlite_mem->db_path)) {
+        for (uint32_t i = 0; i < SQLITE_READER_COUNT; i++) {
+            sqlite_conn_t* reader = &sqlite_mem->readers[sqlite_mem->reader_count];
+            if (conn_open(reader, sqlite_mem->db_path, false) != ERR_OK) break;
+            sqlite_mem->free_readers[sqlite_mem->free_count++] = sqlite_mem->reader_count++;
+        }
     }
 
-    // Create tables
-    rc = sqlite3_exec(sqlite_mem->db, get_table_schema(), NULL, NULL, NULL);
-    if (rc != SQLITE_OK) {
-        sqlite3_close(sqlite_mem->db);
-        return ERR_MEMORY;
+    if (sqlite_mem->embed) {
+        embedding_cache_init(&sqlite_mem->cache, memory->config.embedding_cache_size, sqlite_mem->dimensions);
+        load_vectors(sqlite_mem, &sqlite_mem->writer);
     }
 
-    // Prepare statements
-    err_t err = prepare_statements(sqlite_mem);
-    if (err != ERR_OK) {
-        sqlite3_close(sqlite_mem->db);
-        return err;
+    if (sqlite_mem->write_behind) {
+        sqlite_mem->stopping = false;
+        if (pthread_create(&sqlite_mem->flusher, NULL, write_behind_thread, sqlite_mem) != 0) {
+            readers_close(sqlite_mem);
+            conn_close(&sqlite_mem->writer);
+            memory_compressor_free(sqlite_mem->compressor);
+            sqlite_mem->compressor = NULL;
+            dicts_free(sqlite_mem);
+            return ERR_RUNTIME;
+        }
+        sqlite_mem->flusher_running = true;
     }
 
     memory->initialized = true;
@@ -255,12 +1278,24 @@ static void sqlite_cleanup(memory_t* memory) {
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    finalize_statements(sqlite_mem);
-
-    if (sqlite_mem->db) {
-        sqlite3_close(sqlite_mem->db);
-        sqlite_mem->db = NULL;
+    // The flusher commits whatever is still queued before exiting
+    if (sqlite_mem->flusher_running) {
+        pthread_mutex_lock(&sqlite_mem->queue_lock);
+        sqlite_mem->stopping = true;
+        pthread_cond_signal(&sqlite_mem->queue_cond);
+        pthread_mutex_unlock(&sqlite_mem->queue_lock);
+        pthread_join(sqlite_mem->flusher, NULL);
+        sqlite_mem->flusher_running = false;
     }
+    write_behind_drain(sqlite_mem);
+
+    readers_close(sqlite_mem);
+    conn_close(&sqlite_mem->writer);
+    vector_index_free(&sqlite_mem->vectors);
+    embedding_cache_free(&sqlite_mem->cache);
+    memory_compressor_free(sqlite_mem->compressor);
+    sqlite_mem->compressor = NULL;
+    dicts_free(sqlite_mem);
 
     memory->initialized = false;
 }
@@ -272,71 +1307,105 @@ static err_t sqlite_store(memory_t* memory, const memory_entry_t* entry) {
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    // Bind parameters
-    sqlite3_bind_text(sqlite_mem->stmt_insert, 1, entry->id.data, -1, SQLITE_STATIC);
-    sqlite3_bind_text(sqlite_mem->stmt_insert, 2, entry->key.data, -1, SQLITE_STATIC);
-    sqlite3_bind_text(sqlite_mem->stmt_insert, 3, entry->content.data, -1, SQLITE_STATIC);
-    sqlite3_bind_int(sqlite_mem->stmt_insert, 4, entry->category);
-    sqlite3_bind_text(sqlite_mem->stmt_insert, 5, entry->timestamp.data, -1, SQLITE_STATIC);
+    if (sqlite_mem->write_behind) {
+        return write_behind_enqueue(sqlite_mem, entry, 1);
+    }
 
-    if (!str_empty(entry->session_id)) {
-        sqlite3_bind_text(sqlite_mem->stmt_insert, 6, entry->session_id.data, -1, SQLITE_STATIC);
-    } else {
-        sqlite3_bind_null(sqlite_mem->stmt_insert, 6);
+    return sqlite_store_multiple(memory, entry, 1);
+}
+
+static err_t sqlite_store_multiple(memory_t* memory, const memory_entry_t* entries, uint32_t count) {
+    if (!memory || !memory->impl_data || !memory->initialized || (!entries && count > 0)) {
+        return ERR_INVALID_ARGUMENT;
     }
 
-    sqlite3_bind_double(sqlite_mem->stmt_insert, 7, entry->score);
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    int rc = sqlite3_step(sqlite_mem->stmt_insert);
-    sqlite3_reset(sqlite_mem->stmt_insert);
+    if (sqlite_mem->write_behind) {
+        return write_behind_enqueue(sqlite_mem, entries, count);
+    }
 
-    if (rc != SQLITE_DONE) {
-        return ERR_MEMORY;
+    // Embed before taking the connection so the request never blocks readers
+    vector_batch_t vectors;
+    if (embed_entries(sqlite_mem, entries, count, &vectors) != ERR_OK) {
+        memset(&vectors, 0, sizeof(vectors));
     }
 
-    return ERR_OK;
+    pthread_mutex_lock(&sqlite_mem->db_lock);
+    err_t err = insert_entries(sqlite_mem, entries, count, &vectors);
+    pthread_mutex_unlock(&sqlite_mem->db_lock);
+
+    vector_batch_free(&vectors);
+    return err;
 }
 
-static err_t sqlite_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry) {
-    if (!memory || !memory->impl_data || !memory->initialized || !key || !out_entry) {
+static err_t sqlite_flush(memory_t* memory) {
+    if (!memory || !memory->impl_data || !memory->initialized) {
         return ERR_INVALID_ARGUMENT;
     }
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    sqlite3_bind_text(sqlite_mem->stmt_select_by_key, 1, key->data, -1, SQLITE_STATIC);
+    pthread_mutex_lock(&sqlite_mem->db_lock);
+    write_behind_drain(sqlite_mem);
+    err_t err = sqlite_mem->flush_error;
+    sqlite_mem->flush_error = ERR_OK;
+    pthread_mutex_unlock(&sqlite_mem->db_lock);
 
-    int rc = sqlite3_step(sqlite_mem->stmt_select_by_key);
-    if (rc == SQLITE_ROW) {
-        // Extract columns
-        out_entry->id.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_key, 0));
-        out_entry->id.len = strlen(out_entry->id.data);
+    return err;
+}
 
-        out_entry->key.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_key, 1));
-        out_entry->key.len = strlen(out_entry->key.data);
+// Copy id, key, content, category, timestamp and session_id from columns
+// 0-5, decoding the content by the codec in codec_column
+static err_t entry_from_row(sqlite_memory_t* sqlite_mem, sqlite3_stmt* stmt, int codec_column,
+                            memory_entry_t* entry) {
+    const char* columns[4] = {
+        (const char*)sqlite3_column_text(stmt, 0),
+        (const char*)sqlite3_column_text(stmt, 1),
+        (const char*)sqlite3_column_text(stmt, 4),
+        (const char*)sqlite3_column_text(stmt, 5)
+    };
+    str_t* fields[4] = { &entry->id, &entry->key, &entry->timestamp, &entry->session_id };
+
+    memset(entry, 0, sizeof(memory_entry_t));
+    entry->category = sqlite3_column_int(stmt, 3);
+    for (int i = 0; i < 4; i++) {
+        if (!columns[i]) continue;
+        fields[i]->data = strdup(columns[i]);
+        if (!fields[i]->data) {
+            entry_release(entry);
+            return ERR_OUT_OF_MEMORY;
+        }
+        fields[i]->len = (uint32_t)strlen(columns[i]);
+    }
 
-        out_entry->content.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_key, 2));
-        out_entry->content.len = strlen(out_entry->content.data);
+    err_t err = content_from_row(sqlite_mem, stmt, 2, sqlite3_column_int(stmt, codec_column), &entry->content);
+    if (err != ERR_OK) {
+        entry_release(entry);
+        memset(entry, 0, sizeof(memory_entry_t));
+    }
+    return err;
+}
 
-        out_entry->category = sqlite3_column_int(sqlite_mem->stmt_select_by_key, 3);
+static err_t sqlite_recall(memory_t* memory, const str_t* key, memory_entry_t* out_entry) {
+    if (!memory || !memory->impl_data || !memory->initialized || !key || !out_entry) {
+        return ERR_INVALID_ARGUMENT;
+    }
 
-        out_entry->timestamp.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_key, 4));
-        out_entry->timestamp.len = strlen(out_entry->timestamp.data);
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-        const char* session_id = (const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_key, 5);
-        if (session_id) {
-            out_entry->session_id.data = strdup(session_id);
-            out_entry->session_id.len = strlen(session_id);
-        } else {
-            out_entry->session_id = STR_NULL;
-        }
+    sqlite_conn_t* conn = reader_acquire(sqlite_mem);
+    sqlite3_stmt* stmt = conn->stmt_select_by_key;
+    sqlite3_bind_text(stmt, 1, key->data, -1, SQLITE_STATIC);
 
-        out_entry->score = sqlite3_column_double(sqlite_mem->stmt_select_by_key, 6);
-    }
+    int rc = sqlite3_step(stmt);
+    err_t err = rc == SQLITE_ROW ? entry_from_row(sqlite_mem, stmt, 7, out_entry) : ERR_NOT_FOUND;
+    if (err == ERR_OK) out_entry->score = sqlite3_column_double(stmt, 6);
 
-    sqlite3_reset(sqlite_mem->stmt_select_by_key);
+    sqlite3_reset(stmt);
 
-    return (rc == SQLITE_ROW) ? ERR_OK : ERR_NOT_FOUND;
+    reader_release(sqlite_mem, conn);
+    return err;
 }
 
 static err_t sqlite_recall_by_id(memory_t* memory, const str_t* id, memory_entry_t* out_entry) {
@@ -346,145 +1415,300 @@ static err_t sqlite_recall_by_id(memory_t* memory, const str_t* id, memory_entry
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    sqlite3_bind_text(sqlite_mem->stmt_select_by_id, 1, id->data, -1, SQLITE_STATIC);
-
-    int rc = sqlite3_step(sqlite_mem->stmt_select_by_id);
-    if (rc == SQLITE_ROW) {
-        // Extract columns (similar to recall)
-        out_entry->id.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_id, 0));
-        out_entry->id.len = strlen(out_entry->id.data);
-
-        out_entry->key.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_id, 1));
-        out_entry->key.len = strlen(out_entry->key.data);
+    sqlite_conn_t* conn = reader_acquire(sqlite_mem);
+    sqlite3_stmt* stmt = conn->stmt_select_by_id;
+    sqlite3_bind_text(stmt, 1, id->data, -1, SQLITE_STATIC);
 
-        out_entry->content.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_id, 2));
-        out_entry->content.len = strlen(out_entry->content.data);
+    int rc = sqlite3_step(stmt);
+    err_t err = rc == SQLITE_ROW ? entry_from_row(sqlite_mem, stmt, 7, out_entry) : ERR_NOT_FOUND;
+    if (err == ERR_OK) out_entry->score = sqlite3_column_double(stmt, 6);
 
-        out_entry->category = sqlite3_column_int(sqlite_mem->stmt_select_by_id, 3);
+    sqlite3_reset(stmt);
 
-        out_entry->timestamp.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_id, 4));
-        out_entry->timestamp.len = strlen(out_entry->timestamp.data);
+    reader_release(sqlite_mem, conn);
+    return err;
+}
 
-        const char* session_id = (const char*)sqlite3_column_text(sqlite_mem->stmt_select_by_id, 5);
-        if (session_id) {
-            out_entry->session_id.data = strdup(session_id);
-            out_entry->session_id.len = strlen(session_id);
-        } else {
-            out_entry->session_id = STR_NULL;
+// Turn free text into an FTS5 expression: each whitespace-separated term
+// becomes a quoted string, OR-ed together so bm25 ranks partial matches
+static char* build_match_expression(const str_t* query) {
+    // Worst case every byte is a quote (doubled) plus per-term quoting and " OR "
+    size_t cap = (size_t)query->len * 7 + 1;
+    char* out = malloc(cap);
+    if (!out) return NULL;
+
+    size_t len = 0;
+    size_t i = 0;
+    while (i < query->len) {
+        while (i < query->len && isspace((unsigned char)query->data[i])) i++;
+        if (i >= query->len) break;
+
+        if (len > 0) {
+            memcpy(out + len, " OR ", 4);
+            len += 4;
         }
 
-        out_entry->score = sqlite3_column_double(sqlite_mem->stmt_select_by_id, 6);
+        out[len++] = '"';
+        while (i < query->len && !isspace((unsigned char)query->data[i])) {
+            char c = query->data[i++];
+            if (c == '"') out[len++] = '"';
+            out[len++] = c;
+        }
+        out[len++] = '"';
     }
+    out[len] = '\0';
 
-    sqlite3_reset(sqlite_mem->stmt_select_by_id);
-
-    return (rc == SQLITE_ROW) ? ERR_OK : ERR_NOT_FOUND;
+    return out;
 }
 
-static err_t sqlite_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
-                          memory_entry_t** out_entries, uint32_t* out_count) {
-    if (!memory || !memory->impl_data || !memory->initialized || !query || !out_entries || !out_count) {
-        return ERR_INVALID_ARGUMENT;
-    }
+static bool entries_reserve(memory_entry_t** entries, uint32_t count, uint32_t* capacity) {
+    if (count < *capacity) return true;
 
-    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
+    uint32_t new_capacity = *capacity ? *capacity * 2 : 16;
+    memory_entry_t* new_entries = realloc(*entries, new_capacity * sizeof(memory_entry_t));
+    if (!new_entries) return false;
 
-    // For now, simple FTS search
-    // TODO: Add category filtering, timestamp range, etc.
+    *entries = new_entries;
+    *capacity = new_capacity;
+    return true;
+}
 
-    sqlite3_bind_text(sqlite_mem->stmt_search, 1, query->data, -1, SQLITE_STATIC);
-    sqlite3_bind_text(sqlite_mem->stmt_search, 2, query->data, -1, SQLITE_STATIC);
-    sqlite3_bind_int(sqlite_mem->stmt_search, 3, opts ? opts->limit : 10);
+// Run the keyword query on conn. Row ids are returned when out_rowids is set.
+static err_t keyword_search(sqlite_memory_t* sqlite_mem, sqlite_conn_t* conn, const char* match, const memory_search_opts_t* opts,
+                            double min_score, uint32_t limit, memory_entry_t** out_entries,
+                            int64_t** out_rowids, uint32_t* out_count) {
+    sqlite3_stmt* stmt = opts->snippets ? conn->stmt_search_snippet : conn->stmt_search;
+    sqlite3_bind_text(stmt, 1, match, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, (int)opts->category_filter);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)opts->min_timestamp);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)opts->max_timestamp);
+    sqlite3_bind_double(stmt, 5, min_score);
+    sqlite3_bind_int(stmt, 6, (int)limit);
 
     // Collect results
     memory_entry_t* entries = NULL;
+    int64_t* rowids = NULL;
     uint32_t count = 0;
     uint32_t capacity = 0;
+    err_t err = ERR_OK;
 
-    while (sqlite3_step(sqlite_mem->stmt_search) == SQLITE_ROW) {
-        if (count >= capacity) {
-            capacity = capacity ? capacity * 2 : 16;
-            memory_entry_t* new_entries = realloc(entries, capacity * sizeof(memory_entry_t));
-            if (!new_entries) {
-                memory_entry_array_free(entries, count);
-                sqlite3_reset(sqlite_mem->stmt_search);
-                return ERR_OUT_OF_MEMORY;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        uint32_t old_capacity = capacity;
+        if (!entries_reserve(&entries, count, &capacity)) {
+            err = ERR_OUT_OF_MEMORY;
+            break;
+        }
+        if (out_rowids && capacity != old_capacity) {
+            int64_t* new_rowids = realloc(rowids, capacity * sizeof(int64_t));
+            if (!new_rowids) {
+                err = ERR_OUT_OF_MEMORY;
+                break;
             }
-            entries = new_entries;
+            rowids = new_rowids;
         }
 
         memory_entry_t* entry = &entries[count];
+        err = entry_from_row(sqlite_mem, stmt, 8, entry);
+        if (err != ERR_OK) break;
+        entry->score = sqlite3_column_double(stmt, 6);
+        if (rowids) rowids[count] = sqlite3_column_int64(stmt, 7);
+
+        count++;
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (err != ERR_OK) {
+        memory_entry_array_free(entries, count);
+        free(rowids);
+        return err;
+    }
 
-        entry->id.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_search, 0));
-        entry->id.len = strlen(entry->id.data);
+    *out_entries = entries;
+    if (out_rowids) *out_rowids = rowids;
+    *out_count = count;
+    return ERR_OK;
+}
 
-        entry->key.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_search, 1));
-        entry->key.len = strlen(entry->key.data);
+static int compare_score_desc(const void* a, const void* b) {
+    double sa = ((const memory_entry_t*)a)->score;
+    double sb = ((const memory_entry_t*)b)->score;
+    return (sa < sb) - (sa > sb);
+}
 
-        entry->content.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_search, 2));
-        entry->content.len = strlen(entry->content.data);
+// Fuse bm25 and cosine candidates on conn. Keyword scores are scaled by
+// the best one so both signals sit in [0, 1] before weighting.
+static err_t hybrid_search(sqlite_memory_t* sqlite_mem, sqlite_conn_t* conn, const char* match,
+                           const float* query_vector, const memory_search_opts_t* opts, uint32_t limit,
+                           memory_entry_t** out_entries, uint32_t* out_count) {
+    uint32_t candidates = limit * 4 > 16 ? limit * 4 : 16;
 
-        entry->category = sqlite3_column_int(sqlite_mem->stmt_search, 3);
+    memory_entry_t* entries = NULL;
+    int64_t* rowids = NULL;
+    uint32_t count = 0;
+    err_t err = keyword_search(sqlite_mem, conn, match, opts, 0.0, candidates, &entries, &rowids, &count);
+    if (err != ERR_OK) return err;
+
+    uint32_t capacity = count;
+    vector_hit_t* hits = malloc(candidates * sizeof(vector_hit_t));
+    double* cosine = calloc(count + candidates, sizeof(double));
+    if (!hits || !cosine) {
+        err = ERR_OUT_OF_MEMORY;
+        goto done;
+    }
 
-        entry->timestamp.data = strdup((const char*)sqlite3_column_text(sqlite_mem->stmt_search, 4));
-        entry->timestamp.len = strlen(entry->timestamp.data);
+    double best_keyword = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (entries[i].score > best_keyword) best_keyword = entries[i].score;
+    }
+    uint32_t keyword_count = count;
+
+    // Scans share the index; the first one after a delete rebuilds it
+    pthread_rwlock_rdlock(&sqlite_mem->vectors_lock);
+    if (sqlite_mem->vectors_stale) {
+        pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+        pthread_rwlock_wrlock(&sqlite_mem->vectors_lock);
+        if (sqlite_mem->vectors_stale) load_vectors(sqlite_mem, conn);
+        pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+        pthread_rwlock_rdlock(&sqlite_mem->vectors_lock);
+    }
+    uint32_t hit_count = vector_index_search(&sqlite_mem->vectors, query_vector, candidates, hits);
+    pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+    for (uint32_t h = 0; h < hit_count; h++) {
+        uint32_t i = 0;
+        while (i < keyword_count && rowids[i] != hits[h].owner) i++;
+        if (i < keyword_count) {
+            cosine[i] = hits[h].score;
+            continue;
+        }
 
-        const char* session_id = (const char*)sqlite3_column_text(sqlite_mem->stmt_search, 5);
-        if (session_id) {
-            entry->session_id.data = strdup(session_id);
-            entry->session_id.len = strlen(session_id);
-        } else {
-            entry->session_id = STR_NULL;
+        // Vector-only match: fetch it through the same filters as the keyword query
+        sqlite3_stmt* stmt = conn->stmt_select_filtered;
+        sqlite3_bind_int64(stmt, 1, hits[h].owner);
+        sqlite3_bind_int(stmt, 2, (int)opts->category_filter);
+        sqlite3_bind_int64(stmt, 3, (sqlite3_int64)opts->min_timestamp);
+        sqlite3_bind_int64(stmt, 4, (sqlite3_int64)opts->max_timestamp);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            err = entries_reserve(&entries, count, &capacity) ? entry_from_row(sqlite_mem, stmt, 6, &entries[count])
+                                                              : ERR_OUT_OF_MEMORY;
+            if (err == ERR_OK) {
+                entries[count].score = 0.0;
+                cosine[count] = hits[h].score;
+                count++;
+            }
         }
+        sqlite3_reset(stmt);
+        if (err != ERR_OK) goto done;
+    }
 
-        entry->score = sqlite3_column_double(sqlite_mem->stmt_search, 6);
+    // Score, drop anything under min_score and keep the best `limit`
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        double keyword = best_keyword > 0.0 && entries[i].score > 0.0 ? entries[i].score / best_keyword : 0.0;
+        double vector = cosine[i] > 0.0 ? cosine[i] : 0.0;
+        double score = sqlite_mem->vector_weight * vector + sqlite_mem->keyword_weight * keyword;
 
-        count++;
+        if (score < opts->min_score || score <= 0.0) {
+            entry_release(&entries[i]);
+            continue;
+        }
+        entries[i].score = score;
+        entries[kept++] = entries[i];
     }
+    count = kept;
 
-    sqlite3_reset(sqlite_mem->stmt_search);
+    if (count > 1) qsort(entries, count, sizeof(memory_entry_t), compare_score_desc);
+    while (count > limit) {
+        entry_release(&entries[--count]);
+    }
+
+done:
+    free(hits);
+    free(cosine);
+    free(rowids);
+    if (err != ERR_OK) {
+        memory_entry_array_free(entries, count);
+        return err;
+    }
 
     *out_entries = entries;
     *out_count = count;
     return ERR_OK;
 }
 
-static err_t sqlite_forget(memory_t* memory, const str_t* key) {
-    if (!memory || !memory->impl_data || !memory->initialized || !key) {
+static err_t sqlite_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                          memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!memory || !memory->impl_data || !memory->initialized || !query || !out_entries || !out_count) {
         return ERR_INVALID_ARGUMENT;
     }
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    sqlite3_bind_text(sqlite_mem->stmt_delete_by_key, 1, key->data, -1, SQLITE_STATIC);
-
-    int rc = sqlite3_step(sqlite_mem->stmt_delete_by_key);
-    sqlite3_reset(sqlite_mem->stmt_delete_by_key);
+    memory_search_opts_t defaults = memory_search_opts_default();
+    if (!opts) opts = &defaults;
+    uint32_t limit = opts->limit ? opts->limit : 10;
+
+    // Quote every term so user text never reaches the FTS5 query grammar
+    char* match = build_match_expression(query);
+    if (!match) return ERR_OUT_OF_MEMORY;
+    if (!*match) {
+        free(match);
+        *out_entries = NULL;
+        *out_count = 0;
+        return ERR_OK;
+    }
 
-    if (rc != SQLITE_DONE) {
-        return ERR_MEMORY;
+    // Embed the query before taking the connection; on failure fall back to keywords
+    float* query_vector = NULL;
+    if (sqlite_mem->embed && sqlite_mem->vector_weight > 0.0) {
+        query_vector = malloc(sqlite_mem->dimensions * sizeof(float));
+        if (query_vector && embed_texts(sqlite_mem, query, 1, query_vector) != ERR_OK) {
+            free(query_vector);
+            query_vector = NULL;
+        }
     }
 
-    return ERR_OK;
+    sqlite_conn_t* conn = reader_acquire(sqlite_mem);
+    err_t err = query_vector
+        ? hybrid_search(sqlite_mem, conn, match, query_vector, opts, limit, out_entries, out_count)
+        : keyword_search(sqlite_mem, conn, match, opts, opts->min_score, limit, out_entries, NULL, out_count);
+    reader_release(sqlite_mem, conn);
+
+    free(query_vector);
+    free(match);
+    return err;
 }
 
-static err_t sqlite_forget_by_id(memory_t* memory, const str_t* id) {
-    if (!memory || !memory->impl_data || !memory->initialized || !id) {
+static err_t sqlite_forget(memory_t* memory, const str_t* key) {
+    if (!memory || !memory->impl_data || !memory->initialized || !key) {
         return ERR_INVALID_ARGUMENT;
     }
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    sqlite3_bind_text(sqlite_mem->stmt_delete_by_id, 1, id->data, -1, SQLITE_STATIC);
+    db_acquire(sqlite_mem);
+    sqlite3_bind_text(sqlite_mem->writer.stmt_delete_by_key, 1, key->data, -1, SQLITE_STATIC);
+    err_t err = run_delete(sqlite_mem, sqlite_mem->writer.stmt_delete_by_key, NULL);
+    db_release(sqlite_mem);
 
-    int rc = sqlite3_step(sqlite_mem->stmt_delete_by_id);
-    sqlite3_reset(sqlite_mem->stmt_delete_by_id);
+    return err;
+}
 
-    if (rc != SQLITE_DONE) {
-        return ERR_MEMORY;
+static err_t sqlite_forget_by_id(memory_t* memory, const str_t* id) {
+    if (!memory || !memory->impl_data || !memory->initialized || !id) {
+        return ERR_INVALID_ARGUMENT;
     }
 
-    return ERR_OK;
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
+
+    db_acquire(sqlite_mem);
+    sqlite3_bind_text(sqlite_mem->writer.stmt_delete_by_id, 1, id->data, -1, SQLITE_STATIC);
+    err_t err = run_delete(sqlite_mem, sqlite_mem->writer.stmt_delete_by_id, NULL);
+    db_release(sqlite_mem);
+
+    return err;
 }
 
 static err_t sqlite_forget_old(memory_t* memory, uint64_t cutoff_timestamp) {
@@ -494,15 +1718,162 @@ static err_t sqlite_forget_old(memory_t* memory, uint64_t cutoff_timestamp) {
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    sqlite3_bind_int64(sqlite_mem->stmt_delete_old, 1, (sqlite3_int64)cutoff_timestamp);
+    // Batches, so stores queue behind one short delete at a time
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_delete_old;
+    uint32_t removed = MEMORY_SWEEP_BATCH_DEFAULT;
+    err_t err = ERR_OK;
+    while (err == ERR_OK && removed == MEMORY_SWEEP_BATCH_DEFAULT) {
+        db_acquire(sqlite_mem);
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_timestamp);
+        sqlite3_bind_int(stmt, 2, MEMORY_SWEEP_BATCH_DEFAULT);
+        err = run_delete(sqlite_mem, stmt, &removed);
+        db_release(sqlite_mem);
+    }
 
-    int rc = sqlite3_step(sqlite_mem->stmt_delete_old);
-    sqlite3_reset(sqlite_mem->stmt_delete_old);
+    return err;
+}
 
-    if (rc != SQLITE_DONE) {
-        return ERR_MEMORY;
+// One batch of category rows created before cutoff, past *cursor (db_lock
+// held). Archived rows are copied out first in the same transaction.
+// Returns ERR_NOT_FOUND once nothing is left.
+static err_t sweep_batch(sqlite_memory_t* sqlite_mem, int category, uint64_t cutoff, bool archive,
+                         uint32_t batch_size, int64_t* cursor, uint32_t* out_removed) {
+    sqlite_conn_t* conn = &sqlite_mem->writer;
+
+    sqlite3_bind_int64(conn->stmt_sweep_bound, 1, *cursor);
+    sqlite3_bind_int(conn->stmt_sweep_bound, 2, category);
+    sqlite3_bind_int64(conn->stmt_sweep_bound, 3, (sqlite3_int64)cutoff);
+    sqlite3_bind_int(conn->stmt_sweep_bound, 4, (int)batch_size);
+    bool found = sqlite3_step(conn->stmt_sweep_bound) == SQLITE_ROW &&
+                 sqlite3_column_type(conn->stmt_sweep_bound, 0) != SQLITE_NULL;
+    int64_t bound = found ? sqlite3_column_int64(conn->stmt_sweep_bound, 0) : 0;
+    sqlite3_reset(conn->stmt_sweep_bound);
+    if (!found) return ERR_NOT_FOUND;
+
+    if (sqlite3_exec(conn->db, "BEGIN IMMEDIATE;", NULL, NULL, NULL) != SQLITE_OK) return ERR_MEMORY;
+
+    sqlite3_stmt* range[] = { conn->stmt_sweep_archive, conn->stmt_sweep_delete };
+    for (int i = 0; i < 2; i++) {
+        sqlite3_bind_int64(range[i], 1, *cursor);
+        sqlite3_bind_int64(range[i], 2, bound);
+        sqlite3_bind_int(range[i], 3, category);
+        sqlite3_bind_int64(range[i], 4, (sqlite3_int64)cutoff);
+    }
+
+    err_t err = ERR_OK;
+    if (archive) {
+        if (sqlite3_step(conn->stmt_sweep_archive) != SQLITE_DONE) err = ERR_MEMORY;
+        sqlite3_reset(conn->stmt_sweep_archive);
     }
+    // FTS rows and vectors go with the triggers on memories
+    if (err == ERR_OK) err = run_delete(sqlite_mem, conn->stmt_sweep_delete, out_removed);
+
+    if (err == ERR_OK && sqlite3_exec(conn->db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) err = ERR_MEMORY;
+    if (err != ERR_OK) {
+        sqlite3_exec(conn->db, "ROLLBACK;", NULL, NULL, NULL);
+        count_load(sqlite_mem);
+        return err;
+    }
+
+    *cursor = bound;
+    return ERR_OK;
+}
+
+static bool sweep_budget_left(const memory_sweep_opts_t* opts, const memory_sweep_result_t* result) {
+    return opts->max_batches == 0 || result->batches < opts->max_batches;
+}
 
+static err_t sweep_category(sqlite_memory_t* sqlite_mem, int category, uint64_t cutoff, bool archive,
+                            const memory_sweep_opts_t* opts, uint32_t batch_size,
+                            memory_sweep_result_t* result, uint32_t* out_total) {
+    int64_t cursor = 0;
+    while (sweep_budget_left(opts, result)) {
+        uint32_t removed = 0;
+        db_acquire(sqlite_mem);
+        err_t err = sweep_batch(sqlite_mem, category, cutoff, archive, batch_size, &cursor, &removed);
+        db_release(sqlite_mem);
+        if (err == ERR_NOT_FOUND) return ERR_OK;
+        if (err != ERR_OK) return err;
+
+        result->batches++;
+        *out_total += removed;
+    }
+    result->complete = false;
+    return ERR_OK;
+}
+
+static err_t sweep_purge(sqlite_memory_t* sqlite_mem, uint64_t cutoff, const memory_sweep_opts_t* opts,
+                         uint32_t batch_size, memory_sweep_result_t* result) {
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_purge_archive;
+    while (sweep_budget_left(opts, result)) {
+        db_acquire(sqlite_mem);
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff);
+        sqlite3_bind_int(stmt, 2, (int)batch_size);
+        int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        uint32_t purged = (uint32_t)sqlite3_changes(sqlite_mem->writer.db);
+        db_release(sqlite_mem);
+        if (rc != SQLITE_DONE) return ERR_MEMORY;
+
+        result->batches++;
+        result->purged += purged;
+        if (purged < batch_size) return ERR_OK;
+    }
+    result->complete = false;
+    return ERR_OK;
+}
+
+// Hand free pages back to the filesystem a slice at a time (no-op unless
+// the file was created with auto_vacuum=INCREMENTAL)
+static void sweep_vacuum(sqlite_memory_t* sqlite_mem, const memory_sweep_opts_t* opts,
+                         memory_sweep_result_t* result) {
+    sqlite3_stmt* stmt = sqlite_mem->writer.stmt_freelist_count;
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%d);", SQLITE_SWEEP_VACUUM_PAGES);
+
+    while (sweep_budget_left(opts, result)) {
+        db_acquire(sqlite_mem);
+        int64_t free_pages = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+        sqlite3_reset(stmt);
+        bool vacuumed = free_pages > 0 && sqlite3_exec(sqlite_mem->writer.db, sql, NULL, NULL, NULL) == SQLITE_OK;
+        db_release(sqlite_mem);
+        if (!vacuumed) return;
+
+        result->batches++;
+        if (free_pages <= SQLITE_SWEEP_VACUUM_PAGES) return;
+    }
+    result->complete = false;
+}
+
+static err_t sqlite_sweep(memory_t* memory, const memory_sweep_opts_t* opts, memory_sweep_result_t* out_result) {
+    if (!memory || !memory->impl_data || !memory->initialized || !opts || !out_result) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
+    uint32_t batch_size = opts->batch_size ? opts->batch_size : MEMORY_SWEEP_BATCH_DEFAULT;
+    memory_sweep_result_t* result = out_result;
+    memset(result, 0, sizeof(*result));
+    result->complete = true;
+
+    err_t err = ERR_OK;
+    if (opts->conversation_before) {
+        err = sweep_category(sqlite_mem, MEMORY_CATEGORY_CONVERSATION, opts->conversation_before, false,
+                             opts, batch_size, result, &result->expired);
+    }
+    if (err == ERR_OK && opts->archive_before) {
+        err = sweep_category(sqlite_mem, MEMORY_CATEGORY_DAILY, opts->archive_before, true,
+                             opts, batch_size, result, &result->archived);
+    }
+    if (err == ERR_OK && opts->purge_before) {
+        err = sweep_purge(sqlite_mem, opts->purge_before, opts, batch_size, result);
+    }
+    if (err != ERR_OK) {
+        result->complete = false;
+        return err;
+    }
+
+    sweep_vacuum(sqlite_mem, opts, result);
     return ERR_OK;
 }
 
@@ -513,33 +1884,245 @@ static err_t sqlite_get_stats(memory_t* memory, uint32_t* total_entries, uint32_
 
     sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
 
-    // Get total count
-    int rc = sqlite3_step(sqlite_mem->stmt_count_total);
-    if (rc == SQLITE_ROW) {
-        *total_entries = sqlite3_column_int(sqlite_mem->stmt_count_total, 0);
+    // Counters move with every committed insert and delete
+    sync_pending(sqlite_mem);
+    *total_entries = __atomic_load_n(&sqlite_mem->total_count, __ATOMIC_RELAXED);
+    if (by_category_counts) {
+        for (int i = 0; i < SQLITE_CATEGORY_COUNT; i++) {
+            by_category_counts[i] = __atomic_load_n(&sqlite_mem->category_counts[i], __ATOMIC_RELAXED);
+        }
     }
-    sqlite3_reset(sqlite_mem->stmt_count_total);
 
-    // Get counts by category if requested
-    if (by_category_counts) {
-        // For simplicity, just zero out the array
-        // In real implementation, we would populate it
-        memset(by_category_counts, 0, sizeof(uint32_t) * 4); // 4 categories
+    return ERR_OK;
+}
+
+// ============================================================================
+// Backup and restore
+// ============================================================================
+
+// Pages copied per backup step and rows per incremental batch; the writer
+// is released between them so stores keep flowing during a large copy
+#define SQLITE_BACKUP_STEP_PAGES 256
+#define SQLITE_BACKUP_BATCH_ROWS 1000
+
+// Copy src into dst a few pages at a time. lock serializes each step with
+// stores on the writer (NULL when the caller holds db_lock throughout).
+static err_t backup_copy(sqlite_memory_t* sqlite_mem, sqlite3* dst, sqlite3* src, bool lock) {
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+    if (!backup) return ERR_MEMORY;
+
+    int rc;
+    do {
+        if (lock) db_acquire(sqlite_mem);
+        rc = sqlite3_backup_step(backup, SQLITE_BACKUP_STEP_PAGES);
+        if (lock) db_release(sqlite_mem);
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) sqlite3_sleep(5);
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    return rc == SQLITE_DONE ? ERR_OK : ERR_MEMORY;
+}
+
+// Any backup, whatever its schema version, holds both row tables
+static bool backup_has_tables(sqlite3* db) {
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' "
+                               "AND name IN ('memories', 'memories_archive');", -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
     }
+    bool found = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 2;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// An earlier backup at the current schema version can be brought up to date
+static bool backup_is_current_schema(sqlite3* db) {
+    return backup_has_tables(db) && table_has_column(db, "memories", "codec") &&
+           table_has_column(db, "memory_dicts", "dict_id");
+}
+
+// Run one statement on the writer under db_lock; *out_changes when set
+static err_t backup_exec(sqlite_memory_t* sqlite_mem, const char* sql, int64_t lo, int64_t hi, int* out_changes) {
+    db_acquire(sqlite_mem);
+    sqlite3* db = sqlite_mem->writer.db;
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, lo);
+        sqlite3_bind_int64(stmt, 2, hi);
+        rc = sqlite3_step(stmt);
+        if (out_changes) *out_changes = sqlite3_changes(db);
+    }
+    sqlite3_finalize(stmt);
+    db_release(sqlite_mem);
+    return rc == SQLITE_DONE || rc == SQLITE_ROW ? ERR_OK : ERR_MEMORY;
+}
+
+static int64_t backup_max_rowid(sqlite_memory_t* sqlite_mem, const char* table) {
+    char sql[96];
+    snprintf(sql, sizeof(sql), "SELECT COALESCE(MAX(rowid), 0) FROM %s;", table);
+
+    db_acquire(sqlite_mem);
+    sqlite3_stmt* stmt = NULL;
+    int64_t max = 0;
+    if (sqlite3_prepare_v2(sqlite_mem->writer.db, sql, -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        max = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    db_release(sqlite_mem);
+    return max;
+}
 
+// Bring backup.<table> level with main.<table>. Rows are never updated in
+// place, so a row whose rowid and id both match is already current: drop
+// backup rows that no longer match, then append the rows past the backup's
+// highest rowid. Both passes work in bounded rowid windows.
+static err_t backup_sync_table(sqlite_memory_t* sqlite_mem, const char* table, const char* columns,
+                               bool with_index) {
+    char backup_table[64];
+    snprintf(backup_table, sizeof(backup_table), "backup.%s", table);
+
+    char sql[768];
+    snprintf(sql, sizeof(sql),
+             "DELETE FROM backup.%s WHERE rowid > ?1 AND rowid <= ?2 AND NOT EXISTS "
+             "(SELECT 1 FROM main.%s AS m WHERE m.rowid = backup.%s.rowid AND m.id = backup.%s.id);",
+             table, table, table, table);
+    int64_t backup_max = backup_max_rowid(sqlite_mem, backup_table);
+    for (int64_t lo = 0; lo < backup_max; lo += SQLITE_BACKUP_BATCH_ROWS) {
+        err_t err = backup_exec(sqlite_mem, sql, lo, lo + SQLITE_BACKUP_BATCH_ROWS, NULL);
+        if (err != ERR_OK) return err;
+    }
+
+    // Vectors of a dropped row went with the backup's delete trigger
+    backup_max = backup_max_rowid(sqlite_mem, backup_table);
+    int64_t source_max = backup_max_rowid(sqlite_mem, table);
+    for (int64_t lo = backup_max; lo < source_max; lo += SQLITE_BACKUP_BATCH_ROWS) {
+        snprintf(sql, sizeof(sql),
+                 "INSERT INTO backup.%s (rowid, %s) SELECT rowid, %s FROM main.%s "
+                 "WHERE rowid > ?1 AND rowid <= ?2;",
+                 table, columns, columns, table);
+        err_t err = backup_exec(sqlite_mem, sql, lo, lo + SQLITE_BACKUP_BATCH_ROWS, NULL);
+        // The backup's trigger indexes plain rows; compressed ones take
+        // their index rows from the source
+        if (err == ERR_OK && with_index) {
+            err = backup_exec(sqlite_mem,
+                              "INSERT INTO backup.memories_fts (rowid, key, content) "
+                              "SELECT f.rowid, f.key, f.content FROM main.memories_fts AS f "
+                              "JOIN main.memories AS m ON m.rowid = f.rowid "
+                              "WHERE m.rowid > ?1 AND m.rowid <= ?2 AND m.codec != 0;",
+                              lo, lo + SQLITE_BACKUP_BATCH_ROWS, NULL);
+        }
+        if (err == ERR_OK && with_index) {
+            err = backup_exec(sqlite_mem,
+                              "INSERT OR REPLACE INTO backup.memory_vectors SELECT * FROM main.memory_vectors "
+                              "WHERE memory_rowid > ?1 AND memory_rowid <= ?2;",
+                              lo, lo + SQLITE_BACKUP_BATCH_ROWS, NULL);
+        }
+        if (err != ERR_OK) return err;
+    }
     return ERR_OK;
 }
 
+static err_t backup_incremental(sqlite_memory_t* sqlite_mem, const char* path) {
+    db_acquire(sqlite_mem);
+    sqlite3_stmt* attach = NULL;
+    int rc = sqlite3_prepare_v2(sqlite_mem->writer.db, "ATTACH DATABASE ?1 AS backup;", -1, &attach, NULL);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_text(attach, 1, path, -1, SQLITE_STATIC);
+        rc = sqlite3_step(attach);
+    }
+    sqlite3_finalize(attach);
+    db_release(sqlite_mem);
+    if (rc != SQLITE_DONE) return ERR_MEMORY;
+
+    // Dictionaries first: they are never removed, and every copied row
+    // needs the one it was written with
+    err_t err = backup_exec(sqlite_mem,
+                            "INSERT OR IGNORE INTO backup.memory_dicts (dict_id, category, dict) "
+                            "SELECT dict_id, category, dict FROM main.memory_dicts ORDER BY rowid;",
+                            0, 0, NULL);
+    if (err == ERR_OK) {
+        err = backup_sync_table(sqlite_mem, "memories",
+                                "id, key, content, category, timestamp, session_id, score, created_at, updated_at, "
+                                "codec",
+                                true);
+    }
+    if (err == ERR_OK) {
+        err = backup_sync_table(sqlite_mem, "memories_archive",
+                                "id, key, content, category, timestamp, session_id, score, created_at, archived_at, "
+                                "codec",
+                                false);
+    }
+
+    db_acquire(sqlite_mem);
+    sqlite3_exec(sqlite_mem->writer.db, "DETACH DATABASE backup;", NULL, NULL, NULL);
+    db_release(sqlite_mem);
+    return err;
+}
+
+// A path holding an earlier backup is updated in place with the rows
+// added and removed since; anything else gets a full page copy
 static err_t sqlite_backup(memory_t* memory, const str_t* backup_path) {
-    // TODO: Implement database backup
-    (void)memory;
-    (void)backup_path;
-    return ERR_NOT_IMPLEMENTED;
+    if (!memory || !memory->impl_data || !memory->initialized || !backup_path || str_empty(*backup_path)) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
+    char* path = strndup(backup_path->data, backup_path->len);
+    if (!path) return ERR_OUT_OF_MEMORY;
+
+    sqlite3* dst = NULL;
+    if (sqlite3_open_v2(path, &dst, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        sqlite3_close(dst);
+        free(path);
+        return ERR_WRITE_FAILED;
+    }
+
+    // Steps read through the writer, so stores made between them are
+    // folded into the copy instead of restarting it
+    bool incremental = backup_is_current_schema(dst);
+    err_t err = incremental ? ERR_OK : backup_copy(sqlite_mem, dst, sqlite_mem->writer.db, true);
+    sqlite3_close(dst);
+    if (incremental) err = backup_incremental(sqlite_mem, path);
+
+    free(path);
+    return err;
 }
 
+// Replace the contents with a backup; lookups and stores wait until the
+// copy is complete and the counters and vector index are rebuilt
 static err_t sqlite_restore(memory_t* memory, const str_t* backup_path) {
-    // TODO: Implement database restore
-    (void)memory;
-    (void)backup_path;
-    return ERR_NOT_IMPLEMENTED;
-}
\ No newline at end of file
+    if (!memory || !memory->impl_data || !memory->initialized || !backup_path || str_empty(*backup_path)) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    sqlite_memory_t* sqlite_mem = (sqlite_memory_t*)memory->impl_data;
+    char* path = strndup(backup_path->data, backup_path->len);
+    if (!path) return ERR_OUT_OF_MEMORY;
+
+    sqlite3* src = NULL;
+    int rc = sqlite3_open_v2(path, &src, SQLITE_OPEN_READONLY, NULL);
+    free(path);
+    if (rc != SQLITE_OK || !backup_has_tables(src)) {
+        sqlite3_close(src);
+        return rc != SQLITE_OK ? ERR_FILE_NOT_FOUND : ERR_INVALID_ARGUMENT;
+    }
+
+    db_acquire(sqlite_mem);
+    err_t err = backup_copy(sqlite_mem, sqlite_mem->writer.db, src, false);
+    // A backup taken before a schema change is upgraded like an old file
+    if (err == ERR_OK && (sqlite3_exec(sqlite_mem->writer.db, get_table_schema(), NULL, NULL, NULL) != SQLITE_OK ||
+                          !schema_migrate(sqlite_mem->writer.db))) {
+        err = ERR_MEMORY;
+    }
+    count_load(sqlite_mem);
+    dicts_load(sqlite_mem);
+    pthread_rwlock_wrlock(&sqlite_mem->vectors_lock);
+    if (sqlite_mem->embed) load_vectors(sqlite_mem, &sqlite_mem->writer);
+    pthread_rwlock_unlock(&sqlite_mem->vectors_lock);
+    db_release(sqlite_mem);
+
+    sqlite3_close(src);
+    return err;
+}
@@ -0,0 +1,230 @@
+// vector.c - Quantized vector index for memory backends
+// SPDX-License-Identifier: MIT
+
+#include "memory/vector.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Index
+// ============================================================================
+
+void vector_index_init(vector_index_t* index, uint32_t dimensions) {
+    memset(index, 0, sizeof(vector_index_t));
+    index->dimensions = dimensions;
+}
+
+void vector_index_free(vector_index_t* index) {
+    if (!index) return;
+    free(index->codes);
+    free(index->scales);
+    free(index->owners);
+    uint32_t dimensions = index->dimensions;
+    vector_index_init(index, dimensions);
+}
+
+void vector_index_clear(vector_index_t* index) {
+    index->count = 0;
+}
+
+err_t vector_index_add(vector_index_t* index, int64_t owner, const int8_t* code, float scale) {
+    if (!index || !code || index->dimensions == 0) return ERR_INVALID_ARGUMENT;
+
+    if (index->count == index->capacity) {
+        uint32_t new_capacity = index->capacity ? index->capacity * 2 : 256;
+
+        int8_t* codes = realloc(index->codes, (size_t)new_capacity * index->dimensions);
+        if (!codes) return ERR_OUT_OF_MEMORY;
+        index->codes = codes;
+
+        float* scales = realloc(index->scales, new_capacity * sizeof(float));
+        if (!scales) return ERR_OUT_OF_MEMORY;
+        index->scales = scales;
+
+        int64_t* owners = realloc(index->owners, new_capacity * sizeof(int64_t));
+        if (!owners) return ERR_OUT_OF_MEMORY;
+        index->owners = owners;
+
+        index->capacity = new_capacity;
+    }
+
+    memcpy(index->codes + (size_t)index->count * index->dimensions, code, index->dimensions);
+    index->scales[index->count] = scale;
+    index->owners[index->count] = owner;
+    index->count++;
+
+    return ERR_OK;
+}
+
+static int32_t dot_i8(const int8_t* a, const int8_t* b, uint32_t n) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return sum;
+}
+
+// Keep hits sorted best-first; an owner appears once with its best score
+static uint32_t hits_offer(vector_hit_t* hits, uint32_t count, uint32_t k, int64_t owner, float score) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (hits[i].owner != owner) continue;
+        if (score <= hits[i].score) return count;
+
+        // Better chunk for a known owner: bubble it up
+        while (i > 0 && hits[i - 1].score < score) {
+            hits[i] = hits[i - 1];
+            i--;
+        }
+        hits[i] = (vector_hit_t){ .owner = owner, .score = score };
+        return count;
+    }
+
+    if (count == k && score <= hits[k - 1].score) return count;
+
+    uint32_t pos = count < k ? count++ : k - 1;
+    while (pos > 0 && hits[pos - 1].score < score) {
+        hits[pos] = hits[pos - 1];
+        pos--;
+    }
+    hits[pos] = (vector_hit_t){ .owner = owner, .score = score };
+    return count;
+}
+
+uint32_t vector_index_search(const vector_index_t* index, const float* query,
+                             uint32_t k, vector_hit_t* out_hits) {
+    if (!index || !query || !out_hits || k == 0 || index->count == 0) return 0;
+
+    uint32_t dims = index->dimensions;
+    int8_t* code = malloc(dims);
+    float* normalized = malloc(dims * sizeof(float));
+    if (!code || !normalized) {
+        free(code);
+        free(normalized);
+        return 0;
+    }
+
+    memcpy(normalized, query, dims * sizeof(float));
+    float query_scale = vector_quantize(normalized, dims, code);
+    free(normalized);
+
+    uint32_t count = 0;
+    const int8_t* row = index->codes;
+    for (uint32_t i = 0; i < index->count; i++, row += dims) {
+        float score = (float)dot_i8(code, row, dims) * query_scale * index->scales[i];
+        if (count < k || score > out_hits[count - 1].score) {
+            count = hits_offer(out_hits, count, k, index->owners[i], score);
+        }
+    }
+
+    free(code);
+    return count;
+}
+
+float vector_quantize(float* v, uint32_t dimensions, int8_t* out_code) {
+    double norm = 0.0;
+    for (uint32_t i = 0; i < dimensions; i++) norm += (double)v[i] * v[i];
+
+    float max_abs = 0.0f;
+    if (norm > 0.0) {
+        float inv = (float)(1.0 / sqrt(norm));
+        for (uint32_t i = 0; i < dimensions; i++) {
+            v[i] *= inv;
+            if (fabsf(v[i]) > max_abs) max_abs = fabsf(v[i]);
+        }
+    }
+
+    if (max_abs == 0.0f) {
+        memset(out_code, 0, dimensions);
+        return 0.0f;
+    }
+
+    float to_code = 127.0f / max_abs;
+    for (uint32_t i = 0; i < dimensions; i++) {
+        out_code[i] = (int8_t)lrintf(v[i] * to_code);
+    }
+    return max_abs / 127.0f;
+}
+
+uint32_t vector_chunk_text(str_t text, size_t max_bytes, str_t* out_chunks, uint32_t max_chunks) {
+    if (!text.data || text.len == 0 || max_chunks == 0) return 0;
+    if (max_bytes == 0) max_bytes = text.len;
+
+    uint32_t count = 0;
+    size_t pos = 0;
+    while (pos < text.len && count < max_chunks) {
+        while (pos < text.len && isspace((unsigned char)text.data[pos])) pos++;
+        if (pos >= text.len) break;
+
+        size_t end = pos + max_bytes;
+        if (end >= text.len || count == max_chunks - 1) {
+            end = text.len;
+        } else {
+            // Back off to the last whitespace so words stay whole
+            size_t cut = end;
+            while (cut > pos && !isspace((unsigned char)text.data[cut])) cut--;
+            if (cut > pos) end = cut;
+        }
+
+        out_chunks[count++] = (str_t){ .data = text.data + pos, .len = (uint32_t)(end - pos) };
+        pos = end;
+    }
+
+    return count;
+}
+
+// ============================================================================
+// Embedding cache
+// ============================================================================
+
+err_t embedding_cache_init(embedding_cache_t* cache, uint32_t capacity, uint32_t dimensions) {
+    memset(cache, 0, sizeof(embedding_cache_t));
+    if (capacity == 0 || dimensions == 0) return ERR_OK;
+
+    cache->hashes = calloc(capacity, sizeof(uint64_t));
+    cache->vectors = malloc((size_t)capacity * dimensions * sizeof(float));
+    if (!cache->hashes || !cache->vectors) {
+        embedding_cache_free(cache);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    cache->capacity = capacity;
+    cache->dimensions = dimensions;
+    return ERR_OK;
+}
+
+void embedding_cache_free(embedding_cache_t* cache) {
+    if (!cache) return;
+    free(cache->hashes);
+    free(cache->vectors);
+    memset(cache, 0, sizeof(embedding_cache_t));
+}
+
+uint64_t embedding_cache_hash(str_t text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint32_t i = 0; i < text.len; i++) {
+        hash ^= (unsigned char)text.data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+bool embedding_cache_get(const embedding_cache_t* cache, uint64_t hash, float* out) {
+    if (!cache || cache->capacity == 0) return false;
+
+    uint32_t slot = (uint32_t)(hash % cache->capacity);
+    if (cache->hashes[slot] != hash) return false;
+
+    memcpy(out, cache->vectors + (size_t)slot * cache->dimensions, cache->dimensions * sizeof(float));
+    return true;
+}
+
+void embedding_cache_put(embedding_cache_t* cache, uint64_t hash, const float* vector) {
+    if (!cache || cache->capacity == 0) return;
+
+    uint32_t slot = (uint32_t)(hash % cache->capacity);
+    cache->hashes[slot] = hash;
+    memcpy(cache->vectors + (size_t)slot * cache->dimensions, vector, cache->dimensions * sizeof(float));
+}
@@ -4,6 +4,7 @@
 #include "providers/anthropic.h"
 #include "providers/base.h"
 #include "core/error.h"
+#include "core/trace.h"
 #include "json_config.h"
 
 #include <stdlib.h>
@@ -34,11 +35,39 @@ static err_t anthropic_chat(provider_t* provider,
                            double temperature,
                            chat_response_t** out_response);
 static err_t anthropic_chat_stream(provider_t* provider,
+                                   const chat_message_t* messages,
+                                   uint32_t message_count,
+                                   const char* model,
+                                   double temperature,
+                                   void (*on_chunk)(const char* chunk, void* user_data),
+                                   void* user_data);
+static err_t anthropic_chat_stream_deltas(provider_t* provider,
+                                          const chat_message_t* messages,
+                                          uint32_t message_count,
+                                          const tool_def_t* tools,
+                                          uint32_t tool_count,
+                                          const char* model,
+                                          double temperature,
+                                          stream_delta_callback_t on_delta,
+                                          void* user_data);
+static err_t anthropic_chat_stream_async(provider_t* provider,
+                                         http_engine_t* engine,
+                                         const chat_message_t* messages,
+                                         uint32_t message_count,
+                                         const char* model,
+                                         double temperature,
+                                         void (*on_chunk)(const char* chunk, void* user_data),
+                                         provider_stream_done_t on_done,
+                                         void* user_data);
+static err_t anthropic_chat_async(provider_t* provider,
+                                  http_engine_t* engine,
                                   const chat_message_t* messages,
                                   uint32_t message_count,
+                                  const tool_def_t* tools,
+                                  uint32_t tool_count,
                                   const char* model,
                                   double temperature,
-                                  void (*on_chunk)(const char* chunk, void* user_data),
+                                  provider_chat_callback_t on_done,
                                   void* user_data);
 static err_t anthropic_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count);
 static bool anthropic_supports_model(provider_t* provider, const char* model);
@@ -55,7 +84,10 @@ static const provider_vtable_t anthropic_vtable = {
     .disconnect = anthropic_disconnect,
     .is_connected = anthropic_is_connected,
     .chat = anthropic_chat,
-    .chat_stream = NULL, // TODO: Implement streaming
+    .chat_stream = anthropic_chat_stream,
+    .chat_stream_deltas = anthropic_chat_stream_deltas,
+    .chat_async = anthropic_chat_async,
+    .chat_stream_async = anthropic_chat_stream_async,
     .list_models = anthropic_list_models,
     .supports_model = anthropic_supports_model,
     .health_check = anthropic_health_check,
@@ -92,6 +124,7 @@ err_t anthropic_create(const provider_config_t* config, provider_t** out_provide
     // Create HTTP client
     http_client_config_t http_config = http_client_default_config();
     http_config.timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 60000;
+    http_config.compress_min_bytes = config->compress_requests ? HTTP_COMPRESS_MIN_BYTES_DEFAULT : 0;
     provider->http = http_client_create(&http_config);
     if (!provider->http) {
         free(provider);
@@ -174,103 +207,159 @@ static bool anthropic_is_connected(provider_t* provider) {
     return provider && provider->connected;
 }
 
-static char* build_anthropic_request(const provider_t* provider,
-                                     const chat_message_t* messages,
-                                     uint32_t message_count,
-                                     const tool_def_t* tools,
-                                     uint32_t tool_count,
-                                     const char* model,
-                                     double temperature) {
-    json_value_t* root = json_create_object();
-    if (!root) return NULL;
+static void write_cache_control(json_writer_t* w, const chat_message_t* message) {
+    if (message->cache_breakpoint) {
+        json_write_key(w, "cache_control");
+        json_write_object_begin(w);
+        json_write_kv_string(w, "type", "ephemeral");
+        json_write_object_end(w);
+    }
+}
 
-    const char* model_name = model ? model : DEFAULT_ANTHROPIC_MODEL;
-    json_object_set_string(root, "model", model_name);
-
-    // Build messages array for Anthropic
-    json_value_t* messages_arr = json_create_array();
-    for (uint32_t i = 0; i < message_count; i++) {
-        json_value_t* msg_obj = json_create_object();
-
-        // Convert role to Anthropic format
-        const char* role_str = "user";
-        switch (messages[i].role) {
-            case CHAT_ROLE_SYSTEM:
-                // Anthropic handles system messages differently
-                // We'll set it as the first user message with system content
-                role_str = "user";
-                break;
-            case CHAT_ROLE_USER: role_str = "user"; break;
-            case CHAT_ROLE_ASSISTANT: role_str = "assistant"; break;
-            case CHAT_ROLE_TOOL: role_str = "user"; break; // Anthropic doesn't have tool role
+// Text content block, marked as a prompt-cache breakpoint when requested
+static void write_text_block(json_writer_t* w, const chat_message_t* message) {
+    json_write_object_begin(w);
+    json_write_kv_string(w, "type", "text");
+    json_write_kv_str(w, "text", message->content);
+    write_cache_control(w, message);
+    json_write_object_end(w);
+}
+
+// Result of one tool call, answering the tool_use block with the same id
+static void write_tool_result_block(json_writer_t* w, const chat_message_t* message) {
+    json_write_object_begin(w);
+    json_write_kv_string(w, "type", "tool_result");
+    json_write_kv_str(w, "tool_use_id", message->tool_call_id);
+    json_write_kv_str(w, "content", message->content);
+    write_cache_control(w, message);
+    json_write_object_end(w);
+}
+
+// An assistant turn's OpenAI-shaped tool_calls as tool_use blocks
+static void write_tool_use_blocks(json_writer_t* w, str_t tool_calls, arena_allocator_t** scratch) {
+    if (!*scratch) {
+        *scratch = arena_create(4096);
+        arena_set_tag(*scratch, ALLOC_TAG_PROVIDER);
+    }
+
+    tool_call_t* calls = NULL;
+    uint32_t count = 0;
+    if (!*scratch || provider_parse_tool_calls(tool_calls, *scratch, &calls, &count) != ERR_OK) return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        json_write_object_begin(w);
+        json_write_kv_string(w, "type", "tool_use");
+        json_write_kv_str(w, "id", calls[i].id);
+        json_write_kv_str(w, "name", calls[i].name);
+
+        // input must be an object; the arguments string is its JSON text
+        str_t args = calls[i].arguments;
+        while (args.len > 0 && (args.data[0] == ' ' || args.data[0] == '\n')) {
+            args.data++;
+            args.len--;
         }
-        json_object_set_string(msg_obj, "role", role_str);
-
-        // Build content array (Anthropic uses array format)
-        json_value_t* content_arr = json_create_array();
-        json_value_t* text_block = json_create_object();
-        json_object_set_string(text_block, "type", "text");
-
-        if (messages[i].content.len > 0) {
-            // Create null-terminated copy
-            char* text_copy = malloc(messages[i].content.len + 1);
-            if (text_copy) {
-                memcpy(text_copy, messages[i].content.data, messages[i].content.len);
-                text_copy[messages[i].content.len] = '\0';
-                json_object_set_string(text_block, "text", text_copy);
-                free(text_copy);
-            } else {
-                json_object_set_string(text_block, "text", "");
-            }
+        json_write_key(w, "input");
+        if (args.len > 0 && args.data[0] == '{') {
+            json_write_raw(w, args.data, args.len);
         } else {
-            json_object_set_string(text_block, "text", "");
+            json_write_raw(w, "{}", 2);
         }
+        json_write_object_end(w);
+    }
+}
+
+char* anthropic_build_request(const provider_t* provider,
+                             const chat_message_t* messages,
+                             uint32_t message_count,
+                             const tool_def_t* tools,
+                             uint32_t tool_count,
+                             const char* model,
+                             double temperature,
+                             bool stream) {
+    json_writer_t w;
+    json_writer_init(&w, provider_estimate_request_size(messages, message_count));
 
-        json_array_append(content_arr, text_block);
-        json_object_set(msg_obj, "content", content_arr);
+    json_write_object_begin(&w);
 
-        json_array_append(messages_arr, msg_obj);
+    const char* model_name = model ? model : DEFAULT_ANTHROPIC_MODEL;
+    json_write_kv_string(&w, "model", model_name);
+
+    // Anthropic takes the leading system prompt as a top-level field; as a
+    // block it can carry a cache breakpoint covering tools and system
+    uint32_t first = 0;
+    if (message_count > 0 && messages[0].role == CHAT_ROLE_SYSTEM) {
+        if (messages[0].cache_breakpoint) {
+            json_write_key(&w, "system");
+            json_write_array_begin(&w);
+            write_text_block(&w, &messages[0]);
+            json_write_array_end(&w);
+        } else {
+            json_write_kv_str(&w, "system", messages[0].content);
+        }
+        first = 1;
     }
-    json_object_set(root, "messages", messages_arr);
+
+    // Build messages array for Anthropic (content as blocks). There are no
+    // system/tool roles inside messages: tool results are tool_result blocks
+    // of a user turn, a run of them sharing one turn.
+    arena_allocator_t* scratch = NULL;
+    json_write_key(&w, "messages");
+    json_write_array_begin(&w);
+    for (uint32_t i = first; i < message_count; i++) {
+        const chat_message_t* msg = &messages[i];
+        bool tool_result = msg->role == CHAT_ROLE_TOOL;
+        bool continues = tool_result && i > first && messages[i - 1].role == CHAT_ROLE_TOOL;
+        bool continued = tool_result && i + 1 < message_count && messages[i + 1].role == CHAT_ROLE_TOOL;
+
+        if (!continues) {
+            json_write_object_begin(&w);
+            json_write_kv_string(&w, "role", msg->role == CHAT_ROLE_ASSISTANT ? "assistant" : "user");
+            json_write_key(&w, "content");
+            json_write_array_begin(&w);
+        }
+
+        if (tool_result) {
+            write_tool_result_block(&w, msg);
+        } else {
+            bool calls = msg->role == CHAT_ROLE_ASSISTANT && !str_empty(msg->tool_calls);
+            // Empty text blocks are rejected, but a turn needs at least one block
+            if (!calls || !str_empty(msg->content)) write_text_block(&w, msg);
+            if (calls) write_tool_use_blocks(&w, msg->tool_calls, &scratch);
+        }
+
+        if (!continued) {
+            json_write_array_end(&w);
+            json_write_object_end(&w);
+        }
+    }
+    json_write_array_end(&w);
+    if (scratch) arena_destroy(scratch);
 
     // Set max_tokens (required for Anthropic)
     if (provider->impl_data) {
         anthropic_data_t* data = (anthropic_data_t*)provider->impl_data;
-        json_object_set_number(root, "max_tokens", (double)data->max_tokens);
+        json_write_kv_int(&w, "max_tokens", data->max_tokens);
     } else {
-        json_object_set_number(root, "max_tokens", 1024.0); // Default
+        json_write_kv_int(&w, "max_tokens", 1024); // Default
     }
 
     // Set temperature if in valid range
     if (temperature >= 0.0 && temperature <= 1.0) {
-        json_object_set_number(root, "temperature", temperature);
+        json_write_kv_number(&w, "temperature", temperature);
     }
 
-    // TODO: Add tools support for Anthropic
-    (void)tools;
-    (void)tool_count;
-
-    // Add system prompt if first message is system
-    if (message_count > 0 && messages[0].role == CHAT_ROLE_SYSTEM) {
-        // Create null-terminated copy
-        char* system_copy = malloc(messages[0].content.len + 1);
-        if (system_copy) {
-            memcpy(system_copy, messages[0].content.data, messages[0].content.len);
-            system_copy[messages[0].content.len] = '\0';
-            json_object_set_string(root, "system", system_copy);
-            free(system_copy);
-        }
-        // Remove the system message from messages array for Anthropic
-        // This is handled above by converting system to user role
+    if (stream) {
+        json_write_kv_bool(&w, "stream", true);
     }
 
-    char* json_str = json_print(root, false);
-    json_free(root);
-    return json_str;
+    provider_write_tools(&w, TOOL_DIALECT_ANTHROPIC, tools, tool_count);
+
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
 }
 
-static err_t parse_anthropic_response(const char* json_str, chat_response_t* response) {
-    json_value_t* root = json_parse(json_str);
+err_t anthropic_parse_response(char* json_str, size_t len, chat_response_t* response) {
+    json_value_t* root = json_parse_insitu(json_str, len);
     if (!root) return ERR_CONFIG_PARSE;
 
     json_object_t* obj = json_as_object(root);
@@ -313,9 +402,9 @@ static err_t parse_anthropic_response(const char* json_str, chat_response_t* res
                         if (strcmp(type, "text") == 0) {
                             const char* text = json_object_get_string(block_obj, "text", "");
                             if (text) {
-                                size_t len = strlen(text);
-                                memcpy(combined + offset, text, len);
-                                offset += len;
+                                size_t text_len = strlen(text);
+                                memcpy(combined + offset, text, text_len);
+                                offset += text_len;
                             }
                         }
                     }
@@ -327,6 +416,8 @@ static err_t parse_anthropic_response(const char* json_str, chat_response_t* res
         }
     }
 
+    provider_capture_tool_use(content, response);
+
     // Parse model
     const char* model = json_object_get_string(obj, "model", DEFAULT_ANTHROPIC_MODEL);
     response->model = (str_t){ .data = strdup(model), .len = strlen(model) };
@@ -335,16 +426,8 @@ static err_t parse_anthropic_response(const char* json_str, chat_response_t* res
     const char* stop_reason = json_object_get_string(obj, "stop_reason", "end_turn");
     response->finish_reason = (str_t){ .data = strdup(stop_reason), .len = strlen(stop_reason) };
 
-    // Parse usage
-    json_object_t* usage = json_object_get_object(obj, "usage");
-    if (usage) {
-        uint32_t input_tokens = (uint32_t)json_object_get_number(usage, "input_tokens", 0);
-        uint32_t output_tokens = (uint32_t)json_object_get_number(usage, "output_tokens", 0);
-        // Map to standard fields
-        response->prompt_tokens = input_tokens;
-        response->completion_tokens = output_tokens;
-        response->total_tokens = input_tokens + output_tokens;
-    }
+    // Parse usage, including prompt cache reads and writes
+    provider_parse_usage(json_object_get_object(obj, "usage"), response);
 
     json_free(root);
     return ERR_OK;
@@ -361,7 +444,7 @@ static err_t anthropic_chat(provider_t* provider,
     if (!provider || !provider->http || !out_response) return ERR_INVALID_ARGUMENT;
 
     // Build request JSON
-    char* request_body = build_anthropic_request(provider, messages, message_count, tools, tool_count, model, temperature);
+    char* request_body = anthropic_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     // Build URL
@@ -370,14 +453,11 @@ static err_t anthropic_chat(provider_t* provider,
 
     // Send request
     http_response_t* http_resp = NULL;
-    err_t err = http_post_json(provider->http, url, request_body, &http_resp);
+    // Rate limited; non-2xx statuses come back as provider errors
+    err_t err = provider_post_json(provider, url, request_body, &http_resp);
     free(request_body);
 
     if (err != ERR_OK) return err;
-    if (!http_response_is_success(http_resp)) {
-        http_response_free(http_resp);
-        return ERR_PROVIDER;
-    }
 
     // Parse response
     chat_response_t* response = calloc(1, sizeof(chat_response_t));
@@ -386,7 +466,9 @@ static err_t anthropic_chat(provider_t* provider,
         return ERR_OUT_OF_MEMORY;
     }
 
-    err = parse_anthropic_response(http_resp->body.data, response);
+    TRACE_BEGIN(parse_span, "provider.parse");
+    err = anthropic_parse_response(http_response_body(http_resp), http_resp->body.len, response);
+    TRACE_END(parse_span);
     http_response_free(http_resp);
 
     if (err != ERR_OK) {
@@ -398,6 +480,104 @@ static err_t anthropic_chat(provider_t* provider,
     return ERR_OK;
 }
 
+static err_t anthropic_chat_stream(provider_t* provider,
+                                   const chat_message_t* messages,
+                                   uint32_t message_count,
+                                   const char* model,
+                                   double temperature,
+                                   void (*on_chunk)(const char* chunk, void* user_data),
+                                   void* user_data) {
+    if (!provider || !provider->http || !on_chunk) return ERR_INVALID_ARGUMENT;
+
+    // Build streaming request
+    char* request_body = anthropic_build_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    // Build URL
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages", ANTHROPIC_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_ANTHROPIC,
+                                        NULL, on_chunk, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t anthropic_chat_stream_deltas(provider_t* provider,
+                                          const chat_message_t* messages,
+                                          uint32_t message_count,
+                                          const tool_def_t* tools,
+                                          uint32_t tool_count,
+                                          const char* model,
+                                          double temperature,
+                                          stream_delta_callback_t on_delta,
+                                          void* user_data) {
+    if (!provider || !provider->http || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = anthropic_build_request(provider, messages, message_count, tools, tool_count,
+                                                 model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages", ANTHROPIC_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_ANTHROPIC,
+                                        on_delta, NULL, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t anthropic_chat_stream_async(provider_t* provider,
+                                         http_engine_t* engine,
+                                         const chat_message_t* messages,
+                                         uint32_t message_count,
+                                         const char* model,
+                                         double temperature,
+                                         void (*on_chunk)(const char* chunk, void* user_data),
+                                         provider_stream_done_t on_done,
+                                         void* user_data) {
+    if (!provider || !provider->http || !engine || !on_chunk || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = anthropic_build_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages", ANTHROPIC_BASE_URL);
+
+    err_t err = provider_submit_stream_async(provider, engine, url, request_body, SSE_DIALECT_ANTHROPIC,
+                                             NULL, on_chunk, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t anthropic_chat_async(provider_t* provider,
+                                  http_engine_t* engine,
+                                  const chat_message_t* messages,
+                                  uint32_t message_count,
+                                  const tool_def_t* tools,
+                                  uint32_t tool_count,
+                                  const char* model,
+                                  double temperature,
+                                  provider_chat_callback_t on_done,
+                                  void* user_data) {
+    if (!provider || !provider->http || !engine || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = anthropic_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages", ANTHROPIC_BASE_URL);
+
+    err_t err = provider_submit_chat_async(provider, engine, url, request_body,
+                                           anthropic_parse_response, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
 static err_t anthropic_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count) {
     (void)provider;
     if (!out_models || !out_count) return ERR_INVALID_ARGUMENT;
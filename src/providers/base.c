@@ -4,9 +4,19 @@
 #include "providers/base.h"
 #include "providers/openai.h"
 #include "providers/anthropic.h"
+#include "providers/replay.h"
+#include "core/alloc.h"
+#include "core/trace.h"
+#include "core/metrics.h"
+#include "providers/ratelimit.h"
+#include "providers/singleflight.h"
+#include "json_config.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
 
 // Response helpers
 chat_response_t* chat_response_create(void) {
@@ -35,9 +45,22 @@ void chat_response_clear(chat_response_t* response) {
     memset(response, 0, sizeof(chat_response_t));
 }
 
+chat_response_t* chat_response_copy(const chat_response_t* response) {
+    if (!response) return NULL;
+
+    chat_response_t* copy = calloc(1, sizeof(chat_response_t));
+    if (!copy) return NULL;
+    *copy = *response;
+    copy->content = str_dup(response->content, NULL);
+    copy->finish_reason = str_dup(response->finish_reason, NULL);
+    copy->model = str_dup(response->model, NULL);
+    copy->tool_calls = str_dup(response->tool_calls, NULL);
+    return copy;
+}
+
 // Message helpers
 chat_message_t* chat_message_create(chat_role_t role, const char* content) {
-    chat_message_t* msg = calloc(1, sizeof(chat_message_t));
+    chat_message_t* msg = sizeclass_calloc(sizeof(chat_message_t));
     if (!msg) return NULL;
 
     msg->role = role;
@@ -56,7 +79,7 @@ void chat_message_free(chat_message_t* message) {
     free((void*)message->tool_calls.data);
     free((void*)message->tool_call_id.data);
 
-    free(message);
+    sizeclass_free(message, sizeof(chat_message_t));
 }
 
 void chat_message_array_free(chat_message_t* messages, uint32_t count) {
@@ -98,6 +121,7 @@ void tool_def_free(tool_def_t* tool) {
     free((void*)tool->name.data);
     free((void*)tool->description.data);
     free((void*)tool->parameters.data);
+    for (int d = 0; d < TOOL_DIALECT_COUNT; d++) free((void*)tool->json[d].data);
 
     free(tool);
 }
@@ -109,48 +133,385 @@ void tool_def_array_free(tool_def_t* tools, uint32_t count) {
         free((void*)tools[i].name.data);
         free((void*)tools[i].description.data);
         free((void*)tools[i].parameters.data);
+        for (int d = 0; d < TOOL_DIALECT_COUNT; d++) free((void*)tools[i].json[d].data);
     }
 
     free(tools);
 }
 
+static void write_tool_parameters(json_writer_t* w, const tool_def_t* tool) {
+    if (!str_empty(tool->parameters)) {
+        json_write_raw(w, tool->parameters.data, tool->parameters.len);
+    } else {
+        json_write_raw(w, "{\"type\":\"object\",\"properties\":{}}", 34);
+    }
+}
+
+static void write_tool_entry(json_writer_t* w, tool_dialect_t dialect, const tool_def_t* tool) {
+    json_write_object_begin(w);
+    if (dialect == TOOL_DIALECT_ANTHROPIC) {
+        json_write_kv_str(w, "name", tool->name);
+        json_write_kv_str(w, "description", tool->description);
+        json_write_key(w, "input_schema");
+        write_tool_parameters(w, tool);
+    } else {
+        json_write_kv_string(w, "type", "function");
+        json_write_key(w, "function");
+        json_write_object_begin(w);
+        json_write_kv_str(w, "name", tool->name);
+        json_write_kv_str(w, "description", tool->description);
+        json_write_key(w, "parameters");
+        write_tool_parameters(w, tool);
+        json_write_object_end(w);
+    }
+    json_write_object_end(w);
+}
+
+err_t tool_def_serialize(tool_def_t* tool) {
+    if (!tool) return ERR_INVALID_ARGUMENT;
+
+    for (int d = 0; d < TOOL_DIALECT_COUNT; d++) {
+        json_writer_t w;
+        json_writer_init(&w, 128 + tool->name.len + tool->description.len + tool->parameters.len);
+        write_tool_entry(&w, (tool_dialect_t)d, tool);
+
+        size_t len = 0;
+        char* json = json_writer_finish(&w, &len);
+        if (!json) return ERR_OUT_OF_MEMORY;
+
+        free((void*)tool->json[d].data);
+        tool->json[d] = (str_t){ .data = json, .len = (uint32_t)len };
+    }
+    return ERR_OK;
+}
+
+void provider_parse_usage(json_object_t* usage, chat_response_t* response) {
+    if (!usage || !response) return;
+
+    // Cache hits: OpenAI and OpenRouter nest them under prompt_tokens_details,
+    // DeepSeek reports prompt_cache_hit_tokens, Kimi a flat cached_tokens
+    json_object_t* details = json_object_get_object(usage, "prompt_tokens_details");
+    double cached = json_object_get_number(details, "cached_tokens", 0);
+    if (cached == 0) cached = json_object_get_number(usage, "prompt_cache_hit_tokens", 0);
+    if (cached == 0) cached = json_object_get_number(usage, "cached_tokens", 0);
+
+    if (json_object_has(usage, "input_tokens") || json_object_has(usage, "output_tokens")) {
+        // Anthropic: input_tokens excludes cache reads and writes
+        double read = json_object_get_number(usage, "cache_read_input_tokens", 0);
+        double write = json_object_get_number(usage, "cache_creation_input_tokens", 0);
+        response->prompt_tokens = (uint32_t)(json_object_get_number(usage, "input_tokens", 0) + read + write);
+        response->completion_tokens = (uint32_t)json_object_get_number(usage, "output_tokens", 0);
+        response->total_tokens = response->prompt_tokens + response->completion_tokens;
+        response->cached_tokens = (uint32_t)read;
+        response->cache_write_tokens = (uint32_t)write;
+        return;
+    }
+
+    response->prompt_tokens = (uint32_t)json_object_get_number(usage, "prompt_tokens", 0);
+    response->completion_tokens = (uint32_t)json_object_get_number(usage, "completion_tokens", 0);
+    response->total_tokens = (uint32_t)json_object_get_number(usage, "total_tokens",
+                                                             response->prompt_tokens + response->completion_tokens);
+    response->cached_tokens = (uint32_t)cached;
+}
+
+// ============================================================================
+// Tool calls
+// ============================================================================
+
+err_t provider_capture_tool_calls(json_object_t* message, chat_response_t* response) {
+    if (!message || !response) return ERR_INVALID_ARGUMENT;
+
+    json_value_t* calls = json_object_get(message, "tool_calls");
+    if (!json_is_array(calls) || json_array_length(json_as_array(calls)) == 0) return ERR_OK;
+
+    char* json = json_print(calls, false);
+    if (!json) return ERR_OUT_OF_MEMORY;
+
+    free((void*)response->tool_calls.data);
+    response->tool_calls = (str_t){ .data = json, .len = (uint32_t)strlen(json) };
+    return ERR_OK;
+}
+
+err_t provider_capture_tool_use(json_array_t* content, chat_response_t* response) {
+    if (!response) return ERR_INVALID_ARGUMENT;
+
+    size_t length = json_array_length(content);
+    json_writer_t w;
+    json_writer_init(&w, 256);
+    json_write_array_begin(&w);
+
+    // Same shape as an OpenAI message.tool_calls; input becomes the arguments string
+    uint32_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        json_object_t* block = json_as_object(json_array_get(content, i));
+        if (strcmp(json_object_get_string(block, "type", ""), "tool_use") != 0) continue;
+
+        json_value_t* input = json_object_get(block, "input");
+        char* arguments = input ? json_print(input, false) : NULL;
+
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "id", json_object_get_string(block, "id", ""));
+        json_write_kv_string(&w, "type", "function");
+        json_write_key(&w, "function");
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "name", json_object_get_string(block, "name", ""));
+        json_write_kv_string(&w, "arguments", arguments ? arguments : "{}");
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+
+        free(arguments);
+        count++;
+    }
+    json_write_array_end(&w);
+
+    if (count == 0) {
+        json_writer_free(&w);
+        return ERR_OK;
+    }
+
+    size_t len = 0;
+    char* json = json_writer_finish(&w, &len);
+    if (!json) return ERR_OUT_OF_MEMORY;
+
+    free((void*)response->tool_calls.data);
+    response->tool_calls = (str_t){ .data = json, .len = (uint32_t)len };
+    return ERR_OK;
+}
+
+err_t provider_parse_chat_response(char* json_str, size_t len, const char* default_model,
+                                   chat_response_t* response) {
+    if (!json_str || !response) return ERR_INVALID_ARGUMENT;
+
+    json_value_t* root = json_parse_insitu(json_str, len);
+    json_object_t* obj = json_as_object(root);
+    if (!obj) {
+        json_free(root);
+        return ERR_CONFIG_PARSE;
+    }
+
+    json_array_t* choices = json_object_get_array(obj, "choices");
+    json_object_t* choice = json_as_object(json_array_get(choices, 0));
+    if (choice) {
+        json_object_t* message = json_object_get_object(choice, "message");
+        if (message) {
+            // content is null when the model only calls tools
+            const char* content = json_object_get_string(message, "content", "");
+            response->content = str_dup_cstr(content ? content : "", NULL);
+            provider_capture_tool_calls(message, response);
+        }
+        response->finish_reason = str_dup_cstr(json_object_get_string(choice, "finish_reason", "stop"), NULL);
+    }
+
+    response->model = str_dup_cstr(json_object_get_string(obj, "model", default_model), NULL);
+    provider_parse_usage(json_object_get_object(obj, "usage"), response);
+
+    json_free(root);
+    return ERR_OK;
+}
+
+static str_t arena_cstr(arena_allocator_t* arena, const char* s) {
+    if (!s) return STR_NULL;
+    return str_dup_cstr(s, &arena->base);
+}
+
+err_t provider_parse_tool_calls(str_t json, arena_allocator_t* arena,
+                                tool_call_t** out_calls, uint32_t* out_count) {
+    if (!arena || !out_calls || !out_count) return ERR_INVALID_ARGUMENT;
+
+    *out_calls = NULL;
+    *out_count = 0;
+    if (str_empty(json)) return ERR_OK;
+
+    // The tree lives in the arena, so strings are borrowed, not copied
+    json_value_t* root = json_parse_arena(json.data, json.len, arena);
+    json_array_t* array = json_as_array(root);
+    if (!array) {
+        json_free(root);
+        return ERR_CONFIG_PARSE;
+    }
+
+    size_t length = json_array_length(array);
+    tool_call_t* calls = length ? alloc(&arena->base, length * sizeof(tool_call_t)) : NULL;
+    if (length && !calls) {
+        json_free(root);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        json_object_t* call = json_as_object(json_array_get(array, i));
+        json_object_t* function = json_object_get_object(call, "function");
+        const char* name = json_object_get_string(function, "name", NULL);
+        if (!name || !*name) continue;
+
+        tool_call_t* out = &calls[count++];
+        out->id = STR_VIEW(json_object_get_string(call, "id", ""));
+        out->name = STR_VIEW(name);
+
+        // Arguments are normally a JSON-encoded string; some backends send the object
+        json_value_t* args = json_object_get(function, "arguments");
+        if (json_is_string(args)) {
+            out->arguments = STR_VIEW(json_as_string(args, ""));
+        } else if (args && !json_is_null(args)) {
+            char* printed = json_print(args, false);
+            out->arguments = arena_cstr(arena, printed);
+            free(printed);
+        } else {
+            out->arguments = STR_NULL;
+        }
+    }
+
+    json_free(root);
+    *out_calls = calls;
+    *out_count = count;
+    return ERR_OK;
+}
+
+void tool_call_builder_init(tool_call_builder_t* builder) {
+    memset(builder, 0, sizeof(tool_call_builder_t));
+}
+
+void tool_call_builder_free(tool_call_builder_t* builder) {
+    if (!builder) return;
+    for (uint32_t i = 0; i < builder->count; i++) {
+        free(builder->slots[i].id);
+        free(builder->slots[i].name);
+        free(builder->slots[i].arguments);
+    }
+    free(builder->slots);
+    tool_call_builder_init(builder);
+}
+
+static char* builder_strdup(str_t s) {
+    char* copy = malloc(s.len + 1);
+    if (copy) {
+        memcpy(copy, s.data, s.len);
+        copy[s.len] = '\0';
+    }
+    return copy;
+}
+
+// Follows brace nesting so a caller can act on a call whose arguments are
+// complete before the rest of the message arrives
+static void builder_scan(tool_call_builder_slot_t* slot, str_t fragment) {
+    for (uint32_t i = 0; i < fragment.len; i++) {
+        char c = fragment.data[i];
+        if (slot->in_string) {
+            if (slot->escaped) slot->escaped = false;
+            else if (c == '\\') slot->escaped = true;
+            else if (c == '"') slot->in_string = false;
+        } else if (c == '"') {
+            slot->in_string = true;
+        } else if (c == '{') {
+            slot->depth++;
+        } else if (c == '}' && slot->depth > 0 && --slot->depth == 0) {
+            slot->closed = true;
+        }
+    }
+}
+
+err_t tool_call_builder_feed(tool_call_builder_t* builder, const stream_delta_t* delta) {
+    if (!builder || !delta) return ERR_INVALID_ARGUMENT;
+    if (delta->type != STREAM_DELTA_TOOL_CALL) return ERR_OK;
+
+    // Indices are small and dense in practice; grow to cover this one
+    uint32_t index = delta->tool_index;
+    if (index >= builder->count) {
+        tool_call_builder_slot_t* slots = realloc(builder->slots, (index + 1) * sizeof(tool_call_builder_slot_t));
+        if (!slots) return ERR_OUT_OF_MEMORY;
+        memset(slots + builder->count, 0, (index + 1 - builder->count) * sizeof(tool_call_builder_slot_t));
+        builder->slots = slots;
+        builder->count = index + 1;
+    }
+
+    tool_call_builder_slot_t* slot = &builder->slots[index];
+    if (!slot->id && !str_empty(delta->tool_id)) {
+        slot->id = builder_strdup(delta->tool_id);
+        if (!slot->id) return ERR_OUT_OF_MEMORY;
+    }
+    if (!slot->name && !str_empty(delta->tool_name)) {
+        slot->name = builder_strdup(delta->tool_name);
+        if (!slot->name) return ERR_OUT_OF_MEMORY;
+    }
+
+    if (!str_empty(delta->tool_arguments)) {
+        size_t needed = slot->arguments_len + delta->tool_arguments.len + 1;
+        if (needed > slot->arguments_cap) {
+            size_t cap = slot->arguments_cap ? slot->arguments_cap : 128;
+            while (cap < needed) cap *= 2;
+            char* arguments = realloc(slot->arguments, cap);
+            if (!arguments) return ERR_OUT_OF_MEMORY;
+            slot->arguments = arguments;
+            slot->arguments_cap = cap;
+        }
+        memcpy(slot->arguments + slot->arguments_len, delta->tool_arguments.data, delta->tool_arguments.len);
+        slot->arguments_len += delta->tool_arguments.len;
+        slot->arguments[slot->arguments_len] = '\0';
+        builder_scan(slot, delta->tool_arguments);
+    }
+
+    return ERR_OK;
+}
+
+err_t tool_call_builder_finish(tool_call_builder_t* builder, str_t* out_json) {
+    if (!builder || !out_json) return ERR_INVALID_ARGUMENT;
+    *out_json = STR_NULL;
+
+    size_t estimate = 2;
+    uint32_t named = 0;
+    for (uint32_t i = 0; i < builder->count; i++) {
+        if (!builder->slots[i].name) continue;
+        estimate += 96 + builder->slots[i].arguments_len * 2;
+        named++;
+    }
+    if (named == 0) return ERR_OK;
+
+    json_writer_t w;
+    json_writer_init(&w, estimate);
+    json_write_array_begin(&w);
+    for (uint32_t i = 0; i < builder->count; i++) {
+        const tool_call_builder_slot_t* slot = &builder->slots[i];
+        if (!slot->name) continue;
+
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "id", slot->id ? slot->id : "");
+        json_write_kv_string(&w, "type", "function");
+        json_write_key(&w, "function");
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "name", slot->name);
+        json_write_key(&w, "arguments");
+        json_write_string_len(&w, slot->arguments ? slot->arguments : "{}",
+                              slot->arguments ? slot->arguments_len : 2);
+        json_write_object_end(&w);
+        json_write_object_end(&w);
+    }
+    json_write_array_end(&w);
+
+    size_t len = 0;
+    char* json = json_writer_finish(&w, &len);
+    if (!json) return ERR_OUT_OF_MEMORY;
+
+    *out_json = (str_t){ .data = json, .len = (uint32_t)len };
+    return ERR_OK;
+}
+
 // Provider registry (simple implementation)
 typedef struct {
     const char* name;
     const provider_vtable_t* vtable;
 } provider_entry_t;
 
+// Built-ins are registered on first use, not at startup, so a one-shot
+// command only pays for the registries it touches. Registration and
+// lookups take the lock; the initialized flag is the unlocked fast path.
 #define MAX_PROVIDERS 16
 static provider_entry_t g_registry[MAX_PROVIDERS];
 static uint32_t g_provider_count = 0;
 static bool g_registry_initialized = false;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
-err_t provider_registry_init(void) {
-    if (g_registry_initialized) return ERR_OK;
-
-    memset(g_registry, 0, sizeof(g_registry));
-    g_provider_count = 0;
-    g_registry_initialized = true;
-
-    // Register built-in providers
-    provider_register("openrouter", openrouter_get_vtable());
-    provider_register("deepseek", deepseek_get_vtable());
-    provider_register("kimi", kimi_get_vtable());
-    provider_register("openai", openai_get_vtable());
-    provider_register("anthropic", anthropic_get_vtable());
-
-    return ERR_OK;
-}
-
-void provider_registry_shutdown(void) {
-    memset(g_registry, 0, sizeof(g_registry));
-    g_provider_count = 0;
-    g_registry_initialized = false;
-}
-
-err_t provider_register(const char* name, const provider_vtable_t* vtable) {
-    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) provider_registry_init();
+// Caller holds g_registry_lock
+static err_t registry_add(const char* name, const provider_vtable_t* vtable) {
     if (g_provider_count >= MAX_PROVIDERS) return ERR_OUT_OF_MEMORY;
 
     // Check for duplicates
@@ -167,30 +528,86 @@ err_t provider_register(const char* name, const provider_vtable_t* vtable) {
     return ERR_OK;
 }
 
-err_t provider_create(const char* name, const provider_config_t* config, provider_t** out_provider) {
-    if (!name || !config || !out_provider) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) provider_registry_init();
+static const provider_vtable_t* registry_lookup(const char* name) {
+    const provider_vtable_t* vtable = NULL;
 
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_provider_count; i++) {
         if (strcmp(g_registry[i].name, name) == 0) {
-            return g_registry[i].vtable->create(config, out_provider);
+            vtable = g_registry[i].vtable;
+            break;
         }
     }
+    pthread_mutex_unlock(&g_registry_lock);
 
-    return ERR_NOT_FOUND;
+    return vtable;
+}
+
+err_t provider_registry_init(void) {
+    if (__atomic_load_n(&g_registry_initialized, __ATOMIC_ACQUIRE)) return ERR_OK;
+
+    pthread_mutex_lock(&g_registry_lock);
+    if (!g_registry_initialized) {
+        memset(g_registry, 0, sizeof(g_registry));
+        g_provider_count = 0;
+
+        // Register built-in providers
+        registry_add("openrouter", openrouter_get_vtable());
+        registry_add("deepseek", deepseek_get_vtable());
+        registry_add("kimi", kimi_get_vtable());
+        registry_add("openai", openai_get_vtable());
+        registry_add("anthropic", anthropic_get_vtable());
+        registry_add("replay", replay_get_vtable());
+
+        __atomic_store_n(&g_registry_initialized, true, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return ERR_OK;
+}
+
+void provider_registry_shutdown(void) {
+    pthread_mutex_lock(&g_registry_lock);
+    memset(g_registry, 0, sizeof(g_registry));
+    g_provider_count = 0;
+    __atomic_store_n(&g_registry_initialized, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+err_t provider_register(const char* name, const provider_vtable_t* vtable) {
+    if (!name || !vtable) return ERR_INVALID_ARGUMENT;
+    provider_registry_init();
+
+    pthread_mutex_lock(&g_registry_lock);
+    err_t err = registry_add(name, vtable);
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return err;
+}
+
+err_t provider_create(const char* name, const provider_config_t* config, provider_t** out_provider) {
+    if (!name || !config || !out_provider) return ERR_INVALID_ARGUMENT;
+    provider_registry_init();
+
+    const provider_vtable_t* vtable = registry_lookup(name);
+    if (!vtable) return ERR_NOT_FOUND;
+
+    return vtable->create(config, out_provider);
 }
 
 err_t provider_registry_list(const char*** out_names, uint32_t* out_count) {
     if (!out_names || !out_count) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) provider_registry_init();
+    provider_registry_init();
 
     static const char* names[MAX_PROVIDERS];
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_provider_count; i++) {
         names[i] = g_registry[i].name;
     }
+    *out_count = g_provider_count;
+    pthread_mutex_unlock(&g_registry_lock);
 
     *out_names = names;
-    *out_count = g_provider_count;
 
     return ERR_OK;
 }
@@ -213,6 +630,96 @@ void provider_free(provider_t* provider) {
     }
 }
 
+err_t provider_prewarm(provider_t* provider) {
+    if (!provider || !provider->vtable) return ERR_INVALID_ARGUMENT;
+    if (provider->vtable->prewarm) return provider->vtable->prewarm(provider);
+    if (!provider->http || str_empty(provider->config.base_url)) return ERR_OK;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%.*s", (int)provider->config.base_url.len, provider->config.base_url.data);
+    return http_client_prewarm(provider->http, url);
+}
+
+typedef struct prewarm_task_t {
+    provider_t* provider;
+    pthread_t thread;
+    bool started;
+    err_t err;
+} prewarm_task_t;
+
+static void* prewarm_main(void* arg) {
+    prewarm_task_t* task = arg;
+    task->err = provider_prewarm(task->provider);
+    return NULL;
+}
+
+err_t provider_prewarm_all(provider_t* const* providers, uint32_t count) {
+    if (!providers && count > 0) return ERR_INVALID_ARGUMENT;
+    if (count == 1) return provider_prewarm(providers[0]);
+
+    prewarm_task_t* tasks = calloc(count, sizeof(prewarm_task_t));
+    if (!tasks) return ERR_OUT_OF_MEMORY;
+
+    // Handshakes overlap, so startup pays for the slowest host only
+    for (uint32_t i = 0; i < count; i++) {
+        tasks[i].provider = providers[i];
+        tasks[i].started = pthread_create(&tasks[i].thread, NULL, prewarm_main, &tasks[i]) == 0;
+        if (!tasks[i].started) prewarm_main(&tasks[i]);
+    }
+
+    err_t err = ERR_OK;
+    for (uint32_t i = 0; i < count; i++) {
+        if (tasks[i].started) pthread_join(tasks[i].thread, NULL);
+        if (err == ERR_OK) err = tasks[i].err;
+    }
+    free(tasks);
+    return err;
+}
+
+// ============================================================================
+// Rate-limited requests
+// ============================================================================
+
+static void sleep_for_ms(uint64_t ms) {
+    if (!ms) return;
+    struct timespec ts = { .tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0) {}
+}
+
+static uint64_t provider_limit_key(provider_t* provider) {
+    str_t name = provider->config.name;
+    if (str_empty(name) && provider->vtable && provider->vtable->get_name) name = provider->vtable->get_name();
+    return rate_limit_key(name, provider->config.api_key);
+}
+
+// Feed a response into the key's bucket and map its status
+static err_t provider_note_response(uint64_t limit_key, http_response_t* response) {
+    rate_limit_info_t info;
+    rate_limit_parse(response, &info);
+    rate_limit_update(limit_key, response->status_code, &info);
+    return http_response_is_success(response) ? ERR_OK : rate_limit_status_error(response->status_code);
+}
+
+err_t provider_post_json(provider_t* provider, const char* url, const char* request_body,
+                         http_response_t** out_response) {
+    if (!provider || !provider->http || !url || !out_response) return ERR_INVALID_ARGUMENT;
+
+    uint64_t limit_key = provider_limit_key(provider);
+    sleep_for_ms(rate_limit_reserve(limit_key));
+
+    http_response_t* response = NULL;
+    err_t err = http_post_json(provider->http, url, request_body, &response);
+    if (err != ERR_OK) return err;
+
+    err = provider_note_response(limit_key, response);
+    if (err != ERR_OK) {
+        http_response_free(response);
+        return err;
+    }
+    *out_response = response;
+    return ERR_OK;
+}
+
 err_t provider_chat_with_retry(provider_t* provider,
                                const chat_message_t* messages,
                                uint32_t message_count,
@@ -228,63 +735,989 @@ err_t provider_chat_with_retry(provider_t* provider,
     }
 
     if (max_retries == 0) {
-        // No retry requested, just call the provider directly
-        return provider->vtable->chat(provider, messages, message_count,
-                                     tools, tool_count, model, temperature,
-                                     out_response);
+        // No retry requested, just one (possibly hedged) attempt
+        return provider_chat_hedged(provider, NULL, messages, message_count,
+                                    tools, tool_count, model, temperature,
+                                    out_response);
     }
 
+    // 429s wait out the server's pause; other failures back off with jitter
+    retry_policy_t policy = { .max_retries = max_retries, .base_delay_ms = retry_delay_ms,
+                              .max_delay_ms = RETRY_MAX_DELAY_MS };
+    uint64_t limit_key = provider_limit_key(provider);
     err_t last_error = ERR_OK;
-    uint64_t current_delay = retry_delay_ms;
 
     for (uint32_t attempt = 0; attempt <= max_retries; attempt++) {
-        // Wait before retry (except first attempt)
         if (attempt > 0) {
-            // Simple sleep - in production would use async/non-blocking
-            struct timespec ts = {
-                .tv_sec = current_delay / 1000,
-                .tv_nsec = (current_delay % 1000) * 1000000
-            };
-            nanosleep(&ts, NULL);
-
-            // Exponential backoff
-            current_delay *= 2;
+            sleep_for_ms(retry_backoff_ms(&policy, attempt - 1, rate_limit_blocked_ms(limit_key)));
         }
 
-        // Try the chat request
-        err_t err = provider->vtable->chat(provider, messages, message_count,
-                                          tools, tool_count, model, temperature,
-                                          out_response);
-
+        err_t err = provider_chat_hedged(provider, NULL, messages, message_count,
+                                         tools, tool_count, model, temperature,
+                                         out_response);
         if (err == ERR_OK) {
             return ERR_OK;
         }
 
         last_error = err;
+        if (!retry_is_retryable(err)) return err;
+    }
+
+    return last_error;
+}
+
+// Async chat dispatch
+// ============================================================================
+// Hedged requests
+// ============================================================================
+
+static pthread_mutex_t g_hedge_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t g_hedge_budget = PROVIDER_HEDGE_BUDGET_PER_MIN;
+static double g_hedge_tokens = PROVIDER_HEDGE_BUDGET_PER_MIN;
+static uint64_t g_hedge_refill_ms;
+static uint64_t g_hedge_tags;
+
+static uint64_t hedge_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
 
-        // Check if error is retryable
-        // Some errors like invalid input shouldn't be retried
-        switch (err) {
-            case ERR_NETWORK:
-            case ERR_TIMEOUT:
-            case ERR_PROVIDER:
-            case ERR_PROVIDER_UNAVAILABLE:
-            case ERR_CONNECTION_FAILED:
-            case ERR_CONNECTION_TIMEOUT:
-            case ERR_HTTP_ERROR:
-            case ERR_RATE_LIMITED:
-                // These are retryable
-                break;
-            case ERR_INVALID_ARGUMENT:
-            case ERR_OUT_OF_MEMORY:
-            case ERR_PROVIDER_AUTH:
-            case ERR_AUTH_FAILED:
-            case ERR_INVALID_TOKEN:
-            default:
-                // Not retryable
-                return err;
+void provider_set_hedge_budget(uint32_t per_minute) {
+    pthread_mutex_lock(&g_hedge_lock);
+    __atomic_store_n(&g_hedge_budget, per_minute, __ATOMIC_RELAXED);
+    g_hedge_tokens = per_minute;
+    g_hedge_refill_ms = hedge_now_ms();
+    pthread_mutex_unlock(&g_hedge_lock);
+}
+
+// Token bucket refilled continuously at the per-minute rate
+static bool hedge_budget_take(void) {
+    pthread_mutex_lock(&g_hedge_lock);
+    uint64_t now = hedge_now_ms();
+    if (g_hedge_refill_ms) {
+        g_hedge_tokens += (double)(now - g_hedge_refill_ms) * g_hedge_budget / 60000.0;
+        if (g_hedge_tokens > g_hedge_budget) g_hedge_tokens = g_hedge_budget;
+    }
+    g_hedge_refill_ms = now;
+    bool ok = g_hedge_tokens >= 1.0;
+    if (ok) g_hedge_tokens -= 1.0;
+    pthread_mutex_unlock(&g_hedge_lock);
+    return ok;
+}
+
+static str_t hedge_provider_name(provider_t* provider) {
+    str_t name = provider->config.name;
+    if (str_empty(name) && provider->vtable->get_name) name = provider->vtable->get_name();
+    return name;
+}
+
+// p95 of the latency the agent has observed for this provider and model;
+// 0 = not enough samples to hedge
+static uint64_t hedge_delay_ms(provider_t* provider, const char* model) {
+    if (!__atomic_load_n(&g_hedge_budget, __ATOMIC_RELAXED)) return 0;
+
+    str_t model_name = model ? STR_VIEW(model) : provider->config.default_model;
+    metric_t* latency = metric_get(&METRIC_PROVIDER_LATENCY, hedge_provider_name(provider), model_name);
+    if (metric_count(latency) < PROVIDER_HEDGE_MIN_SAMPLES) return 0;
+
+    uint64_t delay_ms = metric_quantile(latency, 0.95) / 1000;
+    return delay_ms > PROVIDER_HEDGE_MIN_DELAY_MS ? delay_ms : PROVIDER_HEDGE_MIN_DELAY_MS;
+}
+
+typedef struct hedge_race_t {
+    http_engine_t* engine;
+    uint64_t tags[2];
+    uint32_t outstanding;
+    bool done;
+    int winner;
+    err_t err;
+    chat_response_t* response;
+} hedge_race_t;
+
+typedef struct hedge_attempt_t {
+    hedge_race_t* race;
+    int slot;
+} hedge_attempt_t;
+
+static void hedge_on_done(err_t err, chat_response_t* response, void* user_data) {
+    hedge_attempt_t* attempt = (hedge_attempt_t*)user_data;
+    hedge_race_t* race = attempt->race;
+    race->outstanding--;
+
+    if (race->done) {
+        // Lost the race, or cancelled because of it
+        if (response) chat_response_free(response);
+        return;
+    }
+    if (err != ERR_OK) {
+        race->err = err;
+        return;
+    }
+
+    race->done = true;
+    race->winner = attempt->slot;
+    race->response = response;
+    http_engine_cancel(race->engine, race->tags[1 - attempt->slot]);
+}
+
+static err_t hedge_submit(hedge_race_t* race, hedge_attempt_t* attempt, provider_t* provider,
+                          const chat_message_t* messages, uint32_t message_count,
+                          const tool_def_t* tools, uint32_t tool_count,
+                          const char* model, double temperature) {
+    race->outstanding++;
+    http_engine_set_tag(race->engine, race->tags[attempt->slot]);
+    err_t err = provider->vtable->chat_async(provider, race->engine, messages, message_count,
+                                             tools, tool_count, model, temperature,
+                                             hedge_on_done, attempt);
+    http_engine_set_tag(race->engine, 0);
+    if (err != ERR_OK) race->outstanding--;
+    return err;
+}
+
+static err_t chat_hedged(provider_t* provider,
+                         provider_t* hedge_provider,
+                         const chat_message_t* messages,
+                         uint32_t message_count,
+                         const tool_def_t* tools,
+                         uint32_t tool_count,
+                         const char* model,
+                         double temperature,
+                         chat_response_t** out_response) {
+
+    uint64_t delay_ms = hedge_delay_ms(provider, model);
+    http_engine_t* engine = delay_ms ? http_engine_thread() : NULL;
+    if (!engine || !provider->vtable->chat_async || !hedge_provider->vtable->chat_async) {
+        return provider->vtable->chat(provider, messages, message_count, tools, tool_count,
+                                      model, temperature, out_response);
+    }
+
+    uint64_t tag = __atomic_add_fetch(&g_hedge_tags, 2, __ATOMIC_RELAXED);
+    hedge_race_t race = { .engine = engine, .tags = { tag - 1, tag }, .err = ERR_PROVIDER };
+    hedge_attempt_t attempts[2] = { { &race, 0 }, { &race, 1 } };
+
+    err_t err = hedge_submit(&race, &attempts[0], provider, messages, message_count,
+                             tools, tool_count, model, temperature);
+    if (err != ERR_OK) return err;
+
+    uint64_t hedge_at = hedge_now_ms() + delay_ms;
+    bool hedged = false;
+    while (!race.done && race.outstanding > 0) {
+        uint64_t now = hedge_now_ms();
+        if (!hedged && now >= hedge_at) {
+            // Only one chance to hedge; without budget the primary runs alone
+            hedged = true;
+            if (hedge_budget_take() &&
+                hedge_submit(&race, &attempts[1], hedge_provider, messages, message_count,
+                             tools, tool_count, model, temperature) == ERR_OK) {
+                metric_inc(metric_get(&METRIC_PROVIDER_HEDGES, hedge_provider_name(provider), STR_LIT("sent")), 1);
+            }
+            continue;
         }
+        uint32_t wait_ms = hedged ? HTTP_ENGINE_WAIT_FOREVER : (uint32_t)(hedge_at - now);
+        http_engine_run_once(engine, wait_ms);
     }
 
-    return last_error;
+    if (!race.done) return race.err;
+    if (hedged && race.winner == 1) {
+        metric_inc(metric_get(&METRIC_PROVIDER_HEDGES, hedge_provider_name(provider), STR_LIT("won")), 1);
+    }
+    *out_response = race.response;
+    return ERR_OK;
+}
+
+// Arguments of a request that may be shared with identical callers
+typedef struct chat_call_t {
+    provider_t* provider;
+    provider_t* hedge_provider;
+    const chat_message_t* messages;
+    uint32_t message_count;
+    const tool_def_t* tools;
+    uint32_t tool_count;
+    const char* model;
+    double temperature;
+} chat_call_t;
+
+static err_t chat_call_hedged(void* ctx, chat_response_t** out_response) {
+    chat_call_t* call = ctx;
+    return chat_hedged(call->provider, call->hedge_provider, call->messages, call->message_count,
+                       call->tools, call->tool_count, call->model, call->temperature, out_response);
+}
+
+err_t provider_chat_hedged(provider_t* provider,
+                           provider_t* hedge_provider,
+                           const chat_message_t* messages,
+                           uint32_t message_count,
+                           const tool_def_t* tools,
+                           uint32_t tool_count,
+                           const char* model,
+                           double temperature,
+                           chat_response_t** out_response) {
+    if (!provider || !provider->vtable || !provider->vtable->chat || !out_response) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    chat_call_t call = {
+        .provider = provider, .hedge_provider = hedge_provider ? hedge_provider : provider,
+        .messages = messages, .message_count = message_count, .tools = tools, .tool_count = tool_count,
+        .model = model, .temperature = temperature
+    };
+    uint8_t key[SINGLEFLIGHT_KEY_BYTES];
+    singleflight_chat_key(provider, messages, message_count, tools, tool_count, model, temperature, key);
+    return singleflight_chat(key, chat_call_hedged, &call, out_response);
+}
+
+err_t provider_chat_async(provider_t* provider,
+                          http_engine_t* engine,
+                          const chat_message_t* messages,
+                          uint32_t message_count,
+                          const tool_def_t* tools,
+                          uint32_t tool_count,
+                          const char* model,
+                          double temperature,
+                          provider_chat_callback_t on_done,
+                          void* user_data) {
+    if (!provider || !provider->vtable || !on_done) return ERR_INVALID_ARGUMENT;
+
+    if (provider->vtable->chat_async) {
+        return provider->vtable->chat_async(provider, engine, messages, message_count,
+                                            tools, tool_count, model, temperature,
+                                            on_done, user_data);
+    }
+
+    if (!provider->vtable->chat) return ERR_NOT_IMPLEMENTED;
+
+    chat_response_t* response = NULL;
+    err_t err = provider->vtable->chat(provider, messages, message_count, tools, tool_count,
+                                       model, temperature, &response);
+    on_done(err, err == ERR_OK ? response : NULL, user_data);
+    return ERR_OK;
+}
+
+err_t provider_chat_stream_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const char* model,
+                                 double temperature,
+                                 void (*on_chunk)(const char* chunk, void* user_data),
+                                 provider_stream_done_t on_done,
+                                 void* user_data) {
+    if (!provider || !provider->vtable || !on_chunk || !on_done) return ERR_INVALID_ARGUMENT;
+
+    if (provider->vtable->chat_stream_async) {
+        return provider->vtable->chat_stream_async(provider, engine, messages, message_count,
+                                                   model, temperature, on_chunk, on_done, user_data);
+    }
+
+    if (!provider->vtable->chat_stream) return ERR_NOT_IMPLEMENTED;
+
+    err_t err = provider->vtable->chat_stream(provider, messages, message_count, model,
+                                              temperature, on_chunk, user_data);
+    on_done(err, user_data);
+    return ERR_OK;
+}
+
+// Adapts a text-only chat_stream to typed deltas
+typedef struct {
+    stream_delta_callback_t on_delta;
+    void* user_data;
+} text_delta_adapter_t;
+
+static void text_delta_adapter_chunk(const char* chunk, void* user_data) {
+    text_delta_adapter_t* adapter = (text_delta_adapter_t*)user_data;
+    stream_delta_t delta = {
+        .type = STREAM_DELTA_TEXT,
+        .text = { .data = chunk, .len = (uint32_t)strlen(chunk) }
+    };
+    adapter->on_delta(&delta, adapter->user_data);
+}
+
+static err_t chat_call_stream(void* ctx, stream_delta_callback_t on_delta, void* user_data) {
+    chat_call_t* call = ctx;
+    provider_t* provider = call->provider;
+    const chat_message_t* messages = call->messages;
+    uint32_t message_count = call->message_count;
+    const char* model = call->model;
+    double temperature = call->temperature;
+
+    if (provider->vtable->chat_stream_deltas) {
+        return provider->vtable->chat_stream_deltas(provider, messages, message_count,
+                                                    call->tools, call->tool_count, model, temperature,
+                                                    on_delta, user_data);
+    }
+
+    text_delta_adapter_t adapter = { .on_delta = on_delta, .user_data = user_data };
+    err_t err = provider->vtable->chat_stream(provider, messages, message_count, model,
+                                              temperature, text_delta_adapter_chunk, &adapter);
+    if (err == ERR_OK) {
+        stream_delta_t done = { .type = STREAM_DELTA_DONE };
+        on_delta(&done, user_data);
+    }
+    return err;
+}
+
+err_t provider_chat_stream_deltas(provider_t* provider,
+                                  const chat_message_t* messages,
+                                  uint32_t message_count,
+                                  const tool_def_t* tools,
+                                  uint32_t tool_count,
+                                  const char* model,
+                                  double temperature,
+                                  stream_delta_callback_t on_delta,
+                                  void* user_data) {
+    if (!provider || !provider->vtable || !on_delta) return ERR_INVALID_ARGUMENT;
+    if (!provider->vtable->chat_stream_deltas && !provider->vtable->chat_stream) return ERR_NOT_IMPLEMENTED;
+
+    chat_call_t call = {
+        .provider = provider, .messages = messages, .message_count = message_count,
+        .tools = tools, .tool_count = tool_count, .model = model, .temperature = temperature
+    };
+    uint8_t key[SINGLEFLIGHT_KEY_BYTES];
+    singleflight_chat_key(provider, messages, message_count, tools, tool_count, model, temperature, key);
+    return singleflight_stream(key, chat_call_stream, &call, on_delta, user_data);
+}
+
+// Pending async chat
+typedef struct {
+    provider_parse_fn_t parse;
+    provider_chat_callback_t on_done;
+    void* user_data;
+    uint64_t limit_key;
+} async_chat_ctx_t;
+
+static void async_chat_done(err_t err, http_response_t* http_resp, void* user_data) {
+    async_chat_ctx_t* ctx = (async_chat_ctx_t*)user_data;
+    chat_response_t* response = NULL;
+
+    if (err == ERR_OK) err = provider_note_response(ctx->limit_key, http_resp);
+
+    if (err == ERR_OK) {
+        response = chat_response_create();
+        if (!response) {
+            err = ERR_OUT_OF_MEMORY;
+        } else {
+            TRACE_BEGIN(parse_span, "provider.parse");
+            err = ctx->parse(http_response_body(http_resp), http_resp->body.len, response);
+            TRACE_END(parse_span);
+            if (err != ERR_OK) {
+                chat_response_free(response);
+                response = NULL;
+            }
+        }
+    }
+
+    http_response_free(http_resp);
+    ctx->on_done(err, response, ctx->user_data);
+    free(ctx);
+}
+
+err_t provider_submit_chat_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const char* url,
+                                 const char* request_body,
+                                 provider_parse_fn_t parse,
+                                 provider_chat_callback_t on_done,
+                                 void* user_data) {
+    if (!provider || !provider->http || !engine || !url || !parse || !on_done) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    // The loop thread must not sleep; a request that would be refused is not sent
+    uint64_t limit_key = provider_limit_key(provider);
+    if (rate_limit_try(limit_key)) return ERR_PROVIDER_RATE_LIMIT;
+
+    async_chat_ctx_t* ctx = malloc(sizeof(async_chat_ctx_t));
+    if (!ctx) return ERR_OUT_OF_MEMORY;
+    ctx->parse = parse;
+    ctx->on_done = on_done;
+    ctx->user_data = user_data;
+    ctx->limit_key = limit_key;
+
+    err_t err = http_post_json_async(engine, provider->http, url, request_body,
+                                     async_chat_done, ctx);
+    if (err != ERR_OK) free(ctx);
+    return err;
+}
+
+// Pending async stream
+typedef struct {
+    sse_parser_t parser;
+    provider_stream_done_t on_done;
+    void* user_data;
+    uint64_t limit_key;
+} async_stream_ctx_t;
+
+static void async_stream_done(err_t err, http_response_t* http_resp, void* user_data) {
+    async_stream_ctx_t* ctx = (async_stream_ctx_t*)user_data;
+
+    if (err == ERR_OK) err = provider_note_response(ctx->limit_key, http_resp);
+
+    http_response_free(http_resp);
+    ctx->on_done(err, ctx->user_data);
+    sse_parser_free(&ctx->parser);
+    free(ctx);
+}
+
+err_t provider_submit_stream_async(provider_t* provider,
+                                   http_engine_t* engine,
+                                   const char* url,
+                                   const char* request_body,
+                                   sse_dialect_t dialect,
+                                   stream_delta_callback_t on_delta,
+                                   void (*on_chunk)(const char* chunk, void* user_data),
+                                   provider_stream_done_t on_done,
+                                   void* user_data) {
+    if (!provider || !provider->http || !engine || !url || !on_done || (!on_delta && !on_chunk)) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    uint64_t limit_key = provider_limit_key(provider);
+    if (rate_limit_try(limit_key)) return ERR_PROVIDER_RATE_LIMIT;
+
+    async_stream_ctx_t* ctx = calloc(1, sizeof(async_stream_ctx_t));
+    if (!ctx) return ERR_OUT_OF_MEMORY;
+    ctx->limit_key = limit_key;
+
+    err_t err = sse_parser_init(&ctx->parser, dialect, on_delta, on_chunk, user_data);
+    if (err != ERR_OK) {
+        free(ctx);
+        return err;
+    }
+    ctx->on_done = on_done;
+    ctx->user_data = user_data;
+
+    err = http_post_json_stream_async(engine, provider->http, url, request_body,
+                                      sse_parser_feed, async_stream_done, ctx);
+    if (err != ERR_OK) {
+        sse_parser_free(&ctx->parser);
+        free(ctx);
+    }
+    return err;
+}
+
+err_t provider_stream_request(provider_t* provider,
+                              const char* url,
+                              const char* request_body,
+                              sse_dialect_t dialect,
+                              stream_delta_callback_t on_delta,
+                              void (*on_chunk)(const char* chunk, void* user_data),
+                              void* user_data) {
+    if (!provider || !provider->http || !url || (!on_delta && !on_chunk)) return ERR_INVALID_ARGUMENT;
+
+    sse_parser_t parser;
+    err_t err = sse_parser_init(&parser, dialect, on_delta, on_chunk, user_data);
+    if (err != ERR_OK) return err;
+
+    uint64_t limit_key = provider_limit_key(provider);
+    sleep_for_ms(rate_limit_reserve(limit_key));
+
+    http_response_t* status = NULL;
+    err = http_post_json_stream_status(provider->http, url, request_body, sse_parser_feed, &parser, &status);
+    sse_parser_free(&parser);
+    if (err == ERR_OK) {
+        err = provider_note_response(limit_key, status);
+        http_response_free(status);
+    }
+
+    return err;
+}
+
+// ============================================================================
+// SSE parser
+// ============================================================================
+
+#define SSE_ARENA_SIZE 16384
+
+err_t sse_parser_init(sse_parser_t* parser, sse_dialect_t dialect,
+                      stream_delta_callback_t on_delta,
+                      void (*on_chunk)(const char* chunk, void* user_data),
+                      void* user_data) {
+    if (!parser) return ERR_INVALID_ARGUMENT;
+
+    memset(parser, 0, sizeof(sse_parser_t));
+    parser->dialect = dialect;
+    parser->on_delta = on_delta;
+    parser->on_chunk = on_chunk;
+    parser->user_data = user_data;
+
+    parser->arena = arena_create(SSE_ARENA_SIZE);
+    if (!parser->arena) return ERR_OUT_OF_MEMORY;
+    arena_set_tag(parser->arena, ALLOC_TAG_PROVIDER);
+
+    return ERR_OK;
+}
+
+void sse_parser_free(sse_parser_t* parser) {
+    if (!parser) return;
+
+    free(parser->carry);
+    arena_destroy((arena_allocator_t*)parser->arena);
+    memset(parser, 0, sizeof(sse_parser_t));
+}
+
+static str_t sse_cstr(const char* s) {
+    return s ? (str_t){ .data = s, .len = (uint32_t)strlen(s) } : STR_NULL;
+}
+
+static void sse_emit(sse_parser_t* parser, const stream_delta_t* delta) {
+    if (parser->on_delta) {
+        parser->on_delta(delta, parser->user_data);
+    } else if (parser->on_chunk && delta->type == STREAM_DELTA_TEXT && delta->text.len > 0) {
+        // Arena strings are NUL-terminated
+        parser->on_chunk(delta->text.data, parser->user_data);
+    }
+}
+
+static void sse_emit_text(sse_parser_t* parser, stream_delta_type_t type, const char* text) {
+    if (!text || !*text) return;
+    stream_delta_t delta = { .type = type, .text = sse_cstr(text) };
+    sse_emit(parser, &delta);
+}
+
+static void sse_emit_finish(sse_parser_t* parser, const char* reason) {
+    if (!reason || !*reason) return;
+    stream_delta_t delta = { .type = STREAM_DELTA_FINISH, .finish_reason = sse_cstr(reason) };
+    sse_emit(parser, &delta);
+}
+
+static void sse_emit_usage(sse_parser_t* parser, json_object_t* usage) {
+    if (!usage) return;
+
+    chat_response_t counts = {0};
+    provider_parse_usage(usage, &counts);
+    if (counts.prompt_tokens == 0 && counts.completion_tokens == 0) return;
+
+    stream_delta_t delta = {
+        .type = STREAM_DELTA_USAGE,
+        .prompt_tokens = counts.prompt_tokens,
+        .completion_tokens = counts.completion_tokens,
+        .cached_tokens = counts.cached_tokens
+    };
+    sse_emit(parser, &delta);
+}
+
+static void sse_emit_done(sse_parser_t* parser) {
+    if (parser->done) return;
+    parser->done = true;
+    stream_delta_t delta = { .type = STREAM_DELTA_DONE };
+    sse_emit(parser, &delta);
+}
+
+static void sse_dispatch_openai(sse_parser_t* parser, json_object_t* obj) {
+    json_object_t* error = json_object_get_object(obj, "error");
+    if (error) {
+        sse_emit_text(parser, STREAM_DELTA_ERROR, json_object_get_string(error, "message", "provider error"));
+        return;
+    }
+
+    json_array_t* choices = json_object_get_array(obj, "choices");
+    json_object_t* choice = json_as_object(json_array_get(choices, 0));
+    if (choice) {
+        json_object_t* delta = json_object_get_object(choice, "delta");
+        if (delta) {
+            sse_emit_text(parser, STREAM_DELTA_TEXT, json_object_get_string(delta, "content", NULL));
+
+            json_array_t* tool_calls = json_object_get_array(delta, "tool_calls");
+            size_t count = json_array_length(tool_calls);
+            for (size_t i = 0; i < count; i++) {
+                json_object_t* call = json_as_object(json_array_get(tool_calls, i));
+                if (!call) continue;
+
+                json_object_t* function = json_object_get_object(call, "function");
+                stream_delta_t out = {
+                    .type = STREAM_DELTA_TOOL_CALL,
+                    .tool_index = (uint32_t)json_object_get_number(call, "index", (double)i),
+                    .tool_id = sse_cstr(json_object_get_string(call, "id", NULL)),
+                    .tool_name = sse_cstr(json_object_get_string(function, "name", NULL)),
+                    .tool_arguments = sse_cstr(json_object_get_string(function, "arguments", NULL))
+                };
+                sse_emit(parser, &out);
+            }
+        }
+
+        sse_emit_finish(parser, json_object_get_string(choice, "finish_reason", NULL));
+    }
+
+    sse_emit_usage(parser, json_object_get_object(obj, "usage"));
+}
+
+static void sse_dispatch_anthropic(sse_parser_t* parser, json_object_t* obj) {
+    const char* type = json_object_get_string(obj, "type", "");
+
+    if (strcmp(type, "content_block_delta") == 0) {
+        json_object_t* delta = json_object_get_object(obj, "delta");
+        const char* delta_type = json_object_get_string(delta, "type", "");
+
+        if (strcmp(delta_type, "text_delta") == 0) {
+            sse_emit_text(parser, STREAM_DELTA_TEXT, json_object_get_string(delta, "text", NULL));
+        } else if (strcmp(delta_type, "input_json_delta") == 0) {
+            stream_delta_t out = {
+                .type = STREAM_DELTA_TOOL_CALL,
+                .tool_index = (uint32_t)json_object_get_number(obj, "index", 0),
+                .tool_arguments = sse_cstr(json_object_get_string(delta, "partial_json", NULL))
+            };
+            sse_emit(parser, &out);
+        }
+    } else if (strcmp(type, "content_block_start") == 0) {
+        json_object_t* block = json_object_get_object(obj, "content_block");
+        if (strcmp(json_object_get_string(block, "type", ""), "tool_use") == 0) {
+            stream_delta_t out = {
+                .type = STREAM_DELTA_TOOL_CALL,
+                .tool_index = (uint32_t)json_object_get_number(obj, "index", 0),
+                .tool_id = sse_cstr(json_object_get_string(block, "id", NULL)),
+                .tool_name = sse_cstr(json_object_get_string(block, "name", NULL))
+            };
+            sse_emit(parser, &out);
+        }
+    } else if (strcmp(type, "message_start") == 0) {
+        json_object_t* message = json_object_get_object(obj, "message");
+        sse_emit_usage(parser, json_object_get_object(message, "usage"));
+    } else if (strcmp(type, "message_delta") == 0) {
+        json_object_t* delta = json_object_get_object(obj, "delta");
+        sse_emit_finish(parser, json_object_get_string(delta, "stop_reason", NULL));
+
+        sse_emit_usage(parser, json_object_get_object(obj, "usage"));
+    } else if (strcmp(type, "message_stop") == 0) {
+        sse_emit_done(parser);
+    } else if (strcmp(type, "error") == 0) {
+        json_object_t* error = json_object_get_object(obj, "error");
+        sse_emit_text(parser, STREAM_DELTA_ERROR, json_object_get_string(error, "message", "provider error"));
+    }
+}
+
+static void sse_process_line(sse_parser_t* parser, const char* line, size_t len) {
+    if (len > 0 && line[len - 1] == '\r') len--;
+
+    // Only data: fields carry payloads; event:, id:, retry: and comments are skipped
+    if (len < 5 || memcmp(line, "data:", 5) != 0) return;
+
+    const char* payload = line + 5;
+    size_t payload_len = len - 5;
+    if (payload_len > 0 && payload[0] == ' ') {
+        payload++;
+        payload_len--;
+    }
+
+    if (payload_len == 6 && memcmp(payload, "[DONE]", 6) == 0) {
+        sse_emit_done(parser);
+        return;
+    }
+
+    arena_allocator_t* arena = (arena_allocator_t*)parser->arena;
+    json_value_t* root = json_parse_arena(payload, payload_len, arena);
+    json_object_t* obj = json_as_object(root);
+    if (obj) {
+        if (parser->dialect == SSE_DIALECT_ANTHROPIC) {
+            sse_dispatch_anthropic(parser, obj);
+        } else {
+            sse_dispatch_openai(parser, obj);
+        }
+    }
+
+    json_free(root);
+    arena_reset(arena);
+}
+
+static void sse_carry_append(sse_parser_t* parser, const char* data, size_t len) {
+    if (parser->carry_overflow) return;
+
+    if (parser->carry_len + len > SSE_MAX_LINE) {
+        parser->carry_overflow = true;
+        parser->carry_len = 0;
+        return;
+    }
+
+    if (parser->carry_len + len > parser->carry_cap) {
+        size_t new_cap = parser->carry_cap ? parser->carry_cap : 4096;
+        while (new_cap < parser->carry_len + len) new_cap *= 2;
+
+        char* carry = realloc(parser->carry, new_cap);
+        if (!carry) {
+            parser->carry_overflow = true;
+            parser->carry_len = 0;
+            return;
+        }
+        parser->carry = carry;
+        parser->carry_cap = new_cap;
+    }
+
+    memcpy(parser->carry + parser->carry_len, data, len);
+    parser->carry_len += len;
+}
+
+size_t sse_parser_feed(const char* data, size_t len, void* userp) {
+    sse_parser_t* parser = (sse_parser_t*)userp;
+    size_t pos = 0;
+
+    // Finish a line left over from the previous write
+    if (parser->carry_len > 0 || parser->carry_overflow) {
+        const char* newline = memchr(data, '\n', len);
+        if (!newline) {
+            sse_carry_append(parser, data, len);
+            return len;
+        }
+
+        size_t head = (size_t)(newline - data);
+        sse_carry_append(parser, data, head);
+        if (!parser->carry_overflow) {
+            sse_process_line(parser, parser->carry, parser->carry_len);
+        }
+        parser->carry_len = 0;
+        parser->carry_overflow = false;
+        pos = head + 1;
+    }
+
+    // Complete lines are parsed in place
+    while (pos < len) {
+        const char* newline = memchr(data + pos, '\n', len - pos);
+        if (!newline) {
+            sse_carry_append(parser, data + pos, len - pos);
+            break;
+        }
+
+        size_t line_len = (size_t)(newline - (data + pos));
+        sse_process_line(parser, data + pos, line_len);
+        pos += line_len + 1;
+    }
+
+    return len;
+}
+
+// ============================================================================
+// Request construction
+// ============================================================================
+
+const char* provider_role_name(chat_role_t role) {
+    switch (role) {
+        case CHAT_ROLE_SYSTEM: return "system";
+        case CHAT_ROLE_USER: return "user";
+        case CHAT_ROLE_ASSISTANT: return "assistant";
+        case CHAT_ROLE_TOOL: return "tool";
+    }
+    return "user";
+}
+
+// Size the output buffer so a typical request needs a single allocation
+size_t provider_estimate_request_size(const chat_message_t* messages, uint32_t message_count) {
+    size_t size = 256;
+    for (uint32_t i = 0; i < message_count; i++) {
+        size_t body = messages[i].content.len + messages[i].tool_calls.len + messages[i].tool_call_id.len;
+        size += body + body / 8 + 64;
+    }
+    return size;
+}
+
+void provider_write_chat_messages(json_writer_t* w,
+                                  const chat_message_t* messages,
+                                  uint32_t message_count) {
+    json_write_key(w, "messages");
+    json_write_array_begin(w);
+    for (uint32_t i = 0; i < message_count; i++) {
+        const chat_message_t* msg = &messages[i];
+
+        json_write_object_begin(w);
+        json_write_kv_string(w, "role", provider_role_name(msg->role));
+        json_write_kv_str(w, "content", msg->content);
+        if (!str_empty(msg->tool_calls)) {
+            json_write_key(w, "tool_calls");
+            json_write_raw(w, msg->tool_calls.data, msg->tool_calls.len);
+        }
+        if (!str_empty(msg->tool_call_id)) {
+            json_write_kv_str(w, "tool_call_id", msg->tool_call_id);
+        }
+        json_write_object_end(w);
+    }
+    json_write_array_end(w);
+}
+
+void provider_write_tools(json_writer_t* w, tool_dialect_t dialect,
+                          const tool_def_t* tools, uint32_t tool_count) {
+    if (!tools || tool_count == 0) return;
+
+    json_write_key(w, "tools");
+    json_write_array_begin(w);
+    for (uint32_t i = 0; i < tool_count; i++) {
+        if (!str_empty(tools[i].json[dialect])) {
+            json_write_raw(w, tools[i].json[dialect].data, tools[i].json[dialect].len);
+        } else {
+            write_tool_entry(w, dialect, &tools[i]);
+        }
+    }
+    json_write_array_end(w);
+}
+
+void provider_write_chat_request_begin(json_writer_t* w,
+                                       const provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       bool stream) {
+    json_write_object_begin(w);
+
+    if (model) {
+        json_write_kv_string(w, "model", model);
+    } else if (provider && !str_empty(provider->config.default_model)) {
+        json_write_kv_str(w, "model", provider->config.default_model);
+    }
+
+    provider_write_chat_messages(w, messages, message_count);
+
+    // Negative temperature means "provider default"
+    if (temperature >= 0.0 && temperature <= 2.0) {
+        json_write_kv_number(w, "temperature", temperature);
+    }
+
+    if (stream) {
+        json_write_kv_bool(w, "stream", true);
+    }
+
+    provider_write_tools(w, TOOL_DIALECT_OPENAI, tools, tool_count);
+}
+
+char* provider_build_chat_request(const provider_t* provider,
+                                   const chat_message_t* messages,
+                                   uint32_t message_count,
+                                   const tool_def_t* tools,
+                                   uint32_t tool_count,
+                                   const char* model,
+                                   double temperature,
+                                   bool stream) {
+    json_writer_t w;
+    json_writer_init(&w, provider_estimate_request_size(messages, message_count));
+
+    provider_write_chat_request_begin(&w, provider, messages, message_count,
+                                      tools, tool_count, model, temperature, stream);
+    json_write_object_end(&w);
+
+    return json_writer_finish(&w, NULL);
+}
+
+// ============================================================================
+// Embeddings
+// ============================================================================
+
+typedef struct embed_call_t {
+    provider_t* provider;
+    const char* model;
+    const str_t* texts;
+    uint32_t count;
+    uint32_t dimensions;
+} embed_call_t;
+
+static err_t embed_call_run(void* ctx, float* out_vectors) {
+    embed_call_t* call = ctx;
+    return call->provider->vtable->embed(call->provider, call->model, call->texts, call->count,
+                                         call->dimensions, out_vectors);
+}
+
+err_t provider_embed(provider_t* provider,
+                     const char* model,
+                     const str_t* texts,
+                     uint32_t count,
+                     uint32_t dimensions,
+                     float* out_vectors) {
+    if (!provider || !provider->vtable || !texts || !out_vectors || count == 0) return ERR_INVALID_ARGUMENT;
+    if (!provider->vtable->embed) return ERR_NOT_IMPLEMENTED;
+
+    // The output size is only known up front when dimensions are given
+    if (dimensions == 0) return provider->vtable->embed(provider, model, texts, count, dimensions, out_vectors);
+
+    embed_call_t call = { .provider = provider, .model = model, .texts = texts, .count = count,
+                          .dimensions = dimensions };
+    uint8_t key[SINGLEFLIGHT_KEY_BYTES];
+    singleflight_embed_key(provider, model, texts, count, dimensions, key);
+    return singleflight_embed(key, embed_call_run, &call, (size_t)count * dimensions, out_vectors);
+}
+
+// Copy one embedding and L2-normalize it so callers can use plain dot products
+static bool copy_embedding(json_array_t* values, uint32_t dimensions, float* out) {
+    if (json_array_length(values) < dimensions) return false;
+
+    double norm = 0.0;
+    for (uint32_t d = 0; d < dimensions; d++) {
+        double v = json_as_number(json_array_get(values, d), 0.0);
+        out[d] = (float)v;
+        norm += v * v;
+    }
+
+    if (norm > 0.0) {
+        float inv = (float)(1.0 / sqrt(norm));
+        for (uint32_t d = 0; d < dimensions; d++) out[d] *= inv;
+    }
+    return true;
+}
+
+char* provider_embed_request_body(const char* model, const str_t* texts, uint32_t count, uint32_t dimensions) {
+    size_t estimate = 128;
+    for (uint32_t i = 0; i < count; i++) estimate += texts[i].len + texts[i].len / 8 + 4;
+
+    json_writer_t w;
+    json_writer_init(&w, estimate);
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "model", model);
+    json_write_key(&w, "input");
+    json_write_array_begin(&w);
+    for (uint32_t i = 0; i < count; i++) json_write_str(&w, texts[i]);
+    json_write_array_end(&w);
+    // Only the text-embedding-3 family accepts shortened vectors
+    if (strncmp(model, "text-embedding-3", 16) == 0) {
+        json_write_kv_int(&w, "dimensions", dimensions);
+    }
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
+}
+
+err_t provider_parse_embeddings(json_object_t* body, uint32_t count, uint32_t dimensions, float* out_vectors) {
+    json_array_t* data = json_object_get_array(body, "data");
+    uint32_t filled = 0;
+    size_t n = json_array_length(data);
+    for (size_t i = 0; i < n; i++) {
+        json_object_t* item = json_as_object(json_array_get(data, i));
+        double index = json_object_get_number(item, "index", (double)i);
+        if (index < 0 || index >= count) continue;
+
+        float* out = out_vectors + (size_t)index * dimensions;
+        if (copy_embedding(json_object_get_array(item, "embedding"), dimensions, out)) filled++;
+    }
+    return filled == count ? ERR_OK : ERR_PROVIDER;
+}
+
+err_t provider_embed_openai_compatible(provider_t* provider,
+                                       const char* url,
+                                       const char* model,
+                                       const str_t* texts,
+                                       uint32_t count,
+                                       uint32_t dimensions,
+                                       float* out_vectors) {
+    if (!provider || !provider->http || !url || !model || !texts || !out_vectors || count == 0 || dimensions == 0) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    char* request_body = provider_embed_request_body(model, texts, count, dimensions);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    http_response_t* response = NULL;
+    err_t err = provider_post_json(provider, url, request_body, &response);
+    free(request_body);
+    if (err != ERR_OK) return err;
+
+    // The tree borrows the response's buffer
+    json_value_t* root = json_parse_insitu(http_response_body(response), response->body.len);
+    err = root ? provider_parse_embeddings(json_as_object(root), count, dimensions, out_vectors)
+               : ERR_CONFIG_PARSE;
+    json_free(root);
+    http_response_free(response);
+    return err;
+}
+
+err_t provider_embedder_embed(void* ctx, const str_t* texts, uint32_t count,
+                              uint32_t dimensions, float* out_vectors) {
+    provider_embedder_t* embedder = (provider_embedder_t*)ctx;
+    if (!embedder) return ERR_INVALID_ARGUMENT;
+
+    return provider_embed(embedder->provider, embedder->model, texts, count, dimensions, out_vectors);
 }
@@ -0,0 +1,776 @@
+// batch.c - Batch-API offload for non-interactive provider work
+// SPDX-License-Identifier: MIT
+
+#include "providers/batch.h"
+#include "providers/openai.h"
+#include "providers/anthropic.h"
+#include "providers/ratelimit.h"
+#include "utils/json_writer.h"
+#include "json_config.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum {
+    BATCH_DIALECT_OPENAI,
+    BATCH_DIALECT_ANTHROPIC
+} batch_dialect_t;
+
+// One endpoint per submitted batch, so chats and embeddings queue apart
+typedef enum {
+    BATCH_KIND_CHAT,
+    BATCH_KIND_EMBED,
+    BATCH_KIND_COUNT
+} batch_kind_t;
+
+typedef struct batch_item_t {
+    struct batch_item_t* next;
+    char* body;                    // Request body, rendered when queued
+    uint32_t count;                // Embeddings: texts and dimensions
+    uint32_t dimensions;
+    provider_chat_callback_t on_chat;
+    provider_embed_callback_t on_embed;
+    void* user_data;
+    bool delivered;
+} batch_item_t;
+
+typedef struct batch_queue_t {
+    batch_item_t* head;
+    batch_item_t* tail;
+    uint32_t count;
+    uint64_t first_ms;             // When the oldest item was queued
+} batch_queue_t;
+
+typedef struct batch_job_t {
+    struct batch_job_t* next;
+    batch_kind_t kind;
+    char id[128];                  // Remote batch id
+    batch_item_t** items;          // custom_id is the index
+    uint32_t count;
+    uint64_t next_poll_ms;
+    uint32_t poll_ms;
+} batch_job_t;
+
+struct provider_batch_t {
+    provider_t* provider;
+    batch_dialect_t dialect;
+    http_client_t* http;
+    char base_url[256];
+    provider_batch_config_t config;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t worker;
+    bool stopping;
+    bool flush_requested;
+    batch_queue_t queues[BATCH_KIND_COUNT];
+    batch_job_t* jobs;             // Worker only
+    provider_batch_stats_t stats;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+static void item_fail(batch_item_t* item, err_t err) {
+    if (item->delivered) return;
+    item->delivered = true;
+    if (item->on_chat) item->on_chat(err, NULL, item->user_data);
+    else item->on_embed(err, NULL, item->user_data);
+}
+
+static void item_free(batch_item_t* item) {
+    free(item->body);
+    free(item);
+}
+
+// body is the response the endpoint would have returned for the request
+static void item_deliver(provider_batch_t* batch, batch_item_t* item, json_value_t* body) {
+    if (item->delivered) return;
+
+    if (item->on_embed) {
+        float* vectors = malloc((size_t)item->count * item->dimensions * sizeof(float));
+        err_t err = vectors ? provider_parse_embeddings(json_as_object(body), item->count, item->dimensions, vectors)
+                            : ERR_OUT_OF_MEMORY;
+        item->delivered = true;
+        item->on_embed(err, err == ERR_OK ? vectors : NULL, item->user_data);
+        free(vectors);
+        return;
+    }
+
+    char* json = json_print(body, false);
+    chat_response_t* response = chat_response_create();
+    err_t err = json && response ? ERR_OK : ERR_OUT_OF_MEMORY;
+    if (err == ERR_OK) {
+        err = batch->dialect == BATCH_DIALECT_OPENAI ? openai_parse_response(json, strlen(json), response)
+                                                     : anthropic_parse_response(json, strlen(json), response);
+    }
+    free(json);
+    if (err != ERR_OK) {
+        chat_response_free(response);
+        response = NULL;
+    }
+    item->delivered = true;
+    item->on_chat(err, response, item->user_data);
+}
+
+// One results line; custom_id is the item's index in the job
+static void deliver_line(provider_batch_t* batch, batch_job_t* job, const char* line, size_t len) {
+    json_value_t* root = json_parse_len(line, len);
+    json_object_t* obj = json_as_object(root);
+    const char* custom_id = json_object_get_string(obj, "custom_id", NULL);
+    char* end = NULL;
+    unsigned long index = custom_id ? strtoul(custom_id, &end, 10) : 0;
+    if (!custom_id || end == custom_id || index >= job->count) {
+        json_free(root);
+        return;
+    }
+    batch_item_t* item = job->items[index];
+
+    if (batch->dialect == BATCH_DIALECT_OPENAI) {
+        json_object_t* response = json_object_get_object(obj, "response");
+        uint32_t status = (uint32_t)json_object_get_number(response, "status_code", 0);
+        if (response && status >= 200 && status < 300) {
+            item_deliver(batch, item, json_object_get(response, "body"));
+        } else {
+            item_fail(item, status ? rate_limit_status_error(status) : ERR_PROVIDER);
+        }
+    } else {
+        json_object_t* result = json_object_get_object(obj, "result");
+        const char* type = json_object_get_string(result, "type", "");
+        if (strcmp(type, "succeeded") == 0) {
+            item_deliver(batch, item, json_object_get(result, "message"));
+        } else {
+            item_fail(item, strcmp(type, "expired") == 0 ? ERR_TIMEOUT :
+                            strcmp(type, "canceled") == 0 ? ERR_CANCELLED : ERR_PROVIDER);
+        }
+    }
+    json_free(root);
+}
+
+// Fetch a JSONL results file and deliver every line
+static err_t deliver_results(provider_batch_t* batch, batch_job_t* job, const char* url) {
+    http_response_t* response = NULL;
+    err_t err = http_get(batch->http, url, &response);
+    if (err == ERR_OK && !http_response_is_success(response)) err = rate_limit_status_error(response->status_code);
+    if (err == ERR_OK) {
+        const char* p = response->body.data;
+        const char* end = p + response->body.len;
+        while (p < end) {
+            const char* nl = memchr(p, '\n', (size_t)(end - p));
+            const char* line_end = nl ? nl : end;
+            if (line_end > p) deliver_line(batch, job, p, (size_t)(line_end - p));
+            p = line_end + 1;
+        }
+    }
+    http_response_free(response);
+    return err;
+}
+
+// ============================================================================
+// Dialects
+// ============================================================================
+
+static const char* openai_endpoint(batch_kind_t kind) {
+    return kind == BATCH_KIND_EMBED ? "/v1/embeddings" : "/v1/chat/completions";
+}
+
+// Object from a JSON response; NULL when the call failed
+static json_value_t* call_json(provider_batch_t* batch, const char* method, const char* url,
+                               const char* body, size_t body_len, const char* content_type, err_t* out_err) {
+    http_response_t* response = NULL;
+    err_t err = http_request(batch->http, method, url, body, body_len, content_type, &response);
+    json_value_t* root = NULL;
+    if (err == ERR_OK && !http_response_is_success(response)) err = rate_limit_status_error(response->status_code);
+    if (err == ERR_OK) {
+        root = json_parse_len(response->body.data, response->body.len);
+        if (!json_as_object(root)) err = ERR_CONFIG_PARSE;
+    }
+    http_response_free(response);
+    if (err != ERR_OK) {
+        json_free(root);
+        root = NULL;
+    }
+    *out_err = err;
+    return root;
+}
+
+static err_t copy_id(json_value_t* root, char* out, size_t out_size) {
+    const char* id = json_object_get_string(json_as_object(root), "id", NULL);
+    if (!id || strlen(id) >= out_size) return ERR_PROVIDER;
+    snprintf(out, out_size, "%s", id);
+    return ERR_OK;
+}
+
+// Upload the requests as a JSONL file, then open a batch over it
+static err_t openai_submit(provider_batch_t* batch, batch_job_t* job) {
+    static const char boundary[] = "cclaw-batch-7f3a91c2";
+    json_writer_t w;
+    json_writer_init(&w, 4096);
+    char head[256];
+    int head_len = snprintf(head, sizeof(head),
+                            "--%s\r\nContent-Disposition: form-data; name=\"purpose\"\r\n\r\nbatch\r\n"
+                            "--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"batch.jsonl\"\r\n"
+                            "Content-Type: application/jsonl\r\n\r\n", boundary, boundary);
+    json_write_raw(&w, head, (size_t)head_len);
+    for (uint32_t i = 0; i < job->count; i++) {
+        char prefix[128];
+        int prefix_len = snprintf(prefix, sizeof(prefix), "{\"custom_id\":\"%u\",\"method\":\"POST\",\"url\":\"%s\",\"body\":",
+                                  i, openai_endpoint(job->kind));
+        json_write_raw(&w, prefix, (size_t)prefix_len);
+        json_write_raw(&w, job->items[i]->body, strlen(job->items[i]->body));
+        json_write_raw(&w, "}\n", 2);
+    }
+    char tail[64];
+    int tail_len = snprintf(tail, sizeof(tail), "\r\n--%s--\r\n", boundary);
+    json_write_raw(&w, tail, (size_t)tail_len);
+
+    size_t form_len = 0;
+    char* form = json_writer_finish(&w, &form_len);
+    if (!form) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    char content_type[96];
+    snprintf(url, sizeof(url), "%s/files", batch->base_url);
+    snprintf(content_type, sizeof(content_type), "multipart/form-data; boundary=%s", boundary);
+    err_t err;
+    json_value_t* file = call_json(batch, "POST", url, form, form_len, content_type, &err);
+    free(form);
+    if (!file) return err;
+
+    char file_id[128];
+    err = copy_id(file, file_id, sizeof(file_id));
+    json_free(file);
+    if (err != ERR_OK) return err;
+
+    char body[384];
+    int body_len = snprintf(body, sizeof(body),
+                            "{\"input_file_id\":\"%s\",\"endpoint\":\"%s\",\"completion_window\":\"24h\"}",
+                            file_id, openai_endpoint(job->kind));
+    snprintf(url, sizeof(url), "%s/batches", batch->base_url);
+    json_value_t* created = call_json(batch, "POST", url, body, (size_t)body_len, "application/json", &err);
+    if (!created) return err;
+    err = copy_id(created, job->id, sizeof(job->id));
+    json_free(created);
+    return err;
+}
+
+static err_t anthropic_submit(provider_batch_t* batch, batch_job_t* job) {
+    json_writer_t w;
+    json_writer_init(&w, 4096);
+    json_write_object_begin(&w);
+    json_write_key(&w, "requests");
+    json_write_array_begin(&w);
+    for (uint32_t i = 0; i < job->count; i++) {
+        char custom_id[16];
+        snprintf(custom_id, sizeof(custom_id), "%u", i);
+        json_write_object_begin(&w);
+        json_write_kv_string(&w, "custom_id", custom_id);
+        json_write_key(&w, "params");
+        json_write_raw(&w, job->items[i]->body, strlen(job->items[i]->body));
+        json_write_object_end(&w);
+    }
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+
+    size_t body_len = 0;
+    char* body = json_writer_finish(&w, &body_len);
+    if (!body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages/batches", batch->base_url);
+    err_t err;
+    json_value_t* created = call_json(batch, "POST", url, body, body_len, "application/json", &err);
+    free(body);
+    if (!created) return err;
+    err = copy_id(created, job->id, sizeof(job->id));
+    json_free(created);
+    return err;
+}
+
+// *out_done once every item has been delivered or failed
+static err_t openai_poll(provider_batch_t* batch, batch_job_t* job, bool* out_done) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/batches/%s", batch->base_url, job->id);
+    err_t err;
+    json_value_t* root = call_json(batch, "GET", url, NULL, 0, NULL, &err);
+    if (!root) return err;
+
+    json_object_t* obj = json_as_object(root);
+    const char* status = json_object_get_string(obj, "status", "");
+    *out_done = true;
+    if (strcmp(status, "completed") == 0) {
+        // Successes and failures come back in separate files
+        const char* files[2] = { json_object_get_string(obj, "output_file_id", NULL),
+                                 json_object_get_string(obj, "error_file_id", NULL) };
+        for (int i = 0; i < 2 && err == ERR_OK; i++) {
+            if (!files[i]) continue;
+            snprintf(url, sizeof(url), "%s/files/%s/content", batch->base_url, files[i]);
+            err = deliver_results(batch, job, url);
+        }
+    } else if (strcmp(status, "expired") == 0) {
+        err = ERR_TIMEOUT;
+    } else if (strcmp(status, "failed") == 0 || strcmp(status, "cancelled") == 0) {
+        err = ERR_PROVIDER;
+    } else {
+        *out_done = false;
+    }
+    json_free(root);
+    return err;
+}
+
+static err_t anthropic_poll(provider_batch_t* batch, batch_job_t* job, bool* out_done) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/messages/batches/%s", batch->base_url, job->id);
+    err_t err;
+    json_value_t* root = call_json(batch, "GET", url, NULL, 0, NULL, &err);
+    if (!root) return err;
+
+    json_object_t* obj = json_as_object(root);
+    *out_done = strcmp(json_object_get_string(obj, "processing_status", ""), "ended") == 0;
+    if (*out_done) {
+        const char* results = json_object_get_string(obj, "results_url", NULL);
+        err = results ? deliver_results(batch, job, results) : ERR_PROVIDER;
+    }
+    json_free(root);
+    return err;
+}
+
+static void remote_cancel(provider_batch_t* batch, batch_job_t* job) {
+    char url[512];
+    snprintf(url, sizeof(url), batch->dialect == BATCH_DIALECT_OPENAI ? "%s/batches/%s/cancel"
+                                                                       : "%s/messages/batches/%s/cancel",
+             batch->base_url, job->id);
+    http_response_t* response = NULL;
+    if (http_request(batch->http, "POST", url, NULL, 0, NULL, &response) == ERR_OK) {
+        http_response_free(response);
+    }
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+static void job_finish(batch_job_t* job, err_t err) {
+    // Anything the results did not mention failed upstream
+    for (uint32_t i = 0; i < job->count; i++) {
+        item_fail(job->items[i], err != ERR_OK ? err : ERR_PROVIDER);
+        item_free(job->items[i]);
+    }
+    free(job->items);
+    free(job);
+}
+
+// Items taken off a queue become one remote batch; NULL when submit failed
+static batch_job_t* job_submit(provider_batch_t* batch, batch_kind_t kind, batch_item_t* items, uint32_t count) {
+    batch_job_t* job = calloc(1, sizeof(batch_job_t));
+    batch_item_t** list = calloc(count, sizeof(batch_item_t*));
+    err_t err = job && list ? ERR_OK : ERR_OUT_OF_MEMORY;
+    if (err == ERR_OK) {
+        job->kind = kind;
+        job->items = list;
+        for (batch_item_t* item = items; item; item = item->next) job->items[job->count++] = item;
+        err = batch->dialect == BATCH_DIALECT_OPENAI ? openai_submit(batch, job) : anthropic_submit(batch, job);
+    }
+    if (err != ERR_OK) {
+        if (job && list) {
+            job_finish(job, err);
+        } else {
+            free(job);
+            free(list);
+            while (items) {
+                batch_item_t* next = items->next;
+                item_fail(items, err);
+                item_free(items);
+                items = next;
+            }
+        }
+        return NULL;
+    }
+
+    job->poll_ms = batch->config.poll_min_ms;
+    job->next_poll_ms = now_ms() + job->poll_ms;
+    return job;
+}
+
+// Caller holds lock; detaches up to max_requests items
+static batch_item_t* queue_take(provider_batch_t* batch, batch_queue_t* queue, uint32_t* out_count) {
+    batch_item_t* head = queue->head;
+    batch_item_t* last = NULL;
+    uint32_t count = 0;
+    for (batch_item_t* item = head; item && count < batch->config.max_requests; item = item->next) {
+        last = item;
+        count++;
+    }
+    queue->head = last ? last->next : NULL;
+    if (!queue->head) queue->tail = NULL;
+    if (last) last->next = NULL;
+    queue->count -= count;
+    queue->first_ms = now_ms();
+    *out_count = count;
+    return count ? head : NULL;
+}
+
+static void* batch_worker_main(void* arg) {
+    provider_batch_t* batch = arg;
+
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->stopping) {
+        uint64_t now = now_ms();
+        uint64_t wake = UINT64_MAX;
+
+        for (int kind = 0; kind < BATCH_KIND_COUNT; kind++) {
+            batch_queue_t* queue = &batch->queues[kind];
+            bool due = queue->count >= batch->config.max_requests ||
+                       (queue->count && (batch->flush_requested || now >= queue->first_ms + batch->config.flush_ms));
+            if (!due) {
+                if (queue->count && queue->first_ms + batch->config.flush_ms < wake) {
+                    wake = queue->first_ms + batch->config.flush_ms;
+                }
+                continue;
+            }
+
+            // A flush drains the queue in max_requests chunks
+            uint32_t count = 0;
+            batch_item_t* items = queue_take(batch, queue, &count);
+            batch->stats.queued -= count;
+            pthread_mutex_unlock(&batch->lock);
+            batch_job_t* job = job_submit(batch, (batch_kind_t)kind, items, count);
+            pthread_mutex_lock(&batch->lock);
+            if (job) {
+                job->next = batch->jobs;
+                batch->jobs = job;
+                batch->stats.submitted++;
+                batch->stats.requests += count;
+                batch->stats.in_flight++;
+            }
+            kind--;
+        }
+        batch->flush_requested = false;
+
+        for (batch_job_t** slot = &batch->jobs; *slot;) {
+            batch_job_t* job = *slot;
+            if (job->next_poll_ms > now) {
+                if (job->next_poll_ms < wake) wake = job->next_poll_ms;
+                slot = &job->next;
+                continue;
+            }
+
+            batch->stats.polls++;
+            pthread_mutex_unlock(&batch->lock);
+            bool done = false;
+            err_t err = batch->dialect == BATCH_DIALECT_OPENAI ? openai_poll(batch, job, &done)
+                                                               : anthropic_poll(batch, job, &done);
+            pthread_mutex_lock(&batch->lock);
+
+            if (done) {
+                *slot = job->next;
+                batch->stats.in_flight--;
+                pthread_mutex_unlock(&batch->lock);
+                job_finish(job, err);
+                pthread_mutex_lock(&batch->lock);
+                continue;
+            }
+            // Transient poll errors back off like a pending batch
+            job->poll_ms = job->poll_ms * 2 < batch->config.poll_max_ms ? job->poll_ms * 2 : batch->config.poll_max_ms;
+            job->next_poll_ms = now_ms() + job->poll_ms;
+            if (job->next_poll_ms < wake) wake = job->next_poll_ms;
+            slot = &job->next;
+        }
+
+        if (batch->stopping) continue;
+        if (wake == UINT64_MAX) {
+            pthread_cond_wait(&batch->cond, &batch->lock);
+        } else if (wake > now_ms()) {
+            struct timespec deadline = { .tv_sec = (time_t)(wake / 1000), .tv_nsec = (long)(wake % 1000) * 1000000L };
+            pthread_cond_timedwait(&batch->cond, &batch->lock, &deadline);
+        }
+    }
+
+    // Queued and in-flight work is failed; remote batches are cancelled
+    batch_item_t* pending[BATCH_KIND_COUNT];
+    for (int kind = 0; kind < BATCH_KIND_COUNT; kind++) {
+        pending[kind] = batch->queues[kind].head;
+        batch->queues[kind] = (batch_queue_t){0};
+    }
+    batch_job_t* jobs = batch->jobs;
+    batch->jobs = NULL;
+    batch->stats.queued = 0;
+    batch->stats.in_flight = 0;
+    pthread_mutex_unlock(&batch->lock);
+
+    for (int kind = 0; kind < BATCH_KIND_COUNT; kind++) {
+        for (batch_item_t* item = pending[kind]; item;) {
+            batch_item_t* next = item->next;
+            item_fail(item, ERR_CANCELLED);
+            item_free(item);
+            item = next;
+        }
+    }
+    while (jobs) {
+        batch_job_t* next = jobs->next;
+        remote_cancel(batch, jobs);
+        job_finish(jobs, ERR_CANCELLED);
+        jobs = next;
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Batch
+// ============================================================================
+
+bool provider_batch_supported(const provider_t* provider) {
+    return provider && (provider->vtable == openai_get_vtable() || provider->vtable == anthropic_get_vtable());
+}
+
+err_t provider_batch_create(provider_t* provider, const provider_batch_config_t* config,
+                            provider_batch_t** out_batch) {
+    if (!provider || !out_batch) return ERR_INVALID_ARGUMENT;
+    if (!provider_batch_supported(provider)) return ERR_NOT_IMPLEMENTED;
+
+    provider_batch_t* batch = calloc(1, sizeof(provider_batch_t));
+    if (!batch) return ERR_OUT_OF_MEMORY;
+
+    batch->provider = provider;
+    batch->dialect = provider->vtable == openai_get_vtable() ? BATCH_DIALECT_OPENAI : BATCH_DIALECT_ANTHROPIC;
+    if (config) batch->config = *config;
+    if (!batch->config.max_requests) batch->config.max_requests = PROVIDER_BATCH_MAX_REQUESTS;
+    if (!batch->config.flush_ms) batch->config.flush_ms = PROVIDER_BATCH_FLUSH_MS;
+    if (!batch->config.poll_min_ms) batch->config.poll_min_ms = PROVIDER_BATCH_POLL_MIN_MS;
+    if (!batch->config.poll_max_ms) batch->config.poll_max_ms = PROVIDER_BATCH_POLL_MAX_MS;
+    snprintf(batch->base_url, sizeof(batch->base_url), "%.*s",
+             (int)provider->config.base_url.len, provider->config.base_url.data);
+
+    // Own client: no JSON content type on uploads, no share of the interactive pool
+    http_client_config_t http_config = http_client_default_config();
+    batch->http = http_client_create(&http_config);
+    if (!batch->http) {
+        free(batch);
+        return ERR_NETWORK;
+    }
+    char auth[512];
+    str_t key = provider->config.api_key;
+    if (batch->dialect == BATCH_DIALECT_OPENAI) {
+        snprintf(auth, sizeof(auth), "Bearer %.*s", (int)key.len, key.data);
+        http_client_add_header(batch->http, "Authorization", auth);
+    } else {
+        snprintf(auth, sizeof(auth), "%.*s", (int)key.len, key.data);
+        http_client_add_header(batch->http, "x-api-key", auth);
+        http_client_add_header(batch->http, "anthropic-version", "2023-06-01");
+    }
+
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->cond, NULL);
+    if (pthread_create(&batch->worker, NULL, batch_worker_main, batch) != 0) {
+        pthread_cond_destroy(&batch->cond);
+        pthread_mutex_destroy(&batch->lock);
+        http_client_destroy(batch->http);
+        free(batch);
+        return ERR_RUNTIME;
+    }
+
+    *out_batch = batch;
+    return ERR_OK;
+}
+
+void provider_batch_destroy(provider_batch_t* batch) {
+    if (!batch) return;
+
+    pthread_mutex_lock(&batch->lock);
+    batch->stopping = true;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+    pthread_join(batch->worker, NULL);
+
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->lock);
+    http_client_destroy(batch->http);
+    free(batch);
+}
+
+static err_t batch_enqueue(provider_batch_t* batch, batch_kind_t kind, batch_item_t* item) {
+    pthread_mutex_lock(&batch->lock);
+    if (batch->stopping) {
+        pthread_mutex_unlock(&batch->lock);
+        item_free(item);
+        return ERR_CANCELLED;
+    }
+    batch_queue_t* queue = &batch->queues[kind];
+    if (queue->tail) queue->tail->next = item;
+    else queue->head = item;
+    queue->tail = item;
+    if (queue->count++ == 0) queue->first_ms = now_ms();
+    batch->stats.queued++;
+    // The worker only needs waking when this fills a batch or starts a timer
+    if (queue->count == 1 || queue->count >= batch->config.max_requests) pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+    return ERR_OK;
+}
+
+err_t provider_batch_chat_async(provider_batch_t* batch,
+                                const chat_message_t* messages,
+                                uint32_t message_count,
+                                const tool_def_t* tools,
+                                uint32_t tool_count,
+                                const char* model,
+                                double temperature,
+                                provider_chat_callback_t on_done,
+                                void* user_data) {
+    if (!batch || !messages || message_count == 0 || !on_done) return ERR_INVALID_ARGUMENT;
+
+    batch_item_t* item = calloc(1, sizeof(batch_item_t));
+    if (!item) return ERR_OUT_OF_MEMORY;
+    provider_t* provider = batch->provider;
+    item->body = batch->dialect == BATCH_DIALECT_OPENAI
+        ? openai_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false)
+        : anthropic_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    if (!item->body) {
+        free(item);
+        return ERR_OUT_OF_MEMORY;
+    }
+    item->on_chat = on_done;
+    item->user_data = user_data;
+    return batch_enqueue(batch, BATCH_KIND_CHAT, item);
+}
+
+err_t provider_batch_embed_async(provider_batch_t* batch,
+                                 const char* model,
+                                 const str_t* texts,
+                                 uint32_t count,
+                                 uint32_t dimensions,
+                                 provider_embed_callback_t on_done,
+                                 void* user_data) {
+    if (!batch || !model || !texts || count == 0 || dimensions == 0 || !on_done) return ERR_INVALID_ARGUMENT;
+    if (batch->dialect != BATCH_DIALECT_OPENAI) return ERR_NOT_IMPLEMENTED;
+
+    batch_item_t* item = calloc(1, sizeof(batch_item_t));
+    if (!item) return ERR_OUT_OF_MEMORY;
+    item->body = provider_embed_request_body(model, texts, count, dimensions);
+    if (!item->body) {
+        free(item);
+        return ERR_OUT_OF_MEMORY;
+    }
+    item->count = count;
+    item->dimensions = dimensions;
+    item->on_embed = on_done;
+    item->user_data = user_data;
+    return batch_enqueue(batch, BATCH_KIND_EMBED, item);
+}
+
+// Blocking callers park here until the worker delivers
+typedef struct batch_wait_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool done;
+    err_t err;
+    chat_response_t* response;
+    float* vectors;
+    size_t vector_floats;
+} batch_wait_t;
+
+static void batch_wait_init(batch_wait_t* wait) {
+    memset(wait, 0, sizeof(batch_wait_t));
+    pthread_mutex_init(&wait->lock, NULL);
+    pthread_cond_init(&wait->cond, NULL);
+}
+
+static err_t batch_wait_finish(batch_wait_t* wait) {
+    pthread_mutex_lock(&wait->lock);
+    while (!wait->done) pthread_cond_wait(&wait->cond, &wait->lock);
+    pthread_mutex_unlock(&wait->lock);
+    pthread_cond_destroy(&wait->cond);
+    pthread_mutex_destroy(&wait->lock);
+    return wait->err;
+}
+
+static void batch_wait_signal(batch_wait_t* wait, err_t err) {
+    pthread_mutex_lock(&wait->lock);
+    wait->err = err;
+    wait->done = true;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+static void batch_wait_chat(err_t err, chat_response_t* response, void* user_data) {
+    batch_wait_t* wait = user_data;
+    wait->response = response;
+    batch_wait_signal(wait, err);
+}
+
+static void batch_wait_embed(err_t err, const float* vectors, void* user_data) {
+    batch_wait_t* wait = user_data;
+    if (err == ERR_OK) memcpy(wait->vectors, vectors, wait->vector_floats * sizeof(float));
+    batch_wait_signal(wait, err);
+}
+
+err_t provider_batch_chat(provider_batch_t* batch,
+                          const chat_message_t* messages,
+                          uint32_t message_count,
+                          const tool_def_t* tools,
+                          uint32_t tool_count,
+                          const char* model,
+                          double temperature,
+                          chat_response_t** out_response) {
+    if (!out_response) return ERR_INVALID_ARGUMENT;
+
+    batch_wait_t wait;
+    batch_wait_init(&wait);
+    err_t err = provider_batch_chat_async(batch, messages, message_count, tools, tool_count, model,
+                                          temperature, batch_wait_chat, &wait);
+    if (err != ERR_OK) {
+        batch_wait_signal(&wait, err);
+        batch_wait_finish(&wait);
+        return err;
+    }
+    err = batch_wait_finish(&wait);
+    if (err == ERR_OK) *out_response = wait.response;
+    return err;
+}
+
+err_t provider_batch_embed(provider_batch_t* batch,
+                           const char* model,
+                           const str_t* texts,
+                           uint32_t count,
+                           uint32_t dimensions,
+                           float* out_vectors) {
+    if (!out_vectors) return ERR_INVALID_ARGUMENT;
+
+    batch_wait_t wait;
+    batch_wait_init(&wait);
+    wait.vectors = out_vectors;
+    wait.vector_floats = (size_t)count * dimensions;
+    err_t err = provider_batch_embed_async(batch, model, texts, count, dimensions, batch_wait_embed, &wait);
+    if (err != ERR_OK) {
+        batch_wait_signal(&wait, err);
+        batch_wait_finish(&wait);
+        return err;
+    }
+    return batch_wait_finish(&wait);
+}
+
+void provider_batch_flush(provider_batch_t* batch) {
+    if (!batch) return;
+
+    pthread_mutex_lock(&batch->lock);
+    batch->flush_requested = true;
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+void provider_batch_get_stats(provider_batch_t* batch, provider_batch_stats_t* out_stats) {
+    if (!batch || !out_stats) return;
+
+    pthread_mutex_lock(&batch->lock);
+    *out_stats = batch->stats;
+    pthread_mutex_unlock(&batch->lock);
+}
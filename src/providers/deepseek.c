@@ -4,6 +4,7 @@
 #include "providers/deepseek.h"
 #include "providers/base.h"
 #include "core/error.h"
+#include "core/trace.h"
 #include "json_config.h"
 
 #include <stdlib.h>
@@ -39,6 +40,34 @@ static err_t deepseek_chat_stream(provider_t* provider,
                                   double temperature,
                                   void (*on_chunk)(const char* chunk, void* user_data),
                                   void* user_data);
+static err_t deepseek_chat_stream_deltas(provider_t* provider,
+                                         const chat_message_t* messages,
+                                         uint32_t message_count,
+                                         const tool_def_t* tools,
+                                         uint32_t tool_count,
+                                         const char* model,
+                                         double temperature,
+                                         stream_delta_callback_t on_delta,
+                                         void* user_data);
+static err_t deepseek_chat_stream_async(provider_t* provider,
+                                        http_engine_t* engine,
+                                        const chat_message_t* messages,
+                                        uint32_t message_count,
+                                        const char* model,
+                                        double temperature,
+                                        void (*on_chunk)(const char* chunk, void* user_data),
+                                        provider_stream_done_t on_done,
+                                        void* user_data);
+static err_t deepseek_chat_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const tool_def_t* tools,
+                                 uint32_t tool_count,
+                                 const char* model,
+                                 double temperature,
+                                 provider_chat_callback_t on_done,
+                                 void* user_data);
 static err_t deepseek_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count);
 static bool deepseek_supports_model(provider_t* provider, const char* model);
 static err_t deepseek_health_check(provider_t* provider, bool* out_healthy);
@@ -55,6 +84,9 @@ static const provider_vtable_t deepseek_vtable = {
     .is_connected = deepseek_is_connected,
     .chat = deepseek_chat,
     .chat_stream = deepseek_chat_stream,
+    .chat_stream_deltas = deepseek_chat_stream_deltas,
+    .chat_async = deepseek_chat_async,
+    .chat_stream_async = deepseek_chat_stream_async,
     .list_models = deepseek_list_models,
     .supports_model = deepseek_supports_model,
     .health_check = deepseek_health_check,
@@ -91,6 +123,7 @@ err_t deepseek_create(const provider_config_t* config, provider_t** out_provider
     // Create HTTP client
     http_client_config_t http_config = http_client_default_config();
     http_config.timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 60000;
+    http_config.compress_min_bytes = config->compress_requests ? HTTP_COMPRESS_MIN_BYTES_DEFAULT : 0;
     provider->http = http_client_create(&http_config);
     if (!provider->http) {
         free(provider);
@@ -166,100 +199,34 @@ static bool deepseek_is_connected(provider_t* provider) {
 static char* build_deepseek_request(const provider_t* provider,
                                     const chat_message_t* messages,
                                     uint32_t message_count,
+                                    const tool_def_t* tools,
+                                    uint32_t tool_count,
                                     const char* model,
                                     double temperature,
                                     bool stream) {
-    json_value_t* root = json_create_object();
-    if (!root) return NULL;
+    json_writer_t w;
+    json_writer_init(&w, provider_estimate_request_size(messages, message_count));
 
-    // Model
     const char* model_name = model ? model : DEFAULT_DEEPSEEK_MODEL;
-    json_object_set_string(root, "model", model_name);
-
-    // Messages array
-    json_value_t* messages_arr = json_create_array();
-    for (uint32_t i = 0; i < message_count; i++) {
-        json_value_t* msg_obj = json_create_object();
-
-        const char* role_str = "user";
-        switch (messages[i].role) {
-            case CHAT_ROLE_SYSTEM: role_str = "system"; break;
-            case CHAT_ROLE_USER: role_str = "user"; break;
-            case CHAT_ROLE_ASSISTANT: role_str = "assistant"; break;
-            case CHAT_ROLE_TOOL: role_str = "tool"; break;
-        }
-
-        json_object_set_string(msg_obj, "role", role_str);
-        json_object_set_string(msg_obj, "content", messages[i].content.data);
-        json_array_append(messages_arr, msg_obj);
-    }
-    json_object_set(root, "messages", messages_arr);
-
-    // Temperature
-    json_object_set_number(root, "temperature", temperature);
-
-    // Stream
-    json_object_set_bool(root, "stream", stream);
+    provider_write_chat_request_begin(&w, provider, messages, message_count,
+                                      tools, tool_count, model_name, temperature, stream);
 
     // Enable search if configured
     deepseek_data_t* data = (deepseek_data_t*)provider->impl_data;
     if (data && data->enable_search) {
-        json_value_t* search_options = json_create_object();
-        json_object_set_bool(search_options, "enabled", true);
-        json_object_set(root, "search_options", search_options);
+        json_write_key(&w, "search_options");
+        json_write_object_begin(&w);
+        json_write_kv_bool(&w, "enabled", true);
+        json_write_object_end(&w);
     }
 
-    char* json_str = json_print(root, false);
-    json_free(root);
-
-    return json_str;
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
 }
 
 // Parse DeepSeek chat response
-static err_t parse_deepseek_response(const char* json_str, chat_response_t* response) {
-    json_value_t* root = json_parse(json_str);
-    if (!root) return ERR_CONFIG_PARSE;
-
-    json_object_t* obj = json_as_object(root);
-    if (!obj) {
-        json_free(root);
-        return ERR_CONFIG_PARSE;
-    }
-
-    // Get choices array
-    json_array_t* choices = json_object_get_array(obj, "choices");
-    if (choices && json_array_length(choices) > 0) {
-        json_value_t* first_choice = json_array_get(choices, 0);
-        json_object_t* choice_obj = json_as_object(first_choice);
-
-        if (choice_obj) {
-            // Get message
-            json_object_t* message = json_object_get_object(choice_obj, "message");
-            if (message) {
-                const char* content = json_object_get_string(message, "content", "");
-                response->content = (str_t){ .data = strdup(content), .len = strlen(content) };
-            }
-
-            // Get finish reason
-            const char* finish_reason = json_object_get_string(choice_obj, "finish_reason", "stop");
-            response->finish_reason = (str_t){ .data = strdup(finish_reason), .len = strlen(finish_reason) };
-        }
-    }
-
-    // Get usage
-    json_object_t* usage = json_object_get_object(obj, "usage");
-    if (usage) {
-        response->prompt_tokens = (uint32_t)json_object_get_number(usage, "prompt_tokens", 0);
-        response->completion_tokens = (uint32_t)json_object_get_number(usage, "completion_tokens", 0);
-        response->total_tokens = (uint32_t)json_object_get_number(usage, "total_tokens", 0);
-    }
-
-    // Get model
-    const char* model = json_object_get_string(obj, "model", DEFAULT_DEEPSEEK_MODEL);
-    response->model = (str_t){ .data = strdup(model), .len = strlen(model) };
-
-    json_free(root);
-    return ERR_OK;
+static err_t parse_deepseek_response(char* json_str, size_t len, chat_response_t* response) {
+    return provider_parse_chat_response(json_str, len, DEFAULT_DEEPSEEK_MODEL, response);
 }
 
 static err_t deepseek_chat(provider_t* provider,
@@ -270,13 +237,10 @@ static err_t deepseek_chat(provider_t* provider,
                            const char* model,
                            double temperature,
                            chat_response_t** out_response) {
-    (void)tools;
-    (void)tool_count;
-
     if (!provider || !provider->http || !out_response) return ERR_INVALID_ARGUMENT;
 
     // Build request
-    char* request_body = build_deepseek_request(provider, messages, message_count, model, temperature, false);
+    char* request_body = build_deepseek_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     // Make request
@@ -284,16 +248,12 @@ static err_t deepseek_chat(provider_t* provider,
     snprintf(url, sizeof(url), "%s/chat/completions", DEEPSEEK_BASE_URL);
 
     http_response_t* http_resp = NULL;
-    err_t err = http_post_json(provider->http, url, request_body, &http_resp);
+    // Rate limited; non-2xx statuses come back as provider errors
+    err_t err = provider_post_json(provider, url, request_body, &http_resp);
     free(request_body);
 
     if (err != ERR_OK) return err;
 
-    if (!http_response_is_success(http_resp)) {
-        http_response_free(http_resp);
-        return ERR_PROVIDER;
-    }
-
     // Parse response
     chat_response_t* response = calloc(1, sizeof(chat_response_t));
     if (!response) {
@@ -301,7 +261,9 @@ static err_t deepseek_chat(provider_t* provider,
         return ERR_OUT_OF_MEMORY;
     }
 
-    err = parse_deepseek_response(http_resp->body.data, response);
+    TRACE_BEGIN(parse_span, "provider.parse");
+    err = parse_deepseek_response(http_response_body(http_resp), http_resp->body.len, response);
+    TRACE_END(parse_span);
     http_response_free(http_resp);
 
     if (err != ERR_OK) {
@@ -313,85 +275,6 @@ static err_t deepseek_chat(provider_t* provider,
     return ERR_OK;
 }
 
-// SSE parser context
-typedef struct {
-    void (*on_chunk)(const char* chunk, void* user_data);
-    void* user_data;
-    char* buffer;
-    size_t buffer_size;
-    size_t buffer_capacity;
-    size_t partial_line_len;
-    char partial_line[8192];  // Buffer for partial SSE lines
-} sse_parser_t;
-
-static size_t sse_parser_write(const char* data, size_t len, void* userp) {
-    sse_parser_t* parser = (sse_parser_t*)userp;
-    size_t consumed = 0;
-
-    while (consumed < len) {
-        // Find next newline
-        const char* newline = (const char*)memchr(data + consumed, '\n', len - consumed);
-        size_t chunk_end = newline ? (size_t)(newline - data) : len;
-
-        // Add to partial line buffer
-        size_t line_len = chunk_end - consumed;
-        if (parser->partial_line_len + line_len < sizeof(parser->partial_line)) {
-            memcpy(parser->partial_line + parser->partial_line_len, data + consumed, line_len);
-            parser->partial_line_len += line_len;
-        }
-
-        consumed = chunk_end;
-
-        // If we found a newline, process the line
-        if (newline) {
-            parser->partial_line[parser->partial_line_len] = '\0';
-
-            // Check if it's an SSE event line
-            if (parser->partial_line_len >= 6 && strncmp(parser->partial_line, "data: ", 6) == 0) {
-                // Skip "data: " prefix
-                const char* event_data = parser->partial_line + 6;
-
-                // Check for "[DONE]" event
-                if (strcmp(event_data, "[DONE]") == 0) {
-                    // End of stream
-                    parser->partial_line_len = 0;
-                    consumed++;  // Skip the newline
-                    continue;
-                }
-
-                // Parse JSON from event data
-                json_value_t* root = json_parse(event_data);
-                if (root) {
-                    json_object_t* obj = json_as_object(root);
-                    if (obj) {
-                        json_array_t* choices = json_object_get_array(obj, "choices");
-                        if (choices && json_array_length(choices) > 0) {
-                            json_value_t* first = json_array_get(choices, 0);
-                            json_object_t* choice_obj = json_as_object(first);
-                            if (choice_obj) {
-                                json_object_t* delta = json_object_get_object(choice_obj, "delta");
-                                if (delta) {
-                                    const char* content = json_object_get_string(delta, "content", "");
-                                    if (content && parser->on_chunk) {
-                                        parser->on_chunk(content, parser->user_data);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    json_free(root);
-                }
-            }
-
-            // Reset for next line
-            parser->partial_line_len = 0;
-            consumed++;  // Skip the newline
-        }
-    }
-
-    return len;  // Consume all data
-}
-
 static err_t deepseek_chat_stream(provider_t* provider,
                                   const chat_message_t* messages,
                                   uint32_t message_count,
@@ -402,25 +285,88 @@ static err_t deepseek_chat_stream(provider_t* provider,
     if (!provider || !provider->http || !on_chunk) return ERR_INVALID_ARGUMENT;
 
     // Build streaming request
-    char* request_body = build_deepseek_request(provider, messages, message_count, model, temperature, true);
+    char* request_body = build_deepseek_request(provider, messages, message_count, NULL, 0, model, temperature, true);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     // Build URL
     char url[512];
     snprintf(url, sizeof(url), "%s/chat/completions", DEEPSEEK_BASE_URL);
 
-    // Initialize SSE parser
-    sse_parser_t parser = {
-        .on_chunk = on_chunk,
-        .user_data = user_data,
-        .buffer = NULL,
-        .buffer_size = 0,
-        .buffer_capacity = 0,
-        .partial_line_len = 0
-    };
-
-    // Make streaming request
-    err_t err = http_post_json_stream(provider->http, url, request_body, sse_parser_write, &parser);
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        NULL, on_chunk, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t deepseek_chat_stream_deltas(provider_t* provider,
+                                         const chat_message_t* messages,
+                                         uint32_t message_count,
+                                         const tool_def_t* tools,
+                                         uint32_t tool_count,
+                                         const char* model,
+                                         double temperature,
+                                         stream_delta_callback_t on_delta,
+                                         void* user_data) {
+    if (!provider || !provider->http || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = build_deepseek_request(provider, messages, message_count, tools, tool_count,
+                                                model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", DEEPSEEK_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        on_delta, NULL, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t deepseek_chat_stream_async(provider_t* provider,
+                                        http_engine_t* engine,
+                                        const chat_message_t* messages,
+                                        uint32_t message_count,
+                                        const char* model,
+                                        double temperature,
+                                        void (*on_chunk)(const char* chunk, void* user_data),
+                                        provider_stream_done_t on_done,
+                                        void* user_data) {
+    if (!provider || !provider->http || !engine || !on_chunk || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = build_deepseek_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", DEEPSEEK_BASE_URL);
+
+    err_t err = provider_submit_stream_async(provider, engine, url, request_body, SSE_DIALECT_OPENAI,
+                                             NULL, on_chunk, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t deepseek_chat_async(provider_t* provider,
+                                 http_engine_t* engine,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const tool_def_t* tools,
+                                 uint32_t tool_count,
+                                 const char* model,
+                                 double temperature,
+                                 provider_chat_callback_t on_done,
+                                 void* user_data) {
+    if (!provider || !provider->http || !engine || !on_done) return ERR_INVALID_ARGUMENT;
+    char* request_body = build_deepseek_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", DEEPSEEK_BASE_URL);
+
+    err_t err = provider_submit_chat_async(provider, engine, url, request_body,
+                                           parse_deepseek_response, on_done, user_data);
     free(request_body);
 
     return err;
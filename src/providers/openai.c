@@ -4,6 +4,7 @@
 #include "providers/openai.h"
 #include "providers/base.h"
 #include "core/error.h"
+#include "core/trace.h"
 #include "json_config.h"
 
 #include <stdlib.h>
@@ -41,6 +42,40 @@ static err_t openai_chat_stream(provider_t* provider,
                                 double temperature,
                                 void (*on_chunk)(const char* chunk, void* user_data),
                                 void* user_data);
+static err_t openai_chat_stream_deltas(provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       stream_delta_callback_t on_delta,
+                                       void* user_data);
+static err_t openai_chat_async(provider_t* provider,
+                               http_engine_t* engine,
+                               const chat_message_t* messages,
+                               uint32_t message_count,
+                               const tool_def_t* tools,
+                               uint32_t tool_count,
+                               const char* model,
+                               double temperature,
+                               provider_chat_callback_t on_done,
+                               void* user_data);
+static err_t openai_chat_stream_async(provider_t* provider,
+                                      http_engine_t* engine,
+                                      const chat_message_t* messages,
+                                      uint32_t message_count,
+                                      const char* model,
+                                      double temperature,
+                                      void (*on_chunk)(const char* chunk, void* user_data),
+                                      provider_stream_done_t on_done,
+                                      void* user_data);
+static err_t openai_embed(provider_t* provider,
+                          const char* model,
+                          const str_t* texts,
+                          uint32_t count,
+                          uint32_t dimensions,
+                          float* out_vectors);
 static err_t openai_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count);
 static bool openai_supports_model(provider_t* provider, const char* model);
 static err_t openai_health_check(provider_t* provider, bool* out_healthy);
@@ -57,6 +92,10 @@ static const provider_vtable_t openai_vtable = {
     .is_connected = openai_is_connected,
     .chat = openai_chat,
     .chat_stream = openai_chat_stream,
+    .chat_stream_deltas = openai_chat_stream_deltas,
+    .chat_async = openai_chat_async,
+    .chat_stream_async = openai_chat_stream_async,
+    .embed = openai_embed,
     .list_models = openai_list_models,
     .supports_model = openai_supports_model,
     .health_check = openai_health_check,
@@ -93,6 +132,7 @@ err_t openai_create(const provider_config_t* config, provider_t** out_provider)
     // Create HTTP client
     http_client_config_t http_config = http_client_default_config();
     http_config.timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 60000;
+    http_config.compress_min_bytes = config->compress_requests ? HTTP_COMPRESS_MIN_BYTES_DEFAULT : 0;
     provider->http = http_client_create(&http_config);
     if (!provider->http) {
         free(provider);
@@ -165,121 +205,35 @@ static bool openai_is_connected(provider_t* provider) {
     return provider && provider->connected;
 }
 
-static char* build_openai_request(const provider_t* provider,
-                                  const chat_message_t* messages,
-                                  uint32_t message_count,
-                                  const tool_def_t* tools,
-                                  uint32_t tool_count,
-                                  const char* model,
-                                  double temperature,
-                                  bool stream) {
-    json_value_t* root = json_create_object();
-    if (!root) return NULL;
+char* openai_build_request(const provider_t* provider,
+                          const chat_message_t* messages,
+                          uint32_t message_count,
+                          const tool_def_t* tools,
+                          uint32_t tool_count,
+                          const char* model,
+                          double temperature,
+                          bool stream) {
+    json_writer_t w;
+    json_writer_init(&w, provider_estimate_request_size(messages, message_count));
 
     const char* model_name = model ? model : DEFAULT_OPENAI_MODEL;
-    json_object_set_string(root, "model", model_name);
-
-    // Build messages array
-    json_value_t* messages_arr = json_create_array();
-    for (uint32_t i = 0; i < message_count; i++) {
-        json_value_t* msg_obj = json_create_object();
-
-        // Convert role to OpenAI format
-        const char* role_str = "user";
-        switch (messages[i].role) {
-            case CHAT_ROLE_SYSTEM: role_str = "system"; break;
-            case CHAT_ROLE_USER: role_str = "user"; break;
-            case CHAT_ROLE_ASSISTANT: role_str = "assistant"; break;
-            case CHAT_ROLE_TOOL: role_str = "tool"; break;
-        }
-        json_object_set_string(msg_obj, "role", role_str);
-
-        // Set content
-        if (messages[i].content.len > 0) {
-            // Create a null-terminated copy for JSON
-            char* content_copy = malloc(messages[i].content.len + 1);
-            if (content_copy) {
-                memcpy(content_copy, messages[i].content.data, messages[i].content.len);
-                content_copy[messages[i].content.len] = '\0';
-                json_object_set_string(msg_obj, "content", content_copy);
-                free(content_copy);
-            } else {
-                json_object_set_string(msg_obj, "content", "");
-            }
-        }
-
-        // TODO: Handle tool calls if present
-        json_array_append(messages_arr, msg_obj);
-    }
-    json_object_set(root, "messages", messages_arr);
-
-    // Set temperature
-    if (temperature >= 0.0 && temperature <= 2.0) {
-        json_object_set_number(root, "temperature", temperature);
-    }
-
-    // Set stream parameter
-    if (stream) {
-        json_object_set_bool(root, "stream", true);
-    }
+    provider_write_chat_request_begin(&w, provider, messages, message_count,
+                                      tools, tool_count, model_name, temperature, stream);
 
-    // TODO: Add tools support
-    (void)tools;
-    (void)tool_count;
-
-    // TODO: Add max_tokens, top_p, etc.
+    // TODO: Add top_p, etc.
     if (provider->impl_data) {
         openai_data_t* data = (openai_data_t*)provider->impl_data;
         if (data->max_completion_tokens > 0) {
-            json_object_set_number(root, "max_tokens", (double)data->max_completion_tokens);
+            json_write_kv_int(&w, "max_tokens", data->max_completion_tokens);
         }
     }
 
-    char* json_str = json_print(root, false);
-    json_free(root);
-    return json_str;
+    json_write_object_end(&w);
+    return json_writer_finish(&w, NULL);
 }
 
-static err_t parse_openai_response(const char* json_str, chat_response_t* response) {
-    json_value_t* root = json_parse(json_str);
-    if (!root) return ERR_CONFIG_PARSE;
-
-    json_object_t* obj = json_as_object(root);
-    if (!obj) {
-        json_free(root);
-        return ERR_CONFIG_PARSE;
-    }
-
-    json_array_t* choices = json_object_get_array(obj, "choices");
-    if (choices && json_array_length(choices) > 0) {
-        json_value_t* first = json_array_get(choices, 0);
-        json_object_t* choice_obj = json_as_object(first);
-        if (choice_obj) {
-            json_object_t* message = json_object_get_object(choice_obj, "message");
-            if (message) {
-                const char* content = json_object_get_string(message, "content", "");
-                if (content) {
-                    response->content = (str_t){ .data = strdup(content), .len = strlen(content) };
-                }
-            }
-            const char* finish = json_object_get_string(choice_obj, "finish_reason", "stop");
-            response->finish_reason = (str_t){ .data = strdup(finish), .len = strlen(finish) };
-        }
-    }
-
-    const char* model = json_object_get_string(obj, "model", DEFAULT_OPENAI_MODEL);
-    response->model = (str_t){ .data = strdup(model), .len = strlen(model) };
-
-    // Parse token usage if available
-    json_object_t* usage = json_object_get_object(obj, "usage");
-    if (usage) {
-        response->prompt_tokens = (uint32_t)json_object_get_number(usage, "prompt_tokens", 0);
-        response->completion_tokens = (uint32_t)json_object_get_number(usage, "completion_tokens", 0);
-        response->total_tokens = (uint32_t)json_object_get_number(usage, "total_tokens", 0);
-    }
-
-    json_free(root);
-    return ERR_OK;
+err_t openai_parse_response(char* json_str, size_t len, chat_response_t* response) {
+    return provider_parse_chat_response(json_str, len, DEFAULT_OPENAI_MODEL, response);
 }
 
 static err_t openai_chat(provider_t* provider,
@@ -293,7 +247,7 @@ static err_t openai_chat(provider_t* provider,
     if (!provider || !provider->http || !out_response) return ERR_INVALID_ARGUMENT;
 
     // Build request JSON
-    char* request_body = build_openai_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    char* request_body = openai_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     // Build URL
@@ -302,14 +256,11 @@ static err_t openai_chat(provider_t* provider,
 
     // Send request
     http_response_t* http_resp = NULL;
-    err_t err = http_post_json(provider->http, url, request_body, &http_resp);
+    // Rate limited; non-2xx statuses come back as provider errors
+    err_t err = provider_post_json(provider, url, request_body, &http_resp);
     free(request_body);
 
     if (err != ERR_OK) return err;
-    if (!http_response_is_success(http_resp)) {
-        http_response_free(http_resp);
-        return ERR_PROVIDER;
-    }
 
     // Parse response
     chat_response_t* response = calloc(1, sizeof(chat_response_t));
@@ -318,7 +269,9 @@ static err_t openai_chat(provider_t* provider,
         return ERR_OUT_OF_MEMORY;
     }
 
-    err = parse_openai_response(http_resp->body.data, response);
+    TRACE_BEGIN(parse_span, "provider.parse");
+    err = openai_parse_response(http_response_body(http_resp), http_resp->body.len, response);
+    TRACE_END(parse_span);
     http_response_free(http_resp);
 
     if (err != ERR_OK) {
@@ -330,6 +283,44 @@ static err_t openai_chat(provider_t* provider,
     return ERR_OK;
 }
 
+static err_t openai_chat_async(provider_t* provider,
+                               http_engine_t* engine,
+                               const chat_message_t* messages,
+                               uint32_t message_count,
+                               const tool_def_t* tools,
+                               uint32_t tool_count,
+                               const char* model,
+                               double temperature,
+                               provider_chat_callback_t on_done,
+                               void* user_data) {
+    if (!provider || !provider->http || !engine || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = openai_build_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENAI_BASE_URL);
+
+    err_t err = provider_submit_chat_async(provider, engine, url, request_body,
+                                           openai_parse_response, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t openai_embed(provider_t* provider,
+                          const char* model,
+                          const str_t* texts,
+                          uint32_t count,
+                          uint32_t dimensions,
+                          float* out_vectors) {
+    char url[512];
+    snprintf(url, sizeof(url), "%s/embeddings", OPENAI_BASE_URL);
+
+    return provider_embed_openai_compatible(provider, url, model ? model : "text-embedding-3-small",
+                                            texts, count, dimensions, out_vectors);
+}
+
 static err_t openai_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count) {
     (void)provider;
     if (!out_models || !out_count) return ERR_INVALID_ARGUMENT;
@@ -438,79 +429,6 @@ err_t openai_set_include_reasoning(provider_t* provider, bool include) {
     return ERR_OK;
 }
 
-// SSE parser context for OpenAI
-typedef struct {
-    void (*on_chunk)(const char* chunk, void* user_data);
-    void* user_data;
-    char* buffer;
-    size_t buffer_size;
-    size_t buffer_capacity;
-    size_t partial_line_len;
-    char partial_line[8192];
-} openai_sse_parser_t;
-
-static size_t openai_sse_parser_write(const char* data, size_t len, void* userp) {
-    openai_sse_parser_t* parser = (openai_sse_parser_t*)userp;
-    size_t consumed = 0;
-
-    while (consumed < len) {
-        const char* newline = (const char*)memchr(data + consumed, '\n', len - consumed);
-        size_t chunk_end = newline ? (size_t)(newline - data) : len;
-
-        size_t line_len = chunk_end - consumed;
-        if (parser->partial_line_len + line_len < sizeof(parser->partial_line)) {
-            memcpy(parser->partial_line + parser->partial_line_len, data + consumed, line_len);
-            parser->partial_line_len += line_len;
-        }
-
-        consumed = chunk_end;
-
-        if (newline) {
-            parser->partial_line[parser->partial_line_len] = '\0';
-
-            // Check for SSE event line
-            if (parser->partial_line_len >= 6 && strncmp(parser->partial_line, "data: ", 6) == 0) {
-                const char* event_data = parser->partial_line + 6;
-
-                // Check for "[DONE]" event
-                if (strcmp(event_data, "[DONE]") == 0) {
-                    parser->partial_line_len = 0;
-                    consumed++;
-                    continue;
-                }
-
-                // Parse JSON from event data
-                json_value_t* root = json_parse(event_data);
-                if (root) {
-                    json_object_t* obj = json_as_object(root);
-                    if (obj) {
-                        json_array_t* choices = json_object_get_array(obj, "choices");
-                        if (choices && json_array_length(choices) > 0) {
-                            json_value_t* first = json_array_get(choices, 0);
-                            json_object_t* choice_obj = json_as_object(first);
-                            if (choice_obj) {
-                                json_object_t* delta = json_object_get_object(choice_obj, "delta");
-                                if (delta) {
-                                    const char* content = json_object_get_string(delta, "content", "");
-                                    if (content && parser->on_chunk) {
-                                        parser->on_chunk(content, parser->user_data);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    json_free(root);
-                }
-            }
-
-            parser->partial_line_len = 0;
-            consumed++;
-        }
-    }
-
-    return len;
-}
-
 static err_t openai_chat_stream(provider_t* provider,
                                 const chat_message_t* messages,
                                 uint32_t message_count,
@@ -521,26 +439,65 @@ static err_t openai_chat_stream(provider_t* provider,
     if (!provider || !provider->http || !on_chunk) return ERR_INVALID_ARGUMENT;
 
     // Build streaming request
-    char* request_body = build_openai_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    char* request_body = openai_build_request(provider, messages, message_count, NULL, 0, model, temperature, true);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     // Build URL
     char url[512];
     snprintf(url, sizeof(url), "%s/chat/completions", OPENAI_BASE_URL);
 
-    // Initialize SSE parser
-    openai_sse_parser_t parser = {
-        .on_chunk = on_chunk,
-        .user_data = user_data,
-        .buffer = NULL,
-        .buffer_size = 0,
-        .buffer_capacity = 0,
-        .partial_line_len = 0
-    };
-
-    // Make streaming request
-    err_t err = http_post_json_stream(provider->http, url, request_body, openai_sse_parser_write, &parser);
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        NULL, on_chunk, user_data);
     free(request_body);
 
     return err;
-}
\ No newline at end of file
+}
+
+static err_t openai_chat_stream_deltas(provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       stream_delta_callback_t on_delta,
+                                       void* user_data) {
+    if (!provider || !provider->http || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = openai_build_request(provider, messages, message_count, tools, tool_count,
+                                              model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENAI_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        on_delta, NULL, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t openai_chat_stream_async(provider_t* provider,
+                                      http_engine_t* engine,
+                                      const chat_message_t* messages,
+                                      uint32_t message_count,
+                                      const char* model,
+                                      double temperature,
+                                      void (*on_chunk)(const char* chunk, void* user_data),
+                                      provider_stream_done_t on_done,
+                                      void* user_data) {
+    if (!provider || !provider->http || !engine || !on_chunk || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = openai_build_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENAI_BASE_URL);
+
+    err_t err = provider_submit_stream_async(provider, engine, url, request_body, SSE_DIALECT_OPENAI,
+                                             NULL, on_chunk, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
@@ -4,6 +4,7 @@
 #include "providers/openrouter.h"
 #include "providers/base.h"
 #include "core/error.h"
+#include "core/trace.h"
 #include "json_config.h"
 
 #include <stdlib.h>
@@ -32,6 +33,41 @@ static err_t openrouter_chat(provider_t* provider,
                              const char* model,
                              double temperature,
                              chat_response_t** out_response);
+static err_t openrouter_chat_stream(provider_t* provider,
+                                    const chat_message_t* messages,
+                                    uint32_t message_count,
+                                    const char* model,
+                                    double temperature,
+                                    void (*on_chunk)(const char* chunk, void* user_data),
+                                    void* user_data);
+static err_t openrouter_chat_stream_deltas(provider_t* provider,
+                                           const chat_message_t* messages,
+                                           uint32_t message_count,
+                                           const tool_def_t* tools,
+                                           uint32_t tool_count,
+                                           const char* model,
+                                           double temperature,
+                                           stream_delta_callback_t on_delta,
+                                           void* user_data);
+static err_t openrouter_chat_stream_async(provider_t* provider,
+                                          http_engine_t* engine,
+                                          const chat_message_t* messages,
+                                          uint32_t message_count,
+                                          const char* model,
+                                          double temperature,
+                                          void (*on_chunk)(const char* chunk, void* user_data),
+                                          provider_stream_done_t on_done,
+                                          void* user_data);
+static err_t openrouter_chat_async(provider_t* provider,
+                                   http_engine_t* engine,
+                                   const chat_message_t* messages,
+                                   uint32_t message_count,
+                                   const tool_def_t* tools,
+                                   uint32_t tool_count,
+                                   const char* model,
+                                   double temperature,
+                                   provider_chat_callback_t on_done,
+                                   void* user_data);
 static err_t openrouter_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count);
 static bool openrouter_supports_model(provider_t* provider, const char* model);
 static err_t openrouter_health_check(provider_t* provider, bool* out_healthy);
@@ -46,7 +82,10 @@ static const provider_vtable_t openrouter_vtable = {
     .disconnect = openrouter_disconnect,
     .is_connected = openrouter_is_connected,
     .chat = openrouter_chat,
-    .chat_stream = NULL,
+    .chat_stream = openrouter_chat_stream,
+    .chat_stream_deltas = openrouter_chat_stream_deltas,
+    .chat_async = openrouter_chat_async,
+    .chat_stream_async = openrouter_chat_stream_async,
     .list_models = openrouter_list_models,
     .supports_model = openrouter_supports_model,
     .health_check = openrouter_health_check,
@@ -80,6 +119,7 @@ err_t openrouter_create(const provider_config_t* config, provider_t** out_provid
 
     http_client_config_t http_config = http_client_default_config();
     http_config.timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 60000;
+    http_config.compress_min_bytes = config->compress_requests ? HTTP_COMPRESS_MIN_BYTES_DEFAULT : 0;
     provider->http = http_client_create(&http_config);
     if (!provider->http) {
         free(provider);
@@ -142,67 +182,18 @@ static bool openrouter_is_connected(provider_t* provider) {
 static char* build_openrouter_request(const provider_t* provider,
                                       const chat_message_t* messages,
                                       uint32_t message_count,
+                                      const tool_def_t* tools,
+                                      uint32_t tool_count,
                                       const char* model,
-                                      double temperature) {
-    json_value_t* root = json_create_object();
-    if (!root) return NULL;
-
+                                      double temperature,
+                                      bool stream) {
     const char* model_name = model ? model : DEFAULT_OPENROUTER_MODEL;
-    json_object_set_string(root, "model", model_name);
-
-    json_value_t* messages_arr = json_create_array();
-    for (uint32_t i = 0; i < message_count; i++) {
-        json_value_t* msg_obj = json_create_object();
-        const char* role_str = "user";
-        switch (messages[i].role) {
-            case CHAT_ROLE_SYSTEM: role_str = "system"; break;
-            case CHAT_ROLE_USER: role_str = "user"; break;
-            case CHAT_ROLE_ASSISTANT: role_str = "assistant"; break;
-            case CHAT_ROLE_TOOL: role_str = "tool"; break;
-        }
-        json_object_set_string(msg_obj, "role", role_str);
-        json_object_set_string(msg_obj, "content", messages[i].content.data);
-        json_array_append(messages_arr, msg_obj);
-    }
-    json_object_set(root, "messages", messages_arr);
-
-    json_object_set_number(root, "temperature", temperature);
-
-    char* json_str = json_print(root, false);
-    json_free(root);
-    return json_str;
+    return provider_build_chat_request(provider, messages, message_count, tools, tool_count,
+                                       model_name, temperature, stream);
 }
 
-static err_t parse_openrouter_response(const char* json_str, chat_response_t* response) {
-    json_value_t* root = json_parse(json_str);
-    if (!root) return ERR_CONFIG_PARSE;
-
-    json_object_t* obj = json_as_object(root);
-    if (!obj) {
-        json_free(root);
-        return ERR_CONFIG_PARSE;
-    }
-
-    json_array_t* choices = json_object_get_array(obj, "choices");
-    if (choices && json_array_length(choices) > 0) {
-        json_value_t* first = json_array_get(choices, 0);
-        json_object_t* choice_obj = json_as_object(first);
-        if (choice_obj) {
-            json_object_t* message = json_object_get_object(choice_obj, "message");
-            if (message) {
-                const char* content = json_object_get_string(message, "content", "");
-                response->content = (str_t){ .data = strdup(content), .len = strlen(content) };
-            }
-            const char* finish = json_object_get_string(choice_obj, "finish_reason", "stop");
-            response->finish_reason = (str_t){ .data = strdup(finish), .len = strlen(finish) };
-        }
-    }
-
-    const char* model = json_object_get_string(obj, "model", DEFAULT_OPENROUTER_MODEL);
-    response->model = (str_t){ .data = strdup(model), .len = strlen(model) };
-
-    json_free(root);
-    return ERR_OK;
+static err_t parse_openrouter_response(char* json_str, size_t len, chat_response_t* response) {
+    return provider_parse_chat_response(json_str, len, DEFAULT_OPENROUTER_MODEL, response);
 }
 
 static err_t openrouter_chat(provider_t* provider,
@@ -213,25 +204,20 @@ static err_t openrouter_chat(provider_t* provider,
                              const char* model,
                              double temperature,
                              chat_response_t** out_response) {
-    (void)tools;
-    (void)tool_count;
     if (!provider || !provider->http || !out_response) return ERR_INVALID_ARGUMENT;
 
-    char* request_body = build_openrouter_request(provider, messages, message_count, model, temperature);
+    char* request_body = build_openrouter_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
     if (!request_body) return ERR_OUT_OF_MEMORY;
 
     char url[512];
     snprintf(url, sizeof(url), "%s/chat/completions", OPENROUTER_BASE_URL);
 
     http_response_t* http_resp = NULL;
-    err_t err = http_post_json(provider->http, url, request_body, &http_resp);
+    // Rate limited; non-2xx statuses come back as provider errors
+    err_t err = provider_post_json(provider, url, request_body, &http_resp);
     free(request_body);
 
     if (err != ERR_OK) return err;
-    if (!http_response_is_success(http_resp)) {
-        http_response_free(http_resp);
-        return ERR_PROVIDER;
-    }
 
     chat_response_t* response = calloc(1, sizeof(chat_response_t));
     if (!response) {
@@ -239,7 +225,9 @@ static err_t openrouter_chat(provider_t* provider,
         return ERR_OUT_OF_MEMORY;
     }
 
-    err = parse_openrouter_response(http_resp->body.data, response);
+    TRACE_BEGIN(parse_span, "provider.parse");
+    err = parse_openrouter_response(http_response_body(http_resp), http_resp->body.len, response);
+    TRACE_END(parse_span);
     http_response_free(http_resp);
 
     if (err != ERR_OK) {
@@ -251,6 +239,103 @@ static err_t openrouter_chat(provider_t* provider,
     return ERR_OK;
 }
 
+static err_t openrouter_chat_stream(provider_t* provider,
+                                    const chat_message_t* messages,
+                                    uint32_t message_count,
+                                    const char* model,
+                                    double temperature,
+                                    void (*on_chunk)(const char* chunk, void* user_data),
+                                    void* user_data) {
+    if (!provider || !provider->http || !on_chunk) return ERR_INVALID_ARGUMENT;
+
+    // Build streaming request
+    char* request_body = build_openrouter_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    // Build URL
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENROUTER_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        NULL, on_chunk, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t openrouter_chat_stream_deltas(provider_t* provider,
+                                           const chat_message_t* messages,
+                                           uint32_t message_count,
+                                           const tool_def_t* tools,
+                                           uint32_t tool_count,
+                                           const char* model,
+                                           double temperature,
+                                           stream_delta_callback_t on_delta,
+                                           void* user_data) {
+    if (!provider || !provider->http || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = build_openrouter_request(provider, messages, message_count, tools, tool_count,
+                                                  model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENROUTER_BASE_URL);
+
+    err_t err = provider_stream_request(provider, url, request_body, SSE_DIALECT_OPENAI,
+                                        on_delta, NULL, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t openrouter_chat_stream_async(provider_t* provider,
+                                          http_engine_t* engine,
+                                          const chat_message_t* messages,
+                                          uint32_t message_count,
+                                          const char* model,
+                                          double temperature,
+                                          void (*on_chunk)(const char* chunk, void* user_data),
+                                          provider_stream_done_t on_done,
+                                          void* user_data) {
+    if (!provider || !provider->http || !engine || !on_chunk || !on_done) return ERR_INVALID_ARGUMENT;
+
+    char* request_body = build_openrouter_request(provider, messages, message_count, NULL, 0, model, temperature, true);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENROUTER_BASE_URL);
+
+    err_t err = provider_submit_stream_async(provider, engine, url, request_body, SSE_DIALECT_OPENAI,
+                                             NULL, on_chunk, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
+static err_t openrouter_chat_async(provider_t* provider,
+                                   http_engine_t* engine,
+                                   const chat_message_t* messages,
+                                   uint32_t message_count,
+                                   const tool_def_t* tools,
+                                   uint32_t tool_count,
+                                   const char* model,
+                                   double temperature,
+                                   provider_chat_callback_t on_done,
+                                   void* user_data) {
+    if (!provider || !provider->http || !engine || !on_done) return ERR_INVALID_ARGUMENT;
+    char* request_body = build_openrouter_request(provider, messages, message_count, tools, tool_count, model, temperature, false);
+    if (!request_body) return ERR_OUT_OF_MEMORY;
+
+    char url[512];
+    snprintf(url, sizeof(url), "%s/chat/completions", OPENROUTER_BASE_URL);
+
+    err_t err = provider_submit_chat_async(provider, engine, url, request_body,
+                                           parse_openrouter_response, on_done, user_data);
+    free(request_body);
+
+    return err;
+}
+
 static err_t openrouter_list_models(provider_t* provider, str_t** out_models, uint32_t* out_count) {
     (void)provider;
     if (!out_models || !out_count) return ERR_INVALID_ARGUMENT;
@@ -0,0 +1,352 @@
+// ratelimit.c - Retry policy and server-reported rate limits for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "providers/ratelimit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+// ============================================================================
+// Header parsing
+// ============================================================================
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int64_t realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t until_ms(int64_t epoch_ms) {
+    int64_t delta = epoch_ms - realtime_ms();
+    return delta > 0 ? (uint64_t)delta : 0;
+}
+
+static const char* header(const http_response_t* response, const char* const* names) {
+    for (; *names; names++) {
+        const char* value = http_response_get_header((http_response_t*)response, *names);
+        if (value && *value) return value;
+    }
+    return NULL;
+}
+
+// Go-style duration as OpenAI sends it: "20ms", "1.5s", "6m0s", "1h2m3s"
+static bool parse_duration_ms(const char* text, uint64_t* out_ms) {
+    double total = 0;
+    const char* p = text;
+    bool any = false;
+    while (*p) {
+        char* end = NULL;
+        double value = strtod(p, &end);
+        if (end == p) return false;
+        p = end;
+        if (p[0] == 'm' && p[1] == 's') {
+            total += value;
+            p += 2;
+        } else if (*p == 'h') {
+            total += value * 3600000.0;
+            p++;
+        } else if (*p == 'm') {
+            total += value * 60000.0;
+            p++;
+        } else if (*p == 's') {
+            total += value * 1000.0;
+            p++;
+        } else {
+            return false;
+        }
+        any = true;
+    }
+    if (!any || total < 0) return false;
+    *out_ms = (uint64_t)ceil(total);
+    return true;
+}
+
+// Reset headers come as durations, RFC 3339 times (Anthropic), epoch
+// seconds or milliseconds (OpenRouter) or plain seconds
+static uint64_t parse_reset_ms(const char* text) {
+    uint64_t ms = 0;
+    if (parse_duration_ms(text, &ms)) return ms;
+
+    if (strchr(text, 'T')) {
+        struct tm tm = {0};
+        if (!strptime(text, "%Y-%m-%dT%H:%M:%S", &tm)) return 0;
+        return until_ms((int64_t)timegm(&tm) * 1000);
+    }
+
+    char* end = NULL;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return 0;
+    if (value > 1e12) return until_ms((int64_t)value);
+    if (value > 1e9) return until_ms((int64_t)(value * 1000.0));
+    return (uint64_t)ceil(value * 1000.0);
+}
+
+// Retry-After is delay-seconds or an HTTP date
+static uint64_t parse_retry_after_ms(const char* text) {
+    if (isdigit((unsigned char)*text)) {
+        char* end = NULL;
+        double seconds = strtod(text, &end);
+        return seconds > 0 ? (uint64_t)ceil(seconds * 1000.0) : 0;
+    }
+
+    struct tm tm = {0};
+    if (!strptime(text, "%a, %d %b %Y %H:%M:%S", &tm)) return 0;
+    return until_ms((int64_t)timegm(&tm) * 1000);
+}
+
+static int64_t parse_count(const char* text) {
+    if (!text) return -1;
+    char* end = NULL;
+    long long value = strtoll(text, &end, 10);
+    return end == text || value < 0 ? -1 : (int64_t)value;
+}
+
+void rate_limit_parse(const http_response_t* response, rate_limit_info_t* out_info) {
+    if (!out_info) return;
+    *out_info = (rate_limit_info_t){ .requests_limit = -1, .requests_remaining = -1, .tokens_remaining = -1 };
+    if (!response || !response->headers_count) return;
+
+    static const char* const retry_ms[] = { "retry-after-ms", NULL };
+    static const char* const retry[] = { "retry-after", NULL };
+    static const char* const req_limit[] = {
+        "x-ratelimit-limit-requests", "anthropic-ratelimit-requests-limit", "x-ratelimit-limit", NULL
+    };
+    static const char* const req_remaining[] = {
+        "x-ratelimit-remaining-requests", "anthropic-ratelimit-requests-remaining", "x-ratelimit-remaining", NULL
+    };
+    static const char* const req_reset[] = {
+        "x-ratelimit-reset-requests", "anthropic-ratelimit-requests-reset", "x-ratelimit-reset", NULL
+    };
+    static const char* const tok_remaining[] = {
+        "x-ratelimit-remaining-tokens", "anthropic-ratelimit-tokens-remaining", NULL
+    };
+    static const char* const tok_reset[] = {
+        "x-ratelimit-reset-tokens", "anthropic-ratelimit-tokens-reset", NULL
+    };
+
+    const char* value = header(response, retry_ms);
+    if (value) {
+        double ms = strtod(value, NULL);
+        out_info->retry_after_ms = ms > 0 ? (uint64_t)ceil(ms) : 0;
+    } else if ((value = header(response, retry))) {
+        out_info->retry_after_ms = parse_retry_after_ms(value);
+    }
+
+    out_info->requests_limit = parse_count(header(response, req_limit));
+    out_info->requests_remaining = parse_count(header(response, req_remaining));
+    if ((value = header(response, req_reset))) out_info->requests_reset_ms = parse_reset_ms(value);
+    out_info->tokens_remaining = parse_count(header(response, tok_remaining));
+    if ((value = header(response, tok_reset))) out_info->tokens_reset_ms = parse_reset_ms(value);
+}
+
+// ============================================================================
+// Buckets
+// ============================================================================
+
+typedef struct rate_bucket_t {
+    uint64_t key;              // 0 = free slot
+    bool limited;              // The server reported request limits
+    double tokens;             // May go negative: permits reserved ahead
+    double capacity;
+    double refill_per_ms;
+    uint64_t updated_ms;
+    uint64_t blocked_until_ms;
+} rate_bucket_t;
+
+static rate_bucket_t g_buckets[RATE_LIMIT_SLOTS];
+static pthread_mutex_t g_buckets_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t rate_limit_key(str_t provider_name, str_t api_key) {
+    // FNV-1a over both strings; 0 is reserved for free slots
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < provider_name.len; i++) hash = (hash ^ (uint8_t)provider_name.data[i]) * 0x100000001b3ULL;
+    hash = (hash ^ 0xff) * 0x100000001b3ULL;
+    for (uint32_t i = 0; i < api_key.len; i++) hash = (hash ^ (uint8_t)api_key.data[i]) * 0x100000001b3ULL;
+    return hash ? hash : 1;
+}
+
+// Under g_buckets_lock. A full table recycles the key's home slot.
+static rate_bucket_t* bucket_find(uint64_t key, bool create) {
+    uint32_t home = (uint32_t)(key % RATE_LIMIT_SLOTS);
+    for (uint32_t i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        rate_bucket_t* bucket = &g_buckets[(home + i) % RATE_LIMIT_SLOTS];
+        if (bucket->key == key) return bucket;
+        if (!bucket->key) {
+            if (!create) return NULL;
+            *bucket = (rate_bucket_t){ .key = key, .updated_ms = monotonic_ms() };
+            return bucket;
+        }
+    }
+    if (!create) return NULL;
+    g_buckets[home] = (rate_bucket_t){ .key = key, .updated_ms = monotonic_ms() };
+    return &g_buckets[home];
+}
+
+static void bucket_refill(rate_bucket_t* bucket, uint64_t now) {
+    if (bucket->limited && bucket->refill_per_ms > 0 && now > bucket->updated_ms) {
+        bucket->tokens += (double)(now - bucket->updated_ms) * bucket->refill_per_ms;
+        if (bucket->tokens > bucket->capacity) bucket->tokens = bucket->capacity;
+    }
+    bucket->updated_ms = now;
+}
+
+static uint64_t bucket_wait(const rate_bucket_t* bucket, uint64_t now, double tokens) {
+    uint64_t wait = bucket->blocked_until_ms > now ? bucket->blocked_until_ms - now : 0;
+    if (bucket->limited && tokens < 0 && bucket->refill_per_ms > 0) {
+        uint64_t refill_wait = (uint64_t)ceil(-tokens / bucket->refill_per_ms);
+        if (refill_wait > wait) wait = refill_wait;
+    }
+    return wait;
+}
+
+uint64_t rate_limit_reserve(uint64_t key) {
+    pthread_mutex_lock(&g_buckets_lock);
+    rate_bucket_t* bucket = bucket_find(key, false);
+    uint64_t wait = 0;
+    if (bucket) {
+        uint64_t now = monotonic_ms();
+        bucket_refill(bucket, now);
+        if (bucket->limited) bucket->tokens -= 1.0;
+        wait = bucket_wait(bucket, now, bucket->tokens);
+    }
+    pthread_mutex_unlock(&g_buckets_lock);
+    return wait;
+}
+
+uint64_t rate_limit_try(uint64_t key) {
+    pthread_mutex_lock(&g_buckets_lock);
+    rate_bucket_t* bucket = bucket_find(key, false);
+    uint64_t wait = 0;
+    if (bucket) {
+        uint64_t now = monotonic_ms();
+        bucket_refill(bucket, now);
+        wait = bucket_wait(bucket, now, bucket->limited ? bucket->tokens - 1.0 : 0);
+        if (!wait && bucket->limited) bucket->tokens -= 1.0;
+    }
+    pthread_mutex_unlock(&g_buckets_lock);
+    return wait;
+}
+
+static void bucket_block(rate_bucket_t* bucket, uint64_t now, uint64_t pause_ms) {
+    if (pause_ms && now + pause_ms > bucket->blocked_until_ms) bucket->blocked_until_ms = now + pause_ms;
+}
+
+void rate_limit_update(uint64_t key, uint32_t status, const rate_limit_info_t* info) {
+    if (!info) return;
+    bool reported = info->requests_limit > 0 || info->requests_remaining >= 0 ||
+                    info->tokens_remaining >= 0 || info->retry_after_ms;
+    if (!reported && status != 429) return;
+
+    pthread_mutex_lock(&g_buckets_lock);
+    rate_bucket_t* bucket = bucket_find(key, true);
+    uint64_t now = monotonic_ms();
+    bucket_refill(bucket, now);
+
+    // The server's count is authoritative; the refill rate brings the
+    // bucket back to full when the window resets
+    if (info->requests_limit > 0 && info->requests_remaining >= 0) {
+        double limit = (double)info->requests_limit;
+        double remaining = (double)info->requests_remaining;
+        uint64_t window_ms = info->requests_reset_ms ? info->requests_reset_ms : 60000;
+        double missing = limit - remaining > 1.0 ? limit - remaining : 1.0;
+        bucket->limited = true;
+        bucket->capacity = limit;
+        bucket->tokens = remaining;
+        bucket->refill_per_ms = missing / (double)window_ms;
+        if (bucket->refill_per_ms < limit / 60000.0) bucket->refill_per_ms = limit / 60000.0;
+    }
+    if (info->requests_remaining == 0) bucket_block(bucket, now, info->requests_reset_ms);
+    if (info->tokens_remaining == 0) bucket_block(bucket, now, info->tokens_reset_ms);
+
+    if (status == 429) {
+        uint64_t pause = info->retry_after_ms ? info->retry_after_ms : info->requests_reset_ms;
+        bucket_block(bucket, now, pause ? pause : RATE_LIMIT_DEFAULT_BLOCK_MS);
+        if (bucket->tokens > 0) bucket->tokens = 0;
+    } else {
+        bucket_block(bucket, now, info->retry_after_ms);
+    }
+    pthread_mutex_unlock(&g_buckets_lock);
+}
+
+uint64_t rate_limit_blocked_ms(uint64_t key) {
+    pthread_mutex_lock(&g_buckets_lock);
+    rate_bucket_t* bucket = bucket_find(key, false);
+    uint64_t now = monotonic_ms();
+    uint64_t wait = bucket && bucket->blocked_until_ms > now ? bucket->blocked_until_ms - now : 0;
+    pthread_mutex_unlock(&g_buckets_lock);
+    return wait;
+}
+
+void rate_limit_reset(void) {
+    pthread_mutex_lock(&g_buckets_lock);
+    memset(g_buckets, 0, sizeof(g_buckets));
+    pthread_mutex_unlock(&g_buckets_lock);
+}
+
+// ============================================================================
+// Retry policy
+// ============================================================================
+
+static uint64_t jitter_random(void) {
+    static __thread uint64_t state;
+    if (!state) state = monotonic_ms() ^ ((uint64_t)(uintptr_t)&state << 16) ^ 0x9E3779B97F4A7C15ULL;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+uint64_t retry_backoff_ms(const retry_policy_t* policy, uint32_t attempt, uint64_t min_delay_ms) {
+    uint64_t base = policy && policy->base_delay_ms ? policy->base_delay_ms : 1000;
+    uint64_t cap = policy && policy->max_delay_ms ? policy->max_delay_ms : RETRY_MAX_DELAY_MS;
+
+    uint64_t ceiling = base;
+    for (uint32_t i = 0; i < attempt && ceiling < cap; i++) ceiling *= 2;
+    if (ceiling > cap) ceiling = cap;
+
+    uint64_t delay = ceiling / 2 + jitter_random() % (ceiling - ceiling / 2 + 1);
+    return delay > min_delay_ms ? delay : min_delay_ms;
+}
+
+bool retry_is_retryable(err_t err) {
+    switch (err) {
+        case ERR_NETWORK:
+        case ERR_TIMEOUT:
+        case ERR_PROVIDER_UNAVAILABLE:
+        case ERR_PROVIDER_RATE_LIMIT:
+        case ERR_CONNECTION_FAILED:
+        case ERR_CONNECTION_TIMEOUT:
+        case ERR_HTTP_ERROR:
+        case ERR_RATE_LIMITED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+err_t rate_limit_status_error(uint32_t status) {
+    switch (status) {
+        case 401:
+        case 403:
+            return ERR_PROVIDER_AUTH;
+        case 402:
+            return ERR_PROVIDER_QUOTA_EXCEEDED;
+        case 408:
+            return ERR_TIMEOUT;
+        case 429:
+            return ERR_PROVIDER_RATE_LIMIT;
+        default:
+            return status >= 500 ? ERR_PROVIDER_UNAVAILABLE : ERR_PROVIDER;
+    }
+}
@@ -0,0 +1,538 @@
+// replay.c - Provider serving recorded HTTP exchanges
+// SPDX-License-Identifier: MIT
+
+#include "providers/replay.h"
+#include "providers/anthropic.h"
+#include "providers/base.h"
+#include "providers/openai.h"
+#include "providers/ratelimit.h"
+#include "core/error.h"
+#include "json_config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct replay_chunk_t {
+    char* data;
+    uint32_t len;
+    uint64_t at_us;            // From the start of the request
+} replay_chunk_t;
+
+typedef struct replay_exchange_t {
+    sse_dialect_t dialect;
+    bool streaming;
+    uint32_t status;
+    uint64_t elapsed_us;
+    char* body;                // Non-streamed responses
+    uint32_t body_len;
+    replay_chunk_t* chunks;    // Streamed responses
+    uint32_t chunk_count;
+    uint64_t prompt_key;       // Hash of the last user message, 0 = none
+} replay_exchange_t;
+
+// Exchanges of one kind with a prompt, sorted by key; turn lives in the
+// first entry of each run of equal keys
+typedef struct replay_key_t {
+    uint64_t key;
+    uint32_t index;
+    uint32_t turn;
+} replay_key_t;
+
+typedef struct replay_kind_t {
+    uint32_t* order;           // Capture order
+    uint32_t count;
+    uint32_t next;
+    replay_key_t* keys;
+    uint32_t key_count;
+} replay_kind_t;
+
+typedef struct replay_data_t {
+    replay_exchange_t* exchanges;
+    uint32_t count;
+    uint32_t skipped;
+    replay_kind_t kinds[2];    // [streaming]
+    double time_scale;
+    uint64_t served;
+    uint64_t matched;
+} replay_data_t;
+
+// ============================================================================
+// Capture loading
+// ============================================================================
+
+static uint64_t prompt_key(const char* text, size_t len) {
+    // FNV-1a; 0 is reserved for "no prompt"
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+static bool has_suffix(const char* text, const char* suffix) {
+    size_t len = strlen(text), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(text + len - suffix_len, suffix) == 0;
+}
+
+// Last user message of an OpenAI or Anthropic request body; Anthropic
+// content blocks count by their first text block
+static uint64_t request_prompt_key(const char* request) {
+    json_value_t* root = json_parse(request);
+    json_array_t* messages = json_object_get_array(json_as_object(root), "messages");
+    uint64_t key = 0;
+
+    for (size_t i = messages ? json_array_length(messages) : 0; i > 0 && !key; i--) {
+        json_object_t* msg = json_as_object(json_array_get(messages, i - 1));
+        if (strcmp(json_object_get_string(msg, "role", ""), "user") != 0) continue;
+
+        json_value_t* content = json_object_get(msg, "content");
+        const char* text = json_as_string(content, NULL);
+        json_array_t* blocks = json_as_array(content);
+        for (size_t j = 0; !text && blocks && j < json_array_length(blocks); j++) {
+            text = json_object_get_string(json_as_object(json_array_get(blocks, j)), "text", NULL);
+        }
+        // A user turn without text (tool results) is not the prompt
+        if (text) key = prompt_key(text, strlen(text));
+    }
+
+    json_free(root);
+    return key;
+}
+
+static char* copy_string(const char* text, uint32_t* out_len) {
+    size_t len = strlen(text);
+    char* copy = malloc(len + 1);
+    if (copy) memcpy(copy, text, len + 1);
+    *out_len = (uint32_t)len;
+    return copy;
+}
+
+static void exchange_free(replay_exchange_t* exchange) {
+    free(exchange->body);
+    for (uint32_t i = 0; i < exchange->chunk_count; i++) free(exchange->chunks[i].data);
+    free(exchange->chunks);
+}
+
+// ERR_NOT_FOUND for lines that are not chat exchanges
+static err_t exchange_parse(const char* line, size_t len, replay_exchange_t* out) {
+    json_value_t* root = json_parse_len(line, len);
+    json_object_t* obj = json_as_object(root);
+    if (!obj) {
+        json_free(root);
+        return ERR_CONFIG_PARSE;
+    }
+
+    const char* method = json_object_get_string(obj, "method", "");
+    const char* url = json_object_get_string(obj, "url", "");
+    bool anthropic = has_suffix(url, "/messages");
+    if (strcmp(method, "POST") != 0 || (!anthropic && !has_suffix(url, "/chat/completions"))) {
+        json_free(root);
+        return ERR_NOT_FOUND;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->dialect = anthropic ? SSE_DIALECT_ANTHROPIC : SSE_DIALECT_OPENAI;
+    out->streaming = json_object_get_bool(obj, "stream", false);
+    out->status = (uint32_t)json_object_get_number(obj, "status", 200);
+    out->elapsed_us = (uint64_t)(json_object_get_number(obj, "elapsed_ms", 0) * 1000.0);
+    out->prompt_key = request_prompt_key(json_object_get_string(obj, "request", "{}"));
+
+    err_t err = ERR_OK;
+    if (out->streaming) {
+        json_array_t* chunks = json_object_get_array(obj, "chunks");
+        size_t count = chunks ? json_array_length(chunks) : 0;
+        out->chunks = count ? calloc(count, sizeof(replay_chunk_t)) : NULL;
+        if (count && !out->chunks) err = ERR_OUT_OF_MEMORY;
+        for (size_t i = 0; err == ERR_OK && i < count; i++) {
+            json_object_t* chunk = json_as_object(json_array_get(chunks, i));
+            replay_chunk_t* slot = &out->chunks[out->chunk_count];
+            slot->at_us = (uint64_t)(json_object_get_number(chunk, "at_ms", 0) * 1000.0);
+            slot->data = copy_string(json_object_get_string(chunk, "data", ""), &slot->len);
+            if (!slot->data) err = ERR_OUT_OF_MEMORY;
+            else out->chunk_count++;
+        }
+    } else {
+        out->body = copy_string(json_object_get_string(obj, "body", ""), &out->body_len);
+        if (!out->body) err = ERR_OUT_OF_MEMORY;
+    }
+
+    json_free(root);
+    if (err != ERR_OK) exchange_free(out);
+    return err;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    const replay_key_t* x = a;
+    const replay_key_t* y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+static err_t build_kinds(replay_data_t* data) {
+    for (uint32_t i = 0; i < data->count; i++) {
+        replay_kind_t* kind = &data->kinds[data->exchanges[i].streaming];
+        kind->count++;
+        if (data->exchanges[i].prompt_key) kind->key_count++;
+    }
+
+    for (uint32_t k = 0; k < 2; k++) {
+        replay_kind_t* kind = &data->kinds[k];
+        kind->order = calloc(kind->count ? kind->count : 1, sizeof(uint32_t));
+        kind->keys = calloc(kind->key_count ? kind->key_count : 1, sizeof(replay_key_t));
+        if (!kind->order || !kind->keys) return ERR_OUT_OF_MEMORY;
+        kind->count = 0;
+        kind->key_count = 0;
+    }
+
+    for (uint32_t i = 0; i < data->count; i++) {
+        const replay_exchange_t* exchange = &data->exchanges[i];
+        replay_kind_t* kind = &data->kinds[exchange->streaming];
+        kind->order[kind->count++] = i;
+        if (exchange->prompt_key) {
+            kind->keys[kind->key_count++] = (replay_key_t){ .key = exchange->prompt_key, .index = i };
+        }
+    }
+
+    // Equal keys stay in capture order
+    for (uint32_t k = 0; k < 2; k++) {
+        qsort(data->kinds[k].keys, data->kinds[k].key_count, sizeof(replay_key_t), compare_keys);
+    }
+    return ERR_OK;
+}
+
+static err_t replay_load(replay_data_t* data, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return errno == ENOENT ? ERR_NOT_FOUND : ERR_IO;
+
+    uint32_t capacity = 0;
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    err_t err = ERR_OK;
+
+    while (err == ERR_OK && (len = getline(&line, &line_cap, file)) > 0) {
+        if (data->count == capacity) {
+            uint32_t new_capacity = capacity ? capacity * 2 : 64;
+            replay_exchange_t* grown = realloc(data->exchanges, new_capacity * sizeof(replay_exchange_t));
+            if (!grown) {
+                err = ERR_OUT_OF_MEMORY;
+                break;
+            }
+            data->exchanges = grown;
+            capacity = new_capacity;
+        }
+
+        err = exchange_parse(line, (size_t)len, &data->exchanges[data->count]);
+        if (err == ERR_OK) {
+            data->count++;
+        } else if (err == ERR_NOT_FOUND || err == ERR_CONFIG_PARSE) {
+            // Other endpoints, or a line cut short by a crash while recording
+            data->skipped++;
+            err = ERR_OK;
+        }
+    }
+
+    free(line);
+    fclose(file);
+    if (err == ERR_OK && data->count == 0) err = ERR_NOT_FOUND;
+    return err == ERR_OK ? build_kinds(data) : err;
+}
+
+static void replay_data_free(replay_data_t* data) {
+    if (!data) return;
+    for (uint32_t i = 0; i < data->count; i++) exchange_free(&data->exchanges[i]);
+    free(data->exchanges);
+    for (uint32_t k = 0; k < 2; k++) {
+        free(data->kinds[k].order);
+        free(data->kinds[k].keys);
+    }
+    free(data);
+}
+
+// ============================================================================
+// Serving
+// ============================================================================
+
+static const replay_exchange_t* replay_pick(replay_data_t* data, const chat_message_t* messages,
+                                            uint32_t message_count, bool streaming) {
+    replay_kind_t* kind = &data->kinds[streaming];
+    if (kind->count == 0) return NULL;
+    __atomic_fetch_add(&data->served, 1, __ATOMIC_RELAXED);
+
+    uint64_t key = 0;
+    for (uint32_t i = message_count; i > 0 && !key; i--) {
+        if (messages[i - 1].role == CHAT_ROLE_USER && !str_empty(messages[i - 1].content)) {
+            key = prompt_key(messages[i - 1].content.data, messages[i - 1].content.len);
+        }
+    }
+
+    if (key) {
+        // First entry with this key
+        uint32_t lo = 0, hi = kind->key_count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (kind->keys[mid].key < key) lo = mid + 1;
+            else hi = mid;
+        }
+        uint32_t end = lo;
+        while (end < kind->key_count && kind->keys[end].key == key) end++;
+
+        if (end > lo) {
+            uint32_t turn = __atomic_fetch_add(&kind->keys[lo].turn, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&data->matched, 1, __ATOMIC_RELAXED);
+            return &data->exchanges[kind->keys[lo + turn % (end - lo)].index];
+        }
+    }
+
+    uint32_t next = __atomic_fetch_add(&kind->next, 1, __ATOMIC_RELAXED);
+    return &data->exchanges[kind->order[next % kind->count]];
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Until offset_us (scaled) after start
+static void wait_until(uint64_t start_us, uint64_t offset_us, double time_scale) {
+    if (time_scale <= 0.0 || offset_us == 0) return;
+
+    uint64_t deadline = start_us + (uint64_t)((double)offset_us * time_scale);
+    uint64_t now = now_us();
+    if (now >= deadline) return;
+
+    uint64_t wait = deadline - now;
+    struct timespec ts = { .tv_sec = (time_t)(wait / 1000000), .tv_nsec = (long)(wait % 1000000) * 1000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static err_t replay_status_error(uint32_t status) {
+    return status >= 200 && status < 300 ? ERR_OK : rate_limit_status_error(status);
+}
+
+static err_t replay_chat(provider_t* provider,
+                         const chat_message_t* messages,
+                         uint32_t message_count,
+                         const tool_def_t* tools,
+                         uint32_t tool_count,
+                         const char* model,
+                         double temperature,
+                         chat_response_t** out_response) {
+    if (!provider || !provider->impl_data || !out_response) return ERR_INVALID_ARGUMENT;
+
+    replay_data_t* data = provider->impl_data;
+    uint64_t start = now_us();
+    const replay_exchange_t* exchange = replay_pick(data, messages, message_count, false);
+    if (!exchange) return ERR_NOT_FOUND;
+
+    wait_until(start, exchange->elapsed_us, data->time_scale);
+    err_t err = replay_status_error(exchange->status);
+    if (err != ERR_OK) return err;
+
+    // The parsers work in place
+    char* body = malloc((size_t)exchange->body_len + 1);
+    chat_response_t* response = calloc(1, sizeof(chat_response_t));
+    if (!body || !response) {
+        free(body);
+        free(response);
+        return ERR_OUT_OF_MEMORY;
+    }
+    memcpy(body, exchange->body, (size_t)exchange->body_len + 1);
+
+    if (exchange->dialect == SSE_DIALECT_ANTHROPIC) {
+        err = anthropic_parse_response(body, exchange->body_len, response);
+    } else {
+        err = openai_parse_response(body, exchange->body_len, response);
+    }
+    free(body);
+
+    if (err != ERR_OK) {
+        chat_response_free(response);
+        return err;
+    }
+    *out_response = response;
+    return ERR_OK;
+}
+
+static err_t replay_stream(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                           stream_delta_callback_t on_delta,
+                           void (*on_chunk)(const char* chunk, void* user_data), void* user_data) {
+    if (!provider || !provider->impl_data || (!on_delta && !on_chunk)) return ERR_INVALID_ARGUMENT;
+
+    replay_data_t* data = provider->impl_data;
+    uint64_t start = now_us();
+    const replay_exchange_t* exchange = replay_pick(data, messages, message_count, true);
+    if (!exchange) return ERR_NOT_FOUND;
+
+    sse_parser_t parser;
+    err_t err = sse_parser_init(&parser, exchange->dialect, on_delta, on_chunk, user_data);
+    if (err != ERR_OK) return err;
+
+    // Chunks arrive as they did, so lines split across writes split again
+    for (uint32_t i = 0; i < exchange->chunk_count; i++) {
+        wait_until(start, exchange->chunks[i].at_us, data->time_scale);
+        sse_parser_feed(exchange->chunks[i].data, exchange->chunks[i].len, &parser);
+    }
+    sse_parser_free(&parser);
+
+    return replay_status_error(exchange->status);
+}
+
+static err_t replay_chat_stream(provider_t* provider,
+                                const chat_message_t* messages,
+                                uint32_t message_count,
+                                const char* model,
+                                double temperature,
+                                void (*on_chunk)(const char* chunk, void* user_data),
+                                void* user_data) {
+    if (!on_chunk) return ERR_INVALID_ARGUMENT;
+    return replay_stream(provider, messages, message_count, NULL, on_chunk, user_data);
+}
+
+static err_t replay_chat_stream_deltas(provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       stream_delta_callback_t on_delta,
+                                       void* user_data) {
+    if (!on_delta) return ERR_INVALID_ARGUMENT;
+    return replay_stream(provider, messages, message_count, on_delta, NULL, user_data);
+}
+
+// ============================================================================
+// Provider
+// ============================================================================
+
+static str_t replay_get_name(void) {
+    return STR_LIT("replay");
+}
+
+static str_t replay_get_version(void) {
+    return STR_LIT("1.0.0");
+}
+
+static err_t replay_connect(provider_t* provider) {
+    if (!provider) return ERR_INVALID_ARGUMENT;
+    provider->connected = true;
+    return ERR_OK;
+}
+
+static void replay_disconnect(provider_t* provider) {
+    if (provider) provider->connected = false;
+}
+
+static bool replay_is_connected(provider_t* provider) {
+    return provider && provider->connected;
+}
+
+// Whatever model the capture was recorded with
+static bool replay_supports_model(provider_t* provider, const char* model) {
+    return model != NULL;
+}
+
+static err_t replay_health_check(provider_t* provider, bool* out_healthy) {
+    if (!provider || !out_healthy) return ERR_INVALID_ARGUMENT;
+    *out_healthy = provider->impl_data != NULL;
+    return ERR_OK;
+}
+
+static const char** replay_get_available_models(uint32_t* out_count) {
+    static const char* models[] = { NULL };
+    if (out_count) *out_count = 0;
+    return models;
+}
+
+static const provider_vtable_t replay_vtable = {
+    .get_name = replay_get_name,
+    .get_version = replay_get_version,
+    .create = replay_create,
+    .destroy = replay_destroy,
+    .connect = replay_connect,
+    .disconnect = replay_disconnect,
+    .is_connected = replay_is_connected,
+    .chat = replay_chat,
+    .chat_stream = replay_chat_stream,
+    .chat_stream_deltas = replay_chat_stream_deltas,
+    .supports_model = replay_supports_model,
+    .health_check = replay_health_check,
+    .get_available_models = replay_get_available_models
+};
+
+const provider_vtable_t* replay_get_vtable(void) {
+    return &replay_vtable;
+}
+
+err_t replay_create(const provider_config_t* config, provider_t** out_provider) {
+    if (!config || !out_provider) return ERR_INVALID_ARGUMENT;
+
+    // base_url, with or without file://, or the environment
+    char path[4096];
+    if (!str_empty(config->base_url)) {
+        str_t url = config->base_url;
+        if (url.len > 7 && strncmp(url.data, "file://", 7) == 0) {
+            url.data += 7;
+            url.len -= 7;
+        }
+        snprintf(path, sizeof(path), "%.*s", (int)url.len, url.data);
+    } else {
+        const char* env = getenv("CCLAW_REPLAY_FILE");
+        if (!env || !env[0]) return ERR_INVALID_ARGUMENT;
+        snprintf(path, sizeof(path), "%s", env);
+    }
+
+    replay_data_t* data = calloc(1, sizeof(replay_data_t));
+    if (!data) return ERR_OUT_OF_MEMORY;
+
+    const char* scale = getenv("CCLAW_REPLAY_TIME_SCALE");
+    data->time_scale = scale ? strtod(scale, NULL) : REPLAY_DEFAULT_TIME_SCALE;
+    if (data->time_scale < 0.0) data->time_scale = 0.0;
+
+    err_t err = replay_load(data, path);
+    if (err != ERR_OK) {
+        replay_data_free(data);
+        return err;
+    }
+
+    provider_t* provider = calloc(1, sizeof(provider_t));
+    if (!provider) {
+        replay_data_free(data);
+        return ERR_OUT_OF_MEMORY;
+    }
+    provider->vtable = &replay_vtable;
+    provider->config = *config;
+    provider->impl_data = data;
+
+    *out_provider = provider;
+    return ERR_OK;
+}
+
+void replay_destroy(provider_t* provider) {
+    if (!provider) return;
+    replay_data_free(provider->impl_data);
+    free(provider);
+}
+
+err_t replay_set_time_scale(provider_t* provider, double time_scale) {
+    if (!provider || !provider->impl_data || time_scale < 0.0) return ERR_INVALID_ARGUMENT;
+    ((replay_data_t*)provider->impl_data)->time_scale = time_scale;
+    return ERR_OK;
+}
+
+err_t replay_get_stats(provider_t* provider, replay_stats_t* out_stats) {
+    if (!provider || !provider->impl_data || !out_stats) return ERR_INVALID_ARGUMENT;
+
+    replay_data_t* data = provider->impl_data;
+    out_stats->exchanges = data->count;
+    out_stats->skipped = data->skipped;
+    out_stats->served = __atomic_load_n(&data->served, __ATOMIC_RELAXED);
+    out_stats->matched = __atomic_load_n(&data->matched, __ATOMIC_RELAXED);
+    return ERR_OK;
+}
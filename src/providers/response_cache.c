@@ -0,0 +1,592 @@
+// response_cache.c - Content-addressed cache of deterministic chat responses
+// SPDX-License-Identifier: MIT
+
+#include "providers/response_cache.h"
+#include "core/metrics.h"
+
+#include <sodium.h>
+#include <sqlite3.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct cache_entry_t {
+    uint8_t key[RESPONSE_CACHE_KEY_BYTES];
+    uint64_t expires_at;               // Wall-clock seconds
+    chat_response_t response;
+    struct cache_entry_t* hash_next;
+    struct cache_entry_t* prev;        // LRU list, most recent first
+    struct cache_entry_t* next;
+} cache_entry_t;
+
+struct response_cache_t {
+    uint32_t max_entries;
+    uint64_t ttl_secs;
+    double max_temperature;
+
+    // LRU tier
+    pthread_mutex_t lock;
+    cache_entry_t** buckets;
+    uint32_t bucket_mask;
+    cache_entry_t* head;
+    cache_entry_t* tail;
+    uint32_t count;
+    response_cache_stats_t stats;
+
+    // SQLite tier
+    pthread_mutex_t db_lock;
+    sqlite3* db;
+    sqlite3_stmt* stmt_get;
+    sqlite3_stmt* stmt_put;
+};
+
+static __thread bool t_bypass;
+
+static uint64_t wall_secs(void) {
+    return (uint64_t)time(NULL);
+}
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+// Length-prefixed so adjacent fields cannot run into each other
+static void hash_field(crypto_generichash_state* state, const void* data, size_t len) {
+    uint64_t prefix = len;
+    crypto_generichash_update(state, (const unsigned char*)&prefix, sizeof(prefix));
+    if (len) crypto_generichash_update(state, (const unsigned char*)data, len);
+}
+
+static void hash_str(crypto_generichash_state* state, str_t s) {
+    hash_field(state, s.data, s.len);
+}
+
+void response_cache_hash_request(str_t provider_name,
+                                 const char* model,
+                                 double temperature,
+                                 const chat_message_t* messages,
+                                 uint32_t message_count,
+                                 const tool_def_t* tools,
+                                 uint32_t tool_count,
+                                 uint8_t out_key[RESPONSE_CACHE_KEY_BYTES]) {
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, NULL, 0, RESPONSE_CACHE_KEY_BYTES);
+    hash_str(&state, provider_name);
+    hash_field(&state, model, model ? strlen(model) : 0);
+    hash_field(&state, &temperature, sizeof(temperature));
+
+    uint32_t count = tool_count;
+    hash_field(&state, &count, sizeof(count));
+    for (uint32_t i = 0; i < tool_count; i++) {
+        hash_str(&state, tools[i].name);
+        hash_str(&state, tools[i].description);
+        hash_str(&state, tools[i].parameters);
+    }
+
+    count = message_count;
+    hash_field(&state, &count, sizeof(count));
+    for (uint32_t i = 0; i < message_count; i++) {
+        uint32_t role = (uint32_t)messages[i].role;
+        hash_field(&state, &role, sizeof(role));
+        hash_str(&state, messages[i].content);
+        hash_str(&state, messages[i].tool_calls);
+        hash_str(&state, messages[i].tool_call_id);
+    }
+
+    crypto_generichash_final(&state, out_key, RESPONSE_CACHE_KEY_BYTES);
+}
+
+bool response_cache_key(const response_cache_t* cache,
+                        str_t provider_name,
+                        const char* model,
+                        double temperature,
+                        const chat_message_t* messages,
+                        uint32_t message_count,
+                        const tool_def_t* tools,
+                        uint32_t tool_count,
+                        uint8_t out_key[RESPONSE_CACHE_KEY_BYTES]) {
+    if (!cache || !out_key || t_bypass || temperature > cache->max_temperature) return false;
+
+    response_cache_hash_request(provider_name, model, temperature, messages, message_count,
+                                tools, tool_count, out_key);
+    return true;
+}
+
+bool response_cache_set_bypass(bool bypass) {
+    bool previous = t_bypass;
+    t_bypass = bypass;
+    return previous;
+}
+
+// ============================================================================
+// Responses
+// ============================================================================
+
+static void response_copy(const chat_response_t* src, chat_response_t* dst) {
+    *dst = *src;
+    dst->content = str_dup(src->content, NULL);
+    dst->finish_reason = str_dup(src->finish_reason, NULL);
+    dst->model = str_dup(src->model, NULL);
+    dst->tool_calls = str_dup(src->tool_calls, NULL);
+}
+
+// ============================================================================
+// LRU tier
+// ============================================================================
+
+static uint32_t bucket_of(const response_cache_t* cache, const uint8_t* key) {
+    uint32_t h;
+    memcpy(&h, key, sizeof(h));
+    return h & cache->bucket_mask;
+}
+
+static cache_entry_t** entry_slot(response_cache_t* cache, const uint8_t* key) {
+    cache_entry_t** slot = &cache->buckets[bucket_of(cache, key)];
+    while (*slot && memcmp((*slot)->key, key, RESPONSE_CACHE_KEY_BYTES) != 0) {
+        slot = &(*slot)->hash_next;
+    }
+    return slot;
+}
+
+static void lru_unlink(response_cache_t* cache, cache_entry_t* entry) {
+    if (entry->prev) entry->prev->next = entry->next; else cache->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev; else cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void lru_push_front(response_cache_t* cache, cache_entry_t* entry) {
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry;
+    cache->head = entry;
+    if (!cache->tail) cache->tail = entry;
+}
+
+static void entry_remove(response_cache_t* cache, cache_entry_t* entry) {
+    cache_entry_t** slot = entry_slot(cache, entry->key);
+    *slot = entry->hash_next;
+    lru_unlink(cache, entry);
+    chat_response_clear(&entry->response);
+    free(entry);
+    cache->count--;
+}
+
+static void memory_put(response_cache_t* cache, const uint8_t* key, uint64_t expires_at,
+                       const chat_response_t* response) {
+    cache_entry_t* existing = *entry_slot(cache, key);
+    if (existing) entry_remove(cache, existing);
+    if (cache->count >= cache->max_entries && cache->tail) entry_remove(cache, cache->tail);
+
+    cache_entry_t* entry = calloc(1, sizeof(cache_entry_t));
+    if (!entry) return;
+    memcpy(entry->key, key, RESPONSE_CACHE_KEY_BYTES);
+    entry->expires_at = expires_at;
+    response_copy(response, &entry->response);
+
+    cache_entry_t** slot = &cache->buckets[bucket_of(cache, key)];
+    entry->hash_next = *slot;
+    *slot = entry;
+    lru_push_front(cache, entry);
+    cache->count++;
+}
+
+// ============================================================================
+// SQLite tier
+// ============================================================================
+
+static const char* CACHE_SCHEMA =
+    "PRAGMA journal_mode=WAL;"
+    "CREATE TABLE IF NOT EXISTS response_cache ("
+    "  key BLOB PRIMARY KEY,"
+    "  expires_at INTEGER NOT NULL,"
+    "  content TEXT,"
+    "  finish_reason TEXT,"
+    "  model TEXT,"
+    "  tool_calls TEXT,"
+    "  prompt_tokens INTEGER,"
+    "  completion_tokens INTEGER,"
+    "  total_tokens INTEGER"
+    ") WITHOUT ROWID;";
+
+static err_t db_open(response_cache_t* cache, const char* path) {
+    if (sqlite3_open(path, &cache->db) != SQLITE_OK) goto fail;
+    if (sqlite3_exec(cache->db, CACHE_SCHEMA, NULL, NULL, NULL) != SQLITE_OK) goto fail;
+
+    // Expired rows are pruned once per open; lookups skip the rest
+    char prune[96];
+    snprintf(prune, sizeof(prune), "DELETE FROM response_cache WHERE expires_at <= %llu;",
+             (unsigned long long)wall_secs());
+    sqlite3_exec(cache->db, prune, NULL, NULL, NULL);
+
+    if (sqlite3_prepare_v2(cache->db,
+                           "SELECT expires_at, content, finish_reason, model, tool_calls,"
+                           " prompt_tokens, completion_tokens, total_tokens"
+                           " FROM response_cache WHERE key = ?;",
+                           -1, &cache->stmt_get, NULL) != SQLITE_OK) goto fail;
+    if (sqlite3_prepare_v2(cache->db,
+                           "INSERT OR REPLACE INTO response_cache VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);",
+                           -1, &cache->stmt_put, NULL) != SQLITE_OK) goto fail;
+    return ERR_OK;
+
+fail:
+    sqlite3_finalize(cache->stmt_get);
+    sqlite3_close(cache->db);
+    cache->stmt_get = NULL;
+    cache->db = NULL;
+    return ERR_MEMORY;
+}
+
+static str_t column_str(sqlite3_stmt* stmt, int column) {
+    const char* text = (const char*)sqlite3_column_text(stmt, column);
+    int bytes = sqlite3_column_bytes(stmt, column);
+    return text ? str_dup((str_t){ .data = text, .len = (uint32_t)bytes }, NULL) : STR_NULL;
+}
+
+static void bind_str(sqlite3_stmt* stmt, int index, str_t s) {
+    if (str_empty(s)) sqlite3_bind_null(stmt, index);
+    else sqlite3_bind_text(stmt, index, s.data, (int)s.len, SQLITE_STATIC);
+}
+
+static bool db_get(response_cache_t* cache, const uint8_t* key, uint64_t* out_expires,
+                   chat_response_t* out_response) {
+    bool found = false;
+    pthread_mutex_lock(&cache->db_lock);
+    sqlite3_stmt* stmt = cache->stmt_get;
+    sqlite3_bind_blob(stmt, 1, key, RESPONSE_CACHE_KEY_BYTES, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        uint64_t expires_at = (uint64_t)sqlite3_column_int64(stmt, 0);
+        if (expires_at > wall_secs()) {
+            *out_expires = expires_at;
+            out_response->content = column_str(stmt, 1);
+            out_response->finish_reason = column_str(stmt, 2);
+            out_response->model = column_str(stmt, 3);
+            out_response->tool_calls = column_str(stmt, 4);
+            out_response->prompt_tokens = (uint32_t)sqlite3_column_int(stmt, 5);
+            out_response->completion_tokens = (uint32_t)sqlite3_column_int(stmt, 6);
+            out_response->total_tokens = (uint32_t)sqlite3_column_int(stmt, 7);
+            found = true;
+        }
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    pthread_mutex_unlock(&cache->db_lock);
+    return found;
+}
+
+static void db_put(response_cache_t* cache, const uint8_t* key, uint64_t expires_at,
+                   const chat_response_t* response) {
+    pthread_mutex_lock(&cache->db_lock);
+    sqlite3_stmt* stmt = cache->stmt_put;
+    sqlite3_bind_blob(stmt, 1, key, RESPONSE_CACHE_KEY_BYTES, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)expires_at);
+    bind_str(stmt, 3, response->content);
+    bind_str(stmt, 4, response->finish_reason);
+    bind_str(stmt, 5, response->model);
+    bind_str(stmt, 6, response->tool_calls);
+    sqlite3_bind_int(stmt, 7, (int)response->prompt_tokens);
+    sqlite3_bind_int(stmt, 8, (int)response->completion_tokens);
+    sqlite3_bind_int(stmt, 9, (int)response->total_tokens);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    pthread_mutex_unlock(&cache->db_lock);
+}
+
+// ============================================================================
+// Cache
+// ============================================================================
+
+err_t response_cache_create(const response_cache_config_t* config, response_cache_t** out_cache) {
+    if (!config || !out_cache) return ERR_INVALID_ARGUMENT;
+    if (sodium_init() < 0) return ERR_RUNTIME;
+
+    response_cache_t* cache = calloc(1, sizeof(response_cache_t));
+    if (!cache) return ERR_OUT_OF_MEMORY;
+
+    cache->max_entries = config->max_entries ? config->max_entries : RESPONSE_CACHE_DEFAULT_ENTRIES;
+    cache->ttl_secs = config->ttl_secs ? config->ttl_secs : RESPONSE_CACHE_DEFAULT_TTL_SECS;
+    cache->max_temperature = config->max_temperature;
+
+    // Power-of-two buckets at no more than half load
+    uint32_t buckets = 16;
+    while (buckets < cache->max_entries * 2 && buckets < (1u << 30)) buckets <<= 1;
+    cache->buckets = calloc(buckets, sizeof(cache_entry_t*));
+    if (!cache->buckets) {
+        free(cache);
+        return ERR_OUT_OF_MEMORY;
+    }
+    cache->bucket_mask = buckets - 1;
+
+    if (config->db_path) {
+        err_t err = db_open(cache, config->db_path);
+        if (err != ERR_OK) {
+            free(cache->buckets);
+            free(cache);
+            return err;
+        }
+    }
+
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_mutex_init(&cache->db_lock, NULL);
+    *out_cache = cache;
+    return ERR_OK;
+}
+
+void response_cache_destroy(response_cache_t* cache) {
+    if (!cache) return;
+
+    while (cache->head) entry_remove(cache, cache->head);
+    free(cache->buckets);
+
+    if (cache->db) {
+        sqlite3_finalize(cache->stmt_get);
+        sqlite3_finalize(cache->stmt_put);
+        sqlite3_close(cache->db);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    pthread_mutex_destroy(&cache->db_lock);
+    free(cache);
+}
+
+err_t response_cache_create_from_config(const config_t* config, response_cache_t** out_cache) {
+    if (!config || !out_cache) return ERR_INVALID_ARGUMENT;
+
+    char path[512];
+    response_cache_config_t cache_config = {
+        .max_entries = config->response_cache.max_entries,
+        .ttl_secs = config->response_cache.ttl_secs,
+        .max_temperature = config->response_cache.max_temperature
+    };
+    if (config->response_cache.persist && !str_empty(config->workspace_dir)) {
+        snprintf(path, sizeof(path), "%.*s/response_cache.db",
+                 (int)config->workspace_dir.len, config->workspace_dir.data);
+        cache_config.db_path = path;
+    }
+    return response_cache_create(&cache_config, out_cache);
+}
+
+// out_tier names where the hit came from ("memory", "disk") or "miss"
+static bool cache_lookup(response_cache_t* cache, const uint8_t* key, chat_response_t** out_response,
+                         const char** out_tier) {
+    *out_tier = "miss";
+
+    uint64_t now = wall_secs();
+    pthread_mutex_lock(&cache->lock);
+    cache_entry_t* entry = *entry_slot(cache, key);
+    if (entry && entry->expires_at <= now) {
+        entry_remove(cache, entry);
+        entry = NULL;
+    }
+    if (entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        *out_response = chat_response_copy(&entry->response);
+        cache->stats.memory_hits++;
+        pthread_mutex_unlock(&cache->lock);
+        *out_tier = "memory";
+        return *out_response != NULL;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    chat_response_t stored = {0};
+    uint64_t expires_at = 0;
+    bool found = cache->db && db_get(cache, key, &expires_at, &stored);
+
+    pthread_mutex_lock(&cache->lock);
+    if (found) {
+        memory_put(cache, key, expires_at, &stored);
+        cache->stats.disk_hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (!found) return false;
+    *out_tier = "disk";
+    *out_response = chat_response_copy(&stored);
+    chat_response_clear(&stored);
+    return *out_response != NULL;
+}
+
+bool response_cache_get(response_cache_t* cache, const uint8_t key[RESPONSE_CACHE_KEY_BYTES],
+                        chat_response_t** out_response) {
+    if (!cache || !key || !out_response) return false;
+    const char* tier;
+    return cache_lookup(cache, key, out_response, &tier);
+}
+
+void response_cache_put(response_cache_t* cache, const uint8_t key[RESPONSE_CACHE_KEY_BYTES],
+                        const chat_response_t* response) {
+    if (!cache || !key || !response) return;
+    // An empty answer is more likely a glitch than the stable reply
+    if (str_empty(response->content) && str_empty(response->tool_calls)) return;
+
+    uint64_t expires_at = wall_secs() + cache->ttl_secs;
+    pthread_mutex_lock(&cache->lock);
+    memory_put(cache, key, expires_at, response);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (cache->db) db_put(cache, key, expires_at, response);
+}
+
+void response_cache_clear(response_cache_t* cache) {
+    if (!cache) return;
+
+    pthread_mutex_lock(&cache->lock);
+    while (cache->head) entry_remove(cache, cache->head);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (cache->db) {
+        pthread_mutex_lock(&cache->db_lock);
+        sqlite3_exec(cache->db, "DELETE FROM response_cache;", NULL, NULL, NULL);
+        pthread_mutex_unlock(&cache->db_lock);
+    }
+}
+
+void response_cache_get_stats(response_cache_t* cache, response_cache_stats_t* out_stats) {
+    if (!cache || !out_stats) return;
+
+    pthread_mutex_lock(&cache->lock);
+    *out_stats = cache->stats;
+    out_stats->entries = cache->count;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// ============================================================================
+// Caching provider
+// ============================================================================
+
+typedef struct cached_provider_t {
+    response_cache_t* cache;
+    provider_t* inner;
+} cached_provider_t;
+
+static cached_provider_t* cached_impl(provider_t* provider) {
+    return provider ? (cached_provider_t*)provider->impl_data : NULL;
+}
+
+static str_t cached_get_name(void) {
+    return STR_LIT("cache");
+}
+
+static str_t cached_get_version(void) {
+    return STR_LIT("1.0.0");
+}
+
+static void cached_destroy(provider_t* provider) {
+    if (!provider) return;
+    cached_provider_t* impl = cached_impl(provider);
+    if (impl) {
+        provider_free(impl->inner);
+        response_cache_destroy(impl->cache);
+        free(impl);
+    }
+    free(provider);
+}
+
+static err_t cached_chat(provider_t* provider,
+                         const chat_message_t* messages,
+                         uint32_t message_count,
+                         const tool_def_t* tools,
+                         uint32_t tool_count,
+                         const char* model,
+                         double temperature,
+                         chat_response_t** out_response) {
+    cached_provider_t* impl = cached_impl(provider);
+    if (!impl || !out_response) return ERR_INVALID_ARGUMENT;
+    provider_t* inner = impl->inner;
+    if (!inner->vtable->chat) return ERR_NOT_IMPLEMENTED;
+
+    // A NULL model means the provider default, which is part of the answer
+    const char* keyed_model = model ? model : inner->config.default_model.data;
+    uint8_t key[RESPONSE_CACHE_KEY_BYTES];
+    bool cacheable = response_cache_key(impl->cache, inner->config.name, keyed_model, temperature,
+                                        messages, message_count, tools, tool_count, key);
+    if (cacheable) {
+        const char* tier;
+        bool hit = cache_lookup(impl->cache, key, out_response, &tier);
+        metric_inc(metric_get(&METRIC_RESPONSE_CACHE, inner->config.name, STR_VIEW(tier)), 1);
+        if (hit) return ERR_OK;
+    }
+
+    err_t err = inner->vtable->chat(inner, messages, message_count, tools, tool_count,
+                                    model, temperature, out_response);
+    if (err == ERR_OK && cacheable) response_cache_put(impl->cache, key, *out_response);
+    return err;
+}
+
+static err_t cached_chat_stream_deltas(provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       stream_delta_callback_t on_delta,
+                                       void* user_data) {
+    cached_provider_t* impl = cached_impl(provider);
+    if (!impl) return ERR_INVALID_ARGUMENT;
+    return provider_chat_stream_deltas(impl->inner, messages, message_count, tools, tool_count,
+                                       model, temperature, on_delta, user_data);
+}
+
+static err_t cached_embed(provider_t* provider, const char* model, const str_t* texts,
+                          uint32_t count, uint32_t dimensions, float* out_vectors) {
+    cached_provider_t* impl = cached_impl(provider);
+    if (!impl) return ERR_INVALID_ARGUMENT;
+    return provider_embed(impl->inner, model, texts, count, dimensions, out_vectors);
+}
+
+static bool cached_supports_model(provider_t* provider, const char* model) {
+    cached_provider_t* impl = cached_impl(provider);
+    if (!impl || !impl->inner->vtable->supports_model) return false;
+    return impl->inner->vtable->supports_model(impl->inner, model);
+}
+
+static err_t cached_health_check(provider_t* provider, bool* out_healthy) {
+    cached_provider_t* impl = cached_impl(provider);
+    if (!impl || !out_healthy) return ERR_INVALID_ARGUMENT;
+    if (!impl->inner->vtable->health_check) {
+        *out_healthy = true;
+        return ERR_OK;
+    }
+    return impl->inner->vtable->health_check(impl->inner, out_healthy);
+}
+
+static err_t cached_prewarm(provider_t* provider) {
+    cached_provider_t* impl = cached_impl(provider);
+    return impl ? provider_prewarm(impl->inner) : ERR_INVALID_ARGUMENT;
+}
+
+static const provider_vtable_t cached_vtable = {
+    .get_name = cached_get_name,
+    .get_version = cached_get_version,
+    .destroy = cached_destroy,
+    .chat = cached_chat,
+    .chat_stream_deltas = cached_chat_stream_deltas,
+    .embed = cached_embed,
+    .supports_model = cached_supports_model,
+    .health_check = cached_health_check,
+    .prewarm = cached_prewarm
+};
+
+err_t response_cache_wrap(response_cache_t* cache, provider_t* inner, provider_t** out_provider) {
+    if (!cache || !inner || !inner->vtable || !out_provider) return ERR_INVALID_ARGUMENT;
+
+    provider_t* provider = provider_alloc(&cached_vtable);
+    cached_provider_t* impl = calloc(1, sizeof(cached_provider_t));
+    if (!provider || !impl) {
+        free(provider);
+        free(impl);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    impl->cache = cache;
+    impl->inner = inner;
+    provider->impl_data = impl;
+    provider->config = inner->config;
+    provider->connected = true;
+    *out_provider = provider;
+    return ERR_OK;
+}
@@ -10,62 +10,113 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 
 #define MAX_RETRIES 3
 #define RETRY_DELAY_MS 1000
 
-// Helper function to get provider names from config
-static const char** get_fallback_providers(config_t* config, uint32_t* out_count) {
-    if (!config || !out_count) return NULL;
+// ============================================================================
+// Routes
+// ============================================================================
 
-    *out_count = config->reliability.fallback_providers_count;
-    return (const char**)config->reliability.fallback_providers;
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
 }
 
-// Helper to check if provider supports model
-static bool provider_supports_model_by_name(const char* provider_name, const char* model) {
-    // This is a simplified check - in real implementation we would
-    // create a provider instance and check its supports_model method
-    if (!provider_name || !model) return false;
-
-    // Check based on provider name and model prefix
-    if (strcmp(provider_name, "openai") == 0) {
-        return (strncmp(model, "gpt-", 4) == 0) ||
-               (strncmp(model, "o1-", 3) == 0) ||
-               (strncmp(model, "text-embedding-", 15) == 0);
-    }
-    else if (strcmp(provider_name, "anthropic") == 0) {
-        return strncmp(model, "claude-", 7) == 0;
-    }
-    else if (strcmp(provider_name, "deepseek") == 0) {
-        return strncmp(model, "deepseek-", 9) == 0;
-    }
-    else if (strcmp(provider_name, "kimi") == 0) {
-        return strncmp(model, "moonshot-", 9) == 0;
-    }
-    else if (strcmp(provider_name, "openrouter") == 0) {
-        // OpenRouter supports many models
-        return true;
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Errors that say something about the route rather than the request
+static bool route_failure(err_t err) {
+    switch (err) {
+        case ERR_NETWORK:
+        case ERR_TIMEOUT:
+        case ERR_PROVIDER:
+        case ERR_PROVIDER_UNAVAILABLE:
+        case ERR_PROVIDER_AUTH:
+        case ERR_PROVIDER_RATE_LIMIT:
+        case ERR_PROVIDER_QUOTA_EXCEEDED:
+            return true;
+        default:
+            return false;
     }
+}
 
+static err_t router_push_route(provider_router_t* router, provider_t* provider,
+                               str_t name, str_t model, str_t hint) {
+    if (router->route_count >= 64) return ERR_OUT_OF_MEMORY;  // exclude is a 64-bit mask
+    provider_route_t* routes = realloc(router->routes, (router->route_count + 1) * sizeof(provider_route_t));
+    if (!routes) return ERR_OUT_OF_MEMORY;
+    router->routes = routes;
+
+    provider_route_t* route = &routes[router->route_count];
+    memset(route, 0, sizeof(*route));
+    route->provider_name = str_dup(name, NULL);
+    route->model = str_empty(model) ? STR_NULL : str_dup(model, NULL);
+    route->hint = str_empty(hint) ? STR_NULL : str_dup(hint, NULL);
+    route->provider = provider;
+    route->circuit = CIRCUIT_CLOSED;
+    route->open_ms = router->open_ms;
+    router->route_count++;
+    return ERR_OK;
+}
+
+// Each provider/model pair is routed once
+static bool router_has_route(provider_router_t* router, str_t name, str_t model, str_t hint) {
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        provider_route_t* r = &router->routes[i];
+        if (str_equal(r->provider_name, name) && str_equal(r->model, model) && str_equal(r->hint, hint)) return true;
+    }
     return false;
 }
 
-provider_router_t* provider_router_create(config_t* config) {
-    if (!config) return NULL;
+static void router_add_configured(provider_router_t* router, str_t name, str_t api_key,
+                                  str_t model, str_t hint) {
+    if (str_empty(name)) return;
+    if (str_empty(model)) model = STR_NULL;
+    if (str_empty(hint)) hint = STR_NULL;
+    if (router_has_route(router, name, model, hint)) return;
 
+    config_t* config = router->config;
+    provider_config_t provider_config = {
+        .name = name,
+        .api_key = str_empty(api_key) ? config->api_key : api_key,
+        .default_model = str_empty(model) ? config->default_model : model,
+        .default_temperature = config->default_temperature,
+        .compress_requests = config->compress_requests,
+        .max_tokens = 4096,
+        .timeout_ms = 60000
+    };
+
+    // Names in config_t are NUL-terminated copies
+    provider_t* provider = NULL;
+    if (provider_create(name.data, &provider_config, &provider) != ERR_OK) provider = NULL;
+    if (router_push_route(router, provider, name, model, hint) != ERR_OK) provider_free(provider);
+}
+
+provider_router_t* provider_router_create(config_t* config) {
     provider_router_t* router = calloc(1, sizeof(provider_router_t));
     if (!router) return NULL;
 
     router->config = config;
+    router->open_ms = ROUTER_OPEN_MS;
+    pthread_mutex_init(&router->lock, NULL);
+    if (!config) return router;
 
-    // Initialize provider array based on configuration
-    // For now, we'll just allocate space for providers
-    router->providers = NULL;
-    router->provider_count = 0;
-    router->current_index = 0;
-    router->retry_count = 0;
-    router->last_failure_time = 0;
+    for (uint32_t i = 0; i < config->model_routes_count; i++) {
+        router_add_configured(router, config->model_routes[i].provider, config->model_routes[i].api_key,
+                              config->model_routes[i].model, config->model_routes[i].hint);
+    }
+    str_t primary = str_empty(config->default_provider) ? STR_LIT("openrouter") : config->default_provider;
+    router_add_configured(router, primary, STR_NULL, STR_NULL, STR_NULL);
+    for (uint32_t i = 0; i < config->reliability.fallback_providers_count; i++) {
+        router_add_configured(router, config->reliability.fallback_providers[i], STR_NULL, STR_NULL, STR_NULL);
+    }
 
     return router;
 }
@@ -73,70 +124,369 @@ provider_router_t* provider_router_create(config_t* config) {
 void provider_router_destroy(provider_router_t* router) {
     if (!router) return;
 
-    // Destroy all providers
-    for (uint32_t i = 0; i < router->provider_count; i++) {
-        if (router->providers[i]) {
-            provider_free(router->providers[i]);
-        }
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        provider_route_t* route = &router->routes[i];
+        provider_free(route->provider);
+        free((void*)route->provider_name.data);
+        free((void*)route->model.data);
+        free((void*)route->hint.data);
     }
 
-    free(router->providers);
+    free(router->routes);
+    pthread_mutex_destroy(&router->lock);
     free(router);
 }
 
+err_t provider_router_add_route(provider_router_t* router, provider_t* provider,
+                                str_t model, str_t hint) {
+    if (!router || !provider) return ERR_INVALID_ARGUMENT;
+
+    str_t name = provider->config.name;
+    if (str_empty(name) && provider->vtable->get_name) name = provider->vtable->get_name();
+
+    pthread_mutex_lock(&router->lock);
+    err_t err = router_push_route(router, provider, name, model, hint);
+    pthread_mutex_unlock(&router->lock);
+    return err;
+}
+
+// ============================================================================
+// Scoring and circuit breaking
+// ============================================================================
+
+// A hinted route serves matching models only; an unhinted one serves any
+// model its provider claims (the caller's, or the provider default)
+static bool route_serves(const provider_route_t* route, const char* model_hint) {
+    provider_t* provider = route->provider;
+    if (!provider) return false;
+
+    if (!str_empty(route->hint)) {
+        return model_hint && strncmp(model_hint, route->hint.data, route->hint.len) == 0;
+    }
+    if (!provider->vtable->supports_model) return true;
+
+    const char* model = model_hint;
+    if (!model && !str_empty(provider->config.default_model)) model = provider->config.default_model.data;
+    return !model || provider->vtable->supports_model(provider, model);
+}
+
+static double route_score(const provider_route_t* route) {
+    if (route->circuit != CIRCUIT_CLOSED) return INFINITY;
+
+    double latency = ROUTER_UNMEASURED_US;
+    if (route->ttft_samples) {
+        latency = route->ttft_us;
+    } else if (route->samples) {
+        latency = route->latency_us;
+    }
+    return latency * (1.0 + ROUTER_ERROR_WEIGHT * route->error_rate);
+}
+
+static double ewma(double current, double sample, uint32_t samples) {
+    return samples ? current + ROUTER_EWMA_ALPHA * (sample - current) : sample;
+}
+
+err_t provider_router_select(provider_router_t* router, const char* model_hint,
+                             uint64_t exclude, uint32_t* out_index) {
+    if (!router || !out_index) return ERR_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&router->lock);
+    uint64_t now = monotonic_ms();
+    int64_t best = -1;
+    double best_score = INFINITY;
+    int64_t probe = -1;
+
+    // Routes are in configured order; a later one has to beat the current
+    // pick by a margin, so equal routes keep the configured preference
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        provider_route_t* route = &router->routes[i];
+        if ((exclude >> i) & 1) continue;
+        if (!route_serves(route, model_hint)) continue;
+
+        if (route->circuit == CIRCUIT_OPEN) {
+            if (now >= route->open_until_ms && probe < 0) probe = i;
+            continue;
+        }
+        if (route->circuit == CIRCUIT_HALF_OPEN) continue;
+
+        double score = route_score(route);
+        if (best < 0 || score < best_score * (1.0 - ROUTER_SWITCH_MARGIN)) {
+            best = i;
+            best_score = score;
+        }
+    }
+
+    // A cooled-down circuit gets one probe request before anything else
+    if (probe >= 0) {
+        router->routes[probe].circuit = CIRCUIT_HALF_OPEN;
+        best = probe;
+    }
+    pthread_mutex_unlock(&router->lock);
+
+    if (best < 0) return ERR_PROVIDER_UNAVAILABLE;
+    *out_index = (uint32_t)best;
+    return ERR_OK;
+}
+
+void provider_router_report(provider_router_t* router, uint32_t index, err_t err,
+                            uint64_t latency_us, uint64_t ttft_us) {
+    if (!router) return;
+
+    pthread_mutex_lock(&router->lock);
+    if (index >= router->route_count) {
+        pthread_mutex_unlock(&router->lock);
+        return;
+    }
+    provider_route_t* route = &router->routes[index];
+
+    if (err == ERR_OK) {
+        route->latency_us = ewma(route->latency_us, (double)latency_us, route->samples);
+        route->samples++;
+        if (ttft_us) {
+            route->ttft_us = ewma(route->ttft_us, (double)ttft_us, route->ttft_samples);
+            route->ttft_samples++;
+        }
+        route->error_rate *= 1.0 - ROUTER_EWMA_ALPHA;
+        route->consecutive_failures = 0;
+        route->circuit = CIRCUIT_CLOSED;
+        route->open_ms = router->open_ms;
+    } else if (route_failure(err)) {
+        route->error_rate += ROUTER_EWMA_ALPHA * (1.0 - route->error_rate);
+        route->consecutive_failures++;
+        if (route->circuit == CIRCUIT_HALF_OPEN) {
+            // Failed probe: back off further before the next one
+            route->open_ms = route->open_ms * 2 < ROUTER_OPEN_MAX_MS ? route->open_ms * 2 : ROUTER_OPEN_MAX_MS;
+            route->circuit = CIRCUIT_OPEN;
+            route->open_until_ms = monotonic_ms() + route->open_ms;
+        } else if (route->consecutive_failures >= ROUTER_FAILURE_THRESHOLD) {
+            route->circuit = CIRCUIT_OPEN;
+            route->open_until_ms = monotonic_ms() + route->open_ms;
+        }
+    } else if (route->circuit == CIRCUIT_HALF_OPEN) {
+        // The request itself was bad; let the next one probe instead
+        route->circuit = CIRCUIT_OPEN;
+    }
+    pthread_mutex_unlock(&router->lock);
+}
+
+double provider_router_score(provider_router_t* router, uint32_t index) {
+    if (!router) return INFINITY;
+
+    pthread_mutex_lock(&router->lock);
+    double score = index < router->route_count ? route_score(&router->routes[index]) : INFINITY;
+    pthread_mutex_unlock(&router->lock);
+    return score;
+}
+
 err_t provider_router_get_provider(provider_router_t* router,
                                    const char* model_hint,
                                    provider_t** out_provider) {
-    if (!router || !router->config || !out_provider) {
-        return ERR_INVALID_ARGUMENT;
+    if (!router || !out_provider) return ERR_INVALID_ARGUMENT;
+
+    uint32_t index = 0;
+    err_t err = provider_router_select(router, model_hint, 0, &index);
+    if (err != ERR_OK) return err;
+
+    // The caller reports no outcome, so a probe slot is handed back
+    pthread_mutex_lock(&router->lock);
+    if (router->routes[index].circuit == CIRCUIT_HALF_OPEN) router->routes[index].circuit = CIRCUIT_OPEN;
+    *out_provider = router->routes[index].provider;
+    pthread_mutex_unlock(&router->lock);
+    return ERR_OK;
+}
+
+// ============================================================================
+// Routed provider
+// ============================================================================
+
+static provider_router_t* routed_router(provider_t* provider) {
+    return provider ? (provider_router_t*)provider->impl_data : NULL;
+}
+
+static const char* route_model(provider_router_t* router, uint32_t index, const char* model) {
+    // Route fields are immutable once added
+    const provider_route_t* route = &router->routes[index];
+    return str_empty(route->model) ? model : route->model.data;
+}
+
+static str_t routed_get_name(void) {
+    return STR_LIT("router");
+}
+
+static str_t routed_get_version(void) {
+    return STR_LIT("1.0.0");
+}
+
+static void routed_destroy(provider_t* provider) {
+    if (!provider) return;
+    provider_router_destroy(routed_router(provider));
+    free(provider);
+}
+
+static err_t routed_chat(provider_t* provider,
+                         const chat_message_t* messages,
+                         uint32_t message_count,
+                         const tool_def_t* tools,
+                         uint32_t tool_count,
+                         const char* model,
+                         double temperature,
+                         chat_response_t** out_response) {
+    provider_router_t* router = routed_router(provider);
+    if (!router || !out_response) return ERR_INVALID_ARGUMENT;
+
+    uint64_t tried = 0;
+    err_t err = ERR_PROVIDER_UNAVAILABLE;
+    uint32_t index = 0;
+    while (provider_router_select(router, model, tried, &index) == ERR_OK) {
+        tried |= 1ULL << index;
+        provider_t* target = router->routes[index].provider;
+        if (!target->vtable->chat) {
+            provider_router_report(router, index, ERR_NOT_IMPLEMENTED, 0, 0);
+            continue;
+        }
+
+        uint64_t start_us = monotonic_us();
+        err = target->vtable->chat(target, messages, message_count, tools, tool_count,
+                                   route_model(router, index, model), temperature, out_response);
+        provider_router_report(router, index, err, monotonic_us() - start_us, 0);
+        if (err == ERR_OK || !route_failure(err)) return err;
     }
+    return err;
+}
 
-    // First, check model_routes for specific routing
-    for (uint32_t i = 0; i < router->config->model_routes_count; i++) {
-        const str_t* hint = &router->config->model_routes[i].hint;
-        const str_t* provider_name = &router->config->model_routes[i].provider;
-
-        if (!str_empty(*hint) && model_hint) {
-            // Simple prefix matching for model hint
-            if (strncmp(model_hint, hint->data, hint->len) == 0) {
-                // Found a route for this model hint
-                provider_config_t provider_config = {
-                    .name = *provider_name,
-                    .api_key = router->config->model_routes[i].api_key,
-                    .default_model = router->config->model_routes[i].model,
-                    .default_temperature = router->config->default_temperature,
-                    .timeout_ms = 30000
-                };
-
-                // Use the configured API key if available, otherwise use default
-                if (str_empty(provider_config.api_key)) {
-                    provider_config.api_key = router->config->api_key;
-                }
+// Forwards deltas and notes whether any reached the caller; an error
+// before the first forwarded delta is held back so the call can fail over
+typedef struct routed_stream_t {
+    stream_delta_callback_t on_delta;
+    void* user_data;
+    uint64_t start_us;
+    uint64_t ttft_us;
+    bool delivered;
+    bool failed;
+} routed_stream_t;
+
+static void routed_stream_delta(const stream_delta_t* delta, void* user_data) {
+    routed_stream_t* rs = user_data;
+    if (delta->type == STREAM_DELTA_ERROR) {
+        rs->failed = true;
+        if (!rs->delivered) return;
+    } else if (rs->failed) {
+        return;
+    }
+    if (!rs->ttft_us && (delta->type == STREAM_DELTA_TEXT || delta->type == STREAM_DELTA_TOOL_CALL)) {
+        uint64_t elapsed = monotonic_us() - rs->start_us;
+        rs->ttft_us = elapsed ? elapsed : 1;
+    }
+    if (delta->type != STREAM_DELTA_DONE) rs->delivered = true;
+    rs->on_delta(delta, rs->user_data);
+}
 
-                return provider_create(provider_name->data, &provider_config, out_provider);
-            }
+static err_t routed_chat_stream_deltas(provider_t* provider,
+                                       const chat_message_t* messages,
+                                       uint32_t message_count,
+                                       const tool_def_t* tools,
+                                       uint32_t tool_count,
+                                       const char* model,
+                                       double temperature,
+                                       stream_delta_callback_t on_delta,
+                                       void* user_data) {
+    provider_router_t* router = routed_router(provider);
+    if (!router || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    uint64_t tried = 0;
+    err_t err = ERR_PROVIDER_UNAVAILABLE;
+    uint32_t index = 0;
+    while (provider_router_select(router, model, tried, &index) == ERR_OK) {
+        tried |= 1ULL << index;
+        provider_t* target = router->routes[index].provider;
+        if (!target->vtable->chat_stream_deltas && !target->vtable->chat_stream) {
+            provider_router_report(router, index, ERR_NOT_IMPLEMENTED, 0, 0);
+            continue;
         }
+
+        routed_stream_t rs = { .on_delta = on_delta, .user_data = user_data, .start_us = monotonic_us() };
+        err = provider_chat_stream_deltas(target, messages, message_count, tools, tool_count,
+                                          route_model(router, index, model), temperature,
+                                          routed_stream_delta, &rs);
+        if (err == ERR_OK && rs.failed) err = ERR_PROVIDER;
+        provider_router_report(router, index, err, monotonic_us() - rs.start_us, rs.ttft_us);
+
+        // Once output reached the caller the turn belongs to this route
+        if (err == ERR_OK || rs.delivered || !route_failure(err)) return err;
     }
+    return err;
+}
+
+static bool routed_supports_model(provider_t* provider, const char* model) {
+    provider_router_t* router = routed_router(provider);
+    if (!router) return false;
 
-    // No specific route found, use default provider
-    const char* default_provider = NULL;
-    if (!str_empty(router->config->default_provider)) {
-        default_provider = router->config->default_provider.data;
-    } else {
-        // Fallback to first available provider
-        default_provider = "openrouter"; // Default fallback
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        if (route_serves(&router->routes[i], model)) return true;
     }
+    return false;
+}
 
-    // Create default provider configuration
-    provider_config_t provider_config = {
-        .name = { .data = (char*)default_provider, .len = strlen(default_provider) },
-        .api_key = router->config->api_key,
-        .default_model = router->config->default_model,
-        .default_temperature = router->config->default_temperature,
-        .timeout_ms = 30000
-    };
+static err_t routed_embed(provider_t* provider, const char* model, const str_t* texts,
+                          uint32_t count, uint32_t dimensions, float* out_vectors) {
+    provider_router_t* router = routed_router(provider);
+    if (!router) return ERR_INVALID_ARGUMENT;
+
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        provider_t* target = router->routes[i].provider;
+        if (target && target->vtable->embed) {
+            return target->vtable->embed(target, model, texts, count, dimensions, out_vectors);
+        }
+    }
+    return ERR_NOT_IMPLEMENTED;
+}
+
+static err_t routed_health_check(provider_t* provider, bool* out_healthy) {
+    return provider_router_health_check(routed_router(provider), out_healthy);
+}
 
-    return provider_create(default_provider, &provider_config, out_provider);
+static err_t routed_prewarm(provider_t* provider) {
+    provider_router_t* router = routed_router(provider);
+    if (!router) return ERR_INVALID_ARGUMENT;
+
+    provider_t** targets = calloc(router->route_count ? router->route_count : 1, sizeof(provider_t*));
+    if (!targets) return ERR_OUT_OF_MEMORY;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        if (router->routes[i].provider) targets[count++] = router->routes[i].provider;
+    }
+    err_t err = provider_prewarm_all(targets, count);
+    free(targets);
+    return err;
+}
+
+static const provider_vtable_t routed_vtable = {
+    .get_name = routed_get_name,
+    .get_version = routed_get_version,
+    .destroy = routed_destroy,
+    .chat = routed_chat,
+    .chat_stream_deltas = routed_chat_stream_deltas,
+    .embed = routed_embed,
+    .supports_model = routed_supports_model,
+    .health_check = routed_health_check,
+    .prewarm = routed_prewarm
+};
+
+err_t provider_router_as_provider(provider_router_t* router, provider_t** out_provider) {
+    if (!router || !out_provider) return ERR_INVALID_ARGUMENT;
+
+    provider_t* provider = provider_alloc(&routed_vtable);
+    if (!provider) return ERR_OUT_OF_MEMORY;
+
+    provider->impl_data = router;
+    provider->config.name = STR_LIT("router");
+    if (router->config) {
+        provider->config.default_model = router->config->default_model;
+        provider->config.default_temperature = router->config->default_temperature;
+    }
+    provider->connected = true;
+    *out_provider = provider;
+    return ERR_OK;
 }
 
 err_t provider_router_create_with_failover(config_t* config,
@@ -154,6 +504,7 @@ err_t provider_router_create_with_failover(config_t* config,
             .api_key = config->api_key,
             .default_model = config->default_model,
             .default_temperature = config->default_temperature,
+            .compress_requests = config->compress_requests,
             .timeout_ms = 30000
         };
 
@@ -180,12 +531,12 @@ err_t provider_router_create_with_failover(config_t* config,
     }
 
     // Try fallback providers
-    uint32_t fallback_count = 0;
-    const char** fallback_providers = get_fallback_providers(config, &fallback_count);
+    uint32_t fallback_count = config->reliability.fallback_providers_count;
+    const str_t* fallback_providers = config->reliability.fallback_providers;
 
     if (fallback_providers && fallback_count > 0) {
         for (uint32_t i = 0; i < fallback_count; i++) {
-            const char* fallback = fallback_providers[i];
+            const char* fallback = fallback_providers[i].data;
             if (!fallback) continue;
 
             // Skip if it's the same as preferred provider we already tried
@@ -198,6 +549,7 @@ err_t provider_router_create_with_failover(config_t* config,
                 .api_key = config->api_key,
                 .default_model = config->default_model,
                 .default_temperature = config->default_temperature,
+                .compress_requests = config->compress_requests,
                 .timeout_ms = 30000
             };
 
@@ -221,7 +573,7 @@ err_t provider_router_create_with_failover(config_t* config,
         if (fallback_providers) {
             bool already_tried = false;
             for (uint32_t j = 0; j < fallback_count; j++) {
-                if (fallback_providers[j] && strcmp(providers_to_try[i], fallback_providers[j]) == 0) {
+                if (fallback_providers[j].data && strcmp(providers_to_try[i], fallback_providers[j].data) == 0) {
                     already_tried = true;
                     break;
                 }
@@ -234,6 +586,7 @@ err_t provider_router_create_with_failover(config_t* config,
             .api_key = config->api_key,
             .default_model = config->default_model,
             .default_temperature = config->default_temperature,
+            .compress_requests = config->compress_requests,
             .timeout_ms = 30000
         };
 
@@ -254,14 +607,15 @@ err_t provider_router_health_check(provider_router_t* router,
     *out_all_healthy = true;
 
     // If no providers are instantiated yet, we can't check health
-    if (router->provider_count == 0) {
+    if (router->route_count == 0) {
         return ERR_OK;
     }
 
-    for (uint32_t i = 0; i < router->provider_count; i++) {
-        if (router->providers[i] && router->providers[i]->vtable->health_check) {
+    for (uint32_t i = 0; i < router->route_count; i++) {
+        provider_t* provider = router->routes[i].provider;
+        if (provider && provider->vtable->health_check) {
             bool healthy = false;
-            err_t err = router->providers[i]->vtable->health_check(router->providers[i], &healthy);
+            err_t err = provider->vtable->health_check(provider, &healthy);
             if (err != ERR_OK || !healthy) {
                 *out_all_healthy = false;
                 // Don't return early - check all providers
@@ -0,0 +1,348 @@
+// singleflight.c - Coalescing of concurrent identical provider requests
+// SPDX-License-Identifier: MIT
+
+#include "providers/singleflight.h"
+
+#include <sodium.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A delta and the bytes its strings point at, immutable once recorded
+typedef struct recorded_delta_t {
+    stream_delta_t delta;
+    char bytes[];
+} recorded_delta_t;
+
+typedef struct flight_t {
+    uint8_t key[SINGLEFLIGHT_KEY_BYTES];
+    struct flight_t* next;
+    uint32_t refs;                 // Leader plus followers
+    bool done;
+    err_t err;
+    pthread_cond_t cond;
+
+    chat_response_t* response;     // Chat: the followers' copy
+    float* vectors;                // Embed: the followers' copy
+    size_t vector_floats;
+    recorded_delta_t** deltas;     // Stream: everything the leader saw
+    uint32_t delta_count;
+    uint32_t delta_cap;
+} flight_t;
+
+static pthread_mutex_t g_flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static flight_t* g_flights[SINGLEFLIGHT_BUCKETS];
+static uint64_t g_shared;
+static pthread_once_t g_sodium_once = PTHREAD_ONCE_INIT;
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+static void sodium_setup(void) {
+    (void)sodium_init();
+}
+
+static void hash_field(crypto_generichash_state* state, const void* data, size_t len) {
+    uint64_t prefix = len;
+    crypto_generichash_update(state, (const unsigned char*)&prefix, sizeof(prefix));
+    if (len) crypto_generichash_update(state, (const unsigned char*)data, len);
+}
+
+void singleflight_chat_key(const provider_t* provider,
+                           const chat_message_t* messages,
+                           uint32_t message_count,
+                           const tool_def_t* tools,
+                           uint32_t tool_count,
+                           const char* model,
+                           double temperature,
+                           uint8_t out_key[SINGLEFLIGHT_KEY_BYTES]) {
+    pthread_once(&g_sodium_once, sodium_setup);
+
+    uint8_t request[RESPONSE_CACHE_KEY_BYTES];
+    response_cache_hash_request(provider->config.name, model, temperature, messages, message_count,
+                                tools, tool_count, request);
+
+    // The instance keeps a wrapper and its inner provider apart
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, NULL, 0, SINGLEFLIGHT_KEY_BYTES);
+    hash_field(&state, &provider, sizeof(provider));
+    hash_field(&state, request, sizeof(request));
+    crypto_generichash_final(&state, out_key, SINGLEFLIGHT_KEY_BYTES);
+}
+
+void singleflight_embed_key(const provider_t* provider,
+                            const char* model,
+                            const str_t* texts,
+                            uint32_t count,
+                            uint32_t dimensions,
+                            uint8_t out_key[SINGLEFLIGHT_KEY_BYTES]) {
+    pthread_once(&g_sodium_once, sodium_setup);
+
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, NULL, 0, SINGLEFLIGHT_KEY_BYTES);
+    hash_field(&state, &provider, sizeof(provider));
+    hash_field(&state, model, model ? strlen(model) : 0);
+    hash_field(&state, &dimensions, sizeof(dimensions));
+    hash_field(&state, &count, sizeof(count));
+    for (uint32_t i = 0; i < count; i++) {
+        hash_field(&state, texts[i].data, texts[i].len);
+    }
+    crypto_generichash_final(&state, out_key, SINGLEFLIGHT_KEY_BYTES);
+}
+
+// ============================================================================
+// Flights
+// ============================================================================
+
+static flight_t** flight_bucket(const uint8_t* key) {
+    return &g_flights[key[0] % SINGLEFLIGHT_BUCKETS];
+}
+
+// Join the flight for key or start one; *out_leader says which. Lock held.
+static flight_t* flight_join(const uint8_t* key, bool* out_leader) {
+    flight_t** bucket = flight_bucket(key);
+    for (flight_t* flight = *bucket; flight; flight = flight->next) {
+        if (memcmp(flight->key, key, SINGLEFLIGHT_KEY_BYTES) == 0) {
+            flight->refs++;
+            g_shared++;
+            *out_leader = false;
+            return flight;
+        }
+    }
+
+    flight_t* flight = calloc(1, sizeof(flight_t));
+    if (!flight) return NULL;
+    memcpy(flight->key, key, SINGLEFLIGHT_KEY_BYTES);
+    flight->refs = 1;
+    pthread_cond_init(&flight->cond, NULL);
+    flight->next = *bucket;
+    *bucket = flight;
+    *out_leader = true;
+    return flight;
+}
+
+// Leader: later arrivals start a new flight. Lock held.
+static void flight_land(flight_t* flight, err_t err) {
+    flight_t** slot = flight_bucket(flight->key);
+    while (*slot != flight) slot = &(*slot)->next;
+    *slot = flight->next;
+
+    flight->err = err;
+    flight->done = true;
+    pthread_cond_broadcast(&flight->cond);
+}
+
+// Lock held
+static void flight_release(flight_t* flight) {
+    if (--flight->refs > 0) return;
+
+    chat_response_free(flight->response);
+    free(flight->vectors);
+    for (uint32_t i = 0; i < flight->delta_count; i++) free(flight->deltas[i]);
+    free(flight->deltas);
+    pthread_cond_destroy(&flight->cond);
+    free(flight);
+}
+
+static void flight_wait(flight_t* flight) {
+    while (!flight->done) pthread_cond_wait(&flight->cond, &g_flights_lock);
+}
+
+// ============================================================================
+// Chat
+// ============================================================================
+
+err_t singleflight_chat(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_chat_fn_t run, void* ctx,
+                        chat_response_t** out_response) {
+    if (!key || !run || !out_response) return ERR_INVALID_ARGUMENT;
+
+    bool leader = false;
+    pthread_mutex_lock(&g_flights_lock);
+    flight_t* flight = flight_join(key, &leader);
+    pthread_mutex_unlock(&g_flights_lock);
+    if (!flight) return run(ctx, out_response);
+
+    if (leader) {
+        err_t err = run(ctx, out_response);
+        err_t shared_err = err;
+        pthread_mutex_lock(&g_flights_lock);
+        if (err == ERR_OK && flight->refs > 1) {
+            flight->response = chat_response_copy(*out_response);
+            if (!flight->response) shared_err = ERR_OUT_OF_MEMORY;
+        }
+        flight_land(flight, shared_err);
+        flight_release(flight);
+        pthread_mutex_unlock(&g_flights_lock);
+        return err;
+    }
+
+    pthread_mutex_lock(&g_flights_lock);
+    flight_wait(flight);
+    err_t err = flight->err;
+    if (err == ERR_OK) {
+        *out_response = chat_response_copy(flight->response);
+        if (!*out_response) err = ERR_OUT_OF_MEMORY;
+    }
+    flight_release(flight);
+    pthread_mutex_unlock(&g_flights_lock);
+    return err;
+}
+
+// ============================================================================
+// Streams
+// ============================================================================
+
+static size_t str_bytes(str_t s) {
+    return s.data ? (size_t)s.len + 1 : 0;
+}
+
+static str_t str_place(str_t s, char** cursor) {
+    if (!s.data) return STR_NULL;
+    str_t placed = { .data = *cursor, .len = s.len };
+    if (s.len) memcpy(*cursor, s.data, s.len);
+    (*cursor)[s.len] = '\0';
+    *cursor += s.len + 1;
+    return placed;
+}
+
+static recorded_delta_t* delta_record(const stream_delta_t* delta) {
+    size_t bytes = str_bytes(delta->text) + str_bytes(delta->tool_id) + str_bytes(delta->tool_name) +
+                   str_bytes(delta->tool_arguments) + str_bytes(delta->finish_reason);
+    recorded_delta_t* record = malloc(sizeof(recorded_delta_t) + bytes);
+    if (!record) return NULL;
+
+    char* cursor = record->bytes;
+    record->delta = *delta;
+    record->delta.text = str_place(delta->text, &cursor);
+    record->delta.tool_id = str_place(delta->tool_id, &cursor);
+    record->delta.tool_name = str_place(delta->tool_name, &cursor);
+    record->delta.tool_arguments = str_place(delta->tool_arguments, &cursor);
+    record->delta.finish_reason = str_place(delta->finish_reason, &cursor);
+    return record;
+}
+
+// Leader side: forward live and keep a copy for followers
+typedef struct stream_tap_t {
+    flight_t* flight;
+    stream_delta_callback_t on_delta;
+    void* user_data;
+    bool failed;                   // A delta could not be recorded
+} stream_tap_t;
+
+static void stream_tap_delta(const stream_delta_t* delta, void* user_data) {
+    stream_tap_t* tap = user_data;
+    tap->on_delta(delta, tap->user_data);
+
+    recorded_delta_t* record = tap->failed ? NULL : delta_record(delta);
+    pthread_mutex_lock(&g_flights_lock);
+    flight_t* flight = tap->flight;
+    if (record && flight->delta_count == flight->delta_cap) {
+        uint32_t cap = flight->delta_cap ? flight->delta_cap * 2 : 16;
+        recorded_delta_t** grown = realloc(flight->deltas, cap * sizeof(recorded_delta_t*));
+        if (grown) {
+            flight->deltas = grown;
+            flight->delta_cap = cap;
+        }
+    }
+    if (record && flight->delta_count < flight->delta_cap) {
+        flight->deltas[flight->delta_count++] = record;
+        pthread_cond_broadcast(&flight->cond);
+    } else if (!tap->failed) {
+        // A gap would corrupt the followers' stream
+        free(record);
+        tap->failed = true;
+    }
+    pthread_mutex_unlock(&g_flights_lock);
+}
+
+err_t singleflight_stream(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_stream_fn_t run, void* ctx,
+                          stream_delta_callback_t on_delta, void* user_data) {
+    if (!key || !run || !on_delta) return ERR_INVALID_ARGUMENT;
+
+    bool leader = false;
+    pthread_mutex_lock(&g_flights_lock);
+    flight_t* flight = flight_join(key, &leader);
+    pthread_mutex_unlock(&g_flights_lock);
+    if (!flight) return run(ctx, on_delta, user_data);
+
+    if (leader) {
+        stream_tap_t tap = { .flight = flight, .on_delta = on_delta, .user_data = user_data };
+        err_t err = run(ctx, stream_tap_delta, &tap);
+        pthread_mutex_lock(&g_flights_lock);
+        flight_land(flight, err == ERR_OK && tap.failed ? ERR_OUT_OF_MEMORY : err);
+        flight_release(flight);
+        pthread_mutex_unlock(&g_flights_lock);
+        return err;
+    }
+
+    // Replay what was recorded so far, then follow along
+    uint32_t next = 0;
+    pthread_mutex_lock(&g_flights_lock);
+    for (;;) {
+        while (next == flight->delta_count && !flight->done) {
+            pthread_cond_wait(&flight->cond, &g_flights_lock);
+        }
+        if (next == flight->delta_count) break;
+        const stream_delta_t* delta = &flight->deltas[next++]->delta;
+        pthread_mutex_unlock(&g_flights_lock);
+        on_delta(delta, user_data);
+        pthread_mutex_lock(&g_flights_lock);
+    }
+    err_t err = flight->err;
+    flight_release(flight);
+    pthread_mutex_unlock(&g_flights_lock);
+    return err;
+}
+
+// ============================================================================
+// Embeddings
+// ============================================================================
+
+err_t singleflight_embed(const uint8_t key[SINGLEFLIGHT_KEY_BYTES], singleflight_embed_fn_t run, void* ctx,
+                         size_t vector_floats, float* out_vectors) {
+    if (!key || !run || !out_vectors) return ERR_INVALID_ARGUMENT;
+
+    bool leader = false;
+    pthread_mutex_lock(&g_flights_lock);
+    flight_t* flight = flight_join(key, &leader);
+    pthread_mutex_unlock(&g_flights_lock);
+    if (!flight) return run(ctx, out_vectors);
+
+    if (leader) {
+        err_t err = run(ctx, out_vectors);
+        err_t shared_err = err;
+        pthread_mutex_lock(&g_flights_lock);
+        if (err == ERR_OK && flight->refs > 1) {
+            flight->vectors = malloc(vector_floats * sizeof(float));
+            if (flight->vectors) {
+                memcpy(flight->vectors, out_vectors, vector_floats * sizeof(float));
+                flight->vector_floats = vector_floats;
+            } else {
+                shared_err = ERR_OUT_OF_MEMORY;
+            }
+        }
+        flight_land(flight, shared_err);
+        flight_release(flight);
+        pthread_mutex_unlock(&g_flights_lock);
+        return err;
+    }
+
+    pthread_mutex_lock(&g_flights_lock);
+    flight_wait(flight);
+    err_t err = flight->err;
+    if (err == ERR_OK) {
+        if (flight->vector_floats != vector_floats) err = ERR_INVALID_ARGUMENT;
+        else memcpy(out_vectors, flight->vectors, vector_floats * sizeof(float));
+    }
+    flight_release(flight);
+    pthread_mutex_unlock(&g_flights_lock);
+    return err;
+}
+
+uint64_t singleflight_shared_count(void) {
+    pthread_mutex_lock(&g_flights_lock);
+    uint64_t shared = g_shared;
+    pthread_mutex_unlock(&g_flights_lock);
+    return shared;
+}
@@ -5,6 +5,8 @@
 #include "core/agent.h"
 #include "core/config.h"
 #include "providers/router.h"
+#include "providers/response_cache.h"
+#include "runtime/docker_pool.h"
 #include "cclaw.h"
 
 #include <stdio.h>
@@ -185,6 +187,7 @@ err_t agent_runtime_init(config_t* config) {
     agent_config.autonomy_level = config->autonomy.level;
     agent_config.enable_shell_tool = true;  // Default enable
     agent_config.workspace_root = str_dup(config->workspace_dir, NULL);
+    agent_config.sessions_dir = agent_sessions_dir_default();
 
     // Create agent
     err_t err = agent_create(&agent_config, &g_runtime.agent);
@@ -192,9 +195,30 @@ err_t agent_runtime_init(config_t* config) {
         return err;
     }
 
-    // Create default session
+    // One memory instance for every memory tool, behind the recall cache
+    memory_t* memory = NULL;
+    err_t memory_err = memory_create_from_config(config, &memory);
+    if (memory_err == ERR_OK) {
+        agent_set_memory(g_runtime.agent, memory);
+    } else {
+        fprintf(stderr, "Warning: Failed to open memory backend: %s\n", error_to_string(memory_err));
+    }
+
+    // Warm containers for the shell tool; never fall back to the host
+    if (config->runtime.kind == RUNTIME_KIND_DOCKER) {
+        docker_pool_t* sandbox = NULL;
+        err = docker_pool_create_from_config(config, &sandbox);
+        if (err != ERR_OK) {
+            fprintf(stderr, "Failed to start Docker sandbox: %s\n", error_to_string(err));
+            agent_destroy(g_runtime.agent);
+            return err;
+        }
+        agent_set_sandbox(g_runtime.agent, sandbox);
+    }
+
+    // Pick up the default session where the last run left it
     str_t session_name = STR_LIT("default");
-    err = agent_session_create(g_runtime.agent, &session_name, &g_runtime.session);
+    err = agent_session_resume(g_runtime.agent, &session_name, &session_name, &g_runtime.session);
     if (err != ERR_OK) {
         agent_destroy(g_runtime.agent);
         return err;
@@ -220,6 +244,7 @@ err_t agent_runtime_init(config_t* config) {
             .base_url = STR_NULL,
             .default_model = config->default_model,
             .default_temperature = config->default_temperature,
+            .compress_requests = config->compress_requests,
             .max_tokens = 4096,
             .timeout_ms = 60000,
             .stream = false,
@@ -232,7 +257,30 @@ err_t agent_runtime_init(config_t* config) {
 
         // Create provider
         provider_t* provider = NULL;
-        err_t provider_err = provider_create(provider_name, &provider_config, &provider);
+        err_t provider_err;
+        if (config->model_routes_count > 0 || config->reliability.fallback_providers_count > 0) {
+            // Several candidates: route each request by live latency and errors
+            provider_router_t* router = provider_router_create(config);
+            provider_err = router ? provider_router_as_provider(router, &provider) : ERR_OUT_OF_MEMORY;
+            if (provider_err != ERR_OK) provider_router_destroy(router);
+        } else {
+            provider_err = provider_create(provider_name, &provider_config, &provider);
+        }
+        if (provider_err == ERR_OK && config->response_cache.enabled) {
+            // Deterministic requests (cron, summaries) are answered from the cache
+            response_cache_t* cache = NULL;
+            provider_t* cached = NULL;
+            if (response_cache_create_from_config(config, &cache) == ERR_OK &&
+                response_cache_wrap(cache, provider, &cached) == ERR_OK) {
+                provider = cached;
+            } else {
+                response_cache_destroy(cache);
+            }
+        }
+        if (provider_err == ERR_OK && config->reliability.prewarm_providers) {
+            // Handshakes happen now, in parallel, instead of on the first turn
+            provider_prewarm(provider);
+        }
         if (provider_err == ERR_OK) {
             g_runtime.agent->ctx->provider = provider;
         } else {
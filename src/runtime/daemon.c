@@ -4,11 +4,15 @@
 #include "runtime/daemon.h"
 #include "runtime/agent_loop.h"
 #include "core/alloc.h"
+#include "core/metrics.h"
+#include "utils/json_writer.h"
 #include "cclaw.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -19,11 +23,18 @@
 #include <time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <pthread.h>
+#include <poll.h>
 
 // Global daemon instance for signal handling
 static daemon_t* g_daemon = NULL;
 
+static uint64_t now_ms(void);
+static void cron_workers_stop(daemon_t* daemon);
+static void cron_job_free(cron_job_t* job);
+
 // ============================================================================
 // Signal Handlers
 // ============================================================================
@@ -43,6 +54,7 @@ static void signal_handler(int sig) {
             g_daemon->received_sigusr1 = 1;
             break;
     }
+    daemon_wakeup(g_daemon);
 }
 
 void daemon_setup_signals(daemon_t* daemon) {
@@ -285,66 +297,253 @@ err_t daemon_kill(const char* pid_file) {
 // Cron Expression Parsing
 // ============================================================================
 
-static bool parse_cron_field(const char* field, uint8_t min, uint8_t max, uint8_t* out_value) {
-    if (strcmp(field, "*") == 0) {
-        *out_value = 255; // Wildcard
-        return true;
+static const char* const g_month_names[] = {
+    "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec", NULL
+};
+static const char* const g_weekday_names[] = {
+    "sun", "mon", "tue", "wed", "thu", "fri", "sat", NULL
+};
+
+// Number or name at *p; names[0] stands for `base`
+static bool parse_cron_value(const char** p, int base, const char* const* names, int* out_value) {
+    if (names && isalpha((unsigned char)**p)) {
+        for (int i = 0; names[i]; i++) {
+            if (strncasecmp(*p, names[i], 3) == 0 && !isalpha((unsigned char)(*p)[3])) {
+                *out_value = base + i;
+                *p += 3;
+                return true;
+            }
+        }
+        return false;
     }
 
-    char* endptr;
-    long val = strtol(field, &endptr, 10);
-    if (*endptr != '\0' || val < min || val > max) {
-        return false;
+    if (!isdigit((unsigned char)**p)) return false;
+    int value = 0;
+    while (isdigit((unsigned char)**p)) {
+        value = value * 10 + (**p - '0');
+        if (value > 1000) return false;
+        (*p)++;
+    }
+    *out_value = value;
+    return true;
+}
+
+// A comma-separated list of "*", "N" or "N-M", each optionally "/step",
+// compiled into a mask with bit n set when value n matches
+static bool parse_cron_field(const char* field, int min, int max, const char* const* names,
+                             uint64_t* out_mask) {
+    uint64_t mask = 0;
+    const char* p = field;
+
+    for (;;) {
+        int lo = min, hi = max, step = 1;
+        bool single = false;
+        if (*p == '*') {
+            p++;
+        } else {
+            if (!parse_cron_value(&p, min, names, &lo)) return false;
+            hi = lo;
+            single = true;
+            if (*p == '-') {
+                p++;
+                if (!parse_cron_value(&p, min, names, &hi)) return false;
+                single = false;
+            }
+        }
+        if (*p == '/') {
+            p++;
+            if (!parse_cron_value(&p, 0, NULL, &step) || step == 0) return false;
+            // "N/step" runs from N to the end of the range
+            if (single) hi = max;
+        }
+        if (lo < min || hi > max || lo > hi) return false;
+
+        for (int v = lo; v <= hi; v += step) mask |= 1ULL << v;
+
+        if (*p == '\0') break;
+        if (*p != ',') return false;
+        p++;
     }
 
-    *out_value = (uint8_t)val;
+    *out_mask = mask;
     return true;
 }
 
 err_t cron_parse_expression(const str_t* expression, cron_job_t* out_job) {
-    if (!expression || !out_job) return ERR_INVALID_ARGUMENT;
+    if (!expression || !out_job || str_empty(*expression)) return ERR_INVALID_ARGUMENT;
 
     char* expr = strndup(expression->data, expression->len);
-    char* parts[5] = {0};
-    int part_count = 0;
+    if (!expr) return ERR_OUT_OF_MEMORY;
 
-    // Split by space
-    char* token = strtok(expr, " ");
-    while (token && part_count < 5) {
-        parts[part_count++] = token;
-        token = strtok(NULL, " ");
+    // Shorthands from cron(5)
+    static const struct { const char* name; const char* expansion; } macros[] = {
+        { "@yearly", "0 0 1 1 *" }, { "@annually", "0 0 1 1 *" }, { "@monthly", "0 0 1 * *" },
+        { "@weekly", "0 0 * * 0" }, { "@daily", "0 0 * * *" }, { "@midnight", "0 0 * * *" },
+        { "@hourly", "0 * * * *" },
+    };
+    const char* source = expr;
+    if (expr[0] == '@') {
+        source = NULL;
+        for (size_t i = 0; i < sizeof(macros) / sizeof(macros[0]); i++) {
+            if (strcasecmp(expr, macros[i].name) == 0) source = macros[i].expansion;
+        }
+        if (!source) {
+            free(expr);
+            return ERR_INVALID_ARGUMENT;
+        }
     }
 
-    if (part_count != 5) {
-        free(expr);
-        return ERR_INVALID_ARGUMENT;
-    }
+    char* fields = strdup(source);
+    free(expr);
+    if (!fields) return ERR_OUT_OF_MEMORY;
 
-    // Parse: minute hour day_of_month month day_of_week
-    if (!parse_cron_field(parts[0], 0, 59, &out_job->minute) ||
-        !parse_cron_field(parts[1], 0, 23, &out_job->hour) ||
-        !parse_cron_field(parts[2], 1, 31, &out_job->day_of_month) ||
-        !parse_cron_field(parts[3], 1, 12, &out_job->month) ||
-        !parse_cron_field(parts[4], 0, 6, &out_job->day_of_week)) {
-        free(expr);
-        return ERR_INVALID_ARGUMENT;
+    char* parts[6] = {0};
+    int part_count = 0;
+    char* save = NULL;
+    for (char* token = strtok_r(fields, " \t", &save); token && part_count < 6;
+         token = strtok_r(NULL, " \t", &save)) {
+        parts[part_count++] = token;
     }
 
-    free(expr);
+    // Parse: minute hour day_of_month month day_of_week
+    uint64_t minutes, hours, days, months, weekdays;
+    bool ok = part_count == 5 &&
+              parse_cron_field(parts[0], 0, 59, NULL, &minutes) &&
+              parse_cron_field(parts[1], 0, 23, NULL, &hours) &&
+              parse_cron_field(parts[2], 1, 31, NULL, &days) &&
+              parse_cron_field(parts[3], 1, 12, g_month_names, &months) &&
+              parse_cron_field(parts[4], 0, 7, g_weekday_names, &weekdays);
+
+    // With both day fields restricted either one matching is enough
+    bool days_either = ok && parts[2][0] != '*' && parts[4][0] != '*';
+    free(fields);
+    if (!ok) return ERR_INVALID_ARGUMENT;
+
+    // 7 is Sunday as well
+    if (weekdays & (1ULL << 7)) weekdays = (weekdays & ~(1ULL << 7)) | 1ULL;
+
+    out_job->minutes = minutes;
+    out_job->hours = hours;
+    out_job->days_of_month = days;
+    out_job->months = months;
+    out_job->days_of_week = weekdays;
+    out_job->days_either = days_either;
     return ERR_OK;
 }
 
+static bool cron_day_matches(const cron_job_t* job, int mday, int wday) {
+    bool dom = (job->days_of_month >> mday) & 1;
+    bool dow = (job->days_of_week >> wday) & 1;
+    return job->days_either ? (dom || dow) : (dom && dow);
+}
+
 bool cron_should_run(const cron_job_t* job, uint64_t current_timestamp) {
     time_t t = (time_t)(current_timestamp / 1000);
-    struct tm* tm_info = localtime(&t);
+    struct tm tm_info;
+    if (!localtime_r(&t, &tm_info)) return false;
 
-    if (job->minute != 255 && job->minute != tm_info->tm_min) return false;
-    if (job->hour != 255 && job->hour != tm_info->tm_hour) return false;
-    if (job->day_of_month != 255 && job->day_of_month != tm_info->tm_mday) return false;
-    if (job->month != 255 && job->month != (tm_info->tm_mon + 1)) return false;
-    if (job->day_of_week != 255 && job->day_of_week != tm_info->tm_wday) return false;
+    return ((job->minutes >> tm_info.tm_min) & 1) &&
+           ((job->hours >> tm_info.tm_hour) & 1) &&
+           ((job->months >> (tm_info.tm_mon + 1)) & 1) &&
+           cron_day_matches(job, tm_info.tm_mday, tm_info.tm_wday);
+}
 
-    return true;
+// Smallest set bit >= from, or -1
+static int next_bit(uint64_t mask, int from) {
+    if (from > 63) return -1;
+    uint64_t rest = mask >> from;
+    return rest ? from + __builtin_ctzll(rest) : -1;
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+static int weekday(int year, int month, int day) {
+    // Sakamoto's method, 0 = Sunday
+    static const int offsets[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    if (month < 3) year--;
+    return (year + year / 4 - year / 100 + year / 400 + offsets[month - 1] + day) % 7;
+}
+
+// Upper bound on search steps; a never-matching expression such as
+// 31 February costs about 30 steps per year
+#define CRON_SEARCH_STEPS 4096
+
+// Walks the civil calendar in local time, jumping each field to its next
+// set bit; only the final candidate goes through mktime
+err_t cron_compute_next_run(cron_job_t* job, uint64_t after_timestamp) {
+    if (!job) return ERR_INVALID_ARGUMENT;
+    if (!job->minutes || !job->hours || !job->days_of_month || !job->months || !job->days_of_week) {
+        return ERR_NOT_FOUND;
+    }
+
+    // Strictly after the given time
+    time_t t = (time_t)(after_timestamp / 1000) + 60;
+    struct tm tm;
+    if (!localtime_r(&t, &tm)) return ERR_FAILED;
+    int year = tm.tm_year + 1900, month = tm.tm_mon + 1, day = tm.tm_mday;
+    int hour = tm.tm_hour, minute = tm.tm_min;
+
+    int first_hour = next_bit(job->hours, 0);
+    int first_minute = next_bit(job->minutes, 0);
+
+    for (uint32_t step = 0; step < CRON_SEARCH_STEPS; step++) {
+        if (minute > 59) minute = first_minute, hour++;
+        if (hour > 23) hour = first_hour, minute = first_minute, day++;
+        if (day > days_in_month(year, month)) day = 1, hour = first_hour, minute = first_minute, month++;
+        if (month > 12) month = 1, year++;
+
+        if (!((job->months >> month) & 1)) {
+            int next = next_bit(job->months, month + 1);
+            if (next < 0) {
+                year++;
+                next = next_bit(job->months, 1);
+            }
+            month = next;
+            day = 1;
+            hour = first_hour;
+            minute = first_minute;
+            continue;
+        }
+
+        if (!cron_day_matches(job, day, weekday(year, month, day))) {
+            day++;
+            hour = first_hour;
+            minute = first_minute;
+            continue;
+        }
+
+        if (!((job->hours >> hour) & 1)) {
+            int next = next_bit(job->hours, hour + 1);
+            hour = next < 0 ? 24 : next;
+            minute = first_minute;
+            continue;
+        }
+
+        if (!((job->minutes >> minute) & 1)) {
+            int next = next_bit(job->minutes, minute + 1);
+            minute = next < 0 ? 60 : next;
+            continue;
+        }
+
+        struct tm candidate = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day,
+                                .tm_hour = hour, .tm_min = minute, .tm_isdst = -1 };
+        t = mktime(&candidate);
+        if (t == (time_t)-1) return ERR_FAILED;
+
+        // A time skipped by a DST change is normalized forward; keep
+        // searching if that lands at or before the starting point
+        if ((uint64_t)t * 1000 > after_timestamp) {
+            job->next_run = (uint64_t)t * 1000;
+            return ERR_OK;
+        }
+        minute++;
+    }
+
+    return ERR_NOT_FOUND;
 }
 
 // ============================================================================
@@ -358,7 +557,8 @@ daemon_config_t daemon_config_default(void) {
         .working_dir = STR_LIT("~"),
         .redirect_stdio = true,
         .double_fork = true,
-        .umask = 022
+        .umask = 022,
+        .cron_workers = DAEMON_CRON_WORKERS
     };
 }
 
@@ -367,6 +567,8 @@ void daemon_config_free(daemon_config_t* config) {
     free((void*)config->pid_file.data);
     free((void*)config->log_file.data);
     free((void*)config->working_dir.data);
+    free((void*)config->health_socket.data);
+    free((void*)config->metrics_bind.data);
 }
 
 err_t daemon_create(const daemon_config_t* config, daemon_t** out_daemon) {
@@ -375,7 +577,13 @@ err_t daemon_create(const daemon_config_t* config, daemon_t** out_daemon) {
     daemon_t* daemon = calloc(1, sizeof(daemon_t));
     if (!daemon) return ERR_OUT_OF_MEMORY;
 
+    // The daemon owns copies of the configuration strings
     daemon->config = config ? *config : daemon_config_default();
+    daemon->config.pid_file = str_dup(daemon->config.pid_file, NULL);
+    daemon->config.log_file = str_dup(daemon->config.log_file, NULL);
+    daemon->config.working_dir = str_dup(daemon->config.working_dir, NULL);
+    daemon->config.health_socket = str_dup(daemon->config.health_socket, NULL);
+    daemon->config.metrics_bind = str_dup(daemon->config.metrics_bind, NULL);
     daemon->running = false;
     daemon->start_time = 0;
     daemon->pid = getpid();
@@ -388,6 +596,20 @@ err_t daemon_create(const daemon_config_t* config, daemon_t** out_daemon) {
     daemon->health.provider_healthy = false;
     daemon->health.memory_healthy = true;
     daemon->health.channel_healthy = true;
+    pthread_mutex_init(&daemon->health_lock, NULL);
+    daemon->health_fd = -1;
+    daemon->metrics_fd = -1;
+    daemon->health_stop_fds[0] = -1;
+    daemon->health_stop_fds[1] = -1;
+
+    // Scheduler state; the wake pipe survives daemonize's forks
+    pthread_mutex_init(&daemon->cron_lock, NULL);
+    pthread_mutex_init(&daemon->task_lock, NULL);
+    pthread_cond_init(&daemon->task_cond, NULL);
+    if (pipe2(daemon->wake_fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        daemon->wake_fds[0] = -1;
+        daemon->wake_fds[1] = -1;
+    }
 
     g_daemon = daemon;
     *out_daemon = daemon;
@@ -402,17 +624,23 @@ void daemon_destroy(daemon_t* daemon) {
         daemon_stop(daemon);
     }
 
+    // Let running and queued job bodies finish
+    cron_workers_stop(daemon);
+    daemon_health_server_stop(daemon);
+
     // Free jobs
     for (uint32_t i = 0; i < daemon->job_count; i++) {
-        cron_job_t* job = daemon->jobs[i];
-        free((void*)job->id.data);
-        free((void*)job->name.data);
-        free((void*)job->expression.data);
-        free((void*)job->command.data);
-        free((void*)job->description.data);
-        free(job);
+        cron_job_free(daemon->jobs[i]);
     }
     free(daemon->jobs);
+    free(daemon->schedule);
+
+    if (daemon->wake_fds[0] >= 0) close(daemon->wake_fds[0]);
+    if (daemon->wake_fds[1] >= 0) close(daemon->wake_fds[1]);
+    pthread_cond_destroy(&daemon->task_cond);
+    pthread_mutex_destroy(&daemon->task_lock);
+    pthread_mutex_destroy(&daemon->cron_lock);
+    pthread_mutex_destroy(&daemon->health_lock);
 
     daemon_config_free(&daemon->config);
     free((void*)daemon->health_socket_path.data);
@@ -496,7 +724,29 @@ err_t daemon_run(daemon_t* daemon) {
 
     while (daemon->running) {
         daemon_run_once(daemon);
-        usleep(100000); // 100ms sleep
+        if (!daemon->running) break;
+
+        // Sleep until the next job is due, the wake pipe is written or a
+        // watched extension changes
+        int timeout_ms = -1;
+        uint64_t deadline = daemon_cron_next_deadline(daemon);
+        if (deadline) {
+            uint64_t now = now_ms();
+            uint64_t wait_ms = deadline > now ? deadline - now : 0;
+            timeout_ms = (int)(wait_ms < DAEMON_MAX_SLEEP_MS ? wait_ms : DAEMON_MAX_SLEEP_MS);
+        }
+        int watch_ms = extension_watch_timeout_ms();
+        if (watch_ms >= 0 && (timeout_ms < 0 || watch_ms < timeout_ms)) timeout_ms = watch_ms;
+
+        // poll skips the watch entry while its fd is -1
+        struct pollfd fds[2] = {
+            { .fd = daemon->wake_fds[0], .events = POLLIN },
+            { .fd = extension_watch_fd(), .events = POLLIN },
+        };
+        if (poll(fds, 2, timeout_ms) > 0 && (fds[0].revents & POLLIN)) {
+            char drain[64];
+            while (read(daemon->wake_fds[0], drain, sizeof(drain)) > 0) {}
+        }
     }
 
     return ERR_OK;
@@ -514,9 +764,14 @@ err_t daemon_run_once(daemon_t* daemon) {
     // Run pending cron jobs
     daemon_cron_run_pending(daemon);
 
+    // Reload extensions whose sources changed (no-op unless watching)
+    extension_watch_poll();
+
     // Update uptime
     if (daemon->start_time > 0) {
+        pthread_mutex_lock(&daemon->health_lock);
         daemon->health.uptime_ms = ((uint64_t)time(NULL) * 1000) - daemon->start_time;
+        pthread_mutex_unlock(&daemon->health_lock);
     }
 
     return ERR_OK;
@@ -526,28 +781,221 @@ err_t daemon_run_once(daemon_t* daemon) {
 // Cron Job Management
 // ============================================================================
 
+// A due job's body, queued for the workers with its own copy of the
+// arguments so the job may be removed while it runs
+struct cron_task_t {
+    void (*callback)(const char* args, void* user_data);
+    void* user_data;
+    char* args;
+    cron_task_t* next;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void daemon_wakeup(daemon_t* daemon) {
+    if (!daemon || daemon->wake_fds[1] < 0) return;
+
+    // A full pipe already holds a pending wakeup
+    int saved_errno = errno;
+    ssize_t written = write(daemon->wake_fds[1], "", 1);
+    (void)written;
+    errno = saved_errno;
+}
+
+static void* cron_worker_main(void* arg) {
+    daemon_t* daemon = (daemon_t*)arg;
+
+    pthread_mutex_lock(&daemon->task_lock);
+    for (;;) {
+        while (!daemon->task_head && !daemon->workers_stop) {
+            pthread_cond_wait(&daemon->task_cond, &daemon->task_lock);
+        }
+        // Queued tasks still run on stop
+        cron_task_t* task = daemon->task_head;
+        if (!task) break;
+        daemon->task_head = task->next;
+        if (!daemon->task_head) daemon->task_tail = NULL;
+        pthread_mutex_unlock(&daemon->task_lock);
+
+        task->callback(task->args, task->user_data);
+        free(task->args);
+        free(task);
+
+        pthread_mutex_lock(&daemon->task_lock);
+    }
+    pthread_mutex_unlock(&daemon->task_lock);
+    return NULL;
+}
+
+// Caller holds cron_lock. Threads are created on first use rather than in
+// daemon_create, which runs before daemonize forks.
+static err_t cron_workers_start(daemon_t* daemon) {
+    if (daemon->workers) return ERR_OK;
+
+    uint32_t count = daemon->config.cron_workers ? daemon->config.cron_workers : DAEMON_CRON_WORKERS;
+    daemon->workers = calloc(count, sizeof(pthread_t));
+    if (!daemon->workers) return ERR_OUT_OF_MEMORY;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (pthread_create(&daemon->workers[i], NULL, cron_worker_main, daemon) != 0) break;
+        daemon->worker_count++;
+    }
+    return daemon->worker_count > 0 ? ERR_OK : ERR_FAILED;
+}
+
+static void cron_workers_stop(daemon_t* daemon) {
+    pthread_mutex_lock(&daemon->task_lock);
+    daemon->workers_stop = true;
+    pthread_cond_broadcast(&daemon->task_cond);
+    pthread_mutex_unlock(&daemon->task_lock);
+
+    for (uint32_t i = 0; i < daemon->worker_count; i++) {
+        pthread_join(daemon->workers[i], NULL);
+    }
+    free(daemon->workers);
+    daemon->workers = NULL;
+    daemon->worker_count = 0;
+}
+
+// Caller holds cron_lock
+static err_t cron_dispatch(daemon_t* daemon, cron_job_t* job, uint64_t now) {
+    job->last_run = now;
+    job->run_count++;
+    if (!job->callback) return ERR_OK;
+
+    err_t err = cron_workers_start(daemon);
+    if (err != ERR_OK) return err;
+
+    cron_task_t* task = calloc(1, sizeof(cron_task_t));
+    if (!task) return ERR_OUT_OF_MEMORY;
+    task->callback = job->callback;
+    task->user_data = job->user_data;
+    task->args = strndup(job->command.data ? job->command.data : "", job->command.len);
+    if (!task->args) {
+        free(task);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_lock(&daemon->task_lock);
+    if (daemon->task_tail) daemon->task_tail->next = task;
+    else daemon->task_head = task;
+    daemon->task_tail = task;
+    pthread_cond_signal(&daemon->task_cond);
+    pthread_mutex_unlock(&daemon->task_lock);
+    return ERR_OK;
+}
+
+// Schedule min-heap on next_run; every move updates the job's heap_slot
+static void schedule_place(daemon_t* daemon, uint32_t i, cron_job_t* job) {
+    daemon->schedule[i] = job;
+    job->heap_slot = i + 1;
+}
+
+static void schedule_sift_up(daemon_t* daemon, uint32_t i) {
+    cron_job_t* job = daemon->schedule[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (daemon->schedule[parent]->next_run <= job->next_run) break;
+        schedule_place(daemon, i, daemon->schedule[parent]);
+        i = parent;
+    }
+    schedule_place(daemon, i, job);
+}
+
+static void schedule_sift_down(daemon_t* daemon, uint32_t i) {
+    cron_job_t* job = daemon->schedule[i];
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= daemon->schedule_count) break;
+        if (child + 1 < daemon->schedule_count &&
+            daemon->schedule[child + 1]->next_run < daemon->schedule[child]->next_run) {
+            child++;
+        }
+        if (daemon->schedule[child]->next_run >= job->next_run) break;
+        schedule_place(daemon, i, daemon->schedule[child]);
+        i = child;
+    }
+    schedule_place(daemon, i, job);
+}
+
+static err_t schedule_push(daemon_t* daemon, cron_job_t* job) {
+    if (daemon->schedule_count >= daemon->schedule_capacity) {
+        uint32_t new_cap = daemon->schedule_capacity == 0 ? 8 : daemon->schedule_capacity * 2;
+        cron_job_t** schedule = realloc(daemon->schedule, sizeof(cron_job_t*) * new_cap);
+        if (!schedule) return ERR_OUT_OF_MEMORY;
+        daemon->schedule = schedule;
+        daemon->schedule_capacity = new_cap;
+    }
+    daemon->schedule[daemon->schedule_count] = job;
+    schedule_sift_up(daemon, daemon->schedule_count++);
+    return ERR_OK;
+}
+
+static void schedule_remove(daemon_t* daemon, cron_job_t* job) {
+    if (!job->heap_slot) return;
+
+    uint32_t i = job->heap_slot - 1;
+    job->heap_slot = 0;
+    cron_job_t* last = daemon->schedule[--daemon->schedule_count];
+    if (i == daemon->schedule_count) return;
+
+    // The moved job may belong above or below the hole
+    schedule_place(daemon, i, last);
+    schedule_sift_down(daemon, i);
+    schedule_sift_up(daemon, last->heap_slot - 1);
+}
+
+// Caller holds cron_lock
+static err_t schedule_job(daemon_t* daemon, cron_job_t* job, uint64_t now) {
+    err_t err = cron_compute_next_run(job, now);
+    if (err != ERR_OK) return err;
+    return schedule_push(daemon, job);
+}
+
+static void cron_job_free(cron_job_t* job) {
+    free((void*)job->id.data);
+    free((void*)job->name.data);
+    free((void*)job->expression.data);
+    free((void*)job->command.data);
+    free((void*)job->description.data);
+    free(job);
+}
+
+// Caller holds cron_lock
+static cron_job_t* cron_find(daemon_t* daemon, const str_t* job_id, uint32_t* out_index) {
+    for (uint32_t i = 0; i < daemon->job_count; i++) {
+        if (str_equal(daemon->jobs[i]->id, *job_id)) {
+            if (out_index) *out_index = i;
+            return daemon->jobs[i];
+        }
+    }
+    return NULL;
+}
+
 str_t daemon_generate_job_id(void) {
     static uint32_t counter = 0;
     char buffer[32];
-    snprintf(buffer, sizeof(buffer), "job-%u-%lu", ++counter, (unsigned long)time(NULL));
+    snprintf(buffer, sizeof(buffer), "job-%u-%lu", __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED),
+             (unsigned long)time(NULL));
     return str_dup_cstr(buffer, NULL);
 }
 
 err_t daemon_cron_add(daemon_t* daemon, const cron_job_t* job) {
     if (!daemon || !job) return ERR_INVALID_ARGUMENT;
 
-    // Check capacity
-    if (daemon->job_count >= daemon->job_capacity) {
-        uint32_t new_cap = daemon->job_capacity == 0 ? 8 : daemon->job_capacity * 2;
-        cron_job_t** new_jobs = realloc(daemon->jobs, sizeof(cron_job_t*) * new_cap);
-        if (!new_jobs) return ERR_OUT_OF_MEMORY;
-        daemon->jobs = new_jobs;
-        daemon->job_capacity = new_cap;
-    }
-
-    // Copy job
+    // Copy job; a given expression overrides pre-parsed fields
     cron_job_t* new_job = malloc(sizeof(cron_job_t));
+    if (!new_job) return ERR_OUT_OF_MEMORY;
     *new_job = *job;
+    new_job->heap_slot = 0;
+    if (!str_empty(job->expression) && cron_parse_expression(&job->expression, new_job) != ERR_OK) {
+        free(new_job);
+        return ERR_INVALID_ARGUMENT;
+    }
 
     if (str_empty(new_job->id)) {
         new_job->id = daemon_generate_job_id();
@@ -560,34 +1008,58 @@ err_t daemon_cron_add(daemon_t* daemon, const cron_job_t* job) {
     new_job->command = str_dup(new_job->command, NULL);
     new_job->description = str_dup(new_job->description, NULL);
 
-    daemon->jobs[daemon->job_count++] = new_job;
+    pthread_mutex_lock(&daemon->cron_lock);
+
+    err_t err = ERR_OK;
+    if (daemon->job_count >= daemon->job_capacity) {
+        uint32_t new_cap = daemon->job_capacity == 0 ? 8 : daemon->job_capacity * 2;
+        cron_job_t** new_jobs = realloc(daemon->jobs, sizeof(cron_job_t*) * new_cap);
+        if (!new_jobs) {
+            err = ERR_OUT_OF_MEMORY;
+        } else {
+            daemon->jobs = new_jobs;
+            daemon->job_capacity = new_cap;
+        }
+    }
+
+    // An expression that never matches (say 31 February) is refused
+    if (err == ERR_OK && new_job->enabled) {
+        err = schedule_job(daemon, new_job, now_ms());
+        if (err == ERR_NOT_FOUND) err = ERR_INVALID_ARGUMENT;
+    }
+    if (err == ERR_OK) daemon->jobs[daemon->job_count++] = new_job;
+
+    pthread_mutex_unlock(&daemon->cron_lock);
+
+    if (err != ERR_OK) {
+        cron_job_free(new_job);
+        return err;
+    }
+    daemon_wakeup(daemon);
     return ERR_OK;
 }
 
 err_t daemon_cron_remove(daemon_t* daemon, const str_t* job_id) {
     if (!daemon || !job_id) return ERR_INVALID_ARGUMENT;
 
-    for (uint32_t i = 0; i < daemon->job_count; i++) {
-        if (str_equal(daemon->jobs[i]->id, *job_id)) {
-            // Free job
-            cron_job_t* job = daemon->jobs[i];
-            free((void*)job->id.data);
-            free((void*)job->name.data);
-            free((void*)job->expression.data);
-            free((void*)job->command.data);
-            free((void*)job->description.data);
-            free(job);
-
-            // Shift remaining
-            for (uint32_t j = i; j < daemon->job_count - 1; j++) {
-                daemon->jobs[j] = daemon->jobs[j + 1];
-            }
-            daemon->job_count--;
-            return ERR_OK;
+    pthread_mutex_lock(&daemon->cron_lock);
+    uint32_t index = 0;
+    cron_job_t* job = cron_find(daemon, job_id, &index);
+    if (job) {
+        schedule_remove(daemon, job);
+        cron_job_free(job);
+
+        // Shift remaining
+        for (uint32_t j = index; j < daemon->job_count - 1; j++) {
+            daemon->jobs[j] = daemon->jobs[j + 1];
         }
+        daemon->job_count--;
     }
+    pthread_mutex_unlock(&daemon->cron_lock);
 
-    return ERR_NOT_FOUND;
+    if (!job) return ERR_NOT_FOUND;
+    daemon_wakeup(daemon);
+    return ERR_OK;
 }
 
 err_t daemon_cron_list(daemon_t* daemon, cron_job_t*** out_jobs, uint32_t* out_count) {
@@ -598,33 +1070,69 @@ err_t daemon_cron_list(daemon_t* daemon, cron_job_t*** out_jobs, uint32_t* out_c
     return ERR_OK;
 }
 
-err_t daemon_cron_run_pending(daemon_t* daemon) {
-    if (!daemon) return ERR_INVALID_ARGUMENT;
+err_t daemon_cron_enable(daemon_t* daemon, const str_t* job_id, bool enable) {
+    if (!daemon || !job_id) return ERR_INVALID_ARGUMENT;
 
-    uint64_t now = (uint64_t)time(NULL) * 1000;
+    pthread_mutex_lock(&daemon->cron_lock);
+    cron_job_t* job = cron_find(daemon, job_id, NULL);
+    err_t err = job ? ERR_OK : ERR_NOT_FOUND;
+    if (job && enable && !job->enabled) {
+        err = schedule_job(daemon, job, now_ms());
+        if (err == ERR_OK) job->enabled = true;
+    } else if (job && !enable && job->enabled) {
+        schedule_remove(daemon, job);
+        job->enabled = false;
+    }
+    pthread_mutex_unlock(&daemon->cron_lock);
 
-    for (uint32_t i = 0; i < daemon->job_count; i++) {
-        cron_job_t* job = daemon->jobs[i];
+    if (err == ERR_OK) daemon_wakeup(daemon);
+    return err;
+}
 
-        if (!job->enabled) continue;
-        if (job->next_run > now) continue;
-        if (!cron_should_run(job, now)) continue;
+err_t daemon_cron_run_pending(daemon_t* daemon) {
+    if (!daemon) return ERR_INVALID_ARGUMENT;
 
-        // Execute job
-        job->last_run = now;
-        job->run_count++;
+    uint64_t now = now_ms();
+    err_t err = ERR_OK;
 
-        if (job->callback) {
-            char* args = strndup(job->command.data, job->command.len);
-            job->callback(args, job->user_data);
-            free(args);
+    pthread_mutex_lock(&daemon->cron_lock);
+    while (daemon->schedule_count > 0 && daemon->schedule[0]->next_run <= now) {
+        cron_job_t* job = daemon->schedule[0];
+        err_t dispatch_err = cron_dispatch(daemon, job, now);
+        if (dispatch_err != ERR_OK) {
+            job->fail_count++;
+            err = dispatch_err;
         }
 
-        // Schedule next run (simple: next minute)
-        job->next_run = now + 60000;
+        // Next occurrence after now, so a late wakeup never runs a job twice
+        if (cron_compute_next_run(job, now) == ERR_OK) {
+            schedule_sift_down(daemon, 0);
+        } else {
+            schedule_remove(daemon, job);
+        }
     }
+    pthread_mutex_unlock(&daemon->cron_lock);
 
-    return ERR_OK;
+    return err;
+}
+
+err_t daemon_cron_trigger(daemon_t* daemon, const str_t* job_id) {
+    if (!daemon || !job_id) return ERR_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&daemon->cron_lock);
+    cron_job_t* job = cron_find(daemon, job_id, NULL);
+    err_t err = job ? cron_dispatch(daemon, job, now_ms()) : ERR_NOT_FOUND;
+    pthread_mutex_unlock(&daemon->cron_lock);
+    return err;
+}
+
+uint64_t daemon_cron_next_deadline(daemon_t* daemon) {
+    if (!daemon) return 0;
+
+    pthread_mutex_lock(&daemon->cron_lock);
+    uint64_t deadline = daemon->schedule_count > 0 ? daemon->schedule[0]->next_run : 0;
+    pthread_mutex_unlock(&daemon->cron_lock);
+    return deadline;
 }
 
 // ============================================================================
@@ -634,7 +1142,10 @@ err_t daemon_cron_run_pending(daemon_t* daemon) {
 err_t daemon_health_init(daemon_t* daemon) {
     if (!daemon) return ERR_INVALID_ARGUMENT;
 
-    daemon->health_socket_path = str_dup_cstr(DAEMON_HEALTH_SOCKET, NULL);
+    free((void*)daemon->health_socket_path.data);
+    daemon->health_socket_path = str_empty(daemon->config.health_socket)
+        ? str_dup_cstr(DAEMON_HEALTH_SOCKET, NULL)
+        : str_dup(daemon->config.health_socket, NULL);
     daemon->health_fd = -1;
 
     return ERR_OK;
@@ -649,6 +1160,7 @@ void daemon_health_shutdown(daemon_t* daemon) {
     }
 
     // Remove socket file
+    if (str_empty(daemon->health_socket_path)) return;
     char* path = strndup(daemon->health_socket_path.data, daemon->health_socket_path.len);
     unlink(path);
     free(path);
@@ -658,9 +1170,11 @@ err_t daemon_health_update(daemon_t* daemon) {
     if (!daemon) return ERR_INVALID_ARGUMENT;
 
     // Overall health is the AND of all components
+    pthread_mutex_lock(&daemon->health_lock);
     daemon->health.healthy = daemon->health.provider_healthy &&
                              daemon->health.memory_healthy &&
                              daemon->health.channel_healthy;
+    pthread_mutex_unlock(&daemon->health_lock);
 
     return ERR_OK;
 }
@@ -668,15 +1182,160 @@ err_t daemon_health_update(daemon_t* daemon) {
 err_t daemon_health_get(daemon_t* daemon, health_status_t* out_status) {
     if (!daemon || !out_status) return ERR_INVALID_ARGUMENT;
 
+    pthread_mutex_lock(&daemon->health_lock);
     *out_status = daemon->health;
+    pthread_mutex_unlock(&daemon->health_lock);
     return ERR_OK;
 }
 
+static char* health_json(daemon_t* daemon, size_t* out_len) {
+    health_status_t status = {0};
+    daemon_health_get(daemon, &status);
+
+    json_writer_t w;
+    json_writer_init(&w, 256);
+    json_write_object_begin(&w);
+    json_write_kv_bool(&w, "healthy", status.healthy);
+    json_write_kv_int(&w, "uptime_ms", (int64_t)status.uptime_ms);
+    json_write_kv_bool(&w, "provider_healthy", status.provider_healthy);
+    json_write_kv_bool(&w, "memory_healthy", status.memory_healthy);
+    json_write_kv_bool(&w, "channel_healthy", status.channel_healthy);
+    json_write_kv_int(&w, "messages_processed", status.messages_processed);
+    json_write_kv_int(&w, "api_calls_made", status.api_calls_made);
+    json_write_kv_int(&w, "errors_count", status.errors_count);
+    json_write_object_end(&w);
+    return json_writer_finish(&w, out_len);
+}
+
+static bool send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// One request per connection; the answer is small enough to build whole
+static void health_serve(daemon_t* daemon, int fd) {
+    struct timeval timeout = { .tv_sec = DAEMON_HEALTH_IO_TIMEOUT_MS / 1000,
+                               .tv_usec = (DAEMON_HEALTH_IO_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[2048];
+    size_t len = 0;
+    while (len < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[len] = '\0';
+
+    // Only the path of the request line matters
+    char path[256] = "";
+    if (sscanf(request, "GET %255s", path) != 1) {
+        static const char bad[] = "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        send_all(fd, bad, sizeof(bad) - 1);
+        return;
+    }
+    char* query = strchr(path, '?');
+    if (query) *query = '\0';
+
+    const char* content_type = NULL;
+    char* body = NULL;
+    size_t body_len = 0;
+    if (strcmp(path, "/metrics") == 0) {
+        str_t text = STR_NULL;
+        if (metrics_export_prometheus(&text) == ERR_OK) {
+            body = (char*)text.data;
+            body_len = text.len;
+        }
+        content_type = "text/plain; version=0.0.4";
+    } else if (strcmp(path, "/health") == 0 || strcmp(path, "/") == 0) {
+        body = health_json(daemon, &body_len);
+        content_type = "application/json";
+    }
+
+    char head[192];
+    int head_len;
+    if (!content_type) {
+        head_len = snprintf(head, sizeof(head), "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    } else if (!body) {
+        head_len = snprintf(head, sizeof(head), "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n");
+    } else {
+        head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                            content_type, body_len);
+    }
+
+    if (send_all(fd, head, (size_t)head_len) && body) send_all(fd, body, body_len);
+    free(body);
+}
+
+static void* health_server_main(void* arg) {
+    daemon_t* daemon = (daemon_t*)arg;
+
+    struct pollfd fds[3] = {
+        { .fd = daemon->health_stop_fds[0], .events = POLLIN },
+        { .fd = daemon->health_fd, .events = POLLIN },
+        { .fd = daemon->metrics_fd, .events = POLLIN },
+    };
+
+    for (;;) {
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) break;
+
+        for (int i = 1; i < 3; i++) {
+            if (fds[i].fd < 0 || !(fds[i].revents & POLLIN)) continue;
+            int client = accept4(fds[i].fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client < 0) continue;
+            health_serve(daemon, client);
+            close(client);
+        }
+    }
+    return NULL;
+}
+
+static int metrics_listen(const daemon_config_t* config) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->metrics_port);
+
+    char host[64] = DAEMON_METRICS_BIND;
+    if (!str_empty(config->metrics_bind)) {
+        snprintf(host, sizeof(host), "%.*s", (int)config->metrics_bind.len, config->metrics_bind.data);
+    }
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) return -1;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 err_t daemon_health_server_start(daemon_t* daemon) {
     if (!daemon) return ERR_INVALID_ARGUMENT;
+    if (daemon->health_thread_started) return ERR_ALREADY_EXISTS;
+    if (str_empty(daemon->health_socket_path)) daemon_health_init(daemon);
 
     // Create Unix socket
-    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (fd < 0) {
         return ERR_FAILED;
     }
@@ -701,16 +1360,51 @@ err_t daemon_health_server_start(daemon_t* daemon) {
     }
 
     daemon->health_fd = fd;
-    return ERR_OK;
+
+    // A busy TCP port leaves the unix socket serving; report it anyway
+    err_t err = ERR_OK;
+    if (daemon->config.metrics_port) {
+        daemon->metrics_fd = metrics_listen(&daemon->config);
+        if (daemon->metrics_fd < 0) err = ERR_NETWORK;
+    }
+
+    if (pipe2(daemon->health_stop_fds, O_CLOEXEC) != 0) {
+        daemon->health_stop_fds[0] = -1;
+        daemon->health_stop_fds[1] = -1;
+        return ERR_FAILED;
+    }
+    if (pthread_create(&daemon->health_thread, NULL, health_server_main, daemon) != 0) {
+        return ERR_FAILED;
+    }
+    daemon->health_thread_started = true;
+
+    return err;
 }
 
 void daemon_health_server_stop(daemon_t* daemon) {
     if (!daemon) return;
 
+    if (daemon->health_thread_started) {
+        ssize_t written;
+        do {
+            written = write(daemon->health_stop_fds[1], "x", 1);
+        } while (written < 0 && errno == EINTR);
+        pthread_join(daemon->health_thread, NULL);
+        daemon->health_thread_started = false;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (daemon->health_stop_fds[i] >= 0) close(daemon->health_stop_fds[i]);
+        daemon->health_stop_fds[i] = -1;
+    }
+
     if (daemon->health_fd >= 0) {
         close(daemon->health_fd);
         daemon->health_fd = -1;
     }
+    if (daemon->metrics_fd >= 0) {
+        close(daemon->metrics_fd);
+        daemon->metrics_fd = -1;
+    }
 }
 
 // ============================================================================
@@ -0,0 +1,460 @@
+// docker_pool.c - Warm container pool for sandboxed shell commands
+// SPDX-License-Identifier: MIT
+
+#include "runtime/docker_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+// docker run, exec-for-reset and rm each get this long
+#define DOCKER_COMMAND_TIMEOUT_MS 60000
+// First retry after a failed start; doubles up to the cap
+#define DOCKER_RETRY_MIN_MS 1000
+#define DOCKER_RETRY_MAX_MS 30000
+// Exit status docker uses for its own failures (daemon gone, no container)
+#define DOCKER_EXIT_DAEMON_ERROR 125
+// 128 + SIGKILL: the command or the container was killed, usually by the OOM killer
+#define DOCKER_EXIT_KILLED 137
+
+typedef enum {
+    SLOT_EMPTY,                // Nothing started yet; the maintainer starts one
+    SLOT_STARTING,
+    SLOT_IDLE,
+    SLOT_BUSY,
+    SLOT_DIRTY,                // Ran a command, waiting for its reset
+    SLOT_RESETTING,
+    SLOT_RETIRED,              // Waiting to be removed
+    SLOT_REMOVING
+} slot_state_t;
+
+typedef struct pool_slot_t {
+    slot_state_t state;
+    char id[80];
+    uint32_t uses;
+} pool_slot_t;
+
+struct docker_pool_t {
+    docker_pool_config_t config;   // Strings owned
+    pool_slot_t* slots;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t maintainer;
+    bool stopping;
+
+    uint32_t start_failures_in_row;
+    uint64_t retry_at_ms;          // No start before this
+    docker_pool_stats_t stats;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Realtime, the clock pthread_cond_timedwait uses by default
+static void wait_until(docker_pool_t* pool, uint64_t deadline_ms) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(deadline_ms / 1000),
+        .tv_nsec = (long)(deadline_ms % 1000) * 1000000L,
+    };
+    pthread_cond_timedwait(&pool->changed, &pool->lock, &ts);
+}
+
+docker_pool_config_t docker_pool_config_default(void) {
+    return (docker_pool_config_t){
+        .image = "alpine:3.20",
+        .network = "none",
+        .memory_limit_mb = 512,
+        .cpu_limit = 1.0,
+        .read_only_rootfs = true,
+        .workspace_dir = NULL,
+        .size = DOCKER_POOL_DEFAULT_SIZE,
+        .max_uses = DOCKER_POOL_DEFAULT_MAX_USES,
+        .acquire_timeout_ms = DOCKER_POOL_DEFAULT_ACQUIRE_TIMEOUT_MS,
+        .docker = "docker",
+        .reset_command = DOCKER_POOL_RESET_COMMAND,
+    };
+}
+
+// ============================================================================
+// Docker commands (run without the pool lock)
+// ============================================================================
+
+static err_t run_docker(char* const argv[], uint32_t timeout_ms, shell_run_result_t* out_result) {
+    shell_run_options_t options = { .timeout_ms = timeout_ms, .max_output = 4096 };
+    err_t err = shell_run_argv(argv, &options, out_result);
+    if (err != ERR_OK) return ERR_DOCKER_UNAVAILABLE;
+    if (out_result->timed_out || out_result->exit_code != 0) {
+        shell_run_result_free(out_result);
+        return ERR_DOCKER_UNAVAILABLE;
+    }
+    return ERR_OK;
+}
+
+static err_t container_start(const docker_pool_config_t* c, char* out_id, size_t id_size) {
+    char memory[32], cpus[32], network[128], volume[1100];
+    char* argv[24];
+    int n = 0;
+    argv[n++] = (char*)c->docker;
+    argv[n++] = "run";
+    argv[n++] = "-d";
+    argv[n++] = "--rm";
+    argv[n++] = "--label";
+    argv[n++] = "cclaw.pool=1";
+    if (c->network && *c->network) {
+        snprintf(network, sizeof(network), "--network=%s", c->network);
+        argv[n++] = network;
+    }
+    if (c->memory_limit_mb > 0) {
+        snprintf(memory, sizeof(memory), "--memory=%llum", (unsigned long long)c->memory_limit_mb);
+        argv[n++] = memory;
+    }
+    if (c->cpu_limit > 0) {
+        snprintf(cpus, sizeof(cpus), "--cpus=%.2f", c->cpu_limit);
+        argv[n++] = cpus;
+    }
+    if (c->read_only_rootfs) {
+        argv[n++] = "--read-only";
+        argv[n++] = "--tmpfs";
+        argv[n++] = "/tmp";
+    }
+    if (c->workspace_dir) {
+        snprintf(volume, sizeof(volume), "%s:%s", c->workspace_dir, DOCKER_POOL_WORKDIR);
+        argv[n++] = "-v";
+        argv[n++] = volume;
+    }
+    argv[n++] = (char*)c->image;
+    argv[n++] = "sleep";
+    argv[n++] = "infinity";
+    argv[n] = NULL;
+
+    shell_run_result_t run;
+    err_t err = run_docker(argv, DOCKER_COMMAND_TIMEOUT_MS, &run);
+    if (err != ERR_OK) return err;
+
+    // `docker run -d` prints the container id
+    size_t len = run.out.len;
+    while (len > 0 && (run.out.data[len - 1] == '\n' || run.out.data[len - 1] == '\r')) len--;
+    if (len == 0 || len >= id_size || memchr(run.out.data, '\n', len)) {
+        shell_run_result_free(&run);
+        return ERR_DOCKER_UNAVAILABLE;
+    }
+    memcpy(out_id, run.out.data, len);
+    out_id[len] = '\0';
+    shell_run_result_free(&run);
+    return ERR_OK;
+}
+
+static err_t container_reset(const docker_pool_config_t* c, const char* id) {
+    char* argv[] = { (char*)c->docker, "exec", (char*)id, "sh", "-c", (char*)c->reset_command, NULL };
+    shell_run_result_t run;
+    err_t err = run_docker(argv, DOCKER_COMMAND_TIMEOUT_MS, &run);
+    if (err == ERR_OK) shell_run_result_free(&run);
+    return err;
+}
+
+static void containers_remove(const docker_pool_config_t* c, char** ids, uint32_t count) {
+    if (count == 0) return;
+
+    char** argv = calloc(count + 4, sizeof(char*));
+    if (!argv) return;
+    argv[0] = (char*)c->docker;
+    argv[1] = "rm";
+    argv[2] = "-f";
+    memcpy(argv + 3, ids, count * sizeof(char*));
+
+    shell_run_result_t run;
+    if (run_docker(argv, DOCKER_COMMAND_TIMEOUT_MS, &run) == ERR_OK) shell_run_result_free(&run);
+    free(argv);
+}
+
+// ============================================================================
+// Maintenance thread
+// ============================================================================
+
+// Caller holds the lock. Removals first so a replacement can start, then
+// resets (a container nearly ready to hand out), then new starts.
+static pool_slot_t* next_job(docker_pool_t* pool, uint64_t now) {
+    static const slot_state_t order[] = { SLOT_RETIRED, SLOT_DIRTY, SLOT_EMPTY };
+    for (size_t o = 0; o < sizeof(order) / sizeof(order[0]); o++) {
+        if (order[o] == SLOT_EMPTY && now < pool->retry_at_ms) continue;
+        for (uint32_t i = 0; i < pool->config.size; i++) {
+            if (pool->slots[i].state == order[o]) return &pool->slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void* maintainer_main(void* arg) {
+    docker_pool_t* pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping) {
+        uint64_t now = now_ms();
+        pool_slot_t* slot = next_job(pool, now);
+        if (!slot) {
+            bool waiting_retry = false;
+            for (uint32_t i = 0; i < pool->config.size; i++) {
+                if (pool->slots[i].state == SLOT_EMPTY) waiting_retry = true;
+            }
+            if (waiting_retry) {
+                wait_until(pool, pool->retry_at_ms);
+            } else {
+                pthread_cond_wait(&pool->changed, &pool->lock);
+            }
+            continue;
+        }
+
+        slot_state_t job = slot->state;
+        char id[sizeof(slot->id)];
+        memcpy(id, slot->id, sizeof(id));
+        slot->state = job == SLOT_RETIRED ? SLOT_REMOVING : job == SLOT_DIRTY ? SLOT_RESETTING : SLOT_STARTING;
+        pthread_mutex_unlock(&pool->lock);
+
+        err_t err = ERR_OK;
+        if (job == SLOT_RETIRED) {
+            char* ids[] = { id };
+            containers_remove(&pool->config, ids, 1);
+        } else if (job == SLOT_DIRTY) {
+            err = container_reset(&pool->config, id);
+        } else {
+            err = container_start(&pool->config, id, sizeof(id));
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (job == SLOT_RETIRED) {
+            slot->state = SLOT_EMPTY;
+            slot->id[0] = '\0';
+        } else if (job == SLOT_DIRTY) {
+            // A container that can't be reset is not trusted with the next command
+            if (err == ERR_OK) {
+                slot->state = SLOT_IDLE;
+            } else {
+                slot->state = SLOT_RETIRED;
+                pool->stats.recycled++;
+            }
+        } else if (err == ERR_OK) {
+            memcpy(slot->id, id, sizeof(slot->id));
+            slot->uses = 0;
+            slot->state = SLOT_IDLE;
+            pool->stats.started++;
+            pool->start_failures_in_row = 0;
+            pool->retry_at_ms = 0;
+        } else {
+            slot->state = SLOT_EMPTY;
+            pool->stats.start_failures++;
+            uint64_t backoff = DOCKER_RETRY_MIN_MS << (pool->start_failures_in_row < 5 ? pool->start_failures_in_row : 5);
+            if (backoff > DOCKER_RETRY_MAX_MS) backoff = DOCKER_RETRY_MAX_MS;
+            pool->start_failures_in_row++;
+            pool->retry_at_ms = now_ms() + backoff;
+        }
+        pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// ============================================================================
+// Pool API
+// ============================================================================
+
+static char* dup_or_null(const char* s) {
+    return s ? strdup(s) : NULL;
+}
+
+static void pool_free(docker_pool_t* pool) {
+    free((void*)pool->config.image);
+    free((void*)pool->config.network);
+    free((void*)pool->config.workspace_dir);
+    free((void*)pool->config.docker);
+    free((void*)pool->config.reset_command);
+    free(pool->slots);
+    free(pool);
+}
+
+err_t docker_pool_create(const docker_pool_config_t* config, docker_pool_t** out_pool) {
+    if (!out_pool) return ERR_INVALID_ARGUMENT;
+
+    docker_pool_config_t defaults = docker_pool_config_default();
+    docker_pool_config_t c = config ? *config : defaults;
+    if (!c.image || !*c.image) return ERR_INVALID_ARGUMENT;
+    if (c.size == 0) c.size = DOCKER_POOL_DEFAULT_SIZE;
+    if (c.max_uses == 0) c.max_uses = DOCKER_POOL_DEFAULT_MAX_USES;
+    if (c.acquire_timeout_ms == 0) c.acquire_timeout_ms = DOCKER_POOL_DEFAULT_ACQUIRE_TIMEOUT_MS;
+    if (!c.docker) c.docker = defaults.docker;
+    if (!c.reset_command) c.reset_command = defaults.reset_command;
+
+    docker_pool_t* pool = calloc(1, sizeof(docker_pool_t));
+    if (!pool) return ERR_OUT_OF_MEMORY;
+
+    pool->config = c;
+    pool->config.image = dup_or_null(c.image);
+    pool->config.network = dup_or_null(c.network);
+    pool->config.workspace_dir = dup_or_null(c.workspace_dir);
+    pool->config.docker = dup_or_null(c.docker);
+    pool->config.reset_command = dup_or_null(c.reset_command);
+    pool->slots = calloc(c.size, sizeof(pool_slot_t));
+    if (!pool->config.image || !pool->config.docker || !pool->config.reset_command || !pool->slots ||
+        (c.network && !pool->config.network) || (c.workspace_dir && !pool->config.workspace_dir)) {
+        pool_free(pool);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    pthread_cond_init(&pool->changed, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+
+    if (pthread_create(&pool->maintainer, NULL, maintainer_main, pool) != 0) {
+        pthread_cond_destroy(&pool->changed);
+        pthread_mutex_destroy(&pool->lock);
+        pool_free(pool);
+        return ERR_FAILED;
+    }
+
+    *out_pool = pool;
+    return ERR_OK;
+}
+
+err_t docker_pool_create_from_config(const config_t* config, docker_pool_t** out_pool) {
+    if (!config || !out_pool) return ERR_INVALID_ARGUMENT;
+
+    docker_pool_config_t c = docker_pool_config_default();
+    if (!str_empty(config->runtime.docker.image)) c.image = config->runtime.docker.image.data;
+    c.network = str_empty(config->runtime.docker.network) ? NULL : config->runtime.docker.network.data;
+    c.memory_limit_mb = config->runtime.docker.memory_limit_mb;
+    c.cpu_limit = config->runtime.docker.cpu_limit;
+    c.read_only_rootfs = config->runtime.docker.read_only_rootfs;
+    if (config->runtime.docker.mount_workspace && !str_empty(config->workspace_dir)) {
+        c.workspace_dir = config->workspace_dir.data;
+    }
+    c.size = config->runtime.docker.pool_size;
+    c.max_uses = config->runtime.docker.max_uses;
+
+    return docker_pool_create(&c, out_pool);
+}
+
+void docker_pool_destroy(docker_pool_t* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_join(pool->maintainer, NULL);
+
+    // One `docker rm -f` for everything still running
+    char** ids = calloc(pool->config.size, sizeof(char*));
+    uint32_t count = 0;
+    for (uint32_t i = 0; ids && i < pool->config.size; i++) {
+        if (pool->slots[i].id[0]) ids[count++] = pool->slots[i].id;
+    }
+    containers_remove(&pool->config, ids, count);
+    free(ids);
+
+    pthread_cond_destroy(&pool->changed);
+    pthread_mutex_destroy(&pool->lock);
+    pool_free(pool);
+}
+
+// Caller holds the lock. True while some container may still become idle
+// without another start succeeding first.
+static bool idle_expected(const docker_pool_t* pool) {
+    if (pool->start_failures_in_row == 0) return true;
+    for (uint32_t i = 0; i < pool->config.size; i++) {
+        slot_state_t state = pool->slots[i].state;
+        if (state == SLOT_STARTING || state == SLOT_BUSY || state == SLOT_DIRTY || state == SLOT_RESETTING) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static pool_slot_t* slot_acquire(docker_pool_t* pool) {
+    uint64_t deadline = now_ms() + pool->config.acquire_timeout_ms;
+
+    pthread_mutex_lock(&pool->lock);
+    pool_slot_t* slot = NULL;
+    while (!pool->stopping) {
+        for (uint32_t i = 0; i < pool->config.size && !slot; i++) {
+            if (pool->slots[i].state == SLOT_IDLE) slot = &pool->slots[i];
+        }
+        if (slot) {
+            slot->state = SLOT_BUSY;
+            break;
+        }
+        // Docker is failing to start containers: say so now rather than
+        // after the full timeout
+        if (!idle_expected(pool) || now_ms() >= deadline) break;
+        wait_until(pool, deadline);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return slot;
+}
+
+static bool policy_violated(err_t err, const shell_run_result_t* run) {
+    return err != ERR_OK || run->timed_out || run->term_signal != 0 ||
+           run->exit_code == DOCKER_EXIT_KILLED || run->exit_code == DOCKER_EXIT_DAEMON_ERROR;
+}
+
+err_t docker_pool_exec(docker_pool_t* pool, const char* command, const shell_run_options_t* options,
+                       shell_run_result_t* out_result) {
+    if (!pool || !command || !out_result) return ERR_INVALID_ARGUMENT;
+
+    pool_slot_t* slot = slot_acquire(pool);
+    if (!slot) return ERR_DOCKER_UNAVAILABLE;
+
+    char* argv[10];
+    int n = 0;
+    argv[n++] = (char*)pool->config.docker;
+    argv[n++] = "exec";
+    if (pool->config.workspace_dir) {
+        argv[n++] = "-w";
+        argv[n++] = DOCKER_POOL_WORKDIR;
+    }
+    argv[n++] = slot->id;
+    argv[n++] = "sh";
+    argv[n++] = "-c";
+    argv[n++] = (char*)command;
+    argv[n] = NULL;
+
+    shell_run_options_t opts = options ? *options : (shell_run_options_t){0};
+    opts.cwd = NULL;
+    err_t err = shell_run_argv(argv, &opts, out_result);
+    bool violated = policy_violated(err, out_result);
+
+    pthread_mutex_lock(&pool->lock);
+    slot->uses++;
+    pool->stats.execs++;
+    if (violated) pool->stats.violations++;
+    if (violated || slot->uses >= pool->config.max_uses) {
+        slot->state = SLOT_RETIRED;
+        pool->stats.recycled++;
+    } else {
+        slot->state = SLOT_DIRTY;
+    }
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+
+    return err;
+}
+
+void docker_pool_stats(docker_pool_t* pool, docker_pool_stats_t* out_stats) {
+    if (!out_stats) return;
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    *out_stats = pool->stats;
+    for (uint32_t i = 0; i < pool->config.size; i++) {
+        if (pool->slots[i].state == SLOT_IDLE) out_stats->idle++;
+        if (pool->slots[i].state == SLOT_BUSY) out_stats->busy++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,663 @@
+// loadgen.c - Synthetic session load generator behind `cclaw bench`
+// SPDX-License-Identifier: MIT
+
+#include "runtime/loadgen.h"
+#include "core/alloc.h"
+#include "core/metrics.h"
+#include "utils/http.h"
+#include "utils/json_writer.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Heap and magazine sampling interval
+#define LOADGEN_SAMPLE_MS 10
+
+static const char* g_prompts[] = {
+    "Summarize the open issues in the deploy checklist",
+    "What did we decide about the retention policy last week?",
+    "Draft a short reply thanking the vendor for the quote",
+    "List the files under src that mention the rate limiter",
+    "Refactor this function so the error path frees the buffer",
+    "Remind me what the staging database is called",
+    "Explain the difference between p95 and p99 latency in two sentences",
+    "Write a cron expression for every weekday at 07:30",
+    "Check whether the backup job ran last night",
+    "Translate 'the build is green again' into German",
+};
+#define PROMPT_COUNT (sizeof(g_prompts) / sizeof(g_prompts[0]))
+
+static const char* g_replies[] = {
+    "Done. The checklist has three open items, all owned by the platform team.",
+    "You chose 90 days for conversations and no limit for core notes.",
+    "Sure, here is a draft you can send as is.",
+};
+#define REPLY_COUNT (sizeof(g_replies) / sizeof(g_replies[0]))
+
+// Offered as name, description, JSON schema
+static const char* g_tools[][3] = {
+    { "shell", "Run a shell command in the workspace",
+      "{\"type\":\"object\",\"properties\":{\"command\":{\"type\":\"string\"}},\"required\":[\"command\"]}" },
+    { "file_read", "Read a file, optionally a line range",
+      "{\"type\":\"object\",\"properties\":{\"path\":{\"type\":\"string\"},"
+      "\"offset\":{\"type\":\"integer\"},\"limit\":{\"type\":\"integer\"}},\"required\":[\"path\"]}" },
+    { "memory_recall", "Search long-term memory",
+      "{\"type\":\"object\",\"properties\":{\"query\":{\"type\":\"string\"}},\"required\":[\"query\"]}" },
+};
+#define TOOL_COUNT (sizeof(g_tools) / sizeof(g_tools[0]))
+
+typedef struct loadgen_run_t loadgen_run_t;
+
+typedef struct loadgen_session_t {
+    loadgen_run_t* run;
+    uint32_t id;
+    uint64_t rng;
+    pthread_t thread;
+    http_client_t* http;       // Webhook target
+
+    // Ring of the last `history` messages, system prompt kept apart
+    chat_message_t* messages;
+    uint32_t message_start;
+    uint32_t message_count;
+    chat_message_t* request;   // system + history, rebuilt per turn
+
+    uint64_t* latencies;
+    uint64_t* ttfts;
+    uint32_t sample_count;
+    uint32_t ttft_count;
+    uint32_t sample_cap;
+
+    uint64_t turns;
+    uint64_t errors;
+    uint64_t tool_turns;
+    uint64_t tool_calls;
+    err_t first_error;
+} loadgen_session_t;
+
+struct loadgen_run_t {
+    const loadgen_config_t* config;
+    tool_def_t tools[TOOL_COUNT];
+    uint64_t deadline_us;      // 0 = none
+    bool done;                 // Atomic, stops the sampler
+
+    uint64_t peak_heap;
+    uint32_t peak_magazines;
+};
+
+// Per-turn state while a reply streams in
+typedef struct loadgen_turn_t {
+    uint64_t start_us;
+    uint64_t first_us;
+    char* text;
+    size_t len;
+    size_t cap;
+    bool tool_call;
+    bool failed;
+} loadgen_turn_t;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t rng_next(uint64_t* state) {
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+static double rng_unit(uint64_t* state) {
+    return (double)(rng_next(state) >> 11) / 9007199254740992.0;
+}
+
+static bool deadline_passed(const loadgen_run_t* run) {
+    return run->deadline_us && metrics_now_us() >= run->deadline_us;
+}
+
+// Sleeps at most until the deadline
+static void pause_ms(const loadgen_run_t* run, uint64_t ms) {
+    uint64_t wait_us = ms * 1000;
+    if (run->deadline_us) {
+        uint64_t now = metrics_now_us();
+        if (now >= run->deadline_us) return;
+        if (run->deadline_us - now < wait_us) wait_us = run->deadline_us - now;
+    }
+    struct timespec ts = { .tv_sec = (time_t)(wait_us / 1000000), .tv_nsec = (long)(wait_us % 1000000) * 1000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+// Exponential around the mean, capped at ten times it
+static uint64_t think_time_ms(loadgen_session_t* session) {
+    uint32_t mean = session->run->config->think_ms;
+    if (mean == 0) return 0;
+    double u = rng_unit(&session->rng);
+    double ms = -log1p(-u) * mean;
+    return (uint64_t)(ms < mean * 10.0 ? ms : mean * 10.0);
+}
+
+static bool turn_append(loadgen_turn_t* turn, const char* data, size_t len) {
+    if (turn->len + len + 1 > turn->cap) {
+        size_t cap = turn->cap ? turn->cap * 2 : 256;
+        while (cap < turn->len + len + 1) cap *= 2;
+        char* text = realloc(turn->text, cap);
+        if (!text) return false;
+        turn->text = text;
+        turn->cap = cap;
+    }
+    memcpy(turn->text + turn->len, data, len);
+    turn->len += len;
+    turn->text[turn->len] = '\0';
+    return true;
+}
+
+static void turn_first_token(loadgen_turn_t* turn) {
+    if (!turn->first_us) turn->first_us = metrics_now_us();
+}
+
+static void session_fail(loadgen_session_t* session, err_t err) {
+    session->errors++;
+    if (session->first_error == ERR_OK) session->first_error = err;
+}
+
+static bool session_record(loadgen_session_t* session, uint64_t latency_us, const uint64_t* ttft_us) {
+    if (session->sample_count == session->sample_cap) {
+        uint32_t cap = session->sample_cap ? session->sample_cap * 2 : 64;
+        uint64_t* latencies = realloc(session->latencies, cap * sizeof(uint64_t));
+        if (latencies) session->latencies = latencies;
+        uint64_t* ttfts = realloc(session->ttfts, cap * sizeof(uint64_t));
+        if (ttfts) session->ttfts = ttfts;
+        if (!latencies || !ttfts) return false;
+        session->sample_cap = cap;
+    }
+    session->latencies[session->sample_count++] = latency_us;
+    if (ttft_us) session->ttfts[session->ttft_count++] = *ttft_us;
+    return true;
+}
+
+// ============================================================================
+// Provider Turns
+// ============================================================================
+
+static void session_push(loadgen_session_t* session, chat_role_t role, const char* text, size_t len) {
+    uint32_t history = session->run->config->history;
+    uint32_t slot;
+    if (session->message_count < history) {
+        slot = (session->message_start + session->message_count++) % history;
+    } else {
+        slot = session->message_start;
+        session->message_start = (session->message_start + 1) % history;
+        free((void*)session->messages[slot].content.data);
+    }
+
+    char* copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, text, len);
+        copy[len] = '\0';
+    }
+    session->messages[slot] = (chat_message_t){
+        .role = role,
+        .content = { .data = copy, .len = copy ? (uint32_t)len : 0 }
+    };
+}
+
+static void on_provider_delta(const stream_delta_t* delta, void* user_data) {
+    loadgen_turn_t* turn = user_data;
+    switch (delta->type) {
+        case STREAM_DELTA_TEXT:
+            turn_first_token(turn);
+            if (!turn_append(turn, delta->text.data, delta->text.len)) turn->failed = true;
+            break;
+        case STREAM_DELTA_TOOL_CALL:
+            turn_first_token(turn);
+            turn->tool_call = true;
+            break;
+        case STREAM_DELTA_ERROR:
+            turn->failed = true;
+            break;
+        default:
+            break;
+    }
+}
+
+static err_t provider_turn(loadgen_session_t* session, bool offer_tools, loadgen_turn_t* turn) {
+    const loadgen_config_t* config = session->run->config;
+
+    // Unique per session, so the single-flight layer never merges sessions
+    char prompt[256];
+    int len = snprintf(prompt, sizeof(prompt), "%s (session %u)",
+                       g_prompts[rng_next(&session->rng) % PROMPT_COUNT], session->id);
+    session_push(session, CHAT_ROLE_USER, prompt, (size_t)len);
+
+    uint32_t count = 1;
+    session->request[0] = (chat_message_t){
+        .role = CHAT_ROLE_SYSTEM,
+        .content = STR_LIT("You are a concise assistant. Answer in one or two sentences."),
+        .cache_breakpoint = true
+    };
+    for (uint32_t i = 0; i < session->message_count; i++) {
+        session->request[count++] = session->messages[(session->message_start + i) % config->history];
+    }
+
+    const tool_def_t* tools = offer_tools ? session->run->tools : NULL;
+    uint32_t tool_count = offer_tools ? (uint32_t)TOOL_COUNT : 0;
+    provider_t* provider = config->provider;
+    const char* model = config->model;
+    double temperature = provider->config.default_temperature;
+
+    err_t err;
+    if (config->stream) {
+        err = provider_chat_stream_deltas(provider, session->request, count, tools, tool_count, model,
+                                          temperature, on_provider_delta, turn);
+        if (err == ERR_OK && turn->failed) err = ERR_PROVIDER;
+    } else {
+        chat_response_t* response = NULL;
+        err = provider->vtable->chat(provider, session->request, count, tools, tool_count, model,
+                                     temperature, &response);
+        if (err == ERR_OK && response) {
+            turn->tool_call = !str_empty(response->tool_calls);
+            if (!turn_append(turn, response->content.data ? response->content.data : "", response->content.len)) {
+                err = ERR_OUT_OF_MEMORY;
+            }
+        }
+        if (response) chat_response_free(response);
+    }
+    if (err != ERR_OK) return err;
+
+    // Tool calls are not executed; a canned reply keeps the conversation going
+    if (turn->len == 0) {
+        const char* reply = g_replies[rng_next(&session->rng) % REPLY_COUNT];
+        session_push(session, CHAT_ROLE_ASSISTANT, reply, strlen(reply));
+    } else {
+        session_push(session, CHAT_ROLE_ASSISTANT, turn->text, turn->len);
+    }
+    return ERR_OK;
+}
+
+// ============================================================================
+// Webhook and Memory Turns
+// ============================================================================
+
+static size_t on_webhook_data(const char* data, size_t len, void* user_data) {
+    loadgen_turn_t* turn = user_data;
+    // The first event goes out with the first token
+    if (!turn->first_us && len > 0) turn->first_us = metrics_now_us();
+    return len;
+}
+
+static err_t webhook_turn(loadgen_session_t* session, loadgen_turn_t* turn) {
+    const loadgen_config_t* config = session->run->config;
+
+    char sender[32];
+    snprintf(sender, sizeof(sender), "bench-%u", session->id);
+    json_writer_t w;
+    json_writer_init(&w, 256);
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "text", g_prompts[rng_next(&session->rng) % PROMPT_COUNT]);
+    json_write_kv_string(&w, "sender", sender);
+    json_write_object_end(&w);
+    char* body = json_writer_finish(&w, NULL);
+    if (!body) return ERR_OUT_OF_MEMORY;
+
+    err_t err;
+    http_response_t* response = NULL;
+    if (config->stream) {
+        err = http_post_json_stream_status(session->http, config->url, body, on_webhook_data, turn, &response);
+    } else {
+        err = http_post_json(session->http, config->url, body, &response);
+    }
+    if (err == ERR_OK && (!response || response->status_code < 200 || response->status_code >= 300)) {
+        err = ERR_HTTP_ERROR;
+    }
+    http_response_free(response);
+    free(body);
+    return err;
+}
+
+static err_t memory_turn(loadgen_session_t* session, bool store, loadgen_turn_t* turn) {
+    memory_t* memory = session->run->config->memory;
+    const char* text = g_prompts[rng_next(&session->rng) % PROMPT_COUNT];
+
+    if (store) {
+        char key[64];
+        snprintf(key, sizeof(key), "bench-%u-%llu", session->id, (unsigned long long)session->turns);
+        str_t key_str = STR_VIEW(key);
+        str_t content = STR_VIEW(text);
+        memory_entry_t* entry = memory_entry_create(&key_str, &content, MEMORY_CATEGORY_CONVERSATION, NULL);
+        if (!entry) return ERR_OUT_OF_MEMORY;
+        err_t err = memory->vtable->store(memory, entry);
+        memory_entry_free(entry);
+        return err;
+    }
+
+    // Two words of the prompt, like a recall tool call would send
+    const char* space = strchr(text, ' ');
+    const char* second = space ? strchr(space + 1, ' ') : NULL;
+    str_t query = { .data = text, .len = (uint32_t)(second ? (size_t)(second - text) : strlen(text)) };
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    err_t err = memory_search_simple(memory, &query, 5, &results, &count);
+    if (err == ERR_OK) memory_entry_array_free(results, count);
+    return err;
+}
+
+// ============================================================================
+// Sessions
+// ============================================================================
+
+static void* session_main(void* arg) {
+    loadgen_session_t* session = arg;
+    loadgen_run_t* run = session->run;
+    const loadgen_config_t* config = run->config;
+
+    // Staggered start, so sessions do not move in lockstep
+    if (config->think_ms) pause_ms(run, rng_next(&session->rng) % config->think_ms);
+
+    for (uint32_t i = 0; (config->turns == 0 || i < config->turns) && !deadline_passed(run); i++) {
+        if (i > 0) {
+            pause_ms(run, think_time_ms(session));
+            if (deadline_passed(run)) break;
+        }
+
+        bool tools = rng_unit(&session->rng) < config->tool_ratio;
+        loadgen_turn_t turn = { .start_us = metrics_now_us() };
+        err_t err;
+        switch (config->target) {
+            case LOADGEN_TARGET_PROVIDER: err = provider_turn(session, tools, &turn); break;
+            case LOADGEN_TARGET_WEBHOOK: err = webhook_turn(session, &turn); break;
+            case LOADGEN_TARGET_MEMORY: err = memory_turn(session, tools, &turn); break;
+            default: err = ERR_INVALID_ARGUMENT; break;
+        }
+        uint64_t end = metrics_now_us();
+        free(turn.text);
+
+        session->turns++;
+        if (tools && config->target != LOADGEN_TARGET_WEBHOOK) session->tool_turns++;
+        if (turn.tool_call) session->tool_calls++;
+        if (err != ERR_OK) {
+            session_fail(session, err);
+            continue;
+        }
+        uint64_t ttft = turn.first_us - turn.start_us;
+        bool streamed = config->stream && turn.first_us;
+        if (!session_record(session, end - turn.start_us, streamed ? &ttft : NULL)) {
+            session_fail(session, ERR_OUT_OF_MEMORY);
+        }
+    }
+    return NULL;
+}
+
+static void* sampler_main(void* arg) {
+    loadgen_run_t* run = arg;
+    while (!__atomic_load_n(&run->done, __ATOMIC_ACQUIRE)) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        uint64_t heap = (uint64_t)(info.uordblks + info.hblkhd);
+        if (heap > run->peak_heap) run->peak_heap = heap;
+#endif
+        uint32_t magazines = sizeclass_magazines_used();
+        if (magazines > run->peak_magazines) run->peak_magazines = magazines;
+
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = LOADGEN_SAMPLE_MS * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+static void session_free(loadgen_session_t* session) {
+    if (session->messages) {
+        for (uint32_t i = 0; i < session->message_count; i++) {
+            uint32_t slot = (session->message_start + i) % session->run->config->history;
+            free((void*)session->messages[slot].content.data);
+        }
+    }
+    free(session->messages);
+    free(session->request);
+    free(session->latencies);
+    free(session->ttfts);
+    if (session->http) http_client_destroy(session->http);
+}
+
+static err_t session_init(loadgen_session_t* session, loadgen_run_t* run, uint32_t id, uint64_t seed) {
+    const loadgen_config_t* config = run->config;
+    session->run = run;
+    session->id = id;
+    // Never zero, and distinct per session
+    session->rng = (seed + (uint64_t)id * 0x9E3779B97F4A7C15ULL) | 1;
+
+    if (config->target == LOADGEN_TARGET_PROVIDER) {
+        session->messages = calloc(config->history, sizeof(chat_message_t));
+        session->request = calloc(config->history + 1, sizeof(chat_message_t));
+        if (!session->messages || !session->request) return ERR_OUT_OF_MEMORY;
+    } else if (config->target == LOADGEN_TARGET_WEBHOOK) {
+        http_client_config_t http_config = http_client_default_config();
+        session->http = http_client_create(&http_config);
+        if (!session->http) return ERR_OUT_OF_MEMORY;
+        if (config->stream) http_client_add_header(session->http, "Accept", "text/event-stream");
+        if (config->auth_token && config->auth_token[0]) {
+            char auth[512];
+            snprintf(auth, sizeof(auth), "Bearer %s", config->auth_token);
+            http_client_add_header(session->http, "Authorization", auth);
+        }
+    }
+    return ERR_OK;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t* sorted, uint32_t count, double q) {
+    if (count == 0) return 0;
+    uint32_t rank = (uint32_t)(q * count + 0.999999);
+    return sorted[rank ? (rank > count ? count : rank) - 1 : 0];
+}
+
+static err_t loadgen_collect(loadgen_session_t* sessions, uint32_t count, loadgen_report_t* report) {
+    uint32_t samples = 0, ttfts = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        samples += sessions[i].sample_count;
+        ttfts += sessions[i].ttft_count;
+        report->turns += sessions[i].turns;
+        report->errors += sessions[i].errors;
+        report->tool_turns += sessions[i].tool_turns;
+        report->tool_calls += sessions[i].tool_calls;
+        if (report->first_error == ERR_OK) report->first_error = sessions[i].first_error;
+    }
+
+    uint64_t* latencies = malloc((samples ? samples : 1) * sizeof(uint64_t));
+    uint64_t* first = malloc((ttfts ? ttfts : 1) * sizeof(uint64_t));
+    if (!latencies || !first) {
+        free(latencies);
+        free(first);
+        return ERR_OUT_OF_MEMORY;
+    }
+    uint32_t n = 0, m = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        memcpy(latencies + n, sessions[i].latencies, sessions[i].sample_count * sizeof(uint64_t));
+        n += sessions[i].sample_count;
+        memcpy(first + m, sessions[i].ttfts, sessions[i].ttft_count * sizeof(uint64_t));
+        m += sessions[i].ttft_count;
+    }
+    qsort(latencies, n, sizeof(uint64_t), compare_u64);
+    qsort(first, m, sizeof(uint64_t), compare_u64);
+
+    report->latency_p50_us = percentile(latencies, n, 0.50);
+    report->latency_p95_us = percentile(latencies, n, 0.95);
+    report->latency_p99_us = percentile(latencies, n, 0.99);
+    report->latency_max_us = n ? latencies[n - 1] : 0;
+    report->ttft_count = m;
+    report->ttft_p50_us = percentile(first, m, 0.50);
+    report->ttft_p95_us = percentile(first, m, 0.95);
+    report->ttft_p99_us = percentile(first, m, 0.99);
+    free(latencies);
+    free(first);
+    return ERR_OK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+loadgen_config_t loadgen_config_default(void) {
+    return (loadgen_config_t){
+        .target = LOADGEN_TARGET_PROVIDER,
+        .sessions = LOADGEN_DEFAULT_SESSIONS,
+        .turns = LOADGEN_DEFAULT_TURNS,
+        .think_ms = LOADGEN_DEFAULT_THINK_MS,
+        .tool_ratio = LOADGEN_DEFAULT_TOOL_RATIO,
+        .history = LOADGEN_DEFAULT_HISTORY,
+        .stream = true
+    };
+}
+
+err_t loadgen_run(const loadgen_config_t* config, loadgen_report_t* out_report) {
+    if (!config || !out_report || config->sessions == 0) return ERR_INVALID_ARGUMENT;
+    if (config->turns == 0 && config->duration_ms == 0) return ERR_INVALID_ARGUMENT;
+    if (config->tool_ratio < 0.0 || config->tool_ratio > 1.0) return ERR_INVALID_ARGUMENT;
+    switch (config->target) {
+        case LOADGEN_TARGET_PROVIDER:
+            if (!config->provider || !config->provider->vtable || config->history == 0) return ERR_INVALID_ARGUMENT;
+            break;
+        case LOADGEN_TARGET_WEBHOOK:
+            if (!config->url || !config->url[0]) return ERR_INVALID_ARGUMENT;
+            break;
+        case LOADGEN_TARGET_MEMORY:
+            if (!config->memory || !config->memory->vtable) return ERR_INVALID_ARGUMENT;
+            break;
+        default:
+            return ERR_INVALID_ARGUMENT;
+    }
+
+    memset(out_report, 0, sizeof(*out_report));
+    out_report->target = config->target;
+    loadgen_session_t* sessions = calloc(config->sessions, sizeof(loadgen_session_t));
+    if (!sessions) return ERR_OUT_OF_MEMORY;
+
+    loadgen_run_t run = { .config = config };
+    for (uint32_t i = 0; i < TOOL_COUNT; i++) {
+        run.tools[i] = (tool_def_t){ .name = STR_VIEW(g_tools[i][0]), .description = STR_VIEW(g_tools[i][1]),
+                                     .parameters = STR_VIEW(g_tools[i][2]) };
+    }
+    uint64_t seed = config->seed ? config->seed : (uint64_t)time(NULL) ^ metrics_now_us();
+    err_t err = ERR_OK;
+    for (uint32_t i = 0; i < config->sessions && err == ERR_OK; i++) {
+        err = session_init(&sessions[i], &run, i, seed);
+    }
+
+    pthread_t sampler;
+    bool sampling = false;
+    uint64_t start = metrics_now_us();
+    uint32_t started = 0;
+    if (err == ERR_OK) {
+        if (config->duration_ms) run.deadline_us = start + config->duration_ms * 1000;
+        sampling = pthread_create(&sampler, NULL, sampler_main, &run) == 0;
+        for (; started < config->sessions; started++) {
+            if (pthread_create(&sessions[started].thread, NULL, session_main, &sessions[started]) != 0) {
+                err = ERR_FAILED;
+                // Whatever started finishes on its own schedule
+                break;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < started; i++) pthread_join(sessions[i].thread, NULL);
+    uint64_t end = metrics_now_us();
+
+    __atomic_store_n(&run.done, true, __ATOMIC_RELEASE);
+    if (sampling) pthread_join(sampler, NULL);
+
+    if (err == ERR_OK) {
+        err = loadgen_collect(sessions, config->sessions, out_report);
+        out_report->elapsed_s = (double)(end - start) / 1e6;
+        out_report->turns_per_s = out_report->elapsed_s > 0 ?
+            (double)(out_report->turns - out_report->errors) / out_report->elapsed_s : 0;
+        out_report->peak_heap_bytes = run.peak_heap;
+        out_report->peak_magazines = run.peak_magazines;
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+            out_report->peak_rss_bytes = (uint64_t)usage.ru_maxrss;
+#else
+            out_report->peak_rss_bytes = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+        }
+    }
+
+    for (uint32_t i = 0; i < config->sessions; i++) {
+        if (sessions[i].run) session_free(&sessions[i]);
+    }
+    free(sessions);
+    return err;
+}
+
+static void print_ms(FILE* out, const char* label, uint64_t p50, uint64_t p95, uint64_t p99) {
+    fprintf(out, "  %-18s p50 %9.1f ms   p95 %9.1f ms   p99 %9.1f ms\n", label,
+            (double)p50 / 1000.0, (double)p95 / 1000.0, (double)p99 / 1000.0);
+}
+
+void loadgen_report_print(const loadgen_report_t* report, FILE* out) {
+    if (!report || !out) return;
+
+    fprintf(out, "  %-18s %llu (%llu failed)\n", "Turns", (unsigned long long)report->turns,
+            (unsigned long long)report->errors);
+    if (report->errors && report->first_error != ERR_OK) {
+        fprintf(out, "  %-18s %s\n", "First error", error_to_string(report->first_error));
+    }
+    fprintf(out, "  %-18s %.2f turns/s over %.2f s\n", "Throughput", report->turns_per_s, report->elapsed_s);
+    print_ms(out, "Turn latency", report->latency_p50_us, report->latency_p95_us, report->latency_p99_us);
+    if (report->ttft_count) {
+        print_ms(out, "First token", report->ttft_p50_us, report->ttft_p95_us, report->ttft_p99_us);
+    }
+    if (report->target == LOADGEN_TARGET_MEMORY) {
+        fprintf(out, "  %-18s %llu\n", "Stores", (unsigned long long)report->tool_turns);
+    } else if (report->target == LOADGEN_TARGET_PROVIDER) {
+        fprintf(out, "  %-18s %llu turns offered, %llu called\n", "Tools", (unsigned long long)report->tool_turns,
+                (unsigned long long)report->tool_calls);
+    }
+    fprintf(out, "  %-18s %.1f MiB\n", "Peak RSS", (double)report->peak_rss_bytes / (1024.0 * 1024.0));
+    if (report->peak_heap_bytes) {
+        fprintf(out, "  %-18s %.1f MiB\n", "Peak heap", (double)report->peak_heap_bytes / (1024.0 * 1024.0));
+    }
+    fprintf(out, "  %-18s %u\n", "Peak magazines", report->peak_magazines);
+}
+
+err_t loadgen_report_json(const loadgen_report_t* report, char** out_json) {
+    if (!report || !out_json) return ERR_INVALID_ARGUMENT;
+
+    json_writer_t w;
+    json_writer_init(&w, 512);
+    json_write_object_begin(&w);
+    json_write_kv_int(&w, "turns", (int64_t)report->turns);
+    json_write_kv_int(&w, "errors", (int64_t)report->errors);
+    if (report->first_error != ERR_OK) json_write_kv_string(&w, "first_error", error_to_string(report->first_error));
+    json_write_kv_int(&w, "tool_turns", (int64_t)report->tool_turns);
+    json_write_kv_int(&w, "tool_calls", (int64_t)report->tool_calls);
+    json_write_kv_number(&w, "elapsed_s", report->elapsed_s);
+    json_write_kv_number(&w, "turns_per_s", report->turns_per_s);
+    json_write_kv_number(&w, "latency_p50_ms", (double)report->latency_p50_us / 1000.0);
+    json_write_kv_number(&w, "latency_p95_ms", (double)report->latency_p95_us / 1000.0);
+    json_write_kv_number(&w, "latency_p99_ms", (double)report->latency_p99_us / 1000.0);
+    json_write_kv_number(&w, "latency_max_ms", (double)report->latency_max_us / 1000.0);
+    json_write_kv_int(&w, "ttft_samples", report->ttft_count);
+    json_write_kv_number(&w, "ttft_p50_ms", (double)report->ttft_p50_us / 1000.0);
+    json_write_kv_number(&w, "ttft_p95_ms", (double)report->ttft_p95_us / 1000.0);
+    json_write_kv_number(&w, "ttft_p99_ms", (double)report->ttft_p99_us / 1000.0);
+    json_write_kv_int(&w, "peak_rss_bytes", (int64_t)report->peak_rss_bytes);
+    json_write_kv_int(&w, "peak_heap_bytes", (int64_t)report->peak_heap_bytes);
+    json_write_kv_int(&w, "peak_magazines", report->peak_magazines);
+    json_write_object_end(&w);
+
+    *out_json = json_writer_finish(&w, NULL);
+    return *out_json ? ERR_OK : ERR_OUT_OF_MEMORY;
+}
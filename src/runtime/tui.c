@@ -4,6 +4,7 @@
 #include "runtime/tui.h"
 #include "core/alloc.h"
 #include "core/agent.h"
+#include "utils/text_scan.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,10 +15,13 @@
 #include <signal.h>
 #include <ctype.h>
 #include <time.h>
+#include <poll.h>
 
 // Global TUI instance for signal handling
 static tui_t* g_tui = NULL;
 
+static uint32_t utf8_char_count(const char* str, uint32_t len);
+
 // ============================================================================
 // Terminal Control
 // ============================================================================
@@ -95,28 +99,28 @@ void tui_theme_apply(tui_t* tui, const tui_theme_t* theme) {
 }
 
 // ============================================================================
-// ANSI Drawing
+// Drawing Primitives
 // ============================================================================
 
-void tui_move_cursor(uint16_t x, uint16_t y) {
-    printf("\033[%d;%dH", y + 1, x + 1);
+void tui_move_cursor(tui_t* tui, uint16_t x, uint16_t y) {
+    tui_screen_move(tui->screen, x, y);
 }
 
-void tui_set_color(uint8_t fg, uint8_t bg) {
-    printf("\033[38;5;%dm\033[48;5;%dm", fg, bg);
+void tui_set_color(tui_t* tui, uint8_t fg, uint8_t bg) {
+    tui_screen_set_style(tui->screen, fg, bg, 0);
 }
 
-void tui_reset_color(void) {
-    printf("\033[0m");
+void tui_reset_color(tui_t* tui) {
+    tui_screen_reset_style(tui->screen);
 }
 
 void tui_clear_screen(tui_t* tui) {
-    (void)tui;
-    printf(TUI_CLEAR_SCREEN TUI_CURSOR_HOME);
-    fflush(stdout);
+    tui_screen_clear(tui->screen);
 }
 
-void tui_draw_box(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title) {
+void tui_draw_box(tui_t* tui, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* title) {
+    if (w < 2 || h < 2) return;
+
     // Draw corners and borders
     const char* ul = "┌";
     const char* ur = "┐";
@@ -126,61 +130,62 @@ void tui_draw_box(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char* ti
     const char* vline = "│";
 
     // Top border
-    tui_move_cursor(x, y);
-    printf("%s", ul);
-    for (uint16_t i = 0; i < w - 2; i++) printf("%s", hline);
-    printf("%s", ur);
+    tui_move_cursor(tui, x, y);
+    tui_screen_puts(tui->screen, ul);
+    for (uint16_t i = 0; i < w - 2; i++) tui_screen_puts(tui->screen, hline);
+    tui_screen_puts(tui->screen, ur);
 
     // Title
     if (title && strlen(title) > 0) {
-        tui_move_cursor(x + 2, y);
-        printf(" %s ", title);
+        tui_move_cursor(tui, x + 2, y);
+        tui_screen_printf(tui->screen, " %s ", title);
     }
 
     // Side borders
     for (uint16_t i = 1; i < h - 1; i++) {
-        tui_move_cursor(x, y + i);
-        printf("%s", vline);
-        tui_move_cursor(x + w - 1, y + i);
-        printf("%s", vline);
+        tui_move_cursor(tui, x, y + i);
+        tui_screen_puts(tui->screen, vline);
+        tui_move_cursor(tui, x + w - 1, y + i);
+        tui_screen_puts(tui->screen, vline);
     }
 
     // Bottom border
-    tui_move_cursor(x, y + h - 1);
-    printf("%s", ll);
-    for (uint16_t i = 0; i < w - 2; i++) printf("%s", hline);
-    printf("%s", lr);
+    tui_move_cursor(tui, x, y + h - 1);
+    tui_screen_puts(tui->screen, ll);
+    for (uint16_t i = 0; i < w - 2; i++) tui_screen_puts(tui->screen, hline);
+    tui_screen_puts(tui->screen, lr);
 }
 
-void tui_draw_line(uint16_t x, uint16_t y, uint16_t len, bool horizontal) {
-    tui_move_cursor(x, y);
+void tui_draw_line(tui_t* tui, uint16_t x, uint16_t y, uint16_t len, bool horizontal) {
+    tui_move_cursor(tui, x, y);
     const char* hline = "─";
     const char* vline = "│";
 
     if (horizontal) {
         for (uint16_t i = 0; i < len; i++) {
-            printf("%s", hline);
+            tui_screen_puts(tui->screen, hline);
         }
     } else {
         for (uint16_t i = 0; i < len; i++) {
-            tui_move_cursor(x, y + i);
-            printf("%s", vline);
+            tui_move_cursor(tui, x, y + i);
+            tui_screen_puts(tui->screen, vline);
         }
     }
 }
 
-void tui_draw_text(uint16_t x, uint16_t y, const char* text) {
-    tui_move_cursor(x, y);
-    printf("%s", text);
+void tui_draw_text(tui_t* tui, uint16_t x, uint16_t y, const char* text) {
+    tui_move_cursor(tui, x, y);
+    tui_screen_puts(tui->screen, text);
 }
 
-void tui_draw_text_truncated(uint16_t x, uint16_t y, uint16_t max_width, const char* text) {
-    tui_move_cursor(x, y);
+void tui_draw_text_truncated(tui_t* tui, uint16_t x, uint16_t y, uint16_t max_width, const char* text) {
+    tui_move_cursor(tui, x, y);
     size_t len = strlen(text);
     if (len > max_width) {
-        printf("%.*s...", (int)max_width - 3, text);
+        if (max_width > 3) tui_screen_put(tui->screen, text, max_width - 3);
+        tui_screen_puts(tui->screen, "...");
     } else {
-        printf("%s", text);
+        tui_screen_put(tui->screen, text, len);
     }
 }
 
@@ -200,6 +205,7 @@ tui_config_t tui_config_default(void) {
         .show_token_count = true,
         .show_timestamps = false,
         .show_branch_indicator = true,
+        .max_fps = TUI_DEFAULT_FPS,
         .theme = tui_theme_default()
     };
 }
@@ -232,6 +238,17 @@ err_t tui_create(const tui_config_t* config, tui_t** out_tui) {
         return ERR_OUT_OF_MEMORY;
     }
 
+    err_t err = tui_screen_create(tui->config.width, tui->config.height, STDOUT_FILENO, &tui->screen);
+    if (err != ERR_OK) {
+        free(tui->history);
+        free(tui->input_buffer);
+        free(tui);
+        return err;
+    }
+    if (tui->config.max_fps > 0) {
+        tui_screen_set_frame_interval(tui->screen, 1000u / tui->config.max_fps);
+    }
+
     // Create panels
     for (int i = 0; i < 5; i++) {
         tui->panels[i] = calloc(1, sizeof(tui_panel_t));
@@ -240,6 +257,7 @@ err_t tui_create(const tui_config_t* config, tui_t** out_tui) {
             for (int j = 0; j < i; j++) {
                 free(tui->panels[j]);
             }
+            tui_screen_free(tui->screen);
             free(tui->history);
             free(tui->input_buffer);
             free(tui);
@@ -250,9 +268,11 @@ err_t tui_create(const tui_config_t* config, tui_t** out_tui) {
     }
 
     // Initialize message list
-    tui->messages = NULL;
-    tui->messages_tail = NULL;
-    tui->message_count = 0;
+    err = tui_scrollback_init(&tui->scrollback, 0);
+    if (err != ERR_OK) {
+        tui_destroy(tui);
+        return err;
+    }
     tui->selected_session = 0;
 
     g_tui = tui;
@@ -273,19 +293,13 @@ void tui_destroy(tui_t* tui) {
     free(tui->history);
 
     // Free messages
-    tui_message_t* msg = tui->messages;
-    while (msg) {
-        tui_message_t* next = msg->next;
-        free(msg->text);
-        free(msg->sender);
-        free(msg);
-        msg = next;
-    }
+    tui_scrollback_free(&tui->scrollback);
 
     for (int i = 0; i < 5; i++) {
         free(tui->panels[i]);
     }
 
+    tui_screen_free(tui->screen);
     free(tui);
 
     if (g_tui == tui) {
@@ -323,9 +337,10 @@ err_t tui_init_terminal(tui_t* tui) {
 
     tui->raw_mode = true;
 
-    // Hide cursor
+    // Hide cursor; the first frame paints the whole screen
     printf(TUI_CURSOR_HIDE);
     fflush(stdout);
+    tui_screen_invalidate(tui->screen);
 
     return ERR_OK;
 }
@@ -371,7 +386,12 @@ err_t tui_run(tui_t* tui, agent_t* agent) {
     while (tui->running) {
         if (tui->needs_redraw) {
             tui_redraw(tui);
-            tui->needs_redraw = false;
+        }
+
+        // A deferred frame is drawn once due, even with no key pressed
+        if (tui->needs_redraw) {
+            struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+            if (poll(&pfd, 1, tui_screen_frame_wait_ms(tui->screen)) <= 0) continue;
         }
 
         tui_process_input(tui);
@@ -391,24 +411,29 @@ void tui_stop(tui_t* tui) {
 // ============================================================================
 
 void tui_refresh(tui_t* tui) {
-    fflush(stdout);
+    if (tui_screen_flush(tui->screen) != ERR_OK) {
+        // Whatever is on the terminal now, the next frame replaces it
+        tui_screen_invalidate(tui->screen);
+    }
 }
 
 void tui_redraw(tui_t* tui) {
-    if (!tui) return;
+    if (!tui || !tui->screen) return;
 
-    tui_clear_screen(tui);
+    // Deferred to the loop; a later change just joins the frame
+    if (!tui_screen_frame_due(tui->screen)) {
+        tui->needs_redraw = true;
+        return;
+    }
+    tui->needs_redraw = false;
 
-    // Calculate panel sizes
-    uint16_t sidebar_width = 25;
-    uint16_t status_height = 1;
-    uint16_t input_height = 3;
-    uint16_t toolbar_height = 1;
+    uint16_t width, height;
+    tui_screen_get_size(tui->screen, &width, &height);
+    if (width != tui->config.width || height != tui->config.height) {
+        tui_screen_resize(tui->screen, tui->config.width, tui->config.height);
+    }
 
-    uint16_t chat_x = sidebar_width;
-    uint16_t chat_y = toolbar_height;
-    uint16_t chat_w = tui->config.width - sidebar_width;
-    uint16_t chat_h = tui->config.height - toolbar_height - status_height - input_height;
+    tui_clear_screen(tui);
 
     // Draw panels
     tui_draw_toolbar(tui);
@@ -420,19 +445,23 @@ void tui_redraw(tui_t* tui) {
     tui_refresh(tui);
 }
 
-void tui_draw_toolbar(tui_t* tui) {
-    // Top toolbar with key hints
-    tui_set_color(tui->config.theme.color_fg, tui->config.theme.color_primary);
-    tui_move_cursor(0, 0);
-
+// Blank a whole row in the current colors
+static void tui_fill_row(tui_t* tui, uint16_t y) {
+    tui_move_cursor(tui, 0, y);
     for (uint16_t i = 0; i < tui->config.width; i++) {
-        printf(" ");
+        tui_screen_put(tui->screen, " ", 1);
     }
+}
+
+void tui_draw_toolbar(tui_t* tui) {
+    // Top toolbar with key hints
+    tui_set_color(tui, tui->config.theme.color_fg, tui->config.theme.color_primary);
+    tui_fill_row(tui, 0);
 
-    tui_move_cursor(1, 0);
-    printf("CClaw Agent  |  Ctrl+H: Help  |  Ctrl+N: New  |  Ctrl+B: Branch  |  Ctrl+Q: Quit");
+    tui_move_cursor(tui, 1, 0);
+    tui_screen_puts(tui->screen, "CClaw Agent  |  Ctrl+H: Help  |  Ctrl+N: New  |  Ctrl+B: Branch  |  Ctrl+Q: Quit");
 
-    tui_reset_color();
+    tui_reset_color(tui);
 }
 
 void tui_draw_sidebar(tui_t* tui) {
@@ -440,16 +469,16 @@ void tui_draw_sidebar(tui_t* tui) {
     uint16_t sidebar_h = tui->config.height - 1;
 
     const char* title = (tui->active_panel == TUI_PANEL_SIDEBAR) ? "Sessions (*)" : "Sessions";
-    tui_draw_box(0, 1, sidebar_w, sidebar_h, title);
+    tui_draw_box(tui, 0, 1, sidebar_w, sidebar_h, title);
 
-    tui_set_color(tui->config.theme.color_muted, tui->config.theme.color_bg);
+    tui_set_color(tui, tui->config.theme.color_muted, tui->config.theme.color_bg);
 
     // List sessions from agent
     uint32_t session_count = tui->agent ? tui->agent->ctx->session_count : 0;
     uint32_t max_display = (sidebar_h > 3) ? sidebar_h - 3 : 0;
 
     for (uint32_t i = 0; i < max_display; i++) {
-        tui_move_cursor(2, 3 + i);
+        tui_move_cursor(tui, 2, (uint16_t)(3 + i));
         
         bool is_selected = (i == tui->selected_session);
         bool is_active = false;
@@ -460,23 +489,24 @@ void tui_draw_sidebar(tui_t* tui) {
         
         // Highlight selected session
         if (is_selected && tui->active_panel == TUI_PANEL_SIDEBAR) {
-            tui_set_color(tui->config.theme.color_bg, tui->config.theme.color_primary);
+            tui_set_color(tui, tui->config.theme.color_bg, tui->config.theme.color_primary);
         } else if (is_active) {
-            tui_set_color(tui->config.theme.color_primary, tui->config.theme.color_bg);
+            tui_set_color(tui, tui->config.theme.color_primary, tui->config.theme.color_bg);
         } else {
-            tui_set_color(tui->config.theme.color_muted, tui->config.theme.color_bg);
+            tui_set_color(tui, tui->config.theme.color_muted, tui->config.theme.color_bg);
         }
         
         if (i < session_count) {
-            printf("%s %s", is_active ? ">" : " ", tui->agent->ctx->sessions[i]->name.data ? tui->agent->ctx->sessions[i]->name.data : "unnamed");
+            const char* name = tui->agent->ctx->sessions[i]->name.data;
+            tui_screen_printf(tui->screen, "%s %s", is_active ? ">" : " ", name ? name : "unnamed");
         } else if (i == 0 && session_count == 0) {
-            printf("  (no sessions)");
+            tui_screen_puts(tui->screen, "  (no sessions)");
         } else {
             break;
         }
     }
 
-    tui_reset_color();
+    tui_reset_color(tui);
 }
 
 void tui_draw_chat_panel(tui_t* tui) {
@@ -486,17 +516,18 @@ void tui_draw_chat_panel(tui_t* tui) {
     uint16_t h = tui->config.height - 5;
 
     // Draw border
-    tui_draw_box(x, y, w, h, NULL);
+    tui_draw_box(tui, x, y, w, h, tui->scrollback.scroll > 0 ? "History (PgDn)" : NULL);
+    if (w < 4 || h < 3) return;
 
     // Chat content area - render messages
-    tui_set_color(tui->config.theme.color_fg, tui->config.theme.color_bg);
+    tui_set_color(tui, tui->config.theme.color_fg, tui->config.theme.color_bg);
 
     // Calculate visible message area
     uint16_t max_lines = h - 2;
     uint16_t line_y = y + 1;
 
     // Show placeholder if no messages
-    if (!tui->messages) {
+    if (tui->scrollback.count == 0) {
         const char* placeholder[] = {
             "Welcome to CClaw Agent!",
             "Type a message to start chatting.",
@@ -504,71 +535,45 @@ void tui_draw_chat_panel(tui_t* tui) {
             NULL
         };
         for (int i = 0; placeholder[i] && i < (int)max_lines; i++) {
-            tui_move_cursor(x + 2, line_y + i);
-            printf("%s", placeholder[i]);
+            tui_draw_text(tui, x + 2, (uint16_t)(line_y + i), placeholder[i]);
         }
     } else {
-        // Render messages from linked list
-        uint16_t lines_used = 0;
-        tui_message_t* msg = tui->messages;
-        
-        // Count total messages to show from the end
-        uint32_t msg_count = 0;
-        while (msg) {
-            msg_count++;
-            msg = msg->next;
-        }
-
-        // Show last N messages that fit
-        uint32_t skip = (msg_count > max_lines) ? msg_count - max_lines : 0;
-        msg = tui->messages;
-        for (uint32_t i = 0; i < skip && msg; i++) {
-            msg = msg->next;
-        }
-
-        // Render visible messages
-        while (msg && lines_used < max_lines) {
-            tui_move_cursor(x + 2, line_y + lines_used);
-            
-            // Color by sender
-            if (strcmp(msg->sender, "user") == 0) {
-                tui_set_color(tui->config.theme.color_success, tui->config.theme.color_bg);
-                printf("[You]: ");
-            } else if (strcmp(msg->sender, "assistant") == 0) {
-                tui_set_color(tui->config.theme.color_primary, tui->config.theme.color_bg);
-                printf("[AI]: ");
-            } else {
-                tui_set_color(tui->config.theme.color_muted, tui->config.theme.color_bg);
-                printf("[%s]: ", msg->sender);
-            }
-            
-            tui_set_color(tui->config.theme.color_fg, tui->config.theme.color_bg);
-            
-            // Print message text (truncate if too long)
-            uint16_t max_text_width = w - 10;
-            if (strlen(msg->text) > max_text_width) {
-                printf("%.*s...", max_text_width, msg->text);
-            } else {
-                printf("%s", msg->text);
+        // Only the visible window is looked at; wrapping is cached
+        tui_scrollback_set_width(&tui->scrollback, w - 3);
+        tui_scrollback_line_t lines[TUI_CHAT_MAX_ROWS];
+        if (max_lines > TUI_CHAT_MAX_ROWS) max_lines = TUI_CHAT_MAX_ROWS;
+        uint32_t count = tui_scrollback_window(&tui->scrollback, max_lines, lines);
+
+        for (uint32_t i = 0; i < count; i++) {
+            const tui_message_t* msg = lines[i].message;
+            uint16_t row = (uint16_t)(line_y + i);
+
+            if (lines[i].line == 0) {
+                // Color by sender
+                uint8_t color = tui->config.theme.color_muted;
+                if (strcmp(msg->sender, "user") == 0) {
+                    color = tui->config.theme.color_success;
+                } else if (strcmp(msg->sender, "assistant") == 0) {
+                    color = tui->config.theme.color_primary;
+                }
+                tui_set_color(tui, color, tui->config.theme.color_bg);
+                tui_draw_text(tui, x + 2, row, msg->label);
             }
-            
-            lines_used++;
-            msg = msg->next;
+
+            tui_set_color(tui, tui->config.theme.color_fg, tui->config.theme.color_bg);
+            tui_move_cursor(tui, (uint16_t)(x + 2 + msg->label_width), row);
+            tui_screen_put(tui->screen, lines[i].text, lines[i].len);
         }
     }
 
-    tui_reset_color();
+    tui_reset_color(tui);
 }
 
 void tui_draw_status_bar(tui_t* tui) {
     uint16_t y = tui->config.height - 4;
 
-    tui_set_color(15, tui->config.theme.color_primary);
-    tui_move_cursor(0, y);
-
-    for (uint16_t i = 0; i < tui->config.width; i++) {
-        printf(" ");
-    }
+    tui_set_color(tui, 15, tui->config.theme.color_primary);
+    tui_fill_row(tui, y);
 
     char status[256];
     const char* model_name = "unknown";
@@ -576,47 +581,51 @@ void tui_draw_status_bar(tui_t* tui) {
         model_name = tui->agent->ctx->provider->config.default_model.data;
         if (!model_name) model_name = "unknown";
     }
-    snprintf(status, sizeof(status), " Model: %s  |  Tokens: %u  |  Branch: main ",
-             model_name, 0);
+    snprintf(status, sizeof(status), " Model: %s  |  Tokens: %u  |  Branch: main%s ",
+             model_name, 0, tui->streaming ? "  |  Receiving..." : "");
 
-    tui_move_cursor(1, y);
-    printf("%s", status);
+    tui_draw_text(tui, 1, y, status);
 
-    tui_reset_color();
+    tui_reset_color(tui);
 }
 
 void tui_draw_input_area(tui_t* tui) {
     uint16_t y = tui->config.height - 3;
 
     // Clear input area
-    tui_set_color(tui->config.theme.color_fg, tui->config.theme.color_bg);
+    tui_set_color(tui, tui->config.theme.color_fg, tui->config.theme.color_bg);
 
     for (uint16_t i = 0; i < 3; i++) {
-        tui_move_cursor(0, y + i);
-        for (uint16_t j = 0; j < tui->config.width; j++) {
-            printf(" ");
-        }
+        tui_fill_row(tui, y + i);
     }
 
     // Draw prompt
-    tui_set_color(tui->config.theme.color_success, tui->config.theme.color_bg);
-    tui_move_cursor(0, y + 1);
-    printf(" > ");
+    tui_set_color(tui, tui->config.theme.color_success, tui->config.theme.color_bg);
+    tui_draw_text(tui, 0, y + 1, " > ");
 
     // Draw input text
-    tui_set_color(tui->config.theme.color_fg, tui->config.theme.color_bg);
-    printf("%s", tui->input_buffer);
+    tui_set_color(tui, tui->config.theme.color_fg, tui->config.theme.color_bg);
+    tui_screen_put(tui->screen, tui->input_buffer, tui->input_len);
 
-    // Position cursor
-    tui_move_cursor(3 + tui->input_pos, y + 1);
+    // Position cursor (hidden, but kept where typing happens)
+    uint32_t column = 3 + utf8_char_count(tui->input_buffer, tui->input_pos);
+    tui_screen_set_cursor(tui->screen, (uint16_t)column, y + 1, false);
 
-    tui_reset_color();
+    tui_reset_color(tui);
 }
 
 // ============================================================================
 // Input Handling
 // ============================================================================
 
+static void tui_chat_replace_last(tui_t* tui, const char* sender, const char* text);
+
+static void tui_stream_text(const str_t* delta, void* user_data) {
+    tui_t* tui = (tui_t*)user_data;
+    tui_chat_append_text(tui, delta->data, delta->len);
+    tui_redraw(tui);
+}
+
 err_t tui_process_input(tui_t* tui) {
     if (!tui) return ERR_INVALID_ARGUMENT;
 
@@ -685,6 +694,18 @@ err_t tui_process_input(tui_t* tui) {
                     read(STDIN_FILENO, &c, 1); // consume ~
                     tui_input_delete(tui);
                     break;
+                case '5': // Page Up
+                case '6': // Page Down
+                    {
+                        read(STDIN_FILENO, &c, 1); // consume ~
+                        uint16_t rows = tui->config.height > 8 ? tui->config.height - 8 : 1;
+                        if (seq[1] == '5') {
+                            tui_chat_scroll_up(tui, rows);
+                        } else {
+                            tui_chat_scroll_down(tui, rows);
+                        }
+                    }
+                    break;
             }
         }
         tui->needs_redraw = true;
@@ -754,6 +775,7 @@ err_t tui_process_input(tui_t* tui) {
     }
 
     if (c == TUI_KEY_CTRL('l')) {
+        tui_screen_invalidate(tui->screen);
         tui_redraw(tui);
         return ERR_OK;
     }
@@ -798,12 +820,19 @@ err_t tui_process_input(tui_t* tui) {
                     }
                     
                     if (session) {
-                        err_t err = agent_process_message(tui->agent, session, &user_input, &response);
+                        // The reply is drawn as it arrives, into a message of its own
+                        tui_chat_add_assistant_message(tui, "");
+                        tui->streaming = true;
+                        tui_redraw(tui);
+                        err_t err = agent_process_message_stream(tui->agent, session, &user_input,
+                                                                 tui_stream_text, tui, &response);
+                        tui->streaming = false;
                         if (err == ERR_OK && response.data) {
-                            tui_chat_add_assistant_message(tui, response.data);
+                            // Streamed text includes tool-call rounds; keep the reply
+                            tui_chat_replace_last(tui, "assistant", response.data);
                             free((void*)response.data);
                         } else {
-                            tui_chat_add_system_message(tui, "Error: Failed to get response");
+                            tui_chat_replace_last(tui, "system", "Error: Failed to get response");
                         }
                     } else {
                         tui_chat_add_system_message(tui, "Error: No active session");
@@ -911,6 +940,11 @@ static uint32_t utf8_char_count(const char* str, uint32_t len) {
     uint32_t count = 0;
     uint32_t i = 0;
     while (i < len) {
+        // An ASCII run is one character a byte
+        uint32_t run = (uint32_t)text_scan_non_ascii(str + i, len - i);
+        count += run;
+        i += run;
+        if (i >= len) break;
         i += utf8_char_len(str, i);
         count++;
     }
@@ -1061,31 +1095,8 @@ const char* tui_history_next(tui_t* tui) {
 static void tui_chat_add_message_internal(tui_t* tui, const char* sender, const char* text) {
     if (!tui || !text) return;
 
-    tui_message_t* msg = calloc(1, sizeof(tui_message_t));
-    if (!msg) return;
-
-    msg->sender = strdup(sender);
-    msg->text = strdup(text);
-    msg->timestamp = 0; // TODO: get actual timestamp
-    msg->next = NULL;
-
-    // Add to linked list
-    if (tui->messages_tail) {
-        tui->messages_tail->next = msg;
-    } else {
-        tui->messages = msg;
-    }
-    tui->messages_tail = msg;
-    tui->message_count++;
-
-    // Limit message count to prevent memory issues
-    if (tui->message_count > 1000) {
-        tui_message_t* old = tui->messages;
-        tui->messages = old->next;
-        free(old->text);
-        free(old->sender);
-        free(old);
-        tui->message_count--;
+    if (tui_scrollback_push(&tui->scrollback, sender, text) == ERR_OK) {
+        tui->needs_redraw = true;
     }
 }
 
@@ -1100,3 +1111,29 @@ void tui_chat_add_user_message(tui_t* tui, const char* text) {
 void tui_chat_add_assistant_message(tui_t* tui, const char* text) {
     tui_chat_add_message_internal(tui, "assistant", text);
 }
+
+void tui_chat_append_text(tui_t* tui, const char* text, size_t len) {
+    if (!tui || !text || len == 0) return;
+
+    if (tui_scrollback_append(&tui->scrollback, text, len) == ERR_OK) {
+        tui->needs_redraw = true;
+    }
+}
+
+static void tui_chat_replace_last(tui_t* tui, const char* sender, const char* text) {
+    if (tui_scrollback_replace_last(&tui->scrollback, sender, text) == ERR_OK) {
+        tui->needs_redraw = true;
+    }
+}
+
+void tui_chat_scroll_up(tui_t* tui, uint32_t lines) {
+    if (!tui) return;
+    tui_scrollback_scroll_up(&tui->scrollback, lines);
+    tui->needs_redraw = true;
+}
+
+void tui_chat_scroll_down(tui_t* tui, uint32_t lines) {
+    if (!tui) return;
+    tui_scrollback_scroll_down(&tui->scrollback, lines);
+    tui->needs_redraw = true;
+}
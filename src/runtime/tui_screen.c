@@ -0,0 +1,475 @@
+// tui_screen.c - Double-buffered cell grid for the terminal UI
+// SPDX-License-Identifier: MIT
+
+#include "runtime/tui_screen.h"
+#include "core/metrics.h"
+#include "core/alloc.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct tui_screen_t {
+    uint16_t width;
+    uint16_t height;
+    tui_cell_t* front;         // What the terminal shows
+    tui_cell_t* back;          // Frame being drawn
+    bool front_valid;          // false = repaint everything
+
+    // Pen
+    uint16_t x, y;
+    uint16_t fg, bg;
+    uint8_t attr;
+
+    // Cursor after the frame
+    uint16_t cursor_x, cursor_y;
+    bool cursor_visible;
+    bool terminal_cursor_visible;
+    bool cursor_parked;        // Terminal cursor known to be at cursor_x/y
+
+    int fd;
+    char* out;
+    size_t out_len;
+    size_t out_capacity;
+
+    uint32_t frame_interval_ms;
+    uint64_t last_flush_us;
+    tui_screen_stats_t stats;
+};
+
+static const tui_cell_t BLANK_CELL = { .glyph = " ", .len = 1, .fg = TUI_COLOR_DEFAULT, .bg = TUI_COLOR_DEFAULT };
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+// Both cell buffers, as charged to ALLOC_TAG_TUI
+static size_t screen_cell_bytes(uint16_t width, uint16_t height) {
+    size_t count = (size_t)width * height;
+    return 2 * (count ? count : 1) * sizeof(tui_cell_t);
+}
+
+static err_t screen_alloc_cells(tui_screen_t* screen, uint16_t width, uint16_t height) {
+    size_t count = (size_t)width * height;
+    tui_cell_t* front = malloc((count ? count : 1) * sizeof(tui_cell_t));
+    tui_cell_t* back = malloc((count ? count : 1) * sizeof(tui_cell_t));
+    if (!front || !back) {
+        free(front);
+        free(back);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    if (screen->front) alloc_tag_sub(ALLOC_TAG_TUI, screen_cell_bytes(screen->width, screen->height));
+    alloc_tag_add(ALLOC_TAG_TUI, screen_cell_bytes(width, height));
+    free(screen->front);
+    free(screen->back);
+    screen->front = front;
+    screen->back = back;
+    screen->width = width;
+    screen->height = height;
+    screen->front_valid = false;
+    tui_screen_clear(screen);
+    return ERR_OK;
+}
+
+err_t tui_screen_create(uint16_t width, uint16_t height, int fd, tui_screen_t** out_screen) {
+    if (!out_screen || fd < 0) return ERR_INVALID_ARGUMENT;
+
+    tui_screen_t* screen = calloc(1, sizeof(tui_screen_t));
+    if (!screen) return ERR_OUT_OF_MEMORY;
+
+    screen->fd = fd;
+    screen->fg = TUI_COLOR_DEFAULT;
+    screen->bg = TUI_COLOR_DEFAULT;
+    // Whoever owns the terminal decides; assume it is showing
+    screen->terminal_cursor_visible = true;
+
+    err_t err = screen_alloc_cells(screen, width, height);
+    if (err != ERR_OK) {
+        free(screen);
+        return err;
+    }
+
+    *out_screen = screen;
+    return ERR_OK;
+}
+
+void tui_screen_free(tui_screen_t* screen) {
+    if (!screen) return;
+    alloc_tag_sub(ALLOC_TAG_TUI, screen_cell_bytes(screen->width, screen->height) + screen->out_capacity);
+    free(screen->front);
+    free(screen->back);
+    free(screen->out);
+    free(screen);
+}
+
+err_t tui_screen_resize(tui_screen_t* screen, uint16_t width, uint16_t height) {
+    if (!screen) return ERR_INVALID_ARGUMENT;
+    if (width == screen->width && height == screen->height) {
+        screen->front_valid = false;
+        return ERR_OK;
+    }
+    return screen_alloc_cells(screen, width, height);
+}
+
+void tui_screen_invalidate(tui_screen_t* screen) {
+    if (screen) screen->front_valid = false;
+}
+
+void tui_screen_get_size(const tui_screen_t* screen, uint16_t* out_width, uint16_t* out_height) {
+    if (out_width) *out_width = screen ? screen->width : 0;
+    if (out_height) *out_height = screen ? screen->height : 0;
+}
+
+// ============================================================================
+// Drawing
+// ============================================================================
+
+void tui_screen_clear(tui_screen_t* screen) {
+    if (!screen) return;
+    size_t count = (size_t)screen->width * screen->height;
+    for (size_t i = 0; i < count; i++) {
+        screen->back[i] = BLANK_CELL;
+    }
+    screen->x = 0;
+    screen->y = 0;
+    tui_screen_reset_style(screen);
+}
+
+void tui_screen_move(tui_screen_t* screen, uint16_t x, uint16_t y) {
+    if (!screen) return;
+    screen->x = x;
+    screen->y = y;
+}
+
+void tui_screen_set_style(tui_screen_t* screen, uint16_t fg, uint16_t bg, uint8_t attr) {
+    if (!screen) return;
+    screen->fg = fg;
+    screen->bg = bg;
+    screen->attr = attr;
+}
+
+void tui_screen_reset_style(tui_screen_t* screen) {
+    tui_screen_set_style(screen, TUI_COLOR_DEFAULT, TUI_COLOR_DEFAULT, 0);
+}
+
+// Length of the UTF-8 sequence at text, 1 for a byte that can't start one
+static uint32_t glyph_decode(const char* text, size_t len, uint32_t* out_codepoint) {
+    unsigned char c = (unsigned char)text[0];
+    uint32_t n = (c & 0x80) == 0 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if (n == 0 || n > len) {
+        *out_codepoint = 0xFFFD;
+        return 1;
+    }
+
+    uint32_t cp = n == 1 ? c : (uint32_t)(c & (0x7F >> n));
+    for (uint32_t i = 1; i < n; i++) {
+        unsigned char cc = (unsigned char)text[i];
+        if ((cc & 0xC0) != 0x80) {
+            *out_codepoint = 0xFFFD;
+            return 1;
+        }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    *out_codepoint = cp;
+    return n;
+}
+
+// East Asian wide and emoji ranges take two columns
+static bool glyph_is_wide(uint32_t cp) {
+    return (cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF && cp != 0x303F) ||
+           (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+           (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+           (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) ||
+           (cp >= 0x1F900 && cp <= 0x1F9FF) || (cp >= 0x20000 && cp <= 0x3FFFD);
+}
+
+uint32_t tui_glyph_measure(const char* text, size_t len, uint32_t* out_columns) {
+    if (!text || len == 0) {
+        if (out_columns) *out_columns = 0;
+        return 0;
+    }
+    uint32_t cp;
+    uint32_t n = glyph_decode(text, len, &cp);
+    if (out_columns) *out_columns = glyph_is_wide(cp) ? 2 : 1;
+    return n;
+}
+
+// Overwrite one cell, blanking what's left of a wide glyph it cuts through
+static void cell_store(tui_screen_t* screen, uint16_t x, const tui_cell_t* cell) {
+    tui_cell_t* row = &screen->back[(size_t)screen->y * screen->width];
+    if (row[x].len == 0 && x > 0) {
+        row[x - 1] = BLANK_CELL;
+    }
+    if (x + 1 < screen->width && row[x + 1].len == 0) {
+        row[x + 1] = BLANK_CELL;
+    }
+    row[x] = *cell;
+}
+
+void tui_screen_put(tui_screen_t* screen, const char* text, size_t len) {
+    if (!screen || !text) return;
+
+    size_t pos = 0;
+    while (pos < len && screen->y < screen->height && screen->x < screen->width) {
+        uint32_t cp;
+        uint32_t n = glyph_decode(text + pos, len - pos, &cp);
+        tui_cell_t cell = { .len = (uint8_t)n, .attr = screen->attr, .fg = screen->fg, .bg = screen->bg };
+        if (cp < 0x20 || cp == 0x7F || cp == 0xFFFD) {
+            cell.glyph[0] = cp == 0xFFFD ? '?' : ' ';
+            cell.len = 1;
+        } else {
+            memcpy(cell.glyph, text + pos, n);
+        }
+        pos += n;
+
+        bool wide = glyph_is_wide(cp);
+        if (wide && screen->x + 1 >= screen->width) {
+            // Half a glyph would be worse than none
+            cell.glyph[0] = ' ';
+            cell.len = 1;
+            wide = false;
+        }
+
+        cell_store(screen, screen->x, &cell);
+        screen->x++;
+        if (wide) {
+            tui_cell_t half = cell;
+            half.len = 0;
+            cell_store(screen, screen->x, &half);
+            screen->x++;
+        }
+    }
+}
+
+void tui_screen_puts(tui_screen_t* screen, const char* text) {
+    if (text) tui_screen_put(screen, text, strlen(text));
+}
+
+void tui_screen_printf(tui_screen_t* screen, const char* fmt, ...) {
+    if (!screen || !fmt) return;
+
+    char buffer[1024];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+
+    // A line never holds more than this anyway
+    tui_screen_put(screen, buffer, (size_t)n < sizeof(buffer) ? (size_t)n : sizeof(buffer) - 1);
+}
+
+void tui_screen_set_cursor(tui_screen_t* screen, uint16_t x, uint16_t y, bool visible) {
+    if (!screen) return;
+    if (x != screen->cursor_x || y != screen->cursor_y) screen->cursor_parked = false;
+    screen->cursor_x = x;
+    screen->cursor_y = y;
+    screen->cursor_visible = visible;
+}
+
+const tui_cell_t* tui_screen_cell(const tui_screen_t* screen, uint16_t x, uint16_t y) {
+    if (!screen || x >= screen->width || y >= screen->height) return NULL;
+    return &screen->back[(size_t)y * screen->width + x];
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+void tui_screen_set_frame_interval(tui_screen_t* screen, uint32_t interval_ms) {
+    if (screen) screen->frame_interval_ms = interval_ms;
+}
+
+int tui_screen_frame_wait_ms(const tui_screen_t* screen) {
+    if (!screen || screen->frame_interval_ms == 0 || screen->last_flush_us == 0) return 0;
+
+    uint64_t elapsed_ms = (metrics_now_us() - screen->last_flush_us) / 1000;
+    return elapsed_ms >= screen->frame_interval_ms ? 0 : (int)(screen->frame_interval_ms - elapsed_ms);
+}
+
+bool tui_screen_frame_due(const tui_screen_t* screen) {
+    return tui_screen_frame_wait_ms(screen) == 0;
+}
+
+static bool out_reserve(tui_screen_t* screen, size_t extra) {
+    if (screen->out_len + extra <= screen->out_capacity) return true;
+
+    size_t capacity = screen->out_capacity ? screen->out_capacity : 4096;
+    while (capacity < screen->out_len + extra) capacity *= 2;
+    char* out = realloc(screen->out, capacity);
+    if (!out) return false;
+    alloc_tag_add(ALLOC_TAG_TUI, capacity - screen->out_capacity);
+    screen->out = out;
+    screen->out_capacity = capacity;
+    return true;
+}
+
+static bool out_append(tui_screen_t* screen, const char* data, size_t len) {
+    if (!out_reserve(screen, len)) return false;
+    memcpy(screen->out + screen->out_len, data, len);
+    screen->out_len += len;
+    return true;
+}
+
+__attribute__((format(printf, 2, 3)))
+static bool out_printf(tui_screen_t* screen, const char* fmt, ...) {
+    char buffer[64];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return n > 0 && (size_t)n < sizeof(buffer) && out_append(screen, buffer, (size_t)n);
+}
+
+// What the terminal is known to be showing while a frame is written
+typedef struct term_state_t {
+    int x, y;                  // -1 = unknown
+    uint16_t fg, bg;
+    uint8_t attr;
+} term_state_t;
+
+static bool emit_move(tui_screen_t* screen, term_state_t* term, uint16_t x, uint16_t y) {
+    if (term->x == x && term->y == y) return true;
+    bool ok = x == 0 ? out_printf(screen, "\033[%uH", (unsigned)y + 1)
+                     : out_printf(screen, "\033[%u;%uH", (unsigned)y + 1, (unsigned)x + 1);
+    term->x = x;
+    term->y = y;
+    return ok;
+}
+
+// One SGR sequence, starting from a reset, whenever the style changes
+static bool emit_style(tui_screen_t* screen, term_state_t* term, const tui_cell_t* cell) {
+    if (term->fg == cell->fg && term->bg == cell->bg && term->attr == cell->attr) return true;
+
+    char sgr[64] = "\033[0";
+    size_t len = 3;
+    static const char* const attr_codes[] = { ";1", ";2", ";3", ";4", ";7" };
+    for (int i = 0; i < 5; i++) {
+        if (cell->attr & (1 << i)) {
+            memcpy(sgr + len, attr_codes[i], 2);
+            len += 2;
+        }
+    }
+    if (cell->fg != TUI_COLOR_DEFAULT) len += (size_t)snprintf(sgr + len, sizeof(sgr) - len, ";38;5;%u", cell->fg);
+    if (cell->bg != TUI_COLOR_DEFAULT) len += (size_t)snprintf(sgr + len, sizeof(sgr) - len, ";48;5;%u", cell->bg);
+    sgr[len++] = 'm';
+
+    term->fg = cell->fg;
+    term->bg = cell->bg;
+    term->attr = cell->attr;
+    return out_append(screen, sgr, len);
+}
+
+static bool emit_row(tui_screen_t* screen, term_state_t* term, uint16_t y, bool full) {
+    const tui_cell_t* back = &screen->back[(size_t)y * screen->width];
+    const tui_cell_t* front = &screen->front[(size_t)y * screen->width];
+    uint16_t width = screen->width;
+
+    // Span to repaint: the changed cells, or after a clear whatever isn't blank
+    int first = -1, last = -1;
+    for (uint16_t x = 0; x < width; x++) {
+        bool changed = full ? memcmp(&back[x], &BLANK_CELL, sizeof(tui_cell_t)) != 0
+                            : memcmp(&back[x], &front[x], sizeof(tui_cell_t)) != 0;
+        if (!changed) continue;
+        if (first < 0) first = x;
+        last = x;
+    }
+    if (first < 0) return true;
+
+    // Never start or stop in the middle of a wide glyph
+    if (back[first].len == 0 && first > 0) first--;
+    if (last + 1 < width && back[last + 1].len == 0) last++;
+
+    if (!emit_move(screen, term, (uint16_t)first, y)) return false;
+    for (int x = first; x <= last; x++) {
+        const tui_cell_t* cell = &back[x];
+        if (cell->len == 0) continue;    // Drawn with the glyph before it
+
+        bool wide = x + 1 < width && back[x + 1].len == 0;
+        if (!emit_style(screen, term, cell) || !out_append(screen, cell->glyph, cell->len)) return false;
+        term->x += wide ? 2 : 1;
+    }
+    // In the last column the terminal holds a pending wrap; don't guess
+    if (term->x >= width) term->x = -1;
+
+    screen->stats.rows_painted++;
+    return true;
+}
+
+static err_t out_write(tui_screen_t* screen) {
+    size_t written = 0;
+    while (written < screen->out_len) {
+        ssize_t n = write(screen->fd, screen->out + written, screen->out_len - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return ERR_IO;
+        }
+        written += (size_t)n;
+    }
+    screen->stats.bytes_written += written;
+    return ERR_OK;
+}
+
+err_t tui_screen_flush(tui_screen_t* screen) {
+    if (!screen) return ERR_INVALID_ARGUMENT;
+
+    // Every frame ends on the default style; a full one resets to it first
+    screen->out_len = 0;
+    term_state_t term = { .x = -1, .y = -1, .fg = TUI_COLOR_DEFAULT, .bg = TUI_COLOR_DEFAULT };
+    bool full = !screen->front_valid;
+    bool ok = true;
+
+    if (full) {
+        // Cleared to the default colors, which blank cells already match
+        ok = out_append(screen, "\033[0m\033[2J", 8);
+    }
+
+    size_t row_bytes = (size_t)screen->width * sizeof(tui_cell_t);
+    for (uint16_t y = 0; ok && y < screen->height; y++) {
+        const tui_cell_t* back = &screen->back[(size_t)y * screen->width];
+        const tui_cell_t* front = &screen->front[(size_t)y * screen->width];
+        if (!full && memcmp(back, front, row_bytes) == 0) continue;
+        ok = emit_row(screen, &term, y, full);
+    }
+
+    if (ok && screen->out_len > 0) {
+        if (term.fg != TUI_COLOR_DEFAULT || term.bg != TUI_COLOR_DEFAULT || term.attr) {
+            ok = out_append(screen, "\033[0m", 4);
+        }
+        screen->cursor_parked = false;
+    }
+    // The cursor only matters when it shows
+    if (ok && screen->cursor_visible && !screen->cursor_parked) {
+        ok = emit_move(screen, &term, screen->cursor_x, screen->cursor_y);
+        screen->cursor_parked = true;
+    }
+    if (ok && screen->cursor_visible != screen->terminal_cursor_visible) {
+        ok = out_append(screen, screen->cursor_visible ? "\033[?25h" : "\033[?25l", 6);
+        screen->terminal_cursor_visible = screen->cursor_visible;
+    }
+    if (!ok) return ERR_OUT_OF_MEMORY;
+
+    if (screen->out_len > 0) {
+        err_t err = out_write(screen);
+        if (err != ERR_OK) {
+            // Unknown what made it out
+            screen->front_valid = false;
+            return err;
+        }
+        screen->stats.frames++;
+    }
+
+    memcpy(screen->front, screen->back, (size_t)screen->width * screen->height * sizeof(tui_cell_t));
+    screen->front_valid = true;
+    screen->last_flush_us = metrics_now_us();
+    return ERR_OK;
+}
+
+void tui_screen_get_stats(const tui_screen_t* screen, tui_screen_stats_t* out_stats) {
+    if (!screen || !out_stats) return;
+    *out_stats = screen->stats;
+}
@@ -0,0 +1,338 @@
+// tui_scrollback.c - Chat history with cached line wrapping for the TUI
+// SPDX-License-Identifier: MIT
+
+#include "runtime/tui_scrollback.h"
+#include "runtime/tui_screen.h"
+#include "core/alloc.h"
+#include "utils/text_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Width until the panel sets one
+#define SCROLLBACK_DEFAULT_WIDTH 80
+
+// ============================================================================
+// Wrapping
+// ============================================================================
+
+static uint16_t text_columns(const char* text) {
+    size_t len = strlen(text);
+    // ASCII takes a column a byte
+    size_t pos = text_scan_non_ascii(text, len);
+    uint32_t columns = pos > UINT16_MAX ? UINT16_MAX : (uint32_t)pos;
+    while (pos < len) {
+        uint32_t width;
+        pos += tui_glyph_measure(text + pos, len - pos, &width);
+        columns += width;
+    }
+    return columns > UINT16_MAX ? UINT16_MAX : (uint16_t)columns;
+}
+
+static bool message_add_line(tui_message_t* msg, uint32_t start) {
+    if (msg->line_count == msg->line_capacity) {
+        uint32_t capacity = msg->line_capacity ? msg->line_capacity * 2 : 4;
+        uint32_t* starts = realloc(msg->line_starts, capacity * sizeof(uint32_t));
+        if (!starts) return false;
+        msg->line_starts = starts;
+        msg->line_capacity = capacity;
+    }
+    msg->line_starts[msg->line_count++] = start;
+    return true;
+}
+
+// Rewrap from line from_line on, keeping the lines before it. Lines break
+// at the last space that fits, mid-word only when a word is longer than
+// the line, and always at '\n'.
+static err_t message_wrap(tui_message_t* msg, uint32_t from_line, uint16_t width) {
+    uint32_t pos = from_line < msg->line_count ? msg->line_starts[from_line] : 0;
+    msg->line_count = from_line < msg->line_count ? from_line : 0;
+    uint32_t avail = width > msg->label_width ? (uint32_t)(width - msg->label_width) : 1;
+    const char* text = msg->text;
+    // [ascii_start, ascii_end) is known ASCII, a column a byte; lines can
+    // restart before the end of it, so it outlives one line
+    uint32_t ascii_start = 0, ascii_end = 0;
+
+    for (;;) {
+        if (!message_add_line(msg, pos)) return ERR_OUT_OF_MEMORY;
+
+        uint32_t columns = 0, space_break = 0, i = pos;
+        uint32_t next = msg->text_len;
+        bool more = false;
+        while (i < msg->text_len) {
+            if (text[i] == '\n') {
+                next = i + 1;
+                more = true;
+                break;
+            }
+            if (i < ascii_start || i >= ascii_end) {
+                ascii_start = i;
+                ascii_end = i + (uint32_t)text_scan_non_ascii(text + i, msg->text_len - i);
+            }
+            uint32_t glyph_columns = 1, n = 1;
+            if (i >= ascii_end) n = tui_glyph_measure(text + i, msg->text_len - i, &glyph_columns);
+            if (columns + glyph_columns > avail && i > pos) {
+                next = space_break > pos ? space_break : i;
+                more = next < msg->text_len;
+                break;
+            }
+            if (text[i] == ' ') space_break = i + 1;
+            columns += glyph_columns;
+            i += n;
+        }
+        if (!more) return ERR_OK;
+        pos = next;
+    }
+}
+
+// ============================================================================
+// Ring
+// ============================================================================
+
+err_t tui_scrollback_init(tui_scrollback_t* scrollback, uint32_t max_messages) {
+    if (!scrollback) return ERR_INVALID_ARGUMENT;
+
+    memset(scrollback, 0, sizeof(*scrollback));
+    scrollback->capacity = max_messages ? max_messages : TUI_SCROLLBACK_MAX_MESSAGES;
+    scrollback->ring = calloc(scrollback->capacity, sizeof(tui_message_t*));
+    if (!scrollback->ring) return ERR_OUT_OF_MEMORY;
+    alloc_tag_add(ALLOC_TAG_TUI, scrollback->capacity * sizeof(tui_message_t*));
+    scrollback->width = SCROLLBACK_DEFAULT_WIDTH;
+    return ERR_OK;
+}
+
+// Charge the message's current size to its tag after any change
+static void message_account(tui_message_t* msg) {
+    size_t bytes = sizeof(tui_message_t) + msg->line_capacity * sizeof(uint32_t);
+    if (msg->text) bytes += msg->text_len + 1;
+    if (msg->sender) bytes += strlen(msg->sender) + 1;
+    if (msg->label) bytes += strlen(msg->label) + 1;
+    alloc_tag_add(ALLOC_TAG_TUI, bytes);
+    alloc_tag_sub(ALLOC_TAG_TUI, msg->accounted);
+    msg->accounted = bytes;
+}
+
+static void message_free(tui_message_t* msg) {
+    if (!msg) return;
+    alloc_tag_sub(ALLOC_TAG_TUI, msg->accounted);
+    free(msg->text);
+    free(msg->sender);
+    free(msg->label);
+    free(msg->line_starts);
+    free(msg);
+}
+
+void tui_scrollback_free(tui_scrollback_t* scrollback) {
+    if (!scrollback || !scrollback->ring) return;
+    for (uint32_t i = 0; i < scrollback->count; i++) {
+        message_free(tui_scrollback_at(scrollback, i));
+    }
+    alloc_tag_sub(ALLOC_TAG_TUI, scrollback->capacity * sizeof(tui_message_t*));
+    free(scrollback->ring);
+    memset(scrollback, 0, sizeof(*scrollback));
+}
+
+tui_message_t* tui_scrollback_at(const tui_scrollback_t* scrollback, uint32_t index) {
+    if (!scrollback || index >= scrollback->count) return NULL;
+    return scrollback->ring[(scrollback->head + index) % scrollback->capacity];
+}
+
+tui_message_t* tui_scrollback_last(const tui_scrollback_t* scrollback) {
+    return scrollback && scrollback->count ? tui_scrollback_at(scrollback, scrollback->count - 1) : NULL;
+}
+
+static uint64_t first_line(const tui_scrollback_t* scrollback) {
+    tui_message_t* oldest = tui_scrollback_at(scrollback, 0);
+    return oldest ? oldest->first_line : scrollback->end_line;
+}
+
+uint64_t tui_scrollback_line_count(const tui_scrollback_t* scrollback) {
+    return scrollback ? scrollback->end_line - first_line(scrollback) : 0;
+}
+
+// The last message's line count moved from old_count
+static void last_lines_changed(tui_scrollback_t* scrollback, uint32_t old_count) {
+    tui_message_t* last = tui_scrollback_last(scrollback);
+    scrollback->end_line = last->first_line + last->line_count;
+    if (scrollback->scroll > 0 && last->line_count > old_count) {
+        scrollback->scroll += last->line_count - old_count;
+    }
+}
+
+static char* make_label(const char* sender) {
+    if (strcmp(sender, "user") == 0) return strdup("[You]: ");
+    if (strcmp(sender, "assistant") == 0) return strdup("[AI]: ");
+
+    size_t size = strlen(sender) + sizeof("[]: ");
+    char* label = malloc(size);
+    if (label) snprintf(label, size, "[%s]: ", sender);
+    return label;
+}
+
+static err_t message_set(tui_message_t* msg, const char* sender, const char* text) {
+    char* new_sender = strdup(sender);
+    char* new_label = make_label(sender);
+    char* new_text = strdup(text);
+    if (!new_sender || !new_label || !new_text) {
+        free(new_sender);
+        free(new_label);
+        free(new_text);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    free(msg->sender);
+    free(msg->label);
+    free(msg->text);
+    msg->sender = new_sender;
+    msg->label = new_label;
+    msg->label_width = text_columns(new_label);
+    msg->text = new_text;
+    msg->text_len = (uint32_t)strlen(new_text);
+    return ERR_OK;
+}
+
+err_t tui_scrollback_push(tui_scrollback_t* scrollback, const char* sender, const char* text) {
+    if (!scrollback || !scrollback->ring || !sender || !text) return ERR_INVALID_ARGUMENT;
+
+    tui_message_t* msg = calloc(1, sizeof(tui_message_t));
+    if (!msg) return ERR_OUT_OF_MEMORY;
+    err_t err = message_set(msg, sender, text);
+    if (err == ERR_OK) err = message_wrap(msg, 0, scrollback->width);
+    message_account(msg);
+    if (err != ERR_OK) {
+        message_free(msg);
+        return err;
+    }
+
+    if (scrollback->count == scrollback->capacity) {
+        message_free(scrollback->ring[scrollback->head]);
+        scrollback->head = (scrollback->head + 1) % scrollback->capacity;
+        scrollback->count--;
+    }
+
+    msg->first_line = scrollback->end_line;
+    scrollback->ring[(scrollback->head + scrollback->count) % scrollback->capacity] = msg;
+    scrollback->count++;
+    last_lines_changed(scrollback, 0);
+    return ERR_OK;
+}
+
+err_t tui_scrollback_append(tui_scrollback_t* scrollback, const char* text, size_t len) {
+    tui_message_t* msg = tui_scrollback_last(scrollback);
+    if (!msg || !text) return ERR_INVALID_ARGUMENT;
+    if (len == 0) return ERR_OK;
+
+    char* grown = realloc(msg->text, (size_t)msg->text_len + len + 1);
+    if (!grown) return ERR_OUT_OF_MEMORY;
+    memcpy(grown + msg->text_len, text, len);
+    grown[msg->text_len + len] = '\0';
+    msg->text = grown;
+    msg->text_len += (uint32_t)len;
+
+    // Earlier lines are full and stay as they are
+    uint32_t old_count = msg->line_count;
+    err_t err = message_wrap(msg, old_count ? old_count - 1 : 0, scrollback->width);
+    message_account(msg);
+    last_lines_changed(scrollback, old_count);
+    return err;
+}
+
+err_t tui_scrollback_replace_last(tui_scrollback_t* scrollback, const char* sender, const char* text) {
+    tui_message_t* msg = tui_scrollback_last(scrollback);
+    if (!msg || !sender || !text) return ERR_INVALID_ARGUMENT;
+
+    err_t err = message_set(msg, sender, text);
+    if (err != ERR_OK) return err;
+
+    uint32_t old_count = msg->line_count;
+    err = message_wrap(msg, 0, scrollback->width);
+    message_account(msg);
+    last_lines_changed(scrollback, old_count);
+    return err;
+}
+
+void tui_scrollback_set_width(tui_scrollback_t* scrollback, uint16_t width) {
+    if (!scrollback || width == 0 || width == scrollback->width) return;
+
+    scrollback->width = width;
+    uint64_t line = first_line(scrollback);
+    for (uint32_t i = 0; i < scrollback->count; i++) {
+        tui_message_t* msg = tui_scrollback_at(scrollback, i);
+        msg->first_line = line;
+        // On failure the message keeps the lines it got
+        message_wrap(msg, 0, width);
+        message_account(msg);
+        line += msg->line_count;
+    }
+    scrollback->end_line = line;
+}
+
+// ============================================================================
+// Scrolling
+// ============================================================================
+
+void tui_scrollback_scroll_up(tui_scrollback_t* scrollback, uint64_t lines) {
+    if (!scrollback) return;
+    uint64_t total = tui_scrollback_line_count(scrollback);
+    bool to_top = scrollback->scroll >= total || lines >= total - scrollback->scroll;
+    scrollback->scroll = to_top ? total : scrollback->scroll + lines;
+}
+
+void tui_scrollback_scroll_down(tui_scrollback_t* scrollback, uint64_t lines) {
+    if (!scrollback) return;
+    scrollback->scroll = lines >= scrollback->scroll ? 0 : scrollback->scroll - lines;
+}
+
+// Index of the message holding line
+static uint32_t message_for_line(const tui_scrollback_t* scrollback, uint64_t line) {
+    uint32_t lo = 0, hi = scrollback->count - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (tui_scrollback_at(scrollback, mid)->first_line <= line) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+static void line_text(const tui_message_t* msg, uint32_t line, tui_scrollback_line_t* out) {
+    uint32_t start = msg->line_starts[line];
+    uint32_t end = line + 1 < msg->line_count ? msg->line_starts[line + 1] : msg->text_len;
+    // Not the '\n' or the space the line broke at
+    while (end > start && (msg->text[end - 1] == '\n' || msg->text[end - 1] == ' ')) end--;
+
+    out->message = msg;
+    out->line = line;
+    out->text = msg->text + start;
+    out->len = end - start;
+}
+
+uint32_t tui_scrollback_window(tui_scrollback_t* scrollback, uint32_t rows,
+                               tui_scrollback_line_t* out_lines) {
+    if (!scrollback || !out_lines || rows == 0 || scrollback->count == 0) return 0;
+
+    // A view scrolled past the top stops at it
+    uint64_t total = tui_scrollback_line_count(scrollback);
+    uint64_t max_scroll = total > rows ? total - rows : 0;
+    if (scrollback->scroll > max_scroll) scrollback->scroll = max_scroll;
+
+    uint64_t bottom = scrollback->end_line - scrollback->scroll;
+    uint64_t base = first_line(scrollback);
+    uint64_t top = bottom - base > rows ? bottom - rows : base;
+
+    uint32_t filled = 0;
+    uint32_t index = message_for_line(scrollback, top);
+    uint32_t line = (uint32_t)(top - tui_scrollback_at(scrollback, index)->first_line);
+    while (filled < rows && index < scrollback->count) {
+        const tui_message_t* msg = tui_scrollback_at(scrollback, index);
+        for (; line < msg->line_count && filled < rows; line++) {
+            line_text(msg, line, &out_lines[filled++]);
+        }
+        index++;
+        line = 0;
+    }
+    return filled;
+}
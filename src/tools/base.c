@@ -2,8 +2,11 @@
 // SPDX-License-Identifier: MIT
 
 #include "core/tool.h"
+#include "core/metrics.h"
+#include "core/trace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 // Tool registry (similar to provider and memory registries)
 typedef struct {
@@ -11,79 +14,129 @@ typedef struct {
     const tool_vtable_t* vtable;
 } tool_backend_entry_t;
 
+// Filled on first use; tool_unregister holds the lock as well
 #define MAX_TOOL_BACKENDS 32
 static tool_backend_entry_t g_registry[MAX_TOOL_BACKENDS];
 static uint32_t g_backend_count = 0;
 static bool g_registry_initialized = false;
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
-err_t tool_registry_init(void) {
-    if (g_registry_initialized) return ERR_OK;
+// Caller holds g_registry_lock
+static err_t registry_add(const char* name, const tool_vtable_t* vtable) {
+    if (g_backend_count >= MAX_TOOL_BACKENDS) return ERR_OUT_OF_MEMORY;
 
-    memset(g_registry, 0, sizeof(g_registry));
-    g_backend_count = 0;
-    g_registry_initialized = true;
+    // Check for duplicates
+    for (uint32_t i = 0; i < g_backend_count; i++) {
+        if (strcmp(g_registry[i].name, name) == 0) {
+            return ERR_INVALID_ARGUMENT; // Already registered
+        }
+    }
 
-    // Register built-in tools
-    // These will be registered when their respective modules are implemented
-    tool_register("shell", shell_tool_get_vtable());
-    tool_register("file_read", file_read_tool_get_vtable());
-    tool_register("file_write", file_write_tool_get_vtable());
-    tool_register("memory_store", memory_store_tool_get_vtable());
-    tool_register("memory_recall", memory_recall_tool_get_vtable());
-    tool_register("memory_forget", memory_forget_tool_get_vtable());
+    g_registry[g_backend_count].name = name;
+    g_registry[g_backend_count].vtable = vtable;
+    g_backend_count++;
+
+    return ERR_OK;
+}
+
+static const tool_vtable_t* registry_lookup(const char* name) {
+    const tool_vtable_t* vtable = NULL;
+
+    pthread_mutex_lock(&g_registry_lock);
+    for (uint32_t i = 0; i < g_backend_count; i++) {
+        if (strcmp(g_registry[i].name, name) == 0) {
+            vtable = g_registry[i].vtable;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return vtable;
+}
+
+err_t tool_registry_init(void) {
+    if (__atomic_load_n(&g_registry_initialized, __ATOMIC_ACQUIRE)) return ERR_OK;
+
+    pthread_mutex_lock(&g_registry_lock);
+    if (!g_registry_initialized) {
+        memset(g_registry, 0, sizeof(g_registry));
+        g_backend_count = 0;
+
+        // Register built-in tools
+        registry_add("shell", shell_tool_get_vtable());
+        registry_add("file_read", file_read_tool_get_vtable());
+        registry_add("file_write", file_write_tool_get_vtable());
+        registry_add("memory_store", memory_store_tool_get_vtable());
+        registry_add("memory_recall", memory_recall_tool_get_vtable());
+        registry_add("memory_forget", memory_forget_tool_get_vtable());
+
+        __atomic_store_n(&g_registry_initialized, true, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_registry_lock);
 
     return ERR_OK;
 }
 
 void tool_registry_shutdown(void) {
+    pthread_mutex_lock(&g_registry_lock);
     memset(g_registry, 0, sizeof(g_registry));
     g_backend_count = 0;
-    g_registry_initialized = false;
+    __atomic_store_n(&g_registry_initialized, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_registry_lock);
 }
 
 err_t tool_register(const char* name, const tool_vtable_t* vtable) {
     if (!name || !vtable) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) tool_registry_init();
-    if (g_backend_count >= MAX_TOOL_BACKENDS) return ERR_OUT_OF_MEMORY;
+    tool_registry_init();
 
-    // Check for duplicates
+    pthread_mutex_lock(&g_registry_lock);
+    err_t err = registry_add(name, vtable);
+    pthread_mutex_unlock(&g_registry_lock);
+
+    return err;
+}
+
+err_t tool_unregister(const char* name) {
+    if (!name) return ERR_INVALID_ARGUMENT;
+
+    err_t err = ERR_NOT_FOUND;
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_backend_count; i++) {
         if (strcmp(g_registry[i].name, name) == 0) {
-            return ERR_INVALID_ARGUMENT; // Already registered
+            memmove(&g_registry[i], &g_registry[i + 1], (g_backend_count - i - 1) * sizeof(g_registry[0]));
+            g_backend_count--;
+            err = ERR_OK;
+            break;
         }
     }
+    pthread_mutex_unlock(&g_registry_lock);
 
-    g_registry[g_backend_count].name = name;
-    g_registry[g_backend_count].vtable = vtable;
-    g_backend_count++;
-
-    return ERR_OK;
+    return err;
 }
 
 err_t tool_create(const char* name, tool_t** out_tool) {
     if (!name || !out_tool) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) tool_registry_init();
+    tool_registry_init();
 
-    for (uint32_t i = 0; i < g_backend_count; i++) {
-        if (strcmp(g_registry[i].name, name) == 0) {
-            return g_registry[i].vtable->create(out_tool);
-        }
-    }
+    const tool_vtable_t* vtable = registry_lookup(name);
+    if (!vtable) return ERR_NOT_FOUND;
 
-    return ERR_NOT_FOUND;
+    return vtable->create(out_tool);
 }
 
 err_t tool_registry_list(const char*** out_names, uint32_t* out_count) {
     if (!out_names || !out_count) return ERR_INVALID_ARGUMENT;
-    if (!g_registry_initialized) tool_registry_init();
+    tool_registry_init();
 
     static const char* names[MAX_TOOL_BACKENDS];
+    pthread_mutex_lock(&g_registry_lock);
     for (uint32_t i = 0; i < g_backend_count; i++) {
         names[i] = g_registry[i].name;
     }
+    *out_count = g_backend_count;
+    pthread_mutex_unlock(&g_registry_lock);
 
     *out_names = names;
-    *out_count = g_backend_count;
 
     return ERR_OK;
 }
@@ -99,13 +152,27 @@ tool_t* tool_alloc(const tool_vtable_t* vtable) {
 
 void tool_free(tool_t* tool) {
     if (!tool) return;
-    if (tool->vtable && tool->vtable->destroy) {
+    // Tool destroy functions release impl_data and then call back here
+    if (tool->impl_data && tool->vtable && tool->vtable->destroy) {
         tool->vtable->destroy(tool);
     } else {
         free(tool);
     }
 }
 
+err_t tool_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
+    if (!tool || !tool->vtable || !tool->vtable->execute) return ERR_INVALID_ARGUMENT;
+
+    str_t name = tool->vtable->get_name ? tool->vtable->get_name() : STR_NULL;
+    TRACE_BEGIN(span, "tool.execute");
+    TRACE_DETAIL(span, name);
+    uint64_t start_us = metrics_now_us();
+    err_t err = tool->vtable->execute(tool, args, out_result);
+    TRACE_END(span);
+    metric_observe(metric_get(&METRIC_TOOL_DURATION, name, STR_NULL), metrics_now_us() - start_us);
+    return err;
+}
+
 // Result helpers
 tool_result_t tool_result_create(void) {
     return (tool_result_t){
@@ -155,7 +222,8 @@ tool_context_t tool_context_default(void) {
     return (tool_context_t){
         .user_data = NULL,
         .memory = NULL,
-        .workspace_dir = STR_NULL
+        .workspace_dir = STR_NULL,
+        .sandbox = NULL
     };
 }
 
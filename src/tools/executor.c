@@ -0,0 +1,267 @@
+// executor.c - Bounded worker pool for concurrent tool calls
+// SPDX-License-Identifier: MIT
+
+#include "core/tool.h"
+#include "core/trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+
+// A queued call. Owns a copy of its arguments so an abandoned task can
+// outlive the caller's job array.
+struct tool_task_t {
+    struct tool_task_t* next;
+    tool_t* tool;
+    str_t args;
+    tool_result_t result;
+    trace_context_t trace;     // Caller's trace, continued on the worker
+    struct timespec submitted;
+    err_t err;
+    bool done;
+    bool abandoned;            // Caller gave up waiting; worker frees it
+};
+
+struct tool_pool_t {
+    pthread_t* workers;
+    uint32_t worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;  // Queue became non-empty or pool is stopping
+    pthread_cond_t done_cond;  // Some task finished
+    tool_task_t* head;
+    tool_task_t* tail;
+    bool stopping;
+};
+
+static void task_free(tool_task_t* task) {
+    tool_result_free(&task->result);
+    free((void*)task->args.data);
+    free(task);
+}
+
+static tool_task_t* task_create(tool_t* tool, str_t args) {
+    tool_task_t* task = calloc(1, sizeof(tool_task_t));
+    if (!task) return NULL;
+    task->tool = tool;
+    task->trace = trace_context_current();
+    task->result = tool_result_create();
+    task->args = str_dup(args, NULL);
+    if (!str_empty(args) && !task->args.data) {
+        free(task);
+        return NULL;
+    }
+    clock_gettime(CLOCK_REALTIME, &task->submitted);
+    return task;
+}
+
+// Caller holds pool->lock
+static void task_enqueue(tool_pool_t* pool, tool_task_t* task) {
+    if (pool->tail) {
+        pool->tail->next = task;
+    } else {
+        pool->head = task;
+    }
+    pool->tail = task;
+}
+
+static struct timespec deadline_after(struct timespec from, uint32_t timeout_ms) {
+    from.tv_sec += timeout_ms / 1000;
+    from.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (from.tv_nsec >= 1000000000L) {
+        from.tv_sec++;
+        from.tv_nsec -= 1000000000L;
+    }
+    return from;
+}
+
+// Caller holds pool->lock. A finished task's outcome moves into job and
+// the task is freed; an unfinished one is left to the worker.
+static void task_settle(tool_task_t* task, tool_job_t* job) {
+    const str_t timeout_message = STR_LIT("Tool call timed out");
+    if (task->done) {
+        job->err = task->err;
+        job->result = task->result;
+        task->result = tool_result_create();
+        task_free(task);
+    } else {
+        task->abandoned = true;
+        job->err = ERR_TIMEOUT;
+        tool_result_set_error(&job->result, &timeout_message);
+    }
+}
+
+static void* worker_main(void* arg) {
+    tool_pool_t* pool = (tool_pool_t*)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && !pool->head) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (!pool->head) break;
+
+        tool_task_t* task = pool->head;
+        pool->head = task->next;
+        if (!pool->head) pool->tail = NULL;
+
+        // Timed out before it even started
+        if (task->abandoned) {
+            task_free(task);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        trace_context_t saved;
+        trace_context_enter(&task->trace, &saved);
+        task->err = tool_execute(task->tool, &task->args, &task->result);
+        trace_context_leave(&saved);
+
+        pthread_mutex_lock(&pool->lock);
+        task->done = true;
+        if (task->abandoned) {
+            task_free(task);
+        } else {
+            pthread_cond_broadcast(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+err_t tool_pool_create(uint32_t workers, tool_pool_t** out_pool) {
+    if (workers == 0 || !out_pool) return ERR_INVALID_ARGUMENT;
+
+    tool_pool_t* pool = calloc(1, sizeof(tool_pool_t));
+    if (!pool) return ERR_OUT_OF_MEMORY;
+
+    pool->workers = calloc(workers, sizeof(pthread_t));
+    if (!pool->workers) {
+        free(pool);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (uint32_t i = 0; i < workers; i++) {
+        if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0) break;
+        pool->worker_count++;
+    }
+
+    if (pool->worker_count == 0) {
+        tool_pool_destroy(pool);
+        return ERR_RUNTIME;
+    }
+
+    *out_pool = pool;
+    return ERR_OK;
+}
+
+void tool_pool_destroy(tool_pool_t* pool) {
+    if (!pool) return;
+
+    // Workers drain the queue (including abandoned tasks) before exiting
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+err_t tool_pool_run(tool_pool_t* pool, tool_job_t* jobs, uint32_t count, uint32_t timeout_ms) {
+    if (!pool || (!jobs && count > 0)) return ERR_INVALID_ARGUMENT;
+    if (count == 0) return ERR_OK;
+
+    tool_task_t** tasks = calloc(count, sizeof(tool_task_t*));
+    if (!tasks) return ERR_OUT_OF_MEMORY;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!jobs[i].tool) continue;
+        tasks[i] = task_create(jobs[i].tool, jobs[i].args);
+        if (!tasks[i]) jobs[i].err = ERR_OUT_OF_MEMORY;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    struct timespec deadline = deadline_after(now, timeout_ms);
+
+    pthread_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < count; i++) {
+        if (tasks[i]) task_enqueue(pool, tasks[i]);
+    }
+    pthread_cond_broadcast(&pool->work_cond);
+
+    // Wait for every task, or until the deadline passes
+    bool timed_out = false;
+    for (;;) {
+        bool all_done = true;
+        for (uint32_t i = 0; i < count && all_done; i++) {
+            if (tasks[i] && !tasks[i]->done) all_done = false;
+        }
+        if (all_done || timed_out) break;
+
+        if (timeout_ms == 0) {
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        } else if (pthread_cond_timedwait(&pool->done_cond, &pool->lock, &deadline) == ETIMEDOUT) {
+            timed_out = true;
+        }
+    }
+
+    // Hand finished results over in the original order; abandon the rest
+    for (uint32_t i = 0; i < count; i++) {
+        if (tasks[i]) task_settle(tasks[i], &jobs[i]);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(tasks);
+    return ERR_OK;
+}
+
+err_t tool_pool_submit(tool_pool_t* pool, tool_t* tool, str_t args, tool_task_t** out_task) {
+    if (!pool || !tool || !out_task) return ERR_INVALID_ARGUMENT;
+
+    tool_task_t* task = task_create(tool, args);
+    if (!task) return ERR_OUT_OF_MEMORY;
+
+    pthread_mutex_lock(&pool->lock);
+    task_enqueue(pool, task);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    *out_task = task;
+    return ERR_OK;
+}
+
+void tool_pool_collect(tool_pool_t* pool, tool_task_t* task, uint32_t timeout_ms, tool_job_t* job) {
+    struct timespec deadline = deadline_after(task->submitted, timeout_ms);
+
+    pthread_mutex_lock(&pool->lock);
+    while (!task->done) {
+        if (timeout_ms == 0) {
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        } else if (pthread_cond_timedwait(&pool->done_cond, &pool->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    task_settle(task, job);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void tool_pool_discard(tool_pool_t* pool, tool_task_t* task) {
+    pthread_mutex_lock(&pool->lock);
+    if (task->done) task_free(task);
+    else task->abandoned = true;
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -10,13 +10,43 @@
 #include <unistd.h>
 #include <errno.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
+// Every FILE_READ_INDEX_STRIDE-th line start is recorded, so a line lookup
+// is one index probe plus at most STRIDE-1 memchr steps
+#define FILE_READ_INDEX_STRIDE 64
+#define FILE_READ_CACHE_SLOTS 8
+#define FILE_READ_DEFAULT_LINES 2000
+#define FILE_READ_DEFAULT_MATCHES 200
+
+// A read-only mapping, valid while the file keeps its identity and mtime
+typedef struct mapped_file_t {
+    char* path;
+    dev_t dev;
+    ino_t ino;
+    int64_t mtime_ns;
+    size_t size;
+    const char* data;           // NULL for an empty file
+    pthread_mutex_t index_lock;
+    size_t* line_index;         // Start of line k * FILE_READ_INDEX_STRIDE
+    size_t line_count;
+    bool indexed;
+    uint32_t refs;              // Readers using the mapping
+    uint64_t last_used;
+    bool stale;                 // Evicted; the last reader frees it
+} mapped_file_t;
+
 // File read tool instance data
 typedef struct file_read_tool_t {
     config_t* config;           // Configuration for path restrictions
     str_t workspace_dir;        // Working directory restriction
-    size_t max_file_size;       // Maximum file size to read (bytes)
+    size_t max_file_size;       // Whole-file limit and cap on returned bytes
+    pthread_mutex_t cache_lock;
+    mapped_file_t* cache[FILE_READ_CACHE_SLOTS];
+    uint64_t cache_clock;
 } file_read_tool_t;
 
 // Forward declarations for vtable
@@ -31,6 +61,7 @@ static err_t file_read_execute(tool_t* tool, const str_t* args, tool_result_t* o
 static str_t file_read_get_parameters_schema(void);
 static bool file_read_requires_memory(void);
 static bool file_read_allowed_in_autonomous(autonomy_level_t level);
+static bool file_read_is_pure(void);
 
 // VTable definition
 static const tool_vtable_t file_read_vtable = {
@@ -44,7 +75,8 @@ static const tool_vtable_t file_read_vtable = {
     .execute = file_read_execute,
     .get_parameters_schema = file_read_get_parameters_schema,
     .requires_memory = file_read_requires_memory,
-    .allowed_in_autonomous = file_read_allowed_in_autonomous
+    .allowed_in_autonomous = file_read_allowed_in_autonomous,
+    .is_pure = file_read_is_pure
 };
 
 // Get vtable
@@ -80,6 +112,7 @@ static err_t file_read_create(tool_t** out_tool) {
     file_read_data->config = NULL;
     file_read_data->workspace_dir = STR_NULL;
     file_read_data->max_file_size = 10 * 1024 * 1024; // 10 MB default limit
+    pthread_mutex_init(&file_read_data->cache_lock, NULL);
 
     tool->impl_data = file_read_data;
 
@@ -100,6 +133,8 @@ static void file_read_destroy(tool_t* tool) {
     // Free workspace directory string
     free((void*)file_read_data->workspace_dir.data);
 
+    pthread_mutex_destroy(&file_read_data->cache_lock);
+
     free(file_read_data);
     tool->impl_data = NULL;
 
@@ -129,10 +164,18 @@ static err_t file_read_init(tool_t* tool, const tool_context_t* context) {
     return ERR_OK;
 }
 
+static void cache_clear(file_read_tool_t* tool_data);
+
 static void file_read_cleanup(tool_t* tool) {
     if (!tool || !tool->impl_data || !tool->initialized) return;
 
-    // Nothing specific to cleanup for file read tool
+    file_read_tool_t* file_read_data = (file_read_tool_t*)tool->impl_data;
+
+    // Drop cached mappings
+    pthread_mutex_lock(&file_read_data->cache_lock);
+    cache_clear(file_read_data);
+    pthread_mutex_unlock(&file_read_data->cache_lock);
+
     tool->initialized = false;
 }
 
@@ -168,10 +211,307 @@ static bool is_path_safe(file_read_tool_t* tool_data, const char* path) {
     return true;
 }
 
-// Read file contents with safety checks
-static err_t read_file_contents(const char* path, size_t max_size, tool_result_t* out_result) {
-    FILE* file = NULL;
-    char* buffer = NULL;
+// ============================================================================
+// Mapped File Cache
+// ============================================================================
+
+static int64_t stat_mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static void mapped_file_free(mapped_file_t* mf) {
+    if (mf->data) munmap((void*)mf->data, mf->size);
+    pthread_mutex_destroy(&mf->index_lock);
+    free(mf->line_index);
+    free(mf->path);
+    free(mf);
+}
+
+static err_t mapped_file_open(const char* path, const struct stat* st, mapped_file_t** out_mf) {
+    mapped_file_t* mf = calloc(1, sizeof(mapped_file_t));
+    if (!mf) return ERR_OUT_OF_MEMORY;
+
+    mf->path = strdup(path);
+    if (!mf->path) {
+        free(mf);
+        return ERR_OUT_OF_MEMORY;
+    }
+    mf->dev = st->st_dev;
+    mf->ino = st->st_ino;
+    mf->mtime_ns = stat_mtime_ns(st);
+    mf->size = (size_t)st->st_size;
+    pthread_mutex_init(&mf->index_lock, NULL);
+
+    if (mf->size > 0) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        void* map = fd >= 0 ? mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if (fd >= 0) close(fd);
+        if (map == MAP_FAILED) {
+            mf->size = 0;
+            mapped_file_free(mf);
+            return ERR_IO;
+        }
+        mf->data = map;
+    }
+
+    *out_mf = mf;
+    return ERR_OK;
+}
+
+// Remove a slot; readers still holding the mapping free it on release
+static void cache_drop(file_read_tool_t* tool_data, uint32_t slot) {
+    mapped_file_t* mf = tool_data->cache[slot];
+    tool_data->cache[slot] = NULL;
+    mf->stale = true;
+    if (mf->refs == 0) mapped_file_free(mf);
+}
+
+static void cache_clear(file_read_tool_t* tool_data) {
+    for (uint32_t i = 0; i < FILE_READ_CACHE_SLOTS; i++) {
+        if (tool_data->cache[i]) cache_drop(tool_data, i);
+    }
+}
+
+// Mapping for path, reused while device, inode, size and mtime match
+static err_t mapped_file_acquire(file_read_tool_t* tool_data, const char* path,
+                                 const struct stat* st, mapped_file_t** out_mf) {
+    pthread_mutex_lock(&tool_data->cache_lock);
+
+    uint32_t free_slot = FILE_READ_CACHE_SLOTS;
+    for (uint32_t i = 0; i < FILE_READ_CACHE_SLOTS; i++) {
+        mapped_file_t* mf = tool_data->cache[i];
+        if (!mf) {
+            if (free_slot == FILE_READ_CACHE_SLOTS) free_slot = i;
+            continue;
+        }
+        if (strcmp(mf->path, path) != 0) continue;
+
+        if (mf->dev == st->st_dev && mf->ino == st->st_ino &&
+            mf->size == (size_t)st->st_size && mf->mtime_ns == stat_mtime_ns(st)) {
+            mf->refs++;
+            mf->last_used = ++tool_data->cache_clock;
+            pthread_mutex_unlock(&tool_data->cache_lock);
+            *out_mf = mf;
+            return ERR_OK;
+        }
+        cache_drop(tool_data, i);
+        if (free_slot == FILE_READ_CACHE_SLOTS) free_slot = i;
+    }
+
+    mapped_file_t* mf = NULL;
+    err_t err = mapped_file_open(path, st, &mf);
+    if (err != ERR_OK) {
+        pthread_mutex_unlock(&tool_data->cache_lock);
+        return err;
+    }
+
+    if (free_slot == FILE_READ_CACHE_SLOTS) {
+        free_slot = 0;
+        for (uint32_t i = 1; i < FILE_READ_CACHE_SLOTS; i++) {
+            if (tool_data->cache[i]->last_used < tool_data->cache[free_slot]->last_used) free_slot = i;
+        }
+        cache_drop(tool_data, free_slot);
+    }
+
+    mf->refs = 1;
+    mf->last_used = ++tool_data->cache_clock;
+    tool_data->cache[free_slot] = mf;
+    pthread_mutex_unlock(&tool_data->cache_lock);
+
+    *out_mf = mf;
+    return ERR_OK;
+}
+
+static void mapped_file_release(file_read_tool_t* tool_data, mapped_file_t* mf) {
+    pthread_mutex_lock(&tool_data->cache_lock);
+    mf->refs--;
+    if (mf->stale && mf->refs == 0) mapped_file_free(mf);
+    pthread_mutex_unlock(&tool_data->cache_lock);
+}
+
+// Build the sparse newline index once per mapping
+static err_t mapped_file_index(mapped_file_t* mf) {
+    pthread_mutex_lock(&mf->index_lock);
+    if (mf->indexed) {
+        pthread_mutex_unlock(&mf->index_lock);
+        return ERR_OK;
+    }
+
+    size_t capacity = 64;
+    size_t* index = malloc(capacity * sizeof(size_t));
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (index && pos < mf->size) {
+        if (count % FILE_READ_INDEX_STRIDE == 0) {
+            size_t slot = count / FILE_READ_INDEX_STRIDE;
+            if (slot == capacity) {
+                size_t* grown = realloc(index, capacity * 2 * sizeof(size_t));
+                if (!grown) {
+                    free(index);
+                    index = NULL;
+                    break;
+                }
+                index = grown;
+                capacity *= 2;
+            }
+            index[slot] = pos;
+        }
+        count++;
+
+        const char* nl = memchr(mf->data + pos, '\n', mf->size - pos);
+        if (!nl) break;
+        pos = (size_t)(nl - mf->data) + 1;
+    }
+
+    if (!index) {
+        pthread_mutex_unlock(&mf->index_lock);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    mf->line_index = index;
+    mf->line_count = count;
+    mf->indexed = true;
+    pthread_mutex_unlock(&mf->index_lock);
+    return ERR_OK;
+}
+
+// Offset just past the n-th newline at or after pos
+static size_t skip_lines(const char* data, size_t size, size_t pos, size_t n) {
+    while (n > 0 && pos < size) {
+        const char* nl = memchr(data + pos, '\n', size - pos);
+        if (!nl) return size;
+        pos = (size_t)(nl - data) + 1;
+        n--;
+    }
+    return pos;
+}
+
+// Start of 0-based line (requires the index)
+static size_t line_offset(const mapped_file_t* mf, size_t line) {
+    if (line >= mf->line_count) return mf->size;
+    size_t base = mf->line_index[line / FILE_READ_INDEX_STRIDE];
+    return skip_lines(mf->data, mf->size, base, line % FILE_READ_INDEX_STRIDE);
+}
+
+// Start of the last n lines, scanning backwards from the end
+static size_t tail_offset(const char* data, size_t size, size_t n) {
+    if (n == 0) return size;
+
+    size_t end = size;
+    if (end > 0 && data[end - 1] == '\n') end--;
+    while (end > 0) {
+        const char* nl = memrchr(data, '\n', end);
+        if (!nl) return 0;
+        if (--n == 0) return (size_t)(nl - data) + 1;
+        end = (size_t)(nl - data);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+typedef enum {
+    READ_WHOLE,
+    READ_LINES,
+    READ_BYTES,
+    READ_HEAD,
+    READ_TAIL,
+    READ_GREP
+} read_mode_t;
+
+typedef struct read_request_t {
+    read_mode_t mode;
+    size_t offset;             // 1-based line, or byte offset
+    size_t limit;              // Lines, bytes or matches
+    const char* pattern;       // READ_GREP substring
+} read_request_t;
+
+typedef struct read_buf_t {
+    char* data;
+    size_t len;
+    size_t cap;
+    size_t limit;
+    bool truncated;
+    bool failed;
+} read_buf_t;
+
+static void read_buf_append(read_buf_t* buf, const char* data, size_t len) {
+    if (buf->failed || buf->truncated) return;
+    if (buf->len + len > buf->limit) {
+        len = buf->limit - buf->len;
+        buf->truncated = true;
+    }
+    if (buf->len + len + 1 > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap < buf->len + len + 1) cap *= 2;
+        char* grown = realloc(buf->data, cap);
+        if (!grown) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+// Matching lines as "number:text", numbers counted incrementally
+static err_t grep_lines(const mapped_file_t* mf, const char* pattern, size_t max_matches,
+                        size_t max_output, tool_result_t* out_result) {
+    read_buf_t buf = { .limit = max_output };
+    size_t pattern_len = strlen(pattern);
+    size_t line_no = 1;
+    size_t counted_to = 0;
+    size_t pos = 0;
+    size_t matches = 0;
+
+    while (pattern_len > 0 && pos < mf->size && matches < max_matches && !buf.truncated) {
+        const char* hit = memmem(mf->data + pos, mf->size - pos, pattern, pattern_len);
+        if (!hit) break;
+
+        size_t at = (size_t)(hit - mf->data);
+        const char* prev = memrchr(mf->data + pos, '\n', at - pos);
+        size_t start = prev ? (size_t)(prev - mf->data) + 1 : pos;
+        const char* next = memchr(hit, '\n', mf->size - at);
+        size_t end = next ? (size_t)(next - mf->data) : mf->size;
+
+        while (counted_to < start) {
+            const char* nl = memchr(mf->data + counted_to, '\n', start - counted_to);
+            if (!nl) break;
+            line_no++;
+            counted_to = (size_t)(nl - mf->data) + 1;
+        }
+        counted_to = start;
+
+        char number[32];
+        int number_len = snprintf(number, sizeof(number), "%zu:", line_no);
+        read_buf_append(&buf, number, (size_t)number_len);
+        read_buf_append(&buf, mf->data + start, end - start);
+        read_buf_append(&buf, "\n", 1);
+        matches++;
+        pos = end + 1;
+    }
+
+    if (buf.failed) {
+        free(buf.data);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    str_t content = matches > 0 ? (str_t){ .data = buf.data, .len = (uint32_t)buf.len }
+                                : STR_LIT("No matches");
+    tool_result_set_success(out_result, &content);
+    free(buf.data);
+    return ERR_OK;
+}
+
+// Serve a request straight from the mapping; only the result is copied
+static err_t read_file_contents(file_read_tool_t* tool_data, const char* path,
+                                const read_request_t* request, tool_result_t* out_result) {
     struct stat st;
 
     // Get file info
@@ -188,50 +528,125 @@ static err_t read_file_contents(const char* path, size_t max_size, tool_result_t
         return ERR_INVALID_ARGUMENT;
     }
 
-    // Check file size
-    if (st.st_size > (off_t)max_size) {
-        str_t error = STR_LIT("File too large");
+    // Whole-file reads keep the size limit; ranges are capped instead
+    size_t max_size = tool_data->max_file_size;
+    if (request->mode == READ_WHOLE && st.st_size > (off_t)max_size) {
+        str_t error = STR_LIT("File too large; read a range with offset/limit, head or tail");
         tool_result_set_error(out_result, &error);
         return ERR_FILE_TOO_LARGE;
     }
 
-    // Open file
-    file = fopen(path, "rb");
-    if (!file) {
-        str_t error = STR_LIT("Failed to open file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
+    mapped_file_t* mf = NULL;
+    err_t err = mapped_file_acquire(tool_data, path, &st, &mf);
+    if (err != ERR_OK) {
+        if (err == ERR_IO) {
+            str_t error = STR_LIT("Failed to open file");
+            tool_result_set_error(out_result, &error);
+        }
+        return err;
     }
 
-    // Allocate buffer
-    buffer = malloc((size_t)st.st_size + 1);
-    if (!buffer) {
-        fclose(file);
-        return ERR_OUT_OF_MEMORY;
+    if (request->mode == READ_GREP) {
+        err = grep_lines(mf, request->pattern, request->limit, max_size, out_result);
+        mapped_file_release(tool_data, mf);
+        return err;
     }
 
-    // Read file
-    size_t bytes_read = fread(buffer, 1, (size_t)st.st_size, file);
-    fclose(file);
+    size_t start = 0;
+    size_t end = mf->size;
+    switch (request->mode) {
+        case READ_LINES:
+            if (request->offset > 1) {
+                err = mapped_file_index(mf);
+                if (err != ERR_OK) break;
+                start = line_offset(mf, request->offset - 1);
+            }
+            end = skip_lines(mf->data, mf->size, start, request->limit);
+            break;
+        case READ_BYTES:
+            start = request->offset < mf->size ? request->offset : mf->size;
+            end = request->limit < mf->size - start ? start + request->limit : mf->size;
+            break;
+        case READ_HEAD:
+            end = skip_lines(mf->data, mf->size, 0, request->limit);
+            break;
+        case READ_TAIL:
+            start = tail_offset(mf->data, mf->size, request->limit);
+            break;
+        default:
+            break;
+    }
 
-    if (bytes_read != (size_t)st.st_size) {
-        free(buffer);
-        str_t error = STR_LIT("Failed to read entire file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
+    if (err == ERR_OK) {
+        if (end - start > max_size) end = start + max_size;
+        str_t content = { .data = mf->data ? mf->data + start : "", .len = (uint32_t)(end - start) };
+        tool_result_set_success(out_result, &content);
     }
 
-    // Null-terminate (for safety, though we treat as binary)
-    buffer[bytes_read] = '\0';
+    mapped_file_release(tool_data, mf);
+    return err;
+}
 
-    // Set success result
-    str_t content = { .data = buffer, .len = (uint32_t)bytes_read };
-    tool_result_set_success(out_result, &content);
+static size_t json_count(json_object_t* obj, const char* key, size_t default_val) {
+    double value = json_object_get_number(obj, key, (double)default_val);
+    if (!(value > 0)) return 0;
+    if (value >= (double)SIZE_MAX) return SIZE_MAX;
+    return (size_t)value;
+}
 
-    // Note: tool_result_set_success duplicates the string, so we can free our buffer
-    free(buffer);
+// Arguments are either a bare path or a JSON object:
+//   {"path", "offset", "limit", "unit": "lines"|"bytes", "head", "tail", "grep"}
+static err_t parse_read_args(const str_t* args, char** out_path, read_request_t* out_request) {
+    *out_request = (read_request_t){ .mode = READ_WHOLE, .offset = 1, .limit = SIZE_MAX };
+
+    uint32_t i = 0;
+    while (i < args->len && (args->data[i] == ' ' || args->data[i] == '\n' || args->data[i] == '\t')) i++;
+    if (i == args->len || args->data[i] != '{') {
+        *out_path = malloc(args->len + 1);
+        if (!*out_path) return ERR_OUT_OF_MEMORY;
+        memcpy(*out_path, args->data, args->len);
+        (*out_path)[args->len] = '\0';
+        return ERR_OK;
+    }
 
-    return ERR_OK;
+    json_value_t* root = json_parse_len(args->data, args->len);
+    json_object_t* obj = root && root->type == JSON_OBJECT ? root->object : NULL;
+    const char* path = json_object_get_string(obj, "path", NULL);
+    if (!path) {
+        json_free(root);
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    const char* grep = json_object_get_string(obj, "grep", NULL);
+    const char* unit = json_object_get_string(obj, "unit", "lines");
+    bool ranged = json_object_has(obj, "offset") || json_object_has(obj, "limit");
+    err_t err = ERR_OK;
+
+    if (grep) {
+        out_request->mode = READ_GREP;
+        out_request->limit = json_count(obj, "limit", FILE_READ_DEFAULT_MATCHES);
+        out_request->pattern = strdup(grep);
+        if (!out_request->pattern) err = ERR_OUT_OF_MEMORY;
+    } else if (json_object_has(obj, "head")) {
+        out_request->mode = READ_HEAD;
+        out_request->limit = json_count(obj, "head", 0);
+    } else if (json_object_has(obj, "tail")) {
+        out_request->mode = READ_TAIL;
+        out_request->limit = json_count(obj, "tail", 0);
+    } else if (strcmp(unit, "bytes") == 0) {
+        out_request->mode = ranged ? READ_BYTES : READ_WHOLE;
+        out_request->offset = json_count(obj, "offset", 0);
+        out_request->limit = json_count(obj, "limit", SIZE_MAX);
+    } else if (ranged) {
+        out_request->mode = READ_LINES;
+        out_request->offset = json_count(obj, "offset", 1);
+        out_request->limit = json_count(obj, "limit", FILE_READ_DEFAULT_LINES);
+    }
+
+    *out_path = err == ERR_OK ? strdup(path) : NULL;
+    if (err == ERR_OK && !*out_path) err = ERR_OUT_OF_MEMORY;
+    json_free(root);
+    return err;
 }
 
 static err_t file_read_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
@@ -241,27 +656,32 @@ static err_t file_read_execute(tool_t* tool, const str_t* args, tool_result_t* o
 
     file_read_tool_t* file_read_data = (file_read_tool_t*)tool->impl_data;
 
-    // Parse args (expecting JSON with "path" field)
-    // For simplicity, treat args as plain file path for now
-    // TODO: Parse JSON args properly
-    char* path = malloc(args->len + 1);
-    if (!path) return ERR_OUT_OF_MEMORY;
-
-    memcpy(path, args->data, args->len);
-    path[args->len] = '\0';
+    char* path = NULL;
+    read_request_t request;
+    err_t result = parse_read_args(args, &path, &request);
+    if (result != ERR_OK) {
+        free((void*)request.pattern);
+        if (result == ERR_INVALID_ARGUMENT) {
+            str_t error = STR_LIT("Missing \"path\" argument");
+            tool_result_set_error(out_result, &error);
+        }
+        return result;
+    }
 
     // Check if path is safe
     if (!is_path_safe(file_read_data, path)) {
         free(path);
+        free((void*)request.pattern);
         str_t error = STR_LIT("Path not allowed (outside workspace)");
         tool_result_set_error(out_result, &error);
         return ERR_PERMISSION_DENIED;
     }
 
     // Read file
-    err_t result = read_file_contents(path, file_read_data->max_file_size, out_result);
+    result = read_file_contents(file_read_data, path, &request, out_result);
 
     free(path);
+    free((void*)request.pattern);
     return result;
 }
 
@@ -273,6 +693,31 @@ static str_t file_read_get_parameters_schema(void) {
             "\"path\": {"
                 "\"type\": \"string\","
                 "\"description\": \"Path to file to read\""
+            "},"
+            "\"offset\": {"
+                "\"type\": \"integer\","
+                "\"description\": \"First line (1-based) or byte offset to read\""
+            "},"
+            "\"limit\": {"
+                "\"type\": \"integer\","
+                "\"description\": \"Number of lines or bytes to read, or matches with grep\""
+            "},"
+            "\"unit\": {"
+                "\"type\": \"string\","
+                "\"enum\": [\"lines\", \"bytes\"],"
+                "\"description\": \"Unit of offset and limit (default lines)\""
+            "},"
+            "\"head\": {"
+                "\"type\": \"integer\","
+                "\"description\": \"Read only the first N lines\""
+            "},"
+            "\"tail\": {"
+                "\"type\": \"integer\","
+                "\"description\": \"Read only the last N lines\""
+            "},"
+            "\"grep\": {"
+                "\"type\": \"string\","
+                "\"description\": \"Return only lines containing this text, prefixed with line numbers\""
             "}"
         "},"
         "\"required\": [\"path\"]"
@@ -288,4 +733,8 @@ static bool file_read_requires_memory(void) {
 static bool file_read_allowed_in_autonomous(autonomy_level_t level) {
     // Allow in supervised or full autonomy modes
     return level >= AUTONOMY_LEVEL_SUPERVISED;
+}
+
+static bool file_read_is_pure(void) {
+    return true;
 }
\ No newline at end of file
@@ -13,6 +13,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+// Upper bound on files in one batched call
+#define FILE_WRITE_MAX_BATCH 64
+
 // File write tool instance data
 typedef struct file_write_tool_t {
     config_t* config;           // Configuration for path restrictions
@@ -183,182 +186,288 @@ static bool is_path_safe(file_write_tool_t* tool_data, const char* path) {
     return true;
 }
 
-// Write file contents atomically (write to temp file then rename)
-static err_t write_file_atomically(const char* path, const char* content, size_t content_len,
-                                   bool allow_overwrite, tool_result_t* out_result) {
-    int fd = -1;
-    FILE* file = NULL;
-    char temp_path[PATH_MAX + 10];
-    size_t written = 0;
-
-    // Check if file exists and overwrite is not allowed
-    if (!allow_overwrite && access(path, F_OK) == 0) {
-        str_t error = STR_LIT("File already exists and overwrite not allowed");
-        tool_result_set_error(out_result, &error);
-        return ERR_FILE_EXISTS;
-    }
+// ============================================================================
+// Staged Writes
+// ============================================================================
+
+// One file of a batch. Content lands in a temp file beside its target and
+// is renamed over it only once every file of the batch reached the disk.
+typedef struct write_op_t {
+    const char* path;           // Borrowed from the parsed arguments
+    const char* content;
+    size_t content_len;
+    const char* find;           // Patch: replace the single occurrence of find
+    const char* replace;
+    char* patched;              // Content produced by the patch
+    char temp_path[PATH_MAX + 32];
+    int fd;
+    dev_t dev;
+} write_op_t;
+
+static err_t op_fail(const write_op_t* op, const char* what, err_t err, tool_result_t* out_result) {
+    char message[PATH_MAX + 128];
+    snprintf(message, sizeof(message), "%s: %s", op->path, what);
+    str_t error = { .data = message, .len = (uint32_t)strlen(message) };
+    tool_result_set_error(out_result, &error);
+    return err;
+}
 
-    // Create temporary file in same directory
-    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path);
-    fd = mkstemp(temp_path);
-    if (fd < 0) {
-        str_t error = STR_LIT("Failed to create temporary file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
+static void op_discard(write_op_t* op) {
+    if (op->fd >= 0) {
+        close(op->fd);
+        unlink(op->temp_path);
+        op->fd = -1;
     }
+    free(op->patched);
+    op->patched = NULL;
+}
 
-    // Convert fd to FILE* for easier writing
-    file = fdopen(fd, "wb");
-    if (!file) {
-        close(fd);
-        unlink(temp_path);
-        str_t error = STR_LIT("Failed to open temporary file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
-    }
+// Apply a find/replace patch to the current file contents
+static err_t op_patch(write_op_t* op, size_t max_size, tool_result_t* out_result) {
+    FILE* file = fopen(op->path, "rb");
+    if (!file) return op_fail(op, "cannot open file to patch", ERR_FILE_NOT_FOUND, out_result);
 
-    // Write content
-    written = fwrite(content, 1, content_len, file);
-    if (written != content_len) {
+    char* current = malloc(max_size + 1);
+    if (!current) {
         fclose(file);
-        unlink(temp_path);
-        str_t error = STR_LIT("Failed to write entire content");
-        tool_result_set_error(out_result, &error);
-        return ERR_WRITE_FAILED;
+        return ERR_OUT_OF_MEMORY;
     }
+    size_t len = fread(current, 1, max_size + 1, file);
+    fclose(file);
+    current[len > max_size ? max_size : len] = '\0';
 
-    // Flush to ensure data is written
-    if (fflush(file) != 0) {
-        fclose(file);
-        unlink(temp_path);
-        str_t error = STR_LIT("Failed to flush file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
+    if (len > max_size) {
+        free(current);
+        return op_fail(op, "file too large to patch", ERR_FILE_TOO_LARGE, out_result);
     }
 
-    // Close file
-    fclose(file);
-
-    // Atomically rename temp file to target
-    if (rename(temp_path, path) != 0) {
-        unlink(temp_path);
-        str_t error = STR_LIT("Failed to rename temporary file");
-        tool_result_set_error(out_result, &error);
-        return ERR_IO;
+    size_t find_len = strlen(op->find);
+    char* hit = find_len ? strstr(current, op->find) : NULL;
+    if (!hit || strstr(hit + 1, op->find)) {
+        free(current);
+        return op_fail(op, hit ? "patch text is not unique" : "patch text not found",
+                       ERR_INVALID_ARGUMENT, out_result);
     }
 
-    // Set success result
-    str_t success_msg = STR_LIT("File written successfully");
-    tool_result_set_success(out_result, &success_msg);
+    size_t replace_len = strlen(op->replace);
+    size_t prefix = (size_t)(hit - current);
+    size_t out_len = len - find_len + replace_len;
+    if (out_len > max_size) {
+        free(current);
+        return op_fail(op, "patched content too large", ERR_FILE_TOO_LARGE, out_result);
+    }
 
+    op->patched = malloc(out_len + 1);
+    if (!op->patched) {
+        free(current);
+        return ERR_OUT_OF_MEMORY;
+    }
+    memcpy(op->patched, current, prefix);
+    memcpy(op->patched + prefix, op->replace, replace_len);
+    memcpy(op->patched + prefix + replace_len, hit + find_len, len - prefix - find_len);
+    op->patched[out_len] = '\0';
+    free(current);
+
+    op->content = op->patched;
+    op->content_len = out_len;
     return ERR_OK;
 }
 
-static err_t file_write_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
-    if (!tool || !tool->impl_data || !tool->initialized || !args || !out_result) {
-        return ERR_INVALID_ARGUMENT;
+// Write the temp file without syncing it. Unlike mkstemp the temp is
+// created with 0666 so new files honour the umask, and an existing file's
+// mode is carried over.
+static err_t op_stage(write_op_t* op, tool_result_t* out_result) {
+    static uint32_t counter = 0;
+    struct stat existing;
+    bool exists = stat(op->path, &existing) == 0;
+
+    for (int attempt = 0; attempt < 16 && op->fd < 0; attempt++) {
+        snprintf(op->temp_path, sizeof(op->temp_path), "%s.tmp-%d-%u", op->path, (int)getpid(),
+                 __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED));
+        op->fd = open(op->temp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (op->fd < 0 && errno != EEXIST) break;
     }
+    if (op->fd < 0) return op_fail(op, "failed to create temporary file", ERR_IO, out_result);
 
-    file_write_tool_t* file_write_data = (file_write_tool_t*)tool->impl_data;
+    if (exists) fchmod(op->fd, existing.st_mode & 07777);
 
-    // Parse args (expecting JSON with "path" and "content" fields)
-    // For simplicity, treat args as JSON string for now
-    // TODO: Parse JSON args properly using json_config.h
-    // For now, assume format: {"path": "file.txt", "content": "text"}
-    // We'll implement a simple parser for demonstration
+    size_t written = 0;
+    while (written < op->content_len) {
+        ssize_t n = write(op->fd, op->content + written, op->content_len - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return op_fail(op, "failed to write entire content", ERR_WRITE_FAILED, out_result);
+        written += (size_t)n;
+    }
 
-    // Convert args to C string for parsing
-    char* args_str = malloc(args->len + 1);
-    if (!args_str) return ERR_OUT_OF_MEMORY;
+    struct stat st;
+    if (fstat(op->fd, &st) != 0) return op_fail(op, "failed to stat temporary file", ERR_IO, out_result);
+    op->dev = st.st_dev;
+    return ERR_OK;
+}
 
-    memcpy(args_str, args->data, args->len);
-    args_str[args->len] = '\0';
+static size_t parent_len(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? (size_t)(slash - path) : 0;
+}
 
-    // Simple JSON parsing (for demonstration)
-    char* path_start = strstr(args_str, "\"path\"");
-    char* content_start = strstr(args_str, "\"content\"");
+// Make the renames durable: one fsync per distinct parent directory
+static void sync_parent_dirs(write_op_t* ops, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        size_t len = parent_len(ops[i].path);
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) {
+            seen = parent_len(ops[j].path) == len && strncmp(ops[i].path, ops[j].path, len) == 0;
+        }
+        if (seen) continue;
 
-    if (!path_start) {
-        free(args_str);
-        str_t error = STR_LIT("Missing 'path' field in arguments");
-        tool_result_set_error(out_result, &error);
-        return ERR_INVALID_ARGUMENT;
+        char dir[PATH_MAX];
+        if (len == 0) {
+            snprintf(dir, sizeof(dir), "%s", ops[i].path[0] == '/' ? "/" : ".");
+        } else {
+            snprintf(dir, sizeof(dir), "%.*s", (int)len, ops[i].path);
+        }
+        int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
     }
+}
 
-    if (!content_start) {
-        free(args_str);
-        str_t error = STR_LIT("Missing 'content' field in arguments");
-        tool_result_set_error(out_result, &error);
-        return ERR_INVALID_ARGUMENT;
+// Stage every file, issue a single durability barrier, then rename. A
+// staging failure leaves all targets untouched.
+static err_t write_files_atomically(write_op_t* ops, uint32_t count, size_t max_size,
+                                    bool allow_overwrite, tool_result_t* out_result) {
+    err_t err = ERR_OK;
+
+    for (uint32_t i = 0; i < count && err == ERR_OK; i++) {
+        write_op_t* op = &ops[i];
+        if (!allow_overwrite && access(op->path, F_OK) == 0) {
+            err = op_fail(op, "file already exists and overwrite not allowed", ERR_FILE_EXISTS, out_result);
+        } else if (op->find) {
+            err = op_patch(op, max_size, out_result);
+        }
+        if (err == ERR_OK) err = op_stage(op, out_result);
     }
 
-    // Extract path value (simplified parsing)
-    char* path = NULL;
-    char* content = NULL;
-
-    // Find path value (after "path":)
-    char* path_quote = strchr(path_start + 6, '"');
-    if (path_quote) {
-        char* path_end = strchr(path_quote + 1, '"');
-        if (path_end) {
-            size_t path_len = path_end - (path_quote + 1);
-            path = malloc(path_len + 1);
-            if (path) {
-                memcpy(path, path_quote + 1, path_len);
-                path[path_len] = '\0';
-            }
+    // A lone file only needs its own data flushed; a batch flushes each
+    // filesystem once instead of paying one fdatasync per file
+    for (uint32_t i = 0; i < count && err == ERR_OK; i++) {
+        if (count == 1) {
+            if (fdatasync(ops[i].fd) != 0) err = op_fail(&ops[i], "failed to sync", ERR_IO, out_result);
+            break;
         }
+
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) seen = ops[j].dev == ops[i].dev;
+        if (!seen && syncfs(ops[i].fd) != 0) err = op_fail(&ops[i], "failed to sync", ERR_IO, out_result);
     }
 
-    // Find content value (after "content":)
-    char* content_quote = strchr(content_start + 9, '"');
-    if (content_quote) {
-        char* content_end = strchr(content_quote + 1, '"');
-        if (content_end) {
-            size_t content_len = content_end - (content_quote + 1);
-            content = malloc(content_len + 1);
-            if (content) {
-                memcpy(content, content_quote + 1, content_len);
-                content[content_len] = '\0';
-            }
+    if (err != ERR_OK) {
+        for (uint32_t i = 0; i < count; i++) op_discard(&ops[i]);
+        return err;
+    }
+
+    uint32_t renamed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        close(ops[i].fd);
+        ops[i].fd = -1;
+        if (err != ERR_OK) {
+            unlink(ops[i].temp_path);
+        } else if (rename(ops[i].temp_path, ops[i].path) != 0) {
+            unlink(ops[i].temp_path);
+            err = op_fail(&ops[i], "failed to rename temporary file", ERR_IO, out_result);
+        } else {
+            renamed++;
         }
+        free(ops[i].patched);
+        ops[i].patched = NULL;
     }
+    sync_parent_dirs(ops, renamed);
 
-    free(args_str);
+    if (err != ERR_OK) return err;
 
-    if (!path || !content) {
-        free(path);
-        free(content);
+    char message[64];
+    if (count == 1) {
+        snprintf(message, sizeof(message), "File written successfully");
+    } else {
+        snprintf(message, sizeof(message), "Wrote %u files", count);
+    }
+    str_t success_msg = { .data = message, .len = (uint32_t)strlen(message) };
+    tool_result_set_success(out_result, &success_msg);
+    return ERR_OK;
+}
+
+// {"path", "content"} or {"path", "find", "replace"}
+static bool parse_write_op(json_object_t* obj, write_op_t* op) {
+    *op = (write_op_t){ .fd = -1 };
+    op->path = json_object_get_string(obj, "path", NULL);
+    op->content = json_object_get_string(obj, "content", NULL);
+    op->find = json_object_get_string(obj, "find", NULL);
+    op->replace = json_object_get_string(obj, "replace", NULL);
+    if (!op->path || op->path[0] == '\0') return false;
+    if (op->content) {
+        op->content_len = strlen(op->content);
+        return !op->find;
+    }
+    return op->find && op->replace;
+}
+
+static err_t file_write_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
+    if (!tool || !tool->impl_data || !tool->initialized || !args || !out_result) {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    file_write_tool_t* file_write_data = (file_write_tool_t*)tool->impl_data;
+
+    json_value_t* root = json_parse_len(args->data, args->len);
+    json_object_t* obj = root && root->type == JSON_OBJECT ? root->object : NULL;
+    if (!obj) {
+        json_free(root);
         str_t error = STR_LIT("Failed to parse arguments");
         tool_result_set_error(out_result, &error);
         return ERR_INVALID_ARGUMENT;
     }
 
-    // Check if path is safe
-    if (!is_path_safe(file_write_data, path)) {
-        free(path);
-        free(content);
-        str_t error = STR_LIT("Path not allowed (outside workspace)");
+    // A "files" array batches several writes behind one sync barrier
+    json_array_t* files = json_object_get_array(obj, "files");
+    uint32_t count = files ? files->count : 1;
+    if (count == 0 || count > FILE_WRITE_MAX_BATCH) {
+        json_free(root);
+        str_t error = STR_LIT("\"files\" must hold between 1 and 64 entries");
         tool_result_set_error(out_result, &error);
-        return ERR_PERMISSION_DENIED;
+        return ERR_INVALID_ARGUMENT;
     }
 
-    // Check content size
-    size_t content_len = strlen(content);
-    if (content_len > file_write_data->max_file_size) {
-        free(path);
-        free(content);
-        str_t error = STR_LIT("Content too large");
-        tool_result_set_error(out_result, &error);
-        return ERR_FILE_TOO_LARGE;
+    write_op_t* ops = calloc(count, sizeof(write_op_t));
+    if (!ops) {
+        json_free(root);
+        return ERR_OUT_OF_MEMORY;
     }
 
-    // Write file
-    err_t result = write_file_atomically(path, content, content_len,
-                                         file_write_data->allow_overwrite, out_result);
+    err_t result = ERR_OK;
+    for (uint32_t i = 0; i < count && result == ERR_OK; i++) {
+        json_object_t* entry = obj;
+        if (files) entry = files->items[i].type == JSON_OBJECT ? files->items[i].object : NULL;
+
+        if (!entry || !parse_write_op(entry, &ops[i])) {
+            str_t error = STR_LIT("Each write needs \"path\" and either \"content\" or \"find\" and \"replace\"");
+            tool_result_set_error(out_result, &error);
+            result = ERR_INVALID_ARGUMENT;
+        } else if (!is_path_safe(file_write_data, ops[i].path)) {
+            result = op_fail(&ops[i], "path not allowed (outside workspace)", ERR_PERMISSION_DENIED, out_result);
+        } else if (ops[i].content_len > file_write_data->max_file_size) {
+            result = op_fail(&ops[i], "content too large", ERR_FILE_TOO_LARGE, out_result);
+        }
+    }
 
-    free(path);
-    free(content);
+    if (result == ERR_OK) {
+        result = write_files_atomically(ops, count, file_write_data->max_file_size,
+                                        file_write_data->allow_overwrite, out_result);
+    }
+
+    free(ops);
+    json_free(root);
     return result;
 }
 
@@ -374,9 +483,30 @@ static str_t file_write_get_parameters_schema(void) {
             "\"content\": {"
                 "\"type\": \"string\","
                 "\"description\": \"Content to write to file\""
+            "},"
+            "\"find\": {"
+                "\"type\": \"string\","
+                "\"description\": \"Instead of content: text occurring exactly once in the file\""
+            "},"
+            "\"replace\": {"
+                "\"type\": \"string\","
+                "\"description\": \"Replacement for find\""
+            "},"
+            "\"files\": {"
+                "\"type\": \"array\","
+                "\"description\": \"Several writes applied together, each with path and content or find/replace\","
+                "\"items\": {"
+                    "\"type\": \"object\","
+                    "\"properties\": {"
+                        "\"path\": {\"type\": \"string\"},"
+                        "\"content\": {\"type\": \"string\"},"
+                        "\"find\": {\"type\": \"string\"},"
+                        "\"replace\": {\"type\": \"string\"}"
+                    "},"
+                    "\"required\": [\"path\"]"
+                "}"
             "}"
-        "},"
-        "\"required\": [\"path\", \"content\"]"
+        "}"
     "}";
 
     return (str_t){ .data = schema, .len = strlen(schema) };
@@ -26,6 +26,7 @@ static err_t memory_recall_execute(tool_t* tool, const str_t* args, tool_result_
 static str_t memory_recall_get_parameters_schema(void);
 static bool memory_recall_requires_memory(void);
 static bool memory_recall_allowed_in_autonomous(autonomy_level_t level);
+static bool memory_recall_is_pure(void);
 
 // VTable definition
 static const tool_vtable_t memory_recall_vtable = {
@@ -39,7 +40,8 @@ static const tool_vtable_t memory_recall_vtable = {
     .execute = memory_recall_execute,
     .get_parameters_schema = memory_recall_get_parameters_schema,
     .requires_memory = memory_recall_requires_memory,
-    .allowed_in_autonomous = memory_recall_allowed_in_autonomous
+    .allowed_in_autonomous = memory_recall_allowed_in_autonomous,
+    .is_pure = memory_recall_is_pure
 };
 
 // Get vtable
@@ -117,8 +119,8 @@ static err_t memory_recall_init(tool_t* tool, const tool_context_t* context) {
         recall_data->memory = context->memory;
         recall_data->memory_owned = false;
     } else {
-        // Create our own memory instance
-        // TODO: Load memory configuration from context or default
+        // Used outside an agent (agent_register_tool passes the shared
+        // instance): open a private in-memory one
         memory_config_t config = memory_config_default();
 
         err_t err = memory_create("sqlite", &config, &recall_data->memory);
@@ -355,8 +357,7 @@ static err_t memory_recall_execute(tool_t* tool, const str_t* args, tool_result_
             opts.category_filter = category;
         }
 
-        recall_err = recall_data->memory->vtable->search(recall_data->memory, &query, &opts,
-                                                         &entries, &entry_count);
+        recall_err = memory_search(recall_data->memory, &query, &opts, &entries, &entry_count);
     }
 
     // Cleanup parsed arguments
@@ -429,4 +430,8 @@ static bool memory_recall_requires_memory(void) {
 static bool memory_recall_allowed_in_autonomous(autonomy_level_t level) {
     // Allow in supervised or full autonomy modes
     return level >= AUTONOMY_LEVEL_SUPERVISED;
+}
+
+static bool memory_recall_is_pure(void) {
+    return true;
 }
\ No newline at end of file
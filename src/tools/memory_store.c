@@ -117,8 +117,8 @@ static err_t memory_store_init(tool_t* tool, const tool_context_t* context) {
         store_data->memory = context->memory;
         store_data->memory_owned = false;
     } else {
-        // Create our own memory instance
-        // TODO: Load memory configuration from context or default
+        // Used outside an agent (agent_register_tool passes the shared
+        // instance): open a private in-memory one
         memory_config_t config = memory_config_default();
 
         err_t err = memory_create("sqlite", &config, &store_data->memory);
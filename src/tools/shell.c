@@ -3,15 +3,11 @@
 
 #include "core/tool.h"
 #include "core/config.h"
+#include "runtime/docker_pool.h"
 #include "json_config.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <unistd.h>
-#include <sys/wait.h>
-#include <sys/types.h>
-#include <errno.h>
-#include <signal.h>
 
 // Shell tool instance data
 typedef struct shell_tool_t {
@@ -20,6 +16,9 @@ typedef struct shell_tool_t {
     uint32_t allowed_count;
     str_t workspace_dir;       // Working directory restriction
     uint32_t timeout_seconds;  // Execution timeout
+    shell_output_fn on_output; // Optional progress stream
+    void* output_user_data;
+    docker_pool_t* sandbox;    // Borrowed; NULL = run on the host
 } shell_tool_t;
 
 // Forward declarations for vtable
@@ -125,6 +124,7 @@ static err_t shell_init(tool_t* tool, const tool_context_t* context) {
 
     // Copy context
     tool->context = *context;
+    shell_data->sandbox = context->sandbox;
 
     // Set workspace from context if provided
     if (!str_empty(context->workspace_dir)) {
@@ -193,116 +193,86 @@ static bool is_command_allowed(shell_tool_t* shell_data, const char* command) {
     return false;
 }
 
-// Execute command with timeout (simple implementation using popen)
-static err_t execute_command(const char* command, uint32_t timeout_seconds,
-                            const char* workspace_dir, tool_result_t* out_result) {
-    FILE* fp = NULL;
-    char buffer[4096];
-    char* output = NULL;
-    size_t output_size = 0;
-    size_t output_len = 0;
-    int status = 0;
-
-    // Change to workspace directory if specified
-    char original_cwd[1024];
-    if (workspace_dir && getcwd(original_cwd, sizeof(original_cwd)) != NULL) {
-        if (chdir(workspace_dir) != 0) {
-            str_t error = STR_LIT("Failed to change to workspace directory");
-            tool_result_set_error(out_result, &error);
-            return ERR_IO;
-        }
+// Join stdout and stderr (when there is any) into one message
+static char* format_output(const char* prefix, const shell_run_result_t* run) {
+    size_t len = strlen(prefix) + run->out.len + run->err.len + 64;
+    char* text = malloc(len);
+    if (!text) return NULL;
+
+    int n = snprintf(text, len, "%s", prefix);
+    if (run->out.len > 0) {
+        n += snprintf(text + n, len - (size_t)n, "%s%.*s", n > 0 ? "\nOutput:\n" : "",
+                      (int)run->out.len, run->out.data);
+    }
+    if (run->err.len > 0) {
+        snprintf(text + n, len - (size_t)n, "%s%.*s", n > 0 ? "\nStderr:\n" : "",
+                 (int)run->err.len, run->err.data);
     }
+    return text;
+}
+
+// Execute command with a hard wall-clock timeout
+static err_t execute_command(shell_tool_t* shell_data, const char* command, tool_result_t* out_result) {
+    shell_run_options_t options = {
+        .cwd = shell_data->workspace_dir.data,
+        .timeout_ms = shell_data->timeout_seconds * 1000u,
+        .max_output = SHELL_MAX_OUTPUT_DEFAULT,
+        .on_output = shell_data->on_output,
+        .user_data = shell_data->output_user_data,
+    };
 
-    // Execute command using popen (simpler than fork/exec for now)
-    fp = popen(command, "r");
-    if (!fp) {
-        if (workspace_dir) chdir(original_cwd);
+    // The sandbox ignores cwd and runs in the mounted workspace instead
+    shell_run_result_t run;
+    err_t err = shell_data->sandbox ? docker_pool_exec(shell_data->sandbox, command, &options, &run)
+                                    : shell_run(command, &options, &run);
+    if (err == ERR_OUT_OF_MEMORY) return err;
+    if (err != ERR_OK) {
         str_t error = STR_LIT("Failed to execute command");
         tool_result_set_error(out_result, &error);
-        return ERR_TOOL_EXECUTION_FAILED;
+        return err;
     }
 
-    // Read output
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        size_t line_len = strlen(buffer);
-
-        // Resize output buffer if needed
-        if (output_len + line_len + 1 > output_size) {
-            size_t new_size = output_size ? output_size * 2 : 4096;
-            char* new_output = realloc(output, new_size);
-            if (!new_output) {
-                free(output);
-                pclose(fp);
-                if (workspace_dir) chdir(original_cwd);
-                return ERR_OUT_OF_MEMORY;
-            }
-            output = new_output;
-            output_size = new_size;
-        }
+    char prefix[128];
+    if (run.timed_out) {
+        snprintf(prefix, sizeof(prefix), "Command timed out after %u seconds", shell_data->timeout_seconds);
+        err = ERR_TOOL_TIMEOUT;
+    } else if (run.term_signal) {
+        snprintf(prefix, sizeof(prefix), "Command killed by signal %d", run.term_signal);
+        err = ERR_TOOL_EXECUTION_FAILED;
+    } else if (run.exit_code != 0) {
+        snprintf(prefix, sizeof(prefix), "Command failed with exit code %d", run.exit_code);
+        err = ERR_TOOL_EXECUTION_FAILED;
+    } else {
+        prefix[0] = '\0';
+    }
 
-        // Append line to output
-        memcpy(output + output_len, buffer, line_len);
-        output_len += line_len;
-        output[output_len] = '\0';
+    if (err == ERR_OK && run.out.len == 0 && run.err.len == 0) {
+        str_t empty = STR_LIT("Command executed successfully (no output)");
+        tool_result_set_success(out_result, &empty);
+        shell_run_result_free(&run);
+        return ERR_OK;
     }
 
-    // Get exit status
-    status = pclose(fp);
-
-    // Restore original directory
-    if (workspace_dir) chdir(original_cwd);
-
-    // Check exit status
-    if (WIFEXITED(status)) {
-        int exit_code = WEXITSTATUS(status);
-        if (exit_code == 0) {
-            // Success
-            if (output) {
-                str_t result_str = { .data = output, .len = (uint32_t)output_len };
-                tool_result_set_success(out_result, &result_str);
-            } else {
-                str_t empty = STR_LIT("Command executed successfully (no output)");
-                tool_result_set_success(out_result, &empty);
-            }
-            free(output);
-            return ERR_OK;
-        } else {
-            // Command failed
-            str_t error_msg;
-            char error_buf[512];
-            snprintf(error_buf, sizeof(error_buf), "Command failed with exit code %d", exit_code);
-            error_msg = (str_t){ .data = strdup(error_buf), .len = strlen(error_buf) };
-
-            if (output) {
-                // Include output in error message
-                char* full_error = malloc(error_msg.len + output_len + 64);
-                if (full_error) {
-                    snprintf(full_error, error_msg.len + output_len + 64,
-                            "%s\nOutput:\n%s", error_buf, output);
-                    free((void*)error_msg.data);
-                    error_msg.data = full_error;
-                    error_msg.len = strlen(full_error);
-                }
-            }
+    char* text = format_output(prefix, &run);
+    shell_run_result_free(&run);
+    if (!text) return ERR_OUT_OF_MEMORY;
 
-            tool_result_set_error(out_result, &error_msg);
-            free((void*)error_msg.data);
-            free(output);
-            return ERR_TOOL_EXECUTION_FAILED;
-        }
-    } else if (WIFSIGNALED(status)) {
-        // Command killed by signal
-        str_t error = STR_LIT("Command killed by signal");
-        tool_result_set_error(out_result, &error);
-        free(output);
-        return ERR_TOOL_EXECUTION_FAILED;
+    str_t message = { .data = text, .len = (uint32_t)strlen(text) };
+    if (err == ERR_OK) {
+        tool_result_set_success(out_result, &message);
     } else {
-        // Unknown error
-        str_t error = STR_LIT("Command execution failed");
-        tool_result_set_error(out_result, &error);
-        free(output);
-        return ERR_TOOL_EXECUTION_FAILED;
+        tool_result_set_error(out_result, &message);
     }
+    free(text);
+    return err;
+}
+
+void shell_tool_set_output_callback(tool_t* tool, shell_output_fn fn, void* user_data) {
+    if (!tool || tool->vtable != &shell_vtable || !tool->impl_data) return;
+
+    shell_tool_t* shell_data = (shell_tool_t*)tool->impl_data;
+    shell_data->on_output = fn;
+    shell_data->output_user_data = user_data;
 }
 
 static err_t shell_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
@@ -328,9 +298,7 @@ static err_t shell_execute(tool_t* tool, const str_t* args, tool_result_t* out_r
     }
 
     // Execute command
-    err_t result = execute_command(command, shell_data->timeout_seconds,
-                                  shell_data->workspace_dir.data ? shell_data->workspace_dir.data : NULL,
-                                  out_result);
+    err_t result = execute_command(shell_data, command, out_result);
 
     free(command);
     return result;
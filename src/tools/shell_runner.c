@@ -0,0 +1,321 @@
+// shell_runner.c - posix_spawn command runner for the shell tool
+// SPDX-License-Identifier: MIT
+
+#include "core/tool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+// How long to keep draining pipes after the group was killed; a daemonized
+// grandchild holding a pipe open must not hang the caller
+#define SHELL_KILL_DRAIN_MS 200
+
+// Bounded capture of one stream: the first half of the budget is kept
+// verbatim, the rest goes through a ring holding the most recent bytes
+typedef struct capture_t {
+    char* head;
+    size_t head_len;
+    char* ring;
+    size_t ring_start;
+    size_t ring_len;
+    size_t half;
+    uint64_t total;
+} capture_t;
+
+static err_t capture_init(capture_t* cap, size_t max_output) {
+    memset(cap, 0, sizeof(*cap));
+    cap->half = max_output / 2 ? max_output / 2 : 1;
+    cap->head = malloc(cap->half);
+    cap->ring = malloc(cap->half);
+    if (!cap->head || !cap->ring) {
+        free(cap->head);
+        free(cap->ring);
+        return ERR_OUT_OF_MEMORY;
+    }
+    return ERR_OK;
+}
+
+static void capture_free(capture_t* cap) {
+    free(cap->head);
+    free(cap->ring);
+    memset(cap, 0, sizeof(*cap));
+}
+
+static void capture_append(capture_t* cap, const char* data, size_t len) {
+    cap->total += len;
+
+    if (cap->head_len < cap->half) {
+        size_t take = cap->half - cap->head_len;
+        if (take > len) take = len;
+        memcpy(cap->head + cap->head_len, data, take);
+        cap->head_len += take;
+        data += take;
+        len -= take;
+    }
+    if (len == 0) return;
+
+    if (len >= cap->half) {
+        memcpy(cap->ring, data + len - cap->half, cap->half);
+        cap->ring_start = 0;
+        cap->ring_len = cap->half;
+        return;
+    }
+
+    size_t end = (cap->ring_start + cap->ring_len) % cap->half;
+    size_t first = cap->half - end;
+    if (first > len) first = len;
+    memcpy(cap->ring + end, data, first);
+    memcpy(cap->ring, data + first, len - first);
+
+    cap->ring_len += len;
+    if (cap->ring_len > cap->half) {
+        cap->ring_start = (cap->ring_start + cap->ring_len - cap->half) % cap->half;
+        cap->ring_len = cap->half;
+    }
+}
+
+// Flatten into a NUL-terminated string; sets *truncated if bytes were dropped
+static err_t capture_finish(const capture_t* cap, str_t* out, bool* truncated) {
+    uint64_t omitted = cap->total - cap->head_len - cap->ring_len;
+    char marker[80];
+    int marker_len = 0;
+    if (omitted > 0) {
+        marker_len = snprintf(marker, sizeof(marker), "\n... [%llu bytes omitted] ...\n",
+                              (unsigned long long)omitted);
+        *truncated = true;
+    }
+
+    size_t len = cap->head_len + (size_t)marker_len + cap->ring_len;
+    char* buf = malloc(len + 1);
+    if (!buf) return ERR_OUT_OF_MEMORY;
+
+    char* p = buf;
+    memcpy(p, cap->head, cap->head_len);
+    p += cap->head_len;
+    memcpy(p, marker, (size_t)marker_len);
+    p += marker_len;
+    size_t first = cap->half - cap->ring_start;
+    if (first > cap->ring_len) first = cap->ring_len;
+    memcpy(p, cap->ring + cap->ring_start, first);
+    memcpy(p + first, cap->ring, cap->ring_len - first);
+    buf[len] = '\0';
+
+    *out = (str_t){ .data = buf, .len = (uint32_t)len };
+    return ERR_OK;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static err_t spawn_child(char* const argv[], const char* cwd, int out_fd, int err_fd, pid_t* out_pid) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    if (posix_spawn_file_actions_init(&actions) != 0) return ERR_OUT_OF_MEMORY;
+    if (posix_spawnattr_init(&attr) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_fd, STDERR_FILENO);
+
+    // The child gets its own group so a timeout can kill the whole pipeline,
+    // and default dispositions for signals the agent may ignore
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    // Changing directory in the child keeps the caller's cwd untouched,
+    // which matters with tool calls running on several threads
+    char* const* spawn_argv = argv;
+    char** wrapped = NULL;
+    if (cwd) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+        posix_spawn_file_actions_addchdir_np(&actions, cwd);
+#else
+        size_t argc = 0;
+        while (argv[argc]) argc++;
+        wrapped = calloc(argc + 5, sizeof(char*));
+        if (!wrapped) {
+            posix_spawnattr_destroy(&attr);
+            posix_spawn_file_actions_destroy(&actions);
+            return ERR_OUT_OF_MEMORY;
+        }
+        wrapped[0] = "/bin/sh";
+        wrapped[1] = "-c";
+        wrapped[2] = "cd -- \"$0\" && exec \"$@\"";
+        wrapped[3] = (char*)cwd;
+        memcpy(wrapped + 4, argv, argc * sizeof(char*));
+        spawn_argv = wrapped;
+#endif
+    }
+
+    // posix_spawnp only searches PATH for names without a slash
+    int rc = posix_spawnp(out_pid, spawn_argv[0], &actions, &attr, spawn_argv, environ);
+
+    free(wrapped);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return rc == 0 ? ERR_OK : ERR_TOOL_EXECUTION_FAILED;
+}
+
+err_t shell_run(const char* command, const shell_run_options_t* options, shell_run_result_t* out_result) {
+    if (!command || !out_result) return ERR_INVALID_ARGUMENT;
+
+    char* const argv[] = { "/bin/sh", "-c", (char*)command, NULL };
+    return shell_run_argv(argv, options, out_result);
+}
+
+err_t shell_run_argv(char* const argv[], const shell_run_options_t* options, shell_run_result_t* out_result) {
+    if (!argv || !argv[0] || !out_result) return ERR_INVALID_ARGUMENT;
+
+    shell_run_options_t opts = options ? *options : (shell_run_options_t){0};
+    size_t max_output = opts.max_output ? opts.max_output : SHELL_MAX_OUTPUT_DEFAULT;
+
+    memset(out_result, 0, sizeof(*out_result));
+    out_result->exit_code = -1;
+
+    capture_t caps[2];
+    if (capture_init(&caps[0], max_output) != ERR_OK) return ERR_OUT_OF_MEMORY;
+    if (capture_init(&caps[1], max_output) != ERR_OK) {
+        capture_free(&caps[0]);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    int out_pipe[2] = { -1, -1 };
+    int err_pipe[2] = { -1, -1 };
+    err_t err = ERR_OK;
+    pid_t pid = -1;
+
+    if (pipe2(out_pipe, O_CLOEXEC) != 0 || pipe2(err_pipe, O_CLOEXEC) != 0) {
+        err = ERR_IO;
+    } else {
+        err = spawn_child(argv, opts.cwd, out_pipe[1], err_pipe[1], &pid);
+    }
+    if (out_pipe[1] >= 0) close(out_pipe[1]);
+    if (err_pipe[1] >= 0) close(err_pipe[1]);
+
+    if (err != ERR_OK) {
+        if (out_pipe[0] >= 0) close(out_pipe[0]);
+        if (err_pipe[0] >= 0) close(err_pipe[0]);
+        capture_free(&caps[0]);
+        capture_free(&caps[1]);
+        return err;
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = out_pipe[0], .events = POLLIN },
+        { .fd = err_pipe[0], .events = POLLIN },
+    };
+    int open_count = 2;
+    int64_t deadline = opts.timeout_ms ? now_ms() + opts.timeout_ms : 0;
+    char buffer[16384];
+
+    while (open_count > 0) {
+        int wait_ms = -1;
+        if (deadline) {
+            int64_t left = deadline - now_ms();
+            if (left <= 0) {
+                if (out_result->timed_out) break;
+                // Kill the whole group, then drain what is already buffered
+                killpg(pid, SIGKILL);
+                out_result->timed_out = true;
+                deadline = now_ms() + SHELL_KILL_DRAIN_MS;
+                continue;
+            }
+            wait_ms = left > INT32_MAX ? INT32_MAX : (int)left;
+        }
+
+        int ready = poll(fds, 2, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            ssize_t n = read(fds[i].fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                open_count--;
+                continue;
+            }
+
+            capture_append(&caps[i], buffer, (size_t)n);
+            if (opts.on_output) opts.on_output(opts.user_data, i == 1, buffer, (size_t)n);
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (fds[i].fd >= 0) close(fds[i].fd);
+    }
+
+    // Stdout closing early does not mean the child is done
+    if (!out_result->timed_out && deadline) {
+        int status = 0;
+        pid_t reaped = 0;
+        while ((reaped = waitpid(pid, &status, WNOHANG)) == 0 && now_ms() < deadline) {
+            struct timespec pause = { .tv_sec = 0, .tv_nsec = 10 * 1000000L };
+            nanosleep(&pause, NULL);
+        }
+        if (reaped == 0) {
+            killpg(pid, SIGKILL);
+            out_result->timed_out = true;
+        } else if (reaped == pid) {
+            pid = -1;
+            if (WIFEXITED(status)) out_result->exit_code = WEXITSTATUS(status);
+            if (WIFSIGNALED(status)) out_result->term_signal = WTERMSIG(status);
+        }
+    }
+
+    if (pid > 0) {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        if (WIFEXITED(status)) out_result->exit_code = WEXITSTATUS(status);
+        if (WIFSIGNALED(status)) out_result->term_signal = WTERMSIG(status);
+    }
+
+    out_result->out_total = caps[0].total;
+    out_result->err_total = caps[1].total;
+    err = capture_finish(&caps[0], &out_result->out, &out_result->truncated);
+    if (err == ERR_OK) err = capture_finish(&caps[1], &out_result->err, &out_result->truncated);
+
+    capture_free(&caps[0]);
+    capture_free(&caps[1]);
+    if (err != ERR_OK) shell_run_result_free(out_result);
+    return err;
+}
+
+void shell_run_result_free(shell_run_result_t* result) {
+    if (!result) return;
+    free((void*)result->out.data);
+    free((void*)result->err.data);
+    result->out = STR_NULL;
+    result->err = STR_NULL;
+}
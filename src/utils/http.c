@@ -3,8 +3,12 @@
 
 #include "utils/http.h"
 #include "core/error.h"
+#include "core/trace.h"
+#include "utils/json_writer.h"
 
 #include <curl/curl.h>
+#include <pthread.h>
+#include <uv.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -16,13 +20,32 @@ typedef struct {
     char* data;
     size_t size;
     size_t capacity;
+    CURL* curl;            // Asked for Content-Length before the first write
 } memory_buffer_t;
 
+// Larger announced bodies grow as they arrive instead of being reserved up front
+#define HTTP_PRESIZE_MAX (64u * 1024 * 1024)
+
 // Callback for libcurl to write response data
 static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
     size_t total_size = size * nmemb;
     memory_buffer_t* mem = (memory_buffer_t*)userp;
 
+    // Size the buffer once from Content-Length; decoded bodies may still outgrow it
+#if LIBCURL_VERSION_NUM >= 0x073700
+    if (mem->size == 0 && mem->curl) {
+        curl_off_t length = -1;
+        if (curl_easy_getinfo(mem->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK &&
+            length > 0 && (size_t)length + 1 > mem->capacity && (size_t)length < HTTP_PRESIZE_MAX) {
+            char* new_data = realloc(mem->data, (size_t)length + 1);
+            if (!new_data) return 0;
+            mem->data = new_data;
+            mem->capacity = (size_t)length + 1;
+        }
+        mem->curl = NULL;
+    }
+#endif
+
     // Reallocate if needed
     if (mem->size + total_size + 1 > mem->capacity) {
         size_t new_capacity = mem->capacity * 2;
@@ -42,11 +65,103 @@ static size_t write_callback(void* contents, size_t size, size_t nmemb, void* us
     return total_size;
 }
 
+// Pooled easy handle (one keep-alive slot)
+typedef struct http_pool_handle_t {
+    CURL* curl;
+    char host[256];          // Host (with port) of the last request
+    uint64_t last_used_ms;
+    bool in_use;
+} http_pool_handle_t;
+
+// Per-client connection pool
+typedef struct http_pool_t {
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    http_pool_handle_t** handles;
+    uint32_t handle_count;
+    uint32_t handle_capacity;
+    uint32_t max_handles;
+    uint32_t max_per_host;
+    uint32_t idle_timeout_ms;
+
+    // Shared connection, DNS and TLS session cache for all handles
+    CURLSH* share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+} http_pool_t;
+
+static uint64_t get_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Shared engine behind http_get_async
+static http_engine_t* g_default_engine = NULL;
+
+// Response headers collected during a transfer
+typedef struct header_list_t {
+    http_header_t* items;
+    uint32_t count;
+    uint32_t capacity;
+} header_list_t;
+
+static void header_list_clear(header_list_t* list) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        free((void*)list->items[i].name.data);
+        free((void*)list->items[i].value.data);
+    }
+    list->count = 0;
+}
+
+static void header_list_free(header_list_t* list) {
+    header_list_clear(list);
+    free(list->items);
+    list->items = NULL;
+    list->capacity = 0;
+}
+
+// Hand the collected headers to a response
+static void header_list_move(header_list_t* list, http_response_t* response) {
+    response->headers = list->items;
+    response->headers_count = list->count;
+    *list = (header_list_t){0};
+}
+
 // Callback for libcurl to write headers
 static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userp) {
-    (void)buffer;
-    (void)userp;
-    return size * nitems;  // Just discard for now, we'll parse later
+    size_t len = size * nitems;
+    header_list_t* list = (header_list_t*)userp;
+    if (!list) return len;
+
+    // Each status line starts a new header block (redirects, 100 Continue)
+    if (len >= 5 && memcmp(buffer, "HTTP/", 5) == 0) {
+        header_list_clear(list);
+        return len;
+    }
+
+    const char* colon = memchr(buffer, ':', len);
+    if (!colon || colon == buffer) return len;
+    const char* value = colon + 1;
+    const char* end = buffer + len;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) end--;
+
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+        http_header_t* items = realloc(list->items, capacity * sizeof(http_header_t));
+        if (!items) return len;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    http_header_t* header = &list->items[list->count];
+    header->name = str_dup((str_t){ .data = buffer, .len = (uint32_t)(colon - buffer) }, NULL);
+    header->value = str_dup((str_t){ .data = value, .len = (uint32_t)(end - value) }, NULL);
+    if (!header->name.data) {
+        free((void*)header->value.data);
+        return len;
+    }
+    list->count++;
+    return len;
 }
 
 // Initialize global HTTP subsystem
@@ -56,6 +171,7 @@ err_t http_init(void) {
 }
 
 void http_shutdown(void) {
+    http_engine_destroy(g_default_engine);
     curl_global_cleanup();
 }
 
@@ -71,10 +187,424 @@ http_client_config_t http_client_default_config(void) {
         .verify_ssl = true,
         .ca_cert_path = STR_NULL,
         .client_cert_path = STR_NULL,
-        .client_key_path = STR_NULL
+        .client_key_path = STR_NULL,
+        .pool_size = HTTP_POOL_SIZE_DEFAULT,
+        .max_connections_per_host = HTTP_POOL_MAX_PER_HOST_DEFAULT,
+        .idle_timeout_ms = HTTP_POOL_IDLE_TIMEOUT_MS_DEFAULT,
+        .http2 = true,
+        .tcp_keepalive_secs = HTTP_TCP_KEEPALIVE_SECS_DEFAULT,
+        .upkeep_interval_ms = HTTP_UPKEEP_INTERVAL_MS_DEFAULT
     };
 }
 
+// ============================================================================
+// Connection Pool
+// ============================================================================
+
+static void share_lock_callback(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp) {
+    (void)handle;
+    (void)access;
+    http_pool_t* pool = (http_pool_t*)userp;
+    pthread_mutex_lock(&pool->share_locks[data]);
+}
+
+static void share_unlock_callback(CURL* handle, curl_lock_data data, void* userp) {
+    (void)handle;
+    http_pool_t* pool = (http_pool_t*)userp;
+    pthread_mutex_unlock(&pool->share_locks[data]);
+}
+
+static CURLSH* http_pool_create_share(http_pool_t* pool) {
+    CURLSH* share = curl_share_init();
+    if (!share) return NULL;
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock_callback);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock_callback);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, pool);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+
+    return share;
+}
+
+static http_pool_t* http_pool_create(const http_client_config_t* config) {
+    http_pool_t* pool = calloc(1, sizeof(http_pool_t));
+    if (!pool) return NULL;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->available, NULL);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&pool->share_locks[i], NULL);
+    }
+
+    pool->max_handles = config->pool_size > 0 ? config->pool_size : HTTP_POOL_SIZE_DEFAULT;
+    pool->max_per_host = config->max_connections_per_host;
+    pool->idle_timeout_ms = config->idle_timeout_ms;
+
+    pool->share = http_pool_create_share(pool);
+    if (!pool->share) {
+        pthread_cond_destroy(&pool->available);
+        pthread_mutex_destroy(&pool->lock);
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&pool->share_locks[i]);
+        }
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+// Remove handle at index (caller holds pool->lock)
+static void http_pool_remove_locked(http_pool_t* pool, uint32_t index) {
+    http_pool_handle_t* handle = pool->handles[index];
+    curl_easy_cleanup(handle->curl);
+    free(handle);
+
+    pool->handles[index] = pool->handles[pool->handle_count - 1];
+    pool->handle_count--;
+}
+
+// Evict idle handles (caller holds pool->lock)
+static void http_pool_evict_idle_locked(http_pool_t* pool, uint64_t now_ms, bool evict_all) {
+    uint32_t i = 0;
+    while (i < pool->handle_count) {
+        http_pool_handle_t* handle = pool->handles[i];
+        bool expired = pool->idle_timeout_ms > 0 &&
+                       now_ms - handle->last_used_ms > pool->idle_timeout_ms;
+        bool excess = pool->handle_count > pool->max_handles;
+
+        if (!handle->in_use && (evict_all || expired || excess)) {
+            http_pool_remove_locked(pool, i);
+            continue; // Slot i now holds the former last handle
+        }
+        i++;
+    }
+}
+
+// Create a new handle (caller holds pool->lock)
+static http_pool_handle_t* http_pool_add_handle_locked(http_pool_t* pool) {
+    if (pool->handle_count >= pool->handle_capacity) {
+        uint32_t new_capacity = pool->handle_capacity == 0 ? 4 : pool->handle_capacity * 2;
+        http_pool_handle_t** new_handles = realloc(pool->handles,
+                                                   sizeof(http_pool_handle_t*) * new_capacity);
+        if (!new_handles) return NULL;
+        pool->handles = new_handles;
+        pool->handle_capacity = new_capacity;
+    }
+
+    http_pool_handle_t* handle = calloc(1, sizeof(http_pool_handle_t));
+    if (!handle) return NULL;
+
+    handle->curl = curl_easy_init();
+    if (!handle->curl) {
+        free(handle);
+        return NULL;
+    }
+
+    pool->handles[pool->handle_count++] = handle;
+    return handle;
+}
+
+// Check out a handle for host, blocking while the pool or host limit is exhausted
+static http_pool_handle_t* http_pool_acquire(http_pool_t* pool, const char* host) {
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;) {
+        http_pool_evict_idle_locked(pool, get_monotonic_ms(), false);
+
+        uint32_t host_busy = 0;
+        uint32_t total_busy = 0;
+        http_pool_handle_t* idle_same_host = NULL;
+        http_pool_handle_t* idle_any = NULL;
+
+        for (uint32_t i = 0; i < pool->handle_count; i++) {
+            http_pool_handle_t* handle = pool->handles[i];
+            bool same_host = strcmp(handle->host, host) == 0;
+
+            if (handle->in_use) {
+                total_busy++;
+                if (same_host) host_busy++;
+            } else if (same_host && !idle_same_host) {
+                idle_same_host = handle;
+            } else if (!idle_any) {
+                idle_any = handle;
+            }
+        }
+
+        bool host_ok = pool->max_per_host == 0 || host_busy < pool->max_per_host;
+        if (host_ok && total_busy < pool->max_handles) {
+            http_pool_handle_t* handle = idle_same_host ? idle_same_host : idle_any;
+            if (!handle) {
+                handle = http_pool_add_handle_locked(pool);
+                if (!handle) {
+                    pthread_mutex_unlock(&pool->lock);
+                    return NULL;
+                }
+            }
+
+            handle->in_use = true;
+            snprintf(handle->host, sizeof(handle->host), "%s", host);
+            pthread_mutex_unlock(&pool->lock);
+            return handle;
+        }
+
+        pthread_cond_wait(&pool->available, &pool->lock);
+    }
+}
+
+static void http_pool_release(http_pool_t* pool, http_pool_handle_t* handle) {
+    pthread_mutex_lock(&pool->lock);
+
+    handle->in_use = false;
+    handle->last_used_ms = get_monotonic_ms();
+
+    // Shrink lazily after http_client_set_pool_size lowered the limit
+    if (pool->handle_count > pool->max_handles) {
+        http_pool_evict_idle_locked(pool, handle->last_used_ms, false);
+    }
+
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void http_pool_destroy(http_pool_t* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    for (uint32_t i = 0; i < pool->handle_count; i++) {
+        curl_easy_cleanup(pool->handles[i]->curl);
+        free(pool->handles[i]);
+    }
+    free(pool->handles);
+    pool->handles = NULL;
+    pool->handle_count = 0;
+    pthread_mutex_unlock(&pool->lock);
+
+    // Handles must be gone before the share is released
+    if (pool->share) curl_share_cleanup(pool->share);
+
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->lock);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&pool->share_locks[i]);
+    }
+    free(pool);
+}
+
+err_t http_client_set_pool_size(http_client_t* client, uint32_t size) {
+    if (!client || !client->pool || size == 0) return ERR_INVALID_ARGUMENT;
+
+    http_pool_t* pool = (http_pool_t*)client->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->max_handles = size;
+    client->config.pool_size = size;
+    http_pool_evict_idle_locked(pool, get_monotonic_ms(), false);
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return ERR_OK;
+}
+
+void http_client_drain_pool(http_client_t* client) {
+    if (!client || !client->pool) return;
+
+    http_pool_t* pool = (http_pool_t*)client->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    http_pool_evict_idle_locked(pool, get_monotonic_ms(), true);
+
+    // Drop cached connections too once no handle references the share
+    if (pool->handle_count == 0) {
+        CURLSH* share = http_pool_create_share(pool);
+        if (share) {
+            curl_share_cleanup(pool->share);
+            pool->share = share;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void http_client_upkeep(http_client_t* client) {
+    if (!client || !client->pool) return;
+
+#if LIBCURL_VERSION_NUM >= 0x073e00
+    http_pool_t* pool = (http_pool_t*)client->pool;
+
+    // Upkeep walks the shared connection cache, so one idle handle covers them all
+    pthread_mutex_lock(&pool->lock);
+    http_pool_handle_t* handle = NULL;
+    for (uint32_t i = 0; i < pool->handle_count && !handle; i++) {
+        if (!pool->handles[i]->in_use) handle = pool->handles[i];
+    }
+    if (handle) handle->in_use = true;
+    pthread_mutex_unlock(&pool->lock);
+    if (!handle) return;
+
+    curl_easy_upkeep(handle->curl);
+
+    pthread_mutex_lock(&pool->lock);
+    handle->in_use = false;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+// Extract "host[:port]" from an absolute URL
+static void extract_host(const char* url, char* out, size_t out_size) {
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+
+    size_t len = strcspn(start, "/?#");
+    if (len >= out_size) len = out_size - 1;
+
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+// Apply client-wide options to a freshly reset handle
+static void apply_client_options(http_client_t* client, CURL* curl) {
+    http_pool_t* pool = (http_pool_t*)client->pool;
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, pool->share);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, client->config.follow_redirects ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, (long)client->config.max_redirects);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)client->config.timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, (long)client->config.connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, client->config.verify_ssl ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, client->config.verify_ssl ? 2L : 0L);
+    // "" offers every decoder libcurl was built with (gzip, br, zstd); bodies arrive decoded
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                     client->config.http2 ? (long)CURL_HTTP_VERSION_2TLS : (long)CURL_HTTP_VERSION_1_1);
+
+    // Keep NAT and load-balancer state alive across quiet spells
+    if (client->config.tcp_keepalive_secs > 0) {
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, (long)client->config.tcp_keepalive_secs);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, (long)client->config.tcp_keepalive_secs);
+    }
+#if LIBCURL_VERSION_NUM >= 0x073e00
+    if (client->config.upkeep_interval_ms > 0) {
+        curl_easy_setopt(curl, CURLOPT_UPKEEP_INTERVAL_MS, (long)client->config.upkeep_interval_ms);
+    }
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x074100
+    if (client->config.idle_timeout_ms > 0) {
+        long max_age = (long)(client->config.idle_timeout_ms / 1000);
+        curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, max_age > 0 ? max_age : 1L);
+    }
+#endif
+
+    if (!str_empty(client->config.user_agent)) {
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, client->config.user_agent.data);
+    }
+    if (!str_empty(client->config.ca_cert_path)) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, client->config.ca_cert_path.data);
+    }
+    if (!str_empty(client->config.client_cert_path)) {
+        curl_easy_setopt(curl, CURLOPT_SSLCERT, client->config.client_cert_path.data);
+    }
+    if (!str_empty(client->config.client_key_path)) {
+        curl_easy_setopt(curl, CURLOPT_SSLKEY, client->config.client_key_path.data);
+    }
+}
+
+// Internal: resolve url against the client's base URL
+static void build_full_url(http_client_t* client, const char* url, char* out, size_t out_size) {
+    if (client->config.base_url.data && strncmp(url, "http", 4) != 0) {
+        snprintf(out, out_size, "%.*s%s",
+                 (int)client->config.base_url.len, client->config.base_url.data, url);
+    } else {
+        strncpy(out, url, out_size - 1);
+        out[out_size - 1] = '\0';
+    }
+}
+
+// Internal: set method and body on a handle
+static void apply_method(CURL* curl, const char* method, const char* body, size_t body_len) {
+    if (strcmp(method, "GET") == 0) {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    } else if (strcmp(method, "POST") == 0) {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        if (body && body_len > 0) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+        }
+    } else if (strcmp(method, "PUT") == 0) {
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 0L);
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+        if (body && body_len > 0) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+        }
+    } else if (strcmp(method, "PATCH") == 0) {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+        if (body && body_len > 0) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
+        }
+    } else if (strcmp(method, "DELETE") == 0) {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+    }
+}
+
+// Internal: gzip a body of at least compress_min_bytes; NULL leaves it as is
+static char* compress_body(http_client_t* client, const char* body, size_t* body_len) {
+    if (!body || client->config.compress_min_bytes == 0 || *body_len < client->config.compress_min_bytes) {
+        return NULL;
+    }
+
+    // Fed in chunks so the writer deflates as it goes instead of staging a copy
+    json_writer_t w;
+    json_writer_init_gzip(&w, HTTP_COMPRESS_LEVEL);
+    for (size_t off = 0; off < *body_len; off += JSON_WRITER_GZIP_CHUNK) {
+        size_t n = *body_len - off < JSON_WRITER_GZIP_CHUNK ? *body_len - off : JSON_WRITER_GZIP_CHUNK;
+        json_write_raw(&w, body + off, n);
+    }
+    size_t len = 0;
+    char* gz = json_writer_finish(&w, &len);
+    if (gz) *body_len = len;
+    return gz;
+}
+
+// Internal: build request header list (content type, accept, client defaults)
+static struct curl_slist* build_header_list(http_client_t* client, const char* content_type, bool stream,
+                                            bool gzip_body) {
+    struct curl_slist* headers = NULL;
+    if (content_type) {
+        char ct_header[256];
+        snprintf(ct_header, sizeof(ct_header), "Content-Type: %s", content_type);
+        headers = curl_slist_append(headers, ct_header);
+    }
+    if (gzip_body) {
+        headers = curl_slist_append(headers, "Content-Encoding: gzip");
+    }
+    headers = curl_slist_append(headers, "Accept: application/json");
+
+    // Accept SSE streams
+    if (stream) {
+        headers = curl_slist_append(headers, "Accept: text/event-stream");
+    }
+
+    // Add default headers
+    for (uint32_t i = 0; i < client->default_headers_count; i++) {
+        char header[1024];
+        snprintf(header, sizeof(header), "%.*s: %.*s",
+                 (int)client->default_headers[i].name.len, client->default_headers[i].name.data,
+                 (int)client->default_headers[i].value.len, client->default_headers[i].value.data);
+        headers = curl_slist_append(headers, header);
+    }
+
+    return headers;
+}
+
 // Create HTTP client
 http_client_t* http_client_create(const http_client_config_t* config) {
     http_client_t* client = calloc(1, sizeof(http_client_t));
@@ -86,25 +616,13 @@ http_client_t* http_client_create(const http_client_config_t* config) {
         client->config = http_client_default_config();
     }
 
-    client->curl = curl_easy_init();
-    if (!client->curl) {
+    // Handles are created lazily on first use and kept alive between requests
+    client->pool = http_pool_create(&client->config);
+    if (!client->pool) {
         free(client);
         return NULL;
     }
 
-    // Set default options
-    curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, client->config.follow_redirects ? 1L : 0L);
-    curl_easy_setopt(client->curl, CURLOPT_MAXREDIRS, (long)client->config.max_redirects);
-    curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, (long)client->config.timeout_ms);
-    curl_easy_setopt(client->curl, CURLOPT_CONNECTTIMEOUT_MS, (long)client->config.connect_timeout_ms);
-    curl_easy_setopt(client->curl, CURLOPT_SSL_VERIFYPEER, client->config.verify_ssl ? 1L : 0L);
-    curl_easy_setopt(client->curl, CURLOPT_SSL_VERIFYHOST, client->config.verify_ssl ? 2L : 0L);
-
-    // User agent
-    if (!str_empty(client->config.user_agent)) {
-        curl_easy_setopt(client->curl, CURLOPT_USERAGENT, client->config.user_agent.data);
-    }
-
     return client;
 }
 
@@ -112,9 +630,7 @@ http_client_t* http_client_create(const http_client_config_t* config) {
 void http_client_destroy(http_client_t* client) {
     if (!client) return;
 
-    if (client->curl) {
-        curl_easy_cleanup(client->curl);
-    }
+    http_pool_destroy((http_pool_t*)client->pool);
 
     // Free default headers
     if (client->default_headers) {
@@ -156,6 +672,10 @@ void http_client_clear_headers(http_client_t* client) {
     client->default_headers_count = 0;
 }
 
+char* http_response_body(http_response_t* response) {
+    return response ? (char*)response->body.data : NULL;
+}
+
 // Free response
 void http_response_free(http_response_t* response) {
     if (!response) return;
@@ -199,116 +719,235 @@ bool http_response_is_error(http_response_t* response) {
     return response && response->status_code >= 400;
 }
 
+// ============================================================================
+// Capture
+// ============================================================================
+
+// One JSON object per exchange and line: method, url, request, status,
+// headers, elapsed_ms, and either body or, for streams, the chunks as
+// they arrived with their offset from the start of the request
+static pthread_mutex_t g_capture_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* g_capture_file = NULL;
+static bool g_capture_on = false;
+
+typedef struct capture_record_t {
+    json_writer_t w;
+    uint64_t start_us;
+    bool streaming;
+} capture_record_t;
+
+static uint64_t get_monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+err_t http_capture_start(const char* path) {
+    if (!path) return ERR_INVALID_ARGUMENT;
+
+    FILE* file = fopen(path, "a");
+    if (!file) return ERR_IO;
+
+    pthread_mutex_lock(&g_capture_lock);
+    if (g_capture_file) fclose(g_capture_file);
+    g_capture_file = file;
+    __atomic_store_n(&g_capture_on, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_capture_lock);
+    return ERR_OK;
+}
+
+void http_capture_stop(void) {
+    pthread_mutex_lock(&g_capture_lock);
+    __atomic_store_n(&g_capture_on, false, __ATOMIC_RELEASE);
+    if (g_capture_file) fclose(g_capture_file);
+    g_capture_file = NULL;
+    pthread_mutex_unlock(&g_capture_lock);
+}
+
+err_t http_capture_init_from_env(void) {
+    const char* path = getenv("CCLAW_HTTP_CAPTURE");
+    return path && path[0] ? http_capture_start(path) : ERR_OK;
+}
+
+// NULL while capture is off; body is the request as given, before gzip
+static capture_record_t* capture_begin(const char* method, const char* url,
+                                       const char* body, size_t body_len, bool streaming) {
+    if (!__atomic_load_n(&g_capture_on, __ATOMIC_ACQUIRE)) return NULL;
+
+    capture_record_t* rec = malloc(sizeof(capture_record_t));
+    if (!rec) return NULL;
+    rec->start_us = get_monotonic_us();
+    rec->streaming = streaming;
+
+    json_writer_init(&rec->w, 4096 + body_len);
+    json_write_object_begin(&rec->w);
+    json_write_kv_string(&rec->w, "method", method);
+    json_write_kv_string(&rec->w, "url", url);
+    json_write_key(&rec->w, "request");
+    json_write_string_len(&rec->w, body ? body : "", body ? body_len : 0);
+    if (streaming) {
+        json_write_kv_bool(&rec->w, "stream", true);
+        json_write_key(&rec->w, "chunks");
+        json_write_array_begin(&rec->w);
+    }
+    return rec;
+}
+
+static void capture_chunk(capture_record_t* rec, const char* data, size_t len) {
+    json_write_object_begin(&rec->w);
+    json_write_kv_number(&rec->w, "at_ms", (double)(get_monotonic_us() - rec->start_us) / 1000.0);
+    json_write_key(&rec->w, "data");
+    json_write_string_len(&rec->w, data, len);
+    json_write_object_end(&rec->w);
+}
+
+static void capture_abort(capture_record_t* rec) {
+    if (!rec) return;
+    json_writer_free(&rec->w);
+    free(rec);
+}
+
+// Finish the record with the response and append it; failed transfers
+// are dropped with capture_abort instead
+static void capture_end(capture_record_t* rec, uint32_t status, const http_header_t* headers,
+                        uint32_t headers_count, const char* body, size_t body_len) {
+    if (!rec) return;
+
+    if (rec->streaming) json_write_array_end(&rec->w);
+    json_write_kv_int(&rec->w, "status", status);
+    json_write_kv_number(&rec->w, "elapsed_ms", (double)(get_monotonic_us() - rec->start_us) / 1000.0);
+    json_write_key(&rec->w, "headers");
+    json_write_array_begin(&rec->w);
+    for (uint32_t i = 0; i < headers_count; i++) {
+        json_write_array_begin(&rec->w);
+        json_write_str(&rec->w, headers[i].name);
+        json_write_str(&rec->w, headers[i].value);
+        json_write_array_end(&rec->w);
+    }
+    json_write_array_end(&rec->w);
+    if (!rec->streaming) {
+        json_write_key(&rec->w, "body");
+        json_write_string_len(&rec->w, body ? body : "", body ? body_len : 0);
+    }
+    json_write_object_end(&rec->w);
+
+    size_t len = 0;
+    char* line = json_writer_finish(&rec->w, &len);
+    if (line) {
+        pthread_mutex_lock(&g_capture_lock);
+        if (g_capture_file) {
+            fwrite(line, 1, len, g_capture_file);
+            fputc('\n', g_capture_file);
+            fflush(g_capture_file);
+        }
+        pthread_mutex_unlock(&g_capture_lock);
+    }
+    free(line);
+    free(rec);
+}
+
 // Internal: Perform HTTP request
 static err_t perform_request(http_client_t* client, const char* method, const char* url,
                              const char* body, size_t body_len,
                              const char* content_type,
                              http_response_t** out_response) {
-    if (!client || !client->curl || !url || !out_response) return ERR_INVALID_ARGUMENT;
+    if (!client || !client->pool || !url || !out_response) return ERR_INVALID_ARGUMENT;
 
     // Build full URL
     char full_url[2048];
-    if (client->config.base_url.data && strncmp(url, "http", 4) != 0) {
-        snprintf(full_url, sizeof(full_url), "%.*s%s",
-                 (int)client->config.base_url.len, client->config.base_url.data, url);
-    } else {
-        strncpy(full_url, url, sizeof(full_url) - 1);
-        full_url[sizeof(full_url) - 1] = '\0';
-    }
+    build_full_url(client, url, full_url, sizeof(full_url));
 
-    // Reset curl handle
-    curl_easy_reset(client->curl);
-
-    // Set URL
-    curl_easy_setopt(client->curl, CURLOPT_URL, full_url);
-
-    // Set method and body
-    if (strcmp(method, "GET") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_HTTPGET, 1L);
-    } else if (strcmp(method, "POST") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_POST, 1L);
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "PUT") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_UPLOAD, 0L);
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "PUT");
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "PATCH") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "DELETE") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-    }
+    char host[256];
+    extract_host(full_url, host, sizeof(host));
 
     // Prepare response buffer
     memory_buffer_t response_buffer = { .data = malloc(4096), .size = 0, .capacity = 4096 };
     if (!response_buffer.data) return ERR_OUT_OF_MEMORY;
     response_buffer.data[0] = '\0';
 
-    // Set write callback
-    curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, &response_buffer);
+    // Check out a keep-alive handle
+    http_pool_t* pool = (http_pool_t*)client->pool;
+    http_pool_handle_t* handle = http_pool_acquire(pool, host);
+    if (!handle) {
+        free(response_buffer.data);
+        return ERR_OUT_OF_MEMORY;
+    }
+    CURL* curl = handle->curl;
 
-    // Set header callback (for now just discard)
-    curl_easy_setopt(client->curl, CURLOPT_HEADERFUNCTION, header_callback);
+    // Reset per-request state; live connections stay in the shared cache
+    curl_easy_reset(curl);
+    apply_client_options(client, curl);
 
-    // Set headers
-    struct curl_slist* headers = NULL;
-    if (content_type) {
-        char ct_header[256];
-        snprintf(ct_header, sizeof(ct_header), "Content-Type: %s", content_type);
-        headers = curl_slist_append(headers, ct_header);
-    }
-    headers = curl_slist_append(headers, "Accept: application/json");
+    // Set URL
+    curl_easy_setopt(curl, CURLOPT_URL, full_url);
 
-    // Add default headers
-    for (uint32_t i = 0; i < client->default_headers_count; i++) {
-        char header[1024];
-        snprintf(header, sizeof(header), "%.*s: %.*s",
-                 (int)client->default_headers[i].name.len, client->default_headers[i].name.data,
-                 (int)client->default_headers[i].value.len, client->default_headers[i].value.data);
-        headers = curl_slist_append(headers, header);
-    }
+    // Set method and body
+    capture_record_t* capture = capture_begin(method, full_url, body, body_len, false);
+    char* gz_body = compress_body(client, body, &body_len);
+    apply_method(curl, method, gz_body ? gz_body : body, body_len);
+
+    // Set write callback
+    response_buffer.curl = curl;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_buffer);
 
+    // Collect response headers (rate limits, Retry-After)
+    header_list_t response_headers = {0};
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
+
+    // Set headers
+    struct curl_slist* headers = build_header_list(client, content_type, false, gz_body != NULL);
     if (headers) {
-        curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     }
 
     // Perform request
-    CURLcode res = curl_easy_perform(client->curl);
+    TRACE_BEGIN(span, "http.request");
+    TRACE_DETAIL(span, STR_VIEW(host));
+    CURLcode res = curl_easy_perform(curl);
+    TRACE_END(span);
+
+    long http_code = 0;
+    double total_time = 0.0;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total_time);
+    }
 
-    // Cleanup headers
+    // Cleanup headers and hand the handle back
     if (headers) curl_slist_free_all(headers);
+    free(gz_body);
+    http_pool_release(pool, handle);
 
     if (res != CURLE_OK) {
+        capture_abort(capture);
         free(response_buffer.data);
+        header_list_free(&response_headers);
         return ERR_NETWORK;
     }
 
     // Create response object
     http_response_t* response = calloc(1, sizeof(http_response_t));
     if (!response) {
+        capture_abort(capture);
         free(response_buffer.data);
+        header_list_free(&response_headers);
         return ERR_OUT_OF_MEMORY;
     }
+    header_list_move(&response_headers, response);
 
     // Get response info
-    long http_code = 0;
-    curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &http_code);
     response->status_code = (uint32_t)http_code;
+    response->request_time_ms = total_time * 1000.0;
 
     // Move buffer to response
     response->body.data = response_buffer.data;
     response->body.len = (uint32_t)response_buffer.size;
 
+    capture_end(capture, response->status_code, response->headers, response->headers_count,
+                response->body.data, response->body.len);
+
     *out_response = response;
     return ERR_OK;
 }
@@ -355,6 +994,33 @@ err_t http_request(http_client_t* client, const char* method, const char* url,
     return perform_request(client, method, url, body, body_len, content_type, out_response);
 }
 
+err_t http_client_prewarm(http_client_t* client, const char* url) {
+    if (!client || !url) return ERR_INVALID_ARGUMENT;
+
+    char full_url[2048];
+    build_full_url(client, url, full_url, sizeof(full_url));
+    char host[256];
+    extract_host(full_url, host, sizeof(host));
+
+    http_pool_t* pool = (http_pool_t*)client->pool;
+    http_pool_handle_t* handle = http_pool_acquire(pool, host);
+    if (!handle) return ERR_OUT_OF_MEMORY;
+
+    // The connection lands in the shared cache for whichever handle goes next
+    curl_easy_reset(handle->curl);
+    apply_client_options(client, handle->curl);
+    curl_easy_setopt(handle->curl, CURLOPT_URL, full_url);
+    curl_easy_setopt(handle->curl, CURLOPT_NOBODY, 1L);
+
+    TRACE_BEGIN(span, "http.prewarm");
+    TRACE_DETAIL(span, STR_VIEW(host));
+    CURLcode res = curl_easy_perform(handle->curl);
+    TRACE_END(span);
+
+    http_pool_release(pool, handle);
+    return res == CURLE_OK ? ERR_OK : ERR_NETWORK;
+}
+
 // URL encoding (basic implementation)
 str_t http_url_encode(const char* str) {
     if (!str) return STR_NULL;
@@ -453,11 +1119,13 @@ typedef struct {
     char* buffer;
     size_t buffer_size;
     size_t buffer_capacity;
+    capture_record_t* capture;
 } stream_context_t;
 
 static size_t stream_write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
     stream_context_t* ctx = (stream_context_t*)userp;
     size_t total_size = size * nmemb;
+    if (ctx->capture) capture_chunk(ctx->capture, (const char*)contents, total_size);
 
     // Call user callback with the chunk
     if (ctx->user_callback) {
@@ -472,50 +1140,33 @@ static size_t stream_write_callback(void* contents, size_t size, size_t nmemb, v
 static err_t perform_stream_request(http_client_t* client, const char* method, const char* url,
                                    const char* body, size_t body_len,
                                    const char* content_type,
-                                   http_write_callback_t callback, void* user_data) {
-    if (!client || !client->curl || !url || !callback) return ERR_INVALID_ARGUMENT;
+                                   http_write_callback_t callback, void* user_data,
+                                   http_response_t** out_status) {
+    if (!client || !client->pool || !url || !callback) return ERR_INVALID_ARGUMENT;
 
     // Build full URL
     char full_url[2048];
-    if (client->config.base_url.data && strncmp(url, "http", 4) != 0) {
-        snprintf(full_url, sizeof(full_url), "%.*s%s",
-                 (int)client->config.base_url.len, client->config.base_url.data, url);
-    } else {
-        strncpy(full_url, url, sizeof(full_url) - 1);
-        full_url[sizeof(full_url) - 1] = '\0';
-    }
+    build_full_url(client, url, full_url, sizeof(full_url));
+
+    char host[256];
+    extract_host(full_url, host, sizeof(host));
+
+    // Check out a keep-alive handle
+    http_pool_t* pool = (http_pool_t*)client->pool;
+    http_pool_handle_t* handle = http_pool_acquire(pool, host);
+    if (!handle) return ERR_OUT_OF_MEMORY;
+    CURL* curl = handle->curl;
 
-    // Reset curl handle
-    curl_easy_reset(client->curl);
+    curl_easy_reset(curl);
+    apply_client_options(client, curl);
 
     // Set URL
-    curl_easy_setopt(client->curl, CURLOPT_URL, full_url);
+    curl_easy_setopt(curl, CURLOPT_URL, full_url);
 
     // Set method and body
-    if (strcmp(method, "GET") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_HTTPGET, 1L);
-    } else if (strcmp(method, "POST") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_POST, 1L);
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "PUT") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_UPLOAD, 0L);
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "PUT");
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "PATCH") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-        if (body && body_len > 0) {
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, body);
-            curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)body_len);
-        }
-    } else if (strcmp(method, "DELETE") == 0) {
-        curl_easy_setopt(client->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-    }
+    capture_record_t* capture = capture_begin(method, full_url, body, body_len, true);
+    char* gz_body = compress_body(client, body, &body_len);
+    apply_method(curl, method, gz_body ? gz_body : body, body_len);
 
     // Set streaming callback
     stream_context_t stream_ctx = {
@@ -523,69 +1174,577 @@ static err_t perform_stream_request(http_client_t* client, const char* method, c
         .user_data = user_data,
         .buffer = NULL,
         .buffer_size = 0,
-        .buffer_capacity = 0
+        .buffer_capacity = 0,
+        .capture = capture
     };
 
-    curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
-    curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, &stream_ctx);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream_ctx);
 
-    // Set headers
-    struct curl_slist* headers = NULL;
-    if (content_type) {
-        char ct_header[256];
-        snprintf(ct_header, sizeof(ct_header), "Content-Type: %s", content_type);
-        headers = curl_slist_append(headers, ct_header);
-    }
-    headers = curl_slist_append(headers, "Accept: application/json");
-
-    // Accept SSE streams
-    headers = curl_slist_append(headers, "Accept: text/event-stream");
-
-    // Add default headers
-    for (uint32_t i = 0; i < client->default_headers_count; i++) {
-        char header[1024];
-        snprintf(header, sizeof(header), "%.*s: %.*s",
-                 (int)client->default_headers[i].name.len, client->default_headers[i].name.data,
-                 (int)client->default_headers[i].value.len, client->default_headers[i].value.data);
-        headers = curl_slist_append(headers, header);
+    header_list_t response_headers = {0};
+    if (out_status || capture) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
     }
 
+    // Set headers
+    struct curl_slist* headers = build_header_list(client, content_type, true, gz_body != NULL);
     if (headers) {
-        curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     }
 
     // Perform request
-    CURLcode res = curl_easy_perform(client->curl);
+    TRACE_BEGIN(span, "http.request");
+    TRACE_DETAIL(span, STR_VIEW(host));
+    CURLcode res = curl_easy_perform(curl);
+    TRACE_END(span);
+
+    long http_code = 0;
+    if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-    // Cleanup headers
+    // Cleanup headers and hand the handle back
     if (headers) curl_slist_free_all(headers);
+    free(gz_body);
+    http_pool_release(pool, handle);
 
     // Cleanup buffer
     free(stream_ctx.buffer);
 
     if (res != CURLE_OK) {
+        capture_abort(capture);
+        header_list_free(&response_headers);
         return ERR_NETWORK;
     }
 
+    capture_end(capture, (uint32_t)http_code, response_headers.items, response_headers.count, NULL, 0);
+
+    if (out_status) {
+        http_response_t* status = calloc(1, sizeof(http_response_t));
+        if (!status) {
+            header_list_free(&response_headers);
+            return ERR_OUT_OF_MEMORY;
+        }
+        status->status_code = (uint32_t)http_code;
+        header_list_move(&response_headers, status);
+        *out_status = status;
+    }
+    header_list_free(&response_headers);
+
     return ERR_OK;
 }
 
 // HTTP GET with streaming
 err_t http_get_stream(http_client_t* client, const char* url,
                       http_write_callback_t callback, void* user_data) {
-    return perform_stream_request(client, "GET", url, NULL, 0, NULL, callback, user_data);
+    return perform_stream_request(client, "GET", url, NULL, 0, NULL, callback, user_data, NULL);
 }
 
 // HTTP POST with streaming
 err_t http_post_stream(http_client_t* client, const char* url, const char* body,
                        http_write_callback_t callback, void* user_data) {
     return perform_stream_request(client, "POST", url, body, body ? strlen(body) : 0,
-                                  "application/x-www-form-urlencoded", callback, user_data);
+                                  "application/x-www-form-urlencoded", callback, user_data, NULL);
 }
 
 // HTTP POST JSON with streaming
 err_t http_post_json_stream(http_client_t* client, const char* url, const char* json_body,
                             http_write_callback_t callback, void* user_data) {
     return perform_stream_request(client, "POST", url, json_body, json_body ? strlen(json_body) : 0,
-                                  "application/json", callback, user_data);
+                                  "application/json", callback, user_data, NULL);
+}
+
+err_t http_post_json_stream_status(http_client_t* client, const char* url, const char* json_body,
+                                   http_write_callback_t callback, void* user_data,
+                                   http_response_t** out_status) {
+    if (!out_status) return ERR_INVALID_ARGUMENT;
+    return perform_stream_request(client, "POST", url, json_body, json_body ? strlen(json_body) : 0,
+                                  "application/json", callback, user_data, out_status);
+}
+
+// ============================================================================
+// Async Engine (curl_multi driven by libuv)
+// ============================================================================
+
+// In-flight async request
+typedef struct http_async_request_t {
+    http_engine_t* engine;
+    CURL* curl;
+    struct curl_slist* headers;
+    char* body;                        // Owned copy of the request body
+    memory_buffer_t buffer;            // Buffered response body
+    stream_context_t stream;           // Streaming sink (when on_data set)
+    bool streaming;
+    header_list_t headers_in;          // Response headers
+    capture_record_t* capture;         // While http_capture_start is on
+    http_async_callback_t on_done;
+    void* user_data;
+    uint64_t tag;                      // Cancellation group (http_engine_set_tag)
+    struct http_async_request_t* prev;
+    struct http_async_request_t* next;
+} http_async_request_t;
+
+// Per-socket poll watcher
+typedef struct http_async_socket_t {
+    uv_poll_t poll;
+    http_engine_t* engine;
+    curl_socket_t fd;
+} http_async_socket_t;
+
+struct http_engine_t {
+    uv_loop_t* loop;
+    uv_timer_t timer;
+    uv_timer_t wake;                   // Bounds http_engine_run_once
+    uint32_t open_handles;             // Engine is freed when both timers closed
+    CURLM* multi;
+    http_async_request_t* requests;    // In-flight list
+    uint32_t pending;
+    uint64_t tag;                      // Applied to new requests
+};
+
+static void async_check_multi_info(http_engine_t* engine);
+
+static void async_request_free(http_async_request_t* req) {
+    capture_abort(req->capture);
+    if (req->curl) curl_easy_cleanup(req->curl);
+    if (req->headers) curl_slist_free_all(req->headers);
+    free(req->body);
+    free(req->buffer.data);
+    header_list_free(&req->headers_in);
+    free(req);
+}
+
+static void async_request_unlink(http_async_request_t* req) {
+    http_engine_t* engine = req->engine;
+    if (req->prev) req->prev->next = req->next;
+    else engine->requests = req->next;
+    if (req->next) req->next->prev = req->prev;
+    engine->pending--;
+}
+
+// Finish a request: build the response, run the callback, free the request
+static void async_request_complete(http_async_request_t* req, CURLcode result) {
+    http_engine_t* engine = req->engine;
+
+    curl_multi_remove_handle(engine->multi, req->curl);
+    async_request_unlink(req);
+
+    err_t err = ERR_OK;
+    http_response_t* response = NULL;
+
+    if (result == CURLE_ABORTED_BY_CALLBACK) {
+        err = ERR_CANCELLED;
+    } else if (result != CURLE_OK) {
+        err = ERR_NETWORK;
+    } else {
+        response = calloc(1, sizeof(http_response_t));
+        if (!response) {
+            err = ERR_OUT_OF_MEMORY;
+        } else {
+            long http_code = 0;
+            double total_time = 0.0;
+            curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &http_code);
+            curl_easy_getinfo(req->curl, CURLINFO_TOTAL_TIME, &total_time);
+
+            response->status_code = (uint32_t)http_code;
+            response->request_time_ms = total_time * 1000.0;
+
+            // Move buffer to response
+            response->body.data = req->buffer.data;
+            response->body.len = (uint32_t)req->buffer.size;
+            req->buffer.data = NULL;
+            header_list_move(&req->headers_in, response);
+
+            capture_end(req->capture, response->status_code, response->headers, response->headers_count,
+                        response->body.data, response->body.len);
+            req->capture = NULL;
+        }
+    }
+
+    if (req->on_done) {
+        req->on_done(err, response, req->user_data);
+    } else if (response) {
+        http_response_free(response);
+    }
+
+    async_request_free(req);
+}
+
+static void async_check_multi_info(http_engine_t* engine) {
+    CURLMsg* msg;
+    int pending_msgs;
+
+    while ((msg = curl_multi_info_read(engine->multi, &pending_msgs))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        http_async_request_t* req = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+        if (req) async_request_complete(req, msg->data.result);
+    }
+}
+
+static void async_on_timeout(uv_timer_t* timer) {
+    http_engine_t* engine = (http_engine_t*)timer->data;
+    int running = 0;
+    curl_multi_socket_action(engine->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    async_check_multi_info(engine);
+}
+
+static int async_timer_callback(CURLM* multi, long timeout_ms, void* userp) {
+    (void)multi;
+    http_engine_t* engine = (http_engine_t*)userp;
+
+    if (timeout_ms < 0) {
+        uv_timer_stop(&engine->timer);
+    } else {
+        uv_timer_start(&engine->timer, async_on_timeout, (uint64_t)timeout_ms, 0);
+    }
+    return 0;
+}
+
+static void async_on_poll(uv_poll_t* poll, int status, int events) {
+    http_async_socket_t* sock = (http_async_socket_t*)poll->data;
+    http_engine_t* engine = sock->engine;
+
+    int flags = 0;
+    if (status < 0) {
+        flags = CURL_CSELECT_ERR;
+    } else {
+        if (events & UV_READABLE) flags |= CURL_CSELECT_IN;
+        if (events & UV_WRITABLE) flags |= CURL_CSELECT_OUT;
+    }
+
+    int running = 0;
+    curl_multi_socket_action(engine->multi, sock->fd, flags, &running);
+    async_check_multi_info(engine);
+}
+
+static void async_on_socket_close(uv_handle_t* handle) {
+    free(handle->data);
+}
+
+static int async_socket_callback(CURL* easy, curl_socket_t fd, int action, void* userp, void* socketp) {
+    (void)easy;
+    http_engine_t* engine = (http_engine_t*)userp;
+    http_async_socket_t* sock = (http_async_socket_t*)socketp;
+
+    if (action == CURL_POLL_REMOVE) {
+        if (sock) {
+            uv_poll_stop(&sock->poll);
+            uv_close((uv_handle_t*)&sock->poll, async_on_socket_close);
+            curl_multi_assign(engine->multi, fd, NULL);
+        }
+        return 0;
+    }
+
+    if (!sock) {
+        sock = calloc(1, sizeof(http_async_socket_t));
+        if (!sock) return -1;
+        sock->engine = engine;
+        sock->fd = fd;
+        if (uv_poll_init_socket(engine->loop, &sock->poll, fd) != 0) {
+            free(sock);
+            return -1;
+        }
+        sock->poll.data = sock;
+        curl_multi_assign(engine->multi, fd, sock);
+    }
+
+    int events = 0;
+    if (action == CURL_POLL_IN || action == CURL_POLL_INOUT) events |= UV_READABLE;
+    if (action == CURL_POLL_OUT || action == CURL_POLL_INOUT) events |= UV_WRITABLE;
+
+    uv_poll_start(&sock->poll, events, async_on_poll);
+    return 0;
+}
+
+http_engine_t* http_engine_create(void* loop) {
+    http_engine_t* engine = calloc(1, sizeof(http_engine_t));
+    if (!engine) return NULL;
+
+    engine->loop = loop ? (uv_loop_t*)loop : uv_default_loop();
+
+    engine->multi = curl_multi_init();
+    if (!engine->multi) {
+        free(engine);
+        return NULL;
+    }
+
+    uv_timer_init(engine->loop, &engine->timer);
+    engine->timer.data = engine;
+    uv_timer_init(engine->loop, &engine->wake);
+    engine->wake.data = engine;
+    engine->open_handles = 2;
+
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETFUNCTION, async_socket_callback);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERFUNCTION, async_timer_callback);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+#ifdef CURLPIPE_MULTIPLEX
+    curl_multi_setopt(engine->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+    return engine;
+}
+
+static void async_on_timer_close(uv_handle_t* handle) {
+    http_engine_t* engine = (http_engine_t*)handle->data;
+    if (--engine->open_handles == 0) free(engine);
+}
+
+void http_engine_destroy(http_engine_t* engine) {
+    if (!engine) return;
+
+    // Cancel everything still in flight
+    while (engine->requests) {
+        async_request_complete(engine->requests, CURLE_ABORTED_BY_CALLBACK);
+    }
+
+    curl_multi_cleanup(engine->multi);
+    engine->multi = NULL;
+
+    // Engine memory is released by the timer close callback
+    uv_timer_stop(&engine->timer);
+    uv_close((uv_handle_t*)&engine->timer, async_on_timer_close);
+    uv_timer_stop(&engine->wake);
+    uv_close((uv_handle_t*)&engine->wake, async_on_timer_close);
+
+    if (engine == g_default_engine) g_default_engine = NULL;
+
+    // Let pending close callbacks run
+    uv_run(engine->loop, UV_RUN_NOWAIT);
+}
+
+err_t http_engine_run(http_engine_t* engine) {
+    if (!engine) return ERR_INVALID_ARGUMENT;
+
+    while (engine->pending > 0) {
+        uv_run(engine->loop, UV_RUN_ONCE);
+    }
+    return ERR_OK;
+}
+
+static void async_on_wake(uv_timer_t* timer) {
+    (void)timer;
+}
+
+err_t http_engine_run_once(http_engine_t* engine, uint32_t timeout_ms) {
+    if (!engine) return ERR_INVALID_ARGUMENT;
+
+    if (timeout_ms != HTTP_ENGINE_WAIT_FOREVER) uv_timer_start(&engine->wake, async_on_wake, timeout_ms, 0);
+    uv_run(engine->loop, UV_RUN_ONCE);
+    uv_timer_stop(&engine->wake);
+    return ERR_OK;
+}
+
+void http_engine_set_tag(http_engine_t* engine, uint64_t tag) {
+    if (engine) engine->tag = tag;
+}
+
+uint32_t http_engine_cancel(http_engine_t* engine, uint64_t tag) {
+    if (!engine || !tag) return 0;
+
+    // Completing a request may submit or cancel others, so rescan each time
+    uint32_t cancelled = 0;
+    for (;;) {
+        http_async_request_t* req = engine->requests;
+        while (req && req->tag != tag) req = req->next;
+        if (!req) break;
+        async_request_complete(req, CURLE_ABORTED_BY_CALLBACK);
+        cancelled++;
+    }
+    return cancelled;
+}
+
+uint32_t http_engine_pending(const http_engine_t* engine) {
+    return engine ? engine->pending : 0;
+}
+
+void* http_engine_get_loop(const http_engine_t* engine) {
+    return engine ? engine->loop : NULL;
+}
+
+http_engine_t* http_engine_default(void) {
+    if (!g_default_engine) {
+        g_default_engine = http_engine_create(NULL);
+    }
+    return g_default_engine;
+}
+
+// Per-thread engines run on a private loop owned by the thread
+static pthread_key_t g_thread_engine_key;
+static pthread_once_t g_thread_engine_once = PTHREAD_ONCE_INIT;
+static __thread http_engine_t* t_engine;
+
+static void thread_engine_release(void* data) {
+    http_engine_t* engine = (http_engine_t*)data;
+    uv_loop_t* loop = engine->loop;
+    http_engine_destroy(engine);
+    uv_run(loop, UV_RUN_NOWAIT);
+    uv_loop_close(loop);
+    free(loop);
+}
+
+static void thread_engine_key_create(void) {
+    pthread_key_create(&g_thread_engine_key, thread_engine_release);
+}
+
+http_engine_t* http_engine_thread(void) {
+    if (t_engine) return t_engine;
+
+    pthread_once(&g_thread_engine_once, thread_engine_key_create);
+    uv_loop_t* loop = malloc(sizeof(uv_loop_t));
+    if (!loop) return NULL;
+    if (uv_loop_init(loop) != 0) {
+        free(loop);
+        return NULL;
+    }
+
+    http_engine_t* engine = http_engine_create(loop);
+    if (!engine || pthread_setspecific(g_thread_engine_key, engine) != 0) {
+        if (engine) http_engine_destroy(engine);
+        uv_run(loop, UV_RUN_NOWAIT);
+        uv_loop_close(loop);
+        free(loop);
+        return NULL;
+    }
+    t_engine = engine;
+    return engine;
+}
+
+static err_t async_submit(http_engine_t* engine, http_client_t* client,
+                          const char* method, const char* url,
+                          const char* body, size_t body_len,
+                          const char* content_type,
+                          http_write_callback_t on_data,
+                          http_async_callback_t on_done, void* user_data) {
+    if (!engine || !client || !client->pool || !method || !url) return ERR_INVALID_ARGUMENT;
+
+    http_async_request_t* req = calloc(1, sizeof(http_async_request_t));
+    if (!req) return ERR_OUT_OF_MEMORY;
+
+    req->engine = engine;
+    req->on_done = on_done;
+    req->user_data = user_data;
+    req->tag = engine->tag;
+
+    req->curl = curl_easy_init();
+    if (!req->curl) {
+        free(req);
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    char full_url[2048];
+    build_full_url(client, url, full_url, sizeof(full_url));
+    req->capture = capture_begin(method, full_url, body, body_len, on_data != NULL);
+
+    // Body must outlive this call
+    req->body = compress_body(client, body, &body_len);
+    bool gzip_body = req->body != NULL;
+    if (!gzip_body && body && body_len > 0) {
+        req->body = malloc(body_len);
+        if (!req->body) {
+            async_request_free(req);
+            return ERR_OUT_OF_MEMORY;
+        }
+        memcpy(req->body, body, body_len);
+    }
+
+    apply_client_options(client, req->curl);
+    curl_easy_setopt(req->curl, CURLOPT_URL, full_url);
+    curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+    apply_method(req->curl, method, req->body, body_len);
+
+    if (on_data) {
+        req->streaming = true;
+        req->stream.user_callback = on_data;
+        req->stream.user_data = user_data;
+        req->stream.capture = req->capture;
+        curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+        curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, &req->stream);
+    } else {
+        req->buffer.data = malloc(4096);
+        if (!req->buffer.data) {
+            async_request_free(req);
+            return ERR_OUT_OF_MEMORY;
+        }
+        req->buffer.data[0] = '\0';
+        req->buffer.capacity = 4096;
+        req->buffer.curl = req->curl;
+        curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, &req->buffer);
+    }
+    curl_easy_setopt(req->curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(req->curl, CURLOPT_HEADERDATA, &req->headers_in);
+
+    req->headers = build_header_list(client, content_type, req->streaming, gzip_body);
+    if (req->headers) {
+        curl_easy_setopt(req->curl, CURLOPT_HTTPHEADER, req->headers);
+    }
+
+    if (curl_multi_add_handle(engine->multi, req->curl) != CURLM_OK) {
+        async_request_free(req);
+        return ERR_NETWORK;
+    }
+
+    // Link in-flight request
+    req->next = engine->requests;
+    if (engine->requests) engine->requests->prev = req;
+    engine->requests = req;
+    engine->pending++;
+
+    return ERR_OK;
+}
+
+err_t http_request_async(http_engine_t* engine, http_client_t* client,
+                         const char* method, const char* url,
+                         const char* body, size_t body_len,
+                         const char* content_type,
+                         http_async_callback_t on_done, void* user_data) {
+    return async_submit(engine, client, method, url, body, body_len, content_type,
+                        NULL, on_done, user_data);
+}
+
+err_t http_post_json_async(http_engine_t* engine, http_client_t* client,
+                           const char* url, const char* json_body,
+                           http_async_callback_t on_done, void* user_data) {
+    return async_submit(engine, client, "POST", url, json_body, json_body ? strlen(json_body) : 0,
+                        "application/json", NULL, on_done, user_data);
+}
+
+err_t http_post_json_stream_async(http_engine_t* engine, http_client_t* client,
+                                  const char* url, const char* json_body,
+                                  http_write_callback_t on_data,
+                                  http_async_callback_t on_done, void* user_data) {
+    if (!on_data) return ERR_INVALID_ARGUMENT;
+    return async_submit(engine, client, "POST", url, json_body, json_body ? strlen(json_body) : 0,
+                        "application/json", on_data, on_done, user_data);
+}
+
+// Adapter for the legacy single-argument callback
+typedef struct {
+    http_callback_t callback;
+    void* user_data;
+} async_get_ctx_t;
+
+static void async_get_done(err_t err, http_response_t* response, void* user_data) {
+    (void)err;
+    async_get_ctx_t* ctx = (async_get_ctx_t*)user_data;
+    ctx->callback(response, ctx->user_data);
+    free(ctx);
+}
+
+err_t http_get_async(http_client_t* client, const char* url, http_callback_t callback, void* user_data) {
+    if (!client || !url || !callback) return ERR_INVALID_ARGUMENT;
+
+    http_engine_t* engine = http_engine_default();
+    if (!engine) return ERR_OUT_OF_MEMORY;
+
+    async_get_ctx_t* ctx = malloc(sizeof(async_get_ctx_t));
+    if (!ctx) return ERR_OUT_OF_MEMORY;
+    ctx->callback = callback;
+    ctx->user_data = user_data;
+
+    err_t err = async_submit(engine, client, "GET", url, NULL, 0, NULL, NULL, async_get_done, ctx);
+    if (err != ERR_OK) free(ctx);
+    return err;
 }
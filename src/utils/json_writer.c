@@ -0,0 +1,359 @@
+// json_writer.c - Streaming JSON writer for CClaw
+// SPDX-License-Identifier: MIT
+
+#include "utils/json_writer.h"
+#include "core/alloc.h"
+#include "utils/text_scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <zlib.h>
+
+#define JSON_WRITER_DEFAULT_CAPACITY 1024
+
+// ============================================================================
+// Buffer
+// ============================================================================
+
+// Deflate the staged text into gz_data and empty the stage
+static bool writer_deflate(json_writer_t* w, int flush) {
+    z_stream* zs = w->gzip;
+    zs->next_in = (Bytef*)w->data;
+    zs->avail_in = (uInt)w->len;
+
+    int rc;
+    do {
+        if (w->gz_cap - w->gz_len < 1024) {
+            size_t new_cap = w->gz_cap ? w->gz_cap * 2 : JSON_WRITER_GZIP_CHUNK / 2;
+            char* new_data = realloc(w->gz_data, new_cap);
+            if (!new_data) {
+                w->failed = true;
+                return false;
+            }
+            alloc_tag_add(ALLOC_TAG_JSON, new_cap - w->gz_cap);
+            w->gz_data = new_data;
+            w->gz_cap = new_cap;
+        }
+        // One byte stays free for the terminating NUL
+        uInt room = (uInt)(w->gz_cap - w->gz_len - 1);
+        zs->next_out = (Bytef*)w->gz_data + w->gz_len;
+        zs->avail_out = room;
+        rc = deflate(zs, flush);
+        if (rc == Z_STREAM_ERROR) {
+            w->failed = true;
+            return false;
+        }
+        w->gz_len += room - zs->avail_out;
+    } while (zs->avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+
+    w->len = 0;
+    return true;
+}
+
+static bool writer_reserve(json_writer_t* w, size_t extra) {
+    if (w->failed) return false;
+    if (w->len + extra + 1 <= w->cap) return true;
+
+    // A gzip writer drains the stage before it grows it
+    if (w->gzip && w->len > 0) {
+        if (!writer_deflate(w, Z_NO_FLUSH)) return false;
+        if (extra + 1 <= w->cap) return true;
+    }
+
+    size_t new_cap = w->cap ? w->cap : JSON_WRITER_DEFAULT_CAPACITY;
+    while (new_cap < w->len + extra + 1) new_cap *= 2;
+
+    char* new_data = realloc(w->data, new_cap);
+    if (!new_data) {
+        w->failed = true;
+        return false;
+    }
+
+    alloc_tag_add(ALLOC_TAG_JSON, new_cap - w->cap);
+    w->data = new_data;
+    w->cap = new_cap;
+    return true;
+}
+
+static void writer_append(json_writer_t* w, const char* data, size_t len) {
+    if (!writer_reserve(w, len)) return;
+    memcpy(w->data + w->len, data, len);
+    w->len += len;
+}
+
+static void writer_putc(json_writer_t* w, char c) {
+    if (!writer_reserve(w, 1)) return;
+    w->data[w->len++] = c;
+}
+
+// Emit the separator owed before a value in the current container
+static void writer_before_value(json_writer_t* w) {
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth == 0 || w->depth > JSON_WRITER_MAX_DEPTH) return;
+
+    uint64_t bit = 1ULL << (w->depth - 1);
+    if (w->has_items & bit) writer_putc(w, ',');
+    w->has_items |= bit;
+}
+
+void json_writer_init(json_writer_t* w, size_t initial_capacity) {
+    memset(w, 0, sizeof(json_writer_t));
+    if (initial_capacity > 0) writer_reserve(w, initial_capacity);
+}
+
+void json_writer_init_gzip(json_writer_t* w, int level) {
+    json_writer_init(w, JSON_WRITER_GZIP_CHUNK);
+
+    z_stream* zs = calloc(1, sizeof(z_stream));
+    // windowBits 15 + 16 selects the gzip wrapper
+    if (!zs || deflateInit2(zs, level > 0 ? level : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                            Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(zs);
+        w->failed = true;
+        return;
+    }
+    w->gzip = zs;
+}
+
+static void writer_gzip_end(json_writer_t* w) {
+    if (!w->gzip) return;
+    deflateEnd(w->gzip);
+    free(w->gzip);
+    w->gzip = NULL;
+}
+
+void json_writer_free(json_writer_t* w) {
+    if (!w) return;
+    writer_gzip_end(w);
+    alloc_tag_sub(ALLOC_TAG_JSON, w->cap + w->gz_cap);
+    free(w->data);
+    free(w->gz_data);
+    memset(w, 0, sizeof(json_writer_t));
+}
+
+void json_writer_reset(json_writer_t* w) {
+    if (w->gzip) {
+        deflateReset(w->gzip);
+        w->gz_len = 0;
+    }
+    w->len = 0;
+    w->depth = 0;
+    w->has_items = 0;
+    w->after_key = false;
+    w->failed = false;
+}
+
+char* json_writer_finish(json_writer_t* w, size_t* out_len) {
+    if (w->failed || !writer_reserve(w, 0)) {
+        json_writer_free(w);
+        return NULL;
+    }
+
+    if (w->gzip) {
+        if (!writer_deflate(w, Z_FINISH)) {
+            json_writer_free(w);
+            return NULL;
+        }
+        writer_gzip_end(w);
+        free(w->data);
+        w->data = w->gz_data;
+        w->len = w->gz_len;
+    }
+
+    // The caller owns the buffer from here
+    alloc_tag_sub(ALLOC_TAG_JSON, w->cap + w->gz_cap);
+    w->data[w->len] = '\0';
+    if (out_len) *out_len = w->len;
+
+    char* result = w->data;
+    memset(w, 0, sizeof(json_writer_t));
+    return result;
+}
+
+// ============================================================================
+// Containers
+// ============================================================================
+
+static void writer_open(json_writer_t* w, char c) {
+    writer_before_value(w);
+    writer_putc(w, c);
+    w->depth++;
+    if (w->depth <= JSON_WRITER_MAX_DEPTH) {
+        w->has_items &= ~(1ULL << (w->depth - 1));
+    }
+}
+
+static void writer_close(json_writer_t* w, char c) {
+    if (w->depth > 0) w->depth--;
+    w->after_key = false;
+    writer_putc(w, c);
+}
+
+void json_write_object_begin(json_writer_t* w) { writer_open(w, '{'); }
+void json_write_object_end(json_writer_t* w) { writer_close(w, '}'); }
+void json_write_array_begin(json_writer_t* w) { writer_open(w, '['); }
+void json_write_array_end(json_writer_t* w) { writer_close(w, ']'); }
+
+// ============================================================================
+// Strings
+// ============================================================================
+
+// Escape table: 0 = copy as-is, otherwise the escape letter ('u' for \u00XX)
+static const char g_escape[256] = {
+    ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r',
+    ['"'] = '"', ['\\'] = '\\',
+    [0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u', [0x04] = 'u',
+    [0x05] = 'u', [0x06] = 'u', [0x07] = 'u', [0x0B] = 'u', [0x0E] = 'u',
+    [0x0F] = 'u', [0x10] = 'u', [0x11] = 'u', [0x12] = 'u', [0x13] = 'u',
+    [0x14] = 'u', [0x15] = 'u', [0x16] = 'u', [0x17] = 'u', [0x18] = 'u',
+    [0x19] = 'u', [0x1A] = 'u', [0x1B] = 'u', [0x1C] = 'u', [0x1D] = 'u',
+    [0x1E] = 'u', [0x1F] = 'u'
+};
+
+// str is well-formed UTF-8
+static void write_escaped_valid(json_writer_t* w, const char* str, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    // Common case: nothing to escape, or only a few escapes
+    if (!writer_reserve(w, len)) return;
+
+    size_t run_start = 0;
+    for (size_t i = 0; i < len; i++) {
+        // Clean runs are found a vector at a time and copied whole
+        i += text_scan_json_escape(str + i, len - i);
+        if (i == len) break;
+        unsigned char c = (unsigned char)str[i];
+        char esc = g_escape[c];
+
+        writer_append(w, str + run_start, i - run_start);
+        if (esc == 'u') {
+            char buf[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            writer_append(w, buf, sizeof(buf));
+        } else {
+            char buf[2] = { '\\', esc };
+            writer_append(w, buf, sizeof(buf));
+        }
+        run_start = i + 1;
+    }
+    writer_append(w, str + run_start, len - run_start);
+}
+
+void json_write_escaped(json_writer_t* w, const char* str, size_t len) {
+    // Providers reject bodies that are not UTF-8, so a byte that does not
+    // belong to a well-formed sequence is written as U+FFFD
+    for (;;) {
+        size_t valid = text_utf8_valid_prefix(str, len);
+        write_escaped_valid(w, str, valid);
+        if (valid == len) return;
+        writer_append(w, "\\ufffd", 6);
+        str += valid + 1;
+        len -= valid + 1;
+    }
+}
+
+void json_write_string_len(json_writer_t* w, const char* str, size_t len) {
+    writer_before_value(w);
+    writer_putc(w, '"');
+    if (str) json_write_escaped(w, str, len);
+    writer_putc(w, '"');
+}
+
+void json_write_string(json_writer_t* w, const char* str) {
+    json_write_string_len(w, str, str ? strlen(str) : 0);
+}
+
+void json_write_str(json_writer_t* w, str_t str) {
+    json_write_string_len(w, str.data, str.data ? str.len : 0);
+}
+
+void json_write_key(json_writer_t* w, const char* key) {
+    json_write_string(w, key);
+    writer_putc(w, ':');
+    w->after_key = true;
+}
+
+// ============================================================================
+// Scalars
+// ============================================================================
+
+void json_write_int(json_writer_t* w, int64_t value) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%lld", (long long)value);
+    writer_before_value(w);
+    writer_append(w, buf, (size_t)n);
+}
+
+void json_write_number(json_writer_t* w, double value) {
+    if (!isfinite(value)) {
+        json_write_null(w);
+        return;
+    }
+
+    // Integers print exactly; other values use the shortest round-trip form
+    if (value == floor(value) && fabs(value) < 9007199254740992.0) {
+        json_write_int(w, (int64_t)value);
+        return;
+    }
+
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%.15g", value);
+    if (strtod(buf, NULL) != value) {
+        n = snprintf(buf, sizeof(buf), "%.17g", value);
+    }
+
+    writer_before_value(w);
+    writer_append(w, buf, (size_t)n);
+}
+
+void json_write_bool(json_writer_t* w, bool value) {
+    writer_before_value(w);
+    if (value) {
+        writer_append(w, "true", 4);
+    } else {
+        writer_append(w, "false", 5);
+    }
+}
+
+void json_write_null(json_writer_t* w) {
+    writer_before_value(w);
+    writer_append(w, "null", 4);
+}
+
+void json_write_raw(json_writer_t* w, const char* json, size_t len) {
+    writer_before_value(w);
+    writer_append(w, json, len);
+}
+
+// ============================================================================
+// Key/value shorthands
+// ============================================================================
+
+void json_write_kv_string(json_writer_t* w, const char* key, const char* value) {
+    json_write_key(w, key);
+    json_write_string(w, value);
+}
+
+void json_write_kv_str(json_writer_t* w, const char* key, str_t value) {
+    json_write_key(w, key);
+    json_write_str(w, value);
+}
+
+void json_write_kv_number(json_writer_t* w, const char* key, double value) {
+    json_write_key(w, key);
+    json_write_number(w, value);
+}
+
+void json_write_kv_int(json_writer_t* w, const char* key, int64_t value) {
+    json_write_key(w, key);
+    json_write_int(w, value);
+}
+
+void json_write_kv_bool(json_writer_t* w, const char* key, bool value) {
+    json_write_key(w, key);
+    json_write_bool(w, value);
+}
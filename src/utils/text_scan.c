@@ -0,0 +1,311 @@
+// text_scan.c - Vectorized scans for JSON strings and UTF-8 text
+// SPDX-License-Identifier: MIT
+
+#include "utils/text_scan.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define TEXT_SCAN_HAVE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TEXT_SCAN_HAVE_NEON 1
+#endif
+
+// Below this a vector setup costs more than the loop it replaces
+#define TEXT_SCAN_MIN_VECTOR 16
+
+typedef size_t (*scan_fn_t)(const char* s, size_t len);
+
+typedef struct scan_kernels_t {
+    scan_fn_t json_escape;
+    scan_fn_t json_special;
+    scan_fn_t non_ascii;
+} scan_kernels_t;
+
+// ============================================================================
+// Scalar
+// ============================================================================
+
+static size_t scalar_json_escape(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x20 || c == '"' || c == '\\') return i;
+    }
+    return len;
+}
+
+static size_t scalar_json_special(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '"' || s[i] == '\\') return i;
+    }
+    return len;
+}
+
+static size_t scalar_non_ascii(const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)s[i] >= 0x80) return i;
+    }
+    return len;
+}
+
+// ============================================================================
+// SSE2 and AVX2
+// ============================================================================
+
+#ifdef TEXT_SCAN_HAVE_X86
+
+// SSE2 is part of x86-64, so these need no target attribute
+static size_t sse2_json_escape(const char* s, size_t len) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        // min(v, 0x1F) == v exactly for the bytes <= 0x1F, unsigned
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scalar_json_escape(s + i, len - i);
+}
+
+static size_t sse2_json_special(const char* s, size_t len) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scalar_json_special(s + i, len - i);
+}
+
+static size_t sse2_non_ascii(const char* s, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        // The sign bit of each byte is the mask
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scalar_non_ascii(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_json_escape(const char* s, size_t len) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                      _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + sse2_json_escape(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_json_special(const char* s, size_t len) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + sse2_json_special(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_non_ascii(const char* s, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(s + i)));
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + sse2_non_ascii(s + i, len - i);
+}
+
+#endif // TEXT_SCAN_HAVE_X86
+
+// ============================================================================
+// NEON
+// ============================================================================
+
+#ifdef TEXT_SCAN_HAVE_NEON
+
+// Narrow a byte mask to four bits per byte; the first hit is ctz / 4
+static inline uint64_t neon_mask(uint8x16_t hit) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+}
+
+static size_t neon_json_escape(const char* s, size_t len) {
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t control = vdupq_n_u8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(s + i));
+        uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)), vcleq_u8(v, control));
+        uint64_t mask = neon_mask(hit);
+        if (mask) return i + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    return i + scalar_json_escape(s + i, len - i);
+}
+
+static size_t neon_json_special(const char* s, size_t len) {
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(s + i));
+        uint64_t mask = neon_mask(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+        if (mask) return i + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    return i + scalar_json_special(s + i, len - i);
+}
+
+static size_t neon_non_ascii(const char* s, size_t len) {
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint64_t mask = neon_mask(vcgeq_u8(vld1q_u8((const uint8_t*)(s + i)), high));
+        if (mask) return i + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    return i + scalar_non_ascii(s + i, len - i);
+}
+
+#endif // TEXT_SCAN_HAVE_NEON
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+static const scan_kernels_t g_kernels[TEXT_SCAN_IMPL_COUNT] = {
+    [TEXT_SCAN_SCALAR] = { scalar_json_escape, scalar_json_special, scalar_non_ascii },
+#ifdef TEXT_SCAN_HAVE_X86
+    [TEXT_SCAN_SSE2] = { sse2_json_escape, sse2_json_special, sse2_non_ascii },
+    [TEXT_SCAN_AVX2] = { avx2_json_escape, avx2_json_special, avx2_non_ascii },
+#endif
+#ifdef TEXT_SCAN_HAVE_NEON
+    [TEXT_SCAN_NEON] = { neon_json_escape, neon_json_special, neon_non_ascii },
+#endif
+};
+
+static bool impl_available(text_scan_impl_t impl) {
+    if (impl >= TEXT_SCAN_IMPL_COUNT || !g_kernels[impl].json_escape) return false;
+#ifdef TEXT_SCAN_HAVE_X86
+    if (impl == TEXT_SCAN_AVX2) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return true;
+}
+
+// Index + 1 of the kernels in use, 0 until the first scan picks them
+static unsigned g_impl;
+
+static const scan_kernels_t* kernels(void) {
+    unsigned impl = __atomic_load_n(&g_impl, __ATOMIC_RELAXED);
+    if (!impl) {
+        impl = TEXT_SCAN_SCALAR + 1;
+        for (int i = TEXT_SCAN_IMPL_COUNT - 1; i > TEXT_SCAN_SCALAR; i--) {
+            if (impl_available((text_scan_impl_t)i)) {
+                impl = (unsigned)i + 1;
+                break;
+            }
+        }
+        // Every thread resolves the same answer, so racing here is harmless
+        __atomic_store_n(&g_impl, impl, __ATOMIC_RELAXED);
+    }
+    return &g_kernels[impl - 1];
+}
+
+text_scan_impl_t text_scan_impl(void) {
+    return (text_scan_impl_t)(kernels() - g_kernels);
+}
+
+bool text_scan_set_impl(text_scan_impl_t impl) {
+    if (!impl_available(impl)) return false;
+    __atomic_store_n(&g_impl, (unsigned)impl + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+const char* text_scan_impl_name(text_scan_impl_t impl) {
+    switch (impl) {
+        case TEXT_SCAN_SCALAR: return "scalar";
+        case TEXT_SCAN_SSE2:   return "sse2";
+        case TEXT_SCAN_AVX2:   return "avx2";
+        case TEXT_SCAN_NEON:   return "neon";
+        default:               return "unknown";
+    }
+}
+
+// ============================================================================
+// Scans
+// ============================================================================
+
+size_t text_scan_json_escape(const char* s, size_t len) {
+    if (len < TEXT_SCAN_MIN_VECTOR) return scalar_json_escape(s, len);
+    return kernels()->json_escape(s, len);
+}
+
+size_t text_scan_json_special(const char* s, size_t len) {
+    if (len < TEXT_SCAN_MIN_VECTOR) return scalar_json_special(s, len);
+    return kernels()->json_special(s, len);
+}
+
+size_t text_scan_non_ascii(const char* s, size_t len) {
+    if (len < TEXT_SCAN_MIN_VECTOR) return scalar_non_ascii(s, len);
+    return kernels()->non_ascii(s, len);
+}
+
+// Length of the well-formed multibyte sequence at s, 0 if there is none
+static size_t utf8_sequence(const unsigned char* s, size_t len) {
+    unsigned char c = s[0];
+    size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;    // Range of the second byte
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;          // Overlong
+        if (c == 0xED) hi = 0x9F;          // Surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;          // Overlong
+        if (c == 0xF4) hi = 0x8F;          // Past U+10FFFF
+    } else {
+        return 0;
+    }
+
+    if (n > len || s[1] < lo || s[1] > hi) return 0;
+    for (size_t i = 2; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+size_t text_utf8_valid_prefix(const char* s, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)s;
+    size_t i = 0;
+    while (i < len) {
+        // ASCII runs go by at vector speed; sequences are checked one by one
+        i += text_scan_non_ascii(s + i, len - i);
+        while (i < len && bytes[i] >= 0x80) {
+            size_t n = utf8_sequence(bytes + i, len - i);
+            if (!n) return i;
+            i += n;
+        }
+    }
+    return i;
+}
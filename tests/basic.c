@@ -4,9 +4,48 @@
 #include "cclaw.h"
 #include "core/types.h"
 #include "core/error.h"
+#include "core/alloc.h"
+#include "utils/http.h"
+#include "json_config.h"
+#include "utils/json_writer.h"
+#include "providers/base.h"
+#include "providers/router.h"
+#include "providers/ratelimit.h"
+#include "providers/response_cache.h"
+#include "providers/singleflight.h"
+#include "providers/batch.h"
+#include "providers/openai.h"
+#include "providers/anthropic.h"
+#include "providers/replay.h"
+#include "core/agent.h"
+#include "core/session_log.h"
+#include "core/tool.h"
+#include "core/channel.h"
+#include "core/config.h"
+#include "runtime/daemon.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "runtime/tui_screen.h"
+#include "runtime/tui_scrollback.h"
+#include "runtime/loadgen.h"
+#include "runtime/docker_pool.h"
+#include "utils/text_scan.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <dirent.h>
+#include <zlib.h>
 
 // Test utilities
 #define TEST_ASSERT(cond, msg) \
@@ -64,6 +103,18 @@ static bool test_platform(void) {
     return true;
 }
 
+#define INTERN_TEST_NAMES 500
+
+static void* intern_names(void* arg) {
+    str_t* names = arg;
+    for (int n = 0; n < INTERN_TEST_NAMES; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "tool_%d", n);
+        names[n] = str_intern_cstr(name);
+    }
+    return NULL;
+}
+
 static bool test_string_utils(void) {
     str_t s1 = STR_LIT("hello");
     str_t s2 = STR_LIT("world");
@@ -76,6 +127,28 @@ static bool test_string_utils(void) {
     TEST_ASSERT(str_empty(empty), "Empty string not recognized");
     TEST_ASSERT(!str_empty(s1), "Non-empty string incorrectly empty");
 
+    // Interned copies of equal strings share their data
+    char buf[] = "gpt-4o";
+    str_t a = str_intern(STR_VIEW(buf));
+    str_t b = str_intern_cstr("gpt-4o");
+    TEST_ASSERT(a.data && a.data == b.data && a.data != buf, "Equal strings interned apart");
+    TEST_ASSERT(a.data[a.len] == '\0', "Interned string not terminated");
+    TEST_ASSERT(str_intern(STR_LIT("gpt-4o-mini")).data != a.data, "Prefix collapsed");
+    TEST_ASSERT(str_intern(STR_NULL).data == NULL, "Empty string interned");
+
+    // And stay put while the table grows under other threads
+    pthread_t threads[4];
+    str_t names[4][INTERN_TEST_NAMES];
+    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, intern_names, names[i]);
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    for (int n = 0; n < INTERN_TEST_NAMES; n++) {
+        char name[32];
+        snprintf(name, sizeof(name), "tool_%d", n);
+        str_t mine = str_intern_cstr(name);
+        for (int i = 0; i < 4; i++) TEST_ASSERT(names[i][n].data == mine.data, "Threads got different copies");
+    }
+    TEST_ASSERT(str_intern_cstr("gpt-4o").data == a.data, "Interned string moved");
+
     return true;
 }
 
@@ -100,7 +173,3445 @@ static bool test_init_shutdown(void) {
     return true;
 }
 
+static bool write_text_file(const char* path, const char* text) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fputs(text, f);
+    return fclose(f) == 0;
+}
+
+static bool test_config_snapshot(void) {
+    char dir[] = "/tmp/cclaw_config_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL, "mkdtemp failed");
+    char path[64], snap[80];
+    snprintf(path, sizeof(path), "%s/config.json", dir);
+    snprintf(snap, sizeof(snap), "%s.snap", path);
+
+    const char* json_a = "{\"api_key\":\"sk-aaaa\",\"default_provider\":\"openai\",\"default_model\":\"gpt-4o\","
+                         "\"compress_requests\":true,\"memory\":{\"backend\":\"markdown\"},\"gateway\":{\"port\":9090}}";
+    TEST_ASSERT(write_text_file(path, json_a), "Write failed");
+
+    // First load parses and leaves a snapshot behind
+    config_t* parsed = NULL;
+    TEST_ASSERT(config_load(STR_VIEW(path), &parsed) == ERR_OK, "Load failed");
+    struct stat st;
+    TEST_ASSERT(stat(snap, &st) == 0 && (st.st_mode & 0777) == 0600, "Snapshot not written");
+
+    config_t* cached = NULL;
+    TEST_ASSERT(config_snapshot_load(path, NULL, &cached) == ERR_OK, "Snapshot load failed");
+    TEST_ASSERT(str_equal(cached->api_key, STR_LIT("sk-aaaa")) &&
+                str_equal(cached->default_provider, STR_LIT("openai")) &&
+                str_equal(cached->memory.backend, STR_LIT("markdown")), "Snapshot strings differ");
+    TEST_ASSERT(cached->gateway.port == 9090 && cached->compress_requests &&
+                cached->default_temperature == parsed->default_temperature, "Snapshot scalars differ");
+    TEST_ASSERT(cached->alloc != NULL && cached->channels.webhook == NULL, "Snapshot pointers not restored");
+    config_destroy(cached);
+
+    config_t* reloaded = NULL;
+    TEST_ASSERT(config_load(STR_VIEW(path), &reloaded) == ERR_OK, "Reload failed");
+    TEST_ASSERT(str_equal(reloaded->config_path, STR_VIEW(path)) &&
+                str_equal(reloaded->default_model, STR_LIT("gpt-4o")), "Reload differs");
+    config_destroy(reloaded);
+    config_destroy(parsed);
+
+    // String lists round trip
+    config_t* defaults = config_default(NULL);
+    TEST_ASSERT(config_snapshot_save(defaults, path) == ERR_OK, "Save failed");
+    TEST_ASSERT(config_snapshot_load(path, NULL, &cached) == ERR_OK, "Load of defaults failed");
+    TEST_ASSERT(cached->autonomy.allowed_commands_count == defaults->autonomy.allowed_commands_count &&
+                cached->autonomy.forbidden_paths_count == defaults->autonomy.forbidden_paths_count,
+                "List counts differ");
+    for (uint32_t i = 0; i < cached->autonomy.forbidden_paths_count; i++) {
+        TEST_ASSERT(str_equal(cached->autonomy.forbidden_paths[i], defaults->autonomy.forbidden_paths[i]),
+                    "List entry differs");
+    }
+    config_destroy(cached);
+
+    // Sections the snapshot can't encode are refused
+    struct { uint16_t port; str_t secret; } webhook = { 8443, STR_LIT("s") };
+    defaults->channels.webhook = (void*)&webhook;
+    TEST_ASSERT(config_snapshot_save(defaults, path) == ERR_NOT_IMPLEMENTED, "Section not refused");
+    defaults->channels.webhook = NULL;
+    config_destroy(defaults);
+
+    // Same size and mtime but different bytes: the hash catches it
+    TEST_ASSERT(stat(path, &st) == 0, "Stat failed");
+    char* json_b = strdup(json_a);
+    memcpy(strstr(json_b, "sk-aaaa"), "sk-bbbb", 7);
+    TEST_ASSERT(write_text_file(path, json_b), "Rewrite failed");
+    free(json_b);
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    TEST_ASSERT(utimensat(AT_FDCWD, path, times, 0) == 0, "utimensat failed");
+    TEST_ASSERT(config_snapshot_load(path, NULL, &cached) == ERR_NOT_FOUND, "Stale snapshot used");
+
+    config_t* fresh = NULL;
+    TEST_ASSERT(config_load(STR_VIEW(path), &fresh) == ERR_OK &&
+                str_equal(fresh->api_key, STR_LIT("sk-bbbb")), "Changed file not reparsed");
+    config_destroy(fresh);
+
+    // A damaged snapshot is ignored rather than trusted
+    FILE* f = fopen(snap, "r+b");
+    TEST_ASSERT(f != NULL, "Open snapshot failed");
+    fseek(f, -2, SEEK_END);
+    fputc('#', f);
+    fclose(f);
+    TEST_ASSERT(config_snapshot_load(path, NULL, &cached) == ERR_NOT_FOUND, "Damaged snapshot used");
+
+    unlink(snap);
+    unlink(path);
+    rmdir(dir);
+    return true;
+}
+
+static bool test_arena(void) {
+    arena_allocator_t* arena = arena_create(64);
+    TEST_ASSERT(arena != NULL, "Arena creation failed");
+
+    void* a = alloc(&arena->base, 48);
+    void* b = alloc(&arena->base, 4096);  // Spills into an overflow chunk
+    TEST_ASSERT(a != NULL && b != NULL, "Arena allocation failed");
+    TEST_ASSERT(((uintptr_t)b % _Alignof(max_align_t)) == 0, "Arena allocation misaligned");
+    TEST_ASSERT(arena_used(arena) >= 48 + 4096, "Arena usage not tracked");
+
+    arena_reset(arena);
+    TEST_ASSERT(arena_used(arena) == 0, "Arena reset failed");
+    TEST_ASSERT(arena->region_size >= 48 + 4096, "Arena did not grow on reset");
+
+    // String helpers draw from the allocator they are given
+    str_t dup = str_dup(STR_LIT("scratch"), &arena->base);
+    str_t formatted = str_format(&arena->base, "%s-%d", "turn", 7);
+    TEST_ASSERT(str_equal_cstr(dup, "scratch") && str_equal_cstr(formatted, "turn-7"), "Arena strings wrong");
+    TEST_ASSERT(arena_used(arena) >= dup.len + formatted.len + 2, "Strings bypassed the arena");
+
+    arena_destroy(arena);
+    return true;
+}
+
+static bool test_json_dom(void) {
+    json_value_t* root = json_parse("{\"a\":1,\"list\":[],\"s\":\"caf\\u00e9 \\ud83d\\ude00\",\"a\":2}");
+    TEST_ASSERT(root != NULL, "JSON parse failed");
+
+    json_object_t* obj = json_as_object(root);
+    TEST_ASSERT(json_object_get_number(obj, "a", 0) == 2, "Duplicate key not replaced");
+    TEST_ASSERT(json_array_length(json_object_get_array(obj, "list")) == 0, "Empty array not empty");
+    TEST_ASSERT(strcmp(json_object_get_string(obj, "s", ""), "caf\xc3\xa9 \xf0\x9f\x98\x80") == 0,
+                "Unicode escapes not decoded");
+    json_free(root);
+
+    // Large object goes through the hash index, arrays index in O(1)
+    json_value_t* built = json_create_object();
+    json_value_t* items = json_create_array();
+    char key[32];
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        json_object_set_number(built, key, i);
+        json_array_append(items, json_create_number(i));
+    }
+    json_object_set(built, "items", items);
+
+    obj = json_as_object(built);
+    TEST_ASSERT(json_object_get_number(obj, "k73", -1) == 73, "Indexed lookup failed");
+    TEST_ASSERT(json_object_get(obj, "missing") == NULL, "Missing key found");
+    json_array_t* arr = json_object_get_array(obj, "items");
+    TEST_ASSERT(json_array_length(arr) == 100, "Array length wrong");
+    TEST_ASSERT(json_as_number(json_array_get(arr, 99), -1) == 99, "Array index wrong");
+
+    char* printed = json_print(built, false);
+    json_free(built);
+    TEST_ASSERT(printed != NULL, "JSON print failed");
+
+    json_value_t* reparsed = json_parse(printed);
+    free(printed);
+    TEST_ASSERT(reparsed != NULL, "Round trip parse failed");
+    TEST_ASSERT(json_object_get_number(json_as_object(reparsed), "k0", -1) == 0, "Round trip lost data");
+    json_free(reparsed);
+
+    // Caller-owned arena
+    arena_allocator_t* arena = arena_create(1024);
+    const char* text = "[1,2,3]";
+    json_value_t* in_arena = json_parse_arena(text, strlen(text), arena);
+    TEST_ASSERT(json_array_length(json_as_array(in_arena)) == 3, "Arena parse failed");
+    json_free(in_arena);
+    arena_destroy(arena);
+
+    return true;
+}
+
+static bool test_json_writer(void) {
+    chat_message_t messages[2] = {
+        { .role = CHAT_ROLE_SYSTEM, .content = STR_LIT("Be \"brief\"\n\ttab\x01") },
+        { .role = CHAT_ROLE_USER, .content = STR_LIT("caf\xc3\xa9 \\ path") }
+    };
+
+    char* body = provider_build_chat_request(NULL, messages, 2, NULL, 0, "gpt-test", 0.7, true);
+    TEST_ASSERT(body != NULL, "Request build failed");
+
+    json_value_t* root = json_parse(body);
+    free(body);
+    TEST_ASSERT(root != NULL, "Writer output is not valid JSON");
+
+    json_object_t* obj = json_as_object(root);
+    TEST_ASSERT(strcmp(json_object_get_string(obj, "model", ""), "gpt-test") == 0, "Model missing");
+    TEST_ASSERT(json_object_get_number(obj, "temperature", 0) == 0.7, "Temperature not round-tripped");
+    TEST_ASSERT(json_object_get_bool(obj, "stream", false), "Stream flag missing");
+
+    json_array_t* arr = json_object_get_array(obj, "messages");
+    TEST_ASSERT(json_array_length(arr) == 2, "Message count wrong");
+    json_object_t* first = json_as_object(json_array_get(arr, 0));
+    TEST_ASSERT(strcmp(json_object_get_string(first, "role", ""), "system") == 0, "Role wrong");
+    TEST_ASSERT(strcmp(json_object_get_string(first, "content", ""), "Be \"brief\"\n\ttab\x01") == 0,
+                "Content not escaped losslessly");
+    json_object_t* second = json_as_object(json_array_get(arr, 1));
+    TEST_ASSERT(strcmp(json_object_get_string(second, "content", ""), "caf\xc3\xa9 \\ path") == 0,
+                "UTF-8 content altered");
+    json_free(root);
+
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_write_array_begin(&w);
+    json_write_number(&w, 1000000);
+    json_write_int(&w, -5);
+    json_write_null(&w);
+    json_write_array_end(&w);
+    char* text = json_writer_finish(&w, NULL);
+    TEST_ASSERT(text && strcmp(text, "[1000000,-5,null]") == 0, "Scalar formatting wrong");
+    free(text);
+
+    return true;
+}
+
+static bool test_json_parse_insitu(void) {
+    char text[] = "{\"plain\":\"hello\",\"escaped\":\"a\\\"b\\nc\\u00e9\",\"n\":[1,2.5]}";
+    size_t len = strlen(text);
+    json_value_t* root = json_parse_insitu(text, len);
+    TEST_ASSERT(root != NULL && root->type == JSON_OBJECT, "In-situ parse returns an object");
+
+    // Strings are decoded in the input buffer, not copied out of it
+    const char* plain = json_object_get_string(root->object, "plain", NULL);
+    const char* escaped = json_object_get_string(root->object, "escaped", NULL);
+    TEST_ASSERT(plain && strcmp(plain, "hello") == 0, "Plain string decodes");
+    TEST_ASSERT(escaped && strcmp(escaped, "a\"b\nc\xc3\xa9") == 0, "Escapes decode in place");
+    TEST_ASSERT(plain > text && plain < text + len, "Plain string points into the input");
+    TEST_ASSERT(escaped > text && escaped < text + len, "Escaped string points into the input");
+
+    json_array_t* numbers = json_object_get_array(root->object, "n");
+    TEST_ASSERT(numbers && json_array_length(numbers) == 2, "Array parses");
+    TEST_ASSERT(json_array_get(numbers, 1)->number == 2.5, "Numbers parse");
+    json_free(root);
+
+    char broken[] = "{\"a\":\"unterminated}";
+    TEST_ASSERT(json_parse_insitu(broken, strlen(broken)) == NULL, "Unterminated string fails");
+    return true;
+}
+
+static bool test_text_scan(void) {
+    // Every kernel this machine runs stops at the same bytes as the scalar loop
+    text_scan_impl_t initial = text_scan_impl();
+    char buf[128];
+    for (int impl = 0; impl < TEXT_SCAN_IMPL_COUNT; impl++) {
+        if (!text_scan_set_impl((text_scan_impl_t)impl)) continue;
+        for (size_t pos = 0; pos < sizeof(buf); pos++) {
+            static const unsigned char probes[] = { '"', '\\', 0x00, 0x1F, 0x20, 0x7F, 0x80, 0xFF };
+            for (size_t k = 0; k < sizeof(probes); k++) {
+                unsigned char c = probes[k];
+                memset(buf, 'a', sizeof(buf));
+                buf[pos] = (char)c;
+                bool escape = c < 0x20 || c == '"' || c == '\\';
+                bool special = c == '"' || c == '\\';
+                TEST_ASSERT(text_scan_json_escape(buf, sizeof(buf)) == (escape ? pos : sizeof(buf)),
+                            "Escape scan disagrees");
+                TEST_ASSERT(text_scan_json_special(buf, sizeof(buf)) == (special ? pos : sizeof(buf)),
+                            "Special scan disagrees");
+                TEST_ASSERT(text_scan_non_ascii(buf, sizeof(buf)) == (c >= 0x80 ? pos : sizeof(buf)),
+                            "ASCII scan disagrees");
+                // Nothing past len is looked at
+                TEST_ASSERT(text_scan_json_escape(buf, pos) == pos, "Scan read past its length");
+            }
+        }
+    }
+    TEST_ASSERT(text_scan_set_impl(initial), "Default kernel lost");
+    TEST_ASSERT(!text_scan_set_impl(TEXT_SCAN_IMPL_COUNT), "Bogus kernel accepted");
+
+    // UTF-8: well-formed text, then what RFC 3629 rules out
+    const char* good = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf";
+    TEST_ASSERT(text_utf8_valid(good, strlen(good)), "Valid UTF-8 rejected");
+    TEST_ASSERT(text_utf8_valid_prefix("ab\xc0\xaf" "cd", 6) == 2, "Overlong accepted");
+    TEST_ASSERT(text_utf8_valid_prefix("\xed\xa0\x80", 3) == 0, "Surrogate accepted");
+    TEST_ASSERT(text_utf8_valid_prefix("\xf4\x90\x80\x80", 4) == 0, "Past U+10FFFF accepted");
+    TEST_ASSERT(text_utf8_valid_prefix("ab\xe2\x82", 4) == 2, "Truncated sequence accepted");
+    memset(buf, 'x', sizeof(buf));
+    buf[100] = (char)0xBF;
+    TEST_ASSERT(text_utf8_valid_prefix(buf, sizeof(buf)) == 100, "Stray continuation accepted");
+
+    // The writer replaces malformed bytes; long strings round-trip through the parser
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    json_write_string(&w, "ok\xffok\xe2\x82");
+    char* text = json_writer_finish(&w, NULL);
+    TEST_ASSERT(text && strcmp(text, "\"ok\\ufffdok\\ufffd\\ufffd\"") == 0, "Malformed UTF-8 written as is");
+    free(text);
+
+    char original[600];
+    for (size_t i = 0; i < sizeof(original) - 1; i++) {
+        original[i] = i % 37 == 0 ? '"' : i % 53 == 0 ? '\n' : i % 71 == 0 ? '\\' : (char)('a' + i % 26);
+    }
+    original[sizeof(original) - 1] = '\0';
+    json_writer_init(&w, 0);
+    json_write_string(&w, original);
+    size_t len = 0;
+    text = json_writer_finish(&w, &len);
+    json_value_t* value = json_parse_len(text, len);
+    TEST_ASSERT(value && value->type == JSON_STRING && strcmp(value->string, original) == 0,
+                "Long string did not round-trip");
+    char* printed = json_print(value, false);
+    TEST_ASSERT(printed && strcmp(printed, text) == 0, "Printer escapes differently");
+    free(printed);
+    json_free(value);
+    value = json_parse_insitu(text, len);
+    TEST_ASSERT(value && value->type == JSON_STRING && strcmp(value->string, original) == 0,
+                "Long string did not round-trip in place");
+    json_free(value);
+    free(text);
+    return true;
+}
+
+static void write_gzip_sample(json_writer_t* w) {
+    json_write_array_begin(w);
+    for (int i = 0; i < 5000; i++) {
+        json_write_object_begin(w);
+        json_write_kv_string(w, "role", i % 2 ? "user" : "assistant");
+        json_write_kv_int(w, "turn", i);
+        json_write_object_end(w);
+    }
+    json_write_array_end(w);
+}
+
+static bool test_json_writer_gzip(void) {
+    json_writer_t w;
+    json_writer_init(&w, 0);
+    write_gzip_sample(&w);
+    size_t plain_len = 0;
+    char* plain = json_writer_finish(&w, &plain_len);
+
+    // Several chunks pass through the deflate stage
+    json_writer_init_gzip(&w, 6);
+    write_gzip_sample(&w);
+    size_t gz_len = 0;
+    char* gz = json_writer_finish(&w, &gz_len);
+    TEST_ASSERT(plain && plain_len > 4 * JSON_WRITER_GZIP_CHUNK, "Sample too small");
+    TEST_ASSERT(gz && gz_len < plain_len / 4, "Output not compressed");
+    TEST_ASSERT((unsigned char)gz[0] == 0x1f && (unsigned char)gz[1] == 0x8b, "Not a gzip member");
+
+    char* inflated = malloc(plain_len + 1);
+    z_stream zs = { .next_in = (Bytef*)gz, .avail_in = (uInt)gz_len,
+                    .next_out = (Bytef*)inflated, .avail_out = (uInt)plain_len + 1 };
+    TEST_ASSERT(inflateInit2(&zs, 15 + 16) == Z_OK, "Inflate init failed");
+    int rc = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    TEST_ASSERT(rc == Z_STREAM_END && zs.total_out == plain_len && memcmp(inflated, plain, plain_len) == 0,
+                "Round trip differs");
+    free(inflated);
+    free(plain);
+    free(gz);
+    return true;
+}
+
+static bool test_http_pool(void) {
+    http_client_config_t config = http_client_default_config();
+    TEST_ASSERT(config.pool_size == HTTP_POOL_SIZE_DEFAULT, "Default pool size not set");
+
+    http_client_t* client = http_client_create(&config);
+    TEST_ASSERT(client != NULL, "HTTP client creation failed");
+
+    TEST_ASSERT(http_client_set_pool_size(client, 0) == ERR_INVALID_ARGUMENT, "Zero pool size accepted");
+    TEST_ASSERT(http_client_set_pool_size(client, 2) == ERR_OK, "Pool resize failed");
+
+    http_client_drain_pool(client);
+    http_client_destroy(client);
+
+    return true;
+}
+
+static void on_async_done(err_t err, http_response_t* response, void* user_data) {
+    *(err_t*)user_data = err;
+    http_response_free(response);
+}
+
+static bool test_http_async(void) {
+    http_client_t* client = http_client_create(NULL);
+    TEST_ASSERT(client != NULL, "HTTP client creation failed");
+
+    http_engine_t* engine = http_engine_create(NULL);
+    TEST_ASSERT(engine != NULL, "HTTP engine creation failed");
+
+    // Nothing listens on port 1; the request must fail without blocking the caller
+    err_t results[4] = { ERR_OK, ERR_OK, ERR_OK, ERR_OK };
+    for (int i = 0; i < 4; i++) {
+        err_t err = http_request_async(engine, client, "GET", "http://127.0.0.1:1/", NULL, 0, NULL,
+                                       on_async_done, &results[i]);
+        TEST_ASSERT(err == ERR_OK, "Async submit failed");
+    }
+    TEST_ASSERT(http_engine_pending(engine) == 4, "Requests not in flight");
+
+    http_engine_run(engine);
+    TEST_ASSERT(http_engine_pending(engine) == 0, "Requests still pending");
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT(results[i] == ERR_NETWORK, "Refused connection not reported");
+    }
+
+    http_engine_destroy(engine);
+    http_client_destroy(client);
+
+    return true;
+}
+
 // Main test runner
+typedef struct {
+    char text[128];
+    char args[128];
+    char tool_name[32];
+    uint32_t prompt_tokens;
+    uint32_t completion_tokens;
+    char finish[32];
+    int done;
+} sse_capture_t;
+
+static void capture_append(char* buf, size_t cap, str_t s) {
+    size_t len = strlen(buf);
+    if (s.data && len + s.len < cap) {
+        memcpy(buf + len, s.data, s.len);
+        buf[len + s.len] = '\0';
+    }
+}
+
+static void on_sse_delta(const stream_delta_t* delta, void* user_data) {
+    sse_capture_t* cap = (sse_capture_t*)user_data;
+    switch (delta->type) {
+        case STREAM_DELTA_TEXT:
+            capture_append(cap->text, sizeof(cap->text), delta->text);
+            break;
+        case STREAM_DELTA_TOOL_CALL:
+            capture_append(cap->tool_name, sizeof(cap->tool_name), delta->tool_name);
+            capture_append(cap->args, sizeof(cap->args), delta->tool_arguments);
+            break;
+        case STREAM_DELTA_USAGE:
+            if (delta->prompt_tokens) cap->prompt_tokens = delta->prompt_tokens;
+            if (delta->completion_tokens) cap->completion_tokens = delta->completion_tokens;
+            break;
+        case STREAM_DELTA_FINISH:
+            capture_append(cap->finish, sizeof(cap->finish), delta->finish_reason);
+            break;
+        case STREAM_DELTA_DONE:
+            cap->done++;
+            break;
+        default:
+            break;
+    }
+}
+
+// Feed a stream in fixed-size slices so frames straddle writes
+static void feed_sliced(sse_parser_t* parser, const char* stream, size_t slice) {
+    size_t len = strlen(stream);
+    for (size_t pos = 0; pos < len; pos += slice) {
+        size_t n = len - pos < slice ? len - pos : slice;
+        sse_parser_feed(stream + pos, n, parser);
+    }
+}
+
+static bool test_sse_parser(void) {
+    const char* openai =
+        ": keep-alive\n\n"
+        "data: {\"choices\":[{\"delta\":{\"content\":\"Hel\"}}]}\r\n\r\n"
+        "data: {\"choices\":[{\"delta\":{\"content\":\"lo\"}}]}\n\n"
+        "data: {\"choices\":[{\"delta\":{\"tool_calls\":[{\"index\":0,\"id\":\"c1\","
+        "\"function\":{\"name\":\"shell\",\"arguments\":\"{\\\"cmd\"}}]}}]}\n\n"
+        "data: {\"choices\":[{\"delta\":{\"tool_calls\":[{\"index\":0,"
+        "\"function\":{\"arguments\":\"\\\":1}\"}}]}}]}\n\n"
+        "data: {\"choices\":[{\"delta\":{},\"finish_reason\":\"tool_calls\"}],"
+        "\"usage\":{\"prompt_tokens\":7,\"completion_tokens\":3}}\n\n"
+        "data: [DONE]\n\n";
+
+    size_t slices[] = { 1, 7, 4096 };
+    for (size_t i = 0; i < sizeof(slices) / sizeof(slices[0]); i++) {
+        sse_capture_t cap = {0};
+        sse_parser_t parser;
+        TEST_ASSERT(sse_parser_init(&parser, SSE_DIALECT_OPENAI, on_sse_delta, NULL, &cap) == ERR_OK,
+                    "Parser init failed");
+        feed_sliced(&parser, openai, slices[i]);
+        sse_parser_free(&parser);
+
+        TEST_ASSERT(strcmp(cap.text, "Hello") == 0, "OpenAI text deltas wrong");
+        TEST_ASSERT(strcmp(cap.tool_name, "shell") == 0, "Tool name missing");
+        TEST_ASSERT(strcmp(cap.args, "{\"cmd\":1}") == 0, "Tool argument fragments wrong");
+        TEST_ASSERT(strcmp(cap.finish, "tool_calls") == 0, "Finish reason wrong");
+        TEST_ASSERT(cap.prompt_tokens == 7 && cap.completion_tokens == 3, "Usage wrong");
+        TEST_ASSERT(cap.done == 1, "DONE not reported once");
+    }
+
+    const char* anthropic =
+        "event: message_start\n"
+        "data: {\"type\":\"message_start\",\"message\":{\"usage\":{\"input_tokens\":11}}}\n\n"
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,"
+        "\"delta\":{\"type\":\"text_delta\",\"text\":\"Hi \\u00e9\"}}\n\n"
+        "event: message_delta\n"
+        "data: {\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"end_turn\"},"
+        "\"usage\":{\"output_tokens\":2}}\n\n"
+        "event: message_stop\n"
+        "data: {\"type\":\"message_stop\"}\n\n";
+
+    sse_capture_t cap = {0};
+    sse_parser_t parser;
+    TEST_ASSERT(sse_parser_init(&parser, SSE_DIALECT_ANTHROPIC, on_sse_delta, NULL, &cap) == ERR_OK,
+                "Parser init failed");
+    feed_sliced(&parser, anthropic, 5);
+    sse_parser_free(&parser);
+
+    TEST_ASSERT(strcmp(cap.text, "Hi \xc3\xa9") == 0, "Anthropic text delta wrong");
+    TEST_ASSERT(strcmp(cap.finish, "end_turn") == 0, "Stop reason wrong");
+    TEST_ASSERT(cap.prompt_tokens == 11 && cap.completion_tokens == 2, "Anthropic usage wrong");
+    TEST_ASSERT(cap.done == 1, "message_stop not reported");
+
+    return true;
+}
+
+static bool test_session_context(void) {
+    agent_session_t session = {0};
+    str_t text = STR_LIT("turn");
+
+    // A straight chain of 200 turns, built incrementally
+    agent_message_t* chain[200];
+    for (uint32_t i = 0; i < 200; i++) {
+        chain[i] = agent_message_create(i % 2 ? AGENT_MSG_ASSISTANT : AGENT_MSG_USER, &text);
+        TEST_ASSERT(chain[i] != NULL, "Message alloc failed");
+        if (i == 0) {
+            session.root = chain[i];
+        } else {
+            agent_message_add_child(chain[i - 1], chain[i]);
+        }
+        session.current = chain[i];
+
+        chat_message_t* messages = NULL;
+        uint32_t count = 0;
+        TEST_ASSERT(agent_session_to_chat_messages(&session, &messages, &count) == ERR_OK, "Build failed");
+        TEST_ASSERT(count == i + 2, "Context length wrong");
+        TEST_ASSERT(messages[0].role == CHAT_ROLE_SYSTEM, "System prompt missing");
+        TEST_ASSERT(messages[count - 1].content.data == chain[i]->content.data, "Content not borrowed");
+    }
+
+    // Branch off turn 9: the context follows the branch, not the first child
+    agent_message_t* branch = agent_message_create(AGENT_MSG_USER, &text);
+    agent_message_add_child(chain[9], branch);
+    session.current = branch;
+
+    chat_message_t* messages = NULL;
+    uint32_t count = 0;
+    TEST_ASSERT(agent_session_to_chat_messages(&session, &messages, &count) == ERR_OK, "Branch build failed");
+    TEST_ASSERT(count == 12, "Branch context length wrong");
+    TEST_ASSERT(messages[10].content.data == chain[9]->content.data, "Branch parent wrong");
+    TEST_ASSERT(messages[11].role == CHAT_ROLE_USER, "Branch tip role wrong");
+
+    // Navigating back to an ancestor truncates
+    session.current = chain[4];
+    TEST_ASSERT(agent_session_to_chat_messages(&session, &messages, &count) == ERR_OK, "Ancestor build failed");
+    TEST_ASSERT(count == 6, "Ancestor context length wrong");
+
+    free(session.context);
+    free(session.context_nodes);
+    agent_message_tree_free(session.root);
+    return true;
+}
+
+static bool test_session_tree(void) {
+    agent_config_t config = agent_config_default();
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+
+    // A chain deep enough that a recursive free or walk would blow the stack,
+    // spanning many node slabs
+    str_t text = STR_LIT("turn");
+    const uint32_t depth = 200000;
+    agent_message_t* tip = NULL;
+    for (uint32_t i = 0; i < depth; i++) {
+        agent_message_t* msg = agent_session_message_create(session, AGENT_MSG_USER, &text);
+        TEST_ASSERT(msg != NULL && msg->node_id == i + 1, "Node ids not sequential");
+        if (tip) {
+            agent_message_add_child(tip, msg);
+        } else {
+            session->root = msg;
+        }
+        tip = msg;
+    }
+    session->current = tip;
+    TEST_ASSERT(agent_session_node(session, depth) == tip, "Node lookup by id failed");
+    TEST_ASSERT(agent_session_node(session, depth + 1) == NULL, "Unused id resolved");
+    TEST_ASSERT(tip->content.data != session->root->content.data, "Content not copied");
+
+    agent_message_t** path = NULL;
+    uint32_t path_count = 0;
+    TEST_ASSERT(agent_message_get_path(session->root, tip, &path, &path_count) == ERR_OK, "Path failed");
+    TEST_ASSERT(path_count == depth - 1 && path[path_count - 1] == tip, "Path wrong");
+    free(path);
+
+    // Branches keep their order through a splice; owned nodes mixed into
+    // the tree are freed with it
+    agent_message_t* fork = agent_session_node(session, 10);
+    agent_message_t* owned = agent_message_create(AGENT_MSG_USER, &text);
+    agent_message_t* last = agent_session_message_create(session, AGENT_MSG_USER, &text);
+    agent_message_add_child(fork, owned);
+    agent_message_add_child(fork, last);
+    TEST_ASSERT(fork->child_count == 3 && fork->last_child == last, "Children not appended");
+
+    agent_message_t* summary = agent_session_message_create(session, AGENT_MSG_SUMMARY, &text);
+    agent_message_splice(fork, owned, summary);
+    TEST_ASSERT(fork->first_child == agent_session_node(session, 11), "First child moved");
+    TEST_ASSERT(fork->first_child->next_sibling == summary && summary->next_sibling == last,
+                "Splice broke sibling order");
+    TEST_ASSERT(summary->first_child == owned && owned->parent == summary, "Spliced child not reparented");
+
+    agent->ctx->active_session = session;
+    session->current = fork;
+    TEST_ASSERT(agent_navigate_to_child(agent, 2) == ERR_OK && session->current == last, "Child navigation failed");
+    TEST_ASSERT(agent_navigate_to_child(agent, 0) == ERR_NOT_FOUND, "Leaf has no children");
+    TEST_ASSERT(agent_navigate_to_parent(agent) == ERR_OK && session->current == fork, "Parent navigation failed");
+
+    agent_destroy(agent);
+    return true;
+}
+
+static bool test_session_log(void) {
+    char dir[128];
+    snprintf(dir, sizeof(dir), "/tmp/cclaw-test-sessions-%d", (int)getpid());
+    agent_config_t config = agent_config_default();
+    config.sessions_dir = str_dup_cstr(dir, NULL);
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+
+    // 10k messages logged one by one as they join the tree
+    str_t id = STR_LIT("log-test");
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_resume(agent, &id, &id, &session) == ERR_OK && session->log, "No log opened");
+    enum { COUNT = 10000 };
+    agent_message_t* fifth = NULL;
+    for (uint32_t i = 0; i < COUNT; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "message %u", i);
+        str_t content = STR_VIEW(text);
+        agent_message_t* msg = agent_message_create(i % 2 ? AGENT_MSG_ASSISTANT : AGENT_MSG_USER, &content);
+        msg->tokens_input = i;
+        if (session->current) {
+            agent_message_add_child(session->current, msg);
+        } else {
+            session->root = msg;
+        }
+        session->current = msg;
+        TEST_ASSERT(session_log_append(session->log, msg) == ERR_OK, "Append failed");
+        if (i == 5) fifth = msg;
+    }
+
+    // A summary spliced above message 5, and the cursor moved back to it
+    str_t summary_text = STR_LIT("summary");
+    agent_message_t* summary = agent_message_create(AGENT_MSG_SUMMARY, &summary_text);
+    agent_message_splice(fifth->parent, fifth, summary);
+    TEST_ASSERT(session_log_append_splice(session->log, summary, fifth) == ERR_OK, "Splice failed");
+    TEST_ASSERT(agent_navigate_to(agent, fifth) == ERR_OK, "Navigate failed");
+    agent_destroy(agent);
+
+    // A torn record at the end is dropped on load
+    char path[192];
+    snprintf(path, sizeof(path), "%s/log-test.log", dir);
+    FILE* f = fopen(path, "ab");
+    TEST_ASSERT(f != NULL, "Log file missing");
+    fwrite("\x40\x00\x00\x00garbage", 1, 11, f);
+    fclose(f);
+
+    config.sessions_dir = str_dup_cstr(dir, NULL);
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    TEST_ASSERT(agent_session_load(agent, &id, &session) == ERR_OK, "Load failed");
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("(%u messages in %.2f ms) ", COUNT + 1,
+           (double)(t1.tv_sec - t0.tv_sec) * 1e3 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e6);
+
+    TEST_ASSERT(session_log_message_count(session->log) == COUNT + 1, "Wrong message count");
+    TEST_ASSERT(str_equal_cstr(session->root->content, "message 0"), "Wrong root");
+    TEST_ASSERT(session->root->log_borrowed, "Content was copied");
+    TEST_ASSERT(str_equal_cstr(session->current->content, "message 5"), "Cursor not restored");
+    TEST_ASSERT(session->current->parent->type == AGENT_MSG_SUMMARY, "Splice not replayed");
+    TEST_ASSERT(session->current->parent->parent->tokens_input == 4, "Token counts lost");
+
+    // Appends continue after the loaded prefix
+    str_t more = STR_LIT("after restart");
+    agent_message_t* msg = agent_message_create(AGENT_MSG_USER, &more);
+    agent_message_add_child(session->current, msg);
+    session->current = msg;
+    TEST_ASSERT(agent_session_save(agent, session) == ERR_OK, "Save failed");
+    agent_destroy(agent);
+
+    config.sessions_dir = str_dup_cstr(dir, NULL);
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+    TEST_ASSERT(agent_session_load(agent, &id, &session) == ERR_OK, "Reload failed");
+    TEST_ASSERT(str_equal_cstr(session->current->content, "after restart"), "Append after load lost");
+    TEST_ASSERT(session->current->parent->parent->type == AGENT_MSG_SUMMARY, "Tree changed on reload");
+
+    str_t* ids = NULL;
+    uint32_t id_count = 0;
+    TEST_ASSERT(agent_session_list(agent, &ids, &id_count) == ERR_OK && id_count == 1, "List failed");
+    TEST_ASSERT(str_equal_cstr(ids[0], "log-test"), "Wrong listed id");
+    free((void*)ids[0].data);
+    free(ids);
+    agent_destroy(agent);
+
+    unlink(path);
+    rmdir(dir);
+    return true;
+}
+
+static bool test_context_window(void) {
+    // Estimator: empty is free, prose lands near 4 bytes a token
+    TEST_ASSERT(token_estimate(STR_NULL, TOKEN_FAMILY_OPENAI) == 0, "Empty text has tokens");
+    str_t prose = STR_LIT("The quick brown fox jumps over the lazy dog and keeps running far away.");
+    uint32_t prose_tokens = token_estimate(prose, TOKEN_FAMILY_OPENAI);
+    TEST_ASSERT(prose_tokens >= 14 && prose_tokens <= 22, "Prose estimate off");
+    TEST_ASSERT(token_estimate(prose, TOKEN_FAMILY_ANTHROPIC) >= prose_tokens, "Family density ignored");
+    TEST_ASSERT(token_family_for_provider(STR_LIT("anthropic")) == TOKEN_FAMILY_ANTHROPIC, "Family lookup");
+
+    // 100 turns, then a summary, then 100 more
+    agent_session_t session = {0};
+    str_t text = STR_LIT("turn");
+    str_t summary_text = STR_LIT("summary of the first hundred turns");
+    agent_message_t* chain[201];
+    for (uint32_t i = 0; i < 201; i++) {
+        bool is_summary = i == 100;
+        chain[i] = agent_message_create(is_summary ? AGENT_MSG_SUMMARY : (i % 2 ? AGENT_MSG_ASSISTANT : AGENT_MSG_USER),
+                                        is_summary ? &summary_text : &text);
+        if (i == 0) {
+            session.root = chain[i];
+        } else {
+            agent_message_add_child(chain[i - 1], chain[i]);
+        }
+    }
+    session.current = chain[200];
+
+    // No limits: system prompt, summary, everything after it
+    chat_message_t* messages = NULL;
+    uint32_t count = 0;
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, 0, 0, &messages, &count) == ERR_OK, "Window failed");
+    TEST_ASSERT(count == 102, "Summary should replace the prefix");
+    TEST_ASSERT(messages[1].content.data == chain[100]->content.data, "Summary not pinned");
+
+    // Token budget for the system prompt, the summary and exactly ten turns
+    uint32_t per_turn = agent_message_tokens(chain[200], TOKEN_FAMILY_OPENAI);
+    TEST_ASSERT(chain[200]->token_counts[TOKEN_FAMILY_OPENAI] == per_turn, "Count not cached");
+    uint32_t fixed = TOKEN_MESSAGE_OVERHEAD + token_estimate(STR_LIT(AGENT_SYSTEM_PROMPT_EXTENDED), TOKEN_FAMILY_OPENAI) +
+                     agent_message_tokens(chain[100], TOKEN_FAMILY_OPENAI);
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, fixed + per_turn * 10, 0,
+                                     &messages, &count) == ERR_OK, "Budgeted window failed");
+    // An overflow refills to 75% of the budget: 7 of the 10 turns
+    TEST_ASSERT(count == 9, "Budget not applied");
+    TEST_ASSERT(messages[count - 1].content.data == chain[200]->content.data, "Newest message missing");
+    TEST_ASSERT(messages[0].cache_breakpoint && messages[1].cache_breakpoint, "Stable prefix not marked");
+    TEST_ASSERT(messages[count - 1].cache_breakpoint && !messages[2].cache_breakpoint, "Wrong breakpoints");
+
+    // The next turn keeps the same start while it fits
+    const char* start = messages[2].content.data;
+    agent_message_t* next = agent_message_create(AGENT_MSG_USER, &text);
+    agent_message_add_child(chain[200], next);
+    session.current = next;
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, fixed + per_turn * 10, 0,
+                                     &messages, &count) == ERR_OK, "Next window failed");
+    TEST_ASSERT(count == 10 && messages[2].content.data == start, "Window start moved");
+    session.current = chain[200];
+
+    // Message cap; the newest message survives even an impossible budget
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, 0, 4, &messages, &count) == ERR_OK, "Capped failed");
+    TEST_ASSERT(count == 5, "Message cap not applied");
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, 1, 0, &messages, &count) == ERR_OK, "Tiny failed");
+    TEST_ASSERT(count == 3, "Newest message dropped");
+
+    // A tool result pulls its call in with it
+    agent_message_t* call = agent_message_create(AGENT_MSG_TOOL_CALL, &text);
+    agent_message_t* result = agent_message_create(AGENT_MSG_TOOL_RESULT, &text);
+    agent_message_add_child(chain[200], call);
+    agent_message_add_child(call, result);
+    session.current = result;
+    TEST_ASSERT(agent_session_window(&session, TOKEN_FAMILY_OPENAI, 1, 0, &messages, &count) == ERR_OK, "Tool window failed");
+    TEST_ASSERT(count == 4 && messages[2].role == CHAT_ROLE_ASSISTANT, "Tool result orphaned");
+
+    free(session.context);
+    free(session.context_nodes);
+    free(session.window);
+    agent_message_tree_free(session.root);
+    return true;
+}
+
+// Summarizer backend: checks the request shape and answers after a delay
+static bool g_summary_request_ok;
+
+static err_t summary_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                          const tool_def_t* tools, uint32_t tool_count, const char* model,
+                          double temperature, chat_response_t** out_response) {
+    g_summary_request_ok = message_count == 2 && messages[0].role == CHAT_ROLE_SYSTEM &&
+                           strncmp(messages[1].content.data, "User: ", 6) == 0 &&
+                           model && strcmp(model, "small") == 0;
+    usleep(20 * 1000);
+
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup_cstr("condensed", NULL);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_summary_provider = { .chat = summary_chat };
+
+static bool test_background_summary(void) {
+    agent_config_t config = agent_config_default();
+    config.context_window_tokens = 400;
+
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+
+    // Summaries go to their own route
+    provider_t provider = { .vtable = &g_summary_provider };
+    str_t model = STR_LIT("small");
+    agent_set_summarizer(agent, &provider, &model);
+
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+
+    str_t text = STR_LIT("a message long enough to be worth summarizing later on");
+    agent_message_t* chain[40];
+    for (uint32_t i = 0; i < 40; i++) {
+        chain[i] = agent_message_create(i % 2 ? AGENT_MSG_ASSISTANT : AGENT_MSG_USER, &text);
+        if (i == 0) {
+            session->root = chain[i];
+        } else {
+            agent_message_add_child(chain[i - 1], chain[i]);
+        }
+    }
+    session->current = chain[39];
+
+    TEST_ASSERT(agent_summary_schedule(agent, session) == ERR_OK, "Schedule failed");
+    TEST_ASSERT(session->summary_job != NULL, "Over-budget path not summarized");
+    TEST_ASSERT(agent_summary_collect(agent, session, true), "Summary not spliced");
+    TEST_ASSERT(g_summary_request_ok, "Malformed summary request");
+
+    // The summary sits right before the kept recent messages
+    agent_message_t* summary = chain[40 - AGENT_SUMMARY_KEEP_RECENT]->parent;
+    TEST_ASSERT(summary->type == AGENT_MSG_SUMMARY, "Summary node missing");
+    TEST_ASSERT(summary->parent == chain[39 - AGENT_SUMMARY_KEEP_RECENT], "Summary misplaced");
+
+    chat_message_t* messages = NULL;
+    uint32_t count = 0;
+    TEST_ASSERT(agent_session_window(session, TOKEN_FAMILY_GENERIC, 0, 0, &messages, &count) == ERR_OK, "Window failed");
+    TEST_ASSERT(count == 2 + AGENT_SUMMARY_KEEP_RECENT, "Summary did not bound the context");
+    TEST_ASSERT(str_equal_cstr(messages[1].content, "condensed"), "Wrong summary");
+
+    // Back under budget: nothing new to do
+    TEST_ASSERT(agent_summary_schedule(agent, session) == ERR_OK, "Reschedule failed");
+    TEST_ASSERT(session->summary_job == NULL, "Summarized again under budget");
+
+    agent_destroy(agent);
+    return true;
+}
+
+// Sleeps for the number of milliseconds in args and echoes them back
+static str_t sleep_tool_name(void) { return STR_LIT("sleep"); }
+static str_t locked_tool_name(void) { return STR_LIT("locked"); }
+static bool never_allowed(autonomy_level_t level) { return false; }
+
+static err_t sleep_tool_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
+    usleep((useconds_t)atoi(args->data) * 1000);
+    tool_result_set_success(out_result, args);
+    return ERR_OK;
+}
+
+static const tool_vtable_t g_sleep_tool = {
+    .get_name = sleep_tool_name,
+    .execute = sleep_tool_execute,
+};
+
+static const tool_vtable_t g_locked_tool = {
+    .get_name = locked_tool_name,
+    .execute = sleep_tool_execute,
+    .allowed_in_autonomous = never_allowed,
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static bool test_tool_pool(void) {
+    tool_t* tool = tool_alloc(&g_sleep_tool);
+    TEST_ASSERT(tool != NULL, "Tool alloc failed");
+
+    tool_pool_t* pool = NULL;
+    TEST_ASSERT(tool_pool_create(4, &pool) == ERR_OK, "Pool create failed");
+
+    // Four calls totalling 280ms overlap, and results keep their submission order
+    const char* waits[] = { "100", "60", "100", "20" };
+    tool_job_t jobs[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        jobs[i] = (tool_job_t){ .tool = tool, .args = STR_VIEW(waits[i]), .result = tool_result_create() };
+    }
+
+    uint64_t start = now_ms();
+    TEST_ASSERT(tool_pool_run(pool, jobs, 4, 0) == ERR_OK, "Pool run failed");
+    TEST_ASSERT(now_ms() - start < 250, "Calls did not overlap");
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT(jobs[i].err == ERR_OK && jobs[i].result.success, "Job failed");
+        TEST_ASSERT(str_equal(jobs[i].result.content, jobs[i].args), "Result out of order");
+        tool_result_free(&jobs[i].result);
+    }
+
+    // A call past its deadline is abandoned, its neighbour still completes
+    jobs[0] = (tool_job_t){ .tool = tool, .args = STR_LIT("10"), .result = tool_result_create() };
+    jobs[1] = (tool_job_t){ .tool = tool, .args = STR_LIT("300"), .result = tool_result_create() };
+    TEST_ASSERT(tool_pool_run(pool, jobs, 2, 100) == ERR_OK, "Timed run failed");
+    TEST_ASSERT(jobs[0].err == ERR_OK, "Fast job should finish");
+    TEST_ASSERT(jobs[1].err == ERR_TIMEOUT && !jobs[1].result.success, "Slow job should time out");
+    tool_result_free(&jobs[0].result);
+    tool_result_free(&jobs[1].result);
+
+    tool_pool_destroy(pool);
+
+    // Through the agent: name index lookup and the autonomy check
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(NULL, &agent) == ERR_OK, "Agent create failed");
+    TEST_ASSERT(agent_register_tool(agent, tool) == ERR_OK, "Register failed");
+    TEST_ASSERT(agent_register_tool(agent, tool_alloc(&g_locked_tool)) == ERR_OK, "Register failed");
+
+    str_t name = STR_LIT("sleep");
+    str_t args = STR_LIT("1");
+    str_t out = STR_NULL;
+    TEST_ASSERT(agent_tool_is_available(agent, &name), "Tool not found");
+    TEST_ASSERT(agent_execute_tool(agent, &name, &args, &out) == ERR_OK, "Execute failed");
+    TEST_ASSERT(str_equal(out, args), "Wrong output");
+    free((void*)out.data);
+
+    name = STR_LIT("locked");
+    TEST_ASSERT(!agent_tool_is_available(agent, &name), "Locked tool should be unavailable");
+    TEST_ASSERT(agent_execute_tool(agent, &name, &args, &out) == ERR_PERMISSION_DENIED, "Locked tool ran");
+    free((void*)out.data);
+
+    name = STR_LIT("missing");
+    TEST_ASSERT(agent_execute_tool(agent, &name, &args, &out) == ERR_NOT_FOUND, "Missing tool ran");
+    free((void*)out.data);
+
+    agent_destroy(agent);
+    return true;
+}
+
+static bool test_usage_parsing(void) {
+    // OpenAI-style nested cache hits
+    json_value_t* root = json_parse("{\"prompt_tokens\":1200,\"completion_tokens\":30,"
+                                    "\"prompt_tokens_details\":{\"cached_tokens\":1024}}");
+    chat_response_t response = {0};
+    provider_parse_usage(json_as_object(root), &response);
+    json_free(root);
+    TEST_ASSERT(response.prompt_tokens == 1200 && response.total_tokens == 1230, "OpenAI usage wrong");
+    TEST_ASSERT(response.cached_tokens == 1024, "OpenAI cache hits missing");
+
+    // Anthropic counts cache reads and writes outside input_tokens
+    root = json_parse("{\"input_tokens\":20,\"output_tokens\":5,"
+                      "\"cache_read_input_tokens\":900,\"cache_creation_input_tokens\":80}");
+    response = (chat_response_t){0};
+    provider_parse_usage(json_as_object(root), &response);
+    json_free(root);
+    TEST_ASSERT(response.prompt_tokens == 1000, "Anthropic prompt total wrong");
+    TEST_ASSERT(response.cached_tokens == 900 && response.cache_write_tokens == 80, "Anthropic cache wrong");
+
+    // DeepSeek's flat field
+    root = json_parse("{\"prompt_tokens\":64,\"completion_tokens\":1,\"prompt_cache_hit_tokens\":64}");
+    response = (chat_response_t){0};
+    provider_parse_usage(json_as_object(root), &response);
+    json_free(root);
+    TEST_ASSERT(response.cached_tokens == 64, "DeepSeek cache hits missing");
+    return true;
+}
+
+// Scripted provider: asks for the sleep tool once, then answers
+static uint32_t g_script_calls;
+static bool g_script_ok;
+
+static err_t script_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                         const tool_def_t* tools, uint32_t tool_count, const char* model,
+                         double temperature, chat_response_t** out_response) {
+    chat_response_t* response = chat_response_create();
+    g_script_ok = g_script_ok && tool_count == 1 && !str_empty(tools[0].json[TOOL_DIALECT_OPENAI]);
+
+    if (g_script_calls++ == 0) {
+        response->tool_calls = str_dup_cstr(
+            "[{\"id\":\"call_1\",\"type\":\"function\","
+            "\"function\":{\"name\":\"sleep\",\"arguments\":\"1\"}}]", NULL);
+    } else {
+        // The follow-up carries the call and its answer
+        const chat_message_t* call = &messages[message_count - 2];
+        const chat_message_t* result = &messages[message_count - 1];
+        g_script_ok = g_script_ok && call->role == CHAT_ROLE_ASSISTANT && !str_empty(call->tool_calls) &&
+                      result->role == CHAT_ROLE_TOOL && str_equal_cstr(result->tool_call_id, "call_1") &&
+                      str_equal_cstr(result->content, "1");
+        response->content = str_dup_cstr("done", NULL);
+    }
+
+    *out_response = response;
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_script_provider = { .chat = script_chat };
+
+static bool test_tool_calling(void) {
+    // Streamed fragments assemble into the same array a full response carries
+    tool_call_builder_t builder;
+    tool_call_builder_init(&builder);
+    stream_delta_t first = {
+        .type = STREAM_DELTA_TOOL_CALL, .tool_index = 0,
+        .tool_id = STR_LIT("call_9"), .tool_name = STR_LIT("sleep"), .tool_arguments = STR_LIT("{\"ms\"")
+    };
+    stream_delta_t rest = { .type = STREAM_DELTA_TOOL_CALL, .tool_index = 0, .tool_arguments = STR_LIT(":5}") };
+    TEST_ASSERT(tool_call_builder_feed(&builder, &first) == ERR_OK, "Feed failed");
+    TEST_ASSERT(tool_call_builder_feed(&builder, &rest) == ERR_OK, "Feed failed");
+
+    str_t json = STR_NULL;
+    TEST_ASSERT(tool_call_builder_finish(&builder, &json) == ERR_OK && json.data, "Finish failed");
+    tool_call_builder_free(&builder);
+
+    arena_allocator_t* arena = arena_create(4096);
+    tool_call_t* calls = NULL;
+    uint32_t count = 0;
+    TEST_ASSERT(provider_parse_tool_calls(json, arena, &calls, &count) == ERR_OK, "Parse failed");
+    TEST_ASSERT(count == 1, "Wrong call count");
+    TEST_ASSERT(str_equal_cstr(calls[0].id, "call_9"), "Wrong id");
+    TEST_ASSERT(str_equal_cstr(calls[0].name, "sleep"), "Wrong name");
+    TEST_ASSERT(str_equal_cstr(calls[0].arguments, "{\"ms\":5}"), "Arguments not joined");
+    free((void*)json.data);
+    arena_destroy(arena);
+
+    // The agent loop runs the call and feeds the result back
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(NULL, &agent) == ERR_OK, "Agent create failed");
+    TEST_ASSERT(agent_register_tool(agent, tool_alloc(&g_sleep_tool)) == ERR_OK, "Register failed");
+
+    provider_t provider = { .vtable = &g_script_provider };
+    agent->ctx->provider = &provider;
+    g_script_calls = 0;
+    g_script_ok = true;
+
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+
+    str_t input = STR_LIT("go");
+    str_t reply = STR_NULL;
+    TEST_ASSERT(agent_process_message(agent, session, &input, &reply) == ERR_OK, "Turn failed");
+    TEST_ASSERT(g_script_calls == 2, "Tool round trip missing");
+    TEST_ASSERT(g_script_ok, "Provider saw a malformed request");
+    TEST_ASSERT(str_equal_cstr(reply, "done"), "Wrong reply");
+    free((void*)reply.data);
+
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+    return true;
+}
+
+// Pure tool that notes when it ran; the streaming provider below asks for
+// it, then keeps the message open for a while before finishing
+static uint32_t g_probe_runs;
+static uint64_t g_probe_started_ms;
+static uint64_t g_spec_stream_end_ms;
+static uint32_t g_spec_stream_calls;
+static bool g_spec_alter_args;
+
+static str_t probe_tool_name(void) { return STR_LIT("probe"); }
+static bool probe_tool_pure(void) { return true; }
+
+static err_t probe_tool_execute(tool_t* tool, const str_t* args, tool_result_t* out_result) {
+    if (__atomic_fetch_add(&g_probe_runs, 1, __ATOMIC_RELAXED) == 0) {
+        __atomic_store_n(&g_probe_started_ms, now_ms(), __ATOMIC_RELAXED);
+    }
+    tool_result_set_success(out_result, args);
+    return ERR_OK;
+}
+
+static const tool_vtable_t g_probe_tool = {
+    .get_name = probe_tool_name,
+    .execute = probe_tool_execute,
+    .is_pure = probe_tool_pure,
+};
+
+static err_t spec_stream(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                         const tool_def_t* tools, uint32_t tool_count, const char* model,
+                         double temperature, stream_delta_callback_t on_delta, void* user_data) {
+    if (g_spec_stream_calls++ % 2 == 1) {
+        stream_delta_t text = { .type = STREAM_DELTA_TEXT, .text = STR_LIT("done") };
+        on_delta(&text, user_data);
+        return ERR_OK;
+    }
+
+    stream_delta_t call = {
+        .type = STREAM_DELTA_TOOL_CALL, .tool_index = 0,
+        .tool_id = STR_LIT("call_1"), .tool_name = STR_LIT("probe"), .tool_arguments = STR_LIT("{\"q\":\"}\"")
+    };
+    on_delta(&call, user_data);
+    stream_delta_t close = { .type = STREAM_DELTA_TOOL_CALL, .tool_index = 0, .tool_arguments = STR_LIT("}") };
+    on_delta(&close, user_data);
+    usleep(100 * 1000);
+    if (g_spec_alter_args) {
+        // Valid JSON still, but not the call that was started
+        stream_delta_t extra = { .type = STREAM_DELTA_TOOL_CALL, .tool_index = 0, .tool_arguments = STR_LIT(" ") };
+        on_delta(&extra, user_data);
+    }
+    g_spec_stream_end_ms = now_ms();
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_spec_provider = { .chat_stream_deltas = spec_stream };
+
+// Streaming needs a text callback
+static void ignore_text(const str_t* delta, void* user_data) {}
+
+static bool test_tool_speculation(void) {
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(NULL, &agent) == ERR_OK, "Agent create failed");
+    TEST_ASSERT(agent_register_tool(agent, tool_alloc(&g_probe_tool)) == ERR_OK, "Register failed");
+    provider_t provider = { .vtable = &g_spec_provider };
+    agent->ctx->provider = &provider;
+
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+
+    // The call starts once its arguments close (a brace inside a string
+    // does not count) and its result is used
+    str_t input = STR_LIT("go");
+    str_t reply = STR_NULL;
+    g_probe_runs = 0;
+    g_spec_stream_calls = 0;
+    g_spec_alter_args = false;
+    TEST_ASSERT(agent_process_message_stream(agent, session, &input, ignore_text, NULL, &reply) == ERR_OK,
+                "Turn failed");
+    TEST_ASSERT(str_equal_cstr(reply, "done"), "Wrong reply");
+    free((void*)reply.data);
+    TEST_ASSERT(g_probe_runs == 1, "Speculative result not reused");
+    TEST_ASSERT(g_probe_started_ms < g_spec_stream_end_ms, "Tool waited for the message to end");
+    agent_message_t* result = session->current->parent;
+    TEST_ASSERT(result->type == AGENT_MSG_TOOL_RESULT && str_equal_cstr(result->content, "{\"q\":\"}\"}"),
+                "Wrong tool result");
+
+    // Arguments changed after the call started: it is dropped and the
+    // final call runs
+    g_probe_runs = 0;
+    g_spec_alter_args = true;
+    TEST_ASSERT(agent_process_message_stream(agent, session, &input, ignore_text, NULL, &reply) == ERR_OK,
+                "Turn failed");
+    free((void*)reply.data);
+    TEST_ASSERT(g_probe_runs == 2, "Stale speculation used");
+    result = session->current->parent;
+    TEST_ASSERT(str_equal_cstr(result->content, "{\"q\":\"}\"} "), "Result not from the final call");
+
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+    return true;
+}
+
+static bool test_tool_dialects(void) {
+    // One definition, serialized once per wire shape
+    tool_def_t* tool = tool_def_create("sleep", "Wait", "{\"type\":\"object\"}");
+    TEST_ASSERT(tool && tool_def_serialize(tool) == ERR_OK, "Serialize failed");
+    TEST_ASSERT(strstr(tool->json[TOOL_DIALECT_OPENAI].data, "\"function\":{\"name\":\"sleep\""), "OpenAI shape wrong");
+    TEST_ASSERT(strstr(tool->json[TOOL_DIALECT_ANTHROPIC].data, "\"input_schema\":{\"type\":\"object\"}"),
+                "Anthropic shape wrong");
+
+    // Tool history: calls become tool_use blocks, results share one user turn
+    chat_message_t messages[] = {
+        { .role = CHAT_ROLE_USER, .content = STR_LIT("go") },
+        { .role = CHAT_ROLE_ASSISTANT, .tool_calls = STR_LIT(
+            "[{\"id\":\"t1\",\"type\":\"function\",\"function\":{\"name\":\"sleep\",\"arguments\":\"{\\\"ms\\\":1}\"}},"
+            "{\"id\":\"t2\",\"type\":\"function\",\"function\":{\"name\":\"sleep\",\"arguments\":\"\"}}]") },
+        { .role = CHAT_ROLE_TOOL, .content = STR_LIT("a"), .tool_call_id = STR_LIT("t1") },
+        { .role = CHAT_ROLE_TOOL, .content = STR_LIT("b"), .tool_call_id = STR_LIT("t2") },
+    };
+    provider_t provider = {0};
+    char* body = anthropic_build_request(&provider, messages, 4, tool, 1, NULL, -1.0, false);
+    TEST_ASSERT(body != NULL, "Build failed");
+    json_value_t* root = json_parse(body);
+    json_array_t* turns = json_object_get_array(json_as_object(root), "messages");
+    TEST_ASSERT(json_array_length(turns) == 3, "Tool results not merged into one turn");
+    json_array_t* uses = json_object_get_array(json_as_object(json_array_get(turns, 1)), "content");
+    TEST_ASSERT(json_array_length(uses) == 2, "Assistant turn should hold only tool_use blocks");
+    json_object_t* use = json_as_object(json_array_get(uses, 0));
+    TEST_ASSERT(strcmp(json_object_get_string(use, "type", ""), "tool_use") == 0, "Not a tool_use block");
+    TEST_ASSERT(json_object_get_number(json_object_get_object(use, "input"), "ms", 0) == 1, "Input not an object");
+    json_array_t* results = json_object_get_array(json_as_object(json_array_get(turns, 2)), "content");
+    TEST_ASSERT(json_array_length(results) == 2, "Expected two tool_result blocks");
+    TEST_ASSERT(strcmp(json_object_get_string(json_as_object(json_array_get(results, 1)), "tool_use_id", ""),
+                       "t2") == 0, "Wrong tool_use_id");
+    TEST_ASSERT(json_array_length(json_object_get_array(json_as_object(root), "tools")) == 1, "Tools missing");
+    json_free(root);
+    free(body);
+    tool_def_free(tool);
+
+    // tool_use blocks in a response come back OpenAI-shaped
+    char reply[] = "{\"content\":[{\"type\":\"text\",\"text\":\"ok\"},"
+                   "{\"type\":\"tool_use\",\"id\":\"t3\",\"name\":\"sleep\",\"input\":{\"ms\":2}}],"
+                   "\"stop_reason\":\"tool_use\"}";
+    chat_response_t* response = chat_response_create();
+    TEST_ASSERT(anthropic_parse_response(reply, strlen(reply), response) == ERR_OK, "Parse failed");
+    arena_allocator_t* arena = arena_create(4096);
+    tool_call_t* calls = NULL;
+    uint32_t count = 0;
+    TEST_ASSERT(provider_parse_tool_calls(response->tool_calls, arena, &calls, &count) == ERR_OK && count == 1,
+                "tool_use not captured");
+    TEST_ASSERT(str_equal_cstr(calls[0].id, "t3") && str_equal_cstr(calls[0].arguments, "{\"ms\":2}"),
+                "Wrong tool call");
+    arena_destroy(arena);
+    chat_response_free(response);
+
+    // OpenAI-compatible replies carry null content when only tools are called
+    char completion[] = "{\"choices\":[{\"message\":{\"content\":null,\"tool_calls\":[{\"id\":\"c1\","
+                        "\"type\":\"function\",\"function\":{\"name\":\"sleep\",\"arguments\":\"{}\"}}]},"
+                        "\"finish_reason\":\"tool_calls\"}]}";
+    response = chat_response_create();
+    TEST_ASSERT(provider_parse_chat_response(completion, strlen(completion), "m", response) == ERR_OK,
+                "Completion parse failed");
+    TEST_ASSERT(response->content.data && response->content.len == 0, "Null content mishandled");
+    TEST_ASSERT(strstr(response->tool_calls.data, "\"c1\"") != NULL, "tool_calls not captured");
+    TEST_ASSERT(str_equal_cstr(response->model, "m"), "Default model not used");
+    chat_response_free(response);
+    return true;
+}
+
+static void count_output(void* user_data, bool is_stderr, const char* data, size_t len) {
+    (void)is_stderr;
+    (void)data;
+    *(size_t*)user_data += len;
+}
+
+static bool test_shell_runner(void) {
+    shell_run_result_t run;
+
+    // Separate streams and exit status
+    TEST_ASSERT(shell_run("echo out; echo err 1>&2; exit 3", NULL, &run) == ERR_OK, "Run failed");
+    TEST_ASSERT(run.exit_code == 3 && !run.timed_out, "Exit status lost");
+    TEST_ASSERT(str_equal(run.out, STR_LIT("out\n")), "Stdout not captured");
+    TEST_ASSERT(str_equal(run.err, STR_LIT("err\n")), "Stderr not captured");
+    shell_run_result_free(&run);
+
+    // Working directory is set in the child only
+    char before[1024];
+    TEST_ASSERT(getcwd(before, sizeof(before)) != NULL, "getcwd failed");
+    shell_run_options_t in_tmp = { .cwd = "/tmp" };
+    TEST_ASSERT(shell_run("pwd", &in_tmp, &run) == ERR_OK, "Run in cwd failed");
+    TEST_ASSERT(str_equal(run.out, STR_LIT("/tmp\n")), "Cwd not applied");
+    shell_run_result_free(&run);
+    char after[1024];
+    TEST_ASSERT(getcwd(after, sizeof(after)) && strcmp(before, after) == 0, "Caller cwd changed");
+
+    // Hard timeout kills the whole process group, including children
+    shell_run_options_t quick = { .timeout_ms = 200 };
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    TEST_ASSERT(shell_run("echo started; sleep 5 | cat", &quick, &run) == ERR_OK, "Timed run failed");
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    TEST_ASSERT(run.timed_out && run.term_signal == SIGKILL, "Timeout not enforced");
+    TEST_ASSERT(elapsed < 2.0, "Timeout too slow");
+    TEST_ASSERT(str_equal(run.out, STR_LIT("started\n")), "Output before timeout lost");
+    shell_run_result_free(&run);
+
+    // Capped output keeps head and tail; the callback sees everything
+    size_t streamed = 0;
+    shell_run_options_t capped = { .max_output = 1000, .on_output = count_output, .user_data = &streamed };
+    TEST_ASSERT(shell_run("echo BEGIN; seq 1 20000; echo END", &capped, &run) == ERR_OK, "Capped run failed");
+    TEST_ASSERT(run.truncated && run.out_total > 100000, "Output not truncated");
+    TEST_ASSERT(streamed == run.out_total, "Callback missed output");
+    TEST_ASSERT(run.out.len < 1100, "Cap exceeded");
+    TEST_ASSERT(strncmp(run.out.data, "BEGIN\n1\n", 8) == 0, "Head lost");
+    TEST_ASSERT(strcmp(run.out.data + run.out.len - 10, "20000\nEND\n") == 0, "Tail lost");
+    TEST_ASSERT(strstr(run.out.data, "bytes omitted") != NULL, "No omission marker");
+    shell_run_result_free(&run);
+
+    return true;
+}
+
+// Stands in for the docker CLI: numbered containers, exec runs locally
+static const char g_fake_docker[] =
+    "#!/bin/sh\n"
+    "dir=$(dirname \"$0\")\n"
+    "case \"$1\" in\n"
+    "run) n=$(($(cat \"$dir/count\" 2>/dev/null || echo 0) + 1)); echo $n > \"$dir/count\"; echo \"c$n\" ;;\n"
+    "exec) shift; [ \"$1\" = -w ] && shift 2; echo \"exec $1\" >> \"$dir/log\"; shift; exec \"$@\" ;;\n"
+    "rm) shift 2; echo \"rm $*\" >> \"$dir/log\" ;;\n"
+    "*) exit 125 ;;\n"
+    "esac\n";
+
+static bool wait_pool_idle(docker_pool_t* pool, uint32_t idle) {
+    for (int i = 0; i < 200; i++) {
+        docker_pool_stats_t stats;
+        docker_pool_stats(pool, &stats);
+        if (stats.idle == idle) return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+static bool test_docker_pool(void) {
+    char dir[] = "/tmp/cclaw_docker_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL, "mkdtemp failed");
+    char docker[64], log_path[64];
+    snprintf(docker, sizeof(docker), "%s/docker", dir);
+    snprintf(log_path, sizeof(log_path), "%s/log", dir);
+    TEST_ASSERT(write_text_file(docker, g_fake_docker) && chmod(docker, 0755) == 0, "Fake docker not written");
+
+    docker_pool_config_t config = docker_pool_config_default();
+    config.docker = docker;
+    config.size = 1;
+    config.max_uses = 3;
+    config.acquire_timeout_ms = 5000;
+    config.reset_command = "true";
+    docker_pool_t* pool = NULL;
+    TEST_ASSERT(docker_pool_create(&config, &pool) == ERR_OK, "Pool create failed");
+    TEST_ASSERT(wait_pool_idle(pool, 1), "Pool never warmed");
+
+    // Three commands share a container, the fourth gets a fresh one
+    shell_run_result_t run;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT(docker_pool_exec(pool, "echo hi", NULL, &run) == ERR_OK, "Exec failed");
+        TEST_ASSERT(run.exit_code == 0 && str_equal(run.out, STR_LIT("hi\n")), "Exec output wrong");
+        shell_run_result_free(&run);
+    }
+    docker_pool_stats_t stats;
+    docker_pool_stats(pool, &stats);
+    TEST_ASSERT(stats.execs == 4 && stats.started == 2 && stats.recycled == 1, "Not recycled after max_uses");
+
+    // A timeout leaves the command running in the container: it is replaced
+    shell_run_options_t quick = { .timeout_ms = 200 };
+    TEST_ASSERT(docker_pool_exec(pool, "sleep 5", &quick, &run) == ERR_OK && run.timed_out, "Timeout not enforced");
+    shell_run_result_free(&run);
+    docker_pool_stats(pool, &stats);
+    TEST_ASSERT(stats.violations == 1 && stats.recycled == 2, "Violation not recycled");
+    TEST_ASSERT(wait_pool_idle(pool, 1), "Replacement never started");
+
+    // The shell tool runs through the pool when given one
+    tool_t* shell = NULL;
+    TEST_ASSERT(shell_tool_get_vtable()->create(&shell) == ERR_OK, "Shell create failed");
+    tool_context_t context = tool_context_default();
+    context.sandbox = pool;
+    TEST_ASSERT(shell->vtable->init(shell, &context) == ERR_OK, "Shell init failed");
+    str_t args = STR_LIT("echo boxed");
+    tool_result_t result = tool_result_create();
+    TEST_ASSERT(shell->vtable->execute(shell, &args, &result) == ERR_OK && result.success &&
+                strstr(result.content.data, "boxed") != NULL, "Shell tool did not use the pool");
+    tool_result_free(&result);
+    shell->vtable->destroy(shell);
+    docker_pool_stats(pool, &stats);
+    TEST_ASSERT(stats.execs == 6, "Shell command not counted");
+
+    docker_pool_destroy(pool);
+    FILE* f = fopen(log_path, "r");
+    TEST_ASSERT(f != NULL, "No docker log");
+    char log[4096];
+    size_t n = fread(log, 1, sizeof(log) - 1, f);
+    fclose(f);
+    log[n] = '\0';
+    TEST_ASSERT(strstr(log, "exec c1") && strstr(log, "rm c1") && strstr(log, "rm c3"), "Containers not removed");
+
+    // Without a working docker, exec fails fast instead of waiting out the timeout
+    config.docker = "/nonexistent/docker";
+    TEST_ASSERT(docker_pool_create(&config, &pool) == ERR_OK, "Pool create failed");
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    TEST_ASSERT(docker_pool_exec(pool, "echo hi", NULL, &run) == ERR_DOCKER_UNAVAILABLE, "Missing docker not reported");
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TEST_ASSERT(t1.tv_sec - t0.tv_sec < 2, "Missing docker reported slowly");
+    docker_pool_destroy(pool);
+
+    char path[96];
+    snprintf(path, sizeof(path), "%s/count", dir);
+    unlink(path);
+    unlink(log_path);
+    unlink(docker);
+    rmdir(dir);
+    return true;
+}
+
+static bool read_with(tool_t* tool, const char* args, tool_result_t* result) {
+    str_t a = { .data = args, .len = (uint32_t)strlen(args) };
+    tool_result_free(result);
+    *result = tool_result_create();
+    return tool->vtable->execute(tool, &a, result) == ERR_OK && result->success;
+}
+
+static bool test_file_read_ranges(void) {
+    char path[] = "/tmp/cclaw_read_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0, "mkstemp failed");
+    FILE* f = fdopen(fd, "w");
+    for (int i = 1; i <= 10000; i++) fprintf(f, "line %d%s\n", i, i % 1000 == 0 ? " marker" : "");
+    fclose(f);
+
+    tool_t* tool = NULL;
+    TEST_ASSERT(file_read_tool_get_vtable()->create(&tool) == ERR_OK, "Create failed");
+    tool_context_t context = tool_context_default();
+    TEST_ASSERT(tool->vtable->init(tool, &context) == ERR_OK, "Init failed");
+
+    tool_result_t result = tool_result_create();
+    char args[256];
+
+    // Plain path still reads the whole file
+    TEST_ASSERT(read_with(tool, path, &result), "Whole read failed");
+    TEST_ASSERT(strncmp(result.content.data, "line 1\n", 7) == 0, "Whole read wrong");
+
+    // Line windows go through the newline index, also past a stride boundary
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"offset\":4000,\"limit\":2}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Line read failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("line 4000 marker\nline 4001\n")), "Line window wrong");
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"offset\":65,\"limit\":1}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Line read failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("line 65\n")), "Stride offset wrong");
+
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"unit\":\"bytes\",\"offset\":5,\"limit\":3}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Byte read failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("1\nl")), "Byte range wrong");
+
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"head\":2}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Head failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("line 1\nline 2\n")), "Head wrong");
+
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"tail\":2}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Tail failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("line 9999\nline 10000 marker\n")), "Tail wrong");
+
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"grep\":\"marker\",\"limit\":2}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Grep failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("1000:line 1000 marker\n2000:line 2000 marker\n")), "Grep wrong");
+
+    // A rewritten file invalidates the cached mapping and index
+    f = fopen(path, "w");
+    fprintf(f, "fresh\nsecond\n");
+    fclose(f);
+    struct timespec later[2] = { { .tv_sec = time(NULL) + 5 }, { .tv_sec = time(NULL) + 5 } };
+    utimensat(AT_FDCWD, path, later, 0);
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"offset\":2,\"limit\":1}", path);
+    TEST_ASSERT(read_with(tool, args, &result), "Reread failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("second\n")), "Stale mapping served");
+
+    tool_result_free(&result);
+    tool->vtable->destroy(tool);
+    unlink(path);
+    return true;
+}
+
+static bool read_file_equals(const char* path, const char* expected) {
+    char buf[256];
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return strcmp(buf, expected) == 0;
+}
+
+static bool test_file_write_batch(void) {
+    char dir[] = "/tmp/cclaw_write_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL, "mkdtemp failed");
+    char a[64], b[64], c[64], args[512];
+    snprintf(a, sizeof(a), "%s/a.txt", dir);
+    snprintf(b, sizeof(b), "%s/b.txt", dir);
+    snprintf(c, sizeof(c), "%s/c.txt", dir);
+
+    FILE* f = fopen(c, "w");
+    fputs("alpha beta gamma\n", f);
+    fclose(f);
+    chmod(c, 0640);
+
+    tool_t* tool = NULL;
+    TEST_ASSERT(file_write_tool_get_vtable()->create(&tool) == ERR_OK, "Create failed");
+    tool_context_t context = tool_context_default();
+    TEST_ASSERT(tool->vtable->init(tool, &context) == ERR_OK, "Init failed");
+    tool_result_t result = tool_result_create();
+
+    // Single write keeps the old argument shape (with escapes decoded)
+    snprintf(args, sizeof(args), "{\"path\":\"%s\",\"content\":\"one\\n\"}", a);
+    TEST_ASSERT(read_with(tool, args, &result), "Single write failed");
+    TEST_ASSERT(read_file_equals(a, "one\n"), "Single write content wrong");
+
+    // Batch: new file, overwrite and patch
+    snprintf(args, sizeof(args),
+             "{\"files\":[{\"path\":\"%s\",\"content\":\"two\"},"
+             "{\"path\":\"%s\",\"content\":\"bee\"},"
+             "{\"path\":\"%s\",\"find\":\"beta\",\"replace\":\"BETA\"}]}", a, b, c);
+    TEST_ASSERT(read_with(tool, args, &result), "Batch write failed");
+    TEST_ASSERT(str_equal(result.content, STR_LIT("Wrote 3 files")), "Batch message wrong");
+    TEST_ASSERT(read_file_equals(a, "two") && read_file_equals(b, "bee"), "Batch content wrong");
+    TEST_ASSERT(read_file_equals(c, "alpha BETA gamma\n"), "Patch not applied");
+    struct stat st;
+    TEST_ASSERT(stat(c, &st) == 0 && (st.st_mode & 0777) == 0640, "Mode not preserved");
+
+    // A failing patch aborts the batch before any rename
+    snprintf(args, sizeof(args),
+             "{\"files\":[{\"path\":\"%s\",\"content\":\"three\"},"
+             "{\"path\":\"%s\",\"find\":\"missing\",\"replace\":\"x\"}]}", a, c);
+    TEST_ASSERT(!read_with(tool, args, &result), "Broken batch succeeded");
+    TEST_ASSERT(read_file_equals(a, "two"), "Partial batch applied");
+
+    tool_result_free(&result);
+    tool->vtable->destroy(tool);
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "ls %s | wc -l", dir);
+    FILE* ls = popen(cmd, "r");
+    int entries = 0;
+    TEST_ASSERT(ls && fscanf(ls, "%d", &entries) == 1, "ls failed");
+    pclose(ls);
+    TEST_ASSERT(entries == 3, "Temp files left behind");
+
+    unlink(a);
+    unlink(b);
+    unlink(c);
+    rmdir(dir);
+    return true;
+}
+
+#define SIZECLASS_TEST_THREADS 4
+#define SIZECLASS_TEST_ROUNDS 20000
+
+// Allocates in one thread and frees in the next one, so blocks migrate
+// between thread caches through the depot
+typedef struct sizeclass_ring_t {
+    pthread_mutex_t lock;
+    void* slots[64];
+    size_t sizes[64];
+    uint32_t head;
+    uint32_t tail;
+} sizeclass_ring_t;
+
+static sizeclass_ring_t g_sc_rings[SIZECLASS_TEST_THREADS];
+
+static void* sizeclass_worker(void* arg) {
+    uintptr_t id = (uintptr_t)arg;
+    sizeclass_ring_t* out = &g_sc_rings[id];
+    sizeclass_ring_t* in = &g_sc_rings[(id + 1) % SIZECLASS_TEST_THREADS];
+    allocator_t* a = allocator_sizeclass();
+    uint32_t seed = (uint32_t)id * 2654435761u + 1;
+    uintptr_t bad = 0;
+
+    for (uint32_t i = 0; i < SIZECLASS_TEST_ROUNDS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        size_t size = 1 + (seed >> 8) % 3000;
+        unsigned char* p = alloc(a, size);
+        if (!p) return (void*)1;
+        memset(p, (int)(size & 0xFF), size);
+
+        pthread_mutex_lock(&out->lock);
+        bool queued = out->head - out->tail < 64;
+        if (queued) {
+            out->slots[out->head % 64] = p;
+            out->sizes[out->head % 64] = size;
+            out->head++;
+        }
+        pthread_mutex_unlock(&out->lock);
+        if (!queued) free_ptr(a, p, size);
+
+        pthread_mutex_lock(&in->lock);
+        void* q = NULL;
+        size_t qsize = 0;
+        if (in->head != in->tail) {
+            q = in->slots[in->tail % 64];
+            qsize = in->sizes[in->tail % 64];
+            in->tail++;
+        }
+        pthread_mutex_unlock(&in->lock);
+        if (q) {
+            unsigned char* bytes = q;
+            if (bytes[0] != (unsigned char)(qsize & 0xFF) || bytes[qsize - 1] != (unsigned char)(qsize & 0xFF)) bad = 1;
+            free_ptr(a, q, qsize);
+        }
+    }
+    return (void*)bad;
+}
+
+static bool test_sizeclass_allocator(void) {
+    allocator_t* a = allocator_sizeclass();
+
+    // A freed block is reused by the next allocation of its class
+    void* p = alloc(a, 100);
+    TEST_ASSERT(p != NULL, "Alloc failed");
+    free_ptr(a, p, 100);
+    void* q = alloc(a, 120);
+    TEST_ASSERT(q == p, "Block not recycled");
+
+    // Growing within the class keeps the block; crossing it moves
+    TEST_ASSERT(realloc_ptr(a, q, 120, 128) == q, "Same-class realloc moved");
+    memcpy(q, "payload", 8);
+    void* r = realloc_ptr(a, q, 128, 5000);
+    TEST_ASSERT(r && memcmp(r, "payload", 8) == 0, "Cross-class realloc lost data");
+    free_ptr(a, r, 5000);
+
+    // An over-aligned block is recycled into its class at full size
+    void* aligned = alloc_aligned(a, 130, 64);
+    TEST_ASSERT(aligned && ((uintptr_t)aligned % 64) == 0, "Aligned alloc misaligned");
+    free_ptr(a, aligned, 130);
+    void* full = alloc(a, 256);
+    TEST_ASSERT(full == aligned, "Aligned block not recycled");
+    memset(full, 0xab, 256);
+    free_ptr(a, full, 256);
+
+    for (uint32_t i = 0; i < SIZECLASS_TEST_THREADS; i++) pthread_mutex_init(&g_sc_rings[i].lock, NULL);
+    pthread_t threads[SIZECLASS_TEST_THREADS];
+    for (uintptr_t i = 0; i < SIZECLASS_TEST_THREADS; i++) {
+        TEST_ASSERT(pthread_create(&threads[i], NULL, sizeclass_worker, (void*)i) == 0, "Thread failed");
+    }
+    bool clean = true;
+    for (uint32_t i = 0; i < SIZECLASS_TEST_THREADS; i++) {
+        void* ret = NULL;
+        pthread_join(threads[i], &ret);
+        if (ret) clean = false;
+    }
+    for (uint32_t i = 0; i < SIZECLASS_TEST_THREADS; i++) {
+        sizeclass_ring_t* ring = &g_sc_rings[i];
+        for (; ring->tail != ring->head; ring->tail++) {
+            free_ptr(a, ring->slots[ring->tail % 64], ring->sizes[ring->tail % 64]);
+        }
+        pthread_mutex_destroy(&ring->lock);
+    }
+    TEST_ASSERT(clean, "Block corrupted across threads");
+
+    return true;
+}
+
+// Replies with the number of messages it was sent; tracks overlapping calls
+static uint32_t g_echo_inflight;
+static uint32_t g_echo_peak;
+
+static err_t echo_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                       const tool_def_t* tools, uint32_t tool_count, const char* model,
+                       double temperature, chat_response_t** out_response) {
+    uint32_t now = __atomic_add_fetch(&g_echo_inflight, 1, __ATOMIC_SEQ_CST);
+    uint32_t peak = __atomic_load_n(&g_echo_peak, __ATOMIC_SEQ_CST);
+    while (now > peak && !__atomic_compare_exchange_n(&g_echo_peak, &peak, now, false,
+                                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {}
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 30 * 1000000L };
+    nanosleep(&pause, NULL);
+
+    char count[16];
+    snprintf(count, sizeof(count), "%u", message_count);
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup_cstr(count, NULL);
+    __atomic_sub_fetch(&g_echo_inflight, 1, __ATOMIC_SEQ_CST);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_echo_provider = { .chat = echo_chat };
+
+// Three hits, best first; the middle one is far over any recall budget
+static char g_recall_big[4096];
+static char g_recall_system[8192];
+
+static err_t recall_search(memory_t* memory, const str_t* query, const memory_search_opts_t* opts,
+                           memory_entry_t** out_entries, uint32_t* out_count) {
+    if (!str_equal_cstr(*query, "when is the demo?") || !opts->snippets) return ERR_INVALID_ARGUMENT;
+    memset(g_recall_big, 'x', sizeof(g_recall_big) - 1);
+    const char* hits[3][2] = { { "demo", "Demo moved to Friday" }, { "notes", g_recall_big }, { "misc", "Unrelated" } };
+    memory_entry_t* entries = calloc(3, sizeof(memory_entry_t));
+    for (uint32_t i = 0; i < 3; i++) {
+        entries[i].key = str_dup_cstr(hits[i][0], NULL);
+        entries[i].content = str_dup_cstr(hits[i][1], NULL);
+    }
+    *out_entries = entries;
+    *out_count = 3;
+    return ERR_OK;
+}
+
+static const memory_vtable_t g_recall_memory = { .search = recall_search };
+
+// Keeps the system prompt it was sent
+static err_t prompt_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                         const tool_def_t* tools, uint32_t tool_count, const char* model,
+                         double temperature, chat_response_t** out_response) {
+    snprintf(g_recall_system, sizeof(g_recall_system), "%.*s", (int)messages[0].content.len, messages[0].content.data);
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup_cstr("ok", NULL);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_prompt_provider = { .chat = prompt_chat };
+
+static bool test_memory_prefetch(void) {
+    agent_config_t config = agent_config_default();
+    config.recall_top_k = 3;
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+    provider_t provider = { .vtable = &g_prompt_provider };
+    memory_t memory = { .vtable = &g_recall_memory };
+    agent->ctx->provider = &provider;
+    agent->ctx->memory = &memory;
+
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+    str_t input = STR_LIT("when is the demo?");
+    str_t reply = STR_NULL;
+    TEST_ASSERT(agent_process_message(agent, session, &input, &reply) == ERR_OK, "Turn failed");
+    free((void*)reply.data);
+
+    // Hits that fit the budget follow the usual prompt, without a tool call
+    TEST_ASSERT(strncmp(g_recall_system, AGENT_SYSTEM_PROMPT_EXTENDED, strlen(AGENT_SYSTEM_PROMPT_EXTENDED)) == 0,
+                "System prompt replaced");
+    TEST_ASSERT(strstr(g_recall_system, "- demo: Demo moved to Friday\n"), "Memory not in the system prompt");
+    TEST_ASSERT(!strstr(g_recall_system, "xxxx") && !strstr(g_recall_system, "Unrelated"), "Budget not kept");
+
+    // Off by default
+    agent->ctx->config.recall_top_k = 0;
+    TEST_ASSERT(agent_process_message(agent, session, &input, &reply) == ERR_OK, "Turn failed");
+    free((void*)reply.data);
+    TEST_ASSERT(strcmp(g_recall_system, AGENT_SYSTEM_PROMPT_EXTENDED) == 0, "Memories added when disabled");
+
+    agent->ctx->memory = NULL;
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+    return true;
+}
+
+typedef struct conversation_t {
+    agent_session_map_t* map;
+    char sender[16];
+    bool ok;
+} conversation_t;
+
+static void* conversation_worker(void* arg) {
+    conversation_t* conv = (conversation_t*)arg;
+    str_t channel = STR_LIT("telegram");
+    str_t sender = STR_VIEW(conv->sender);
+    // Distinct text, or identical requests would share one provider call
+    str_t input = sender;
+    conv->ok = true;
+
+    // System prompt + user, then + assistant + user: each chat has its own history
+    for (int turn = 0; turn < 2; turn++) {
+        str_t reply = STR_NULL;
+        err_t err = agent_session_map_process(conv->map, &channel, &sender, &input, &reply);
+        conv->ok = conv->ok && err == ERR_OK && str_equal_cstr(reply, turn == 0 ? "2" : "4");
+        free((void*)reply.data);
+    }
+    return NULL;
+}
+
+static bool test_session_map(void) {
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(NULL, &agent) == ERR_OK, "Agent create failed");
+    provider_t provider = { .vtable = &g_echo_provider };
+    agent->ctx->provider = &provider;
+
+    agent_session_map_t* map = NULL;
+    TEST_ASSERT(agent_session_map_create(agent, 4, &map) == ERR_OK, "Map create failed");
+
+    // Four senders on four different shards
+    conversation_t convs[4];
+    bool used[4] = { false };
+    uint32_t found = 0;
+    str_t channel = STR_LIT("telegram");
+    for (uint32_t i = 0; found < 4 && i < 1000; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "user%u", i);
+        str_t sender = STR_VIEW(name);
+        uint32_t shard = channel_route_hash(&channel, &sender) % 4;
+        if (used[shard]) continue;
+        used[shard] = true;
+        convs[found].map = map;
+        memcpy(convs[found].sender, name, sizeof(name));
+        found++;
+    }
+    TEST_ASSERT(found == 4, "Could not spread senders");
+
+    g_echo_inflight = 0;
+    g_echo_peak = 0;
+    pthread_t threads[4];
+    for (uint32_t i = 0; i < 4; i++) pthread_create(&threads[i], NULL, conversation_worker, &convs[i]);
+    for (uint32_t i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+
+    for (uint32_t i = 0; i < 4; i++) TEST_ASSERT(convs[i].ok, "Conversation history mixed up");
+    TEST_ASSERT(agent_session_map_count(map) == 4, "Wrong session count");
+    TEST_ASSERT(g_echo_peak > 1, "Different conversations did not overlap");
+    TEST_ASSERT(agent->ctx->session_count == 0, "Map sessions leaked into the agent list");
+
+    agent_session_map_destroy(map);
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+    return true;
+}
+
+// Streams "Hello, world" in three pieces; chat() answers in one
+static err_t pieces_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                         const tool_def_t* tools, uint32_t tool_count, const char* model,
+                         double temperature, chat_response_t** out_response) {
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup_cstr("Hello, world", NULL);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static err_t pieces_stream(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                           const tool_def_t* tools, uint32_t tool_count, const char* model,
+                           double temperature, stream_delta_callback_t on_delta, void* user_data) {
+    const char* pieces[] = { "Hello", ", ", "world" };
+    for (int i = 0; i < 3; i++) {
+        stream_delta_t delta = { .type = STREAM_DELTA_TEXT, .text = STR_VIEW(pieces[i]) };
+        on_delta(&delta, user_data);
+    }
+    stream_delta_t usage = { .type = STREAM_DELTA_USAGE, .prompt_tokens = 7, .completion_tokens = 3 };
+    on_delta(&usage, user_data);
+    stream_delta_t done = { .type = STREAM_DELTA_DONE };
+    on_delta(&done, user_data);
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_pieces_provider = { .chat = pieces_chat, .chat_stream_deltas = pieces_stream };
+
+typedef struct text_sink_t {
+    char text[64];
+    uint32_t calls;
+} text_sink_t;
+
+static void collect_text(const str_t* delta, void* user_data) {
+    text_sink_t* sink = (text_sink_t*)user_data;
+    strncat(sink->text, delta->data, delta->len);
+    sink->calls++;
+}
+
+// A channel without stream support: the reply arrives through send
+static char g_sent_text[64];
+static char g_sent_to[32];
+static uint32_t g_send_calls;
+
+static err_t record_send(channel_t* channel, const str_t* message, const str_t* recipient) {
+    snprintf(g_sent_text, sizeof(g_sent_text), "%.*s", (int)message->len, message->data);
+    snprintf(g_sent_to, sizeof(g_sent_to), "%.*s", (int)recipient->len, recipient->data);
+    g_send_calls++;
+    return ERR_OK;
+}
+
+static const channel_vtable_t g_record_channel = { .send = record_send };
+
+// Router test provider: answers with its name unless told to fail
+typedef struct flaky_t {
+    const char* name;
+    err_t fail_with;
+    uint32_t calls;
+} flaky_t;
+
+static err_t flaky_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                        const tool_def_t* tools, uint32_t tool_count, const char* model,
+                        double temperature, chat_response_t** out_response) {
+    flaky_t* flaky = provider->impl_data;
+    flaky->calls++;
+    if (flaky->fail_with != ERR_OK) return flaky->fail_with;
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup_cstr(flaky->name, NULL);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static err_t flaky_stream(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                          const tool_def_t* tools, uint32_t tool_count, const char* model,
+                          double temperature, stream_delta_callback_t on_delta, void* user_data) {
+    flaky_t* flaky = provider->impl_data;
+    flaky->calls++;
+    stream_delta_t delta = { .type = STREAM_DELTA_TEXT, .text = STR_VIEW(flaky->name) };
+    if (flaky->fail_with != ERR_OK) {
+        delta.type = STREAM_DELTA_ERROR;
+        delta.text = STR_LIT("overloaded");
+    }
+    on_delta(&delta, user_data);
+    stream_delta_t done = { .type = STREAM_DELTA_DONE };
+    on_delta(&done, user_data);
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_flaky_provider = { .chat = flaky_chat, .chat_stream_deltas = flaky_stream };
+
+static provider_t* flaky_provider(flaky_t* flaky) {
+    provider_t* provider = provider_alloc(&g_flaky_provider);
+    provider->config.name = STR_VIEW(flaky->name);
+    provider->impl_data = flaky;
+    return provider;
+}
+
+static void collect_delta_text(const stream_delta_t* delta, void* user_data) {
+    text_sink_t* sink = (text_sink_t*)user_data;
+    if (delta->type == STREAM_DELTA_TEXT) strncat(sink->text, delta->text.data, delta->text.len);
+    if (delta->type == STREAM_DELTA_ERROR) sink->calls++;
+}
+
+static bool test_provider_router(void) {
+    flaky_t a = { .name = "alpha" };
+    flaky_t b = { .name = "beta" };
+    provider_router_t* router = provider_router_create(NULL);
+    TEST_ASSERT(router, "Router create failed");
+    router->open_ms = 30;
+    TEST_ASSERT(provider_router_add_route(router, flaky_provider(&a), STR_NULL, STR_NULL) == ERR_OK, "Add failed");
+    TEST_ASSERT(provider_router_add_route(router, flaky_provider(&b), STR_NULL, STR_NULL) == ERR_OK, "Add failed");
+
+    // Unmeasured routes keep the configured order
+    uint32_t index = 9;
+    TEST_ASSERT(provider_router_select(router, NULL, 0, &index) == ERR_OK && index == 0, "Primary not preferred");
+
+    // Similar latency stays put; a clearly faster route takes over
+    provider_router_report(router, 0, ERR_OK, 1000000, 0);
+    provider_router_report(router, 1, ERR_OK, 900000, 0);
+    TEST_ASSERT(provider_router_select(router, NULL, 0, &index) == ERR_OK && index == 0, "Switched within margin");
+    for (int i = 0; i < 3; i++) provider_router_report(router, 0, ERR_OK, 3000000, 0);
+    TEST_ASSERT(provider_router_select(router, NULL, 0, &index) == ERR_OK && index == 1, "Slow route still chosen");
+    for (int i = 0; i < 8; i++) provider_router_report(router, 0, ERR_OK, 500000, 0);
+    TEST_ASSERT(provider_router_select(router, NULL, 0, &index) == ERR_OK && index == 0, "Recovered route ignored");
+
+    provider_t* routed = NULL;
+    TEST_ASSERT(provider_router_as_provider(router, &routed) == ERR_OK, "Routed provider failed");
+
+    // A failing route is skipped within the same request
+    a.fail_with = ERR_PROVIDER_UNAVAILABLE;
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_LIT("hi") };
+    chat_response_t* response = NULL;
+    TEST_ASSERT(routed->vtable->chat(routed, &message, 1, NULL, 0, NULL, 0.7, &response) == ERR_OK, "No failover");
+    TEST_ASSERT(str_equal_cstr(response->content, "beta") && a.calls == 1, "Wrong route answered");
+    chat_response_free(response);
+    TEST_ASSERT(provider_router_score(router, 0) > provider_router_score(router, 1), "Errors not scored");
+
+    // Consecutive failures open the circuit; the route gets no traffic
+    for (int i = 0; i < 2; i++) provider_router_report(router, 0, ERR_PROVIDER_UNAVAILABLE, 0, 0);
+    TEST_ASSERT(router->routes[0].circuit == CIRCUIT_OPEN, "Circuit did not open");
+    TEST_ASSERT(provider_router_select(router, NULL, 2, &index) == ERR_PROVIDER_UNAVAILABLE, "Open route chosen");
+
+    // After the cool-down one probe goes through; success closes the circuit
+    a.fail_with = ERR_OK;
+    usleep(40000);
+    TEST_ASSERT(provider_router_select(router, NULL, 0, &index) == ERR_OK && index == 0, "No probe sent");
+    TEST_ASSERT(router->routes[0].circuit == CIRCUIT_HALF_OPEN, "Probe not half-open");
+    TEST_ASSERT(provider_router_select(router, NULL, 2, &index) == ERR_PROVIDER_UNAVAILABLE, "Second probe sent");
+    provider_router_report(router, 0, ERR_OK, 500000, 0);
+    TEST_ASSERT(router->routes[0].circuit == CIRCUIT_CLOSED, "Probe success did not close");
+
+    // A failed probe backs off further
+    for (int i = 0; i < 3; i++) provider_router_report(router, 0, ERR_TIMEOUT, 0, 0);
+    usleep(40000);
+    provider_router_select(router, NULL, 2, &index);
+    provider_router_report(router, 0, ERR_TIMEOUT, 0, 0);
+    TEST_ASSERT(router->routes[0].circuit == CIRCUIT_OPEN && router->routes[0].open_ms == 60, "No probe backoff");
+
+    // An error before any streamed output fails over; the caller never sees it
+    b.fail_with = ERR_OK;
+    a.fail_with = ERR_PROVIDER;
+    router->routes[0].circuit = CIRCUIT_CLOSED;
+    router->routes[0].consecutive_failures = 0;
+    text_sink_t sink = {0};
+    TEST_ASSERT(routed->vtable->chat_stream_deltas(routed, &message, 1, NULL, 0, NULL, 0.7,
+                                                   collect_delta_text, &sink) == ERR_OK, "Stream failover failed");
+    TEST_ASSERT(strcmp(sink.text, "beta") == 0 && sink.calls == 0, "Stream error leaked");
+    TEST_ASSERT(router->routes[1].ttft_samples > 0, "TTFT not recorded");
+
+    // Hinted routes only serve matching models
+    flaky_t c = { .name = "gamma" };
+    TEST_ASSERT(provider_router_add_route(router, flaky_provider(&c), STR_LIT("gamma-large"), STR_LIT("gamma-"))
+                == ERR_OK, "Add failed");
+    TEST_ASSERT(provider_router_select(router, "other-model", 3, &index) == ERR_PROVIDER_UNAVAILABLE, "Hint ignored");
+    TEST_ASSERT(provider_router_select(router, "gamma-small", 3, &index) == ERR_OK && index == 2, "Hint not routed");
+
+    provider_free(routed);
+    return true;
+}
+
+// Upstream for the hedging test: the first request hangs until its
+// client goes away, the second is answered at once
+typedef struct stall_server_t {
+    int listen_fd;
+    uint16_t port;
+    bool primary_closed;
+} stall_server_t;
+
+static void* stall_server_main(void* arg) {
+    stall_server_t* server = (stall_server_t*)arg;
+    char buf[4096];
+
+    int stalled = accept(server->listen_fd, NULL, NULL);
+    if (stalled < 0) return NULL;
+    if (read(stalled, buf, sizeof(buf)) < 0) buf[0] = '\0';
+
+    int fast = accept(server->listen_fd, NULL, NULL);
+    if (fast >= 0) {
+        if (read(fast, buf, sizeof(buf)) < 0) buf[0] = '\0';
+        const char* reply = "HTTP/1.1 200 OK\r\nContent-Length: 6\r\nConnection: close\r\n\r\nhedged";
+        if (write(fast, reply, strlen(reply)) < 0) buf[0] = '\0';
+        close(fast);
+    }
+
+    struct pollfd pfd = { .fd = stalled, .events = POLLIN };
+    if (poll(&pfd, 1, 2000) == 1 && read(stalled, buf, sizeof(buf)) == 0) server->primary_closed = true;
+    close(stalled);
+    return NULL;
+}
+
+static uint16_t g_stall_port;
+
+static err_t stall_parse(char* json_str, size_t len, chat_response_t* out_response) {
+    (void)len;
+    out_response->content = str_dup_cstr(json_str, NULL);
+    return ERR_OK;
+}
+
+static err_t stall_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                        const tool_def_t* tools, uint32_t tool_count, const char* model,
+                        double temperature, chat_response_t** out_response) {
+    return ERR_PROVIDER;
+}
+
+static err_t stall_chat_async(provider_t* provider, http_engine_t* engine, const chat_message_t* messages,
+                              uint32_t message_count, const tool_def_t* tools, uint32_t tool_count,
+                              const char* model, double temperature, provider_chat_callback_t on_done,
+                              void* user_data) {
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/", (unsigned)g_stall_port);
+    return provider_submit_chat_async(provider, engine, url, "{}", stall_parse, on_done, user_data);
+}
+
+static const provider_vtable_t g_stall_provider = { .chat = stall_chat, .chat_async = stall_chat_async };
+
+static bool test_hedged_requests(void) {
+    stall_server_t server = {0};
+    server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    TEST_ASSERT(bind(server.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0, "Bind failed");
+    TEST_ASSERT(listen(server.listen_fd, 4) == 0, "Listen failed");
+    getsockname(server.listen_fd, (struct sockaddr*)&addr, &addr_len);
+    g_stall_port = ntohs(addr.sin_port);
+
+    provider_t provider = { .vtable = &g_stall_provider, .config.name = STR_LIT("hedge-test") };
+    provider.http = http_client_create(NULL);
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_LIT("hi") };
+    chat_response_t* response = NULL;
+
+    // Without a latency history the provider is called directly
+    TEST_ASSERT(provider_chat_hedged(&provider, NULL, &message, 1, NULL, 0, "m", 0.7, &response) == ERR_PROVIDER,
+                "Hedged without history");
+
+    metric_t* latency = metric_get(&METRIC_PROVIDER_LATENCY, STR_LIT("hedge-test"), STR_LIT("m"));
+    for (int i = 0; i < PROVIDER_HEDGE_MIN_SAMPLES; i++) metric_observe(latency, 50000);
+
+    // An exhausted budget sends no hedge either
+    provider_set_hedge_budget(0);
+    TEST_ASSERT(provider_chat_hedged(&provider, NULL, &message, 1, NULL, 0, "m", 0.7, &response) == ERR_PROVIDER,
+                "Hedged without budget");
+    provider_set_hedge_budget(PROVIDER_HEDGE_BUDGET_PER_MIN);
+
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, NULL, stall_server_main, &server) == 0, "Server thread failed");
+    uint64_t start = metrics_now_us();
+    err_t err = provider_chat_hedged(&provider, NULL, &message, 1, NULL, 0, "m", 0.7, &response);
+    uint64_t elapsed_us = metrics_now_us() - start;
+    pthread_join(thread, NULL);
+    close(server.listen_fd);
+
+    TEST_ASSERT(err == ERR_OK && str_equal_cstr(response->content, "hedged"), "Hedge did not answer");
+    TEST_ASSERT(elapsed_us < 1000000, "Hedge waited for the stalled request");
+    TEST_ASSERT(server.primary_closed, "Stalled request not cancelled");
+    metric_t* won = metric_get(&METRIC_PROVIDER_HEDGES, STR_LIT("hedge-test"), STR_LIT("won"));
+    TEST_ASSERT(metric_value(won) == 1, "Hedge win not counted");
+    chat_response_free(response);
+    http_client_destroy(provider.http);
+    return true;
+}
+
+// Answers one connection with a canned reply
+typedef struct canned_server_t {
+    int listen_fd;
+    uint16_t port;
+    const char* reply;
+    char request[512];             // Start of what the client sent
+} canned_server_t;
+
+static void* canned_server_main(void* arg) {
+    canned_server_t* server = (canned_server_t*)arg;
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    if (n >= 0) {
+        buf[n] = '\0';
+        snprintf(server->request, sizeof(server->request), "%s", buf);
+        if (write(fd, server->reply, strlen(server->reply)) < 0) buf[0] = '\0';
+    }
+    close(fd);
+    return NULL;
+}
+
+static bool canned_server_start(canned_server_t* server, pthread_t* thread) {
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) return false;
+    if (listen(server->listen_fd, 4) != 0) return false;
+    getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len);
+    server->port = ntohs(addr.sin_port);
+    return pthread_create(thread, NULL, canned_server_main, server) == 0;
+}
+
+static bool test_provider_prewarm(void) {
+    http_client_config_t http_config = http_client_default_config();
+    TEST_ASSERT(http_config.http2 && http_config.tcp_keepalive_secs == HTTP_TCP_KEEPALIVE_SECS_DEFAULT,
+                "HTTP/2 and keepalive not on by default");
+
+    // Any status means DNS, TCP and TLS are done
+    canned_server_t server = { .reply = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n" };
+    pthread_t thread;
+    TEST_ASSERT(canned_server_start(&server, &thread), "Server start failed");
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%u/v1", server.port);
+    provider_config_t config = { .name = STR_LIT("openai"), .api_key = STR_LIT("sk-test"),
+                                 .base_url = STR_VIEW(base_url) };
+    provider_t* provider = NULL;
+    TEST_ASSERT(openai_create(&config, &provider) == ERR_OK, "Provider create failed");
+    TEST_ASSERT(provider_prewarm(provider) == ERR_OK, "Prewarm failed");
+    pthread_join(thread, NULL);
+    close(server.listen_fd);
+    TEST_ASSERT(strncmp(server.request, "HEAD /v1 ", 9) == 0, "Prewarm did not HEAD the base URL");
+    provider_free(provider);
+
+    // Unreachable hosts are reported once every attempt has finished
+    config.base_url = STR_LIT("http://127.0.0.1:1");
+    provider_t* providers[2] = { NULL, NULL };
+    for (int i = 0; i < 2; i++) TEST_ASSERT(openai_create(&config, &providers[i]) == ERR_OK, "Create failed");
+    TEST_ASSERT(provider_prewarm_all(providers, 2) == ERR_NETWORK, "Refused prewarm not reported");
+    for (int i = 0; i < 2; i++) provider_free(providers[i]);
+    return true;
+}
+
+static bool test_http_compression(void) {
+    canned_server_t server = { .reply = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}" };
+    pthread_t thread;
+    TEST_ASSERT(canned_server_start(&server, &thread), "Server start failed");
+
+    // Bodies over the threshold leave gzipped; every response encoding is offered
+    http_client_config_t config = http_client_default_config();
+    config.compress_min_bytes = 64;
+    http_client_t* client = http_client_create(&config);
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/v1/chat", server.port);
+    char body[4096];
+    memset(body, ' ', sizeof(body) - 1);
+    body[0] = '[';
+    body[sizeof(body) - 2] = ']';
+    body[sizeof(body) - 1] = '\0';
+    http_response_t* response = NULL;
+    TEST_ASSERT(http_post_json(client, url, body, &response) == ERR_OK, "Compressed post failed");
+    pthread_join(thread, NULL);
+    close(server.listen_fd);
+    TEST_ASSERT(strcasestr(server.request, "Content-Encoding: gzip"), "Body not marked gzip");
+    TEST_ASSERT(strcasestr(server.request, "Accept-Encoding: ") && strstr(server.request, "gzip"),
+                "Response encodings not offered");
+    const char* length = strcasestr(server.request, "Content-Length: ");
+    TEST_ASSERT(length && strtoul(length + 16, NULL, 10) < 200, "Body sent uncompressed");
+    http_response_free(response);
+    http_client_destroy(client);
+    return true;
+}
+
+static bool test_rate_limits(void) {
+    // OpenAI-style headers
+    http_header_t headers[] = {
+        { STR_LIT("x-ratelimit-limit-requests"), STR_LIT("60") },
+        { STR_LIT("x-ratelimit-remaining-requests"), STR_LIT("0") },
+        { STR_LIT("x-ratelimit-reset-requests"), STR_LIT("1.5s") },
+        { STR_LIT("x-ratelimit-remaining-tokens"), STR_LIT("1000") },
+        { STR_LIT("x-ratelimit-reset-tokens"), STR_LIT("6m0s") },
+        { STR_LIT("Retry-After"), STR_LIT("2") },
+    };
+    http_response_t response = { .status_code = 429, .headers = headers, .headers_count = 6 };
+    rate_limit_info_t info;
+    rate_limit_parse(&response, &info);
+    TEST_ASSERT(info.requests_limit == 60 && info.requests_remaining == 0, "Request counts not parsed");
+    TEST_ASSERT(info.requests_reset_ms == 1500 && info.tokens_reset_ms == 360000, "Durations not parsed");
+    TEST_ASSERT(info.tokens_remaining == 1000 && info.retry_after_ms == 2000, "Retry-After not parsed");
+
+    // Anthropic reports resets as RFC 3339 times
+    char reset[32];
+    time_t later = time(NULL) + 10;
+    strftime(reset, sizeof(reset), "%Y-%m-%dT%H:%M:%SZ", gmtime(&later));
+    http_header_t anthropic[] = {
+        { STR_LIT("anthropic-ratelimit-requests-limit"), STR_LIT("50") },
+        { STR_LIT("anthropic-ratelimit-requests-remaining"), STR_LIT("49") },
+        { STR_LIT("anthropic-ratelimit-requests-reset"), STR_VIEW(reset) },
+    };
+    response = (http_response_t){ .status_code = 200, .headers = anthropic, .headers_count = 3 };
+    rate_limit_parse(&response, &info);
+    TEST_ASSERT(info.requests_remaining == 49 && info.retry_after_ms == 0, "Anthropic counts not parsed");
+    TEST_ASSERT(info.requests_reset_ms > 8000 && info.requests_reset_ms <= 10000, "RFC 3339 reset not parsed");
+
+    // Unknown keys are not throttled; reported limits space requests
+    rate_limit_reset();
+    uint64_t key = rate_limit_key(STR_LIT("test"), STR_LIT("sk-1"));
+    TEST_ASSERT(key != rate_limit_key(STR_LIT("test"), STR_LIT("sk-2")), "Keys collide");
+    TEST_ASSERT(rate_limit_reserve(key) == 0, "Unknown key throttled");
+    rate_limit_info_t limits = { .requests_limit = 2, .requests_remaining = 1, .requests_reset_ms = 200,
+                                 .tokens_remaining = -1 };
+    rate_limit_update(key, 200, &limits);
+    TEST_ASSERT(rate_limit_reserve(key) == 0, "Remaining permit not granted");
+    uint64_t wait = rate_limit_try(key);
+    TEST_ASSERT(wait > 0 && wait <= 200, "Empty bucket not spaced");
+    TEST_ASSERT(rate_limit_try(key) <= wait, "Try consumed a permit");
+    wait = rate_limit_reserve(key);
+    TEST_ASSERT(wait > 0 && wait <= 200, "Reservation not delayed");
+
+    // A 429 pauses the key for Retry-After
+    rate_limit_info_t refused = { .retry_after_ms = 300, .requests_limit = -1, .requests_remaining = -1,
+                                  .tokens_remaining = -1 };
+    rate_limit_update(key, 429, &refused);
+    TEST_ASSERT(rate_limit_blocked_ms(key) > 250, "429 did not pause");
+    TEST_ASSERT(rate_limit_reserve(key) > 250, "Paused key not delayed");
+
+    // Backoff doubles with jitter and honours the server's pause
+    retry_policy_t policy = { .max_retries = 5, .base_delay_ms = 100, .max_delay_ms = 1000 };
+    for (int i = 0; i < 20; i++) {
+        uint64_t first = retry_backoff_ms(&policy, 0, 0);
+        uint64_t late = retry_backoff_ms(&policy, 6, 0);
+        TEST_ASSERT(first >= 50 && first <= 100, "First backoff out of range");
+        TEST_ASSERT(late >= 500 && late <= 1000, "Backoff not capped");
+    }
+    TEST_ASSERT(retry_backoff_ms(&policy, 0, 2000) == 2000, "Server pause ignored");
+
+    TEST_ASSERT(rate_limit_status_error(429) == ERR_PROVIDER_RATE_LIMIT, "429 not rate limit");
+    TEST_ASSERT(rate_limit_status_error(503) == ERR_PROVIDER_UNAVAILABLE, "503 not unavailable");
+    TEST_ASSERT(rate_limit_status_error(401) == ERR_PROVIDER_AUTH, "401 not auth");
+    TEST_ASSERT(retry_is_retryable(ERR_PROVIDER_RATE_LIMIT) && !retry_is_retryable(ERR_PROVIDER),
+                "Wrong retry classification");
+
+    // End to end: response headers reach the limiter
+    canned_server_t server = { .reply = "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\n"
+                                        "Content-Length: 2\r\nConnection: close\r\n\r\n{}" };
+    pthread_t thread;
+    TEST_ASSERT(canned_server_start(&server, &thread), "Server start failed");
+    provider_t provider = { .config.name = STR_LIT("canned"), .config.api_key = STR_LIT("sk-3") };
+    provider.http = http_client_create(NULL);
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/", (unsigned)server.port);
+    http_response_t* reply = NULL;
+    err_t err = provider_post_json(&provider, url, "{}", &reply);
+    pthread_join(thread, NULL);
+    close(server.listen_fd);
+    http_client_destroy(provider.http);
+    TEST_ASSERT(err == ERR_PROVIDER_RATE_LIMIT, "429 not reported");
+    TEST_ASSERT(rate_limit_blocked_ms(rate_limit_key(STR_LIT("canned"), STR_LIT("sk-3"))) > 500,
+                "Retry-After header not applied");
+    rate_limit_reset();
+    return true;
+}
+
+static bool test_response_cache(void) {
+    char db_path[64];
+    snprintf(db_path, sizeof(db_path), "/tmp/cclaw_response_cache_%d.db", (int)getpid());
+    unlink(db_path);
+
+    response_cache_config_t config = { .max_entries = 2, .db_path = db_path };
+    response_cache_t* cache = NULL;
+    TEST_ASSERT(response_cache_create(&config, &cache) == ERR_OK, "Cache create failed");
+    flaky_t inner = { .name = "cached" };
+    provider_t* provider = NULL;
+    TEST_ASSERT(response_cache_wrap(cache, flaky_provider(&inner), &provider) == ERR_OK, "Wrap failed");
+
+    chat_message_t messages[2] = {
+        { .role = CHAT_ROLE_SYSTEM, .content = STR_LIT("Summarize.") },
+        { .role = CHAT_ROLE_USER, .content = STR_LIT("first") }
+    };
+    chat_response_t* response = NULL;
+
+    // Deterministic repeats are served without calling the provider
+    TEST_ASSERT(provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.0, &response) == ERR_OK,
+                "Miss failed");
+    chat_response_free(response);
+    TEST_ASSERT(provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.0, &response) == ERR_OK,
+                "Hit failed");
+    TEST_ASSERT(inner.calls == 1 && str_equal(response->content, STR_LIT("cached")), "Repeat not cached");
+    chat_response_free(response);
+
+    // Sampled, bypassed and different requests reach the provider
+    provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.7, &response);
+    chat_response_free(response);
+    bool previous = response_cache_set_bypass(true);
+    provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.0, &response);
+    chat_response_free(response);
+    response_cache_set_bypass(previous);
+    provider->vtable->chat(provider, messages, 2, NULL, 0, "other", 0.0, &response);
+    chat_response_free(response);
+    TEST_ASSERT(inner.calls == 4, "Uncacheable request served from cache");
+
+    // Two more keys evict the first from memory; SQLite still has it
+    messages[1].content = STR_LIT("second");
+    provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.0, &response);
+    chat_response_free(response);
+    messages[1].content = STR_LIT("first");
+    TEST_ASSERT(provider->vtable->chat(provider, messages, 2, NULL, 0, "m", 0.0, &response) == ERR_OK,
+                "Disk hit failed");
+    chat_response_free(response);
+    response_cache_stats_t stats;
+    response_cache_get_stats(cache, &stats);
+    TEST_ASSERT(inner.calls == 5 && stats.disk_hits == 1 && stats.memory_hits == 1, "Tiers not used");
+    TEST_ASSERT(stats.entries == 2, "LRU over capacity");
+    provider_free(provider);
+
+    // A fresh cache on the same database answers from disk
+    TEST_ASSERT(response_cache_create(&config, &cache) == ERR_OK, "Cache reopen failed");
+    uint8_t key[RESPONSE_CACHE_KEY_BYTES];
+    TEST_ASSERT(response_cache_key(cache, STR_LIT("cached"), "m", 0.0, messages, 2, NULL, 0, key),
+                "Key not computed");
+    TEST_ASSERT(response_cache_get(cache, key, &response), "Persisted entry missing");
+    TEST_ASSERT(str_equal(response->content, STR_LIT("cached")), "Persisted content wrong");
+    chat_response_free(response);
+    response_cache_clear(cache);
+    TEST_ASSERT(!response_cache_get(cache, key, &response), "Clear left entries");
+    response_cache_destroy(cache);
+    unlink(db_path);
+    return true;
+}
+
+// Slow upstream counting how many requests actually reach it
+static uint32_t g_slow_calls;
+
+static void slow_upstream(void) {
+    __atomic_add_fetch(&g_slow_calls, 1, __ATOMIC_SEQ_CST);
+    usleep(100000);
+}
+
+static err_t slow_chat(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                       const tool_def_t* tools, uint32_t tool_count, const char* model,
+                       double temperature, chat_response_t** out_response) {
+    slow_upstream();
+    chat_response_t* response = chat_response_create();
+    response->content = str_dup(messages[message_count - 1].content, NULL);
+    *out_response = response;
+    return ERR_OK;
+}
+
+static err_t slow_stream(provider_t* provider, const chat_message_t* messages, uint32_t message_count,
+                         const tool_def_t* tools, uint32_t tool_count, const char* model,
+                         double temperature, stream_delta_callback_t on_delta, void* user_data) {
+    stream_delta_t first = { .type = STREAM_DELTA_TEXT, .text = STR_LIT("Hello, ") };
+    on_delta(&first, user_data);
+    slow_upstream();
+    stream_delta_t second = { .type = STREAM_DELTA_TEXT, .text = messages[message_count - 1].content };
+    on_delta(&second, user_data);
+    stream_delta_t done = { .type = STREAM_DELTA_DONE };
+    on_delta(&done, user_data);
+    return ERR_OK;
+}
+
+static err_t slow_embed(provider_t* provider, const char* model, const str_t* texts, uint32_t count,
+                        uint32_t dimensions, float* out_vectors) {
+    slow_upstream();
+    for (uint32_t i = 0; i < count * dimensions; i++) out_vectors[i] = (float)(texts[i / dimensions].len + i);
+    return ERR_OK;
+}
+
+static const provider_vtable_t g_slow_provider = {
+    .chat = slow_chat, .chat_stream_deltas = slow_stream, .embed = slow_embed
+};
+
+typedef struct flight_caller_t {
+    provider_t* provider;
+    pthread_barrier_t* start;
+    int kind;                  // 0 chat, 1 stream, 2 embed
+    const char* text;
+    char reply[64];
+    float vectors[8];
+    err_t err;
+} flight_caller_t;
+
+static void* flight_caller_main(void* arg) {
+    flight_caller_t* caller = arg;
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_VIEW(caller->text) };
+    pthread_barrier_wait(caller->start);
+    if (caller->kind == 0) {
+        chat_response_t* response = NULL;
+        caller->err = provider_chat_hedged(caller->provider, NULL, &message, 1, NULL, 0, "m", 0.7, &response);
+        if (caller->err == ERR_OK) snprintf(caller->reply, sizeof(caller->reply), "%s", response->content.data);
+        chat_response_free(response);
+    } else if (caller->kind == 1) {
+        text_sink_t sink = {0};
+        caller->err = provider_chat_stream_deltas(caller->provider, &message, 1, NULL, 0, "m", 0.7,
+                                                  collect_delta_text, &sink);
+        snprintf(caller->reply, sizeof(caller->reply), "%s", sink.text);
+    } else {
+        str_t texts[2] = { STR_VIEW(caller->text), STR_LIT("b") };
+        caller->err = provider_embed(caller->provider, "e", texts, 2, 4, caller->vectors);
+    }
+    return NULL;
+}
+
+static bool run_flight(provider_t* provider, int kind, const char** texts, uint32_t count,
+                       flight_caller_t* callers) {
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, count);
+    pthread_t threads[4];
+    for (uint32_t i = 0; i < count; i++) {
+        memset(&callers[i], 0, sizeof(flight_caller_t));
+        callers[i] = (flight_caller_t){ .provider = provider, .start = &start, .kind = kind, .text = texts[i] };
+        pthread_create(&threads[i], NULL, flight_caller_main, &callers[i]);
+    }
+    for (uint32_t i = 0; i < count; i++) pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&start);
+    for (uint32_t i = 0; i < count; i++) {
+        if (callers[i].err != ERR_OK) return false;
+    }
+    return true;
+}
+
+static bool test_singleflight(void) {
+    provider_t provider = { .vtable = &g_slow_provider, .config.name = STR_LIT("slow") };
+    const char* same[4] = { "world", "world", "world", "world" };
+    flight_caller_t callers[4];
+
+    // Identical chats share one upstream call
+    g_slow_calls = 0;
+    uint64_t shared = singleflight_shared_count();
+    TEST_ASSERT(run_flight(&provider, 0, same, 4, callers), "Chat failed");
+    TEST_ASSERT(g_slow_calls == 1, "Identical chats not coalesced");
+    TEST_ASSERT(singleflight_shared_count() - shared == 3, "Followers not counted");
+    for (int i = 0; i < 4; i++) TEST_ASSERT(strcmp(callers[i].reply, "world") == 0, "Follower reply wrong");
+
+    // Stream followers see every delta, including those sent before they joined
+    g_slow_calls = 0;
+    TEST_ASSERT(run_flight(&provider, 1, same, 3, callers), "Stream failed");
+    TEST_ASSERT(g_slow_calls == 1, "Identical streams not coalesced");
+    for (int i = 0; i < 3; i++) TEST_ASSERT(strcmp(callers[i].reply, "Hello, world") == 0, "Replayed stream wrong");
+
+    // Embeddings, and different requests stay apart
+    g_slow_calls = 0;
+    TEST_ASSERT(run_flight(&provider, 2, same, 3, callers), "Embed failed");
+    TEST_ASSERT(g_slow_calls == 1, "Identical embeddings not coalesced");
+    TEST_ASSERT(memcmp(callers[0].vectors, callers[2].vectors, sizeof(callers[0].vectors)) == 0 &&
+                callers[0].vectors[7] == 8.0f, "Follower vectors wrong");
+
+    const char* different[2] = { "one", "two" };
+    g_slow_calls = 0;
+    TEST_ASSERT(run_flight(&provider, 0, different, 2, callers), "Distinct chats failed");
+    TEST_ASSERT(g_slow_calls == 2 && strcmp(callers[1].reply, "two") == 0, "Distinct chats coalesced");
+    return true;
+}
+
+// Plays the OpenAI files and batches endpoints for one batch
+typedef struct batch_server_t {
+    int listen_fd;
+    uint16_t port;
+    char upload[8192];
+    int polls;
+} batch_server_t;
+
+static void* batch_server_main(void* arg) {
+    batch_server_t* server = (batch_server_t*)arg;
+    // Upload, create, two polls, results
+    for (int handled = 0; handled < 5; handled++) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) return NULL;
+        char req[8192] = {0};
+        size_t len = 0;
+        char* body = NULL;
+        while (len < sizeof(req) - 1) {
+            ssize_t n = read(fd, req + len, sizeof(req) - 1 - len);
+            if (n <= 0) break;
+            len += (size_t)n;
+            body = strstr(req, "\r\n\r\n");
+            if (!body) continue;
+            if (strcasestr(req, "Expect: 100-continue") && !strstr(body + 4, "--")) {
+                if (write(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25) < 0) break;
+            }
+            const char* cl = strcasestr(req, "Content-Length:");
+            size_t want = cl ? strtoul(cl + 15, NULL, 10) : 0;
+            if (len - (size_t)(body + 4 - req) >= want) break;
+        }
+
+        const char* reply = "{}";
+        if (strncmp(req, "POST /files", 11) == 0) {
+            snprintf(server->upload, sizeof(server->upload), "%s", body ? body + 4 : "");
+            reply = "{\"id\":\"file-in\"}";
+        } else if (strncmp(req, "POST /batches", 13) == 0) {
+            reply = strstr(req, "\"input_file_id\":\"file-in\"") ? "{\"id\":\"batch_1\"}" : "{}";
+        } else if (strncmp(req, "GET /batches/batch_1", 20) == 0) {
+            reply = server->polls++ == 0 ? "{\"status\":\"in_progress\"}"
+                                         : "{\"status\":\"completed\",\"output_file_id\":\"file-out\"}";
+        } else if (strncmp(req, "GET /files/file-out/content", 27) == 0) {
+            // Out of order, the way batches finish
+            reply = "{\"custom_id\":\"1\",\"response\":{\"status_code\":200,\"body\":"
+                    "{\"choices\":[{\"message\":{\"content\":\"reply-1\"}}]}}}\n"
+                    "{\"custom_id\":\"0\",\"response\":{\"status_code\":200,\"body\":"
+                    "{\"choices\":[{\"message\":{\"content\":\"reply-0\"}}]}}}\n";
+        }
+        char head[256];
+        int head_len = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                "Content-Length: %zu\r\nConnection: close\r\n\r\n", strlen(reply));
+        if (write(fd, head, (size_t)head_len) >= 0 && write(fd, reply, strlen(reply)) < 0) head[0] = '\0';
+        close(fd);
+    }
+    return NULL;
+}
+
+typedef struct batch_caller_t {
+    provider_batch_t* batch;
+    const char* text;
+    err_t err;
+    chat_response_t* response;
+} batch_caller_t;
+
+static void* batch_caller_main(void* arg) {
+    batch_caller_t* caller = (batch_caller_t*)arg;
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_VIEW(caller->text) };
+    caller->err = provider_batch_chat(caller->batch, &message, 1, NULL, 0, "gpt-4o-mini", 0.0, &caller->response);
+    return NULL;
+}
+
+static void record_batch_chat(err_t err, chat_response_t* response, void* user_data) {
+    batch_caller_t* caller = (batch_caller_t*)user_data;
+    caller->err = err;
+    caller->response = response;
+}
+
+static bool test_provider_batch(void) {
+    batch_server_t server = {0};
+    server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    TEST_ASSERT(bind(server.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+                listen(server.listen_fd, 8) == 0, "Server listen failed");
+    getsockname(server.listen_fd, (struct sockaddr*)&addr, &addr_len);
+    server.port = ntohs(addr.sin_port);
+    pthread_t server_thread;
+    TEST_ASSERT(pthread_create(&server_thread, NULL, batch_server_main, &server) == 0, "Server start failed");
+
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%u", server.port);
+    provider_config_t config = { .name = STR_LIT("openai"), .api_key = STR_LIT("sk-test"),
+                                 .base_url = STR_VIEW(base_url) };
+    provider_t* provider = NULL;
+    TEST_ASSERT(openai_create(&config, &provider) == ERR_OK, "Provider create failed");
+    TEST_ASSERT(provider_batch_supported(provider), "OpenAI batches not supported");
+
+    // Two blocking callers ride in one batch and each gets its own result
+    provider_batch_config_t batch_config = { .flush_ms = 100, .poll_min_ms = 10, .poll_max_ms = 20 };
+    provider_batch_t* batch = NULL;
+    TEST_ASSERT(provider_batch_create(provider, &batch_config, &batch) == ERR_OK, "Batch create failed");
+    batch_caller_t callers[2] = { { .batch = batch, .text = "zero" }, { .batch = batch, .text = "one" } };
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, batch_caller_main, &callers[0]);
+    while (1) {
+        provider_batch_stats_t stats;
+        provider_batch_get_stats(batch, &stats);
+        if (stats.queued == 1) break;
+        usleep(1000);
+    }
+    pthread_create(&threads[1], NULL, batch_caller_main, &callers[1]);
+    for (int i = 0; i < 2; i++) pthread_join(threads[i], NULL);
+    pthread_join(server_thread, NULL);
+    close(server.listen_fd);
+
+    TEST_ASSERT(callers[0].err == ERR_OK && callers[1].err == ERR_OK, "Batched chat failed");
+    TEST_ASSERT(str_equal_cstr(callers[0].response->content, "reply-0") &&
+                str_equal_cstr(callers[1].response->content, "reply-1"), "Results matched to wrong callers");
+    TEST_ASSERT(strstr(server.upload, "name=\"purpose\"") && strstr(server.upload, "\"custom_id\":\"0\"") &&
+                strstr(server.upload, "\"custom_id\":\"1\"") &&
+                strstr(server.upload, "\"url\":\"/v1/chat/completions\""), "Upload not a batch JSONL file");
+    provider_batch_stats_t stats;
+    provider_batch_get_stats(batch, &stats);
+    TEST_ASSERT(stats.submitted == 1 && stats.requests == 2 && stats.polls == 2 && stats.in_flight == 0,
+                "Batch stats wrong");
+    for (int i = 0; i < 2; i++) chat_response_free(callers[i].response);
+
+    // Whatever is still queued at shutdown is cancelled
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_LIT("late") };
+    batch_caller_t late = { .err = ERR_OK };
+    TEST_ASSERT(provider_batch_chat_async(batch, &message, 1, NULL, 0, "m", 0.0, record_batch_chat, &late) == ERR_OK,
+                "Async chat not queued");
+    provider_batch_destroy(batch);
+    TEST_ASSERT(late.err == ERR_CANCELLED && !late.response, "Queued chat not cancelled");
+    provider_free(provider);
+    return true;
+}
+
+static bool test_streaming_reply(void) {
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(NULL, &agent) == ERR_OK, "Agent create failed");
+    provider_t provider = { .vtable = &g_pieces_provider };
+    agent->ctx->provider = &provider;
+    agent_session_t* session = NULL;
+    TEST_ASSERT(agent_session_create(agent, NULL, &session) == ERR_OK, "Session create failed");
+
+    // Deltas reach the sink as the provider emits them
+    text_sink_t sink = {0};
+    str_t input = STR_LIT("hi");
+    str_t reply = STR_NULL;
+    TEST_ASSERT(agent_process_message_stream(agent, session, &input, collect_text, &sink, &reply) == ERR_OK,
+                "Streamed turn failed");
+    TEST_ASSERT(sink.calls == 3 && strcmp(sink.text, "Hello, world") == 0, "Deltas not forwarded");
+    TEST_ASSERT(str_equal_cstr(reply, "Hello, world"), "Streamed reply not assembled");
+    TEST_ASSERT(session->current->tokens_input == 7 && session->current->tokens_output == 3,
+                "Stream usage lost");
+    free((void*)reply.data);
+
+    // With streaming off the sink gets the whole completion once
+    agent->ctx->config.stream_responses = false;
+    memset(&sink, 0, sizeof(sink));
+    TEST_ASSERT(agent_process_message_stream(agent, session, &input, collect_text, &sink, &reply) == ERR_OK,
+                "Buffered turn failed");
+    TEST_ASSERT(sink.calls == 1 && strcmp(sink.text, "Hello, world") == 0, "Completion not forwarded");
+    free((void*)reply.data);
+    agent->ctx->config.stream_responses = true;
+
+    // Channels without stream_* get the assembled text through send
+    channel_t channel = { .vtable = &g_record_channel };
+    channel_stream_t* stream = NULL;
+    str_t recipient = STR_LIT("alice");
+    TEST_ASSERT(channel_stream_begin(&channel, &recipient, &stream) == ERR_OK, "Stream begin failed");
+    TEST_ASSERT(!stream->native, "Fallback stream claimed native support");
+    g_send_calls = 0;
+    TEST_ASSERT(agent_process_message_stream(agent, session, &input, channel_stream_on_text, stream, &reply) == ERR_OK,
+                "Channel turn failed");
+    TEST_ASSERT(g_send_calls == 0, "Sent before the stream ended");
+    TEST_ASSERT(channel_stream_end(stream) == ERR_OK, "Stream end failed");
+    TEST_ASSERT(g_send_calls == 1 && strcmp(g_sent_text, "Hello, world") == 0 && strcmp(g_sent_to, "alice") == 0,
+                "Fallback send wrong");
+    free((void*)reply.data);
+
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+    return true;
+}
+
+static void collect_chunk(const char* chunk, void* user_data) {
+    text_sink_t* sink = (text_sink_t*)user_data;
+    strncat(sink->text, chunk, sizeof(sink->text) - strlen(sink->text) - 1);
+    sink->calls++;
+}
+
+static size_t discard_data(const char* data, size_t len, void* user_data) {
+    return len;
+}
+
+// Live exchange against a canned server while capturing, then the replay
+static bool capture_exchange(const char* reply, const char* prompt, bool stream) {
+    canned_server_t server = { .reply = reply };
+    pthread_t thread;
+    TEST_ASSERT(canned_server_start(&server, &thread), "Server start failed");
+    char url[64], body[256];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/v1/chat/completions", server.port);
+    snprintf(body, sizeof(body), "{\"model\":\"gpt-4o\",\"stream\":%s,\"messages\":"
+             "[{\"role\":\"system\",\"content\":\"Be brief\"},{\"role\":\"user\",\"content\":\"%s\"}]}",
+             stream ? "true" : "false", prompt);
+
+    http_client_config_t config = http_client_default_config();
+    http_client_t* client = http_client_create(&config);
+    http_response_t* response = NULL;
+    err_t err = stream ? http_post_json_stream(client, url, body, discard_data, NULL)
+                       : http_post_json(client, url, body, &response);
+    pthread_join(thread, NULL);
+    close(server.listen_fd);
+    http_response_free(response);
+    http_client_destroy(client);
+    TEST_ASSERT(err == ERR_OK, "Live exchange failed");
+    return true;
+}
+
+static bool test_http_replay(void) {
+    char path[] = "/tmp/cclaw_capture_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0, "mkstemp failed");
+    close(fd);
+
+    static const char chat_reply[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 63\r\n\r\n"
+        "{\"choices\":[{\"message\":{\"role\":\"assistant\",\"content\":\"pong\"}}]}";
+    static const char stream_reply[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nConnection: close\r\n\r\n"
+        "data: {\"choices\":[{\"delta\":{\"content\":\"Hel\"}}]}\n\n"
+        "data: {\"choices\":[{\"delta\":{\"content\":\"lo\"}}]}\n\n"
+        "data: [DONE]\n\n";
+
+    TEST_ASSERT(http_capture_start(path) == ERR_OK, "Capture start failed");
+    bool ok = capture_exchange(chat_reply, "ping", false) && capture_exchange(stream_reply, "say hello", true);
+    http_capture_stop();
+    TEST_ASSERT(ok, "Live exchanges failed");
+
+    // A line cut short while recording is skipped
+    FILE* file = fopen(path, "a");
+    TEST_ASSERT(file != NULL, "Capture not writable");
+    fputs("{\"method\":\"POST\",\"url\":\"http://x/v1/chat/comp\n", file);
+    fclose(file);
+
+    provider_config_t config = { .name = STR_LIT("replay"), .base_url = STR_VIEW(path) };
+    provider_t* provider = NULL;
+    TEST_ASSERT(replay_create(&config, &provider) == ERR_OK, "Replay create failed");
+    TEST_ASSERT(replay_set_time_scale(provider, 0.0) == ERR_OK, "Time scale rejected");
+    replay_stats_t stats;
+    replay_get_stats(provider, &stats);
+    TEST_ASSERT(stats.exchanges == 2 && stats.skipped == 1, "Capture not loaded");
+
+    // Matched by prompt, then in turn for prompts never recorded
+    chat_message_t message = { .role = CHAT_ROLE_USER, .content = STR_LIT("ping") };
+    chat_response_t* response = NULL;
+    TEST_ASSERT(provider->vtable->chat(provider, &message, 1, NULL, 0, "m", 0.0, &response) == ERR_OK,
+                "Replayed chat failed");
+    TEST_ASSERT(str_equal(response->content, STR_LIT("pong")), "Replayed content wrong");
+    chat_response_free(response);
+    message.content = STR_LIT("something else");
+    response = NULL;
+    TEST_ASSERT(provider->vtable->chat(provider, &message, 1, NULL, 0, "m", 0.0, &response) == ERR_OK,
+                "Unmatched chat failed");
+    chat_response_free(response);
+
+    text_sink_t sink = {0};
+    TEST_ASSERT(provider->vtable->chat_stream(provider, &message, 1, "m", 0.0, collect_chunk, &sink) == ERR_OK,
+                "Replayed stream failed");
+    TEST_ASSERT(strcmp(sink.text, "Hello") == 0, "Replayed stream wrong");
+
+    replay_get_stats(provider, &stats);
+    TEST_ASSERT(stats.served == 3 && stats.matched == 1, "Replay stats wrong");
+    provider_free(provider);
+    unlink(path);
+    return true;
+}
+
+static bool test_loadgen(void) {
+    char path[] = "/tmp/cclaw_loadgen_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0, "mkstemp failed");
+    static const char capture[] =
+        "{\"method\":\"POST\",\"url\":\"https://api.openai.com/v1/chat/completions\",\"request\":\"{}\","
+        "\"stream\":true,\"status\":200,\"elapsed_ms\":2,\"chunks\":["
+        "{\"at_ms\":1,\"data\":\"data: {\\\"choices\\\":[{\\\"delta\\\":{\\\"content\\\":\\\"Hi\\\"}}]}\\n\\n\"},"
+        "{\"at_ms\":2,\"data\":\"data: [DONE]\\n\\n\"}]}\n";
+    TEST_ASSERT(write(fd, capture, sizeof(capture) - 1) == (ssize_t)(sizeof(capture) - 1), "Capture write failed");
+    close(fd);
+
+    provider_config_t provider_config = { .name = STR_LIT("replay"), .base_url = STR_VIEW(path) };
+    provider_t* provider = NULL;
+    TEST_ASSERT(replay_create(&provider_config, &provider) == ERR_OK, "Replay create failed");
+    replay_set_time_scale(provider, 0.0);
+
+    loadgen_config_t config = loadgen_config_default();
+    config.provider = provider;
+    config.sessions = 3;
+    config.turns = 0;
+    TEST_ASSERT(loadgen_run(&config, &(loadgen_report_t){0}) == ERR_INVALID_ARGUMENT, "Unbounded run accepted");
+
+    // Every turn streams, so every turn has a first token
+    config.turns = 5;
+    config.think_ms = 1;
+    config.tool_ratio = 1.0;
+    config.seed = 7;
+    loadgen_report_t report;
+    TEST_ASSERT(loadgen_run(&config, &report) == ERR_OK, "Run failed");
+    TEST_ASSERT(report.turns == 15 && report.errors == 0 && report.tool_turns == 15, "Turns not all run");
+    TEST_ASSERT(report.ttft_count == 15 && report.ttft_p50_us <= report.latency_p50_us, "First tokens not timed");
+    TEST_ASSERT(report.latency_p50_us <= report.latency_p95_us && report.latency_p95_us <= report.latency_p99_us &&
+                report.latency_p99_us <= report.latency_max_us, "Percentiles out of order");
+    TEST_ASSERT(report.peak_rss_bytes > 0 && report.turns_per_s > 0, "Process peaks missing");
+
+    char* json = NULL;
+    TEST_ASSERT(loadgen_report_json(&report, &json) == ERR_OK && strstr(json, "\"turns\":15"), "JSON report wrong");
+    free(json);
+
+    provider_free(provider);
+    unlink(path);
+    return true;
+}
+
+static bool test_alloc_tags(void) {
+    // The tagged allocator and direct accounting land on the same tag
+    allocator_t* tagged = allocator_tagged(ALLOC_TAG_MEMORY);
+    alloc_tag_stats_t before, stats;
+    alloc_tag_stats(ALLOC_TAG_MEMORY, &before);
+    void* block = tagged->vtable->alloc(tagged, 1000, 8);
+    TEST_ASSERT(block && alloc_tag_live(ALLOC_TAG_MEMORY) == before.live + 1000, "Tagged alloc not counted");
+    block = tagged->vtable->realloc(tagged, block, 1000, 3000, 8);
+    alloc_tag_stats(ALLOC_TAG_MEMORY, &stats);
+    TEST_ASSERT(block && stats.live == before.live + 3000, "Realloc not counted");
+    tagged->vtable->free(tagged, block, 3000);
+    alloc_tag_stats(ALLOC_TAG_MEMORY, &stats);
+    TEST_ASSERT(stats.live == before.live && stats.allocations == before.allocations + 2, "Free not counted");
+    TEST_ASSERT(stats.peak >= before.live + 3000, "Peak seen on read lost");
+
+    // Arenas charge what they hold: the region, overflow chunks, the folded region
+    size_t base = alloc_tag_live(ALLOC_TAG_PROVIDER);
+    arena_allocator_t* arena = arena_create(4096);
+    arena_set_tag(arena, ALLOC_TAG_PROVIDER);
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_PROVIDER) == base + 4096, "Region not charged");
+    TEST_ASSERT(arena->base.vtable->alloc(&arena->base, 10000, 8), "Arena alloc failed");
+    size_t grown = alloc_tag_live(ALLOC_TAG_PROVIDER);
+    TEST_ASSERT(grown == base + 4096 + arena->chunk_bytes, "Chunk not charged");
+    arena_reset(arena);
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_PROVIDER) == base + arena->region_size, "Fold not charged");
+    arena_set_tag(arena, ALLOC_TAG_NONE);
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_PROVIDER) == base, "Untagging left bytes behind");
+    arena_set_tag(arena, ALLOC_TAG_PROVIDER);
+    arena_destroy(arena);
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_PROVIDER) == base, "Destroy left bytes behind");
+
+    // A JSON buffer is charged while it is built, not once handed over
+    base = alloc_tag_live(ALLOC_TAG_JSON);
+    json_writer_t w;
+    json_writer_init(&w, 100);
+    json_write_object_begin(&w);
+    json_write_kv_str(&w, "text", STR_LIT("hello"));
+    json_write_object_end(&w);
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_JSON) > base, "Writer not charged");
+    free(json_writer_finish(&w, NULL));
+    TEST_ASSERT(alloc_tag_live(ALLOC_TAG_JSON) == base, "Finished writer still charged");
+
+    // Budgets and the export
+    base = alloc_tag_live(ALLOC_TAG_TUI);
+    alloc_tag_set_budget(ALLOC_TAG_TUI, base + 100);
+    TEST_ASSERT(!alloc_tag_over_budget(ALLOC_TAG_TUI), "Under budget reported over");
+    alloc_tag_add(ALLOC_TAG_TUI, 200);
+    TEST_ASSERT(alloc_tag_over_budget(ALLOC_TAG_TUI), "Over budget not reported");
+    str_t text = STR_NULL;
+    TEST_ASSERT(metrics_export_prometheus(&text) == ERR_OK, "Export failed");
+    TEST_ASSERT(strstr(text.data, "# TYPE cclaw_alloc_bytes gauge\n"), "Family missing");
+    char line[96];
+    snprintf(line, sizeof(line), "cclaw_alloc_bytes{subsystem=\"tui\"} %zu\n", base + 200);
+    TEST_ASSERT(strstr(text.data, line), "Live bytes not exported");
+    snprintf(line, sizeof(line), "cclaw_alloc_budget_bytes{subsystem=\"tui\"} %zu\n", base + 100);
+    TEST_ASSERT(strstr(text.data, line), "Budget not exported");
+    TEST_ASSERT(!strstr(text.data, "cclaw_alloc_budget_bytes{subsystem=\"agent\"}"), "Unset budget exported");
+    free((void*)text.data);
+    alloc_tag_sub(ALLOC_TAG_TUI, 200);
+    alloc_tag_set_budget(ALLOC_TAG_TUI, 0);
+
+    // Over the agent budget, a turn closes the shard's other logged
+    // sessions; the next turn reopens one from its log with its history
+    char dir[64] = "/tmp/cclaw_alloc_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir), "mkdtemp failed");
+    agent_config_t config = agent_config_default();
+    config.sessions_dir = str_dup_cstr(dir, NULL);
+    config.session_memory_budget = 1;
+    agent_t* agent = NULL;
+    TEST_ASSERT(agent_create(&config, &agent) == ERR_OK, "Agent create failed");
+    provider_t provider = { .vtable = &g_echo_provider };
+    agent->ctx->provider = &provider;
+    agent_session_map_t* map = NULL;
+    TEST_ASSERT(agent_session_map_create(agent, 1, &map) == ERR_OK, "Map create failed");
+
+    str_t channel = STR_LIT("webhook");
+    str_t alice = STR_LIT("alice"), bob = STR_LIT("bob");
+    const str_t* turns[] = { &alice, &bob, &alice };
+    const char* expected[] = { "2", "2", "4" };
+    for (int i = 0; i < 3; i++) {
+        str_t reply = STR_NULL;
+        err_t err = agent_session_map_process(map, &channel, turns[i], turns[i], &reply);
+        bool ok = err == ERR_OK && str_equal_cstr(reply, expected[i]);
+        free((void*)reply.data);
+        TEST_ASSERT(ok, "Turn lost its history");
+        TEST_ASSERT(agent_session_map_count(map) == 1, "Idle session not evicted");
+    }
+
+    agent_session_map_destroy(map);
+    alloc_tag_set_budget(ALLOC_TAG_AGENT, 0);
+    agent->ctx->provider = NULL;
+    agent_destroy(agent);
+
+    DIR* d = opendir(dir);
+    for (struct dirent* e; d && (e = readdir(d));) {
+        if (e->d_name[0] == '.') continue;
+        char path[160];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    if (d) closedir(d);
+    rmdir(dir);
+    return true;
+}
+
+// Local wall-clock time in ms, so the expectations hold in any time zone
+static uint64_t local_ms(int year, int month, int day, int hour, int minute) {
+    struct tm tm = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day,
+                     .tm_hour = hour, .tm_min = minute, .tm_isdst = -1 };
+    return (uint64_t)mktime(&tm) * 1000;
+}
+
+static bool cron_next(const char* expression, uint64_t after, uint64_t expected) {
+    cron_job_t job = {0};
+    str_t expr = { .data = expression, .len = (uint32_t)strlen(expression) };
+    return cron_parse_expression(&expr, &job) == ERR_OK &&
+           cron_compute_next_run(&job, after) == ERR_OK && job.next_run == expected;
+}
+
+static bool test_cron_expressions(void) {
+    // 2026-01-05 is a Monday
+    uint64_t monday = local_ms(2026, 1, 5, 17, 50);
+    TEST_ASSERT(cron_next("*/15 9-17 * * 1-5", monday, local_ms(2026, 1, 6, 9, 0)), "Step in range");
+    TEST_ASSERT(cron_next("0,30 * * * *", local_ms(2026, 1, 5, 10, 1), local_ms(2026, 1, 5, 10, 30)), "List");
+    TEST_ASSERT(cron_next("5/20 * * * *", local_ms(2026, 1, 5, 10, 30), local_ms(2026, 1, 5, 10, 45)), "N/step");
+    TEST_ASSERT(cron_next("0 8 * jun-aug sat,sun", monday, local_ms(2026, 6, 6, 8, 0)), "Names");
+    TEST_ASSERT(cron_next("0 0 * * 7", monday, local_ms(2026, 1, 11, 0, 0)), "Sunday as 7");
+    TEST_ASSERT(cron_next("@hourly", monday, local_ms(2026, 1, 5, 18, 0)), "@hourly");
+    TEST_ASSERT(cron_next("@yearly", monday, local_ms(2027, 1, 1, 0, 0)), "@yearly");
+
+    // Both day fields restricted: the 13th or any Friday
+    TEST_ASSERT(cron_next("0 0 13 * 5", monday, local_ms(2026, 1, 9, 0, 0)), "Friday missed");
+    TEST_ASSERT(cron_next("0 0 13 * 5", local_ms(2026, 1, 10, 0, 0), local_ms(2026, 1, 13, 0, 0)),
+                "13th missed");
+
+    const char* bad[] = { "60 * * * *", "* 24 * * *", "* * 0 * *", "* * * 13 *", "* * * * 8",
+                          "*/0 * * * *", "5-1 * * * *", "* * * foo *", "1,,2 * * * *", "@often",
+                          "* * * *", "* * * * * *" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        cron_job_t job = {0};
+        str_t expr = { .data = bad[i], .len = (uint32_t)strlen(bad[i]) };
+        TEST_ASSERT(cron_parse_expression(&expr, &job) == ERR_INVALID_ARGUMENT, bad[i]);
+    }
+
+    // Sparse schedules jump field by field rather than scanning minutes
+    cron_job_t job = {0};
+    str_t sparse = STR_LIT("59 23 29 2 *");
+    TEST_ASSERT(cron_parse_expression(&sparse, &job) == ERR_OK, "Parse failed");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT(cron_compute_next_run(&job, monday) == ERR_OK, "No leap day");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    TEST_ASSERT(job.next_run == local_ms(2028, 2, 29, 23, 59), "Wrong leap day");
+    double ms = (double)(end.tv_sec - start.tv_sec) * 1e3 + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+    TEST_ASSERT(ms < 1000.0, "Next-run search too slow");
+    return true;
+}
+
+// Two jobs that each wait for the other: they only finish side by side
+static pthread_mutex_t g_cron_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cron_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t g_cron_started;
+static uint32_t g_cron_finished;
+
+static void rendezvous_job(const char* args, void* user_data) {
+    (void)args;
+    (void)user_data;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 5;
+
+    pthread_mutex_lock(&g_cron_lock);
+    g_cron_started++;
+    pthread_cond_broadcast(&g_cron_cond);
+    while (g_cron_started < 2) {
+        if (pthread_cond_timedwait(&g_cron_cond, &g_cron_lock, &deadline) != 0) break;
+    }
+    if (g_cron_started >= 2) g_cron_finished++;
+    pthread_mutex_unlock(&g_cron_lock);
+}
+
+static bool test_cron_scheduler(void) {
+    cron_job_t job = {0};
+    str_t daily = STR_LIT("30 9 * * *");
+    TEST_ASSERT(cron_parse_expression(&daily, &job) == ERR_OK, "Parse failed");
+    TEST_ASSERT(cron_compute_next_run(&job, local_ms(2026, 1, 5, 10, 0)) == ERR_OK, "No next run");
+    TEST_ASSERT(job.next_run == local_ms(2026, 1, 6, 9, 30), "Daily job not moved to the next day");
+    TEST_ASSERT(cron_compute_next_run(&job, local_ms(2026, 1, 6, 9, 29)) == ERR_OK, "No next run");
+    TEST_ASSERT(job.next_run == local_ms(2026, 1, 6, 9, 30), "Same-day run missed");
+
+    str_t leap = STR_LIT("0 0 29 2 *");
+    TEST_ASSERT(cron_parse_expression(&leap, &job) == ERR_OK, "Parse failed");
+    TEST_ASSERT(cron_compute_next_run(&job, local_ms(2026, 3, 1, 0, 0)) == ERR_OK, "No leap day found");
+    TEST_ASSERT(job.next_run == local_ms(2028, 2, 29, 0, 0), "Wrong leap day");
+
+    daemon_t* daemon = NULL;
+    TEST_ASSERT(daemon_create(NULL, &daemon) == ERR_OK, "Daemon create failed");
+    TEST_ASSERT(daemon_cron_next_deadline(daemon) == 0, "Empty schedule has a deadline");
+
+    cron_job_t impossible = { .id = STR_LIT("never"), .expression = STR_LIT("0 0 31 2 *"), .enabled = true };
+    TEST_ASSERT(daemon_cron_add(daemon, &impossible) == ERR_INVALID_ARGUMENT, "Impossible job accepted");
+
+    // The schedule's root is always the earliest job
+    cron_job_t noon = { .id = STR_LIT("noon"), .expression = STR_LIT("0 12 * * *"), .enabled = true };
+    cron_job_t every = { .id = STR_LIT("every"), .expression = STR_LIT("* * * * *"), .enabled = true,
+                         .callback = rendezvous_job };
+    cron_job_t yearly = { .id = STR_LIT("yearly"), .expression = STR_LIT("0 0 1 1 *"), .enabled = true,
+                          .callback = rendezvous_job };
+    TEST_ASSERT(daemon_cron_add(daemon, &noon) == ERR_OK, "Add failed");
+    TEST_ASSERT(daemon_cron_add(daemon, &yearly) == ERR_OK, "Add failed");
+    TEST_ASSERT(daemon_cron_add(daemon, &every) == ERR_OK, "Add failed");
+
+    uint64_t now = (uint64_t)time(NULL) * 1000;
+    uint64_t first = daemon_cron_next_deadline(daemon);
+    TEST_ASSERT(first > now - 1000 && first <= now + 60000, "Minutely job not first");
+    TEST_ASSERT(first == daemon->jobs[2]->next_run, "Deadline is not the minutely job");
+
+    str_t every_id = STR_LIT("every");
+    TEST_ASSERT(daemon_cron_enable(daemon, &every_id, false) == ERR_OK, "Disable failed");
+    TEST_ASSERT(daemon_cron_next_deadline(daemon) == daemon->jobs[0]->next_run, "Noon job not next");
+    TEST_ASSERT(daemon_cron_enable(daemon, &every_id, true) == ERR_OK, "Enable failed");
+    TEST_ASSERT(daemon_cron_next_deadline(daemon) <= now + 60000, "Re-enabled job not scheduled");
+
+    str_t noon_id = STR_LIT("noon");
+    TEST_ASSERT(daemon_cron_remove(daemon, &noon_id) == ERR_OK, "Remove failed");
+    TEST_ASSERT(daemon->job_count == 2 && daemon->schedule_count == 2, "Removed job still scheduled");
+
+    // A blocked job body does not hold up the next one
+    str_t yearly_id = STR_LIT("yearly");
+    g_cron_started = 0;
+    g_cron_finished = 0;
+    TEST_ASSERT(daemon_cron_trigger(daemon, &every_id) == ERR_OK, "Trigger failed");
+    TEST_ASSERT(daemon_cron_trigger(daemon, &yearly_id) == ERR_OK, "Trigger failed");
+
+    // Destroy waits for both bodies
+    daemon_destroy(daemon);
+    TEST_ASSERT(g_cron_finished == 2, "Job bodies did not run in parallel");
+    return true;
+}
+
+static const metric_desc_t g_test_counter = {
+    .name = "cclaw_test_events_total", .help = "Test events", .kind = METRIC_COUNTER, .labels = { "kind" }
+};
+static const double g_test_bounds[] = { 0.001, 0.01 };
+static const metric_desc_t g_test_histogram = {
+    .name = "cclaw_test_duration_seconds", .help = "Test durations", .kind = METRIC_HISTOGRAM,
+    .labels = { "name" }, .scale = 1e-6, .bounds = g_test_bounds, .bound_count = 2
+};
+
+static void* count_events(void* arg) {
+    metric_t* events = (metric_t*)arg;
+    for (int i = 0; i < 10000; i++) metric_inc(events, 1);
+    return NULL;
+}
+
+static bool test_metrics(void) {
+    metric_t* events = metric_get(&g_test_counter, STR_LIT("a\"b"), STR_NULL);
+    TEST_ASSERT(events, "Series not registered");
+    TEST_ASSERT(metric_get(&g_test_counter, STR_LIT("a\"b"), STR_LIT("ignored")) == events, "Lookup not stable");
+
+    // Stripes from several threads add up
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, count_events, events);
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    TEST_ASSERT(metric_value(events) == 40000, "Counter lost increments");
+
+    metric_t* hist = metric_get(&g_test_histogram, STR_LIT("op"), STR_NULL);
+    for (uint64_t v = 1; v <= 10000; v++) metric_observe(hist, v);
+    TEST_ASSERT(metric_count(hist) == 10000, "Histogram count wrong");
+    uint64_t p50 = metric_quantile(hist, 0.5);
+    uint64_t p99 = metric_quantile(hist, 0.99);
+    TEST_ASSERT(p50 > 4800 && p50 < 5200, "p50 off");
+    TEST_ASSERT(p99 > 9600 && p99 < 10200, "p99 off");
+
+    str_t text = STR_NULL;
+    TEST_ASSERT(metrics_export_prometheus(&text) == ERR_OK, "Export failed");
+    TEST_ASSERT(strstr(text.data, "# TYPE cclaw_test_events_total counter\n"), "Counter family missing");
+    TEST_ASSERT(strstr(text.data, "cclaw_test_events_total{kind=\"a\\\"b\"} 40000\n"), "Label not escaped");
+    TEST_ASSERT(strstr(text.data, "cclaw_test_duration_seconds_bucket{name=\"op\",le=\"0.001\"} 1000\n"),
+                "le bucket wrong");
+    TEST_ASSERT(strstr(text.data, "cclaw_test_duration_seconds_bucket{name=\"op\",le=\"+Inf\"} 10000\n"),
+                "+Inf bucket wrong");
+    TEST_ASSERT(strstr(text.data, "cclaw_test_duration_seconds_count{name=\"op\"} 10000\n"), "Count missing");
+    free((void*)text.data);
+    return true;
+}
+
+// Send one request on the health socket and read the reply until close
+static char* health_request(const char* socket_path, const char* request) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return NULL;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if (write(fd, request, strlen(request)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t cap = 65536, len = 0;
+    char* reply = malloc(cap);
+    ssize_t n;
+    while (reply && len < cap - 1 && (n = read(fd, reply + len, cap - 1 - len)) > 0) len += (size_t)n;
+    if (reply) reply[len] = '\0';
+    close(fd);
+    return reply;
+}
+
+static bool test_health_server(void) {
+    char socket_path[64];
+    snprintf(socket_path, sizeof(socket_path), "/tmp/cclaw-test-health-%d.sock", (int)getpid());
+
+    daemon_config_t config = daemon_config_default();
+    config.health_socket = STR_VIEW(socket_path);
+    daemon_t* daemon = NULL;
+    TEST_ASSERT(daemon_create(&config, &daemon) == ERR_OK, "Daemon create failed");
+    TEST_ASSERT(daemon_health_init(daemon) == ERR_OK, "Health init failed");
+    TEST_ASSERT(daemon_health_server_start(daemon) == ERR_OK, "Health server failed");
+
+    char* reply = health_request(socket_path, "GET /metrics HTTP/1.0\r\n\r\n");
+    TEST_ASSERT(reply && strncmp(reply, "HTTP/1.0 200 OK", 15) == 0, "No metrics reply");
+    TEST_ASSERT(strstr(reply, "text/plain; version=0.0.4"), "Wrong metrics content type");
+    TEST_ASSERT(strstr(reply, "cclaw_sizeclass_magazines"), "Metrics body missing");
+    free(reply);
+
+    reply = health_request(socket_path, "GET /health HTTP/1.0\r\n\r\n");
+    TEST_ASSERT(reply && strstr(reply, "\"healthy\":"), "No health reply");
+    free(reply);
+
+    reply = health_request(socket_path, "GET /nope HTTP/1.0\r\n\r\n");
+    TEST_ASSERT(reply && strncmp(reply, "HTTP/1.0 404", 12) == 0, "Unknown path served");
+    free(reply);
+
+    daemon_health_server_stop(daemon);
+    daemon_health_shutdown(daemon);
+    TEST_ASSERT(access(socket_path, F_OK) != 0, "Socket file left behind");
+    daemon_destroy(daemon);
+    return true;
+}
+
+static void* trace_child_thread(void* arg) {
+    trace_context_t saved;
+    trace_context_enter((const trace_context_t*)arg, &saved);
+    TRACE_BEGIN(span, "test.worker");
+    TRACE_END(span);
+    trace_context_leave(&saved);
+    return NULL;
+}
+
+static bool test_tracing(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cclaw-test-trace-%d.json", (int)getpid());
+    unlink(path);
+
+    // Nothing is recorded outside a trace
+    TRACE_BEGIN(orphan, "test.orphan");
+    TEST_ASSERT(orphan.span_id == 0, "Span recorded without a trace");
+    TRACE_END(orphan);
+
+    trace_config_t config = { .sample_every = 1, .chrome_path = path, .flush_interval_ms = 60000 };
+    TEST_ASSERT(trace_init(&config) == ERR_OK, "Trace init failed");
+
+    TRACE_ROOT(root, "test.root");
+    TEST_ASSERT(root.span_id != 0, "Root not sampled");
+    TRACE_BEGIN(child, "test.child");
+    TRACE_DETAIL(child, STR_LIT("detail-text"));
+    TEST_ASSERT(child.parent_id == root.span_id, "Child has wrong parent");
+    TRACE_END(child);
+
+    trace_context_t context = trace_context_current();
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, NULL, trace_child_thread, &context) == 0, "Thread failed");
+    pthread_join(thread, NULL);
+    TRACE_END(root);
+    TEST_ASSERT(trace_context_current().span_id == 0, "Context not restored");
+
+    trace_flush();
+    trace_shutdown();
+
+    char* text = NULL;
+    FILE* f = fopen(path, "r");
+    TEST_ASSERT(f, "Trace file missing");
+    text = calloc(1, 65536);
+    size_t len = fread(text, 1, 65535, f);
+    fclose(f);
+    unlink(path);
+    text[len] = '\0';
+
+    char trace_id[48];
+    snprintf(trace_id, sizeof(trace_id), "\"trace_id\":\"%016llx%016llx\"",
+             (unsigned long long)context.trace_hi, (unsigned long long)context.trace_lo);
+    bool ok = text[0] == '[' && strstr(text, "\"test.root\"") && strstr(text, "\"test.child\"") &&
+              strstr(text, "\"test.worker\"") && strstr(text, "detail-text") && !strstr(text, "test.orphan");
+    size_t shared = 0;
+    for (const char* p = text; (p = strstr(p, trace_id)); p++) shared++;
+    free(text);
+    TEST_ASSERT(ok, "Trace file missing spans");
+    TEST_ASSERT(shared == 3, "Spans do not share a trace id");
+    return true;
+}
+
+static bool write_extension_source(const char* path, const char* text) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fputs(text, f);
+    return fclose(f) == 0;
+}
+
+static bool test_extension_watch(void) {
+    char dir[] = "/tmp/cclaw_ext_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir), "mkdtemp failed");
+    char path[600];
+    snprintf(path, sizeof(path), "%s/hello.c", dir);
+    TEST_ASSERT(write_extension_source(path, "// v1\n"), "Write failed");
+
+    TEST_ASSERT(extension_registry_init() == ERR_OK, "Registry init failed");
+    extension_t* ext = NULL;
+    str_t source = STR_VIEW(path);
+    TEST_ASSERT(extension_load(&source, &ext) == ERR_OK, "Load failed");
+    uint64_t loaded_mtime = ext->last_modified;
+
+    str_t watch_dir = STR_VIEW(dir);
+    TEST_ASSERT(extension_watch_start(&watch_dir) == ERR_OK, "Watch start failed");
+    int fd = extension_watch_fd();
+#if defined(__linux__) && !defined(__ANDROID__)
+    TEST_ASSERT(fd >= 0, "No inotify descriptor");
+    TEST_ASSERT(extension_watch_timeout_ms() == -1, "Idle watcher has a timeout");
+#endif
+
+    // Nothing changed: no reload
+    TEST_ASSERT(extension_watch_poll() == ERR_OK, "Poll failed");
+    TEST_ASSERT(ext->last_modified == loaded_mtime, "Reloaded without a change");
+
+    usleep(20 * 1000);
+    TEST_ASSERT(write_extension_source(path, "// v2\n"), "Rewrite failed");
+    if (fd >= 0) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        TEST_ASSERT(poll(&pfd, 1, 1000) == 1, "No change event");
+
+        // The reload waits out the debounce window
+        TEST_ASSERT(extension_watch_poll() == ERR_OK, "Poll failed");
+        int wait_ms = extension_watch_timeout_ms();
+        TEST_ASSERT(wait_ms >= 0 && wait_ms <= EXTENSION_WATCH_DEBOUNCE_MS, "Debounce not pending");
+    }
+
+    uint64_t deadline = (uint64_t)time(NULL) + 5;
+    while (ext->last_modified == loaded_mtime && (uint64_t)time(NULL) < deadline) {
+        int wait_ms = extension_watch_timeout_ms();
+        usleep((useconds_t)(wait_ms > 0 ? wait_ms : 1) * 1000);
+        extension_watch_poll();
+    }
+    TEST_ASSERT(ext->last_modified != loaded_mtime, "Change not reloaded");
+
+    extension_watch_stop();
+    TEST_ASSERT(extension_watch_fd() == -1, "Descriptor left open");
+    extension_registry_shutdown();
+
+    unlink(path);
+    rmdir(dir);
+    return true;
+}
+
+// A tool library built the way a third-party one would be
+static const char* NATIVE_EXTENSION_SOURCE =
+    "#include \"core/extension.h\"\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "static str_t echo_name(void) { return STR_LIT(\"native_echo\"); }\n"
+    "static err_t echo_create(tool_t** out) { *out = calloc(1, sizeof(tool_t)); return *out ? ERR_OK : ERR_OUT_OF_MEMORY; }\n"
+    "static void echo_destroy(tool_t* tool) { free(tool); }\n"
+    "static err_t echo_execute(tool_t* tool, const str_t* args, tool_result_t* out) {\n"
+    "    out->content = (str_t){ .data = strdup(ECHO_OUTPUT), .len = sizeof(ECHO_OUTPUT) - 1 };\n"
+    "    out->success = true;\n"
+    "    return ERR_OK;\n"
+    "}\n"
+    "static const tool_vtable_t echo = { .get_name = echo_name, .create = echo_create,\n"
+    "                                    .destroy = echo_destroy, .execute = echo_execute };\n"
+    "static const tool_vtable_t* const tools[] = { &echo };\n"
+    "static const extension_native_table_t table = { EXTENSION_ABI_VERSION, 1, tools };\n"
+    "const extension_native_table_t* cclaw_extension_v1(void) { return &table; }\n";
+
+static bool build_native_extension(const char* dir, const char* output) {
+    char source[600], command[2048];
+    snprintf(source, sizeof(source), "%s/echo.c", dir);
+    if (!write_extension_source(source, NATIVE_EXTENSION_SOURCE)) return false;
+
+    // Built next to the library and renamed over it, as an installer would
+    snprintf(command, sizeof(command),
+             "cc -shared -fPIC -Iinclude '-DECHO_OUTPUT=\"%s\"' -o %s/echo.tmp %s 2>/dev/null && mv %s/echo.tmp %s/echo.so",
+             output, dir, source, dir, dir);
+    return system(command) == 0;
+}
+
+static bool test_native_extension(void) {
+    char dir[] = "/tmp/cclaw_native_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir), "mkdtemp failed");
+    char path[600], manifest[600], source[600];
+    snprintf(path, sizeof(path), "%s/echo.so", dir);
+    snprintf(manifest, sizeof(manifest), "%s/echo.json", dir);
+    snprintf(source, sizeof(source), "%s/echo.c", dir);
+
+    if (!build_native_extension(dir, "v1")) {
+        printf("(no compiler, skipped) ");
+        unlink(source);
+        rmdir(dir);
+        return true;
+    }
+    TEST_ASSERT(write_extension_source(manifest,
+        "{\"name\": \"echo\", \"version\": \"1.0.0\", \"type\": \"tool\",\n"
+        " \"tools\": [{\"name\": \"native_echo\", \"description\": \"Echo\",\n"
+        "             \"parameters\": {\"type\": \"object\"}}]}\n"), "Manifest write failed");
+
+    TEST_ASSERT(extension_registry_init() == ERR_OK, "Registry init failed");
+    extension_t* ext = NULL;
+    str_t lib = STR_VIEW(path);
+    TEST_ASSERT(extension_is_native_path(&lib), "Not seen as native");
+    TEST_ASSERT(extension_load(&lib, &ext) == ERR_OK, "Load failed");
+
+    // Registered from the manifest; the library is opened on first use
+    TEST_ASSERT(ext->dl_handle == NULL, "Library opened at load");
+    TEST_ASSERT(str_equal_cstr(ext->manifest.version, "1.0.0"), "Manifest not read");
+    tool_t* tool = NULL;
+    TEST_ASSERT(tool_create("native_echo", &tool) == ERR_OK, "Tool not registered");
+    TEST_ASSERT(str_equal_cstr(tool->vtable->get_description(), "Echo"), "Wrong description");
+    TEST_ASSERT(ext->dl_handle == NULL, "Library opened for metadata");
+
+    str_t args = STR_LIT("{}");
+    tool_result_t result = tool_result_create();
+    TEST_ASSERT(tool_execute(tool, &args, &result) == ERR_OK, "Execute failed");
+    TEST_ASSERT(ext->dl_handle != NULL, "Library not bound");
+    TEST_ASSERT(result.success && str_equal_cstr(result.content, "v1"), "Wrong output");
+    tool_result_free(&result);
+
+    // A rebuilt library takes over the existing instance
+    TEST_ASSERT(build_native_extension(dir, "v2"), "Rebuild failed");
+    TEST_ASSERT(extension_reload(ext) == ERR_OK, "Reload failed");
+    result = tool_result_create();
+    TEST_ASSERT(tool_execute(tool, &args, &result) == ERR_OK, "Execute after reload failed");
+    TEST_ASSERT(str_equal_cstr(result.content, "v2"), "Old build still running");
+    tool_result_free(&result);
+    tool_free(tool);
+
+    TEST_ASSERT(extension_unload(ext) == ERR_OK, "Unload failed");
+    TEST_ASSERT(tool_create("native_echo", &tool) == ERR_NOT_FOUND, "Tool left registered");
+    extension_registry_shutdown();
+
+    unlink(path);
+    unlink(manifest);
+    unlink(source);
+    rmdir(dir);
+    return true;
+}
+
+// Bytes the screen wrote for one frame, NUL-terminated
+static size_t read_frame(int fd, char* buffer, size_t size) {
+    size_t len = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (len + 1 < size && poll(&pfd, 1, 0) == 1) {
+        ssize_t n = read(fd, buffer + len, size - 1 - len);
+        if (n <= 0) break;
+        len += (size_t)n;
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+static bool test_tui_screen(void) {
+    int fds[2];
+    TEST_ASSERT(pipe(fds) == 0, "pipe failed");
+    tui_screen_t* screen = NULL;
+    TEST_ASSERT(tui_screen_create(20, 4, fds[1], &screen) == ERR_OK, "Create failed");
+    char out[4096];
+
+    // First frame clears and paints what isn't blank
+    tui_screen_move(screen, 2, 0);
+    tui_screen_set_style(screen, 3, TUI_COLOR_DEFAULT, TUI_ATTR_BOLD);
+    tui_screen_puts(screen, "hello");
+    tui_screen_reset_style(screen);
+    tui_screen_move(screen, 0, 2);
+    tui_screen_puts(screen, "status");
+    TEST_ASSERT(tui_screen_flush(screen) == ERR_OK, "Flush failed");
+    read_frame(fds[0], out, sizeof(out));
+    TEST_ASSERT(strstr(out, "\033[2J") && strstr(out, "\033[0;1;38;5;3mhello") && strstr(out, "status"),
+                "First frame incomplete");
+
+    // Same frame again: nothing to write
+    tui_screen_stats_t stats;
+    tui_screen_get_stats(screen, &stats);
+    uint64_t rows_before = stats.rows_painted;
+    TEST_ASSERT(tui_screen_flush(screen) == ERR_OK, "Flush failed");
+    TEST_ASSERT(read_frame(fds[0], out, sizeof(out)) == 0, "Unchanged frame written");
+
+    // A streamed delta repaints only its row, from the first changed cell
+    tui_screen_move(screen, 0, 2);
+    tui_screen_puts(screen, "status: ok");
+    TEST_ASSERT(tui_screen_flush(screen) == ERR_OK, "Flush failed");
+    read_frame(fds[0], out, sizeof(out));
+    TEST_ASSERT(strcmp(out, "\033[3;7H: ok") == 0, "Changed span not isolated");
+    tui_screen_get_stats(screen, &stats);
+    TEST_ASSERT(stats.rows_painted == rows_before + 1, "Other rows repainted");
+
+    // Wide glyphs take two cells and are never split
+    tui_screen_move(screen, 0, 3);
+    tui_screen_puts(screen, "\xe4\xbd\xa0\xe5\xa5\xbd");    // 你好
+    const tui_cell_t* half = tui_screen_cell(screen, 1, 3);
+    TEST_ASSERT(half && half->len == 0, "Wide glyph not doubled");
+    tui_screen_move(screen, 1, 3);
+    tui_screen_puts(screen, "x");
+    TEST_ASSERT(tui_screen_cell(screen, 0, 3)->glyph[0] == ' ', "Split glyph left behind");
+
+    // Frames are capped
+    tui_screen_set_frame_interval(screen, 1000);
+    TEST_ASSERT(!tui_screen_frame_due(screen), "Frame due inside the cap");
+    TEST_ASSERT(tui_screen_frame_wait_ms(screen) > 0, "No wait inside the cap");
+
+    tui_screen_free(screen);
+    close(fds[0]);
+    close(fds[1]);
+    return true;
+}
+
+static bool test_tui_scrollback(void) {
+    tui_scrollback_t sb;
+    TEST_ASSERT(tui_scrollback_init(&sb, 0) == ERR_OK, "Init failed");
+    tui_scrollback_set_width(&sb, 27);    // 20 columns after "[You]: "
+
+    // Words wrap to the width left after the label; '\n' always breaks
+    TEST_ASSERT(tui_scrollback_push(&sb, "user", "the quick brown fox jumps over\nthe dog") == ERR_OK,
+                "Push failed");
+    tui_message_t* msg = tui_scrollback_last(&sb);
+    TEST_ASSERT(msg->line_count == 3, "Wrong wrap");
+    tui_scrollback_line_t lines[8];
+    TEST_ASSERT(tui_scrollback_window(&sb, 8, lines) == 3, "Wrong window");
+    TEST_ASSERT(lines[0].len == 19 && strncmp(lines[0].text, "the quick brown fox", 19) == 0, "Line 1 wrong");
+    TEST_ASSERT(lines[1].len == 10 && strncmp(lines[1].text, "jumps over", 10) == 0, "Line 2 wrong");
+
+    // A long session: the window is the newest lines, paging moves a page
+    char text[32];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(text, sizeof(text), "message %d", i);
+        TEST_ASSERT(tui_scrollback_push(&sb, "assistant", text) == ERR_OK, "Push failed");
+    }
+    TEST_ASSERT(tui_scrollback_line_count(&sb) == 5003, "Wrong line count");
+    TEST_ASSERT(tui_scrollback_window(&sb, 8, lines) == 8, "Window not full");
+    TEST_ASSERT(strncmp(lines[7].text, "message 4999", lines[7].len) == 0, "Bottom not newest");
+    tui_scrollback_scroll_up(&sb, 8);
+    tui_scrollback_window(&sb, 8, lines);
+    TEST_ASSERT(strncmp(lines[7].text, "message 4991", lines[7].len) == 0, "Page up wrong");
+
+    // Scrolled up, new lines and streamed text don't move the view
+    TEST_ASSERT(tui_scrollback_push(&sb, "assistant", "") == ERR_OK, "Push failed");
+    TEST_ASSERT(tui_scrollback_append(&sb, "streamed reply that wraps", 25) == ERR_OK, "Append failed");
+    TEST_ASSERT(tui_scrollback_last(&sb)->line_count == 2, "Append not rewrapped");
+    tui_scrollback_window(&sb, 8, lines);
+    TEST_ASSERT(strncmp(lines[7].text, "message 4991", lines[7].len) == 0, "View moved");
+    tui_scrollback_scroll_down(&sb, UINT32_MAX);
+    tui_scrollback_window(&sb, 8, lines);
+    TEST_ASSERT(lines[7].message == tui_scrollback_last(&sb) && lines[7].line == 1, "Not back at bottom");
+
+    // The top of the history stops the view
+    tui_scrollback_scroll_up(&sb, UINT32_MAX);
+    tui_scrollback_window(&sb, 8, lines);
+    TEST_ASSERT(lines[0].message == tui_scrollback_at(&sb, 0) && lines[0].line == 0, "Not at top");
+
+    // A resize rewraps everything
+    tui_scrollback_set_width(&sb, 80);
+    TEST_ASSERT(tui_scrollback_at(&sb, 0)->line_count == 2, "Not rewrapped");
+    TEST_ASSERT(tui_scrollback_line_count(&sb) == 5003, "Wrong count after resize");
+
+    tui_scrollback_free(&sb);
+
+    // Past the cap the oldest go
+    TEST_ASSERT(tui_scrollback_init(&sb, 4) == ERR_OK, "Init failed");
+    for (int i = 0; i < 6; i++) {
+        snprintf(text, sizeof(text), "m%d", i);
+        tui_scrollback_push(&sb, "system", text);
+    }
+    TEST_ASSERT(sb.count == 4 && strcmp(tui_scrollback_at(&sb, 0)->text, "m2") == 0, "Oldest kept");
+    TEST_ASSERT(tui_scrollback_line_count(&sb) == 4, "Dropped lines counted");
+    tui_scrollback_free(&sb);
+    return true;
+}
+
 int main(void) {
     printf("CClaw Test Suite\n");
     printf("Version: %s\n", CCLAW_VERSION_STRING);
@@ -117,6 +3628,54 @@ int main(void) {
     TEST_RUN("string_utils", test_string_utils);
     TEST_RUN("error_codes", test_error_codes);
     TEST_RUN("init_shutdown", test_init_shutdown);
+    TEST_RUN("config_snapshot", test_config_snapshot);
+    TEST_RUN("arena", test_arena);
+    TEST_RUN("sizeclass_allocator", test_sizeclass_allocator);
+    TEST_RUN("json_dom", test_json_dom);
+    TEST_RUN("json_writer", test_json_writer);
+    TEST_RUN("json_parse_insitu", test_json_parse_insitu);
+    TEST_RUN("json_writer_gzip", test_json_writer_gzip);
+    TEST_RUN("text_scan", test_text_scan);
+    TEST_RUN("http_pool", test_http_pool);
+    TEST_RUN("http_async", test_http_async);
+    TEST_RUN("sse_parser", test_sse_parser);
+    TEST_RUN("session_context", test_session_context);
+    TEST_RUN("session_tree", test_session_tree);
+    TEST_RUN("session_log", test_session_log);
+    TEST_RUN("context_window", test_context_window);
+    TEST_RUN("background_summary", test_background_summary);
+    TEST_RUN("tool_pool", test_tool_pool);
+    TEST_RUN("tool_calling", test_tool_calling);
+    TEST_RUN("tool_speculation", test_tool_speculation);
+    TEST_RUN("memory_prefetch", test_memory_prefetch);
+    TEST_RUN("tool_dialects", test_tool_dialects);
+    TEST_RUN("session_map", test_session_map);
+    TEST_RUN("streaming_reply", test_streaming_reply);
+    TEST_RUN("provider_router", test_provider_router);
+    TEST_RUN("hedged_requests", test_hedged_requests);
+    TEST_RUN("rate_limits", test_rate_limits);
+    TEST_RUN("provider_prewarm", test_provider_prewarm);
+    TEST_RUN("http_compression", test_http_compression);
+    TEST_RUN("response_cache", test_response_cache);
+    TEST_RUN("singleflight", test_singleflight);
+    TEST_RUN("provider_batch", test_provider_batch);
+    TEST_RUN("http_replay", test_http_replay);
+    TEST_RUN("loadgen", test_loadgen);
+    TEST_RUN("alloc_tags", test_alloc_tags);
+    TEST_RUN("cron_expressions", test_cron_expressions);
+    TEST_RUN("cron_scheduler", test_cron_scheduler);
+    TEST_RUN("metrics", test_metrics);
+    TEST_RUN("health_server", test_health_server);
+    TEST_RUN("tracing", test_tracing);
+    TEST_RUN("usage_parsing", test_usage_parsing);
+    TEST_RUN("shell_runner", test_shell_runner);
+    TEST_RUN("docker_pool", test_docker_pool);
+    TEST_RUN("file_read_ranges", test_file_read_ranges);
+    TEST_RUN("file_write_batch", test_file_write_batch);
+    TEST_RUN("extension_watch", test_extension_watch);
+    TEST_RUN("native_extension", test_native_extension);
+    TEST_RUN("tui_screen", test_tui_screen);
+    TEST_RUN("tui_scrollback", test_tui_scrollback);
 
     // Summary
     printf("\n");
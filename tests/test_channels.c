@@ -10,6 +10,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
 
 // Test utilities (copied from basic.c)
 #define TEST_ASSERT(cond, msg) \
@@ -174,6 +179,82 @@ static bool test_webhook_listening(void) {
     return true;
 }
 
+// Stands in for a blocking HTTP send; "bad" recipients fail
+static pthread_mutex_t g_sent_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_sent[8][64];
+static uint32_t g_sent_count = 0;
+
+static err_t slow_send(channel_t* channel, const str_t* message, const str_t* recipient) {
+    usleep(100 * 1000);
+    pthread_mutex_lock(&g_sent_lock);
+    if (g_sent_count < 8) {
+        snprintf(g_sent[g_sent_count++], sizeof(g_sent[0]), "%.*s:%.*s", (int)channel->config.name.len,
+                 channel->config.name.data, (int)message->len, message->data);
+    }
+    pthread_mutex_unlock(&g_sent_lock);
+    return recipient && str_equal_cstr(*recipient, "bad") ? ERR_NETWORK : ERR_OK;
+}
+
+static const channel_vtable_t g_slow_vtable = { .send = slow_send };
+
+static bool sent_contains(const char* text) {
+    for (uint32_t i = 0; i < g_sent_count; i++) {
+        if (strcmp(g_sent[i], text) == 0) return true;
+    }
+    return false;
+}
+
+// Broadcasts go out on every channel at once, quick messages merged
+static bool test_outbound_fanout(void) {
+    channel_manager_t* manager = channel_manager_create();
+    TEST_ASSERT(manager != NULL, "Failed to create channel manager");
+    const char* names[] = { "out-a", "out-b" };
+    for (int i = 0; i < 2; i++) {
+        channel_t* channel = channel_alloc(&g_slow_vtable);
+        channel->config.name = STR_VIEW(names[i]);
+        channel->initialized = true;
+        TEST_ASSERT(channel_manager_add_channel(manager, channel) == ERR_OK, "Failed to add channel");
+    }
+
+    g_sent_count = 0;
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    const char* lines[] = { "m1", "m2", "m3" };
+    for (int i = 0; i < 3; i++) {
+        str_t line = STR_VIEW(lines[i]);
+        TEST_ASSERT(channel_manager_send_to_all(manager, &line) == ERR_OK, "Broadcast not queued");
+    }
+    TEST_ASSERT(channel_manager_flush(manager, 2000) == ERR_OK, "Flush timed out");
+    gettimeofday(&end, NULL);
+    long elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000;
+    TEST_ASSERT(elapsed_ms < 180, "Channels sent one after another");
+    TEST_ASSERT(g_sent_count == 2 && sent_contains("out-a:m1\nm2\nm3") && sent_contains("out-b:m1\nm2\nm3"),
+                "Messages not merged per channel");
+
+    channel_delivery_stats_t stats;
+    str_t name = STR_LIT("out-a");
+    TEST_ASSERT(channel_manager_get_delivery_stats(manager, &name, &stats) == ERR_OK, "No stats");
+    TEST_ASSERT(stats.accepted == 3 && stats.sends == 1 && stats.delivered == 3 && stats.pending == 0,
+                "Wrong delivery stats");
+
+    // Another recipient is not merged into the run; its failure is counted
+    str_t bad = STR_LIT("bad");
+    str_t x = STR_LIT("x");
+    str_t y = STR_LIT("y");
+    TEST_ASSERT(channel_manager_send(manager, &name, &bad, &x) == ERR_OK, "Send not queued");
+    TEST_ASSERT(channel_manager_send_to_channel(manager, &name, &y) == ERR_OK, "Send not queued");
+    TEST_ASSERT(channel_manager_flush(manager, 2000) == ERR_OK, "Flush timed out");
+    channel_manager_get_delivery_stats(manager, &name, &stats);
+    TEST_ASSERT(stats.sends == 3 && stats.failed == 1 && stats.delivered == 4, "Failure not counted");
+    TEST_ASSERT(sent_contains("out-a:x") && sent_contains("out-a:y"), "Recipients merged");
+
+    str_t missing = STR_LIT("missing");
+    TEST_ASSERT(channel_manager_send_to_channel(manager, &missing, &y) == ERR_NOT_FOUND, "Unknown channel accepted");
+
+    channel_manager_destroy(manager);
+    return true;
+}
+
 // Test channel manager
 static bool test_channel_manager(void) {
     err_t err = channel_registry_init();
@@ -301,6 +382,434 @@ static bool test_health_check(void) {
     return true;
 }
 
+// Read from fd until `count` complete responses arrived or the peer closed
+static int read_responses(int fd, char* buf, size_t cap, int count) {
+    size_t len = 0;
+    while (len + 1 < cap) {
+        buf[len] = '\0';
+        int seen = 0;
+        for (const char* p = buf; (p = strstr(p, "HTTP/1.1 ")) != NULL; p++) seen++;
+        if (seen >= count && strstr(buf + len - (len > 32 ? 32 : len), "}")) return seen;
+
+        struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ssize_t n = recv(fd, buf + len, cap - len - 1, 0);
+        if (n <= 0) break;
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+    int seen = 0;
+    for (const char* p = buf; (p = strstr(p, "HTTP/1.1 ")) != NULL; p++) seen++;
+    return seen;
+}
+
+static int connect_local(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Keep-alive, pipelining, chunked bodies and large bodies over a real socket
+static bool test_webhook_http(void) {
+    err_t err = channel_registry_init();
+    TEST_ASSERT(err == ERR_OK, "Failed to initialize channel registry");
+
+    channel_config_t config = channel_config_default();
+    config.name = str_dup_cstr("test-http", NULL);
+    config.type = str_dup_cstr("webhook", NULL);
+    config.port = 9996;
+    config.host = str_dup_cstr("127.0.0.1", NULL);
+
+    channel_t* channel = NULL;
+    TEST_ASSERT(channel_create("webhook", &config, &channel) == ERR_OK, "Failed to create webhook channel");
+    TEST_ASSERT(channel->vtable->init(channel) == ERR_OK, "Failed to initialize webhook channel");
+    cleanup_test_message();
+    TEST_ASSERT(channel->vtable->start_listening(channel, test_message_callback, NULL) == ERR_OK,
+                "Failed to start listening");
+
+    int fd = connect_local(9996);
+    TEST_ASSERT(fd >= 0, "Connect failed");
+
+    // Two pipelined requests in one write: Content-Length, then chunked
+    const char* pipelined =
+        "POST /webhook HTTP/1.1\r\nHost: x\r\nContent-Length: 14\r\n\r\n{\"text\":\"one\"}"
+        "POST /webhook HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5\r\n{\"tex\r\n9\r\nt\":\"two\"}\r\n0\r\n\r\n";
+    TEST_ASSERT(send(fd, pipelined, strlen(pipelined), 0) == (ssize_t)strlen(pipelined), "Send failed");
+
+    char response[4096];
+    TEST_ASSERT(read_responses(fd, response, sizeof(response), 2) == 2, "Expected two responses");
+    TEST_ASSERT(strstr(response, "200 OK") && strstr(response, "keep-alive"), "Keep-alive response missing");
+    TEST_ASSERT(g_message_received && strcmp(g_last_received_message.content.data, "two") == 0,
+                "Chunked body not decoded");
+
+    // A body far larger than any fixed buffer, sent in pieces on the same connection
+    size_t text_len = 200000;
+    char* big = malloc(text_len + 64);
+    int head = snprintf(big, 64, "{\"text\":\"");
+    memset(big + head, 'x', text_len);
+    size_t body_len = (size_t)head + text_len;
+    memcpy(big + body_len, "\"}", 2);
+    body_len += 2;
+    char header[128];
+    int header_len = snprintf(header, sizeof(header),
+                              "POST / HTTP/1.1\r\nContent-Length: %zu\r\n\r\n", body_len);
+    send(fd, header, (size_t)header_len, 0);
+    for (size_t off = 0; off < body_len; off += 7000) {
+        size_t n = body_len - off < 7000 ? body_len - off : 7000;
+        send(fd, big + off, n, 0);
+    }
+    free(big);
+    TEST_ASSERT(read_responses(fd, response, sizeof(response), 1) == 1, "Large body not answered");
+    TEST_ASSERT(strstr(response, "200 OK"), "Large body rejected");
+    TEST_ASSERT(g_last_received_message.content.len == text_len, "Large body truncated");
+
+    // Connection: close is honoured
+    const char* closing = "GET /nope HTTP/1.1\r\nConnection: close\r\n\r\n";
+    send(fd, closing, strlen(closing), 0);
+    TEST_ASSERT(read_responses(fd, response, sizeof(response), 1) == 1, "No 404 response");
+    TEST_ASSERT(strstr(response, "404") && strstr(response, "Connection: close"), "Close not honoured");
+    char extra;
+    TEST_ASSERT(recv(fd, &extra, 1, 0) == 0, "Connection left open");
+    close(fd);
+
+    // Framing other parsers could read differently is refused
+    const char* ambiguous[] = {
+        "POST / HTTP/1.1\r\nContent-Length: 14\r\nContent-Length: 14\r\n\r\n{\"text\":\"dup\"}",
+        "POST / HTTP/1.1\r\nContent-Length: +14\r\n\r\n{\"text\":\"dup\"}",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0x5\r\n{\"a\":\r\n0\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n 5\r\n{\"a\":\r\n0\r\n\r\n",
+    };
+    for (size_t i = 0; i < sizeof(ambiguous) / sizeof(ambiguous[0]); i++) {
+        fd = connect_local(9996);
+        TEST_ASSERT(fd >= 0, "Connect failed");
+        send(fd, ambiguous[i], strlen(ambiguous[i]), 0);
+        TEST_ASSERT(read_responses(fd, response, sizeof(response), 1) == 1 && strstr(response, "400"),
+                    "Ambiguous framing accepted");
+        close(fd);
+    }
+
+    uint32_t received = 0;
+    channel->vtable->get_stats(channel, NULL, &received, NULL);
+    TEST_ASSERT(received == 3, "Received counter wrong");
+
+    TEST_ASSERT(channel->vtable->stop_listening(channel) == ERR_OK, "Failed to stop listening");
+    channel->vtable->destroy(channel);
+    cleanup_test_message();
+    channel_registry_shutdown();
+    return true;
+}
+
+// Several loops share one port; counters survive stop and are summed
+static bool test_webhook_reactors(void) {
+    err_t err = channel_registry_init();
+    TEST_ASSERT(err == ERR_OK, "Failed to initialize channel registry");
+
+    channel_config_t config = channel_config_default();
+    config.name = str_dup_cstr("test-reactors", NULL);
+    config.type = str_dup_cstr("webhook", NULL);
+    config.port = 9995;
+    config.host = str_dup_cstr("127.0.0.1", NULL);
+    config.listener_threads = 4;
+
+    channel_t* channel = NULL;
+    TEST_ASSERT(channel_create("webhook", &config, &channel) == ERR_OK, "Failed to create webhook channel");
+    TEST_ASSERT(channel->vtable->init(channel) == ERR_OK, "Failed to initialize webhook channel");
+    cleanup_test_message();
+    TEST_ASSERT(channel->vtable->start_listening(channel, test_message_callback, NULL) == ERR_OK,
+                "Failed to start listening");
+
+    // One request per connection so each can land on any loop
+    const char* request =
+        "POST /webhook HTTP/1.1\r\nConnection: close\r\nContent-Length: 14\r\n\r\n{\"text\":\"one\"}";
+    char response[1024];
+    for (int i = 0; i < 16; i++) {
+        int fd = connect_local(9995);
+        TEST_ASSERT(fd >= 0, "Connect failed");
+        send(fd, request, strlen(request), 0);
+        TEST_ASSERT(read_responses(fd, response, sizeof(response), 1) == 1, "No response");
+        TEST_ASSERT(strstr(response, "200 OK"), "Request rejected");
+        close(fd);
+    }
+
+    uint32_t received = 0;
+    channel->vtable->get_stats(channel, NULL, &received, NULL);
+    TEST_ASSERT(received == 16, "Aggregated counter wrong");
+
+    TEST_ASSERT(channel->vtable->stop_listening(channel) == ERR_OK, "Failed to stop listening");
+    channel->vtable->get_stats(channel, NULL, &received, NULL);
+    TEST_ASSERT(received == 16, "Counter lost on stop");
+
+    channel->vtable->destroy(channel);
+    cleanup_test_message();
+    channel_registry_shutdown();
+    return true;
+}
+
+// Worker-side handler that blocks until the test opens the gate
+static pthread_mutex_t g_gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_gate_cond = PTHREAD_COND_INITIALIZER;
+static bool g_gate_open = false;
+static char g_handled[16][16];
+static uint32_t g_handled_count = 0;
+
+static void gated_message_callback(channel_message_t* msg, void* user_data) {
+    (void)user_data;
+    pthread_mutex_lock(&g_gate_lock);
+    while (!g_gate_open) pthread_cond_wait(&g_gate_cond, &g_gate_lock);
+    if (g_handled_count < 16) {
+        snprintf(g_handled[g_handled_count], sizeof(g_handled[0]), "%.*s",
+                 (int)msg->content.len, msg->content.data);
+        g_handled_count++;
+    }
+    pthread_mutex_unlock(&g_gate_lock);
+}
+
+// A full inbound queue answers 429 and one sender's messages stay ordered
+static bool test_inbound_queue(void) {
+    err_t err = channel_registry_init();
+    TEST_ASSERT(err == ERR_OK, "Failed to initialize channel registry");
+
+    channel_manager_t* manager = channel_manager_create();
+    TEST_ASSERT(manager != NULL, "Failed to create channel manager");
+    TEST_ASSERT(channel_manager_set_workers(manager, 2, 4) == ERR_OK, "Failed to set workers");
+
+    channel_config_t config = channel_config_default();
+    config.name = str_dup_cstr("queue-test", NULL);
+    config.type = str_dup_cstr("webhook", NULL);
+    config.port = 9994;
+    config.host = str_dup_cstr("127.0.0.1", NULL);
+
+    channel_t* channel = NULL;
+    TEST_ASSERT(channel_create("webhook", &config, &channel) == ERR_OK, "Failed to create webhook channel");
+    TEST_ASSERT(channel->vtable->init(channel) == ERR_OK, "Failed to initialize webhook channel");
+    TEST_ASSERT(channel_manager_add_channel(manager, channel) == ERR_OK, "Failed to add channel");
+    TEST_ASSERT(channel_manager_start_all(manager, gated_message_callback, NULL) == ERR_OK,
+                "Failed to start all channels");
+
+    int fd = connect_local(9994);
+    TEST_ASSERT(fd >= 0, "Connect failed");
+
+    // Two slots per ring and a blocked worker: the fourth message at the latest is refused
+    uint32_t accepted = 0, refused = 0;
+    char response[1024];
+    for (int i = 0; i < 6; i++) {
+        char body[64];
+        int body_len = snprintf(body, sizeof(body), "{\"text\":\"m%d\",\"sender\":\"alice\"}", i);
+        char request[256];
+        int len = snprintf(request, sizeof(request),
+                           "POST /webhook HTTP/1.1\r\nContent-Length: %d\r\n\r\n%s", body_len, body);
+        send(fd, request, (size_t)len, 0);
+        TEST_ASSERT(read_responses(fd, response, sizeof(response), 1) == 1, "No response");
+        if (strstr(response, "200 OK")) accepted++;
+        if (strstr(response, "429") && strstr(response, "Retry-After")) refused++;
+    }
+    close(fd);
+    TEST_ASSERT(accepted >= 2 && accepted <= 3 && refused == 6 - accepted, "Backpressure not applied");
+
+    pthread_mutex_lock(&g_gate_lock);
+    g_gate_open = true;
+    pthread_cond_broadcast(&g_gate_cond);
+    pthread_mutex_unlock(&g_gate_lock);
+
+    // Stopping drains what was queued
+    TEST_ASSERT(channel_manager_stop_all(manager) == ERR_OK, "Failed to stop all channels");
+    TEST_ASSERT(g_handled_count == accepted, "Queued messages lost");
+    for (uint32_t i = 0; i < g_handled_count; i++) {
+        char expected[8];
+        snprintf(expected, sizeof(expected), "m%u", i);
+        TEST_ASSERT(strcmp(g_handled[i], expected) == 0, "Sender order not kept");
+    }
+
+    uint64_t queued = 0, rejected = 0;
+    channel_manager_get_queue_stats(manager, &queued, &rejected);
+    TEST_ASSERT(queued == accepted && rejected == refused, "Queue stats wrong");
+
+    channel_manager_destroy(manager);
+    channel_registry_shutdown();
+    return true;
+}
+
+// Streams its reply in two pieces from an agent worker
+static channel_t* g_stream_channel = NULL;
+static uint32_t g_stream_turns = 0;
+
+static void streaming_message_callback(channel_message_t* msg, void* user_data) {
+    (void)user_data;
+    __atomic_fetch_add(&g_stream_turns, 1, __ATOMIC_RELAXED);
+    channel_stream_t* stream = NULL;
+    if (channel_stream_begin(g_stream_channel, &msg->sender, &stream) != ERR_OK) return;
+    str_t first = STR_LIT("Hel");
+    str_t second = STR_LIT("lo \"there\"");
+    channel_stream_append(stream, &first);
+    channel_stream_append(stream, &second);
+    channel_stream_end(stream);
+}
+
+// Read until the peer closes the connection
+static size_t read_until_close(int fd, char* buf, size_t cap) {
+    size_t len = 0;
+    struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (len + 1 < cap) {
+        ssize_t n = recv(fd, buf + len, cap - len - 1, 0);
+        if (n <= 0) break;
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+// A sender asking for text/event-stream gets the reply as SSE events
+static bool test_webhook_stream(void) {
+    err_t err = channel_registry_init();
+    TEST_ASSERT(err == ERR_OK, "Failed to initialize channel registry");
+
+    channel_manager_t* manager = channel_manager_create();
+    TEST_ASSERT(manager != NULL, "Failed to create channel manager");
+    TEST_ASSERT(channel_manager_set_workers(manager, 1, 16) == ERR_OK, "Failed to set workers");
+
+    channel_config_t config = channel_config_default();
+    config.name = str_dup_cstr("stream-test", NULL);
+    config.type = str_dup_cstr("webhook", NULL);
+    config.port = 9993;
+    config.host = str_dup_cstr("127.0.0.1", NULL);
+
+    TEST_ASSERT(channel_create("webhook", &config, &g_stream_channel) == ERR_OK, "Failed to create webhook channel");
+    TEST_ASSERT(g_stream_channel->vtable->init(g_stream_channel) == ERR_OK, "Failed to initialize webhook channel");
+    TEST_ASSERT(channel_manager_add_channel(manager, g_stream_channel) == ERR_OK, "Failed to add channel");
+    TEST_ASSERT(channel_manager_start_all(manager, streaming_message_callback, NULL) == ERR_OK,
+                "Failed to start all channels");
+
+    int fd = connect_local(9993);
+    TEST_ASSERT(fd >= 0, "Connect failed");
+    const char* body = "{\"text\":\"hi\",\"sender\":\"bob\"}";
+    char request[256];
+    int len = snprintf(request, sizeof(request),
+                       "POST /webhook HTTP/1.1\r\nAccept: text/event-stream\r\nContent-Length: %zu\r\n\r\n%s",
+                       strlen(body), body);
+    send(fd, request, (size_t)len, 0);
+
+    char response[4096];
+    read_until_close(fd, response, sizeof(response));
+    close(fd);
+    TEST_ASSERT(strstr(response, "200 OK") && strstr(response, "Content-Type: text/event-stream"),
+                "No event stream");
+    const char* first = strstr(response, "data: {\"text\":\"Hel\"}\n\n");
+    const char* second = strstr(response, "data: {\"text\":\"lo \\\"there\\\"\"}\n\n");
+    const char* done = strstr(response, "event: done\n");
+    TEST_ASSERT(first && second && done && first < second && second < done, "Events missing or out of order");
+
+    // Without the Accept header the request is only acknowledged
+    fd = connect_local(9993);
+    TEST_ASSERT(fd >= 0, "Connect failed");
+    len = snprintf(request, sizeof(request),
+                   "POST /webhook HTTP/1.1\r\nConnection: close\r\nContent-Length: %zu\r\n\r\n%s",
+                   strlen(body), body);
+    send(fd, request, (size_t)len, 0);
+    read_until_close(fd, response, sizeof(response));
+    close(fd);
+    TEST_ASSERT(strstr(response, "200 OK") && strstr(response, "{\"status\":\"ok\"}") &&
+                !strstr(response, "event:"), "Plain request streamed");
+
+    TEST_ASSERT(channel_manager_stop_all(manager) == ERR_OK, "Failed to stop all channels");
+
+    uint32_t sent = 0;
+    g_stream_channel->vtable->get_stats(g_stream_channel, &sent, NULL, NULL);
+    TEST_ASSERT(sent == 1, "Streamed reply not counted");
+
+    channel_manager_destroy(manager);
+    g_stream_channel = NULL;
+    channel_registry_shutdown();
+    return true;
+}
+
+// One request on a fresh connection, read until the server closes it
+static size_t post_once(uint16_t port, const char* headers, const char* body, char* response, size_t cap) {
+    int fd = connect_local(port);
+    if (fd < 0) return 0;
+    char request[512];
+    int len = snprintf(request, sizeof(request),
+                       "POST /webhook HTTP/1.1\r\nConnection: close\r\n%sContent-Length: %zu\r\n\r\n%s",
+                       headers, strlen(body), body);
+    send(fd, request, (size_t)len, 0);
+    size_t got = read_until_close(fd, response, cap);
+    close(fd);
+    return got;
+}
+
+// Retries are answered from the idempotency table; a sender over its
+// rate limit is refused
+static bool test_webhook_guards(void) {
+    err_t err = channel_registry_init();
+    TEST_ASSERT(err == ERR_OK, "Failed to initialize channel registry");
+
+    channel_manager_t* manager = channel_manager_create();
+    TEST_ASSERT(manager != NULL, "Failed to create channel manager");
+    TEST_ASSERT(channel_manager_set_workers(manager, 1, 16) == ERR_OK, "Failed to set workers");
+
+    channel_config_t config = channel_config_default();
+    config.name = str_dup_cstr("guard-test", NULL);
+    config.type = str_dup_cstr("webhook", NULL);
+    config.port = 9992;
+    config.host = str_dup_cstr("127.0.0.1", NULL);
+    config.rate_limit_per_minute = 6;
+    config.idempotency_ttl_secs = 60;
+
+    TEST_ASSERT(channel_create("webhook", &config, &g_stream_channel) == ERR_OK, "Failed to create webhook channel");
+    TEST_ASSERT(g_stream_channel->vtable->init(g_stream_channel) == ERR_OK, "Failed to initialize webhook channel");
+    TEST_ASSERT(channel_manager_add_channel(manager, g_stream_channel) == ERR_OK, "Failed to add channel");
+    g_stream_turns = 0;
+    TEST_ASSERT(channel_manager_start_all(manager, streaming_message_callback, NULL) == ERR_OK,
+                "Failed to start all channels");
+
+    // A streamed reply is replayed to a retry with the same delivery ID
+    const char* stream_headers = "Accept: text/event-stream\r\nIdempotency-Key: d-1\r\n";
+    const char* body = "{\"text\":\"hi\",\"sender\":\"bob\"}";
+    char first[4096];
+    char retry[4096];
+    post_once(9992, stream_headers, body, first, sizeof(first));
+    TEST_ASSERT(strstr(first, "event: done\n"), "First attempt not streamed");
+    post_once(9992, stream_headers, body, retry, sizeof(retry));
+    TEST_ASSERT(strstr(retry, "Idempotent-Replayed: true"), "Retry not replayed");
+    const char* events = strstr(first, "\r\n\r\n");
+    const char* replayed = strstr(retry, "\r\n\r\n");
+    TEST_ASSERT(events && replayed && strcmp(events, replayed) == 0, "Replay differs");
+
+    // The same ID from another sender is a delivery of its own
+    char other[4096];
+    post_once(9992, stream_headers, "{\"text\":\"hi\",\"sender\":\"mallory\"}", other, sizeof(other));
+    TEST_ASSERT(!strstr(other, "Idempotent-Replayed") && strstr(other, "event: done\n"),
+                "Another sender's reply replayed");
+
+    // Without an ID the body identifies the delivery
+    char response[4096];
+    post_once(9992, "", "{\"text\":\"plain\"}", response, sizeof(response));
+    TEST_ASSERT(strstr(response, "200 OK") && !strstr(response, "Idempotent-Replayed"), "Plain request replayed");
+    post_once(9992, "", "{\"text\":\"plain\"}", response, sizeof(response));
+    TEST_ASSERT(strstr(response, "200 OK") && strstr(response, "Idempotent-Replayed"), "Same body not deduplicated");
+
+    // Six per minute: one more fits, the seventh request is refused
+    post_once(9992, "", "{\"text\":\"a\"}", response, sizeof(response));
+    TEST_ASSERT(strstr(response, "200 OK"), "Sixth request refused");
+    post_once(9992, "", "{\"text\":\"b\"}", response, sizeof(response));
+    TEST_ASSERT(strstr(response, "429 Too Many Requests") && strstr(response, "Retry-After: "),
+                "Over-limit request not refused");
+
+    TEST_ASSERT(channel_manager_stop_all(manager) == ERR_OK, "Failed to stop all channels");
+    TEST_ASSERT(g_stream_turns == 4, "Duplicates reached the agent");
+
+    channel_manager_destroy(manager);
+    g_stream_channel = NULL;
+    channel_registry_shutdown();
+    return true;
+}
+
 // Main test runner
 int main(void) {
     printf("CClaw Channel System Test Suite\n");
@@ -316,7 +825,13 @@ int main(void) {
     TEST_RUN("channel_registry", test_channel_registry);
     TEST_RUN("webhook_creation", test_webhook_creation);
     TEST_RUN("webhook_listening", test_webhook_listening);
+    TEST_RUN("webhook_http", test_webhook_http);
+    TEST_RUN("webhook_reactors", test_webhook_reactors);
+    TEST_RUN("inbound_queue", test_inbound_queue);
+    TEST_RUN("webhook_stream", test_webhook_stream);
+    TEST_RUN("webhook_guards", test_webhook_guards);
     TEST_RUN("channel_manager", test_channel_manager);
+    TEST_RUN("outbound_fanout", test_outbound_fanout);
     TEST_RUN("message_sending", test_message_sending);
     TEST_RUN("health_check", test_health_check);
 
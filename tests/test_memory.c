@@ -3,9 +3,15 @@
 
 #include "core/memory.h"
 #include "core/error.h"
+#include "memory/cache.h"
+#include "memory/shard.h"
+#include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
 
 #define TEST(expr) \
     do { \
@@ -180,6 +186,845 @@ static bool test_memory_search(void) {
     return true;
 }
 
+static bool test_memory_store_multiple(void) {
+    printf("Testing batched store...\n");
+
+    memory_config_t config = memory_config_default();
+    memory_t* memory = NULL;
+    err_t err = memory_create("sqlite", &config, &memory);
+    TEST_OK(err);
+    TEST_OK(memory->vtable->init(memory));
+
+    memory_entry_t entries[50];
+    for (int i = 0; i < 50; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "batch_%d", i);
+        str_t key_str = STR_VIEW(key);
+        str_t content = STR_LIT("batched entry");
+        memory_entry_t* entry = memory_entry_create(&key_str, &content, MEMORY_CATEGORY_CONVERSATION, NULL);
+        TEST(entry != NULL);
+        entries[i] = *entry;
+        free(entry);
+    }
+
+    TEST_OK(memory_store_multiple(memory, entries, 50));
+
+    uint32_t total = 0;
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 50);
+
+    // Duplicate ids fail the whole group
+    TEST(memory_store_multiple(memory, entries, 2) == ERR_MEMORY);
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 50);
+
+    for (int i = 0; i < 50; i++) {
+        free((void*)entries[i].id.data);
+        free((void*)entries[i].key.data);
+        free((void*)entries[i].content.data);
+        free((void*)entries[i].timestamp.data);
+        free((void*)entries[i].session_id.data);
+    }
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    return true;
+}
+
+static bool test_memory_write_behind(void) {
+    printf("Testing write-behind store...\n");
+
+    memory_config_t config = memory_config_default();
+    config.write_behind_batch = 8;
+    config.write_behind_interval_ms = 20;
+
+    memory_t* memory = NULL;
+    err_t err = memory_create("sqlite", &config, &memory);
+    TEST_OK(err);
+    TEST_OK(memory->vtable->init(memory));
+
+    for (int i = 0; i < 20; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "wb_%d", i);
+        str_t key_str = STR_VIEW(key);
+        str_t content = STR_LIT("queued entry");
+        memory_entry_t* entry = memory_entry_create(&key_str, &content, MEMORY_CATEGORY_DAILY, NULL);
+        TEST(entry != NULL);
+
+        err = memory->vtable->store(memory, entry);
+        memory_entry_free(entry);
+        TEST_OK(err);
+    }
+
+    // Reads observe stores that are still queued
+    str_t key = STR_LIT("wb_19");
+    memory_entry_t recalled = {0};
+    TEST_OK(memory->vtable->recall(memory, &key, &recalled));
+    free((void*)recalled.id.data);
+    free((void*)recalled.key.data);
+    free((void*)recalled.content.data);
+    free((void*)recalled.timestamp.data);
+    free((void*)recalled.session_id.data);
+
+    TEST_OK(memory_flush(memory));
+
+    uint32_t total = 0;
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 20);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    return true;
+}
+
+static bool test_memory_search_ranked(void) {
+    printf("Testing ranked search with filters...\n");
+
+    memory_config_t config = memory_config_default();
+    memory_t* memory = NULL;
+    err_t err = memory_create("sqlite", &config, &memory);
+    TEST_OK(err);
+    TEST_OK(memory->vtable->init(memory));
+
+    const char* keys[] = {"once", "thrice", "none"};
+    const char* contents[] = {
+        "The orchard grows one apple among many pears and plums.",
+        "apple apple apple",
+        "Nothing to see here."
+    };
+    memory_category_t categories[] = {MEMORY_CATEGORY_DAILY, MEMORY_CATEGORY_CUSTOM, MEMORY_CATEGORY_DAILY};
+
+    for (int i = 0; i < 3; i++) {
+        str_t key = STR_VIEW(keys[i]);
+        str_t content = STR_VIEW(contents[i]);
+        memory_entry_t* entry = memory_entry_create(&key, &content, categories[i], NULL);
+        TEST(entry != NULL);
+        err = memory->vtable->store(memory, entry);
+        memory_entry_free(entry);
+        TEST_OK(err);
+    }
+
+    str_t query = STR_LIT("apple");
+    memory_search_opts_t opts = memory_search_opts_default();
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+
+    // Best match first with a positive relevance score
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 2);
+    TEST(str_equal_cstr(results[0].key, "thrice"));
+    TEST(results[0].score > results[1].score && results[1].score > 0.0);
+    memory_entry_array_free(results, count);
+
+    // Category pushdown
+    opts.category_filter = MEMORY_CATEGORY_DAILY;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 1);
+    TEST(str_equal_cstr(results[0].key, "once"));
+    memory_entry_array_free(results, count);
+
+    // Snippets instead of full content
+    opts.snippets = true;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 1);
+    TEST(strstr(results[0].content.data, "[apple]") != NULL);
+    memory_entry_array_free(results, count);
+
+    // Query syntax characters are treated as text
+    str_t hostile = STR_LIT("apple\" OR NOT (");
+    opts = memory_search_opts_default();
+    TEST_OK(memory->vtable->search(memory, &hostile, &opts, &results, &count));
+    memory_entry_array_free(results, count);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    return true;
+}
+
+// Letter-frequency "embedding": anagrams get identical vectors
+static int g_embed_calls = 0;
+
+static err_t letter_embed(void* ctx, const str_t* texts, uint32_t count, uint32_t dimensions, float* out) {
+    (void)ctx;
+    g_embed_calls++;
+    for (uint32_t t = 0; t < count; t++) {
+        float* v = out + (size_t)t * dimensions;
+        memset(v, 0, dimensions * sizeof(float));
+        for (uint32_t i = 0; i < texts[t].len; i++) {
+            char c = (char)tolower((unsigned char)texts[t].data[i]);
+            if (c >= 'a' && c <= 'z') v[c - 'a'] += 1.0f;
+        }
+    }
+    return ERR_OK;
+}
+
+static bool test_memory_hybrid(void) {
+    printf("Testing hybrid vector + keyword search...\n");
+
+    memory_config_t config = memory_config_default();
+    config.embed = letter_embed;
+    config.embedding_dimensions = 26;
+    config.embedding_cache_size = 8;
+    memory_t* memory = NULL;
+    err_t err = memory_create("sqlite", &config, &memory);
+    TEST_OK(err);
+    TEST_OK(memory->vtable->init(memory));
+
+    const char* keys[] = {"fruit", "tools"};
+    const char* contents[] = {"apple", "hammer and nails"};
+    memory_entry_t entries[2];
+    for (int i = 0; i < 2; i++) {
+        str_t key_str = STR_VIEW(keys[i]);
+        str_t content = STR_VIEW(contents[i]);
+        memory_entry_t* entry = memory_entry_create(&key_str, &content, MEMORY_CATEGORY_DAILY, NULL);
+        TEST(entry != NULL);
+        entries[i] = *entry;
+        free(entry);
+    }
+    TEST_OK(memory_store_multiple(memory, entries, 2));
+    TEST(g_embed_calls == 1);
+    for (int i = 0; i < 2; i++) {
+        free((void*)entries[i].id.data);
+        free((void*)entries[i].key.data);
+        free((void*)entries[i].content.data);
+        free((void*)entries[i].timestamp.data);
+        free((void*)entries[i].session_id.data);
+    }
+
+    // No keyword overlap: only the vector side can find it
+    str_t query = STR_LIT("elppa");
+    memory_search_opts_t opts = memory_search_opts_default();
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count >= 1);
+    TEST(str_equal_cstr(results[0].key, "fruit"));
+    TEST(results[0].score > 0.6);
+    memory_entry_array_free(results, count);
+
+    // Repeated query text is served from the embedding cache
+    int calls = g_embed_calls;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    memory_entry_array_free(results, count);
+    TEST(g_embed_calls == calls);
+
+    // Filters apply to vector-only matches too
+    opts.category_filter = MEMORY_CATEGORY_CUSTOM;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 0);
+    memory_entry_array_free(results, count);
+
+    // Forgotten memories drop out of the vector index
+    str_t key = STR_LIT("fruit");
+    TEST_OK(memory->vtable->forget(memory, &key));
+    opts = memory_search_opts_default();
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    for (uint32_t i = 0; i < count; i++) {
+        TEST(!str_equal_cstr(results[i].key, "fruit"));
+    }
+    memory_entry_array_free(results, count);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    return true;
+}
+
+static bool test_memory_markdown_index(void) {
+    printf("Testing markdown inverted index...\n");
+
+    char dir[] = "/tmp/cclaw_md_XXXXXX";
+    TEST(mkdtemp(dir) != NULL);
+
+    memory_config_t config = memory_config_default();
+    config.data_dir = STR_VIEW(dir);
+    memory_t* memory = NULL;
+    TEST_OK(memory_create("markdown", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    const char* keys[] = {"trip", "recipe"};
+    const char* contents[] = {"Flight to Lisbon on Friday", "Lisbon custard tarts need hot ovens"};
+    for (int i = 0; i < 2; i++) {
+        str_t key = STR_VIEW(keys[i]);
+        str_t content = STR_VIEW(contents[i]);
+        memory_entry_t* entry = memory_entry_create(&key, &content, MEMORY_CATEGORY_DAILY, NULL);
+        TEST(entry != NULL);
+        TEST_OK(memory->vtable->store(memory, entry));
+        memory_entry_free(entry);
+    }
+
+    // Every query term must occur; content comes back parsed from the file
+    str_t query = STR_LIT("lisbon ovens");
+    memory_search_opts_t opts = memory_search_opts_default();
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 1);
+    TEST(str_equal_cstr(results[0].key, "recipe"));
+    TEST(str_equal_cstr(results[0].content, "Lisbon custard tarts need hot ovens"));
+    memory_entry_array_free(results, count);
+
+    // A file dropped in by hand is picked up through the directory mtime
+    char path[512];
+    snprintf(path, sizeof(path), "%s/custom/notes.md", dir);
+    FILE* f = fopen(path, "w");
+    TEST(f != NULL);
+    fputs("Buy a guidebook for Lisbon\n", f);
+    fclose(f);
+
+    query = STR_LIT("lisbon");
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 3);
+    memory_entry_array_free(results, count);
+
+    str_t key = STR_LIT("trip");
+    TEST_OK(memory->vtable->forget(memory, &key));
+    TEST(memory->vtable->forget(memory, &key) == ERR_NOT_FOUND);
+
+    // The index survives a restart
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+    TEST_OK(memory_create("markdown", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    TEST_OK(memory->vtable->search(memory, &query, &opts, &results, &count));
+    TEST(count == 2);
+    memory_entry_array_free(results, count);
+
+    uint32_t total = 0;
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 2);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    TEST(system(cmd) == 0);
+
+    return true;
+}
+
+typedef struct pool_reader_t {
+    memory_t* memory;
+    int misses;
+} pool_reader_t;
+
+static void* pool_reader_thread(void* arg) {
+    pool_reader_t* reader = arg;
+    str_t key = STR_LIT("seed");
+    str_t query = STR_LIT("pooled");
+    for (int i = 0; i < 200; i++) {
+        memory_entry_t entry = {0};
+        if (reader->memory->vtable->recall(reader->memory, &key, &entry) != ERR_OK) reader->misses++;
+        free((void*)entry.id.data);
+        free((void*)entry.key.data);
+        free((void*)entry.content.data);
+        free((void*)entry.timestamp.data);
+        free((void*)entry.session_id.data);
+
+        memory_entry_t* results = NULL;
+        uint32_t count = 0;
+        if (reader->memory->vtable->search(reader->memory, &query, NULL, &results, &count) != ERR_OK || count == 0) {
+            reader->misses++;
+        }
+        memory_entry_array_free(results, count);
+    }
+    return NULL;
+}
+
+static bool test_memory_sqlite_pool(void) {
+    printf("Testing sqlite reader pool and counters...\n");
+
+    char dir[] = "/tmp/cclaw_sqlite_XXXXXX";
+    TEST(mkdtemp(dir) != NULL);
+
+    memory_config_t config = memory_config_default();
+    config.data_dir = STR_VIEW(dir);
+    config.write_behind_batch = 8;
+    memory_t* memory = NULL;
+    TEST_OK(memory_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    str_t key = STR_LIT("seed");
+    str_t content = STR_LIT("pooled seed entry");
+    memory_entry_t* entry = memory_entry_create(&key, &content, MEMORY_CATEGORY_CORE, NULL);
+    TEST(entry != NULL);
+    TEST_OK(memory->vtable->store(memory, entry));
+    memory_entry_free(entry);
+
+    // Lookups run on the read connections while stores go through the writer
+    pool_reader_t readers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        readers[i] = (pool_reader_t){ memory, 0 };
+        TEST(pthread_create(&threads[i], NULL, pool_reader_thread, &readers[i]) == 0);
+    }
+    for (int i = 0; i < 60; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "pool_%d", i);
+        str_t entry_key = STR_VIEW(name);
+        str_t entry_content = STR_LIT("pooled entry");
+        entry = memory_entry_create(&entry_key, &entry_content, (memory_category_t)(i % 3 + 1), NULL);
+        TEST(entry != NULL);
+        TEST_OK(memory->vtable->store(memory, entry));
+        memory_entry_free(entry);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        TEST(readers[i].misses == 0);
+    }
+
+    // Counters see queued stores and follow deletes
+    uint32_t total = 0;
+    uint32_t by_category[MEMORY_CATEGORY_CUSTOM + 1] = {0};
+    TEST_OK(memory->vtable->get_stats(memory, &total, by_category));
+    TEST(total == 61);
+    TEST(by_category[MEMORY_CATEGORY_CORE] == 1 && by_category[MEMORY_CATEGORY_DAILY] == 20);
+
+    TEST_OK(memory->vtable->forget(memory, &key));
+    str_t daily = STR_LIT("pool_0");
+    TEST_OK(memory->vtable->forget(memory, &daily));
+    TEST_OK(memory->vtable->get_stats(memory, &total, by_category));
+    TEST(total == 59);
+    TEST(by_category[MEMORY_CATEGORY_CORE] == 0 && by_category[MEMORY_CATEGORY_DAILY] == 19);
+
+    // Reopening recounts from the file
+    memory->vtable->cleanup(memory);
+    TEST_OK(memory->vtable->init(memory));
+    TEST_OK(memory->vtable->get_stats(memory, &total, by_category));
+    TEST(total == 59 && by_category[MEMORY_CATEGORY_CONVERSATION] == 20);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    TEST(system(cmd) == 0);
+
+    return true;
+}
+
+static bool test_memory_sweep(void) {
+    printf("Testing retention sweep...\n");
+
+    memory_config_t config = memory_config_default();
+    memory_t* memory = NULL;
+    TEST_OK(memory_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    memory_category_t categories[] = { MEMORY_CATEGORY_CONVERSATION, MEMORY_CATEGORY_DAILY, MEMORY_CATEGORY_CORE };
+    int counts[] = { 10, 7, 2 };
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < counts[c]; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "sweep_%d_%d", c, i);
+            str_t key = STR_VIEW(name);
+            str_t content = STR_LIT("retention candidate");
+            memory_entry_t* entry = memory_entry_create(&key, &content, categories[c], NULL);
+            TEST(entry != NULL);
+            TEST_OK(memory->vtable->store(memory, entry));
+            memory_entry_free(entry);
+        }
+    }
+
+    // Cutoffs in the future make every row old enough
+    uint64_t later = (uint64_t)time(NULL) + 60;
+    memory_sweep_opts_t opts = { .conversation_before = later, .archive_before = later,
+                                 .batch_size = 3, .max_batches = 2 };
+    memory_sweep_result_t result;
+    TEST_OK(memory_sweep(memory, &opts, &result));
+    TEST(result.expired == 6 && result.archived == 0 && !result.complete);
+
+    opts.max_batches = 0;
+    TEST_OK(memory_sweep(memory, &opts, &result));
+    TEST(result.expired == 4 && result.archived == 7 && result.complete);
+
+    uint32_t total = 0;
+    uint32_t by_category[MEMORY_CATEGORY_CUSTOM + 1] = {0};
+    TEST_OK(memory->vtable->get_stats(memory, &total, by_category));
+    TEST(total == 2 && by_category[MEMORY_CATEGORY_CORE] == 2);
+
+    // Archived entries leave recall and search
+    str_t key = STR_LIT("sweep_1_0");
+    memory_entry_t recalled = {0};
+    TEST(memory->vtable->recall(memory, &key, &recalled) == ERR_NOT_FOUND);
+    str_t query = STR_LIT("retention");
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory->vtable->search(memory, &query, NULL, &results, &count));
+    TEST(count == 2);
+    memory_entry_array_free(results, count);
+
+    opts = (memory_sweep_opts_t){ .purge_before = later, .batch_size = 3 };
+    TEST_OK(memory_sweep(memory, &opts, &result));
+    TEST(result.purged == 7 && result.complete);
+
+    // Batched forget_old
+    TEST_OK(memory->vtable->forget_old(memory, later));
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 0);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    return true;
+}
+
+static void entry_fields_free(memory_entry_t* entry) {
+    free((void*)entry->id.data);
+    free((void*)entry->key.data);
+    free((void*)entry->content.data);
+    free((void*)entry->timestamp.data);
+    free((void*)entry->session_id.data);
+}
+
+static bool store_keys(memory_t* memory, const char* prefix, int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s_%d", prefix, i);
+        str_t key = STR_VIEW(name);
+        str_t content = STR_LIT("backed up entry");
+        memory_entry_t* entry = memory_entry_create(&key, &content, MEMORY_CATEGORY_CORE, NULL);
+        TEST(entry != NULL);
+        err_t err = memory->vtable->store(memory, entry);
+        memory_entry_free(entry);
+        TEST_OK(err);
+    }
+    return true;
+}
+
+static bool test_memory_backup(void) {
+    printf("Testing sqlite backup and restore...\n");
+
+    char dir[] = "/tmp/cclaw_backup_XXXXXX";
+    TEST(mkdtemp(dir) != NULL);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/memories.db", dir);
+    str_t backup_path = STR_VIEW(path);
+
+    memory_config_t config = memory_config_default();
+    memory_t* memory = NULL;
+    TEST_OK(memory_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+    TEST(store_keys(memory, "bk", 0, 30));
+
+    // First backup is a full copy
+    TEST_OK(memory->vtable->backup(memory, &backup_path));
+
+    // The second only applies what changed: a delete and new rows
+    str_t gone = STR_LIT("bk_3");
+    TEST_OK(memory->vtable->forget(memory, &gone));
+    TEST(store_keys(memory, "bk", 30, 5));
+    TEST_OK(memory->vtable->backup(memory, &backup_path));
+
+    memory_config_t backup_config = memory_config_default();
+    backup_config.data_dir = STR_VIEW(dir);
+    memory_t* copy = NULL;
+    TEST_OK(memory_create("sqlite", &backup_config, &copy));
+    TEST_OK(copy->vtable->init(copy));
+    uint32_t total = 0;
+    TEST_OK(copy->vtable->get_stats(copy, &total, NULL));
+    TEST(total == 34);
+    memory_entry_t recalled = {0};
+    TEST(copy->vtable->recall(copy, &gone, &recalled) == ERR_NOT_FOUND);
+    str_t query = STR_LIT("backed");
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    memory_search_opts_t opts = memory_search_opts_default();
+    opts.limit = 100;
+    TEST_OK(copy->vtable->search(copy, &query, &opts, &results, &count));
+    TEST(count == 34);
+    memory_entry_array_free(results, count);
+    copy->vtable->cleanup(copy);
+    copy->vtable->destroy(copy);
+
+    // Restore replaces the contents
+    memory_t* restored = NULL;
+    TEST_OK(memory_create("sqlite", &config, &restored));
+    TEST_OK(restored->vtable->init(restored));
+    TEST(store_keys(restored, "other", 0, 3));
+    TEST_OK(restored->vtable->restore(restored, &backup_path));
+    TEST_OK(restored->vtable->get_stats(restored, &total, NULL));
+    TEST(total == 34);
+    str_t kept = STR_LIT("bk_34");
+    TEST_OK(restored->vtable->recall(restored, &kept, &recalled));
+    entry_fields_free(&recalled);
+    restored->vtable->cleanup(restored);
+    restored->vtable->destroy(restored);
+
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    TEST(system(cmd) == 0);
+
+    return true;
+}
+
+static bool store_conversation(memory_t* memory, int first, int count) {
+    for (int i = first; i < first + count; i++) {
+        char name[32];
+        char text[256];
+        snprintf(name, sizeof(name), "turn_%d", i);
+        snprintf(text, sizeof(text), "user: can you check the deployment logs for the staging cluster again? "
+                                     "assistant: the staging cluster deployment finished, marker%d", i);
+        str_t key = STR_VIEW(name);
+        str_t content = STR_VIEW(text);
+        memory_entry_t* entry = memory_entry_create(&key, &content, MEMORY_CATEGORY_CONVERSATION, NULL);
+        TEST(entry != NULL);
+        err_t err = memory->vtable->store(memory, entry);
+        memory_entry_free(entry);
+        TEST_OK(err);
+    }
+    return true;
+}
+
+static bool test_memory_compression(void) {
+    printf("Testing sqlite content compression...\n");
+
+    char dir[] = "/tmp/cclaw_compress_XXXXXX";
+    TEST(mkdtemp(dir) != NULL);
+
+    memory_config_t config = memory_config_default();
+    config.data_dir = STR_VIEW(dir);
+    config.compression = true;
+    memory_t* memory = NULL;
+    TEST_OK(memory_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    // The dictionary is trained once the category has enough rows
+    TEST(store_conversation(memory, 0, 60));
+
+    str_t key = STR_LIT("turn_50");
+    memory_entry_t recalled = {0};
+    TEST_OK(memory->vtable->recall(memory, &key, &recalled));
+    TEST(strstr(recalled.content.data, "finished, marker50") != NULL);
+    TEST(recalled.content.len == strlen(recalled.content.data));
+    entry_fields_free(&recalled);
+
+    // Search matches against the plaintext index
+    str_t query = STR_LIT("marker55");
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory->vtable->search(memory, &query, NULL, &results, &count));
+    TEST(count == 1 && strstr(results[0].content.data, "marker55") != NULL);
+    memory_entry_array_free(results, count);
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/memories.db", dir);
+    sqlite3* db = NULL;
+    TEST(sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK);
+    sqlite3_stmt* stmt = NULL;
+    TEST(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM memories WHERE codec != 0;", -1, &stmt, NULL) == SQLITE_OK);
+    TEST(sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    // Compressed rows still decode once compression is turned off
+    config.compression = false;
+    TEST_OK(memory_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+    key = STR_LIT("turn_59");
+    TEST_OK(memory->vtable->recall(memory, &key, &recalled));
+    TEST(strstr(recalled.content.data, "marker59") != NULL);
+    entry_fields_free(&recalled);
+    memory->vtable->cleanup(memory);
+    memory->vtable->destroy(memory);
+
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    TEST(system(cmd) == 0);
+
+    return true;
+}
+
+static bool test_memory_cache(void) {
+    printf("Testing read-through memory cache...\n");
+
+    memory_config_t config = memory_config_default();
+    memory_t* inner = NULL;
+    TEST_OK(memory_create("sqlite", &config, &inner));
+    memory_t* memory = NULL;
+    TEST_OK(memory_cache_wrap(inner, 64, &memory));
+    TEST(memory_is_cache(memory) && !memory_is_cache(inner));
+    TEST_OK(memory->vtable->init(memory));
+    TEST(inner->initialized);
+
+    str_t key = STR_LIT("color");
+    str_t content = STR_LIT("The sky is blue.");
+    memory_entry_t* entry = memory_entry_create(&key, &content, MEMORY_CATEGORY_CORE, NULL);
+    TEST_OK(memory->vtable->store(memory, entry));
+
+    // The second recall is answered from the cache
+    memory_entry_t recalled = {0};
+    TEST_OK(memory->vtable->recall(memory, &key, &recalled));
+    entry_fields_free(&recalled);
+    memory_entry_t again = {0};
+    TEST_OK(memory->vtable->recall(memory, &key, &again));
+    TEST(str_equal(again.content, content));
+    entry_fields_free(&again);
+
+    memory_cache_stats_t stats;
+    TEST(memory_cache_get_stats(memory, &stats));
+    TEST(stats.hits == 1 && stats.misses == 1 && stats.entries == 1);
+
+    // Misses are cached too: a write behind the cache's back goes unseen
+    str_t other = STR_LIT("other");
+    memory_entry_t missing = {0};
+    TEST(memory->vtable->recall(memory, &other, &missing) == ERR_NOT_FOUND);
+    memory_entry_t* hidden = memory_entry_create(&other, &content, MEMORY_CATEGORY_CORE, NULL);
+    TEST_OK(inner->vtable->store(inner, hidden));
+    TEST(memory->vtable->recall(memory, &other, &missing) == ERR_NOT_FOUND);
+
+    // Searches are cached until any write
+    str_t query = STR_LIT("sky");
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory_search_simple(memory, &query, 10, &results, &count));
+    uint32_t first_count = count;
+    memory_entry_array_free(results, count);
+    TEST_OK(memory_search_simple(memory, &query, 10, &results, &count));
+    TEST(count == first_count);
+    memory_entry_array_free(results, count);
+    TEST(memory_cache_get_stats(memory, &stats) && stats.hits == 3);
+
+    // Storing through the cache drops that key and every search
+    str_t updated = STR_LIT("The sky is grey today.");
+    memory_entry_t* replacement = memory_entry_create(&key, &updated, MEMORY_CATEGORY_CORE, NULL);
+    TEST_OK(inner->vtable->forget(inner, &key));
+    TEST_OK(memory->vtable->store(memory, replacement));
+    TEST_OK(memory->vtable->recall(memory, &key, &again));
+    TEST(str_equal(again.content, updated));
+    entry_fields_free(&again);
+    TEST_OK(memory_search_simple(memory, &query, 10, &results, &count));
+    memory_entry_array_free(results, count);
+    TEST(memory_cache_get_stats(memory, &stats) && stats.hits == 3);
+
+    // The unrelated cached miss survived; forget drops its key
+    TEST(memory->vtable->recall(memory, &other, &missing) == ERR_NOT_FOUND);
+    TEST_OK(memory->vtable->forget(memory, &key));
+    TEST(memory->vtable->recall(memory, &key, &again) == ERR_NOT_FOUND);
+
+    memory_entry_free(entry);
+    memory_entry_free(hidden);
+    memory_entry_free(replacement);
+    memory_free(memory);
+    return true;
+}
+
+static bool test_memory_shard(void) {
+    printf("Testing sharded memory...\n");
+
+    memory_config_t config = memory_config_default();
+    config.shards = 4;
+    memory_t* memory = NULL;
+    TEST_OK(memory_shard_create("sqlite", &config, &memory));
+    TEST(memory_is_sharded(memory));
+    TEST_OK(memory->vtable->init(memory));
+
+    // Keys spread over the shards
+    memory_entry_t* entries[16];
+    bool used[4] = {false};
+    for (uint32_t i = 0; i < 16; i++) {
+        char key_buf[16], content_buf[64], session_buf[16];
+        snprintf(key_buf, sizeof(key_buf), "note-%u", i);
+        snprintf(content_buf, sizeof(content_buf), "planet %s fact number %u", i % 2 ? "mars" : "venus", i);
+        snprintf(session_buf, sizeof(session_buf), "session-%u", i / 2);
+        str_t key = STR_VIEW(key_buf);
+        str_t content = STR_VIEW(content_buf);
+        str_t session = STR_VIEW(session_buf);
+        entries[i] = memory_entry_create(&key, &content, MEMORY_CATEGORY_DAILY, &session);
+        TEST(entries[i] != NULL);
+        TEST_OK(memory->vtable->store(memory, entries[i]));
+        used[memory_shard_of(memory, entries[i])] = true;
+    }
+    TEST((int)used[0] + used[1] + used[2] + used[3] > 1);
+
+    uint32_t total = 0;
+    uint32_t by_category[MEMORY_CATEGORY_CUSTOM + 1] = {0};
+    TEST_OK(memory->vtable->get_stats(memory, &total, by_category));
+    TEST(total == 16 && by_category[MEMORY_CATEGORY_DAILY] == 16);
+
+    // Hits from every shard, merged best first and cut to the limit
+    str_t query = STR_LIT("mars");
+    memory_entry_t* results = NULL;
+    uint32_t count = 0;
+    TEST_OK(memory_search_simple(memory, &query, 5, &results, &count));
+    TEST(count == 5);
+    for (uint32_t i = 0; i < count; i++) {
+        TEST(strstr(results[i].content.data, "mars") != NULL);
+        if (i > 0) TEST(results[i - 1].score >= results[i].score);
+    }
+    memory_entry_array_free(results, count);
+    TEST_OK(memory_search_simple(memory, &query, 20, &results, &count));
+    TEST(count == 8);
+    memory_entry_array_free(results, count);
+
+    // Key lookups find the entry wherever it went
+    str_t key = STR_LIT("note-7");
+    memory_entry_t recalled = {0};
+    TEST_OK(memory->vtable->recall(memory, &key, &recalled));
+    TEST(str_equal(recalled.content, entries[7]->content));
+    entry_fields_free(&recalled);
+    TEST_OK(memory->vtable->forget(memory, &key));
+    TEST(memory->vtable->recall(memory, &key, &recalled) == ERR_NOT_FOUND);
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 15);
+
+    // A key written from two sessions stays on one shard
+    str_t shared = STR_LIT("color");
+    str_t blue = STR_LIT("The sky is blue.");
+    str_t green = STR_LIT("The sky is green.");
+    str_t session_a = STR_LIT("session-a");
+    str_t session_b = STR_LIT("session-b");
+    memory_entry_t* first = memory_entry_create(&shared, &blue, MEMORY_CATEGORY_CORE, &session_a);
+    memory_entry_t* second = memory_entry_create(&shared, &green, MEMORY_CATEGORY_CORE, &session_b);
+    TEST(memory_shard_of(memory, first) == memory_shard_of(memory, second));
+    TEST_OK(memory->vtable->store(memory, first));
+    TEST_OK(memory->vtable->store(memory, second));
+    TEST_OK(memory->vtable->recall(memory, &shared, &recalled));
+    entry_fields_free(&recalled);
+    TEST_OK(memory->vtable->forget(memory, &shared));
+    TEST_OK(memory->vtable->get_stats(memory, &total, NULL));
+    TEST(total == 15);
+
+    for (uint32_t i = 0; i < 16; i++) memory_entry_free(entries[i]);
+    memory->vtable->cleanup(memory);
+    memory_free(memory);
+
+    // Routed by category, the key has a copy per category and recall
+    // answers with the newest, wherever its shard is
+    config.shard_by_category = true;
+    TEST_OK(memory_shard_create("sqlite", &config, &memory));
+    TEST_OK(memory->vtable->init(memory));
+    second->category = MEMORY_CATEGORY_CONVERSATION;
+    free((void*)first->timestamp.data);
+    first->timestamp = str_dup_cstr("2026-01-01 09:00:00", NULL);
+    free((void*)second->timestamp.data);
+    second->timestamp = str_dup_cstr("2026-01-02 09:00:00", NULL);
+    TEST(memory_shard_of(memory, first) < memory_shard_of(memory, second));
+    TEST_OK(memory->vtable->store(memory, first));
+    TEST_OK(memory->vtable->store(memory, second));
+    TEST_OK(memory->vtable->recall(memory, &shared, &recalled));
+    TEST(str_equal(recalled.content, green));
+    entry_fields_free(&recalled);
+    TEST_OK(memory->vtable->forget(memory, &shared));
+    TEST(memory->vtable->recall(memory, &shared, &recalled) == ERR_NOT_FOUND);
+
+    memory_entry_free(first);
+    memory_entry_free(second);
+    memory->vtable->cleanup(memory);
+    memory_free(memory);
+    return true;
+}
+
 static bool test_null_backend(void) {
     printf("Testing null backend...\n");
 
@@ -255,6 +1100,94 @@ int main(void) {
         failed++;
     }
 
+    if (test_memory_search_ranked()) {
+        printf("✓ test_memory_search_ranked passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_search_ranked failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_store_multiple()) {
+        printf("✓ test_memory_store_multiple passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_store_multiple failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_write_behind()) {
+        printf("✓ test_memory_write_behind passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_write_behind failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_hybrid()) {
+        printf("✓ test_memory_hybrid passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_hybrid failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_markdown_index()) {
+        printf("✓ test_memory_markdown_index passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_markdown_index failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_sqlite_pool()) {
+        printf("✓ test_memory_sqlite_pool passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_sqlite_pool failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_sweep()) {
+        printf("✓ test_memory_sweep passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_sweep failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_backup()) {
+        printf("✓ test_memory_backup passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_backup failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_compression()) {
+        printf("✓ test_memory_compression passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_compression failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_cache()) {
+        printf("✓ test_memory_cache passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_cache failed\n\n");
+        failed++;
+    }
+
+    if (test_memory_shard()) {
+        printf("✓ test_memory_shard passed\n\n");
+        passed++;
+    } else {
+        printf("✗ test_memory_shard failed\n\n");
+        failed++;
+    }
+
     if (test_null_backend()) {
         printf("✓ test_null_backend passed\n\n");
         passed++;
@@ -2,17 +2,278 @@
 // SPDX-License-Identifier: MIT
 
 #include "json_config.h"
+#include "core/alloc.h"
+#include "utils/text_scan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <assert.h>
 
+// Initial arena sizes
+#define JSON_DOC_BUILD_SIZE 1024
+#define JSON_DOC_SCALAR_SIZE 256
+#define JSON_INITIAL_CAPACITY 4
+
+// Objects up to this many entries are scanned linearly
+#define JSON_OBJECT_INDEX_THRESHOLD 8
+
+// Document: arena plus the root value handed to callers
+struct json_doc_t {
+    arena_allocator_t* arena;
+    bool owns_arena;
+    json_doc_t* adopted;       // Documents merged into this one
+    json_doc_t* next_adopted;
+    json_value_t root;
+};
+
+#define JSON_DOC_FROM_ROOT(value) \
+    ((json_doc_t*)((char*)(value) - offsetof(json_doc_t, root)))
+
+// ============================================================================
+// Documents
+// ============================================================================
+
+static json_doc_t* doc_create(arena_allocator_t* arena, size_t size_hint) {
+    bool owns = arena == NULL;
+    if (owns) {
+        arena = arena_create(size_hint);
+        if (!arena) return NULL;
+    }
+
+    json_doc_t* doc = alloc(&arena->base, sizeof(json_doc_t));
+    if (!doc) {
+        if (owns) arena_destroy(arena);
+        return NULL;
+    }
+
+    memset(doc, 0, sizeof(json_doc_t));
+    doc->arena = arena;
+    doc->owns_arena = owns;
+    doc->root.flags = JSON_VALUE_ROOT;
+    return doc;
+}
+
+static void doc_destroy(json_doc_t* doc) {
+    json_doc_t* child = doc->adopted;
+    while (child) {
+        json_doc_t* next = child->next_adopted;
+        doc_destroy(child);
+        child = next;
+    }
+
+    if (doc->owns_arena) arena_destroy(doc->arena);
+}
+
+static void* doc_alloc(json_doc_t* doc, size_t size) {
+    return alloc(&doc->arena->base, size);
+}
+
+static char* doc_strndup(json_doc_t* doc, const char* str, size_t len) {
+    char* copy = alloc_aligned(&doc->arena->base, len + 1, 1);
+    if (!copy) return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static json_array_t* doc_new_array(json_doc_t* doc) {
+    json_array_t* arr = doc_alloc(doc, sizeof(json_array_t));
+    if (!arr) return NULL;
+    memset(arr, 0, sizeof(json_array_t));
+    arr->doc = doc;
+    return arr;
+}
+
+static json_object_t* doc_new_object(json_doc_t* doc) {
+    json_object_t* obj = doc_alloc(doc, sizeof(json_object_t));
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(json_object_t));
+    obj->doc = doc;
+    return obj;
+}
+
+// ============================================================================
+// Containers
+// ============================================================================
+
+// FNV-1a
+static uint32_t json_hash(const char* key, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static json_value_t* array_push(json_array_t* arr) {
+    if (arr->count == arr->capacity) {
+        uint32_t new_capacity = arr->capacity ? arr->capacity * 2 : JSON_INITIAL_CAPACITY;
+        json_value_t* items = realloc_ptr(&arr->doc->arena->base, arr->items,
+                                          sizeof(json_value_t) * arr->capacity,
+                                          sizeof(json_value_t) * new_capacity);
+        if (!items) return NULL;
+        arr->items = items;
+        arr->capacity = new_capacity;
+    }
+    return &arr->items[arr->count++];
+}
+
+static bool object_rebuild_index(json_object_t* obj, uint32_t size) {
+    uint32_t* index = doc_alloc(obj->doc, sizeof(uint32_t) * size);
+    if (!index) return false;
+    memset(index, 0, sizeof(uint32_t) * size);
+
+    for (uint32_t i = 0; i < obj->count; i++) {
+        uint32_t slot = obj->entries[i].hash & (size - 1);
+        while (index[slot]) slot = (slot + 1) & (size - 1);
+        index[slot] = i + 1;
+    }
+
+    obj->index = index;
+    obj->index_size = size;
+    return true;
+}
+
+static json_entry_t* object_find(json_object_t* obj, const char* key, size_t key_len, uint32_t hash) {
+    if (obj->index) {
+        uint32_t mask = obj->index_size - 1;
+        for (uint32_t slot = hash & mask; obj->index[slot]; slot = (slot + 1) & mask) {
+            json_entry_t* entry = &obj->entries[obj->index[slot] - 1];
+            if (entry->hash == hash && entry->key_len == key_len &&
+                memcmp(entry->key, key, key_len) == 0) {
+                return entry;
+            }
+        }
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < obj->count; i++) {
+        json_entry_t* entry = &obj->entries[i];
+        if (entry->hash == hash && entry->key_len == key_len &&
+            memcmp(entry->key, key, key_len) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Insert or replace; key is copied unless already arena-owned (key_owned)
+static json_value_t* object_put(json_object_t* obj, const char* key, size_t key_len, bool key_owned) {
+    uint32_t hash = json_hash(key, key_len);
+
+    json_entry_t* existing = object_find(obj, key, key_len, hash);
+    if (existing) return &existing->value;
+
+    if (obj->count == obj->capacity) {
+        uint32_t new_capacity = obj->capacity ? obj->capacity * 2 : JSON_INITIAL_CAPACITY;
+        json_entry_t* entries = realloc_ptr(&obj->doc->arena->base, obj->entries,
+                                            sizeof(json_entry_t) * obj->capacity,
+                                            sizeof(json_entry_t) * new_capacity);
+        if (!entries) return NULL;
+        obj->entries = entries;
+        obj->capacity = new_capacity;
+    }
+
+    char* key_copy = key_owned ? (char*)key : doc_strndup(obj->doc, key, key_len);
+    if (!key_copy) return NULL;
+
+    uint32_t index = obj->count++;
+    json_entry_t* entry = &obj->entries[index];
+    entry->key = key_copy;
+    entry->key_len = (uint32_t)key_len;
+    entry->hash = hash;
+    memset(&entry->value, 0, sizeof(json_value_t));
+
+    // Keep load factor at or below one half; without an index lookups
+    // fall back to a linear scan
+    if (obj->index && obj->count * 2 > obj->index_size) {
+        if (!object_rebuild_index(obj, obj->index_size * 2)) {
+            obj->index = NULL;
+            obj->index_size = 0;
+        }
+    } else if (obj->index) {
+        uint32_t mask = obj->index_size - 1;
+        uint32_t slot = hash & mask;
+        while (obj->index[slot]) slot = (slot + 1) & mask;
+        obj->index[slot] = index + 1;
+    } else if (obj->count > JSON_OBJECT_INDEX_THRESHOLD) {
+        object_rebuild_index(obj, JSON_OBJECT_INDEX_THRESHOLD * 4);
+    }
+
+    return &obj->entries[index].value;
+}
+
+// Deep copy src into doc
+static bool value_copy(json_doc_t* doc, json_value_t* dst, const json_value_t* src) {
+    dst->type = src->type;
+    dst->flags = 0;
+
+    switch (src->type) {
+        case JSON_STRING:
+            dst->string = doc_strndup(doc, src->string, strlen(src->string));
+            return dst->string != NULL;
+
+        case JSON_ARRAY: {
+            dst->array = doc_new_array(doc);
+            if (!dst->array) return false;
+            for (uint32_t i = 0; i < src->array->count; i++) {
+                json_value_t* item = array_push(dst->array);
+                if (!item || !value_copy(doc, item, &src->array->items[i])) return false;
+            }
+            return true;
+        }
+
+        case JSON_OBJECT: {
+            dst->object = doc_new_object(doc);
+            if (!dst->object) return false;
+            for (uint32_t i = 0; i < src->object->count; i++) {
+                json_entry_t* entry = &src->object->entries[i];
+                json_value_t* slot = object_put(dst->object, entry->key, entry->key_len, false);
+                if (!slot || !value_copy(doc, slot, &entry->value)) return false;
+            }
+            return true;
+        }
+
+        default:
+            *dst = *src;
+            dst->flags = 0;
+            return true;
+    }
+}
+
+// Move value into doc: root containers are adopted, everything else is copied
+static void value_attach(json_doc_t* doc, json_value_t* dst, json_value_t* value) {
+    bool is_root = (value->flags & JSON_VALUE_ROOT) != 0;
+    bool is_container = value->type == JSON_ARRAY || value->type == JSON_OBJECT;
+
+    if (is_root && is_container) {
+        json_doc_t* child = JSON_DOC_FROM_ROOT(value);
+        *dst = *value;
+        dst->flags = 0;
+        child->next_adopted = doc->adopted;
+        doc->adopted = child;
+        return;
+    }
+
+    if (!value_copy(doc, dst, value)) {
+        dst->type = JSON_NULL;
+    }
+    if (is_root) json_free(value);
+}
+
+// ============================================================================
+// Parser
+// ============================================================================
+
 // Parser state
 typedef struct {
     const char* text;
     size_t pos;
     size_t len;
+    json_doc_t* doc;
+    char* insitu;          // Same buffer as text when strings are decoded in place
 } json_parser_t;
 
 // Skip whitespace
@@ -39,64 +300,142 @@ static bool is_at_end(json_parser_t* p) {
     return p->pos >= p->len;
 }
 
-// Parse string (handles basic escape sequences)
-static char* parse_string_raw(json_parser_t* p) {
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parse_hex4(json_parser_t* p, uint32_t* out) {
+    if (p->len - p->pos < 4) return false;
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(p->text[p->pos++]);
+        if (digit < 0) return false;
+        value = (value << 4) | (uint32_t)digit;
+    }
+    *out = value;
+    return true;
+}
+
+static size_t encode_utf8(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Parse string into the document arena (handles escapes including \uXXXX)
+static char* parse_string_raw(json_parser_t* p, size_t* out_len) {
     if (peek(p) != '"') return NULL;
     advance(p); // consume opening quote
 
+    // Find the closing quote; escapes never grow the decoded string
     size_t start = p->pos;
-    size_t len = 0;
-
-    // First pass: calculate length
-    while (!is_at_end(p) && peek(p) != '"') {
-        if (peek(p) == '\\') {
-            advance(p);
-            if (!is_at_end(p)) advance(p);
-        } else {
-            advance(p);
-        }
-        len++;
+    bool has_escapes = false;
+    for (;;) {
+        p->pos += text_scan_json_special(p->text + p->pos, p->len - p->pos);
+        if (is_at_end(p) || peek(p) == '"') break;
+        has_escapes = true;
+        advance(p);
+        advance(p);
     }
 
     if (is_at_end(p)) return NULL; // Unterminated string
 
-    // Allocate and copy
-    char* str = malloc(len + 1);
+    size_t raw_len = p->pos - start;
+    if (!has_escapes) {
+        advance(p); // consume closing quote
+        *out_len = raw_len;
+        if (p->insitu) {
+            // The closing quote becomes the terminator
+            p->insitu[start + raw_len] = '\0';
+            return p->insitu + start;
+        }
+        return doc_strndup(p->doc, p->text + start, raw_len);
+    }
+
+    // Decoding never writes ahead of what it has read, so in place is safe
+    char* str = p->insitu ? p->insitu + start : alloc_aligned(&p->doc->arena->base, raw_len + 1, 1);
     if (!str) return NULL;
 
     p->pos = start;
     size_t i = 0;
 
     while (peek(p) != '"') {
-        if (peek(p) == '\\') {
-            advance(p);
-            char c = advance(p);
-            switch (c) {
-                case '"': str[i++] = '"'; break;
-                case '\\': str[i++] = '\\'; break;
-                case '/': str[i++] = '/'; break;
-                case 'b': str[i++] = '\b'; break;
-                case 'f': str[i++] = '\f'; break;
-                case 'n': str[i++] = '\n'; break;
-                case 'r': str[i++] = '\r'; break;
-                case 't': str[i++] = '\t'; break;
-                default: str[i++] = c; break;
+        // Runs between escapes move in one piece; in place they overlap
+        size_t run = text_scan_json_special(p->text + p->pos, p->len - p->pos);
+        if (run > 0) {
+            memmove(str + i, p->text + p->pos, run);
+            i += run;
+            p->pos += run;
+            continue;
+        }
+
+        advance(p);
+        char c = advance(p);
+        switch (c) {
+            case '"': str[i++] = '"'; break;
+            case '\\': str[i++] = '\\'; break;
+            case '/': str[i++] = '/'; break;
+            case 'b': str[i++] = '\b'; break;
+            case 'f': str[i++] = '\f'; break;
+            case 'n': str[i++] = '\n'; break;
+            case 'r': str[i++] = '\r'; break;
+            case 't': str[i++] = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!parse_hex4(p, &cp)) return NULL;
+
+                // Surrogate pair
+                if (cp >= 0xD800 && cp <= 0xDBFF && p->len - p->pos >= 6 &&
+                    p->text[p->pos] == '\\' && p->text[p->pos + 1] == 'u') {
+                    size_t save = p->pos;
+                    uint32_t low;
+                    p->pos += 2;
+                    if (parse_hex4(p, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        p->pos = save;
+                    }
+                }
+
+                i += encode_utf8(cp, str + i);
+                break;
             }
-        } else {
-            str[i++] = advance(p);
+            default: str[i++] = c; break;
         }
     }
 
     str[i] = '\0';
     advance(p); // consume closing quote
+    *out_len = i;
     return str;
 }
 
 // Forward declaration
-static json_value_t* parse_value(json_parser_t* p);
+static bool parse_value(json_parser_t* p, json_value_t* out);
 
 // Parse number
-static json_value_t* parse_number(json_parser_t* p) {
+static bool parse_number(json_parser_t* p, json_value_t* out) {
     size_t start = p->pos;
     bool has_digits = false;
 
@@ -125,75 +464,43 @@ static json_value_t* parse_number(json_parser_t* p) {
         while (isdigit((unsigned char)peek(p))) advance(p);
     }
 
-    if (!has_digits) return NULL;
-
-    char* num_str = malloc(p->pos - start + 1);
-    if (!num_str) return NULL;
+    if (!has_digits) return false;
 
-    strncpy(num_str, p->text + start, p->pos - start);
-    num_str[p->pos - start] = '\0';
-
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (val) {
-        val->type = JSON_NUMBER;
-        val->number = strtod(num_str, NULL);
-    }
+    // Copy the token so strtod never reads past len
+    char buf[64];
+    size_t len = p->pos - start;
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, p->text + start, len);
+    buf[len] = '\0';
 
-    free(num_str);
-    return val;
+    out->type = JSON_NUMBER;
+    out->number = strtod(buf, NULL);
+    return true;
 }
 
 // Parse array
-static json_value_t* parse_array(json_parser_t* p) {
-    if (peek(p) != '[') return NULL;
+static bool parse_array(json_parser_t* p, json_value_t* out) {
+    if (peek(p) != '[') return false;
     advance(p); // consume '['
 
-    json_value_t* arr_val = malloc(sizeof(json_value_t));
-    if (!arr_val) return NULL;
-
-    arr_val->type = JSON_ARRAY;
-    arr_val->array = malloc(sizeof(json_array_t));
-    if (!arr_val->array) {
-        free(arr_val);
-        return NULL;
-    }
-    arr_val->array->next = NULL;
+    json_array_t* arr = doc_new_array(p->doc);
+    if (!arr) return false;
 
-    json_array_t* current = NULL;
+    out->type = JSON_ARRAY;
+    out->array = arr;
 
     skip_whitespace(p);
 
     if (peek(p) == ']') {
         advance(p);
-        return arr_val;
+        return true;
     }
 
     while (true) {
         skip_whitespace(p);
 
-        json_value_t* item = parse_value(p);
-        if (!item) {
-            json_free(arr_val);
-            return NULL;
-        }
-
-        json_array_t* new_item = malloc(sizeof(json_array_t));
-        if (!new_item) {
-            json_free(item);
-            json_free(arr_val);
-            return NULL;
-        }
-
-        new_item->value = *item;
-        free(item); // We copied the value
-        new_item->next = NULL;
-
-        if (current) {
-            current->next = new_item;
-        } else {
-            arr_val->array = new_item;
-        }
-        current = new_item;
+        json_value_t* item = array_push(arr);
+        if (!item || !parse_value(p, item)) return false;
 
         skip_whitespace(p);
 
@@ -202,90 +509,49 @@ static json_value_t* parse_array(json_parser_t* p) {
             continue;
         } else if (peek(p) == ']') {
             advance(p);
-            break;
+            return true;
         } else {
-            json_free(arr_val);
-            return NULL;
+            return false;
         }
     }
-
-    return arr_val;
 }
 
 // Parse object
-static json_value_t* parse_object(json_parser_t* p) {
-    if (peek(p) != '{') return NULL;
+static bool parse_object(json_parser_t* p, json_value_t* out) {
+    if (peek(p) != '{') return false;
     advance(p); // consume '{'
 
-    json_value_t* obj_val = malloc(sizeof(json_value_t));
-    if (!obj_val) return NULL;
+    json_object_t* obj = doc_new_object(p->doc);
+    if (!obj) return false;
 
-    obj_val->type = JSON_OBJECT;
-    obj_val->object = malloc(sizeof(json_object_t));
-    if (!obj_val->object) {
-        free(obj_val);
-        return NULL;
-    }
-    obj_val->object->entries = NULL;
-
-    json_entry_t* current = NULL;
+    out->type = JSON_OBJECT;
+    out->object = obj;
 
     skip_whitespace(p);
 
     if (peek(p) == '}') {
         advance(p);
-        return obj_val;
+        return true;
     }
 
     while (true) {
         skip_whitespace(p);
 
         // Parse key
-        char* key = parse_string_raw(p);
-        if (!key) {
-            json_free(obj_val);
-            return NULL;
-        }
+        size_t key_len = 0;
+        char* key = parse_string_raw(p, &key_len);
+        if (!key) return false;
 
         skip_whitespace(p);
 
-        if (peek(p) != ':') {
-            free(key);
-            json_free(obj_val);
-            return NULL;
-        }
+        if (peek(p) != ':') return false;
         advance(p); // consume ':'
 
         skip_whitespace(p);
 
-        // Parse value
-        json_value_t* value = parse_value(p);
-        if (!value) {
-            free(key);
-            json_free(obj_val);
-            return NULL;
-        }
-
-        // Create entry
-        json_entry_t* entry = malloc(sizeof(json_entry_t));
-        if (!entry) {
-            free(key);
-            json_free(value);
-            json_free(obj_val);
-            return NULL;
-        }
-
-        entry->key = key;
-        entry->value = *value;
-        free(value); // We copied the value
-        entry->next = NULL;
-
-        if (current) {
-            current->next = entry;
-        } else {
-            obj_val->object->entries = entry;
-        }
-        current = entry;
+        // Duplicate keys: last one wins
+        json_value_t* slot = object_put(obj, key, key_len, true);
+        if (!slot || !parse_value(p, slot)) return false;
 
         skip_whitespace(p);
 
@@ -294,52 +560,46 @@ static json_value_t* parse_object(json_parser_t* p) {
             continue;
         } else if (peek(p) == '}') {
             advance(p);
-            break;
+            return true;
         } else {
-            json_free(obj_val);
-            return NULL;
+            return false;
         }
     }
-
-    return obj_val;
 }
 
 // Parse value
-static json_value_t* parse_value(json_parser_t* p) {
+static bool parse_value(json_parser_t* p, json_value_t* out) {
     skip_whitespace(p);
 
-    if (is_at_end(p)) return NULL;
+    memset(out, 0, sizeof(json_value_t));
+    if (is_at_end(p)) return false;
 
     char c = peek(p);
 
     // String
     if (c == '"') {
-        char* str = parse_string_raw(p);
-        if (!str) return NULL;
+        size_t len = 0;
+        char* str = parse_string_raw(p, &len);
+        if (!str) return false;
 
-        json_value_t* val = malloc(sizeof(json_value_t));
-        if (val) {
-            val->type = JSON_STRING;
-            val->string = str;
-        } else {
-            free(str);
-        }
-        return val;
+        out->type = JSON_STRING;
+        out->string = str;
+        return true;
     }
 
     // Object
     if (c == '{') {
-        return parse_object(p);
+        return parse_object(p, out);
     }
 
     // Array
     if (c == '[') {
-        return parse_array(p);
+        return parse_array(p, out);
     }
 
     // Number
     if (c == '-' || isdigit((unsigned char)c)) {
-        return parse_number(p);
+        return parse_number(p, out);
     }
 
     // Boolean or null
@@ -348,57 +608,77 @@ static json_value_t* parse_value(json_parser_t* p) {
 
     if (remaining >= 4 && strncmp(text, "true", 4) == 0) {
         p->pos += 4;
-        json_value_t* val = malloc(sizeof(json_value_t));
-        if (val) {
-            val->type = JSON_BOOL;
-            val->boolean = true;
-        }
-        return val;
+        out->type = JSON_BOOL;
+        out->boolean = true;
+        return true;
     }
 
     if (remaining >= 5 && strncmp(text, "false", 5) == 0) {
         p->pos += 5;
-        json_value_t* val = malloc(sizeof(json_value_t));
-        if (val) {
-            val->type = JSON_BOOL;
-            val->boolean = false;
-        }
-        return val;
+        out->type = JSON_BOOL;
+        out->boolean = false;
+        return true;
     }
 
     if (remaining >= 4 && strncmp(text, "null", 4) == 0) {
         p->pos += 4;
-        json_value_t* val = malloc(sizeof(json_value_t));
-        if (val) {
-            val->type = JSON_NULL;
-        }
-        return val;
+        out->type = JSON_NULL;
+        return true;
     }
 
-    return NULL;
+    return false;
 }
 
-// Parse JSON from string
-json_value_t* json_parse(const char* text) {
+static json_value_t* parse_document(const char* text, size_t len, arena_allocator_t* arena, char* insitu) {
     if (!text) return NULL;
 
+    // Strings and nodes together rarely exceed twice the input size; in
+    // place, only the nodes need room
+    json_doc_t* doc = doc_create(arena, (insitu ? len : len * 2) + 512);
+    if (!doc) return NULL;
+
     json_parser_t parser = {
         .text = text,
         .pos = 0,
-        .len = strlen(text)
+        .len = len,
+        .doc = doc,
+        .insitu = insitu
     };
 
-    json_value_t* value = parse_value(&parser);
-    if (!value) return NULL;
+    json_value_t* root = &doc->root;
+    if (!parse_value(&parser, root)) {
+        doc_destroy(doc);
+        return NULL;
+    }
+    root->flags = JSON_VALUE_ROOT;
 
     skip_whitespace(&parser);
 
     if (!is_at_end(&parser)) {
-        json_free(value);
+        doc_destroy(doc);
         return NULL;
     }
 
-    return value;
+    return root;
+}
+
+// Parse JSON from string
+json_value_t* json_parse(const char* text) {
+    if (!text) return NULL;
+    return parse_document(text, strlen(text), NULL, NULL);
+}
+
+json_value_t* json_parse_len(const char* text, size_t len) {
+    return parse_document(text, len, NULL, NULL);
+}
+
+json_value_t* json_parse_insitu(char* text, size_t len) {
+    return parse_document(text, len, NULL, text);
+}
+
+json_value_t* json_parse_arena(const char* text, size_t len, arena_allocator_t* arena) {
+    if (!arena) return NULL;
+    return parse_document(text, len, arena, NULL);
 }
 
 // Parse JSON from file
@@ -426,74 +706,26 @@ json_value_t* json_parse_file(const char* filename) {
 
     content[read] = '\0';
 
-    json_value_t* value = json_parse(content);
+    json_value_t* value = json_parse_len(content, read);
     free(content);
 
     return value;
 }
 
-// Internal: free value contents without freeing the value itself
-static void json_free_contents(json_value_t* value) {
-    if (!value) return;
-
-    switch (value->type) {
-        case JSON_STRING:
-            free(value->string);
-            value->string = NULL;
-            break;
-
-        case JSON_ARRAY: {
-            json_array_t* item = value->array;
-            while (item) {
-                json_array_t* next = item->next;
-                json_free_contents(&item->value);
-                free(item);
-                item = next;
-            }
-            value->array = NULL;
-            break;
-        }
-
-        case JSON_OBJECT: {
-            json_entry_t* entry = value->object->entries;
-            while (entry) {
-                json_entry_t* next = entry->next;
-                free(entry->key);
-                json_free_contents(&entry->value);
-                free(entry);
-                entry = next;
-            }
-            free(value->object);
-            value->object = NULL;
-            break;
-        }
-
-        default:
-            break;
-    }
-}
-
-// Free JSON value
+// Free JSON document
 void json_free(json_value_t* value) {
-    if (!value) return;
+    if (!value || !(value->flags & JSON_VALUE_ROOT)) return;
 
-    json_free_contents(value);
-    free(value);
+    doc_destroy(JSON_DOC_FROM_ROOT(value));
 }
 
 // Get value from object by key
 json_value_t* json_object_get(json_object_t* obj, const char* key) {
     if (!obj || !key) return NULL;
 
-    json_entry_t* entry = obj->entries;
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return &entry->value;
-        }
-        entry = entry->next;
-    }
-
-    return NULL;
+    size_t key_len = strlen(key);
+    json_entry_t* entry = object_find(obj, key, key_len, json_hash(key, key_len));
+    return entry ? &entry->value : NULL;
 }
 
 // Get bool from object
@@ -533,28 +765,13 @@ bool json_object_has(json_object_t* obj, const char* key) {
 
 // Get array length
 size_t json_array_length(json_array_t* arr) {
-    if (!arr) return 0;
-
-    size_t count = 0;
-    while (arr) {
-        count++;
-        arr = arr->next;
-    }
-    return count;
+    return arr ? arr->count : 0;
 }
 
 // Get array item at index
 json_value_t* json_array_get(json_array_t* arr, size_t index) {
-    if (!arr) return NULL;
-
-    size_t i = 0;
-    while (arr) {
-        if (i == index) return &arr->value;
-        i++;
-        arr = arr->next;
-    }
-
-    return NULL;
+    if (!arr || index >= arr->count) return NULL;
+    return &arr->items[index];
 }
 
 // Type checks
@@ -594,6 +811,7 @@ json_object_t* json_as_object(json_value_t* val) {
 // Forward declarations for printing helpers
 static void append_char(char** out, size_t* cap, size_t* len, char c);
 static void append_string(char** out, size_t* cap, size_t* len, const char* str);
+static void append_bytes(char** out, size_t* cap, size_t* len, const char* str, size_t slen);
 
 // Helper for printing
 static void print_indent(char** out, size_t* cap, size_t* len, int indent) {
@@ -613,8 +831,7 @@ static void append_char(char** out, size_t* cap, size_t* len, char c) {
     (*out)[(*len)++] = c;
 }
 
-static void append_string(char** out, size_t* cap, size_t* len, const char* str) {
-    size_t slen = strlen(str);
+static void append_bytes(char** out, size_t* cap, size_t* len, const char* str, size_t slen) {
     while (*len + slen + 1 >= *cap) {
         *cap *= 2;
         char* new_out = realloc(*out, *cap);
@@ -625,13 +842,25 @@ static void append_string(char** out, size_t* cap, size_t* len, const char* str)
     *len += slen;
 }
 
+static void append_string(char** out, size_t* cap, size_t* len, const char* str) {
+    append_bytes(out, cap, len, str, strlen(str));
+}
+
 static void print_value(json_value_t* val, char** out, size_t* cap, size_t* len, int indent, bool pretty);
 
 static void print_string_escaped(const char* str, char** out, size_t* cap, size_t* len) {
     append_char(out, cap, len, '"');
 
-    while (*str) {
+    size_t remaining = strlen(str);
+    while (remaining > 0) {
+        size_t run = text_scan_json_escape(str, remaining);
+        append_bytes(out, cap, len, str, run);
+        str += run;
+        remaining -= run;
+        if (remaining == 0) break;
+
         char c = *str++;
+        remaining--;
         switch (c) {
             case '"': append_string(out, cap, len, "\\\""); break;
             case '\\': append_string(out, cap, len, "\\\\"); break;
@@ -657,15 +886,12 @@ static void print_string_escaped(const char* str, char** out, size_t* cap, size_
 static void print_array(json_array_t* arr, char** out, size_t* cap, size_t* len, int indent, bool pretty) {
     append_char(out, cap, len, '[');
 
-    bool first = true;
-    while (arr) {
-        if (!first) append_char(out, cap, len, ',');
+    uint32_t count = arr ? arr->count : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0) append_char(out, cap, len, ',');
         if (pretty) append_char(out, cap, len, ' ');
 
-        print_value(&arr->value, out, cap, len, indent, pretty);
-
-        first = false;
-        arr = arr->next;
+        print_value(&arr->items[i], out, cap, len, indent, pretty);
     }
 
     append_char(out, cap, len, ']');
@@ -674,15 +900,16 @@ static void print_array(json_array_t* arr, char** out, size_t* cap, size_t* len,
 static void print_object(json_object_t* obj, char** out, size_t* cap, size_t* len, int indent, bool pretty) {
     append_char(out, cap, len, '{');
 
-    if (pretty && obj && obj->entries) {
+    uint32_t count = obj ? obj->count : 0;
+
+    if (pretty && count > 0) {
         append_char(out, cap, len, '\n');
     }
 
-    json_entry_t* entry = obj ? obj->entries : NULL;
-    bool first = true;
+    for (uint32_t i = 0; i < count; i++) {
+        json_entry_t* entry = &obj->entries[i];
 
-    while (entry) {
-        if (!first) {
+        if (i > 0) {
             append_char(out, cap, len, ',');
             if (pretty) append_char(out, cap, len, '\n');
         }
@@ -694,12 +921,9 @@ static void print_object(json_object_t* obj, char** out, size_t* cap, size_t* le
         if (pretty) append_char(out, cap, len, ' ');
 
         print_value(&entry->value, out, cap, len, indent + 1, pretty);
-
-        first = false;
-        entry = entry->next;
     }
 
-    if (pretty && obj && obj->entries) {
+    if (pretty && count > 0) {
         append_char(out, cap, len, '\n');
         print_indent(out, cap, len, indent);
     }
@@ -763,30 +987,47 @@ char* json_print(json_value_t* value, bool pretty) {
     return out;
 }
 
+// Create a standalone root value
+static json_value_t* create_root(json_type_t type, size_t size_hint) {
+    json_doc_t* doc = doc_create(NULL, size_hint);
+    if (!doc) return NULL;
+
+    json_value_t* val = &doc->root;
+    val->type = type;
+
+    if (type == JSON_ARRAY) {
+        val->array = doc_new_array(doc);
+        if (!val->array) {
+            doc_destroy(doc);
+            return NULL;
+        }
+    } else if (type == JSON_OBJECT) {
+        val->object = doc_new_object(doc);
+        if (!val->object) {
+            doc_destroy(doc);
+            return NULL;
+        }
+    }
+
+    return val;
+}
+
 // Create JSON null
 json_value_t* json_create_null(void) {
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (val) val->type = JSON_NULL;
-    return val;
+    return create_root(JSON_NULL, JSON_DOC_SCALAR_SIZE);
 }
 
 // Create JSON bool
 json_value_t* json_create_bool(bool value) {
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (val) {
-        val->type = JSON_BOOL;
-        val->boolean = value;
-    }
+    json_value_t* val = create_root(JSON_BOOL, JSON_DOC_SCALAR_SIZE);
+    if (val) val->boolean = value;
     return val;
 }
 
 // Create JSON number
 json_value_t* json_create_number(double value) {
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (val) {
-        val->type = JSON_NUMBER;
-        val->number = value;
-    }
+    json_value_t* val = create_root(JSON_NUMBER, JSON_DOC_SCALAR_SIZE);
+    if (val) val->number = value;
     return val;
 }
 
@@ -794,112 +1035,85 @@ json_value_t* json_create_number(double value) {
 json_value_t* json_create_string(const char* value) {
     if (!value) return NULL;
 
-    json_value_t* val = malloc(sizeof(json_value_t));
+    size_t len = strlen(value);
+    json_value_t* val = create_root(JSON_STRING, JSON_DOC_SCALAR_SIZE + len);
     if (!val) return NULL;
 
-    val->type = JSON_STRING;
-    val->string = strdup(value);
+    val->string = doc_strndup(JSON_DOC_FROM_ROOT(val), value, len);
+    if (!val->string) {
+        json_free(val);
+        return NULL;
+    }
 
     return val;
 }
 
 // Create JSON array
 json_value_t* json_create_array(void) {
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (!val) return NULL;
-
-    val->type = JSON_ARRAY;
-    val->array = NULL;  // Empty array, no head node
-
-    return val;
+    return create_root(JSON_ARRAY, JSON_DOC_BUILD_SIZE);
 }
 
 // Create JSON object
 json_value_t* json_create_object(void) {
-    json_value_t* val = malloc(sizeof(json_value_t));
-    if (!val) return NULL;
-
-    val->type = JSON_OBJECT;
-    val->object = malloc(sizeof(json_object_t));
-    if (!val->object) {
-        free(val);
-        return NULL;
-    }
-    val->object->entries = NULL;
-
-    return val;
+    return create_root(JSON_OBJECT, JSON_DOC_BUILD_SIZE);
 }
 
 // Append to array
 void json_array_append(json_value_t* arr, json_value_t* item) {
     if (!arr || arr->type != JSON_ARRAY || !item) return;
 
-    json_array_t* new_item = malloc(sizeof(json_array_t));
-    if (!new_item) return;
-
-    new_item->value = *item;
-    new_item->next = NULL;
-
-    if (!arr->array || !arr->array->next) {
-        // First item or empty
-        if (arr->array) {
-            // Find end
-            json_array_t* last = arr->array;
-            while (last->next) last = last->next;
-            last->next = new_item;
-        } else {
-            arr->array = new_item;
-        }
-    } else {
-        // Find end
-        json_array_t* last = arr->array;
-        while (last->next) last = last->next;
-        last->next = new_item;
+    json_value_t* slot = array_push(arr->array);
+    if (!slot) {
+        json_free(item);
+        return;
     }
 
-    free(item); // We copied the value
+    value_attach(arr->array->doc, slot, item);
 }
 
 // Set object property
 void json_object_set(json_value_t* obj, const char* key, json_value_t* value) {
     if (!obj || obj->type != JSON_OBJECT || !key || !value) return;
 
-    // Check if key already exists
-    json_entry_t* entry = obj->object->entries;
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            // Replace value
-            json_free(&entry->value);
-            entry->value = *value;
-            free(value);
-            return;
-        }
-        entry = entry->next;
+    json_value_t* slot = object_put(obj->object, key, strlen(key), false);
+    if (!slot) {
+        json_free(value);
+        return;
     }
 
-    // Add new entry
-    entry = malloc(sizeof(json_entry_t));
-    if (!entry) return;
+    // A replaced value stays in the arena until the document is freed
+    value_attach(obj->object->doc, slot, value);
+}
 
-    entry->key = strdup(key);
-    entry->value = *value;
-    entry->next = obj->object->entries;
-    obj->object->entries = entry;
+// Scalar setters write straight into the parent's arena
+static json_value_t* object_slot(json_value_t* obj, const char* key) {
+    if (!obj || obj->type != JSON_OBJECT || !key) return NULL;
 
-    free(value);
+    json_value_t* slot = object_put(obj->object, key, strlen(key), false);
+    if (slot) memset(slot, 0, sizeof(json_value_t));
+    return slot;
 }
 
 void json_object_set_bool(json_value_t* obj, const char* key, bool value) {
-    json_value_t* val = json_create_bool(value);
-    if (val) json_object_set(obj, key, val);
+    json_value_t* slot = object_slot(obj, key);
+    if (!slot) return;
+    slot->type = JSON_BOOL;
+    slot->boolean = value;
 }
 
 void json_object_set_number(json_value_t* obj, const char* key, double value) {
-    json_value_t* val = json_create_number(value);
-    if (val) json_object_set(obj, key, val);
+    json_value_t* slot = object_slot(obj, key);
+    if (!slot) return;
+    slot->type = JSON_NUMBER;
+    slot->number = value;
 }
 
 void json_object_set_string(json_value_t* obj, const char* key, const char* value) {
-    json_value_t* val = json_create_string(value);
-    if (val) json_object_set(obj, key, val);
+    if (!value) return;
+
+    json_value_t* slot = object_slot(obj, key);
+    if (!slot) return;
+
+    slot->string = doc_strndup(obj->object->doc, value, strlen(value));
+    slot->type = slot->string ? JSON_STRING : JSON_NULL;
 }
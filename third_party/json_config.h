@@ -23,10 +23,16 @@ typedef enum {
 typedef struct json_value_t json_value_t;
 typedef struct json_object_t json_object_t;
 typedef struct json_array_t json_array_t;
+typedef struct json_doc_t json_doc_t;
+typedef struct arena_allocator_t arena_allocator_t;
+
+// Value flags
+#define JSON_VALUE_ROOT 0x1u   // Value is a document root (owns the document)
 
 // JSON value structure
 struct json_value_t {
     json_type_t type;
+    uint32_t flags;
     union {
         bool boolean;
         double number;
@@ -36,32 +42,54 @@ struct json_value_t {
     };
 };
 
-// JSON array (linked list)
+// JSON array (contiguous, O(1) indexing)
 struct json_array_t {
-    json_value_t value;
-    json_array_t* next;
+    json_value_t* items;
+    uint32_t count;
+    uint32_t capacity;
+    json_doc_t* doc;           // Document whose arena backs this array
 };
 
-// JSON object entry (linked list)
+// JSON object entry
 typedef struct json_entry_t {
     char* key;
+    uint32_t key_len;
+    uint32_t hash;
     json_value_t value;
-    struct json_entry_t* next;
 } json_entry_t;
 
-// JSON object
+// JSON object (entries in insertion order, hash index once it grows)
 struct json_object_t {
     json_entry_t* entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* index;           // Open-addressed slots holding entry index + 1
+    uint32_t index_size;       // Power of two, 0 while the object is small
+    json_doc_t* doc;
 };
 
+// Every tree lives in a document backed by an arena allocator; all values,
+// strings and containers are carved from it. json_free on a root releases
+// the whole document at once. Values obtained from a tree are borrowed and
+// stay valid until the root is freed.
+
 // Parse JSON from string
 // Returns NULL on parse error
 json_value_t* json_parse(const char* text);
+json_value_t* json_parse_len(const char* text, size_t len);
+
+// Parse without copying strings: they are decoded in place and point into
+// text, which is overwritten and must outlive the tree
+json_value_t* json_parse_insitu(char* text, size_t len);
+
+// Parse into a caller-owned arena; json_free then only drops the document
+// header and the caller reclaims memory with arena_reset/arena_destroy
+json_value_t* json_parse_arena(const char* text, size_t len, arena_allocator_t* arena);
 
 // Parse JSON from file
 json_value_t* json_parse_file(const char* filename);
 
-// Free JSON value and all children
+// Free a document root (no-op for values inside a tree)
 void json_free(json_value_t* value);
 
 // Getters for object properties
@@ -105,10 +133,11 @@ json_value_t* json_create_string(const char* value);
 json_value_t* json_create_array(void);
 json_value_t* json_create_object(void);
 
-// Add to array
+// Add to array (takes ownership of item)
 void json_array_append(json_value_t* arr, json_value_t* item);
 
-// Add to object (takes ownership of value)
+// Add to object (takes ownership of value; a root's document is merged into
+// the parent, other values are copied)
 void json_object_set(json_value_t* obj, const char* key, json_value_t* value);
 void json_object_set_bool(json_value_t* obj, const char* key, bool value);
 void json_object_set_number(json_value_t* obj, const char* key, double value);